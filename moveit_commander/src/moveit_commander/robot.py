@@ -145,6 +145,15 @@ class RobotCommander(object):
             """
             return conversions.list_to_pose_stamped(self._robot._r.get_link_pose(self._name), self._robot.get_planning_frame())
 
+        def poses(self, group, values):
+            """
+            Compute the pose of this link for many states of a group at once.
+            @param group str: Name of the group the values are for
+            @param values: N x V array (e.g. a float64 numpy array) of group variable values
+            @return: N x 7 memoryview of (x, y, z, qx, qy, qz, qw); wrap it with numpy.asarray() to avoid a copy
+            """
+            return self._robot._r.get_link_poses(self._name, group, values)
+
     def __init__(self, robot_description="robot_description", ns=""):
         self._robot_description = robot_description
         self._ns = ns
@@ -52,7 +52,9 @@ namespace tools
 {
 /** \brief This class provides simple API for executing background
     jobs. A queue of jobs is created and the specified jobs are
-    executed in order, one at a time. */
+    executed in order, one at a time. The jobs are executed by the
+    shared TaskScheduler at low priority, no thread is started per
+    instance. */
 class BackgroundProcessing : private boost::noncopyable
 {
 public:
@@ -74,10 +76,10 @@ public:
   /** \brief The signature for job callbacks */
   typedef boost::function<void()> JobCallback;
 
-  /** \brief Constructor. The background thread is activated automatically. */
+  /** \brief Constructor. Jobs are executed by the shared TaskScheduler. */
   BackgroundProcessing();
 
-  /** \brief Finishes currently executing job, clears the remaining queue. */
+  /** \brief Waits until the queued jobs are executed. */
   ~BackgroundProcessing();
 
   /** \brief Add a job to the queue of jobs to execute. A name is also specifies for the job */
@@ -96,11 +98,7 @@ public:
   void clearJobUpdateEvent();
 
 private:
-  std::unique_ptr<boost::thread> processing_thread_;
-  bool run_processing_thread_;
-
   mutable boost::mutex action_lock_;
-  boost::condition_variable new_action_condition_;
   std::deque<JobCallback> actions_;
   std::deque<std::string> action_names_;
 
@@ -108,7 +106,12 @@ private:
 
   bool processing_;
 
-  void processingThread();
+  /** \brief Whether a task executing the queued jobs is submitted to the scheduler */
+  bool scheduled_;
+  boost::condition_variable scheduled_condition_;
+
+  /** \brief Execute the queued jobs in order, until the queue is empty */
+  void processJobs();
 };
 }  // namespace tools
 }  // namespace moveit
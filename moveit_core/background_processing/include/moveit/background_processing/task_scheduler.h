@@ -0,0 +1,144 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, PickNik LLC
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik LLC nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <boost/noncopyable.hpp>
+
+namespace moveit
+{
+namespace tools
+{
+/** \brief A pool of worker threads executing tasks, meant to be shared by all components of a process instead of
+    each component running its own threads.
+
+    Every worker has its own queues of tasks. Tasks submitted by a worker are queued by this worker and executed last
+    in, first out, while tasks submitted by other threads are distributed round-robin. Idle workers steal the oldest
+    tasks queued by the others. Tasks of a higher priority are always taken before those of a lower priority.
+
+    Tasks should not block while waiting for other tasks, since all workers may be blocked then. Use parallelFor()
+    instead, in which the calling thread takes part in the work. */
+class TaskScheduler : private boost::noncopyable
+{
+public:
+  /** \brief Priorities of tasks, in decreasing order */
+  enum Priority
+  {
+    /// Latency sensitive work, e.g. collision checks of a running plan
+    HIGH,
+    /// The default priority
+    NORMAL,
+    /// Long running background work, e.g. the jobs of BackgroundProcessing
+    LOW
+  };
+
+  /** \brief The signature of tasks */
+  typedef std::function<void()> Task;
+
+  /** \brief Start \e thread_count workers (the number of hardware threads if 0). If \e cpu_affinity is not empty,
+      worker i is pinned to the CPU cpu_affinity[i % cpu_affinity.size()]. */
+  explicit TaskScheduler(std::size_t thread_count = 0, const std::vector<int>& cpu_affinity = std::vector<int>());
+
+  /** \brief Execute the queued tasks and stop the workers */
+  ~TaskScheduler();
+
+  /** \brief Get the scheduler shared by all components, created on first use */
+  static TaskScheduler& getGlobal();
+
+  /** \brief Set the number of workers and their CPU affinity for the shared scheduler.
+      @return false if the shared scheduler was already created, in which case nothing is changed */
+  static bool configureGlobal(std::size_t thread_count, const std::vector<int>& cpu_affinity = std::vector<int>());
+
+  std::size_t getThreadCount() const
+  {
+    return workers_.size();
+  }
+
+  /** \brief Whether the calling thread is a worker of this scheduler */
+  bool isWorkerThread() const;
+
+  /** \brief Queue \e task for execution. Exceptions thrown by the task are logged. */
+  void submit(Task task, Priority priority = NORMAL);
+
+  /** \brief Queue \e function for execution and return a future for its result (or exception) */
+  template <typename Function>
+  auto async(Function&& function, Priority priority = NORMAL) -> std::future<decltype(function())>
+  {
+    using Result = decltype(function());
+    auto task = std::make_shared<std::packaged_task<Result()>>(std::forward<Function>(function));
+    std::future<Result> future = task->get_future();
+    submit([task] { (*task)(); }, priority);
+    return future;
+  }
+
+  /** \brief Call \e function for all indices in [begin, end), in chunks of \e grain_size indices, and return when all
+      calls completed. The calling thread processes chunks too, so this can be used from within tasks. The first
+      exception thrown by \e function is rethrown after all chunks completed. */
+  void parallelFor(std::size_t begin, std::size_t end, const std::function<void(std::size_t)>& function,
+                   std::size_t grain_size = 1, Priority priority = NORMAL);
+
+private:
+  static const std::size_t PRIORITY_COUNT = LOW + 1;
+
+  struct Worker
+  {
+    std::mutex lock;
+    std::deque<Task> queues[PRIORITY_COUNT];
+    std::thread thread;
+  };
+
+  /** \brief Take a task for worker \e index, from its own queues or stolen from the other workers */
+  bool takeTask(std::size_t index, Task& task);
+
+  void runWorker(std::size_t index);
+
+  std::vector<std::unique_ptr<Worker>> workers_;
+  std::atomic<std::size_t> next_worker_;   // where the next task submitted by another thread is queued
+  std::atomic<std::size_t> queued_tasks_;  // number of tasks in all queues
+
+  std::mutex wake_lock_;
+  std::condition_variable wake_condition_;
+  bool stop_;
+};
+}  // namespace tools
+}  // namespace moveit
@@ -35,6 +35,7 @@
 /* Author: Ioan Sucan */
 
 #include <moveit/background_processing/background_processing.h>
+#include <moveit/background_processing/task_scheduler.h>
 #include "rclcpp/rclcpp.hpp"
 
 namespace moveit
@@ -44,68 +45,67 @@ namespace tools
 // Logger
 static const rclcpp::Logger LOGGER = rclcpp::get_logger("moveit_background_processing.background_processing");
 
-BackgroundProcessing::BackgroundProcessing()
+BackgroundProcessing::BackgroundProcessing() : processing_(false), scheduled_(false)
 {
-  // spin a thread that will process user events
-  run_processing_thread_ = true;
-  processing_ = false;
-  processing_thread_.reset(new boost::thread(boost::bind(&BackgroundProcessing::processingThread, this)));
 }
 
 BackgroundProcessing::~BackgroundProcessing()
 {
-  run_processing_thread_ = false;
-  new_action_condition_.notify_all();
-  processing_thread_->join();
+  boost::unique_lock<boost::mutex> ulock(action_lock_);
+  while (scheduled_)
+    scheduled_condition_.wait(ulock);
 }
 
-void BackgroundProcessing::processingThread()
+void BackgroundProcessing::processJobs()
 {
   boost::unique_lock<boost::mutex> ulock(action_lock_);
 
-  while (run_processing_thread_)
+  while (!actions_.empty())
   {
-    while (actions_.empty() && run_processing_thread_)
-      new_action_condition_.wait(ulock);
+    JobCallback fn = actions_.front();
+    std::string action_name = action_names_.front();
+    actions_.pop_front();
+    action_names_.pop_front();
+    processing_ = true;
 
-    while (!actions_.empty())
+    // make sure we are unlocked while we process the event
+    action_lock_.unlock();
+    try
     {
-      JobCallback fn = actions_.front();
-      std::string action_name = action_names_.front();
-      actions_.pop_front();
-      action_names_.pop_front();
-      processing_ = true;
-
-      // make sure we are unlocked while we process the event
-      action_lock_.unlock();
-      try
-      {
-        RCLCPP_DEBUG(LOGGER, "Begin executing '%s'", action_name.c_str());
-        fn();
-        RCLCPP_DEBUG(LOGGER, "Done executing '%s'", action_name.c_str());
-      }
-      catch (std::exception& ex)
-      {
-        RCLCPP_ERROR(LOGGER, "Exception caught while processing action '%s': %s", action_name.c_str(), ex.what());
-      }
-      processing_ = false;
-      if (queue_change_event_)
-        queue_change_event_(COMPLETE, action_name);
-      action_lock_.lock();
+      RCLCPP_DEBUG(LOGGER, "Begin executing '%s'", action_name.c_str());
+      fn();
+      RCLCPP_DEBUG(LOGGER, "Done executing '%s'", action_name.c_str());
     }
+    catch (std::exception& ex)
+    {
+      RCLCPP_ERROR(LOGGER, "Exception caught while processing action '%s': %s", action_name.c_str(), ex.what());
+    }
+    processing_ = false;
+    if (queue_change_event_)
+      queue_change_event_(COMPLETE, action_name);
+    action_lock_.lock();
   }
+
+  // the destructor may return once this is reset, so this must not be accessed afterwards
+  scheduled_ = false;
+  scheduled_condition_.notify_all();
 }
 
 void BackgroundProcessing::addJob(const boost::function<void()>& job, const std::string& name)
 {
+  bool schedule = false;
   {
     boost::mutex::scoped_lock _(action_lock_);
     actions_.push_back(job);
     action_names_.push_back(name);
-    new_action_condition_.notify_all();
+    // jobs are executed one at a time, by a single task at a time
+    schedule = !scheduled_;
+    scheduled_ = true;
   }
   if (queue_change_event_)
     queue_change_event_(ADD, name);
+  if (schedule)
+    TaskScheduler::getGlobal().submit([this] { processJobs(); }, TaskScheduler::LOW);
 }
 
 void BackgroundProcessing::clear()
@@ -0,0 +1,280 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, PickNik LLC
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik LLC nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include <moveit/background_processing/task_scheduler.h>
+#include <algorithm>
+#include <exception>
+#include "rclcpp/rclcpp.hpp"
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace moveit
+{
+namespace tools
+{
+// Logger
+static const rclcpp::Logger LOGGER = rclcpp::get_logger("moveit_background_processing.task_scheduler");
+
+namespace
+{
+// The scheduler and worker index of the calling thread, if it is a worker
+thread_local const TaskScheduler* current_scheduler = nullptr;
+thread_local std::size_t current_worker = 0;
+
+std::mutex global_lock;
+std::unique_ptr<TaskScheduler> global_scheduler;
+std::size_t global_thread_count = 0;
+std::vector<int> global_cpu_affinity;
+
+// The progress of a parallelFor() call, shared with the tasks helping with it
+struct ParallelForState
+{
+  std::size_t begin;
+  std::size_t end;
+  std::size_t grain_size;
+  std::function<void(std::size_t)> function;
+  std::size_t chunk_count;
+  std::atomic<std::size_t> next_chunk{ 0 };
+  std::atomic<std::size_t> completed_chunks{ 0 };
+  std::mutex lock;
+  std::condition_variable done_condition;
+  std::exception_ptr exception;
+
+  // Process chunks until none are left
+  void work()
+  {
+    std::size_t chunk;
+    while ((chunk = next_chunk++) < chunk_count)
+    {
+      const std::size_t chunk_begin = begin + chunk * grain_size;
+      const std::size_t chunk_end = std::min(end, chunk_begin + grain_size);
+      try
+      {
+        for (std::size_t i = chunk_begin; i < chunk_end; ++i)
+          function(i);
+      }
+      catch (...)
+      {
+        std::lock_guard<std::mutex> _(lock);
+        if (!exception)
+          exception = std::current_exception();
+      }
+      if (++completed_chunks == chunk_count)
+      {
+        std::lock_guard<std::mutex> _(lock);
+        done_condition.notify_all();
+      }
+    }
+  }
+};
+
+void setAffinity(std::thread& thread, int cpu)
+{
+#ifdef __linux__
+  cpu_set_t cpu_set;
+  CPU_ZERO(&cpu_set);
+  CPU_SET(cpu, &cpu_set);
+  if (pthread_setaffinity_np(thread.native_handle(), sizeof(cpu_set), &cpu_set) != 0)
+    RCLCPP_WARN(LOGGER, "Unable to pin task scheduler worker to CPU %d", cpu);
+#else
+  (void)thread;
+  RCLCPP_WARN(LOGGER, "Pinning task scheduler workers to CPU %d is not supported on this platform", cpu);
+#endif
+}
+}  // namespace
+
+TaskScheduler::TaskScheduler(std::size_t thread_count, const std::vector<int>& cpu_affinity)
+  : next_worker_(0), queued_tasks_(0), stop_(false)
+{
+  if (thread_count == 0)
+    thread_count = std::max(1u, std::thread::hardware_concurrency());
+
+  workers_.reserve(thread_count);
+  for (std::size_t i = 0; i < thread_count; ++i)
+    workers_.push_back(std::make_unique<Worker>());
+  // the workers only start once all queues exist, as they steal from each other
+  for (std::size_t i = 0; i < thread_count; ++i)
+  {
+    workers_[i]->thread = std::thread(&TaskScheduler::runWorker, this, i);
+    if (!cpu_affinity.empty())
+      setAffinity(workers_[i]->thread, cpu_affinity[i % cpu_affinity.size()]);
+  }
+  RCLCPP_DEBUG(LOGGER, "Started task scheduler with %zu workers", thread_count);
+}
+
+TaskScheduler::~TaskScheduler()
+{
+  {
+    std::lock_guard<std::mutex> _(wake_lock_);
+    stop_ = true;
+  }
+  wake_condition_.notify_all();
+  for (std::unique_ptr<Worker>& worker : workers_)
+    worker->thread.join();
+}
+
+TaskScheduler& TaskScheduler::getGlobal()
+{
+  std::lock_guard<std::mutex> _(global_lock);
+  if (!global_scheduler)
+    global_scheduler = std::make_unique<TaskScheduler>(global_thread_count, global_cpu_affinity);
+  return *global_scheduler;
+}
+
+bool TaskScheduler::configureGlobal(std::size_t thread_count, const std::vector<int>& cpu_affinity)
+{
+  std::lock_guard<std::mutex> _(global_lock);
+  if (global_scheduler)
+  {
+    RCLCPP_WARN(LOGGER, "The shared task scheduler is already running with %zu workers",
+                global_scheduler->getThreadCount());
+    return false;
+  }
+  global_thread_count = thread_count;
+  global_cpu_affinity = cpu_affinity;
+  return true;
+}
+
+bool TaskScheduler::isWorkerThread() const
+{
+  return current_scheduler == this;
+}
+
+void TaskScheduler::submit(Task task, Priority priority)
+{
+  const std::size_t index = isWorkerThread() ? current_worker : next_worker_++ % workers_.size();
+  // counted before it is queued, so that the count never drops below the number of queued tasks
+  ++queued_tasks_;
+  {
+    std::lock_guard<std::mutex> _(workers_[index]->lock);
+    workers_[index]->queues[priority].push_back(std::move(task));
+  }
+  // taking the lock makes sure that a worker about to sleep sees the new task
+  {
+    std::lock_guard<std::mutex> _(wake_lock_);
+  }
+  wake_condition_.notify_one();
+}
+
+void TaskScheduler::parallelFor(std::size_t begin, std::size_t end, const std::function<void(std::size_t)>& function,
+                                std::size_t grain_size, Priority priority)
+{
+  if (begin >= end)
+    return;
+  auto state = std::make_shared<ParallelForState>();
+  state->begin = begin;
+  state->end = end;
+  state->grain_size = std::max<std::size_t>(grain_size, 1);
+  state->function = function;
+  state->chunk_count = (end - begin + state->grain_size - 1) / state->grain_size;
+
+  // helpers that start after all chunks were taken return right away
+  const std::size_t helpers = std::min(state->chunk_count, workers_.size()) - (isWorkerThread() ? 1 : 0);
+  for (std::size_t i = 0; i < helpers; ++i)
+    submit([state] { state->work(); }, priority);
+  state->work();
+
+  std::unique_lock<std::mutex> lock(state->lock);
+  state->done_condition.wait(lock, [&state] { return state->completed_chunks == state->chunk_count; });
+  if (state->exception)
+    std::rethrow_exception(state->exception);
+}
+
+bool TaskScheduler::takeTask(std::size_t index, Task& task)
+{
+  for (std::size_t priority = 0; priority < PRIORITY_COUNT; ++priority)
+  {
+    {
+      Worker& own = *workers_[index];
+      std::lock_guard<std::mutex> _(own.lock);
+      if (!own.queues[priority].empty())
+      {
+        task = std::move(own.queues[priority].back());
+        own.queues[priority].pop_back();
+        --queued_tasks_;
+        return true;
+      }
+    }
+    for (std::size_t i = 1; i < workers_.size(); ++i)
+    {
+      Worker& other = *workers_[(index + i) % workers_.size()];
+      std::lock_guard<std::mutex> _(other.lock);
+      if (!other.queues[priority].empty())
+      {
+        task = std::move(other.queues[priority].front());
+        other.queues[priority].pop_front();
+        --queued_tasks_;
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+void TaskScheduler::runWorker(std::size_t index)
+{
+  current_scheduler = this;
+  current_worker = index;
+  while (true)
+  {
+    Task task;
+    if (takeTask(index, task))
+    {
+      try
+      {
+        task();
+      }
+      catch (std::exception& ex)
+      {
+        RCLCPP_ERROR(LOGGER, "Exception caught while executing task: %s", ex.what());
+      }
+      catch (...)
+      {
+        // an exception leaving the worker thread would terminate the process
+        RCLCPP_ERROR(LOGGER, "Unknown exception caught while executing task");
+      }
+      continue;
+    }
+
+    std::unique_lock<std::mutex> lock(wake_lock_);
+    wake_condition_.wait(lock, [this] { return queued_tasks_ > 0 || stop_; });
+    if (stop_ && queued_tasks_ == 0)
+      return;
+  }
+}
+
+}  // end of namespace tools
+}  // end of namespace moveit
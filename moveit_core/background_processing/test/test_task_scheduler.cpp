@@ -0,0 +1,116 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, PickNik LLC
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik LLC nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include <moveit/background_processing/background_processing.h>
+#include <moveit/background_processing/task_scheduler.h>
+#include <gtest/gtest.h>
+#include <atomic>
+#include <stdexcept>
+
+TEST(TaskScheduler, ExecuteTasks)
+{
+  moveit::tools::TaskScheduler scheduler(4);
+  EXPECT_EQ(scheduler.getThreadCount(), 4u);
+  EXPECT_FALSE(scheduler.isWorkerThread());
+
+  std::vector<std::future<int>> results;
+  for (int i = 0; i < 100; ++i)
+    results.push_back(scheduler.async([i] { return 2 * i; }));
+  for (int i = 0; i < 100; ++i)
+    EXPECT_EQ(results[i].get(), 2 * i);
+
+  EXPECT_TRUE(scheduler.async([&scheduler] { return scheduler.isWorkerThread(); }).get());
+  EXPECT_THROW(scheduler.async([] { throw std::runtime_error("failed"); }).get(), std::runtime_error);
+
+  // exceptions of submitted tasks are logged and don't stop the workers, whatever their type
+  for (std::size_t i = 0; i < scheduler.getThreadCount(); ++i)
+    scheduler.submit([] { throw 1; });
+  EXPECT_EQ(scheduler.async([] { return 1; }).get(), 1);
+}
+
+TEST(TaskScheduler, FinishTasksOnDestruction)
+{
+  std::atomic<int> count(0);
+  {
+    moveit::tools::TaskScheduler scheduler(2);
+    for (int i = 0; i < 1000; ++i)
+    {
+      const auto priority = i % 2 ? moveit::tools::TaskScheduler::HIGH : moveit::tools::TaskScheduler::LOW;
+      scheduler.submit([&count] { ++count; }, priority);
+    }
+  }
+  EXPECT_EQ(count, 1000);
+}
+
+TEST(TaskScheduler, ParallelFor)
+{
+  moveit::tools::TaskScheduler scheduler(3);
+  std::vector<int> values(1000, 0);
+  scheduler.parallelFor(0, values.size(), [&values](std::size_t i) { values[i] = i; }, 7);
+  for (std::size_t i = 0; i < values.size(); ++i)
+    EXPECT_EQ(values[i], static_cast<int>(i));
+
+  // nested loops do not wait for workers that are busy with the outer loop
+  std::atomic<int> count(0);
+  scheduler.parallelFor(0, 10, [&scheduler, &count](std::size_t) {
+    scheduler.parallelFor(0, 10, [&count](std::size_t) { ++count; });
+  });
+  EXPECT_EQ(count, 100);
+
+  EXPECT_THROW(scheduler.parallelFor(0, 10,
+                                     [](std::size_t i) {
+                                       if (i == 5)
+                                         throw std::runtime_error("failed");
+                                     }),
+               std::runtime_error);
+}
+
+TEST(BackgroundProcessing, ExecuteJobsInOrder)
+{
+  std::vector<int> order;
+  {
+    moveit::tools::BackgroundProcessing processing;
+    for (int i = 0; i < 100; ++i)
+      processing.addJob([&order, i] { order.push_back(i); }, "job");
+  }
+  ASSERT_EQ(order.size(), 100u);
+  for (int i = 0; i < 100; ++i)
+    EXPECT_EQ(order[i], i);
+}
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
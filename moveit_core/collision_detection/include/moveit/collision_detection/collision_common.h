@@ -48,6 +48,7 @@
 namespace collision_detection
 {
 MOVEIT_CLASS_FORWARD(AllowedCollisionMatrix)  // Defines AllowedCollisionMatrixPtr, ConstPtr, WeakPtr... etc
+MOVEIT_CLASS_FORWARD(GroupCollisionCulling)  // Defines GroupCollisionCullingPtr, ConstPtr, WeakPtr... etc
 
 /** \brief The types of bodies that are considered for collision */
 namespace BodyTypes
@@ -228,6 +229,14 @@ struct CollisionRequest
 
   /** \brief Flag indicating whether information about detected collisions should be reported */
   bool verbose;
+
+  /** \brief The padding profile of the robot links to check with (optional; if empty or unknown, use the link padding
+   * of the collision environment, see CollisionEnv::setPaddingProfile()) */
+  std::string padding_profile;
+
+  /** \brief Precomputed bounds that exclude link pairs and world objects from the check (optional; only used if they
+   * are valid for the checked state, see GroupCollisionCulling::isValidFor()) */
+  GroupCollisionCullingConstPtr culling;
 };
 
 namespace DistanceRequestTypes
@@ -300,6 +309,9 @@ struct DistanceRequest
   /// Indicate if gradient should be calculated between each object.
   /// This is the normalized vector connecting the closest points on the two objects.
   bool compute_gradient;
+
+  /// The padding profile of the robot links (if empty or unknown, the link padding of the collision environment)
+  std::string padding_profile;
 };
 
 /** \brief Generic representation of the distance information for a pair of objects */
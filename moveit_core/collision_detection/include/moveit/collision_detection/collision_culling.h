@@ -0,0 +1,125 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, PickNik LLC
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik LLC nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#pragma once
+
+#include <moveit/macros/class_forward.h>
+#include <moveit/robot_state/robot_state.h>
+#include <Eigen/Geometry>
+#include <string>
+#include <vector>
+
+namespace collision_detection
+{
+class CollisionEnv;
+MOVEIT_CLASS_FORWARD(GroupCollisionCulling);  // Defines GroupCollisionCullingPtr, ConstPtr, WeakPtr... etc
+
+/** \brief Precomputed bounds on the collisions that motions of a planning group can cause
+ *
+ * For a reference state, the links that are not moved by the group are fixed in place, and every link moved by the
+ * group stays within a sphere that is computed from the kinematic chain and the joint limits of the group. Pairs of
+ * links whose volumes do not intersect cannot be in collision for any state that only differs from the reference
+ * state in the variables of the group, and neither can a moving link and an object outside its volume. The bounds
+ * are conservative: revolute joints are assumed to sweep full circles, and links below planar or floating group
+ * joints are not bounded at all. Attached bodies are not covered.
+ *
+ * Collision checks only use the bounds if the state they check matches the reference state in the fixed variables,
+ * see isValidFor(). */
+class GroupCollisionCulling
+{
+public:
+  /** \brief Compute the bounds for the motions of \e group from \e state
+   *  @param env Provides the padding and scaling of the links
+   *  @param padding_profile The padding profile to use (optional; see CollisionEnv::getLinkPadding()) */
+  GroupCollisionCulling(const CollisionEnv& env, const moveit::core::RobotState& state,
+                        const moveit::core::JointModelGroup* group, const std::string& padding_profile = "");
+
+  const moveit::core::JointModelGroup* getJointModelGroup() const
+  {
+    return group_;
+  }
+
+  /** \brief Check whether \e state matches the reference state in all variables that are not moved by the group */
+  bool isValidFor(const moveit::core::RobotState& state) const;
+
+  /** \brief Check whether two links can be in collision. Always true if neither link is moved by the group */
+  bool mayCollide(const moveit::core::LinkModel* link1, const moveit::core::LinkModel* link2) const
+  {
+    return pair_may_collide_[link1->getLinkIndex() * link_count_ + link2->getLinkIndex()];
+  }
+
+  /** \brief Check whether a link can be in collision with an object within \e box. Always true if the link is not
+   * moved by the group */
+  bool mayCollide(const moveit::core::LinkModel* link, const Eigen::AlignedBox3d& box) const
+  {
+    return !moving_links_[link->getLinkIndex()] || link_volumes_[link->getLinkIndex()].intersects(box);
+  }
+
+  /** \brief The volume a link stays within, in the model frame. Empty for links without collision geometry */
+  const Eigen::AlignedBox3d& getLinkVolume(const moveit::core::LinkModel* link) const
+  {
+    return link_volumes_[link->getLinkIndex()];
+  }
+
+  /** \brief The volume the links moved by the group stay within, in the model frame */
+  const Eigen::AlignedBox3d& getSweptVolume() const
+  {
+    return swept_volume_;
+  }
+
+  /** \brief The number of link pairs that cannot be in collision */
+  std::size_t getCulledPairCount() const
+  {
+    return culled_pair_count_;
+  }
+
+private:
+  /** \brief Compute the volume of a link moved by the group */
+  Eigen::AlignedBox3d computeMovingLinkVolume(const moveit::core::RobotState& state,
+                                              const moveit::core::LinkModel* link, double radius) const;
+
+  moveit::core::RobotModelConstPtr robot_model_;
+  const moveit::core::JointModelGroup* group_;
+  std::size_t link_count_;
+
+  std::vector<int> fixed_variables_;     // indices of the variables not moved by the group
+  std::vector<double> fixed_positions_;  // their values in the reference state
+  std::vector<bool> group_variables_;    // for each variable, whether it is moved by the group
+  std::vector<bool> moving_links_;       // for each link, whether it is moved by the group
+  std::vector<Eigen::AlignedBox3d, Eigen::aligned_allocator<Eigen::AlignedBox3d> > link_volumes_;
+  std::vector<char> pair_may_collide_;  // link_count_ x link_count_, by link index
+  Eigen::AlignedBox3d swept_volume_;
+  std::size_t culled_pair_count_;
+};
+}  // namespace collision_detection
@@ -231,6 +231,39 @@ public:
     return res.minimum_distance.distance;
   }
 
+  /** \brief Check whether each state in \e states is in self collision or in collision with the world.
+   *
+   *  The result for states[i] is stored in res[i], as computed by checkCollision(). The default implementation checks
+   *  the states one by one; backends override it to check the states in parallel and reuse their collision structures
+   *  across the batch, which pays off for the many states of roadmaps and trajectories.
+   *  @param req A CollisionRequest object that encapsulates the collision request, shared by all states
+   *  @param res The collision results, resized to the number of states
+   *  @param states The states of this robot to check
+   *  @param acm The allowed collision matrix */
+  virtual void checkCollisionBatch(const CollisionRequest& req, std::vector<CollisionResult>& res,
+                                   const std::vector<const moveit::core::RobotState*>& states,
+                                   const AllowedCollisionMatrix& acm) const;
+
+  /** \brief Compute the distance to self-collision for each state in \e states.
+   *
+   *  The result for states[i] is stored in res[i]. The default implementation calls distanceSelf() for every state;
+   *  backends override it to reuse their collision structures across the batch.
+   *  @param req A DistanceRequest object that encapsulates the distance request, shared by all states
+   *  @param res The distance results, resized to the number of states
+   *  @param states The states of this robot to consider */
+  virtual void distanceSelfBatch(const DistanceRequest& req, std::vector<DistanceResult>& res,
+                                 const std::vector<const moveit::core::RobotState*>& states) const;
+
+  /** \brief Compute the distance between the robot and the world for each state in \e states.
+   *
+   *  The result for states[i] is stored in res[i]. The default implementation calls distanceRobot() for every state;
+   *  backends override it to reuse their collision structures across the batch.
+   *  @param req A DistanceRequest object that encapsulates the distance request, shared by all states
+   *  @param res The distance results, resized to the number of states
+   *  @param states The states for the robot to check distances from */
+  virtual void distanceRobotBatch(const DistanceRequest& req, std::vector<DistanceResult>& res,
+                                  const std::vector<const moveit::core::RobotState*>& states) const;
+
   /** set the world to use.
    * This can be expensive unless the new and old world are empty.
    * Passing NULL will result in a new empty world being created. */
@@ -251,6 +284,10 @@ public:
   using ObjectPtr = World::ObjectPtr;
   using ObjectConstPtr = World::ObjectConstPtr;
 
+  /** @brief Estimate the memory (in bytes) held by the collision geometry, broadphase structures and caches of this
+      environment, in addition to the shapes of the world (see World::getMemoryUsage()). Returns 0 by default. */
+  virtual std::size_t getMemoryUsage() const;
+
   /** @brief The kinematic model corresponding to this collision model*/
   const moveit::core::RobotModelConstPtr& getRobotModel() const
   {
@@ -302,6 +339,37 @@ public:
   /** @brief Get the link scaling as a vector of messages*/
   void getScale(std::vector<moveit_msgs::msg::LinkScale>& scale) const;
 
+  /** @brief A named set of link paddings that collision requests can select through their padding_profile */
+  struct PaddingProfile
+  {
+    /** @brief The padding of the links that are not in link_padding (in meters) */
+    double padding;
+
+    /** @brief The padding of specific links (in meters) */
+    std::map<std::string, double> link_padding;
+  };
+
+  /** @brief Add or replace the padding profile \e name. Checkers that precompute padded geometry (FCL) do so for
+      every profile here, so that requests can switch between profiles without rebuilding any geometry.
+      @param name The name of the profile, must not be empty
+      @param padding The padding of the links that are not in \e link_padding (in meters)
+      @param link_padding The padding of specific links (in meters) */
+  void setPaddingProfile(const std::string& name, double padding,
+                         const std::map<std::string, double>& link_padding = std::map<std::string, double>());
+
+  /** @brief Remove the padding profile \e name */
+  void removePaddingProfile(const std::string& name);
+
+  /** @brief Check if there is a padding profile called \e name */
+  bool hasPaddingProfile(const std::string& name) const;
+
+  /** @brief Get the padding profiles (from profile names to profiles) */
+  const std::map<std::string, PaddingProfile>& getPaddingProfiles() const;
+
+  /** @brief Get the padding of a link in the padding profile \e padding_profile. If the profile name is empty or there
+      is no such profile, the link padding of this environment is returned. */
+  double getLinkPadding(const std::string& link_name, const std::string& padding_profile) const;
+
 protected:
   /** @brief When the scale or padding is changed for a set of links by any of the functions in this class,
      updatedPaddingOrScaling() function is called.
@@ -311,6 +379,10 @@ protected:
       @param links the names of the links whose padding or scaling were updated */
   virtual void updatedPaddingOrScaling(const std::vector<std::string>& links);
 
+  /** @brief Called when the padding profile \e name is added, changed or removed (see setPaddingProfile()).
+      This function has an empty default implementation. */
+  virtual void updatedPaddingProfile(const std::string& name);
+
   /** @brief The kinematic model corresponding to this collision model*/
   moveit::core::RobotModelConstPtr robot_model_;
 
@@ -320,6 +392,9 @@ protected:
   /** @brief The internally maintained map (from link names to scaling)*/
   std::map<std::string, double> link_scale_;
 
+  /** @brief The padding profiles (from profile names to profiles)*/
+  std::map<std::string, PaddingProfile> padding_profiles_;
+
 private:
   WorldPtr world_;             // The world always valid, never nullptr.
   WorldConstPtr world_const_;  // always same as world_
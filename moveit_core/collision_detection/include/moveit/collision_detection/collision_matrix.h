@@ -39,10 +39,12 @@
 #include <moveit/collision_detection/collision_common.h>
 #include <moveit/macros/class_forward.h>
 #include <moveit_msgs/msg/allowed_collision_matrix.hpp>
+#include <cstdint>
 #include <iostream>
 #include <vector>
 #include <string>
 #include <map>
+#include <unordered_map>
 
 namespace collision_detection
 {
@@ -70,7 +72,8 @@ enum Type
  * CONDITIONAL) */
 using DecideContactFn = boost::function<bool(collision_detection::Contact&)>;
 
-MOVEIT_CLASS_FORWARD(AllowedCollisionMatrix)  // Defines AllowedCollisionMatrixPtr, ConstPtr, WeakPtr... etc
+MOVEIT_CLASS_FORWARD(AllowedCollisionMatrix)          // Defines AllowedCollisionMatrixPtr, ConstPtr, WeakPtr... etc
+MOVEIT_CLASS_FORWARD(CompiledAllowedCollisionMatrix)  // Defines CompiledAllowedCollisionMatrixPtr, ConstPtr... etc
 
 /** @class AllowedCollisionMatrix
  *  @brief Definition of a structure for the allowed collision matrix. All elements in the collision world are referred
@@ -91,7 +94,9 @@ public:
   AllowedCollisionMatrix(const moveit_msgs::msg::AllowedCollisionMatrix& msg);
 
   /** @brief Copy constructor */
-  AllowedCollisionMatrix(const AllowedCollisionMatrix& acm) = default;
+  AllowedCollisionMatrix(const AllowedCollisionMatrix& acm);
+
+  AllowedCollisionMatrix& operator=(const AllowedCollisionMatrix& acm);
 
   /** @brief Get the type of the allowed collision between two elements. Return true if the entry is included in the
    * collision matrix.
@@ -268,11 +273,98 @@ public:
   /** @brief Print the allowed collision matrix */
   void print(std::ostream& out) const;
 
+  /** @brief Get the version of the matrix, which changes whenever the matrix is modified. Copies keep the version of
+   * the matrix they are copied from, so matrices with the same version have the same entries. */
+  std::uint64_t getVersion() const
+  {
+    return version_;
+  }
+
+  /** @brief Get an index-based copy of the matrix for fast lookups of pairs. The copy is made on the first call after
+   * a modification and shared by later calls, which may come from several threads. */
+  CompiledAllowedCollisionMatrixConstPtr getCompiled() const;
+
 private:
+  friend class CompiledAllowedCollisionMatrix;
+
+  /** @brief Assign a version that no other matrix has */
+  void updateVersion();
+
   std::map<std::string, std::map<std::string, AllowedCollision::Type> > entries_;
   std::map<std::string, std::map<std::string, DecideContactFn> > allowed_contacts_;
 
   std::map<std::string, AllowedCollision::Type> default_entries_;
   std::map<std::string, DecideContactFn> default_allowed_contacts_;
+
+  std::uint64_t version_;
+
+  // access with std::atomic_load() and std::atomic_store()
+  mutable CompiledAllowedCollisionMatrixConstPtr compiled_;
+};
+
+/** @class CompiledAllowedCollisionMatrix
+ *  @brief A read-only copy of an AllowedCollisionMatrix that stores the allowed collision types of all pairs of
+ *  elements in a dense table, so a pair is looked up in constant time from the indices of its elements.
+ *
+ *  Collision checkers look up the indices of their bodies once per version (see getVersion()) and then use
+ *  getAllowedCollision() with indices. The functions of AllowedCollision::CONDITIONAL pairs are not copied, they are
+ *  still read from the AllowedCollisionMatrix. */
+class CompiledAllowedCollisionMatrix
+{
+public:
+  CompiledAllowedCollisionMatrix(const AllowedCollisionMatrix& acm);
+
+  /** @brief The version of the AllowedCollisionMatrix this is a copy of */
+  std::uint64_t getVersion() const
+  {
+    return version_;
+  }
+
+  /** @brief The number of elements with an index */
+  std::size_t getSize() const
+  {
+    return size_;
+  }
+
+  /** @brief Get the index of element \e name, or -1 if the matrix has no entries for it */
+  int getIndex(const std::string& name) const;
+
+  /** @brief Get the type of the allowed collision between the elements with indices \e index1 and \e index2, with
+   * the semantics of AllowedCollisionMatrix::getAllowedCollision(). Indices may be -1. Return false if the matrix has
+   * no entry for the pair. */
+  bool getAllowedCollision(int index1, int index2, AllowedCollision::Type& allowed_collision) const
+  {
+    std::uint8_t value;
+    if (index1 >= 0 && index2 >= 0)
+      value = entries_[index1 * size_ + index2];
+    else if (index1 >= 0)
+      value = default_entries_[index1];
+    else if (index2 >= 0)
+      value = default_entries_[index2];
+    else
+      return false;
+    if (value == NO_ENTRY)
+      return false;
+    allowed_collision = static_cast<AllowedCollision::Type>(value);
+    return true;
+  }
+
+  /** @brief Get the type of the allowed collision between two elements, see getAllowedCollision(int, int, ...) */
+  bool getAllowedCollision(const std::string& name1, const std::string& name2,
+                           AllowedCollision::Type& allowed_collision) const
+  {
+    return getAllowedCollision(getIndex(name1), getIndex(name2), allowed_collision);
+  }
+
+private:
+  static const std::uint8_t NO_ENTRY = 0xFF;
+
+  std::uint64_t version_;
+  std::size_t size_;
+  std::unordered_map<std::string, int> indices_;
+
+  // the types of all pairs, row-major, and of the default entries, NO_ENTRY where there is none
+  std::vector<std::uint8_t> entries_;
+  std::vector<std::uint8_t> default_entries_;
 };
 }  // namespace collision_detection
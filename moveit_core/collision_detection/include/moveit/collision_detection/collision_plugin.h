@@ -37,6 +37,7 @@
 #include <moveit/macros/class_forward.h>
 #include <moveit/collision_detection/collision_env.h>
 #include <moveit/planning_scene/planning_scene.h>
+#include <rclcpp/rclcpp.hpp>
 
 namespace collision_detection
 {
@@ -88,6 +89,15 @@ public:
    * @brief This should be used to load your collision plugin.
    */
   virtual bool initialize(const planning_scene::PlanningScenePtr& scene, bool exclusive) const = 0;
+
+  /**
+   * @brief Load the collision plugin, configured by the parameters of \e node. By default, the parameters are ignored.
+   */
+  virtual bool initialize(const rclcpp::Node::SharedPtr& /*node*/, const planning_scene::PlanningScenePtr& scene,
+                          bool exclusive) const
+  {
+    return initialize(scene, exclusive);
+  }
 };
 
 }  // namespace collision_detection
@@ -0,0 +1,130 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, PickNik LLC
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik LLC nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#pragma once
+
+#include <moveit/collision_detection/collision_matrix.h>
+#include <moveit/macros/class_forward.h>
+#include <moveit/robot_state/robot_state.h>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace collision_detection
+{
+MOVEIT_CLASS_FORWARD(SelfCollisionCache);  // Defines SelfCollisionCachePtr, ConstPtr, WeakPtr... etc
+
+/** \brief A bounded, thread-safe cache of self-collision results
+ *
+ * Results are keyed by the variable positions of a robot state, quantized at a fixed resolution, together with the
+ * robot model, the attached bodies of the state, the version of the allowed collision matrix and a context string
+ * that identifies the rest of the query (e.g. the group and the collision detector). All states in a quantization
+ * cell share the result of the first state checked in it, so the resolution should be small compared to the
+ * clearances that matter. Allowed collision matrices with conditional entries must decide contacts
+ * deterministically. When the cache is full, the least recently used results are dropped. */
+class SelfCollisionCache
+{
+public:
+  /** \brief Constructor
+   *  @param max_size The maximum number of cached results
+   *  @param resolution The size of a quantization cell for each variable, in radians or meters */
+  SelfCollisionCache(std::size_t max_size = 100000, double resolution = 1e-3);
+
+  /** \brief Look up whether \e state is in self collision. Return false if the result is not known */
+  bool lookup(const moveit::core::RobotState& state, const AllowedCollisionMatrix& acm, const std::string& context,
+              bool& collision) const;
+
+  /** \brief Store whether \e state is in self collision */
+  void insert(const moveit::core::RobotState& state, const AllowedCollisionMatrix& acm, const std::string& context,
+              bool collision);
+
+  void clear();
+
+  std::size_t size() const;
+
+  std::size_t getMaximumSize() const
+  {
+    return max_size_;
+  }
+
+  double getResolution() const
+  {
+    return resolution_;
+  }
+
+  /** \brief The number of successful lookups since construction or the last clear() */
+  std::size_t getHitCount() const;
+
+  /** \brief The number of failed lookups since construction or the last clear() */
+  std::size_t getMissCount() const;
+
+private:
+  struct Key
+  {
+    std::size_t context_hash;
+    std::vector<std::int64_t> cells;
+    std::size_t hash;
+
+    bool operator==(const Key& other) const
+    {
+      return hash == other.hash && context_hash == other.context_hash && cells == other.cells;
+    }
+  };
+
+  struct KeyHash
+  {
+    std::size_t operator()(const Key& key) const
+    {
+      return key.hash;
+    }
+  };
+
+  using Entries = std::list<std::pair<Key, bool> >;
+
+  Key makeKey(const moveit::core::RobotState& state, const AllowedCollisionMatrix& acm,
+              const std::string& context) const;
+
+  std::size_t max_size_;
+  double resolution_;
+
+  mutable std::mutex lock_;
+  mutable Entries entries_;  // most recently used first
+  mutable std::unordered_map<Key, Entries::iterator, KeyHash> index_;
+  mutable std::size_t hits_;
+  mutable std::size_t misses_;
+};
+}  // namespace collision_detection
@@ -0,0 +1,313 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, PickNik LLC
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik LLC nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#pragma once
+
+#include <moveit/robot_model/robot_model.h>
+#include <moveit/robot_state/robot_state.h>
+#include <moveit/utils/robot_model_test_utils.h>
+#include <moveit/collision_detection/collision_common.h>
+#include <moveit/collision_detection/collision_env.h>
+#include <moveit/collision_detection/collision_detector_allocator.h>
+
+#include <geometric_shapes/shapes.h>
+#include <geometric_shapes/shape_operations.h>
+#include <octomap/octomap.h>
+#include <random_numbers/random_numbers.h>
+
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+/** \brief The number of random robot states each thread checks in a benchmark */
+static const std::size_t BENCHMARK_STATE_COUNT = 1000;
+
+/** \brief The number of objects in the cluttered scenes */
+static const std::size_t BENCHMARK_OBJECT_COUNT = 100;
+
+/** \brief The maximum number of threads a benchmark is run with */
+static const unsigned int BENCHMARK_MAX_THREADS = 8;
+
+/** \brief The mesh the mesh-heavy scene is cluttered with */
+static const std::string BENCHMARK_MESH = "package://moveit_resources_panda_description/meshes/collision/link5.stl";
+
+/** \brief The standard scenes of the collision benchmarks */
+enum class BenchmarkScene
+{
+  EMPTY,
+  PRIMITIVES,
+  MESHES,
+  OCTOMAP,
+};
+
+/** \brief Collision checking benchmarks of the panda robot, meant to catch performance regressions of a backend.
+ *
+ *  Every benchmark checks the same random states in 1, 2, 4... threads and reports the checks per second on the
+ *  console and as test properties named <scene>_<self|world>_<query>_<threads>threads, which are part of the XML
+ *  output of gtest (--gtest_output=xml) for comparing results between releases. */
+template <class CollisionAllocatorType>
+class CollisionBenchmarkPanda : public testing::Test
+{
+public:
+  std::shared_ptr<CollisionAllocatorType> value_;
+
+protected:
+  void SetUp() override
+  {
+    value_.reset(new CollisionAllocatorType);
+    robot_model_ = moveit::core::loadTestingRobotModel("panda");
+    ASSERT_TRUE(bool(robot_model_));
+
+    acm_.reset(new collision_detection::AllowedCollisionMatrix());
+    // Use default collision operations in the SRDF to setup the acm
+    const std::vector<std::string>& collision_links = robot_model_->getLinkModelNamesWithCollisionGeometry();
+    acm_->setEntry(collision_links, collision_links, false);
+
+    // allow collisions for pairs that have been disabled
+    const std::vector<srdf::Model::DisabledCollision>& dc = robot_model_->getSRDF()->getDisabledCollisionPairs();
+    for (const srdf::Model::DisabledCollision& it : dc)
+      acm_->setEntry(it.link1_, it.link2_, true);
+
+    cenv_ = value_->allocateEnv(robot_model_);
+
+    // the same states for every backend
+    random_numbers::RandomNumberGenerator rng(42);
+    const moveit::core::JointModelGroup* jmg = robot_model_->getJointModelGroup("panda_arm");
+    moveit::core::RobotState state(robot_model_);
+    state.setToDefaultValues();
+    states_.reserve(BENCHMARK_STATE_COUNT);
+    for (std::size_t i = 0; i < BENCHMARK_STATE_COUNT; ++i)
+    {
+      state.setToRandomPositions(jmg, rng);
+      state.update();
+      states_.push_back(state);
+    }
+  }
+
+  void TearDown() override
+  {
+  }
+
+  /** \brief Fills the world with the objects of \e scene, the same for every backend */
+  void populateWorld(BenchmarkScene scene)
+  {
+    random_numbers::RandomNumberGenerator rng(123);
+    const collision_detection::WorldPtr& world = cenv_->getWorld();
+    switch (scene)
+    {
+      case BenchmarkScene::EMPTY:
+        break;
+      case BenchmarkScene::PRIMITIVES:
+        for (std::size_t i = 0; i < BENCHMARK_OBJECT_COUNT; ++i)
+        {
+          shapes::ShapeConstPtr shape;
+          if (i % 3 == 0)
+            shape.reset(new shapes::Box(rng.uniformReal(0.02, 0.2), rng.uniformReal(0.02, 0.2),
+                                        rng.uniformReal(0.02, 0.2)));
+          else if (i % 3 == 1)
+            shape.reset(new shapes::Cylinder(rng.uniformReal(0.01, 0.1), rng.uniformReal(0.02, 0.2)));
+          else
+            shape.reset(new shapes::Sphere(rng.uniformReal(0.01, 0.1)));
+          world->addToObject("object_" + std::to_string(i), shape, randomPose(rng));
+        }
+        break;
+      case BenchmarkScene::MESHES:
+      {
+        shapes::ShapeConstPtr mesh(shapes::createMeshFromResource(BENCHMARK_MESH));
+        ASSERT_TRUE(bool(mesh)) << "Unable to load " << BENCHMARK_MESH;
+        for (std::size_t i = 0; i < BENCHMARK_OBJECT_COUNT; ++i)
+          world->addToObject("object_" + std::to_string(i), mesh, randomPose(rng));
+        break;
+      }
+      case BenchmarkScene::OCTOMAP:
+      {
+        // occupied cubes of 10cm around random points, like a sensor would see them
+        auto tree = std::make_shared<octomap::OcTree>(0.02);
+        for (std::size_t i = 0; i < BENCHMARK_OBJECT_COUNT; ++i)
+        {
+          const Eigen::Vector3d center = randomPose(rng).translation();
+          for (double x = -0.05; x < 0.05; x += 0.02)
+            for (double y = -0.05; y < 0.05; y += 0.02)
+              for (double z = -0.05; z < 0.05; z += 0.02)
+                tree->updateNode(center.x() + x, center.y() + y, center.z() + z, true);
+        }
+        tree->updateInnerOccupancy();
+        world->addToObject("octomap", std::make_shared<const shapes::OcTree>(tree), Eigen::Isometry3d::Identity());
+        break;
+      }
+    }
+  }
+
+  /** \brief Runs \e check on all states in an increasing number of threads and reports the checks per second */
+  void benchmark(const std::string& name, const std::function<void(const moveit::core::RobotState&)>& check)
+  {
+    const unsigned int max_threads =
+        std::max(1u, std::min(BENCHMARK_MAX_THREADS, std::thread::hardware_concurrency()));
+    for (unsigned int threads = 1; threads <= max_threads; threads *= 2)
+    {
+      // every thread checks its own copies of the states
+      const std::vector<std::vector<moveit::core::RobotState>> thread_states(threads, states_);
+      std::vector<std::thread> workers;
+      const auto start = std::chrono::steady_clock::now();
+      for (unsigned int t = 0; t < threads; ++t)
+        workers.emplace_back([&check, &states = thread_states[t]] {
+          for (const moveit::core::RobotState& state : states)
+            check(state);
+        });
+      for (std::thread& worker : workers)
+        worker.join();
+      const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+      const double checks_per_second = threads * states_.size() / elapsed.count();
+      std::cout << name << " in " << threads << " threads: " << checks_per_second << " checks/s" << std::endl;
+      testing::Test::RecordProperty(name + "_" + std::to_string(threads) + "threads",
+                                    static_cast<int>(checks_per_second));
+    }
+  }
+
+  /** \brief Benchmarks collision checks of the robot against the world of \e scene */
+  void benchmarkWorldCollision(BenchmarkScene scene, const std::string& scene_name)
+  {
+    populateWorld(scene);
+    benchmark(scene_name + "_world_boolean", [this](const moveit::core::RobotState& state) {
+      collision_detection::CollisionRequest req;
+      collision_detection::CollisionResult res;
+      cenv_->checkRobotCollision(req, res, state, *acm_);
+    });
+  }
+
+  /** \brief Benchmarks distance queries of the robot against the world of \e scene */
+  void benchmarkWorldDistance(BenchmarkScene scene, const std::string& scene_name)
+  {
+    populateWorld(scene);
+    benchmark(scene_name + "_world_distance", [this](const moveit::core::RobotState& state) {
+      collision_detection::DistanceRequest req;
+      collision_detection::DistanceResult res;
+      req.acm = acm_.get();
+      cenv_->distanceRobot(req, res, state);
+    });
+  }
+
+  static Eigen::Isometry3d randomPose(random_numbers::RandomNumberGenerator& rng)
+  {
+    double quat[4];
+    rng.quaternion(quat);
+    Eigen::Isometry3d pose(Eigen::Quaterniond(quat[0], quat[1], quat[2], quat[3]));
+    pose.translation() =
+        Eigen::Vector3d(rng.uniformReal(-1.0, 1.0), rng.uniformReal(-1.0, 1.0), rng.uniformReal(0.0, 1.0));
+    return pose;
+  }
+
+  moveit::core::RobotModelPtr robot_model_;
+
+  collision_detection::CollisionEnvPtr cenv_;
+
+  collision_detection::AllowedCollisionMatrixPtr acm_;
+
+  std::vector<moveit::core::RobotState> states_;
+};
+
+template <class CollisionAllocatorType>
+class DistanceBenchmarkPanda : public CollisionBenchmarkPanda<CollisionAllocatorType>
+{
+};
+
+TYPED_TEST_CASE_P(CollisionBenchmarkPanda);
+
+TYPED_TEST_P(CollisionBenchmarkPanda, SelfCollision)
+{
+  this->benchmark("self_boolean", [this](const moveit::core::RobotState& state) {
+    collision_detection::CollisionRequest req;
+    collision_detection::CollisionResult res;
+    this->cenv_->checkSelfCollision(req, res, state, *this->acm_);
+  });
+}
+
+TYPED_TEST_P(CollisionBenchmarkPanda, WorldCollisionEmpty)
+{
+  this->benchmarkWorldCollision(BenchmarkScene::EMPTY, "empty");
+}
+
+TYPED_TEST_P(CollisionBenchmarkPanda, WorldCollisionPrimitives)
+{
+  this->benchmarkWorldCollision(BenchmarkScene::PRIMITIVES, "primitives");
+}
+
+TYPED_TEST_P(CollisionBenchmarkPanda, WorldCollisionMeshes)
+{
+  this->benchmarkWorldCollision(BenchmarkScene::MESHES, "meshes");
+}
+
+TYPED_TEST_P(CollisionBenchmarkPanda, WorldCollisionOctomap)
+{
+  this->benchmarkWorldCollision(BenchmarkScene::OCTOMAP, "octomap");
+}
+
+TYPED_TEST_CASE_P(DistanceBenchmarkPanda);
+
+TYPED_TEST_P(DistanceBenchmarkPanda, SelfDistance)
+{
+  this->benchmark("self_distance", [this](const moveit::core::RobotState& state) {
+    collision_detection::DistanceRequest req;
+    collision_detection::DistanceResult res;
+    req.acm = this->acm_.get();
+    this->cenv_->distanceSelf(req, res, state);
+  });
+}
+
+TYPED_TEST_P(DistanceBenchmarkPanda, WorldDistancePrimitives)
+{
+  this->benchmarkWorldDistance(BenchmarkScene::PRIMITIVES, "primitives");
+}
+
+TYPED_TEST_P(DistanceBenchmarkPanda, WorldDistanceMeshes)
+{
+  this->benchmarkWorldDistance(BenchmarkScene::MESHES, "meshes");
+}
+
+TYPED_TEST_P(DistanceBenchmarkPanda, WorldDistanceOctomap)
+{
+  this->benchmarkWorldDistance(BenchmarkScene::OCTOMAP, "octomap");
+}
+
+REGISTER_TYPED_TEST_CASE_P(CollisionBenchmarkPanda, SelfCollision, WorldCollisionEmpty, WorldCollisionPrimitives,
+                           WorldCollisionMeshes, WorldCollisionOctomap);
+
+REGISTER_TYPED_TEST_CASE_P(DistanceBenchmarkPanda, SelfDistance, WorldDistancePrimitives, WorldDistanceMeshes,
+                           WorldDistanceOctomap);
@@ -143,6 +143,34 @@ public:
   /** \brief Check if a particular object exists in the collision world*/
   bool hasObject(const std::string& object_id) const;
 
+  /** \brief An estimate of the memory held by the shapes of the world (in bytes) */
+  struct MemoryUsage
+  {
+    /** \brief Vertices, triangles and normals of the meshes */
+    std::size_t meshes = 0;
+
+    /** \brief The nodes of the octrees */
+    std::size_t octrees = 0;
+
+    /** \brief The objects themselves and all other shapes */
+    std::size_t other = 0;
+
+    std::size_t total() const
+    {
+      return meshes + octrees + other;
+    }
+  };
+
+  /** \brief Estimate the memory held by the objects of the world. Shapes shared between objects are counted once. */
+  MemoryUsage getMemoryUsage() const;
+
+  /** \brief A number that changes whenever an object of the world changes. It is unique across all World instances,
+   * so references into the objects that were taken at the same generation are still valid. */
+  std::size_t getGeneration() const
+  {
+    return generation_;
+  }
+
   /** \brief Check if an object or subframe with given name exists in the collision world.
    * A subframe name needs to be prefixed with the object's name separated by a slash. */
   bool knowsTransform(const std::string& name) const;
@@ -178,6 +206,10 @@ public:
   bool moveShapeInObject(const std::string& object_id, const shapes::ShapeConstPtr& shape,
                          const Eigen::Isometry3d& pose);
 
+  /** \brief Update the poses of all shapes in an object. \e poses needs to contain one pose for each shape, in the
+   * order of the object's shapes. Returns true on success. */
+  bool moveShapesInObject(const std::string& object_id, const EigenSTL::vector_Isometry3d& poses);
+
   /** \brief Move all shapes in an object according to the given transform specified in world frame */
   bool moveObject(const std::string& object_id, const Eigen::Isometry3d& transform);
 
@@ -255,12 +287,21 @@ public:
 
   using ObserverCallbackFn = boost::function<void(const ObjectConstPtr&, Action)>;
 
+  /** \brief A list of changes, at most one per object unless the object was destroyed and created again */
+  using ObjectChanges = std::vector<std::pair<ObjectConstPtr, Action>>;
+  using ObserverBatchCallbackFn = boost::function<void(const ObjectChanges&)>;
+
   /** \brief register a callback function for notification of changes.
    * \e callback will be called right after any change occurs to any Object.
    * \e observer is the object which is requesting the changes.  It is only
    * used for identifying the callback in removeObserver(). */
   ObserverHandle addObserver(const ObserverCallbackFn& callback);
 
+  /** \brief register callback functions for notification of changes.
+   * \e callback is called for changes outside of a batch (see beginBatch()),
+   * \e batch_callback once with all changes of a batch when it is committed. */
+  ObserverHandle addObserver(const ObserverCallbackFn& callback, const ObserverBatchCallbackFn& batch_callback);
+
   /** \brief remove a notifier callback */
   void removeObserver(const ObserverHandle observer_handle);
 
@@ -268,6 +309,16 @@ public:
    * Used which switching from one world to another. */
   void notifyObserverAllObjects(const ObserverHandle observer_handle, Action action) const;
 
+  /** \brief Start a batch of changes.
+   * Until the matching commitBatch(), observers are not notified. Instead the changes are
+   * coalesced per object, so that observers can process many changes at once (e.g. rebuild
+   * a broadphase structure only once). Batches can be nested, only the outermost
+   * commitBatch() notifies the observers. */
+  void beginBatch();
+
+  /** \brief Notify the observers of the changes since the matching beginBatch() */
+  void commitBatch();
+
 private:
   /** notify all observers of a change */
   void notify(const ObjectConstPtr& /*obj*/, Action /*action*/);
@@ -291,13 +342,27 @@ private:
   class Observer
   {
   public:
-    Observer(const ObserverCallbackFn& callback) : callback_(callback)
+    Observer(const ObserverCallbackFn& callback, const ObserverBatchCallbackFn& batch_callback)
+      : callback_(callback), batch_callback_(batch_callback)
     {
     }
     ObserverCallbackFn callback_;
+    ObserverBatchCallbackFn batch_callback_;
   };
 
   /// All registered observers of this world representation
   std::vector<Observer*> observers_;
+
+  /// The nesting depth of beginBatch() calls
+  unsigned int batch_depth_;
+
+  /// The generation of the objects, see getGeneration()
+  std::size_t generation_;
+
+  /// The coalesced changes of the current batch. Entries without object are changes that cancelled out.
+  ObjectChanges batch_changes_;
+
+  /// The index of the last entry of each object in \e batch_changes_
+  std::map<std::string, std::size_t> batch_change_index_;
 };
 }  // namespace collision_detection
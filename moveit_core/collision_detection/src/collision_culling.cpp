@@ -0,0 +1,193 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, PickNik LLC
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik LLC nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include <moveit/collision_detection/collision_culling.h>
+#include <moveit/collision_detection/collision_env.h>
+#include <geometric_shapes/shape_operations.h>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace collision_detection
+{
+namespace
+{
+Eigen::AlignedBox3d unboundedVolume()
+{
+  return Eigen::AlignedBox3d(Eigen::Vector3d::Constant(-std::numeric_limits<double>::infinity()),
+                             Eigen::Vector3d::Constant(std::numeric_limits<double>::infinity()));
+}
+
+// The largest distance a prismatic joint can move its child link, or infinity if it is not bounded
+double maxPrismaticOffset(const moveit::core::JointModel* joint)
+{
+  const moveit::core::VariableBounds& bounds = joint->getVariableBounds()[0];
+  if (!bounds.position_bounded_)
+    return std::numeric_limits<double>::infinity();
+  return std::max(std::fabs(bounds.min_position_), std::fabs(bounds.max_position_));
+}
+}  // namespace
+
+GroupCollisionCulling::GroupCollisionCulling(const CollisionEnv& env, const moveit::core::RobotState& state,
+                                             const moveit::core::JointModelGroup* group,
+                                             const std::string& padding_profile)
+  : robot_model_(state.getRobotModel())
+  , group_(group)
+  , link_count_(robot_model_->getLinkModelCount())
+  , group_variables_(robot_model_->getVariableCount(), false)
+  , moving_links_(link_count_, false)
+  , link_volumes_(link_count_)
+  , pair_may_collide_(link_count_ * link_count_, 1)
+  , culled_pair_count_(0)
+{
+  moveit::core::RobotState reference(state);
+  reference.updateLinkTransforms();
+
+  // the variables of the group and of the joints that mimic them
+  for (const moveit::core::JointModel* joint : group->getJointModels())
+  {
+    for (std::size_t i = 0; i < joint->getVariableCount(); ++i)
+      group_variables_[joint->getFirstVariableIndex() + i] = true;
+    for (const moveit::core::JointModel* mimic : joint->getMimicRequests())
+      for (std::size_t i = 0; i < mimic->getVariableCount(); ++i)
+        group_variables_[mimic->getFirstVariableIndex() + i] = true;
+  }
+  for (std::size_t i = 0; i < group_variables_.size(); ++i)
+    if (!group_variables_[i])
+    {
+      fixed_variables_.push_back(i);
+      fixed_positions_.push_back(reference.getVariablePosition(i));
+    }
+  for (const moveit::core::LinkModel* link : group->getUpdatedLinkModels())
+    moving_links_[link->getLinkIndex()] = true;
+
+  for (const moveit::core::LinkModel* link : robot_model_->getLinkModelsWithCollisionGeometry())
+  {
+    const double scale = env.getLinkScale(link->getName());
+    const double padding = env.getLinkPadding(link->getName(), padding_profile);
+    const bool moving = moving_links_[link->getLinkIndex()];
+    const Eigen::Isometry3d& link_transform = reference.getGlobalLinkTransform(link);
+    Eigen::AlignedBox3d& volume = link_volumes_[link->getLinkIndex()];
+    double link_radius = 0.0;
+    for (std::size_t i = 0; i < link->getShapes().size(); ++i)
+    {
+      Eigen::Vector3d center;
+      double radius;
+      shapes::computeShapeBoundingSphere(link->getShapes()[i].get(), center, radius);
+      center = link->getCollisionOriginTransforms()[i] * (scale * center);
+      radius = scale * radius + padding;
+      if (moving)
+        link_radius = std::max(link_radius, center.norm() + radius);
+      else
+      {
+        center = link_transform * center;
+        volume.extend(center - Eigen::Vector3d::Constant(radius));
+        volume.extend(center + Eigen::Vector3d::Constant(radius));
+      }
+    }
+    if (moving)
+    {
+      volume = computeMovingLinkVolume(reference, link, link_radius);
+      swept_volume_.extend(volume);
+    }
+  }
+
+  for (std::size_t i = 0; i < link_count_; ++i)
+    for (std::size_t j = i + 1; j < link_count_; ++j)
+      if ((moving_links_[i] || moving_links_[j]) && !link_volumes_[i].intersects(link_volumes_[j]))
+      {
+        pair_may_collide_[i * link_count_ + j] = 0;
+        pair_may_collide_[j * link_count_ + i] = 0;
+        ++culled_pair_count_;
+      }
+}
+
+Eigen::AlignedBox3d GroupCollisionCulling::computeMovingLinkVolume(const moveit::core::RobotState& state,
+                                                                   const moveit::core::LinkModel* link,
+                                                                   double radius) const
+{
+  // walk up to the first link that is not moved by the group, adding the largest distance each joint can put
+  // between the origins of its parent and child links
+  while (true)
+  {
+    const moveit::core::JointModel* joint = link->getParentJointModel();
+    const moveit::core::LinkModel* parent = link->getParentLinkModel();
+    const bool group_joint = joint->getVariableCount() > 0 && group_variables_[joint->getFirstVariableIndex()];
+    double offset = link->getJointOriginTransform().translation().norm();
+    if (group_joint)
+    {
+      if (joint->getType() == moveit::core::JointModel::PRISMATIC)
+        offset += maxPrismaticOffset(joint);
+      else if (joint->getType() != moveit::core::JointModel::REVOLUTE)
+        return unboundedVolume();
+    }
+    else
+    {
+      Eigen::Isometry3d joint_transform;
+      joint->computeTransform(state.getVariablePositions() + joint->getFirstVariableIndex(), joint_transform);
+      offset = (link->getJointOriginTransform() * joint_transform).translation().norm();
+    }
+
+    if (!parent || !moving_links_[parent->getLinkIndex()])
+    {
+      // revolute joints keep the child link origin at the joint origin, prismatic ones move it along a line
+      Eigen::Vector3d center = state.getGlobalLinkTransform(link).translation();
+      if (group_joint)
+      {
+        const Eigen::Isometry3d parent_transform =
+            parent ? state.getGlobalLinkTransform(parent) : Eigen::Isometry3d::Identity();
+        center = parent_transform * link->getJointOriginTransform().translation();
+        if (joint->getType() == moveit::core::JointModel::PRISMATIC)
+          radius += maxPrismaticOffset(joint);
+      }
+      if (!std::isfinite(radius))
+        return unboundedVolume();
+      return Eigen::AlignedBox3d(center - Eigen::Vector3d::Constant(radius),
+                                 center + Eigen::Vector3d::Constant(radius));
+    }
+    radius += offset;
+    link = parent;
+  }
+}
+
+bool GroupCollisionCulling::isValidFor(const moveit::core::RobotState& state) const
+{
+  if (state.getRobotModel() != robot_model_)
+    return false;
+  for (std::size_t i = 0; i < fixed_variables_.size(); ++i)
+    if (state.getVariablePosition(fixed_variables_[i]) != fixed_positions_[i])
+      return false;
+  return true;
+}
+}  // namespace collision_detection
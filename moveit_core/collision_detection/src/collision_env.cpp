@@ -111,6 +111,7 @@ CollisionEnv::CollisionEnv(const CollisionEnv& other, const WorldPtr& world)
 {
   link_padding_ = other.link_padding_;
   link_scale_ = other.link_scale_;
+  padding_profiles_ = other.padding_profiles_;
 }
 void CollisionEnv::setPadding(double padding)
 {
@@ -283,6 +284,57 @@ void CollisionEnv::updatedPaddingOrScaling(const std::vector<std::string>& links
 {
 }
 
+void CollisionEnv::setPaddingProfile(const std::string& name, double padding,
+                                     const std::map<std::string, double>& link_padding)
+{
+  if (name.empty())
+  {
+    RCLCPP_ERROR(LOGGER, "Padding profiles must have a name");
+    return;
+  }
+  if (!validatePadding(padding))
+    return;
+  for (const auto& link_pad_pair : link_padding)
+    if (!validatePadding(link_pad_pair.second))
+      return;
+
+  PaddingProfile& profile = padding_profiles_[name];
+  profile.padding = padding;
+  profile.link_padding = link_padding;
+  updatedPaddingProfile(name);
+}
+
+void CollisionEnv::removePaddingProfile(const std::string& name)
+{
+  if (padding_profiles_.erase(name))
+    updatedPaddingProfile(name);
+}
+
+bool CollisionEnv::hasPaddingProfile(const std::string& name) const
+{
+  return padding_profiles_.find(name) != padding_profiles_.end();
+}
+
+const std::map<std::string, CollisionEnv::PaddingProfile>& CollisionEnv::getPaddingProfiles() const
+{
+  return padding_profiles_;
+}
+
+double CollisionEnv::getLinkPadding(const std::string& link_name, const std::string& padding_profile) const
+{
+  if (padding_profile.empty())
+    return getLinkPadding(link_name);
+  auto profile = padding_profiles_.find(padding_profile);
+  if (profile == padding_profiles_.end())
+    return getLinkPadding(link_name);
+  auto it = profile->second.link_padding.find(link_name);
+  return it != profile->second.link_padding.end() ? it->second : profile->second.padding;
+}
+
+void CollisionEnv::updatedPaddingProfile(const std::string& name)
+{
+}
+
 void CollisionEnv::setWorld(const WorldPtr& world)
 {
   world_ = world;
@@ -292,6 +344,11 @@ void CollisionEnv::setWorld(const WorldPtr& world)
   world_const_ = world;
 }
 
+std::size_t CollisionEnv::getMemoryUsage() const
+{
+  return 0;
+}
+
 void CollisionEnv::checkCollision(const CollisionRequest& req, CollisionResult& res,
                                   const moveit::core::RobotState& state) const
 {
@@ -307,4 +364,29 @@ void CollisionEnv::checkCollision(const CollisionRequest& req, CollisionResult&
   if (!res.collision || (req.contacts && res.contacts.size() < req.max_contacts))
     checkRobotCollision(req, res, state, acm);
 }
+
+void CollisionEnv::checkCollisionBatch(const CollisionRequest& req, std::vector<CollisionResult>& res,
+                                       const std::vector<const moveit::core::RobotState*>& states,
+                                       const AllowedCollisionMatrix& acm) const
+{
+  res.assign(states.size(), CollisionResult());
+  for (std::size_t i = 0; i < states.size(); ++i)
+    checkCollision(req, res[i], *states[i], acm);
+}
+
+void CollisionEnv::distanceSelfBatch(const DistanceRequest& req, std::vector<DistanceResult>& res,
+                                     const std::vector<const moveit::core::RobotState*>& states) const
+{
+  res.assign(states.size(), DistanceResult());
+  for (std::size_t i = 0; i < states.size(); ++i)
+    distanceSelf(req, res[i], *states[i]);
+}
+
+void CollisionEnv::distanceRobotBatch(const DistanceRequest& req, std::vector<DistanceResult>& res,
+                                      const std::vector<const moveit::core::RobotState*>& states) const
+{
+  res.assign(states.size(), DistanceResult());
+  for (std::size_t i = 0; i < states.size(); ++i)
+    distanceRobot(req, res[i], *states[i]);
+}
 }  // end of namespace collision_detection
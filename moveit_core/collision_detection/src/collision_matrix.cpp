@@ -36,6 +36,8 @@
 
 #include <moveit/collision_detection/collision_matrix.h>
 #include <boost/bind.hpp>
+#include <atomic>
+#include <memory>
 #include <iomanip>
 #include "rclcpp/rclcpp.hpp"
 
@@ -44,18 +46,45 @@ namespace collision_detection
 // Logger
 static const rclcpp::Logger LOGGER = rclcpp::get_logger("moveit_collision_detection.collision_matrix");
 
-AllowedCollisionMatrix::AllowedCollisionMatrix()
+// versions are unique across all matrices, so equal versions imply equal entries
+static std::atomic<std::uint64_t> NEXT_VERSION(1);
+
+AllowedCollisionMatrix::AllowedCollisionMatrix() : version_(0)
+{
+}
+
+AllowedCollisionMatrix::AllowedCollisionMatrix(const AllowedCollisionMatrix& acm)
+  : entries_(acm.entries_)
+  , allowed_contacts_(acm.allowed_contacts_)
+  , default_entries_(acm.default_entries_)
+  , default_allowed_contacts_(acm.default_allowed_contacts_)
+  , version_(acm.version_)
+  , compiled_(std::atomic_load(&acm.compiled_))
+{
+}
+
+AllowedCollisionMatrix& AllowedCollisionMatrix::operator=(const AllowedCollisionMatrix& acm)
 {
+  if (this != &acm)
+  {
+    entries_ = acm.entries_;
+    allowed_contacts_ = acm.allowed_contacts_;
+    default_entries_ = acm.default_entries_;
+    default_allowed_contacts_ = acm.default_allowed_contacts_;
+    version_ = acm.version_;
+    std::atomic_store(&compiled_, std::atomic_load(&acm.compiled_));
+  }
+  return *this;
 }
 
-AllowedCollisionMatrix::AllowedCollisionMatrix(const std::vector<std::string>& names, bool allowed)
+AllowedCollisionMatrix::AllowedCollisionMatrix(const std::vector<std::string>& names, bool allowed) : version_(0)
 {
   for (std::size_t i = 0; i < names.size(); ++i)
     for (std::size_t j = i; j < names.size(); ++j)
       setEntry(names[i], names[j], allowed);
 }
 
-AllowedCollisionMatrix::AllowedCollisionMatrix(const moveit_msgs::msg::AllowedCollisionMatrix& msg)
+AllowedCollisionMatrix::AllowedCollisionMatrix(const moveit_msgs::msg::AllowedCollisionMatrix& msg) : version_(0)
 {
   if (msg.entry_names.size() != msg.entry_values.size() ||
       msg.default_entry_names.size() != msg.default_entry_values.size())
@@ -126,6 +155,7 @@ bool AllowedCollisionMatrix::hasEntry(const std::string& name1, const std::strin
 
 void AllowedCollisionMatrix::setEntry(const std::string& name1, const std::string& name2, bool allowed)
 {
+  updateVersion();
   const AllowedCollision::Type v = allowed ? AllowedCollision::ALWAYS : AllowedCollision::NEVER;
   entries_[name1][name2] = entries_[name2][name1] = v;
 
@@ -148,12 +178,14 @@ void AllowedCollisionMatrix::setEntry(const std::string& name1, const std::strin
 
 void AllowedCollisionMatrix::setEntry(const std::string& name1, const std::string& name2, DecideContactFn& fn)
 {
+  updateVersion();
   entries_[name1][name2] = entries_[name2][name1] = AllowedCollision::CONDITIONAL;
   allowed_contacts_[name1][name2] = allowed_contacts_[name2][name1] = fn;
 }
 
 void AllowedCollisionMatrix::removeEntry(const std::string& name)
 {
+  updateVersion();
   entries_.erase(name);
   allowed_contacts_.erase(name);
   for (auto& entry : entries_)
@@ -164,6 +196,7 @@ void AllowedCollisionMatrix::removeEntry(const std::string& name)
 
 void AllowedCollisionMatrix::removeEntry(const std::string& name1, const std::string& name2)
 {
+  updateVersion();
   auto jt = entries_.find(name1);
   if (jt != entries_.end())
   {
@@ -222,6 +255,7 @@ void AllowedCollisionMatrix::setEntry(const std::string& name, bool allowed)
 
 void AllowedCollisionMatrix::setEntry(bool allowed)
 {
+  updateVersion();
   const AllowedCollision::Type v = allowed ? AllowedCollision::ALWAYS : AllowedCollision::NEVER;
   for (auto& entry : entries_)
     for (auto& it2 : entry.second)
@@ -230,6 +264,7 @@ void AllowedCollisionMatrix::setEntry(bool allowed)
 
 void AllowedCollisionMatrix::setDefaultEntry(const std::string& name, bool allowed)
 {
+  updateVersion();
   const AllowedCollision::Type v = allowed ? AllowedCollision::ALWAYS : AllowedCollision::NEVER;
   default_entries_[name] = v;
   default_allowed_contacts_.erase(name);
@@ -237,6 +272,7 @@ void AllowedCollisionMatrix::setDefaultEntry(const std::string& name, bool allow
 
 void AllowedCollisionMatrix::setDefaultEntry(const std::string& name, DecideContactFn& fn)
 {
+  updateVersion();
   default_entries_[name] = AllowedCollision::CONDITIONAL;
   default_allowed_contacts_[name] = fn;
 }
@@ -319,12 +355,29 @@ bool AllowedCollisionMatrix::getAllowedCollision(const std::string& name1, const
 
 void AllowedCollisionMatrix::clear()
 {
+  updateVersion();
   entries_.clear();
   allowed_contacts_.clear();
   default_entries_.clear();
   default_allowed_contacts_.clear();
 }
 
+void AllowedCollisionMatrix::updateVersion()
+{
+  version_ = NEXT_VERSION++;
+}
+
+CompiledAllowedCollisionMatrixConstPtr AllowedCollisionMatrix::getCompiled() const
+{
+  CompiledAllowedCollisionMatrixConstPtr compiled = std::atomic_load(&compiled_);
+  if (!compiled || compiled->getVersion() != version_)
+  {
+    compiled = std::make_shared<const CompiledAllowedCollisionMatrix>(*this);
+    std::atomic_store(&compiled_, compiled);
+  }
+  return compiled;
+}
+
 void AllowedCollisionMatrix::getAllEntryNames(std::vector<std::string>& names) const
 {
   names.clear();
@@ -421,4 +474,36 @@ void AllowedCollisionMatrix::print(std::ostream& out) const
   }
 }
 
+const std::uint8_t CompiledAllowedCollisionMatrix::NO_ENTRY;
+
+CompiledAllowedCollisionMatrix::CompiledAllowedCollisionMatrix(const AllowedCollisionMatrix& acm)
+  : version_(acm.version_)
+{
+  std::vector<const std::string*> names;
+  for (const auto& entry : acm.entries_)
+    if (indices_.emplace(entry.first, names.size()).second)
+      names.push_back(&entry.first);
+  for (const auto& entry : acm.default_entries_)
+    if (indices_.emplace(entry.first, names.size()).second)
+      names.push_back(&entry.first);
+  size_ = names.size();
+
+  AllowedCollision::Type type;
+  entries_.resize(size_ * size_, NO_ENTRY);
+  for (std::size_t i = 0; i < size_; ++i)
+    for (std::size_t j = i; j < size_; ++j)
+      if (acm.getAllowedCollision(*names[i], *names[j], type))
+        entries_[i * size_ + j] = entries_[j * size_ + i] = type;
+
+  default_entries_.resize(size_, NO_ENTRY);
+  for (std::size_t i = 0; i < size_; ++i)
+    if (acm.getDefaultEntry(*names[i], type))
+      default_entries_[i] = type;
+}
+
+int CompiledAllowedCollisionMatrix::getIndex(const std::string& name) const
+{
+  auto it = indices_.find(name);
+  return it == indices_.end() ? -1 : it->second;
+}
 }  // end of namespace collision_detection
@@ -36,187 +36,72 @@
 
 #include <moveit/collision_detection/collision_common.h>
 #include <moveit/collision_detection/collision_octomap_filter.h>
-#include <octomap/math/Vector3.h>
-#include <octomap/math/Utils.h>
 #include <octomap/octomap.h>
 #include <geometric_shapes/shapes.h>
+#include <algorithm>
+#include <cmath>
+#include <map>
 #include <memory>
 #include "rclcpp/rclcpp.hpp"
 
 // Logger
 static const rclcpp::Logger LOGGER = rclcpp::get_logger("moveit_collision_detection.collision_octomap_filter");
 
-// forward declarations
-bool getMetaballSurfaceProperties(const octomap::point3d_list& cloud, const double& spacing, const double& iso_value,
-                                  const double& r_multiple, const octomath::Vector3& contact_point,
-                                  octomath::Vector3& normal, double& depth, bool estimate_depth);
-
-bool findSurface(const octomap::point3d_list& cloud, const double& spacing, const double& iso_value,
-                 const double& r_multiple, const octomath::Vector3& seed, octomath::Vector3& surface_point,
-                 octomath::Vector3& normal);
-
-bool sampleCloud(const octomap::point3d_list& cloud, const double& spacing, const double& r_multiple,
-                 const octomath::Vector3& position, double& intensity, octomath::Vector3& gradient);
-
-int collision_detection::refineContactNormals(const World::ObjectConstPtr& object, CollisionResult& res,
-                                              double cell_bbx_search_distance, double allowed_angle_divergence,
-                                              bool estimate_depth, double iso_value, double metaball_radius_multiple)
+namespace
 {
-  if (!object)
+/** \brief Wyvill's soft object potential of metaballs of radius R around points. Each point contributes
+ *  a r^6 / R^6 + b r^4 / R^4 + c r^2 / R^2 + 1 at distance r. */
+struct MetaballPotential
+{
+  MetaballPotential(double spacing, double r_multiple)
   {
-    RCLCPP_ERROR(LOGGER, "No valid Object passed in, cannot refine Normals!");
-    return 0;
+    const double r2 = (r_multiple * spacing) * (r_multiple * spacing);
+    a1 = (-4.0 / 9.0) / (r2 * r2 * r2);
+    b1 = (17.0 / 9.0) / (r2 * r2);
+    c1 = (-22.0 / 9.0) / r2;
   }
-  if (res.contact_count < 1)
-  {
-    RCLCPP_WARN(LOGGER, "There do not appear to be any contacts, so there is nothing to refine!");
-    return 0;
-  }
-
-  int modified = 0;
 
-  // iterate through contacts
-  for (auto& contact : res.contacts)
+  /** \brief Sample the potential of the points in \e cloud at \e position.
+   *
+   * The gradient is flipped to follow the convention of implicit surfaces, pointing out of the cloud.
+   * Return false if the cloud is empty. */
+  bool sample(const Eigen::Matrix3Xd& cloud, const Eigen::Vector3d& position, double& intensity,
+              Eigen::Vector3d& gradient) const
   {
-    std::string contact1 = contact.first.first;
-    std::string contact2 = contact.first.second;
-    std::string octomap_name = "";
-    std::vector<collision_detection::Contact>& contact_vector = contact.second;
-
-    if (contact1.find("octomap") != std::string::npos)
-      octomap_name = contact1;
-    else if (contact2.find("octomap") != std::string::npos)
-      octomap_name = contact2;
-    else
-    {
-      continue;
-    }
-
-    double cell_size = 0;
-    if (!object->shapes_.empty())
-    {
-      const shapes::ShapeConstPtr& shape = object->shapes_[0];
-      std::shared_ptr<const shapes::OcTree> shape_octree = std::dynamic_pointer_cast<const shapes::OcTree>(shape);
-      if (shape_octree)
-      {
-        std::shared_ptr<const octomap::OcTree> octree = shape_octree->octree;
-        cell_size = octree->getResolution();
-        for (auto& contact_info : contact_vector)
-        {
-          const Eigen::Vector3d& point = contact_info.pos;
-          const Eigen::Vector3d& normal = contact_info.normal;
-
-          octomath::Vector3 contact_point(point[0], point[1], point[2]);
-          octomath::Vector3 contact_normal(normal[0], normal[1], normal[2]);
-          octomath::Vector3 diagonal = octomath::Vector3(1, 1, 1);
-          octomath::Vector3 bbx_min = contact_point - diagonal * cell_size * cell_bbx_search_distance;
-          octomath::Vector3 bbx_max = contact_point + diagonal * cell_size * cell_bbx_search_distance;
-          octomap::point3d_list node_centers;
-          octomap::OcTreeBaseImpl<octomap::OcTreeNode, octomap::AbstractOccupancyOcTree>::leaf_bbx_iterator it =
-              octree->begin_leafs_bbx(bbx_min, bbx_max);
-          octomap::OcTreeBaseImpl<octomap::OcTreeNode, octomap::AbstractOccupancyOcTree>::leaf_bbx_iterator leafs_end =
-              octree->end_leafs_bbx();
-          int count = 0;
-          for (; it != leafs_end; ++it)
-          {
-            octomap::point3d pt = it.getCoordinate();
-            // double prob = it->getOccupancy();
-            if (octree->isNodeOccupied(*it))  // magic number!
-            {
-              count++;
-              node_centers.push_back(pt);
-              // RCLCPP_INFO(LOGGER, "Adding point %d with prob %.3f at [%.3f, %.3f, %.3f]",
-              //                          count, prob, pt.x(), pt.y(), pt.z());
-            }
-          }
-          // RCLCPP_INFO(LOGGER, "Contact point at [%.3f, %.3f, %.3f], cell size %.3f, occupied cells
-          // %d",
-          //                          contact_point.x(), contact_point.y(), contact_point.z(), cell_size, count);
-
-          // octree->getOccupiedLeafsBBX(node_centers, bbx_min, bbx_max);
-          // RCLCPP_ERROR(LOGGER, "bad stuff in collision_octomap_filter.cpp; need to port octomap
-          // call for groovy");
-
-          octomath::Vector3 n;
-          double depth;
-          if (getMetaballSurfaceProperties(node_centers, cell_size, iso_value, metaball_radius_multiple, contact_point,
-                                           n, depth, estimate_depth))
-          {
-            // only modify normal if the refinement predicts a "very different" result.
-            double divergence = contact_normal.angleTo(n);
-            if (divergence > allowed_angle_divergence)
-            {
-              modified++;
-              // RCLCPP_INFO(LOGGER, "Normals differ by %.3f, changing: [%.3f, %.3f, %.3f] -> [%.3f,
-              // %.3f, %.3f]",
-              //                          divergence, contact_normal.x(), contact_normal.y(), contact_normal.z(),
-              //                          n.x(), n.y(), n.z());
-              contact_info.normal = Eigen::Vector3d(n.x(), n.y(), n.z());
-            }
+    if (cloud.cols() == 0)
+      return false;
 
-            if (estimate_depth)
-              contact_info.depth = depth;
-          }
-        }
-      }
-    }
+    // all terms are polynomials in the squared distance, which is evaluated for all points at once
+    const Eigen::Matrix3Xd offsets = (-cloud).colwise() + position;
+    const Eigen::ArrayXd r2 = offsets.colwise().squaredNorm().transpose().array();
+    intensity = (((a1 * r2 + b1) * r2 + c1) * r2 + 1.0).sum();
+    // the derivative of the potential along the offset divided by r, (6 a r^5 + 4 b r^3 + 2 c r) / r
+    gradient = -(offsets * ((6.0 * a1 * r2 + 4.0 * b1) * r2 + 2.0 * c1).matrix());
+    return true;
   }
-  return modified;
-}
 
-bool getMetaballSurfaceProperties(const octomap::point3d_list& cloud, const double& spacing, const double& iso_value,
-                                  const double& r_multiple, const octomath::Vector3& contact_point,
-                                  octomath::Vector3& normal, double& depth, bool estimate_depth)
-{
-  double intensity;
-  if (estimate_depth)
-  {
-    octomath::Vector3 surface_point;
-    if (findSurface(cloud, spacing, iso_value, r_multiple, contact_point, surface_point, normal))
-    {
-      depth = normal.dot(surface_point - contact_point);  // do we prefer this, or magnitude of surface - contact?
-      return true;
-    }
-    else
-    {
-      return false;
-    }
-  }
-  else  // just get normals, no depth
-  {
-    octomath::Vector3 gradient;
-    if (sampleCloud(cloud, spacing, r_multiple, contact_point, intensity, gradient))
-    {
-      normal = gradient.normalized();
-      return true;
-    }
-    else
-    {
-      return false;
-    }
-  }
-}
+  double a1, b1, c1;
+};
 
 // --------------------------------------------------------------------------
 // This algorithm is from Salisbury & Tarr's 1997 paper.  It will find the
 // closest point on the surface starting from a seed point that is close by
 // following the direction of the field gradient.
-bool findSurface(const octomap::point3d_list& cloud, const double& spacing, const double& iso_value,
-                 const double& r_multiple, const octomath::Vector3& seed, octomath::Vector3& surface_point,
-                 octomath::Vector3& normal)
+bool findSurface(const Eigen::Matrix3Xd& cloud, const MetaballPotential& potential, double iso_value,
+                 const Eigen::Vector3d& seed, Eigen::Vector3d& surface_point, Eigen::Vector3d& normal)
 {
   const double epsilon = 1e-10;
   const int iterations = 10;
   double intensity = 0;
 
-  octomath::Vector3 p = seed, dp, gs;
+  Eigen::Vector3d p = seed, gs;
   for (int i = 0; i < iterations; ++i)
   {
-    if (!sampleCloud(cloud, spacing, r_multiple, p, intensity, gs))
+    if (!potential.sample(cloud, p, intensity, gs))
       return false;
     double s = iso_value - intensity;
-    dp = (gs * -s) * (1.0 / std::max(gs.dot(gs), epsilon));
-    p = p + dp;
+    Eigen::Vector3d dp = (gs * -s) * (1.0 / std::max(gs.dot(gs), epsilon));
+    p += dp;
     if (dp.dot(dp) < epsilon)
     {
       surface_point = p;
@@ -225,89 +110,133 @@ bool findSurface(const octomap::point3d_list& cloud, const double& spacing, cons
     }
   }
   return false;
-  //    return p;
 }
 
-bool sampleCloud(const octomap::point3d_list& cloud, const double& spacing, const double& r_multiple,
-                 const octomath::Vector3& position, double& intensity, octomath::Vector3& gradient)
+bool getMetaballSurfaceProperties(const Eigen::Matrix3Xd& cloud, const MetaballPotential& potential, double iso_value,
+                                  const Eigen::Vector3d& contact_point, Eigen::Vector3d& normal, double& depth,
+                                  bool estimate_depth)
 {
-  intensity = 0.f;
-  gradient = octomath::Vector3(0, 0, 0);
+  if (estimate_depth)
+  {
+    Eigen::Vector3d surface_point;
+    if (!findSurface(cloud, potential, iso_value, contact_point, surface_point, normal))
+      return false;
+    depth = normal.dot(surface_point - contact_point);  // do we prefer this, or magnitude of surface - contact?
+    return true;
+  }
+
+  // just get normals, no depth
+  double intensity;
+  Eigen::Vector3d gradient;
+  if (!potential.sample(cloud, contact_point, intensity, gradient))
+    return false;
+  normal = gradient.normalized();
+  return true;
+}
 
-  double r = r_multiple * spacing;  // TODO magic number!
-  // double T = 0.5; // TODO magic number!
+std::uint64_t packKey(const octomap::OcTreeKey& key)
+{
+  return (std::uint64_t(key[0]) << 32) | (std::uint64_t(key[1]) << 16) | std::uint64_t(key[2]);
+}
 
-  int nn = cloud.size();
-  if (nn == 0)
+/** \brief The centers of the occupied leafs of an octree in bounding boxes, cached by the keys of the box corners
+ *  so that contacts in the same region share a single traversal of the octree */
+class OccupiedCellCache
+{
+public:
+  OccupiedCellCache(const octomap::OcTree& octree) : octree_(octree)
   {
-    return false;
   }
 
-  // variables for Wyvill
-  double a = 0, b = 0, c = 0, r2 = 0, r4 = 0, r6 = 0, a1 = 0, b1 = 0, c1 = 0, a2 = 0, b2 = 0, c2 = 0;
-  bool wyvill = true;
-
-  octomap::point3d_list::const_iterator it;
-  for (it = cloud.begin(); it != cloud.end(); ++it)
+  const Eigen::Matrix3Xd& getCells(const Eigen::Vector3d& bbx_min, const Eigen::Vector3d& bbx_max)
   {
-    octomath::Vector3 v = (*it);
+    octomap::OcTreeKey min_key, max_key;
+    if (!octree_.coordToKeyChecked(bbx_min.x(), bbx_min.y(), bbx_min.z(), min_key) ||
+        !octree_.coordToKeyChecked(bbx_max.x(), bbx_max.y(), bbx_max.z(), max_key))
+      return empty_;
+
+    std::pair<std::map<std::pair<std::uint64_t, std::uint64_t>, Eigen::Matrix3Xd>::iterator, bool> inserted =
+        cells_.emplace(std::make_pair(packKey(min_key), packKey(max_key)), Eigen::Matrix3Xd());
+    Eigen::Matrix3Xd& cells = inserted.first->second;
+    if (!inserted.second)
+      return cells;
+
+    std::vector<Eigen::Vector3d> centers;
+    for (octomap::OcTree::leaf_bbx_iterator it = octree_.begin_leafs_bbx(min_key, max_key),
+                                            end = octree_.end_leafs_bbx();
+         it != end; ++it)
+      if (octree_.isNodeOccupied(*it))
+        centers.emplace_back(it.getX(), it.getY(), it.getZ());
+    cells.resize(3, centers.size());
+    for (std::size_t i = 0; i < centers.size(); ++i)
+      cells.col(i) = centers[i];
+    return cells;
+  }
 
-    if (wyvill)
-    {
-      r2 = r * r;
-      r4 = r2 * r2;
-      r6 = r4 * r2;
-      a = -4.0 / 9.0;
-      b = 17.0 / 9.0;
-      c = -22.0 / 9.0;
-      a1 = a / r6;
-      b1 = b / r4;
-      c1 = c / r2;
-      a2 = 6 * a1;
-      b2 = 4 * b1;
-      c2 = 2 * c1;
-    }
-    else
-    {
-      RCLCPP_ERROR(LOGGER, "This should not be called!");
-    }
+private:
+  const octomap::OcTree& octree_;
+  std::map<std::pair<std::uint64_t, std::uint64_t>, Eigen::Matrix3Xd> cells_;
+  const Eigen::Matrix3Xd empty_;
+};
+}  // namespace
 
-    double f_val = 0;
-    octomath::Vector3 f_grad(0, 0, 0);
+int collision_detection::refineContactNormals(const World::ObjectConstPtr& object, CollisionResult& res,
+                                              double cell_bbx_search_distance, double allowed_angle_divergence,
+                                              bool estimate_depth, double iso_value, double metaball_radius_multiple)
+{
+  if (!object)
+  {
+    RCLCPP_ERROR(LOGGER, "No valid Object passed in, cannot refine Normals!");
+    return 0;
+  }
+  if (res.contact_count < 1)
+  {
+    RCLCPP_WARN(LOGGER, "There do not appear to be any contacts, so there is nothing to refine!");
+    return 0;
+  }
+  if (object->shapes_.empty())
+    return 0;
+  std::shared_ptr<const shapes::OcTree> shape_octree =
+      std::dynamic_pointer_cast<const shapes::OcTree>(object->shapes_[0]);
+  if (!shape_octree)
+    return 0;
 
-    octomath::Vector3 pos = position - v;
-    double r = pos.norm();
-    pos = pos * (1.0 / r);
-    if (r > r)  // must skip points outside valid bounds.
-    {
+  const octomap::OcTree& octree = *shape_octree->octree;
+  const double cell_size = octree.getResolution();
+  const Eigen::Vector3d half_extent = Eigen::Vector3d::Constant(cell_size * cell_bbx_search_distance);
+  const MetaballPotential potential(cell_size, metaball_radius_multiple);
+  OccupiedCellCache cell_cache(octree);
+  int modified = 0;
+
+  // iterate through contacts
+  for (auto& contact : res.contacts)
+  {
+    if (contact.first.first.find("octomap") == std::string::npos &&
+        contact.first.second.find("octomap") == std::string::npos)
       continue;
-    }
-    double r2 = r * r;
-    double r3 = r * r2;
-    double r4 = r2 * r2;
-    double r5 = r3 * r2;
-    double r6 = r3 * r3;
 
-    if (wyvill)
+    for (collision_detection::Contact& contact_info : contact.second)
     {
-      f_val = (a1 * r6 + b1 * r4 + c1 * r2 + 1);
-      f_grad = pos * (a2 * r5 + b2 * r3 + c2 * r);
-    }
-    else
-    {
-      RCLCPP_ERROR(LOGGER, "This should not be called!");
-      double r_scaled = r / r;
-      // TODO still need to address the scaling...
-      f_val = pow((1 - r_scaled), 4) * (4 * r_scaled + 1);
-      f_grad = pos * (-4.0 / r * pow(1.0 - r_scaled, 3) * (4.0 * r_scaled + 1.0) + 4.0 / r * pow(1 - r_scaled, 4));
-    }
+      const Eigen::Vector3d& contact_point = contact_info.pos;
+      const Eigen::Matrix3Xd& cells = cell_cache.getCells(contact_point - half_extent, contact_point + half_extent);
 
-    // TODO:  The whole library should be overhauled to follow the "gradient points out"
-    //        convention of implicit functions.
-    intensity += f_val;
-    gradient += f_grad;
+      Eigen::Vector3d n;
+      double depth;
+      if (getMetaballSurfaceProperties(cells, potential, iso_value, contact_point, n, depth, estimate_depth))
+      {
+        // only modify normal if the refinement predicts a "very different" result.
+        const double cos_divergence = contact_info.normal.normalized().dot(n);
+        const double divergence = std::acos(std::max(-1.0, std::min(1.0, cos_divergence)));
+        if (divergence > allowed_angle_divergence)
+        {
+          modified++;
+          contact_info.normal = n;
+        }
+
+        if (estimate_depth)
+          contact_info.depth = depth;
+      }
+    }
   }
-  // implicit surface gradient convention points out, so we flip it.
-  gradient *= -1.0;
-  return true;  // it worked
+  return modified;
 }
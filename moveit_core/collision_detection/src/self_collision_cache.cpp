@@ -0,0 +1,139 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, PickNik LLC
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik LLC nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include <moveit/collision_detection/self_collision_cache.h>
+#include <boost/functional/hash.hpp>
+#include <algorithm>
+#include <cmath>
+
+namespace collision_detection
+{
+SelfCollisionCache::SelfCollisionCache(std::size_t max_size, double resolution)
+  : max_size_(std::max<std::size_t>(max_size, 1)), resolution_(resolution), hits_(0), misses_(0)
+{
+}
+
+SelfCollisionCache::Key SelfCollisionCache::makeKey(const moveit::core::RobotState& state,
+                                                    const AllowedCollisionMatrix& acm,
+                                                    const std::string& context) const
+{
+  Key key;
+  key.context_hash = 0;
+  boost::hash_combine(key.context_hash, state.getRobotModel().get());
+  boost::hash_combine(key.context_hash, acm.getVersion());
+  boost::hash_combine(key.context_hash, context);
+  std::vector<const moveit::core::AttachedBody*> attached_bodies;
+  state.getAttachedBodies(attached_bodies);
+  for (const moveit::core::AttachedBody* attached_body : attached_bodies)
+  {
+    boost::hash_combine(key.context_hash, attached_body->getName());
+    boost::hash_combine(key.context_hash, attached_body->getAttachedLinkName());
+  }
+
+  const double* positions = state.getVariablePositions();
+  key.cells.resize(state.getVariableCount());
+  key.hash = key.context_hash;
+  for (std::size_t i = 0; i < key.cells.size(); ++i)
+  {
+    key.cells[i] = std::llround(positions[i] / resolution_);
+    boost::hash_combine(key.hash, key.cells[i]);
+  }
+  return key;
+}
+
+bool SelfCollisionCache::lookup(const moveit::core::RobotState& state, const AllowedCollisionMatrix& acm,
+                                const std::string& context, bool& collision) const
+{
+  const Key key = makeKey(state, acm, context);
+  std::unique_lock<std::mutex> slock(lock_);
+  auto it = index_.find(key);
+  if (it == index_.end())
+  {
+    ++misses_;
+    return false;
+  }
+  ++hits_;
+  entries_.splice(entries_.begin(), entries_, it->second);
+  collision = it->second->second;
+  return true;
+}
+
+void SelfCollisionCache::insert(const moveit::core::RobotState& state, const AllowedCollisionMatrix& acm,
+                                const std::string& context, bool collision)
+{
+  Key key = makeKey(state, acm, context);
+  std::unique_lock<std::mutex> slock(lock_);
+  auto it = index_.find(key);
+  if (it != index_.end())
+  {
+    it->second->second = collision;
+    entries_.splice(entries_.begin(), entries_, it->second);
+    return;
+  }
+  if (entries_.size() >= max_size_)
+  {
+    index_.erase(entries_.back().first);
+    entries_.pop_back();
+  }
+  entries_.emplace_front(std::move(key), collision);
+  index_[entries_.front().first] = entries_.begin();
+}
+
+void SelfCollisionCache::clear()
+{
+  std::unique_lock<std::mutex> slock(lock_);
+  index_.clear();
+  entries_.clear();
+  hits_ = 0;
+  misses_ = 0;
+}
+
+std::size_t SelfCollisionCache::size() const
+{
+  std::unique_lock<std::mutex> slock(lock_);
+  return entries_.size();
+}
+
+std::size_t SelfCollisionCache::getHitCount() const
+{
+  std::unique_lock<std::mutex> slock(lock_);
+  return hits_;
+}
+
+std::size_t SelfCollisionCache::getMissCount() const
+{
+  std::unique_lock<std::mutex> slock(lock_);
+  return misses_;
+}
+}  // namespace collision_detection
@@ -37,18 +37,43 @@
 #include <moveit/collision_detection/world.h>
 #include <rclcpp/rclcpp.hpp>
 #include <geometric_shapes/check_isometry.h>
+#include <geometric_shapes/shapes.h>
+#include <octomap/octomap.h>
 #include <boost/algorithm/string/predicate.hpp>
+#include <atomic>
+#include <unordered_set>
 
 namespace collision_detection
 {
 // Logger
 static const rclcpp::Logger LOGGER = rclcpp::get_logger("moveit_collision_detection.world");
 
-World::World()
+namespace
 {
+// generations are unique across all worlds, so that a handle cached for one world never matches another
+std::size_t nextGeneration()
+{
+  static std::atomic<std::size_t> generation(0);
+  return ++generation;
+}
+
+std::size_t getMeshMemoryUsage(const shapes::Mesh& mesh)
+{
+  std::size_t bytes = sizeof(shapes::Mesh) + mesh.vertex_count * 3 * sizeof(double) +
+                      mesh.triangle_count * 3 * sizeof(unsigned int);
+  if (mesh.triangle_normals)
+    bytes += mesh.triangle_count * 3 * sizeof(double);
+  if (mesh.vertex_normals)
+    bytes += mesh.vertex_count * 3 * sizeof(double);
+  return bytes;
 }
+}  // namespace
 
-World::World(const World& other)
+World::World() : batch_depth_(0), generation_(nextGeneration())
+{
+}
+
+World::World(const World& other) : batch_depth_(0), generation_(nextGeneration())
 {
   objects_ = other.objects_;
 }
@@ -137,6 +162,34 @@ void World::ensureUnique(ObjectPtr& obj)
     obj.reset(new Object(*obj));
 }
 
+World::MemoryUsage World::getMemoryUsage() const
+{
+  MemoryUsage usage;
+  std::unordered_set<const shapes::Shape*> counted;
+  for (const auto& object : objects_)
+  {
+    const Object& obj = *object.second;
+    usage.other += sizeof(Object) + obj.id_.capacity() +
+                   obj.shapes_.size() * (sizeof(shapes::ShapeConstPtr) + sizeof(Eigen::Isometry3d)) +
+                   obj.subframe_poses_.size() * (sizeof(std::string) + sizeof(Eigen::Isometry3d));
+    for (const shapes::ShapeConstPtr& shape : obj.shapes_)
+    {
+      if (!counted.insert(shape.get()).second)
+        continue;
+      if (shape->type == shapes::MESH)
+        usage.meshes += getMeshMemoryUsage(static_cast<const shapes::Mesh&>(*shape));
+      else if (shape->type == shapes::OCTREE)
+      {
+        const auto& octree = static_cast<const shapes::OcTree&>(*shape).octree;
+        usage.octrees += sizeof(shapes::OcTree) + (octree ? octree->memoryUsage() : 0);
+      }
+      else
+        usage.other += sizeof(shapes::Box);  // all primitives are about this size
+    }
+  }
+  return usage;
+}
+
 bool World::hasObject(const std::string& object_id) const
 {
   return objects_.find(object_id) != objects_.end();
@@ -223,6 +276,22 @@ bool World::moveShapeInObject(const std::string& object_id, const shapes::ShapeC
   return false;
 }
 
+bool World::moveShapesInObject(const std::string& object_id, const EigenSTL::vector_Isometry3d& poses)
+{
+  auto it = objects_.find(object_id);
+  if (it == objects_.end() || it->second->shapes_.size() != poses.size())
+    return false;
+
+  ensureUnique(it->second);
+  for (std::size_t i = 0; i < poses.size(); ++i)
+  {
+    ASSERT_ISOMETRY(poses[i])  // unsanitized input, could contain a non-isometry
+    it->second->shape_poses_[i] = poses[i];
+  }
+  notify(it->second, MOVE_SHAPE);
+  return true;
+}
+
 bool World::moveObject(const std::string& object_id, const Eigen::Isometry3d& transform)
 {
   auto it = objects_.find(object_id);
@@ -298,12 +367,19 @@ bool World::setSubframesOfObject(const std::string& object_id, const moveit::cor
     ASSERT_ISOMETRY(t.second)  // unsanitized input, could contain a non-isometry
   }
   obj_pair->second->subframe_poses_ = subframe_poses;
+  generation_ = nextGeneration();
   return true;
 }
 
 World::ObserverHandle World::addObserver(const ObserverCallbackFn& callback)
 {
-  auto o = new Observer(callback);
+  return addObserver(callback, ObserverBatchCallbackFn());
+}
+
+World::ObserverHandle World::addObserver(const ObserverCallbackFn& callback,
+                                         const ObserverBatchCallbackFn& batch_callback)
+{
+  auto o = new Observer(callback, batch_callback);
   observers_.push_back(o);
   return ObserverHandle(o);
 }
@@ -329,8 +405,75 @@ void World::notifyAll(Action action)
 
 void World::notify(const ObjectConstPtr& obj, Action action)
 {
-  for (Observer* observer : observers_)
-    observer->callback_(obj, action);
+  generation_ = nextGeneration();
+  if (batch_depth_ > 0)
+  {
+    auto it = batch_change_index_.find(obj->id_);
+    if (it != batch_change_index_.end())
+    {
+      std::pair<ObjectConstPtr, Action>& change = batch_changes_[it->second];
+      if (!(change.second & DESTROY))
+      {
+        if (action & DESTROY)
+        {
+          if (change.second & CREATE)
+          {
+            // the observers never knew about this object
+            change.first.reset();
+            change.second = UNINITIALIZED;
+          }
+          else
+            change = std::make_pair(obj, Action(DESTROY));
+        }
+        else
+          change = std::make_pair(obj, Action(change.second | action));
+        return;
+      }
+    }
+    // the first change of this object in the batch, or it is created again after being destroyed
+    batch_change_index_[obj->id_] = batch_changes_.size();
+    batch_changes_.emplace_back(obj, action);
+    return;
+  }
+
+  // observers added by a callback (e.g. lazily allocated collision environments) are notified of this change as well
+  for (std::size_t i = 0; i < observers_.size(); ++i)
+    observers_[i]->callback_(obj, action);
+}
+
+void World::beginBatch()
+{
+  ++batch_depth_;
+}
+
+void World::commitBatch()
+{
+  if (batch_depth_ == 0)
+  {
+    RCLCPP_ERROR(LOGGER, "commitBatch() called without beginBatch()");
+    return;
+  }
+  if (--batch_depth_ > 0)
+    return;
+
+  ObjectChanges changes;
+  changes.reserve(batch_changes_.size());
+  for (std::pair<ObjectConstPtr, Action>& change : batch_changes_)
+    if (change.first)
+      changes.push_back(std::move(change));
+  batch_changes_.clear();
+  batch_change_index_.clear();
+  if (changes.empty())
+    return;
+
+  for (std::size_t i = 0; i < observers_.size(); ++i)
+  {
+    if (observers_[i]->batch_callback_)
+      observers_[i]->batch_callback_(changes);
+    else
+      for (const std::pair<ObjectConstPtr, Action>& change : changes)
+        observers_[i]->callback_(change.first, change.second);
+  }
 }
 
 void World::notifyObserverAllObjects(const ObserverHandle observer_handle, Action action) const
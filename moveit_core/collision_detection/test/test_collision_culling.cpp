@@ -0,0 +1,126 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, PickNik LLC
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik LLC nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include <gtest/gtest.h>
+#include <moveit/collision_detection/collision_culling.h>
+#include <moveit/collision_detection/allvalid/collision_env_allvalid.h>
+#include <moveit/utils/robot_model_test_utils.h>
+
+using namespace collision_detection;
+
+class GroupCollisionCullingTest : public testing::Test
+{
+protected:
+  void SetUp() override
+  {
+    // a two link arm reaching 1m from the base, and a revolute link 5m away that is not part of the arm
+    moveit::core::RobotModelBuilder builder("arm", "base");
+    geometry_msgs::msg::Pose origin;
+    origin.orientation.w = 1.0;
+    geometry_msgs::msg::Pose elbow = origin;
+    elbow.position.x = 1.0;
+    geometry_msgs::msg::Pose distant = origin;
+    distant.position.x = 5.0;
+    builder.addChain("base->a->b", "revolute", { origin, elbow });
+    builder.addChain("base->c", "revolute", { distant });
+    for (const std::string& link : { "base", "a", "b", "c" })
+      builder.addCollisionBox(link, { 0.2, 0.2, 0.2 }, origin);
+    builder.addGroupChain("base", "b", "arm");
+    ASSERT_TRUE(builder.isValid());
+    robot_model_ = builder.build();
+  }
+
+  moveit::core::RobotModelPtr robot_model_;
+};
+
+TEST_F(GroupCollisionCullingTest, LinkPairs)
+{
+  CollisionEnvAllValid env(robot_model_);
+  moveit::core::RobotState state(robot_model_);
+  state.setToDefaultValues();
+  GroupCollisionCulling culling(env, state, robot_model_->getJointModelGroup("arm"));
+
+  const moveit::core::LinkModel* base = robot_model_->getLinkModel("base");
+  const moveit::core::LinkModel* a = robot_model_->getLinkModel("a");
+  const moveit::core::LinkModel* b = robot_model_->getLinkModel("b");
+  const moveit::core::LinkModel* c = robot_model_->getLinkModel("c");
+
+  EXPECT_TRUE(culling.mayCollide(a, b));
+  EXPECT_TRUE(culling.mayCollide(base, b));
+  EXPECT_FALSE(culling.mayCollide(a, c));
+  EXPECT_FALSE(culling.mayCollide(c, b));
+  // pairs of links that are not moved by the group are not culled
+  EXPECT_TRUE(culling.mayCollide(base, c));
+  EXPECT_EQ(culling.getCulledPairCount(), 2u);
+
+  // b sweeps a sphere around the base
+  EXPECT_TRUE(culling.getSweptVolume().contains(Eigen::Vector3d(0.0, -1.1, 0.0)));
+  const Eigen::AlignedBox3d near_box(Eigen::Vector3d(-1.2, 0.0, 0.0), Eigen::Vector3d(-1.1, 0.1, 0.1));
+  const Eigen::AlignedBox3d far_box(Eigen::Vector3d(2.0, 0.0, 0.0), Eigen::Vector3d(3.0, 1.0, 1.0));
+  EXPECT_TRUE(culling.mayCollide(b, near_box));
+  EXPECT_FALSE(culling.mayCollide(b, far_box));
+  EXPECT_TRUE(culling.mayCollide(c, far_box));
+}
+
+TEST_F(GroupCollisionCullingTest, Padding)
+{
+  CollisionEnvAllValid env(robot_model_, 2.0);
+  moveit::core::RobotState state(robot_model_);
+  state.setToDefaultValues();
+  GroupCollisionCulling culling(env, state, robot_model_->getJointModelGroup("arm"));
+  EXPECT_TRUE(culling.mayCollide(robot_model_->getLinkModel("b"), robot_model_->getLinkModel("c")));
+}
+
+TEST_F(GroupCollisionCullingTest, ValidForState)
+{
+  CollisionEnvAllValid env(robot_model_);
+  moveit::core::RobotState state(robot_model_);
+  state.setToDefaultValues();
+  GroupCollisionCulling culling(env, state, robot_model_->getJointModelGroup("arm"));
+  EXPECT_TRUE(culling.isValidFor(state));
+
+  // the variables of the group may change
+  state.setVariablePosition("a-b-joint", 1.0);
+  EXPECT_TRUE(culling.isValidFor(state));
+
+  // the others may not
+  state.setVariablePosition("base-c-joint", 1.0);
+  EXPECT_FALSE(culling.isValidFor(state));
+}
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,134 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, PickNik LLC
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik LLC nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include <gtest/gtest.h>
+#include <moveit/collision_detection/self_collision_cache.h>
+#include <moveit/utils/robot_model_test_utils.h>
+
+using namespace collision_detection;
+
+class SelfCollisionCacheTest : public testing::Test
+{
+protected:
+  void SetUp() override
+  {
+    moveit::core::RobotModelBuilder builder("arm", "base");
+    builder.addChain("base->a->b", "continuous");
+    ASSERT_TRUE(builder.isValid());
+    robot_model_ = builder.build();
+  }
+
+  moveit::core::RobotModelPtr robot_model_;
+};
+
+TEST_F(SelfCollisionCacheTest, LookupQuantized)
+{
+  SelfCollisionCache cache(10, 0.01);
+  AllowedCollisionMatrix acm;
+  moveit::core::RobotState state(robot_model_);
+  state.setToDefaultValues();
+
+  bool collision = false;
+  EXPECT_FALSE(cache.lookup(state, acm, "arm", collision));
+  cache.insert(state, acm, "arm", true);
+  EXPECT_TRUE(cache.lookup(state, acm, "arm", collision));
+  EXPECT_TRUE(collision);
+
+  // states in the same cell share the result
+  state.setVariablePosition(0, 0.001);
+  EXPECT_TRUE(cache.lookup(state, acm, "arm", collision));
+  state.setVariablePosition(0, 0.1);
+  EXPECT_FALSE(cache.lookup(state, acm, "arm", collision));
+  state.setVariablePosition(0, 0.0);
+
+  // the context is part of the key
+  EXPECT_FALSE(cache.lookup(state, acm, "other", collision));
+
+  EXPECT_EQ(cache.getHitCount(), 2u);
+  EXPECT_EQ(cache.getMissCount(), 3u);
+}
+
+TEST_F(SelfCollisionCacheTest, CollisionMatrixVersion)
+{
+  SelfCollisionCache cache;
+  AllowedCollisionMatrix acm;
+  moveit::core::RobotState state(robot_model_);
+  state.setToDefaultValues();
+  cache.insert(state, acm, "", false);
+
+  bool collision = true;
+  AllowedCollisionMatrix copy(acm);
+  EXPECT_TRUE(cache.lookup(state, copy, "", collision));
+  EXPECT_FALSE(collision);
+
+  copy.setEntry("a", "b", true);
+  EXPECT_NE(copy.getVersion(), acm.getVersion());
+  EXPECT_FALSE(cache.lookup(state, copy, "", collision));
+}
+
+TEST_F(SelfCollisionCacheTest, LeastRecentlyUsedEviction)
+{
+  SelfCollisionCache cache(2, 0.01);
+  AllowedCollisionMatrix acm;
+  moveit::core::RobotState state(robot_model_);
+  state.setToDefaultValues();
+
+  bool collision;
+  for (double position : { 0.0, 0.1 })
+  {
+    state.setVariablePosition(0, position);
+    cache.insert(state, acm, "", false);
+  }
+  // use the first result, so the second one is dropped next
+  state.setVariablePosition(0, 0.0);
+  EXPECT_TRUE(cache.lookup(state, acm, "", collision));
+  state.setVariablePosition(0, 0.2);
+  cache.insert(state, acm, "", true);
+
+  EXPECT_EQ(cache.size(), 2u);
+  EXPECT_TRUE(cache.lookup(state, acm, "", collision));
+  state.setVariablePosition(0, 0.0);
+  EXPECT_TRUE(cache.lookup(state, acm, "", collision));
+  state.setVariablePosition(0, 0.1);
+  EXPECT_FALSE(cache.lookup(state, acm, "", collision));
+
+  cache.clear();
+  EXPECT_EQ(cache.size(), 0u);
+}
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
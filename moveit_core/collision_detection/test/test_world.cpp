@@ -365,6 +365,91 @@ TEST(World, TrackChanges)
   EXPECT_EQ(4, ta3.cnt_);
 }
 
+/* batch notification callback */
+static void TrackBatchChangesNotify(collision_detection::World::ObjectChanges* changes, int* cnt,
+                                    const collision_detection::World::ObjectChanges& batch)
+{
+  *changes = batch;
+  (*cnt)++;
+}
+
+TEST(World, BatchChanges)
+{
+  collision_detection::World world;
+
+  TestAction ta;
+  world.addObserver(boost::bind(TrackChangesNotify, &ta, _1, _2));
+
+  collision_detection::World::ObjectChanges changes;
+  int batch_cnt = 0;
+  TestAction ta_batch;
+  world.addObserver(boost::bind(TrackChangesNotify, &ta_batch, _1, _2),
+                    boost::bind(TrackBatchChangesNotify, &changes, &batch_cnt, _1));
+
+  shapes::ShapePtr ball(new shapes::Sphere(1.0));
+  shapes::ShapePtr box(new shapes::Box(1, 2, 3));
+  world.addToObject("obj1", ball, Eigen::Isometry3d::Identity());
+  world.addToObject("obj2", box, Eigen::Isometry3d::Identity());
+  EXPECT_EQ(2, ta.cnt_);
+  EXPECT_EQ(2, ta_batch.cnt_);
+  EXPECT_EQ(0, batch_cnt);
+
+  world.beginBatch();
+  world.moveShapeInObject("obj1", ball, Eigen::Isometry3d(Eigen::Translation3d(0, 0, 1)));
+  world.beginBatch();
+  world.addToObject("obj1", box, Eigen::Isometry3d::Identity());
+  world.addToObject("obj3", box, Eigen::Isometry3d::Identity());
+  world.commitBatch();
+  world.removeObject("obj3");  // never seen by the observers
+  world.removeObject("obj2");
+  world.addToObject("obj2", ball, Eigen::Isometry3d::Identity());
+  EXPECT_EQ(2, ta.cnt_);
+  EXPECT_EQ(0, batch_cnt);
+  world.commitBatch();
+
+  // the observer without batch callback gets the coalesced changes one by one
+  EXPECT_EQ(5, ta.cnt_);
+  EXPECT_EQ("obj2", ta.obj_.id_);
+  EXPECT_EQ(collision_detection::World::CREATE | collision_detection::World::ADD_SHAPE, ta.action_);
+  EXPECT_EQ(2, ta_batch.cnt_);
+
+  EXPECT_EQ(1, batch_cnt);
+  ASSERT_EQ(3u, changes.size());
+  EXPECT_EQ("obj1", changes[0].first->id_);
+  EXPECT_EQ(collision_detection::World::MOVE_SHAPE | collision_detection::World::ADD_SHAPE, changes[0].second);
+  EXPECT_EQ(2u, changes[0].first->shapes_.size());
+  EXPECT_EQ("obj2", changes[1].first->id_);
+  EXPECT_EQ(collision_detection::World::DESTROY, changes[1].second);
+  EXPECT_EQ("obj2", changes[2].first->id_);
+  EXPECT_EQ(collision_detection::World::CREATE | collision_detection::World::ADD_SHAPE, changes[2].second);
+
+  // an empty batch does not notify
+  world.beginBatch();
+  world.commitBatch();
+  EXPECT_EQ(1, batch_cnt);
+}
+
+TEST(World, MemoryUsage)
+{
+  collision_detection::World world;
+  EXPECT_EQ(0u, world.getMemoryUsage().total());
+
+  shapes::ShapePtr mesh(new shapes::Mesh(3, 1));
+  world.addToObject("mesh1", mesh, Eigen::Isometry3d::Identity());
+  collision_detection::World::MemoryUsage usage = world.getMemoryUsage();
+  EXPECT_EQ(sizeof(shapes::Mesh) + 3 * 3 * sizeof(double) + 3 * sizeof(unsigned int), usage.meshes);
+  EXPECT_EQ(0u, usage.octrees);
+  EXPECT_GT(usage.other, 0u);
+
+  // a shared mesh is only counted once
+  world.addToObject("mesh2", mesh, Eigen::Isometry3d::Identity());
+  EXPECT_EQ(usage.meshes, world.getMemoryUsage().meshes);
+  EXPECT_GT(world.getMemoryUsage().other, usage.other);
+
+  world.clearObjects();
+  EXPECT_EQ(0u, world.getMemoryUsage().total());
+}
+
 int main(int argc, char** argv)
 {
   testing::InitGoogleTest(&argc, argv);
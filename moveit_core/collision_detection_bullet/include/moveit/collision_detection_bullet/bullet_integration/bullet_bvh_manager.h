@@ -81,6 +81,12 @@ public:
    * @param pose The tranformation in world */
   void setCollisionObjectsTransform(const std::string& name, const Eigen::Isometry3d& pose);
 
+  /**@brief Move the shapes of an object rigidly, keeping its collision shape
+   * @param name The name of the object
+   * @param shape_poses The new poses of the shapes of the object in world
+   * @return false if the object does not exist or the relative poses of its shapes change */
+  bool moveCollisionObject(const std::string& name, const AlignedVector<Eigen::Isometry3d>& shape_poses);
+
   /**@brief Set which collision objects are active
    * @param names A vector of collision object names */
   void setActiveCollisionObjects(const std::vector<std::string>& names);
@@ -0,0 +1,113 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, PickNik LLC
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik LLC nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace collision_detection_bullet
+{
+/** @brief A pool of copies of a BVH manager, so that concurrent contact tests do not share a manager
+ *
+ * Managers are expensive to copy but cheap to update with new transforms. The pool therefore keeps the managers of
+ * finished contact tests and hands them out again, until the objects they were copied from change. */
+template <class Manager>
+class BulletBVHManagerPool
+{
+public:
+  using ManagerPtr = std::shared_ptr<Manager>;
+
+  BulletBVHManagerPool() : version_(0)
+  {
+  }
+
+  BulletBVHManagerPool(const BulletBVHManagerPool&) = delete;
+  BulletBVHManagerPool& operator=(const BulletBVHManagerPool&) = delete;
+
+  /** @brief Get a manager for exclusive use by the caller
+   *
+   * The manager is returned to the pool when the last copy of the returned pointer is destroyed. The pool must
+   * outlive it.
+   * @param create Function returning a new manager, called if no idle manager is available
+   * @return The manager, with the transforms of its last use */
+  template <class Create>
+  ManagerPtr acquire(const Create& create)
+  {
+    ManagerPtr manager;
+    std::size_t version;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      version = version_;
+      if (!idle_.empty())
+      {
+        manager = std::move(idle_.back());
+        idle_.pop_back();
+      }
+    }
+    if (!manager)
+      manager = create();
+
+    // the returned pointer shares ownership with a deleter that puts the manager back into the pool
+    Manager* raw = manager.get();
+    return ManagerPtr(raw, [this, manager, version](Manager*) mutable { release(std::move(manager), version); });
+  }
+
+  /** @brief Discard all managers, to be called when the objects they were created from change */
+  void invalidate()
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ++version_;
+    idle_.clear();
+  }
+
+private:
+  void release(ManagerPtr manager, std::size_t version)
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (version == version_)
+      idle_.push_back(std::move(manager));
+  }
+
+  std::mutex mutex_;
+
+  /** @brief Incremented on each invalidation, managers created for an older version are not reused */
+  std::size_t version_;
+
+  std::vector<ManagerPtr> idle_;
+};
+}  // namespace collision_detection_bullet
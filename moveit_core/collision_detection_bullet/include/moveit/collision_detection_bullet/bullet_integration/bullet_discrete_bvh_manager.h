@@ -67,5 +67,15 @@ public:
   /**@brief Add a bullet collision object to the manager
    *  @param cow The bullet collision object */
   void addCollisionObject(const CollisionObjectWrapperPtr& cow) override;
+
+private:
+  /**@brief Contact test for requests without contacts and distances
+   *
+   * The pairs are checked from the cheapest to the most expensive shapes, until the first collision. */
+  void booleanContactTest(collision_detection::CollisionResult& collisions,
+                          const collision_detection::AllowedCollisionMatrix* acm, bool self);
+
+  /** @brief The pairs to check in booleanContactTest(), with their cost, kept to reuse the memory */
+  std::vector<std::pair<int, btBroadphasePair*>> boolean_test_pairs_;
 };
 }  // namespace collision_detection_bullet
@@ -195,6 +195,12 @@ public:
                       [](const Eigen::Isometry3d& t1, const Eigen::Isometry3d& t2) { return t1.isApprox(t2); });
   }
 
+  /** @brief Move the shapes to \e shape_poses, only if they are moved rigidly.
+   *
+   *  The collision shape is shared with clones, so only the world transform of the object can be changed.
+   *  @return False if the relative poses of the shapes change */
+  bool setShapePoses(const AlignedVector<Eigen::Isometry3d>& shape_poses);
+
   /** @brief Get the collision objects axis aligned bounding box
    *  @param aabb_min The minimum point
    *  @param aabb_max The maximum point */
@@ -681,6 +687,35 @@ struct TesseractBroadphaseBridgedManifoldResult : public btManifoldResult
   }
 };
 
+/** @brief A manifold result that only records whether the objects penetrate, for requests without contacts and
+ *  distances */
+struct BooleanManifoldResult : public btManifoldResult
+{
+  bool collision{ false };
+
+  BooleanManifoldResult(const btCollisionObjectWrapper* obj0Wrap, const btCollisionObjectWrapper* obj1Wrap)
+    : btManifoldResult(obj0Wrap, obj1Wrap)
+  {
+  }
+
+  void addContactPoint(const btVector3& /*normalOnBInWorld*/, const btVector3& /*pointInWorld*/,
+                       btScalar depth) override
+  {
+    if (depth <= 0)
+      collision = true;
+  }
+};
+
+/** @brief Rough relative cost of a narrowphase check involving the shape: primitives, convex hulls, compounds */
+inline int getShapeCost(const btCollisionShape* shape)
+{
+  if (btBroadphaseProxy::isCompound(shape->getShapeType()))
+    return 2;
+  if (shape->getShapeType() == CONVEX_HULL_SHAPE_PROXYTYPE || btBroadphaseProxy::isConcave(shape->getShapeType()))
+    return 1;
+  return 0;
+}
+
 /** @brief A callback function that is called as part of the broadphase collision checking.
  *
  *  If the AABB of two collision objects are overlapping the processOverlap method is called and they are checked for
@@ -39,6 +39,7 @@
 #include <moveit/collision_detection/collision_env.h>
 #include <moveit/collision_detection_bullet/bullet_integration/bullet_discrete_bvh_manager.h>
 #include <moveit/collision_detection_bullet/bullet_integration/bullet_cast_bvh_manager.h>
+#include <moveit/collision_detection_bullet/bullet_integration/bullet_bvh_manager_pool.h>
 
 namespace collision_detection
 {
@@ -112,15 +113,28 @@ protected:
   /** \brief Construts a bullet collision object out of a robot link */
   void addLinkAsCollisionObject(const urdf::LinkSharedPtr& link);
 
-  /** \brief Handles self collision checks */
-  mutable collision_detection_bullet::BulletDiscreteBVHManagerPtr manager_{
+  /** \brief Holds the robot links and world objects, collision checks are performed on copies of it */
+  collision_detection_bullet::BulletDiscreteBVHManagerPtr manager_{
     new collision_detection_bullet::BulletDiscreteBVHManager()
   };
 
-  /** \brief Handles continuous robot world collision checks */
-  mutable collision_detection_bullet::BulletCastBVHManagerPtr manager_CCD_{
-    new collision_detection_bullet::BulletCastBVHManager()
-  };
+  /** \brief Copies of \e manager_ for discrete collision checks, one per concurrent check */
+  mutable collision_detection_bullet::BulletBVHManagerPool<collision_detection_bullet::BulletDiscreteBVHManager>
+      manager_pool_;
+
+  /** \brief Continuous collision managers with the objects of \e manager_, one per concurrent check */
+  mutable collision_detection_bullet::BulletBVHManagerPool<collision_detection_bullet::BulletCastBVHManager>
+      manager_CCD_pool_;
+
+  /** \brief Get a copy of \e manager_ for exclusive use during a discrete collision check */
+  collision_detection_bullet::BulletDiscreteBVHManagerPtr acquireManager() const;
+
+  /** \brief Get a continuous collision manager with the objects of \e manager_ for exclusive use during a check */
+  collision_detection_bullet::BulletCastBVHManagerPtr acquireManagerCCD() const;
+
+  /** \brief Creates a manager of type \e Manager holding copies of the objects of \e manager_ */
+  template <class Manager>
+  std::shared_ptr<Manager> copyManager() const;
 
   /** \brief Adds a world object to the collision managers */
   void addToManager(const World::Object* obj);
@@ -139,6 +153,9 @@ private:
   /** \brief Callback function executed for each change to the world environment */
   void notifyObjectChange(const ObjectConstPtr& obj, World::Action action);
 
+  /** \brief Callback function executed for the changes of a batch of world updates */
+  void notifyObjectsChange(const World::ObjectChanges& changes);
+
   World::ObserverHandle observer_handle_;
 };
 }  // namespace collision_detection
@@ -121,6 +121,17 @@ void BulletBVHManager::setCollisionObjectsTransform(const std::string& name, con
   }
 }
 
+bool BulletBVHManager::moveCollisionObject(const std::string& name, const AlignedVector<Eigen::Isometry3d>& shape_poses)
+{
+  auto it = link2cow_.find(name);
+  if (it == link2cow_.end() || !it->second->setShapePoses(shape_poses))
+    return false;
+
+  if (it->second->getBroadphaseHandle())
+    updateBroadphaseAABB(it->second, broadphase_, dispatcher_);
+  return true;
+}
+
 void BulletBVHManager::setActiveCollisionObjects(const std::vector<std::string>& names)
 {
   active_ = names;
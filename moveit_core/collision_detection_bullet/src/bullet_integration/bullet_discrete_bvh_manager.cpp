@@ -33,6 +33,8 @@
 
 #include "moveit/collision_detection_bullet/bullet_integration/bullet_discrete_bvh_manager.h"
 
+#include <algorithm>
+
 namespace collision_detection_bullet
 {
 BulletDiscreteBVHManagerPtr BulletDiscreteBVHManager::clone() const
@@ -61,6 +63,12 @@ void BulletDiscreteBVHManager::contactTest(collision_detection::CollisionResult&
                                            const collision_detection::CollisionRequest& req,
                                            const collision_detection::AllowedCollisionMatrix* acm, bool self)
 {
+  if (!req.contacts && !req.distance)
+  {
+    booleanContactTest(collisions, acm, self);
+    return;
+  }
+
   ContactTestData cdata(active_, contact_distance_, collisions, req);
 
   broadphase_->calculateOverlappingPairs(dispatcher_.get());
@@ -78,6 +86,54 @@ void BulletDiscreteBVHManager::contactTest(collision_detection::CollisionResult&
                                                            << " collisions");
 }
 
+void BulletDiscreteBVHManager::booleanContactTest(collision_detection::CollisionResult& collisions,
+                                                  const collision_detection::AllowedCollisionMatrix* acm, bool self)
+{
+  broadphase_->calculateOverlappingPairs(dispatcher_.get());
+  btBroadphasePairArray& pairs = broadphase_->getOverlappingPairCache()->getOverlappingPairArray();
+
+  boolean_test_pairs_.clear();
+  for (int i = 0; i < pairs.size(); ++i)
+  {
+    const CollisionObjectWrapper* cow0 = static_cast<const CollisionObjectWrapper*>(pairs[i].m_pProxy0->m_clientObject);
+    const CollisionObjectWrapper* cow1 = static_cast<const CollisionObjectWrapper*>(pairs[i].m_pProxy1->m_clientObject);
+    if ((self ? isOnlyKinematic(cow0, cow1) : !isOnlyKinematic(cow0, cow1)) &&
+        !acmCheck(cow0->getName(), cow1->getName(), acm))
+    {
+      const int cost = getShapeCost(cow0->getCollisionShape()) + getShapeCost(cow1->getCollisionShape());
+      boolean_test_pairs_.emplace_back(cost, &pairs[i]);
+    }
+  }
+  std::stable_sort(boolean_test_pairs_.begin(), boolean_test_pairs_.end(),
+                   [](const std::pair<int, btBroadphasePair*>& a, const std::pair<int, btBroadphasePair*>& b) {
+                     return a.first < b.first;
+                   });
+
+  for (const std::pair<int, btBroadphasePair*>& test_pair : boolean_test_pairs_)
+  {
+    btBroadphasePair& pair = *test_pair.second;
+    const CollisionObjectWrapper* cow0 = static_cast<const CollisionObjectWrapper*>(pair.m_pProxy0->m_clientObject);
+    const CollisionObjectWrapper* cow1 = static_cast<const CollisionObjectWrapper*>(pair.m_pProxy1->m_clientObject);
+    btCollisionObjectWrapper obj0_wrap(nullptr, cow0->getCollisionShape(), cow0, cow0->getWorldTransform(), -1, -1);
+    btCollisionObjectWrapper obj1_wrap(nullptr, cow1->getCollisionShape(), cow1, cow1->getWorldTransform(), -1, -1);
+
+    // dispatcher will keep algorithms persistent in the collision pair
+    if (!pair.m_algorithm)
+      pair.m_algorithm = dispatcher_->findAlgorithm(&obj0_wrap, &obj1_wrap, nullptr, BT_CLOSEST_POINT_ALGORITHMS);
+    if (!pair.m_algorithm)
+      continue;
+
+    BooleanManifoldResult result(&obj0_wrap, &obj1_wrap);
+    result.m_closestPointDistanceThreshold = static_cast<btScalar>(contact_distance_);
+    pair.m_algorithm->processCollision(&obj0_wrap, &obj1_wrap, dispatch_info_, &result);
+    if (result.collision)
+    {
+      collisions.collision = true;
+      break;
+    }
+  }
+}
+
 void BulletDiscreteBVHManager::addCollisionObject(const CollisionObjectWrapperPtr& cow)
 {
   link2cow_[cow->getName()] = cow;
@@ -350,4 +350,21 @@ CollisionObjectWrapper::CollisionObjectWrapper(const std::string& name, const co
   , m_data(data)
 {
 }
+
+bool CollisionObjectWrapper::setShapePoses(const AlignedVector<Eigen::Isometry3d>& shape_poses)
+{
+  if (shape_poses.size() != m_shape_poses.size() || shape_poses.empty())
+    return false;
+
+  // the children of a compound shape are placed relative to the first shape
+  const Eigen::Isometry3d old_inv_world = m_shape_poses[0].inverse();
+  const Eigen::Isometry3d new_inv_world = shape_poses[0].inverse();
+  for (std::size_t j = 1; j < shape_poses.size(); ++j)
+    if (!(old_inv_world * m_shape_poses[j]).isApprox(new_inv_world * shape_poses[j]))
+      return false;
+
+  m_shape_poses = shape_poses;
+  setWorldTransform(convertEigenToBt(m_shape_poses[0]));
+  return true;
+}
 }  // namespace collision_detection_bullet
@@ -51,7 +51,8 @@ CollisionEnvBullet::CollisionEnvBullet(const moveit::core::RobotModelConstPtr& m
   : CollisionEnv(model, padding, scale)
 {
   // request notifications about changes to new world
-  observer_handle_ = getWorld()->addObserver(boost::bind(&CollisionEnvBullet::notifyObjectChange, this, _1, _2));
+  observer_handle_ = getWorld()->addObserver(boost::bind(&CollisionEnvBullet::notifyObjectChange, this, _1, _2),
+                                             boost::bind(&CollisionEnvBullet::notifyObjectsChange, this, _1));
 
   for (const std::pair<const std::string, urdf::LinkSharedPtr>& link : robot_model_->getURDF()->links_)
   {
@@ -64,7 +65,8 @@ CollisionEnvBullet::CollisionEnvBullet(const moveit::core::RobotModelConstPtr& m
   : CollisionEnv(model, world, padding, scale)
 {
   // request notifications about changes to new world
-  observer_handle_ = getWorld()->addObserver(boost::bind(&CollisionEnvBullet::notifyObjectChange, this, _1, _2));
+  observer_handle_ = getWorld()->addObserver(boost::bind(&CollisionEnvBullet::notifyObjectChange, this, _1, _2),
+                                             boost::bind(&CollisionEnvBullet::notifyObjectsChange, this, _1));
 
   for (const std::pair<const std::string, urdf::LinkSharedPtr>& link : robot_model_->getURDF()->links_)
   {
@@ -80,7 +82,8 @@ CollisionEnvBullet::CollisionEnvBullet(const CollisionEnvBullet& other, const Wo
   // TODO(j-petit): Verify this constructor
 
   // request notifications about changes to new world
-  observer_handle_ = getWorld()->addObserver(boost::bind(&CollisionEnvBullet::notifyObjectChange, this, _1, _2));
+  observer_handle_ = getWorld()->addObserver(boost::bind(&CollisionEnvBullet::notifyObjectChange, this, _1, _2),
+                                             boost::bind(&CollisionEnvBullet::notifyObjectsChange, this, _1));
 
   for (const std::pair<const std::string, urdf::LinkSharedPtr>& link : other.robot_model_->getURDF()->links_)
   {
@@ -113,29 +116,35 @@ void CollisionEnvBullet::checkSelfCollisionHelper(const CollisionRequest& req, C
   std::vector<collision_detection_bullet::CollisionObjectWrapperPtr> cows;
   addAttachedOjects(state, cows);
 
+  collision_detection_bullet::BulletDiscreteBVHManagerPtr manager = acquireManager();
   if (req.distance)
   {
-    manager_->setContactDistanceThreshold(MAX_DISTANCE_MARGIN);
+    manager->setContactDistanceThreshold(MAX_DISTANCE_MARGIN);
   }
 
   for (const collision_detection_bullet::CollisionObjectWrapperPtr& cow : cows)
   {
-    manager_->addCollisionObject(cow);
-    manager_->setCollisionObjectsTransform(
+    manager->addCollisionObject(cow);
+    manager->setCollisionObjectsTransform(
         cow->getName(), state.getAttachedBody(cow->getName())->getGlobalCollisionBodyTransforms()[0]);
   }
 
   // updating link positions with the current robot state
   for (const std::string& link : active_)
   {
-    manager_->setCollisionObjectsTransform(link, state.getCollisionBodyTransform(link, 0));
+    manager->setCollisionObjectsTransform(link, state.getCollisionBodyTransform(link, 0));
   }
 
-  manager_->contactTest(res, req, acm, true);
+  manager->contactTest(res, req, acm, true);
 
   for (const collision_detection_bullet::CollisionObjectWrapperPtr& cow : cows)
   {
-    manager_->removeCollisionObject(cow->getName());
+    manager->removeCollisionObject(cow->getName());
+  }
+
+  if (req.distance)
+  {
+    manager->setContactDistanceThreshold(manager_->getContactDistanceThreshold());
   }
 }
 
@@ -171,27 +180,33 @@ void CollisionEnvBullet::checkRobotCollisionHelper(const CollisionRequest& req,
                                                    const moveit::core::RobotState& state,
                                                    const AllowedCollisionMatrix* acm) const
 {
+  collision_detection_bullet::BulletDiscreteBVHManagerPtr manager = acquireManager();
   if (req.distance)
   {
-    manager_->setContactDistanceThreshold(MAX_DISTANCE_MARGIN);
+    manager->setContactDistanceThreshold(MAX_DISTANCE_MARGIN);
   }
 
   std::vector<collision_detection_bullet::CollisionObjectWrapperPtr> attached_cows;
   addAttachedOjects(state, attached_cows);
-  updateTransformsFromState(state, manager_);
+  updateTransformsFromState(state, manager);
 
   for (const collision_detection_bullet::CollisionObjectWrapperPtr& cow : attached_cows)
   {
-    manager_->addCollisionObject(cow);
-    manager_->setCollisionObjectsTransform(
+    manager->addCollisionObject(cow);
+    manager->setCollisionObjectsTransform(
         cow->getName(), state.getAttachedBody(cow->getName())->getGlobalCollisionBodyTransforms()[0]);
   }
 
-  manager_->contactTest(res, req, acm, false);
+  manager->contactTest(res, req, acm, false);
 
   for (const collision_detection_bullet::CollisionObjectWrapperPtr& cow : attached_cows)
   {
-    manager_->removeCollisionObject(cow->getName());
+    manager->removeCollisionObject(cow->getName());
+  }
+
+  if (req.distance)
+  {
+    manager->setContactDistanceThreshold(manager_->getContactDistanceThreshold());
   }
 }
 
@@ -203,28 +218,54 @@ void CollisionEnvBullet::checkRobotCollisionHelperCCD(const CollisionRequest& re
   std::vector<collision_detection_bullet::CollisionObjectWrapperPtr> attached_cows;
   addAttachedOjects(state1, attached_cows);
 
+  collision_detection_bullet::BulletCastBVHManagerPtr manager = acquireManagerCCD();
   for (const collision_detection_bullet::CollisionObjectWrapperPtr& cow : attached_cows)
   {
-    manager_CCD_->addCollisionObject(cow);
-    manager_CCD_->setCastCollisionObjectsTransform(
+    manager->addCollisionObject(cow);
+    manager->setCastCollisionObjectsTransform(
         cow->getName(), state1.getAttachedBody(cow->getName())->getGlobalCollisionBodyTransforms()[0],
         state2.getAttachedBody(cow->getName())->getGlobalCollisionBodyTransforms()[0]);
   }
 
   for (const std::string& link : active_)
   {
-    manager_CCD_->setCastCollisionObjectsTransform(link, state1.getCollisionBodyTransform(link, 0),
-                                                   state2.getCollisionBodyTransform(link, 0));
+    manager->setCastCollisionObjectsTransform(link, state1.getCollisionBodyTransform(link, 0),
+                                              state2.getCollisionBodyTransform(link, 0));
   }
 
-  manager_CCD_->contactTest(res, req, acm, false);
+  manager->contactTest(res, req, acm, false);
 
   for (const collision_detection_bullet::CollisionObjectWrapperPtr& cow : attached_cows)
   {
-    manager_CCD_->removeCollisionObject(cow->getName());
+    manager->removeCollisionObject(cow->getName());
   }
 }
 
+collision_detection_bullet::BulletDiscreteBVHManagerPtr CollisionEnvBullet::acquireManager() const
+{
+  return manager_pool_.acquire(
+      [this] { return copyManager<collision_detection_bullet::BulletDiscreteBVHManager>(); });
+}
+
+collision_detection_bullet::BulletCastBVHManagerPtr CollisionEnvBullet::acquireManagerCCD() const
+{
+  return manager_CCD_pool_.acquire(
+      [this] { return copyManager<collision_detection_bullet::BulletCastBVHManager>(); });
+}
+
+template <class Manager>
+std::shared_ptr<Manager> CollisionEnvBullet::copyManager() const
+{
+  // BulletBVHManager::clone() would reset the collision filters of the objects, and the cast manager creates its own
+  // cast shapes of the robot links, so the objects are added one by one
+  std::shared_ptr<Manager> manager(new Manager());
+  for (const std::pair<const std::string, collision_detection_bullet::CollisionObjectWrapperPtr>& cow :
+       manager_->getCollisionObjects())
+    manager->addCollisionObject(cow.second->clone());
+  manager->setContactDistanceThreshold(manager_->getContactDistanceThreshold());
+  return manager;
+}
+
 void CollisionEnvBullet::distanceSelf(const DistanceRequest& req, DistanceResult& res,
                                       const moveit::core::RobotState& state) const
 {
@@ -254,7 +295,6 @@ void CollisionEnvBullet::addToManager(const World::Object* obj)
       false));
 
   manager_->addCollisionObject(cow);
-  manager_CCD_->addCollisionObject(cow->clone());
 }
 
 void CollisionEnvBullet::updateManagedObject(const std::string& id)
@@ -265,7 +305,6 @@ void CollisionEnvBullet::updateManagedObject(const std::string& id)
     if (manager_->hasCollisionObject(id))
     {
       manager_->removeCollisionObject(id);
-      manager_CCD_->removeCollisionObject(id);
       addToManager(it->second.get());
     }
     else
@@ -278,7 +317,6 @@ void CollisionEnvBullet::updateManagedObject(const std::string& id)
     if (manager_->hasCollisionObject(id))
     {
       manager_->removeCollisionObject(id);
-      manager_CCD_->removeCollisionObject(id);
     }
   }
 }
@@ -294,7 +332,8 @@ void CollisionEnvBullet::setWorld(const WorldPtr& world)
   CollisionEnv::setWorld(world);
 
   // request notifications about changes to new world
-  observer_handle_ = getWorld()->addObserver(boost::bind(&CollisionEnvBullet::notifyObjectChange, this, _1, _2));
+  observer_handle_ = getWorld()->addObserver(boost::bind(&CollisionEnvBullet::notifyObjectChange, this, _1, _2),
+                                             boost::bind(&CollisionEnvBullet::notifyObjectsChange, this, _1));
 
   // get notifications any objects already in the new world
   getWorld()->notifyObserverAllObjects(observer_handle_, World::CREATE);
@@ -305,12 +344,28 @@ void CollisionEnvBullet::notifyObjectChange(const ObjectConstPtr& obj, World::Ac
   if (action == World::DESTROY)
   {
     manager_->removeCollisionObject(obj->id_);
-    manager_CCD_->removeCollisionObject(obj->id_);
   }
-  else
+  else if (action != World::MOVE_SHAPE || !manager_->moveCollisionObject(obj->id_, obj->shape_poses_))
   {
     updateManagedObject(obj->id_);
   }
+  manager_pool_.invalidate();
+  manager_CCD_pool_.invalidate();
+}
+
+void CollisionEnvBullet::notifyObjectsChange(const World::ObjectChanges& changes)
+{
+  for (const std::pair<World::ObjectConstPtr, World::Action>& change : changes)
+  {
+    if (change.second == World::DESTROY)
+      manager_->removeCollisionObject(change.first->id_);
+    else if (change.second != World::MOVE_SHAPE ||
+             !manager_->moveCollisionObject(change.first->id_, change.first->shape_poses_))
+      updateManagedObject(change.first->id_);
+  }
+  // the pooled managers are copied from manager_ only once for the whole batch
+  manager_pool_.invalidate();
+  manager_CCD_pool_.invalidate();
 }
 
 void CollisionEnvBullet::addAttachedOjects(const moveit::core::RobotState& state,
@@ -410,7 +465,6 @@ void CollisionEnvBullet::addLinkAsCollisionObject(const urdf::LinkSharedPtr& lin
     if (manager_->hasCollisionObject(link->name))
     {
       manager_->removeCollisionObject(link->name);
-      manager_CCD_->removeCollisionObject(link->name);
     }
 
     try
@@ -418,13 +472,14 @@ void CollisionEnvBullet::addLinkAsCollisionObject(const urdf::LinkSharedPtr& lin
       collision_detection_bullet::CollisionObjectWrapperPtr cow(new collision_detection_bullet::CollisionObjectWrapper(
           link->name, collision_detection::BodyType::ROBOT_LINK, shapes, shape_poses, collision_object_types, true));
       manager_->addCollisionObject(cow);
-      manager_CCD_->addCollisionObject(cow->clone());
       active_.push_back(cow->getName());
     }
     catch (std::exception&)
     {
       RCLCPP_ERROR_STREAM(LOGGER, "Not adding " << link->name << " due to bad arguments.");
     }
+    manager_pool_.invalidate();
+    manager_CCD_pool_.invalidate();
   }
 }
 
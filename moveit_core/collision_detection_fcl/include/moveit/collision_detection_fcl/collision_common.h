@@ -52,8 +52,11 @@
 #include <fcl/distance.h>
 #endif
 
+#include <atomic>
+#include <cstdint>
 #include <memory>
 #include <set>
+#include <vector>
 
 namespace collision_detection
 {
@@ -112,6 +115,20 @@ struct CollisionGeometryData
     return "Object";
   }
 
+  /** \brief Returns the index of getID() in \e acm. The index is cached for the version of \e acm, so that collision
+   *  callbacks do not look up names. */
+  int getAllowedCollisionMatrixIndex(const CompiledAllowedCollisionMatrix& acm) const
+  {
+    // the upper 40 bits hold the matrix version plus one, the lower 24 bits the index plus one
+    const std::uint64_t tag = (acm.getVersion() + 1) << 24;
+    const std::uint64_t cached = acm_index_cache.load(std::memory_order_relaxed);
+    if ((cached & ~ACM_INDEX_MASK) == tag)
+      return static_cast<int>(cached & ACM_INDEX_MASK) - 1;
+    const int index = acm.getIndex(getID());
+    acm_index_cache.store(tag | static_cast<std::uint64_t>(index + 1), std::memory_order_relaxed);
+    return index;
+  }
+
   /** \brief Check if two CollisionGeometryData objects point to the same source object. */
   bool sameObject(const CollisionGeometryData& other) const
   {
@@ -135,17 +152,29 @@ struct CollisionGeometryData
     const World::Object* obj;
     const void* raw;
   } ptr;
+
+  /** \brief The index of this body in a compiled allowed collision matrix, see getAllowedCollisionMatrixIndex(). */
+  mutable std::atomic<std::uint64_t> acm_index_cache{ 0 };
+
+  static const std::uint64_t ACM_INDEX_MASK = 0xFFFFFF;
 };
 
 /** \brief Data structure which is passed to the collision callback function of the collision manager. */
 struct CollisionData
 {
-  CollisionData() : req_(nullptr), active_components_only_(nullptr), res_(nullptr), acm_(nullptr), done_(false)
+  CollisionData()
+    : req_(nullptr), active_components_only_(nullptr), culling_(nullptr), res_(nullptr), acm_(nullptr), done_(false)
   {
   }
 
   CollisionData(const CollisionRequest* req, CollisionResult* res, const AllowedCollisionMatrix* acm)
-    : req_(req), active_components_only_(nullptr), res_(res), acm_(acm), done_(false)
+    : req_(req)
+    , active_components_only_(nullptr)
+    , culling_(nullptr)
+    , res_(res)
+    , acm_(acm)
+    , compiled_acm_(acm ? acm->getCompiled() : nullptr)
+    , done_(false)
   {
   }
 
@@ -156,6 +185,9 @@ struct CollisionData
   /** \brief Compute \e active_components_only_ based on the joint group specified in \e req_ */
   void enableGroup(const moveit::core::RobotModelConstPtr& robot_model);
 
+  /** \brief Set \e culling_ to the culling bounds of \e req_, if they are valid for \e state */
+  void enableCulling(const moveit::core::RobotState& state);
+
   /** \brief The collision request passed by the user */
   const CollisionRequest* req_;
 
@@ -165,20 +197,40 @@ struct CollisionData
    *  If the pointer is NULL, all collisions are considered. */
   const std::set<const moveit::core::LinkModel*>* active_components_only_;
 
+  /** \brief The culling bounds of the request, if they apply to the checked state. Pairs they rule out are skipped.
+   *
+   *  If the pointer is NULL, no pairs are culled. */
+  const GroupCollisionCulling* culling_;
+
   /** \brief The user-specified response location. */
   CollisionResult* res_;
 
   /** \brief The user-specified collision matrix (may be NULL). */
   const AllowedCollisionMatrix* acm_;
 
+  /** \brief The compiled version of \e acm_, for fast lookups (NULL if \e acm_ is). */
+  CompiledAllowedCollisionMatrixConstPtr compiled_acm_;
+
   /** \brief Flag indicating whether collision checking is complete. */
   bool done_;
+
+  /** \brief A pair of objects whose narrowphase check was deferred by booleanCollisionCallback() */
+  struct DeferredPair
+  {
+    int cost;
+    fcl::CollisionObjectd* o1;
+    fcl::CollisionObjectd* o2;
+  };
+
+  /** \brief The pairs deferred by booleanCollisionCallback(), see checkDeferredCollisionPairs(). */
+  std::vector<DeferredPair> deferred_pairs_;
 };
 
 /** \brief Data structure which is passed to the distance callback function of the collision manager. */
 struct DistanceData
 {
-  DistanceData(const DistanceRequest* req, DistanceResult* res) : req(req), res(res), done(false)
+  DistanceData(const DistanceRequest* req, DistanceResult* res)
+    : req(req), res(res), compiled_acm(req->acm ? req->acm->getCompiled() : nullptr), done(false)
   {
   }
   ~DistanceData()
@@ -191,6 +243,9 @@ struct DistanceData
   /** \brief Distance query results information. */
   DistanceResult* res;
 
+  /** \brief The compiled version of the collision matrix of \e req, for fast lookups (may be NULL). */
+  CompiledAllowedCollisionMatrixConstPtr compiled_acm;
+
   /** \brief Indicates if distance query is finished. */
   bool done;
 };
@@ -277,6 +332,28 @@ struct FCLManager
  *   \return True terminates the distance check, false continues it to the next pair of objects */
 bool collisionCallback(fcl::CollisionObjectd* o1, fcl::CollisionObjectd* o2, void* data);
 
+/** \brief Whether \e req only asks if there is a collision, so that booleanCollisionCallback() can be used. */
+inline bool isBooleanCollisionRequest(const CollisionRequest& req)
+{
+  return !req.contacts && !req.distance && !req.cost && !req.verbose && !req.is_done;
+}
+
+/** \brief Callback function used by the FCLManager for requests that only ask if there is a collision (see
+ *   isBooleanCollisionRequest()).
+ *
+ *   Pairs of primitive shapes are checked right away. Pairs involving meshes or octrees are only added to
+ *   CollisionData::deferred_pairs_, checkDeferredCollisionPairs() needs to be called after the broadphase traversal.
+ *   Both stop at the first collision.
+ *
+ *   \param o1 First FCL collision object
+ *   \param o2 Second FCL collision object
+ *   \data Pointer to the CollisionData of the request
+ *   \return True terminates the collision check, false continues it to the next pair of objects */
+bool booleanCollisionCallback(fcl::CollisionObjectd* o1, fcl::CollisionObjectd* o2, void* data);
+
+/** \brief Checks the pairs deferred by booleanCollisionCallback(), cheapest first, until a collision is found. */
+void checkDeferredCollisionPairs(CollisionData& data);
+
 /** \brief Callback function used by the FCLManager used for each pair of collision objects to
  *   calculate collisions and distances.
  *
@@ -314,6 +391,19 @@ FCLGeometryConstPtr createCollisionGeometry(const shapes::ShapeConstPtr& shape,
 /** \brief Increases the counter of the caches which can trigger the cleaning of expired entries from them. */
 void cleanCollisionGeometryCache();
 
+/** \brief Set the maximum total number of triangles of the BVH models kept in the process-wide mesh cache.
+ *
+ *  Meshes with the same vertices and triangles as a cached one reuse its BVH instead of building a new one. Each
+ *  triangle takes about 0.5 KB in the cache. Zero disables the cache. */
+void setCollisionGeometryMeshCacheSize(std::size_t max_triangles);
+
+/** \brief Estimate the memory (in bytes) held by the BVH models of the process-wide mesh cache */
+std::size_t getCollisionGeometryMeshCacheMemoryUsage();
+
+/** \brief Estimate the memory (in bytes) held by \e geometry. For BVH models this is the size of the vertices,
+ *  triangles and bounding volumes, octrees do not own their nodes and only count the wrapper. */
+std::size_t getCollisionGeometryMemoryUsage(const FCLGeometry& geometry);
+
 /** \brief Transforms an Eigen Isometry3d to FCL coordinate transformation */
 inline void transform2fcl(const Eigen::Isometry3d& b, fcl::Transform3d& f)
 {
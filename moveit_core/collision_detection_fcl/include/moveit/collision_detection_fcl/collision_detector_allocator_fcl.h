@@ -47,5 +47,40 @@ class CollisionDetectorAllocatorFCL
 {
 public:
   static const std::string NAME;  // defined in collision_env_fcl.cpp
+
+  CollisionDetectorAllocatorFCL() = default;
+
+  /** \brief An allocator of environments that use the broadphase collision managers of \e config */
+  explicit CollisionDetectorAllocatorFCL(const FCLBroadPhaseConfig& config) : broadphase_config_(config)
+  {
+  }
+
+  using CollisionDetectorAllocatorTemplate<CollisionEnvFCL, CollisionDetectorAllocatorFCL>::create;
+
+  /** Create an allocator for collision detectors that use the broadphase collision managers of \e config. */
+  static CollisionDetectorAllocatorPtr create(const FCLBroadPhaseConfig& config)
+  {
+    return std::make_shared<CollisionDetectorAllocatorFCL>(config);
+  }
+
+  // copies keep the broadphase configuration of the original
+  using CollisionDetectorAllocatorTemplate<CollisionEnvFCL, CollisionDetectorAllocatorFCL>::allocateEnv;
+
+  CollisionEnvPtr allocateEnv(const WorldPtr& world, const moveit::core::RobotModelConstPtr& robot_model) const override
+  {
+    auto env = std::make_shared<CollisionEnvFCL>(robot_model, world);
+    env->setBroadPhaseConfig(broadphase_config_);
+    return env;
+  }
+
+  CollisionEnvPtr allocateEnv(const moveit::core::RobotModelConstPtr& robot_model) const override
+  {
+    auto env = std::make_shared<CollisionEnvFCL>(robot_model);
+    env->setBroadPhaseConfig(broadphase_config_);
+    return env;
+  }
+
+private:
+  FCLBroadPhaseConfig broadphase_config_;
 };
 }  // namespace collision_detection
@@ -45,5 +45,13 @@ class CollisionDetectorFCLPluginLoader : public CollisionPlugin
 {
 public:
   bool initialize(const planning_scene::PlanningScenePtr& scene, bool exclusive) const override;
+
+  /** \brief Initialize with the broadphase collision managers selected by the parameters
+   *  collision_detector_fcl.world_broadphase and collision_detector_fcl.self_broadphase (see
+   *  FCLBroadPhaseTypes::fromString()), and the spatial hashing parameters
+   *  collision_detector_fcl.spatial_hashing_cell_size, collision_detector_fcl.spatial_hashing_scene_min and
+   *  collision_detector_fcl.spatial_hashing_scene_max */
+  bool initialize(const rclcpp::Node::SharedPtr& node, const planning_scene::PlanningScenePtr& scene,
+                  bool exclusive) const override;
 };
 }  // namespace collision_detection
@@ -46,9 +46,55 @@
 #endif
 
 #include <memory>
+#include <mutex>
+#include <string>
 
 namespace collision_detection
 {
+/** \brief The broadphase collision managers of FCL a CollisionEnvFCL can use */
+namespace FCLBroadPhaseTypes
+{
+enum Type
+{
+  /** \brief A bounding volume hierarchy that is updated incrementally as objects are added, moved and removed */
+  DYNAMIC_AABB_TREE,
+
+  /** \brief A bounding volume hierarchy in a flat array that is rebuilt after every change of the world. Fast queries
+   * for worlds that rarely change */
+  STATIC_AABB_TREE,
+
+  /** \brief Sorted lists of the AABB bounds along each axis */
+  SWEEP_AND_PRUNE,
+
+  /** \brief A hash grid of uniform cells, for many objects of similar size */
+  SPATIAL_HASHING
+};
+
+/** \brief Get the type named \e name ("dynamic_aabb_tree", "static_aabb_tree", "sweep_and_prune" or
+ * "spatial_hashing"). Return false if there is no such type */
+bool fromString(const std::string& name, Type& type);
+
+/** \brief The name of \e type, as accepted by fromString() */
+std::string toString(Type type);
+}  // namespace FCLBroadPhaseTypes
+
+/** \brief The broadphase collision managers of a CollisionEnvFCL */
+struct FCLBroadPhaseConfig
+{
+  /** \brief The broadphase of the world objects */
+  FCLBroadPhaseTypes::Type world_type = FCLBroadPhaseTypes::DYNAMIC_AABB_TREE;
+
+  /** \brief The broadphase of the robot links in self-collision checks */
+  FCLBroadPhaseTypes::Type self_type = FCLBroadPhaseTypes::DYNAMIC_AABB_TREE;
+
+  /** \brief The edge length of the cells of spatial hashing, in meters */
+  double spatial_hashing_cell_size = 0.1;
+
+  /** \brief The volume spatial hashing divides into cells. Objects outside of it are checked against all others */
+  Eigen::Vector3d spatial_hashing_scene_min = Eigen::Vector3d::Constant(-5.0);
+  Eigen::Vector3d spatial_hashing_scene_max = Eigen::Vector3d::Constant(5.0);
+};
+
 /** \brief FCL implementation of the CollisionEnv */
 class CollisionEnvFCL : public CollisionEnv
 {
@@ -88,8 +134,27 @@ public:
   void distanceRobot(const DistanceRequest& req, DistanceResult& res,
                      const moveit::core::RobotState& state) const override;
 
+  void distanceSelfBatch(const DistanceRequest& req, std::vector<DistanceResult>& res,
+                         const std::vector<const moveit::core::RobotState*>& states) const override;
+
+  void distanceRobotBatch(const DistanceRequest& req, std::vector<DistanceResult>& res,
+                          const std::vector<const moveit::core::RobotState*>& states) const override;
+
   void setWorld(const WorldPtr& world) override;
 
+  /** \brief The FCL geometry of the robot links (for every padding profile) and world objects, the collision objects
+   *   and the broadphase managers. The process-wide mesh cache is not included, see
+   *   getCollisionGeometryMeshCacheMemoryUsage(). */
+  std::size_t getMemoryUsage() const override;
+
+  /** \brief Select the broadphase collision managers. The world objects are registered to a new manager */
+  void setBroadPhaseConfig(const FCLBroadPhaseConfig& config);
+
+  const FCLBroadPhaseConfig& getBroadPhaseConfig() const
+  {
+    return broadphase_config_;
+  }
+
 protected:
   /** \brief Updates the FCL collision geometry and objects saved in the CollisionRobotFCL members to reflect a new
    *   padding or scaling of the robot links.
@@ -100,6 +165,43 @@ protected:
    *   \param links The names of the links which have been updated in the robot model */
   void updatedPaddingOrScaling(const std::vector<std::string>& links) override;
 
+  /** \brief Creates, updates or removes the FCL collision geometry of the padding profile \e name */
+  void updatedPaddingProfile(const std::string& name) override;
+
+  /** \brief Broadphase manager holding persistent FCL objects for all robot links, for incremental self-collision
+   *   checks */
+  struct SelfCollisionBroadPhase
+  {
+    FCLManager manager_;
+
+    /** \brief Index into RobotGeometry::geoms_ of each entry in manager_.object_.collision_objects_ */
+    std::vector<std::size_t> geom_indices_;
+  };
+
+  /** \brief The FCL collision geometry of the robot links for one padding, indexed like the collision bodies of
+   *   RobotState, with the self-collision broadphase managers using it */
+  struct RobotGeometry
+  {
+    /** \brief Vector of shared pointers to the FCL geometry for the objects in fcl_objs_. */
+    std::vector<FCLGeometryConstPtr> geoms_;
+
+    /** \brief Vector of shared pointers to the FCL collision objects which make up the robot */
+    std::vector<FCLCollisionObjectConstPtr> fcl_objs_;
+
+    /// Pool of self-collision broadphase managers, one is in use per concurrent self-collision check
+    mutable std::vector<std::unique_ptr<SelfCollisionBroadPhase>> self_collision_broadphases_;
+    mutable std::mutex self_collision_broadphases_lock_;
+  };
+
+  /** \brief Recreate the FCL collision geometry of the shapes of \e links in \e geometry, padded as given by the
+   *   padding profile \e padding_profile, and empty its pool of self-collision broadphase managers */
+  void updateRobotGeometry(const std::vector<const moveit::core::LinkModel*>& links,
+                           const std::string& padding_profile, RobotGeometry& geometry) const;
+
+  /** \brief Get the robot geometry of the padding profile \e padding_profile, or the one with the link padding of this
+   *   environment if the name is empty or there is no such profile */
+  const RobotGeometry& getRobotGeometry(const std::string& padding_profile) const;
+
   /** \brief Bundles the different checkSelfCollision functions into a single function */
   void checkSelfCollisionHelper(const CollisionRequest& req, CollisionResult& res,
                                 const moveit::core::RobotState& state, const AllowedCollisionMatrix* acm) const;
@@ -108,6 +210,21 @@ protected:
   void checkRobotCollisionHelper(const CollisionRequest& req, CollisionResult& res,
                                  const moveit::core::RobotState& state, const AllowedCollisionMatrix* acm) const;
 
+  /** \brief Continuous collision check of the robot moving linearly (per collision body) from \e state1 to \e state2
+   *   against the world.
+   *
+   *   Candidate pairs are selected by an enlarged swept AABB; each candidate is checked with FCL's continuous collision
+   *   solver and, if a collision is found, evaluated at the first colliding pose like a discrete check. */
+  void checkRobotCollisionHelperCCD(const CollisionRequest& req, CollisionResult& res,
+                                    const moveit::core::RobotState& state1, const moveit::core::RobotState& state2,
+                                    const AllowedCollisionMatrix* acm) const;
+
+  /** \brief Create an empty broadphase collision manager of \e type, configured by \m broadphase_config_ */
+  std::unique_ptr<fcl::BroadPhaseCollisionManagerd> createBroadPhase(FCLBroadPhaseTypes::Type type) const;
+
+  /** \brief Register all FCL objects of the world to \m manager_, which must be empty */
+  void registerWorldObjects();
+
   /** \brief Construct an FCL collision object from MoveIt's World::Object. */
   void constructFCLObjectWorld(const World::Object* obj, FCLObject& fcl_obj) const;
 
@@ -116,20 +233,54 @@ protected:
    *  If it does not exist in world, it is deleted. If it's not existing in \m fcl_objs_ yet, it's added there. */
   void updateFCLObject(const std::string& id);
 
+  /** \brief Updates the transforms of the FCL objects of \e obj and their bounding boxes in the manager, keeping the
+   *  geometry. Returns false if \e obj is not in \m fcl_objs_ or not all of its shapes have FCL objects. */
+  bool moveFCLObject(const World::Object* obj);
+
   /** \brief Out of the current robot state and its attached bodies construct an FCLObject which can then be used to
    *   check for collision.
    *
    *   The current state is used to recalculate the AABB of the FCL collision objects. However they are not computed from
    *   scratch (which would require call to computeLocalAABB()) but are only transformed according to the joint states.
    *
+   *   \param geometry The robot geometry to use
    *   \param state The current robot state
    *   \param fcl_obj The newly filled object */
-  void constructFCLObjectRobot(const moveit::core::RobotState& state, FCLObject& fcl_obj) const;
+  void constructFCLObjectRobot(const RobotGeometry& geometry, const moveit::core::RobotState& state,
+                               FCLObject& fcl_obj) const;
+
+  /** \brief Construct the FCL collision objects of the bodies attached to \e state and append them to \e fcl_obj */
+  void constructFCLObjectAttachedBodies(const moveit::core::RobotState& state, FCLObject& fcl_obj) const;
 
   /** \brief Prepares for the collision check through constructing an FCL collision object out of the current robot
    *   state and specifying a broadphase collision manager of FCL where the constructed object is registered to. */
   void allocSelfCollisionBroadPhase(const moveit::core::RobotState& state, FCLManager& manager) const;
 
+  /** \brief Take a self-collision broadphase manager from the pool of \e geometry (or create one) and update it to
+   *   \e state.
+   *
+   *   Instead of reconstructing all collision objects and the AABB tree for every check, the transforms of the
+   *   already registered link objects are updated and the tree is refit. The bodies attached to \e state are
+   *   registered in \e attached and need to be passed to releaseSelfCollisionBroadPhase(). */
+  std::unique_ptr<SelfCollisionBroadPhase> acquireSelfCollisionBroadPhase(const RobotGeometry& geometry,
+                                                                          const moveit::core::RobotState& state,
+                                                                          FCLObject& attached) const;
+
+  /** \brief Move the link objects of \e broadphase to \e state and register the bodies attached to \e state in
+   *   \e attached, which must not be registered to \e broadphase anymore. */
+  void updateSelfCollisionBroadPhase(const RobotGeometry& geometry, const moveit::core::RobotState& state,
+                                     SelfCollisionBroadPhase& broadphase, FCLObject& attached) const;
+
+  /** \brief Set the transforms of the first geom_indices.size() entries of \e objects, which are the link objects
+   *   for the entries of \e geometry given by \e geom_indices, to the link poses in \e state. */
+  void updateFCLObjectRobotLinks(const RobotGeometry& geometry, const moveit::core::RobotState& state,
+                                 const std::vector<std::size_t>& geom_indices,
+                                 std::vector<FCLCollisionObjectPtr>& objects) const;
+
+  /** \brief Unregister the attached bodies and return \e broadphase to the pool of \e geometry */
+  void releaseSelfCollisionBroadPhase(const RobotGeometry& geometry,
+                                      std::unique_ptr<SelfCollisionBroadPhase> broadphase, FCLObject& attached) const;
+
   /** \brief Converts all shapes which make up an atttached body into a vector of FCLGeometryConstPtr.
    *
    *   When they are converted, they can be added to the FCL representation of the robot for collision checking.
@@ -139,11 +290,14 @@ protected:
    */
   void getAttachedBodyObjects(const moveit::core::AttachedBody* ab, std::vector<FCLGeometryConstPtr>& geoms) const;
 
-  /** \brief Vector of shared pointers to the FCL geometry for the objects in fcl_objs_. */
-  std::vector<FCLGeometryConstPtr> robot_geoms_;
+  /** \brief The FCL collision geometry of the robot with the link padding of this environment */
+  RobotGeometry robot_geometry_;
+
+  /** \brief The FCL collision geometry of the robot for each padding profile */
+  std::map<std::string, std::unique_ptr<RobotGeometry>> padding_profile_geometry_;
 
-  /** \brief Vector of shared pointers to the FCL collision objects which make up the robot */
-  std::vector<FCLCollisionObjectConstPtr> robot_fcl_objs_;
+  /// The types of \m manager_ and of the self-collision managers
+  FCLBroadPhaseConfig broadphase_config_;
 
   /// FCL collision manager which handles the collision checking process
   std::unique_ptr<fcl::BroadPhaseCollisionManagerd> manager_;
@@ -154,6 +308,12 @@ private:
   /** \brief Callback function executed for each change to the world environment */
   void notifyObjectChange(const ObjectConstPtr& obj, World::Action action);
 
+  /** \brief Callback function executed for the changes of a batch of world updates, updating the broadphase once */
+  void notifyObjectsChange(const World::ObjectChanges& changes);
+
+  /** \brief Rebuild \m manager_ after a change of the world if its type requires it */
+  void updatedWorldBroadPhase();
+
   World::ObserverHandle observer_handle_;
 };
 }  // namespace collision_detection
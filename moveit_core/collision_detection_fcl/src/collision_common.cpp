@@ -35,6 +35,7 @@
 /* Author: Ioan Sucan, Jia Pan */
 
 #include <moveit/collision_detection_fcl/collision_common.h>
+#include <moveit/collision_detection/collision_culling.h>
 #include <geometric_shapes/shapes.h>
 #include <moveit/collision_detection_fcl/fcl_compat.h>
 
@@ -48,13 +49,36 @@
 #endif
 
 #include <boost/thread/mutex.hpp>
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <list>
 #include <memory>
+#include <mutex>
+#include <unordered_map>
 
 namespace collision_detection
 {
 // Logger
 static const rclcpp::Logger LOGGER = rclcpp::get_logger("moveit_collision_detection_fcl.collision_common");
 
+namespace
+{
+// Check whether the culling bounds of a request rule out a collision between two objects. Attached bodies are
+// never culled
+bool isCulled(const GroupCollisionCulling& culling, const fcl::CollisionObjectd* o1, const CollisionGeometryData* cd1,
+              const fcl::CollisionObjectd* o2, const CollisionGeometryData* cd2)
+{
+  if (cd1->type == BodyTypes::ROBOT_LINK && cd2->type == BodyTypes::ROBOT_LINK)
+    return !culling.mayCollide(cd1->ptr.link, cd2->ptr.link);
+  if (cd1->type == BodyTypes::ROBOT_LINK && cd2->type == BodyTypes::WORLD_OBJECT)
+    return !culling.mayCollide(cd1->ptr.link, Eigen::AlignedBox3d(o2->getAABB().min_, o2->getAABB().max_));
+  if (cd1->type == BodyTypes::WORLD_OBJECT && cd2->type == BodyTypes::ROBOT_LINK)
+    return !culling.mayCollide(cd2->ptr.link, Eigen::AlignedBox3d(o1->getAABB().min_, o1->getAABB().max_));
+  return false;
+}
+}  // namespace
+
 bool collisionCallback(fcl::CollisionObjectd* o1, fcl::CollisionObjectd* o2, void* data)
 {
   CollisionData* cdata = reinterpret_cast<CollisionData*>(data);
@@ -85,13 +109,19 @@ bool collisionCallback(fcl::CollisionObjectd* o1, fcl::CollisionObjectd* o2, voi
       return false;
   }
 
+  // If the motions of the group cannot bring the objects into contact
+  if (cdata->culling_ && isCulled(*cdata->culling_, o1, cd1, o2, cd2))
+    return false;
+
   // use the collision matrix (if any) to avoid certain collision checks
   DecideContactFn dcf;
   bool always_allow_collision = false;
   if (cdata->acm_)
   {
     AllowedCollision::Type type;
-    bool found = cdata->acm_->getAllowedCollision(cd1->getID(), cd2->getID(), type);
+    const CompiledAllowedCollisionMatrix& acm = *cdata->compiled_acm_;
+    bool found = acm.getAllowedCollision(cd1->getAllowedCollisionMatrixIndex(acm),
+                                         cd2->getAllowedCollisionMatrixIndex(acm), type);
     if (found)
     {
       // if we have an entry in the collision matrix, we read it
@@ -362,6 +392,124 @@ bool collisionCallback(fcl::CollisionObjectd* o1, fcl::CollisionObjectd* o2, voi
   return cdata->done_;
 }
 
+namespace
+{
+/** \brief Rough relative cost of collision checks involving \e o: primitives, meshes, octrees */
+int getCollisionCost(const fcl::CollisionObjectd* o)
+{
+  switch (o->getObjectType())
+  {
+    case fcl::OT_GEOM:
+      return 0;
+    case fcl::OT_BVH:
+      return 1;
+    default:
+      return 2;
+  }
+}
+
+/** \brief Checks a single pair for collision, without computing contacts */
+bool collide(fcl::CollisionObjectd* o1, fcl::CollisionObjectd* o2)
+{
+  fcl::CollisionResultd col_result;
+  return fcl::collide(o1, o2, fcl::CollisionRequestd(1, false), col_result) > 0;
+}
+}  // namespace
+
+bool booleanCollisionCallback(fcl::CollisionObjectd* o1, fcl::CollisionObjectd* o2, void* data)
+{
+  CollisionData* cdata = reinterpret_cast<CollisionData*>(data);
+  if (cdata->done_)
+    return true;
+  const CollisionGeometryData* cd1 = static_cast<const CollisionGeometryData*>(o1->collisionGeometry()->getUserData());
+  const CollisionGeometryData* cd2 = static_cast<const CollisionGeometryData*>(o2->collisionGeometry()->getUserData());
+
+  // the same filters as in collisionCallback(), without the diagnostics
+  if (cd1->sameObject(*cd2))
+    return false;
+
+  if (cdata->active_components_only_)
+  {
+    const moveit::core::LinkModel* l1 =
+        cd1->type == BodyTypes::ROBOT_LINK ?
+            cd1->ptr.link :
+            (cd1->type == BodyTypes::ROBOT_ATTACHED ? cd1->ptr.ab->getAttachedLink() : nullptr);
+    const moveit::core::LinkModel* l2 =
+        cd2->type == BodyTypes::ROBOT_LINK ?
+            cd2->ptr.link :
+            (cd2->type == BodyTypes::ROBOT_ATTACHED ? cd2->ptr.ab->getAttachedLink() : nullptr);
+    if ((!l1 || cdata->active_components_only_->find(l1) == cdata->active_components_only_->end()) &&
+        (!l2 || cdata->active_components_only_->find(l2) == cdata->active_components_only_->end()))
+      return false;
+  }
+
+  if (cdata->culling_ && isCulled(*cdata->culling_, o1, cd1, o2, cd2))
+    return false;
+
+  if (cdata->acm_)
+  {
+    AllowedCollision::Type type;
+    const CompiledAllowedCollisionMatrix& acm = *cdata->compiled_acm_;
+    if (acm.getAllowedCollision(cd1->getAllowedCollisionMatrixIndex(acm), cd2->getAllowedCollisionMatrixIndex(acm),
+                                type))
+    {
+      if (type == AllowedCollision::ALWAYS)
+        return false;
+      // the decision depends on the contacts, which only the general callback computes
+      if (type == AllowedCollision::CONDITIONAL)
+        return collisionCallback(o1, o2, data);
+    }
+  }
+
+  if (cd1->type == BodyTypes::ROBOT_LINK && cd2->type == BodyTypes::ROBOT_ATTACHED)
+  {
+    if (cd2->ptr.ab->getTouchLinks().count(cd1->getID()))
+      return false;
+  }
+  else if (cd2->type == BodyTypes::ROBOT_LINK && cd1->type == BodyTypes::ROBOT_ATTACHED)
+  {
+    if (cd1->ptr.ab->getTouchLinks().count(cd2->getID()))
+      return false;
+  }
+  else if (cd1->type == BodyTypes::ROBOT_ATTACHED && cd2->type == BodyTypes::ROBOT_ATTACHED &&
+           cd1->ptr.ab->getAttachedLink() == cd2->ptr.ab->getAttachedLink())
+    return false;
+
+  // check pairs of primitives right away, a collision among them saves the expensive checks
+  const int cost = getCollisionCost(o1) + getCollisionCost(o2);
+  if (cost > 0)
+  {
+    cdata->deferred_pairs_.push_back({ cost, o1, o2 });
+    return false;
+  }
+
+  if (collide(o1, o2))
+  {
+    cdata->res_->collision = true;
+    cdata->done_ = true;
+  }
+  return cdata->done_;
+}
+
+void checkDeferredCollisionPairs(CollisionData& data)
+{
+  if (!data.done_)
+  {
+    std::stable_sort(data.deferred_pairs_.begin(), data.deferred_pairs_.end(),
+                     [](const CollisionData::DeferredPair& a, const CollisionData::DeferredPair& b) {
+                       return a.cost < b.cost;
+                     });
+    for (const CollisionData::DeferredPair& pair : data.deferred_pairs_)
+      if (collide(pair.o1, pair.o2))
+      {
+        data.res_->collision = true;
+        data.done_ = true;
+        break;
+      }
+  }
+  data.deferred_pairs_.clear();
+}
+
 /** \brief Cache for an arbitrary type of shape. It is assigned during the execution of \e createCollisionGeometry().
  *
  *  Only a single cache per thread and object type is created as it is a quasi-singleton instance. */
@@ -406,6 +554,162 @@ struct FCLShapeCache
   unsigned int clean_count_;
 };
 
+/** \brief Process-wide cache of the BVH models of meshes, keyed by the content of the mesh.
+ *
+ *  Unlike \e FCLShapeCache, which is keyed by the shape pointer, this cache also hits for identical meshes of
+ *  different shapes, e.g. when a collision object is re-sent or several objects use the same mesh. As the callbacks
+ *  identify objects through the user data of the collision geometry, the cached models are not shared but copied,
+ *  which is much cheaper than building the BVH. The least recently used models are evicted when the total number of
+ *  triangles exceeds the size of the cache. */
+template <typename BV>
+std::size_t getBVHModelMemoryUsage(const fcl::BVHModel<BV>& model)
+{
+  return sizeof(model) + model.num_vertices * sizeof(fcl::Vector3d) + model.num_tris * sizeof(fcl::Triangle) +
+         model.getNumBVs() * (sizeof(fcl::BVNode<BV>) + sizeof(unsigned int));
+}
+
+template <typename BV>
+class FCLMeshCache
+{
+public:
+  FCLMeshCache() : max_triangles_(DEFAULT_MAX_TRIANGLES), num_triangles_(0)
+  {
+  }
+
+  /** \brief Create the BVH model of \e mesh, copying it from the cache if possible */
+  fcl::BVHModel<BV>* createModel(const shapes::Mesh& mesh)
+  {
+    const std::uint64_t key = hash(mesh);
+    {
+      std::lock_guard<std::mutex> slock(lock_);
+      auto range = index_.equal_range(key);
+      for (auto it = range.first; it != range.second; ++it)
+        if (equal(*it->second->second, mesh))
+        {
+          // move to the front of the LRU list
+          models_.splice(models_.begin(), models_, it->second);
+          return new fcl::BVHModel<BV>(*it->second->second);
+        }
+    }
+
+    auto model = std::make_shared<fcl::BVHModel<BV>>();
+    std::vector<fcl::Triangle> tri_indices(mesh.triangle_count);
+    for (unsigned int i = 0; i < mesh.triangle_count; ++i)
+      tri_indices[i] = fcl::Triangle(mesh.triangles[3 * i], mesh.triangles[3 * i + 1], mesh.triangles[3 * i + 2]);
+
+    std::vector<fcl::Vector3d> points(mesh.vertex_count);
+    for (unsigned int i = 0; i < mesh.vertex_count; ++i)
+      points[i] = fcl::Vector3d(mesh.vertices[3 * i], mesh.vertices[3 * i + 1], mesh.vertices[3 * i + 2]);
+
+    model->beginModel();
+    model->addSubModel(points, tri_indices);
+    model->endModel();
+    model->computeLocalAABB();
+
+    std::lock_guard<std::mutex> slock(lock_);
+    if (mesh.triangle_count <= max_triangles_)
+    {
+      models_.emplace_front(key, model);
+      index_.emplace(key, models_.begin());
+      num_triangles_ += mesh.triangle_count;
+      evict();
+    }
+    return new fcl::BVHModel<BV>(*model);
+  }
+
+  void setMaxTriangles(std::size_t max_triangles)
+  {
+    std::lock_guard<std::mutex> slock(lock_);
+    max_triangles_ = max_triangles;
+    evict();
+  }
+
+  std::size_t getMemoryUsage()
+  {
+    std::lock_guard<std::mutex> slock(lock_);
+    std::size_t bytes = 0;
+    for (const auto& model : models_)
+      bytes += getBVHModelMemoryUsage(*model.second);
+    return bytes;
+  }
+
+  static FCLMeshCache& getInstance()
+  {
+    static FCLMeshCache cache;
+    return cache;
+  }
+
+  static const std::size_t DEFAULT_MAX_TRIANGLES = 1 << 20;
+
+private:
+  /** \brief FNV-1a hash of the vertices and triangles */
+  static std::uint64_t hash(const shapes::Mesh& mesh)
+  {
+    std::uint64_t h = 14695981039346656037ull;
+    auto add = [&h](const void* data, std::size_t size) {
+      const unsigned char* bytes = static_cast<const unsigned char*>(data);
+      for (std::size_t i = 0; i < size; ++i)
+      {
+        h ^= bytes[i];
+        h *= 1099511628211ull;
+      }
+    };
+    add(&mesh.vertex_count, sizeof(mesh.vertex_count));
+    add(&mesh.triangle_count, sizeof(mesh.triangle_count));
+    add(mesh.vertices, 3 * mesh.vertex_count * sizeof(double));
+    add(mesh.triangles, 3 * mesh.triangle_count * sizeof(unsigned int));
+    return h;
+  }
+
+  /** \brief Rule out hash collisions */
+  static bool equal(const fcl::BVHModel<BV>& model, const shapes::Mesh& mesh)
+  {
+    if (model.num_vertices != static_cast<int>(mesh.vertex_count) ||
+        model.num_tris != static_cast<int>(mesh.triangle_count))
+      return false;
+    for (unsigned int i = 0; i < mesh.vertex_count; ++i)
+      if (model.vertices[i] !=
+          fcl::Vector3d(mesh.vertices[3 * i], mesh.vertices[3 * i + 1], mesh.vertices[3 * i + 2]))
+        return false;
+    for (unsigned int i = 0; i < mesh.triangle_count; ++i)
+      for (int k = 0; k < 3; ++k)
+        if (model.tri_indices[i][k] != mesh.triangles[3 * i + k])
+          return false;
+    return true;
+  }
+
+  void evict()
+  {
+    while (num_triangles_ > max_triangles_)
+    {
+      num_triangles_ -= models_.back().second->num_tris;
+      auto range = index_.equal_range(models_.back().first);
+      for (auto it = range.first; it != range.second; ++it)
+        if (it->second == std::prev(models_.end()))
+        {
+          index_.erase(it);
+          break;
+        }
+      models_.pop_back();
+    }
+  }
+
+  std::mutex lock_;
+  std::size_t max_triangles_;
+  std::size_t num_triangles_;
+
+  using ModelList = std::list<std::pair<std::uint64_t, std::shared_ptr<const fcl::BVHModel<BV>>>>;
+
+  /** \brief The models with the hash of their mesh, most recently used first */
+  ModelList models_;
+
+  /** \brief The entries of \e models_ by hash */
+  std::unordered_multimap<std::uint64_t, typename ModelList::iterator> index_;
+};
+
+template <typename BV>
+const std::size_t FCLMeshCache<BV>::DEFAULT_MAX_TRIANGLES;
+
 bool distanceCallback(fcl::CollisionObjectd* o1, fcl::CollisionObjectd* o2, void* data, double& min_dist)
 {
   DistanceData* cdata = reinterpret_cast<DistanceData*>(data);
@@ -442,8 +746,9 @@ bool distanceCallback(fcl::CollisionObjectd* o1, fcl::CollisionObjectd* o2, void
   if (cdata->req->acm)
   {
     AllowedCollision::Type type;
-
-    bool found = cdata->req->acm->getAllowedCollision(cd1->getID(), cd2->getID(), type);
+    const CompiledAllowedCollisionMatrix& acm = *cdata->compiled_acm;
+    bool found = acm.getAllowedCollision(cd1->getAllowedCollisionMatrixIndex(acm),
+                                         cd2->getAllowedCollisionMatrixIndex(acm), type);
     if (found)
     {
       // if we have an entry in the collision matrix, we read it
@@ -816,24 +1121,11 @@ FCLGeometryConstPtr createCollisionGeometry(const shapes::ShapeConstPtr& shape,
     break;
     case shapes::MESH:
     {
-      auto g = new fcl::BVHModel<BV>();
       const shapes::Mesh* mesh = static_cast<const shapes::Mesh*>(shape.get());
       if (mesh->vertex_count > 0 && mesh->triangle_count > 0)
-      {
-        std::vector<fcl::Triangle> tri_indices(mesh->triangle_count);
-        for (unsigned int i = 0; i < mesh->triangle_count; ++i)
-          tri_indices[i] =
-              fcl::Triangle(mesh->triangles[3 * i], mesh->triangles[3 * i + 1], mesh->triangles[3 * i + 2]);
-
-        std::vector<fcl::Vector3d> points(mesh->vertex_count);
-        for (unsigned int i = 0; i < mesh->vertex_count; ++i)
-          points[i] = fcl::Vector3d(mesh->vertices[3 * i], mesh->vertices[3 * i + 1], mesh->vertices[3 * i + 2]);
-
-        g->beginModel();
-        g->addSubModel(points, tri_indices);
-        g->endModel();
-      }
-      cg_g = g;
+        cg_g = FCLMeshCache<BV>::getInstance().createModel(*mesh);
+      else
+        cg_g = new fcl::BVHModel<BV>();
     }
     break;
     case shapes::OCTREE:
@@ -922,6 +1214,26 @@ void cleanCollisionGeometryCache()
   }
 }
 
+void setCollisionGeometryMeshCacheSize(std::size_t max_triangles)
+{
+  FCLMeshCache<fcl::OBBRSSd>::getInstance().setMaxTriangles(max_triangles);
+}
+
+std::size_t getCollisionGeometryMeshCacheMemoryUsage()
+{
+  return FCLMeshCache<fcl::OBBRSSd>::getInstance().getMemoryUsage();
+}
+
+std::size_t getCollisionGeometryMemoryUsage(const FCLGeometry& geometry)
+{
+  std::size_t bytes = sizeof(FCLGeometry) + sizeof(CollisionGeometryData);
+  if (!geometry.collision_geometry_)
+    return bytes;
+  if (const auto* model = dynamic_cast<const fcl::BVHModel<fcl::OBBRSSd>*>(geometry.collision_geometry_.get()))
+    return bytes + getBVHModelMemoryUsage(*model);
+  return bytes + sizeof(fcl::Boxd);  // primitives and octree wrappers are about this size
+}
+
 void CollisionData::enableGroup(const moveit::core::RobotModelConstPtr& robot_model)
 {
   if (robot_model->hasJointModelGroup(req_->group_name))
@@ -930,6 +1242,14 @@ void CollisionData::enableGroup(const moveit::core::RobotModelConstPtr& robot_mo
     active_components_only_ = nullptr;
 }
 
+void CollisionData::enableCulling(const moveit::core::RobotState& state)
+{
+  if (req_->culling && req_->culling->isValidFor(state))
+    culling_ = req_->culling.get();
+  else
+    culling_ = nullptr;
+}
+
 void FCLObject::registerTo(fcl::BroadPhaseCollisionManagerd* manager)
 {
   std::vector<fcl::CollisionObjectd*> collision_objects(collision_objects_.size());
@@ -39,11 +39,56 @@
 
 namespace collision_detection
 {
+static const rclcpp::Logger LOGGER = rclcpp::get_logger("moveit_collision_detection_fcl.plugin_loader");
+static const std::string PARAMETER_NAMESPACE = "collision_detector_fcl.";
+
+namespace
+{
+void getBroadPhaseParameter(const rclcpp::Node::SharedPtr& node, const std::string& name,
+                            FCLBroadPhaseTypes::Type& type)
+{
+  std::string value;
+  if (!node->get_parameter(PARAMETER_NAMESPACE + name, value))
+    return;
+  if (!FCLBroadPhaseTypes::fromString(value, type))
+    RCLCPP_ERROR(LOGGER, "Unknown broadphase '%s' for parameter '%s', using '%s'", value.c_str(),
+                 (PARAMETER_NAMESPACE + name).c_str(), FCLBroadPhaseTypes::toString(type).c_str());
+}
+
+void getVectorParameter(const rclcpp::Node::SharedPtr& node, const std::string& name, Eigen::Vector3d& vector)
+{
+  std::vector<double> value;
+  if (!node->get_parameter(PARAMETER_NAMESPACE + name, value))
+    return;
+  if (value.size() == 3)
+    vector = Eigen::Vector3d(value[0], value[1], value[2]);
+  else
+    RCLCPP_ERROR(LOGGER, "Parameter '%s' needs 3 values", (PARAMETER_NAMESPACE + name).c_str());
+}
+}  // namespace
+
 bool CollisionDetectorFCLPluginLoader::initialize(const planning_scene::PlanningScenePtr& scene, bool exclusive) const
 {
   scene->setActiveCollisionDetector(CollisionDetectorAllocatorFCL::create(), exclusive);
   return true;
 }
+
+bool CollisionDetectorFCLPluginLoader::initialize(const rclcpp::Node::SharedPtr& node,
+                                                  const planning_scene::PlanningScenePtr& scene, bool exclusive) const
+{
+  FCLBroadPhaseConfig config;
+  getBroadPhaseParameter(node, "world_broadphase", config.world_type);
+  getBroadPhaseParameter(node, "self_broadphase", config.self_type);
+  node->get_parameter(PARAMETER_NAMESPACE + "spatial_hashing_cell_size", config.spatial_hashing_cell_size);
+  getVectorParameter(node, "spatial_hashing_scene_min", config.spatial_hashing_scene_min);
+  getVectorParameter(node, "spatial_hashing_scene_max", config.spatial_hashing_scene_max);
+  RCLCPP_DEBUG(LOGGER, "Using the FCL broadphase '%s' for the world and '%s' for self-collisions",
+               FCLBroadPhaseTypes::toString(config.world_type).c_str(),
+               FCLBroadPhaseTypes::toString(config.self_type).c_str());
+
+  scene->setActiveCollisionDetector(CollisionDetectorAllocatorFCL::create(config), exclusive);
+  return true;
+}
 }  // namespace collision_detection
 
 PLUGINLIB_EXPORT_CLASS(collision_detection::CollisionDetectorFCLPluginLoader, collision_detection::CollisionPlugin)
@@ -37,12 +37,18 @@
 #include <moveit/collision_detection_fcl/collision_env_fcl.h>
 #include <moveit/collision_detection_fcl/collision_detector_allocator_fcl.h>
 #include <moveit/collision_detection_fcl/collision_common.h>
+#include <moveit/profiler/tracing.h>
 
 #include <moveit/collision_detection_fcl/fcl_compat.h>
 #include <boost/bind.hpp>
+#include <unordered_set>
 
 #if (MOVEIT_FCL_VERSION >= FCL_VERSION_CHECK(0, 6, 0))
 #include <fcl/broadphase/broadphase_dynamic_AABB_tree.h>
+#include <fcl/broadphase/broadphase_dynamic_AABB_tree_array.h>
+#include <fcl/broadphase/broadphase_SaP.h>
+#include <fcl/broadphase/broadphase_spatialhash.h>
+#include <fcl/narrowphase/continuous_collision.h>
 #endif
 
 namespace collision_detection
@@ -50,78 +56,59 @@ namespace collision_detection
 static const rclcpp::Logger LOGGER = rclcpp::get_logger("moveit_collision_detection_fcl.collision_env_fcl");
 const std::string CollisionDetectorAllocatorFCL::NAME("FCL");
 
-CollisionEnvFCL::CollisionEnvFCL(const moveit::core::RobotModelConstPtr& model, double padding, double scale)
-  : CollisionEnv(model, padding, scale)
+// Number of interpolation steps the naive FCL continuous collision solver checks along each motion
+static const std::size_t CCD_MAX_ITERATIONS = 20;
+
+namespace FCLBroadPhaseTypes
 {
-  const std::vector<const moveit::core::LinkModel*>& links = robot_model_->getLinkModelsWithCollisionGeometry();
-  std::size_t index;
-  robot_geoms_.resize(robot_model_->getLinkGeometryCount());
-  robot_fcl_objs_.resize(robot_model_->getLinkGeometryCount());
-  // we keep the same order of objects as what RobotState *::getLinkState() returns
-  for (auto link : links)
-    for (std::size_t j = 0; j < link->getShapes().size(); ++j)
-    {
-      FCLGeometryConstPtr link_geometry = createCollisionGeometry(link->getShapes()[j], getLinkScale(link->getName()),
-                                                                  getLinkPadding(link->getName()), link, j);
-      if (link_geometry)
-      {
-        index = link->getFirstCollisionBodyTransformIndex() + j;
-        robot_geoms_[index] = link_geometry;
+static const std::vector<std::pair<Type, std::string>> NAMES = { { DYNAMIC_AABB_TREE, "dynamic_aabb_tree" },
+                                                                  { STATIC_AABB_TREE, "static_aabb_tree" },
+                                                                  { SWEEP_AND_PRUNE, "sweep_and_prune" },
+                                                                  { SPATIAL_HASHING, "spatial_hashing" } };
 
-        // Need to store the FCL object so the AABB does not get recreated every time.
-        // Every time this object is created, g->computeLocalAABB() is called  which is
-        // very expensive and should only be calculated once. To update the AABB, use the
-        // collObj->setTransform and then call collObj->computeAABB() to transform the AABB.
-        robot_fcl_objs_[index] =
-            FCLCollisionObjectConstPtr(new fcl::CollisionObjectd(link_geometry->collision_geometry_));
-      }
-      else
-        RCLCPP_ERROR(LOGGER, "Unable to construct collision geometry for link '%s'", link->getName().c_str());
+bool fromString(const std::string& name, Type& type)
+{
+  for (const std::pair<Type, std::string>& entry : NAMES)
+    if (entry.second == name)
+    {
+      type = entry.first;
+      return true;
     }
+  return false;
+}
 
-  auto m = new fcl::DynamicAABBTreeCollisionManagerd();
-  // m->tree_init_level = 2;
-  manager_.reset(m);
+std::string toString(Type type)
+{
+  for (const std::pair<Type, std::string>& entry : NAMES)
+    if (entry.first == type)
+      return entry.second;
+  return "unknown";
+}
+}  // namespace FCLBroadPhaseTypes
+
+CollisionEnvFCL::CollisionEnvFCL(const moveit::core::RobotModelConstPtr& model, double padding, double scale)
+  : CollisionEnv(model, padding, scale)
+{
+  updateRobotGeometry(robot_model_->getLinkModelsWithCollisionGeometry(), std::string(), robot_geometry_);
+
+  manager_ = createBroadPhase(broadphase_config_.world_type);
 
   // request notifications about changes to new world
-  observer_handle_ = getWorld()->addObserver(boost::bind(&CollisionEnvFCL::notifyObjectChange, this, _1, _2));
+  observer_handle_ = getWorld()->addObserver(boost::bind(&CollisionEnvFCL::notifyObjectChange, this, _1, _2),
+                                             boost::bind(&CollisionEnvFCL::notifyObjectsChange, this, _1));
 }
 
 CollisionEnvFCL::CollisionEnvFCL(const moveit::core::RobotModelConstPtr& model, const WorldPtr& world, double padding,
                                  double scale)
   : CollisionEnv(model, world, padding, scale)
 {
-  const std::vector<const moveit::core::LinkModel*>& links = robot_model_->getLinkModelsWithCollisionGeometry();
-  std::size_t index;
-  robot_geoms_.resize(robot_model_->getLinkGeometryCount());
-  robot_fcl_objs_.resize(robot_model_->getLinkGeometryCount());
-  // we keep the same order of objects as what RobotState *::getLinkState() returns
-  for (auto link : links)
-    for (std::size_t j = 0; j < link->getShapes().size(); ++j)
-    {
-      FCLGeometryConstPtr g = createCollisionGeometry(link->getShapes()[j], getLinkScale(link->getName()),
-                                                      getLinkPadding(link->getName()), link, j);
-      if (g)
-      {
-        index = link->getFirstCollisionBodyTransformIndex() + j;
-        robot_geoms_[index] = g;
-
-        // Need to store the FCL object so the AABB does not get recreated every time.
-        // Every time this object is created, g->computeLocalAABB() is called  which is
-        // very expensive and should only be calculated once. To update the AABB, use the
-        // collObj->setTransform and then call collObj->computeAABB() to transform the AABB.
-        robot_fcl_objs_[index] = FCLCollisionObjectConstPtr(new fcl::CollisionObjectd(g->collision_geometry_));
-      }
-      else
-        RCLCPP_ERROR(LOGGER, "Unable to construct collision geometry for link '%s'", link->getName().c_str());
-    }
+  updateRobotGeometry(robot_model_->getLinkModelsWithCollisionGeometry(), std::string(), robot_geometry_);
 
-  auto m = new fcl::DynamicAABBTreeCollisionManagerd();
-  // m->tree_init_level = 2;
-  manager_.reset(m);
+  manager_ = createBroadPhase(broadphase_config_.world_type);
 
   // request notifications about changes to new world
-  observer_handle_ = getWorld()->addObserver(boost::bind(&CollisionEnvFCL::notifyObjectChange, this, _1, _2));
+  observer_handle_ = getWorld()->addObserver(boost::bind(&CollisionEnvFCL::notifyObjectChange, this, _1, _2),
+                                             boost::bind(&CollisionEnvFCL::notifyObjectsChange, this, _1));
   getWorld()->notifyObserverAllObjects(observer_handle_, World::CREATE);
 }
 
@@ -130,22 +117,78 @@ CollisionEnvFCL::~CollisionEnvFCL()
   getWorld()->removeObserver(observer_handle_);
 }
 
-CollisionEnvFCL::CollisionEnvFCL(const CollisionEnvFCL& other, const WorldPtr& world) : CollisionEnv(other, world)
+CollisionEnvFCL::CollisionEnvFCL(const CollisionEnvFCL& other, const WorldPtr& world)
+  : CollisionEnv(other, world), broadphase_config_(other.broadphase_config_)
 {
-  robot_geoms_ = other.robot_geoms_;
-  robot_fcl_objs_ = other.robot_fcl_objs_;
-
-  auto m = new fcl::DynamicAABBTreeCollisionManagerd();
-  // m->tree_init_level = 2;
-  manager_.reset(m);
+  robot_geometry_.geoms_ = other.robot_geometry_.geoms_;
+  robot_geometry_.fcl_objs_ = other.robot_geometry_.fcl_objs_;
+  for (const auto& profile_geometry : other.padding_profile_geometry_)
+  {
+    std::unique_ptr<RobotGeometry>& geometry = padding_profile_geometry_[profile_geometry.first];
+    geometry.reset(new RobotGeometry());
+    geometry->geoms_ = profile_geometry.second->geoms_;
+    geometry->fcl_objs_ = profile_geometry.second->fcl_objs_;
+  }
 
+  manager_ = createBroadPhase(broadphase_config_.world_type);
   fcl_objs_ = other.fcl_objs_;
-  for (auto& fcl_obj : fcl_objs_)
-    fcl_obj.second.registerTo(manager_.get());
-  // manager_->update();
+  registerWorldObjects();
 
   // request notifications about changes to new world
-  observer_handle_ = getWorld()->addObserver(boost::bind(&CollisionEnvFCL::notifyObjectChange, this, _1, _2));
+  observer_handle_ = getWorld()->addObserver(boost::bind(&CollisionEnvFCL::notifyObjectChange, this, _1, _2),
+                                             boost::bind(&CollisionEnvFCL::notifyObjectsChange, this, _1));
+}
+
+std::unique_ptr<fcl::BroadPhaseCollisionManagerd>
+CollisionEnvFCL::createBroadPhase(FCLBroadPhaseTypes::Type type) const
+{
+#if (MOVEIT_FCL_VERSION >= FCL_VERSION_CHECK(0, 6, 0))
+  switch (type)
+  {
+    case FCLBroadPhaseTypes::DYNAMIC_AABB_TREE:
+      break;
+    case FCLBroadPhaseTypes::STATIC_AABB_TREE:
+      return std::make_unique<fcl::DynamicAABBTreeCollisionManager_Array<double>>();
+    case FCLBroadPhaseTypes::SWEEP_AND_PRUNE:
+      return std::make_unique<fcl::SaPCollisionManager<double>>();
+    case FCLBroadPhaseTypes::SPATIAL_HASHING:
+      return std::make_unique<fcl::SpatialHashingCollisionManager<double>>(
+          broadphase_config_.spatial_hashing_cell_size, broadphase_config_.spatial_hashing_scene_min,
+          broadphase_config_.spatial_hashing_scene_max);
+  }
+#else
+  if (type != FCLBroadPhaseTypes::DYNAMIC_AABB_TREE)
+    RCLCPP_ERROR(LOGGER, "The broadphase '%s' requires FCL 0.6 or newer, using a dynamic AABB tree",
+                 FCLBroadPhaseTypes::toString(type).c_str());
+#endif
+  return std::make_unique<fcl::DynamicAABBTreeCollisionManagerd>();
+}
+
+void CollisionEnvFCL::setBroadPhaseConfig(const FCLBroadPhaseConfig& config)
+{
+  broadphase_config_ = config;
+  manager_ = createBroadPhase(broadphase_config_.world_type);
+  registerWorldObjects();
+
+  // the pooled self-collision managers are recreated on demand
+  auto clear_pool = [](const RobotGeometry& geometry) {
+    std::lock_guard<std::mutex> slock(geometry.self_collision_broadphases_lock_);
+    geometry.self_collision_broadphases_.clear();
+  };
+  clear_pool(robot_geometry_);
+  for (const auto& profile_geometry : padding_profile_geometry_)
+    clear_pool(*profile_geometry.second);
+}
+
+void CollisionEnvFCL::registerWorldObjects()
+{
+  // registering all objects at once builds balanced trees
+  std::vector<fcl::CollisionObjectd*> collision_objects;
+  for (const std::pair<const std::string, FCLObject>& fcl_obj : fcl_objs_)
+    for (const FCLCollisionObjectPtr& collision_object : fcl_obj.second.collision_objects_)
+      collision_objects.push_back(collision_object.get());
+  if (!collision_objects.empty())
+    manager_->registerObjects(collision_objects);
 }
 
 void CollisionEnvFCL::getAttachedBodyObjects(const moveit::core::AttachedBody* ab,
@@ -174,23 +217,32 @@ void CollisionEnvFCL::constructFCLObjectWorld(const World::Object* obj, FCLObjec
   }
 }
 
-void CollisionEnvFCL::constructFCLObjectRobot(const moveit::core::RobotState& state, FCLObject& fcl_obj) const
+void CollisionEnvFCL::constructFCLObjectRobot(const RobotGeometry& geometry, const moveit::core::RobotState& state,
+                                              FCLObject& fcl_obj) const
 {
-  fcl_obj.collision_objects_.reserve(robot_geoms_.size());
+  const std::vector<FCLGeometryConstPtr>& geoms = geometry.geoms_;
+  fcl_obj.collision_objects_.reserve(geoms.size());
   fcl::Transform3d fcl_tf;
 
-  for (std::size_t i = 0; i < robot_geoms_.size(); ++i)
-    if (robot_geoms_[i] && robot_geoms_[i]->collision_geometry_)
+  for (std::size_t i = 0; i < geoms.size(); ++i)
+    if (geoms[i] && geoms[i]->collision_geometry_)
     {
-      transform2fcl(state.getCollisionBodyTransform(robot_geoms_[i]->collision_geometry_data_->ptr.link,
-                                                    robot_geoms_[i]->collision_geometry_data_->shape_index),
+      transform2fcl(state.getCollisionBodyTransform(geoms[i]->collision_geometry_data_->ptr.link,
+                                                    geoms[i]->collision_geometry_data_->shape_index),
                     fcl_tf);
-      auto coll_obj = new fcl::CollisionObjectd(*robot_fcl_objs_[i]);
+      auto coll_obj = new fcl::CollisionObjectd(*geometry.fcl_objs_[i]);
       coll_obj->setTransform(fcl_tf);
       coll_obj->computeAABB();
       fcl_obj.collision_objects_.push_back(FCLCollisionObjectPtr(coll_obj));
     }
 
+  constructFCLObjectAttachedBodies(state, fcl_obj);
+}
+
+void CollisionEnvFCL::constructFCLObjectAttachedBodies(const moveit::core::RobotState& state, FCLObject& fcl_obj) const
+{
+  fcl::Transform3d fcl_tf;
+
   // TODO: Implement a method for caching fcl::CollisionObject's for moveit::core::AttachedBody's
   std::vector<const moveit::core::AttachedBody*> ab;
   state.getAttachedBodies(ab);
@@ -214,14 +266,95 @@ void CollisionEnvFCL::constructFCLObjectRobot(const moveit::core::RobotState& st
 
 void CollisionEnvFCL::allocSelfCollisionBroadPhase(const moveit::core::RobotState& state, FCLManager& manager) const
 {
-  auto m = new fcl::DynamicAABBTreeCollisionManagerd();
-  // m->tree_init_level = 2;
-  manager.manager_.reset(m);
-  constructFCLObjectRobot(state, manager.object_);
+  manager.manager_ = createBroadPhase(broadphase_config_.self_type);
+  constructFCLObjectRobot(robot_geometry_, state, manager.object_);
   manager.object_.registerTo(manager.manager_.get());
   // manager.manager_->update();
 }
 
+std::unique_ptr<CollisionEnvFCL::SelfCollisionBroadPhase>
+CollisionEnvFCL::acquireSelfCollisionBroadPhase(const RobotGeometry& geometry, const moveit::core::RobotState& state,
+                                                FCLObject& attached) const
+{
+  std::unique_ptr<SelfCollisionBroadPhase> broadphase;
+  {
+    std::lock_guard<std::mutex> slock(geometry.self_collision_broadphases_lock_);
+    if (!geometry.self_collision_broadphases_.empty())
+    {
+      broadphase = std::move(geometry.self_collision_broadphases_.back());
+      geometry.self_collision_broadphases_.pop_back();
+    }
+  }
+
+  if (broadphase)
+  {
+    updateSelfCollisionBroadPhase(geometry, state, *broadphase, attached);
+  }
+  else
+  {
+    fcl::Transform3d fcl_tf;
+    broadphase.reset(new SelfCollisionBroadPhase());
+    broadphase->manager_.manager_ = createBroadPhase(broadphase_config_.self_type);
+    FCLObject& fcl_obj = broadphase->manager_.object_;
+    const std::vector<FCLGeometryConstPtr>& geoms = geometry.geoms_;
+    for (std::size_t i = 0; i < geoms.size(); ++i)
+      if (geoms[i] && geoms[i]->collision_geometry_)
+      {
+        transform2fcl(state.getCollisionBodyTransform(geoms[i]->collision_geometry_data_->ptr.link,
+                                                      geoms[i]->collision_geometry_data_->shape_index),
+                      fcl_tf);
+        auto coll_obj = new fcl::CollisionObjectd(*geometry.fcl_objs_[i]);
+        coll_obj->setTransform(fcl_tf);
+        coll_obj->computeAABB();
+        fcl_obj.collision_objects_.push_back(FCLCollisionObjectPtr(coll_obj));
+        broadphase->geom_indices_.push_back(i);
+      }
+    fcl_obj.registerTo(broadphase->manager_.manager_.get());
+
+    constructFCLObjectAttachedBodies(state, attached);
+    attached.registerTo(broadphase->manager_.manager_.get());
+  }
+  return broadphase;
+}
+
+void CollisionEnvFCL::updateSelfCollisionBroadPhase(const RobotGeometry& geometry,
+                                                    const moveit::core::RobotState& state,
+                                                    SelfCollisionBroadPhase& broadphase, FCLObject& attached) const
+{
+  // update the poses of the persistent link objects and refit the tree
+  updateFCLObjectRobotLinks(geometry, state, broadphase.geom_indices_,
+                            broadphase.manager_.object_.collision_objects_);
+  broadphase.manager_.manager_->update();
+
+  constructFCLObjectAttachedBodies(state, attached);
+  attached.registerTo(broadphase.manager_.manager_.get());
+}
+
+void CollisionEnvFCL::updateFCLObjectRobotLinks(const RobotGeometry& geometry, const moveit::core::RobotState& state,
+                                                const std::vector<std::size_t>& geom_indices,
+                                                std::vector<FCLCollisionObjectPtr>& objects) const
+{
+  fcl::Transform3d fcl_tf;
+  for (std::size_t i = 0; i < geom_indices.size(); ++i)
+  {
+    const FCLGeometryConstPtr& geom = geometry.geoms_[geom_indices[i]];
+    transform2fcl(state.getCollisionBodyTransform(geom->collision_geometry_data_->ptr.link,
+                                                  geom->collision_geometry_data_->shape_index),
+                  fcl_tf);
+    objects[i]->setTransform(fcl_tf);
+    objects[i]->computeAABB();
+  }
+}
+
+void CollisionEnvFCL::releaseSelfCollisionBroadPhase(const RobotGeometry& geometry,
+                                                     std::unique_ptr<SelfCollisionBroadPhase> broadphase,
+                                                     FCLObject& attached) const
+{
+  attached.unregisterFrom(broadphase->manager_.manager_.get());
+  std::lock_guard<std::mutex> slock(geometry.self_collision_broadphases_lock_);
+  geometry.self_collision_broadphases_.push_back(std::move(broadphase));
+}
+
 void CollisionEnvFCL::checkSelfCollision(const CollisionRequest& req, CollisionResult& res,
                                          const moveit::core::RobotState& state) const
 {
@@ -238,17 +371,28 @@ void CollisionEnvFCL::checkSelfCollisionHelper(const CollisionRequest& req, Coll
                                                const moveit::core::RobotState& state,
                                                const AllowedCollisionMatrix* acm) const
 {
-  FCLManager manager;
-  allocSelfCollisionBroadPhase(state, manager);
+  MOVEIT_TRACE_SCOPE("CollisionEnvFCL::checkSelfCollision");
+  const RobotGeometry& geometry = getRobotGeometry(req.padding_profile);
+  FCLObject attached;
+  std::unique_ptr<SelfCollisionBroadPhase> broadphase = acquireSelfCollisionBroadPhase(geometry, state, attached);
   CollisionData cd(&req, &res, acm);
   cd.enableGroup(getRobotModel());
-  manager.manager_->collide(&cd, &collisionCallback);
+  cd.enableCulling(state);
+  if (isBooleanCollisionRequest(req))
+  {
+    broadphase->manager_.manager_->collide(&cd, &booleanCollisionCallback);
+    checkDeferredCollisionPairs(cd);
+  }
+  else
+    broadphase->manager_.manager_->collide(&cd, &collisionCallback);
+  releaseSelfCollisionBroadPhase(geometry, std::move(broadphase), attached);
   if (req.distance)
   {
     DistanceRequest dreq;
     DistanceResult dres;
 
     dreq.group_name = req.group_name;
+    dreq.padding_profile = req.padding_profile;
     dreq.acm = acm;
     dreq.enableGroup(getRobotModel());
     distanceSelf(dreq, dres, state);
@@ -273,7 +417,7 @@ void CollisionEnvFCL::checkRobotCollision(const CollisionRequest& req, Collision
                                           const moveit::core::RobotState& state1,
                                           const moveit::core::RobotState& state2) const
 {
-  RCLCPP_ERROR(LOGGER, "Continuous collision not implemented");
+  checkRobotCollisionHelperCCD(req, res, state1, state2, nullptr);
 }
 
 void CollisionEnvFCL::checkRobotCollision(const CollisionRequest& req, CollisionResult& res,
@@ -281,20 +425,88 @@ void CollisionEnvFCL::checkRobotCollision(const CollisionRequest& req, Collision
                                           const moveit::core::RobotState& state2,
                                           const AllowedCollisionMatrix& acm) const
 {
-  RCLCPP_ERROR(LOGGER, "Not implemented");
+  checkRobotCollisionHelperCCD(req, res, state1, state2, &acm);
+}
+
+void CollisionEnvFCL::checkRobotCollisionHelperCCD(const CollisionRequest& req, CollisionResult& res,
+                                                   const moveit::core::RobotState& state1,
+                                                   const moveit::core::RobotState& state2,
+                                                   const AllowedCollisionMatrix* acm) const
+{
+#if (MOVEIT_FCL_VERSION >= FCL_VERSION_CHECK(0, 6, 0))
+  const RobotGeometry& geometry = getRobotGeometry(req.padding_profile);
+  FCLObject fcl_obj1, fcl_obj2;
+  constructFCLObjectRobot(geometry, state1, fcl_obj1);
+  constructFCLObjectRobot(geometry, state2, fcl_obj2);
+  if (fcl_obj1.collision_objects_.size() != fcl_obj2.collision_objects_.size())
+  {
+    RCLCPP_ERROR(LOGGER, "Continuous collision checking requires the same attached bodies in both states");
+    return;
+  }
+
+  fcl::ContinuousCollisionRequestd ccd_req;
+  ccd_req.num_max_iterations = CCD_MAX_ITERATIONS;
+  ccd_req.ccd_motion_type = fcl::CCDM_LINEAR;
+  ccd_req.ccd_solver_type = fcl::CCDC_NAIVE;
+
+  CollisionData cd(&req, &res, acm);
+  cd.enableGroup(getRobotModel());
+  for (std::size_t i = 0; !cd.done_ && i < fcl_obj1.collision_objects_.size(); ++i)
+  {
+    fcl::CollisionObjectd* robot_obj = fcl_obj2.collision_objects_[i].get();
+    const fcl::Transform3d tf_begin = fcl_obj1.collision_objects_[i]->getTransform();
+    const fcl::Transform3d tf_end = robot_obj->getTransform();
+
+    // Bound the volume swept by the object: the union of the start and end AABBs, enlarged by the maximum deviation
+    // of the object's points from their chords caused by the rotation.
+    fcl::AABBd swept = fcl_obj1.collision_objects_[i]->getAABB();
+    swept += robot_obj->getAABB();
+    const double angle = Eigen::AngleAxisd(tf_begin.linear().transpose() * tf_end.linear()).angle();
+    const fcl::CollisionGeometryd* geometry = robot_obj->collisionGeometry().get();
+    const double deviation = (geometry->aabb_center.norm() + geometry->aabb_radius) * (1.0 - cos(0.5 * angle));
+    swept.min_.array() -= deviation;
+    swept.max_.array() += deviation;
+
+    for (const std::pair<const std::string, FCLObject>& fcl_obj : fcl_objs_)
+      for (const FCLCollisionObjectPtr& world_obj : fcl_obj.second.collision_objects_)
+      {
+        if (cd.done_ || !swept.overlap(world_obj->getAABB()))
+          continue;
+
+        fcl::ContinuousCollisionResultd ccd_res;
+        fcl::continuousCollide(geometry, tf_begin, tf_end, world_obj->collisionGeometry().get(),
+                               world_obj->getTransform(), world_obj->getTransform(), ccd_req, ccd_res);
+        if (ccd_res.is_collide)
+        {
+          // evaluate the pair at the first colliding pose, which applies the ACM and computes contacts as usual
+          robot_obj->setTransform(ccd_res.contact_tf1);
+          robot_obj->computeAABB();
+          collisionCallback(robot_obj, world_obj.get(), &cd);
+        }
+      }
+  }
+#else
+  RCLCPP_ERROR(LOGGER, "Continuous collision checking requires FCL 0.6 or newer");
+#endif
 }
 
 void CollisionEnvFCL::checkRobotCollisionHelper(const CollisionRequest& req, CollisionResult& res,
                                                 const moveit::core::RobotState& state,
                                                 const AllowedCollisionMatrix* acm) const
 {
+  MOVEIT_TRACE_SCOPE("CollisionEnvFCL::checkRobotCollision");
   FCLObject fcl_obj;
-  constructFCLObjectRobot(state, fcl_obj);
+  constructFCLObjectRobot(getRobotGeometry(req.padding_profile), state, fcl_obj);
 
   CollisionData cd(&req, &res, acm);
   cd.enableGroup(getRobotModel());
+  cd.enableCulling(state);
+  const bool boolean_request = isBooleanCollisionRequest(req);
   for (std::size_t i = 0; !cd.done_ && i < fcl_obj.collision_objects_.size(); ++i)
-    manager_->collide(fcl_obj.collision_objects_[i].get(), &cd, &collisionCallback);
+    manager_->collide(fcl_obj.collision_objects_[i].get(), &cd,
+                      boolean_request ? &booleanCollisionCallback : &collisionCallback);
+  if (boolean_request)
+    checkDeferredCollisionPairs(cd);
 
   if (req.distance)
   {
@@ -302,6 +514,7 @@ void CollisionEnvFCL::checkRobotCollisionHelper(const CollisionRequest& req, Col
     DistanceResult dres;
 
     dreq.group_name = req.group_name;
+    dreq.padding_profile = req.padding_profile;
     dreq.acm = acm;
     dreq.enableGroup(getRobotModel());
     distanceRobot(dreq, dres, state);
@@ -312,24 +525,82 @@ void CollisionEnvFCL::checkRobotCollisionHelper(const CollisionRequest& req, Col
 void CollisionEnvFCL::distanceSelf(const DistanceRequest& req, DistanceResult& res,
                                    const moveit::core::RobotState& state) const
 {
-  FCLManager manager;
-  allocSelfCollisionBroadPhase(state, manager);
+  const RobotGeometry& geometry = getRobotGeometry(req.padding_profile);
+  FCLObject attached;
+  std::unique_ptr<SelfCollisionBroadPhase> broadphase = acquireSelfCollisionBroadPhase(geometry, state, attached);
   DistanceData drd(&req, &res);
 
-  manager.manager_->distance(&drd, &distanceCallback);
+  broadphase->manager_.manager_->distance(&drd, &distanceCallback);
+  releaseSelfCollisionBroadPhase(geometry, std::move(broadphase), attached);
 }
 
 void CollisionEnvFCL::distanceRobot(const DistanceRequest& req, DistanceResult& res,
                                     const moveit::core::RobotState& state) const
 {
   FCLObject fcl_obj;
-  constructFCLObjectRobot(state, fcl_obj);
+  constructFCLObjectRobot(getRobotGeometry(req.padding_profile), state, fcl_obj);
 
   DistanceData drd(&req, &res);
   for (std::size_t i = 0; !drd.done && i < fcl_obj.collision_objects_.size(); ++i)
     manager_->distance(fcl_obj.collision_objects_[i].get(), &drd, &distanceCallback);
 }
 
+void CollisionEnvFCL::distanceSelfBatch(const DistanceRequest& req, std::vector<DistanceResult>& res,
+                                        const std::vector<const moveit::core::RobotState*>& states) const
+{
+  res.assign(states.size(), DistanceResult());
+  if (states.empty())
+    return;
+
+  // keep a single broadphase manager for the whole batch, only moving its link objects between states
+  const RobotGeometry& geometry = getRobotGeometry(req.padding_profile);
+  FCLObject attached;
+  std::unique_ptr<SelfCollisionBroadPhase> broadphase = acquireSelfCollisionBroadPhase(geometry, *states[0], attached);
+  for (std::size_t i = 0; i < states.size(); ++i)
+  {
+    if (i > 0)
+    {
+      attached.unregisterFrom(broadphase->manager_.manager_.get());
+      attached.clear();
+      updateSelfCollisionBroadPhase(geometry, *states[i], *broadphase, attached);
+    }
+    DistanceData drd(&req, &res[i]);
+    broadphase->manager_.manager_->distance(&drd, &distanceCallback);
+  }
+  releaseSelfCollisionBroadPhase(geometry, std::move(broadphase), attached);
+}
+
+void CollisionEnvFCL::distanceRobotBatch(const DistanceRequest& req, std::vector<DistanceResult>& res,
+                                         const std::vector<const moveit::core::RobotState*>& states) const
+{
+  res.assign(states.size(), DistanceResult());
+  if (states.empty())
+    return;
+
+  // the link objects are created once and only moved for the following states
+  const RobotGeometry& geometry = getRobotGeometry(req.padding_profile);
+  FCLObject fcl_obj;
+  constructFCLObjectRobot(geometry, *states[0], fcl_obj);
+  std::vector<std::size_t> geom_indices;
+  for (std::size_t i = 0; i < geometry.geoms_.size(); ++i)
+    if (geometry.geoms_[i] && geometry.geoms_[i]->collision_geometry_)
+      geom_indices.push_back(i);
+
+  for (std::size_t i = 0; i < states.size(); ++i)
+  {
+    if (i > 0)
+    {
+      updateFCLObjectRobotLinks(geometry, *states[i], geom_indices, fcl_obj.collision_objects_);
+      fcl_obj.collision_objects_.resize(geom_indices.size());
+      fcl_obj.collision_geometry_.clear();
+      constructFCLObjectAttachedBodies(*states[i], fcl_obj);
+    }
+    DistanceData drd(&req, &res[i]);
+    for (std::size_t j = 0; !drd.done && j < fcl_obj.collision_objects_.size(); ++j)
+      manager_->distance(fcl_obj.collision_objects_[j].get(), &drd, &distanceCallback);
+  }
+}
+
 void CollisionEnvFCL::updateFCLObject(const std::string& id)
 {
   // remove FCL objects that correspond to this object
@@ -365,6 +636,24 @@ void CollisionEnvFCL::updateFCLObject(const std::string& id)
   // manager_->update();
 }
 
+bool CollisionEnvFCL::moveFCLObject(const World::Object* obj)
+{
+  auto jt = fcl_objs_.find(obj->id_);
+  // the collision objects correspond to the shapes only if all shapes could be converted
+  if (jt == fcl_objs_.end() || jt->second.collision_objects_.size() != obj->shapes_.size())
+    return false;
+
+  std::vector<fcl::CollisionObjectd*> collision_objects(obj->shapes_.size());
+  for (std::size_t i = 0; i < obj->shapes_.size(); ++i)
+  {
+    collision_objects[i] = jt->second.collision_objects_[i].get();
+    collision_objects[i]->setTransform(transform2fcl(obj->shape_poses_[i]));
+    collision_objects[i]->computeAABB();
+  }
+  manager_->update(collision_objects);
+  return true;
+}
+
 void CollisionEnvFCL::setWorld(const WorldPtr& world)
 {
   if (world == getWorld())
@@ -381,10 +670,46 @@ void CollisionEnvFCL::setWorld(const WorldPtr& world)
   CollisionEnv::setWorld(world);
 
   // request notifications about changes to new world
-  observer_handle_ = getWorld()->addObserver(boost::bind(&CollisionEnvFCL::notifyObjectChange, this, _1, _2));
+  observer_handle_ = getWorld()->addObserver(boost::bind(&CollisionEnvFCL::notifyObjectChange, this, _1, _2),
+                                             boost::bind(&CollisionEnvFCL::notifyObjectsChange, this, _1));
+
+  // add the objects already in the new world as one batch
+  World::ObjectChanges changes;
+  for (const std::pair<const std::string, ObjectPtr>& object : *getWorld())
+    changes.emplace_back(object.second, World::CREATE);
+  notifyObjectsChange(changes);
+}
 
-  // get notifications any objects already in the new world
-  getWorld()->notifyObserverAllObjects(observer_handle_, World::CREATE);
+std::size_t CollisionEnvFCL::getMemoryUsage() const
+{
+  // rough size of the nodes a broadphase manager keeps for each registered object
+  static const std::size_t BROADPHASE_BYTES_PER_OBJECT = 2 * 64;
+
+  std::unordered_set<const FCLGeometry*> counted;
+  std::size_t bytes = 0;
+  auto add_geometry = [&counted, &bytes](const std::vector<FCLGeometryConstPtr>& geoms) {
+    for (const FCLGeometryConstPtr& geom : geoms)
+      if (geom && counted.insert(geom.get()).second)
+        bytes += getCollisionGeometryMemoryUsage(*geom);
+  };
+  auto add_robot_geometry = [&](const RobotGeometry& geometry) {
+    add_geometry(geometry.geoms_);
+    bytes += geometry.fcl_objs_.size() * sizeof(fcl::CollisionObjectd);
+    std::lock_guard<std::mutex> slock(geometry.self_collision_broadphases_lock_);
+    for (const std::unique_ptr<SelfCollisionBroadPhase>& broadphase : geometry.self_collision_broadphases_)
+      bytes += broadphase->manager_.object_.collision_objects_.size() *
+               (sizeof(fcl::CollisionObjectd) + BROADPHASE_BYTES_PER_OBJECT);
+  };
+
+  add_robot_geometry(robot_geometry_);
+  for (const auto& profile : padding_profile_geometry_)
+    add_robot_geometry(*profile.second);
+  for (const auto& object : fcl_objs_)
+  {
+    add_geometry(object.second.collision_geometry_);
+    bytes += object.second.collision_objects_.size() * (sizeof(fcl::CollisionObjectd) + BROADPHASE_BYTES_PER_OBJECT);
+  }
+  return bytes;
 }
 
 void CollisionEnvFCL::notifyObjectChange(const ObjectConstPtr& obj, World::Action action)
@@ -400,37 +725,152 @@ void CollisionEnvFCL::notifyObjectChange(const ObjectConstPtr& obj, World::Actio
     }
     cleanCollisionGeometryCache();
   }
-  else
+  else if (action != World::MOVE_SHAPE || !moveFCLObject(obj.get()))
   {
     updateFCLObject(obj->id_);
     if (action & (World::DESTROY | World::REMOVE_SHAPE))
       cleanCollisionGeometryCache();
   }
+  updatedWorldBroadPhase();
 }
 
-void CollisionEnvFCL::updatedPaddingOrScaling(const std::vector<std::string>& links)
+void CollisionEnvFCL::notifyObjectsChange(const World::ObjectChanges& changes)
 {
-  std::size_t index;
-  for (const auto& link : links)
+  // when a large part of the world changed, building the broadphase from scratch is faster and gives a better
+  // balanced tree than updating the objects one by one
+  std::size_t num_rebuilt = 0;
+  for (const std::pair<World::ObjectConstPtr, World::Action>& change : changes)
+    if (change.second != World::MOVE_SHAPE)
+      ++num_rebuilt;
+  const bool rebuild = num_rebuilt > 1 && 2 * num_rebuilt >= fcl_objs_.size();
+  if (rebuild)
+    manager_->clear();
+
+  bool clean_cache = false;
+  for (const std::pair<World::ObjectConstPtr, World::Action>& change : changes)
   {
-    const moveit::core::LinkModel* lmodel = robot_model_->getLinkModel(link);
-    if (lmodel)
+    const std::string& id = change.first->id_;
+    if (change.second & (World::DESTROY | World::REMOVE_SHAPE))
+      clean_cache = true;
+    if (!rebuild)
     {
-      for (std::size_t j = 0; j < lmodel->getShapes().size(); ++j)
+      if (change.second == World::DESTROY)
       {
-        FCLGeometryConstPtr g = createCollisionGeometry(lmodel->getShapes()[j], getLinkScale(lmodel->getName()),
-                                                        getLinkPadding(lmodel->getName()), lmodel, j);
-        if (g)
+        auto it = fcl_objs_.find(id);
+        if (it != fcl_objs_.end())
         {
-          index = lmodel->getFirstCollisionBodyTransformIndex() + j;
-          robot_geoms_[index] = g;
-          robot_fcl_objs_[index] = FCLCollisionObjectConstPtr(new fcl::CollisionObjectd(g->collision_geometry_));
+          it->second.unregisterFrom(manager_.get());
+          fcl_objs_.erase(it);
         }
       }
+      else if (change.second != World::MOVE_SHAPE || !moveFCLObject(change.first.get()))
+        updateFCLObject(id);
+      continue;
+    }
+
+    auto it = getWorld()->find(id);
+    if (change.second == World::DESTROY || it == getWorld()->end())
+      fcl_objs_.erase(id);
+    else
+    {
+      FCLObject& fcl_obj = fcl_objs_[id];
+      fcl_obj.clear();
+      constructFCLObjectWorld(it->second.get(), fcl_obj);
+    }
+  }
+
+  if (rebuild)
+    registerWorldObjects();
+  else
+    updatedWorldBroadPhase();
+
+  if (clean_cache)
+    cleanCollisionGeometryCache();
+}
+
+void CollisionEnvFCL::updatedWorldBroadPhase()
+{
+  if (broadphase_config_.world_type == FCLBroadPhaseTypes::STATIC_AABB_TREE)
+  {
+    manager_->clear();
+    registerWorldObjects();
+  }
+}
+
+void CollisionEnvFCL::updateRobotGeometry(const std::vector<const moveit::core::LinkModel*>& links,
+                                          const std::string& padding_profile, RobotGeometry& geometry) const
+{
+  // the pooled self-collision managers refer to the old geometry
+  {
+    std::lock_guard<std::mutex> slock(geometry.self_collision_broadphases_lock_);
+    geometry.self_collision_broadphases_.clear();
+  }
+
+  geometry.geoms_.resize(robot_model_->getLinkGeometryCount());
+  geometry.fcl_objs_.resize(robot_model_->getLinkGeometryCount());
+  // we keep the same order of objects as what RobotState *::getLinkState() returns
+  for (auto link : links)
+    for (std::size_t j = 0; j < link->getShapes().size(); ++j)
+    {
+      FCLGeometryConstPtr g = createCollisionGeometry(link->getShapes()[j], getLinkScale(link->getName()),
+                                                      getLinkPadding(link->getName(), padding_profile), link, j);
+      if (g)
+      {
+        std::size_t index = link->getFirstCollisionBodyTransformIndex() + j;
+        geometry.geoms_[index] = g;
+
+        // Need to store the FCL object so the AABB does not get recreated every time.
+        // Every time this object is created, g->computeLocalAABB() is called  which is
+        // very expensive and should only be calculated once. To update the AABB, use the
+        // collObj->setTransform and then call collObj->computeAABB() to transform the AABB.
+        geometry.fcl_objs_[index] = FCLCollisionObjectConstPtr(new fcl::CollisionObjectd(g->collision_geometry_));
+      }
+      else
+        RCLCPP_ERROR(LOGGER, "Unable to construct collision geometry for link '%s'", link->getName().c_str());
     }
+}
+
+const CollisionEnvFCL::RobotGeometry& CollisionEnvFCL::getRobotGeometry(const std::string& padding_profile) const
+{
+  if (!padding_profile.empty())
+  {
+    auto it = padding_profile_geometry_.find(padding_profile);
+    if (it != padding_profile_geometry_.end())
+      return *it->second;
+  }
+  return robot_geometry_;
+}
+
+void CollisionEnvFCL::updatedPaddingOrScaling(const std::vector<std::string>& links)
+{
+  std::vector<const moveit::core::LinkModel*> link_models;
+  for (const auto& link : links)
+  {
+    const moveit::core::LinkModel* lmodel = robot_model_->getLinkModel(link);
+    if (lmodel)
+      link_models.push_back(lmodel);
     else
       RCLCPP_ERROR(LOGGER, "Updating padding or scaling for unknown link: '%s'", link.c_str());
   }
+
+  updateRobotGeometry(link_models, std::string(), robot_geometry_);
+  // the scaling also applies to the padding profiles
+  for (auto& profile_geometry : padding_profile_geometry_)
+    updateRobotGeometry(link_models, profile_geometry.first, *profile_geometry.second);
+}
+
+void CollisionEnvFCL::updatedPaddingProfile(const std::string& name)
+{
+  if (!hasPaddingProfile(name))
+  {
+    padding_profile_geometry_.erase(name);
+    return;
+  }
+
+  std::unique_ptr<RobotGeometry>& geometry = padding_profile_geometry_[name];
+  if (!geometry)
+    geometry.reset(new RobotGeometry());
+  updateRobotGeometry(robot_model_->getLinkModelsWithCollisionGeometry(), name, *geometry);
 }
 
 }  // end of namespace collision_detection
@@ -0,0 +1,99 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, PickNik LLC
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik LLC nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include <moveit/collision_detection_fcl/collision_detector_allocator_fcl.h>
+#include <moveit/collision_detection/test_collision_benchmark_panda.h>
+
+INSTANTIATE_TYPED_TEST_CASE_P(FCLCollisionBenchmarkPanda, CollisionBenchmarkPanda,
+                              collision_detection::CollisionDetectorAllocatorFCL);
+
+INSTANTIATE_TYPED_TEST_CASE_P(FCLDistanceBenchmarkPanda, DistanceBenchmarkPanda,
+                              collision_detection::CollisionDetectorAllocatorFCL);
+
+/** \brief Benchmarks of the broadphase types in worlds with many small boxes, like the items in a shelf */
+class FCLBroadPhaseBenchmarkPanda : public CollisionBenchmarkPanda<collision_detection::CollisionDetectorAllocatorFCL>
+{
+protected:
+  /** \brief Runs world collision checks for each broadphase type, in a world of \e object_count boxes */
+  void benchmarkBroadPhases(std::size_t object_count)
+  {
+    for (collision_detection::FCLBroadPhaseTypes::Type type :
+         { collision_detection::FCLBroadPhaseTypes::DYNAMIC_AABB_TREE,
+           collision_detection::FCLBroadPhaseTypes::STATIC_AABB_TREE,
+           collision_detection::FCLBroadPhaseTypes::SWEEP_AND_PRUNE,
+           collision_detection::FCLBroadPhaseTypes::SPATIAL_HASHING })
+    {
+      collision_detection::FCLBroadPhaseConfig config;
+      config.world_type = type;
+      cenv_ = collision_detection::CollisionDetectorAllocatorFCL(config).allocateEnv(robot_model_);
+
+      random_numbers::RandomNumberGenerator rng(123);
+      for (std::size_t i = 0; i < object_count; ++i)
+        cenv_->getWorld()->addToObject("object_" + std::to_string(i),
+                                       std::make_shared<const shapes::Box>(rng.uniformReal(0.02, 0.1),
+                                                                           rng.uniformReal(0.02, 0.1),
+                                                                           rng.uniformReal(0.02, 0.1)),
+                                       randomPose(rng));
+
+      benchmark(collision_detection::FCLBroadPhaseTypes::toString(type) + "_" + std::to_string(object_count) +
+                    "boxes_world_boolean",
+                [this](const moveit::core::RobotState& state) {
+                  collision_detection::CollisionRequest req;
+                  collision_detection::CollisionResult res;
+                  cenv_->checkRobotCollision(req, res, state, *acm_);
+                });
+    }
+  }
+};
+
+TEST_F(FCLBroadPhaseBenchmarkPanda, WorldCollision10Boxes)
+{
+  benchmarkBroadPhases(10);
+}
+
+TEST_F(FCLBroadPhaseBenchmarkPanda, WorldCollision100Boxes)
+{
+  benchmarkBroadPhases(100);
+}
+
+TEST_F(FCLBroadPhaseBenchmarkPanda, WorldCollision1000Boxes)
+{
+  benchmarkBroadPhases(1000);
+}
+
+int main(int argc, char* argv[])
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
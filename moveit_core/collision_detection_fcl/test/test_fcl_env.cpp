@@ -47,6 +47,7 @@
 
 #include <urdf_parser/urdf_parser.h>
 #include <geometric_shapes/shape_operations.h>
+#include <algorithm>
 
 /** \brief Brings the panda robot in user defined home position */
 inline void setToHome(moveit::core::RobotState& panda_state)
@@ -140,6 +141,26 @@ TEST_F(CollisionDetectionEnvTest, LinksInCollision)
   ASSERT_TRUE(res.collision);
 }
 
+/** \brief Repeated self-collision checks reuse the broadphase manager, which must follow the changing states. */
+TEST_F(CollisionDetectionEnvTest, RepeatedSelfCollisionChecks)
+{
+  moveit::core::RobotState colliding_state(robot_model_);
+  colliding_state.setToDefaultValues();
+  colliding_state.update();
+
+  for (int i = 0; i < 3; ++i)
+  {
+    collision_detection::CollisionRequest req;
+    collision_detection::CollisionResult res;
+    c_env_->checkSelfCollision(req, res, *robot_state_, *acm_);
+    EXPECT_FALSE(res.collision);
+
+    res.clear();
+    c_env_->checkSelfCollision(req, res, colliding_state, *acm_);
+    EXPECT_TRUE(res.collision);
+  }
+}
+
 /** \brief Adding obstacles to the world which are tested against the robot. Simple cases. */
 TEST_F(CollisionDetectionEnvTest, RobotWorldCollision_1)
 {
@@ -223,6 +244,45 @@ TEST_F(CollisionDetectionEnvTest, PaddingTest)
   ASSERT_FALSE(res.collision);
 }
 
+/** \brief Tests selecting a padding profile per request, next to the link padding of the environment. */
+TEST_F(CollisionDetectionEnvTest, PaddingProfileTest)
+{
+  collision_detection::CollisionRequest req;
+  collision_detection::CollisionResult res;
+
+  shapes::ShapeConstPtr shape_ptr(new shapes::Box(0.1, 0.1, 0.1));
+  Eigen::Isometry3d pos{ Eigen::Isometry3d::Identity() };
+  pos.translation().x() = 0.43;
+  pos.translation().y() = 0;
+  pos.translation().z() = 0.55;
+  c_env_->getWorld()->addToObject("box", shape_ptr, pos);
+
+  c_env_->setPaddingProfile("conservative", 0.0, { { "panda_hand", 0.08 } });
+  ASSERT_TRUE(c_env_->hasPaddingProfile("conservative"));
+  EXPECT_EQ(c_env_->getLinkPadding("panda_hand", "conservative"), 0.08);
+  EXPECT_EQ(c_env_->getLinkPadding("panda_hand", ""), 0.0);
+
+  c_env_->checkRobotCollision(req, res, *robot_state_, *acm_);
+  ASSERT_FALSE(res.collision);
+  res.clear();
+
+  req.padding_profile = "conservative";
+  c_env_->checkRobotCollision(req, res, *robot_state_, *acm_);
+  ASSERT_TRUE(res.collision);
+  res.clear();
+
+  // unknown profiles and removed profiles use the link padding
+  req.padding_profile = "unknown";
+  c_env_->checkRobotCollision(req, res, *robot_state_, *acm_);
+  ASSERT_FALSE(res.collision);
+  res.clear();
+
+  c_env_->removePaddingProfile("conservative");
+  req.padding_profile = "conservative";
+  c_env_->checkRobotCollision(req, res, *robot_state_, *acm_);
+  ASSERT_FALSE(res.collision);
+}
+
 /** \brief Continuous self collision checks of the robot.
  *
  *  Functionality not supported yet. */
@@ -267,10 +327,8 @@ TEST_F(CollisionDetectionEnvTest, DISABLED_ContinuousCollisionSelf)
   res.clear();
 }
 
-/** \brief Two similar robot poses are used as start and end pose of a continuous collision check.
- *
- *  Functionality not supported yet. */
-TEST_F(CollisionDetectionEnvTest, DISABLED_ContinuousCollisionWorld)
+/** \brief Two similar robot poses are used as start and end pose of a continuous collision check. */
+TEST_F(CollisionDetectionEnvTest, ContinuousCollisionWorld)
 {
   collision_detection::CollisionRequest req;
   req.contacts = true;
@@ -318,6 +376,124 @@ TEST_F(CollisionDetectionEnvTest, DISABLED_ContinuousCollisionWorld)
   res.clear();
 }
 
+/** \brief Batched distance queries must give the same results as the single state queries. */
+TEST_F(CollisionDetectionEnvTest, DistanceBatch)
+{
+  shapes::ShapeConstPtr shape_ptr(new shapes::Box(0.1, 0.1, 0.1));
+  Eigen::Isometry3d pos{ Eigen::Isometry3d::Identity() };
+  pos.translation().x() = 0.43;
+  pos.translation().z() = 0.55;
+  c_env_->getWorld()->addToObject("box", shape_ptr, pos);
+
+  std::vector<moveit::core::RobotState> robot_states(5, *robot_state_);
+  std::vector<const moveit::core::RobotState*> states;
+  for (moveit::core::RobotState& state : robot_states)
+  {
+    state.setToRandomPositions();
+    state.update();
+    states.push_back(&state);
+  }
+
+  collision_detection::DistanceRequest req;
+  req.acm = acm_.get();
+  req.enableGroup(robot_model_);
+
+  std::vector<collision_detection::DistanceResult> self_results, robot_results;
+  c_env_->distanceSelfBatch(req, self_results, states);
+  c_env_->distanceRobotBatch(req, robot_results, states);
+  ASSERT_EQ(self_results.size(), states.size());
+  ASSERT_EQ(robot_results.size(), states.size());
+
+  for (std::size_t i = 0; i < states.size(); ++i)
+  {
+    collision_detection::DistanceResult res;
+    c_env_->distanceSelf(req, res, *states[i]);
+    EXPECT_NEAR(self_results[i].minimum_distance.distance, res.minimum_distance.distance, 1e-6);
+
+    res.clear();
+    c_env_->distanceRobot(req, res, *states[i]);
+    EXPECT_NEAR(robot_results[i].minimum_distance.distance, res.minimum_distance.distance, 1e-6);
+  }
+}
+
+/** \brief All broadphase types find the same collisions, also after the world changed */
+TEST_F(CollisionDetectionEnvTest, BroadPhaseTypes)
+{
+  std::vector<moveit::core::RobotState> states(20, *robot_state_);
+  for (moveit::core::RobotState& state : states)
+  {
+    state.setToRandomPositions();
+    state.update();
+  }
+  shapes::ShapeConstPtr shape_ptr(new shapes::Box(0.1, 0.1, 0.1));
+  auto populate = [&shape_ptr](const collision_detection::WorldPtr& world) {
+    for (int i = 0; i < 30; ++i)
+    {
+      Eigen::Isometry3d pos{ Eigen::Isometry3d::Identity() };
+      pos.translation() = Eigen::Vector3d(-0.6 + 0.4 * (i % 4), -0.6 + 0.4 * (i / 4 % 4), 0.1 + 0.3 * (i / 16));
+      world->addToObject("box" + std::to_string(i), shape_ptr, pos);
+    }
+  };
+
+  auto check = [this, &states](const collision_detection::CollisionEnv& env) {
+    std::vector<bool> results;
+    for (const moveit::core::RobotState& state : states)
+    {
+      collision_detection::CollisionRequest req;
+      collision_detection::CollisionResult res;
+      env.checkRobotCollision(req, res, state, *acm_);
+      results.push_back(res.collision);
+      res.clear();
+      env.checkSelfCollision(req, res, state, *acm_);
+      results.push_back(res.collision);
+    }
+    return results;
+  };
+
+  populate(c_env_->getWorld());
+  const std::vector<bool> expected = check(*c_env_);
+  Eigen::Isometry3d moved{ Eigen::Isometry3d::Identity() };
+  moved.translation() = Eigen::Vector3d(0.3, 0.0, 0.5);
+  c_env_->getWorld()->moveObject("box0", moved);
+  c_env_->getWorld()->removeObject("box1");
+  const std::vector<bool> expected_changed = check(*c_env_);
+  EXPECT_NE(std::count(expected.begin(), expected.end(), true), 0);
+
+  for (collision_detection::FCLBroadPhaseTypes::Type type :
+       { collision_detection::FCLBroadPhaseTypes::STATIC_AABB_TREE,
+         collision_detection::FCLBroadPhaseTypes::SWEEP_AND_PRUNE,
+         collision_detection::FCLBroadPhaseTypes::SPATIAL_HASHING })
+  {
+    SCOPED_TRACE(collision_detection::FCLBroadPhaseTypes::toString(type));
+    collision_detection::FCLBroadPhaseConfig config;
+    config.world_type = type;
+    config.self_type = type;
+    collision_detection::CollisionEnvFCL env(robot_model_);
+    env.setBroadPhaseConfig(config);
+    populate(env.getWorld());
+    EXPECT_EQ(check(env), expected);
+
+    env.getWorld()->moveObject("box0", moved);
+    env.getWorld()->removeObject("box1");
+    EXPECT_EQ(check(env), expected_changed);
+  }
+}
+
+/** \brief The memory estimate follows the collision geometry of the world objects. */
+TEST_F(CollisionDetectionEnvTest, MemoryUsage)
+{
+  const std::size_t robot_bytes = c_env_->getMemoryUsage();
+  EXPECT_GT(robot_bytes, 0u);
+
+  shapes::ShapeConstPtr shape_ptr(new shapes::Box(0.1, 0.1, 0.1));
+  for (int i = 0; i < 10; ++i)
+    c_env_->getWorld()->addToObject("box" + std::to_string(i), shape_ptr, Eigen::Isometry3d::Identity());
+  EXPECT_GT(c_env_->getMemoryUsage(), robot_bytes);
+
+  c_env_->getWorld()->clearObjects();
+  EXPECT_EQ(robot_bytes, c_env_->getMemoryUsage());
+}
+
 int main(int argc, char** argv)
 {
   testing::InitGoogleTest(&argc, argv);
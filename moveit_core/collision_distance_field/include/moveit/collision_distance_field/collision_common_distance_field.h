@@ -52,13 +52,16 @@ MOVEIT_STRUCT_FORWARD(DistanceFieldCacheEntry)
  * This stores posed spheres making up the collision volume for a particular
  * link group in a particular pose.  It is associated with a particular dfce_
  * and can only be used with that dfce_ (DistanceFieldCacheEntry -- see below).
+ *
+ * Copies own their posed spheres, but share the PosedDistanceField of each
+ * link (including its pose) with the original.
  * */
 struct GroupStateRepresentation
 {
   EIGEN_MAKE_ALIGNED_OPERATOR_NEW
 
   GroupStateRepresentation(){};
-  GroupStateRepresentation(const GroupStateRepresentation& gsr)
+  GroupStateRepresentation(const GroupStateRepresentation& gsr) : dfce_(gsr.dfce_)
   {
     link_body_decompositions_.resize(gsr.link_body_decompositions_.size());
     for (unsigned int i = 0; i < gsr.link_body_decompositions_.size(); i++)
@@ -74,7 +77,8 @@ struct GroupStateRepresentation
     attached_body_decompositions_.resize(gsr.attached_body_decompositions_.size());
     for (unsigned int i = 0; i < gsr.attached_body_decompositions_.size(); i++)
     {
-      (*attached_body_decompositions_[i]) = (*gsr.attached_body_decompositions_[i]);
+      attached_body_decompositions_[i].reset(
+          new PosedBodySphereDecompositionVector(*gsr.attached_body_decompositions_[i]));
     }
     gradients_ = gsr.gradients_;
   }
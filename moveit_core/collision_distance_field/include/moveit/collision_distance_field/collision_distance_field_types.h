@@ -373,6 +373,18 @@ public:
   {
   }
 
+  /** \brief Copies the posed decompositions, so that updatePose() does not affect \e other */
+  PosedBodySphereDecompositionVector(const PosedBodySphereDecompositionVector& other)
+    : collision_spheres_(other.collision_spheres_)
+    , posed_collision_spheres_(other.posed_collision_spheres_)
+    , sphere_radii_(other.sphere_radii_)
+    , sphere_index_map_(other.sphere_index_map_)
+  {
+    decomp_vector_.reserve(other.decomp_vector_.size());
+    for (const PosedBodySphereDecompositionPtr& bd : other.decomp_vector_)
+      decomp_vector_.push_back(PosedBodySphereDecompositionPtr(new PosedBodySphereDecomposition(*bd)));
+  }
+
   const std::vector<CollisionSphere>& getCollisionSpheres() const
   {
     return collision_spheres_;
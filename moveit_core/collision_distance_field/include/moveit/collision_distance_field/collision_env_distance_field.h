@@ -43,6 +43,7 @@
 #include <moveit/planning_scene/planning_scene.h>
 #include <boost/thread/mutex.hpp>
 #include "rclcpp/rclcpp.hpp"
+#include <list>
 
 namespace collision_detection
 {
@@ -53,6 +54,7 @@ static const bool DEFAULT_USE_SIGNED_DISTANCE_FIELD = false;
 static const double DEFAULT_RESOLUTION = .02;
 static const double DEFAULT_COLLISION_TOLERANCE = 0.0;
 static const double DEFAULT_MAX_PROPOGATION_DISTANCE = .25;
+static const std::size_t DEFAULT_MAX_DISTANCE_FIELD_CACHE_ENTRIES = 4;
 
 MOVEIT_CLASS_FORWARD(CollisionEnvDistanceField)  // Defines CollisionEnvDistanceFieldPtr, ConstPtr, WeakPtr... etc
 
@@ -128,6 +130,38 @@ public:
     return distance_field_cache_entry_;
   }
 
+  /** \brief Use a distance_field::SparseDistanceField, which only allocates memory near obstacles, instead of a
+      dense distance_field::PropagationDistanceField.  This allows large workspaces with bounded memory, at the cost of
+      slower lookups.  Regenerates the distance field of the world. */
+  void setUseSparseDistanceField(bool use_sparse_distance_field);
+
+  bool getUseSparseDistanceField() const
+  {
+    return use_sparse_distance_field_;
+  }
+
+  /** \brief Set the number of groups for which the distance field of the robot links outside the group is cached.
+      When switching to a group without a cache entry, the least recently used entry is dropped. */
+  void setMaxDistanceFieldCacheEntries(std::size_t max_entries);
+
+  std::size_t getMaxDistanceFieldCacheEntries() const
+  {
+    return max_distance_field_cache_entries_;
+  }
+
+  /** \brief Limit the memory held by the cached distance fields of the robot links (in bytes). The least recently
+      used entries are dropped until the cache fits, but the most recent entry is always kept. Zero disables the
+      limit (default). */
+  void setDistanceFieldCacheMemoryBudget(std::size_t max_bytes);
+
+  std::size_t getDistanceFieldCacheMemoryBudget() const
+  {
+    return distance_field_cache_memory_budget_;
+  }
+
+  /** \brief The distance fields of the world and of the cached robot link entries */
+  std::size_t getMemoryUsage() const override;
+
   // void getSelfCollisionsGradients(const collision_detection::CollisionRequest
   // &req,
   //                                 collision_detection::CollisionResult &res,
@@ -157,6 +191,13 @@ public:
   virtual void checkCollision(const CollisionRequest& req, CollisionResult& res, const moveit::core::RobotState& state,
                               const AllowedCollisionMatrix& acm, GroupStateRepresentationPtr& gsr) const;
 
+  /** \brief Check the states in parallel on the shared TaskScheduler. Consecutive states that only differ in the
+   *  variables of the group of \e req share a group state representation, so only the poses of their spheres are
+   *  updated between checks. */
+  void checkCollisionBatch(const CollisionRequest& req, std::vector<CollisionResult>& res,
+                           const std::vector<const moveit::core::RobotState*>& states,
+                           const AllowedCollisionMatrix& acm) const override;
+
   void checkRobotCollision(const CollisionRequest& req, CollisionResult& res,
                            const moveit::core::RobotState& state) const override;
 
@@ -207,6 +248,7 @@ public:
 
   collision_detection::GroupStateRepresentationConstPtr getLastGroupStateRepresentation() const
   {
+    boost::mutex::scoped_lock slock(last_gsr_lock_);
     return last_gsr_;
   }
 
@@ -248,6 +290,23 @@ protected:
                                                              const collision_detection::AllowedCollisionMatrix* acm,
                                                              bool generate_distance_field) const;
 
+  /** \brief Create a cache entry for \e group_name that reuses the distance field of the cached entry of the group.
+      Only the links outside of the group whose pose changed are moved in the field.  Returns nullptr if there is no
+      cached entry with a distance field, if it is still in use or if the attached bodies changed. */
+  DistanceFieldCacheEntryPtr updateDistanceFieldCacheEntry(const std::string& group_name,
+                                                           const moveit::core::RobotState& state,
+                                                           const collision_detection::AllowedCollisionMatrix* acm) const;
+
+  /** \brief Make \e dfce the most recently used cache entry, replacing the entry of the same group */
+  void storeDistanceFieldCacheEntry(const DistanceFieldCacheEntryPtr& dfce) const;
+
+  /** \brief Drop the least recently used cache entries beyond the entry and memory limits. Requires
+      update_cache_lock_ to be held. */
+  void evictDistanceFieldCacheEntries() const;
+
+  /** \brief Set last_gsr_, which may be done from several threads checking collisions concurrently */
+  void setLastGroupStateRepresentation(const GroupStateRepresentationPtr& gsr) const;
+
   void addLinkBodyDecompositions(double resolution);
 
   void addLinkBodyDecompositions(double resolution,
@@ -264,6 +323,9 @@ protected:
   bool compareCacheEntryToState(const DistanceFieldCacheEntryConstPtr& dfce,
                                 const moveit::core::RobotState& state) const;
 
+  bool compareCacheEntryToAttachedBodies(const DistanceFieldCacheEntryConstPtr& dfce,
+                                         const moveit::core::RobotState& state) const;
+
   bool compareCacheEntryToAllowedCollisionMatrix(const DistanceFieldCacheEntryConstPtr& dfce,
                                                  const collision_detection::AllowedCollisionMatrix& acm) const;
 
@@ -271,6 +333,9 @@ protected:
 
   DistanceFieldCacheEntryWorldPtr generateDistanceFieldCacheEntryWorld();
 
+  /** \brief Create an empty distance field of the configured type and dimensions */
+  distance_field::DistanceFieldPtr createDistanceField() const;
+
   void updateDistanceObject(const std::string& id, CollisionEnvDistanceField::DistanceFieldCacheEntryWorldPtr& dfce,
                             EigenSTL::vector_Vector3d& add_points, EigenSTL::vector_Vector3d& subtract_points);
 
@@ -292,12 +357,17 @@ protected:
   double resolution_;
   double collision_tolerance_;
   double max_propogation_distance_;
+  bool use_sparse_distance_field_;
 
   std::vector<BodyDecompositionConstPtr> link_body_decomposition_vector_;
   std::map<std::string, unsigned int> link_body_decomposition_index_map_;
 
   mutable boost::mutex update_cache_lock_;
   DistanceFieldCacheEntryPtr distance_field_cache_entry_;
+  // at most one entry per group, most recently used first
+  mutable std::list<DistanceFieldCacheEntryPtr> distance_field_cache_entries_;
+  std::size_t max_distance_field_cache_entries_;
+  std::size_t distance_field_cache_memory_budget_;
   std::map<std::string, std::map<std::string, bool>> in_group_update_map_;
   std::map<std::string, GroupStateRepresentationPtr> pregenerated_group_state_representation_map_;
 
@@ -305,6 +375,7 @@ protected:
 
   mutable boost::mutex update_cache_lock_world_;
   DistanceFieldCacheEntryWorldPtr distance_field_cache_entry_world_;
+  mutable boost::mutex last_gsr_lock_;
   GroupStateRepresentationPtr last_gsr_;
   World::ObserverHandle observer_handle_;
 };
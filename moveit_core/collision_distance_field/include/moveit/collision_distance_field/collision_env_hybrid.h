@@ -45,6 +45,20 @@
 
 namespace collision_detection
 {
+/** \brief How the discrete checks of CollisionEnvHybrid use its two backends */
+namespace HybridCheckModes
+{
+enum Mode
+{
+  /** \brief Only FCL is used */
+  FCL_ONLY,
+
+  /** \brief The group is first checked against the distance field. Its collision free answers are final, only states
+   *  it reports in collision are checked again with FCL. */
+  DISTANCE_FIELD_FILTER
+};
+}  // namespace HybridCheckModes
+
 /** \brief This hybrid collision environment combines FCL and a distance field. Both can be used to calculate
  *  collisions. */
 class CollisionEnvHybrid : public collision_detection::CollisionEnvFCL
@@ -134,6 +148,31 @@ public:
                                         const moveit::core::RobotState& state, const AllowedCollisionMatrix& acm,
                                         GroupStateRepresentationPtr& gsr) const;
 
+  void checkSelfCollision(const CollisionRequest& req, CollisionResult& res,
+                          const moveit::core::RobotState& state) const override;
+
+  void checkSelfCollision(const CollisionRequest& req, CollisionResult& res, const moveit::core::RobotState& state,
+                          const AllowedCollisionMatrix& acm) const override;
+
+  void checkRobotCollision(const CollisionRequest& req, CollisionResult& res,
+                           const moveit::core::RobotState& state) const override;
+
+  void checkRobotCollision(const CollisionRequest& req, CollisionResult& res, const moveit::core::RobotState& state,
+                           const AllowedCollisionMatrix& acm) const override;
+
+  using CollisionEnvFCL::checkRobotCollision;
+
+  /** \brief Set how the discrete collision checks use the distance field and FCL, FCL only by default */
+  void setCheckMode(HybridCheckModes::Mode mode)
+  {
+    check_mode_ = mode;
+  }
+
+  HybridCheckModes::Mode getCheckMode() const
+  {
+    return check_mode_;
+  }
+
   void setWorld(const WorldPtr& world) override;
 
   void getCollisionGradients(const CollisionRequest& req, CollisionResult& res, const moveit::core::RobotState& state,
@@ -147,7 +186,19 @@ public:
     return cenv_distance_;
   }
 
+  /** \brief See CollisionEnvDistanceField::setUseSparseDistanceField() */
+  void setUseSparseDistanceField(bool use_sparse_distance_field)
+  {
+    cenv_distance_->setUseSparseDistanceField(use_sparse_distance_field);
+  }
+
 protected:
+  /** \brief Whether \e req can be answered by filtering with the distance field. The distance field only reports
+   *  whether the links of a group collide, so requests without a group or for contacts, costs or distances go to FCL
+   *  directly. */
+  bool useDistanceFieldFilter(const CollisionRequest& req) const;
+
   CollisionEnvDistanceFieldPtr cenv_distance_;
+  HybridCheckModes::Mode check_mode_;
 };
 }  // namespace collision_detection
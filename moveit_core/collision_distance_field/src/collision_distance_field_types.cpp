@@ -40,7 +40,8 @@
 #include <moveit/distance_field/find_internal_points.h>
 #include <memory>
 
-const static double EPSILON = 0.0001;
+// number of spheres looked up in the distance field at once
+const static std::size_t SPHERE_BATCH_SIZE = 32;
 
 namespace collision_detection
 {
@@ -137,55 +138,55 @@ bool getCollisionSphereGradients(const distance_field::DistanceField* distance_f
 {
   // assumes gradient is properly initialized
 
+  // out of bounds lookups have a zero gradient and the uninitialized distance, so they are not treated specially
   bool in_collision = false;
-  for (unsigned int i = 0; i < sphere_list.size(); i++)
+  double distances[SPHERE_BATCH_SIZE];
+  Eigen::Vector3d gradients[SPHERE_BATCH_SIZE];
+  for (std::size_t begin = 0; begin < sphere_list.size(); begin += SPHERE_BATCH_SIZE)
   {
-    Eigen::Vector3d p = sphere_centers[i];
-    Eigen::Vector3d grad;
-    bool in_bounds;
-    double dist = distance_field->getDistanceGradient(p.x(), p.y(), p.z(), grad.x(), grad.y(), grad.z(), in_bounds);
-    if (!in_bounds && grad.norm() > EPSILON)
-    {
-      RCLCPP_DEBUG(LOGGER, "Collision sphere point is out of bounds %lf, %lf, %lf", p.x(), p.y(), p.z());
-      return true;
-    }
-
-    if (dist < maximum_value)
+    const std::size_t count = std::min(SPHERE_BATCH_SIZE, sphere_list.size() - begin);
+    distance_field->getDistanceGradients(&sphere_centers[begin], count, distances, gradients);
+    for (std::size_t j = 0; j < count; ++j)
     {
-      if (subtract_radii)
+      const std::size_t i = begin + j;
+      double dist = distances[j];
+      if (dist < maximum_value)
       {
-        dist -= sphere_list[i].radius_;
+        if (subtract_radii)
+        {
+          dist -= sphere_list[i].radius_;
 
-        if ((dist < 0) && (-dist >= tolerance))
+          if ((dist < 0) && (-dist >= tolerance))
+          {
+            in_collision = true;
+          }
+        }
+        else
         {
-          in_collision = true;
+          if (sphere_list[i].radius_ - dist > tolerance)
+          {
+            in_collision = true;
+          }
         }
-      }
-      else
-      {
-        if (sphere_list[i].radius_ - dist > tolerance)
+
+        if (dist < gradient.closest_distance)
         {
-          in_collision = true;
+          gradient.closest_distance = dist;
         }
-      }
 
-      if (dist < gradient.closest_distance)
-      {
-        gradient.closest_distance = dist;
+        if (dist < gradient.distances[i])
+        {
+          gradient.types[i] = type;
+          gradient.distances[i] = dist;
+          gradient.gradients[i] = gradients[j];
+        }
       }
 
-      if (dist < gradient.distances[i])
+      if (stop_at_first_collision && in_collision)
       {
-        gradient.types[i] = type;
-        gradient.distances[i] = dist;
-        gradient.gradients[i] = grad;
+        return true;
       }
     }
-
-    if (stop_at_first_collision && in_collision)
-    {
-      return true;
-    }
   }
   return in_collision;
 }
@@ -195,22 +196,18 @@ bool getCollisionSphereCollision(const distance_field::DistanceField* distance_f
                                  const EigenSTL::vector_Vector3d& sphere_centers, double maximum_value,
                                  double tolerance)
 {
-  for (unsigned int i = 0; i < sphere_list.size(); i++)
+  double distances[SPHERE_BATCH_SIZE];
+  Eigen::Vector3d gradients[SPHERE_BATCH_SIZE];
+  for (std::size_t begin = 0; begin < sphere_list.size(); begin += SPHERE_BATCH_SIZE)
   {
-    Eigen::Vector3d p = sphere_centers[i];
-    Eigen::Vector3d grad;
-    bool in_bounds = true;
-    double dist = distance_field->getDistanceGradient(p.x(), p.y(), p.z(), grad.x(), grad.y(), grad.z(), in_bounds);
-
-    if (!in_bounds && grad.norm() > 0)
-    {
-      RCLCPP_DEBUG(LOGGER, "Collision sphere point is out of bounds");
-      return true;
-    }
-
-    if ((maximum_value > dist) && (sphere_list[i].radius_ - dist > tolerance))
+    const std::size_t count = std::min(SPHERE_BATCH_SIZE, sphere_list.size() - begin);
+    distance_field->getDistanceGradients(&sphere_centers[begin], count, distances, gradients);
+    for (std::size_t j = 0; j < count; ++j)
     {
-      return true;
+      if ((maximum_value > distances[j]) && (sphere_list[begin + j].radius_ - distances[j] > tolerance))
+      {
+        return true;
+      }
     }
   }
 
@@ -223,28 +220,26 @@ bool getCollisionSphereCollision(const distance_field::DistanceField* distance_f
                                  double tolerance, unsigned int num_coll, std::vector<unsigned int>& colls)
 {
   colls.clear();
-  for (unsigned int i = 0; i < sphere_list.size(); i++)
+  double distances[SPHERE_BATCH_SIZE];
+  Eigen::Vector3d gradients[SPHERE_BATCH_SIZE];
+  for (std::size_t begin = 0; begin < sphere_list.size(); begin += SPHERE_BATCH_SIZE)
   {
-    Eigen::Vector3d p = sphere_centers[i];
-    Eigen::Vector3d grad;
-    bool in_bounds = true;
-    double dist = distance_field->getDistanceGradient(p.x(), p.y(), p.z(), grad.x(), grad.y(), grad.z(), in_bounds);
-    if (!in_bounds && (grad.norm() > 0))
+    const std::size_t count = std::min(SPHERE_BATCH_SIZE, sphere_list.size() - begin);
+    distance_field->getDistanceGradients(&sphere_centers[begin], count, distances, gradients);
+    for (std::size_t j = 0; j < count; ++j)
     {
-      RCLCPP_DEBUG(LOGGER, "Collision sphere point is out of bounds");
-      return true;
-    }
-    if (maximum_value > dist && (sphere_list[i].radius_ - dist > tolerance))
-    {
-      if (num_coll == 0)
+      if (maximum_value > distances[j] && (sphere_list[begin + j].radius_ - distances[j] > tolerance))
       {
-        return true;
-      }
+        if (num_coll == 0)
+        {
+          return true;
+        }
 
-      colls.push_back(i);
-      if (colls.size() >= num_coll)
-      {
-        return true;
+        colls.push_back(begin + j);
+        if (colls.size() >= num_coll)
+        {
+          return true;
+        }
       }
     }
   }
@@ -39,8 +39,11 @@
 #include <moveit/collision_distance_field/collision_env_distance_field.h>
 #include <moveit/collision_distance_field/collision_common_distance_field.h>
 #include <moveit/distance_field/propagation_distance_field.h>
+#include <moveit/distance_field/sparse_distance_field.h>
 #include <moveit/collision_distance_field/collision_detector_allocator_distance_field.h>
+#include <moveit/background_processing/task_scheduler.h>
 #include <boost/bind.hpp>
+#include <algorithm>
 #include <memory>
 #include <utility>
 
@@ -50,6 +53,9 @@ const rclcpp::Logger CollisionEnvDistanceField::LOGGER =
     rclcpp::get_logger("moveit_collision_distance_field.collision_robot_distance_field");
 const double EPSILON = 0.001f;
 
+// The number of consecutive states of a batch that are checked by the same task
+static const std::size_t BATCH_CHUNK_SIZE = 64;
+
 const std::string collision_detection::CollisionDetectorAllocatorDistanceField::NAME("DISTANCE_FIELD");
 
 CollisionEnvDistanceField::CollisionEnvDistanceField(
@@ -98,6 +104,9 @@ CollisionEnvDistanceField::CollisionEnvDistanceField(const CollisionEnvDistanceF
   resolution_ = other.resolution_;
   collision_tolerance_ = other.collision_tolerance_;
   max_propogation_distance_ = other.max_propogation_distance_;
+  use_sparse_distance_field_ = other.use_sparse_distance_field_;
+  max_distance_field_cache_entries_ = other.max_distance_field_cache_entries_;
+  distance_field_cache_memory_budget_ = other.distance_field_cache_memory_budget_;
   link_body_decomposition_vector_ = other.link_body_decomposition_vector_;
   link_body_decomposition_index_map_ = other.link_body_decomposition_index_map_;
   in_group_update_map_ = other.in_group_update_map_;
@@ -126,6 +135,9 @@ void CollisionEnvDistanceField::initialize(
   resolution_ = resolution;
   collision_tolerance_ = collision_tolerance;
   max_propogation_distance_ = max_propogation_distance;
+  use_sparse_distance_field_ = false;
+  max_distance_field_cache_entries_ = DEFAULT_MAX_DISTANCE_FIELD_CACHE_ENTRIES;
+  distance_field_cache_memory_budget_ = 0;
   addLinkBodyDecompositions(resolution_, link_body_decompositions);
   moveit::core::RobotState state(robot_model_);
   planning_scene_.reset(new planning_scene::PlanningScene(robot_model_));
@@ -157,10 +169,12 @@ void CollisionEnvDistanceField::generateCollisionCheckingStructures(
   {
     // RCLCPP_DEBUG_NAMED("collision_distance_field", "Generating new
     // DistanceFieldCacheEntry for CollisionRobot");
-    DistanceFieldCacheEntryPtr new_dfce =
-        generateDistanceFieldCacheEntry(group_name, state, acm, generate_distance_field);
-    boost::mutex::scoped_lock slock(update_cache_lock_);
-    (const_cast<CollisionEnvDistanceField*>(this))->distance_field_cache_entry_ = new_dfce;
+    DistanceFieldCacheEntryPtr new_dfce;
+    if (generate_distance_field)
+      new_dfce = updateDistanceFieldCacheEntry(group_name, state, acm);
+    if (!new_dfce)
+      new_dfce = generateDistanceFieldCacheEntry(group_name, state, acm, generate_distance_field);
+    storeDistanceFieldCacheEntry(new_dfce);
     dfce = new_dfce;
   }
   getGroupStateRepresentation(dfce, state, gsr);
@@ -197,19 +211,17 @@ CollisionEnvDistanceField::getDistanceFieldCacheEntry(const std::string& group_n
                                                       const collision_detection::AllowedCollisionMatrix* acm) const
 {
   DistanceFieldCacheEntryConstPtr ret;
-  if (!distance_field_cache_entry_)
-  {
-    RCLCPP_DEBUG(LOGGER, " No current Distance field cache entry");
-    return ret;
-  }
-  DistanceFieldCacheEntryConstPtr cur = distance_field_cache_entry_;
-  if (group_name != cur->group_name_)
+  boost::mutex::scoped_lock slock(update_cache_lock_);
+  auto it = std::find_if(
+      distance_field_cache_entries_.begin(), distance_field_cache_entries_.end(),
+      [&group_name](const DistanceFieldCacheEntryPtr& dfce) { return dfce->group_name_ == group_name; });
+  if (it == distance_field_cache_entries_.end())
   {
-    RCLCPP_DEBUG(LOGGER, "No cache entry as group name changed from %s to %s", cur->group_name_.c_str(),
-                 group_name.c_str());
+    RCLCPP_DEBUG(LOGGER, "No cache entry for group %s", group_name.c_str());
     return ret;
   }
-  else if (!compareCacheEntryToState(cur, state))
+  DistanceFieldCacheEntryConstPtr cur = *it;
+  if (!compareCacheEntryToState(cur, state))
   {
     // Regenerating distance field as state has changed from last time
     // RCLCPP_DEBUG_NAMED("collision_distance_field", "Regenerating distance field as
@@ -221,9 +233,177 @@ CollisionEnvDistanceField::getDistanceFieldCacheEntry(const std::string& group_n
     RCLCPP_DEBUG(LOGGER, "Regenerating distance field as some relevant part of the acm changed");
     return ret;
   }
+  distance_field_cache_entries_.splice(distance_field_cache_entries_.begin(), distance_field_cache_entries_, it);
+  (const_cast<CollisionEnvDistanceField*>(this))->distance_field_cache_entry_ = *it;
   return cur;
 }
 
+DistanceFieldCacheEntryPtr
+CollisionEnvDistanceField::updateDistanceFieldCacheEntry(const std::string& group_name,
+                                                         const moveit::core::RobotState& state,
+                                                         const collision_detection::AllowedCollisionMatrix* acm) const
+{
+  DistanceFieldCacheEntryPtr old_dfce;
+  {
+    boost::mutex::scoped_lock slock(update_cache_lock_);
+    auto it = std::find_if(
+        distance_field_cache_entries_.begin(), distance_field_cache_entries_.end(),
+        [&group_name](const DistanceFieldCacheEntryPtr& dfce) { return dfce->group_name_ == group_name; });
+    if (it == distance_field_cache_entries_.end() || !(*it)->distance_field_ ||
+        !compareCacheEntryToAttachedBodies(*it, state))
+      return nullptr;
+
+    // the field is modified in place, so no group state representation other than last_gsr_ may refer to the entry
+    long owners = 1;
+    if (*it == distance_field_cache_entry_)
+      ++owners;
+    GroupStateRepresentationConstPtr last_gsr = getLastGroupStateRepresentation();
+    if (last_gsr && last_gsr->dfce_ == *it)
+      ++owners;
+    if (it->use_count() > owners)
+      return nullptr;
+    old_dfce = *it;
+    distance_field_cache_entries_.erase(it);
+    if (distance_field_cache_entry_ == old_dfce)
+      (const_cast<CollisionEnvDistanceField*>(this))->distance_field_cache_entry_.reset();
+  }
+
+  DistanceFieldCacheEntryPtr dfce = generateDistanceFieldCacheEntry(group_name, state, acm, false);
+  dfce->distance_field_ = old_dfce->distance_field_;
+
+  // only the links outside of the group are in the field, a moving link takes its attached bodies along
+  EigenSTL::vector_Vector3d old_points;
+  EigenSTL::vector_Vector3d new_points;
+  EigenSTL::vector_Vector3d static_points;
+  const std::map<std::string, bool>& updated_group_map = in_group_update_map_.find(group_name)->second;
+  for (const moveit::core::LinkModel* link_model : robot_model_->getLinkModelsWithCollisionGeometry())
+  {
+    if (updated_group_map.find(link_model->getName()) != updated_group_map.end())
+      continue;
+
+    const Eigen::Isometry3d& old_pose = old_dfce->state_->getGlobalLinkTransform(link_model);
+    const Eigen::Isometry3d& new_pose = dfce->state_->getGlobalLinkTransform(link_model);
+    PosedBodyPointDecompositionPtr link_decomposition = getPosedLinkBodyPointDecomposition(link_model);
+    std::vector<const moveit::core::AttachedBody*> attached_bodies;
+    if (old_pose.isApprox(new_pose, EPSILON))
+    {
+      link_decomposition->updatePose(new_pose);
+      static_points.insert(static_points.end(), link_decomposition->getCollisionPoints().begin(),
+                           link_decomposition->getCollisionPoints().end());
+      dfce->state_->getAttachedBodies(attached_bodies, link_model);
+      for (const moveit::core::AttachedBody* attached_body : attached_bodies)
+      {
+        PosedBodyPointDecompositionVectorPtr bd = getAttachedBodyPointDecomposition(attached_body, resolution_);
+        static_points.insert(static_points.end(), bd->getCollisionPoints().begin(), bd->getCollisionPoints().end());
+      }
+      continue;
+    }
+
+    link_decomposition->updatePose(old_pose);
+    old_points.insert(old_points.end(), link_decomposition->getCollisionPoints().begin(),
+                      link_decomposition->getCollisionPoints().end());
+    link_decomposition->updatePose(new_pose);
+    new_points.insert(new_points.end(), link_decomposition->getCollisionPoints().begin(),
+                      link_decomposition->getCollisionPoints().end());
+
+    old_dfce->state_->getAttachedBodies(attached_bodies, link_model);
+    for (const moveit::core::AttachedBody* attached_body : attached_bodies)
+    {
+      PosedBodyPointDecompositionVectorPtr bd = getAttachedBodyPointDecomposition(attached_body, resolution_);
+      old_points.insert(old_points.end(), bd->getCollisionPoints().begin(), bd->getCollisionPoints().end());
+    }
+    attached_bodies.clear();
+    dfce->state_->getAttachedBodies(attached_bodies, link_model);
+    for (const moveit::core::AttachedBody* attached_body : attached_bodies)
+    {
+      PosedBodyPointDecompositionVectorPtr bd = getAttachedBodyPointDecomposition(attached_body, resolution_);
+      new_points.insert(new_points.end(), bd->getCollisionPoints().begin(), bd->getCollisionPoints().end());
+    }
+  }
+
+  if (!old_points.empty())
+  {
+    // cells shared with a link that did not move are cleared as well and need to be added again
+    dfce->distance_field_->removePointsFromField(old_points);
+    new_points.insert(new_points.end(), static_points.begin(), static_points.end());
+    dfce->distance_field_->addPointsToField(new_points);
+  }
+  RCLCPP_DEBUG(LOGGER, "Updated cached distance field of group %s, moved %zu points to %zu points", group_name.c_str(),
+               old_points.size(), new_points.size());
+  return dfce;
+}
+
+void CollisionEnvDistanceField::storeDistanceFieldCacheEntry(const DistanceFieldCacheEntryPtr& dfce) const
+{
+  boost::mutex::scoped_lock slock(update_cache_lock_);
+  distance_field_cache_entries_.remove_if(
+      [&dfce](const DistanceFieldCacheEntryPtr& entry) { return entry->group_name_ == dfce->group_name_; });
+  distance_field_cache_entries_.push_front(dfce);
+  evictDistanceFieldCacheEntries();
+  (const_cast<CollisionEnvDistanceField*>(this))->distance_field_cache_entry_ = dfce;
+}
+
+void CollisionEnvDistanceField::setLastGroupStateRepresentation(const GroupStateRepresentationPtr& gsr) const
+{
+  boost::mutex::scoped_lock slock(last_gsr_lock_);
+  (const_cast<CollisionEnvDistanceField*>(this))->last_gsr_ = gsr;
+}
+
+void CollisionEnvDistanceField::setMaxDistanceFieldCacheEntries(std::size_t max_entries)
+{
+  boost::mutex::scoped_lock slock(update_cache_lock_);
+  max_distance_field_cache_entries_ = std::max<std::size_t>(max_entries, 1);
+  evictDistanceFieldCacheEntries();
+}
+
+void CollisionEnvDistanceField::setDistanceFieldCacheMemoryBudget(std::size_t max_bytes)
+{
+  boost::mutex::scoped_lock slock(update_cache_lock_);
+  distance_field_cache_memory_budget_ = max_bytes;
+  evictDistanceFieldCacheEntries();
+}
+
+void CollisionEnvDistanceField::evictDistanceFieldCacheEntries() const
+{
+  while (distance_field_cache_entries_.size() > max_distance_field_cache_entries_)
+    distance_field_cache_entries_.pop_back();
+  if (distance_field_cache_memory_budget_ == 0)
+    return;
+
+  std::size_t bytes = 0;
+  for (const DistanceFieldCacheEntryPtr& entry : distance_field_cache_entries_)
+    if (entry->distance_field_)
+      bytes += entry->distance_field_->getMemoryUsage();
+  while (distance_field_cache_entries_.size() > 1 && bytes > distance_field_cache_memory_budget_)
+  {
+    if (distance_field_cache_entries_.back()->distance_field_)
+      bytes -= distance_field_cache_entries_.back()->distance_field_->getMemoryUsage();
+    RCLCPP_DEBUG(LOGGER, "Dropping the cached distance field of group %s to stay within %zu bytes",
+                 distance_field_cache_entries_.back()->group_name_.c_str(), distance_field_cache_memory_budget_);
+    distance_field_cache_entries_.pop_back();
+  }
+}
+
+std::size_t CollisionEnvDistanceField::getMemoryUsage() const
+{
+  std::size_t bytes = 0;
+  if (distance_field_cache_entry_world_ && distance_field_cache_entry_world_->distance_field_)
+    bytes += distance_field_cache_entry_world_->distance_field_->getMemoryUsage();
+
+  boost::mutex::scoped_lock slock(update_cache_lock_);
+  bool counted_last_entry = false;
+  for (const DistanceFieldCacheEntryPtr& entry : distance_field_cache_entries_)
+  {
+    if (entry->distance_field_)
+      bytes += entry->distance_field_->getMemoryUsage();
+    counted_last_entry |= entry == distance_field_cache_entry_;
+  }
+  // the last used entry is kept alive even if it was evicted from the cache
+  if (!counted_last_entry && distance_field_cache_entry_ && distance_field_cache_entry_->distance_field_)
+    bytes += distance_field_cache_entry_->distance_field_->getMemoryUsage();
+  return bytes;
+}
+
 void CollisionEnvDistanceField::checkSelfCollision(const collision_detection::CollisionRequest& req,
                                                    collision_detection::CollisionResult& res,
                                                    const moveit::core::RobotState& state) const
@@ -918,9 +1098,7 @@ DistanceFieldCacheEntryPtr CollisionEnvDistanceField::generateDistanceFieldCache
               getAttachedBodyPointDecomposition(attached_body, resolution_));
         }
       }
-      dfce->distance_field_.reset(new distance_field::PropagationDistanceField(
-          size_.x(), size_.y(), size_.z(), resolution_, origin_.x() - 0.5 * size_.x(), origin_.y() - 0.5 * size_.y(),
-          origin_.z() - 0.5 * size_.z(), max_propogation_distance_, use_signed_distance_field_));
+      dfce->distance_field_ = createDistanceField();
 
       // TODO - deal with AllowedCollisionMatrix
       // now we need to actually set the points
@@ -1260,11 +1438,17 @@ bool CollisionEnvDistanceField::compareCacheEntryToState(const DistanceFieldCach
         fabs(dfce->state_values_[dfce->state_check_indices_[i]] - new_state_values[dfce->state_check_indices_[i]]);
     if (diff > EPSILON)
     {
-      RCLCPP_WARN(LOGGER, "State for Variable %s has changed by %s radians",
+      RCLCPP_DEBUG(LOGGER, "State for Variable %s has changed by %f radians",
                   state.getVariableNames()[dfce->state_check_indices_[i]].c_str(), diff);
       return false;
     }
   }
+  return compareCacheEntryToAttachedBodies(dfce, state);
+}
+
+bool CollisionEnvDistanceField::compareCacheEntryToAttachedBodies(const DistanceFieldCacheEntryConstPtr& dfce,
+                                                                  const moveit::core::RobotState& state) const
+{
   std::vector<const moveit::core::AttachedBody*> attached_bodies_dfce;
   std::vector<const moveit::core::AttachedBody*> attached_bodies_state;
   dfce->state_->getAttachedBodies(attached_bodies_dfce);
@@ -1396,7 +1580,7 @@ void CollisionEnvDistanceField::checkCollision(const CollisionRequest& req, Coll
     getEnvironmentCollisions(req, res, distance_field_cache_entry_world_->distance_field_, gsr);
   }
 
-  (const_cast<CollisionEnvDistanceField*>(this))->last_gsr_ = gsr;
+  setLastGroupStateRepresentation(gsr);
 }
 
 void CollisionEnvDistanceField::checkCollision(const CollisionRequest& req, CollisionResult& res,
@@ -1429,7 +1613,26 @@ void CollisionEnvDistanceField::checkCollision(const CollisionRequest& req, Coll
     getEnvironmentCollisions(req, res, distance_field_cache_entry_world_->distance_field_, gsr);
   }
 
-  (const_cast<CollisionEnvDistanceField*>(this))->last_gsr_ = gsr;
+  setLastGroupStateRepresentation(gsr);
+}
+
+void CollisionEnvDistanceField::checkCollisionBatch(const CollisionRequest& req, std::vector<CollisionResult>& res,
+                                                    const std::vector<const moveit::core::RobotState*>& states,
+                                                    const AllowedCollisionMatrix& acm) const
+{
+  res.assign(states.size(), CollisionResult());
+  const std::size_t chunk_count = (states.size() + BATCH_CHUNK_SIZE - 1) / BATCH_CHUNK_SIZE;
+  moveit::tools::TaskScheduler::getGlobal().parallelFor(0, chunk_count, [&](std::size_t chunk) {
+    GroupStateRepresentationPtr gsr;
+    const std::size_t end = std::min(states.size(), (chunk + 1) * BATCH_CHUNK_SIZE);
+    for (std::size_t i = chunk * BATCH_CHUNK_SIZE; i < end; ++i)
+    {
+      // the representation of the previous state only fits if the links outside of the group did not move
+      if (gsr && !compareCacheEntryToState(gsr->dfce_, *states[i]))
+        gsr.reset();
+      checkCollision(req, res[i], *states[i], acm, gsr);
+    }
+  });
 }
 
 void CollisionEnvDistanceField::checkRobotCollision(const CollisionRequest& req, CollisionResult& res,
@@ -1453,7 +1656,7 @@ void CollisionEnvDistanceField::checkRobotCollision(const CollisionRequest& req,
     updateGroupStateRepresentationState(state, gsr);
   }
   getEnvironmentCollisions(req, res, env_distance_field, gsr);
-  (const_cast<CollisionEnvDistanceField*>(this))->last_gsr_ = gsr;
+  setLastGroupStateRepresentation(gsr);
 
   // checkRobotCollisionHelper(req, res, robot, state, &acm);
 }
@@ -1482,7 +1685,7 @@ void CollisionEnvDistanceField::checkRobotCollision(const CollisionRequest& req,
     updateGroupStateRepresentationState(state, gsr);
   }
   getEnvironmentCollisions(req, res, env_distance_field, gsr);
-  (const_cast<CollisionEnvDistanceField*>(this))->last_gsr_ = gsr;
+  setLastGroupStateRepresentation(gsr);
 
   // checkRobotCollisionHelper(req, res, robot, state, &acm);
 }
@@ -1522,7 +1725,7 @@ void CollisionEnvDistanceField::getCollisionGradients(const CollisionRequest& re
   getIntraGroupProximityGradients(gsr);
   getEnvironmentProximityGradients(env_distance_field, gsr);
 
-  (const_cast<CollisionEnvDistanceField*>(this))->last_gsr_ = gsr;
+  setLastGroupStateRepresentation(gsr);
 }
 
 void CollisionEnvDistanceField::getAllCollisions(const CollisionRequest& req, CollisionResult& res,
@@ -1543,7 +1746,7 @@ void CollisionEnvDistanceField::getAllCollisions(const CollisionRequest& req, Co
   distance_field::DistanceFieldConstPtr env_distance_field = distance_field_cache_entry_world_->distance_field_;
   getEnvironmentCollisions(req, res, env_distance_field, gsr);
 
-  (const_cast<CollisionEnvDistanceField*>(this))->last_gsr_ = gsr;
+  setLastGroupStateRepresentation(gsr);
 }
 
 bool CollisionEnvDistanceField::getEnvironmentCollisions(const CollisionRequest& req, CollisionResult& res,
@@ -1766,13 +1969,40 @@ void CollisionEnvDistanceField::updateDistanceObject(const std::string& id, Dist
   }
 }
 
+distance_field::DistanceFieldPtr CollisionEnvDistanceField::createDistanceField() const
+{
+  const Eigen::Vector3d field_origin = origin_ - 0.5 * size_;
+  if (use_sparse_distance_field_)
+    return std::make_shared<distance_field::SparseDistanceField>(
+        size_.x(), size_.y(), size_.z(), resolution_, field_origin.x(), field_origin.y(), field_origin.z(),
+        max_propogation_distance_, use_signed_distance_field_);
+
+  auto propagation_field = std::make_shared<distance_field::PropagationDistanceField>(
+      size_.x(), size_.y(), size_.z(), resolution_, field_origin.x(), field_origin.y(), field_origin.z(),
+      max_propogation_distance_, use_signed_distance_field_);
+  // the fields are filled with all points at once
+  propagation_field->setParallelRecompute(true);
+  return propagation_field;
+}
+
+void CollisionEnvDistanceField::setUseSparseDistanceField(bool use_sparse_distance_field)
+{
+  if (use_sparse_distance_field == use_sparse_distance_field_)
+    return;
+  use_sparse_distance_field_ = use_sparse_distance_field;
+  {
+    boost::mutex::scoped_lock slock(update_cache_lock_);
+    distance_field_cache_entry_.reset();
+    distance_field_cache_entries_.clear();
+  }
+  distance_field_cache_entry_world_ = generateDistanceFieldCacheEntryWorld();
+}
+
 CollisionEnvDistanceField::DistanceFieldCacheEntryWorldPtr
 CollisionEnvDistanceField::generateDistanceFieldCacheEntryWorld()
 {
   DistanceFieldCacheEntryWorldPtr dfce(new DistanceFieldCacheEntryWorld());
-  dfce->distance_field_.reset(new distance_field::PropagationDistanceField(
-      size_.x(), size_.y(), size_.z(), resolution_, origin_.x() - 0.5 * size_.x(), origin_.y() - 0.5 * size_.y(),
-      origin_.z() - 0.5 * size_.z(), max_propogation_distance_, use_signed_distance_field_));
+  dfce->distance_field_ = createDistanceField();
 
   EigenSTL::vector_Vector3d add_points;
   EigenSTL::vector_Vector3d subtract_points;
@@ -50,6 +50,7 @@ CollisionEnvHybrid::CollisionEnvHybrid(
   , cenv_distance_(new collision_detection::CollisionEnvDistanceField(
         robot_model, getWorld(), link_body_decompositions, size_x, size_y, size_z, origin, use_signed_distance_field,
         resolution, collision_tolerance, max_propogation_distance, padding, scale))
+  , check_mode_(HybridCheckModes::FCL_ONLY)
 {
 }
 
@@ -62,12 +63,14 @@ CollisionEnvHybrid::CollisionEnvHybrid(
   , cenv_distance_(new collision_detection::CollisionEnvDistanceField(
         robot_model, getWorld(), link_body_decompositions, size_x, size_y, size_z, origin, use_signed_distance_field,
         resolution, collision_tolerance, max_propogation_distance, padding, scale))
+  , check_mode_(HybridCheckModes::FCL_ONLY)
 {
 }
 
 CollisionEnvHybrid::CollisionEnvHybrid(const CollisionEnvHybrid& other, const WorldPtr& world)
   : CollisionEnvFCL(other, world)
   , cenv_distance_(new collision_detection::CollisionEnvDistanceField(*other.getCollisionWorldDistanceField(), world))
+  , check_mode_(other.check_mode_)
 {
 }
 
@@ -159,6 +162,66 @@ void CollisionEnvHybrid::checkRobotCollisionDistanceField(const CollisionRequest
   cenv_distance_->checkRobotCollision(req, res, state, acm, gsr);
 }
 
+bool CollisionEnvHybrid::useDistanceFieldFilter(const CollisionRequest& req) const
+{
+  return check_mode_ == HybridCheckModes::DISTANCE_FIELD_FILTER && !req.group_name.empty() && !req.contacts &&
+         !req.cost && !req.distance && getRobotModel()->hasJointModelGroup(req.group_name);
+}
+
+void CollisionEnvHybrid::checkSelfCollision(const CollisionRequest& req, CollisionResult& res,
+                                            const moveit::core::RobotState& state) const
+{
+  if (useDistanceFieldFilter(req))
+  {
+    CollisionResult filter_res;
+    cenv_distance_->checkSelfCollision(req, filter_res, state);
+    if (!filter_res.collision)
+      return;
+  }
+  CollisionEnvFCL::checkSelfCollision(req, res, state);
+}
+
+void CollisionEnvHybrid::checkSelfCollision(const CollisionRequest& req, CollisionResult& res,
+                                            const moveit::core::RobotState& state,
+                                            const AllowedCollisionMatrix& acm) const
+{
+  if (useDistanceFieldFilter(req))
+  {
+    CollisionResult filter_res;
+    cenv_distance_->checkSelfCollision(req, filter_res, state, acm);
+    if (!filter_res.collision)
+      return;
+  }
+  CollisionEnvFCL::checkSelfCollision(req, res, state, acm);
+}
+
+void CollisionEnvHybrid::checkRobotCollision(const CollisionRequest& req, CollisionResult& res,
+                                             const moveit::core::RobotState& state) const
+{
+  if (useDistanceFieldFilter(req))
+  {
+    CollisionResult filter_res;
+    cenv_distance_->checkRobotCollision(req, filter_res, state);
+    if (!filter_res.collision)
+      return;
+  }
+  CollisionEnvFCL::checkRobotCollision(req, res, state);
+}
+
+void CollisionEnvHybrid::checkRobotCollision(const CollisionRequest& req, CollisionResult& res,
+                                             const moveit::core::RobotState& state,
+                                             const AllowedCollisionMatrix& acm) const
+{
+  if (useDistanceFieldFilter(req))
+  {
+    CollisionResult filter_res;
+    cenv_distance_->checkRobotCollision(req, filter_res, state, acm);
+    if (!filter_res.collision)
+      return;
+  }
+  CollisionEnvFCL::checkRobotCollision(req, res, state, acm);
+}
+
 void CollisionEnvHybrid::setWorld(const WorldPtr& world)
 {
   if (world == getWorld())
@@ -39,6 +39,7 @@
 #include <moveit/transforms/transforms.h>
 #include <moveit/collision_distance_field/collision_distance_field_types.h>
 #include <moveit/collision_distance_field/collision_env_distance_field.h>
+#include <moveit/collision_distance_field/collision_env_hybrid.h>
 #include <moveit/utils/robot_model_test_utils.h>
 
 #include <geometric_shapes/shape_operations.h>
@@ -114,6 +115,170 @@ TEST_F(DistanceFieldCollisionDetectionTester, ChangeTorsoPosition)
   cenv_->checkSelfCollision(req, res1, robot_state, *acm_);
 }
 
+TEST_F(DistanceFieldCollisionDetectionTester, CacheEntriesPerGroup)
+{
+  auto cenv = std::static_pointer_cast<DefaultCEnvType>(cenv_);
+  moveit::core::RobotState robot_state(robot_model_);
+  robot_state.setToDefaultValues();
+  robot_state.update();
+
+  collision_detection::CollisionRequest req;
+  collision_detection::CollisionResult res;
+  req.group_name = "right_arm";
+  cenv->checkSelfCollision(req, res, robot_state, *acm_);
+  collision_detection::DistanceFieldCacheEntryConstPtr right_arm_entry = cenv->getLastDistanceFieldEntry();
+  ASSERT_TRUE(right_arm_entry);
+
+  req.group_name = "left_arm";
+  cenv->checkSelfCollision(req, res, robot_state, *acm_);
+  EXPECT_NE(cenv->getLastDistanceFieldEntry(), right_arm_entry);
+
+  // switching back reuses the entry of the right arm
+  req.group_name = "right_arm";
+  cenv->checkSelfCollision(req, res, robot_state, *acm_);
+  EXPECT_EQ(cenv->getLastDistanceFieldEntry(), right_arm_entry);
+
+  // with a single entry, the right arm entry is dropped when switching
+  cenv->setMaxDistanceFieldCacheEntries(1);
+  req.group_name = "left_arm";
+  cenv->checkSelfCollision(req, res, robot_state, *acm_);
+  req.group_name = "right_arm";
+  cenv->checkSelfCollision(req, res, robot_state, *acm_);
+  EXPECT_NE(cenv->getLastDistanceFieldEntry(), right_arm_entry);
+}
+
+TEST_F(DistanceFieldCollisionDetectionTester, CacheMemoryBudget)
+{
+  auto cenv = std::static_pointer_cast<DefaultCEnvType>(cenv_);
+  moveit::core::RobotState robot_state(robot_model_);
+  robot_state.setToDefaultValues();
+  robot_state.update();
+
+  const std::size_t world_bytes = cenv->getMemoryUsage();
+  collision_detection::CollisionRequest req;
+  collision_detection::CollisionResult res;
+  req.group_name = "right_arm";
+  cenv->checkSelfCollision(req, res, robot_state, *acm_);
+  collision_detection::DistanceFieldCacheEntryConstPtr right_arm_entry = cenv->getLastDistanceFieldEntry();
+  const std::size_t one_entry_bytes = cenv->getMemoryUsage();
+  EXPECT_GT(one_entry_bytes, world_bytes);
+
+  req.group_name = "left_arm";
+  cenv->checkSelfCollision(req, res, robot_state, *acm_);
+  const std::size_t two_entries_bytes = cenv->getMemoryUsage();
+  EXPECT_GT(two_entries_bytes, one_entry_bytes);
+
+  // a budget below both fields keeps only the most recent entry
+  cenv->setDistanceFieldCacheMemoryBudget(two_entries_bytes - world_bytes - 1);
+  EXPECT_LT(cenv->getMemoryUsage(), two_entries_bytes);
+  req.group_name = "right_arm";
+  cenv->checkSelfCollision(req, res, robot_state, *acm_);
+  EXPECT_NE(cenv->getLastDistanceFieldEntry(), right_arm_entry);
+}
+
+TEST_F(DistanceFieldCollisionDetectionTester, IncrementalCacheUpdate)
+{
+  auto cenv = std::static_pointer_cast<DefaultCEnvType>(cenv_);
+  moveit::core::RobotState robot_state(robot_model_);
+  robot_state.setToDefaultValues();
+  robot_state.update();
+
+  collision_detection::CollisionRequest req;
+  collision_detection::CollisionResult res;
+  req.group_name = "right_arm";
+  cenv->checkSelfCollision(req, res, robot_state, *acm_);
+
+  // moving the left arm only moves these links in the cached field
+  std::map<std::string, double> left_arm_val;
+  left_arm_val["l_shoulder_pan_joint"] = .5;
+  left_arm_val["l_elbow_flex_joint"] = -1.0;
+  robot_state.setVariablePositions(left_arm_val);
+  robot_state.update();
+  cenv->checkSelfCollision(req, res, robot_state, *acm_);
+  distance_field::DistanceFieldConstPtr updated_field = cenv->getDistanceField();
+
+  std::map<std::string, std::vector<collision_detection::CollisionSphere>> link_body_decompositions;
+  DefaultCEnvType fresh_cenv(robot_model_, link_body_decompositions);
+  fresh_cenv.checkSelfCollision(req, res, robot_state, *acm_);
+  distance_field::DistanceFieldConstPtr fresh_field = fresh_cenv.getDistanceField();
+
+  ASSERT_EQ(updated_field->getXNumCells(), fresh_field->getXNumCells());
+  ASSERT_EQ(updated_field->getYNumCells(), fresh_field->getYNumCells());
+  ASSERT_EQ(updated_field->getZNumCells(), fresh_field->getZNumCells());
+  for (int x = 0; x < fresh_field->getXNumCells(); x += 3)
+    for (int y = 0; y < fresh_field->getYNumCells(); y += 3)
+      for (int z = 0; z < fresh_field->getZNumCells(); z += 3)
+        ASSERT_EQ(updated_field->getDistance(x, y, z), fresh_field->getDistance(x, y, z));
+}
+
+TEST_F(DistanceFieldCollisionDetectionTester, BatchMatchesSingleChecks)
+{
+  const moveit::core::JointModelGroup* right_arm = robot_model_->getJointModelGroup("right_arm");
+  moveit::core::RobotState robot_state(robot_model_);
+  robot_state.setToDefaultValues();
+
+  // enough states for several chunks, with a torso change in the middle
+  std::vector<moveit::core::RobotState> states;
+  for (std::size_t i = 0; i < 200; ++i)
+  {
+    if (i == 100)
+      robot_state.setVariablePosition("torso_lift_joint", .15);
+    robot_state.setToRandomPositions(right_arm);
+    robot_state.update();
+    states.push_back(robot_state);
+  }
+  std::vector<const moveit::core::RobotState*> state_ptrs;
+  for (const moveit::core::RobotState& state : states)
+    state_ptrs.push_back(&state);
+
+  collision_detection::CollisionRequest req;
+  req.group_name = "right_arm";
+  std::vector<collision_detection::CollisionResult> batch_res;
+  cenv_->checkCollisionBatch(req, batch_res, state_ptrs, *acm_);
+  ASSERT_EQ(batch_res.size(), states.size());
+
+  for (std::size_t i = 0; i < states.size(); ++i)
+  {
+    collision_detection::CollisionResult res;
+    cenv_->checkCollision(req, res, states[i], *acm_);
+    EXPECT_EQ(batch_res[i].collision, res.collision) << "state " << i;
+  }
+}
+
+TEST_F(DistanceFieldCollisionDetectionTester, HybridFilterMatchesFCL)
+{
+  const moveit::core::JointModelGroup* right_arm = robot_model_->getJointModelGroup("right_arm");
+  std::map<std::string, std::vector<collision_detection::CollisionSphere>> link_body_decompositions;
+  collision_detection::CollisionEnvHybrid hybrid(robot_model_, link_body_decompositions);
+  collision_detection::AllowedCollisionMatrix acm(robot_model_->getLinkModelNames(), false);
+
+  moveit::core::RobotState robot_state(robot_model_);
+  robot_state.setToDefaultValues();
+  collision_detection::CollisionRequest req;
+  req.group_name = "right_arm";
+  for (std::size_t i = 0; i < 50; ++i)
+  {
+    robot_state.setToRandomPositions(right_arm);
+    robot_state.update();
+
+    collision_detection::CollisionResult fcl_res;
+    hybrid.setCheckMode(collision_detection::HybridCheckModes::FCL_ONLY);
+    hybrid.checkCollision(req, fcl_res, robot_state, acm);
+
+    // states the distance field reports in collision are decided by FCL
+    collision_detection::CollisionResult filter_res;
+    hybrid.setCheckMode(collision_detection::HybridCheckModes::DISTANCE_FIELD_FILTER);
+    hybrid.checkCollision(req, filter_res, robot_state, acm);
+
+    collision_detection::CollisionResult df_res;
+    hybrid.checkCollisionDistanceField(req, df_res, robot_state, acm);
+    if (df_res.collision)
+      EXPECT_EQ(filter_res.collision, fcl_res.collision) << "state " << i;
+    else
+      EXPECT_FALSE(filter_res.collision) << "state " << i;
+  }
+}
+
 TEST_F(DistanceFieldCollisionDetectionTester, LinksInCollision)
 {
   collision_detection::CollisionRequest req;
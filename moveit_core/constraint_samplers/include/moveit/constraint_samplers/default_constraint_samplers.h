@@ -37,6 +37,7 @@
 #pragma once
 
 #include <moveit/constraint_samplers/constraint_sampler.h>
+#include <moveit/kinematics_metrics/reachability_map.h>
 #include <moveit/macros/class_forward.h>
 #include <random_numbers/random_numbers.h>
 #include "rclcpp/rclcpp.hpp"
@@ -304,7 +305,7 @@ public:
    *
    */
   IKConstraintSampler(const planning_scene::PlanningSceneConstPtr& scene, const std::string& group_name)
-    : ConstraintSampler(scene, group_name)
+    : ConstraintSampler(scene, group_name), ik_thread_count_(1), reachability_base_link_(nullptr)
   {
   }
 
@@ -381,6 +382,55 @@ public:
     ik_timeout_ = timeout;
   }
 
+  /**
+   * \brief Gets the number of threads that run IK attempts concurrently
+   *
+   *
+   * @return The number of IK threads
+   */
+  unsigned int getIKThreadCount() const
+  {
+    return ik_thread_count_;
+  }
+
+  /**
+   * \brief Sets the number of threads that run IK attempts concurrently
+   *
+   * With more than one thread, sample() and project() run the attempts
+   * for different sampled poses and seeds in parallel, and stop all
+   * threads after the first valid solution.  Each thread uses its own
+   * solver instance, allocated by the solver allocator of the group.
+   * If the allocator does not provide separate instances, fewer
+   * threads are used.  The group state validity callback is called
+   * from all threads concurrently, so it must be thread safe.
+   *
+   * @param thread_count The number of threads, 1 for sequential attempts
+   */
+  void setIKThreadCount(unsigned int thread_count);
+
+  /**
+   * \brief Sets a precomputed reachability map that sampled poses are checked against
+   *
+   * Sampled poses that the map marks as unreachable are rejected
+   * before IK is called for them, as long as another pose can be
+   * sampled within the number of attempts.  The map is only used if
+   * its tip link is the constrained link.
+   *
+   * @param reachability_map The map, or nullptr to sample without a map
+   */
+  void setReachabilityMap(const kinematics_metrics::ReachabilityMapConstPtr& reachability_map);
+
+  /**
+   * \brief Gets the reachability map set with \ref setReachabilityMap()
+   *
+   *
+   * @return The reachability map, or nullptr
+   */
+  const kinematics_metrics::ReachabilityMapConstPtr& getReachabilityMap() const
+  {
+    return reachability_map_;
+  }
+
   /**
    * \brief Gets the position constraint associated with this sampler.
    *
@@ -510,8 +560,38 @@ protected:
   bool callIK(const geometry_msgs::msg::Pose& ik_query,
               const kinematics::KinematicsBase::IKCallbackFn& adapted_ik_validity_callback, double timeout,
               moveit::core::RobotState& state, bool use_as_seed);
+
+  /** \brief Calls IK as \ref callIK() does, with the given solver and random number generator for the seed */
+  bool callIK(const kinematics::KinematicsBase& solver, random_numbers::RandomNumberGenerator& rng,
+              const geometry_msgs::msg::Pose& ik_query,
+              const kinematics::KinematicsBase::IKCallbackFn& adapted_ik_validity_callback, double timeout,
+              moveit::core::RobotState& state, bool use_as_seed) const;
+
+  /** \brief Samples a pose as \ref samplePose() does, with the given random number generator */
+  bool samplePose(Eigen::Vector3d& pos, Eigen::Quaterniond& quat, const moveit::core::RobotState& ks,
+                  unsigned int max_attempts, random_numbers::RandomNumberGenerator& rng) const;
+
+  /** \brief Samples a pose within the constraints, without checking the reachability map */
+  bool sampleConstrainedPose(Eigen::Vector3d& pos, Eigen::Quaterniond& quat, const moveit::core::RobotState& ks,
+                             unsigned int max_attempts, random_numbers::RandomNumberGenerator& rng) const;
+
+  /** \brief Samples a pose and converts it to a query for the tip frame of the IK solver in its base frame */
+  bool sampleIKQuery(geometry_msgs::msg::Pose& ik_query, const moveit::core::RobotState& reference_state,
+                     unsigned int max_attempts, random_numbers::RandomNumberGenerator& rng) const;
+
   bool sampleHelper(moveit::core::RobotState& state, const moveit::core::RobotState& reference_state,
                     unsigned int max_attempts, bool project);
+
+  /** \brief Runs the attempts of \ref sampleHelper() on several threads, see \ref setIKThreadCount() */
+  bool sampleHelperParallel(moveit::core::RobotState& state, const moveit::core::RobotState& reference_state,
+                            unsigned int max_attempts, bool project);
+
+  /** \brief Allocates the additional solver instances for the IK threads */
+  void loadParallelIKSolvers();
+
+  /** \brief Checks that the reachability map applies to the constrained link */
+  void loadReachabilityMap();
+
   bool validate(moveit::core::RobotState& state) const;
 
   random_numbers::RandomNumberGenerator random_number_generator_; /**< \brief Random generator used by the sampler */
@@ -524,5 +604,14 @@ protected:
   bool need_eef_to_ik_tip_transform_; /**< \brief True if the tip frame of the inverse kinematic is different than the
                                         frame of the end effector */
   Eigen::Isometry3d eef_to_ik_tip_transform_; /**< \brief Holds the transformation from end effector to IK tip frame */
+  unsigned int ik_thread_count_;              /**< \brief The number of threads that run IK attempts */
+
+  /** \brief The solver instances of the additional IK threads */
+  std::vector<kinematics::KinematicsBaseConstPtr> ik_solvers_;
+
+  /** \brief The map sampled poses are checked against */
+  kinematics_metrics::ReachabilityMapConstPtr reachability_map_;
+  /** \brief The base link of the reachability map, nullptr if the map is not used */
+  const moveit::core::LinkModel* reachability_base_link_;
 };
 }  // namespace constraint_samplers
@@ -35,7 +35,12 @@
 /* Author: Ioan Sucan */
 
 #include <moveit/constraint_samplers/default_constraint_samplers.h>
+#include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <limits>
+#include <mutex>
+#include <thread>
 #include <boost/bind.hpp>
 
 namespace constraint_samplers
@@ -235,6 +240,8 @@ void IKConstraintSampler::clear()
   transform_ik_ = false;
   eef_to_ik_tip_transform_ = Eigen::Isometry3d::Identity();
   need_eef_to_ik_tip_transform_ = false;
+  ik_solvers_.clear();
+  reachability_base_link_ = nullptr;
 }
 
 bool IKConstraintSampler::configure(const IKSamplingPose& sp)
@@ -274,9 +281,73 @@ bool IKConstraintSampler::configure(const IKSamplingPose& sp)
     return false;
   }
   is_valid_ = loadIKSolver();
+  if (is_valid_)
+  {
+    loadParallelIKSolvers();
+    loadReachabilityMap();
+  }
   return is_valid_;
 }
 
+void IKConstraintSampler::setIKThreadCount(unsigned int thread_count)
+{
+  ik_thread_count_ = std::max(1u, thread_count);
+  if (is_valid_)
+    loadParallelIKSolvers();
+}
+
+void IKConstraintSampler::loadParallelIKSolvers()
+{
+  ik_solvers_.clear();
+  if (ik_thread_count_ <= 1)
+    return;
+
+  const moveit::core::SolverAllocatorFn& allocator = jmg_->getGroupKinematics().first.allocator_;
+  while (allocator && ik_solvers_.size() + 1 < ik_thread_count_)
+  {
+    // IK solvers keep internal state, so every thread needs a separate instance of the same solver
+    kinematics::KinematicsBaseConstPtr solver = allocator(jmg_);
+    if (!solver || solver == kb_ || std::find(ik_solvers_.begin(), ik_solvers_.end(), solver) != ik_solvers_.end() ||
+        solver->getBaseFrame() != kb_->getBaseFrame() || solver->getTipFrame() != kb_->getTipFrame())
+      break;
+    ik_solvers_.push_back(solver);
+  }
+  if (ik_solvers_.size() + 1 < ik_thread_count_)
+    RCLCPP_WARN(LOGGER,
+                "Only %zu separate IK solver instances could be allocated for group '%s'. "
+                "Using %zu threads instead of %u for IK sampling.",
+                ik_solvers_.size() + 1, jmg_->getName().c_str(), ik_solvers_.size() + 1, ik_thread_count_);
+}
+
+void IKConstraintSampler::setReachabilityMap(const kinematics_metrics::ReachabilityMapConstPtr& reachability_map)
+{
+  reachability_map_ = reachability_map;
+  if (is_valid_)
+    loadReachabilityMap();
+}
+
+void IKConstraintSampler::loadReachabilityMap()
+{
+  reachability_base_link_ = nullptr;
+  if (!reachability_map_)
+    return;
+
+  const moveit::core::LinkModel* link = sampling_pose_.position_constraint_ ?
+                                            sampling_pose_.position_constraint_->getLinkModel() :
+                                            sampling_pose_.orientation_constraint_->getLinkModel();
+  const moveit::core::LinkModel* base_link = scene_->getRobotModel()->getLinkModel(reachability_map_->getBaseLink());
+  if (reachability_map_->getTipLink() != link->getName() || !base_link || jmg_->isLinkUpdated(base_link->getName()))
+  {
+    RCLCPP_WARN(LOGGER,
+                "Reachability map for link '%s' relative to '%s' does not apply to constrained link '%s' of group "
+                "'%s'. Sampling without the map.",
+                reachability_map_->getTipLink().c_str(), reachability_map_->getBaseLink().c_str(),
+                link->getName().c_str(), jmg_->getName().c_str());
+    return;
+  }
+  reachability_base_link_ = base_link;
+}
+
 bool IKConstraintSampler::configure(const moveit_msgs::msg::Constraints& constr)
 {
   for (std::size_t p = 0; p < constr.position_constraints.size(); ++p)
@@ -413,6 +484,12 @@ bool IKConstraintSampler::loadIKSolver()
 
 bool IKConstraintSampler::samplePose(Eigen::Vector3d& pos, Eigen::Quaterniond& quat, const moveit::core::RobotState& ks,
                                      unsigned int max_attempts)
+{
+  return samplePose(pos, quat, ks, max_attempts, random_number_generator_);
+}
+
+bool IKConstraintSampler::samplePose(Eigen::Vector3d& pos, Eigen::Quaterniond& quat, const moveit::core::RobotState& ks,
+                                     unsigned int max_attempts, random_numbers::RandomNumberGenerator& rng) const
 {
   if (ks.dirtyLinkTransforms())
   {
@@ -422,15 +499,37 @@ bool IKConstraintSampler::samplePose(Eigen::Vector3d& pos, Eigen::Quaterniond& q
     return false;
   }
 
+  if (!reachability_base_link_)
+    return sampleConstrainedPose(pos, quat, ks, max_attempts, rng);
+
+  // the map is an approximation at its resolution, so if no pose it marks reachable is found, the last pose is tried
+  const Eigen::Isometry3d base_inverse = ks.getGlobalLinkTransform(reachability_base_link_).inverse();
+  for (unsigned int a = 0; a < max_attempts; ++a)
+  {
+    if (!sampleConstrainedPose(pos, quat, ks, max_attempts, rng))
+      return false;
+    const Eigen::Isometry3d pose = base_inverse * (Eigen::Translation3d(pos) * quat);
+    // without an orientation constraint, IK is free to search for any reachable orientation
+    if (sampling_pose_.orientation_constraint_ ? reachability_map_->isReachable(pose) :
+                                                 reachability_map_->isReachable(Eigen::Vector3d(pose.translation())))
+      return true;
+  }
+  return true;
+}
+
+bool IKConstraintSampler::sampleConstrainedPose(Eigen::Vector3d& pos, Eigen::Quaterniond& quat,
+                                                const moveit::core::RobotState& ks, unsigned int max_attempts,
+                                                random_numbers::RandomNumberGenerator& rng) const
+{
   if (sampling_pose_.position_constraint_)
   {
     const std::vector<bodies::BodyPtr>& b = sampling_pose_.position_constraint_->getConstraintRegions();
     if (!b.empty())
     {
       bool found = false;
-      std::size_t k = random_number_generator_.uniformInteger(0, b.size() - 1);
+      std::size_t k = rng.uniformInteger(0, b.size() - 1);
       for (std::size_t i = 0; i < b.size(); ++i)
-        if (b[(i + k) % b.size()]->samplePointInside(random_number_generator_, max_attempts, pos))
+        if (b[(i + k) % b.size()]->samplePointInside(rng, max_attempts, pos))
         {
           found = true;
           break;
@@ -465,13 +564,13 @@ bool IKConstraintSampler::samplePose(Eigen::Vector3d& pos, Eigen::Quaterniond& q
   {
     // sample a rotation matrix within the allowed bounds
     double angle_x =
-        2.0 * (random_number_generator_.uniform01() - 0.5) *
+        2.0 * (rng.uniform01() - 0.5) *
         (sampling_pose_.orientation_constraint_->getXAxisTolerance() - std::numeric_limits<double>::epsilon());
     double angle_y =
-        2.0 * (random_number_generator_.uniform01() - 0.5) *
+        2.0 * (rng.uniform01() - 0.5) *
         (sampling_pose_.orientation_constraint_->getYAxisTolerance() - std::numeric_limits<double>::epsilon());
     double angle_z =
-        2.0 * (random_number_generator_.uniform01() - 0.5) *
+        2.0 * (rng.uniform01() - 0.5) *
         (sampling_pose_.orientation_constraint_->getZAxisTolerance() - std::numeric_limits<double>::epsilon());
     Eigen::Isometry3d diff(Eigen::AngleAxisd(angle_x, Eigen::Vector3d::UnitX()) *
                            Eigen::AngleAxisd(angle_y, Eigen::Vector3d::UnitY()) *
@@ -497,7 +596,7 @@ bool IKConstraintSampler::samplePose(Eigen::Vector3d& pos, Eigen::Quaterniond& q
   {
     // sample a random orientation
     double q[4];
-    random_number_generator_.quaternion(q);
+    rng.quaternion(q);
     quat = Eigen::Quaterniond(q[3], q[0], q[1], q[2]);  // quat is normalized by contract
   }
 
@@ -542,6 +641,9 @@ bool IKConstraintSampler::sampleHelper(moveit::core::RobotState& state, const mo
     return false;
   }
 
+  if (!ik_solvers_.empty() && max_attempts > 1)
+    return sampleHelperParallel(state, reference_state, max_attempts, project);
+
   kinematics::KinematicsBase::IKCallbackFn adapted_ik_validity_callback;
   if (group_state_validity_callback_)
     adapted_ik_validity_callback =
@@ -549,50 +651,121 @@ bool IKConstraintSampler::sampleHelper(moveit::core::RobotState& state, const mo
 
   for (unsigned int a = 0; a < max_attempts; ++a)
   {
-    // sample a point in the constraint region
-    Eigen::Vector3d point;
-    Eigen::Quaterniond quat;  // quat is normalized by contract
-    if (!samplePose(point, quat, reference_state, max_attempts))
-    {
-      if (verbose_)
-        RCLCPP_INFO(LOGGER, "IK constraint sampler was unable to produce a pose to run IK for");
+    geometry_msgs::msg::Pose ik_query;
+    if (!sampleIKQuery(ik_query, reference_state, max_attempts, random_number_generator_))
       return false;
-    }
 
-    // we now have the transform we wish to perform IK for, in the planning frame
-    if (transform_ik_)
-    {
-      // we need to convert this transform to the frame expected by the IK solver
-      // both the planning frame and the frame for the IK are assumed to be robot links
-      Eigen::Isometry3d ikq(Eigen::Translation3d(point) * quat);  // valid isometry by construction
-      // getFrameTransform() returns a valid isometry by contract
-      ikq = reference_state.getFrameTransform(ik_frame_).inverse() * ikq;  // valid isometry * valid isometry
-      point = ikq.translation();
-      quat = Eigen::Quaterniond(ikq.linear());  // ikq is isometry, so quat is normalized
-    }
+    if (callIK(ik_query, adapted_ik_validity_callback, ik_timeout_, state, project && a == 0))
+      return true;
+  }
+  return false;
+}
 
-    if (need_eef_to_ik_tip_transform_)
+bool IKConstraintSampler::sampleHelperParallel(moveit::core::RobotState& state,
+                                               const moveit::core::RobotState& reference_state,
+                                               unsigned int max_attempts, bool project)
+{
+  const std::size_t thread_count = std::min<std::size_t>(ik_solvers_.size() + 1, max_attempts);
+
+  // each thread gets its own generator, seeded from the sampler's generator
+  std::vector<boost::uint32_t> seeds(thread_count);
+  for (boost::uint32_t& seed : seeds)
+    seed = random_number_generator_.uniformInteger(0, std::numeric_limits<int>::max());
+
+  std::atomic<unsigned int> next_attempt(0);
+  std::atomic<bool> done(false);  // set by the first solution, or if no pose can be sampled
+  std::mutex solution_lock;
+  std::vector<double> solution;
+
+  auto run_attempts = [&](std::size_t t) {
+    const kinematics::KinematicsBase& solver = t == 0 ? *kb_ : *ik_solvers_[t - 1];
+    random_numbers::RandomNumberGenerator rng(seeds[t]);
+    moveit::core::RobotState thread_state(state);
+    kinematics::KinematicsBase::IKCallbackFn adapted_ik_validity_callback;
+    if (group_state_validity_callback_)
+      adapted_ik_validity_callback =
+          boost::bind(&samplingIkCallbackFnAdapter, &thread_state, jmg_, group_state_validity_callback_, _1, _2, _3);
+
+    // attempts are numbered globally, so that only the first one uses the state as seed when projecting
+    for (unsigned int a = next_attempt++; !done && a < max_attempts; a = next_attempt++)
     {
-      // After sampling the pose needs to be transformed to the ik chain tip
-      Eigen::Isometry3d ikq(Eigen::Translation3d(point) * quat);  // valid isometry by construction
-      ikq = ikq * eef_to_ik_tip_transform_;  // eef_to_ik_tip_transform_ is valid isometry (checked in loadIKSolver())
-      point = ikq.translation();
-      quat = Eigen::Quaterniond(ikq.linear());  // ikq is isometry, so quat is normalized
+      geometry_msgs::msg::Pose ik_query;
+      if (!sampleIKQuery(ik_query, reference_state, max_attempts, rng))
+      {
+        done = true;
+        return;
+      }
+
+      // IK calls that are already running when another thread succeeds end with their timeout
+      if (callIK(solver, rng, ik_query, adapted_ik_validity_callback, ik_timeout_, thread_state, project && a == 0))
+      {
+        std::lock_guard<std::mutex> slock(solution_lock);
+        if (solution.empty())
+          thread_state.copyJointGroupPositions(jmg_, solution);
+        done = true;
+        return;
+      }
     }
+  };
 
-    geometry_msgs::msg::Pose ik_query;
-    ik_query.position.x = point.x();
-    ik_query.position.y = point.y();
-    ik_query.position.z = point.z();
-    ik_query.orientation.x = quat.x();
-    ik_query.orientation.y = quat.y();
-    ik_query.orientation.z = quat.z();
-    ik_query.orientation.w = quat.w();
+  std::vector<std::thread> threads;
+  threads.reserve(thread_count - 1);
+  for (std::size_t t = 1; t < thread_count; ++t)
+    threads.emplace_back(run_attempts, t);
+  run_attempts(0);
+  for (std::thread& thread : threads)
+    thread.join();
 
-    if (callIK(ik_query, adapted_ik_validity_callback, ik_timeout_, state, project && a == 0))
-      return true;
+  if (solution.empty())
+    return false;
+  state.setJointGroupPositions(jmg_, solution);
+  state.update();
+  return true;
+}
+
+bool IKConstraintSampler::sampleIKQuery(geometry_msgs::msg::Pose& ik_query,
+                                        const moveit::core::RobotState& reference_state, unsigned int max_attempts,
+                                        random_numbers::RandomNumberGenerator& rng) const
+{
+  // sample a point in the constraint region
+  Eigen::Vector3d point;
+  Eigen::Quaterniond quat;  // quat is normalized by contract
+  if (!samplePose(point, quat, reference_state, max_attempts, rng))
+  {
+    if (verbose_)
+      RCLCPP_INFO(LOGGER, "IK constraint sampler was unable to produce a pose to run IK for");
+    return false;
   }
-  return false;
+
+  // we now have the transform we wish to perform IK for, in the planning frame
+  if (transform_ik_)
+  {
+    // we need to convert this transform to the frame expected by the IK solver
+    // both the planning frame and the frame for the IK are assumed to be robot links
+    Eigen::Isometry3d ikq(Eigen::Translation3d(point) * quat);  // valid isometry by construction
+    // getFrameTransform() returns a valid isometry by contract
+    ikq = reference_state.getFrameTransform(ik_frame_).inverse() * ikq;  // valid isometry * valid isometry
+    point = ikq.translation();
+    quat = Eigen::Quaterniond(ikq.linear());  // ikq is isometry, so quat is normalized
+  }
+
+  if (need_eef_to_ik_tip_transform_)
+  {
+    // After sampling the pose needs to be transformed to the ik chain tip
+    Eigen::Isometry3d ikq(Eigen::Translation3d(point) * quat);  // valid isometry by construction
+    ikq = ikq * eef_to_ik_tip_transform_;  // eef_to_ik_tip_transform_ is valid isometry (checked in loadIKSolver())
+    point = ikq.translation();
+    quat = Eigen::Quaterniond(ikq.linear());  // ikq is isometry, so quat is normalized
+  }
+
+  ik_query.position.x = point.x();
+  ik_query.position.y = point.y();
+  ik_query.position.z = point.z();
+  ik_query.orientation.x = quat.x();
+  ik_query.orientation.y = quat.y();
+  ik_query.orientation.z = quat.z();
+  ik_query.orientation.w = quat.w();
+  return true;
 }
 
 bool IKConstraintSampler::project(moveit::core::RobotState& state, unsigned int max_attempts)
@@ -612,6 +785,14 @@ bool IKConstraintSampler::validate(moveit::core::RobotState& state) const
 bool IKConstraintSampler::callIK(const geometry_msgs::msg::Pose& ik_query,
                                  const kinematics::KinematicsBase::IKCallbackFn& adapted_ik_validity_callback,
                                  double timeout, moveit::core::RobotState& state, bool use_as_seed)
+{
+  return callIK(*kb_, random_number_generator_, ik_query, adapted_ik_validity_callback, timeout, state, use_as_seed);
+}
+
+bool IKConstraintSampler::callIK(const kinematics::KinematicsBase& solver, random_numbers::RandomNumberGenerator& rng,
+                                 const geometry_msgs::msg::Pose& ik_query,
+                                 const kinematics::KinematicsBase::IKCallbackFn& adapted_ik_validity_callback,
+                                 double timeout, moveit::core::RobotState& state, bool use_as_seed) const
 {
   const std::vector<unsigned int>& ik_joint_bijection = jmg_->getKinematicsSolverJointBijection();
   std::vector<double> seed(ik_joint_bijection.size(), 0.0);
@@ -621,7 +802,7 @@ bool IKConstraintSampler::callIK(const geometry_msgs::msg::Pose& ik_query,
     state.copyJointGroupPositions(jmg_, vals);
   else
     // sample a seed value
-    jmg_->getVariableRandomPositions(random_number_generator_, vals);
+    jmg_->getVariableRandomPositions(rng, vals);
 
   assert(vals.size() == ik_joint_bijection.size());
   for (std::size_t i = 0; i < ik_joint_bijection.size(); ++i)
@@ -631,8 +812,8 @@ bool IKConstraintSampler::callIK(const geometry_msgs::msg::Pose& ik_query,
   moveit_msgs::msg::MoveItErrorCodes error;
 
   if (adapted_ik_validity_callback ?
-          kb_->searchPositionIK(ik_query, seed, timeout, ik_sol, adapted_ik_validity_callback, error) :
-          kb_->searchPositionIK(ik_query, seed, timeout, ik_sol, error))
+          solver.searchPositionIK(ik_query, seed, timeout, ik_sol, adapted_ik_validity_callback, error) :
+          solver.searchPositionIK(ik_query, seed, timeout, ik_sol, error))
   {
     assert(ik_sol.size() == ik_joint_bijection.size());
     std::vector<double> solution(ik_joint_bijection.size());
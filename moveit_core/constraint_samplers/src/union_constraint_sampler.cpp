@@ -128,7 +128,9 @@ UnionConstraintSampler::UnionConstraintSampler(const planning_scene::PlanningSce
 bool UnionConstraintSampler::sample(moveit::core::RobotState& state, const moveit::core::RobotState& reference_state,
                                     unsigned int max_attempts)
 {
-  state = reference_state;
+  // like the other samplers, only write values; copying the whole reference state would copy transforms and
+  // attached bodies for every sample
+  state.copyPositionsFrom(reference_state);
   state.setToRandomPositions(jmg_);
 
   if (!samplers_.empty())
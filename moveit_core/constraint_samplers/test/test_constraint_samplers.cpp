@@ -40,6 +40,7 @@
 #include <moveit/constraint_samplers/union_constraint_sampler.h>
 #include <moveit/constraint_samplers/constraint_sampler_manager.h>
 #include <moveit/constraint_samplers/constraint_sampler_tools.h>
+#include <moveit/kinematics_metrics/kinematics_metrics.h>
 #include <moveit/robot_state/conversions.h>
 #include <moveit/utils/robot_model_test_utils.h>
 
@@ -49,6 +50,7 @@
 #include <gtest/gtest.h>
 #include <urdf_parser/urdf_parser.h>
 #include <fstream>
+#include <sstream>
 #include <boost/bind.hpp>
 
 #include "pr2_arm_kinematics_plugin.h"
@@ -438,6 +440,142 @@ TEST_F(LoadPlanningModelsPr2, IKConstraintsSamplerValid)
   }
 }
 
+TEST_F(LoadPlanningModelsPr2, IKConstraintsSamplerParallel)
+{
+  // every call allocates a separate solver instance, as the kinematics plugin loader does for non-unique solvers
+  std::map<std::string, moveit::core::SolverAllocatorFn> allocators;
+  allocators["left_arm"] = [this](const moveit::core::JointModelGroup* /*jmg*/) -> kinematics::KinematicsBasePtr {
+    pr2_arm_kinematics::PR2ArmKinematicsPluginPtr solver(new pr2_arm_kinematics::PR2ArmKinematicsPlugin);
+    solver->initialize(node_, *robot_model_, "left_arm", "torso_lift_link", { "l_wrist_roll_link" }, .01);
+    return solver;
+  };
+  robot_model_->setKinematicsAllocators(allocators);
+
+  moveit::core::RobotState ks(robot_model_);
+  ks.setToDefaultValues();
+  ks.update();
+  moveit::core::RobotState ks_const(robot_model_);
+  ks_const.setToDefaultValues();
+  ks_const.update();
+
+  kinematic_constraints::PositionConstraint pc(robot_model_);
+  moveit_msgs::msg::PositionConstraint pcm;
+  pcm.link_name = "l_wrist_roll_link";
+  pcm.constraint_region.primitives.resize(1);
+  pcm.constraint_region.primitives[0].type = shape_msgs::msg::SolidPrimitive::SPHERE;
+  pcm.constraint_region.primitives[0].dimensions.resize(1);
+  pcm.constraint_region.primitives[0].dimensions[0] = 0.001;
+  pcm.header.frame_id = robot_model_->getModelFrame();
+  pcm.constraint_region.primitive_poses.resize(1);
+  pcm.constraint_region.primitive_poses[0].position.x = 0.55;
+  pcm.constraint_region.primitive_poses[0].position.y = 0.2;
+  pcm.constraint_region.primitive_poses[0].position.z = 1.25;
+  pcm.constraint_region.primitive_poses[0].orientation.w = 1.0;
+  pcm.weight = 1.0;
+  EXPECT_TRUE(pc.configure(pcm, ps_->getTransforms()));
+
+  constraint_samplers::IKConstraintSampler iks(ps_, "left_arm");
+  EXPECT_EQ(iks.getIKThreadCount(), 1u);
+  iks.setIKThreadCount(4);
+  EXPECT_EQ(iks.getIKThreadCount(), 4u);
+  EXPECT_TRUE(iks.configure(constraint_samplers::IKSamplingPose(pc)));
+  for (int t = 0; t < 100; ++t)
+  {
+    EXPECT_TRUE(iks.sample(ks, ks_const, 100));
+    EXPECT_TRUE(pc.decide(ks).satisfied);
+  }
+
+  // projecting a state that already satisfies the constraint keeps it satisfied
+  EXPECT_TRUE(iks.project(ks, 100));
+  EXPECT_TRUE(pc.decide(ks).satisfied);
+}
+
+TEST_F(LoadPlanningModelsPr2, IKConstraintsSamplerReachabilityMap)
+{
+  moveit::core::RobotState ks(robot_model_);
+  ks.setToDefaultValues();
+  ks.update();
+  moveit::core::RobotState ks_const(robot_model_);
+  ks_const.setToDefaultValues();
+  ks_const.update();
+
+  const moveit::core::JointModelGroup* jmg = robot_model_->getJointModelGroup("left_arm");
+  random_numbers::RandomNumberGenerator rng(7);
+  kinematics_metrics::ReachabilityMap computed_map;
+  moveit::core::RobotState map_state(ks_const);
+  EXPECT_FALSE(computed_map.compute(map_state, jmg, "l_shoulder_pan_link", "l_wrist_roll_link", 0.05, 100, rng));
+  ASSERT_TRUE(computed_map.compute(map_state, jmg, "torso_lift_link", "l_wrist_roll_link", 0.05, 20000, rng));
+  EXPECT_FALSE(computed_map.empty());
+  EXPECT_FALSE(computed_map.isReachable(Eigen::Vector3d(5.0, 0.0, 0.0)));
+
+  // the file format keeps all reachable voxels
+  std::stringstream stream;
+  EXPECT_TRUE(computed_map.writeToStream(stream));
+  kinematics_metrics::ReachabilityMapPtr map(new kinematics_metrics::ReachabilityMap());
+  EXPECT_TRUE(map->readFromStream(stream));
+  EXPECT_EQ(map->getGroupName(), "left_arm");
+  EXPECT_EQ(map->getBaseLink(), "torso_lift_link");
+  EXPECT_EQ(map->getTipLink(), "l_wrist_roll_link");
+  for (int t = 0; t < 100; ++t)
+  {
+    const Eigen::Vector3d position = Eigen::Vector3d::Random();
+    EXPECT_EQ(map->getOrientationCount(position), computed_map.getOrientationCount(position));
+  }
+
+  std::stringstream truncated(stream.str().substr(0, stream.str().size() / 2));
+  kinematics_metrics::ReachabilityMap truncated_map;
+  EXPECT_FALSE(truncated_map.readFromStream(truncated));
+  EXPECT_TRUE(truncated_map.empty());
+
+  // the last state sampled for the map is recorded, so it has a non-zero reachability index
+  kinematics_metrics::KinematicsMetrics metrics(robot_model_);
+  double reachability_index = 0.0;
+  EXPECT_FALSE(metrics.getReachabilityIndex(map_state, "left_arm", reachability_index));
+  metrics.setReachabilityMap(map);
+  EXPECT_TRUE(metrics.getReachabilityIndex(map_state, "left_arm", reachability_index));
+  EXPECT_GT(reachability_index, 0.0);
+  EXPECT_LE(reachability_index, 1.0);
+
+  kinematic_constraints::PositionConstraint pc(robot_model_);
+  moveit_msgs::msg::PositionConstraint pcm;
+  pcm.link_name = "l_wrist_roll_link";
+  pcm.constraint_region.primitives.resize(1);
+  pcm.constraint_region.primitives[0].type = shape_msgs::msg::SolidPrimitive::BOX;
+  pcm.constraint_region.primitives[0].dimensions.resize(3);
+  pcm.constraint_region.primitives[0].dimensions[0] = 2.0;
+  pcm.constraint_region.primitives[0].dimensions[1] = 2.0;
+  pcm.constraint_region.primitives[0].dimensions[2] = 2.0;
+  pcm.header.frame_id = robot_model_->getModelFrame();
+  pcm.constraint_region.primitive_poses.resize(1);
+  pcm.constraint_region.primitive_poses[0].position.x = 0.55;
+  pcm.constraint_region.primitive_poses[0].position.y = 0.2;
+  pcm.constraint_region.primitive_poses[0].position.z = 1.25;
+  pcm.constraint_region.primitive_poses[0].orientation.w = 1.0;
+  pcm.weight = 1.0;
+  EXPECT_TRUE(pc.configure(pcm, ps_->getTransforms()));
+
+  constraint_samplers::IKConstraintSampler iks(ps_, "left_arm");
+  iks.setReachabilityMap(map);
+  EXPECT_EQ(iks.getReachabilityMap(), map);
+  EXPECT_TRUE(iks.configure(constraint_samplers::IKSamplingPose(pc)));
+  for (int t = 0; t < 100; ++t)
+  {
+    EXPECT_TRUE(iks.sample(ks, ks_const, 100));
+    EXPECT_TRUE(pc.decide(ks).satisfied);
+  }
+
+  // a map of another link is ignored
+  kinematics_metrics::ReachabilityMapPtr other_map(new kinematics_metrics::ReachabilityMap());
+  ASSERT_TRUE(other_map->compute(map_state, robot_model_->getJointModelGroup("right_arm"), "torso_lift_link",
+                                 "r_wrist_roll_link", 0.05, 100, rng));
+  iks.setReachabilityMap(other_map);
+  for (int t = 0; t < 10; ++t)
+  {
+    EXPECT_TRUE(iks.sample(ks, ks_const, 100));
+    EXPECT_TRUE(pc.decide(ks).satisfied);
+  }
+}
+
 TEST_F(LoadPlanningModelsPr2, UnionConstraintSampler)
 {
   moveit::core::RobotState ks(robot_model_);
@@ -36,9 +36,11 @@
 
 #pragma once
 
+#include <functional>
 #include <vector>
 #include <string>
 #include <moveit_msgs/msg/robot_trajectory.hpp>
+#include <sensor_msgs/msg/joint_state.hpp>
 #include <moveit/macros/class_forward.h>
 #include "rclcpp/rclcpp.hpp"
 
@@ -127,6 +129,17 @@ public:
    * Return false when the controller cannot accept the trajectory. */
   virtual bool sendTrajectory(const moveit_msgs::msg::RobotTrajectory& trajectory) = 0;
 
+  /** \brief Append a chunk to the trajectory currently being executed.
+   *
+   * The points of \e trajectory are timed relative to the start of the trajectory previously passed to
+   * sendTrajectory() and must follow its last point. The controller (or this handle) is expected to buffer the chunk
+   * and continue the motion without stopping in between. This function call should not block.
+   * Return false when the controller cannot extend the executing trajectory; this is the default. */
+  virtual bool appendTrajectory(const moveit_msgs::msg::RobotTrajectory& /*trajectory*/)
+  {
+    return false;
+  }
+
   /** \brief Cancel the execution of any motion using this controller.
    *
    * Report false if canceling is not possible.
@@ -209,5 +222,15 @@ public:
   /** \brief Activate and deactivate controllers */
   virtual bool switchControllers(const std::vector<std::string>& activate,
                                  const std::vector<std::string>& deactivate) = 0;
+
+  /** \brief Receives joint states, e.g. to update the current state monitor of the process */
+  using JointStateCallback = std::function<void(const sensor_msgs::msg::JointState::ConstSharedPtr&)>;
+
+  /** \brief Controller managers simulating the robot within the process may pass their joint states
+      to \e callback directly, instead of a round trip over the joint states topic. The default
+      implementation ignores the callback. */
+  virtual void setJointStateCallback(const JointStateCallback& /*callback*/)
+  {
+  }
 };
 }  // namespace moveit_controller_manager
@@ -0,0 +1,190 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, PickNik LLC
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik LLC nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#pragma once
+
+#include <moveit/distance_field/voxel_grid.h>
+#include <moveit/distance_field/distance_field.h>
+#include <cstdint>
+#include <vector>
+
+namespace distance_field
+{
+/**
+ * \brief A DistanceField implementation that only stores a 16 bit
+ * squared distance per cell.
+ *
+ * A \ref PropagationDistanceField keeps the closest obstacle cell and
+ * the propagation state of each cell for both positive and negative
+ * distances, which amounts to 40 bytes per cell.  This class only
+ * stores the squared distance in cells to the closest obstacle cell,
+ * and optionally to the closest unoccupied cell, in 2 bytes each.
+ * Without closest points, it cannot update distances incrementally:
+ * every change recomputes the exact Euclidean distances of the whole
+ * field in parallel.  It is best suited for large fields that are
+ * filled once and then queried, e.g. the fields built for each motion
+ * planning request.
+ *
+ * The maximum distance is limited to 255 cells, so that the squared
+ * distances fit in 16 bits.  Distances and gradients are the same as
+ * those of a \ref PropagationDistanceField with parallel recomputation
+ * enabled.
+ */
+class CompactDistanceField : public DistanceField
+{
+public:
+  /**
+   * \brief Constructor that initializes entire distance field to
+   * empty - all cells will be assigned maximum distance values.
+   *
+   * @param [in] size_x The X dimension in meters of the volume to represent
+   * @param [in] size_y The Y dimension in meters of the volume to represent
+   * @param [in] size_z The Z dimension in meters of the volume to represent
+   * @param [in] resolution The resolution in meters of the volume
+   * @param [in] origin_x The minimum X point of the volume
+   * @param [in] origin_y The minimum Y point of the volume
+   * @param [in] origin_z The minimum Z point of the volume
+   *
+   * @param [in] max_distance The maximum distance to compute.  Cells
+   * that are further away from the closest obstacle are assigned this
+   * distance.  It is reduced to 255 cells if larger.
+   *
+   * @param [in] compute_negative_distances Whether to store the
+   * distances of obstacle cells to the closest unoccupied cell, which
+   * doubles the memory usage.  If false, all obstacle cells have zero
+   * distance.
+   */
+  CompactDistanceField(double size_x, double size_y, double size_z, double resolution, double origin_x,
+                       double origin_y, double origin_z, double max_distance, bool compute_negative_distances = false);
+
+  void addPointsToField(const EigenSTL::vector_Vector3d& points) override;
+
+  void removePointsFromField(const EigenSTL::vector_Vector3d& points) override;
+
+  /**
+   * \brief Remove the old points and add the new points in a single
+   * recomputation of the field
+   */
+  void updatePointsInField(const EigenSTL::vector_Vector3d& old_points,
+                           const EigenSTL::vector_Vector3d& new_points) override;
+
+  void reset() override;
+
+  double getDistance(double x, double y, double z) const override;
+
+  double getDistance(int x, int y, int z) const override;
+
+  bool isCellValid(int x, int y, int z) const override;
+  int getXNumCells() const override;
+  int getYNumCells() const override;
+  int getZNumCells() const override;
+  std::size_t getMemoryUsage() const override;
+  bool gridToWorld(int x, int y, int z, double& world_x, double& world_y, double& world_z) const override;
+  bool worldToGrid(double world_x, double world_y, double world_z, int& x, int& y, int& z) const override;
+
+  /**
+   * \brief Writes the obstacle cells to a stream, in the format of
+   * \ref PropagationDistanceField::writeToStream
+   */
+  bool writeToStream(std::ostream& stream) const override;
+
+  /**
+   * \brief Reads and recomputes the field from a stream written by
+   * \ref writeToStream or \ref PropagationDistanceField::writeToStream.
+   * The current maximum distance and whether to compute negative
+   * distances are kept.
+   */
+  bool readFromStream(std::istream& stream) override;
+
+  double getUninitializedDistance() const override
+  {
+    return max_distance_;
+  }
+
+  /**
+   * \brief Gets the squared distance in cells of a cell to the
+   * closest obstacle cell, zero for obstacle cells.  The cell must be
+   * valid.
+   */
+  int getDistanceSquared(int x, int y, int z) const
+  {
+    return distance_sq_->getCell(x, y, z);
+  }
+
+  /**
+   * \brief Gets the squared distance in cells of a cell to the
+   * closest unoccupied cell, zero for unoccupied cells and if
+   * negative distances are not computed.  The cell must be valid.
+   */
+  int getNegativeDistanceSquared(int x, int y, int z) const
+  {
+    return compute_negative_ ? negative_distance_sq_->getCell(x, y, z) : 0;
+  }
+
+  int getMaximumDistanceSquared() const
+  {
+    return max_distance_sq_;
+  }
+
+private:
+  /** \brief Allocate the grids for the current size, resolution and origin */
+  void initialize();
+
+  /** \brief Set the cells of the valid points to the given squared distance */
+  void setCells(const EigenSTL::vector_Vector3d& points, std::uint16_t distance_sq);
+
+  /**
+   * \brief Recompute all distances from the obstacle cells, which are
+   * the cells with zero squared distance
+   */
+  void recompute();
+
+  /**
+   * \brief Replace the values of the grid by the squared distances to
+   * the closest cell with zero value, limited to the maximum distance
+   */
+  void computeDistanceTransform(VoxelGrid<std::uint16_t>& grid) const;
+
+  bool compute_negative_; /**< \brief Whether negative distances are stored */
+  double max_distance_;   /**< \brief Maximum distance in meters */
+  int max_distance_sq_;   /**< \brief Maximum squared distance in cells */
+
+  VoxelGrid<std::uint16_t>::Ptr distance_sq_; /**< \brief Squared distances in cells to the closest obstacle cell */
+  VoxelGrid<std::uint16_t>::Ptr negative_distance_sq_; /**< \brief Squared distances in cells to the closest
+                                                            unoccupied cell, null if negative distances are not
+                                                            computed */
+
+  std::vector<double> sqrt_table_; /**< \brief Distance in meters for each squared distance in cells */
+};
+}  // namespace distance_field
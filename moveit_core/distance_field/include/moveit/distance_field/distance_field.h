@@ -321,6 +321,22 @@ public:
    */
   double getDistanceGradient(double x, double y, double z, double& gradient_x, double& gradient_y, double& gradient_z,
                              bool& in_bounds) const;
+
+  /**
+   * \brief Computes getDistanceGradient() for a batch of points.
+   *
+   * Points for which getDistanceGradient() reports that they are not
+   * in bounds get getUninitializedDistance() and a zero gradient.
+   * Derived classes can override this to look up the cells directly
+   * instead of through one virtual call per cell.
+   *
+   * @param [in] points The locations to query
+   * @param [in] count The number of points
+   * @param [out] distances The distance for each point, of size \e count
+   * @param [out] gradients The gradient for each point, of size \e count
+   */
+  virtual void getDistanceGradients(const Eigen::Vector3d* points, std::size_t count, double* distances,
+                                    Eigen::Vector3d* gradients) const;
   /**
    * \brief Gets the distance to the closest obstacle at the given
    * integer cell location. The particulars of this function are
@@ -370,6 +386,14 @@ public:
    */
   virtual int getZNumCells() const = 0;
 
+  /**
+   * \brief Gets an estimate of the memory held by the distance
+   * field, which implementations should override. Returns 0 by default.
+   *
+   * @return The size of the stored distances and helper structures in bytes
+   */
+  virtual std::size_t getMemoryUsage() const;
+
   /**
    * \brief Converts from an set of integer indices to a world
    * location given the origin and resolution parameters.
@@ -0,0 +1,63 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, PickNik LLC
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik LLC nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#pragma once
+
+#include <limits>
+
+namespace distance_field
+{
+/** \brief Value of \ref distanceTransform1D inputs that are no sites, and of outputs without any site */
+static const int DISTANCE_TRANSFORM_INFINITY = std::numeric_limits<int>::max();
+
+/**
+ * \brief One dimensional squared Euclidean distance transform of
+ * Felzenszwalb and Huttenlocher.
+ *
+ * For every q in [0, n), computes d[q] = min_p (q - p)^2 + f[p] and the
+ * minimizing p in arg[q], in O(n) by building the lower envelope of the
+ * parabolas rooted at the sites p, i.e. all p with f[p] !=
+ * DISTANCE_TRANSFORM_INFINITY.  Applying it along each axis in turn to
+ * the result of the previous axis yields the squared distances to the
+ * closest site of a grid.
+ *
+ * @param [in] f The n input values
+ * @param [in] n The number of values
+ * @param [out] d The n squared distances, DISTANCE_TRANSFORM_INFINITY if there is no site
+ * @param [out] arg The n closest sites, -1 if there is no site
+ * @param v Work buffer of n entries
+ * @param z Work buffer of n + 1 entries
+ */
+void distanceTransform1D(const int* f, int n, int* d, int* arg, int* v, double* z);
+}  // namespace distance_field
@@ -326,10 +326,18 @@ public:
    */
   double getDistance(int x, int y, int z) const override;
 
+  /**
+   * \brief Looks up the cells of all points directly in the voxel
+   * grid, see DistanceField::getDistanceGradients().
+   */
+  void getDistanceGradients(const Eigen::Vector3d* points, std::size_t count, double* distances,
+                            Eigen::Vector3d* gradients) const override;
+
   bool isCellValid(int x, int y, int z) const override;
   int getXNumCells() const override;
   int getYNumCells() const override;
   int getZNumCells() const override;
+  std::size_t getMemoryUsage() const override;
   bool gridToWorld(int x, int y, int z, double& world_x, double& world_y, double& world_z) const override;
   bool worldToGrid(double world_x, double world_y, double world_z, int& x, int& y, int& z) const override;
 
@@ -446,6 +454,30 @@ public:
     return max_distance_sq_;
   }
 
+  /**
+   * \brief Enable recomputing the entire field in parallel for large
+   * updates.
+   *
+   * If enabled, adding or removing a set of points that is large
+   * compared to the field (e.g. when filling a new field with the
+   * whole scene) does not propagate from the changed cells, but
+   * recomputes all distances with an exact Euclidean distance
+   * transform, using all available threads.  Distances may differ
+   * slightly from the ones obtained by propagation, which only
+   * approximates the closest obstacle cell.  Disabled by default.
+   *
+   * @param [in] parallel_recompute Whether to recompute the field for large updates
+   */
+  void setParallelRecompute(bool parallel_recompute)
+  {
+    parallel_recompute_ = parallel_recompute;
+  }
+
+  bool getParallelRecompute() const
+  {
+    return parallel_recompute_;
+  }
+
 private:
   /** Typedef for set of integer indices */
   typedef std::set<Eigen::Vector3i, CompareEigenVector3i, Eigen::aligned_allocator<Eigen::Vector3i>> VoxelSet;
@@ -471,6 +503,29 @@ private:
    */
   void removeObstacleVoxels(const EigenSTL::vector_Vector3i& voxel_points);
 
+  /**
+   * \brief Whether changing the given number of obstacle voxels is
+   * cheaper by recomputing all distances with \ref recomputeDistances
+   * than by propagation
+   */
+  bool shouldRecompute(std::size_t num_voxels) const;
+
+  /**
+   * \brief Recompute all distances from the obstacle voxels, which
+   * are the cells with zero distance_square_.
+   *
+   * Runs the separable Euclidean distance transform of Felzenszwalb
+   * and Huttenlocher along each axis in turn, processing the lines of
+   * an axis in parallel.
+   */
+  void recomputeDistances();
+
+  /**
+   * \brief One pass of \ref recomputeDistances along the given axis,
+   * for the positive or the negative distances
+   */
+  void computeDistanceTransform(int axis, bool negative);
+
   /**
    * \brief Propagates outward to the maximum distance given the
    * contents of the \ref bucket_queue_, and clears the \ref
@@ -540,6 +595,7 @@ private:
   void print(const EigenSTL::vector_Vector3d& points);
 
   bool propagate_negative_; /**< \brief Whether or not to propagate negative distances */
+  bool parallel_recompute_; /**< \brief Whether to recompute the field in parallel for large updates */
 
   VoxelGrid<PropDistanceFieldVoxel>::Ptr voxel_grid_; /**< \brief Actual container for distance data */
 
@@ -0,0 +1,222 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, PickNik LLC
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik LLC nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#pragma once
+
+#include <moveit/distance_field/distance_field.h>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace distance_field
+{
+/**
+ * \brief A DistanceField implementation that only allocates memory
+ * near obstacles.
+ *
+ * The volume is divided into cubic blocks of BLOCK_SIZE^3 cells, kept
+ * in a hash map.  Only blocks that contain a cell within the maximum
+ * distance of an obstacle cell are allocated, all other cells have the
+ * maximum distance (and zero negative distance).  The memory usage is
+ * therefore bounded by the surface of the obstacles rather than by the
+ * volume of the field, which allows large workspaces.
+ *
+ * Like the \ref CompactDistanceField, each block stores 16 bit squared
+ * distances in cells to the closest obstacle cell and, optionally, to
+ * the closest unoccupied cell.  Adding or removing points recomputes
+ * the exact distances of all blocks within the maximum distance of the
+ * changed cells, in parallel, giving the same distances as a \ref
+ * CompactDistanceField of the same dimensions.  Lookups cost a hash
+ * map access more than for dense fields.
+ */
+class SparseDistanceField : public DistanceField
+{
+public:
+  /** \brief The number of cells along each edge of a block */
+  static const int BLOCK_SIZE = 16;
+
+  /**
+   * \brief Constructor that initializes entire distance field to
+   * empty - all cells will be assigned maximum distance values.
+   *
+   * @param [in] size_x The X dimension in meters of the volume to represent
+   * @param [in] size_y The Y dimension in meters of the volume to represent
+   * @param [in] size_z The Z dimension in meters of the volume to represent
+   * @param [in] resolution The resolution in meters of the volume
+   * @param [in] origin_x The minimum X point of the volume
+   * @param [in] origin_y The minimum Y point of the volume
+   * @param [in] origin_z The minimum Z point of the volume
+   *
+   * @param [in] max_distance The maximum distance to compute.  Cells
+   * that are further away from the closest obstacle are assigned this
+   * distance.  It is reduced to 255 cells if larger.
+   *
+   * @param [in] compute_negative_distances Whether to store the
+   * distances of obstacle cells to the closest unoccupied cell.  If
+   * false, all obstacle cells have zero distance.
+   */
+  SparseDistanceField(double size_x, double size_y, double size_z, double resolution, double origin_x,
+                      double origin_y, double origin_z, double max_distance, bool compute_negative_distances = false);
+
+  void addPointsToField(const EigenSTL::vector_Vector3d& points) override;
+
+  void removePointsFromField(const EigenSTL::vector_Vector3d& points) override;
+
+  /**
+   * \brief Remove the old points and add the new points in a single
+   * update of the affected blocks
+   */
+  void updatePointsInField(const EigenSTL::vector_Vector3d& old_points,
+                           const EigenSTL::vector_Vector3d& new_points) override;
+
+  void reset() override;
+
+  double getDistance(double x, double y, double z) const override;
+
+  double getDistance(int x, int y, int z) const override;
+
+  bool isCellValid(int x, int y, int z) const override;
+  int getXNumCells() const override;
+  int getYNumCells() const override;
+  int getZNumCells() const override;
+  std::size_t getMemoryUsage() const override;
+  bool gridToWorld(int x, int y, int z, double& world_x, double& world_y, double& world_z) const override;
+  bool worldToGrid(double world_x, double world_y, double world_z, int& x, int& y, int& z) const override;
+
+  /**
+   * \brief Writes the obstacle cells to a stream, in the format of
+   * \ref PropagationDistanceField::writeToStream
+   */
+  bool writeToStream(std::ostream& stream) const override;
+
+  /**
+   * \brief Reads and recomputes the field from a stream written by
+   * \ref writeToStream or \ref PropagationDistanceField::writeToStream.
+   * The current maximum distance and whether to compute negative
+   * distances are kept.
+   */
+  bool readFromStream(std::istream& stream) override;
+
+  double getUninitializedDistance() const override
+  {
+    return max_distance_;
+  }
+
+  /**
+   * \brief Gets the squared distance in cells of a cell to the
+   * closest obstacle cell, zero for obstacle cells.  The cell must be
+   * valid.
+   */
+  int getDistanceSquared(int x, int y, int z) const;
+
+  /**
+   * \brief Gets the squared distance in cells of a cell to the
+   * closest unoccupied cell, zero for unoccupied cells and if
+   * negative distances are not computed.  The cell must be valid.
+   */
+  int getNegativeDistanceSquared(int x, int y, int z) const;
+
+  int getMaximumDistanceSquared() const
+  {
+    return max_distance_sq_;
+  }
+
+  /** \brief The number of allocated blocks */
+  std::size_t getNumBlocks() const
+  {
+    return blocks_.size();
+  }
+
+private:
+  /** \brief The squared distances of the cells of a block, indexed by \ref getCellIndex */
+  struct Block
+  {
+    std::vector<std::uint16_t> distance_sq;
+    std::vector<std::uint16_t> negative_distance_sq;  // empty if negative distances are not computed
+  };
+
+  static std::uint64_t getBlockKey(int block_x, int block_y, int block_z)
+  {
+    return (std::uint64_t(block_x) << 42) | (std::uint64_t(block_y) << 21) | std::uint64_t(block_z);
+  }
+
+  static std::uint64_t getBlockKeyOfCell(int x, int y, int z)
+  {
+    return getBlockKey(x / BLOCK_SIZE, y / BLOCK_SIZE, z / BLOCK_SIZE);
+  }
+
+  static int getCellIndex(int x, int y, int z)
+  {
+    return ((x % BLOCK_SIZE) * BLOCK_SIZE + y % BLOCK_SIZE) * BLOCK_SIZE + z % BLOCK_SIZE;
+  }
+
+  /** \brief Compute the grid dimensions and the maximum distance, and clear all blocks */
+  void initialize();
+
+  /** \brief Gets the cell of a world location, as done by \ref VoxelGrid */
+  int getCellFromLocation(int dim, double loc) const;
+
+  /** \brief Creates a block of cells at maximum distance */
+  Block createBlock() const;
+
+  /**
+   * \brief Turn the cells of the removed points into unoccupied cells
+   * and those of the added points into obstacle cells, then update
+   * all blocks within the maximum distance of a changed cell
+   */
+  void updateCells(const EigenSTL::vector_Vector3d& removed_points, const EigenSTL::vector_Vector3d& added_points);
+
+  /**
+   * \brief Computes the distances of a block from the obstacle cells
+   * within the maximum distance of it
+   *
+   * @return false if all cells of the block are at maximum distance,
+   * so that the block does not need to be stored
+   */
+  bool computeBlock(int block_x, int block_y, int block_z, Block& block) const;
+
+  bool compute_negative_;  /**< \brief Whether negative distances are stored */
+  double max_distance_;    /**< \brief Maximum distance in meters */
+  int max_distance_cells_; /**< \brief Maximum distance in cells */
+  int max_distance_sq_;    /**< \brief Maximum squared distance in cells */
+
+  int num_cells_[3];       /**< \brief The number of cells in each dimension */
+  double origin_minus_[3]; /**< \brief The origin minus half the resolution in each dimension */
+  double oo_resolution_;   /**< \brief One over the resolution */
+
+  std::unordered_map<std::uint64_t, Block> blocks_; /**< \brief The allocated blocks, by \ref getBlockKey */
+
+  std::vector<double> sqrt_table_; /**< \brief Distance in meters for each squared distance in cells */
+};
+}  // namespace distance_field
@@ -223,6 +223,13 @@ public:
    */
   int getNumCells(Dimension dim) const;
 
+  /**
+   * \brief Gets the memory held by the grid
+   *
+   * @return The size of the grid and its cells in bytes
+   */
+  std::size_t getMemoryUsage() const;
+
   /**
    * \brief Converts grid coordinates to world coordinates.
    */
@@ -458,6 +465,12 @@ inline int VoxelGrid<T>::getNumCells(Dimension dim) const
   return num_cells_[dim];
 }
 
+template <typename T>
+inline std::size_t VoxelGrid<T>::getMemoryUsage() const
+{
+  return sizeof(*this) + std::size_t(num_cells_total_) * sizeof(T);
+}
+
 template <typename T>
 inline const T& VoxelGrid<T>::operator()(double x, double y, double z) const
 {
@@ -0,0 +1,331 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, PickNik LLC
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik LLC nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include <moveit/distance_field/compact_distance_field.h>
+#include <moveit/distance_field/distance_transform.h>
+#include <boost/iostreams/filtering_stream.hpp>
+#include <boost/iostreams/filter/zlib.hpp>
+#include <algorithm>
+#include <bitset>
+#include <cmath>
+#include "rclcpp/rclcpp.hpp"
+
+namespace distance_field
+{
+// Logger
+static const rclcpp::Logger LOGGER = rclcpp::get_logger("moveit_distance_field.compact_distance_field");
+
+// largest distance in cells whose square fits into the 16 bit cells
+static const int MAX_DISTANCE_CELLS = 255;
+
+CompactDistanceField::CompactDistanceField(double size_x, double size_y, double size_z, double resolution,
+                                           double origin_x, double origin_y, double origin_z, double max_distance,
+                                           bool compute_negative_distances)
+  : DistanceField(size_x, size_y, size_z, resolution, origin_x, origin_y, origin_z)
+  , compute_negative_(compute_negative_distances)
+  , max_distance_(max_distance)
+  , max_distance_sq_(0)
+{
+  initialize();
+}
+
+void CompactDistanceField::initialize()
+{
+  int max_distance_cells = std::ceil(max_distance_ / resolution_);
+  if (max_distance_cells > MAX_DISTANCE_CELLS)
+  {
+    RCLCPP_WARN(LOGGER, "Maximum distance of %d cells exceeds the limit of %d cells, reducing it", max_distance_cells,
+                MAX_DISTANCE_CELLS);
+    max_distance_cells = MAX_DISTANCE_CELLS;
+    max_distance_ = max_distance_cells * resolution_;
+  }
+  max_distance_sq_ = max_distance_cells * max_distance_cells;
+
+  distance_sq_.reset(new VoxelGrid<std::uint16_t>(size_x_, size_y_, size_z_, resolution_, origin_x_, origin_y_,
+                                                  origin_z_, max_distance_sq_));
+  if (compute_negative_)
+    negative_distance_sq_.reset(
+        new VoxelGrid<std::uint16_t>(size_x_, size_y_, size_z_, resolution_, origin_x_, origin_y_, origin_z_, 0));
+  else
+    negative_distance_sq_.reset();
+
+  sqrt_table_.resize(max_distance_sq_ + 1);
+  for (int i = 0; i <= max_distance_sq_; ++i)
+    sqrt_table_[i] = std::sqrt(double(i)) * resolution_;
+
+  reset();
+}
+
+void CompactDistanceField::setCells(const EigenSTL::vector_Vector3d& points, std::uint16_t distance_sq)
+{
+  for (const Eigen::Vector3d& point : points)
+  {
+    Eigen::Vector3i cell;
+    if (distance_sq_->worldToGrid(point, cell))
+      distance_sq_->getCell(cell) = distance_sq;
+  }
+}
+
+void CompactDistanceField::addPointsToField(const EigenSTL::vector_Vector3d& points)
+{
+  if (points.empty())
+    return;
+  setCells(points, 0);
+  recompute();
+}
+
+void CompactDistanceField::removePointsFromField(const EigenSTL::vector_Vector3d& points)
+{
+  if (points.empty())
+    return;
+  setCells(points, std::max(max_distance_sq_, 1));
+  recompute();
+}
+
+void CompactDistanceField::updatePointsInField(const EigenSTL::vector_Vector3d& old_points,
+                                               const EigenSTL::vector_Vector3d& new_points)
+{
+  setCells(old_points, std::max(max_distance_sq_, 1));
+  setCells(new_points, 0);
+  recompute();
+}
+
+void CompactDistanceField::reset()
+{
+  distance_sq_->reset(max_distance_sq_);
+  if (compute_negative_)
+    negative_distance_sq_->reset(0);
+}
+
+void CompactDistanceField::recompute()
+{
+  const int num_x = getXNumCells();
+  const int num_y = getYNumCells();
+  const int num_z = getZNumCells();
+
+  // the obstacle cells are the sites of the positive distances, the unoccupied cells the sites of the negative ones
+#pragma omp parallel for
+  for (int x = 0; x < num_x; ++x)
+    for (int y = 0; y < num_y; ++y)
+      for (int z = 0; z < num_z; ++z)
+      {
+        std::uint16_t& distance_sq = distance_sq_->getCell(x, y, z);
+        if (distance_sq != 0)
+          distance_sq = max_distance_sq_;
+        if (compute_negative_)
+          negative_distance_sq_->getCell(x, y, z) = distance_sq == 0 ? max_distance_sq_ : 0;
+      }
+
+  computeDistanceTransform(*distance_sq_);
+  if (compute_negative_)
+    computeDistanceTransform(*negative_distance_sq_);
+}
+
+void CompactDistanceField::computeDistanceTransform(VoxelGrid<std::uint16_t>& grid) const
+{
+  const Eigen::Vector3i num_cells(getXNumCells(), getYNumCells(), getZNumCells());
+
+  // Cells without a closest site within the maximum distance start at the maximum distance instead of infinity.
+  // This keeps all values within 16 bits and does not change the result: such a cell only contributes distances
+  // beyond the maximum distance, which are reduced to the maximum distance anyway.
+  for (int axis = 0; axis < 3; ++axis)
+  {
+    // consecutive lines are adjacent along the last axis other than the transformed one, which is contiguous in memory
+    const int axis1 = axis == 2 ? 1 : 2;
+    const int axis2 = axis == 0 ? 1 : 0;
+    const int n = num_cells[axis];
+    const int num_lines = num_cells[axis1] * num_cells[axis2];
+
+#pragma omp parallel
+    {
+      // per thread line buffers
+      std::vector<int> f(n), d(n), arg(n), v(n);
+      std::vector<double> z(n + 1);
+
+#pragma omp for schedule(dynamic, 16)
+      for (int line = 0; line < num_lines; ++line)
+      {
+        Eigen::Vector3i loc;
+        loc[axis1] = line % num_cells[axis1];
+        loc[axis2] = line / num_cells[axis1];
+        for (int i = 0; i < n; ++i)
+        {
+          loc[axis] = i;
+          f[i] = grid.getCell(loc);
+        }
+
+        distanceTransform1D(f.data(), n, d.data(), arg.data(), v.data(), z.data());
+
+        for (int i = 0; i < n; ++i)
+        {
+          loc[axis] = i;
+          grid.getCell(loc) = std::min(d[i], max_distance_sq_);
+        }
+      }
+    }
+  }
+}
+
+double CompactDistanceField::getDistance(double x, double y, double z) const
+{
+  double distance = sqrt_table_[(*distance_sq_)(x, y, z)];
+  if (compute_negative_)
+    distance -= sqrt_table_[(*negative_distance_sq_)(x, y, z)];
+  return distance;
+}
+
+double CompactDistanceField::getDistance(int x, int y, int z) const
+{
+  double distance = sqrt_table_[distance_sq_->getCell(x, y, z)];
+  if (compute_negative_)
+    distance -= sqrt_table_[negative_distance_sq_->getCell(x, y, z)];
+  return distance;
+}
+
+bool CompactDistanceField::isCellValid(int x, int y, int z) const
+{
+  return distance_sq_->isCellValid(x, y, z);
+}
+
+int CompactDistanceField::getXNumCells() const
+{
+  return distance_sq_->getNumCells(DIM_X);
+}
+
+int CompactDistanceField::getYNumCells() const
+{
+  return distance_sq_->getNumCells(DIM_Y);
+}
+
+int CompactDistanceField::getZNumCells() const
+{
+  return distance_sq_->getNumCells(DIM_Z);
+}
+
+std::size_t CompactDistanceField::getMemoryUsage() const
+{
+  std::size_t bytes = sizeof(*this) + sqrt_table_.size() * sizeof(double) + distance_sq_->getMemoryUsage();
+  if (negative_distance_sq_)
+    bytes += negative_distance_sq_->getMemoryUsage();
+  return bytes;
+}
+
+bool CompactDistanceField::gridToWorld(int x, int y, int z, double& world_x, double& world_y, double& world_z) const
+{
+  distance_sq_->gridToWorld(x, y, z, world_x, world_y, world_z);
+  return true;
+}
+
+bool CompactDistanceField::worldToGrid(double world_x, double world_y, double world_z, int& x, int& y, int& z) const
+{
+  return distance_sq_->worldToGrid(world_x, world_y, world_z, x, y, z);
+}
+
+bool CompactDistanceField::writeToStream(std::ostream& os) const
+{
+  os << "resolution: " << resolution_ << std::endl;
+  os << "size_x: " << size_x_ << std::endl;
+  os << "size_y: " << size_y_ << std::endl;
+  os << "size_z: " << size_z_ << std::endl;
+  os << "origin_x: " << origin_x_ << std::endl;
+  os << "origin_y: " << origin_y_ << std::endl;
+  os << "origin_z: " << origin_z_ << std::endl;
+
+  // one bit per cell, zlib compressed
+  boost::iostreams::filtering_ostream out;
+  out.push(boost::iostreams::zlib_compressor());
+  out.push(os);
+
+  for (int x = 0; x < getXNumCells(); ++x)
+    for (int y = 0; y < getYNumCells(); ++y)
+      for (int z = 0; z < getZNumCells(); z += 8)
+      {
+        std::bitset<8> bs(0);
+        const int zv = std::min(8, getZNumCells() - z);
+        for (int zi = 0; zi < zv; ++zi)
+          bs[zi] = distance_sq_->getCell(x, y, z + zi) == 0;
+        const char c = static_cast<char>(bs.to_ulong());
+        out.write(&c, sizeof(char));
+      }
+  out.flush();
+  return true;
+}
+
+bool CompactDistanceField::readFromStream(std::istream& is)
+{
+  if (!is.good())
+    return false;
+
+  std::string temp;
+  for (const std::pair<const char*, double*>& entry :
+       { std::make_pair("resolution:", &resolution_), std::make_pair("size_x:", &size_x_),
+         std::make_pair("size_y:", &size_y_), std::make_pair("size_z:", &size_z_),
+         std::make_pair("origin_x:", &origin_x_), std::make_pair("origin_y:", &origin_y_),
+         std::make_pair("origin_z:", &origin_z_) })
+  {
+    is >> temp;
+    if (temp != entry.first)
+      return false;
+    is >> *entry.second;
+  }
+  inv_twice_resolution_ = 1.0 / (2.0 * resolution_);
+
+  initialize();
+
+  // this should be newline
+  char nl;
+  is.get(nl);
+
+  boost::iostreams::filtering_istream in;
+  in.push(boost::iostreams::zlib_decompressor());
+  in.push(is);
+
+  for (int x = 0; x < getXNumCells(); ++x)
+    for (int y = 0; y < getYNumCells(); ++y)
+      for (int z = 0; z < getZNumCells(); z += 8)
+      {
+        char inchar;
+        if (!in.good())
+          return false;
+        in.get(inchar);
+        const std::bitset<8> inbit(static_cast<unsigned char>(inchar));
+        const int zv = std::min(8, getZNumCells() - z);
+        for (int zi = 0; zi < zv; ++zi)
+          if (inbit[zi])
+            distance_sq_->getCell(x, y, z + zi) = 0;
+      }
+  recompute();
+  return true;
+}
+}  // namespace distance_field
@@ -62,6 +62,11 @@ DistanceField::DistanceField(double size_x, double size_y, double size_z, double
 
 DistanceField::~DistanceField() = default;
 
+std::size_t DistanceField::getMemoryUsage() const
+{
+  return 0;
+}
+
 double DistanceField::getDistanceGradient(double x, double y, double z, double& gradient_x, double& gradient_y,
                                           double& gradient_z, bool& in_bounds) const
 {
@@ -88,6 +93,15 @@ double DistanceField::getDistanceGradient(double x, double y, double z, double&
   return getDistance(gx, gy, gz);
 }
 
+void DistanceField::getDistanceGradients(const Eigen::Vector3d* points, std::size_t count, double* distances,
+                                         Eigen::Vector3d* gradients) const
+{
+  bool in_bounds;
+  for (std::size_t i = 0; i < count; ++i)
+    distances[i] = getDistanceGradient(points[i].x(), points[i].y(), points[i].z(), gradients[i].x(), gradients[i].y(),
+                                       gradients[i].z(), in_bounds);
+}
+
 void DistanceField::getIsoSurfaceMarkers(double min_distance, double max_distance, const std::string& frame_id,
                                          const rclcpp::Time& stamp, visualization_msgs::msg::Marker& inf_marker) const
 {
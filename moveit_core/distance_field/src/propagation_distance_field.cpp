@@ -35,11 +35,13 @@
 /* Author: Mrinal Kalakrishnan, Ken Anderson */
 
 #include <moveit/distance_field/propagation_distance_field.h>
+#include <moveit/distance_field/distance_transform.h>
 #include <visualization_msgs/msg/marker.h>
 #include <boost/iostreams/filtering_stream.hpp>
 #include <boost/iostreams/copy.hpp>
 #include <boost/iostreams/filter/zlib.hpp>
 #include "rclcpp/rclcpp.hpp"
+#include <cmath>
 
 namespace distance_field
 {
@@ -51,6 +53,7 @@ PropagationDistanceField::PropagationDistanceField(double size_x, double size_y,
                                                    double max_distance, bool propagate_negative)
   : DistanceField(size_x, size_y, size_z, resolution, origin_x, origin_y, origin_z)
   , propagate_negative_(propagate_negative)
+  , parallel_recompute_(false)
   , max_distance_(max_distance)
 {
   initialize();
@@ -62,6 +65,7 @@ PropagationDistanceField::PropagationDistanceField(const octomap::OcTree& octree
   : DistanceField(bbx_max.x() - bbx_min.x(), bbx_max.y() - bbx_min.y(), bbx_max.z() - bbx_min.z(),
                   octree.getResolution(), bbx_min.x(), bbx_min.y(), bbx_min.z())
   , propagate_negative_(propagate_negative_distances)
+  , parallel_recompute_(false)
   , max_distance_(max_distance)
   , max_distance_sq_(0)  // avoid gcc warning about uninitialized value
 {
@@ -71,7 +75,10 @@ PropagationDistanceField::PropagationDistanceField(const octomap::OcTree& octree
 
 PropagationDistanceField::PropagationDistanceField(std::istream& is, double max_distance,
                                                    bool propagate_negative_distances)
-  : DistanceField(0, 0, 0, 0, 0, 0, 0), propagate_negative_(propagate_negative_distances), max_distance_(max_distance)
+  : DistanceField(0, 0, 0, 0, 0, 0, 0)
+  , propagate_negative_(propagate_negative_distances)
+  , parallel_recompute_(false)
+  , max_distance_(max_distance)
 {
   readFromStream(is);
 }
@@ -212,6 +219,14 @@ void PropagationDistanceField::removePointsFromField(const EigenSTL::vector_Vect
 
 void PropagationDistanceField::addNewObstacleVoxels(const EigenSTL::vector_Vector3i& voxel_points)
 {
+  if (shouldRecompute(voxel_points.size()))
+  {
+    for (const Eigen::Vector3i& voxel_point : voxel_points)
+      voxel_grid_->getCell(voxel_point.x(), voxel_point.y(), voxel_point.z()).distance_square_ = 0;
+    recomputeDistances();
+    return;
+  }
+
   int initial_update_direction = getDirectionNumber(0, 0, 0);
   bucket_queue_[0].reserve(voxel_points.size());
   EigenSTL::vector_Vector3i negative_stack;
@@ -295,6 +310,15 @@ void PropagationDistanceField::addNewObstacleVoxels(const EigenSTL::vector_Vecto
 void PropagationDistanceField::removeObstacleVoxels(const EigenSTL::vector_Vector3i& voxel_points)
 // const VoxelSet& locations )
 {
+  if (shouldRecompute(voxel_points.size()))
+  {
+    // any positive value marks a free cell for recomputeDistances()
+    for (const Eigen::Vector3i& voxel_point : voxel_points)
+      voxel_grid_->getCell(voxel_point).distance_square_ = DISTANCE_TRANSFORM_INFINITY;
+    recomputeDistances();
+    return;
+  }
+
   EigenSTL::vector_Vector3i stack;
   EigenSTL::vector_Vector3i negative_stack;
   int initial_update_direction = getDirectionNumber(0, 0, 0);
@@ -379,6 +403,123 @@ void PropagationDistanceField::removeObstacleVoxels(const EigenSTL::vector_Vecto
   }
 }
 
+bool PropagationDistanceField::shouldRecompute(std::size_t num_voxels) const
+{
+  if (!parallel_recompute_)
+    return false;
+  // propagation updates about a cube of (2 * max distance + 1)^3 cells per changed voxel, many less if the changed
+  // voxels are clustered, while the recomputation visits each cell a constant number of times, spread over all threads
+  const double max_distance_cells = std::ceil(max_distance_ / resolution_);
+  const double cells_per_voxel = std::pow(2.0 * max_distance_cells + 1.0, 3);
+  return num_voxels * cells_per_voxel > double(getXNumCells()) * getYNumCells() * getZNumCells();
+}
+
+void PropagationDistanceField::recomputeDistances()
+{
+  const int num_x = getXNumCells();
+  const int num_y = getYNumCells();
+  const int num_z = getZNumCells();
+
+  // the obstacle cells are the sites of the positive distances, the free cells the sites of the negative ones
+#pragma omp parallel for
+  for (int x = 0; x < num_x; ++x)
+    for (int y = 0; y < num_y; ++y)
+      for (int z = 0; z < num_z; ++z)
+      {
+        PropDistanceFieldVoxel& voxel = voxel_grid_->getCell(x, y, z);
+        const bool obstacle = voxel.distance_square_ == 0;
+        voxel.distance_square_ = obstacle ? 0 : DISTANCE_TRANSFORM_INFINITY;
+        voxel.closest_point_ = Eigen::Vector3i(x, y, z);
+        if (propagate_negative_)
+        {
+          voxel.negative_distance_square_ = obstacle ? DISTANCE_TRANSFORM_INFINITY : 0;
+          voxel.closest_negative_point_ = Eigen::Vector3i(x, y, z);
+        }
+      }
+
+  for (int axis = 0; axis < 3; ++axis)
+  {
+    computeDistanceTransform(axis, false);
+    if (propagate_negative_)
+      computeDistanceTransform(axis, true);
+  }
+
+  // cells further away than the maximum distance get the same values as after propagation
+  const int initial_update_direction = getDirectionNumber(0, 0, 0);
+#pragma omp parallel for
+  for (int x = 0; x < num_x; ++x)
+    for (int y = 0; y < num_y; ++y)
+      for (int z = 0; z < num_z; ++z)
+      {
+        PropDistanceFieldVoxel& voxel = voxel_grid_->getCell(x, y, z);
+        voxel.update_direction_ = initial_update_direction;
+        voxel.negative_update_direction_ = initial_update_direction;
+        if (voxel.distance_square_ > max_distance_sq_)
+        {
+          voxel.distance_square_ = max_distance_sq_;
+          voxel.closest_point_ = Eigen::Vector3i(x, y, z);
+        }
+        if (voxel.negative_distance_square_ > max_distance_sq_)
+        {
+          voxel.negative_distance_square_ = max_distance_sq_;
+          voxel.closest_negative_point_ = Eigen::Vector3i(x, y, z);
+        }
+      }
+}
+
+void PropagationDistanceField::computeDistanceTransform(int axis, bool negative)
+{
+  const Eigen::Vector3i num_cells(getXNumCells(), getYNumCells(), getZNumCells());
+  // consecutive lines are adjacent along the last axis other than the transformed one, which is contiguous in memory
+  const int axis1 = axis == 2 ? 1 : 2;
+  const int axis2 = axis == 0 ? 1 : 0;
+  const int n = num_cells[axis];
+  const int num_lines = num_cells[axis1] * num_cells[axis2];
+
+  int PropDistanceFieldVoxel::*distance =
+      negative ? &PropDistanceFieldVoxel::negative_distance_square_ : &PropDistanceFieldVoxel::distance_square_;
+  Eigen::Vector3i PropDistanceFieldVoxel::*closest =
+      negative ? &PropDistanceFieldVoxel::closest_negative_point_ : &PropDistanceFieldVoxel::closest_point_;
+
+#pragma omp parallel
+  {
+    // per thread line buffers
+    std::vector<int> f(n), d(n), arg(n), v(n);
+    std::vector<double> z(n + 1);
+    EigenSTL::vector_Vector3i closest_points(n);
+
+#pragma omp for schedule(dynamic, 16)
+    for (int line = 0; line < num_lines; ++line)
+    {
+      Eigen::Vector3i loc;
+      loc[axis1] = line % num_cells[axis1];
+      loc[axis2] = line / num_cells[axis1];
+      for (int i = 0; i < n; ++i)
+      {
+        loc[axis] = i;
+        const PropDistanceFieldVoxel& voxel = voxel_grid_->getCell(loc);
+        f[i] = voxel.*distance;
+        closest_points[i] = voxel.*closest;
+      }
+
+      distanceTransform1D(f.data(), n, d.data(), arg.data(), v.data(), z.data());
+
+      for (int i = 0; i < n; ++i)
+      {
+        loc[axis] = i;
+        PropDistanceFieldVoxel& voxel = voxel_grid_->getCell(loc);
+        voxel.*distance = d[i];
+        if (arg[i] >= 0)
+        {
+          // the closest site along this axis carries the closest coordinates along the axes processed before
+          voxel.*closest = closest_points[arg[i]];
+          (voxel.*closest)[axis] = arg[i];
+        }
+      }
+    }
+  }
+}
+
 void PropagationDistanceField::propagatePositive()
 {
   // now process the queue:
@@ -593,6 +734,46 @@ double PropagationDistanceField::getDistance(int x, int y, int z) const
   return getDistance(voxel_grid_->getCell(x, y, z));
 }
 
+void PropagationDistanceField::getDistanceGradients(const Eigen::Vector3d* points, std::size_t count, double* distances,
+                                                    Eigen::Vector3d* gradients) const
+{
+  const int max_x = voxel_grid_->getNumCells(DIM_X) - 1;
+  const int max_y = voxel_grid_->getNumCells(DIM_Y) - 1;
+  const int max_z = voxel_grid_->getNumCells(DIM_Z) - 1;
+  if (max_x < 2 || max_y < 2 || max_z < 2)
+  {
+    DistanceField::getDistanceGradients(points, count, distances, gradients);
+    return;
+  }
+
+  const PropDistanceFieldVoxel* data = &voxel_grid_->getCell(0, 0, 0);
+  const std::ptrdiff_t stride_x = &voxel_grid_->getCell(1, 0, 0) - data;
+  const std::ptrdiff_t stride_y = &voxel_grid_->getCell(0, 1, 0) - data;
+  const double* sqrt_table = sqrt_table_.data();
+  const auto distance = [sqrt_table](const PropDistanceFieldVoxel& voxel) {
+    return sqrt_table[voxel.distance_square_] - sqrt_table[voxel.negative_distance_square_];
+  };
+
+  for (std::size_t i = 0; i < count; ++i)
+  {
+    int x, y, z;
+    voxel_grid_->worldToGrid(points[i].x(), points[i].y(), points[i].z(), x, y, z);
+    // same padding of 1 as DistanceField::getDistanceGradient()
+    if (x < 1 || y < 1 || z < 1 || x >= max_x || y >= max_y || z >= max_z)
+    {
+      distances[i] = max_distance_;
+      gradients[i].setZero();
+      continue;
+    }
+
+    const PropDistanceFieldVoxel* cell = data + x * stride_x + y * stride_y + z;
+    gradients[i].x() = (distance(cell[stride_x]) - distance(cell[-stride_x])) * inv_twice_resolution_;
+    gradients[i].y() = (distance(cell[stride_y]) - distance(cell[-stride_y])) * inv_twice_resolution_;
+    gradients[i].z() = (distance(cell[1]) - distance(cell[-1])) * inv_twice_resolution_;
+    distances[i] = distance(*cell);
+  }
+}
+
 bool PropagationDistanceField::isCellValid(int x, int y, int z) const
 {
   return voxel_grid_->isCellValid(x, y, z);
@@ -613,6 +794,16 @@ int PropagationDistanceField::getZNumCells() const
   return voxel_grid_->getNumCells(DIM_Z);
 }
 
+std::size_t PropagationDistanceField::getMemoryUsage() const
+{
+  std::size_t bytes = sizeof(*this) + sqrt_table_.size() * sizeof(double) + voxel_grid_->getMemoryUsage();
+  for (const EigenSTL::vector_Vector3i& bucket : bucket_queue_)
+    bytes += bucket.capacity() * sizeof(Eigen::Vector3i);
+  for (const EigenSTL::vector_Vector3i& bucket : negative_bucket_queue_)
+    bytes += bucket.capacity() * sizeof(Eigen::Vector3i);
+  return bytes;
+}
+
 bool PropagationDistanceField::gridToWorld(int x, int y, int z, double& world_x, double& world_y, double& world_z) const
 {
   voxel_grid_->gridToWorld(x, y, z, world_x, world_y, world_z);
@@ -0,0 +1,452 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, PickNik LLC
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik LLC nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include <moveit/distance_field/sparse_distance_field.h>
+#include <moveit/distance_field/distance_transform.h>
+#include <boost/iostreams/filtering_stream.hpp>
+#include <boost/iostreams/filter/zlib.hpp>
+#include <algorithm>
+#include <bitset>
+#include <cmath>
+#include <unordered_set>
+#include "rclcpp/rclcpp.hpp"
+
+namespace distance_field
+{
+// Logger
+static const rclcpp::Logger LOGGER = rclcpp::get_logger("moveit_distance_field.sparse_distance_field");
+
+// largest distance in cells whose square fits into the 16 bit cells
+static const int MAX_DISTANCE_CELLS = 255;
+
+static const int BLOCK_CELLS = SparseDistanceField::BLOCK_SIZE * SparseDistanceField::BLOCK_SIZE *
+                               SparseDistanceField::BLOCK_SIZE;
+
+SparseDistanceField::SparseDistanceField(double size_x, double size_y, double size_z, double resolution,
+                                         double origin_x, double origin_y, double origin_z, double max_distance,
+                                         bool compute_negative_distances)
+  : DistanceField(size_x, size_y, size_z, resolution, origin_x, origin_y, origin_z)
+  , compute_negative_(compute_negative_distances)
+  , max_distance_(max_distance)
+{
+  initialize();
+}
+
+void SparseDistanceField::initialize()
+{
+  max_distance_cells_ = std::ceil(max_distance_ / resolution_);
+  if (max_distance_cells_ > MAX_DISTANCE_CELLS)
+  {
+    RCLCPP_WARN(LOGGER, "Maximum distance of %d cells exceeds the limit of %d cells, reducing it",
+                max_distance_cells_, MAX_DISTANCE_CELLS);
+    max_distance_cells_ = MAX_DISTANCE_CELLS;
+    max_distance_ = max_distance_cells_ * resolution_;
+  }
+  max_distance_sq_ = max_distance_cells_ * max_distance_cells_;
+
+  // same grid as a VoxelGrid of these dimensions
+  oo_resolution_ = 1.0 / resolution_;
+  const double size[3] = { size_x_, size_y_, size_z_ };
+  const double origin[3] = { origin_x_, origin_y_, origin_z_ };
+  for (int i = 0; i < 3; ++i)
+  {
+    num_cells_[i] = size[i] * oo_resolution_;
+    origin_minus_[i] = origin[i] - 0.5 * resolution_;
+  }
+
+  sqrt_table_.resize(max_distance_sq_ + 1);
+  for (int i = 0; i <= max_distance_sq_; ++i)
+    sqrt_table_[i] = std::sqrt(double(i)) * resolution_;
+
+  blocks_.clear();
+}
+
+int SparseDistanceField::getCellFromLocation(int dim, double loc) const
+{
+  return int(floor((loc - origin_minus_[dim]) * oo_resolution_));
+}
+
+SparseDistanceField::Block SparseDistanceField::createBlock() const
+{
+  Block block;
+  block.distance_sq.assign(BLOCK_CELLS, max_distance_sq_);
+  if (compute_negative_)
+    block.negative_distance_sq.assign(BLOCK_CELLS, 0);
+  return block;
+}
+
+void SparseDistanceField::addPointsToField(const EigenSTL::vector_Vector3d& points)
+{
+  updateCells(EigenSTL::vector_Vector3d(), points);
+}
+
+void SparseDistanceField::removePointsFromField(const EigenSTL::vector_Vector3d& points)
+{
+  updateCells(points, EigenSTL::vector_Vector3d());
+}
+
+void SparseDistanceField::updatePointsInField(const EigenSTL::vector_Vector3d& old_points,
+                                              const EigenSTL::vector_Vector3d& new_points)
+{
+  updateCells(old_points, new_points);
+}
+
+void SparseDistanceField::reset()
+{
+  blocks_.clear();
+}
+
+void SparseDistanceField::updateCells(const EigenSTL::vector_Vector3d& removed_points,
+                                      const EigenSTL::vector_Vector3d& added_points)
+{
+  std::unordered_set<std::uint64_t> changed_blocks;
+  int x, y, z;
+  for (const Eigen::Vector3d& point : removed_points)
+  {
+    if (!worldToGrid(point.x(), point.y(), point.z(), x, y, z))
+      continue;
+    auto it = blocks_.find(getBlockKeyOfCell(x, y, z));
+    if (it == blocks_.end())
+      continue;
+    std::uint16_t& distance_sq = it->second.distance_sq[getCellIndex(x, y, z)];
+    if (distance_sq == 0)
+    {
+      // any positive value marks an unoccupied cell for computeBlock()
+      distance_sq = std::max(max_distance_sq_, 1);
+      changed_blocks.insert(it->first);
+    }
+  }
+  for (const Eigen::Vector3d& point : added_points)
+  {
+    if (!worldToGrid(point.x(), point.y(), point.z(), x, y, z))
+      continue;
+    const std::uint64_t key = getBlockKeyOfCell(x, y, z);
+    auto it = blocks_.find(key);
+    if (it == blocks_.end())
+      it = blocks_.emplace(key, createBlock()).first;
+    std::uint16_t& distance_sq = it->second.distance_sq[getCellIndex(x, y, z)];
+    if (distance_sq != 0)
+    {
+      distance_sq = 0;
+      changed_blocks.insert(key);
+    }
+  }
+  if (changed_blocks.empty())
+    return;
+
+  // all blocks with a cell within the maximum distance of a changed cell
+  const int margin = (max_distance_cells_ + BLOCK_SIZE - 1) / BLOCK_SIZE;
+  const int num_blocks[3] = { (num_cells_[0] + BLOCK_SIZE - 1) / BLOCK_SIZE,
+                              (num_cells_[1] + BLOCK_SIZE - 1) / BLOCK_SIZE,
+                              (num_cells_[2] + BLOCK_SIZE - 1) / BLOCK_SIZE };
+  std::unordered_set<std::uint64_t> affected_set;
+  std::vector<Eigen::Vector3i> affected_blocks;
+  for (std::uint64_t key : changed_blocks)
+  {
+    const int block_x = key >> 42;
+    const int block_y = (key >> 21) & 0x1fffff;
+    const int block_z = key & 0x1fffff;
+    for (int bx = std::max(block_x - margin, 0); bx <= std::min(block_x + margin, num_blocks[0] - 1); ++bx)
+      for (int by = std::max(block_y - margin, 0); by <= std::min(block_y + margin, num_blocks[1] - 1); ++by)
+        for (int bz = std::max(block_z - margin, 0); bz <= std::min(block_z + margin, num_blocks[2] - 1); ++bz)
+          if (affected_set.insert(getBlockKey(bx, by, bz)).second)
+            affected_blocks.push_back(Eigen::Vector3i(bx, by, bz));
+  }
+
+  // the blocks only read the obstacle cells, which do not change, so they can be computed in parallel
+  std::vector<Block> results(affected_blocks.size());
+  std::vector<char> allocate(affected_blocks.size());
+#pragma omp parallel for schedule(dynamic)
+  for (std::size_t i = 0; i < affected_blocks.size(); ++i)
+  {
+    const Eigen::Vector3i& b = affected_blocks[i];
+    allocate[i] = computeBlock(b.x(), b.y(), b.z(), results[i]);
+  }
+
+  for (std::size_t i = 0; i < affected_blocks.size(); ++i)
+  {
+    const Eigen::Vector3i& b = affected_blocks[i];
+    const std::uint64_t key = getBlockKey(b.x(), b.y(), b.z());
+    if (allocate[i])
+      blocks_[key] = std::move(results[i]);
+    else
+      blocks_.erase(key);
+  }
+}
+
+bool SparseDistanceField::computeBlock(int block_x, int block_y, int block_z, Block& block) const
+{
+  // the obstacle and unoccupied cells that can be closest to a cell of the block are within this region
+  const int block_min[3] = { block_x * BLOCK_SIZE, block_y * BLOCK_SIZE, block_z * BLOCK_SIZE };
+  int min[3], dims[3];
+  for (int i = 0; i < 3; ++i)
+  {
+    min[i] = std::max(block_min[i] - max_distance_cells_, 0);
+    dims[i] = std::min(block_min[i] + BLOCK_SIZE + max_distance_cells_, num_cells_[i]) - min[i];
+  }
+  auto local_index = [&dims](int x, int y, int z) { return (x * dims[1] + y) * dims[2] + z; };
+
+  // as in CompactDistanceField, cells without a site start at the maximum distance
+  std::vector<int> distance_sq(dims[0] * dims[1] * dims[2], max_distance_sq_);
+  std::vector<int> negative_distance_sq(compute_negative_ ? distance_sq.size() : 0, 0);
+  bool has_obstacles = false;
+  for (int bx = min[0] / BLOCK_SIZE; bx <= (min[0] + dims[0] - 1) / BLOCK_SIZE; ++bx)
+    for (int by = min[1] / BLOCK_SIZE; by <= (min[1] + dims[1] - 1) / BLOCK_SIZE; ++by)
+      for (int bz = min[2] / BLOCK_SIZE; bz <= (min[2] + dims[2] - 1) / BLOCK_SIZE; ++bz)
+      {
+        auto it = blocks_.find(getBlockKey(bx, by, bz));
+        if (it == blocks_.end())
+          continue;
+        const int x_end = std::min((bx + 1) * BLOCK_SIZE, min[0] + dims[0]);
+        const int y_end = std::min((by + 1) * BLOCK_SIZE, min[1] + dims[1]);
+        const int z_end = std::min((bz + 1) * BLOCK_SIZE, min[2] + dims[2]);
+        for (int x = std::max(bx * BLOCK_SIZE, min[0]); x < x_end; ++x)
+          for (int y = std::max(by * BLOCK_SIZE, min[1]); y < y_end; ++y)
+            for (int z = std::max(bz * BLOCK_SIZE, min[2]); z < z_end; ++z)
+              if (it->second.distance_sq[getCellIndex(x, y, z)] == 0)
+              {
+                const int index = local_index(x - min[0], y - min[1], z - min[2]);
+                distance_sq[index] = 0;
+                if (compute_negative_)
+                  negative_distance_sq[index] = max_distance_sq_;
+                has_obstacles = true;
+              }
+      }
+  if (!has_obstacles)
+    return false;
+
+  const int max_dim = std::max(dims[0], std::max(dims[1], dims[2]));
+  std::vector<int> f(max_dim), d(max_dim), arg(max_dim), v(max_dim);
+  std::vector<double> z(max_dim + 1);
+  for (std::vector<int>* values : { &distance_sq, &negative_distance_sq })
+  {
+    if (values->empty())
+      continue;
+    for (int axis = 0; axis < 3; ++axis)
+    {
+      const int axis1 = axis == 2 ? 1 : 2;
+      const int axis2 = axis == 0 ? 1 : 0;
+      const int n = dims[axis];
+      int loc[3];
+      for (loc[axis2] = 0; loc[axis2] < dims[axis2]; ++loc[axis2])
+        for (loc[axis1] = 0; loc[axis1] < dims[axis1]; ++loc[axis1])
+        {
+          for (loc[axis] = 0; loc[axis] < n; ++loc[axis])
+            f[loc[axis]] = (*values)[local_index(loc[0], loc[1], loc[2])];
+          distanceTransform1D(f.data(), n, d.data(), arg.data(), v.data(), z.data());
+          for (loc[axis] = 0; loc[axis] < n; ++loc[axis])
+            (*values)[local_index(loc[0], loc[1], loc[2])] = std::min(d[loc[axis]], max_distance_sq_);
+        }
+    }
+  }
+
+  // copy the cells of the block, cells outside of the grid keep the maximum distance
+  block = createBlock();
+  bool has_distances = false;
+  for (int x = block_min[0]; x < std::min(block_min[0] + BLOCK_SIZE, num_cells_[0]); ++x)
+    for (int y = block_min[1]; y < std::min(block_min[1] + BLOCK_SIZE, num_cells_[1]); ++y)
+      for (int z = block_min[2]; z < std::min(block_min[2] + BLOCK_SIZE, num_cells_[2]); ++z)
+      {
+        const int index = local_index(x - min[0], y - min[1], z - min[2]);
+        const int cell = getCellIndex(x, y, z);
+        block.distance_sq[cell] = distance_sq[index];
+        if (compute_negative_)
+          block.negative_distance_sq[cell] = negative_distance_sq[index];
+        has_distances |= distance_sq[index] < max_distance_sq_;
+      }
+  return has_distances;
+}
+
+int SparseDistanceField::getDistanceSquared(int x, int y, int z) const
+{
+  auto it = blocks_.find(getBlockKeyOfCell(x, y, z));
+  return it == blocks_.end() ? max_distance_sq_ : it->second.distance_sq[getCellIndex(x, y, z)];
+}
+
+int SparseDistanceField::getNegativeDistanceSquared(int x, int y, int z) const
+{
+  if (!compute_negative_)
+    return 0;
+  auto it = blocks_.find(getBlockKeyOfCell(x, y, z));
+  return it == blocks_.end() ? 0 : it->second.negative_distance_sq[getCellIndex(x, y, z)];
+}
+
+double SparseDistanceField::getDistance(double x, double y, double z) const
+{
+  int cell_x, cell_y, cell_z;
+  if (!worldToGrid(x, y, z, cell_x, cell_y, cell_z))
+    return sqrt_table_[max_distance_sq_];
+  return getDistance(cell_x, cell_y, cell_z);
+}
+
+double SparseDistanceField::getDistance(int x, int y, int z) const
+{
+  auto it = blocks_.find(getBlockKeyOfCell(x, y, z));
+  if (it == blocks_.end())
+    return sqrt_table_[max_distance_sq_];
+  const int cell = getCellIndex(x, y, z);
+  double distance = sqrt_table_[it->second.distance_sq[cell]];
+  if (compute_negative_)
+    distance -= sqrt_table_[it->second.negative_distance_sq[cell]];
+  return distance;
+}
+
+bool SparseDistanceField::isCellValid(int x, int y, int z) const
+{
+  return x >= 0 && x < num_cells_[0] && y >= 0 && y < num_cells_[1] && z >= 0 && z < num_cells_[2];
+}
+
+int SparseDistanceField::getXNumCells() const
+{
+  return num_cells_[0];
+}
+
+int SparseDistanceField::getYNumCells() const
+{
+  return num_cells_[1];
+}
+
+int SparseDistanceField::getZNumCells() const
+{
+  return num_cells_[2];
+}
+
+std::size_t SparseDistanceField::getMemoryUsage() const
+{
+  std::size_t bytes = sizeof(*this) + sqrt_table_.size() * sizeof(double) +
+                      blocks_.bucket_count() * sizeof(void*);
+  for (const auto& block : blocks_)
+    bytes += sizeof(block) + 2 * sizeof(void*) +
+             (block.second.distance_sq.capacity() + block.second.negative_distance_sq.capacity()) *
+                 sizeof(std::uint16_t);
+  return bytes;
+}
+
+bool SparseDistanceField::gridToWorld(int x, int y, int z, double& world_x, double& world_y, double& world_z) const
+{
+  world_x = origin_x_ + resolution_ * double(x);
+  world_y = origin_y_ + resolution_ * double(y);
+  world_z = origin_z_ + resolution_ * double(z);
+  return true;
+}
+
+bool SparseDistanceField::worldToGrid(double world_x, double world_y, double world_z, int& x, int& y, int& z) const
+{
+  x = getCellFromLocation(0, world_x);
+  y = getCellFromLocation(1, world_y);
+  z = getCellFromLocation(2, world_z);
+  return isCellValid(x, y, z);
+}
+bool SparseDistanceField::writeToStream(std::ostream& os) const
+{
+  os << "resolution: " << resolution_ << std::endl;
+  os << "size_x: " << size_x_ << std::endl;
+  os << "size_y: " << size_y_ << std::endl;
+  os << "size_z: " << size_z_ << std::endl;
+  os << "origin_x: " << origin_x_ << std::endl;
+  os << "origin_y: " << origin_y_ << std::endl;
+  os << "origin_z: " << origin_z_ << std::endl;
+
+  // one bit per cell, zlib compressed
+  boost::iostreams::filtering_ostream out;
+  out.push(boost::iostreams::zlib_compressor());
+  out.push(os);
+
+  for (int x = 0; x < getXNumCells(); ++x)
+    for (int y = 0; y < getYNumCells(); ++y)
+      for (int z = 0; z < getZNumCells(); z += 8)
+      {
+        std::bitset<8> bs(0);
+        const int zv = std::min(8, getZNumCells() - z);
+        for (int zi = 0; zi < zv; ++zi)
+          bs[zi] = getDistanceSquared(x, y, z + zi) == 0;
+        const char c = static_cast<char>(bs.to_ulong());
+        out.write(&c, sizeof(char));
+      }
+  out.flush();
+  return true;
+}
+
+bool SparseDistanceField::readFromStream(std::istream& is)
+{
+  if (!is.good())
+    return false;
+
+  std::string temp;
+  for (const std::pair<const char*, double*>& entry :
+       { std::make_pair("resolution:", &resolution_), std::make_pair("size_x:", &size_x_),
+         std::make_pair("size_y:", &size_y_), std::make_pair("size_z:", &size_z_),
+         std::make_pair("origin_x:", &origin_x_), std::make_pair("origin_y:", &origin_y_),
+         std::make_pair("origin_z:", &origin_z_) })
+  {
+    is >> temp;
+    if (temp != entry.first)
+      return false;
+    is >> *entry.second;
+  }
+  inv_twice_resolution_ = 1.0 / (2.0 * resolution_);
+
+  initialize();
+
+  // this should be newline
+  char nl;
+  is.get(nl);
+
+  boost::iostreams::filtering_istream in;
+  in.push(boost::iostreams::zlib_decompressor());
+  in.push(is);
+
+  EigenSTL::vector_Vector3d points;
+  for (int x = 0; x < getXNumCells(); ++x)
+    for (int y = 0; y < getYNumCells(); ++y)
+      for (int z = 0; z < getZNumCells(); z += 8)
+      {
+        char inchar;
+        if (!in.good())
+          return false;
+        in.get(inchar);
+        const std::bitset<8> inbit(static_cast<unsigned char>(inchar));
+        const int zv = std::min(8, getZNumCells() - z);
+        for (int zi = 0; zi < zv; ++zi)
+          if (inbit[zi])
+          {
+            Eigen::Vector3d point;
+            gridToWorld(x, y, z + zi, point.x(), point.y(), point.z());
+            points.push_back(point);
+          }
+      }
+  addPointsToField(points);
+  return true;
+}
+}  // namespace distance_field
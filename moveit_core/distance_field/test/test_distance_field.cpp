@@ -38,11 +38,14 @@
 
 #include <moveit/distance_field/voxel_grid.h>
 #include <moveit/distance_field/propagation_distance_field.h>
+#include <moveit/distance_field/compact_distance_field.h>
+#include <moveit/distance_field/sparse_distance_field.h>
 #include <moveit/distance_field/find_internal_points.h>
 #include <geometric_shapes/body_operations.h>
 #include <tf2_eigen/tf2_eigen.h>
 #include <octomap/octomap.h>
 #include <memory>
+#include <sstream>
 
 using namespace distance_field;
 
@@ -974,6 +977,200 @@ TEST(TestSignedPropagationDistanceField, TestReadWrite)
   EXPECT_FALSE(areDistanceFieldsDistancesEqual(df, df3));
 }
 
+// squared distance in cells of (x, y, z) to the closest cell with (or without) an obstacle, limited to max_dist_sq
+int bruteForceDistanceSquared(const PropagationDistanceField& df, int x, int y, int z, bool to_obstacle,
+                              int max_dist_sq)
+{
+  int best = max_dist_sq;
+  for (int cx = 0; cx < df.getXNumCells(); cx++)
+  {
+    for (int cy = 0; cy < df.getYNumCells(); cy++)
+    {
+      for (int cz = 0; cz < df.getZNumCells(); cz++)
+      {
+        if ((df.getCell(cx, cy, cz).distance_square_ == 0) == to_obstacle)
+          best = std::min(best, dist_sq(x - cx, y - cy, z - cz));
+      }
+    }
+  }
+  return best;
+}
+
+TEST(TestSignedPropagationDistanceField, TestParallelRecompute)
+{
+  PropagationDistanceField df(WIDTH, HEIGHT, DEPTH, RESOLUTION, ORIGIN_X, ORIGIN_Y, ORIGIN_Z, MAX_DIST, true);
+  df.setParallelRecompute(true);
+  const int max_dist_sq = df.getMaximumDistanceSquared();
+
+  shapes::Sphere sphere(.25);
+  Eigen::Isometry3d p = Eigen::Translation3d(0.5, 0.5, 0.5) * Eigen::Quaterniond(0.0, 0.0, 0.0, 1.0);
+  df.addShapeToField(&sphere, p);
+  ASSERT_GT(countOccupiedCells(df), 0u);
+
+  for (int x = 0; x < df.getXNumCells(); x++)
+  {
+    for (int y = 0; y < df.getYNumCells(); y++)
+    {
+      for (int z = 0; z < df.getZNumCells(); z++)
+      {
+        const PropDistanceFieldVoxel& cell = df.getCell(x, y, z);
+        ASSERT_EQ(cell.distance_square_, bruteForceDistanceSquared(df, x, y, z, true, max_dist_sq));
+        ASSERT_EQ(cell.negative_distance_square_, bruteForceDistanceSquared(df, x, y, z, false, max_dist_sq));
+        if (cell.distance_square_ < max_dist_sq)
+        {
+          const Eigen::Vector3i& c = cell.closest_point_;
+          EXPECT_EQ(df.getCell(c.x(), c.y(), c.z()).distance_square_, 0);
+          EXPECT_EQ((cell.closest_point_ - Eigen::Vector3i(x, y, z)).squaredNorm(), cell.distance_square_);
+        }
+        if (cell.negative_distance_square_ < max_dist_sq)
+        {
+          const Eigen::Vector3i& n = cell.closest_negative_point_;
+          EXPECT_GT(df.getCell(n.x(), n.y(), n.z()).distance_square_, 0);
+          EXPECT_EQ((cell.closest_negative_point_ - Eigen::Vector3i(x, y, z)).squaredNorm(),
+                    cell.negative_distance_square_);
+        }
+      }
+    }
+  }
+
+  // removing the shape again results in an empty field
+  df.removeShapeFromField(&sphere, p);
+  PropagationDistanceField empty_df(WIDTH, HEIGHT, DEPTH, RESOLUTION, ORIGIN_X, ORIGIN_Y, ORIGIN_Z, MAX_DIST, true);
+  EXPECT_TRUE(areDistanceFieldsDistancesEqual(df, empty_df));
+}
+
+TEST(TestSignedPropagationDistanceField, TestDistanceGradients)
+{
+  PropagationDistanceField df(WIDTH, HEIGHT, DEPTH, RESOLUTION, ORIGIN_X, ORIGIN_Y, ORIGIN_Z, MAX_DIST, true);
+  shapes::Sphere sphere(.25);
+  Eigen::Isometry3d p = Eigen::Translation3d(0.5, 0.5, 0.5) * Eigen::Quaterniond(0.0, 0.0, 0.0, 1.0);
+  df.addShapeToField(&sphere, p);
+
+  // includes points at the boundary and outside of the field
+  EigenSTL::vector_Vector3d points;
+  for (double x = -0.15; x < WIDTH + 0.2; x += 0.07)
+    for (double y = -0.15; y < HEIGHT + 0.2; y += 0.07)
+      for (double z = -0.15; z < DEPTH + 0.2; z += 0.07)
+        points.push_back(Eigen::Vector3d(x, y, z));
+
+  std::vector<double> distances(points.size());
+  EigenSTL::vector_Vector3d gradients(points.size());
+  df.getDistanceGradients(points.data(), points.size(), distances.data(), gradients.data());
+  for (std::size_t i = 0; i < points.size(); ++i)
+  {
+    Eigen::Vector3d gradient;
+    bool in_bounds;
+    const double distance = df.getDistanceGradient(points[i].x(), points[i].y(), points[i].z(), gradient.x(),
+                                                   gradient.y(), gradient.z(), in_bounds);
+    ASSERT_EQ(distances[i], distance);
+    ASSERT_EQ(gradients[i], gradient);
+  }
+}
+
+bool areDistancesEqual(const DistanceField& df1, const DistanceField& df2)
+{
+  for (int z = 0; z < df1.getZNumCells(); z++)
+  {
+    for (int x = 0; x < df1.getXNumCells(); x++)
+    {
+      for (int y = 0; y < df1.getYNumCells(); y++)
+      {
+        if (df1.getDistance(x, y, z) != df2.getDistance(x, y, z))
+        {
+          printf("Cell %d %d %d distances not equal %g %g\n", x, y, z, df1.getDistance(x, y, z),
+                 df2.getDistance(x, y, z));
+          return false;
+        }
+      }
+    }
+  }
+  return true;
+}
+
+TEST(TestCompactDistanceField, TestCompareWithPropagation)
+{
+  for (bool signed_field : { false, true })
+  {
+    PropagationDistanceField df(WIDTH, HEIGHT, DEPTH, RESOLUTION, ORIGIN_X, ORIGIN_Y, ORIGIN_Z, MAX_DIST, signed_field);
+    df.setParallelRecompute(true);
+    CompactDistanceField cdf(WIDTH, HEIGHT, DEPTH, RESOLUTION, ORIGIN_X, ORIGIN_Y, ORIGIN_Z, MAX_DIST, signed_field);
+    ASSERT_EQ(cdf.getMaximumDistanceSquared(), df.getMaximumDistanceSquared());
+
+    shapes::Sphere sphere(.25);
+    shapes::Box box(.3, .2, .4);
+    Eigen::Isometry3d sphere_pose = Eigen::Translation3d(0.4, 0.5, 0.5) * Eigen::Quaterniond(0.0, 0.0, 0.0, 1.0);
+    Eigen::Isometry3d box_pose = Eigen::Translation3d(0.7, 0.3, 0.6) * Eigen::Quaterniond(0.0, 0.0, 0.0, 1.0);
+    df.addShapeToField(&sphere, sphere_pose);
+    cdf.addShapeToField(&sphere, sphere_pose);
+    df.addShapeToField(&box, box_pose);
+    cdf.addShapeToField(&box, box_pose);
+    EXPECT_TRUE(areDistancesEqual(df, cdf));
+
+    df.removeShapeFromField(&sphere, sphere_pose);
+    cdf.removeShapeFromField(&sphere, sphere_pose);
+    EXPECT_TRUE(areDistancesEqual(df, cdf));
+
+    // both fields use the same file format
+    std::stringstream stream;
+    df.writeToStream(stream);
+    CompactDistanceField read_cdf(WIDTH, HEIGHT, DEPTH, RESOLUTION, ORIGIN_X, ORIGIN_Y, ORIGIN_Z, MAX_DIST,
+                                  signed_field);
+    ASSERT_TRUE(read_cdf.readFromStream(stream));
+    EXPECT_TRUE(areDistancesEqual(df, read_cdf));
+
+    cdf.reset();
+    EXPECT_EQ(cdf.getDistanceSquared(0, 0, 0), cdf.getMaximumDistanceSquared());
+    EXPECT_EQ(cdf.getNegativeDistanceSquared(0, 0, 0), 0);
+  }
+}
+
+TEST(TestSparseDistanceField, TestCompareWithCompact)
+{
+  for (bool signed_field : { false, true })
+  {
+    // a fine resolution, so that the field has several blocks
+    CompactDistanceField cdf(WIDTH, HEIGHT, DEPTH, .02, ORIGIN_X, ORIGIN_Y, ORIGIN_Z, .1, signed_field);
+    SparseDistanceField sdf(WIDTH, HEIGHT, DEPTH, .02, ORIGIN_X, ORIGIN_Y, ORIGIN_Z, .1, signed_field);
+    EXPECT_EQ(sdf.getNumBlocks(), 0u);
+
+    shapes::Sphere sphere(.1);
+    shapes::Box box(.3, .2, .1);
+    Eigen::Isometry3d sphere_pose = Eigen::Translation3d(0.2, 0.2, 0.2) * Eigen::Quaterniond(0.0, 0.0, 0.0, 1.0);
+    Eigen::Isometry3d box_pose = Eigen::Translation3d(0.7, 0.8, 0.9) * Eigen::Quaterniond(0.0, 0.0, 0.0, 1.0);
+    cdf.addShapeToField(&sphere, sphere_pose);
+    sdf.addShapeToField(&sphere, sphere_pose);
+    cdf.addShapeToField(&box, box_pose);
+    sdf.addShapeToField(&box, box_pose);
+    EXPECT_TRUE(areDistancesEqual(cdf, sdf));
+
+    // only the blocks near the obstacles are allocated
+    const int num_blocks = std::ceil(sdf.getXNumCells() / double(SparseDistanceField::BLOCK_SIZE)) *
+                           std::ceil(sdf.getYNumCells() / double(SparseDistanceField::BLOCK_SIZE)) *
+                           std::ceil(sdf.getZNumCells() / double(SparseDistanceField::BLOCK_SIZE));
+    EXPECT_GT(sdf.getNumBlocks(), 0u);
+    EXPECT_LT(sdf.getNumBlocks(), static_cast<std::size_t>(num_blocks));
+    const std::size_t sparse_bytes = sdf.getMemoryUsage();
+    EXPECT_GT(cdf.getMemoryUsage(), std::size_t(cdf.getXNumCells()) * cdf.getYNumCells() * cdf.getZNumCells() *
+                                        sizeof(std::uint16_t));
+
+    cdf.moveShapeInField(&sphere, sphere_pose, box_pose);
+    sdf.moveShapeInField(&sphere, sphere_pose, box_pose);
+    EXPECT_TRUE(areDistancesEqual(cdf, sdf));
+
+    std::stringstream stream;
+    sdf.writeToStream(stream);
+    SparseDistanceField read_sdf(WIDTH, HEIGHT, DEPTH, .02, ORIGIN_X, ORIGIN_Y, ORIGIN_Z, .1, signed_field);
+    ASSERT_TRUE(read_sdf.readFromStream(stream));
+    EXPECT_TRUE(areDistancesEqual(cdf, read_sdf));
+
+    // blocks are freed when their obstacles are removed
+    sdf.removeShapeFromField(&sphere, box_pose);
+    sdf.removeShapeFromField(&box, box_pose);
+    EXPECT_EQ(sdf.getNumBlocks(), 0u);
+    EXPECT_LT(sdf.getMemoryUsage(), sparse_bytes);
+  }
+}
+
 int main(int argc, char** argv)
 {
   testing::InitGoogleTest(&argc, argv);
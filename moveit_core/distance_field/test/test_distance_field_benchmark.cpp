@@ -0,0 +1,113 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, PickNik LLC
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik LLC nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+#include <gtest/gtest.h>
+#include <moveit/distance_field/propagation_distance_field.h>
+#include <geometric_shapes/shapes.h>
+#include <chrono>
+#include <iostream>
+#include <string>
+
+using distance_field::PropagationDistanceField;
+
+// same dimensions as the test_big.df field of test_distance_field
+static const double WIDTH = 3.0;
+static const double HEIGHT = 3.0;
+static const double DEPTH = 4.0;
+static const double RESOLUTION = 0.02;
+static const double MAX_DIST = .25;
+
+// distances obtained by recomputation are exact, while propagation can only overestimate them
+void expectRecomputedDistancesNotGreater(const PropagationDistanceField& recomputed,
+                                         const PropagationDistanceField& propagated)
+{
+  std::size_t greater = 0, negative_greater = 0;
+  for (int x = 0; x < recomputed.getXNumCells(); ++x)
+    for (int y = 0; y < recomputed.getYNumCells(); ++y)
+      for (int z = 0; z < recomputed.getZNumCells(); ++z)
+      {
+        const distance_field::PropDistanceFieldVoxel& cell = recomputed.getCell(x, y, z);
+        greater += cell.distance_square_ > propagated.getCell(x, y, z).distance_square_;
+        negative_greater += cell.negative_distance_square_ > propagated.getCell(x, y, z).negative_distance_square_;
+      }
+  EXPECT_EQ(greater, 0u);
+  EXPECT_EQ(negative_greater, 0u);
+}
+
+void benchmark(bool signed_field)
+{
+  const shapes::Sphere sphere(.5);
+  const shapes::Box table(2.0, 2.0, .5);
+  const Eigen::Isometry3d sphere_pose(Eigen::Translation3d(0.5, 0.5, 0.5));
+  const Eigen::Isometry3d table_pose(Eigen::Translation3d(1.5, 1.5, 2.0));
+
+  PropagationDistanceField propagated(WIDTH, HEIGHT, DEPTH, RESOLUTION, 0.0, 0.0, 0.0, MAX_DIST, signed_field);
+  PropagationDistanceField recomputed(WIDTH, HEIGHT, DEPTH, RESOLUTION, 0.0, 0.0, 0.0, MAX_DIST, signed_field);
+  recomputed.setParallelRecompute(true);
+
+  for (PropagationDistanceField* df : { &propagated, &recomputed })
+  {
+    const std::string name = std::string(signed_field ? "signed" : "unsigned") +
+                             (df->getParallelRecompute() ? " with parallel recompute" : " with propagation");
+
+    auto start = std::chrono::steady_clock::now();
+    df->addShapeToField(&sphere, sphere_pose);
+    df->addShapeToField(&table, table_pose);
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    std::cerr << "Adding shapes to " << name << " took " << elapsed.count() << " secs" << std::endl;
+
+    start = std::chrono::steady_clock::now();
+    df->removeShapeFromField(&sphere, sphere_pose);
+    elapsed = std::chrono::steady_clock::now() - start;
+    std::cerr << "Removing sphere from " << name << " took " << elapsed.count() << " secs" << std::endl;
+  }
+  expectRecomputedDistancesNotGreater(recomputed, propagated);
+}
+
+TEST(TestPropagationDistanceField, BenchmarkParallelRecompute)
+{
+  benchmark(false);
+}
+
+TEST(TestSignedPropagationDistanceField, BenchmarkParallelRecompute)
+{
+  benchmark(true);
+}
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
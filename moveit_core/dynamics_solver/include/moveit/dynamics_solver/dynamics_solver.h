@@ -39,8 +39,10 @@
 // KDL
 #include <kdl/chain.hpp>
 #include <kdl/chainidsolver_recursive_newton_euler.hpp>
+#include <kdl/jntarray.hpp>
 
 #include <moveit/robot_state/robot_state.h>
+#include <moveit/robot_trajectory/robot_trajectory.h>
 #include <geometry_msgs/msg/vector3.hpp>
 #include <geometry_msgs/msg/wrench.hpp>
 #include <memory>
@@ -87,6 +89,44 @@ public:
                   const std::vector<double>& joint_accelerations,
                   const std::vector<geometry_msgs::msg::Wrench>& wrenches, std::vector<double>& torques) const;
 
+  /**
+   * @brief Get the torques for a batch of waypoints, with the only external wrench
+   * being the weight of a payload attached to the last link, as for getPayloadTorques().
+   * Each column holds the values of one waypoint, in the order of the joints of this
+   * group in the RobotModel. The workspaces of the solver are reused for all
+   * waypoints, so no allocation happens per waypoint.
+   * @param joint_angles The joint angles, with rows = number of joints in the group
+   * @param joint_velocities The joint velocities, of the same size as joint_angles
+   * @param joint_accelerations The joint accelerations, of the same size as joint_angles
+   * @param torques Resized to the size of joint_angles and filled with the computed torques
+   * @param payload The payload (in kg)
+   * @return False if any of the input matrices are of the wrong size
+   */
+  bool getTorques(const Eigen::MatrixXd& joint_angles, const Eigen::MatrixXd& joint_velocities,
+                  const Eigen::MatrixXd& joint_accelerations, Eigen::MatrixXd& torques, double payload = 0.0) const;
+
+  /**
+   * @brief Get the torques required to follow a trajectory, one column per waypoint.
+   * Waypoints without velocities or accelerations use zero velocities or accelerations.
+   * @param trajectory The trajectory, whose waypoints must contain the joints of this group
+   * @param torques Filled with the computed torques, rows = number of joints in the group
+   * @param payload The payload attached to the last link (in kg)
+   * @return False if the torques could not be computed
+   */
+  bool getTrajectoryTorques(const robot_trajectory::RobotTrajectory& trajectory, Eigen::MatrixXd& torques,
+                            double payload = 0.0) const;
+
+  /**
+   * @brief Check torques against the maximum torques of this group. Joints
+   * without an effort limit (a maximum torque of zero) are not checked.
+   * @param torques The torques to check, one column per waypoint as computed by getTorques()
+   * @param waypoint If not null, set to the first waypoint exceeding the limits
+   * @param joint If not null, set to the first joint exceeding its limit at that waypoint
+   * @return True if all torques are within the limits
+   */
+  bool withinTorqueLimits(const Eigen::MatrixXd& torques, std::size_t* waypoint = nullptr,
+                          unsigned int* joint = nullptr) const;
+
   /**
    * @brief Get the maximum payload for this group (in kg). Payload is
    * the weight that this group can hold when the weight is attached to the origin
@@ -100,6 +140,18 @@ public:
    */
   bool getMaxPayload(const std::vector<double>& joint_angles, double& payload, unsigned int& joint_saturated) const;
 
+  /**
+   * @brief Get the maximum payload for a batch of joint configurations, as
+   * computed by the single configuration version of getMaxPayload()
+   * @param joint_angles The joint angles, one column per configuration
+   * with rows = number of joints in the group
+   * @param payloads The computed maximum payload of each configuration
+   * @param joints_saturated The first saturated joint of each configuration
+   * @return False if the input matrix is of the wrong size
+   */
+  bool getMaxPayload(const Eigen::MatrixXd& joint_angles, std::vector<double>& payloads,
+                     std::vector<unsigned int>& joints_saturated) const;
+
   /**
    * @brief Get torques corresponding to a particular payload value.  Payload is
    * the weight that this group can hold when the weight is attached to the origin
@@ -134,6 +186,16 @@ public:
   }
 
 private:
+  /** @brief Torques of a single configuration, computed in the preallocated KDL workspaces */
+  bool computeTorques(const double* joint_angles, const double* joint_velocities, const double* joint_accelerations,
+                      const KDL::Wrenches& wrenches, double* torques) const;
+
+  /** @brief Set the wrenches to a force along gravity, of the given norm, acting on the last link */
+  void setTipForce(const double* joint_angles, double force, KDL::Wrenches& wrenches) const;
+
+  /** @brief Maximum payload of a single configuration of valid size */
+  bool computeMaxPayload(const double* joint_angles, double& payload, unsigned int& joint_saturated) const;
+
   std::shared_ptr<KDL::ChainIdSolver_RNE> chain_id_solver_;  // KDL chain inverse dynamics
   KDL::Chain kdl_chain_;                                     // KDL chain
 
@@ -147,5 +209,12 @@ private:
   std::vector<double> max_torques_;         // vector of max torques
 
   double gravity_;  // Norm of the gravity vector passed in initialize()
+
+  // workspaces reused by all torque computations
+  mutable KDL::JntArray kdl_angles_, kdl_velocities_, kdl_accelerations_, kdl_torques_;
+  mutable KDL::Wrenches kdl_wrenches_;
+  KDL::Wrenches zero_wrenches_;
+  std::vector<double> zero_values_;
+  mutable std::vector<double> zero_torques_, payload_torques_;
 };
 }  // namespace dynamics_solver
@@ -138,6 +138,16 @@ DynamicsSolver::DynamicsSolver(const moveit::core::RobotModelConstPtr& robot_mod
   RCLCPP_DEBUG(LOGGER, "Gravity norm set to %f", gravity_);
 
   chain_id_solver_.reset(new KDL::ChainIdSolver_RNE(kdl_chain_, gravity));
+
+  kdl_angles_.resize(num_joints_);
+  kdl_velocities_.resize(num_joints_);
+  kdl_accelerations_.resize(num_joints_);
+  kdl_torques_.resize(num_joints_);
+  kdl_wrenches_.assign(num_segments_, KDL::Wrench::Zero());
+  zero_wrenches_.assign(num_segments_, KDL::Wrench::Zero());
+  zero_values_.assign(num_joints_, 0.0);
+  zero_torques_.assign(num_joints_, 0.0);
+  payload_torques_.assign(num_joints_, 0.0);
 }
 
 bool DynamicsSolver::getTorques(const std::vector<double>& joint_angles, const std::vector<double>& joint_velocities,
@@ -177,36 +187,137 @@ bool DynamicsSolver::getTorques(const std::vector<double>& joint_angles, const s
     return false;
   }
 
-  KDL::JntArray kdl_angles(num_joints_), kdl_velocities(num_joints_), kdl_accelerations(num_joints_),
-      kdl_torques(num_joints_);
-  KDL::Wrenches kdl_wrenches(num_segments_);
+  for (unsigned int i = 0; i < num_segments_; ++i)
+  {
+    kdl_wrenches_[i](0) = wrenches[i].force.x;
+    kdl_wrenches_[i](1) = wrenches[i].force.y;
+    kdl_wrenches_[i](2) = wrenches[i].force.z;
+
+    kdl_wrenches_[i](3) = wrenches[i].torque.x;
+    kdl_wrenches_[i](4) = wrenches[i].torque.y;
+    kdl_wrenches_[i](5) = wrenches[i].torque.z;
+  }
 
-  for (unsigned int i = 0; i < num_joints_; ++i)
+  return computeTorques(joint_angles.data(), joint_velocities.data(), joint_accelerations.data(), kdl_wrenches_,
+                        torques.data());
+}
+
+bool DynamicsSolver::getTorques(const Eigen::MatrixXd& joint_angles, const Eigen::MatrixXd& joint_velocities,
+                                const Eigen::MatrixXd& joint_accelerations, Eigen::MatrixXd& torques,
+                                double payload) const
+{
+  if (!joint_model_group_)
   {
-    kdl_angles(i) = joint_angles[i];
-    kdl_velocities(i) = joint_velocities[i];
-    kdl_accelerations(i) = joint_accelerations[i];
+    RCLCPP_DEBUG(LOGGER, "Did not construct DynamicsSolver object properly. "
+                         "Check error logs.");
+    return false;
+  }
+  if (joint_angles.rows() != static_cast<Eigen::Index>(num_joints_))
+  {
+    RCLCPP_ERROR(LOGGER, "Joint angles matrix should have %d rows", num_joints_);
+    return false;
+  }
+  if (joint_velocities.rows() != joint_angles.rows() || joint_velocities.cols() != joint_angles.cols())
+  {
+    RCLCPP_ERROR(LOGGER, "Joint velocities matrix should be of the size of the joint angles matrix");
+    return false;
+  }
+  if (joint_accelerations.rows() != joint_angles.rows() || joint_accelerations.cols() != joint_angles.cols())
+  {
+    RCLCPP_ERROR(LOGGER, "Joint accelerations matrix should be of the size of the joint angles matrix");
+    return false;
   }
 
-  for (unsigned int i = 0; i < num_segments_; ++i)
+  torques.resize(num_joints_, joint_angles.cols());
+  for (Eigen::Index i = 0; i < joint_angles.cols(); ++i)
+  {
+    if (payload != 0.0)
+      setTipForce(joint_angles.col(i).data(), payload * gravity_, kdl_wrenches_);
+    if (!computeTorques(joint_angles.col(i).data(), joint_velocities.col(i).data(), joint_accelerations.col(i).data(),
+                        payload != 0.0 ? kdl_wrenches_ : zero_wrenches_, torques.col(i).data()))
+      return false;
+  }
+  return true;
+}
+
+bool DynamicsSolver::getTrajectoryTorques(const robot_trajectory::RobotTrajectory& trajectory,
+                                          Eigen::MatrixXd& torques, double payload) const
+{
+  if (!joint_model_group_)
+  {
+    RCLCPP_DEBUG(LOGGER, "Did not construct DynamicsSolver object properly. "
+                         "Check error logs.");
+    return false;
+  }
+  if (joint_model_group_->getVariableCount() != num_joints_)
+  {
+    RCLCPP_ERROR(LOGGER, "Group '%s' has %d variables but the chain has %d joints",
+                 joint_model_group_->getName().c_str(), joint_model_group_->getVariableCount(), num_joints_);
+    return false;
+  }
+
+  const std::size_t count = trajectory.getWayPointCount();
+  Eigen::MatrixXd joint_angles(num_joints_, count);
+  Eigen::MatrixXd joint_velocities = Eigen::MatrixXd::Zero(num_joints_, count);
+  Eigen::MatrixXd joint_accelerations = Eigen::MatrixXd::Zero(num_joints_, count);
+  for (std::size_t i = 0; i < count; ++i)
+  {
+    const moveit::core::RobotState& waypoint = trajectory.getWayPoint(i);
+    waypoint.copyJointGroupPositions(joint_model_group_, joint_angles.col(i).data());
+    if (waypoint.hasVelocities())
+      waypoint.copyJointGroupVelocities(joint_model_group_, joint_velocities.col(i).data());
+    if (waypoint.hasAccelerations())
+      waypoint.copyJointGroupAccelerations(joint_model_group_, joint_accelerations.col(i).data());
+  }
+  return getTorques(joint_angles, joint_velocities, joint_accelerations, torques, payload);
+}
+
+bool DynamicsSolver::withinTorqueLimits(const Eigen::MatrixXd& torques, std::size_t* waypoint,
+                                        unsigned int* joint) const
+{
+  if (torques.rows() != static_cast<Eigen::Index>(num_joints_) || max_torques_.size() < num_joints_)
+  {
+    RCLCPP_ERROR(LOGGER, "Torques matrix should have %d rows", num_joints_);
+    return false;
+  }
+  for (Eigen::Index i = 0; i < torques.cols(); ++i)
   {
-    kdl_wrenches[i](0) = wrenches[i].force.x;
-    kdl_wrenches[i](1) = wrenches[i].force.y;
-    kdl_wrenches[i](2) = wrenches[i].force.z;
+    for (unsigned int j = 0; j < num_joints_; ++j)
+    {
+      if (max_torques_[j] > 0.0 && fabs(torques(j, i)) > max_torques_[j])
+      {
+        RCLCPP_DEBUG(LOGGER, "Joint %d exceeds its torque limit at waypoint %ld: %f > %f", j, static_cast<long>(i),
+                     fabs(torques(j, i)), max_torques_[j]);
+        if (waypoint)
+          *waypoint = i;
+        if (joint)
+          *joint = j;
+        return false;
+      }
+    }
+  }
+  return true;
+}
 
-    kdl_wrenches[i](3) = wrenches[i].torque.x;
-    kdl_wrenches[i](4) = wrenches[i].torque.y;
-    kdl_wrenches[i](5) = wrenches[i].torque.z;
+bool DynamicsSolver::computeTorques(const double* joint_angles, const double* joint_velocities,
+                                    const double* joint_accelerations, const KDL::Wrenches& wrenches,
+                                    double* torques) const
+{
+  for (unsigned int i = 0; i < num_joints_; ++i)
+  {
+    kdl_angles_(i) = joint_angles[i];
+    kdl_velocities_(i) = joint_velocities[i];
+    kdl_accelerations_(i) = joint_accelerations[i];
   }
 
-  if (chain_id_solver_->CartToJnt(kdl_angles, kdl_velocities, kdl_accelerations, kdl_wrenches, kdl_torques) < 0)
+  if (chain_id_solver_->CartToJnt(kdl_angles_, kdl_velocities_, kdl_accelerations_, wrenches, kdl_torques_) < 0)
   {
     RCLCPP_ERROR(LOGGER, "Something went wrong computing torques");
     return false;
   }
 
   for (unsigned int i = 0; i < num_joints_; ++i)
-    torques[i] = kdl_torques(i);
+    torques[i] = kdl_torques_(i);
 
   return true;
 }
@@ -225,16 +336,55 @@ bool DynamicsSolver::getMaxPayload(const std::vector<double>& joint_angles, doub
     RCLCPP_ERROR(LOGGER, "Joint angles vector should be size %d", num_joints_);
     return false;
   }
-  std::vector<double> joint_velocities(num_joints_, 0.0), joint_accelerations(num_joints_, 0.0);
-  std::vector<double> torques(num_joints_, 0.0), zero_torques(num_joints_, 0.0);
+  return computeMaxPayload(joint_angles.data(), payload, joint_saturated);
+}
 
-  std::vector<geometry_msgs::msg::Wrench> wrenches(num_segments_);
-  if (!getTorques(joint_angles, joint_velocities, joint_accelerations, wrenches, zero_torques))
+bool DynamicsSolver::getMaxPayload(const Eigen::MatrixXd& joint_angles, std::vector<double>& payloads,
+                                   std::vector<unsigned int>& joints_saturated) const
+{
+  if (!joint_model_group_)
+  {
+    RCLCPP_DEBUG(LOGGER, "Did not construct DynamicsSolver object properly. "
+                         "Check error logs.");
+    return false;
+  }
+  if (joint_angles.rows() != static_cast<Eigen::Index>(num_joints_))
+  {
+    RCLCPP_ERROR(LOGGER, "Joint angles matrix should have %d rows", num_joints_);
+    return false;
+  }
+  payloads.resize(joint_angles.cols());
+  joints_saturated.resize(joint_angles.cols());
+  for (Eigen::Index i = 0; i < joint_angles.cols(); ++i)
+  {
+    if (!computeMaxPayload(joint_angles.col(i).data(), payloads[i], joints_saturated[i]))
+      return false;
+  }
+  return true;
+}
+
+void DynamicsSolver::setTipForce(const double* joint_angles, double force, KDL::Wrenches& wrenches) const
+{
+  state_->setJointGroupPositions(joint_model_group_, joint_angles);
+  const Eigen::Isometry3d& base_frame = state_->getFrameTransform(base_name_);  // valid isometry by contract
+  const Eigen::Isometry3d& tip_frame = state_->getFrameTransform(tip_name_);    // valid isometry by contract
+  Eigen::Isometry3d transform = tip_frame.inverse() * base_frame;               // valid isometry by construction
+  const Eigen::Vector3d tip_force = transform.linear() * Eigen::Vector3d(0.0, 0.0, force);
+  wrenches = zero_wrenches_;
+  wrenches.back().force = KDL::Vector(tip_force.x(), tip_force.y(), tip_force.z());
+
+  RCLCPP_DEBUG(LOGGER, "New wrench (local frame): %f %f %f", tip_force.x(), tip_force.y(), tip_force.z());
+}
+
+bool DynamicsSolver::computeMaxPayload(const double* joint_angles, double& payload,
+                                       unsigned int& joint_saturated) const
+{
+  if (!computeTorques(joint_angles, zero_values_.data(), zero_values_.data(), zero_wrenches_, zero_torques_.data()))
     return false;
 
   for (unsigned int i = 0; i < num_joints_; ++i)
   {
-    if (fabs(zero_torques[i]) >= max_torques_[i])
+    if (fabs(zero_torques_[i]) >= max_torques_[i])
     {
       payload = 0.0;
       joint_saturated = i;
@@ -242,20 +392,12 @@ bool DynamicsSolver::getMaxPayload(const std::vector<double>& joint_angles, doub
     }
   }
 
-  state_->setJointGroupPositions(joint_model_group_, joint_angles);
-  const Eigen::Isometry3d& base_frame = state_->getFrameTransform(base_name_);  // valid isometry by contract
-  const Eigen::Isometry3d& tip_frame = state_->getFrameTransform(tip_name_);    // valid isometry by contract
-  Eigen::Isometry3d transform = tip_frame.inverse() * base_frame;               // valid isometry by construction
-  wrenches.back().force.z = 1.0;
-  wrenches.back().force = transformVector(transform, wrenches.back().force);
-  wrenches.back().torque = transformVector(transform, wrenches.back().torque);
-
-  RCLCPP_DEBUG(LOGGER, "New wrench (local frame): %f %f %f", wrenches.back().force.x, wrenches.back().force.y,
-               wrenches.back().force.z);
-
-  if (!getTorques(joint_angles, joint_velocities, joint_accelerations, wrenches, torques))
+  setTipForce(joint_angles, 1.0, kdl_wrenches_);
+  if (!computeTorques(joint_angles, zero_values_.data(), zero_values_.data(), kdl_wrenches_, payload_torques_.data()))
     return false;
 
+  const std::vector<double>& zero_torques = zero_torques_;
+  const std::vector<double>& torques = payload_torques_;
   double min_payload = std::numeric_limits<double>::max();
   for (unsigned int i = 0; i < num_joints_; ++i)
   {
@@ -246,6 +246,18 @@ public:
   bool equal(const KinematicConstraint& other, double margin) const override;
 
   ConstraintEvaluationResult decide(const moveit::core::RobotState& state, bool verbose = false) const override;
+
+  /**
+   * \brief Decide whether the constraint is satisfied by a value of the
+   * constrained joint variable
+   *
+   * @param [in] current_joint_position The value of the joint variable
+   * @param [in] verbose Whether or not to print output
+   *
+   * @return The evaluation result, as for decide() on a state with this value
+   */
+  ConstraintEvaluationResult decide(double current_joint_position, bool verbose = false) const;
+
   bool enabled() const override;
   void clear() override;
   void print(std::ostream& out = std::cout) const override;
@@ -322,6 +334,17 @@ public:
     return joint_tolerance_below_;
   }
 
+  /**
+   * \brief Whether the constrained variable is continuous, in which
+   * case distances are computed with angle wrapping
+   *
+   * @return True if the constrained variable is continuous
+   */
+  bool isJointContinuous() const
+  {
+    return joint_is_continuous_;
+  }
+
 protected:
   const moveit::core::JointModel* joint_model_; /**< \brief The joint from the kinematic model for this constraint */
   bool joint_is_continuous_;                    /**< \brief Whether or not the joint is continuous */
@@ -396,6 +419,20 @@ public:
 
   void clear() override;
   ConstraintEvaluationResult decide(const moveit::core::RobotState& state, bool verbose = false) const override;
+
+  /**
+   * \brief Decide whether the constraint is satisfied by a link transform
+   *
+   * @param [in] link_transform The global transform of the constrained link
+   * @param [in] frame_transform The global transform of the reference frame,
+   * only used if it is a mobile frame
+   * @param [in] verbose Whether or not to print output
+   *
+   * @return The evaluation result, as for decide() on a state with these transforms
+   */
+  ConstraintEvaluationResult decide(const Eigen::Isometry3d& link_transform, const Eigen::Isometry3d& frame_transform,
+                                    bool verbose = false) const;
+
   bool enabled() const override;
   void print(std::ostream& out = std::cout) const override;
 
@@ -566,6 +603,20 @@ public:
 
   void clear() override;
   ConstraintEvaluationResult decide(const moveit::core::RobotState& state, bool verbose = false) const override;
+
+  /**
+   * \brief Decide whether the constraint is satisfied by a link transform
+   *
+   * @param [in] link_transform The global transform of the constrained link
+   * @param [in] frame_transform The global transform of the reference frame,
+   * only used if it is a mobile frame
+   * @param [in] verbose Whether or not to print output
+   *
+   * @return The evaluation result, as for decide() on a state with these transforms
+   */
+  ConstraintEvaluationResult decide(const Eigen::Isometry3d& link_transform, const Eigen::Isometry3d& frame_transform,
+                                    bool verbose = false) const;
+
   bool enabled() const override;
   void print(std::ostream& out = std::cout) const override;
 
@@ -967,6 +1018,50 @@ public:
   ConstraintEvaluationResult decide(const moveit::core::RobotState& state,
                                     std::vector<ConstraintEvaluationResult>& results, bool verbose = false) const;
 
+  /**
+   * \brief Determines whether all constraints are satisfied by state,
+   * without computing distances.
+   *
+   * The constraints are compiled into flat arrays when they are added,
+   * so this check does not allocate memory or dispatch virtually for
+   * joint constraints, orientation constraints and position constraints
+   * with box, sphere and cylinder regions.  The cheapest checks are run
+   * first and the evaluation stops at the first violated constraint.
+   * Other constraints are evaluated with decide().
+   *
+   * @param [in] state The state to test
+   *
+   * @return True if all constraints are satisfied, as reported by decide()
+   */
+  bool isSatisfied(const moveit::core::RobotState& state) const;
+
+  /**
+   * \brief Determines whether the constraints are satisfied by a batch
+   * of states that only differ in the variables of a group, e.g. the
+   * waypoints of a trajectory
+   *
+   * The link transforms of all states are computed at once with
+   * moveit::core::RobotState::computeGroupLinkTransforms(), and joint,
+   * position and orientation constraints are evaluated on them
+   * directly.  Other constraints, and constraints relative to frames
+   * that are not robot links, are evaluated with decide() on a copy of
+   * \e state set to each group configuration.
+   *
+   * @param [in] state The state providing the variables outside of the
+   * group.  Its link transforms are updated.
+   * @param [in] group The group whose variables differ between the states
+   * @param [in] group_positions The \e state_count group configurations,
+   * each in the order of group->getVariableNames()
+   * @param [in] state_count The number of states
+   *
+   * @param [out] results The evaluation result of each state, with a
+   * distance that is the sum of all individual distances, as returned
+   * by decide()
+   */
+  void decideBatch(moveit::core::RobotState& state, const moveit::core::JointModelGroup* group,
+                   const double* group_positions, std::size_t state_count,
+                   std::vector<ConstraintEvaluationResult>& results) const;
+
   /**
    * \brief Whether or not another KinematicConstraintSet is equal to
    * this one.
@@ -1046,6 +1141,17 @@ public:
     return all_constraints_;
   }
 
+  /**
+   * \brief Get all the configured constraints in the set
+   *
+   *
+   * @return The constraints, in the order they were added
+   */
+  const std::vector<KinematicConstraintPtr>& getKinematicConstraints() const
+  {
+    return kinematic_constraints_;
+  }
+
   /**
    * \brief Returns whether or not there are any constraints in the set
    *
@@ -1058,6 +1164,60 @@ public:
   }
 
 protected:
+  /** \brief A reference frame of a compiled constraint */
+  struct CompiledFrame
+  {
+    bool mobile;                               /**< \brief Whether the frame has to be looked up in the state */
+    const moveit::core::LinkModel* link_model; /**< \brief The robot link of a mobile frame, if it is one */
+    std::string frame_id;                      /**< \brief The name of a mobile frame that is not a robot link */
+  };
+
+  /** \brief A box, sphere or cylinder region of a compiled position constraint */
+  struct CompiledRegion
+  {
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+    int type;                       /**< \brief The shapes::ShapeType of the region */
+    Eigen::Isometry3d inverse_pose; /**< \brief The inverse of the region pose in the constraint frame */
+
+    /** \brief The half extents of a box, or the squared radius (x) and the half length (z) of a sphere or
+     * cylinder, including scale and padding */
+    Eigen::Vector3d extents;
+  };
+
+  /** \brief A compiled position constraint, satisfied if the point lies in one of its regions */
+  struct CompiledPositionConstraint
+  {
+    const moveit::core::LinkModel* link_model;
+    Eigen::Vector3d offset;
+    CompiledFrame frame;
+    std::size_t regions_begin, regions_end; /**< \brief The range of the regions in compiled_regions_ */
+  };
+
+  /** \brief A compiled orientation constraint */
+  struct CompiledOrientationConstraint
+  {
+    const moveit::core::LinkModel* link_model;
+
+    /** \brief The inverse desired rotation for fixed frames, the desired rotation for mobile ones */
+    Eigen::Matrix3d desired_rotation;
+    Eigen::Vector3d tolerance; /**< \brief The axis tolerances, including the epsilon used by decide() */
+    CompiledFrame frame;
+  };
+
+  /** \brief A compiled constraint on a continuous joint variable */
+  struct CompiledContinuousJointConstraint
+  {
+    int variable_index;
+    double position, lower, upper;
+  };
+
+  /** \brief Rebuild the compiled constraints used by isSatisfied() from kinematic_constraints_ */
+  void compile();
+
+  /** \brief Compile a mobile reference frame */
+  CompiledFrame compileFrame(bool mobile, const std::string& frame_id) const;
+
   moveit::core::RobotModelConstPtr robot_model_; /**< \brief The kinematic model used for by the Set */
   std::vector<KinematicConstraintPtr>
       kinematic_constraints_; /**<  \brief Shared pointers to all the member constraints */
@@ -1073,5 +1233,20 @@ protected:
                                                                                all
                                                                                internal visibility constraints */
   moveit_msgs::msg::Constraints all_constraints_; /**<  \brief Messages corresponding to all internal constraints */
+
+  /** \brief Compiled constraints on non-continuous joint variables, as intervals of the difference to the
+   * desired position */
+  std::vector<int> compiled_joint_indices_;
+  std::vector<double> compiled_joint_positions_;
+  std::vector<double> compiled_joint_lower_;
+  std::vector<double> compiled_joint_upper_;
+
+  std::vector<CompiledContinuousJointConstraint> compiled_continuous_joints_;
+  std::vector<CompiledPositionConstraint> compiled_positions_;
+  std::vector<CompiledRegion, Eigen::aligned_allocator<CompiledRegion>> compiled_regions_;
+  std::vector<CompiledOrientationConstraint> compiled_orientations_;
+
+  /** \brief Constraints that are not compiled and are evaluated with decide() */
+  std::vector<const KinematicConstraint*> uncompiled_constraints_;
 };
 }  // namespace kinematic_constraints
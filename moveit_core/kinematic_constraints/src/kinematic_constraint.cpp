@@ -221,7 +221,14 @@ ConstraintEvaluationResult JointConstraint::decide(const moveit::core::RobotStat
   if (!joint_model_)
     return ConstraintEvaluationResult(true, 0.0);
 
-  double current_joint_position = state.getVariablePosition(joint_variable_index_);
+  return decide(state.getVariablePosition(joint_variable_index_), verbose);
+}
+
+ConstraintEvaluationResult JointConstraint::decide(double current_joint_position, bool verbose) const
+{
+  if (!joint_model_)
+    return ConstraintEvaluationResult(true, 0.0);
+
   double dif = 0.0;
 
   // compute signed shortest distance for continuous joints
@@ -446,19 +453,30 @@ ConstraintEvaluationResult PositionConstraint::decide(const moveit::core::RobotS
   if (!link_model_ || constraint_region_.empty())
     return ConstraintEvaluationResult(true, 0.0);
 
-  Eigen::Vector3d pt = state.getGlobalLinkTransform(link_model_) * offset_;
+  return decide(state.getGlobalLinkTransform(link_model_),
+                mobile_frame_ ? state.getFrameTransform(constraint_frame_id_) : Eigen::Isometry3d::Identity(), verbose);
+}
+
+ConstraintEvaluationResult PositionConstraint::decide(const Eigen::Isometry3d& link_transform,
+                                                      const Eigen::Isometry3d& frame_transform, bool verbose) const
+{
+  if (!link_model_ || constraint_region_.empty())
+    return ConstraintEvaluationResult(true, 0.0);
+
+  Eigen::Vector3d pt = link_transform * offset_;
   if (mobile_frame_)
   {
+    // the regions are posed in the mobile frame, so the point is moved to that frame instead of the regions
+    const Eigen::Vector3d frame_pt = frame_transform.inverse() * pt;
     for (std::size_t i = 0; i < constraint_region_.size(); ++i)
     {
-      Eigen::Isometry3d tmp = state.getFrameTransform(constraint_frame_id_) * constraint_region_pose_[i];
-      bool result = constraint_region_[i]->cloneAt(tmp)->containsPoint(pt, verbose);
+      const Eigen::Vector3d desired = frame_transform * constraint_region_pose_[i].translation();
+      bool result = constraint_region_[i]->containsPoint(frame_pt, verbose);
       if (result || (i + 1 == constraint_region_pose_.size()))
-        return finishPositionConstraintDecision(pt, tmp.translation(), link_model_->getName(), constraint_weight_,
-                                                result, verbose);
+        return finishPositionConstraintDecision(pt, desired, link_model_->getName(), constraint_weight_, result,
+                                                verbose);
       else
-        finishPositionConstraintDecision(pt, tmp.translation(), link_model_->getName(), constraint_weight_, result,
-                                         verbose);
+        finishPositionConstraintDecision(pt, desired, link_model_->getName(), constraint_weight_, result, verbose);
     }
   }
   else
@@ -601,6 +619,18 @@ bool OrientationConstraint::enabled() const
 }
 
 ConstraintEvaluationResult OrientationConstraint::decide(const moveit::core::RobotState& state, bool verbose) const
+{
+  if (!link_model_)
+    return ConstraintEvaluationResult(true, 0.0);
+
+  // getFrameTransform() and getGlobalLinkTransform() return valid isometries by contract
+  return decide(state.getGlobalLinkTransform(link_model_),
+                mobile_frame_ ? state.getFrameTransform(desired_rotation_frame_id_) : Eigen::Isometry3d::Identity(),
+                verbose);
+}
+
+ConstraintEvaluationResult OrientationConstraint::decide(const Eigen::Isometry3d& link_transform,
+                                                         const Eigen::Isometry3d& frame_transform, bool verbose) const
 {
   if (!link_model_)
     return ConstraintEvaluationResult(true, 0.0);
@@ -608,17 +638,15 @@ ConstraintEvaluationResult OrientationConstraint::decide(const moveit::core::Rob
   Eigen::Vector3d xyz;
   if (mobile_frame_)
   {
-    // getFrameTransform() returns a valid isometry by contract
-    Eigen::Matrix3d tmp = state.getFrameTransform(desired_rotation_frame_id_).linear() * desired_rotation_matrix_;
-    // getGlobalLinkTransform() returns a valid isometry by contract
-    Eigen::Isometry3d diff(tmp.transpose() * state.getGlobalLinkTransform(link_model_).linear());  // valid isometry
+    Eigen::Matrix3d tmp = frame_transform.linear() * desired_rotation_matrix_;
+    Eigen::Isometry3d diff(tmp.transpose() * link_transform.linear());  // valid isometry
     xyz = diff.linear().eulerAngles(0, 1, 2);
     // 0,1,2 corresponds to XYZ, the convention used in sampling constraints
   }
   else
   {
     // diff is valid isometry by construction
-    Eigen::Isometry3d diff(desired_rotation_matrix_inv_ * state.getGlobalLinkTransform(link_model_).linear());
+    Eigen::Isometry3d diff(desired_rotation_matrix_inv_ * link_transform.linear());
     xyz = diff.linear().eulerAngles(0, 1, 2);  // 0,1,2 corresponds to XYZ, the convention used in sampling constraints
   }
 
@@ -631,7 +659,7 @@ ConstraintEvaluationResult OrientationConstraint::decide(const moveit::core::Rob
 
   if (verbose)
   {
-    Eigen::Quaterniond q_act(state.getGlobalLinkTransform(link_model_).linear());
+    Eigen::Quaterniond q_act(link_transform.linear());
     Eigen::Quaterniond q_des(desired_rotation_matrix_);
     RCLCPP_INFO(LOGGER,
                 "Orientation constraint %s for link '%s'. Quaternion desired: %f %f %f %f, quaternion "
@@ -1082,6 +1110,7 @@ void KinematicConstraintSet::clear()
   position_constraints_.clear();
   orientation_constraints_.clear();
   visibility_constraints_.clear();
+  compile();
 }
 
 bool KinematicConstraintSet::add(const std::vector<moveit_msgs::msg::JointConstraint>& jc)
@@ -1096,6 +1125,7 @@ bool KinematicConstraintSet::add(const std::vector<moveit_msgs::msg::JointConstr
     joint_constraints_.push_back(joint_constraint);
     all_constraints_.joint_constraints.push_back(joint_constraint);
   }
+  compile();
   return result;
 }
 
@@ -1112,6 +1142,7 @@ bool KinematicConstraintSet::add(const std::vector<moveit_msgs::msg::PositionCon
     position_constraints_.push_back(position_constraint);
     all_constraints_.position_constraints.push_back(position_constraint);
   }
+  compile();
   return result;
 }
 
@@ -1128,6 +1159,7 @@ bool KinematicConstraintSet::add(const std::vector<moveit_msgs::msg::Orientation
     orientation_constraints_.push_back(orientation_constraint);
     all_constraints_.orientation_constraints.push_back(orientation_constraint);
   }
+  compile();
   return result;
 }
 
@@ -1144,6 +1176,7 @@ bool KinematicConstraintSet::add(const std::vector<moveit_msgs::msg::VisibilityC
     visibility_constraints_.push_back(visibility_constraint);
     all_constraints_.visibility_constraints.push_back(visibility_constraint);
   }
+  compile();
   return result;
 }
 
@@ -1185,6 +1218,317 @@ ConstraintEvaluationResult KinematicConstraintSet::decide(const moveit::core::Ro
   return result;
 }
 
+KinematicConstraintSet::CompiledFrame KinematicConstraintSet::compileFrame(bool mobile,
+                                                                          const std::string& frame_id) const
+{
+  CompiledFrame frame{ mobile, nullptr, std::string() };
+  if (!mobile)
+    return frame;
+  const std::string name = !frame_id.empty() && frame_id[0] == '/' ? frame_id.substr(1) : frame_id;
+  // the model frame is not looked up as a link by RobotState::getFrameTransform()
+  if (name != robot_model_->getModelFrame() && robot_model_->hasLinkModel(name))
+    frame.link_model = robot_model_->getLinkModel(name);
+  else
+    frame.frame_id = frame_id;
+  return frame;
+}
+
+void KinematicConstraintSet::compile()
+{
+  compiled_joint_indices_.clear();
+  compiled_joint_positions_.clear();
+  compiled_joint_lower_.clear();
+  compiled_joint_upper_.clear();
+  compiled_continuous_joints_.clear();
+  compiled_positions_.clear();
+  compiled_regions_.clear();
+  compiled_orientations_.clear();
+  uncompiled_constraints_.clear();
+
+  // the bounds include the margins used by the individual decide() functions, so the results are the same
+  for (const KinematicConstraintPtr& kinematic_constraint : kinematic_constraints_)
+  {
+    switch (kinematic_constraint->getType())
+    {
+      case JOINT_CONSTRAINT:
+      {
+        const JointConstraint& jc = static_cast<const JointConstraint&>(*kinematic_constraint);
+        if (!jc.enabled())
+          break;
+        const double lower = -jc.getJointToleranceBelow() - 2.0 * std::numeric_limits<double>::epsilon();
+        const double upper = jc.getJointToleranceAbove() + 2.0 * std::numeric_limits<double>::epsilon();
+        if (jc.isJointContinuous())
+          compiled_continuous_joints_.push_back(
+              { jc.getJointVariableIndex(), jc.getDesiredJointPosition(), lower, upper });
+        else
+        {
+          compiled_joint_indices_.push_back(jc.getJointVariableIndex());
+          compiled_joint_positions_.push_back(jc.getDesiredJointPosition());
+          compiled_joint_lower_.push_back(lower);
+          compiled_joint_upper_.push_back(upper);
+        }
+        break;
+      }
+      case POSITION_CONSTRAINT:
+      {
+        const PositionConstraint& pc = static_cast<const PositionConstraint&>(*kinematic_constraint);
+        if (!pc.enabled())
+          break;
+        const std::size_t regions_begin = compiled_regions_.size();
+        bool primitives = true;
+        for (const bodies::BodyPtr& body : pc.getConstraintRegions())
+        {
+          const std::vector<double> dimensions = body->getDimensions();
+          const double scale = body->getScale();
+          const double padding = body->getPadding();
+          CompiledRegion region;
+          region.type = body->getType();
+          region.inverse_pose = body->getPose().inverse();
+          if (region.type == shapes::BOX)
+            region.extents = Eigen::Vector3d(dimensions[0], dimensions[1], dimensions[2]) * (scale / 2.0) +
+                             Eigen::Vector3d::Constant(padding);
+          else if (region.type == shapes::SPHERE || region.type == shapes::CYLINDER)
+          {
+            const double radius = dimensions[0] * scale + padding;
+            region.extents = Eigen::Vector3d(radius * radius, 0.0,
+                                             region.type == shapes::CYLINDER ? dimensions[1] * scale / 2.0 + padding :
+                                                                               0.0);
+          }
+          else
+          {
+            primitives = false;
+            break;
+          }
+          compiled_regions_.push_back(region);
+        }
+        if (!primitives)
+        {
+          compiled_regions_.resize(regions_begin);
+          uncompiled_constraints_.push_back(kinematic_constraint.get());
+          break;
+        }
+        compiled_positions_.push_back({ pc.getLinkModel(), pc.getLinkOffset(),
+                                        compileFrame(pc.mobileReferenceFrame(), pc.getReferenceFrame()), regions_begin,
+                                        compiled_regions_.size() });
+        break;
+      }
+      case ORIENTATION_CONSTRAINT:
+      {
+        const OrientationConstraint& oc = static_cast<const OrientationConstraint&>(*kinematic_constraint);
+        if (!oc.enabled())
+          break;
+        const Eigen::Vector3d tolerance =
+            Eigen::Vector3d(oc.getXAxisTolerance(), oc.getYAxisTolerance(), oc.getZAxisTolerance()) +
+            Eigen::Vector3d::Constant(std::numeric_limits<double>::epsilon());
+        const Eigen::Matrix3d desired_rotation = oc.mobileReferenceFrame() ?
+                                                     oc.getDesiredRotationMatrix() :
+                                                     Eigen::Matrix3d(oc.getDesiredRotationMatrix().transpose());
+        compiled_orientations_.push_back({ oc.getLinkModel(), desired_rotation, tolerance,
+                                           compileFrame(oc.mobileReferenceFrame(), oc.getReferenceFrame()) });
+        break;
+      }
+      default:
+        uncompiled_constraints_.push_back(kinematic_constraint.get());
+    }
+  }
+}
+
+static inline const Eigen::Isometry3d& getCompiledFrameTransform(const moveit::core::RobotState& state,
+                                                                 const moveit::core::LinkModel* link_model,
+                                                                 const std::string& frame_id)
+{
+  return link_model ? state.getGlobalLinkTransform(link_model) : state.getFrameTransform(frame_id);
+}
+
+bool KinematicConstraintSet::isSatisfied(const moveit::core::RobotState& state) const
+{
+  // joint intervals are checked without branches so that the loop can be vectorized
+  const double* positions = state.getVariablePositions();
+  bool joints_satisfied = true;
+  for (std::size_t i = 0; i < compiled_joint_indices_.size(); ++i)
+  {
+    const double dif = positions[compiled_joint_indices_[i]] - compiled_joint_positions_[i];
+    joints_satisfied &= (dif <= compiled_joint_upper_[i]) & (dif >= compiled_joint_lower_[i]);
+  }
+  if (!joints_satisfied)
+    return false;
+
+  for (const CompiledContinuousJointConstraint& jc : compiled_continuous_joints_)
+  {
+    double dif = normalizeAngle(positions[jc.variable_index]) - jc.position;
+    if (dif > boost::math::constants::pi<double>())
+      dif = 2.0 * boost::math::constants::pi<double>() - dif;
+    else if (dif < -boost::math::constants::pi<double>())
+      dif += 2.0 * boost::math::constants::pi<double>();
+    if (dif > jc.upper || dif < jc.lower)
+      return false;
+  }
+
+  for (const CompiledPositionConstraint& pc : compiled_positions_)
+  {
+    Eigen::Vector3d pt = state.getGlobalLinkTransform(pc.link_model) * pc.offset;
+    if (pc.frame.mobile)
+      pt = getCompiledFrameTransform(state, pc.frame.link_model, pc.frame.frame_id).inverse() * pt;
+    bool contained = false;
+    for (std::size_t i = pc.regions_begin; !contained && i < pc.regions_end; ++i)
+    {
+      const CompiledRegion& region = compiled_regions_[i];
+      const Eigen::Vector3d local = region.inverse_pose * pt;
+      switch (region.type)
+      {
+        case shapes::BOX:
+          contained = (local.cwiseAbs().array() <= region.extents.array()).all();
+          break;
+        case shapes::SPHERE:
+          contained = local.squaredNorm() <= region.extents.x();
+          break;
+        default:  // shapes::CYLINDER
+        {
+          const double remaining = region.extents.x() - local.x() * local.x();
+          contained = std::fabs(local.z()) <= region.extents.z() && remaining >= 0.0 &&
+                      local.y() * local.y() < remaining;
+        }
+      }
+    }
+    if (!contained)
+      return false;
+  }
+
+  for (const CompiledOrientationConstraint& oc : compiled_orientations_)
+  {
+    const Eigen::Matrix3d link_rotation = state.getGlobalLinkTransform(oc.link_model).linear();
+    Eigen::Vector3d xyz;
+    if (oc.frame.mobile)
+    {
+      const Eigen::Matrix3d desired =
+          getCompiledFrameTransform(state, oc.frame.link_model, oc.frame.frame_id).linear() * oc.desired_rotation;
+      xyz = (desired.transpose() * link_rotation).eulerAngles(0, 1, 2);
+    }
+    else
+      xyz = (oc.desired_rotation * link_rotation).eulerAngles(0, 1, 2);
+    for (int i = 2; i >= 0; --i)
+      if (std::min(fabs(xyz(i)), boost::math::constants::pi<double>() - fabs(xyz(i))) >= oc.tolerance(i))
+        return false;
+  }
+
+  for (const KinematicConstraint* kinematic_constraint : uncompiled_constraints_)
+    if (!kinematic_constraint->decide(state).satisfied)
+      return false;
+  return true;
+}
+
+void KinematicConstraintSet::decideBatch(moveit::core::RobotState& state, const moveit::core::JointModelGroup* group,
+                                         const double* group_positions, std::size_t state_count,
+                                         std::vector<ConstraintEvaluationResult>& results) const
+{
+  results.assign(state_count, ConstraintEvaluationResult(true, 0.0));
+  if (state_count == 0 || kinematic_constraints_.empty())
+    return;
+
+  const std::vector<const moveit::core::LinkModel*>& links = group->getUpdatedLinkModels();
+  std::vector<double> link_transforms(12 * links.size() * state_count);
+  state.computeGroupLinkTransforms(group, group_positions, state_count, link_transforms.data());
+
+  // positions of the updated links and of the group variables in the batch, -1 for the ones taken from state
+  std::vector<int> link_batch_index(robot_model_->getLinkModelCount(), -1);
+  for (std::size_t k = 0; k < links.size(); ++k)
+    link_batch_index[links[k]->getLinkIndex()] = k;
+  const std::vector<int>& variable_index_list = group->getVariableIndexList();
+  std::vector<int> variable_batch_index(robot_model_->getVariableCount(), -1);
+  for (std::size_t i = 0; i < variable_index_list.size(); ++i)
+    variable_batch_index[variable_index_list[i]] = i;
+
+  auto variable_position = [&](int index, std::size_t s) {
+    const int i = variable_batch_index[index];
+    return i < 0 ? state.getVariablePosition(index) : group_positions[s * variable_index_list.size() + i];
+  };
+  auto link_transform = [&](const moveit::core::LinkModel* link, std::size_t s) -> Eigen::Isometry3d {
+    const int k = link_batch_index[link->getLinkIndex()];
+    if (k < 0)
+      return state.getGlobalLinkTransform(link);
+    Eigen::Isometry3d transform = Eigen::Isometry3d::Identity();
+    const double* in = &link_transforms[k * 12 * state_count + s];
+    for (int col = 0; col < 4; ++col)
+      for (int row = 0; row < 3; ++row, in += state_count)
+        transform.matrix()(row, col) = *in;
+    return transform;
+  };
+  auto frame_transform = [&](const CompiledFrame& frame, std::size_t s) -> Eigen::Isometry3d {
+    return frame.mobile ? link_transform(frame.link_model, s) : Eigen::Isometry3d::Identity();
+  };
+  auto add_result = [&](std::size_t s, const ConstraintEvaluationResult& r) {
+    results[s].satisfied = results[s].satisfied && r.satisfied;
+    results[s].distance += r.distance;
+  };
+
+  std::vector<const KinematicConstraint*> state_constraints;
+  for (const KinematicConstraintPtr& kinematic_constraint : kinematic_constraints_)
+  {
+    if (!kinematic_constraint->enabled())
+      continue;
+    switch (kinematic_constraint->getType())
+    {
+      case JOINT_CONSTRAINT:
+      {
+        // mimic joints of the group follow their source joint, as in RobotState::computeGroupLinkTransforms()
+        const JointConstraint& jc = static_cast<const JointConstraint&>(*kinematic_constraint);
+        const moveit::core::JointModel* joint = jc.getJointModel();
+        const int index = jc.getJointVariableIndex();
+        const bool mimic = joint->getMimic() && variable_batch_index[index] >= 0;
+        for (std::size_t s = 0; s < state_count; ++s)
+        {
+          double position = variable_position(index, s);
+          if (mimic)
+            position = joint->getMimicFactor() * variable_position(joint->getMimic()->getFirstVariableIndex(), s) +
+                       joint->getMimicOffset();
+          add_result(s, jc.decide(position));
+        }
+        break;
+      }
+      case POSITION_CONSTRAINT:
+      {
+        const PositionConstraint& pc = static_cast<const PositionConstraint&>(*kinematic_constraint);
+        const CompiledFrame frame = compileFrame(pc.mobileReferenceFrame(), pc.getReferenceFrame());
+        // frames that are not robot links, e.g. attached bodies, need the full state
+        if (frame.mobile && !frame.link_model)
+        {
+          state_constraints.push_back(kinematic_constraint.get());
+          break;
+        }
+        for (std::size_t s = 0; s < state_count; ++s)
+          add_result(s, pc.decide(link_transform(pc.getLinkModel(), s), frame_transform(frame, s)));
+        break;
+      }
+      case ORIENTATION_CONSTRAINT:
+      {
+        const OrientationConstraint& oc = static_cast<const OrientationConstraint&>(*kinematic_constraint);
+        const CompiledFrame frame = compileFrame(oc.mobileReferenceFrame(), oc.getReferenceFrame());
+        if (frame.mobile && !frame.link_model)
+        {
+          state_constraints.push_back(kinematic_constraint.get());
+          break;
+        }
+        for (std::size_t s = 0; s < state_count; ++s)
+          add_result(s, oc.decide(link_transform(oc.getLinkModel(), s), frame_transform(frame, s)));
+        break;
+      }
+      default:
+        state_constraints.push_back(kinematic_constraint.get());
+    }
+  }
+
+  if (state_constraints.empty())
+    return;
+  moveit::core::RobotState scratch(state);
+  for (std::size_t s = 0; s < state_count; ++s)
+  {
+    scratch.setJointGroupPositions(group, group_positions + s * variable_index_list.size());
+    scratch.update();
+    for (const KinematicConstraint* kinematic_constraint : state_constraints)
+      add_result(s, kinematic_constraint->decide(scratch));
+  }
+}
+
 void KinematicConstraintSet::print(std::ostream& out) const
 {
   out << kinematic_constraints_.size() << " kinematic constraints" << std::endl;
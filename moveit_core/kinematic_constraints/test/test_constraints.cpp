@@ -38,6 +38,7 @@
 #include <gtest/gtest.h>
 #include <urdf_parser/urdf_parser.h>
 #include <fstream>
+#include <random>
 #include <tf2_eigen/tf2_eigen.h>
 #include <moveit/utils/robot_model_test_utils.h>
 
@@ -927,6 +928,229 @@ TEST_F(LoadPlanningModelsPr2, TestKinematicConstraintSetEquality)
   EXPECT_TRUE(kcs2.equal(kcs, .1));
 }
 
+TEST_F(LoadPlanningModelsPr2, TestKinematicConstraintSetIsSatisfied)
+{
+  moveit::core::RobotState robot_state(robot_model_);
+  robot_state.setToDefaultValues();
+  robot_state.update();
+  moveit::core::Transforms tf(robot_model_->getModelFrame());
+
+  moveit_msgs::msg::Constraints constraints;
+
+  moveit_msgs::msg::JointConstraint jcm;
+  jcm.joint_name = "head_pan_joint";
+  jcm.position = 0.4;
+  jcm.tolerance_above = 1.0;
+  jcm.tolerance_below = 1.5;
+  jcm.weight = 1.0;
+  constraints.joint_constraints.push_back(jcm);
+
+  // continuous joint
+  jcm.joint_name = "r_wrist_roll_joint";
+  jcm.position = 3.0;
+  jcm.tolerance_above = 2.0;
+  jcm.tolerance_below = 1.0;
+  constraints.joint_constraints.push_back(jcm);
+
+  // box, sphere and cylinder regions around the default position of the wrist
+  const Eigen::Vector3d wrist = robot_state.getGlobalLinkTransform("r_wrist_roll_link").translation();
+  moveit_msgs::msg::PositionConstraint pcm;
+  pcm.link_name = "r_wrist_roll_link";
+  pcm.target_point_offset.x = 0.1;
+  pcm.header.frame_id = robot_model_->getModelFrame();
+  pcm.weight = 1.0;
+  pcm.constraint_region.primitives.resize(3);
+  pcm.constraint_region.primitives[0].type = shape_msgs::msg::SolidPrimitive::BOX;
+  pcm.constraint_region.primitives[0].dimensions.resize(3);
+  pcm.constraint_region.primitives[0].dimensions[shape_msgs::msg::SolidPrimitive::BOX_X] = 0.6;
+  pcm.constraint_region.primitives[0].dimensions[shape_msgs::msg::SolidPrimitive::BOX_Y] = 0.4;
+  pcm.constraint_region.primitives[0].dimensions[shape_msgs::msg::SolidPrimitive::BOX_Z] = 0.8;
+  pcm.constraint_region.primitives[1].type = shape_msgs::msg::SolidPrimitive::SPHERE;
+  pcm.constraint_region.primitives[1].dimensions.resize(1);
+  pcm.constraint_region.primitives[1].dimensions[shape_msgs::msg::SolidPrimitive::SPHERE_RADIUS] = 0.3;
+  pcm.constraint_region.primitives[2].type = shape_msgs::msg::SolidPrimitive::CYLINDER;
+  pcm.constraint_region.primitives[2].dimensions.resize(2);
+  pcm.constraint_region.primitives[2].dimensions[shape_msgs::msg::SolidPrimitive::CYLINDER_HEIGHT] = 0.5;
+  pcm.constraint_region.primitives[2].dimensions[shape_msgs::msg::SolidPrimitive::CYLINDER_RADIUS] = 0.3;
+  pcm.constraint_region.primitive_poses.resize(3);
+  for (std::size_t i = 0; i < 3; ++i)
+  {
+    Eigen::Isometry3d pose(Eigen::AngleAxisd(0.3 * i + 0.2, Eigen::Vector3d(1.0, 2.0, 0.5 * i).normalized()));
+    pose.translation() = wrist + Eigen::Vector3d(0.2 * i - 0.2, 0.1, -0.1 * i);
+    pcm.constraint_region.primitive_poses[i] = tf2::toMsg(pose);
+  }
+  constraints.position_constraints.push_back(pcm);
+
+  // a sphere moving with the other wrist
+  pcm.link_name = "l_wrist_roll_link";
+  pcm.header.frame_id = "r_wrist_roll_link";
+  pcm.constraint_region.primitives.resize(1);
+  pcm.constraint_region.primitives[0].type = shape_msgs::msg::SolidPrimitive::SPHERE;
+  pcm.constraint_region.primitives[0].dimensions.resize(1);
+  pcm.constraint_region.primitives[0].dimensions[shape_msgs::msg::SolidPrimitive::SPHERE_RADIUS] = 0.6;
+  pcm.constraint_region.primitive_poses.resize(1);
+  pcm.constraint_region.primitive_poses[0].position.y = 0.4;
+  pcm.constraint_region.primitive_poses[0].orientation.w = 1.0;
+  constraints.position_constraints.push_back(pcm);
+
+  moveit_msgs::msg::OrientationConstraint ocm;
+  ocm.link_name = "r_wrist_roll_link";
+  ocm.header.frame_id = robot_model_->getModelFrame();
+  ocm.orientation.w = 1.0;
+  ocm.absolute_x_axis_tolerance = 1.5;
+  ocm.absolute_y_axis_tolerance = 1.0;
+  ocm.absolute_z_axis_tolerance = 1.2;
+  ocm.weight = 1.0;
+  constraints.orientation_constraints.push_back(ocm);
+
+  // relative to a mobile frame
+  ocm.link_name = "l_wrist_roll_link";
+  ocm.header.frame_id = "r_wrist_roll_link";
+  constraints.orientation_constraints.push_back(ocm);
+
+  // each constraint on its own, and all of them
+  std::vector<std::unique_ptr<kinematic_constraints::KinematicConstraintSet>> sets;
+  for (std::size_t i = 0; i < constraints.joint_constraints.size(); ++i)
+  {
+    sets.emplace_back(new kinematic_constraints::KinematicConstraintSet(robot_model_));
+    EXPECT_TRUE(sets.back()->add(std::vector<moveit_msgs::msg::JointConstraint>{ constraints.joint_constraints[i] }));
+  }
+  for (std::size_t i = 0; i < constraints.position_constraints.size(); ++i)
+  {
+    sets.emplace_back(new kinematic_constraints::KinematicConstraintSet(robot_model_));
+    EXPECT_TRUE(sets.back()->add(
+        std::vector<moveit_msgs::msg::PositionConstraint>{ constraints.position_constraints[i] }, tf));
+  }
+  for (std::size_t i = 0; i < constraints.orientation_constraints.size(); ++i)
+  {
+    sets.emplace_back(new kinematic_constraints::KinematicConstraintSet(robot_model_));
+    EXPECT_TRUE(sets.back()->add(
+        std::vector<moveit_msgs::msg::OrientationConstraint>{ constraints.orientation_constraints[i] }, tf));
+  }
+  sets.emplace_back(new kinematic_constraints::KinematicConstraintSet(robot_model_));
+  EXPECT_TRUE(sets.back()->add(constraints, tf));
+
+  // only the arms and the head move, so that the regions fixed in the model frame are reachable
+  const moveit::core::JointModelGroup* arms = robot_model_->getJointModelGroup("arms");
+  std::mt19937 generator(0);
+  std::uniform_real_distribution<double> head_pan(-2.0, 2.0);
+  std::vector<std::size_t> satisfied(sets.size(), 0);
+  for (std::size_t n = 0; n < 1000; ++n)
+  {
+    robot_state.setToRandomPositions(arms);
+    robot_state.setVariablePosition("head_pan_joint", head_pan(generator));
+    robot_state.update();
+    for (std::size_t i = 0; i < sets.size(); ++i)
+    {
+      const bool decided = sets[i]->decide(robot_state).satisfied;
+      EXPECT_EQ(sets[i]->isSatisfied(robot_state), decided);
+      satisfied[i] += decided;
+    }
+  }
+
+  // the individual constraints are satisfied by some of the states only
+  for (std::size_t i = 0; i + 1 < sets.size(); ++i)
+  {
+    EXPECT_GT(satisfied[i], 0u) << "constraint " << i;
+    EXPECT_LT(satisfied[i], 1000u) << "constraint " << i;
+  }
+
+  // an empty set is always satisfied
+  sets.back()->clear();
+  EXPECT_TRUE(sets.back()->isSatisfied(robot_state));
+}
+
+TEST_F(LoadPlanningModelsPr2, TestKinematicConstraintSetDecideBatch)
+{
+  moveit::core::RobotState robot_state(robot_model_);
+  robot_state.setToDefaultValues();
+  robot_state.setVariablePosition("head_pan_joint", 0.3);
+  robot_state.update();
+  moveit::core::Transforms tf(robot_model_->getModelFrame());
+
+  moveit_msgs::msg::Constraints constraints;
+
+  // joints inside and outside of the group
+  moveit_msgs::msg::JointConstraint jcm;
+  jcm.joint_name = "r_shoulder_pan_joint";
+  jcm.position = -0.5;
+  jcm.tolerance_above = 0.5;
+  jcm.tolerance_below = 0.5;
+  jcm.weight = 1.0;
+  constraints.joint_constraints.push_back(jcm);
+  jcm.joint_name = "head_pan_joint";
+  jcm.position = 0.0;
+  constraints.joint_constraints.push_back(jcm);
+
+  // a link of the group in a fixed frame, and a link outside of the group in a frame of the group
+  moveit_msgs::msg::PositionConstraint pcm;
+  pcm.link_name = "r_wrist_roll_link";
+  pcm.header.frame_id = robot_model_->getModelFrame();
+  pcm.weight = 1.0;
+  pcm.constraint_region.primitives.resize(1);
+  pcm.constraint_region.primitives[0].type = shape_msgs::msg::SolidPrimitive::SPHERE;
+  pcm.constraint_region.primitives[0].dimensions.resize(1);
+  pcm.constraint_region.primitives[0].dimensions[shape_msgs::msg::SolidPrimitive::SPHERE_RADIUS] = 0.4;
+  pcm.constraint_region.primitive_poses.resize(1);
+  pcm.constraint_region.primitive_poses[0] =
+      tf2::toMsg(Eigen::Isometry3d(robot_state.getGlobalLinkTransform("r_wrist_roll_link")));
+  constraints.position_constraints.push_back(pcm);
+  pcm.link_name = "l_wrist_roll_link";
+  pcm.header.frame_id = "r_wrist_roll_link";
+  pcm.constraint_region.primitives[0].dimensions[shape_msgs::msg::SolidPrimitive::SPHERE_RADIUS] = 0.8;
+  pcm.constraint_region.primitive_poses[0] = geometry_msgs::msg::Pose();
+  constraints.position_constraints.push_back(pcm);
+
+  moveit_msgs::msg::OrientationConstraint ocm;
+  ocm.link_name = "r_wrist_roll_link";
+  ocm.header.frame_id = "torso_lift_link";
+  ocm.orientation.w = 1.0;
+  ocm.absolute_x_axis_tolerance = 1.0;
+  ocm.absolute_y_axis_tolerance = 1.0;
+  ocm.absolute_z_axis_tolerance = 1.0;
+  ocm.weight = 1.0;
+  constraints.orientation_constraints.push_back(ocm);
+
+  kinematic_constraints::KinematicConstraintSet kcs(robot_model_);
+  EXPECT_TRUE(kcs.add(constraints, tf));
+
+  const moveit::core::JointModelGroup* group = robot_model_->getJointModelGroup("right_arm");
+  ASSERT_TRUE(group);
+  const std::size_t state_count = 200;
+  moveit::core::RobotState sample_state(robot_state);
+  std::vector<double> group_positions;
+  for (std::size_t s = 0; s < state_count; ++s)
+  {
+    sample_state.setToRandomPositions(group);
+    std::vector<double> values;
+    sample_state.copyJointGroupPositions(group, values);
+    group_positions.insert(group_positions.end(), values.begin(), values.end());
+  }
+
+  std::vector<kinematic_constraints::ConstraintEvaluationResult> results;
+  kcs.decideBatch(robot_state, group, group_positions.data(), state_count, results);
+  ASSERT_EQ(results.size(), state_count);
+
+  std::size_t satisfied = 0;
+  for (std::size_t s = 0; s < state_count; ++s)
+  {
+    sample_state.setJointGroupPositions(group, &group_positions[s * group->getVariableCount()]);
+    sample_state.update();
+    const kinematic_constraints::ConstraintEvaluationResult result = kcs.decide(sample_state);
+    EXPECT_EQ(results[s].satisfied, result.satisfied);
+    EXPECT_NEAR(results[s].distance, result.distance, 1e-9);
+    satisfied += result.satisfied;
+  }
+  EXPECT_LT(satisfied, state_count);
+
+  // the state's own configuration is evaluated as by decide()
+  robot_state.copyJointGroupPositions(group, group_positions);
+  kcs.decideBatch(robot_state, group, group_positions.data(), 1, results);
+  ASSERT_EQ(results.size(), 1u);
+  EXPECT_EQ(results[0].satisfied, kcs.decide(robot_state).satisfied);
+  EXPECT_NEAR(results[0].distance, kcs.decide(robot_state).distance, 1e-9);
+}
+
 int main(int argc, char** argv)
 {
   testing::InitGoogleTest(&argc, argv);
@@ -41,7 +41,9 @@
 #include <moveit/macros/class_forward.h>
 #include "rclcpp/rclcpp.hpp"
 #include <boost/function.hpp>
+#include <functional>
 #include <string>
+#include <vector>
 
 namespace moveit
 {
@@ -193,6 +195,34 @@ public:
                              const std::vector<double>& ik_seed_state, std::vector<std::vector<double> >& solutions,
                              KinematicsResult& result, const kinematics::KinematicsQueryOptions& options) const;
 
+  /**
+   * @brief Given a desired pose of the end-effector, compute all joint solutions reaching it, sorted by their
+   * distance to the seed state, closest first.
+   *
+   * The default implementation returns the single solution of getPositionIK(). Analytic solvers computing all
+   * solutions at once (e.g. IKFast) return every one of them, so that callers can filter them (e.g. for collisions)
+   * without calling the solver again.
+   * @param ik_pose the desired pose of the link
+   * @param ik_seed_state an initial guess solution for the inverse kinematics
+   * @param solutions the solution vectors, sorted by distance to the seed
+   * @param error_code an error code that encodes the reason for failure or success
+   * @param options container for other IK options. See definition of KinematicsQueryOptions for details.
+   * @return True if at least one solution was found, false otherwise
+   */
+  virtual bool
+  getAllPositionIK(const geometry_msgs::msg::Pose& ik_pose, const std::vector<double>& ik_seed_state,
+                   std::vector<std::vector<double> >& solutions, moveit_msgs::msg::MoveItErrorCodes& error_code,
+                   const kinematics::KinematicsQueryOptions& options = kinematics::KinematicsQueryOptions()) const;
+
+  /**
+   * @brief Check whether getAllPositionIK() returns every solution of a pose, so that searchPositionIK() cannot find
+   * any other. RobotState::setFromIK() then checks these solutions instead of searching.
+   */
+  virtual bool providesAllPositionIK() const
+  {
+    return false;
+  }
+
   /**
    * @brief Given a desired pose of the end-effector, search for the joint angles required to reach it.
    * This particular method is intended for "searching" for a solution by stepping through the redundancy
@@ -319,6 +349,38 @@ public:
     return false;
   }
 
+  /**
+   * @brief Solve inverse kinematics for a batch of independent target poses.
+   *
+   * Each pose is solved as by searchPositionIK() without consistency limits. The default implementation distributes
+   * the poses over worker threads if supportsConcurrentQueries() returns true and solves them one after the other
+   * otherwise. Solvers can override this to reuse their internal workspaces across the whole batch.
+   * @param ik_poses The desired poses of the tip link (in the frame returned by getBaseFrame()), one per query
+   * @param ik_seed_states Either one seed state per pose or a single seed state used for all poses
+   * @param timeout The amount of time (in seconds) available to the solver for each pose
+   * @param solutions The solution vectors, resized to the number of poses
+   * @param error_codes The error codes encoding the reason for failure or success of each pose
+   * @param options container for other IK options. See definition of KinematicsQueryOptions for details.
+   * @param thread_count The maximal number of threads to use. If 0, the number of hardware threads is used.
+   * @return True if a solution was found for every pose, false otherwise
+   */
+  virtual bool
+  searchPositionIKBatch(const std::vector<geometry_msgs::msg::Pose>& ik_poses,
+                        const std::vector<std::vector<double> >& ik_seed_states, double timeout,
+                        std::vector<std::vector<double> >& solutions,
+                        std::vector<moveit_msgs::msg::MoveItErrorCodes>& error_codes,
+                        const kinematics::KinematicsQueryOptions& options = kinematics::KinematicsQueryOptions(),
+                        unsigned int thread_count = 0) const;
+
+  /**
+   * @brief Check whether searchPositionIK() can safely be called from several threads at once on this instance.
+   * The default implementation of searchPositionIKBatch() only runs queries in parallel if this returns true.
+   */
+  virtual bool supportsConcurrentQueries() const
+  {
+    return false;
+  }
+
   /**
    * @brief Given a set of joint angles and a set of links, compute their pose
    * @param link_names A set of links for which FK needs to be computed
@@ -600,6 +662,26 @@ protected:
                    const std::string& base_frame, const std::vector<std::string>& tip_frames,
                    double search_discretization);
 
+  /** @brief Solves the batch query with the given index */
+  typedef std::function<void(std::size_t index)> BatchQueryFn;
+
+  /** Validate the seed states of a batch query and size the output vectors accordingly.
+   *
+   * @return False (and all error codes set to NO_IK_SOLUTION) if neither one seed per pose nor a single seed is given
+   */
+  bool prepareBatchQuery(const std::vector<geometry_msgs::msg::Pose>& ik_poses,
+                         const std::vector<std::vector<double> >& ik_seed_states,
+                         std::vector<std::vector<double> >& solutions,
+                         std::vector<moveit_msgs::msg::MoveItErrorCodes>& error_codes) const;
+
+  /** Run the queries 0..count-1 of a batch on up to thread_count threads (0 selects the number of hardware threads).
+   *
+   * Every worker thread first calls make_query() once and then uses the returned function for all the queries it
+   * claims, so per-thread solver workspaces can be captured in it. make_query() may be called concurrently.
+   */
+  static void forEachBatchQuery(std::size_t count, unsigned int thread_count,
+                                const std::function<BatchQueryFn()>& make_query);
+
 private:
   std::string removeSlash(const std::string& str) const;
 };
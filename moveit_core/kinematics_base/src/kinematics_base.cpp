@@ -36,6 +36,9 @@
 
 #include <moveit/kinematics_base/kinematics_base.h>
 #include <moveit/robot_model/joint_model_group.h>
+#include <algorithm>
+#include <atomic>
+#include <thread>
 
 namespace kinematics
 {
@@ -193,4 +196,88 @@ bool KinematicsBase::getPositionIK(const std::vector<geometry_msgs::msg::Pose>&
 
   return true;
 }
+
+bool KinematicsBase::getAllPositionIK(const geometry_msgs::msg::Pose& ik_pose,
+                                      const std::vector<double>& ik_seed_state,
+                                      std::vector<std::vector<double> >& solutions,
+                                      moveit_msgs::msg::MoveItErrorCodes& error_code,
+                                      const kinematics::KinematicsQueryOptions& options) const
+{
+  solutions.resize(1);
+  if (getPositionIK(ik_pose, ik_seed_state, solutions[0], error_code, options))
+    return true;
+  solutions.clear();
+  return false;
+}
+
+bool KinematicsBase::searchPositionIKBatch(const std::vector<geometry_msgs::msg::Pose>& ik_poses,
+                                           const std::vector<std::vector<double> >& ik_seed_states, double timeout,
+                                           std::vector<std::vector<double> >& solutions,
+                                           std::vector<moveit_msgs::msg::MoveItErrorCodes>& error_codes,
+                                           const kinematics::KinematicsQueryOptions& options,
+                                           unsigned int thread_count) const
+{
+  if (!prepareBatchQuery(ik_poses, ik_seed_states, solutions, error_codes))
+    return false;
+
+  // without the solver's guarantee that queries do not share state, fall back to solving one pose at a time
+  if (!supportsConcurrentQueries())
+    thread_count = 1;
+
+  forEachBatchQuery(ik_poses.size(), thread_count, [&]() -> BatchQueryFn {
+    return [&](std::size_t i) {
+      const std::vector<double>& seed = ik_seed_states.size() == 1 ? ik_seed_states[0] : ik_seed_states[i];
+      searchPositionIK(ik_poses[i], seed, timeout, solutions[i], error_codes[i], options);
+    };
+  });
+
+  return std::all_of(error_codes.begin(), error_codes.end(),
+                     [](const moveit_msgs::msg::MoveItErrorCodes& error_code) {
+                       return error_code.val == moveit_msgs::msg::MoveItErrorCodes::SUCCESS;
+                     });
+}
+
+bool KinematicsBase::prepareBatchQuery(const std::vector<geometry_msgs::msg::Pose>& ik_poses,
+                                       const std::vector<std::vector<double> >& ik_seed_states,
+                                       std::vector<std::vector<double> >& solutions,
+                                       std::vector<moveit_msgs::msg::MoveItErrorCodes>& error_codes) const
+{
+  solutions.resize(ik_poses.size());
+  error_codes.resize(ik_poses.size());
+  if (ik_seed_states.size() == 1 || ik_seed_states.size() == ik_poses.size())
+    return true;
+
+  RCLCPP_ERROR(LOGGER, "Expected either a single seed state or one per pose (%zu), but got %zu", ik_poses.size(),
+               ik_seed_states.size());
+  for (moveit_msgs::msg::MoveItErrorCodes& error_code : error_codes)
+    error_code.val = moveit_msgs::msg::MoveItErrorCodes::NO_IK_SOLUTION;
+  return false;
+}
+
+void KinematicsBase::forEachBatchQuery(std::size_t count, unsigned int thread_count,
+                                       const std::function<BatchQueryFn()>& make_query)
+{
+  if (count == 0)
+    return;
+  if (thread_count == 0)
+    thread_count = std::max(1u, std::thread::hardware_concurrency());
+  if (thread_count > count)
+    thread_count = count;
+
+  // queries are claimed one at a time, as their cost varies widely between reachable and unreachable poses
+  std::atomic<std::size_t> next_index(0);
+  auto worker = [&]() {
+    BatchQueryFn query = make_query();
+    for (std::size_t i = next_index++; i < count; i = next_index++)
+      query(i);
+  };
+
+  std::vector<std::thread> threads;
+  threads.reserve(thread_count - 1);
+  for (unsigned int t = 1; t < thread_count; ++t)
+    threads.emplace_back(worker);
+  worker();
+  for (std::thread& thread : threads)
+    thread.join();
+}
 }  // end of namespace kinematics
@@ -36,7 +36,9 @@
 
 #pragma once
 
+#include <moveit/kinematics_metrics/reachability_map.h>
 #include <moveit/robot_state/robot_state.h>
+#include <map>
 
 /** @brief Namespace for kinematics metrics */
 namespace kinematics_metrics
@@ -77,6 +79,35 @@ public:
                               const moveit::core::JointModelGroup* joint_model_group, double& manipulability_index,
                               bool translation = false) const;
 
+  /**
+   * @brief Get the manipulability for a given group at many joint configurations. A single
+   * copy of the state and Jacobian is reused for all configurations
+   * @param state Complete kinematic state for the robot, providing the values of the other variables
+   * @param joint_model_group A pointer to the desired joint model group
+   * @param joint_positions The group positions, one column per configuration
+   * @param manipulability_indices The computed manipulability = sqrt(det(JJ^T)) of each configuration
+   * @return False if the group is not a chain or the positions are of the wrong size
+   */
+  bool getManipulabilityIndices(const moveit::core::RobotState& state,
+                                const moveit::core::JointModelGroup* joint_model_group,
+                                const Eigen::MatrixXd& joint_positions, Eigen::VectorXd& manipulability_indices,
+                                bool translation = false) const;
+
+  /**
+   * @brief Get the manipulability and its analytic gradient with respect to the group variables,
+   * e.g. for use as an optimization cost. The joint limits penalty is not applied.
+   * @param state Complete kinematic state for the robot
+   * @param joint_model_group A pointer to the desired joint model group, a chain of revolute and prismatic joints
+   * @param manipulability_index The computed manipulability = sqrt(det(JJ^T))
+   * @param gradient The derivative of the manipulability with respect to each variable of the group,
+   * zero at singular configurations
+   * @return False if the group is not a chain of revolute and prismatic joints
+   */
+  bool getManipulabilityIndexGradient(const moveit::core::RobotState& state,
+                                      const moveit::core::JointModelGroup* joint_model_group,
+                                      double& manipulability_index, Eigen::VectorXd& gradient,
+                                      bool translation = false) const;
+
   /**
    * @brief Get the (translation) manipulability ellipsoid for a given group at a given joint configuration
    * @param state Complete kinematic state for the robot
@@ -124,6 +155,26 @@ public:
   bool getManipulability(const moveit::core::RobotState& state, const moveit::core::JointModelGroup* joint_model_group,
                          double& condition_number, bool translation = false) const;
 
+  /**
+   * @brief Set the reachability map used by \ref getReachabilityIndex() for the group of the map
+   * @param reachability_map The map, replacing a previous map of the same group
+   */
+  void setReachabilityMap(const ReachabilityMapConstPtr& reachability_map);
+
+  /** @brief Get the reachability map of a group, or nullptr if none was set */
+  ReachabilityMapConstPtr getReachabilityMap(const std::string& group_name) const;
+
+  /**
+   * @brief Get the fraction of approach directions of the tip link of the reachability map that
+   * the group reaches at the current position of the tip link
+   * @param state Complete kinematic state for the robot, with up to date link transforms
+   * @param group_name The group name (e.g. "arm")
+   * @param reachability_index The reachability index, from 0 (unreachable) to 1
+   * @return False if no reachability map was set for the group
+   */
+  bool getReachabilityIndex(const moveit::core::RobotState& state, const std::string& group_name,
+                            double& reachability_index) const;
+
   void setPenaltyMultiplier(double multiplier)
   {
     penalty_multiplier_ = fabs(multiplier);
@@ -154,5 +205,8 @@ private:
                                const moveit::core::JointModelGroup* joint_model_group) const;
 
   double penalty_multiplier_;
+
+  /** @brief The reachability maps, by group name */
+  std::map<std::string, ReachabilityMapConstPtr> reachability_maps_;
 };
 }  // namespace kinematics_metrics
@@ -0,0 +1,164 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, PickNik LLC
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik LLC nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#pragma once
+
+#include <moveit/robot_state/robot_state.h>
+#include <eigen_stl_containers/eigen_stl_vector_container.h>
+#include <random_numbers/random_numbers.h>
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+namespace kinematics_metrics
+{
+MOVEIT_CLASS_FORWARD(ReachabilityMap)  // Defines ReachabilityMapPtr, ConstPtr, WeakPtr... etc
+
+/**
+ * \brief A precomputed map of the poses of a link that a group can reach.
+ *
+ * The workspace around a base link of the robot is divided into cubic
+ * voxels.  For each voxel, the map stores which approach directions
+ * (the z axis of the tip link) were reached, discretized into \ref
+ * ORIENTATION_COUNT directions evenly distributed on the unit sphere.
+ * The map is computed offline by sampling random joint positions of
+ * the group, and stored in a compact binary file.  All positions and
+ * poses passed to the queries are relative to the base link.
+ */
+class ReachabilityMap
+{
+public:
+  /** \brief The number of discretized approach directions per voxel */
+  static const std::size_t ORIENTATION_COUNT = 64;
+
+  /** \brief Constructs an empty map, in which nothing is reachable */
+  ReachabilityMap();
+
+  /**
+   * @brief Compute the map from random joint positions of a group
+   * @param state The state used for forward kinematics, the positions of joints not in the group are kept
+   * @param joint_model_group The group to sample
+   * @param base_link The link the map is relative to, it must not be moved by the group
+   * @param tip_link The link whose poses are recorded
+   * @param resolution The edge length of the voxels in meters
+   * @param sample_count The number of random joint positions
+   * @param rng The random number generator for the joint positions
+   * @return False if the links were not found or the parameters are invalid
+   */
+  bool compute(moveit::core::RobotState& state, const moveit::core::JointModelGroup* joint_model_group,
+               const std::string& base_link, const std::string& tip_link, double resolution,
+               std::size_t sample_count, random_numbers::RandomNumberGenerator& rng);
+
+  /** \brief Writes the map to a binary stream */
+  bool writeToStream(std::ostream& stream) const;
+
+  /** \brief Reads a map written by \ref writeToStream, the map is left empty on failure */
+  bool readFromStream(std::istream& stream);
+
+  /** \brief Writes the map to a binary file */
+  bool saveToFile(const std::string& filename) const;
+
+  /** \brief Reads a map from a file written by \ref saveToFile */
+  bool loadFromFile(const std::string& filename);
+
+  /** \brief Whether the map has no reachable voxel */
+  bool empty() const
+  {
+    return reachable_voxel_count_ == 0;
+  }
+
+  const std::string& getGroupName() const
+  {
+    return group_name_;
+  }
+
+  const std::string& getBaseLink() const
+  {
+    return base_link_;
+  }
+
+  const std::string& getTipLink() const
+  {
+    return tip_link_;
+  }
+
+  double getResolution() const
+  {
+    return resolution_;
+  }
+
+  /** \brief Gets the number of reachable approach directions at a position, zero outside the map */
+  std::size_t getOrientationCount(const Eigen::Vector3d& position) const;
+
+  /**
+   * \brief Gets the fraction of the approach directions that are
+   * reachable at a position, from 0 (unreachable) to 1
+   */
+  double getReachabilityIndex(const Eigen::Vector3d& position) const
+  {
+    return static_cast<double>(getOrientationCount(position)) / ORIENTATION_COUNT;
+  }
+
+  /** \brief Whether the tip link reaches a position with any orientation */
+  bool isReachable(const Eigen::Vector3d& position) const;
+
+  /** \brief Whether the tip link reaches the position of a pose with its approach direction */
+  bool isReachable(const Eigen::Isometry3d& pose) const;
+
+private:
+  /** \brief Gets the index of the voxel containing a position, or -1 if it is outside the map */
+  long getVoxelIndex(const Eigen::Vector3d& position) const;
+
+  /** \brief Gets the index of the discretized direction closest to a unit vector */
+  std::size_t getOrientationIndex(const Eigen::Vector3d& direction) const;
+
+  /** \brief Resets the map to the given bounds, with no reachable voxel */
+  void resize(const Eigen::Vector3d& origin, const int num_voxels[3]);
+
+  std::string group_name_;
+  std::string base_link_;
+  std::string tip_link_;
+  double resolution_;                 /**< \brief Edge length of the voxels in meters */
+  Eigen::Vector3d origin_;            /**< \brief The minimum corner of the map */
+  int num_voxels_[3];                 /**< \brief The number of voxels in each dimension */
+  std::size_t reachable_voxel_count_; /**< \brief The number of voxels with a reachable direction */
+
+  /** \brief Bit masks of the reachable directions, one per voxel with z changing fastest */
+  std::vector<std::uint64_t> voxels_;
+
+  /** \brief The discretized approach directions */
+  EigenSTL::vector_Vector3d directions_;
+};
+}  // namespace kinematics_metrics
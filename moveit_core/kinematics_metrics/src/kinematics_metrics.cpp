@@ -44,6 +44,61 @@ namespace kinematics_metrics
 {
 static const rclcpp::Logger LOGGER = rclcpp::get_logger("moveit_kinematics_metrics.kinematics_metrics");
 
+namespace
+{
+// Gram matrices have at most 6 rows and columns and are never allocated on the heap
+typedef Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, 0, 6, 6> GramMatrix;
+
+// The manipulability index sqrt(det(J J^T)), or sqrt(det(J^T J)) for a Jacobian with less columns than rows,
+// which are both the product of the singular values of J. If weights is not null it is set to the matrix W
+// of the same size as J with d(index) = index * sum(W .* dJ) for a change dJ of the Jacobian.
+template <typename Derived>
+double computeManipulabilityIndex(const Eigen::MatrixBase<Derived>& jacobian, Eigen::MatrixXd* weights = nullptr)
+{
+  const bool wide = jacobian.cols() >= jacobian.rows();
+  GramMatrix gram;
+  if (wide)
+    gram.noalias() = jacobian * jacobian.transpose();
+  else
+    gram.noalias() = jacobian.transpose() * jacobian;
+  Eigen::LDLT<GramMatrix> ldlt(gram);
+  const double determinant = ldlt.vectorD().prod();
+  if (determinant <= 0.0)
+  {
+    if (weights)
+      weights->setZero(jacobian.rows(), jacobian.cols());
+    return 0.0;
+  }
+  if (weights)
+  {
+    // d(det(G)) / det(G) = trace(G^-1 dG) and the index is the square root of det(G)
+    if (wide)
+      *weights = ldlt.solve(jacobian.derived()).eval();
+    else
+      *weights = ldlt.solve(jacobian.transpose()).transpose();
+  }
+  return std::sqrt(determinant);
+}
+
+// The change of a Jacobian column with respect to a joint (H_ij = dJ_i / dq_j), for a chain of revolute and
+// prismatic joints where joint j comes before joint i towards the tip if before is true. Rows 0-2 are
+// linear, rows 3-5 angular, as computed by RobotState::getJacobian().
+inline Eigen::Matrix<double, 6, 1> jacobianColumnDerivative(const Eigen::Matrix<double, 6, Eigen::Dynamic>& jacobian,
+                                                            int i, int j, bool before)
+{
+  Eigen::Matrix<double, 6, 1> derivative;
+  if (before || i == j)
+    derivative.head<3>() = jacobian.block<3, 1>(3, j).cross(jacobian.block<3, 1>(0, i));
+  else
+    derivative.head<3>() = jacobian.block<3, 1>(3, i).cross(jacobian.block<3, 1>(0, j));
+  if (before)
+    derivative.tail<3>() = jacobian.block<3, 1>(3, j).cross(jacobian.block<3, 1>(3, i));
+  else
+    derivative.tail<3>().setZero();
+  return derivative;
+}
+}  // namespace
+
 double KinematicsMetrics::getJointLimitsPenalty(const moveit::core::RobotState& state,
                                                 const moveit::core::JointModelGroup* joint_model_group) const
 {
@@ -114,54 +169,112 @@ bool KinematicsMetrics::getManipulabilityIndex(const moveit::core::RobotState& s
     return false;
   }
 
-  Eigen::MatrixXd jacobian = state.getJacobian(joint_model_group);
+  const moveit::core::LinkModel* tip_link = joint_model_group->getLinkModels().back();
+  Eigen::Matrix<double, 6, Eigen::Dynamic> jacobian;
+  if (!state.getJacobian(joint_model_group, tip_link, Eigen::Vector3d::Zero(), jacobian))
+    return false;
   // Get joint limits penalty
   double penalty = getJointLimitsPenalty(state, joint_model_group);
+  // Get manipulability index
   if (translation)
+    manipulability_index = penalty * computeManipulabilityIndex(jacobian.topRows<3>());
+  else
+    manipulability_index = penalty * computeManipulabilityIndex(jacobian);
+  return true;
+}
+
+bool KinematicsMetrics::getManipulabilityIndices(const moveit::core::RobotState& state,
+                                                 const moveit::core::JointModelGroup* joint_model_group,
+                                                 const Eigen::MatrixXd& joint_positions,
+                                                 Eigen::VectorXd& manipulability_indices, bool translation) const
+{
+  // state.getJacobian() only works for chain groups.
+  if (!joint_model_group->isChain())
   {
-    if (jacobian.cols() < 6)
-    {
-      Eigen::JacobiSVD<Eigen::MatrixXd> svdsolver(jacobian.topLeftCorner(3, jacobian.cols()));
-      Eigen::MatrixXd singular_values = svdsolver.singularValues();
-      manipulability_index = 1.0;
-      for (unsigned int i = 0; i < singular_values.rows(); ++i)
-      {
-        RCLCPP_DEBUG(LOGGER, "Singular value: %d %f", i, singular_values(i, 0));
-        manipulability_index *= singular_values(i, 0);
-      }
-      // Get manipulability index
-      manipulability_index = penalty * manipulability_index;
-    }
+    return false;
+  }
+  if (joint_positions.rows() != static_cast<Eigen::Index>(joint_model_group->getVariableCount()))
+  {
+    RCLCPP_ERROR(LOGGER, "Joint positions of group '%s' should have %u rows", joint_model_group->getName().c_str(),
+                 joint_model_group->getVariableCount());
+    return false;
+  }
+
+  moveit::core::RobotState work_state(state);
+  const moveit::core::LinkModel* tip_link = joint_model_group->getLinkModels().back();
+  Eigen::Matrix<double, 6, Eigen::Dynamic> jacobian(6, joint_model_group->getVariableCount());
+  manipulability_indices.resize(joint_positions.cols());
+  for (Eigen::Index i = 0; i < joint_positions.cols(); ++i)
+  {
+    work_state.setJointGroupPositions(joint_model_group, joint_positions.col(i).data());
+    work_state.updateLinkTransforms();
+    if (!work_state.getJacobian(joint_model_group, tip_link, Eigen::Vector3d::Zero(), jacobian))
+      return false;
+    const double penalty = getJointLimitsPenalty(work_state, joint_model_group);
+    if (translation)
+      manipulability_indices(i) = penalty * computeManipulabilityIndex(jacobian.topRows<3>());
     else
+      manipulability_indices(i) = penalty * computeManipulabilityIndex(jacobian);
+  }
+  return true;
+}
+
+bool KinematicsMetrics::getManipulabilityIndexGradient(const moveit::core::RobotState& state,
+                                                       const moveit::core::JointModelGroup* joint_model_group,
+                                                       double& manipulability_index, Eigen::VectorXd& gradient,
+                                                       bool translation) const
+{
+  // state.getJacobian() only works for chain groups.
+  if (!joint_model_group->isChain())
+  {
+    return false;
+  }
+
+  // position of each variable along the chain, from the base to the tip
+  const std::vector<const moveit::core::JointModel*>& joint_models = joint_model_group->getActiveJointModels();
+  std::vector<int> chain_order(joint_model_group->getVariableCount(), 0);
+  if (joint_models.size() != chain_order.size())
+  {
+    RCLCPP_ERROR(LOGGER, "The gradient of the manipulability of group '%s' requires single variable joints",
+                 joint_model_group->getName().c_str());
+    return false;
+  }
+  for (std::size_t k = 0; k < joint_models.size(); ++k)
+  {
+    if (joint_models[k]->getType() != moveit::core::JointModel::REVOLUTE &&
+        joint_models[k]->getType() != moveit::core::JointModel::PRISMATIC)
     {
-      Eigen::MatrixXd jacobian_2 = jacobian.topLeftCorner(3, jacobian.cols());
-      Eigen::MatrixXd matrix = jacobian_2 * jacobian_2.transpose();
-      // Get manipulability index
-      manipulability_index = penalty * sqrt(matrix.determinant());
+      RCLCPP_ERROR(LOGGER, "The gradient of the manipulability of group '%s' requires revolute or prismatic joints",
+                   joint_model_group->getName().c_str());
+      return false;
     }
+    chain_order[joint_model_group->getJointVariableGroupIndex(joint_models[k])] = k;
   }
+
+  const moveit::core::LinkModel* tip_link = joint_model_group->getLinkModels().back();
+  Eigen::Matrix<double, 6, Eigen::Dynamic> jacobian;
+  if (!state.getJacobian(joint_model_group, tip_link, Eigen::Vector3d::Zero(), jacobian))
+    return false;
+  Eigen::MatrixXd weights;
+  if (translation)
+    manipulability_index = computeManipulabilityIndex(jacobian.topRows<3>(), &weights);
   else
+    manipulability_index = computeManipulabilityIndex(jacobian, &weights);
+
+  const int num_variables = jacobian.cols();
+  gradient.setZero(num_variables);
+  if (manipulability_index <= 0.0)
+    return true;
+  for (int j = 0; j < num_variables; ++j)
   {
-    if (jacobian.cols() < 6)
+    for (int i = 0; i < num_variables; ++i)
     {
-      Eigen::JacobiSVD<Eigen::MatrixXd> svdsolver(jacobian);
-      Eigen::MatrixXd singular_values = svdsolver.singularValues();
-      manipulability_index = 1.0;
-      for (unsigned int i = 0; i < singular_values.rows(); ++i)
-      {
-        RCLCPP_DEBUG(LOGGER, "Singular value: %d %f", i, singular_values(i, 0));
-        manipulability_index *= singular_values(i, 0);
-      }
-      // Get manipulability index
-      manipulability_index = penalty * manipulability_index;
-    }
-    else
-    {
-      Eigen::MatrixXd matrix = jacobian * jacobian.transpose();
-      // Get manipulability index
-      manipulability_index = penalty * sqrt(matrix.determinant());
+      const Eigen::Matrix<double, 6, 1> derivative =
+          jacobianColumnDerivative(jacobian, i, j, chain_order[j] < chain_order[i]);
+      gradient(j) += translation ? weights.col(i).dot(derivative.head<3>()) : weights.col(i).dot(derivative);
     }
   }
+  gradient *= manipulability_index;
   return true;
 }
 
@@ -242,4 +355,35 @@ bool KinematicsMetrics::getManipulability(const moveit::core::RobotState& state,
   return true;
 }
 
+void KinematicsMetrics::setReachabilityMap(const ReachabilityMapConstPtr& reachability_map)
+{
+  if (reachability_map)
+    reachability_maps_[reachability_map->getGroupName()] = reachability_map;
+}
+
+ReachabilityMapConstPtr KinematicsMetrics::getReachabilityMap(const std::string& group_name) const
+{
+  std::map<std::string, ReachabilityMapConstPtr>::const_iterator it = reachability_maps_.find(group_name);
+  return it == reachability_maps_.end() ? ReachabilityMapConstPtr() : it->second;
+}
+
+bool KinematicsMetrics::getReachabilityIndex(const moveit::core::RobotState& state, const std::string& group_name,
+                                             double& reachability_index) const
+{
+  ReachabilityMapConstPtr reachability_map = getReachabilityMap(group_name);
+  if (!reachability_map)
+    return false;
+  const moveit::core::LinkModel* base_link = robot_model_->getLinkModel(reachability_map->getBaseLink());
+  const moveit::core::LinkModel* tip_link = robot_model_->getLinkModel(reachability_map->getTipLink());
+  if (!base_link || !tip_link)
+  {
+    RCLCPP_ERROR(LOGGER, "Reachability map of group '%s' refers to links not in the robot model", group_name.c_str());
+    return false;
+  }
+  const Eigen::Vector3d position =
+      state.getGlobalLinkTransform(base_link).inverse() * state.getGlobalLinkTransform(tip_link).translation();
+  reachability_index = reachability_map->getReachabilityIndex(position);
+  return true;
+}
+
 }  // end of namespace kinematics_metrics
@@ -0,0 +1,320 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, PickNik LLC
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik LLC nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include <moveit/kinematics_metrics/reachability_map.h>
+#include <boost/math/constants/constants.hpp>
+#include "rclcpp/rclcpp.hpp"
+#include <algorithm>
+#include <bitset>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <limits>
+
+namespace kinematics_metrics
+{
+static const rclcpp::Logger LOGGER = rclcpp::get_logger("moveit_kinematics_metrics.reachability_map");
+
+namespace
+{
+const char FILE_MAGIC[4] = { 'M', 'R', 'M', 'P' };
+const std::uint32_t FILE_VERSION = 1;
+
+template <typename T>
+void writeValue(std::ostream& stream, const T& value)
+{
+  stream.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template <typename T>
+bool readValue(std::istream& stream, T& value)
+{
+  return static_cast<bool>(stream.read(reinterpret_cast<char*>(&value), sizeof(T)));
+}
+
+void writeString(std::ostream& stream, const std::string& value)
+{
+  writeValue(stream, static_cast<std::uint32_t>(value.size()));
+  stream.write(value.data(), value.size());
+}
+
+bool readString(std::istream& stream, std::string& value)
+{
+  std::uint32_t size;
+  if (!readValue(stream, size) || size > 4096)
+    return false;
+  value.resize(size);
+  return size == 0 || static_cast<bool>(stream.read(&value[0], size));
+}
+}  // namespace
+
+ReachabilityMap::ReachabilityMap()
+  : resolution_(0.0), origin_(Eigen::Vector3d::Zero()), num_voxels_{ 0, 0, 0 }, reachable_voxel_count_(0)
+{
+  // spherical Fibonacci lattice, the directions cover the sphere almost uniformly
+  const double golden_angle = boost::math::constants::pi<double>() * (3.0 - std::sqrt(5.0));
+  directions_.reserve(ORIENTATION_COUNT);
+  for (std::size_t i = 0; i < ORIENTATION_COUNT; ++i)
+  {
+    const double z = 1.0 - (2.0 * i + 1.0) / ORIENTATION_COUNT;
+    const double r = std::sqrt(1.0 - z * z);
+    directions_.push_back(Eigen::Vector3d(r * std::cos(golden_angle * i), r * std::sin(golden_angle * i), z));
+  }
+}
+
+void ReachabilityMap::resize(const Eigen::Vector3d& origin, const int num_voxels[3])
+{
+  origin_ = origin;
+  std::copy(num_voxels, num_voxels + 3, num_voxels_);
+  voxels_.assign(static_cast<std::size_t>(num_voxels_[0]) * num_voxels_[1] * num_voxels_[2], 0);
+  reachable_voxel_count_ = 0;
+}
+
+bool ReachabilityMap::compute(moveit::core::RobotState& state, const moveit::core::JointModelGroup* joint_model_group,
+                              const std::string& base_link, const std::string& tip_link, double resolution,
+                              std::size_t sample_count, random_numbers::RandomNumberGenerator& rng)
+{
+  const int no_voxels[3] = { 0, 0, 0 };
+  resize(Eigen::Vector3d::Zero(), no_voxels);
+  if (!joint_model_group || resolution <= 0.0)
+  {
+    RCLCPP_ERROR(LOGGER, "A group and a positive resolution are required to compute a reachability map");
+    return false;
+  }
+  const moveit::core::LinkModel* base = state.getRobotModel()->getLinkModel(base_link);
+  const moveit::core::LinkModel* tip = state.getRobotModel()->getLinkModel(tip_link);
+  if (!base || !tip)
+  {
+    RCLCPP_ERROR(LOGGER, "Links '%s' and '%s' are required to compute a reachability map", base_link.c_str(),
+                 tip_link.c_str());
+    return false;
+  }
+  if (joint_model_group->isLinkUpdated(base_link))
+  {
+    RCLCPP_ERROR(LOGGER, "Base link '%s' of the reachability map is moved by group '%s'", base_link.c_str(),
+                 joint_model_group->getName().c_str());
+    return false;
+  }
+
+  group_name_ = joint_model_group->getName();
+  base_link_ = base_link;
+  tip_link_ = tip_link;
+  resolution_ = resolution;
+
+  // the bounds are only known after sampling, so the poses are kept until then
+  EigenSTL::vector_Vector3d positions;
+  std::vector<std::uint8_t> orientations;
+  positions.reserve(sample_count);
+  orientations.reserve(sample_count);
+  Eigen::Vector3d min_position = Eigen::Vector3d::Constant(std::numeric_limits<double>::infinity());
+  Eigen::Vector3d max_position = -min_position;
+  for (std::size_t i = 0; i < sample_count; ++i)
+  {
+    state.setToRandomPositions(joint_model_group, rng);
+    state.updateLinkTransforms();
+    const Eigen::Isometry3d pose = state.getGlobalLinkTransform(base).inverse() * state.getGlobalLinkTransform(tip);
+    positions.push_back(pose.translation());
+    orientations.push_back(getOrientationIndex(pose.linear().col(2)));
+    min_position = min_position.cwiseMin(pose.translation());
+    max_position = max_position.cwiseMax(pose.translation());
+  }
+  if (positions.empty())
+    return true;
+
+  int num_voxels[3];
+  for (int d = 0; d < 3; ++d)
+    num_voxels[d] = static_cast<int>(std::floor((max_position[d] - min_position[d]) / resolution_)) + 1;
+  resize(min_position, num_voxels);
+
+  for (std::size_t i = 0; i < positions.size(); ++i)
+  {
+    const long index = getVoxelIndex(positions[i]);
+    if (index < 0)
+      continue;
+    if (voxels_[index] == 0)
+      ++reachable_voxel_count_;
+    voxels_[index] |= std::uint64_t(1) << orientations[i];
+  }
+  return true;
+}
+
+long ReachabilityMap::getVoxelIndex(const Eigen::Vector3d& position) const
+{
+  long index = 0;
+  for (int d = 0; d < 3; ++d)
+  {
+    const double cell = std::floor((position[d] - origin_[d]) / resolution_);
+    if (!(cell >= 0.0 && cell < num_voxels_[d]))  // also rejects NaN
+      return -1;
+    index = index * num_voxels_[d] + static_cast<long>(cell);
+  }
+  return index;
+}
+
+std::size_t ReachabilityMap::getOrientationIndex(const Eigen::Vector3d& direction) const
+{
+  std::size_t closest = 0;
+  double closest_dot = -std::numeric_limits<double>::infinity();
+  for (std::size_t i = 0; i < directions_.size(); ++i)
+  {
+    const double dot = directions_[i].dot(direction);
+    if (dot > closest_dot)
+    {
+      closest_dot = dot;
+      closest = i;
+    }
+  }
+  return closest;
+}
+
+std::size_t ReachabilityMap::getOrientationCount(const Eigen::Vector3d& position) const
+{
+  const long index = voxels_.empty() ? -1 : getVoxelIndex(position);
+  return index < 0 ? 0 : std::bitset<ORIENTATION_COUNT>(voxels_[index]).count();
+}
+
+bool ReachabilityMap::isReachable(const Eigen::Vector3d& position) const
+{
+  const long index = voxels_.empty() ? -1 : getVoxelIndex(position);
+  return index >= 0 && voxels_[index] != 0;
+}
+
+bool ReachabilityMap::isReachable(const Eigen::Isometry3d& pose) const
+{
+  const long index = voxels_.empty() ? -1 : getVoxelIndex(pose.translation());
+  return index >= 0 && (voxels_[index] & (std::uint64_t(1) << getOrientationIndex(pose.linear().col(2)))) != 0;
+}
+
+bool ReachabilityMap::writeToStream(std::ostream& stream) const
+{
+  // only the reachable voxels are stored, with their index
+  stream.write(FILE_MAGIC, sizeof(FILE_MAGIC));
+  writeValue(stream, FILE_VERSION);
+  writeValue(stream, static_cast<std::uint32_t>(ORIENTATION_COUNT));
+  writeString(stream, group_name_);
+  writeString(stream, base_link_);
+  writeString(stream, tip_link_);
+  writeValue(stream, resolution_);
+  for (int d = 0; d < 3; ++d)
+    writeValue(stream, origin_[d]);
+  for (int d = 0; d < 3; ++d)
+    writeValue(stream, static_cast<std::int32_t>(num_voxels_[d]));
+  writeValue(stream, static_cast<std::uint64_t>(reachable_voxel_count_));
+  for (std::size_t i = 0; i < voxels_.size(); ++i)
+    if (voxels_[i] != 0)
+    {
+      writeValue(stream, static_cast<std::uint64_t>(i));
+      writeValue(stream, voxels_[i]);
+    }
+  return static_cast<bool>(stream);
+}
+
+bool ReachabilityMap::readFromStream(std::istream& stream)
+{
+  const int no_voxels[3] = { 0, 0, 0 };
+  resize(Eigen::Vector3d::Zero(), no_voxels);
+
+  char magic[sizeof(FILE_MAGIC)];
+  std::uint32_t version, orientation_count;
+  if (!stream.read(magic, sizeof(magic)) || std::memcmp(magic, FILE_MAGIC, sizeof(magic)) != 0 ||
+      !readValue(stream, version) || version != FILE_VERSION || !readValue(stream, orientation_count) ||
+      orientation_count != ORIENTATION_COUNT)
+  {
+    RCLCPP_ERROR(LOGGER, "Stream does not contain a reachability map of a supported version");
+    return false;
+  }
+
+  double resolution;
+  Eigen::Vector3d origin;
+  std::int32_t num_voxels[3];
+  std::uint64_t reachable_voxel_count;
+  bool ok = readString(stream, group_name_) && readString(stream, base_link_) && readString(stream, tip_link_) &&
+            readValue(stream, resolution) && resolution > 0.0;
+  for (int d = 0; ok && d < 3; ++d)
+    ok = readValue(stream, origin[d]);
+  for (int d = 0; ok && d < 3; ++d)
+    ok = readValue(stream, num_voxels[d]) && num_voxels[d] >= 0;
+  const std::uint64_t voxel_count = ok ? static_cast<std::uint64_t>(num_voxels[0]) * num_voxels[1] * num_voxels[2] : 0;
+  ok = ok && voxel_count <= std::numeric_limits<std::int32_t>::max() && readValue(stream, reachable_voxel_count) &&
+       reachable_voxel_count <= voxel_count;
+  if (!ok)
+  {
+    group_name_.clear();
+    base_link_.clear();
+    tip_link_.clear();
+    RCLCPP_ERROR(LOGGER, "Unable to read the header of the reachability map");
+    return false;
+  }
+
+  resolution_ = resolution;
+  const int voxel_dims[3] = { num_voxels[0], num_voxels[1], num_voxels[2] };
+  resize(origin, voxel_dims);
+  for (std::uint64_t v = 0; v < reachable_voxel_count; ++v)
+  {
+    std::uint64_t index, mask;
+    if (!readValue(stream, index) || !readValue(stream, mask) || index >= voxels_.size() || mask == 0 ||
+        voxels_[index] != 0)
+    {
+      RCLCPP_ERROR(LOGGER, "Unable to read the voxels of the reachability map");
+      resize(Eigen::Vector3d::Zero(), no_voxels);
+      return false;
+    }
+    voxels_[index] = mask;
+    ++reachable_voxel_count_;
+  }
+  return true;
+}
+
+bool ReachabilityMap::saveToFile(const std::string& filename) const
+{
+  std::ofstream stream(filename.c_str(), std::ios::out | std::ios::binary);
+  if (!stream.good() || !writeToStream(stream))
+  {
+    RCLCPP_ERROR(LOGGER, "Unable to write reachability map to '%s'", filename.c_str());
+    return false;
+  }
+  return true;
+}
+
+bool ReachabilityMap::loadFromFile(const std::string& filename)
+{
+  std::ifstream stream(filename.c_str(), std::ios::in | std::ios::binary);
+  if (!stream.good())
+  {
+    RCLCPP_ERROR(LOGGER, "Unable to open reachability map '%s'", filename.c_str());
+    return false;
+  }
+  return readFromStream(stream);
+}
+}  // namespace kinematics_metrics
@@ -41,6 +41,9 @@
 #include <moveit_msgs/msg/motion_plan_response.hpp>
 #include <moveit_msgs/msg/motion_plan_detailed_response.hpp>
 
+#include <map>
+#include <string>
+
 namespace planning_interface
 {
 struct MotionPlanResponse
@@ -64,6 +67,10 @@ struct MotionPlanDetailedResponse
   std::vector<std::string> description_;
   std::vector<double> processing_time_;
   moveit_msgs::msg::MoveItErrorCodes error_code_;
+
+  /** \brief Optional breakdown of the planning effort by the planner, e.g. the number of state validity checks and
+      the time spent in them, in seconds. The names are specific to the planner. */
+  std::map<std::string, double> statistics_;
 };
 
 }  // namespace planning_interface
@@ -42,6 +42,7 @@
 #include <moveit/collision_detection/collision_detector_allocator.h>
 #include <moveit/collision_detection/world_diff.h>
 #include <moveit/collision_detection/collision_env.h>
+#include <moveit/collision_detection/self_collision_cache.h>
 #include <moveit/kinematic_constraints/kinematic_constraint.h>
 #include <moveit/kinematics_base/kinematics_base.h>
 #include <moveit/robot_trajectory/robot_trajectory.h>
@@ -76,6 +77,41 @@ typedef boost::function<bool(const moveit::core::RobotState&, bool)> StateFeasib
 using MotionFeasibilityFn =
     boost::function<bool(const moveit::core::RobotState&, const moveit::core::RobotState&, bool)>;
 
+/** \brief A frame resolved by PlanningScene::resolveFrame(), for repeated lookups of its transform without
+    searching the robot links, attached bodies, world objects, their subframes and the fixed transforms by name.
+
+    A handle of a robot link stays valid for the lifetime of the scene. Handles of world objects and fixed frames
+    become stale when the world or the fixed transforms of the scene change, which is detected from their
+    generations. Lookups of stale handles fall back to resolving the frame by name. Handles are resolved against the
+    frames known at the time of the call: a frame that is added later and shadows the resolved one is not noticed
+    until the generation changes. */
+struct FrameHandle
+{
+  enum Type
+  {
+    UNKNOWN,
+    MODEL_FRAME,
+    ROBOT_LINK,
+    ATTACHED_BODY,
+    WORLD_OBJECT,
+    FIXED_FRAME
+  };
+
+  Type type = UNKNOWN;
+
+  /** \brief The name of the frame, without leading slash */
+  std::string id;
+
+  /** \brief The link for ROBOT_LINK handles */
+  const moveit::core::LinkModel* link = nullptr;
+
+  /** \brief The transform for WORLD_OBJECT and FIXED_FRAME handles, valid at the generations below */
+  const Eigen::Isometry3d* transform = nullptr;
+
+  std::size_t world_generation = 0;
+  std::size_t transforms_generation = 0;
+};
+
 /** \brief A map from object names (e.g., attached bodies, collision objects) to their colors */
 using ObjectColorMap = std::map<std::string, std_msgs::msg::ColorRGBA>;
 
@@ -118,13 +154,17 @@ public:
 
   /** \brief Return a new child PlanningScene that uses this one as parent.
    *
-   *  The child scene has its own copy of the world. It maintains a list (in
-   *  world_diff_) of changes made to the child world.
-   *
-   *  The robot_model_, robot_state_, scene_transforms_, and acm_ are not copied.
+   *  The world, robot_model_, robot_state_, scene_transforms_, and acm_ are not copied.
    *  They are shared with the parent.  So if changes to these are made in the parent they will be visible in the child.
    * But if any of these is modified (i.e. if the get*NonConst functions are called) in the child then a copy is made
    * and subsequent changes to the corresponding member of the parent will no longer be visible in the child.
+   *
+   *  For the world, the child gets its own copy (with copy on write objects) on the first modification, and from
+   *  then on maintains a list (in world_diff_) of changes made to the child world.
+   *
+   *  The same holds for the collision environments: the child uses the parent's ones until its world is modified or
+   *  getCollisionEnvNonConst() is called, which makes creating a child cheap even for large worlds. As the child
+   *  shares the parent's world until then, its collision checks always agree with getWorld().
    */
   PlanningScenePtr diff() const;
 
@@ -226,6 +266,28 @@ public:
    * body id or a collision object */
   bool knowsFrameTransform(const moveit::core::RobotState& state, const std::string& id) const;
 
+  /** \brief Resolve the frame \e id once, for fast repeated lookups with getFrameTransform(const FrameHandle&) */
+  FrameHandle resolveFrame(const std::string& id) const
+  {
+    return resolveFrame(getCurrentState(), id);
+  }
+
+  /** \brief Resolve the frame \e id once, looking for attached bodies in \e state */
+  FrameHandle resolveFrame(const moveit::core::RobotState& state, const std::string& id) const;
+
+  /** \brief Check if \e handle is known and still refers to the transform it was resolved to */
+  bool isFrameHandleValid(const FrameHandle& handle) const;
+
+  /** \brief Get the transform of a resolved frame for the current state. Stale handles are resolved by name. */
+  const Eigen::Isometry3d& getFrameTransform(const FrameHandle& handle) const
+  {
+    return getFrameTransform(getCurrentState(), handle);
+  }
+
+  /** \brief Get the transform of a resolved frame for \e state, which must have up to date link transforms.
+      Stale handles are resolved by name. */
+  const Eigen::Isometry3d& getFrameTransform(const moveit::core::RobotState& state, const FrameHandle& handle) const;
+
   /**@}*/
 
   /**
@@ -284,16 +346,34 @@ public:
   /** \brief Get the representation of the world */
   const collision_detection::WorldConstPtr& getWorld() const
   {
-    // we always have a world representation
-    return world_const_;
+    // a diff scene uses the parent's world until it modifies its own
+    return world_const_ ? world_const_ : parent_->getWorld();
   }
 
-  // brief Get the representation of the world
-  const collision_detection::WorldPtr& getWorldNonConst()
+  /** \brief Get the representation of the world for modification. A diff scene copies the parent's world first. */
+  const collision_detection::WorldPtr& getWorldNonConst();
+
+  /** \brief An estimate of the memory held by this scene (in bytes) */
+  struct MemoryUsage
   {
-    // we always have a world representation
-    return world_;
-  }
+    /** \brief The shapes of the world objects */
+    collision_detection::World::MemoryUsage world;
+
+    /** \brief The collision environments owned by this scene, by collision detector name. Environments used from the
+     *  parent of a diff scene are not included. */
+    std::map<std::string, std::size_t> collision_environments;
+
+    std::size_t total() const
+    {
+      std::size_t bytes = world.total();
+      for (const std::pair<const std::string, std::size_t>& env : collision_environments)
+        bytes += env.second;
+      return bytes;
+    }
+  };
+
+  /** \brief Estimate the memory held by the world and the collision environments of this scene */
+  MemoryUsage getMemoryUsage() const;
 
   /** \brief Get the active collision environment */
   const collision_detection::CollisionEnvConstPtr& getCollisionEnv() const
@@ -334,6 +414,20 @@ public:
   /** \brief Get the allowed collision matrix */
   collision_detection::AllowedCollisionMatrix& getAllowedCollisionMatrixNonConst();
 
+  /** \brief Set a cache of self-collision results, consulted by the self-collision checks of this scene and of
+   * diffs that do not set their own. Only checks that do not ask for contacts, distances or costs use the cache.
+   * Pass NULL to stop using a cache. */
+  void setSelfCollisionCache(const collision_detection::SelfCollisionCachePtr& cache)
+  {
+    self_collision_cache_ = cache;
+  }
+
+  /** \brief Get the cache of self-collision results, NULL if there is none */
+  const collision_detection::SelfCollisionCachePtr& getSelfCollisionCache() const
+  {
+    return self_collision_cache_ || !parent_ ? self_collision_cache_ : parent_->getSelfCollisionCache();
+  }
+
   /**@}*/
 
   /**
@@ -375,6 +469,12 @@ public:
   bool isStateColliding(const moveit_msgs::msg::RobotState& state, const std::string& group = "",
                         bool verbose = false) const;
 
+  /** \brief Check if the robot collides with the world while each of its links moves linearly from its pose in \e from
+      to its pose in \e to. Self collisions are not checked. This needs a collision detector that supports continuous
+      collision checking (FCL, Bullet). It is expected that the link transforms of both states are up to date. */
+  bool isMotionColliding(const moveit::core::RobotState& from, const moveit::core::RobotState& to,
+                         const std::string& group = "", bool verbose = false) const;
+
   /** \brief Check whether the current state is in collision, and if needed, updates the collision transforms of the
    * current state before the computation. */
   void checkCollision(const collision_detection::CollisionRequest& req, collision_detection::CollisionResult& res);
@@ -490,8 +590,7 @@ public:
   void checkSelfCollision(const collision_detection::CollisionRequest& req, collision_detection::CollisionResult& res,
                           const moveit::core::RobotState& robot_state) const
   {
-    // do self-collision checking with the unpadded version of the robot
-    getCollisionEnvUnpadded()->checkSelfCollision(req, res, robot_state, getAllowedCollisionMatrix());
+    checkSelfCollision(req, res, robot_state, getAllowedCollisionMatrix());
   }
 
   /** \brief Check whether a specified state (\e robot_state) is in self collision, with respect to a given
@@ -508,11 +607,7 @@ public:
       allowed collision matrix (\e acm) */
   void checkSelfCollision(const collision_detection::CollisionRequest& req, collision_detection::CollisionResult& res,
                           const moveit::core::RobotState& robot_state,
-                          const collision_detection::AllowedCollisionMatrix& acm) const
-  {
-    // do self-collision checking with the unpadded version of the robot
-    getCollisionEnvUnpadded()->checkSelfCollision(req, res, robot_state, acm);
-  }
+                          const collision_detection::AllowedCollisionMatrix& acm) const;
 
   /** \brief Get the names of the links that are involved in collisions for the current state */
   void getCollidingLinks(std::vector<std::string>& links);
@@ -715,8 +810,11 @@ public:
   void
   getAttachedCollisionObjectMsgs(std::vector<moveit_msgs::msg::AttachedCollisionObject>& attached_collision_objs) const;
 
-  /** \brief Construct a message (\e octomap) with the octomap data from the planning_scene */
-  bool getOctomapMsg(octomap_msgs::msg::OctomapWithPose& octomap) const;
+  /** \brief Construct a message (\e octomap) with the octomap data from the planning_scene
+   *
+   * With \e binary, the tree is sent in the compact binary format, which only keeps whether nodes are occupied, instead
+   * of their occupancy probabilities. */
+  bool getOctomapMsg(octomap_msgs::msg::OctomapWithPose& octomap, bool binary = false) const;
 
   /** \brief Construct a vector of messages (\e object_colors) with the colors of the objects from the planning_scene */
   void getObjectColorMsgs(std::vector<moveit_msgs::msg::ObjectColor>& object_colors) const;
@@ -821,6 +919,19 @@ public:
     return motion_feasibility_;
   }
 
+  /** \brief Also check the motions between consecutive waypoints for collisions with the world in isPathValid() and
+      isPathValidParallel(), using isMotionColliding(). A diff scene takes the setting of its parent when it is made. */
+  void setContinuousPathCollisionChecking(bool flag)
+  {
+    continuous_path_collision_checking_ = flag;
+  }
+
+  /** \brief Check whether isPathValid() also checks the motions between consecutive waypoints for collisions */
+  bool getContinuousPathCollisionChecking() const
+  {
+    return continuous_path_collision_checking_;
+  }
+
   /** \brief Check if a given state is feasible, in accordance to the feasibility predicate specified by
    * setStateFeasibilityPredicate(). Returns true if no feasibility predicate was specified. */
   bool isStateFeasible(const moveit_msgs::msg::RobotState& state, bool verbose = false) const;
@@ -921,6 +1032,17 @@ public:
   bool isPathValid(const robot_trajectory::RobotTrajectory& trajectory, const std::string& group = "",
                    bool verbose = false, std::vector<std::size_t>* invalid_index = nullptr) const;
 
+  /** \brief Check if a given path is valid, distributing the waypoints over \e thread_count threads.
+   *
+   * The result is the same as for the corresponding sequential isPathValid(). Waypoints are processed in chunks; if
+   * \e invalid_index is not requested, all threads stop as soon as one invalid waypoint is found. A \e thread_count of
+   * 0 uses the number of hardware threads. The state feasibility predicate needs to be thread-safe. */
+  bool isPathValidParallel(const robot_trajectory::RobotTrajectory& trajectory,
+                           const moveit_msgs::msg::Constraints& path_constraints,
+                           const std::vector<moveit_msgs::msg::Constraints>& goal_constraints,
+                           unsigned int thread_count = 0, const std::string& group = "", bool verbose = false,
+                           std::vector<std::size_t>* invalid_index = nullptr) const;
+
   /** \brief Get the top \e max_costs cost sources for a specified trajectory. The resulting costs are stored in \e
    * costs */
   void getCostSources(const robot_trajectory::RobotTrajectory& trajectory, std::size_t max_costs,
@@ -987,7 +1109,7 @@ private:
   struct CollisionDetector
   {
     collision_detection::CollisionDetectorAllocatorPtr alloc_;
-    collision_detection::CollisionEnvPtr cenv_;  // never NULL
+    collision_detection::CollisionEnvPtr cenv_;  // NULL while the parent's environment is used
     collision_detection::CollisionEnvConstPtr cenv_const_;
 
     collision_detection::CollisionEnvPtr cenv_unpadded_;
@@ -1014,6 +1136,20 @@ private:
   void allocateCollisionDetectors();
   void allocateCollisionDetectors(CollisionDetector& detector);
 
+  /* Construct a MOVE message with only the shape poses of object \e ns. Returns false if the object does not exist
+   * or its shapes are not ordered such that a receiver can apply the poses. */
+  bool getCollisionObjectMoveMsg(moveit_msgs::msg::CollisionObject& collision_obj, const std::string& ns) const;
+
+  /* Allocate own collision environments for the detectors still using their parent's ones. A diff scene shares the
+   * parent's environments until it needs to modify them or its world diverges from the parent's world. */
+  void allocateCollisionEnvsFromParent();
+
+  /* Register the world observer calling allocateCollisionEnvsFromParent() on the first change to a diff scene's world */
+  void observeWorldForCollisionEnvs();
+
+  /* Give a diff scene that still uses the parent's world its own copy of it, tracked by world_diff_ */
+  void materializeWorld();
+
   std::string name_;  // may be empty
 
   PlanningSceneConstPtr parent_;  // Null unless this is a diff scene
@@ -1029,20 +1165,25 @@ private:
   // This Transforms class is actually a SceneTransforms class
   moveit::core::TransformsPtr scene_transforms_;  // if NULL use parent's
 
-  collision_detection::WorldPtr world_;             // never NULL, never shared with parent/child
+  collision_detection::WorldPtr world_;             // if NULL use parent's, never shared with parent/child
   collision_detection::WorldConstPtr world_const_;  // copy of world_
-  collision_detection::WorldDiffPtr world_diff_;    // NULL unless this is a diff scene
+  collision_detection::WorldDiffPtr world_diff_;    // NULL unless this is a diff scene with its own world
   collision_detection::World::ObserverCallbackFn current_world_object_update_callback_;
   collision_detection::World::ObserverHandle current_world_object_update_observer_handle_;
+  collision_detection::World::ObserverHandle parent_collision_observer_handle_;
 
   std::map<std::string, CollisionDetectorPtr> collision_;  // never empty
   CollisionDetectorPtr active_collision_;                  // copy of one of the entries in collision_.  Never NULL.
 
   collision_detection::AllowedCollisionMatrixPtr acm_;  // if NULL use parent's
 
+  collision_detection::SelfCollisionCachePtr self_collision_cache_;  // if NULL use parent's
+
   StateFeasibilityFn state_feasibility_;
   MotionFeasibilityFn motion_feasibility_;
 
+  bool continuous_path_collision_checking_ = false;
+
   std::unique_ptr<ObjectColorMap> object_colors_;
 
   // a map of object types
@@ -46,13 +46,19 @@
 #include <moveit/utils/message_checks.h>
 #include <octomap_msgs/conversions.h>
 #include <tf2_eigen/tf2_eigen.h>
+#include <algorithm>
+#include <atomic>
 #include <memory>
 #include <set>
+#include <thread>
 
 namespace planning_scene
 {
 static const rclcpp::Logger LOGGER = rclcpp::get_logger("moveit_planning_scene.planning_scene");
 
+// Number of consecutive waypoints a thread validates at a time in isPathValidParallel()
+static const std::size_t PATH_VALIDITY_CHUNK_SIZE = 32;
+
 const std::string PlanningScene::OCTOMAP_NS = "<octomap>";
 const std::string PlanningScene::DEFAULT_SCENE_NAME = "(noname)";
 
@@ -137,8 +143,11 @@ PlanningScene::PlanningScene(const urdf::ModelInterfaceSharedPtr& urdf_model,
 
 PlanningScene::~PlanningScene()
 {
+  if (!world_)
+    return;
   if (current_world_object_update_callback_)
     world_->removeObserver(current_world_object_update_observer_handle_);
+  world_->removeObserver(parent_collision_observer_handle_);
 }
 
 void PlanningScene::initialize()
@@ -184,16 +193,13 @@ PlanningScene::PlanningScene(const PlanningSceneConstPtr& parent) : parent_(pare
     name_ = parent_->getName() + "+";
 
   robot_model_ = parent_->robot_model_;
+  continuous_path_collision_checking_ = parent_->continuous_path_collision_checking_;
 
-  // maintain a separate world.  Copy on write ensures that most of the object
-  // info is shared until it is modified.
-  world_.reset(new collision_detection::World(*parent_->world_));
-  world_const_ = world_;
+  // The parent's world is used until this scene modifies its own (see materializeWorld()), so that the world always
+  // matches the collision environments, which are shared with the parent until then as well.
 
-  // record changes to the world
-  world_diff_.reset(new collision_detection::WorldDiff(world_));
-
-  // Set up the same collision detectors as the parent
+  // Set up the same collision detectors as the parent. Their environments are only allocated once this scene
+  // diverges from the parent (see allocateCollisionEnvsFromParent()), until then the parent's ones are used.
   for (const std::pair<const std::string, CollisionDetectorPtr>& it : parent_->collision_)
   {
     const CollisionDetectorPtr& parent_detector = it.second;
@@ -201,12 +207,6 @@ PlanningScene::PlanningScene(const PlanningSceneConstPtr& parent) : parent_(pare
     detector.reset(new CollisionDetector());
     detector->alloc_ = parent_detector->alloc_;
     detector->parent_ = parent_detector;
-
-    detector->cenv_ = detector->alloc_->allocateEnv(parent_detector->cenv_, world_);
-    detector->cenv_const_ = detector->cenv_;
-
-    detector->cenv_unpadded_ = detector->alloc_->allocateEnv(parent_detector->cenv_unpadded_, world_);
-    detector->cenv_unpadded_const_ = detector->cenv_unpadded_;
   }
   setActiveCollisionDetector(parent_->getActiveCollisionDetectorName());
 }
@@ -231,6 +231,57 @@ PlanningScenePtr PlanningScene::diff(const moveit_msgs::msg::PlanningScene& msg)
   return result;
 }
 
+void PlanningScene::observeWorldForCollisionEnvs()
+{
+  parent_collision_observer_handle_ = world_->addObserver(
+      [this](const collision_detection::World::ObjectConstPtr& /*obj*/, collision_detection::World::Action /*action*/) {
+        // the world diverges from the parent's one, so the parent's collision environments cannot be used anymore
+        allocateCollisionEnvsFromParent();
+      });
+}
+
+void PlanningScene::materializeWorld()
+{
+  if (world_)
+    return;
+
+  // maintain a separate world.  Copy on write ensures that most of the object
+  // info is shared until it is modified.
+  world_.reset(new collision_detection::World(*parent_->getWorld()));
+  world_const_ = world_;
+
+  // record changes to the world
+  world_diff_.reset(new collision_detection::WorldDiff(world_));
+
+  if (current_world_object_update_callback_)
+    current_world_object_update_observer_handle_ = world_->addObserver(current_world_object_update_callback_);
+  observeWorldForCollisionEnvs();
+}
+
+const collision_detection::WorldPtr& PlanningScene::getWorldNonConst()
+{
+  materializeWorld();
+  return world_;
+}
+
+void PlanningScene::allocateCollisionEnvsFromParent()
+{
+  // the parent's environments match the parent's world, which is copied here if this scene still uses it
+  materializeWorld();
+  for (std::pair<const std::string, CollisionDetectorPtr>& it : collision_)
+  {
+    CollisionDetector& detector = *it.second;
+    if (detector.cenv_ || !detector.parent_)
+      continue;
+
+    detector.cenv_ = detector.alloc_->allocateEnv(detector.parent_->getCollisionEnv(), world_);
+    detector.cenv_const_ = detector.cenv_;
+
+    detector.cenv_unpadded_ = detector.alloc_->allocateEnv(detector.parent_->getCollisionEnvUnpadded(), world_);
+    detector.cenv_unpadded_const_ = detector.cenv_unpadded_;
+  }
+}
+
 void PlanningScene::CollisionDetector::copyPadding(const PlanningScene::CollisionDetector& src)
 {
   cenv_->setLinkPadding(src.getCollisionEnv()->getLinkPadding());
@@ -239,6 +290,7 @@ void PlanningScene::CollisionDetector::copyPadding(const PlanningScene::Collisio
 
 void PlanningScene::propogateRobotPadding()
 {
+  allocateCollisionEnvsFromParent();
   for (std::pair<const std::string, CollisionDetectorPtr>& it : collision_)
   {
     if (it.second != active_collision_)
@@ -273,19 +325,19 @@ void PlanningScene::addCollisionDetector(const collision_detection::CollisionDet
 
   detector->findParent(*this);
 
-  detector->cenv_ = detector->alloc_->allocateEnv(world_, getRobotModel());
+  detector->cenv_ = detector->alloc_->allocateEnv(getWorldNonConst(), getRobotModel());
   detector->cenv_const_ = detector->cenv_;
 
   // if the current active detector is not the added one, copy its padding to the new one and allocate unpadded
   if (detector != active_collision_)
   {
-    detector->cenv_unpadded_ = detector->alloc_->allocateEnv(world_, getRobotModel());
+    detector->cenv_unpadded_ = detector->alloc_->allocateEnv(getWorldNonConst(), getRobotModel());
     detector->cenv_unpadded_const_ = detector->cenv_unpadded_;
 
     detector->copyPadding(*active_collision_);
   }
 
-  detector->cenv_unpadded_ = detector->alloc_->allocateEnv(world_, getRobotModel());
+  detector->cenv_unpadded_ = detector->alloc_->allocateEnv(getWorldNonConst(), getRobotModel());
   detector->cenv_unpadded_const_ = detector->cenv_unpadded_;
 }
 
@@ -340,6 +392,21 @@ void PlanningScene::getCollisionDetectorNames(std::vector<std::string>& names) c
     names.push_back(it.first);
 }
 
+PlanningScene::MemoryUsage PlanningScene::getMemoryUsage() const
+{
+  MemoryUsage usage;
+  usage.world = getWorld()->getMemoryUsage();
+  for (const std::pair<const std::string, CollisionDetectorPtr>& it : collision_)
+  {
+    std::size_t& bytes = usage.collision_environments[it.first];
+    if (it.second->cenv_)
+      bytes += it.second->cenv_->getMemoryUsage();
+    if (it.second->cenv_unpadded_)
+      bytes += it.second->cenv_unpadded_->getMemoryUsage();
+  }
+  return usage;
+}
+
 const collision_detection::CollisionEnvConstPtr&
 PlanningScene::getCollisionEnv(const std::string& collision_detector_name) const
 {
@@ -375,14 +442,21 @@ void PlanningScene::clearDiffs()
   if (!parent_)
     return;
 
-  // clear everything, reset the world, record diffs
-  world_.reset(new collision_detection::World(*parent_->world_));
-  world_const_ = world_;
-  world_diff_.reset(new collision_detection::WorldDiff(world_));
+  // clear everything, use the parent's world again
+  if (world_)
+  {
+    if (current_world_object_update_callback_)
+      world_->removeObserver(current_world_object_update_observer_handle_);
+    world_->removeObserver(parent_collision_observer_handle_);
+    world_.reset();
+    world_const_.reset();
+    world_diff_.reset();
+  }
+  // the update callback observes this scene's own world
   if (current_world_object_update_callback_)
-    current_world_object_update_observer_handle_ = world_->addObserver(current_world_object_update_callback_);
+    materializeWorld();
 
-  // use parent crobot_ if it exists.  Otherwise copy padding from parent.
+  // use the parent's collision environments again if possible.  Otherwise copy padding from parent.
   for (std::pair<const std::string, CollisionDetectorPtr>& it : collision_)
   {
     if (!it.second->parent_)
@@ -390,18 +464,16 @@ void PlanningScene::clearDiffs()
 
     if (it.second->parent_)
     {
-      it.second->cenv_ = it.second->alloc_->allocateEnv(it.second->parent_->cenv_, world_);
-      it.second->cenv_const_ = it.second->cenv_;
-
-      it.second->cenv_unpadded_ = it.second->alloc_->allocateEnv(it.second->parent_->cenv_unpadded_, world_);
-      it.second->cenv_unpadded_const_ = it.second->cenv_unpadded_;
+      it.second->cenv_.reset();
+      it.second->cenv_const_.reset();
+      it.second->cenv_unpadded_.reset();
+      it.second->cenv_unpadded_const_.reset();
     }
     else
     {
-      it.second->copyPadding(*parent_->active_collision_);
-
-      it.second->cenv_ = it.second->alloc_->allocateEnv(it.second->parent_->cenv_, world_);
+      it.second->cenv_ = it.second->alloc_->allocateEnv(getWorldNonConst(), getRobotModel());
       it.second->cenv_const_ = it.second->cenv_;
+      it.second->copyPadding(*parent_->active_collision_);
     }
   }
 
@@ -439,8 +511,8 @@ void PlanningScene::pushDiffs(const PlanningScenePtr& scene)
     scene->getAllowedCollisionMatrixNonConst() = *acm_;
 
   collision_detection::CollisionEnvPtr active_cenv = scene->getCollisionEnvNonConst();
-  active_cenv->setLinkPadding(active_collision_->cenv_->getLinkPadding());
-  active_cenv->setLinkScale(active_collision_->cenv_->getLinkScale());
+  active_cenv->setLinkPadding(getCollisionEnv()->getLinkPadding());
+  active_cenv->setLinkScale(getCollisionEnv()->getLinkScale());
   scene->propogateRobotPadding();
 
   if (world_diff_)
@@ -449,21 +521,21 @@ void PlanningScene::pushDiffs(const PlanningScenePtr& scene)
     {
       if (it.second == collision_detection::World::DESTROY)
       {
-        scene->world_->removeObject(it.first);
+        scene->getWorldNonConst()->removeObject(it.first);
         scene->removeObjectColor(it.first);
         scene->removeObjectType(it.first);
       }
       else
       {
-        const collision_detection::World::Object& obj = *world_->getObject(it.first);
-        scene->world_->removeObject(obj.id_);
-        scene->world_->addToObject(obj.id_, obj.shapes_, obj.shape_poses_);
+        const collision_detection::World::Object& obj = *getWorld()->getObject(it.first);
+        scene->getWorldNonConst()->removeObject(obj.id_);
+        scene->getWorldNonConst()->addToObject(obj.id_, obj.shapes_, obj.shape_poses_);
         if (hasObjectColor(it.first))
           scene->setObjectColor(it.first, getObjectColor(it.first));
         if (hasObjectType(it.first))
           scene->setObjectType(it.first, getObjectType(it.first));
 
-        scene->world_->setSubframesOfObject(obj.id_, obj.subframe_poses_);
+        scene->getWorldNonConst()->setSubframesOfObject(obj.id_, obj.subframe_poses_);
       }
     }
   }
@@ -488,7 +560,7 @@ void PlanningScene::checkCollision(const collision_detection::CollisionRequest&
   if (!res.collision || (req.contacts && res.contacts.size() < req.max_contacts))
   {
     // do self-collision checking with the unpadded version of the robot
-    getCollisionEnvUnpadded()->checkSelfCollision(req, res, robot_state, getAllowedCollisionMatrix());
+    checkSelfCollision(req, res, robot_state, getAllowedCollisionMatrix());
   }
 }
 
@@ -511,7 +583,34 @@ void PlanningScene::checkCollision(const collision_detection::CollisionRequest&
 
   // do self-collision checking with the unpadded version of the robot
   if (!res.collision || (req.contacts && res.contacts.size() < req.max_contacts))
+    checkSelfCollision(req, res, robot_state, acm);
+}
+
+void PlanningScene::checkSelfCollision(const collision_detection::CollisionRequest& req,
+                                       collision_detection::CollisionResult& res,
+                                       const moveit::core::RobotState& robot_state,
+                                       const collision_detection::AllowedCollisionMatrix& acm) const
+{
+  // the cache only knows whether there is a collision
+  const collision_detection::SelfCollisionCachePtr& cache = getSelfCollisionCache();
+  if (!cache || req.contacts || req.distance || req.cost || req.verbose)
+  {
+    // do self-collision checking with the unpadded version of the robot
     getCollisionEnvUnpadded()->checkSelfCollision(req, res, robot_state, acm);
+    return;
+  }
+
+  const std::string context = req.group_name + '/' + getActiveCollisionDetectorName();
+  bool collision;
+  if (cache->lookup(robot_state, acm, context, collision))
+  {
+    res.collision = res.collision || collision;
+    return;
+  }
+  collision_detection::CollisionResult self_res;
+  getCollisionEnvUnpadded()->checkSelfCollision(req, self_res, robot_state, acm);
+  cache->insert(robot_state, acm, context, self_res.collision);
+  res.collision = res.collision || self_res.collision;
 }
 
 void PlanningScene::checkCollisionUnpadded(const collision_detection::CollisionRequest& req,
@@ -534,7 +633,7 @@ void PlanningScene::checkCollisionUnpadded(const collision_detection::CollisionR
   // do self-collision checking with the unpadded version of the robot
   if (!res.collision || (req.contacts && res.contacts.size() < req.max_contacts))
   {
-    getCollisionEnvUnpadded()->checkSelfCollision(req, res, robot_state, acm);
+    checkSelfCollision(req, res, robot_state, acm);
   }
 }
 
@@ -586,6 +685,7 @@ void PlanningScene::getCollidingLinks(std::vector<std::string>& links, const mov
 
 const collision_detection::CollisionEnvPtr& PlanningScene::getCollisionEnvNonConst()
 {
+  allocateCollisionEnvsFromParent();
   return active_collision_->cenv_;
 }
 
@@ -616,7 +716,10 @@ void PlanningScene::setAttachedBodyUpdateCallback(const moveit::core::AttachedBo
 
 void PlanningScene::setCollisionObjectUpdateCallback(const collision_detection::World::ObserverCallbackFn& callback)
 {
-  if (current_world_object_update_callback_)
+  // the callback observes this scene's own world, so a diff scene stops using the parent's world
+  if (callback)
+    materializeWorld();
+  if (current_world_object_update_callback_ && world_)
     world_->removeObserver(current_world_object_update_observer_handle_);
   if (callback)
     current_world_object_update_observer_handle_ = world_->addObserver(callback);
@@ -675,8 +778,8 @@ void PlanningScene::getPlanningSceneDiffMsg(moveit_msgs::msg::PlanningScene& sce
   else
     scene_msg.allowed_collision_matrix = moveit_msgs::msg::AllowedCollisionMatrix();
 
-  active_collision_->cenv_->getPadding(scene_msg.link_padding);
-  active_collision_->cenv_->getScale(scene_msg.link_scale);
+  getCollisionEnv()->getPadding(scene_msg.link_padding);
+  getCollisionEnv()->getScale(scene_msg.link_scale);
 
   scene_msg.object_colors.clear();
   if (object_colors_)
@@ -711,7 +814,10 @@ void PlanningScene::getPlanningSceneDiffMsg(moveit_msgs::msg::PlanningScene& sce
       else
       {
         scene_msg.world.collision_objects.emplace_back();
-        getCollisionObjectMsg(scene_msg.world.collision_objects.back(), it.first);
+        // objects that were only moved are sent without their geometry
+        if (it.second != collision_detection::World::MOVE_SHAPE ||
+            !getCollisionObjectMoveMsg(scene_msg.world.collision_objects.back(), it.first))
+          getCollisionObjectMsg(scene_msg.world.collision_objects.back(), it.first);
       }
     }
     if (do_omap)
@@ -762,7 +868,7 @@ bool PlanningScene::getCollisionObjectMsg(moveit_msgs::msg::CollisionObject& col
   collision_obj.header.frame_id = getPlanningFrame();
   collision_obj.id = ns;
   collision_obj.operation = moveit_msgs::msg::CollisionObject::ADD;
-  collision_detection::CollisionEnv::ObjectConstPtr obj = world_->getObject(ns);
+  collision_detection::CollisionEnv::ObjectConstPtr obj = getWorld()->getObject(ns);
   if (!obj)
     return false;
   ShapeVisitorAddToCollisionObject sv(&collision_obj);
@@ -793,10 +899,56 @@ bool PlanningScene::getCollisionObjectMsg(moveit_msgs::msg::CollisionObject& col
   return true;
 }
 
+bool PlanningScene::getCollisionObjectMoveMsg(moveit_msgs::msg::CollisionObject& collision_obj,
+                                              const std::string& ns) const
+{
+  collision_detection::CollisionEnv::ObjectConstPtr obj = getWorld()->getObject(ns);
+  if (!obj)
+    return false;
+
+  // processCollisionObjectMove() assigns the poses in the order primitives, meshes and planes, which is the order of
+  // the shapes of an object created from a full collision object message
+  std::vector<geometry_msgs::msg::Pose> primitive_poses, mesh_poses, plane_poses;
+  for (std::size_t j = 0; j < obj->shapes_.size(); ++j)
+  {
+    std::vector<geometry_msgs::msg::Pose>* poses;
+    switch (obj->shapes_[j]->type)
+    {
+      case shapes::SPHERE:
+      case shapes::CYLINDER:
+      case shapes::CONE:
+      case shapes::BOX:
+        poses = &primitive_poses;
+        break;
+      case shapes::MESH:
+        poses = &mesh_poses;
+        break;
+      case shapes::PLANE:
+        poses = &plane_poses;
+        break;
+      default:
+        return false;
+    }
+    if ((poses == &primitive_poses && !(mesh_poses.empty() && plane_poses.empty())) ||
+        (poses == &mesh_poses && !plane_poses.empty()))
+      return false;
+    poses->push_back(tf2::toMsg(obj->shape_poses_[j]));
+  }
+
+  collision_obj = moveit_msgs::msg::CollisionObject();
+  collision_obj.header.frame_id = getPlanningFrame();
+  collision_obj.id = ns;
+  collision_obj.operation = moveit_msgs::msg::CollisionObject::MOVE;
+  collision_obj.primitive_poses = std::move(primitive_poses);
+  collision_obj.mesh_poses = std::move(mesh_poses);
+  collision_obj.plane_poses = std::move(plane_poses);
+  return true;
+}
+
 void PlanningScene::getCollisionObjectMsgs(std::vector<moveit_msgs::msg::CollisionObject>& collision_objs) const
 {
   collision_objs.clear();
-  const std::vector<std::string>& ids = world_->getObjectIds();
+  const std::vector<std::string>& ids = getWorld()->getObjectIds();
   for (const std::string& id : ids)
     if (id != OCTOMAP_NS)
     {
@@ -829,18 +981,21 @@ void PlanningScene::getAttachedCollisionObjectMsgs(
   attachedBodiesToAttachedCollisionObjectMsgs(attached_bodies, attached_collision_objs);
 }
 
-bool PlanningScene::getOctomapMsg(octomap_msgs::msg::OctomapWithPose& octomap) const
+bool PlanningScene::getOctomapMsg(octomap_msgs::msg::OctomapWithPose& octomap, bool binary) const
 {
   octomap.header.frame_id = getPlanningFrame();
   octomap.octomap = octomap_msgs::msg::Octomap();
 
-  collision_detection::CollisionEnv::ObjectConstPtr map = world_->getObject(OCTOMAP_NS);
+  collision_detection::CollisionEnv::ObjectConstPtr map = getWorld()->getObject(OCTOMAP_NS);
   if (map)
   {
     if (map->shapes_.size() == 1)
     {
       const shapes::OcTree* o = static_cast<const shapes::OcTree*>(map->shapes_[0].get());
-      octomap_msgs::fullMapToMsg(*o->octree, octomap.octomap);
+      if (binary)
+        octomap_msgs::binaryMapToMsg(*o->octree, octomap.octomap);
+      else
+        octomap_msgs::fullMapToMsg(*o->octree, octomap.octomap);
       octomap.origin = tf2::toMsg(map->shape_poses_[0]);
       return true;
     }
@@ -933,7 +1088,7 @@ void PlanningScene::getPlanningSceneMsg(moveit_msgs::msg::PlanningScene& scene_m
     getCollisionObjectMsgs(scene_msg.world.collision_objects);
   else if (comp.components & moveit_msgs::msg::PlanningSceneComponents::WORLD_OBJECT_NAMES)
   {
-    const std::vector<std::string>& ids = world_->getObjectIds();
+    const std::vector<std::string>& ids = getWorld()->getObjectIds();
     scene_msg.world.collision_objects.clear();
     scene_msg.world.collision_objects.reserve(ids.size());
     for (const std::string& id : ids)
@@ -955,11 +1110,11 @@ void PlanningScene::getPlanningSceneMsg(moveit_msgs::msg::PlanningScene& scene_m
 void PlanningScene::saveGeometryToStream(std::ostream& out) const
 {
   out << name_ << std::endl;
-  const std::vector<std::string>& ids = world_->getObjectIds();
+  const std::vector<std::string>& ids = getWorld()->getObjectIds();
   for (const std::string& id : ids)
     if (id != OCTOMAP_NS)
     {
-      collision_detection::CollisionEnv::ObjectConstPtr obj = world_->getObject(id);
+      collision_detection::CollisionEnv::ObjectConstPtr obj = getWorld()->getObject(id);
       if (obj)
       {
         out << "* " << id << std::endl;
@@ -1049,7 +1204,7 @@ bool PlanningScene::loadGeometryFromStream(std::istream& in, const Eigen::Isomet
           Eigen::Isometry3d pose = Eigen::Translation3d(x, y, z) * Eigen::Quaterniond(rw, rx, ry, rz);
           // Transform pose by input pose offset
           pose = offset * pose;
-          world_->addToObject(ns, shape, pose);
+          getWorldNonConst()->addToObject(ns, shape, pose);
           if (r > 0.0f || g > 0.0f || b > 0.0f || a > 0.0f)
           {
             std_msgs::msg::ColorRGBA color;
@@ -1134,6 +1289,8 @@ void PlanningScene::decoupleParent()
   if (!acm_)
     acm_.reset(new collision_detection::AllowedCollisionMatrix(parent_->getAllowedCollisionMatrix()));
 
+  materializeWorld();
+  allocateCollisionEnvsFromParent();
   for (std::pair<const std::string, CollisionDetectorPtr>& it : collision_)
   {
     it.second->parent_.reset();
@@ -1205,6 +1362,7 @@ bool PlanningScene::setPlanningSceneDiffMsg(const moveit_msgs::msg::PlanningScen
 
   if (!scene_msg.link_padding.empty() || !scene_msg.link_scale.empty())
   {
+    allocateCollisionEnvsFromParent();
     for (std::pair<const std::string, CollisionDetectorPtr>& it : collision_)
     {
       it.second->cenv_->setPadding(scene_msg.link_padding);
@@ -1216,9 +1374,11 @@ bool PlanningScene::setPlanningSceneDiffMsg(const moveit_msgs::msg::PlanningScen
   for (const moveit_msgs::msg::ObjectColor& object_color : scene_msg.object_colors)
     setObjectColor(object_color.id, object_color.color);
 
-  // process collision object updates
+  // process collision object updates, notifying the collision environments once
+  getWorldNonConst()->beginBatch();
   for (const moveit_msgs::msg::CollisionObject& collision_object : scene_msg.world.collision_objects)
     result &= processCollisionObjectMsg(collision_object);
+  getWorldNonConst()->commitBatch();
 
   // if an octomap was specified, replace the one we have with that one
   if (!scene_msg.world.octomap.octomap.data.empty())
@@ -1251,16 +1411,21 @@ bool PlanningScene::setPlanningSceneMsg(const moveit_msgs::msg::PlanningScene& s
   object_colors_.reset(new ObjectColorMap());
   for (const moveit_msgs::msg::ObjectColor& object_color : scene_msg.object_colors)
     setObjectColor(object_color.id, object_color.color);
-  world_->clearObjects();
-  return processPlanningSceneWorldMsg(scene_msg.world);
+  getWorldNonConst()->beginBatch();
+  getWorldNonConst()->clearObjects();
+  const bool result = processPlanningSceneWorldMsg(scene_msg.world);
+  getWorldNonConst()->commitBatch();
+  return result;
 }
 
 bool PlanningScene::processPlanningSceneWorldMsg(const moveit_msgs::msg::PlanningSceneWorld& world)
 {
   bool result = true;
+  getWorldNonConst()->beginBatch();
   for (const moveit_msgs::msg::CollisionObject& collision_object : world.collision_objects)
     result &= processCollisionObjectMsg(collision_object);
   processOctomapMsg(world.octomap);
+  getWorldNonConst()->commitBatch();
   return result;
 }
 
@@ -1275,7 +1440,7 @@ bool PlanningScene::usePlanningSceneMsg(const moveit_msgs::msg::PlanningScene& s
 void PlanningScene::processOctomapMsg(const octomap_msgs::msg::Octomap& map)
 {
   // each octomap replaces any previous one
-  world_->removeObject(OCTOMAP_NS);
+  getWorldNonConst()->removeObject(OCTOMAP_NS);
 
   if (map.data.empty())
     return;
@@ -1290,21 +1455,22 @@ void PlanningScene::processOctomapMsg(const octomap_msgs::msg::Octomap& map)
   if (!map.header.frame_id.empty())
   {
     const Eigen::Isometry3d& t = getFrameTransform(map.header.frame_id);
-    world_->addToObject(OCTOMAP_NS, shapes::ShapeConstPtr(new shapes::OcTree(om)), t);
+    getWorldNonConst()->addToObject(OCTOMAP_NS, shapes::ShapeConstPtr(new shapes::OcTree(om)), t);
   }
   else
   {
-    world_->addToObject(OCTOMAP_NS, shapes::ShapeConstPtr(new shapes::OcTree(om)), Eigen::Isometry3d::Identity());
+    getWorldNonConst()->addToObject(OCTOMAP_NS, shapes::ShapeConstPtr(new shapes::OcTree(om)),
+                                    Eigen::Isometry3d::Identity());
   }
 }
 
 void PlanningScene::removeAllCollisionObjects()
 {
-  const std::vector<std::string>& object_ids = world_->getObjectIds();
+  const std::vector<std::string>& object_ids = getWorld()->getObjectIds();
   for (const std::string& object_id : object_ids)
     if (object_id != OCTOMAP_NS)
     {
-      world_->removeObject(object_id);
+      getWorldNonConst()->removeObject(object_id);
       removeObjectColor(object_id);
       removeObjectType(object_id);
     }
@@ -1313,7 +1479,7 @@ void PlanningScene::removeAllCollisionObjects()
 void PlanningScene::processOctomapMsg(const octomap_msgs::msg::OctomapWithPose& map)
 {
   // each octomap replaces any previous one
-  world_->removeObject(OCTOMAP_NS);
+  getWorldNonConst()->removeObject(OCTOMAP_NS);
 
   if (map.octomap.data.empty())
     return;
@@ -1329,12 +1495,12 @@ void PlanningScene::processOctomapMsg(const octomap_msgs::msg::OctomapWithPose&
   Eigen::Isometry3d p;
   tf2::fromMsg(map.origin, p);
   p = t * p;
-  world_->addToObject(OCTOMAP_NS, shapes::ShapeConstPtr(new shapes::OcTree(om)), p);
+  getWorldNonConst()->addToObject(OCTOMAP_NS, shapes::ShapeConstPtr(new shapes::OcTree(om)), p);
 }
 
 void PlanningScene::processOctomapPtr(const std::shared_ptr<const octomap::OcTree>& octree, const Eigen::Isometry3d& t)
 {
-  collision_detection::CollisionEnv::ObjectConstPtr map = world_->getObject(OCTOMAP_NS);
+  collision_detection::CollisionEnv::ObjectConstPtr map = getWorld()->getObject(OCTOMAP_NS);
   if (map)
   {
     if (map->shapes_.size() == 1)
@@ -1354,15 +1520,15 @@ void PlanningScene::processOctomapPtr(const std::shared_ptr<const octomap::OcTre
         {
           shapes::ShapeConstPtr shape = map->shapes_[0];
           map.reset();  // reset this pointer first so that caching optimizations can be used in CollisionWorld
-          world_->moveShapeInObject(OCTOMAP_NS, shape, t);
+          getWorldNonConst()->moveShapeInObject(OCTOMAP_NS, shape, t);
         }
         return;
       }
     }
   }
   // if the octree pointer changed, update the structure
-  world_->removeObject(OCTOMAP_NS);
-  world_->addToObject(OCTOMAP_NS, shapes::ShapeConstPtr(new shapes::OcTree(octree)), t);
+  getWorldNonConst()->removeObject(OCTOMAP_NS);
+  getWorldNonConst()->addToObject(OCTOMAP_NS, shapes::ShapeConstPtr(new shapes::OcTree(octree)), t);
 }
 
 bool PlanningScene::processAttachedCollisionObjectMsg(const moveit_msgs::msg::AttachedCollisionObject& object)
@@ -1436,7 +1602,7 @@ bool PlanningScene::processAttachedCollisionObjectMsg(const moveit_msgs::msg::At
       // TODO(felixvd): This code may be duplicated in robot_state/conversions.cpp
 
       // STEP 1.1: Get shapes and poses from existing world object or message.
-      collision_detection::CollisionEnv::ObjectConstPtr obj_in_world = world_->getObject(object.object.id);
+      collision_detection::CollisionEnv::ObjectConstPtr obj_in_world = getWorld()->getObject(object.object.id);
       if (object.object.operation == moveit_msgs::msg::CollisionObject::ADD && object.object.primitives.empty() &&
           object.object.meshes.empty() && object.object.planes.empty())
       {
@@ -1547,7 +1713,7 @@ bool PlanningScene::processAttachedCollisionObjectMsg(const moveit_msgs::msg::At
       }
 
       // STEP 2: Remove the object from the world
-      if (obj_in_world && world_->removeObject(object.object.id))
+      if (obj_in_world && getWorldNonConst()->removeObject(object.object.id))
       {
         if (object.object.operation == moveit_msgs::msg::CollisionObject::ADD)
           RCLCPP_DEBUG(LOGGER, "Removing world object with the same name as newly attached object: '%s'",
@@ -1632,7 +1798,7 @@ bool PlanningScene::processAttachedCollisionObjectMsg(const moveit_msgs::msg::At
     for (const moveit::core::AttachedBody* attached_body : attached_bodies)
     {
       const std::string& name = attached_body->getName();
-      if (world_->hasObject(name))
+      if (getWorld()->hasObject(name))
       {
         RCLCPP_WARN(LOGGER,
                     "The collision world already has an object with the same name as the body about to be detached. "
@@ -1641,8 +1807,9 @@ bool PlanningScene::processAttachedCollisionObjectMsg(const moveit_msgs::msg::At
       }
       else
       {
-        world_->addToObject(name, attached_body->getShapes(), attached_body->getGlobalCollisionBodyTransforms());
-        world_->setSubframesOfObject(name, attached_body->getSubframeTransforms());
+        getWorldNonConst()->addToObject(name, attached_body->getShapes(),
+                                        attached_body->getGlobalCollisionBodyTransforms());
+        getWorldNonConst()->setSubframesOfObject(name, attached_body->getSubframeTransforms());
         RCLCPP_DEBUG(LOGGER, "Detached object '%s' from link '%s' and added it back in the collision world",
                      name.c_str(), object.link_name.c_str());
       }
@@ -1740,8 +1907,8 @@ bool PlanningScene::processCollisionObjectAdd(const moveit_msgs::msg::CollisionO
   }
 
   // replace the object if ADD is specified instead of APPEND
-  if (object.operation == moveit_msgs::msg::CollisionObject::ADD && world_->hasObject(object.id))
-    world_->removeObject(object.id);
+  if (object.operation == moveit_msgs::msg::CollisionObject::ADD && getWorld()->hasObject(object.id))
+    getWorldNonConst()->removeObject(object.id);
 
   const Eigen::Isometry3d& object_frame_transform = getFrameTransform(object.header.frame_id);
 
@@ -1752,7 +1919,7 @@ bool PlanningScene::processCollisionObjectAdd(const moveit_msgs::msg::CollisionO
     {
       Eigen::Isometry3d object_pose;
       PlanningScene::poseMsgToEigen(object.primitive_poses[i], object_pose);
-      world_->addToObject(object.id, shapes::ShapeConstPtr(s), object_frame_transform * object_pose);
+      getWorldNonConst()->addToObject(object.id, shapes::ShapeConstPtr(s), object_frame_transform * object_pose);
     }
   }
   for (std::size_t i = 0; i < object.meshes.size(); ++i)
@@ -1762,7 +1929,7 @@ bool PlanningScene::processCollisionObjectAdd(const moveit_msgs::msg::CollisionO
     {
       Eigen::Isometry3d object_pose;
       PlanningScene::poseMsgToEigen(object.mesh_poses[i], object_pose);
-      world_->addToObject(object.id, shapes::ShapeConstPtr(s), object_frame_transform * object_pose);
+      getWorldNonConst()->addToObject(object.id, shapes::ShapeConstPtr(s), object_frame_transform * object_pose);
     }
   }
   for (std::size_t i = 0; i < object.planes.size(); ++i)
@@ -1772,14 +1939,14 @@ bool PlanningScene::processCollisionObjectAdd(const moveit_msgs::msg::CollisionO
     {
       Eigen::Isometry3d object_pose;
       PlanningScene::poseMsgToEigen(object.plane_poses[i], object_pose);
-      world_->addToObject(object.id, shapes::ShapeConstPtr(s), object_frame_transform * object_pose);
+      getWorldNonConst()->addToObject(object.id, shapes::ShapeConstPtr(s), object_frame_transform * object_pose);
     }
   }
   if (!object.type.key.empty() || !object.type.db.empty())
     setObjectType(object.id, object.type);
 
   // Add subframes to the newly created (or possibly modified) object
-  moveit::core::FixedTransformsMap subframes = world_->getObject(object.id)->subframe_poses_;
+  moveit::core::FixedTransformsMap subframes = getWorld()->getObject(object.id)->subframe_poses_;
   Eigen::Isometry3d frame_pose;
   for (std::size_t i = 0; i < object.subframe_poses.size(); ++i)
   {
@@ -1787,7 +1954,7 @@ bool PlanningScene::processCollisionObjectAdd(const moveit_msgs::msg::CollisionO
     std::string name = object.subframe_names[i];
     subframes[name] = object_frame_transform * frame_pose;
   }
-  world_->setSubframesOfObject(object.id, subframes);
+  getWorldNonConst()->setSubframesOfObject(object.id, subframes);
   return true;
 }
 
@@ -1799,7 +1966,7 @@ bool PlanningScene::processCollisionObjectRemove(const moveit_msgs::msg::Collisi
   }
   else
   {
-    world_->removeObject(object.id);
+    getWorldNonConst()->removeObject(object.id);
     removeObjectColor(object.id);
     removeObjectType(object.id);
   }
@@ -1808,7 +1975,7 @@ bool PlanningScene::processCollisionObjectRemove(const moveit_msgs::msg::Collisi
 
 bool PlanningScene::processCollisionObjectMove(const moveit_msgs::msg::CollisionObject& object)
 {
-  if (world_->hasObject(object.id))
+  if (getWorld()->hasObject(object.id))
   {
     if (!object.primitives.empty() || !object.meshes.empty() || !object.planes.empty())
       RCLCPP_WARN(LOGGER, "Move operation for object '%s' ignores the geometry specified in the message.",
@@ -1835,21 +2002,13 @@ bool PlanningScene::processCollisionObjectMove(const moveit_msgs::msg::Collision
       new_poses.push_back(t * object_pose);
     }
 
-    collision_detection::World::ObjectConstPtr obj = world_->getObject(object.id);
-
-    if (obj->shapes_.size() == new_poses.size())
-    {
-      std::vector<shapes::ShapeConstPtr> shapes = obj->shapes_;
-      obj.reset();
-      world_->removeObject(object.id);
-      world_->addToObject(object.id, shapes, new_poses);
-    }
-    else
+    // moving the shapes in place keeps the change a MOVE_SHAPE, which is published as a pose-only diff
+    if (!getWorldNonConst()->moveShapesInObject(object.id, new_poses))
     {
       RCLCPP_ERROR(LOGGER,
                    "Number of supplied poses (%zu) for object '%s' does not match number of shapes (%zu). "
                    "Not moving.",
-                   new_poses.size(), object.id.c_str(), obj->shapes_.size());
+                   new_poses.size(), object.id.c_str(), getWorld()->getObject(object.id)->shapes_.size());
       return false;
     }
     return true;
@@ -1877,7 +2036,7 @@ const Eigen::Isometry3d& PlanningScene::getFrameTransform(const moveit::core::Ro
 {
   if (!frame_id.empty() && frame_id[0] == '/')
     // Recursively call itself without the slash in front of frame name
-    return getFrameTransform(frame_id.substr(1));
+    return getFrameTransform(state, frame_id.substr(1));
 
   bool frame_found;
   const Eigen::Isometry3d& t1 = state.getFrameTransform(frame_id, &frame_found);
@@ -1898,7 +2057,7 @@ bool PlanningScene::knowsFrameTransform(const std::string& frame_id) const
 bool PlanningScene::knowsFrameTransform(const moveit::core::RobotState& state, const std::string& frame_id) const
 {
   if (!frame_id.empty() && frame_id[0] == '/')
-    return knowsFrameTransform(frame_id.substr(1));
+    return knowsFrameTransform(state, frame_id.substr(1));
 
   if (state.knowsFrameTransform(frame_id))
     return true;
@@ -1907,6 +2066,77 @@ bool PlanningScene::knowsFrameTransform(const moveit::core::RobotState& state, c
   return getTransforms().Transforms::canTransform(frame_id);
 }
 
+FrameHandle PlanningScene::resolveFrame(const moveit::core::RobotState& state, const std::string& frame_id) const
+{
+  FrameHandle handle;
+  handle.id = !frame_id.empty() && frame_id[0] == '/' ? frame_id.substr(1) : frame_id;
+  handle.world_generation = getWorld()->getGeneration();
+  handle.transforms_generation = getTransforms().getGeneration();
+
+  // same order as getFrameTransform(): robot state, world, fixed transforms
+  bool found;
+  if (handle.id == getRobotModel()->getModelFrame())
+    handle.type = FrameHandle::MODEL_FRAME;
+  else if ((handle.link = getRobotModel()->getLinkModel(handle.id, &found)))
+    handle.type = FrameHandle::ROBOT_LINK;
+  else if (state.knowsFrameTransform(handle.id))
+    handle.type = FrameHandle::ATTACHED_BODY;
+  else
+  {
+    const Eigen::Isometry3d& t = getWorld()->getTransform(handle.id, found);
+    if (found)
+    {
+      handle.type = FrameHandle::WORLD_OBJECT;
+      handle.transform = &t;
+    }
+    else if (getTransforms().Transforms::canTransform(handle.id))
+    {
+      handle.type = FrameHandle::FIXED_FRAME;
+      handle.transform = &getTransforms().Transforms::getTransform(handle.id);
+    }
+  }
+  return handle;
+}
+
+bool PlanningScene::isFrameHandleValid(const FrameHandle& handle) const
+{
+  switch (handle.type)
+  {
+    case FrameHandle::MODEL_FRAME:
+    case FrameHandle::ROBOT_LINK:
+    case FrameHandle::ATTACHED_BODY:
+      return true;
+    case FrameHandle::WORLD_OBJECT:
+    case FrameHandle::FIXED_FRAME:
+      return handle.world_generation == getWorld()->getGeneration() &&
+             handle.transforms_generation == getTransforms().getGeneration();
+    default:
+      return false;
+  }
+}
+
+const Eigen::Isometry3d& PlanningScene::getFrameTransform(const moveit::core::RobotState& state,
+                                                          const FrameHandle& handle) const
+{
+  static const Eigen::Isometry3d IDENTITY_TRANSFORM = Eigen::Isometry3d::Identity();
+  switch (handle.type)
+  {
+    case FrameHandle::MODEL_FRAME:
+      return IDENTITY_TRANSFORM;
+    case FrameHandle::ROBOT_LINK:
+      return state.getGlobalLinkTransform(handle.link);
+    case FrameHandle::WORLD_OBJECT:
+    case FrameHandle::FIXED_FRAME:
+      if (isFrameHandleValid(handle))
+        return *handle.transform;
+      break;
+    default:
+      break;
+  }
+  // attached bodies belong to the state, all others are resolved again
+  return getFrameTransform(state, handle.id);
+}
+
 bool PlanningScene::hasObjectType(const std::string& object_id) const
 {
   if (object_types_)
@@ -2032,6 +2262,17 @@ bool PlanningScene::isStateColliding(const moveit::core::RobotState& state, cons
   return res.collision;
 }
 
+bool PlanningScene::isMotionColliding(const moveit::core::RobotState& from, const moveit::core::RobotState& to,
+                                      const std::string& group, bool verbose) const
+{
+  collision_detection::CollisionRequest req;
+  req.verbose = verbose;
+  req.group_name = group;
+  collision_detection::CollisionResult res;
+  getCollisionEnv()->checkRobotCollision(req, res, from, to, getAllowedCollisionMatrix());
+  return res.collision;
+}
+
 bool PlanningScene::isStateFeasible(const moveit_msgs::msg::RobotState& state, bool verbose) const
 {
   if (state_feasibility_)
@@ -2166,6 +2407,39 @@ bool PlanningScene::isPathValid(const moveit_msgs::msg::RobotState& start_state,
   return isPathValid(t, path_constraints, goal_constraints, group, verbose, invalid_index);
 }
 
+// Evaluates the path constraints on all waypoints at once, if the waypoints only differ in the variables of the
+// trajectory group. Returns false if the waypoints have to be evaluated one by one.
+static bool decidePathConstraints(const kinematic_constraints::KinematicConstraintSet& ks_p,
+                                  const robot_trajectory::RobotTrajectory& trajectory,
+                                  std::vector<kinematic_constraints::ConstraintEvaluationResult>& results)
+{
+  const moveit::core::JointModelGroup* jmg = trajectory.getGroup();
+  const std::size_t n_wp = trajectory.getWayPointCount();
+  if (!jmg || n_wp < 2)
+    return false;
+
+  const std::vector<int>& variable_index_list = jmg->getVariableIndexList();
+  std::vector<bool> group_variable(trajectory.getRobotModel()->getVariableCount(), false);
+  for (int index : variable_index_list)
+    group_variable[index] = true;
+
+  moveit::core::RobotState state(trajectory.getWayPoint(0));
+  const double* first_positions = state.getVariablePositions();
+  std::vector<double> group_positions;
+  group_positions.reserve(n_wp * variable_index_list.size());
+  for (std::size_t i = 0; i < n_wp; ++i)
+  {
+    const double* positions = trajectory.getWayPoint(i).getVariablePositions();
+    for (std::size_t v = 0; v < group_variable.size(); ++v)
+      if (!group_variable[v] && positions[v] != first_positions[v])
+        return false;
+    for (int index : variable_index_list)
+      group_positions.push_back(positions[index]);
+  }
+  ks_p.decideBatch(state, jmg, group_positions.data(), n_wp, results);
+  return true;
+}
+
 bool PlanningScene::isPathValid(const robot_trajectory::RobotTrajectory& trajectory,
                                 const moveit_msgs::msg::Constraints& path_constraints,
                                 const std::vector<moveit_msgs::msg::Constraints>& goal_constraints,
@@ -2177,6 +2451,10 @@ bool PlanningScene::isPathValid(const robot_trajectory::RobotTrajectory& traject
   kinematic_constraints::KinematicConstraintSet ks_p(getRobotModel());
   ks_p.add(path_constraints, getTransforms());
   std::size_t n_wp = trajectory.getWayPointCount();
+
+  // verbose output is only available from the individual evaluation of each waypoint
+  std::vector<kinematic_constraints::ConstraintEvaluationResult> path_results;
+  const bool batch = !ks_p.empty() && !verbose && decidePathConstraints(ks_p, trajectory, path_results);
   for (std::size_t i = 0; i < n_wp; ++i)
   {
     const moveit::core::RobotState& st = trajectory.getWayPoint(i);
@@ -2186,7 +2464,11 @@ bool PlanningScene::isPathValid(const robot_trajectory::RobotTrajectory& traject
       this_state_valid = false;
     if (!isStateFeasible(st, verbose))
       this_state_valid = false;
-    if (!ks_p.empty() && !ks_p.decide(st, verbose).satisfied)
+    if (!ks_p.empty() && !(batch ? path_results[i].satisfied : ks_p.decide(st, verbose).satisfied))
+      this_state_valid = false;
+    // the motion to this waypoint counts with the waypoint
+    if (continuous_path_collision_checking_ && i > 0 &&
+        isMotionColliding(trajectory.getWayPoint(i - 1), st, group, verbose))
       this_state_valid = false;
 
     if (!this_state_valid)
@@ -2223,6 +2505,97 @@ bool PlanningScene::isPathValid(const robot_trajectory::RobotTrajectory& traject
   return result;
 }
 
+bool PlanningScene::isPathValidParallel(const robot_trajectory::RobotTrajectory& trajectory,
+                                        const moveit_msgs::msg::Constraints& path_constraints,
+                                        const std::vector<moveit_msgs::msg::Constraints>& goal_constraints,
+                                        unsigned int thread_count, const std::string& group, bool verbose,
+                                        std::vector<std::size_t>* invalid_index) const
+{
+  const std::size_t n_wp = trajectory.getWayPointCount();
+  if (thread_count == 0)
+    thread_count = std::max(1u, std::thread::hardware_concurrency());
+  const std::size_t chunk_count = (n_wp + PATH_VALIDITY_CHUNK_SIZE - 1) / PATH_VALIDITY_CHUNK_SIZE;
+  if (thread_count > chunk_count)
+    thread_count = chunk_count;
+  if (thread_count <= 1)
+    return isPathValid(trajectory, path_constraints, goal_constraints, group, verbose, invalid_index);
+
+  if (invalid_index)
+    invalid_index->clear();
+  kinematic_constraints::KinematicConstraintSet ks_p(getRobotModel());
+  ks_p.add(path_constraints, getTransforms());
+  std::vector<kinematic_constraints::ConstraintEvaluationResult> path_results;
+  const bool batch = !ks_p.empty() && !verbose && decidePathConstraints(ks_p, trajectory, path_results);
+
+  // threads pick the next unprocessed chunk, so expensive parts of the path are balanced automatically
+  std::atomic<std::size_t> next_chunk(0);
+  std::atomic<bool> invalid_found(false);
+  std::vector<std::vector<std::size_t>> thread_invalid(thread_count);
+  auto check_waypoints = [&](std::vector<std::size_t>& invalid) {
+    for (std::size_t chunk = next_chunk++; chunk < chunk_count; chunk = next_chunk++)
+    {
+      const std::size_t end = std::min(n_wp, (chunk + 1) * PATH_VALIDITY_CHUNK_SIZE);
+      for (std::size_t i = chunk * PATH_VALIDITY_CHUNK_SIZE; i < end; ++i)
+      {
+        if (!invalid_index && invalid_found)
+          return;
+
+        const moveit::core::RobotState& st = trajectory.getWayPoint(i);
+        if (isStateColliding(st, group, verbose) || !isStateFeasible(st, verbose) ||
+            (!ks_p.empty() && !(batch ? path_results[i].satisfied : ks_p.decide(st, verbose).satisfied)) ||
+            (continuous_path_collision_checking_ && i > 0 &&
+             isMotionColliding(trajectory.getWayPoint(i - 1), st, group, verbose)))
+        {
+          invalid.push_back(i);
+          invalid_found = true;
+        }
+      }
+    }
+  };
+
+  std::vector<std::thread> threads;
+  threads.reserve(thread_count - 1);
+  for (unsigned int t = 1; t < thread_count; ++t)
+    threads.emplace_back(check_waypoints, std::ref(thread_invalid[t]));
+  check_waypoints(thread_invalid[0]);
+  for (std::thread& thread : threads)
+    thread.join();
+
+  bool result = !invalid_found;
+  if (!result && !invalid_index)
+    return false;
+  if (invalid_index)
+  {
+    for (const std::vector<std::size_t>& invalid : thread_invalid)
+      invalid_index->insert(invalid_index->end(), invalid.begin(), invalid.end());
+    std::sort(invalid_index->begin(), invalid_index->end());
+  }
+
+  // check goal for last state
+  if (!goal_constraints.empty())
+  {
+    const moveit::core::RobotState& st = trajectory.getLastWayPoint();
+    bool found = false;
+    for (const moveit_msgs::msg::Constraints& goal_constraint : goal_constraints)
+    {
+      if (isStateConstrained(st, goal_constraint))
+      {
+        found = true;
+        break;
+      }
+    }
+    if (!found)
+    {
+      if (verbose)
+        RCLCPP_INFO(LOGGER, "Goal not satisfied");
+      if (invalid_index)
+        invalid_index->push_back(n_wp - 1);
+      result = false;
+    }
+  }
+  return result;
+}
+
 bool PlanningScene::isPathValid(const robot_trajectory::RobotTrajectory& trajectory,
                                 const moveit_msgs::msg::Constraints& path_constraints,
                                 const moveit_msgs::msg::Constraints& goal_constraints, const std::string& group,
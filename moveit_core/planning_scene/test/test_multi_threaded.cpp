@@ -38,6 +38,7 @@
 #include <moveit/robot_state/robot_state.h>
 #include <moveit/utils/robot_model_test_utils.h>
 #include <moveit/planning_scene/planning_scene.h>
+#include <moveit/robot_trajectory/robot_trajectory.h>
 #include <gtest/gtest.h>
 #include <thread>
 
@@ -124,6 +125,33 @@ TEST_F(CollisionDetectorThreadedTest, FCLThreaded)
   }
 }
 
+/** \brief The parallel path validation has to report the same invalid waypoints as the sequential one. */
+TEST_F(CollisionDetectorThreadedTest, ParallelPathValidity)
+{
+  robot_trajectory::RobotTrajectory trajectory(robot_model_, "panda_arm");
+  moveit::core::RobotState state(robot_model_);
+  for (unsigned int i = 0; i < 500; ++i)
+  {
+    state.setToRandomPositions();
+    state.update();
+    trajectory.addSuffixWayPoint(state, 0.1);
+  }
+
+  moveit_msgs::msg::Constraints path_constraints;
+  std::vector<moveit_msgs::msg::Constraints> goal_constraints;
+  std::vector<std::size_t> sequential_invalid, parallel_invalid;
+  bool sequential_valid =
+      planning_scene_->isPathValid(trajectory, path_constraints, goal_constraints, "", false, &sequential_invalid);
+  bool parallel_valid = planning_scene_->isPathValidParallel(trajectory, path_constraints, goal_constraints, THREADS,
+                                                             "", false, &parallel_invalid);
+  EXPECT_EQ(sequential_valid, parallel_valid);
+  EXPECT_EQ(sequential_invalid, parallel_invalid);
+
+  // without the invalid waypoint list the parallel check may stop early, but has to agree on the result
+  EXPECT_EQ(sequential_valid,
+            planning_scene_->isPathValidParallel(trajectory, path_constraints, goal_constraints, THREADS));
+}
+
 int main(int argc, char** argv)
 {
   ::testing::InitGoogleTest(&argc, argv);
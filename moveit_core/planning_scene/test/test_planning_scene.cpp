@@ -118,6 +118,152 @@ TEST(PlanningScene, LoadRestoreDiff)
   EXPECT_EQ(ps->getCollisionEnvUnpadded()->getWorld()->size(), 2u);
 }
 
+TEST(PlanningScene, DiffSharesCollisionEnv)
+{
+  urdf::ModelInterfaceSharedPtr urdf_model = moveit::core::loadModelInterface("pr2");
+  srdf::ModelSharedPtr srdf_model(new srdf::Model());
+  auto ps = std::make_shared<planning_scene::PlanningScene>(urdf_model, srdf_model);
+  Eigen::Isometry3d id = Eigen::Isometry3d::Identity();
+  ps->getWorldNonConst()->addToObject("sphere", shapes::ShapeConstPtr(new shapes::Sphere(0.4)), id);
+
+  /* an unmodified diff uses the parent's collision environments */
+  planning_scene::PlanningScenePtr next = ps->diff();
+  EXPECT_EQ(next->getCollisionEnv(), ps->getCollisionEnv());
+  EXPECT_EQ(next->getCollisionEnvUnpadded(), ps->getCollisionEnvUnpadded());
+
+  /* modifying the world of the diff allocates its own environments, which include the modification */
+  next->getWorldNonConst()->addToObject("box", shapes::ShapeConstPtr(new shapes::Box(0.1, 0.1, 0.1)), id);
+  EXPECT_NE(next->getCollisionEnv(), ps->getCollisionEnv());
+  EXPECT_EQ(next->getCollisionEnv()->getWorld()->size(), 2u);
+  EXPECT_EQ(ps->getCollisionEnv()->getWorld()->size(), 1u);
+
+  /* a diff of the diff again shares the environments until it is modified */
+  planning_scene::PlanningScenePtr next2 = next->diff();
+  EXPECT_EQ(next2->getCollisionEnv(), next->getCollisionEnv());
+  next2->getCollisionEnvNonConst()->setLinkPadding("r_wrist_roll_link", 0.1);
+  EXPECT_NE(next2->getCollisionEnv(), next->getCollisionEnv());
+  EXPECT_EQ(next2->getCollisionEnv()->getWorld()->size(), 2u);
+}
+
+TEST(PlanningScene, MovedObjectDiffMsg)
+{
+  urdf::ModelInterfaceSharedPtr urdf_model = moveit::core::loadModelInterface("pr2");
+  srdf::ModelSharedPtr srdf_model(new srdf::Model());
+  auto ps = std::make_shared<planning_scene::PlanningScene>(urdf_model, srdf_model);
+
+  moveit_msgs::msg::CollisionObject co;
+  co.header.frame_id = ps->getPlanningFrame();
+  co.id = "box";
+  co.operation = moveit_msgs::msg::CollisionObject::ADD;
+  co.primitives.resize(1);
+  co.primitives[0].type = shape_msgs::msg::SolidPrimitive::BOX;
+  co.primitives[0].dimensions = { 0.1, 0.1, 0.1 };
+  co.primitive_poses.resize(1);
+  co.primitive_poses[0].orientation.w = 1.0;
+  EXPECT_TRUE(ps->processCollisionObjectMsg(co));
+
+  /* moving the object in a diff only publishes its new pose */
+  planning_scene::PlanningScenePtr next = ps->diff();
+  co.operation = moveit_msgs::msg::CollisionObject::MOVE;
+  co.primitives.clear();
+  co.primitive_poses[0].position.x = 1.0;
+  EXPECT_TRUE(next->processCollisionObjectMsg(co));
+
+  moveit_msgs::msg::PlanningScene diff_msg;
+  next->getPlanningSceneDiffMsg(diff_msg);
+  ASSERT_EQ(diff_msg.world.collision_objects.size(), 1u);
+  EXPECT_EQ(diff_msg.world.collision_objects[0].operation, moveit_msgs::msg::CollisionObject::MOVE);
+  EXPECT_TRUE(diff_msg.world.collision_objects[0].primitives.empty());
+  ASSERT_EQ(diff_msg.world.collision_objects[0].primitive_poses.size(), 1u);
+
+  /* applying the diff to the parent moves the object there as well */
+  ps->setPlanningSceneDiffMsg(diff_msg);
+  EXPECT_NEAR(ps->getWorld()->getObject("box")->shape_poses_[0].translation().x(), 1.0, 1e-9);
+}
+
+TEST(PlanningScene, FrameHandles)
+{
+  urdf::ModelInterfaceSharedPtr urdf_model = moveit::core::loadModelInterface("pr2");
+  srdf::ModelSharedPtr srdf_model(new srdf::Model());
+  auto ps = std::make_shared<planning_scene::PlanningScene>(urdf_model, srdf_model);
+
+  moveit_msgs::msg::CollisionObject co;
+  co.header.frame_id = ps->getPlanningFrame();
+  co.id = "box";
+  co.operation = moveit_msgs::msg::CollisionObject::ADD;
+  co.primitives.resize(1);
+  co.primitives[0].type = shape_msgs::msg::SolidPrimitive::BOX;
+  co.primitives[0].dimensions = { 0.1, 0.1, 0.1 };
+  co.primitive_poses.resize(1);
+  co.primitive_poses[0].orientation.w = 1.0;
+  EXPECT_TRUE(ps->processCollisionObjectMsg(co));
+
+  Eigen::Isometry3d fixed = Eigen::Isometry3d::Identity();
+  fixed.translation().z() = 2.0;
+  ps->getTransformsNonConst().setTransform(fixed, "fixed");
+
+  const std::string link = "r_wrist_roll_link";
+  planning_scene::FrameHandle link_handle = ps->resolveFrame(link);
+  EXPECT_EQ(link_handle.type, planning_scene::FrameHandle::ROBOT_LINK);
+  EXPECT_TRUE(ps->getFrameTransform(link_handle).isApprox(ps->getFrameTransform(link)));
+
+  planning_scene::FrameHandle box_handle = ps->resolveFrame("/box");
+  EXPECT_EQ(box_handle.type, planning_scene::FrameHandle::WORLD_OBJECT);
+  EXPECT_TRUE(ps->isFrameHandleValid(box_handle));
+  EXPECT_EQ(&ps->getFrameTransform(box_handle), &ps->getFrameTransform("box"));
+
+  planning_scene::FrameHandle fixed_handle = ps->resolveFrame("fixed");
+  EXPECT_EQ(fixed_handle.type, planning_scene::FrameHandle::FIXED_FRAME);
+  EXPECT_TRUE(ps->getFrameTransform(fixed_handle).isApprox(fixed));
+
+  planning_scene::FrameHandle unknown_handle = ps->resolveFrame("unknown");
+  EXPECT_EQ(unknown_handle.type, planning_scene::FrameHandle::UNKNOWN);
+  EXPECT_FALSE(ps->isFrameHandleValid(unknown_handle));
+
+  /* moving the object invalidates its handle, which is then resolved by name */
+  co.operation = moveit_msgs::msg::CollisionObject::MOVE;
+  co.primitives.clear();
+  co.primitive_poses[0].position.x = 1.0;
+  EXPECT_TRUE(ps->processCollisionObjectMsg(co));
+  EXPECT_FALSE(ps->isFrameHandleValid(box_handle));
+  EXPECT_NEAR(ps->getFrameTransform(box_handle).translation().x(), 1.0, 1e-9);
+  EXPECT_TRUE(ps->getFrameTransform(fixed_handle).isApprox(fixed));
+  EXPECT_TRUE(ps->isFrameHandleValid(link_handle));
+}
+
+TEST(PlanningScene, DiffFollowsParentWorld)
+{
+  urdf::ModelInterfaceSharedPtr urdf_model = moveit::core::loadModelInterface("pr2");
+  srdf::ModelSharedPtr srdf_model(new srdf::Model());
+  auto ps = std::make_shared<planning_scene::PlanningScene>(urdf_model, srdf_model);
+  Eigen::Isometry3d id = Eigen::Isometry3d::Identity();
+  planning_scene::PlanningScenePtr next = ps->diff();
+
+  /* the parent changes after the diff was made: the diff's world and collision checks both follow it */
+  ps->getWorldNonConst()->addToObject("box", shapes::ShapeConstPtr(new shapes::Box(2.0, 2.0, 2.0)), id);
+  EXPECT_TRUE(next->getWorld()->hasObject("box"));
+  EXPECT_EQ(next->getCollisionEnv()->getWorld()->size(), next->getWorld()->size());
+  collision_detection::CollisionRequest req;
+  collision_detection::CollisionResult res;
+  next->getCollisionEnv()->checkRobotCollision(req, res, next->getCurrentState(), next->getAllowedCollisionMatrix());
+  EXPECT_TRUE(res.collision);
+
+  /* once the diff modifies its world, it keeps its own copy */
+  next->getWorldNonConst()->removeObject("box");
+  ps->getWorldNonConst()->addToObject("sphere", shapes::ShapeConstPtr(new shapes::Sphere(0.4)), id);
+  EXPECT_FALSE(next->getWorld()->hasObject("sphere"));
+  EXPECT_EQ(next->getWorld()->size(), 0u);
+  EXPECT_EQ(next->getCollisionEnv()->getWorld()->size(), 0u);
+  res.clear();
+  next->getCollisionEnv()->checkRobotCollision(req, res, next->getCurrentState(), next->getAllowedCollisionMatrix());
+  EXPECT_FALSE(res.collision);
+
+  /* clearing the diffs returns to the parent's world */
+  next->clearDiffs();
+  EXPECT_EQ(next->getWorld(), ps->getWorld());
+  EXPECT_EQ(next->getCollisionEnv(), ps->getCollisionEnv());
+}
+
 TEST(PlanningScene, MakeAttachedDiff)
 {
   urdf::ModelInterfaceSharedPtr urdf_model = moveit::core::loadModelInterface("pr2");
@@ -160,6 +306,44 @@ TEST(PlanningScene, isStateValid)
   }
 }
 
+TEST(PlanningScene, ContinuousPathCollisionChecking)
+{
+  // a box sliding along x
+  moveit::core::RobotModelBuilder builder("slider", "base");
+  geometry_msgs::msg::Pose origin;
+  origin.orientation.w = 1.0;
+  builder.addChain("base->slide", "prismatic", { origin });
+  builder.addCollisionBox("slide", { 0.1, 0.1, 0.1 }, origin);
+  builder.addGroupChain("base", "slide", "slider");
+  ASSERT_TRUE(builder.isValid());
+  moveit::core::RobotModelPtr robot_model = builder.build();
+  auto ps = std::make_shared<planning_scene::PlanningScene>(robot_model);
+
+  // a thin wall between the two waypoints, which are both collision free
+  Eigen::Isometry3d id = Eigen::Isometry3d::Identity();
+  ps->getWorldNonConst()->addToObject("wall", shapes::ShapeConstPtr(new shapes::Box(0.02, 1.0, 1.0)), id);
+  robot_trajectory::RobotTrajectory trajectory(robot_model, "slider");
+  moveit::core::RobotState state(robot_model);
+  for (double position : { -1.0, 1.0 })
+  {
+    state.setVariablePosition("base-slide-joint", position);
+    state.update();
+    EXPECT_FALSE(ps->isStateColliding(state));
+    trajectory.addSuffixWayPoint(state, 1.0);
+  }
+  EXPECT_TRUE(ps->isPathValid(trajectory));
+
+  ps->setContinuousPathCollisionChecking(true);
+  EXPECT_TRUE(ps->isMotionColliding(trajectory.getWayPoint(0), trajectory.getWayPoint(1)));
+  std::vector<std::size_t> invalid_index;
+  EXPECT_FALSE(ps->isPathValid(trajectory, "", false, &invalid_index));
+  ASSERT_EQ(invalid_index.size(), 1u);
+  EXPECT_EQ(invalid_index[0], 1u);
+
+  // diff scenes check continuously as well
+  EXPECT_FALSE(ps->diff()->isPathValid(trajectory));
+}
+
 TEST(PlanningScene, loadGoodSceneGeometry)
 {
   moveit::core::RobotModelPtr robot_model = moveit::core::loadTestingRobotModel("pr2");
@@ -0,0 +1,158 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, PickNik LLC
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik LLC nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#pragma once
+
+/** The MOVEIT_ENABLE_TRACING macro can be set externally to 0 to compile all trace points out. Tracing is enabled
+    by default, as it is cheap enough to be always on. */
+#ifndef MOVEIT_ENABLE_TRACING
+#define MOVEIT_ENABLE_TRACING 1
+#endif
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+namespace moveit
+{
+namespace tools
+{
+namespace tracing
+{
+/** \brief The number of latency histogram buckets. Bucket i counts the durations in [2^i, 2^(i+1)) nanoseconds,
+    the last one all longer durations */
+static const std::size_t HISTOGRAM_SIZE = 40;
+
+/** \brief The number of events kept per thread for writeChromeTrace(). Older events are overwritten. */
+static const std::size_t THREAD_BUFFER_SIZE = 4096;
+
+/** \brief The maximum number of trace points with latency statistics */
+static const std::size_t MAX_TRACE_POINTS = 128;
+
+/** \brief Get the current time of the trace clock, in nanoseconds */
+inline std::int64_t now()
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+/** \brief A named point in the code whose durations are traced.
+
+    Trace points are static objects defined by MOVEIT_TRACE_SCOPE(), whose name must be a string literal. Each
+    thread records the durations in its own buffers without locking: a ring buffer of the last events and a
+    latency histogram per trace point. */
+class TracePoint
+{
+public:
+  /** \brief Register the trace point \e name, which must outlive the trace point */
+  explicit TracePoint(const char* name);
+
+  TracePoint(const TracePoint&) = delete;
+  TracePoint& operator=(const TracePoint&) = delete;
+
+  const char* getName() const
+  {
+    return name_;
+  }
+
+  /** \brief Record an event of the calling thread, from the trace clock time \e start to \e end */
+  void record(std::int64_t start, std::int64_t end) const;
+
+private:
+  const char* name_;
+  std::size_t index_;  // index of the latency statistics, MAX_TRACE_POINTS if there are too many trace points
+};
+
+/** \brief Records the time from its construction to its destruction as an event of a trace point */
+class ScopedTrace
+{
+public:
+  explicit ScopedTrace(const TracePoint& point) : point_(point), start_(now())
+  {
+  }
+
+  ~ScopedTrace()
+  {
+    point_.record(start_, now());
+  }
+
+  ScopedTrace(const ScopedTrace&) = delete;
+  ScopedTrace& operator=(const ScopedTrace&) = delete;
+
+private:
+  const TracePoint& point_;
+  std::int64_t start_;
+};
+
+/** \brief The latency statistics of a trace point, summed over all threads */
+struct LatencyStatistics
+{
+  std::string name;
+  std::uint64_t count;
+  double total_time;  // seconds
+  std::array<std::uint64_t, HISTOGRAM_SIZE> histogram;
+};
+
+/** \brief Get the latency statistics of all trace points that recorded events */
+std::vector<LatencyStatistics> getLatencyStatistics();
+
+/** \brief Print the number of events, the mean and the percentiles of the duration of all trace points */
+void printLatencyStatistics(std::ostream& out);
+
+/** \brief Write the last events of all threads in the Chrome trace event format, which can be loaded in
+    chrome://tracing or Perfetto. Events that threads overwrite while they are written are left out. */
+void writeChromeTrace(std::ostream& out);
+}  // namespace tracing
+}  // namespace tools
+}  // namespace moveit
+
+#if MOVEIT_ENABLE_TRACING
+
+#define MOVEIT_TRACE_CONCAT_IMPL(a, b) a##b
+#define MOVEIT_TRACE_CONCAT(a, b) MOVEIT_TRACE_CONCAT_IMPL(a, b)
+
+/** \brief Trace the time until the end of the enclosing scope, as an event of the trace point \e name */
+#define MOVEIT_TRACE_SCOPE(name)                                                                                       \
+  static const moveit::tools::tracing::TracePoint MOVEIT_TRACE_CONCAT(moveit_trace_point_, __LINE__)(name);           \
+  const moveit::tools::tracing::ScopedTrace MOVEIT_TRACE_CONCAT(moveit_trace_scope_, __LINE__)(                        \
+      MOVEIT_TRACE_CONCAT(moveit_trace_point_, __LINE__))
+
+#else
+
+#define MOVEIT_TRACE_SCOPE(name)
+
+#endif
@@ -0,0 +1,267 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, PickNik LLC
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik LLC nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include <moveit/profiler/tracing.h>
+
+#include <atomic>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <ostream>
+
+namespace moveit
+{
+namespace tools
+{
+namespace tracing
+{
+namespace
+{
+// An event in the ring buffer of a thread, guarded by a sequence lock: the sequence number is 2 * n + 2 once the
+// event number n is written, and odd while it is written
+struct Event
+{
+  std::atomic<std::uint64_t> sequence{ 0 };
+  std::atomic<const TracePoint*> point{ nullptr };
+  std::atomic<std::int64_t> start{ 0 };
+  std::atomic<std::int64_t> end{ 0 };
+};
+
+struct Statistics
+{
+  std::atomic<std::uint64_t> count{ 0 };
+  std::atomic<std::int64_t> total_time{ 0 };  // nanoseconds
+  std::array<std::atomic<std::uint64_t>, HISTOGRAM_SIZE> histogram{};
+};
+
+// The buffers of a thread. Only the thread writes them, all others may read them.
+struct ThreadBuffer
+{
+  std::size_t thread_id;
+  std::atomic<std::uint64_t> event_count{ 0 };
+  std::array<Event, THREAD_BUFFER_SIZE> events;
+  std::array<Statistics, MAX_TRACE_POINTS> statistics;
+};
+
+struct Registry
+{
+  std::mutex mutex;
+  std::vector<const TracePoint*> points;
+  std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+  std::vector<ThreadBuffer*> free_buffers;  // buffers of exited threads
+};
+
+// The registry is never destroyed, as threads may still record events during the static destruction
+Registry& getRegistry()
+{
+  static Registry* registry = new Registry();
+  return *registry;
+}
+
+// Hands the buffer of an exiting thread over to the next new thread, which continues its events. This bounds
+// the number of buffers by the number of threads that run at the same time, e.g. planner threads.
+struct ThreadBufferHolder
+{
+  ThreadBuffer* buffer = nullptr;
+
+  ~ThreadBufferHolder()
+  {
+    if (buffer)
+    {
+      Registry& registry = getRegistry();
+      std::scoped_lock lock(registry.mutex);
+      registry.free_buffers.push_back(buffer);
+    }
+  }
+};
+
+ThreadBuffer& getThreadBuffer()
+{
+  thread_local ThreadBufferHolder holder;
+  if (!holder.buffer)
+  {
+    Registry& registry = getRegistry();
+    std::scoped_lock lock(registry.mutex);
+    if (registry.free_buffers.empty())
+    {
+      registry.buffers.push_back(std::make_unique<ThreadBuffer>());
+      registry.buffers.back()->thread_id = registry.buffers.size();
+      holder.buffer = registry.buffers.back().get();
+    }
+    else
+    {
+      holder.buffer = registry.free_buffers.back();
+      registry.free_buffers.pop_back();
+    }
+  }
+  return *holder.buffer;
+}
+
+// Adds to a counter that only the calling thread writes, which needs no atomic read-modify-write
+template <typename T>
+void add(std::atomic<T>& counter, T value)
+{
+  counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+}
+
+// The upper bound of the durations in a histogram bucket, in microseconds
+double getBucketLimit(std::size_t bucket)
+{
+  return static_cast<double>(std::uint64_t(1) << (bucket + 1)) * 1e-3;
+}
+
+// The upper bound of the durations of a fraction of the events, in microseconds
+double getPercentile(const LatencyStatistics& statistics, double fraction)
+{
+  std::uint64_t count = 0;
+  for (std::size_t i = 0; i < HISTOGRAM_SIZE; ++i)
+  {
+    count += statistics.histogram[i];
+    if (count >= fraction * statistics.count)
+      return getBucketLimit(i);
+  }
+  return getBucketLimit(HISTOGRAM_SIZE - 1);
+}
+}  // namespace
+
+TracePoint::TracePoint(const char* name) : name_(name)
+{
+  Registry& registry = getRegistry();
+  std::scoped_lock lock(registry.mutex);
+  index_ = registry.points.size();
+  if (index_ < MAX_TRACE_POINTS)
+    registry.points.push_back(this);
+}
+
+void TracePoint::record(std::int64_t start, std::int64_t end) const
+{
+  ThreadBuffer& buffer = getThreadBuffer();
+
+  const std::uint64_t event_number = buffer.event_count.load(std::memory_order_relaxed);
+  Event& event = buffer.events[event_number % THREAD_BUFFER_SIZE];
+  event.sequence.store(2 * event_number + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  event.point.store(this, std::memory_order_relaxed);
+  event.start.store(start, std::memory_order_relaxed);
+  event.end.store(end, std::memory_order_relaxed);
+  event.sequence.store(2 * event_number + 2, std::memory_order_release);
+  buffer.event_count.store(event_number + 1, std::memory_order_release);
+
+  if (index_ < MAX_TRACE_POINTS)
+  {
+    Statistics& statistics = buffer.statistics[index_];
+    const std::int64_t duration = end - start;
+    std::size_t bucket = 0;
+    while (bucket + 1 < HISTOGRAM_SIZE && (duration >> (bucket + 1)) > 0)
+      ++bucket;
+    add(statistics.count, std::uint64_t(1));
+    add(statistics.total_time, duration);
+    add(statistics.histogram[bucket], std::uint64_t(1));
+  }
+}
+
+std::vector<LatencyStatistics> getLatencyStatistics()
+{
+  Registry& registry = getRegistry();
+  std::scoped_lock lock(registry.mutex);
+  std::vector<LatencyStatistics> result;
+  for (std::size_t i = 0; i < registry.points.size(); ++i)
+  {
+    LatencyStatistics statistics;
+    statistics.name = registry.points[i]->getName();
+    statistics.count = 0;
+    statistics.histogram.fill(0);
+    std::int64_t total_time = 0;
+    for (const std::unique_ptr<ThreadBuffer>& buffer : registry.buffers)
+    {
+      const Statistics& thread_statistics = buffer->statistics[i];
+      statistics.count += thread_statistics.count.load(std::memory_order_relaxed);
+      total_time += thread_statistics.total_time.load(std::memory_order_relaxed);
+      for (std::size_t j = 0; j < HISTOGRAM_SIZE; ++j)
+        statistics.histogram[j] += thread_statistics.histogram[j].load(std::memory_order_relaxed);
+    }
+    statistics.total_time = total_time * 1e-9;
+    if (statistics.count > 0)
+      result.push_back(statistics);
+  }
+  return result;
+}
+
+void printLatencyStatistics(std::ostream& out)
+{
+  for (const LatencyStatistics& statistics : getLatencyStatistics())
+    out << statistics.name << ": " << statistics.count << " events, total " << statistics.total_time << " s, mean "
+        << statistics.total_time * 1e6 / statistics.count << " us, 50% < " << getPercentile(statistics, 0.5)
+        << " us, 90% < " << getPercentile(statistics, 0.9) << " us, 99% < " << getPercentile(statistics, 0.99)
+        << " us" << std::endl;
+}
+
+void writeChromeTrace(std::ostream& out)
+{
+  Registry& registry = getRegistry();
+  std::scoped_lock lock(registry.mutex);
+
+  out << "{\"traceEvents\":[";
+  bool first = true;
+  const std::ios::fmtflags flags = out.flags();
+  const std::streamsize precision = out.precision();
+  out << std::fixed << std::setprecision(3);
+  for (const std::unique_ptr<ThreadBuffer>& buffer : registry.buffers)
+  {
+    const std::uint64_t event_count = buffer->event_count.load(std::memory_order_acquire);
+    for (std::uint64_t i = event_count > THREAD_BUFFER_SIZE ? event_count - THREAD_BUFFER_SIZE : 0; i < event_count;
+         ++i)
+    {
+      const Event& event = buffer->events[i % THREAD_BUFFER_SIZE];
+      const std::uint64_t sequence = event.sequence.load(std::memory_order_acquire);
+      const TracePoint* point = event.point.load(std::memory_order_relaxed);
+      const std::int64_t start = event.start.load(std::memory_order_relaxed);
+      const std::int64_t end = event.end.load(std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_acquire);
+      // skip the events that were overwritten meanwhile
+      if (sequence != 2 * i + 2 || event.sequence.load(std::memory_order_relaxed) != sequence)
+        continue;
+
+      out << (first ? "" : ",") << "\n{\"name\":\"" << point->getName() << "\",\"ph\":\"X\",\"ts\":" << start * 1e-3
+          << ",\"dur\":" << (end - start) * 1e-3 << ",\"pid\":1,\"tid\":" << buffer->thread_id << "}";
+      first = false;
+    }
+  }
+  out << "\n]}" << std::endl;
+  out.flags(flags);
+  out.precision(precision);
+}
+}  // namespace tracing
+}  // namespace tools
+}  // namespace moveit
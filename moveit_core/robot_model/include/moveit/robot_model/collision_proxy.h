@@ -0,0 +1,159 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, PickNik LLC
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik LLC nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#pragma once
+
+#include <moveit/macros/class_forward.h>
+#include <geometric_shapes/shapes.h>
+#include <eigen_stl_containers/eigen_stl_containers.h>
+#include <Eigen/Geometry>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace moveit
+{
+namespace core
+{
+MOVEIT_CLASS_FORWARD(CollisionProxyGenerator)  // Defines CollisionProxyGeneratorPtr, ConstPtr, WeakPtr... etc
+
+/** \brief The kind of simplified geometry that replaces a mesh for collision checking */
+enum class CollisionProxyType
+{
+  /** \brief Keep the mesh as it is */
+  NONE,
+  /** \brief The mesh with vertices merged on a grid */
+  DECIMATED_MESH,
+  /** \brief The convex hull of the (decimated) mesh */
+  CONVEX_HULL,
+  /** \brief Convex hulls of parts of the mesh, for non-convex meshes */
+  CONVEX_DECOMPOSITION,
+  /** \brief An oriented bounding box */
+  BOX,
+  /** \brief A bounding cylinder along the principal axis */
+  CYLINDER,
+  /** \brief A bounding sphere */
+  SPHERE,
+  /** \brief The smallest of BOX, CYLINDER and SPHERE */
+  PRIMITIVE
+};
+
+/** \brief Parse a proxy type from its lower case name (e.g. "convex_decomposition"). Returns false if unknown. */
+bool collisionProxyTypeFromString(const std::string& name, CollisionProxyType& type);
+
+/** \brief Options for generating the collision proxy of a mesh */
+struct CollisionProxyOptions
+{
+  CollisionProxyType type = CollisionProxyType::NONE;
+
+  /** \brief The cell size for merging vertices, in meters. For zero, 1/64 of the largest extent of the mesh is used.
+   *  Applies to all types except the bounding primitives. */
+  double resolution = 0.0;
+
+  /** \brief The maximum number of convex hulls of CONVEX_DECOMPOSITION */
+  unsigned int max_convex_hulls = 16;
+
+  /** \brief A part of CONVEX_DECOMPOSITION is split while its surface is farther from its convex hull than this
+   *  fraction of the largest extent of the mesh */
+  double concavity = 0.05;
+};
+
+/** \brief Replaces the meshes of links by simplified geometry (collision proxies).
+ *
+ *  High-resolution meshes make collision checks slow, while a decimated mesh, a few convex hulls or a bounding
+ *  primitive usually approximate them well enough. The proxies are configured per link with setLinkOptions(), other
+ *  links use the default options. Proxies can be cached in a directory, keyed by a hash of the mesh and the options,
+ *  as computing convex decompositions of large meshes takes a while.
+ *
+ *  The RobotModel applies the generator when constructing its links, so that all collision checkers use the proxies.
+ */
+class CollisionProxyGenerator
+{
+public:
+  CollisionProxyGenerator() = default;
+
+  void setDefaultOptions(const CollisionProxyOptions& options)
+  {
+    default_options_ = options;
+  }
+
+  const CollisionProxyOptions& getDefaultOptions() const
+  {
+    return default_options_;
+  }
+
+  /** \brief Set the options for the meshes of link \e link */
+  void setLinkOptions(const std::string& link, const CollisionProxyOptions& options)
+  {
+    link_options_[link] = options;
+  }
+
+  /** \brief Get the options for the meshes of link \e link */
+  const CollisionProxyOptions& getLinkOptions(const std::string& link) const;
+
+  /** \brief Set the directory used to cache the proxies. It is created if needed, an empty path disables caching. */
+  void setCacheDirectory(const std::string& directory)
+  {
+    cache_directory_ = directory;
+  }
+
+  const std::string& getCacheDirectory() const
+  {
+    return cache_directory_;
+  }
+
+  /** \brief Replace the meshes among the collision \e shapes of link \e link (with origins \e poses) by their proxies.
+   *  Shapes other than meshes, and meshes for which no proxy can be computed, are not changed. */
+  void apply(const std::string& link, std::vector<shapes::ShapeConstPtr>& shapes,
+             EigenSTL::vector_Isometry3d& poses) const;
+
+  /** \brief Compute the proxy of \e mesh, looking it up in the cache first.
+   *  \param shapes The shapes of the proxy
+   *  \param poses The poses of the proxy shapes in the frame of the mesh
+   *  \return false if no proxy could be computed (e.g. for a flat mesh and a convex type) */
+  bool generate(const shapes::Mesh& mesh, const CollisionProxyOptions& options,
+                std::vector<shapes::ShapeConstPtr>& shapes, EigenSTL::vector_Isometry3d& poses) const;
+
+private:
+  bool compute(const shapes::Mesh& mesh, const CollisionProxyOptions& options,
+               std::vector<shapes::ShapeConstPtr>& shapes, EigenSTL::vector_Isometry3d& poses) const;
+
+  std::string getCacheFile(const shapes::Mesh& mesh, const CollisionProxyOptions& options) const;
+
+  CollisionProxyOptions default_options_;
+  std::map<std::string, CollisionProxyOptions> link_options_;
+  std::string cache_directory_;
+};
+}  // namespace core
+}  // namespace moveit
@@ -42,7 +42,9 @@
 #include <moveit/kinematics_base/kinematics_base.h>
 #include <srdfdom/model.h>
 #include <boost/function.hpp>
+#include <cmath>
 #include <set>
+#include <unordered_map>
 
 namespace moveit
 {
@@ -104,6 +106,23 @@ public:
   /// Map from group instances to allocator functions & bijections
   using KinematicsSolverMap = std::map<const JointModelGroup*, KinematicsSolver>;
 
+  /** \brief How the position bounds of an active joint of the group are checked and enforced */
+  enum PositionBoundsType
+  {
+    BOUNDED_VARIABLE,     // single variable clamped to [min, max] (prismatic and revolute joints)
+    CONTINUOUS_VARIABLE,  // single variable wrapped to (-pi, pi] (continuous revolute joints)
+    JOINT_BOUNDS          // the joint model checks and enforces its own bounds
+  };
+
+  /** \brief Entry of the position bounds table, one per active joint in the order of the active joints */
+  struct PositionBoundsEntry
+  {
+    const JointModel* joint;
+    PositionBoundsType type;
+    int group_index;  // index of the first variable of the joint in the group state
+    int state_index;  // index of the first variable of the joint in the full robot state
+  };
+
   JointModelGroup(const std::string& name, const srdf::Model::Group& config,
                   const std::vector<const JointModel*>& joint_vector, const RobotModel* parent_model);
 
@@ -290,6 +309,13 @@ public:
   /** \brief Get the index of a variable within the group. Return -1 on error. */
   int getVariableGroupIndex(const std::string& variable) const;
 
+  /** \brief Get the index within the group of the first variable of \e joint, without a name lookup. Return -1 if
+      the joint is not part of the group or has no variables. */
+  int getJointVariableGroupIndex(const JointModel* joint) const
+  {
+    return joint_variable_group_index_[joint->getJointIndex()];
+  }
+
   /** \brief Get the names of the known default states (as specified in the SRDF) */
   const std::vector<std::string>& getDefaultStateNames() const
   {
@@ -395,6 +421,46 @@ public:
   bool satisfiesPositionBounds(const double* state, const JointBoundsVector& active_joint_bounds,
                                double margin = 0.0) const;
 
+  /** \brief Get the position bounds table of the active joints, which lets the bounds of single variable
+      joints be checked and enforced without calls to the joint models */
+  const std::vector<PositionBoundsEntry>& getPositionBoundsTable() const
+  {
+    return position_bounds_table_;
+  }
+
+  /** \brief Enforce the bounds of a single variable entry of the position bounds table on \e value.
+      Return true if the value was changed. \e type must not be JOINT_BOUNDS. */
+  static bool enforceVariablePositionBounds(PositionBoundsType type, const VariableBounds& bounds, double& value)
+  {
+    if (type == CONTINUOUS_VARIABLE)
+    {
+      if (value > -M_PI && value <= M_PI)
+        return false;
+      value = fmod(value, 2.0 * M_PI);
+      if (value <= -M_PI)
+        value += 2.0 * M_PI;
+      else if (value > M_PI)
+        value -= 2.0 * M_PI;
+      return true;
+    }
+    if (value < bounds.min_position_)
+      value = bounds.min_position_;
+    else if (value > bounds.max_position_)
+      value = bounds.max_position_;
+    else
+      return false;
+    return true;
+  }
+
+  /** \brief Check the bounds of a single variable entry of the position bounds table on \e value.
+      \e type must not be JOINT_BOUNDS. */
+  static bool satisfiesVariablePositionBounds(PositionBoundsType type, const VariableBounds& bounds, double value,
+                                              double margin)
+  {
+    return type == CONTINUOUS_VARIABLE ||
+           !(value < bounds.min_position_ - margin || value > bounds.max_position_ + margin);
+  }
+
   double getMaximumExtent() const
   {
     return getMaximumExtent(active_joint_models_bounds_);
@@ -618,8 +684,8 @@ protected:
       necessarily joint names!) */
   std::set<std::string> variable_names_set_;
 
-  /** \brief A map from joint names to their instances. This includes all joints in the group. */
-  JointModelMapConst joint_model_map_;
+  /** \brief A hash map from joint names to their instances. This includes all joints in the group. */
+  std::unordered_map<std::string, const JointModel*> joint_model_map_;
 
   /** \brief The list of active joint models that are roots in this group */
   std::vector<const JointModel*> joint_roots_;
@@ -630,11 +696,19 @@ protected:
   /** \brief The group includes all the joint variables that make up the joints the group consists of.
       This map gives the position in the state vector of the group for each of these variables.
       Additionaly, it includes the names of the joints and the index for the first variable of that joint. */
-  VariableIndexMap joint_variables_index_map_;
+  std::unordered_map<std::string, int> joint_variables_index_map_;
+
+  /** \brief The index in the group of the first variable of each joint of the model, by joint index, -1 for the
+      joints that are not in the group or have no variables */
+  std::vector<int> joint_variable_group_index_;
 
   /** \brief The bounds for all the active joint models */
   JointBoundsVector active_joint_models_bounds_;
 
+  /** \brief How to check and enforce the position bounds of each active joint model. The bounds themselves are
+      not copied, as the joint models may have their bounds changed after the group is constructed. */
+  std::vector<PositionBoundsEntry> position_bounds_table_;
+
   /** \brief The list of index values this group includes, with respect to a full robot state; this includes mimic
    * joints. */
   std::vector<int> variable_index_list_;
@@ -648,8 +722,8 @@ protected:
       May not be in any particular order */
   std::vector<const LinkModel*> link_model_vector_;
 
-  /** \brief A map from link names to their instances */
-  LinkModelMapConst link_model_map_;
+  /** \brief A hash map from link names to their instances */
+  std::unordered_map<std::string, const LinkModel*> link_model_map_;
 
   /** \brief The names of the links in this group */
   std::vector<std::string> link_model_name_vector_;
@@ -0,0 +1,78 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, PickNik LLC
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik LLC nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Desc: On-disk cache of the parsed meshes of robot models */
+
+#pragma once
+
+#include <moveit/macros/class_forward.h>
+#include <geometric_shapes/shapes.h>
+#include <Eigen/Core>
+#include <string>
+
+namespace moveit
+{
+namespace core
+{
+MOVEIT_CLASS_FORWARD(MeshCache)  // Defines MeshCachePtr, ConstPtr, WeakPtr... etc
+
+/** \brief Loads the meshes of robot models through a cache of parsed meshes in a directory.
+ *
+ *  Parsing mesh resources with assimp takes most of the time of building a robot model with detailed meshes. The
+ *  cache stores the vertices and triangles of the parsed meshes in a binary file per mesh, which is memory mapped
+ *  when the mesh is loaded again. The raw resource is still read on every load and the cache file is looked up by a
+ *  hash of its content and of the scale, so that changed mesh files are never served from the cache. */
+class MeshCache
+{
+public:
+  /** \brief Construct a cache in \e directory, which is created if needed */
+  MeshCache(const std::string& directory) : directory_(directory)
+  {
+  }
+
+  const std::string& getDirectory() const
+  {
+    return directory_;
+  }
+
+  /** \brief Create a mesh from a resource like shapes::createMeshFromResource(), through the cache. Failing to read
+   *  or write the cache only makes it fall back to parsing the resource. Returns nullptr if the mesh cannot be
+   *  loaded. */
+  shapes::Mesh* createMeshFromResource(const std::string& resource, const Eigen::Vector3d& scale) const;
+
+private:
+  std::string directory_;
+};
+}  // namespace core
+}  // namespace moveit
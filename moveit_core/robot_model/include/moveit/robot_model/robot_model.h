@@ -48,8 +48,11 @@
 #include <moveit/robot_model/planar_joint_model.h>
 #include <moveit/robot_model/revolute_joint_model.h>
 #include <moveit/robot_model/prismatic_joint_model.h>
+#include <moveit/robot_model/collision_proxy.h>
+#include <moveit/robot_model/mesh_cache.h>
 #include <Eigen/Geometry>
 #include <iostream>
+#include <unordered_map>
 
 /** \brief Main namespace for MoveIt */
 namespace moveit
@@ -64,9 +67,29 @@ MOVEIT_CLASS_FORWARD(RobotModel)  // Defines RobotModelPtr, ConstPtr, WeakPtr...
 class RobotModel
 {
 public:
+  /** \brief How the transform of a link is computed from the transform of its joint frame (the parent link
+      transform times the joint origin transform) and the transform of its parent joint. The types are selected when
+      the model is built, so that forward kinematics multiplies by the common joint transforms without full matrix
+      products. */
+  enum LinkTransformType : unsigned char
+  {
+    FIXED_LINK_TRANSFORM,      /**< \brief The joint frame, for fixed joints */
+    REVOLUTE_X_LINK_TRANSFORM, /**< \brief The joint frame rotated about its x axis */
+    REVOLUTE_Y_LINK_TRANSFORM, /**< \brief The joint frame rotated about its y axis */
+    REVOLUTE_Z_LINK_TRANSFORM, /**< \brief The joint frame rotated about its z axis */
+    PRISMATIC_LINK_TRANSFORM,  /**< \brief The joint frame translated along an axis */
+    GENERIC_LINK_TRANSFORM     /**< \brief The joint frame times the joint transform */
+  };
+
   /** \brief Construct a kinematic model from a parsed description and a list of planning groups */
   RobotModel(const urdf::ModelInterfaceSharedPtr& urdf_model, const srdf::ModelConstSharedPtr& srdf_model);
 
+  /** \brief Construct a kinematic model whose link meshes are replaced by the collision proxies of \e collision_proxies
+   *  (see CollisionProxyGenerator). If \e mesh_cache is set, the meshes are loaded through it (see MeshCache). */
+  RobotModel(const urdf::ModelInterfaceSharedPtr& urdf_model, const srdf::ModelConstSharedPtr& srdf_model,
+             const CollisionProxyGeneratorConstPtr& collision_proxies,
+             const MeshCacheConstPtr& mesh_cache = MeshCacheConstPtr());
+
   /** \brief Destructor. Clear all memory. */
   ~RobotModel();
 
@@ -285,6 +308,12 @@ public:
     return link_model_vector_.size();
   }
 
+  /** \brief Get how the transform of the link with index \e link_index is computed */
+  LinkTransformType getLinkTransformType(int link_index) const
+  {
+    return link_transform_types_[link_index];
+  }
+
   std::size_t getLinkGeometryCount() const
   {
     return link_geometry_count_;
@@ -420,6 +449,10 @@ public:
   /** \brief Get the index of a variable in the robot state */
   int getVariableIndex(const std::string& variable) const;
 
+  /** \brief Get the indices in the robot state of a list of variables, -1 for the names that are not variables of
+      the model */
+  void getVariableIndices(const std::vector<std::string>& variables, std::vector<int>& indices) const;
+
   /** \brief Get the deepest joint in the kinematic tree that is a common parent of both joints passed as argument */
   const JointModel* getCommonRoot(const JointModel* a, const JointModel* b) const
   {
@@ -457,13 +490,19 @@ protected:
 
   urdf::ModelInterfaceSharedPtr urdf_;
 
+  /** \brief The generator of simplified collision geometry for the links, may be null */
+  CollisionProxyGeneratorConstPtr collision_proxies_;
+
+  /** \brief The cache the meshes of the links are loaded through, may be null */
+  MeshCacheConstPtr mesh_cache_;
+
   // LINKS
 
   /** \brief The first physical link for the robot */
   const LinkModel* root_link_;
 
-  /** \brief A map from link names to their instances */
-  LinkModelMap link_model_map_;
+  /** \brief A hash map from link names to their instances */
+  std::unordered_map<std::string, LinkModel*> link_model_map_;
 
   /** \brief The vector of links that are updated when computeTransforms() is called, in the order they are updated */
   std::vector<LinkModel*> link_model_vector_;
@@ -483,13 +522,16 @@ protected:
   /** \brief Total number of geometric shapes in this model */
   std::size_t link_geometry_count_;
 
+  /** \brief How the transforms of the links are computed, by link index */
+  std::vector<LinkTransformType> link_transform_types_;
+
   // JOINTS
 
   /** \brief The root joint */
   const JointModel* root_joint_;
 
-  /** \brief A map from joint names to their instances */
-  JointModelMap joint_model_map_;
+  /** \brief A hash map from joint names to their instances */
+  std::unordered_map<std::string, JointModel*> joint_model_map_;
 
   /** \brief The vector of joints in the model, in the order they appear in the state vector */
   std::vector<JointModel*> joint_model_vector_;
@@ -537,7 +579,7 @@ protected:
   /** \brief The state includes all the joint variables that make up the joints the state consists of.
       This map gives the position in the state vector of the group for each of these variables.
       Additionaly, it includes the names of the joints and the index for the first variable of that joint. */
-  VariableIndexMap joint_variables_index_map_;
+  std::unordered_map<std::string, int> joint_variables_index_map_;
 
   std::vector<int> active_joint_model_start_index_;
 
@@ -552,6 +594,9 @@ protected:
   /** \brief A map from group names to joint groups */
   JointModelGroupMap joint_model_group_map_;
 
+  /** \brief A hash map from group names to joint groups, for lookups by name */
+  std::unordered_map<std::string, JointModelGroup*> joint_model_group_index_;
+
   /** \brief The known end effectors */
   JointModelGroupMap end_effectors_map_;
 
@@ -588,6 +633,9 @@ protected:
   /** \brief Compute helpful information about joints */
   void buildJointInfo();
 
+  /** \brief Select how the transform of every link is computed */
+  void buildLinkTransformTypes();
+
   /** \brief For every joint, pre-compute the list of descendant joints & links */
   void computeDescendants();
 
@@ -0,0 +1,74 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, PickNik LLC
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik LLC nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#pragma once
+
+#include <moveit/robot_model/robot_model.h>
+#include <string>
+#include <vector>
+
+namespace moveit
+{
+namespace core
+{
+/** \brief Converts arrays of variable names, such as the names of sensor_msgs::msg::JointState messages, to the
+    indices of the variables in the robot state.
+
+    The indices are only looked up when the names differ from those of the previous conversion, so that a stream of
+    messages with the same layout is converted by comparing the names, without map lookups. An instance is not
+    thread-safe and the robot model must outlive it. */
+class VariableIndexMapping
+{
+public:
+  VariableIndexMapping(const RobotModel& robot_model);
+
+  /** \brief Get the indices of the variables \e names in the robot state, -1 for names that are not variables of
+      the model. The returned reference is valid until the next call. */
+  const std::vector<int>& getVariableIndices(const std::vector<std::string>& names);
+
+  /** \brief Forget the cached layout */
+  void clear();
+
+  const RobotModel& getRobotModel() const
+  {
+    return robot_model_;
+  }
+
+private:
+  const RobotModel& robot_model_;
+  std::vector<std::string> names_; /**< \brief The names of the cached layout */
+  std::vector<int> indices_;       /**< \brief The variable indices of names_ */
+};
+}  // namespace core
+}  // namespace moveit
@@ -0,0 +1,686 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, PickNik LLC
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik LLC nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include <moveit/robot_model/collision_proxy.h>
+#include <geometric_shapes/shape_operations.h>
+#include <boost/filesystem.hpp>
+#include <boost/math/constants/constants.hpp>
+#include <Eigen/Eigenvalues>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+#include <sstream>
+#include <unordered_map>
+#include "rclcpp/rclcpp.hpp"
+
+namespace moveit
+{
+namespace core
+{
+static const rclcpp::Logger LOGGER = rclcpp::get_logger("moveit_robot_model.collision_proxy");
+
+namespace
+{
+/** \brief Version of the cache file format and of the proxy computation, part of the cache key */
+const std::uint64_t CACHE_VERSION = 1;
+
+/** \brief Minimum size of the bounding primitives, for flat meshes */
+const double MIN_PRIMITIVE_SIZE = 1e-4;
+
+struct TriangleMesh
+{
+  EigenSTL::vector_Vector3d vertices;
+  std::vector<unsigned int> triangles;
+};
+
+struct ConvexHull
+{
+  TriangleMesh mesh;
+  double volume = 0.0;
+};
+
+void getVertices(const shapes::Mesh& mesh, EigenSTL::vector_Vector3d& vertices)
+{
+  vertices.resize(mesh.vertex_count);
+  for (unsigned int i = 0; i < mesh.vertex_count; ++i)
+    vertices[i] = Eigen::Vector3d(mesh.vertices[3 * i], mesh.vertices[3 * i + 1], mesh.vertices[3 * i + 2]);
+}
+
+double getLargestExtent(const EigenSTL::vector_Vector3d& points)
+{
+  Eigen::Vector3d min = Eigen::Vector3d::Constant(std::numeric_limits<double>::infinity());
+  Eigen::Vector3d max = -min;
+  for (const Eigen::Vector3d& point : points)
+  {
+    min = min.cwiseMin(point);
+    max = max.cwiseMax(point);
+  }
+  return points.empty() ? 0.0 : (max - min).maxCoeff();
+}
+
+/** \brief Merge all vertices within the same cell of a grid with cell size \e resolution (vertex clustering) */
+void decimate(const shapes::Mesh& mesh, double resolution, TriangleMesh& result)
+{
+  EigenSTL::vector_Vector3d vertices;
+  getVertices(mesh, vertices);
+  if (resolution <= 0.0)
+    resolution = getLargestExtent(vertices) / 64.0;
+
+  // the representative of each cell is the average of its vertices
+  std::unordered_map<std::uint64_t, unsigned int> cells;
+  std::vector<unsigned int> vertex_cell(vertices.size());
+  std::vector<unsigned int> cell_count;
+  result.vertices.clear();
+  for (std::size_t i = 0; i < vertices.size(); ++i)
+  {
+    std::uint64_t key = 0;
+    for (int axis = 0; axis < 3; ++axis)
+      key = (key << 21) | (static_cast<std::uint64_t>(std::floor(vertices[i][axis] / resolution) + (1 << 20)) &
+                           ((std::uint64_t(1) << 21) - 1));
+    auto it = cells.emplace(key, static_cast<unsigned int>(result.vertices.size())).first;
+    if (it->second == result.vertices.size())
+    {
+      result.vertices.push_back(Eigen::Vector3d::Zero());
+      cell_count.push_back(0);
+    }
+    vertex_cell[i] = it->second;
+    result.vertices[it->second] += vertices[i];
+    ++cell_count[it->second];
+  }
+  for (std::size_t i = 0; i < result.vertices.size(); ++i)
+    result.vertices[i] /= cell_count[i];
+
+  // keep the triangles whose corners are in different cells, once
+  std::vector<std::array<unsigned int, 3>> triangles;
+  triangles.reserve(mesh.triangle_count);
+  for (unsigned int i = 0; i < mesh.triangle_count; ++i)
+  {
+    std::array<unsigned int, 3> t = { vertex_cell[mesh.triangles[3 * i]], vertex_cell[mesh.triangles[3 * i + 1]],
+                                      vertex_cell[mesh.triangles[3 * i + 2]] };
+    if (t[0] == t[1] || t[1] == t[2] || t[0] == t[2])
+      continue;
+    // rotate the smallest index to the front, which keeps the orientation
+    std::rotate(t.begin(), std::min_element(t.begin(), t.end()), t.end());
+    triangles.push_back(t);
+  }
+  std::sort(triangles.begin(), triangles.end());
+  triangles.erase(std::unique(triangles.begin(), triangles.end()), triangles.end());
+
+  result.triangles.clear();
+  result.triangles.reserve(3 * triangles.size());
+  for (const std::array<unsigned int, 3>& t : triangles)
+    result.triangles.insert(result.triangles.end(), t.begin(), t.end());
+}
+
+/** \brief Computes the convex hull of \e points incrementally. Returns false if the points are (nearly) coplanar. */
+bool computeConvexHull(const EigenSTL::vector_Vector3d& points, ConvexHull& hull)
+{
+  struct Face
+  {
+    std::array<unsigned int, 3> v;
+    Eigen::Vector3d normal;
+    double offset;
+    bool alive;
+  };
+
+  if (points.size() < 4)
+    return false;
+  const double eps = 1e-9 * std::max(getLargestExtent(points), 1e-9);
+
+  // initial tetrahedron from extreme points
+  unsigned int i0 = 0;
+  for (unsigned int i = 1; i < points.size(); ++i)
+    if (points[i].x() < points[i0].x())
+      i0 = i;
+  auto farthest = [&points](const std::function<double(const Eigen::Vector3d&)>& distance) {
+    unsigned int best = 0;
+    double best_distance = -1.0;
+    for (unsigned int i = 0; i < points.size(); ++i)
+    {
+      const double d = distance(points[i]);
+      if (d > best_distance)
+      {
+        best_distance = d;
+        best = i;
+      }
+    }
+    return std::make_pair(best, best_distance);
+  };
+  const auto p1 = farthest([&](const Eigen::Vector3d& p) { return (p - points[i0]).norm(); });
+  if (p1.second < eps)
+    return false;
+  const unsigned int i1 = p1.first;
+  const Eigen::Vector3d dir = (points[i1] - points[i0]).normalized();
+  const auto p2 = farthest([&](const Eigen::Vector3d& p) { return (p - points[i0]).cross(dir).norm(); });
+  if (p2.second < eps)
+    return false;
+  const unsigned int i2 = p2.first;
+  const Eigen::Vector3d plane_normal = (points[i1] - points[i0]).cross(points[i2] - points[i0]).normalized();
+  const auto p3 = farthest([&](const Eigen::Vector3d& p) { return std::abs((p - points[i0]).dot(plane_normal)); });
+  if (p3.second < eps)
+    return false;
+  const unsigned int i3 = p3.first;
+  const Eigen::Vector3d inside = 0.25 * (points[i0] + points[i1] + points[i2] + points[i3]);
+
+  std::vector<Face> faces;
+  auto add_face = [&](unsigned int a, unsigned int b, unsigned int c) {
+    Face face;
+    face.v = { a, b, c };
+    face.normal = (points[b] - points[a]).cross(points[c] - points[a]);
+    const double norm = face.normal.norm();
+    face.normal = norm > 0.0 ? Eigen::Vector3d(face.normal / norm) : Eigen::Vector3d::Zero();
+    face.offset = face.normal.dot(points[a]);
+    face.alive = true;
+    faces.push_back(face);
+  };
+  for (const std::array<unsigned int, 3>& f : std::vector<std::array<unsigned int, 3>>{
+           { i0, i1, i2 }, { i0, i3, i1 }, { i0, i2, i3 }, { i1, i3, i2 } })
+  {
+    add_face(f[0], f[1], f[2]);
+    // orient the faces outwards
+    if (faces.back().normal.dot(inside) > faces.back().offset)
+    {
+      faces.pop_back();
+      add_face(f[0], f[2], f[1]);
+    }
+  }
+
+  std::vector<std::size_t> visible;
+  std::vector<std::pair<unsigned int, unsigned int>> edges;
+  for (unsigned int i = 0; i < points.size(); ++i)
+  {
+    if (i == i0 || i == i1 || i == i2 || i == i3)
+      continue;
+    visible.clear();
+    for (std::size_t j = 0; j < faces.size(); ++j)
+      if (faces[j].alive && faces[j].normal.dot(points[i]) - faces[j].offset > eps)
+        visible.push_back(j);
+    if (visible.empty())
+      continue;
+
+    // the horizon consists of the edges of visible faces whose opposite edge is not part of a visible face
+    edges.clear();
+    for (std::size_t j : visible)
+    {
+      faces[j].alive = false;
+      for (int k = 0; k < 3; ++k)
+        edges.emplace_back(faces[j].v[k], faces[j].v[(k + 1) % 3]);
+    }
+    std::sort(edges.begin(), edges.end());
+    for (const std::pair<unsigned int, unsigned int>& edge : edges)
+      if (!std::binary_search(edges.begin(), edges.end(), std::make_pair(edge.second, edge.first)))
+        add_face(edge.first, edge.second, i);
+  }
+
+  // collect the used vertices
+  std::vector<int> index(points.size(), -1);
+  hull.mesh.vertices.clear();
+  hull.mesh.triangles.clear();
+  hull.volume = 0.0;
+  for (const Face& face : faces)
+    if (face.alive)
+    {
+      for (unsigned int v : face.v)
+      {
+        if (index[v] < 0)
+        {
+          index[v] = static_cast<int>(hull.mesh.vertices.size());
+          hull.mesh.vertices.push_back(points[v]);
+        }
+        hull.mesh.triangles.push_back(index[v]);
+      }
+      hull.volume += points[face.v[0]].dot(points[face.v[1]].cross(points[face.v[2]])) / 6.0;
+    }
+  return hull.volume > 0.0;
+}
+
+/** \brief Hull of the vertices of a subset of the triangles of \e mesh */
+bool computePartHull(const TriangleMesh& mesh, const std::vector<unsigned int>& triangles, ConvexHull& hull)
+{
+  std::vector<bool> used(mesh.vertices.size(), false);
+  EigenSTL::vector_Vector3d points;
+  for (unsigned int t : triangles)
+    for (int k = 0; k < 3; ++k)
+    {
+      const unsigned int v = mesh.triangles[3 * t + k];
+      if (!used[v])
+      {
+        used[v] = true;
+        points.push_back(mesh.vertices[v]);
+      }
+    }
+  return computeConvexHull(points, hull);
+}
+
+/** \brief The largest distance of the vertices of \e triangles from the boundary of their convex hull */
+double computeConcavity(const TriangleMesh& mesh, const std::vector<unsigned int>& triangles, const ConvexHull& hull)
+{
+  EigenSTL::vector_Vector3d normals;
+  std::vector<double> offsets;
+  for (std::size_t i = 0; i < hull.mesh.triangles.size(); i += 3)
+  {
+    const Eigen::Vector3d& a = hull.mesh.vertices[hull.mesh.triangles[i]];
+    const Eigen::Vector3d normal = (hull.mesh.vertices[hull.mesh.triangles[i + 1]] - a)
+                                       .cross(hull.mesh.vertices[hull.mesh.triangles[i + 2]] - a)
+                                       .normalized();
+    normals.push_back(normal);
+    offsets.push_back(normal.dot(a));
+  }
+
+  double concavity = 0.0;
+  for (unsigned int t : triangles)
+    for (int k = 0; k < 3; ++k)
+    {
+      const Eigen::Vector3d& v = mesh.vertices[mesh.triangles[3 * t + k]];
+      double distance = std::numeric_limits<double>::infinity();
+      for (std::size_t i = 0; i < normals.size() && distance > concavity; ++i)
+        distance = std::min(distance, offsets[i] - normals[i].dot(v));
+      concavity = std::max(concavity, distance);
+    }
+  return concavity;
+}
+
+/** \brief Approximate convex decomposition: the part whose surface is farthest from its hull is split in halves along
+ *  its longest axis, until \e max_hulls is reached or all parts are within \e concavity times the largest extent of
+ *  the mesh from their hulls */
+bool decompose(const TriangleMesh& mesh, unsigned int max_hulls, double concavity, std::vector<ConvexHull>& hulls)
+{
+  struct Part
+  {
+    std::vector<unsigned int> triangles;
+    ConvexHull hull;
+    double concavity = 0.0;
+  };
+
+  const double max_concavity = concavity * getLargestExtent(mesh.vertices);
+  auto make_part = [&mesh](std::vector<unsigned int>&& triangles, Part& part) {
+    part.triangles = std::move(triangles);
+    if (!computePartHull(mesh, part.triangles, part.hull))
+      return false;
+    // parts with few triangles are not split further
+    part.concavity = part.triangles.size() < 8 ? 0.0 : computeConcavity(mesh, part.triangles, part.hull);
+    return true;
+  };
+
+  std::vector<Part> parts(1);
+  std::vector<unsigned int> all_triangles(mesh.triangles.size() / 3);
+  for (std::size_t i = 0; i < all_triangles.size(); ++i)
+    all_triangles[i] = i;
+  if (!make_part(std::move(all_triangles), parts[0]))
+    return false;
+
+  while (parts.size() < max_hulls)
+  {
+    std::size_t best = 0;
+    for (std::size_t i = 1; i < parts.size(); ++i)
+      if (parts[i].concavity > parts[best].concavity)
+        best = i;
+    if (parts[best].concavity <= max_concavity)
+      break;
+
+    Eigen::Vector3d min = Eigen::Vector3d::Constant(std::numeric_limits<double>::infinity());
+    Eigen::Vector3d max = -min;
+    for (const Eigen::Vector3d& v : parts[best].hull.mesh.vertices)
+    {
+      min = min.cwiseMin(v);
+      max = max.cwiseMax(v);
+    }
+    int axis;
+    (max - min).maxCoeff(&axis);
+
+    // split at the median of the triangle centroids
+    std::vector<std::pair<double, unsigned int>> centroids;
+    centroids.reserve(parts[best].triangles.size());
+    for (unsigned int t : parts[best].triangles)
+      centroids.emplace_back(mesh.vertices[mesh.triangles[3 * t]][axis] +
+                                 mesh.vertices[mesh.triangles[3 * t + 1]][axis] +
+                                 mesh.vertices[mesh.triangles[3 * t + 2]][axis],
+                             t);
+    const std::size_t half = centroids.size() / 2;
+    std::nth_element(centroids.begin(), centroids.begin() + half, centroids.end());
+    std::vector<unsigned int> triangles[2];
+    for (std::size_t i = 0; i < centroids.size(); ++i)
+      triangles[i < half ? 0 : 1].push_back(centroids[i].second);
+
+    Part children[2];
+    if (!make_part(std::move(triangles[0]), children[0]) || !make_part(std::move(triangles[1]), children[1]))
+    {
+      // a flat half, keep the part as it is
+      parts[best].concavity = 0.0;
+      continue;
+    }
+    parts[best] = std::move(children[0]);
+    parts.push_back(std::move(children[1]));
+  }
+
+  hulls.clear();
+  for (Part& part : parts)
+    hulls.push_back(std::move(part.hull));
+  return true;
+}
+
+/** \brief The principal axes of \e points as columns of a rotation, in order of increasing variance */
+Eigen::Matrix3d getPrincipalAxes(const EigenSTL::vector_Vector3d& points)
+{
+  Eigen::Vector3d mean = Eigen::Vector3d::Zero();
+  for (const Eigen::Vector3d& p : points)
+    mean += p;
+  mean /= points.size();
+  Eigen::Matrix3d covariance = Eigen::Matrix3d::Zero();
+  for (const Eigen::Vector3d& p : points)
+    covariance += (p - mean) * (p - mean).transpose();
+
+  Eigen::SelfAdjointEigenSolver<Eigen::Matrix3d> solver(covariance);
+  Eigen::Matrix3d axes = solver.eigenvectors();
+  if (axes.determinant() < 0.0)
+    axes.col(0) = -axes.col(0);
+  return axes;
+}
+
+/** \brief Fit a bounding box, cylinder or sphere (or the smallest of them for PRIMITIVE) to \e points */
+void fitPrimitive(const EigenSTL::vector_Vector3d& points, CollisionProxyType type, shapes::ShapeConstPtr& shape,
+                  Eigen::Isometry3d& pose)
+{
+  const double pi = boost::math::constants::pi<double>();
+  const Eigen::Matrix3d axes = getPrincipalAxes(points);
+
+  Eigen::Vector3d min = Eigen::Vector3d::Constant(std::numeric_limits<double>::infinity());
+  Eigen::Vector3d max = -min;
+  for (const Eigen::Vector3d& p : points)
+  {
+    const Eigen::Vector3d q = axes.transpose() * p;
+    min = min.cwiseMin(q);
+    max = max.cwiseMax(q);
+  }
+  const Eigen::Vector3d center = 0.5 * (min + max);
+  const Eigen::Vector3d size = (max - min).cwiseMax(MIN_PRIMITIVE_SIZE);
+
+  // the cylinder axis is the principal axis of largest variance (the last one), the radius is measured around the
+  // center of the box in the other two directions
+  double cylinder_radius = 0.0;
+  double sphere_radius = 0.0;
+  for (const Eigen::Vector3d& p : points)
+  {
+    const Eigen::Vector3d q = axes.transpose() * p - center;
+    cylinder_radius = std::max(cylinder_radius, q.head<2>().norm());
+    sphere_radius = std::max(sphere_radius, q.norm());
+  }
+  cylinder_radius = std::max(cylinder_radius, MIN_PRIMITIVE_SIZE);
+  sphere_radius = std::max(sphere_radius, MIN_PRIMITIVE_SIZE);
+
+  if (type == CollisionProxyType::PRIMITIVE)
+  {
+    const double box_volume = size.prod();
+    const double cylinder_volume = pi * cylinder_radius * cylinder_radius * size.z();
+    const double sphere_volume = 4.0 / 3.0 * pi * std::pow(sphere_radius, 3);
+    if (box_volume <= cylinder_volume && box_volume <= sphere_volume)
+      type = CollisionProxyType::BOX;
+    else if (cylinder_volume <= sphere_volume)
+      type = CollisionProxyType::CYLINDER;
+    else
+      type = CollisionProxyType::SPHERE;
+  }
+
+  pose = Eigen::Isometry3d::Identity();
+  pose.translation() = axes * center;
+  if (type == CollisionProxyType::SPHERE)
+  {
+    shape = std::make_shared<const shapes::Sphere>(sphere_radius);
+    return;
+  }
+  pose.linear() = axes;
+  if (type == CollisionProxyType::BOX)
+    shape = std::make_shared<const shapes::Box>(size.x(), size.y(), size.z());
+  else
+    shape = std::make_shared<const shapes::Cylinder>(cylinder_radius, size.z());
+}
+
+shapes::ShapeConstPtr createMesh(const TriangleMesh& mesh)
+{
+  return shapes::ShapeConstPtr(shapes::createMeshFromVertices(mesh.vertices, mesh.triangles));
+}
+
+/** \brief FNV-1a hash */
+void hashBytes(const void* data, std::size_t size, std::uint64_t& hash)
+{
+  const unsigned char* bytes = static_cast<const unsigned char*>(data);
+  for (std::size_t i = 0; i < size; ++i)
+  {
+    hash ^= bytes[i];
+    hash *= 1099511628211ull;
+  }
+}
+}  // namespace
+
+bool collisionProxyTypeFromString(const std::string& name, CollisionProxyType& type)
+{
+  static const std::map<std::string, CollisionProxyType> TYPES = {
+    { "none", CollisionProxyType::NONE },
+    { "decimated_mesh", CollisionProxyType::DECIMATED_MESH },
+    { "convex_hull", CollisionProxyType::CONVEX_HULL },
+    { "convex_decomposition", CollisionProxyType::CONVEX_DECOMPOSITION },
+    { "box", CollisionProxyType::BOX },
+    { "cylinder", CollisionProxyType::CYLINDER },
+    { "sphere", CollisionProxyType::SPHERE },
+    { "primitive", CollisionProxyType::PRIMITIVE }
+  };
+  auto it = TYPES.find(name);
+  if (it == TYPES.end())
+    return false;
+  type = it->second;
+  return true;
+}
+
+const CollisionProxyOptions& CollisionProxyGenerator::getLinkOptions(const std::string& link) const
+{
+  auto it = link_options_.find(link);
+  return it == link_options_.end() ? default_options_ : it->second;
+}
+
+void CollisionProxyGenerator::apply(const std::string& link, std::vector<shapes::ShapeConstPtr>& shapes,
+                                    EigenSTL::vector_Isometry3d& poses) const
+{
+  const CollisionProxyOptions& options = getLinkOptions(link);
+  if (options.type == CollisionProxyType::NONE)
+    return;
+
+  std::vector<shapes::ShapeConstPtr> new_shapes;
+  EigenSTL::vector_Isometry3d new_poses;
+  for (std::size_t i = 0; i < shapes.size(); ++i)
+  {
+    std::vector<shapes::ShapeConstPtr> proxy_shapes;
+    EigenSTL::vector_Isometry3d proxy_poses;
+    if (shapes[i]->type == shapes::MESH &&
+        generate(static_cast<const shapes::Mesh&>(*shapes[i]), options, proxy_shapes, proxy_poses))
+    {
+      RCLCPP_DEBUG(LOGGER, "Replaced mesh %zu of link '%s' (%u triangles) by %zu proxy shapes", i, link.c_str(),
+                   static_cast<const shapes::Mesh&>(*shapes[i]).triangle_count, proxy_shapes.size());
+      for (std::size_t j = 0; j < proxy_shapes.size(); ++j)
+      {
+        new_shapes.push_back(proxy_shapes[j]);
+        new_poses.push_back(poses[i] * proxy_poses[j]);
+      }
+    }
+    else
+    {
+      new_shapes.push_back(shapes[i]);
+      new_poses.push_back(poses[i]);
+    }
+  }
+  shapes.swap(new_shapes);
+  poses.swap(new_poses);
+}
+
+bool CollisionProxyGenerator::generate(const shapes::Mesh& mesh, const CollisionProxyOptions& options,
+                                       std::vector<shapes::ShapeConstPtr>& shapes,
+                                       EigenSTL::vector_Isometry3d& poses) const
+{
+  shapes.clear();
+  poses.clear();
+  if (options.type == CollisionProxyType::NONE || mesh.triangle_count == 0)
+    return false;
+
+  const std::string cache_file = getCacheFile(mesh, options);
+  if (!cache_file.empty())
+  {
+    std::ifstream in(cache_file);
+    std::size_t count;
+    if (in >> count)
+    {
+      for (std::size_t i = 0; i < count; ++i)
+      {
+        double x, y, z, rx, ry, rz, rw;
+        if (!(in >> x >> y >> z >> rx >> ry >> rz >> rw))
+          break;
+        shapes::ShapeConstPtr shape(shapes::constructShapeFromText(in));
+        if (!shape)
+          break;
+        shapes.push_back(shape);
+        poses.push_back(Eigen::Translation3d(x, y, z) * Eigen::Quaterniond(rw, rx, ry, rz).normalized());
+      }
+      if (shapes.size() == count && count > 0)
+        return true;
+      RCLCPP_WARN(LOGGER, "Ignoring invalid collision proxy cache file '%s'", cache_file.c_str());
+      shapes.clear();
+      poses.clear();
+    }
+  }
+
+  if (!compute(mesh, options, shapes, poses))
+    return false;
+
+  if (!cache_file.empty())
+  {
+    // write to a temporary file first, so that concurrent readers never see a partial file
+    try
+    {
+      boost::filesystem::create_directories(cache_directory_);
+      const boost::filesystem::path tmp =
+          boost::filesystem::path(cache_directory_) / boost::filesystem::unique_path("%%%%-%%%%-%%%%.tmp");
+      {
+        std::ofstream out(tmp.string());
+        out << std::setprecision(17) << shapes.size() << std::endl;
+        for (std::size_t i = 0; i < shapes.size(); ++i)
+        {
+          const Eigen::Quaterniond r(poses[i].linear());
+          out << poses[i].translation().x() << " " << poses[i].translation().y() << " "
+              << poses[i].translation().z() << " " << r.x() << " " << r.y() << " " << r.z() << " " << r.w()
+              << std::endl;
+          shapes::saveAsText(shapes[i].get(), out);
+        }
+        if (!out)
+          throw boost::filesystem::filesystem_error("Failed to write", tmp, boost::system::error_code());
+      }
+      boost::filesystem::rename(tmp, cache_file);
+    }
+    catch (const boost::filesystem::filesystem_error& e)
+    {
+      RCLCPP_WARN(LOGGER, "Failed to cache collision proxy in '%s': %s", cache_directory_.c_str(), e.what());
+    }
+  }
+  return true;
+}
+
+bool CollisionProxyGenerator::compute(const shapes::Mesh& mesh, const CollisionProxyOptions& options,
+                                      std::vector<shapes::ShapeConstPtr>& shapes,
+                                      EigenSTL::vector_Isometry3d& poses) const
+{
+  if (options.type == CollisionProxyType::BOX || options.type == CollisionProxyType::CYLINDER ||
+      options.type == CollisionProxyType::SPHERE || options.type == CollisionProxyType::PRIMITIVE)
+  {
+    EigenSTL::vector_Vector3d vertices;
+    getVertices(mesh, vertices);
+    shapes::ShapeConstPtr shape;
+    Eigen::Isometry3d pose;
+    fitPrimitive(vertices, options.type, shape, pose);
+    shapes.push_back(shape);
+    poses.push_back(pose);
+    return true;
+  }
+
+  TriangleMesh decimated;
+  decimate(mesh, options.resolution, decimated);
+  if (decimated.triangles.empty())
+    return false;
+
+  if (options.type == CollisionProxyType::DECIMATED_MESH)
+  {
+    shapes.push_back(createMesh(decimated));
+  }
+  else if (options.type == CollisionProxyType::CONVEX_HULL)
+  {
+    ConvexHull hull;
+    if (!computeConvexHull(decimated.vertices, hull))
+      return false;
+    shapes.push_back(createMesh(hull.mesh));
+  }
+  else
+  {
+    std::vector<ConvexHull> hulls;
+    if (!decompose(decimated, std::max(options.max_convex_hulls, 1u), options.concavity, hulls))
+      return false;
+    for (const ConvexHull& hull : hulls)
+      shapes.push_back(createMesh(hull.mesh));
+  }
+  poses.resize(shapes.size(), Eigen::Isometry3d::Identity());
+  return true;
+}
+
+std::string CollisionProxyGenerator::getCacheFile(const shapes::Mesh& mesh, const CollisionProxyOptions& options) const
+{
+  if (cache_directory_.empty())
+    return std::string();
+
+  std::uint64_t hash = 14695981039346656037ull;
+  hashBytes(&CACHE_VERSION, sizeof(CACHE_VERSION), hash);
+  hashBytes(mesh.vertices, 3 * mesh.vertex_count * sizeof(double), hash);
+  hashBytes(mesh.triangles, 3 * mesh.triangle_count * sizeof(unsigned int), hash);
+  const int type = static_cast<int>(options.type);
+  hashBytes(&type, sizeof(type), hash);
+  hashBytes(&options.resolution, sizeof(options.resolution), hash);
+  hashBytes(&options.max_convex_hulls, sizeof(options.max_convex_hulls), hash);
+  hashBytes(&options.concavity, sizeof(options.concavity), hash);
+
+  std::stringstream name;
+  name << std::hex << std::setw(16) << std::setfill('0') << hash << ".proxy";
+  return (boost::filesystem::path(cache_directory_) / name.str()).string();
+}
+}  // namespace core
+}  // namespace moveit
@@ -118,6 +118,7 @@ JointModelGroup::JointModelGroup(const std::string& group_name, const srdf::Mode
 
   // figure out active joints, mimic joints, fixed joints
   // construct index maps, list of variables
+  joint_variable_group_index_.resize(parent_model->getJointModelCount(), -1);
   for (const JointModel* joint_model : joint_model_vector_)
   {
     joint_model_name_vector_.push_back(joint_model->getName());
@@ -134,6 +135,18 @@ JointModelGroup::JointModelGroup(const std::string& group_name, const srdf::Mode
         active_joint_model_name_vector_.push_back(joint_model->getName());
         active_joint_model_start_index_.push_back(variable_count_);
         active_joint_models_bounds_.push_back(&joint_model->getVariableBounds());
+
+        PositionBoundsEntry entry;
+        entry.joint = joint_model;
+        entry.type = JOINT_BOUNDS;
+        if (joint_model->getType() == JointModel::PRISMATIC)
+          entry.type = BOUNDED_VARIABLE;
+        else if (joint_model->getType() == JointModel::REVOLUTE)
+          entry.type = static_cast<const RevoluteJointModel*>(joint_model)->isContinuous() ? CONTINUOUS_VARIABLE :
+                                                                                               BOUNDED_VARIABLE;
+        entry.group_index = variable_count_;
+        entry.state_index = joint_model->getFirstVariableIndex();
+        position_bounds_table_.push_back(entry);
       }
       else
         mimic_joints_.push_back(joint_model);
@@ -150,6 +163,7 @@ JointModelGroup::JointModelGroup(const std::string& group_name, const srdf::Mode
         joint_variables_index_map_[name_order[j]] = variable_count_ + j;
       }
       joint_variables_index_map_[joint_model->getName()] = variable_count_;
+      joint_variable_group_index_[joint_model->getJointIndex()] = variable_count_;
 
       if (joint_model->getType() == JointModel::REVOLUTE &&
           static_cast<const RevoluteJointModel*>(joint_model)->isContinuous())
@@ -291,7 +305,7 @@ bool JointModelGroup::hasLinkModel(const std::string& link) const
 
 const LinkModel* JointModelGroup::getLinkModel(const std::string& name) const
 {
-  LinkModelMapConst::const_iterator it = link_model_map_.find(name);
+  auto it = link_model_map_.find(name);
   if (it == link_model_map_.end())
   {
     RCLCPP_ERROR(LOGGER, "Link '%s' not found in group '%s'", name.c_str(), name_.c_str());
@@ -302,7 +316,7 @@ const LinkModel* JointModelGroup::getLinkModel(const std::string& name) const
 
 const JointModel* JointModelGroup::getJointModel(const std::string& name) const
 {
-  JointModelMapConst::const_iterator it = joint_model_map_.find(name);
+  auto it = joint_model_map_.find(name);
   if (it == joint_model_map_.end())
   {
     RCLCPP_ERROR(LOGGER, "Joint '%s' not found in group '%s'", name.c_str(), name_.c_str());
@@ -380,10 +394,18 @@ bool JointModelGroup::satisfiesPositionBounds(const double* state, const JointBo
                                               double margin) const
 {
   assert(active_joint_bounds.size() == active_joint_model_vector_.size());
-  for (std::size_t i = 0; i < active_joint_model_vector_.size(); ++i)
-    if (!active_joint_model_vector_[i]->satisfiesPositionBounds(state + active_joint_model_start_index_[i],
-                                                                *active_joint_bounds[i], margin))
+  for (std::size_t i = 0; i < position_bounds_table_.size(); ++i)
+  {
+    const PositionBoundsEntry& entry = position_bounds_table_[i];
+    if (entry.type == JOINT_BOUNDS)
+    {
+      if (!entry.joint->satisfiesPositionBounds(state + entry.group_index, *active_joint_bounds[i], margin))
+        return false;
+    }
+    else if (!satisfiesVariablePositionBounds(entry.type, (*active_joint_bounds[i])[0], state[entry.group_index],
+                                              margin))
       return false;
+  }
   return true;
 }
 
@@ -391,10 +413,17 @@ bool JointModelGroup::enforcePositionBounds(double* state, const JointBoundsVect
 {
   assert(active_joint_bounds.size() == active_joint_model_vector_.size());
   bool change = false;
-  for (std::size_t i = 0; i < active_joint_model_vector_.size(); ++i)
-    if (active_joint_model_vector_[i]->enforcePositionBounds(state + active_joint_model_start_index_[i],
-                                                             *active_joint_bounds[i]))
+  for (std::size_t i = 0; i < position_bounds_table_.size(); ++i)
+  {
+    const PositionBoundsEntry& entry = position_bounds_table_[i];
+    if (entry.type == JOINT_BOUNDS)
+    {
+      if (entry.joint->enforcePositionBounds(state + entry.group_index, *active_joint_bounds[i]))
+        change = true;
+    }
+    else if (enforceVariablePositionBounds(entry.type, (*active_joint_bounds[i])[0], state[entry.group_index]))
       change = true;
+  }
   if (change)
     updateMimicJoints(state);
   return change;
@@ -544,7 +573,7 @@ const LinkModel* JointModelGroup::getOnlyOneEndEffectorTip() const
 
 int JointModelGroup::getVariableGroupIndex(const std::string& variable) const
 {
-  VariableIndexMap::const_iterator it = joint_variables_index_map_.find(variable);
+  auto it = joint_variables_index_map_.find(variable);
   if (it == joint_variables_index_map_.end())
   {
     RCLCPP_ERROR(LOGGER, "Variable '%s' is not part of group '%s'", variable.c_str(), name_.c_str());
@@ -568,7 +597,7 @@ bool JointModelGroup::computeIKIndexBijection(const std::vector<std::string>& ik
   joint_bijection.clear();
   for (const std::string& ik_jname : ik_jnames)
   {
-    VariableIndexMap::const_iterator it = joint_variables_index_map_.find(ik_jname);
+    auto it = joint_variables_index_map_.find(ik_jname);
     if (it == joint_variables_index_map_.end())
     {
       // skip reported fixed joints
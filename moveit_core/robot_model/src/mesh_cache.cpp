@@ -0,0 +1,188 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, PickNik LLC
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik LLC nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include <moveit/robot_model/mesh_cache.h>
+#include <geometric_shapes/mesh_operations.h>
+#include <resource_retriever/retriever.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/iostreams/device/mapped_file.hpp>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include "rclcpp/rclcpp.hpp"
+
+namespace moveit
+{
+namespace core
+{
+static const rclcpp::Logger LOGGER = rclcpp::get_logger("moveit_robot_model.mesh_cache");
+
+namespace
+{
+/** \brief Version of the cache file format, part of the cache key */
+const std::uint32_t CACHE_VERSION = 1;
+
+const char CACHE_MAGIC[4] = { 'M', 'M', 'S', 'H' };
+
+/** \brief The header of a cache file, followed by the vertices as doubles and the triangles as 32 bit indices */
+struct CacheFileHeader
+{
+  char magic[4];
+  std::uint32_t version;
+  std::uint64_t vertex_count;
+  std::uint64_t triangle_count;
+};
+
+void hashBytes(const void* data, std::size_t size, std::uint64_t& hash)
+{
+  const unsigned char* bytes = static_cast<const unsigned char*>(data);
+  for (std::size_t i = 0; i < size; ++i)
+  {
+    hash ^= bytes[i];
+    hash *= 1099511628211ull;
+  }
+}
+
+shapes::Mesh* readCacheFile(const std::string& cache_file)
+{
+  boost::iostreams::mapped_file_source file;
+  try
+  {
+    file.open(cache_file);
+  }
+  catch (const std::exception&)
+  {
+    return nullptr;  // not cached yet
+  }
+
+  CacheFileHeader header;
+  if (file.size() < sizeof(header))
+    return nullptr;
+  std::memcpy(&header, file.data(), sizeof(header));
+  const std::size_t vertices_size = 3 * header.vertex_count * sizeof(double);
+  const std::size_t triangles_size = 3 * header.triangle_count * sizeof(std::uint32_t);
+  if (std::memcmp(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0 || header.version != CACHE_VERSION ||
+      file.size() != sizeof(header) + vertices_size + triangles_size)
+  {
+    RCLCPP_WARN(LOGGER, "Ignoring invalid mesh cache file '%s'", cache_file.c_str());
+    return nullptr;
+  }
+
+  shapes::Mesh* mesh = new shapes::Mesh(header.vertex_count, header.triangle_count);
+  std::memcpy(mesh->vertices, file.data() + sizeof(header), vertices_size);
+  const std::uint32_t* triangles = reinterpret_cast<const std::uint32_t*>(file.data() + sizeof(header) + vertices_size);
+  for (std::size_t i = 0; i < 3 * header.triangle_count; ++i)
+    mesh->triangles[i] = triangles[i];
+  mesh->computeTriangleNormals();
+  mesh->computeVertexNormals();
+  return mesh;
+}
+
+void writeCacheFile(const std::string& directory, const std::string& cache_file, const shapes::Mesh& mesh)
+{
+  // write to a temporary file first, so that concurrent readers never see a partial file
+  try
+  {
+    boost::filesystem::create_directories(directory);
+    const boost::filesystem::path tmp =
+        boost::filesystem::path(directory) / boost::filesystem::unique_path("%%%%-%%%%-%%%%.tmp");
+    {
+      CacheFileHeader header;
+      std::memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+      header.version = CACHE_VERSION;
+      header.vertex_count = mesh.vertex_count;
+      header.triangle_count = mesh.triangle_count;
+      std::ofstream out(tmp.string(), std::ios::binary);
+      out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+      out.write(reinterpret_cast<const char*>(mesh.vertices), 3 * mesh.vertex_count * sizeof(double));
+      for (std::size_t i = 0; i < 3 * mesh.triangle_count; ++i)
+      {
+        const std::uint32_t index = mesh.triangles[i];
+        out.write(reinterpret_cast<const char*>(&index), sizeof(index));
+      }
+      if (!out)
+        throw boost::filesystem::filesystem_error("Failed to write", tmp, boost::system::error_code());
+    }
+    boost::filesystem::rename(tmp, cache_file);
+  }
+  catch (const boost::filesystem::filesystem_error& e)
+  {
+    RCLCPP_WARN(LOGGER, "Failed to cache mesh in '%s': %s", directory.c_str(), e.what());
+  }
+}
+}  // namespace
+
+shapes::Mesh* MeshCache::createMeshFromResource(const std::string& resource, const Eigen::Vector3d& scale) const
+{
+  if (directory_.empty())
+    return shapes::createMeshFromResource(resource, scale);
+
+  resource_retriever::MemoryResource data;
+  try
+  {
+    resource_retriever::Retriever retriever;
+    data = retriever.get(resource);
+  }
+  catch (const resource_retriever::Exception& e)
+  {
+    RCLCPP_ERROR(LOGGER, "%s", e.what());
+    return nullptr;
+  }
+  if (data.size == 0)
+  {
+    RCLCPP_WARN(LOGGER, "Retrieved empty mesh for resource '%s'", resource.c_str());
+    return nullptr;
+  }
+
+  std::uint64_t hash = 14695981039346656037ull;
+  hashBytes(&CACHE_VERSION, sizeof(CACHE_VERSION), hash);
+  hashBytes(data.data.get(), data.size, hash);
+  hashBytes(scale.data(), 3 * sizeof(double), hash);
+  std::stringstream name;
+  name << std::hex << std::setw(16) << std::setfill('0') << hash << ".mesh";
+  const std::string cache_file = (boost::filesystem::path(directory_) / name.str()).string();
+
+  if (shapes::Mesh* mesh = readCacheFile(cache_file))
+    return mesh;
+
+  shapes::Mesh* mesh =
+      shapes::createMeshFromBinary(reinterpret_cast<const char*>(data.data.get()), data.size, scale, resource);
+  if (mesh)
+    writeCacheFile(directory_, cache_file, *mesh);
+  return mesh;
+}
+}  // namespace core
+}  // namespace moveit
@@ -60,6 +60,18 @@ RobotModel::RobotModel(const urdf::ModelInterfaceSharedPtr& urdf_model, const sr
   buildModel(*urdf_model, *srdf_model);
 }
 
+RobotModel::RobotModel(const urdf::ModelInterfaceSharedPtr& urdf_model, const srdf::ModelConstSharedPtr& srdf_model,
+                       const CollisionProxyGeneratorConstPtr& collision_proxies,
+                       const MeshCacheConstPtr& mesh_cache)
+{
+  root_joint_ = nullptr;
+  urdf_ = urdf_model;
+  srdf_ = srdf_model;
+  collision_proxies_ = collision_proxies;
+  mesh_cache_ = mesh_cache;
+  buildModel(*urdf_model, *srdf_model);
+}
+
 RobotModel::~RobotModel()
 {
   for (std::pair<const std::string, JointModelGroup*>& it : joint_model_group_map_)
@@ -106,6 +118,7 @@ void RobotModel::buildModel(const urdf::ModelInterface& urdf_model, const srdf::
 
     RCLCPP_DEBUG(LOGGER, "... computing joint indexing");
     buildJointInfo();
+    buildLinkTransformTypes();
 
     if (link_models_with_collision_geometry_vector_.empty())
     {
@@ -248,6 +261,29 @@ void RobotModel::computeDescendants()
   }
 }
 
+void RobotModel::buildLinkTransformTypes()
+{
+  link_transform_types_.resize(link_model_vector_.size());
+  for (const LinkModel* link : link_model_vector_)
+  {
+    const JointModel* joint = link->getParentJointModel();
+    LinkTransformType& type = link_transform_types_[link->getLinkIndex()];
+    type = GENERIC_LINK_TRANSFORM;
+    if (joint->getType() == JointModel::FIXED)
+      type = FIXED_LINK_TRANSFORM;
+    else if (joint->getType() == JointModel::PRISMATIC)
+      type = PRISMATIC_LINK_TRANSFORM;
+    else if (joint->getType() == JointModel::REVOLUTE)
+    {
+      // rotations about other axes than the coordinate axes are general rotations
+      const Eigen::Vector3d& axis = static_cast<const RevoluteJointModel*>(joint)->getAxis();
+      for (int i = 0; i < 3; ++i)
+        if (axis[(i + 1) % 3] == 0.0 && axis[(i + 2) % 3] == 0.0)
+          type = static_cast<LinkTransformType>(REVOLUTE_X_LINK_TRANSFORM + i);
+    }
+  }
+}
+
 void RobotModel::buildJointInfo()
 {
   moveit::tools::Profiler::ScopedStart prof_start;
@@ -391,7 +427,7 @@ void RobotModel::buildMimic(const urdf::ModelInterface& urdf_model)
     if (jm)
       if (jm->mimic)
       {
-        JointModelMap::const_iterator jit = joint_model_map_.find(jm->mimic->joint_name);
+        auto jit = joint_model_map_.find(jm->mimic->joint_name);
         if (jit != joint_model_map_.end())
         {
           if (joint_model->getVariableCount() == jit->second->getVariableCount())
@@ -476,13 +512,13 @@ JointModelGroup* RobotModel::getEndEffector(const std::string& name)
 
 bool RobotModel::hasJointModelGroup(const std::string& name) const
 {
-  return joint_model_group_map_.find(name) != joint_model_group_map_.end();
+  return joint_model_group_index_.find(name) != joint_model_group_index_.end();
 }
 
 const JointModelGroup* RobotModel::getJointModelGroup(const std::string& name) const
 {
-  JointModelGroupMap::const_iterator it = joint_model_group_map_.find(name);
-  if (it == joint_model_group_map_.end())
+  auto it = joint_model_group_index_.find(name);
+  if (it == joint_model_group_index_.end())
   {
     RCLCPP_ERROR(LOGGER, "Group '%s' not found in model '%s'", name.c_str(), model_name_.c_str());
     return nullptr;
@@ -492,8 +528,8 @@ const JointModelGroup* RobotModel::getJointModelGroup(const std::string& name) c
 
 JointModelGroup* RobotModel::getJointModelGroup(const std::string& name)
 {
-  JointModelGroupMap::const_iterator it = joint_model_group_map_.find(name);
-  if (it == joint_model_group_map_.end())
+  auto it = joint_model_group_index_.find(name);
+  if (it == joint_model_group_index_.end())
   {
     RCLCPP_ERROR(LOGGER, "Group '%s' not found in model '%s'", name.c_str(), model_name_.c_str());
     return nullptr;
@@ -781,6 +817,7 @@ bool RobotModel::addJointModelGroup(const srdf::Model::Group& gc)
 
   JointModelGroup* jmg = new JointModelGroup(gc.name_, gc, joints, this);
   joint_model_group_map_[gc.name_] = jmg;
+  joint_model_group_index_[gc.name_] = jmg;
 
   return true;
 }
@@ -1035,6 +1072,8 @@ LinkModel* RobotModel::constructLinkModel(const urdf::Link* urdf_link)
                                   "Fix your URDF file by explicitly specifying collision geometry.");
   }
 
+  if (collision_proxies_)
+    collision_proxies_->apply(urdf_link->name, shapes, poses);
   new_link_model->setGeometry(shapes, poses);
 
   // figure out visual mesh (try visual urdf tag first, collision tag otherwise
@@ -1092,7 +1131,8 @@ shapes::ShapePtr RobotModel::constructShape(const urdf::Geometry* geom)
       if (!mesh->filename.empty())
       {
         Eigen::Vector3d scale(mesh->scale.x, mesh->scale.y, mesh->scale.z);
-        shapes::Mesh* m = shapes::createMeshFromResource(mesh->filename, scale);
+        shapes::Mesh* m = mesh_cache_ ? mesh_cache_->createMeshFromResource(mesh->filename, scale) :
+                                        shapes::createMeshFromResource(mesh->filename, scale);
         new_shape = m;
       }
     }
@@ -1117,7 +1157,7 @@ bool RobotModel::hasLinkModel(const std::string& name) const
 
 const JointModel* RobotModel::getJointModel(const std::string& name) const
 {
-  JointModelMap::const_iterator it = joint_model_map_.find(name);
+  auto it = joint_model_map_.find(name);
   if (it != joint_model_map_.end())
     return it->second;
   RCLCPP_ERROR(LOGGER, "Joint '%s' not found in model '%s'", name.c_str(), model_name_.c_str());
@@ -1137,7 +1177,7 @@ const JointModel* RobotModel::getJointModel(int index) const
 
 JointModel* RobotModel::getJointModel(const std::string& name)
 {
-  JointModelMap::const_iterator it = joint_model_map_.find(name);
+  auto it = joint_model_map_.find(name);
   if (it != joint_model_map_.end())
     return it->second;
   RCLCPP_ERROR(LOGGER, "Joint '%s' not found in model '%s'", name.c_str(), model_name_.c_str());
@@ -1164,7 +1204,7 @@ LinkModel* RobotModel::getLinkModel(const std::string& name, bool* has_link)
 {
   if (has_link)
     *has_link = true;  // Start out optimistic
-  LinkModelMap::const_iterator it = link_model_map_.find(name);
+  auto it = link_model_map_.find(name);
   if (it != link_model_map_.end())
     return it->second;
 
@@ -1247,12 +1287,22 @@ void RobotModel::getMissingVariableNames(const std::vector<std::string>& variabl
 
 int RobotModel::getVariableIndex(const std::string& variable) const
 {
-  VariableIndexMap::const_iterator it = joint_variables_index_map_.find(variable);
+  auto it = joint_variables_index_map_.find(variable);
   if (it == joint_variables_index_map_.end())
     throw Exception("Variable '" + variable + "' is not known to model '" + model_name_ + "'");
   return it->second;
 }
 
+void RobotModel::getVariableIndices(const std::vector<std::string>& variables, std::vector<int>& indices) const
+{
+  indices.resize(variables.size());
+  for (std::size_t i = 0; i < variables.size(); ++i)
+  {
+    auto it = joint_variables_index_map_.find(variables[i]);
+    indices[i] = it == joint_variables_index_map_.end() ? -1 : it->second;
+  }
+}
+
 double RobotModel::getMaximumExtent(const JointBoundsVector& active_joint_bounds) const
 {
   double max_distance = 0.0;
@@ -35,6 +35,7 @@
 /* Author: Ioan Sucan */
 
 #include <moveit/robot_model/robot_model.h>
+#include <moveit/robot_model/variable_index_mapping.h>
 #include <urdf_parser/urdf_parser.h>
 #include <fstream>
 #include <gtest/gtest.h>
@@ -82,6 +83,33 @@ TEST_F(LoadPlanningModelsPr2, Model)
   moveit::tools::Profiler::Status();
 }
 
+TEST_F(LoadPlanningModelsPr2, VariableIndexMapping)
+{
+  const std::vector<std::string>& variables = robot_model_->getVariableNames();
+  std::vector<std::string> names = { variables[3], "not_a_variable", variables[0] };
+
+  moveit::core::VariableIndexMapping mapping(*robot_model_);
+  std::vector<int> indices = mapping.getVariableIndices(names);
+  ASSERT_EQ(indices.size(), 3u);
+  EXPECT_EQ(indices[0], 3);
+  EXPECT_EQ(indices[1], -1);
+  EXPECT_EQ(indices[2], 0);
+
+  // the cached layout is used until the names change
+  EXPECT_EQ(mapping.getVariableIndices(names), indices);
+  names[1] = variables[1];
+  indices = mapping.getVariableIndices(names);
+  EXPECT_EQ(indices[1], 1);
+  names.pop_back();
+  EXPECT_EQ(mapping.getVariableIndices(names).size(), 2u);
+
+  std::vector<int> expected;
+  robot_model_->getVariableIndices(variables, expected);
+  for (std::size_t i = 0; i < variables.size(); ++i)
+    EXPECT_EQ(expected[i], robot_model_->getVariableIndex(variables[i]));
+  EXPECT_EQ(mapping.getVariableIndices(variables), expected);
+}
+
 TEST(SiblingAssociateLinks, SimpleYRobot)
 {
   /* base_link - a - b - c
@@ -138,6 +138,8 @@ public:
       ASSERT_ISOMETRY(t.second)  // unsanitized input, could contain a non-isometry
     }
     subframe_poses_ = subframe_poses;
+    global_subframe_poses_ = subframe_poses;
+    global_transforms_valid_ = false;
   }
 
   /** \brief Get the fixed transform to a named subframe on this body (relative to the robot link)
@@ -172,7 +174,9 @@ public:
   /** \brief Set the scale for the shapes of this attached object */
   void setScale(double scale);
 
-  /** \brief Recompute global_collision_body_transform given the transform of the parent link */
+  /** \brief Recompute global_collision_body_transform given the transform of the parent link
+   *
+   * Nothing is recomputed if the parent link did not move since the last call. */
   void computeTransform(const Eigen::Isometry3d& parent_link_global_transform);
 
 private:
@@ -203,6 +207,12 @@ private:
 
   /** \brief Transforms to subframes on the object, relative to the model frame. */
   moveit::core::FixedTransformsMap global_subframe_poses_;
+
+  /** \brief The parent link transform the global transforms were last computed for */
+  Eigen::Isometry3d parent_link_global_transform_;
+
+  /** \brief Whether the global transforms correspond to parent_link_global_transform_ */
+  bool global_transforms_valid_;
 };
 }  // namespace core
 }  // namespace moveit
@@ -86,6 +86,25 @@ struct MaxEEFStep
   double rotation;     // Radians
 };
 
+/** \brief Struct for containing the precision of computeCartesianPath with adaptive steps
+
+    Between consecutive states of the path the robot moves linearly in joint space, so the link deviates from the
+    straight Cartesian line, the more so the larger the step and the closer the robot is to a singularity. Steps whose
+    joint-space midpoint deviates from the line by more than \e translational or \e rotational are bisected until
+    they are within the precision. If this needs steps shorter than \e max_resolution (a fraction of the path to the
+    target), the path is truncated. Setting a tolerance to zero disables checking it. */
+struct CartesianPrecision
+{
+  CartesianPrecision(double translational = 0.0, double rotational = 0.0, double max_resolution = 1e-4)
+    : translational(translational), rotational(rotational), max_resolution(max_resolution)
+  {
+  }
+
+  double translational;   // Meters
+  double rotational;      // Radians
+  double max_resolution;  // Fraction of the path to the target
+};
+
 class CartesianInterpolator
 {
   // TODO(mlautman): Eventually, this planner should be moved out of robot_state
@@ -143,6 +162,23 @@ public:
                        const GroupStateValidityCallbackFn& validCallback = GroupStateValidityCallbackFn(),
                        const kinematics::KinematicsQueryOptions& options = kinematics::KinematicsQueryOptions());
 
+  /** \brief Compute the sequence of joint values that correspond to a straight Cartesian path to \e target with
+     adaptive steps.
+
+     The path is sampled with steps of up to \e max_step as in the previous function, and steps are refined where
+     needed to follow the straight line within \e precision. This allows to use a larger \e max_step than required
+     for the desired precision on the well-conditioned parts of the path, and thus fewer IK calls. As the refined
+     steps are shorter than the others, relative jump detection (\e jump_threshold.factor) should be used with a
+     correspondingly larger factor, or be replaced by absolute thresholds. All other comments from the previous
+     functions apply. */
+  static double
+  computeCartesianPath(RobotState* start_state, const JointModelGroup* group,
+                       std::vector<std::shared_ptr<RobotState>>& traj, const LinkModel* link,
+                       const Eigen::Isometry3d& target, bool global_reference_frame, const MaxEEFStep& max_step,
+                       const JumpThreshold& jump_threshold, const CartesianPrecision& precision,
+                       const GroupStateValidityCallbackFn& validCallback = GroupStateValidityCallbackFn(),
+                       const kinematics::KinematicsQueryOptions& options = kinematics::KinematicsQueryOptions());
+
   /** \brief Compute the sequence of joint values that perform a general Cartesian path.
 
      In contrast to the previous functions, the Cartesian path is specified as a set of \e waypoints to be sequentially
@@ -157,6 +193,17 @@ public:
                        const GroupStateValidityCallbackFn& validCallback = GroupStateValidityCallbackFn(),
                        const kinematics::KinematicsQueryOptions& options = kinematics::KinematicsQueryOptions());
 
+  /** \brief Compute the sequence of joint values that perform a general Cartesian path through \e waypoints, with
+     the adaptive steps of \e precision between consecutive waypoints. */
+  static double
+  computeCartesianPath(RobotState* start_state, const JointModelGroup* group,
+                       std::vector<std::shared_ptr<RobotState>>& traj, const LinkModel* link,
+                       const EigenSTL::vector_Isometry3d& waypoints, bool global_reference_frame,
+                       const MaxEEFStep& max_step, const JumpThreshold& jump_threshold,
+                       const CartesianPrecision& precision,
+                       const GroupStateValidityCallbackFn& validCallback = GroupStateValidityCallbackFn(),
+                       const kinematics::KinematicsQueryOptions& options = kinematics::KinematicsQueryOptions());
+
   /** \brief Tests joint space jumps of a trajectory.
 
      If \e jump_threshold_factor is non-zero, we test for relative jumps.
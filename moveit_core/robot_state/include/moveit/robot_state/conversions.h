@@ -59,6 +59,9 @@ bool jointStateToRobotState(const sensor_msgs::msg::JointState& joint_state, Rob
  * @param state The resultant MoveIt robot state
  * @param copy_attached_bodies Flag to include attached objects in robot state copy
  * @return True if successful, false if failed for any reason
+ *
+ * Attached bodies of \e state that the (non-diff) message describes unchanged, e.g. because it was created by
+ * robotStateToRobotStateMsg(), are kept instead of being rebuilt.
  */
 bool robotStateMsgToRobotState(const Transforms& tf, const moveit_msgs::msg::RobotState& robot_state, RobotState& state,
                                bool copy_attached_bodies = true);
@@ -69,6 +72,8 @@ bool robotStateMsgToRobotState(const Transforms& tf, const moveit_msgs::msg::Rob
  * @param state The resultant MoveIt robot state
  * @param copy_attached_bodies Flag to include attached objects in robot state copy
  * @return True if successful, false if failed for any reason
+ *
+ * Attached bodies of \e state that the (non-diff) message describes unchanged are kept instead of being rebuilt.
  */
 bool robotStateMsgToRobotState(const moveit_msgs::msg::RobotState& robot_state, RobotState& state,
                                bool copy_attached_bodies = true);
@@ -94,6 +99,8 @@ void attachedBodiesToAttachedCollisionObjectMsgs(
  * @brief Convert a MoveIt robot state to a joint state message
  * @param state The input MoveIt robot state object
  * @param robot_state The resultant JointState message
+ *
+ * The joint names of a message that is filled repeatedly are only copied once.
  */
 void robotStateToJointStateMsg(const RobotState& state, sensor_msgs::msg::JointState& joint_state);
 
@@ -38,6 +38,7 @@
 #pragma once
 
 #include <moveit/robot_model/robot_model.h>
+#include <moveit/robot_model/variable_index_mapping.h>
 #include <moveit/robot_state/attached_body.h>
 #include <moveit/transforms/transforms.h>
 #include <sensor_msgs/msg/joint_state.hpp>
@@ -170,6 +171,19 @@ public:
     setVariablePositions(&position[0]);
   }
 
+  /** \brief Copy only the positions of all variables from \e other, a state of the same robot model. Velocities,
+      accelerations, efforts and attached bodies of this state are kept and no transforms are copied, which makes this
+      much cheaper than an assignment in planner inner loops. All transforms are marked dirty. */
+  void copyPositionsFrom(const RobotState& other)
+  {
+    assert(robot_model_ == other.robot_model_);  // checked only in debug mode
+    setVariablePositions(other.position_);
+  }
+
+  /** \brief Copy only the positions of the variables of \e group from \e other, a state of the same robot model,
+      like copyPositionsFrom(const RobotState&). The transforms of the group are marked dirty. */
+  void copyPositionsFrom(const RobotState& other, const JointModelGroup* group);
+
   /** \brief Set the positions of a set of variables. If unknown variable names are specified, an exception is thrown.
    */
   void setVariablePositions(const std::map<std::string, double>& variable_map);
@@ -629,6 +643,11 @@ public:
    *   of mimic joints), set those as the new values that correspond to the group */
   void setJointGroupPositions(const JointModelGroup* group, const double* gstate);
 
+  /** \brief Like setJointGroupPositions(), but only the joints whose positions differ from \e gstate are set and
+      marked dirty, so that a following update() only recomputes the transforms below the changed joints. This is
+      useful when a state is repeatedly overwritten with group positions that are partly or fully the same. */
+  void setJointGroupPositionsIfChanged(const JointModelGroup* group, const double* gstate);
+
   /** \brief Given positions for the variables that make up a group, in the order found in the group (including values
    *   of mimic joints), set those as the new values that correspond to the group */
   void setJointGroupPositions(const std::string& joint_group_name, const Eigen::VectorXd& values)
@@ -1134,6 +1153,42 @@ public:
                                                              use_quaternion_representation);
   }
 
+  /** \brief Compute the Jacobian with reference to a particular point on a given link, for a specified group, into
+   * caller-provided storage. The group must have \e DOF variables, or any number of variables for Eigen::Dynamic, in
+   * which case the matrix is resized if needed. No memory is allocated for matrices of the right size.
+   * \param group The group to compute the Jacobian for
+   * \param link The link model to compute the Jacobian for
+   * \param reference_point_position The reference point position (with respect to the link specified in link)
+   * \param jacobian The resultant jacobian
+   * \return True if jacobian was successfully computed, false otherwise
+   */
+  template <int DOF>
+  bool getJacobian(const JointModelGroup* group, const LinkModel* link, const Eigen::Vector3d& reference_point_position,
+                   Eigen::Matrix<double, 6, DOF>& jacobian) const
+  {
+    if (DOF == Eigen::Dynamic)
+      jacobian.resize(6, group->getVariableCount());
+    return computeJacobian(group, link, reference_point_position, jacobian);
+  }
+
+  /** \brief Update the link transforms, then compute the global transform of \e link and the Jacobian with reference
+   * to a particular point on it, for a specified group, into caller-provided storage.
+   * \param group The group to compute the Jacobian for
+   * \param link The link model to compute the Jacobian for
+   * \param reference_point_position The reference point position (with respect to the link specified in link)
+   * \param jacobian The resultant jacobian
+   * \param link_transform The global transform of the link
+   * \return True if jacobian was successfully computed, false otherwise
+   */
+  template <int DOF>
+  bool getJacobian(const JointModelGroup* group, const LinkModel* link, const Eigen::Vector3d& reference_point_position,
+                   Eigen::Matrix<double, 6, DOF>& jacobian, Eigen::Isometry3d& link_transform)
+  {
+    updateLinkTransforms();
+    link_transform = global_link_transforms_[link->getLinkIndex()];
+    return static_cast<const RobotState*>(this)->getJacobian(group, link, reference_point_position, jacobian);
+  }
+
   /** \brief Compute the Jacobian with reference to the last link of a specified group. If the group is not a chain, an
    * exception is thrown.
    * \param group The group to compute the Jacobian for
@@ -1190,6 +1245,12 @@ public:
       setVariableVelocities(msg.name, msg.velocity);
   }
 
+  /** \brief Set the positions and velocities of the variables in \e msg, using \e mapping to convert the names of
+      the message to variable indices. This avoids the name lookups when messages with the same layout are set
+      repeatedly. As for setVariableValues(msg), an exception is thrown for names that are not variables of the
+      model. */
+  void setVariableValues(const sensor_msgs::msg::JointState& msg, VariableIndexMapping& mapping);
+
   /** \brief Set all joints to their default positions.
        The default position is 0, or if that is not within bounds then half way
        between min and max bound.  */
@@ -1242,6 +1303,22 @@ public:
   /** \brief Update all transforms. */
   void update(bool force = false);
 
+  /** \brief Enable or disable the lazy update of link transforms. When enabled, the non-const
+      getGlobalLinkTransform() only computes the transforms of the link and of its ancestors that are out of date,
+      instead of all link transforms. The other link transforms stay out of date until they are updated, e.g. by
+      update() or updateLinkTransforms(), so the const getters cannot be used in the meantime. This pays off when
+      only a few links are queried after each change, as for IK cost functions. Disabled by default. */
+  void setLazyLinkTransforms(bool lazy)
+  {
+    lazy_link_transforms_ = lazy;
+  }
+
+  /** \brief Whether link transforms are updated lazily, see setLazyLinkTransforms() */
+  bool hasLazyLinkTransforms() const
+  {
+    return lazy_link_transforms_;
+  }
+
   /** \brief Update the state after setting a particular link to the input global transform pose.
 
       This "warps" the given link to the given pose, neglecting the joint values of its parent joint.
@@ -1258,6 +1335,19 @@ public:
   /** \brief Update the state after setting a particular link to the input global transform pose.*/
   void updateStateWithLinkAt(const LinkModel* link, const Eigen::Isometry3d& transform, bool backward = false);
 
+  /** \brief Compute the global link transforms of the links updated by \e group for a batch of group configurations.
+
+      \e group_positions holds \e state_count consecutive group states, each in the order returned by
+      group->getVariableNames() (i.e. the format expected by setJointGroupPositions()). Joints outside of the group
+      keep the values of this state. This state itself is not modified, apart from updating its own link transforms.
+
+      The result is written in structure-of-arrays layout to \e link_transforms, which must provide space for
+      12 * group->getUpdatedLinkModels().size() * state_count doubles: coefficient c of the (column-major) 3x4 affine
+      part of the k-th link in group->getUpdatedLinkModels() for state s is stored at
+      link_transforms[(k * 12 + c) * state_count + s]. */
+  void computeGroupLinkTransforms(const JointModelGroup* group, const double* group_positions,
+                                  std::size_t state_count, double* link_transforms);
+
   /** \brief Get the link transform w.r.t. the root link (model frame) of the RobotModel.
    *   This is typically the root link of the URDF unless a virtual joint is present.
    *   Checks the cache and if there are any dirty (non-updated) transforms, first updates them as needed.
@@ -1273,7 +1363,10 @@ public:
 
   const Eigen::Isometry3d& getGlobalLinkTransform(const LinkModel* link)
   {
-    updateLinkTransforms();
+    if (!lazy_link_transforms_)
+      updateLinkTransforms();
+    else if (dirty_link_transforms_ != nullptr)
+      updateLinkTransformChain(link);
     return global_link_transforms_[link->getLinkIndex()];
   }
 
@@ -1752,6 +1845,19 @@ private:
 
   void updateLinkTransformsInternal(const JointModel* start);
 
+  /** \brief Compute the transform of a link from the transform of its parent link */
+  void updateLinkTransform(const LinkModel* link);
+
+  /** \brief Compute the transforms of \e link and its ancestors that are descendants of dirty_link_transforms_,
+      without updating any other link. Return false if \e link is not a descendant, so its transform is up to date. */
+  bool updateLinkTransformChain(const LinkModel* link);
+
+  /** \brief Compute the 6 rows of the Jacobian of a chain group without allocating memory. The number of columns of
+      \e jacobian must be the number of variables of the group. */
+  bool computeJacobian(const JointModelGroup* group, const LinkModel* link,
+                       const Eigen::Vector3d& reference_point_position,
+                       Eigen::Ref<Eigen::Matrix<double, 6, Eigen::Dynamic>> jacobian) const;
+
   void getMissingKeys(const std::map<std::string, double>& variable_map,
                       std::vector<std::string>& missing_variables) const;
   void getStateTreeJointString(std::ostream& ss, const JointModel* jm, const std::string& pfx0, bool last) const;
@@ -1775,6 +1881,7 @@ private:
   bool has_velocity_;
   bool has_acceleration_;
   bool has_effort_;
+  bool lazy_link_transforms_;
 
   const JointModel* dirty_link_transforms_;
   const JointModel* dirty_collision_body_transforms_;
@@ -56,6 +56,8 @@ AttachedBody::AttachedBody(const LinkModel* parent_link_model, const std::string
   , detach_posture_(detach_posture)
   , subframe_poses_(subframe_poses)
   , global_subframe_poses_(subframe_poses)
+  , parent_link_global_transform_(Eigen::Isometry3d::Identity())
+  , global_transforms_valid_(false)
 {
   for (const auto& t : attach_trans_)
   {
@@ -93,6 +95,13 @@ void AttachedBody::computeTransform(const Eigen::Isometry3d& parent_link_global_
 {
   ASSERT_ISOMETRY(parent_link_global_transform)  // unsanitized input, could contain a non-isometry
 
+  // RobotState updates all attached bodies whenever any link moves, so most calls are for a parent link that stayed
+  // in place; comparing the 16 coefficients is much cheaper than transforming all shapes and subframes
+  if (global_transforms_valid_ && parent_link_global_transform.matrix() == parent_link_global_transform_.matrix())
+    return;
+  parent_link_global_transform_ = parent_link_global_transform;
+  global_transforms_valid_ = true;
+
   // update collision body transforms
   for (std::size_t i = 0; i < global_collision_body_transforms_.size(); ++i)
     global_collision_body_transforms_[i] = parent_link_global_transform * attach_trans_[i];  // valid isometry
@@ -51,6 +51,99 @@ static const std::size_t MIN_STEPS_FOR_JUMP_THRESH = 10;
 
 static const rclcpp::Logger LOGGER = rclcpp::get_logger("moveit_robot_state.cartesian_interpolator");
 
+namespace
+{
+/** \brief A straight Cartesian path of a link, along which the steps of computeCartesianPath are refined */
+class CartesianSegment
+{
+public:
+  CartesianSegment(const JointModelGroup* group, const LinkModel* link, const Eigen::Isometry3d& start_pose,
+                   const Eigen::Isometry3d& target_pose, const std::vector<double>& consistency_limits,
+                   const CartesianPrecision& precision, const GroupStateValidityCallbackFn& validCallback,
+                   const kinematics::KinematicsQueryOptions& options)
+    : group_(group)
+    , link_(link)
+    , start_translation_(start_pose.translation())
+    , target_translation_(target_pose.translation())
+    , start_quaternion_(start_pose.linear())
+    , target_quaternion_(target_pose.linear())
+    , consistency_limits_(consistency_limits)
+    , precision_(precision)
+    , valid_callback_(validCallback)
+    , options_(options)
+  {
+  }
+
+  /** \brief The pose of the link at \e percentage of the path */
+  Eigen::Isometry3d getPose(double percentage) const
+  {
+    Eigen::Isometry3d pose(start_quaternion_.slerp(percentage, target_quaternion_));
+    pose.translation() = percentage * target_translation_ + (1 - percentage) * start_translation_;
+    return pose;
+  }
+
+  /** \brief Solve the IK for the pose at \e percentage of the path, seeded with the current values of \e state */
+  bool setFromIK(RobotState& state, double percentage) const
+  {
+    // Explicitly use a single IK attempt only: We want a smooth trajectory.
+    // Random seeding (of additional attempts) would probably create IK jumps.
+    return state.setFromIK(group_, getPose(percentage), link_->getName(), consistency_limits_, 0.0, valid_callback_,
+                           options_);
+  }
+
+  /** \brief Bisect the step from \e from to \e to, at \e from_percentage and \e to_percentage of the path, until
+      the joint-space midpoints of all steps are within the precision. The states added in between are appended to
+      \e traj. */
+  bool refineStep(const RobotState& from, const RobotState& to, double from_percentage, double to_percentage,
+                  std::vector<RobotStatePtr>& traj) const
+  {
+    const double percentage = 0.5 * (from_percentage + to_percentage);
+    if (isMidpointWithinPrecision(from, to, percentage))
+      return true;
+    if (to_percentage - from_percentage < precision_.max_resolution)
+    {
+      RCLCPP_DEBUG(LOGGER, "Truncating Cartesian path as it cannot follow the straight line within the precision");
+      return false;
+    }
+
+    auto state = std::make_shared<RobotState>(from);
+    if (!setFromIK(*state, percentage) || !refineStep(from, *state, from_percentage, percentage, traj))
+      return false;
+    traj.push_back(state);
+    return refineStep(*state, to, percentage, to_percentage, traj);
+  }
+
+private:
+  bool isMidpointWithinPrecision(const RobotState& from, const RobotState& to, double percentage) const
+  {
+    RobotState midpoint(from);
+    from.interpolate(to, 0.5, midpoint, group_);
+    midpoint.update();
+    const Eigen::Isometry3d& actual = midpoint.getGlobalLinkTransform(link_);
+    const Eigen::Isometry3d expected = getPose(percentage);
+    if (precision_.translational > 0.0 &&
+        (actual.translation() - expected.translation()).norm() > precision_.translational)
+      return false;
+    if (precision_.rotational > 0.0 &&
+        Eigen::Quaterniond(actual.linear()).angularDistance(Eigen::Quaterniond(expected.linear())) >
+            precision_.rotational)
+      return false;
+    return true;
+  }
+
+  const JointModelGroup* group_;
+  const LinkModel* link_;
+  Eigen::Vector3d start_translation_;
+  Eigen::Vector3d target_translation_;
+  Eigen::Quaterniond start_quaternion_;
+  Eigen::Quaterniond target_quaternion_;
+  const std::vector<double>& consistency_limits_;
+  const CartesianPrecision& precision_;
+  const GroupStateValidityCallbackFn& valid_callback_;
+  const kinematics::KinematicsQueryOptions& options_;
+};
+}  // namespace
+
 double CartesianInterpolator::computeCartesianPath(RobotState* start_state, const JointModelGroup* group,
                                                    std::vector<RobotStatePtr>& traj, const LinkModel* link,
                                                    const Eigen::Vector3d& direction, bool global_reference_frame,
@@ -81,6 +174,18 @@ double CartesianInterpolator::computeCartesianPath(RobotState* start_state, cons
                                                    const MaxEEFStep& max_step, const JumpThreshold& jump_threshold,
                                                    const GroupStateValidityCallbackFn& validCallback,
                                                    const kinematics::KinematicsQueryOptions& options)
+{
+  return computeCartesianPath(start_state, group, traj, link, target, global_reference_frame, max_step, jump_threshold,
+                              CartesianPrecision(), validCallback, options);
+}
+
+double CartesianInterpolator::computeCartesianPath(RobotState* start_state, const JointModelGroup* group,
+                                                   std::vector<RobotStatePtr>& traj, const LinkModel* link,
+                                                   const Eigen::Isometry3d& target, bool global_reference_frame,
+                                                   const MaxEEFStep& max_step, const JumpThreshold& jump_threshold,
+                                                   const CartesianPrecision& precision,
+                                                   const GroupStateValidityCallbackFn& validCallback,
+                                                   const kinematics::KinematicsQueryOptions& options)
 {
   const std::vector<const JointModel*>& cjnt = group->getContinuousJointModels();
   // make sure that continuous joints wrap
@@ -146,6 +251,10 @@ double CartesianInterpolator::computeCartesianPath(RobotState* start_state, cons
       consistency_limits.push_back(limit);
     }
 
+  const CartesianSegment segment(group, link, start_pose, rotated_target, consistency_limits, precision, validCallback,
+                                 options);
+  const bool refine_steps = precision.translational > 0.0 || precision.rotational > 0.0;
+
   traj.clear();
   traj.push_back(RobotStatePtr(new moveit::core::RobotState(*start_state)));
 
@@ -154,15 +263,19 @@ double CartesianInterpolator::computeCartesianPath(RobotState* start_state, cons
   {
     double percentage = (double)i / (double)steps;
 
-    Eigen::Isometry3d pose(start_quaternion.slerp(percentage, target_quaternion));
-    pose.translation() = percentage * rotated_target.translation() + (1 - percentage) * start_pose.translation();
-
-    // Explicitly use a single IK attempt only: We want a smooth trajectory.
-    // Random seeding (of additional attempts) would probably create IK jumps.
-    if (start_state->setFromIK(group, pose, link->getName(), consistency_limits, 0.0, validCallback, options))
-      traj.push_back(RobotStatePtr(new moveit::core::RobotState(*start_state)));
-    else
+    if (!segment.setFromIK(*start_state, percentage))
       break;
+    if (refine_steps)
+    {
+      const RobotStatePtr previous = traj.back();
+      const std::size_t traj_size = traj.size();
+      if (!segment.refineStep(*previous, *start_state, last_valid_percentage, percentage, traj))
+      {
+        traj.resize(traj_size);
+        break;
+      }
+    }
+    traj.push_back(RobotStatePtr(new moveit::core::RobotState(*start_state)));
 
     last_valid_percentage = percentage;
   }
@@ -179,6 +292,19 @@ double CartesianInterpolator::computeCartesianPath(RobotState* start_state, cons
                                                    const JumpThreshold& jump_threshold,
                                                    const GroupStateValidityCallbackFn& validCallback,
                                                    const kinematics::KinematicsQueryOptions& options)
+{
+  return computeCartesianPath(start_state, group, traj, link, waypoints, global_reference_frame, max_step,
+                              jump_threshold, CartesianPrecision(), validCallback, options);
+}
+
+double CartesianInterpolator::computeCartesianPath(RobotState* start_state, const JointModelGroup* group,
+                                                   std::vector<RobotStatePtr>& traj, const LinkModel* link,
+                                                   const EigenSTL::vector_Isometry3d& waypoints,
+                                                   bool global_reference_frame, const MaxEEFStep& max_step,
+                                                   const JumpThreshold& jump_threshold,
+                                                   const CartesianPrecision& precision,
+                                                   const GroupStateValidityCallbackFn& validCallback,
+                                                   const kinematics::KinematicsQueryOptions& options)
 {
   double percentage_solved = 0.0;
   for (std::size_t i = 0; i < waypoints.size(); ++i)
@@ -188,7 +314,7 @@ double CartesianInterpolator::computeCartesianPath(RobotState* start_state, cons
     std::vector<RobotStatePtr> waypoint_traj;
     double wp_percentage_solved =
         computeCartesianPath(start_state, group, waypoint_traj, link, waypoints[i], global_reference_frame, max_step,
-                             NO_JOINT_SPACE_JUMP_TEST, validCallback, options);
+                             NO_JOINT_SPACE_JUMP_TEST, precision, validCallback, options);
     if (fabs(wp_percentage_solved - 1.0) < std::numeric_limits<double>::epsilon())
     {
       percentage_solved = (double)(i + 1) / (double)waypoints.size();
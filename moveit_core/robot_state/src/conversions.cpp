@@ -39,6 +39,8 @@
 #include <geometric_shapes/shape_operations.h>
 #include <tf2_eigen/tf2_eigen.h>
 #include <boost/lexical_cast.hpp>
+#include <algorithm>
+#include <memory>
 #include "rclcpp/rclcpp.hpp"
 
 namespace moveit
@@ -63,7 +65,15 @@ static bool _jointStateToRobotState(const sensor_msgs::msg::JointState& joint_st
     return false;
   }
 
-  state.setVariableValues(joint_state);
+  // the variable indices of the names are only looked up when this thread sees a new message layout or robot model
+  thread_local std::weak_ptr<const RobotModel> mapping_model;
+  thread_local std::unique_ptr<VariableIndexMapping> mapping;
+  if (!mapping || mapping_model.lock() != state.getRobotModel())
+  {
+    mapping = std::make_unique<VariableIndexMapping>(*state.getRobotModel());
+    mapping_model = state.getRobotModel();
+  }
+  state.setVariableValues(joint_state, *mapping);
 
   return true;
 }
@@ -230,6 +240,42 @@ static void _attachedBodyToMsg(const AttachedBody& attached_body, moveit_msgs::m
   }
 }
 
+static bool _posesEqual(const std::vector<geometry_msgs::msg::Pose>& a, const std::vector<geometry_msgs::msg::Pose>& b)
+{
+  if (a.size() != b.size())
+    return false;
+  for (std::size_t i = 0; i < a.size(); ++i)
+  {
+    Eigen::Isometry3d pa, pb;
+    tf2::fromMsg(a[i], pa);
+    tf2::fromMsg(b[i], pb);
+    if (!pa.isApprox(pb, 1e-9))
+      return false;
+  }
+  return true;
+}
+
+// Whether attaching the object of the message would reproduce the attached body. Only messages in the frame of the
+// attached link, as created by robotStateToRobotStateMsg(), are recognized.
+static bool _attachedBodyMatchesMsg(const AttachedBody& attached_body,
+                                    const moveit_msgs::msg::AttachedCollisionObject& aco)
+{
+  if (aco.object.operation != moveit_msgs::msg::CollisionObject::ADD ||
+      aco.link_name != attached_body.getAttachedLinkName() || aco.object.header.frame_id != aco.link_name ||
+      std::set<std::string>(aco.touch_links.begin(), aco.touch_links.end()) != attached_body.getTouchLinks() ||
+      aco.detach_posture != attached_body.getDetachPosture())
+    return false;
+
+  moveit_msgs::msg::AttachedCollisionObject existing;
+  _attachedBodyToMsg(attached_body, existing);
+  return existing.object.primitives == aco.object.primitives && existing.object.meshes == aco.object.meshes &&
+         existing.object.planes == aco.object.planes && existing.object.subframe_names == aco.object.subframe_names &&
+         _posesEqual(existing.object.primitive_poses, aco.object.primitive_poses) &&
+         _posesEqual(existing.object.mesh_poses, aco.object.mesh_poses) &&
+         _posesEqual(existing.object.plane_poses, aco.object.plane_poses) &&
+         _posesEqual(existing.object.subframe_poses, aco.object.subframe_poses);
+}
+
 static void _msgToAttachedBody(const Transforms* tf, const moveit_msgs::msg::AttachedCollisionObject& aco,
                                RobotState& state)
 {
@@ -386,11 +432,29 @@ static bool _robotStateMsgToRobotStateHelper(const Transforms* tf, const moveit_
 
   if (valid && copy_attached_bodies)
   {
+    // bodies that the message describes unchanged are kept, so that their shapes are not rebuilt on every conversion
+    std::set<std::string> unchanged;
     if (!robot_state.is_diff)
-      state.clearAttachedBodies();
+    {
+      std::vector<const AttachedBody*> attached_bodies;
+      state.getAttachedBodies(attached_bodies);
+      for (const AttachedBody* attached_body : attached_bodies)
+      {
+        auto it = std::find_if(robot_state.attached_collision_objects.begin(),
+                               robot_state.attached_collision_objects.end(),
+                               [attached_body](const moveit_msgs::msg::AttachedCollisionObject& aco) {
+                                 return aco.object.id == attached_body->getName();
+                               });
+        if (it != robot_state.attached_collision_objects.end() && _attachedBodyMatchesMsg(*attached_body, *it))
+          unchanged.insert(attached_body->getName());
+        else
+          state.clearAttachedBody(attached_body->getName());
+      }
+    }
     for (const moveit_msgs::msg::AttachedCollisionObject& attached_collision_object :
          robot_state.attached_collision_objects)
-      _msgToAttachedBody(tf, attached_collision_object, state);
+      if (unchanged.erase(attached_collision_object.object.id) == 0)
+        _msgToAttachedBody(tf, attached_collision_object, state);
   }
 
   return valid;
@@ -452,21 +516,43 @@ void attachedBodiesToAttachedCollisionObjectMsgs(
 
 void robotStateToJointStateMsg(const RobotState& state, sensor_msgs::msg::JointState& joint_state)
 {
-  const std::vector<const JointModel*>& js = state.getRobotModel()->getSingleDOFJointModels();
-  joint_state = sensor_msgs::msg::JointState();
-
-  for (const JointModel* joint_model : js)
+  // the names and variable indices of the single-DOF joints are only gathered when this thread sees a new robot model
+  thread_local std::weak_ptr<const RobotModel> layout_model;
+  thread_local std::vector<std::string> names;
+  thread_local std::vector<int> indices;
+  if (layout_model.lock() != state.getRobotModel())
   {
-    joint_state.name.push_back(joint_model->getName());
-    joint_state.position.push_back(state.getVariablePosition(joint_model->getFirstVariableIndex()));
-    if (state.hasVelocities())
-      joint_state.velocity.push_back(state.getVariableVelocity(joint_model->getFirstVariableIndex()));
+    const std::vector<const JointModel*>& js = state.getRobotModel()->getSingleDOFJointModels();
+    names.clear();
+    indices.clear();
+    for (const JointModel* joint_model : js)
+    {
+      names.push_back(joint_model->getName());
+      indices.push_back(joint_model->getFirstVariableIndex());
+    }
+    layout_model = state.getRobotModel();
   }
 
-  // if inconsistent number of velocities are specified, discard them
-  if (joint_state.velocity.size() != joint_state.position.size())
+  // messages that are filled repeatedly keep their names, so only the values are copied
+  if (joint_state.name != names)
+    joint_state.name = names;
+  joint_state.position.resize(indices.size());
+  const double* positions = state.getVariablePositions();
+  for (std::size_t i = 0; i < indices.size(); ++i)
+    joint_state.position[i] = positions[indices[i]];
+
+  if (state.hasVelocities())
+  {
+    joint_state.velocity.resize(indices.size());
+    const double* velocities = state.getVariableVelocities();
+    for (std::size_t i = 0; i < indices.size(); ++i)
+      joint_state.velocity[i] = velocities[indices[i]];
+  }
+  else
     joint_state.velocity.clear();
+  joint_state.effort.clear();
 
+  joint_state.header = std_msgs::msg::Header();
   joint_state.header.frame_id = state.getRobotModel()->getModelFrame();
 }
 
@@ -44,8 +44,10 @@
 #include <moveit/backtrace/backtrace.h>
 #include <moveit/profiler/profiler.h>
 #include <moveit/macros/console_colors.h>
+#include <moveit/utils/memory_pool.h>
 #include <boost/bind.hpp>
 #include <moveit/robot_model/aabb.h>
+#include <algorithm>
 #include "rclcpp/rclcpp.hpp"
 
 namespace moveit
@@ -55,11 +57,72 @@ namespace core
 // Logger
 static const rclcpp::Logger LOGGER = rclcpp::get_logger("moveit_robot_state.robot_state");
 
+namespace
+{
+constexpr unsigned int EXTRA_ALIGNMENT_BYTES = EIGEN_MAX_ALIGN_BYTES - 1;
+
+// memory for the dirty joint transforms
+int getNrDoublesForDirtyJointTransforms(const RobotModel& robot_model)
+{
+  return 1 + robot_model.getJointModelCount() / (sizeof(double) / sizeof(unsigned char));
+}
+
+// Rotate the columns a and b of a transform by the rotation whose cosine and sine are c and s
+inline void rotateColumns(Eigen::Isometry3d& transform, int a, int b, double c, double s)
+{
+  double* col_a = transform.data() + 4 * a;  // column-major 4x4
+  double* col_b = transform.data() + 4 * b;
+  for (int row = 0; row < 3; ++row)
+  {
+    const double va = col_a[row];
+    const double vb = col_b[row];
+    col_a[row] = c * va + s * vb;
+    col_b[row] = c * vb - s * va;
+  }
+}
+
+// Multiply the joint frame \e transform in place by the transform of its joint, of the given type
+inline void applyJointTransform(RobotModel::LinkTransformType type, const Eigen::Isometry3d& joint_transform,
+                                Eigen::Isometry3d& transform)
+{
+  const Eigen::Matrix4d& j = joint_transform.matrix();
+  switch (type)
+  {
+    case RobotModel::FIXED_LINK_TRANSFORM:
+      break;
+    case RobotModel::REVOLUTE_X_LINK_TRANSFORM:
+      rotateColumns(transform, 1, 2, j(1, 1), j(2, 1));
+      break;
+    case RobotModel::REVOLUTE_Y_LINK_TRANSFORM:
+      rotateColumns(transform, 2, 0, j(2, 2), j(0, 2));
+      break;
+    case RobotModel::REVOLUTE_Z_LINK_TRANSFORM:
+      rotateColumns(transform, 0, 1, j(0, 0), j(1, 0));
+      break;
+    case RobotModel::PRISMATIC_LINK_TRANSFORM:
+      transform.translation() += transform.linear() * joint_transform.translation();
+      break;
+    default:
+      transform = transform * joint_transform;
+      break;
+  }
+}
+
+std::size_t getStateMemorySize(const RobotModel& robot_model)
+{
+  return sizeof(Eigen::Isometry3d) * (robot_model.getJointModelCount() + robot_model.getLinkModelCount() +
+                                      robot_model.getLinkGeometryCount()) +
+         sizeof(double) * (robot_model.getVariableCount() * 3 + getNrDoublesForDirtyJointTransforms(robot_model)) +
+         EXTRA_ALIGNMENT_BYTES;
+}
+}  // namespace
+
 RobotState::RobotState(const RobotModelConstPtr& robot_model)
   : robot_model_(robot_model)
   , has_velocity_(false)
   , has_acceleration_(false)
   , has_effort_(false)
+  , lazy_link_transforms_(false)
   , dirty_link_transforms_(robot_model_->getRootJoint())
   , dirty_collision_body_transforms_(nullptr)
   , rng_(nullptr)
@@ -78,7 +141,7 @@ RobotState::RobotState(const RobotState& other) : rng_(nullptr)
 RobotState::~RobotState()
 {
   clearAttachedBodies();
-  free(memory_);
+  freeCachedBlock(memory_, getStateMemorySize(*robot_model_));
   if (rng_)
     delete rng_;
 }
@@ -88,21 +151,14 @@ void RobotState::allocMemory()
   static_assert((sizeof(Eigen::Isometry3d) / EIGEN_MAX_ALIGN_BYTES) * EIGEN_MAX_ALIGN_BYTES == sizeof(Eigen::Isometry3d),
                 "sizeof(Eigen::Isometry3d) should be a multiple of EIGEN_MAX_ALIGN_BYTES");
 
-  constexpr unsigned int extra_alignment_bytes = EIGEN_MAX_ALIGN_BYTES - 1;
-  // memory for the dirty joint transforms
-  const int nr_doubles_for_dirty_joint_transforms =
-      1 + robot_model_->getJointModelCount() / (sizeof(double) / sizeof(unsigned char));
-  const size_t bytes =
-      sizeof(Eigen::Isometry3d) * (robot_model_->getJointModelCount() + robot_model_->getLinkModelCount() +
-                                   robot_model_->getLinkGeometryCount()) +
-      sizeof(double) * (robot_model_->getVariableCount() * 3 + nr_doubles_for_dirty_joint_transforms) +
-      extra_alignment_bytes;
-  memory_ = malloc(bytes);
+  const int nr_doubles_for_dirty_joint_transforms = getNrDoublesForDirtyJointTransforms(*robot_model_);
+  // states are frequently created and destroyed in bulk by planners, so reuse memory blocks of released states
+  memory_ = allocateCachedBlock(getStateMemorySize(*robot_model_));
 
   // make the memory for transforms align at EIGEN_MAX_ALIGN_BYTES
   // https://eigen.tuxfamily.org/dox/classEigen_1_1aligned__allocator.html
-  variable_joint_transforms_ = reinterpret_cast<Eigen::Isometry3d*>(((uintptr_t)memory_ + extra_alignment_bytes) &
-                                                                    ~(uintptr_t)extra_alignment_bytes);
+  variable_joint_transforms_ = reinterpret_cast<Eigen::Isometry3d*>(((uintptr_t)memory_ + EXTRA_ALIGNMENT_BYTES) &
+                                                                    ~(uintptr_t)EXTRA_ALIGNMENT_BYTES);
   global_link_transforms_ = variable_joint_transforms_ + robot_model_->getJointModelCount();
   global_collision_body_transforms_ = global_link_transforms_ + robot_model_->getLinkModelCount();
   dirty_joint_transforms_ =
@@ -116,8 +172,7 @@ void RobotState::allocMemory()
 void RobotState::initTransforms()
 {
   // mark all transforms as dirty
-  const int nr_doubles_for_dirty_joint_transforms =
-      1 + robot_model_->getJointModelCount() / (sizeof(double) / sizeof(unsigned char));
+  const int nr_doubles_for_dirty_joint_transforms = getNrDoublesForDirtyJointTransforms(*robot_model_);
   memset(dirty_joint_transforms_, 1, sizeof(double) * nr_doubles_for_dirty_joint_transforms);
 
   // initialize last row of transformation matrices, which will not be modified by transform updates anymore
@@ -139,6 +194,7 @@ void RobotState::copyFrom(const RobotState& other)
   has_velocity_ = other.has_velocity_;
   has_acceleration_ = other.has_acceleration_;
   has_effort_ = other.has_effort_;
+  lazy_link_transforms_ = other.lazy_link_transforms_;
 
   dirty_collision_body_transforms_ = other.dirty_collision_body_transforms_;
   dirty_link_transforms_ = other.dirty_link_transforms_;
@@ -359,6 +415,20 @@ void RobotState::setVariablePositions(const double* position)
   dirty_link_transforms_ = robot_model_->getRootJoint();
 }
 
+void RobotState::copyPositionsFrom(const RobotState& other, const JointModelGroup* group)
+{
+  assert(robot_model_ == other.robot_model_);  // checked only in debug mode
+  const std::vector<int>& il = group->getVariableIndexList();
+  if (group->isContiguousWithinState())
+    memcpy(position_ + il[0], other.position_ + il[0], group->getVariableCount() * sizeof(double));
+  else
+  {
+    for (int index : il)
+      position_[index] = other.position_[index];
+  }
+  updateMimicJoints(group);
+}
+
 void RobotState::setVariablePositions(const std::map<std::string, double>& variable_map)
 {
   for (const std::pair<const std::string, double>& it : variable_map)
@@ -402,6 +472,34 @@ void RobotState::setVariablePositions(const std::vector<std::string>& variable_n
   }
 }
 
+void RobotState::setVariableValues(const sensor_msgs::msg::JointState& msg, VariableIndexMapping& mapping)
+{
+  assert(&mapping.getRobotModel() == robot_model_.get());
+  const std::vector<int>& indices = mapping.getVariableIndices(msg.name);
+  for (std::size_t i = 0; i < indices.size(); ++i)
+    if (indices[i] < 0)
+      throw Exception("Variable '" + msg.name[i] + "' is not known to model '" + robot_model_->getName() + "'");
+
+  if (!msg.position.empty())
+  {
+    assert(msg.position.size() == indices.size());
+    for (std::size_t i = 0; i < indices.size(); ++i)
+    {
+      position_[indices[i]] = msg.position[i];
+      const JointModel* jm = robot_model_->getJointOfVariable(indices[i]);
+      markDirtyJointTransforms(jm);
+      updateMimicJoint(jm);
+    }
+  }
+  if (!msg.velocity.empty())
+  {
+    markVelocity();
+    assert(msg.velocity.size() == indices.size());
+    for (std::size_t i = 0; i < indices.size(); ++i)
+      velocity_[indices[i]] = msg.velocity[i];
+  }
+}
+
 void RobotState::setVariableVelocities(const std::map<std::string, double>& variable_map)
 {
   markVelocity();
@@ -505,6 +603,21 @@ void RobotState::setJointGroupPositions(const JointModelGroup* group, const doub
   updateMimicJoints(group);
 }
 
+void RobotState::setJointGroupPositionsIfChanged(const JointModelGroup* group, const double* gstate)
+{
+  for (const JointModel* jm : group->getActiveJointModels())
+  {
+    const double* values = gstate + group->getJointVariableGroupIndex(jm);
+    double* positions = position_ + jm->getFirstVariableIndex();
+    const std::size_t count = jm->getVariableCount();
+    if (std::equal(values, values + count, positions))
+      continue;
+    memcpy(positions, values, count * sizeof(double));
+    markDirtyJointTransforms(jm);
+    updateMimicJoint(jm);
+  }
+}
+
 void RobotState::setJointGroupPositions(const JointModelGroup* group, const Eigen::VectorXd& values)
 {
   const std::vector<int>& il = group->getVariableIndexList();
@@ -664,38 +777,61 @@ void RobotState::updateLinkTransforms()
   }
 }
 
-void RobotState::updateLinkTransformsInternal(const JointModel* start)
+inline void RobotState::updateLinkTransform(const LinkModel* link)
 {
-  for (const LinkModel* link : start->getDescendantLinkModels())
+  int idx_link = link->getLinkIndex();
+  const LinkModel* parent = link->getParentLinkModel();
+  const RobotModel::LinkTransformType type = robot_model_->getLinkTransformType(idx_link);
+  if (parent && type != RobotModel::GENERIC_LINK_TRANSFORM)
+  {
+    // the joint frame, multiplied in place by the joint transform without a full matrix product
+    Eigen::Isometry3d& link_transform = global_link_transforms_[idx_link];
+    if (link->jointOriginTransformIsIdentity())
+      link_transform = global_link_transforms_[parent->getLinkIndex()];
+    else
+      link_transform.affine().noalias() =
+          global_link_transforms_[parent->getLinkIndex()].affine() * link->getJointOriginTransform().matrix();
+    if (type != RobotModel::FIXED_LINK_TRANSFORM)
+      applyJointTransform(type, getJointTransform(link->getParentJointModel()), link_transform);
+  }
+  else if (parent)  // root JointModel will not have a parent
+  {
+    int idx_parent = parent->getLinkIndex();
+    if (link->jointOriginTransformIsIdentity())  // Link has identity transform
+      global_link_transforms_[idx_link].affine().noalias() =
+          global_link_transforms_[idx_parent].affine() * getJointTransform(link->getParentJointModel()).matrix();
+    else  // Link has non-identity transform
+      global_link_transforms_[idx_link].affine().noalias() =
+          global_link_transforms_[idx_parent].affine() * link->getJointOriginTransform().matrix() *
+          getJointTransform(link->getParentJointModel()).matrix();
+  }
+  else  // is the origin / root / 'model frame'
+  {
+    if (link->jointOriginTransformIsIdentity())
+      global_link_transforms_[idx_link] = getJointTransform(link->getParentJointModel());
+    else
+      global_link_transforms_[idx_link].affine().noalias() =
+          link->getJointOriginTransform().affine() * getJointTransform(link->getParentJointModel()).matrix();
+  }
+}
+
+bool RobotState::updateLinkTransformChain(const LinkModel* link)
+{
+  // the links above the dirty root are up to date, so the chain is computed from the top once it is found
+  if (link->getParentJointModel() != dirty_link_transforms_)
   {
-    int idx_link = link->getLinkIndex();
     const LinkModel* parent = link->getParentLinkModel();
-    if (parent)  // root JointModel will not have a parent
-    {
-      int idx_parent = parent->getLinkIndex();
-      if (link->parentJointIsFixed())  // fixed joint
-        global_link_transforms_[idx_link].affine().noalias() =
-            global_link_transforms_[idx_parent].affine() * link->getJointOriginTransform().matrix();
-      else  // non-fixed joint
-      {
-        if (link->jointOriginTransformIsIdentity())  // Link has identity transform
-          global_link_transforms_[idx_link].affine().noalias() =
-              global_link_transforms_[idx_parent].affine() * getJointTransform(link->getParentJointModel()).matrix();
-        else  // Link has non-identity transform
-          global_link_transforms_[idx_link].affine().noalias() =
-              global_link_transforms_[idx_parent].affine() * link->getJointOriginTransform().matrix() *
-              getJointTransform(link->getParentJointModel()).matrix();
-      }
-    }
-    else  // is the origin / root / 'model frame'
-    {
-      if (link->jointOriginTransformIsIdentity())
-        global_link_transforms_[idx_link] = getJointTransform(link->getParentJointModel());
-      else
-        global_link_transforms_[idx_link].affine().noalias() =
-            link->getJointOriginTransform().affine() * getJointTransform(link->getParentJointModel()).matrix();
-    }
+    if (!parent || !updateLinkTransformChain(parent))
+      return false;
   }
+  updateLinkTransform(link);
+  return true;
+}
+
+void RobotState::updateLinkTransformsInternal(const JointModel* start)
+{
+  for (const LinkModel* link : start->getDescendantLinkModels())
+    updateLinkTransform(link);
 
   // update attached bodies tf; these are usually very few, so we update them all
   for (std::map<std::string, AttachedBody*>::const_iterator it = attached_body_map_.begin();
@@ -734,8 +870,7 @@ void RobotState::updateStateWithLinkAt(const LinkModel* link, const Eigen::Isome
       // update the transform of the parent
       global_link_transforms_[parent_link->getLinkIndex()] =
           global_link_transforms_[child_link->getLinkIndex()] *
-          (child_link->getJointOriginTransform() *
-           variable_joint_transforms_[child_link->getParentJointModel()->getJointIndex()])
+          (child_link->getJointOriginTransform() * getJointTransform(child_link->getParentJointModel()))
               .inverse();
 
       // update link transforms for descendant links only (leaving the transform for the current link untouched)
@@ -755,6 +890,63 @@ void RobotState::updateStateWithLinkAt(const LinkModel* link, const Eigen::Isome
     it->second->computeTransform(global_link_transforms_[it->second->getAttachedLink()->getLinkIndex()]);
 }
 
+void RobotState::computeGroupLinkTransforms(const JointModelGroup* group, const double* group_positions,
+                                            std::size_t state_count, double* link_transforms)
+{
+  // links that are not affected by the group are taken from this state
+  updateLinkTransforms();
+
+  const std::vector<int>& il = group->getVariableIndexList();
+  const std::vector<const LinkModel*>& links = group->getUpdatedLinkModels();
+  const std::size_t group_variable_count = il.size();
+
+  // scratch buffers shared by all states of the batch: no per-state allocation or dirty-flag bookkeeping
+  std::vector<double> positions(position_, position_ + robot_model_->getVariableCount());
+  EigenSTL::vector_Isometry3d link_tf(global_link_transforms_,
+                                      global_link_transforms_ + robot_model_->getLinkModelCount());
+  Eigen::Isometry3d joint_tf = Eigen::Isometry3d::Identity();
+
+  for (std::size_t s = 0; s < state_count; ++s)
+  {
+    const double* gstate = group_positions + s * group_variable_count;
+    for (std::size_t i = 0; i < group_variable_count; ++i)
+      positions[il[i]] = gstate[i];
+    for (const JointModel* jm : group->getMimicJointModels())
+      positions[jm->getFirstVariableIndex()] =
+          jm->getMimicFactor() * positions[jm->getMimic()->getFirstVariableIndex()] + jm->getMimicOffset();
+
+    // updated links are sorted by index, so parent transforms are always computed before their children
+    for (const LinkModel* link : links)
+    {
+      const JointModel* joint = link->getParentJointModel();
+      const LinkModel* parent = link->getParentLinkModel();
+      Eigen::Isometry3d& tf = link_tf[link->getLinkIndex()];
+      if (!parent)
+        tf = link->getJointOriginTransform();
+      else if (link->jointOriginTransformIsIdentity())
+        tf = link_tf[parent->getLinkIndex()];
+      else
+        tf.affine().noalias() = link_tf[parent->getLinkIndex()].affine() * link->getJointOriginTransform().matrix();
+
+      const RobotModel::LinkTransformType type = robot_model_->getLinkTransformType(link->getLinkIndex());
+      if (type != RobotModel::FIXED_LINK_TRANSFORM)
+      {
+        joint->computeTransform(&positions[joint->getFirstVariableIndex()], joint_tf);
+        applyJointTransform(type, joint_tf, tf);
+      }
+    }
+
+    double* out = link_transforms + s;
+    for (const LinkModel* link : links)
+    {
+      const double* m = link_tf[link->getLinkIndex()].data();  // column-major 4x4
+      for (int col = 0; col < 4; ++col)
+        for (int row = 0; row < 3; ++row, out += state_count)
+          *out = m[col * 4 + row];
+    }
+  }
+}
+
 bool RobotState::satisfiesBounds(double margin) const
 {
   const std::vector<const JointModel*>& jm = robot_model_->getActiveJointModels();
@@ -766,10 +958,19 @@ bool RobotState::satisfiesBounds(double margin) const
 
 bool RobotState::satisfiesBounds(const JointModelGroup* group, double margin) const
 {
-  const std::vector<const JointModel*>& jm = group->getActiveJointModels();
-  for (const JointModel* joint : jm)
-    if (!satisfiesBounds(joint, margin))
+  for (const JointModelGroup::PositionBoundsEntry& entry : group->getPositionBoundsTable())
+  {
+    if (entry.type == JointModelGroup::JOINT_BOUNDS)
+    {
+      if (!satisfiesPositionBounds(entry.joint, margin))
+        return false;
+    }
+    else if (!JointModelGroup::satisfiesVariablePositionBounds(entry.type, entry.joint->getVariableBounds()[0],
+                                                               position_[entry.state_index], margin))
+      return false;
+    if (has_velocity_ && !satisfiesVelocityBounds(entry.joint, margin))
       return false;
+  }
   return true;
 }
 
@@ -782,9 +983,19 @@ void RobotState::enforceBounds()
 
 void RobotState::enforceBounds(const JointModelGroup* joint_group)
 {
-  const std::vector<const JointModel*>& jm = joint_group->getActiveJointModels();
-  for (const JointModel* joint : jm)
-    enforceBounds(joint);
+  for (const JointModelGroup::PositionBoundsEntry& entry : joint_group->getPositionBoundsTable())
+  {
+    if (entry.type == JointModelGroup::JOINT_BOUNDS)
+      enforcePositionBounds(entry.joint);
+    else if (JointModelGroup::enforceVariablePositionBounds(entry.type, entry.joint->getVariableBounds()[0],
+                                                            position_[entry.state_index]))
+    {
+      markDirtyJointTransforms(entry.joint);
+      updateMimicJoint(entry.joint);
+    }
+    if (has_velocity_)
+      enforceVelocityBounds(entry.joint);
+  }
 }
 
 void RobotState::harmonizePositions()
@@ -1225,6 +1436,37 @@ Eigen::MatrixXd RobotState::getJacobian(const JointModelGroup* group,
 bool RobotState::getJacobian(const JointModelGroup* group, const LinkModel* link,
                              const Eigen::Vector3d& reference_point_position, Eigen::MatrixXd& jacobian,
                              bool use_quaternion_representation) const
+{
+  int rows = use_quaternion_representation ? 7 : 6;
+  int columns = group->getVariableCount();
+  jacobian = Eigen::MatrixXd::Zero(rows, columns);
+  if (!computeJacobian(group, link, reference_point_position, jacobian.topRows<6>()))
+    return false;
+
+  if (use_quaternion_representation)
+  {  // Quaternion representation
+    // From "Advanced Dynamics and Motion Simulation" by Paul Mitiguy
+    // d/dt ( [w] ) = 1/2 * [ -x -y -z ]  * [ omega_1 ]
+    //        [x]           [  w -z  y ]    [ omega_2 ]
+    //        [y]           [  z  w -x ]    [ omega_3 ]
+    //        [z]           [ -y  x  w ]
+    const moveit::core::LinkModel* root_link_model = group->getJointModels()[0]->getParentLinkModel();
+    // getGlobalLinkTransform() returns a valid isometry by contract
+    Eigen::Isometry3d link_transform = getGlobalLinkTransform(link);
+    if (root_link_model)
+      link_transform = getGlobalLinkTransform(root_link_model).inverse() * link_transform;
+    Eigen::Quaterniond q(link_transform.linear());
+    double w = q.w(), x = q.x(), y = q.y(), z = q.z();
+    Eigen::MatrixXd quaternion_update_matrix(4, 3);
+    quaternion_update_matrix << -x, -y, -z, w, -z, y, z, w, -x, -y, x, w;
+    jacobian.block(3, 0, 4, columns) = 0.5 * quaternion_update_matrix * jacobian.block(3, 0, 3, columns);
+  }
+  return true;
+}
+
+bool RobotState::computeJacobian(const JointModelGroup* group, const LinkModel* link,
+                                 const Eigen::Vector3d& reference_point_position,
+                                 Eigen::Ref<Eigen::Matrix<double, 6, Eigen::Dynamic>> jacobian) const
 {
   BOOST_VERIFY(checkLinkTransforms());
 
@@ -1234,78 +1476,65 @@ bool RobotState::getJacobian(const JointModelGroup* group, const LinkModel* link
     return false;
   }
 
-  if (!group->isLinkUpdated(link->getName()))
+  // the updated links are sorted by index
+  const std::vector<const LinkModel*>& updated_links = group->getUpdatedLinkModels();
+  if (!std::binary_search(updated_links.begin(), updated_links.end(), link,
+                          [](const LinkModel* a, const LinkModel* b) { return a->getLinkIndex() < b->getLinkIndex(); }))
   {
     RCLCPP_ERROR(LOGGER, "Link name '%s' does not exist in the chain '%s' or is not a child for this chain",
                  link->getName().c_str(), group->getName().c_str());
     return false;
   }
 
+  if (jacobian.cols() != static_cast<Eigen::Index>(group->getVariableCount()))
+  {
+    RCLCPP_ERROR(LOGGER, "The Jacobian of group '%s' has %u columns, not %d", group->getName().c_str(),
+                 group->getVariableCount(), static_cast<int>(jacobian.cols()));
+    return false;
+  }
+
   const moveit::core::JointModel* root_joint_model = group->getJointModels()[0];  // group->getJointRoots()[0];
   const moveit::core::LinkModel* root_link_model = root_joint_model->getParentLinkModel();
   // getGlobalLinkTransform() returns a valid isometry by contract
-  Eigen::Isometry3d reference_transform =
+  const Eigen::Isometry3d reference_transform =
       root_link_model ? getGlobalLinkTransform(root_link_model).inverse() : Eigen::Isometry3d::Identity();
-  int rows = use_quaternion_representation ? 7 : 6;
-  int columns = group->getVariableCount();
-  jacobian = Eigen::MatrixXd::Zero(rows, columns);
+  jacobian.setZero();
 
   // getGlobalLinkTransform() returns a valid isometry by contract
-  Eigen::Isometry3d link_transform = reference_transform * getGlobalLinkTransform(link);  // valid isometry
-  Eigen::Vector3d point_transform = link_transform * reference_point_position;
-
-  /*
-  RCLCPP_DEBUG(LOGGER, "Point from reference origin expressed in world coordinates: %f %f %f",
-           point_transform.x(),
-           point_transform.y(),
-           point_transform.z());
-  */
+  const Eigen::Vector3d point_transform =
+      reference_transform * (getGlobalLinkTransform(link) * reference_point_position);
 
   Eigen::Vector3d joint_axis;
   Eigen::Isometry3d joint_transform;
 
   while (link)
   {
-    /*
-    RCLCPP_DEBUG(LOGGER, "Link: %s, %f %f %f",link_state->getName().c_str(),
-             link_state->getGlobalLinkTransform().translation().x(),
-             link_state->getGlobalLinkTransform().translation().y(),
-             link_state->getGlobalLinkTransform().translation().z());
-    RCLCPP_DEBUG(LOGGER, "Joint: %s",link_state->getParentJointState()->getName().c_str());
-    */
     const JointModel* pjm = link->getParentJointModel();
-    if (pjm->getVariableCount() > 0)
+    const int joint_index = group->getJointVariableGroupIndex(pjm);
+    if (joint_index >= 0)
     {
-      if (!group->hasJointModel(pjm->getName()))
-      {
-        link = pjm->getParentLinkModel();
-        continue;
-      }
-      unsigned int joint_index = group->getVariableGroupIndex(pjm->getName());
       // getGlobalLinkTransform() returns a valid isometry by contract
       joint_transform = reference_transform * getGlobalLinkTransform(link);  // valid isometry
       if (pjm->getType() == moveit::core::JointModel::REVOLUTE)
       {
         joint_axis = joint_transform.linear() * static_cast<const moveit::core::RevoluteJointModel*>(pjm)->getAxis();
-        jacobian.block<3, 1>(0, joint_index) =
-            jacobian.block<3, 1>(0, joint_index) + joint_axis.cross(point_transform - joint_transform.translation());
-        jacobian.block<3, 1>(3, joint_index) = jacobian.block<3, 1>(3, joint_index) + joint_axis;
+        jacobian.block<3, 1>(0, joint_index) += joint_axis.cross(point_transform - joint_transform.translation());
+        jacobian.block<3, 1>(3, joint_index) += joint_axis;
       }
       else if (pjm->getType() == moveit::core::JointModel::PRISMATIC)
       {
         joint_axis = joint_transform.linear() * static_cast<const moveit::core::PrismaticJointModel*>(pjm)->getAxis();
-        jacobian.block<3, 1>(0, joint_index) = jacobian.block<3, 1>(0, joint_index) + joint_axis;
+        jacobian.block<3, 1>(0, joint_index) += joint_axis;
       }
       else if (pjm->getType() == moveit::core::JointModel::PLANAR)
       {
         joint_axis = joint_transform * Eigen::Vector3d(1.0, 0.0, 0.0);
-        jacobian.block<3, 1>(0, joint_index) = jacobian.block<3, 1>(0, joint_index) + joint_axis;
+        jacobian.block<3, 1>(0, joint_index) += joint_axis;
         joint_axis = joint_transform * Eigen::Vector3d(0.0, 1.0, 0.0);
-        jacobian.block<3, 1>(0, joint_index + 1) = jacobian.block<3, 1>(0, joint_index + 1) + joint_axis;
+        jacobian.block<3, 1>(0, joint_index + 1) += joint_axis;
         joint_axis = joint_transform * Eigen::Vector3d(0.0, 0.0, 1.0);
-        jacobian.block<3, 1>(0, joint_index + 2) = jacobian.block<3, 1>(0, joint_index + 2) +
-                                                   joint_axis.cross(point_transform - joint_transform.translation());
-        jacobian.block<3, 1>(3, joint_index + 2) = jacobian.block<3, 1>(3, joint_index + 2) + joint_axis;
+        jacobian.block<3, 1>(0, joint_index + 2) += joint_axis.cross(point_transform - joint_transform.translation());
+        jacobian.block<3, 1>(3, joint_index + 2) += joint_axis;
       }
       else
         RCLCPP_ERROR(LOGGER, "Unknown type of joint in Jacobian computation");
@@ -1314,19 +1543,6 @@ bool RobotState::getJacobian(const JointModelGroup* group, const LinkModel* link
       break;
     link = pjm->getParentLinkModel();
   }
-  if (use_quaternion_representation)
-  {  // Quaternion representation
-    // From "Advanced Dynamics and Motion Simulation" by Paul Mitiguy
-    // d/dt ( [w] ) = 1/2 * [ -x -y -z ]  * [ omega_1 ]
-    //        [x]           [  w -z  y ]    [ omega_2 ]
-    //        [y]           [  z  w -x ]    [ omega_3 ]
-    //        [z]           [ -y  x  w ]
-    Eigen::Quaterniond q(link_transform.linear());
-    double w = q.w(), x = q.x(), y = q.y(), z = q.z();
-    Eigen::MatrixXd quaternion_update_matrix(4, 3);
-    quaternion_update_matrix << -x, -y, -z, w, -z, y, z, w, -x, -y, x, w;
-    jacobian.block(3, 0, 4, columns) = 0.5 * quaternion_update_matrix * jacobian.block(3, 0, 3, columns);
-  }
   return true;
 }
 
@@ -1743,6 +1959,34 @@ bool RobotState::setFromIK(const JointModelGroup* jmg, const EigenSTL::vector_Is
   std::vector<double> ik_sol;
   moveit_msgs::msg::MoveItErrorCodes error;
 
+  // analytic solvers compute every solution at once, so check them in order instead of searching
+  if (ik_queries.size() == 1 && solver->providesAllPositionIK())
+  {
+    std::vector<std::vector<double> > ik_sols;
+    if (!solver->getAllPositionIK(ik_queries[0], seed, ik_sols, error, options))
+      return false;
+    for (const std::vector<double>& candidate : ik_sols)
+    {
+      bool consistent = true;
+      for (std::size_t i = 0; consistent && i < consistency_limits.size(); ++i)
+        consistent = fabs(candidate[i] - seed[i]) <= consistency_limits[i];
+      if (!consistent)
+        continue;
+      if (ik_callback_fn)
+      {
+        ik_callback_fn(ik_queries[0], candidate, error);
+        if (error.val != moveit_msgs::msg::MoveItErrorCodes::SUCCESS)
+          continue;
+      }
+      std::vector<double> solution(bij.size());
+      for (std::size_t i = 0; i < bij.size(); ++i)
+        solution[bij[i]] = candidate[i];
+      setJointGroupPositions(jmg, solution);
+      return true;
+    }
+    return false;
+  }
+
   if (solver->searchPositionIK(ik_queries, seed, timeout, consistency_limits, ik_sol, ik_callback_fn, error, options,
                                this))
   {
@@ -106,6 +106,37 @@ TEST_F(Timing, stateUpdate)
   }
 }
 
+TEST_F(Timing, batchedGroupUpdate)
+{
+  moveit::core::RobotModelPtr model = moveit::core::loadTestingRobotModel("pr2");
+  ASSERT_TRUE(bool(model));
+  const moveit::core::JointModelGroup* group = model->getJointModelGroup("right_arm");
+  ASSERT_TRUE(group);
+  moveit::core::RobotState state(model);
+  state.setToDefaultValues();
+
+  const std::size_t count = 1e5;
+  const std::size_t nvar = group->getVariableCount();
+  std::vector<double> positions(count * nvar);
+  for (std::size_t s = 0; s < count; ++s)
+    group->getVariableRandomPositions(state.getRandomNumberGenerator(), &positions[s * nvar]);
+  std::vector<double> soa(12 * group->getUpdatedLinkModels().size() * count);
+
+  double gold_standard = 0;
+  {
+    ScopedTimer t("RobotState group updates: ", &gold_standard);
+    for (std::size_t s = 0; s < count; ++s)
+    {
+      state.setJointGroupPositions(group, &positions[s * nvar]);
+      state.updateLinkTransforms();
+    }
+  }
+  {
+    ScopedTimer t("RobotState batched group updates: ", &gold_standard);
+    state.computeGroupLinkTransforms(group, positions.data(), count, soa.data());
+  }
+}
+
 TEST_F(Timing, multiply)
 {
   size_t runs = 1e7;
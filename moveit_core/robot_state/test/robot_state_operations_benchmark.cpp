@@ -0,0 +1,278 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, PickNik LLC
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik LLC nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include <moveit/robot_model/robot_model.h>
+#include <moveit/robot_state/robot_state.h>
+#include <moveit/kinematics_base/kinematics_base.h>
+#include <moveit/utils/robot_model_test_utils.h>
+#include <random_numbers/random_numbers.h>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <gtest/gtest.h>
+
+// Count the heap allocations of the benchmarked operations by interposing the allocation functions of glibc, which
+// also covers operator new and the memory blocks of RobotState
+static std::atomic<std::size_t> ALLOCATION_COUNT(0);
+
+#ifdef __GLIBC__
+extern "C" {
+void* __libc_malloc(std::size_t size);
+void* __libc_calloc(std::size_t count, std::size_t size);
+void* __libc_realloc(void* ptr, std::size_t size);
+
+void* malloc(std::size_t size) noexcept
+{
+  ALLOCATION_COUNT.fetch_add(1, std::memory_order_relaxed);
+  return __libc_malloc(size);
+}
+
+void* calloc(std::size_t count, std::size_t size) noexcept
+{
+  ALLOCATION_COUNT.fetch_add(1, std::memory_order_relaxed);
+  return __libc_calloc(count, size);
+}
+
+void* realloc(void* ptr, std::size_t size) noexcept
+{
+  ALLOCATION_COUNT.fetch_add(1, std::memory_order_relaxed);
+  return __libc_realloc(ptr, size);
+}
+}
+#endif
+
+/** \brief The number of calls each operation is timed with */
+static const std::size_t RUNS = 10000;
+
+/** \brief A solver that returns the seed as solution, so that setFromIK() is measured without the cost of solving */
+class SeedKinematicsSolver : public kinematics::KinematicsBase
+{
+public:
+  SeedKinematicsSolver(const moveit::core::JointModelGroup* jmg)
+  {
+    storeValues(jmg->getParentModel(), jmg->getName(), jmg->getJointModels()[0]->getParentLinkModel()->getName(),
+                { jmg->getLinkModels().back()->getName() }, 0.1);
+    joint_names_ = jmg->getActiveJointModelNames();
+    link_names_ = jmg->getLinkModelNames();
+  }
+
+  bool getPositionIK(const geometry_msgs::msg::Pose& /*ik_pose*/, const std::vector<double>& ik_seed_state,
+                     std::vector<double>& solution, moveit_msgs::msg::MoveItErrorCodes& error_code,
+                     const kinematics::KinematicsQueryOptions& /*options*/) const override
+  {
+    solution = ik_seed_state;
+    error_code.val = error_code.SUCCESS;
+    return true;
+  }
+
+  bool searchPositionIK(const geometry_msgs::msg::Pose& ik_pose, const std::vector<double>& ik_seed_state,
+                        double timeout, std::vector<double>& solution, moveit_msgs::msg::MoveItErrorCodes& error_code,
+                        const kinematics::KinematicsQueryOptions& options) const override
+  {
+    return searchPositionIK(ik_pose, ik_seed_state, timeout, std::vector<double>(), solution, IKCallbackFn(),
+                            error_code, options);
+  }
+
+  bool searchPositionIK(const geometry_msgs::msg::Pose& ik_pose, const std::vector<double>& ik_seed_state,
+                        double timeout, const std::vector<double>& consistency_limits, std::vector<double>& solution,
+                        moveit_msgs::msg::MoveItErrorCodes& error_code,
+                        const kinematics::KinematicsQueryOptions& options) const override
+  {
+    return searchPositionIK(ik_pose, ik_seed_state, timeout, consistency_limits, solution, IKCallbackFn(), error_code,
+                            options);
+  }
+
+  bool searchPositionIK(const geometry_msgs::msg::Pose& ik_pose, const std::vector<double>& ik_seed_state,
+                        double timeout, std::vector<double>& solution, const IKCallbackFn& solution_callback,
+                        moveit_msgs::msg::MoveItErrorCodes& error_code,
+                        const kinematics::KinematicsQueryOptions& options) const override
+  {
+    return searchPositionIK(ik_pose, ik_seed_state, timeout, std::vector<double>(), solution, solution_callback,
+                            error_code, options);
+  }
+
+  bool searchPositionIK(const geometry_msgs::msg::Pose& ik_pose, const std::vector<double>& ik_seed_state,
+                        double /*timeout*/, const std::vector<double>& /*consistency_limits*/,
+                        std::vector<double>& solution, const IKCallbackFn& solution_callback,
+                        moveit_msgs::msg::MoveItErrorCodes& error_code,
+                        const kinematics::KinematicsQueryOptions& /*options*/) const override
+  {
+    solution = ik_seed_state;
+    error_code.val = error_code.SUCCESS;
+    if (solution_callback)
+      solution_callback(ik_pose, solution, error_code);
+    return error_code.val == error_code.SUCCESS;
+  }
+
+  bool getPositionFK(const std::vector<std::string>& /*link_names*/, const std::vector<double>& /*joint_angles*/,
+                     std::vector<geometry_msgs::msg::Pose>& /*poses*/) const override
+  {
+    return false;
+  }
+
+  const std::vector<std::string>& getJointNames() const override
+  {
+    return joint_names_;
+  }
+
+  const std::vector<std::string>& getLinkNames() const override
+  {
+    return link_names_;
+  }
+
+private:
+  std::vector<std::string> joint_names_;
+  std::vector<std::string> link_names_;
+};
+
+/** \brief Benchmarks the RobotState operations used by planners on a group of a robot model and a chain group (for
+ *  the Jacobian and IK) of the same model.
+ *
+ *  The time and the heap allocations per call are printed and recorded as test properties named
+ *  <model>_<operation>_ns and <model>_<operation>_allocations, which are part of the XML output of gtest. */
+class RobotStateOperationsBenchmark : public testing::Test
+{
+protected:
+  void benchmarkModel(const std::string& name, const moveit::core::RobotModelPtr& model, const std::string& group_name,
+                      const std::string& chain_name)
+  {
+    ASSERT_TRUE(bool(model));
+    const moveit::core::JointModelGroup* group = model->getJointModelGroup(group_name);
+    moveit::core::JointModelGroup* chain = model->getJointModelGroup(chain_name);
+    ASSERT_TRUE(group);
+    ASSERT_TRUE(chain);
+    ASSERT_TRUE(chain->isChain());
+    chain->setSolverAllocators(
+        [](const moveit::core::JointModelGroup* jmg) { return std::make_shared<SeedKinematicsSolver>(jmg); },
+        moveit::core::SolverAllocatorMapFn());
+
+    // random states and positions, the same for every run
+    random_numbers::RandomNumberGenerator rng(42);
+    moveit::core::RobotState state(model);
+    state.setToDefaultValues();
+    state.update();
+    std::vector<moveit::core::RobotState> states(2, state);
+    for (moveit::core::RobotState& s : states)
+    {
+      s.setToRandomPositions(group, rng);
+      s.update();
+    }
+    std::vector<std::vector<double>> positions(2);
+    for (std::size_t i = 0; i < positions.size(); ++i)
+      states[i].copyJointGroupPositions(group, positions[i]);
+    const moveit::core::LinkModel* tip = chain->getLinkModels().back();
+    const Eigen::Isometry3d tip_pose = states[0].getGlobalLinkTransform(tip);
+
+    benchmark(name, "copy", [&](std::size_t) { moveit::core::RobotState copy(state); });
+    benchmark(name, "setJointGroupPositions",
+              [&](std::size_t i) { state.setJointGroupPositions(group, positions[i % 2]); });
+    benchmark(name, "update", [&](std::size_t i) {
+      state.setJointGroupPositions(group, positions[i % 2]);
+      state.update();
+    });
+    Eigen::MatrixXd jacobian;
+    benchmark(name, "getJacobian",
+              [&](std::size_t) { state.getJacobian(chain, tip, Eigen::Vector3d::Zero(), jacobian, false); });
+    Eigen::Matrix<double, 6, Eigen::Dynamic> jacobian_storage;
+    benchmark(name, "getJacobian (caller storage)",
+              [&](std::size_t) { state.getJacobian(chain, tip, Eigen::Vector3d::Zero(), jacobian_storage); });
+    benchmark(name, "setFromIK", [&](std::size_t) { state.setFromIK(chain, tip_pose); });
+    moveit::core::RobotState interpolated(state);
+    benchmark(name, "interpolate",
+              [&](std::size_t i) { states[i % 2].interpolate(states[(i + 1) % 2], 0.5, interpolated, group); });
+    volatile double distance = 0.0;
+    benchmark(name, "distance", [&](std::size_t i) { distance = states[i % 2].distance(states[(i + 1) % 2], group); });
+    std::vector<double> out_of_bounds = positions[0];
+    for (double& position : out_of_bounds)
+      position += 10.0;
+    benchmark(name, "enforceBounds", [&](std::size_t) {
+      state.setJointGroupPositions(group, out_of_bounds);
+      state.enforceBounds(group);
+    });
+  }
+
+  void benchmark(const std::string& model, const std::string& operation, const std::function<void(std::size_t)>& op)
+  {
+    op(0);  // warm up caches
+    const std::size_t allocations = ALLOCATION_COUNT.load();
+    const auto start = std::chrono::steady_clock::now();
+    for (std::size_t i = 0; i < RUNS; ++i)
+      op(i);
+    const std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    const double allocations_per_call = double(ALLOCATION_COUNT.load() - allocations) / RUNS;
+
+    std::cerr << model << " " << operation << ": " << elapsed.count() / RUNS << "ns, " << allocations_per_call
+              << " allocations" << std::endl;
+    RecordProperty(model + "_" + operation + "_ns", static_cast<int>(elapsed.count() / RUNS));
+    RecordProperty(model + "_" + operation + "_allocations", static_cast<int>(allocations_per_call + 0.5));
+  }
+};
+
+TEST_F(RobotStateOperationsBenchmark, SixDof)
+{
+  moveit::core::RobotModelBuilder builder("arm", "base");
+  geometry_msgs::msg::Pose origin;
+  origin.position.z = 0.1;
+  origin.orientation.w = 1.0;
+  builder.addChain("base->link1->link2->link3->link4->link5->link6", "revolute",
+                   std::vector<geometry_msgs::msg::Pose>(6, origin));
+  for (const std::string& link : { "link1", "link2", "link3", "link4", "link5", "link6" })
+    builder.addCollisionBox(link, { 0.05, 0.05, 0.1 }, origin);
+  builder.addGroupChain("base", "link6", "arm");
+  ASSERT_TRUE(builder.isValid());
+  benchmarkModel("6dof", builder.build(), "arm", "arm");
+}
+
+TEST_F(RobotStateOperationsBenchmark, SevenDof)
+{
+  benchmarkModel("panda", moveit::core::loadTestingRobotModel("panda"), "panda_arm", "panda_arm");
+}
+
+TEST_F(RobotStateOperationsBenchmark, DualArm)
+{
+  benchmarkModel("pr2_arms", moveit::core::loadTestingRobotModel("pr2"), "arms", "right_arm");
+}
+
+TEST_F(RobotStateOperationsBenchmark, MobileManipulator)
+{
+  benchmarkModel("pr2_whole_body", moveit::core::loadTestingRobotModel("pr2"), "whole_body", "right_arm");
+}
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -35,8 +35,10 @@
 /* Author: Ioan Sucan */
 #include <moveit/robot_model/robot_model.h>
 #include <moveit/robot_state/robot_state.h>
+#include <moveit/robot_state/conversions.h>
 #include <moveit/utils/robot_model_test_utils.h>
 #include <urdf_parser/urdf_parser.h>
+#include <geometric_shapes/shapes.h>
 #include <tf2_geometry_msgs/tf2_geometry_msgs.h>
 #include <gtest/gtest.h>
 #include <sstream>
@@ -539,6 +541,231 @@ TEST_F(OneRobot, FK)
   EXPECT_NEAR_TRACED(state.getGlobalLinkTransform("link_e").translation(), Eigen::Vector3d(2.8, 0.6, 0));
 }
 
+TEST_F(OneRobot, batchedGroupLinkTransforms)
+{
+  const moveit::core::JointModelGroup* group = robot_model_->getJointModelGroup("base_from_base_to_e");
+  ASSERT_TRUE(group);
+  const std::vector<const moveit::core::LinkModel*>& links = group->getUpdatedLinkModels();
+
+  moveit::core::RobotState state(robot_model_);
+  state.setToDefaultValues();
+  moveit::core::RobotState reference(state);
+
+  const std::size_t count = 5;
+  const std::size_t nvar = group->getVariableCount();
+  std::vector<double> positions(count * nvar);
+  for (std::size_t s = 0; s < count; ++s)
+  {
+    reference.setToRandomPositions(group);
+    reference.copyJointGroupPositions(group, &positions[s * nvar]);
+  }
+
+  std::vector<double> soa(12 * links.size() * count);
+  state.computeGroupLinkTransforms(group, positions.data(), count, soa.data());
+
+  for (std::size_t s = 0; s < count; ++s)
+  {
+    reference.setJointGroupPositions(group, &positions[s * nvar]);
+    for (std::size_t k = 0; k < links.size(); ++k)
+    {
+      const Eigen::Isometry3d& expected = reference.getGlobalLinkTransform(links[k]);
+      for (int c = 0; c < 12; ++c)
+        EXPECT_NEAR(soa[(k * 12 + c) * count + s], expected.matrix()(c % 3, c / 3), 1e-9) << links[k]->getName();
+    }
+  }
+}
+
+TEST_F(OneRobot, linkTransformsMatchJointTransforms)
+{
+  moveit::core::RobotState state(robot_model_);
+  for (int i = 0; i < 10; ++i)
+  {
+    state.setToRandomPositions();
+    state.update();
+    for (const moveit::core::LinkModel* link : robot_model_->getLinkModels())
+    {
+      const moveit::core::JointModel* joint = link->getParentJointModel();
+      Eigen::Isometry3d expected = link->getJointOriginTransform() * state.getJointTransform(joint);
+      if (link->getParentLinkModel())
+        expected = state.getGlobalLinkTransform(link->getParentLinkModel()) * expected;
+      EXPECT_TRUE(state.getGlobalLinkTransform(link).isApprox(expected, 1e-12)) << link->getName();
+    }
+  }
+}
+
+TEST_F(OneRobot, lazyLinkTransformsMatchFullUpdate)
+{
+  moveit::core::RobotState state(robot_model_);
+  state.setLazyLinkTransforms(true);
+  for (int i = 0; i < 10; ++i)
+  {
+    state.setToRandomPositions();
+    moveit::core::RobotState reference(state);
+    reference.update();
+    for (const moveit::core::LinkModel* link : robot_model_->getLinkModels())
+      EXPECT_TRUE(state.getGlobalLinkTransform(link).isApprox(reference.getGlobalLinkTransform(link), 1e-12))
+          << link->getName();
+    // only the queried chains were computed, the state is still marked as dirty
+    EXPECT_TRUE(state.dirtyLinkTransforms());
+  }
+  state.update();
+  EXPECT_FALSE(state.dirtyLinkTransforms());
+}
+
+TEST_F(OneRobot, copyPositionsFrom)
+{
+  moveit::core::RobotState source(robot_model_);
+  source.setToRandomPositions();
+  source.update();
+  moveit::core::RobotState state(robot_model_);
+  state.setToDefaultValues();
+  state.setVariableVelocities(std::vector<double>(robot_model_->getVariableCount(), 0.5));
+  state.update();
+
+  const moveit::core::JointModelGroup* group = robot_model_->getJointModelGroup("mim_joints");
+  state.copyPositionsFrom(source, group);
+  EXPECT_TRUE(state.dirtyLinkTransforms());
+  for (const std::string& name : robot_model_->getVariableNames())
+  {
+    if (group->hasJointModel(robot_model_->getJointOfVariable(name)->getName()))
+      EXPECT_EQ(state.getVariablePosition(name), source.getVariablePosition(name)) << name;
+    EXPECT_EQ(state.getVariableVelocity(name), 0.5) << name;
+  }
+
+  state.copyPositionsFrom(source);
+  EXPECT_TRUE(state.hasVelocities());
+  state.update();
+  for (const moveit::core::LinkModel* link : robot_model_->getLinkModels())
+    EXPECT_TRUE(state.getGlobalLinkTransform(link).isApprox(source.getGlobalLinkTransform(link))) << link->getName();
+}
+
+TEST_F(OneRobot, setJointGroupPositionsIfChanged)
+{
+  const moveit::core::JointModelGroup* group = robot_model_->getJointModelGroup("base_from_joints");
+  moveit::core::RobotState state(robot_model_);
+  state.setToRandomPositions();
+  state.update();
+  std::vector<double> positions;
+  state.copyJointGroupPositions(group, positions);
+
+  // the same positions leave the transforms clean
+  state.setJointGroupPositionsIfChanged(group, positions.data());
+  EXPECT_FALSE(state.dirtyLinkTransforms());
+
+  moveit::core::RobotState reference(state);
+  positions.back() += 0.1;
+  state.setJointGroupPositionsIfChanged(group, positions.data());
+  reference.setJointGroupPositions(group, positions);
+  EXPECT_TRUE(state.dirtyLinkTransforms());
+  state.update();
+  reference.update();
+  for (const moveit::core::LinkModel* link : robot_model_->getLinkModels())
+    EXPECT_TRUE(state.getGlobalLinkTransform(link).isApprox(reference.getGlobalLinkTransform(link))) << link->getName();
+}
+
+TEST_F(OneRobot, groupBoundsMatchJointBounds)
+{
+  for (const std::string& group_name : { "base_from_joints", "mim_joints" })
+  {
+    const moveit::core::JointModelGroup* group = robot_model_->getJointModelGroup(group_name);
+    moveit::core::RobotState state(robot_model_);
+    state.setToDefaultValues();
+    std::vector<double> positions(robot_model_->getVariableCount(), 0.0);
+    for (std::size_t i = 0; i < positions.size(); ++i)
+      positions[i] = (i % 2 ? 1.0 : -1.0) * (4.0 + i);
+    state.setVariablePositions(positions);
+    state.update();
+
+    std::vector<double> group_positions;
+    state.copyJointGroupPositions(group, group_positions);
+    moveit::core::RobotState reference(state);
+    EXPECT_EQ(group->satisfiesPositionBounds(group_positions.data()), reference.satisfiesBounds(group)) << group_name;
+
+    // compare with the bounds enforced by the joint models
+    state.enforceBounds(group);
+    for (const moveit::core::JointModel* joint : group->getActiveJointModels())
+      reference.enforceBounds(joint);
+    EXPECT_TRUE(state.dirtyLinkTransforms());
+    EXPECT_TRUE(state.satisfiesBounds(group));
+    for (const std::string& name : robot_model_->getVariableNames())
+      EXPECT_EQ(state.getVariablePosition(name), reference.getVariablePosition(name)) << name;
+
+    group->enforcePositionBounds(group_positions.data());
+    EXPECT_TRUE(group->satisfiesPositionBounds(group_positions.data()));
+    std::vector<double> expected;
+    reference.copyJointGroupPositions(group, expected);
+    for (std::size_t i = 0; i < expected.size(); ++i)
+      EXPECT_EQ(group_positions[i], expected[i]) << group_name << " " << i;
+  }
+}
+
+TEST_F(OneRobot, setVariableValuesWithMapping)
+{
+  moveit::core::RobotState state(robot_model_);
+  state.setToDefaultValues();
+  moveit::core::RobotState reference(state);
+  moveit::core::VariableIndexMapping mapping(*robot_model_);
+
+  sensor_msgs::msg::JointState msg;
+  msg.name = { "joint_f", "joint_a" };
+  for (double value : { 0.1, 0.5 })
+  {
+    msg.position = { value, -value };
+    msg.velocity = { 2.0 * value, 0.0 };
+    state.setVariableValues(msg, mapping);
+    reference.setVariableValues(msg);
+    for (const std::string& name : robot_model_->getVariableNames())
+    {
+      EXPECT_EQ(state.getVariablePosition(name), reference.getVariablePosition(name)) << name;
+      EXPECT_EQ(state.getVariableVelocity(name), reference.getVariableVelocity(name)) << name;
+    }
+    EXPECT_TRUE(state.getGlobalLinkTransform("link_e").isApprox(reference.getGlobalLinkTransform("link_e")));
+  }
+
+  msg.name[1] = "not_a_joint";
+  EXPECT_THROW(state.setVariableValues(msg, mapping), moveit::Exception);
+}
+
+TEST_F(OneRobot, robotStateMsgRoundTrip)
+{
+  moveit::core::RobotState state(robot_model_);
+  state.setToDefaultValues();
+  state.setVariablePosition("joint_a", 0.3);
+  state.update();
+
+  std::vector<shapes::ShapeConstPtr> shapes = { std::make_shared<shapes::Box>(0.1, 0.2, 0.3) };
+  EigenSTL::vector_Isometry3d poses = { Eigen::Isometry3d(Eigen::Translation3d(0.1, 0.0, 0.0)) };
+  state.attachBody("box", shapes, poses, std::set<std::string>(), "link_e");
+
+  moveit_msgs::msg::RobotState msg;
+  moveit::core::robotStateToRobotStateMsg(state, msg);
+  // filling the same message again gives the same result
+  moveit::core::robotStateToRobotStateMsg(state, msg);
+  ASSERT_EQ(msg.joint_state.name.size(), msg.joint_state.position.size());
+
+  moveit::core::RobotState copy(robot_model_);
+  copy.setToDefaultValues();
+  ASSERT_TRUE(moveit::core::robotStateMsgToRobotState(msg, copy));
+  for (const std::string& name : robot_model_->getVariableNames())
+    EXPECT_EQ(copy.getVariablePosition(name), state.getVariablePosition(name)) << name;
+  const moveit::core::AttachedBody* body = copy.getAttachedBody("box");
+  ASSERT_TRUE(body);
+  EXPECT_TRUE(body->getGlobalCollisionBodyTransforms()[0].isApprox(
+      state.getAttachedBody("box")->getGlobalCollisionBodyTransforms()[0]));
+
+  // an unchanged body is kept, a changed one is replaced
+  ASSERT_TRUE(moveit::core::robotStateMsgToRobotState(msg, copy));
+  EXPECT_EQ(copy.getAttachedBody("box"), body);
+  msg.attached_collision_objects[0].object.primitives[0].dimensions[0] = 0.5;
+  ASSERT_TRUE(moveit::core::robotStateMsgToRobotState(msg, copy));
+  ASSERT_TRUE(copy.getAttachedBody("box"));
+  EXPECT_EQ(static_cast<const shapes::Box*>(copy.getAttachedBody("box")->getShapes()[0].get())->size[0], 0.5);
+
+  msg.attached_collision_objects.clear();
+  ASSERT_TRUE(moveit::core::robotStateMsgToRobotState(msg, copy));
+  EXPECT_FALSE(copy.hasAttachedBody("box"));
+}
+
 TEST_F(OneRobot, testPrintCurrentPositionWithJointLimits)
 {
   moveit::core::RobotState state(robot_model_);
@@ -567,6 +794,39 @@ TEST_F(OneRobot, testPrintCurrentPositionWithJointLimits)
   state.printStatePositionsWithJointLimits(joint_model_group);
 }
 
+TEST(getJacobian, CallerStorageMatchesMatrixXd)
+{
+  moveit::core::RobotModelPtr model = moveit::core::loadTestingRobotModel("panda");
+  const moveit::core::JointModelGroup* group = model->getJointModelGroup("panda_arm");
+  ASSERT_TRUE(group);
+  ASSERT_EQ(group->getVariableCount(), 7u);
+  const moveit::core::LinkModel* tip = group->getLinkModels().back();
+  const Eigen::Vector3d reference_point(0.0, 0.0, 0.1);
+
+  moveit::core::RobotState state(model);
+  state.setToRandomPositions(group);
+  Eigen::MatrixXd expected;
+  ASSERT_TRUE(state.getJacobian(group, tip, reference_point, expected));
+
+  Eigen::Matrix<double, 6, 7> fixed_size;
+  Eigen::Isometry3d tip_pose;
+  state.setToRandomPositions(group);  // the link transforms are dirty
+  moveit::core::RobotState reference(state);
+  ASSERT_TRUE(state.getJacobian(group, tip, reference_point, fixed_size, tip_pose));
+  reference.getJacobian(group, tip, reference_point, expected);
+  EXPECT_TRUE(fixed_size.isApprox(expected, 1e-12));
+  EXPECT_TRUE(tip_pose.isApprox(reference.getGlobalLinkTransform(tip)));
+
+  Eigen::Matrix<double, 6, Eigen::Dynamic> dynamic_size;
+  const moveit::core::RobotState& const_state = state;
+  ASSERT_TRUE(const_state.getJacobian(group, tip, reference_point, dynamic_size));
+  EXPECT_TRUE(dynamic_size.isApprox(expected, 1e-12));
+
+  // the columns must match the variables of the group
+  Eigen::Matrix<double, 6, 6> wrong_size;
+  EXPECT_FALSE(const_state.getJacobian(group, tip, reference_point, wrong_size));
+}
+
 int main(int argc, char** argv)
 {
   testing::InitGoogleTest(&argc, argv);
@@ -262,6 +262,56 @@ TEST_F(LoadPlanningModelsPr2, FullTest)
   ASSERT_EQ(attached_bodies_2.size(), 0u);
 }
 
+TEST_F(LoadPlanningModelsPr2, AttachedBodyTransforms)
+{
+  moveit::core::RobotModelPtr robot_model(new moveit::core::RobotModel(urdf_model_, srdf_model_));
+  moveit::core::RobotState ks(robot_model);
+  ks.setToDefaultValues();
+  ks.update();
+
+  std::vector<shapes::ShapeConstPtr> shapes;
+  shapes.push_back(std::make_shared<shapes::Box>(.1, .1, .1));
+  shapes.push_back(std::make_shared<shapes::Sphere>(.05));
+  EigenSTL::vector_Isometry3d poses;
+  poses.push_back(Eigen::Isometry3d::Identity());
+  poses.push_back(Eigen::Isometry3d(Eigen::Translation3d(0.1, 0.0, 0.0)));
+  moveit::core::FixedTransformsMap subframes;
+  subframes["tip"] = Eigen::Isometry3d(Eigen::Translation3d(0.2, 0.0, 0.0));
+
+  const moveit::core::LinkModel* link = robot_model->getLinkModel("r_gripper_palm_link");
+  ks.attachBody(new moveit::core::AttachedBody(link, "box", shapes, poses, std::set<std::string>(),
+                                               trajectory_msgs::msg::JointTrajectory(), subframes));
+  const moveit::core::AttachedBody* body = ks.getAttachedBody("box");
+  ASSERT_TRUE(body);
+
+  auto expect_transforms = [&]() {
+    const Eigen::Isometry3d& link_pose = ks.getGlobalLinkTransform(link);
+    for (std::size_t i = 0; i < poses.size(); ++i)
+      EXPECT_TRUE(body->getGlobalCollisionBodyTransforms()[i].isApprox(link_pose * poses[i]));
+    for (const auto& subframe : body->getSubframeTransforms())
+      EXPECT_TRUE(body->getGlobalSubframeTransform("box/" + subframe.first).isApprox(link_pose * subframe.second));
+  };
+  expect_transforms();
+
+  // moving a joint that is not a parent of the link leaves the body in place
+  ks.setVariablePosition("l_shoulder_pan_joint", 0.5);
+  ks.update();
+  expect_transforms();
+
+  ks.setVariablePosition("r_shoulder_pan_joint", -0.5);
+  ks.update();
+  expect_transforms();
+
+  // new subframes are placed on the next update, even if the link did not move
+  moveit::core::AttachedBody standalone(link, "box", shapes, poses, std::set<std::string>(),
+                                        trajectory_msgs::msg::JointTrajectory());
+  const Eigen::Isometry3d& link_pose = ks.getGlobalLinkTransform(link);
+  standalone.computeTransform(link_pose);
+  standalone.setSubframeTransforms(subframes);
+  standalone.computeTransform(link_pose);
+  EXPECT_TRUE(standalone.getGlobalSubframeTransform("box/tip").isApprox(link_pose * subframes["tip"]));
+}
+
 int main(int argc, char** argv)
 {
   testing::InitGoogleTest(&argc, argv);
@@ -0,0 +1,191 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, PickNik LLC
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik LLC nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#pragma once
+
+#include <moveit/macros/class_forward.h>
+#include <moveit/robot_trajectory/robot_trajectory.h>
+#include <vector>
+
+namespace robot_trajectory
+{
+MOVEIT_CLASS_FORWARD(CompactRobotTrajectory)  // Defines CompactRobotTrajectoryPtr, ConstPtr, WeakPtr... etc
+
+/** \brief Memory-efficient sequence of waypoints and the time durations between these waypoints
+
+    RobotTrajectory keeps a full RobotState per waypoint, including the values of all variables and the link
+    transforms. This class only stores the positions, velocities and accelerations of the variables of its group
+    (all variables if there is no group) in flat buffers, plus a single reference state providing the values of
+    all other variables. RobotStates are only created on request, e.g. by materializeWayPoint(). */
+class CompactRobotTrajectory
+{
+public:
+  /** \brief Create an empty trajectory. Variables outside of \e group take their values from \e reference_state. */
+  CompactRobotTrajectory(const moveit::core::RobotState& reference_state, const moveit::core::JointModelGroup* group);
+
+  /** \brief Copy the waypoints of \e trajectory. The first waypoint serves as reference state. */
+  explicit CompactRobotTrajectory(const RobotTrajectory& trajectory);
+
+  const moveit::core::RobotModelConstPtr& getRobotModel() const
+  {
+    return reference_state_.getRobotModel();
+  }
+
+  const moveit::core::JointModelGroup* getGroup() const
+  {
+    return group_;
+  }
+
+  const moveit::core::RobotState& getReferenceState() const
+  {
+    return reference_state_;
+  }
+
+  /** \brief The number of values stored per waypoint in each buffer */
+  std::size_t getVariableCount() const
+  {
+    return variable_count_;
+  }
+
+  std::size_t getWayPointCount() const
+  {
+    return durations_.size();
+  }
+
+  bool empty() const
+  {
+    return durations_.empty();
+  }
+
+  /** \brief Velocities and accelerations are stored if the first waypoint added had them */
+  bool hasVelocities() const
+  {
+    return has_velocities_;
+  }
+
+  bool hasAccelerations() const
+  {
+    return has_accelerations_;
+  }
+
+  const double* getWayPointPositions(std::size_t index) const
+  {
+    return &positions_[index * variable_count_];
+  }
+
+  /** \brief Return nullptr if the trajectory has no velocities */
+  const double* getWayPointVelocities(std::size_t index) const
+  {
+    return has_velocities_ ? &velocities_[index * variable_count_] : nullptr;
+  }
+
+  /** \brief Return nullptr if the trajectory has no accelerations */
+  const double* getWayPointAccelerations(std::size_t index) const
+  {
+    return has_accelerations_ ? &accelerations_[index * variable_count_] : nullptr;
+  }
+
+  double getWayPointDurationFromPrevious(std::size_t index) const
+  {
+    return durations_[index];
+  }
+
+  double getWayPointDurationFromStart(std::size_t index) const;
+
+  double getDuration() const;
+
+  /** \brief Add a waypoint, copying the values of the variables of the group from \e state */
+  void addSuffixWayPoint(const moveit::core::RobotState& state, double dt);
+
+  /** \brief Add a waypoint from getVariableCount() values each. \e velocities and \e accelerations may be
+      nullptr, in which case zeros are stored if the trajectory has velocities (accelerations). */
+  void addSuffixWayPoint(const double* positions, const double* velocities, const double* accelerations, double dt);
+
+  void clear();
+
+  /** \brief Copy the values of waypoint \e index into \e state. All other variables of \e state are not modified. */
+  void copyWayPointToState(std::size_t index, moveit::core::RobotState& state) const;
+
+  /** \brief Create a RobotState for waypoint \e index from the reference state */
+  moveit::core::RobotStatePtr materializeWayPoint(std::size_t index) const;
+
+  /** \brief Replace the waypoints of \e trajectory by the (materialized) waypoints of this trajectory */
+  void getRobotTrajectory(RobotTrajectory& trajectory) const;
+
+  /** \brief Fill a trajectory message for all active joints of the group, without creating a RobotState per
+      waypoint. Multi-DOF joints are reported by their transforms only. */
+  void getRobotTrajectoryMsg(moveit_msgs::msg::RobotTrajectory& trajectory) const;
+
+  /** \brief Replace the waypoints by the points of a trajectory message, without creating a RobotState per point.
+   *
+   * The joint names are resolved once and the values are written to the buffers directly. Variables that are not
+   * in the message take their values from the reference state, values of variables that are not stored (outside of
+   * the group) are ignored. Velocities and accelerations are stored if the first point has them for all joints.
+   * An exception is thrown if a joint name is not known to the robot model. */
+  void setRobotTrajectoryMsg(const moveit_msgs::msg::RobotTrajectory& trajectory);
+
+  /** \brief Remove waypoints that can be reconstructed from their neighbors.
+   *
+   * A waypoint is removed if interpolating linearly in time between the remaining waypoints before and after it
+   * reproduces its position with an error of at most \e tolerance for every active joint, as measured by
+   * JointModel::distance(). Velocities and accelerations of the remaining waypoints are kept unchanged.
+   * The first and last waypoints are always kept. Runs in linear time because a remaining segment never spans
+   * more than a fixed number of the original waypoints.
+   * @return the number of removed waypoints */
+  std::size_t compress(double tolerance);
+
+  /** \brief Replace the waypoints by samples taken every \e dt seconds, plus the last waypoint.
+      Positions are interpolated using the joint models, velocities and accelerations linearly. */
+  void resample(double dt);
+
+private:
+  void interpolate(const double* from, const double* to, double t, double* state) const;
+  double maxJointDistance(const double* state1, const double* state2) const;
+
+  moveit::core::RobotState reference_state_;
+  const moveit::core::JointModelGroup* group_;
+  std::size_t variable_count_;
+  bool has_velocities_;
+  bool has_accelerations_;
+
+  // values of waypoint i are stored at [i * variable_count_, (i + 1) * variable_count_)
+  std::vector<double> positions_;
+  std::vector<double> velocities_;
+  std::vector<double> accelerations_;
+  std::vector<double> durations_;  // from previous waypoint
+
+  // active joints and the buffer index of their first variable
+  std::vector<std::pair<const moveit::core::JointModel*, std::size_t>> active_joints_;
+};
+}  // namespace robot_trajectory
@@ -160,7 +160,7 @@ public:
    */
   void addSuffixWayPoint(const moveit::core::RobotState& state, double dt)
   {
-    addSuffixWayPoint(moveit::core::RobotStatePtr(new moveit::core::RobotState(state)), dt);
+    addSuffixWayPoint(std::make_shared<moveit::core::RobotState>(state), dt);
   }
 
   /**
@@ -177,7 +177,7 @@ public:
 
   void addPrefixWayPoint(const moveit::core::RobotState& state, double dt)
   {
-    addPrefixWayPoint(moveit::core::RobotStatePtr(new moveit::core::RobotState(state)), dt);
+    addPrefixWayPoint(std::make_shared<moveit::core::RobotState>(state), dt);
   }
 
   void addPrefixWayPoint(const moveit::core::RobotStatePtr& state, double dt)
@@ -189,7 +189,7 @@ public:
 
   void insertWayPoint(std::size_t index, const moveit::core::RobotState& state, double dt)
   {
-    insertWayPoint(index, moveit::core::RobotStatePtr(new moveit::core::RobotState(state)), dt);
+    insertWayPoint(index, std::make_shared<moveit::core::RobotState>(state), dt);
   }
 
   void insertWayPoint(std::size_t index, const moveit::core::RobotStatePtr& state, double dt)
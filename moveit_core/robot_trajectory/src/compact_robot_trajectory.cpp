@@ -0,0 +1,487 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, PickNik LLC
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik LLC nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include <moveit/robot_trajectory/compact_robot_trajectory.h>
+#include <tf2_eigen/tf2_eigen.h>
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+namespace robot_trajectory
+{
+// A remaining segment spans at most this many original segments, which bounds the cost of compress()
+static const std::size_t MAX_COMPRESSED_SPAN = 64;
+
+static moveit::core::RobotState getReferenceState(const RobotTrajectory& trajectory)
+{
+  if (!trajectory.empty())
+    return trajectory.getFirstWayPoint();
+  moveit::core::RobotState state(trajectory.getRobotModel());
+  state.setToDefaultValues();
+  return state;
+}
+
+CompactRobotTrajectory::CompactRobotTrajectory(const moveit::core::RobotState& reference_state,
+                                               const moveit::core::JointModelGroup* group)
+  : reference_state_(reference_state)
+  , group_(group)
+  , variable_count_(group ? group->getVariableCount() : reference_state.getVariableCount())
+  , has_velocities_(false)
+  , has_accelerations_(false)
+{
+  const std::vector<const moveit::core::JointModel*>& joints =
+      group_ ? group_->getActiveJointModels() : getRobotModel()->getActiveJointModels();
+  for (const moveit::core::JointModel* joint : joints)
+    active_joints_.emplace_back(joint, group_ ? group_->getVariableGroupIndex(joint->getName()) :
+                                                joint->getFirstVariableIndex());
+}
+
+CompactRobotTrajectory::CompactRobotTrajectory(const RobotTrajectory& trajectory)
+  : CompactRobotTrajectory(getReferenceState(trajectory), trajectory.getGroup())
+{
+  positions_.reserve(trajectory.getWayPointCount() * variable_count_);
+  durations_.reserve(trajectory.getWayPointCount());
+  for (std::size_t i = 0; i < trajectory.getWayPointCount(); ++i)
+    addSuffixWayPoint(trajectory.getWayPoint(i), trajectory.getWayPointDurationFromPrevious(i));
+}
+
+double CompactRobotTrajectory::getWayPointDurationFromStart(std::size_t index) const
+{
+  if (durations_.empty())
+    return 0.0;
+  index = std::min(index, durations_.size() - 1);
+  double time = 0.0;
+  for (std::size_t i = 0; i <= index; ++i)
+    time += durations_[i];
+  return time;
+}
+
+double CompactRobotTrajectory::getDuration() const
+{
+  return empty() ? 0.0 : getWayPointDurationFromStart(durations_.size() - 1);
+}
+
+void CompactRobotTrajectory::addSuffixWayPoint(const moveit::core::RobotState& state, double dt)
+{
+  if (empty())
+  {
+    has_velocities_ = state.hasVelocities();
+    has_accelerations_ = state.hasAccelerations();
+  }
+
+  const std::size_t offset = positions_.size();
+  positions_.resize(offset + variable_count_);
+  if (group_)
+    state.copyJointGroupPositions(group_, &positions_[offset]);
+  else
+    std::copy(state.getVariablePositions(), state.getVariablePositions() + variable_count_, &positions_[offset]);
+
+  if (has_velocities_)
+  {
+    velocities_.resize(offset + variable_count_, 0.0);
+    if (state.hasVelocities() && group_)
+      state.copyJointGroupVelocities(group_, &velocities_[offset]);
+    else if (state.hasVelocities())
+      std::copy(state.getVariableVelocities(), state.getVariableVelocities() + variable_count_, &velocities_[offset]);
+  }
+  if (has_accelerations_)
+  {
+    accelerations_.resize(offset + variable_count_, 0.0);
+    if (state.hasAccelerations() && group_)
+      state.copyJointGroupAccelerations(group_, &accelerations_[offset]);
+    else if (state.hasAccelerations())
+      std::copy(state.getVariableAccelerations(), state.getVariableAccelerations() + variable_count_,
+                &accelerations_[offset]);
+  }
+  durations_.push_back(dt);
+}
+
+void CompactRobotTrajectory::addSuffixWayPoint(const double* positions, const double* velocities,
+                                               const double* accelerations, double dt)
+{
+  if (empty())
+  {
+    has_velocities_ = velocities != nullptr;
+    has_accelerations_ = accelerations != nullptr;
+  }
+
+  positions_.insert(positions_.end(), positions, positions + variable_count_);
+  if (has_velocities_ && velocities)
+    velocities_.insert(velocities_.end(), velocities, velocities + variable_count_);
+  else if (has_velocities_)
+    velocities_.resize(velocities_.size() + variable_count_, 0.0);
+  if (has_accelerations_ && accelerations)
+    accelerations_.insert(accelerations_.end(), accelerations, accelerations + variable_count_);
+  else if (has_accelerations_)
+    accelerations_.resize(accelerations_.size() + variable_count_, 0.0);
+  durations_.push_back(dt);
+}
+
+void CompactRobotTrajectory::clear()
+{
+  positions_.clear();
+  velocities_.clear();
+  accelerations_.clear();
+  durations_.clear();
+  has_velocities_ = false;
+  has_accelerations_ = false;
+}
+
+void CompactRobotTrajectory::copyWayPointToState(std::size_t index, moveit::core::RobotState& state) const
+{
+  const double* positions = getWayPointPositions(index);
+  if (group_)
+    state.setJointGroupPositions(group_, positions);
+  else
+    state.setVariablePositions(positions);
+
+  if (has_velocities_ && group_)
+    state.setJointGroupVelocities(group_, getWayPointVelocities(index));
+  else if (has_velocities_)
+    state.setVariableVelocities(getWayPointVelocities(index));
+
+  if (has_accelerations_ && group_)
+    state.setJointGroupAccelerations(group_, getWayPointAccelerations(index));
+  else if (has_accelerations_)
+    state.setVariableAccelerations(getWayPointAccelerations(index));
+}
+
+moveit::core::RobotStatePtr CompactRobotTrajectory::materializeWayPoint(std::size_t index) const
+{
+  auto state = std::make_shared<moveit::core::RobotState>(reference_state_);
+  copyWayPointToState(index, *state);
+  state->update();
+  return state;
+}
+
+void CompactRobotTrajectory::getRobotTrajectory(RobotTrajectory& trajectory) const
+{
+  trajectory.clear();
+  for (std::size_t i = 0; i < getWayPointCount(); ++i)
+    trajectory.addSuffixWayPoint(materializeWayPoint(i), durations_[i]);
+}
+
+void CompactRobotTrajectory::getRobotTrajectoryMsg(moveit_msgs::msg::RobotTrajectory& trajectory) const
+{
+  trajectory = moveit_msgs::msg::RobotTrajectory();
+  if (empty())
+    return;
+
+  std::vector<std::size_t> onedof;
+  std::vector<const moveit::core::JointModel*> mdof;
+  for (const std::pair<const moveit::core::JointModel*, std::size_t>& joint : active_joints_)
+  {
+    if (joint.first->getVariableCount() == 1)
+    {
+      trajectory.joint_trajectory.joint_names.push_back(joint.first->getName());
+      onedof.push_back(joint.second);
+    }
+    else
+    {
+      trajectory.multi_dof_joint_trajectory.joint_names.push_back(joint.first->getName());
+      mdof.push_back(joint.first);
+    }
+  }
+
+  const builtin_interfaces::msg::Time stamp = rclcpp::Clock(RCL_ROS_TIME).now();
+  if (!onedof.empty())
+  {
+    trajectory.joint_trajectory.header.frame_id = getRobotModel()->getModelFrame();
+    trajectory.joint_trajectory.header.stamp = stamp;
+    trajectory.joint_trajectory.points.resize(getWayPointCount());
+  }
+  if (!mdof.empty())
+  {
+    trajectory.multi_dof_joint_trajectory.header.frame_id = getRobotModel()->getModelFrame();
+    trajectory.multi_dof_joint_trajectory.header.stamp = stamp;
+    trajectory.multi_dof_joint_trajectory.points.resize(getWayPointCount());
+  }
+
+  // only needed to compute the transforms of multi-DOF joints
+  moveit::core::RobotState state(reference_state_);
+  double total_time = 0.0;
+  for (std::size_t i = 0; i < getWayPointCount(); ++i)
+  {
+    total_time += durations_[i];
+    const rclcpp::Duration time_from_start = rclcpp::Duration(1, 0) * total_time;
+
+    if (!onedof.empty())
+    {
+      trajectory_msgs::msg::JointTrajectoryPoint& point = trajectory.joint_trajectory.points[i];
+      point.positions.reserve(onedof.size());
+      for (std::size_t index : onedof)
+        point.positions.push_back(getWayPointPositions(i)[index]);
+      if (has_velocities_)
+      {
+        point.velocities.reserve(onedof.size());
+        for (std::size_t index : onedof)
+          point.velocities.push_back(getWayPointVelocities(i)[index]);
+      }
+      if (has_accelerations_)
+      {
+        point.accelerations.reserve(onedof.size());
+        for (std::size_t index : onedof)
+          point.accelerations.push_back(getWayPointAccelerations(i)[index]);
+      }
+      point.time_from_start = time_from_start;
+    }
+    if (!mdof.empty())
+    {
+      copyWayPointToState(i, state);
+      trajectory_msgs::msg::MultiDOFJointTrajectoryPoint& point = trajectory.multi_dof_joint_trajectory.points[i];
+      point.transforms.resize(mdof.size());
+      for (std::size_t j = 0; j < mdof.size(); ++j)
+        point.transforms[j] = tf2::eigenToTransform(state.getJointTransform(mdof[j])).transform;
+      point.time_from_start = time_from_start;
+    }
+  }
+}
+
+void CompactRobotTrajectory::setRobotTrajectoryMsg(const moveit_msgs::msg::RobotTrajectory& trajectory)
+{
+  clear();
+  const trajectory_msgs::msg::JointTrajectory& joint_trajectory = trajectory.joint_trajectory;
+  const trajectory_msgs::msg::MultiDOFJointTrajectory& multi_dof_trajectory = trajectory.multi_dof_joint_trajectory;
+  const std::size_t count = std::max(joint_trajectory.points.size(), multi_dof_trajectory.points.size());
+  if (count == 0)
+    return;
+
+  // buffer index of every variable of the robot model, -1 for variables that are not stored
+  std::vector<int> buffer_index(getRobotModel()->getVariableCount(), -1);
+  if (group_)
+  {
+    const std::vector<int>& variables = group_->getVariableIndexList();
+    for (std::size_t i = 0; i < variables.size(); ++i)
+      buffer_index[variables[i]] = i;
+  }
+  else
+    std::iota(buffer_index.begin(), buffer_index.end(), 0);
+
+  // the names of the message are only resolved once for all points
+  std::vector<int> indices;
+  indices.reserve(joint_trajectory.joint_names.size());
+  for (const std::string& name : joint_trajectory.joint_names)
+    indices.push_back(buffer_index[getRobotModel()->getVariableIndex(name)]);
+  std::vector<std::pair<const moveit::core::JointModel*, int>> mdof;
+  for (const std::string& name : multi_dof_trajectory.joint_names)
+  {
+    const moveit::core::JointModel* joint = getRobotModel()->getJointModel(name);
+    if (!joint)
+      throw moveit::Exception("Joint '" + name + "' is not known to model '" + getRobotModel()->getName() + "'");
+    mdof.emplace_back(joint, buffer_index[joint->getFirstVariableIndex()]);
+  }
+
+  std::vector<double> reference_positions(variable_count_);
+  if (group_)
+    reference_state_.copyJointGroupPositions(group_, reference_positions);
+  else
+    std::copy(reference_state_.getVariablePositions(), reference_state_.getVariablePositions() + variable_count_,
+              reference_positions.begin());
+
+  if (!joint_trajectory.points.empty())
+  {
+    has_velocities_ = !indices.empty() && joint_trajectory.points[0].velocities.size() == indices.size();
+    has_accelerations_ = !indices.empty() && joint_trajectory.points[0].accelerations.size() == indices.size();
+  }
+  positions_.reserve(count * variable_count_);
+  durations_.reserve(count);
+  if (has_velocities_)
+    velocities_.reserve(count * variable_count_);
+  if (has_accelerations_)
+    accelerations_.reserve(count * variable_count_);
+
+  rclcpp::Time last_time_stamp =
+      joint_trajectory.points.empty() ? multi_dof_trajectory.header.stamp : joint_trajectory.header.stamp;
+  rclcpp::Time this_time_stamp = last_time_stamp;
+  for (std::size_t i = 0; i < count; ++i)
+  {
+    const std::size_t offset = positions_.size();
+    positions_.insert(positions_.end(), reference_positions.begin(), reference_positions.end());
+    if (has_velocities_)
+      velocities_.resize(offset + variable_count_, 0.0);
+    if (has_accelerations_)
+      accelerations_.resize(offset + variable_count_, 0.0);
+
+    if (joint_trajectory.points.size() > i)
+    {
+      const trajectory_msgs::msg::JointTrajectoryPoint& point = joint_trajectory.points[i];
+      const std::size_t n = std::min(indices.size(), point.positions.size());
+      for (std::size_t j = 0; j < n; ++j)
+        if (indices[j] >= 0)
+          positions_[offset + indices[j]] = point.positions[j];
+      if (has_velocities_ && point.velocities.size() == indices.size())
+        for (std::size_t j = 0; j < indices.size(); ++j)
+          if (indices[j] >= 0)
+            velocities_[offset + indices[j]] = point.velocities[j];
+      if (has_accelerations_ && point.accelerations.size() == indices.size())
+        for (std::size_t j = 0; j < indices.size(); ++j)
+          if (indices[j] >= 0)
+            accelerations_[offset + indices[j]] = point.accelerations[j];
+      this_time_stamp = rclcpp::Time(joint_trajectory.header.stamp) + point.time_from_start;
+    }
+    if (multi_dof_trajectory.points.size() > i)
+    {
+      const trajectory_msgs::msg::MultiDOFJointTrajectoryPoint& point = multi_dof_trajectory.points[i];
+      for (std::size_t j = 0; j < mdof.size() && j < point.transforms.size(); ++j)
+        if (mdof[j].second >= 0)
+          mdof[j].first->computeVariablePositions(tf2::transformToEigen(point.transforms[j]),
+                                                  &positions_[offset + mdof[j].second]);
+      this_time_stamp = rclcpp::Time(multi_dof_trajectory.header.stamp) + point.time_from_start;
+    }
+
+    durations_.push_back((this_time_stamp - last_time_stamp).seconds());
+    last_time_stamp = this_time_stamp;
+  }
+}
+
+void CompactRobotTrajectory::interpolate(const double* from, const double* to, double t, double* state) const
+{
+  if (group_)
+    group_->interpolate(from, to, t, state);
+  else
+    getRobotModel()->interpolate(from, to, t, state);
+}
+
+double CompactRobotTrajectory::maxJointDistance(const double* state1, const double* state2) const
+{
+  double distance = 0.0;
+  for (const std::pair<const moveit::core::JointModel*, std::size_t>& joint : active_joints_)
+    distance = std::max(distance, joint.first->distance(state1 + joint.second, state2 + joint.second));
+  return distance;
+}
+
+std::size_t CompactRobotTrajectory::compress(double tolerance)
+{
+  const std::size_t count = getWayPointCount();
+  if (count < 3)
+    return 0;
+
+  std::vector<double> time_from_start(count);
+  time_from_start[0] = durations_[0];
+  for (std::size_t i = 1; i < count; ++i)
+    time_from_start[i] = time_from_start[i - 1] + durations_[i];
+
+  // Greedily extend the segment starting at the last kept waypoint for as long as all waypoints it spans
+  // are reproduced within tolerance
+  std::vector<double> interpolated(variable_count_);
+  const auto spans_within_tolerance = [&](std::size_t start, std::size_t end) {
+    const double duration = time_from_start[end] - time_from_start[start];
+    for (std::size_t i = start + 1; i < end; ++i)
+    {
+      const double t = duration > 0.0 ? (time_from_start[i] - time_from_start[start]) / duration :
+                                        static_cast<double>(i - start) / (end - start);
+      interpolate(getWayPointPositions(start), getWayPointPositions(end), t, interpolated.data());
+      if (maxJointDistance(interpolated.data(), getWayPointPositions(i)) > tolerance)
+        return false;
+    }
+    return true;
+  };
+
+  std::vector<std::size_t> kept;
+  kept.push_back(0);
+  for (std::size_t end = 2; end < count; ++end)
+  {
+    if (end - kept.back() > MAX_COMPRESSED_SPAN || !spans_within_tolerance(kept.back(), end))
+      kept.push_back(end - 1);
+  }
+  kept.push_back(count - 1);
+
+  // Move the kept waypoints to the front of the buffers
+  for (std::size_t k = 0; k < kept.size(); ++k)
+  {
+    const std::size_t i = kept[k];
+    durations_[k] = k == 0 ? durations_[0] : time_from_start[i] - time_from_start[kept[k - 1]];
+    if (i == k)
+      continue;
+    std::copy_n(&positions_[i * variable_count_], variable_count_, &positions_[k * variable_count_]);
+    if (has_velocities_)
+      std::copy_n(&velocities_[i * variable_count_], variable_count_, &velocities_[k * variable_count_]);
+    if (has_accelerations_)
+      std::copy_n(&accelerations_[i * variable_count_], variable_count_, &accelerations_[k * variable_count_]);
+  }
+  positions_.resize(kept.size() * variable_count_);
+  if (has_velocities_)
+    velocities_.resize(kept.size() * variable_count_);
+  if (has_accelerations_)
+    accelerations_.resize(kept.size() * variable_count_);
+  durations_.resize(kept.size());
+
+  return count - kept.size();
+}
+
+void CompactRobotTrajectory::resample(double dt)
+{
+  // times are relative to the first waypoint
+  const double duration = getDuration() - durations_.front();
+  if (getWayPointCount() < 2 || dt <= 0.0 || duration <= 0.0)
+    return;
+
+  CompactRobotTrajectory resampled(reference_state_, group_);
+  const std::size_t sample_count = static_cast<std::size_t>(std::ceil(duration / dt)) + 1;
+  resampled.positions_.reserve(sample_count * variable_count_);
+  resampled.durations_.reserve(sample_count);
+
+  std::vector<double> positions(variable_count_);
+  std::vector<double> velocities(variable_count_);
+  std::vector<double> accelerations(variable_count_);
+  double segment_start = 0.0;  // time of waypoint i - 1
+  std::size_t i = 1;
+  double last_time = 0.0;
+  for (std::size_t sample = 0; sample < sample_count; ++sample)
+  {
+    const double time = std::min(duration, sample * dt);
+    while (i + 1 < getWayPointCount() && segment_start + durations_[i] < time)
+      segment_start += durations_[i++];
+    const double blend = durations_[i] > 0.0 ? std::min(1.0, std::max(0.0, (time - segment_start) / durations_[i])) :
+                                               1.0;
+
+    interpolate(getWayPointPositions(i - 1), getWayPointPositions(i), blend, positions.data());
+    for (std::size_t j = 0; has_velocities_ && j < variable_count_; ++j)
+      velocities[j] =
+          getWayPointVelocities(i - 1)[j] + blend * (getWayPointVelocities(i)[j] - getWayPointVelocities(i - 1)[j]);
+    for (std::size_t j = 0; has_accelerations_ && j < variable_count_; ++j)
+      accelerations[j] = getWayPointAccelerations(i - 1)[j] +
+                         blend * (getWayPointAccelerations(i)[j] - getWayPointAccelerations(i - 1)[j]);
+    resampled.addSuffixWayPoint(positions.data(), has_velocities_ ? velocities.data() : nullptr,
+                                has_accelerations_ ? accelerations.data() : nullptr,
+                                sample == 0 ? durations_[0] : time - last_time);
+    last_time = time;
+  }
+
+  positions_.swap(resampled.positions_);
+  velocities_.swap(resampled.velocities_);
+  accelerations_.swap(resampled.accelerations_);
+  durations_.swap(resampled.durations_);
+}
+}  // namespace robot_trajectory
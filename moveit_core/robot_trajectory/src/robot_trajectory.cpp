@@ -360,31 +360,61 @@ void RobotTrajectory::getRobotTrajectoryMsg(moveit_msgs::msg::RobotTrajectory& t
   }
 }
 
+// Look up the variable indices of the joint names of a trajectory message once for all of its points
+static std::vector<int> getVariableIndices(const moveit::core::RobotModel& robot_model,
+                                           const std::vector<std::string>& names)
+{
+  std::vector<int> indices;
+  indices.reserve(names.size());
+  for (const std::string& name : names)
+    indices.push_back(robot_model.getVariableIndex(name));
+  return indices;
+}
+
+static void setWayPointValues(const std::vector<int>& indices, const trajectory_msgs::msg::JointTrajectoryPoint& point,
+                              moveit::core::RobotState& state)
+{
+  assert(point.positions.size() == indices.size());
+  for (std::size_t j = 0; j < indices.size(); ++j)
+    state.setVariablePosition(indices[j], point.positions[j]);
+  if (!point.velocities.empty())
+  {
+    assert(point.velocities.size() == indices.size());
+    for (std::size_t j = 0; j < indices.size(); ++j)
+      state.setVariableVelocity(indices[j], point.velocities[j]);
+  }
+  if (!point.accelerations.empty())
+  {
+    assert(point.accelerations.size() == indices.size());
+    for (std::size_t j = 0; j < indices.size(); ++j)
+      state.setVariableAcceleration(indices[j], point.accelerations[j]);
+  }
+  if (!point.effort.empty())
+  {
+    assert(point.effort.size() == indices.size());
+    for (std::size_t j = 0; j < indices.size(); ++j)
+      state.setVariableEffort(indices[j], point.effort[j]);
+  }
+}
+
 void RobotTrajectory::setRobotTrajectoryMsg(const moveit::core::RobotState& reference_state,
                                             const trajectory_msgs::msg::JointTrajectory& trajectory)
 {
   // make a copy just in case the next clear() removes the memory for the reference passed in
-
-  const moveit::core::RobotState& copy = reference_state;
+  const moveit::core::RobotState copy = reference_state;
   clear();
+  const std::vector<int> indices = getVariableIndices(*robot_model_, trajectory.joint_names);
   std::size_t state_count = trajectory.points.size();
   rclcpp::Time last_time_stamp = trajectory.header.stamp;
   rclcpp::Time this_time_stamp = last_time_stamp;
 
   rclcpp::Time traj_stamp = trajectory.header.stamp;
-  rclcpp::Duration dur_from_start(0, 0);
 
   for (std::size_t i = 0; i < state_count; ++i)
   {
     this_time_stamp = traj_stamp + trajectory.points[i].time_from_start;
-    moveit::core::RobotStatePtr st(new moveit::core::RobotState(copy));
-    st->setVariablePositions(trajectory.joint_names, trajectory.points[i].positions);
-    if (!trajectory.points[i].velocities.empty())
-      st->setVariableVelocities(trajectory.joint_names, trajectory.points[i].velocities);
-    if (!trajectory.points[i].accelerations.empty())
-      st->setVariableAccelerations(trajectory.joint_names, trajectory.points[i].accelerations);
-    if (!trajectory.points[i].effort.empty())
-      st->setVariableEffort(trajectory.joint_names, trajectory.points[i].effort);
+    auto st = std::make_shared<moveit::core::RobotState>(copy);
+    setWayPointValues(indices, trajectory.points[i], *st);
     addSuffixWayPoint(st, (this_time_stamp - last_time_stamp).seconds());
     last_time_stamp = this_time_stamp;
   }
@@ -393,11 +423,16 @@ void RobotTrajectory::setRobotTrajectoryMsg(const moveit::core::RobotState& refe
 void RobotTrajectory::setRobotTrajectoryMsg(const moveit::core::RobotState& reference_state,
                                             const moveit_msgs::msg::RobotTrajectory& trajectory)
 {
-  geometry_msgs::msg::TransformStamped tf_stamped;
   // make a copy just in case the next clear() removes the memory for the reference passed in
-  const moveit::core::RobotState& copy = reference_state;
+  const moveit::core::RobotState copy = reference_state;
   clear();
 
+  const std::vector<int> indices = getVariableIndices(*robot_model_, trajectory.joint_trajectory.joint_names);
+  std::vector<const moveit::core::JointModel*> mdof;
+  mdof.reserve(trajectory.multi_dof_joint_trajectory.joint_names.size());
+  for (const std::string& name : trajectory.multi_dof_joint_trajectory.joint_names)
+    mdof.push_back(robot_model_->getJointModel(name));
+
   std::size_t state_count =
       std::max(trajectory.joint_trajectory.points.size(), trajectory.multi_dof_joint_trajectory.points.size());
   rclcpp::Time last_time_stamp = trajectory.joint_trajectory.points.empty() ?
@@ -407,27 +442,19 @@ void RobotTrajectory::setRobotTrajectoryMsg(const moveit::core::RobotState& refe
 
   for (std::size_t i = 0; i < state_count; ++i)
   {
-    moveit::core::RobotStatePtr st(new moveit::core::RobotState(copy));
+    auto st = std::make_shared<moveit::core::RobotState>(copy);
     if (trajectory.joint_trajectory.points.size() > i)
     {
-      st->setVariablePositions(trajectory.joint_trajectory.joint_names, trajectory.joint_trajectory.points[i].positions);
-      if (!trajectory.joint_trajectory.points[i].velocities.empty())
-        st->setVariableVelocities(trajectory.joint_trajectory.joint_names,
-                                  trajectory.joint_trajectory.points[i].velocities);
-      if (!trajectory.joint_trajectory.points[i].accelerations.empty())
-        st->setVariableAccelerations(trajectory.joint_trajectory.joint_names,
-                                     trajectory.joint_trajectory.points[i].accelerations);
-      if (!trajectory.joint_trajectory.points[i].effort.empty())
-        st->setVariableEffort(trajectory.joint_trajectory.joint_names, trajectory.joint_trajectory.points[i].effort);
+      setWayPointValues(indices, trajectory.joint_trajectory.points[i], *st);
       this_time_stamp = rclcpp::Time(trajectory.joint_trajectory.header.stamp) +
                         trajectory.joint_trajectory.points[i].time_from_start;
     }
     if (trajectory.multi_dof_joint_trajectory.points.size() > i)
     {
-      for (std::size_t j = 0; j < trajectory.multi_dof_joint_trajectory.joint_names.size(); ++j)
+      for (std::size_t j = 0; j < mdof.size(); ++j)
       {
         Eigen::Isometry3d t = tf2::transformToEigen(trajectory.multi_dof_joint_trajectory.points[i].transforms[j]);
-        st->setJointPositions(trajectory.multi_dof_joint_trajectory.joint_names[j], t);
+        st->setJointPositions(mdof[j], t);
       }
       this_time_stamp = rclcpp::Time(trajectory.multi_dof_joint_trajectory.header.stamp) +
                         trajectory.multi_dof_joint_trajectory.points[i].time_from_start;
@@ -37,6 +37,7 @@
 #include <moveit/robot_model/robot_model.h>
 #include <moveit/robot_state/robot_state.h>
 #include <moveit/robot_trajectory/robot_trajectory.h>
+#include <moveit/robot_trajectory/compact_robot_trajectory.h>
 #include <moveit/utils/robot_model_test_utils.h>
 #include <gtest/gtest.h>
 
@@ -136,6 +137,22 @@ protected:
     trajectory_first_waypoint_after_update.copyJointGroupPositions(arm_jmg_name_, trajectory_first_state_after_update);
     EXPECT_NE(trajectory_first_state[0], trajectory_first_state_after_update[0]);
   }
+
+  // Move the first joint along a line and the second one along a sine, 100 waypoints 0.01s apart
+  void initCurvedTrajectory(robot_trajectory::RobotTrajectoryPtr& trajectory)
+  {
+    trajectory = std::make_shared<robot_trajectory::RobotTrajectory>(robot_model_, arm_jmg_name_);
+    moveit::core::RobotState state(*robot_state_);
+    std::vector<double> positions;
+    state.copyJointGroupPositions(arm_jmg_name_, positions);
+    for (std::size_t ix = 0; ix < 100; ++ix)
+    {
+      positions[0] = 0.01 * ix;
+      positions[1] = 0.5 * std::sin(0.05 * ix);
+      state.setJointGroupPositions(arm_jmg_name_, positions);
+      trajectory->addSuffixWayPoint(state, ix == 0 ? 0.0 : 0.01);
+    }
+  }
 };
 
 TEST_F(RobotTrajectoryTestFixture, ModifyFirstWaypointByPtr)
@@ -204,6 +221,98 @@ TEST_F(RobotTrajectoryTestFixture, RobotTrajectoryDeepCopy)
   EXPECT_NE(trajectory_first_state_after_update[0], trajectory_copy_first_state_after_update[0]);
 }
 
+TEST_F(RobotTrajectoryTestFixture, CompactRobotTrajectoryRoundTrip)
+{
+  robot_trajectory::RobotTrajectoryPtr trajectory;
+  initCurvedTrajectory(trajectory);
+
+  robot_trajectory::CompactRobotTrajectory compact(*trajectory);
+  EXPECT_EQ(compact.getWayPointCount(), trajectory->getWayPointCount());
+  EXPECT_DOUBLE_EQ(compact.getDuration(), trajectory->getDuration());
+
+  robot_trajectory::RobotTrajectory restored(robot_model_, arm_jmg_name_);
+  compact.getRobotTrajectory(restored);
+  ASSERT_EQ(restored.getWayPointCount(), trajectory->getWayPointCount());
+  for (std::size_t i = 0; i < restored.getWayPointCount(); ++i)
+  {
+    EXPECT_DOUBLE_EQ(restored.getWayPointDurationFromPrevious(i), trajectory->getWayPointDurationFromPrevious(i));
+    EXPECT_EQ(restored.getWayPoint(i).distance(trajectory->getWayPoint(i)), 0.0);
+  }
+
+  moveit_msgs::msg::RobotTrajectory msg;
+  moveit_msgs::msg::RobotTrajectory compact_msg;
+  trajectory->getRobotTrajectoryMsg(msg);
+  compact.getRobotTrajectoryMsg(compact_msg);
+  EXPECT_EQ(compact_msg.joint_trajectory.joint_names, msg.joint_trajectory.joint_names);
+  ASSERT_EQ(compact_msg.joint_trajectory.points.size(), msg.joint_trajectory.points.size());
+  for (std::size_t i = 0; i < msg.joint_trajectory.points.size(); ++i)
+  {
+    EXPECT_EQ(compact_msg.joint_trajectory.points[i].positions, msg.joint_trajectory.points[i].positions);
+    EXPECT_EQ(rclcpp::Duration(compact_msg.joint_trajectory.points[i].time_from_start),
+              rclcpp::Duration(msg.joint_trajectory.points[i].time_from_start));
+  }
+}
+
+TEST_F(RobotTrajectoryTestFixture, CompactRobotTrajectoryCompress)
+{
+  robot_trajectory::RobotTrajectoryPtr trajectory;
+  initCurvedTrajectory(trajectory);
+
+  const double tolerance = 0.001;
+  robot_trajectory::CompactRobotTrajectory compact(*trajectory);
+  const std::size_t removed = compact.compress(tolerance);
+  EXPECT_GT(removed, 0u);
+  EXPECT_EQ(compact.getWayPointCount() + removed, trajectory->getWayPointCount());
+  EXPECT_DOUBLE_EQ(compact.getDuration(), trajectory->getDuration());
+
+  // Every original waypoint is reproduced within tolerance by interpolating the compressed trajectory
+  robot_trajectory::RobotTrajectory compressed(robot_model_, arm_jmg_name_);
+  compact.getRobotTrajectory(compressed);
+  auto state = std::make_shared<moveit::core::RobotState>(*robot_state_);
+  for (std::size_t i = 0; i < trajectory->getWayPointCount(); ++i)
+  {
+    ASSERT_TRUE(compressed.getStateAtDurationFromStart(trajectory->getWayPointDurationFromStart(i), state));
+    for (const moveit::core::JointModel* joint : trajectory->getGroup()->getActiveJointModels())
+      EXPECT_LE(state->distance(trajectory->getWayPoint(i), joint), tolerance + 1e-9);
+  }
+}
+
+TEST_F(RobotTrajectoryTestFixture, CompactRobotTrajectoryResample)
+{
+  robot_trajectory::RobotTrajectoryPtr trajectory;
+  initCurvedTrajectory(trajectory);
+
+  robot_trajectory::CompactRobotTrajectory compact(*trajectory);
+  compact.resample(0.1);
+  // 0.99s sampled every 0.1s plus the last waypoint
+  EXPECT_EQ(compact.getWayPointCount(), 11u);
+  EXPECT_NEAR(compact.getDuration(), trajectory->getDuration(), 1e-9);
+  EXPECT_EQ(compact.materializeWayPoint(compact.getWayPointCount() - 1)->distance(trajectory->getLastWayPoint()), 0.0);
+  EXPECT_NEAR(compact.getWayPointPositions(5)[0], 0.5, 1e-9);
+}
+
+TEST_F(RobotTrajectoryTestFixture, SetRobotTrajectoryMsg)
+{
+  robot_trajectory::RobotTrajectoryPtr trajectory;
+  initCurvedTrajectory(trajectory);
+  moveit_msgs::msg::RobotTrajectory msg;
+  trajectory->getRobotTrajectoryMsg(msg);
+
+  robot_trajectory::RobotTrajectory restored(robot_model_, arm_jmg_name_);
+  restored.setRobotTrajectoryMsg(*robot_state_, msg);
+  robot_trajectory::CompactRobotTrajectory compact(*robot_state_, trajectory->getGroup());
+  compact.setRobotTrajectoryMsg(msg);
+  ASSERT_EQ(restored.getWayPointCount(), trajectory->getWayPointCount());
+  ASSERT_EQ(compact.getWayPointCount(), trajectory->getWayPointCount());
+  for (std::size_t i = 0; i < trajectory->getWayPointCount(); ++i)
+  {
+    EXPECT_NEAR(restored.getWayPointDurationFromPrevious(i), trajectory->getWayPointDurationFromPrevious(i), 1e-9);
+    EXPECT_NEAR(compact.getWayPointDurationFromPrevious(i), trajectory->getWayPointDurationFromPrevious(i), 1e-9);
+    EXPECT_EQ(restored.getWayPoint(i).distance(trajectory->getWayPoint(i)), 0.0);
+    EXPECT_EQ(compact.materializeWayPoint(i)->distance(trajectory->getWayPoint(i)), 0.0);
+  }
+}
+
 int main(int argc, char** argv)
 {
   testing::InitGoogleTest(&argc, argv);
@@ -0,0 +1,84 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, PickNik LLC
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik LLC nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#pragma once
+
+#include <moveit/robot_trajectory/robot_trajectory.h>
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace trajectory_processing
+{
+/// Time-parameterizes one trajectory, with the given maximum velocity and acceleration scaling factors
+using TimeParameterizationFn = std::function<bool(robot_trajectory::RobotTrajectory&, double, double)>;
+
+/// \brief Time-parameterize all \e trajectories concurrently, e.g. all candidates of a portfolio of planners.
+///
+/// Each of the \e thread_count threads (the number of hardware threads if 0, the calling thread being one of them)
+/// calls \e make_parameterization once and uses the result for all trajectories it processes, so parameterizations
+/// that keep state, like the dynamics solver of a TorqueLimitedTimeParameterization, get a workspace of their own. Trajectories are claimed one at a time, as
+/// their lengths vary. The trajectories must be distinct objects.
+///
+/// \return true if all trajectories were parameterized. The indices of the others are stored in \e failed_index,
+///         if given.
+bool computeTimeStampsBatch(const std::vector<robot_trajectory::RobotTrajectoryPtr>& trajectories,
+                            const std::function<TimeParameterizationFn()>& make_parameterization,
+                            const double max_velocity_scaling_factor = 1.0,
+                            const double max_acceleration_scaling_factor = 1.0, unsigned int thread_count = 0,
+                            std::vector<std::size_t>* failed_index = nullptr);
+
+/// \brief Time-parameterize all \e trajectories concurrently with copies of \e parameterization, which is any of the
+/// parameterizations of this package (IterativeParabolicTimeParameterization, IterativeSplineParameterization,
+/// TimeOptimalTrajectoryGeneration...). Each thread uses a copy of its own, see the overload above. Copies of a
+/// TorqueLimitedTimeParameterization share its dynamics solver, which is not thread safe; create one solver per
+/// thread with the overload above instead.
+template <typename TimeParameterization>
+bool computeTimeStampsBatch(const TimeParameterization& parameterization,
+                            const std::vector<robot_trajectory::RobotTrajectoryPtr>& trajectories,
+                            const double max_velocity_scaling_factor = 1.0,
+                            const double max_acceleration_scaling_factor = 1.0, unsigned int thread_count = 0,
+                            std::vector<std::size_t>* failed_index = nullptr)
+{
+  auto make_parameterization = [&parameterization]() -> TimeParameterizationFn {
+    auto copy = std::make_shared<const TimeParameterization>(parameterization);
+    return [copy](robot_trajectory::RobotTrajectory& trajectory, double max_velocity_scaling,
+                  double max_acceleration_scaling) {
+      return copy->computeTimeStamps(trajectory, max_velocity_scaling, max_acceleration_scaling);
+    };
+  };
+  return computeTimeStampsBatch(trajectories, make_parameterization, max_velocity_scaling_factor,
+                                max_acceleration_scaling_factor, thread_count, failed_index);
+}
+}  // namespace trajectory_processing
@@ -0,0 +1,80 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, PickNik LLC
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik LLC nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#pragma once
+
+#include <map>
+#include <string>
+#include <moveit/robot_trajectory/robot_trajectory.h>
+#include "rclcpp/rclcpp.hpp"
+
+namespace trajectory_processing
+{
+/// \brief This class sets the timestamps of a trajectory
+/// to enforce velocity, acceleration and jerk constraints in linear time.
+/// Velocity and acceleration limits are specified in the model.
+/// Since the model carries no jerk limits, they are passed to the constructor.
+///
+/// The waypoints are treated as a piecewise-linear path. For every waypoint an upper bound
+/// on the squared path velocity is derived from the joint velocity limits and from the
+/// centripetal acceleration caused by the change of direction at the waypoint.
+/// A backward and a forward pass then integrate the path velocity under the acceleration limit,
+/// ramping the path acceleration up and down at a rate given by the jerk limit.
+/// Both passes visit every segment exactly once, so the cost is O(points * joints).
+///
+/// The discrete joint velocities, accelerations and jerks of the result are checked against the limits
+/// and, if any of them is exceeded, all segments are stretched by the single factor that
+/// brings the worst offender back within bounds. There is no iteration, unlike
+/// IterativeSplineParameterization, so the runtime does not depend on how tight the limits are.
+///
+/// The trajectory starts and ends at rest. Consecutive waypoints at the same position
+/// are assigned a zero duration.
+///
+class JerkLimitedTimeParameterization
+{
+public:
+  /// \param max_jerk jerk limit used for every variable without an entry in \e jerk_limits
+  /// \param jerk_limits per-variable jerk limits, keyed by variable name
+  JerkLimitedTimeParameterization(double max_jerk = 10.0, const std::map<std::string, double>& jerk_limits = {});
+  ~JerkLimitedTimeParameterization() = default;
+
+  /// The jerk limits are scaled by \e max_acceleration_scaling_factor.
+  bool computeTimeStamps(robot_trajectory::RobotTrajectory& trajectory, const double max_velocity_scaling_factor = 1.0,
+                         const double max_acceleration_scaling_factor = 1.0) const;
+
+private:
+  double max_jerk_;                            /// @brief Default jerk limit
+  std::map<std::string, double> jerk_limits_;  /// @brief Jerk limits overriding max_jerk_ for single variables
+};
+}  // namespace trajectory_processing
@@ -0,0 +1,84 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, PickNik LLC
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik LLC nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#pragma once
+
+#include <moveit/dynamics_solver/dynamics_solver.h>
+#include <moveit/robot_trajectory/robot_trajectory.h>
+#include "rclcpp/rclcpp.hpp"
+
+namespace trajectory_processing
+{
+/// \brief This class sets the timestamps of a trajectory to respect the velocity and
+/// acceleration limits of the model as well as the joint torque limits.
+///
+/// The trajectory is first parameterized by TimeOptimalTrajectoryGeneration. The torques
+/// required along the result are computed by a DynamicsSolver, including the weight of a
+/// payload held by the last link of the solver group. Joints without an effort limit are
+/// not checked.
+///
+/// The torque of a waypoint splits into a static part (gravity and payload) and a part that
+/// scales with the inverse square of a time scaling factor. This gives the factor that brings
+/// each waypoint back within its limits, i.e. a configuration-dependent acceleration bound.
+/// The segments next to the offending waypoints are stretched by these factors, smoothed
+/// over neighboring waypoints, and the velocities and accelerations are recomputed by finite
+/// differences. This repeats until all torques are within the limits, so only the parts of
+/// the motion that exceed them are slowed down.
+///
+/// Parameterization fails if the static torque alone exceeds a limit at some waypoint,
+/// since no timing can hold the payload there.
+class TorqueLimitedTimeParameterization
+{
+public:
+  /// \param dynamics_solver solver for the torques of the group carrying the payload
+  /// \param payload the payload held by the last link of the solver group (in kg)
+  /// \param path_tolerance path tolerance passed to TimeOptimalTrajectoryGeneration
+  /// \param resample_dt resampling period passed to TimeOptimalTrajectoryGeneration
+  /// \param max_iterations maximum number of stretching iterations
+  TorqueLimitedTimeParameterization(const dynamics_solver::DynamicsSolverConstPtr& dynamics_solver,
+                                    double payload = 0.0, double path_tolerance = 0.1, double resample_dt = 0.1,
+                                    unsigned int max_iterations = 100);
+  ~TorqueLimitedTimeParameterization() = default;
+
+  bool computeTimeStamps(robot_trajectory::RobotTrajectory& trajectory, const double max_velocity_scaling_factor = 1.0,
+                         const double max_acceleration_scaling_factor = 1.0) const;
+
+private:
+  dynamics_solver::DynamicsSolverConstPtr dynamics_solver_;  /// @brief Torques of the payload carrying group
+  double payload_;                                           /// @brief Payload in kg
+  double path_tolerance_;                                    /// @brief Path tolerance of the initial pass
+  double resample_dt_;                                       /// @brief Resampling period of the initial pass
+  unsigned int max_iterations_;                              /// @brief Maximum number of stretching iterations
+};
+}  // namespace trajectory_processing
@@ -0,0 +1,85 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, PickNik LLC
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik LLC nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include <moveit/trajectory_processing/batch_time_parameterization.h>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
+namespace trajectory_processing
+{
+bool computeTimeStampsBatch(const std::vector<robot_trajectory::RobotTrajectoryPtr>& trajectories,
+                            const std::function<TimeParameterizationFn()>& make_parameterization,
+                            const double max_velocity_scaling_factor, const double max_acceleration_scaling_factor,
+                            unsigned int thread_count, std::vector<std::size_t>* failed_index)
+{
+  const std::size_t count = trajectories.size();
+  if (failed_index)
+    failed_index->clear();
+  if (count == 0)
+    return true;
+  if (thread_count == 0)
+    thread_count = std::max(1u, std::thread::hardware_concurrency());
+  if (thread_count > count)
+    thread_count = count;
+
+  // trajectories are claimed one at a time, as their parameterization time grows with their length
+  std::vector<char> succeeded(count, 0);
+  std::atomic<std::size_t> next_index(0);
+  auto worker = [&]() {
+    TimeParameterizationFn parameterization = make_parameterization();
+    for (std::size_t i = next_index++; i < count; i = next_index++)
+      succeeded[i] = trajectories[i] &&
+                     parameterization(*trajectories[i], max_velocity_scaling_factor, max_acceleration_scaling_factor);
+  };
+
+  std::vector<std::thread> threads;
+  threads.reserve(thread_count - 1);
+  for (unsigned int t = 1; t < thread_count; ++t)
+    threads.emplace_back(worker);
+  worker();
+  for (std::thread& thread : threads)
+    thread.join();
+
+  bool result = true;
+  for (std::size_t i = 0; i < count; ++i)
+    if (!succeeded[i])
+    {
+      result = false;
+      if (failed_index)
+        failed_index->push_back(i);
+    }
+  return result;
+}
+}  // namespace trajectory_processing
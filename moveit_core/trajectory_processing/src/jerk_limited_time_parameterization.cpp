@@ -0,0 +1,421 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, PickNik LLC
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik LLC nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include <moveit/trajectory_processing/jerk_limited_time_parameterization.h>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+namespace trajectory_processing
+{
+static const rclcpp::Logger LOGGER =
+    rclcpp::get_logger("moveit_trajectory_processing.jerk_limited_time_parameterization");
+
+static const double VLIMIT = 1.0;  // default if not specified in model
+static const double ALIMIT = 1.0;  // default if not specified in model
+
+// Segments shorter than this are merged into the preceding waypoint
+static const double EPSILON = 1e-9;
+// Share of the acceleration limit that the direction change at a waypoint may use up
+static const double CURVATURE_FRACTION = 0.8;
+// Share of the jerk budget used to ramp the acceleration down before reaching a velocity bound
+static const double RAMP_DOWN_FRACTION = 0.5;
+// The centripetal terms never reduce the usable path acceleration and jerk below this share
+static const double MIN_BUDGET_FRACTION = 0.1;
+// Largest relative drop of the squared path velocity within one segment, keeps durations finite
+static const double MAX_DECELERATION_FRACTION = 0.75;
+
+namespace
+{
+// The piecewise-linear path through the (distinct) waypoints, scaled to path coordinates
+struct LinearPath
+{
+  std::size_t num_points;
+  std::size_t num_joints;
+  std::vector<double> length;                 // Euclidean length of each segment
+  std::vector<double> direction;              // absolute unit direction, [segment * num_joints + joint]
+  std::vector<double> curvature;              // direction change per path length, [point * num_joints + joint]
+  std::vector<double> max_path_acceleration;  // path acceleration bound of each segment
+  std::vector<double> max_path_jerk;          // path jerk bound of each segment
+};
+
+// Path acceleration available on segment k, leaving room for the centripetal acceleration at waypoint i
+double availableAcceleration(const LinearPath& path, const std::vector<double>& max_acceleration, std::size_t k,
+                             std::size_t i, double squared_velocity)
+{
+  double result = std::numeric_limits<double>::infinity();
+  for (std::size_t j = 0; j < path.num_joints; ++j)
+  {
+    const double d = path.direction[k * path.num_joints + j];
+    if (d > 0.0)
+      result = std::min(result,
+                        (max_acceleration[j] - path.curvature[i * path.num_joints + j] * squared_velocity) / d);
+  }
+  return std::max(result, MIN_BUDGET_FRACTION * path.max_path_acceleration[k]);
+}
+
+// Path jerk available on segment k, leaving room for the derivative of the centripetal acceleration at waypoint i
+double availableJerk(const LinearPath& path, const std::vector<double>& max_jerk, std::size_t k, std::size_t i,
+                     double squared_velocity, double acceleration)
+{
+  double result = std::numeric_limits<double>::infinity();
+  const double centripetal_rate = 3.0 * std::sqrt(squared_velocity) * std::abs(acceleration);
+  for (std::size_t j = 0; j < path.num_joints; ++j)
+  {
+    const double d = path.direction[k * path.num_joints + j];
+    if (d > 0.0)
+      result = std::min(result, (max_jerk[j] - path.curvature[i * path.num_joints + j] * centripetal_rate) / d);
+  }
+  return std::max(result, MIN_BUDGET_FRACTION * path.max_path_jerk[k]);
+}
+
+// Integrate the squared path velocity w from rest below the given envelope, either from the first waypoint
+// towards the last one or in reverse. The path acceleration (dw/ds / 2) changes by at most jerk * dt per segment
+// and is ramped down early enough to meet the envelope where it drops.
+std::vector<double> integrate(const LinearPath& path, const std::vector<double>& envelope,
+                              const std::vector<double>& max_acceleration, const std::vector<double>& max_jerk,
+                              bool reverse)
+{
+  const std::size_t num_segments = path.num_points - 1;
+  std::vector<double> w(path.num_points, 0.0);
+  double previous_acceleration = 0.0;
+  double previous_duration = 0.0;
+  for (std::size_t s = 0; s < num_segments; ++s)
+  {
+    const std::size_t k = reverse ? num_segments - 1 - s : s;  // segment
+    const std::size_t from = reverse ? k + 1 : k;
+    const std::size_t to = reverse ? k : k + 1;
+    const double length = path.length[k];
+    const double velocity = std::sqrt(w[from]);
+
+    // the duration of this segment is at least the one reached at the envelope
+    const double duration_estimate = 0.5 * (previous_duration + 2.0 * length / (velocity + std::sqrt(envelope[to])));
+    const double jerk_step =
+        availableJerk(path, max_jerk, k, from, w[from], previous_acceleration) * duration_estimate;
+
+    double acceleration = previous_acceleration + jerk_step;
+    // while riding the envelope, follow it as long as the acceleration limit permits
+    if (w[from] >= envelope[from] * (1.0 - EPSILON))
+      acceleration = std::max(acceleration, (envelope[to] - w[from]) / (2.0 * length));
+    acceleration = std::min(acceleration, availableAcceleration(path, max_acceleration, k, from, w[from]));
+    // ramp down so that the acceleration has decayed when the envelope is reached
+    const double gap = std::max(0.0, envelope[to] - w[from]);
+    acceleration = std::min(acceleration, (envelope[to] - envelope[from]) / (2.0 * length) +
+                                              std::sqrt(RAMP_DOWN_FRACTION * jerk_step * gap / length));
+    acceleration = std::max(acceleration, -MAX_DECELERATION_FRACTION * w[from] / (2.0 * length));
+
+    w[to] = std::max(0.0, std::min(envelope[to], w[from] + 2.0 * length * acceleration));
+    previous_acceleration = (w[to] - w[from]) / (2.0 * length);
+    previous_duration = 2.0 * length / (velocity + std::sqrt(w[to]));
+  }
+  return w;
+}
+
+// Compute the duration of each segment between the given waypoints (positions in [point * num_joints + joint]).
+// All waypoints must be distinct.
+std::vector<double> computeDurations(const std::vector<double>& positions, std::size_t num_joints,
+                                     const std::vector<double>& max_velocity,
+                                     const std::vector<double>& max_acceleration,
+                                     const std::vector<double>& max_jerk)
+{
+  LinearPath path;
+  path.num_joints = num_joints;
+  path.num_points = positions.size() / num_joints;
+  const std::size_t n = path.num_points;
+  const std::size_t num_segments = n - 1;
+
+  path.length.resize(num_segments);
+  path.direction.resize(num_segments * num_joints);
+  path.max_path_acceleration.resize(num_segments);
+  path.max_path_jerk.resize(num_segments);
+  std::vector<double> signed_direction(num_segments * num_joints);
+  std::vector<double> max_path_velocity(num_segments);
+  for (std::size_t k = 0; k < num_segments; ++k)
+  {
+    double squared_length = 0.0;
+    for (std::size_t j = 0; j < num_joints; ++j)
+    {
+      const double delta = positions[(k + 1) * num_joints + j] - positions[k * num_joints + j];
+      squared_length += delta * delta;
+    }
+    path.length[k] = std::sqrt(squared_length);
+
+    max_path_velocity[k] = std::numeric_limits<double>::infinity();
+    path.max_path_acceleration[k] = std::numeric_limits<double>::infinity();
+    path.max_path_jerk[k] = std::numeric_limits<double>::infinity();
+    for (std::size_t j = 0; j < num_joints; ++j)
+    {
+      const std::size_t kj = k * num_joints + j;
+      signed_direction[kj] = (positions[(k + 1) * num_joints + j] - positions[kj]) / path.length[k];
+      path.direction[kj] = std::abs(signed_direction[kj]);
+      if (path.direction[kj] > 0.0)
+      {
+        max_path_velocity[k] = std::min(max_path_velocity[k], max_velocity[j] / path.direction[kj]);
+        path.max_path_acceleration[k] =
+            std::min(path.max_path_acceleration[k], max_acceleration[j] / path.direction[kj]);
+        path.max_path_jerk[k] = std::min(path.max_path_jerk[k], max_jerk[j] / path.direction[kj]);
+      }
+    }
+  }
+
+  path.curvature.assign(n * num_joints, 0.0);
+  for (std::size_t i = 1; i + 1 < n; ++i)
+  {
+    const double mean_length = 0.5 * (path.length[i - 1] + path.length[i]);
+    for (std::size_t j = 0; j < num_joints; ++j)
+      path.curvature[i * num_joints + j] =
+          std::abs(signed_direction[i * num_joints + j] - signed_direction[(i - 1) * num_joints + j]) / mean_length;
+  }
+
+  // Upper bound on the squared path velocity at each waypoint, given by the velocity limits of both adjacent
+  // segments and the centripetal acceleration of the direction change
+  std::vector<double> envelope(n, 0.0);
+  for (std::size_t i = 1; i + 1 < n; ++i)
+  {
+    const double v = std::min(max_path_velocity[i - 1], max_path_velocity[i]);
+    envelope[i] = v * v;
+    for (std::size_t j = 0; j < num_joints; ++j)
+    {
+      const double curvature = path.curvature[i * num_joints + j];
+      if (curvature > EPSILON)
+        envelope[i] = std::min(envelope[i], CURVATURE_FRACTION * max_acceleration[j] / curvature);
+    }
+  }
+
+  std::vector<double> durations(num_segments);
+  if (num_segments == 1)
+  {
+    // Nothing to integrate between the two resting endpoints, start from the velocity limit
+    durations[0] = path.length[0] / max_path_velocity[0];
+  }
+  else
+  {
+    // The backward pass makes the envelope reachable when decelerating, the forward pass produces the profile
+    const std::vector<double> backward = integrate(path, envelope, max_acceleration, max_jerk, true);
+    const std::vector<double> w = integrate(path, backward, max_acceleration, max_jerk, false);
+    for (std::size_t k = 0; k < num_segments; ++k)
+      durations[k] = 2.0 * path.length[k] / (std::sqrt(w[k]) + std::sqrt(w[k + 1]));
+  }
+
+  // Check the discrete joint derivatives and stretch all segments uniformly, which scales velocities by 1/c,
+  // accelerations by 1/c^2 and jerks by 1/c^3.
+  const auto segment_velocity = [&](std::size_t k, std::size_t j) {
+    return signed_direction[k * num_joints + j] * path.length[k] / durations[k];
+  };
+  double velocity_ratio = 0.0;
+  double acceleration_ratio = 0.0;
+  double jerk_ratio = 0.0;
+  for (std::size_t j = 0; j < num_joints; ++j)
+  {
+    double previous_acceleration = 0.0;
+    for (std::size_t i = 0; i < n; ++i)
+    {
+      const double u_before = i > 0 ? segment_velocity(i - 1, j) : 0.0;
+      const double u_after = i < num_segments ? segment_velocity(i, j) : 0.0;
+      const double dt = 0.5 * ((i > 0 ? durations[i - 1] : 0.0) + (i < num_segments ? durations[i] : 0.0));
+      const double acceleration = (u_after - u_before) / dt;
+      velocity_ratio = std::max(velocity_ratio, std::abs(u_after) / max_velocity[j]);
+      acceleration_ratio = std::max(acceleration_ratio, std::abs(acceleration) / max_acceleration[j]);
+      if (i > 0)
+        jerk_ratio =
+            std::max(jerk_ratio, std::abs(acceleration - previous_acceleration) / durations[i - 1] / max_jerk[j]);
+      previous_acceleration = acceleration;
+    }
+  }
+  const double stretch =
+      std::max({ 1.0, velocity_ratio, std::sqrt(acceleration_ratio), std::cbrt(jerk_ratio) }) * (1.0 + EPSILON);
+  for (double& duration : durations)
+    duration *= stretch;
+  return durations;
+}
+}  // namespace
+
+JerkLimitedTimeParameterization::JerkLimitedTimeParameterization(double max_jerk,
+                                                                 const std::map<std::string, double>& jerk_limits)
+  : max_jerk_(max_jerk), jerk_limits_(jerk_limits)
+{
+}
+
+bool JerkLimitedTimeParameterization::computeTimeStamps(robot_trajectory::RobotTrajectory& trajectory,
+                                                        const double max_velocity_scaling_factor,
+                                                        const double max_acceleration_scaling_factor) const
+{
+  if (trajectory.empty())
+    return true;
+
+  const moveit::core::JointModelGroup* group = trajectory.getGroup();
+  if (!group)
+  {
+    RCLCPP_ERROR(LOGGER, "It looks like the planner did not set "
+                         "the group the plan was computed for");
+    return false;
+  }
+  const moveit::core::RobotModel& rmodel = group->getParentModel();
+  const std::vector<int>& idx = group->getVariableIndexList();
+  const std::vector<std::string>& vars = group->getVariableNames();
+  const std::size_t num_points = trajectory.getWayPointCount();
+  const std::size_t num_joints = group->getVariableCount();
+  double velocity_scaling_factor = 1.0;
+  double acceleration_scaling_factor = 1.0;
+
+  // Set scaling factors
+  if (max_velocity_scaling_factor > 0.0 && max_velocity_scaling_factor <= 1.0)
+    velocity_scaling_factor = max_velocity_scaling_factor;
+  else if (max_velocity_scaling_factor == 0.0)
+  {
+    RCLCPP_DEBUG(LOGGER, "A max_velocity_scaling_factor of 0.0 was specified, defaulting to %f instead.",
+                 velocity_scaling_factor);
+  }
+  else
+  {
+    RCLCPP_WARN(LOGGER, "Invalid max_velocity_scaling_factor %f specified, defaulting to %f instead.",
+                max_velocity_scaling_factor, velocity_scaling_factor);
+  }
+  if (max_acceleration_scaling_factor > 0.0 && max_acceleration_scaling_factor <= 1.0)
+    acceleration_scaling_factor = max_acceleration_scaling_factor;
+  else if (max_acceleration_scaling_factor == 0.0)
+  {
+    RCLCPP_DEBUG(LOGGER, "A max_acceleration_scaling_factor of 0.0 was specified, defaulting to %f instead.",
+                 acceleration_scaling_factor);
+  }
+  else
+  {
+    RCLCPP_WARN(LOGGER, "Invalid max_acceleration_scaling_factor %f specified, defaulting to %f instead.",
+                max_acceleration_scaling_factor, acceleration_scaling_factor);
+  }
+
+  // Set bounds based on model, or default limits
+  std::vector<double> max_velocity(num_joints, VLIMIT);
+  std::vector<double> max_acceleration(num_joints, ALIMIT);
+  std::vector<double> max_jerk(num_joints, max_jerk_);
+  for (std::size_t j = 0; j < num_joints; ++j)
+  {
+    const moveit::core::VariableBounds& bounds = rmodel.getVariableBounds(vars[j]);
+    if (bounds.velocity_bounded_)
+    {
+      max_velocity[j] = bounds.max_velocity_;
+      if (bounds.min_velocity_ < 0.0)
+        max_velocity[j] = std::min(max_velocity[j], -bounds.min_velocity_);
+    }
+    if (bounds.acceleration_bounded_)
+    {
+      max_acceleration[j] = bounds.max_acceleration_;
+      if (bounds.min_acceleration_ < 0.0)
+        max_acceleration[j] = std::min(max_acceleration[j], -bounds.min_acceleration_);
+    }
+    const auto jerk_limit = jerk_limits_.find(vars[j]);
+    if (jerk_limit != jerk_limits_.end())
+      max_jerk[j] = jerk_limit->second;
+
+    max_velocity[j] *= velocity_scaling_factor;
+    max_acceleration[j] *= acceleration_scaling_factor;
+    max_jerk[j] *= acceleration_scaling_factor;
+
+    // Error out if bounds don't make sense
+    if (max_velocity[j] <= 0.0 || max_acceleration[j] <= 0.0 || max_jerk[j] <= 0.0)
+    {
+      RCLCPP_ERROR(LOGGER,
+                   "Joint %zu max velocity %f, max acceleration %f and max jerk %f must be greater than zero "
+                   "or a solution won't be found.",
+                   j, max_velocity[j], max_acceleration[j], max_jerk[j]);
+      return false;
+    }
+  }
+
+  // No wrapped angles.
+  trajectory.unwind();
+
+  // Collect the distinct waypoints; repeated ones are merged into their predecessor
+  std::vector<std::size_t> distinct;
+  std::vector<double> positions;
+  distinct.reserve(num_points);
+  positions.reserve(num_points * num_joints);
+  for (std::size_t i = 0; i < num_points; ++i)
+  {
+    const moveit::core::RobotStatePtr& waypoint = trajectory.getWayPointPtr(i);
+    if (!distinct.empty())
+    {
+      double squared_distance = 0.0;
+      for (std::size_t j = 0; j < num_joints; ++j)
+      {
+        const double delta = waypoint->getVariablePosition(idx[j]) - positions[positions.size() - num_joints + j];
+        squared_distance += delta * delta;
+      }
+      if (squared_distance <= EPSILON * EPSILON)
+        continue;
+    }
+    distinct.push_back(i);
+    for (std::size_t j = 0; j < num_joints; ++j)
+      positions.push_back(waypoint->getVariablePosition(idx[j]));
+  }
+
+  std::vector<double> durations;
+  if (distinct.size() > 1)
+    durations = computeDurations(positions, num_joints, max_velocity, max_acceleration, max_jerk);
+
+  // Velocities are averaged over the adjacent segments, accelerations are the difference of those segment velocities
+  const std::size_t num_segments = durations.size();
+  const auto segment_velocity = [&](std::size_t k, std::size_t j) {
+    return (positions[(k + 1) * num_joints + j] - positions[k * num_joints + j]) / durations[k];
+  };
+  std::vector<double> velocities(num_joints);
+  std::vector<double> accelerations(num_joints);
+  for (std::size_t d = 0; d < distinct.size(); ++d)
+  {
+    const double dt = 0.5 * ((d > 0 ? durations[d - 1] : 0.0) + (d < num_segments ? durations[d] : 0.0));
+    for (std::size_t j = 0; j < num_joints; ++j)
+    {
+      const double u_before = d > 0 ? segment_velocity(d - 1, j) : 0.0;
+      const double u_after = d < num_segments ? segment_velocity(d, j) : 0.0;
+      velocities[j] = (d > 0 && d < num_segments) ? 0.5 * (u_before + u_after) : 0.0;
+      accelerations[j] = dt > 0.0 ? (u_after - u_before) / dt : 0.0;
+    }
+
+    const std::size_t last = d + 1 < distinct.size() ? distinct[d + 1] : num_points;
+    for (std::size_t i = distinct[d]; i < last; ++i)
+    {
+      trajectory.setWayPointDurationFromPrevious(i, (i == distinct[d] && d > 0) ? durations[d - 1] : 0.0);
+      moveit::core::RobotStatePtr waypoint = trajectory.getWayPointPtr(i);
+      for (std::size_t j = 0; j < num_joints; ++j)
+      {
+        waypoint->setVariableVelocity(idx[j], velocities[j]);
+        waypoint->setVariableAcceleration(idx[j], accelerations[j]);
+      }
+    }
+  }
+
+  return true;
+}
+}  // namespace trajectory_processing
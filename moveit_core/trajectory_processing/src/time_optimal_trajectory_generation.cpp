@@ -257,14 +257,11 @@ double Path::getLength() const
 
 PathSegment* Path::getPathSegment(double& s) const
 {
-  std::list<std::unique_ptr<PathSegment>>::const_iterator it = path_segments_.begin();
-  std::list<std::unique_ptr<PathSegment>>::const_iterator next = it;
-  ++next;
-  while (next != path_segments_.end() && s >= (*next)->position_)
-  {
-    it = next;
-    ++next;
-  }
+  // The segment before the first one starting behind s contains s
+  std::vector<std::unique_ptr<PathSegment>>::const_iterator it =
+      std::upper_bound(path_segments_.begin() + 1, path_segments_.end(), s,
+                       [](double s, const std::unique_ptr<PathSegment>& segment) { return s < segment->position_; });
+  --it;
   s -= (*it)->position_;
   return (*it).get();
 }
@@ -289,11 +286,9 @@ Eigen::VectorXd Path::getCurvature(double s) const
 
 double Path::getNextSwitchingPoint(double s, bool& discontinuity) const
 {
-  std::list<std::pair<double, bool>>::const_iterator it = switching_points_.begin();
-  while (it != switching_points_.end() && it->first <= s)
-  {
-    ++it;
-  }
+  std::vector<std::pair<double, bool>>::const_iterator it = std::upper_bound(
+      switching_points_.begin(), switching_points_.end(), s,
+      [](double s, const std::pair<double, bool>& switching_point) { return s < switching_point.first; });
   if (it == switching_points_.end())
   {
     discontinuity = true;
@@ -303,7 +298,7 @@ double Path::getNextSwitchingPoint(double s, bool& discontinuity) const
   return it->first;
 }
 
-std::list<std::pair<double, bool>> Path::getSwitchingPoints() const
+const std::vector<std::pair<double, bool>>& Path::getSwitchingPoints() const
 {
   return switching_points_;
 }
@@ -345,8 +340,8 @@ Trajectory::Trajectory(const Path& path, const Eigen::VectorXd& max_velocity, co
   if (valid_)
   {
     // Calculate timing
-    std::list<TrajectoryStep>::iterator previous = trajectory_.begin();
-    std::list<TrajectoryStep>::iterator it = previous;
+    std::vector<TrajectoryStep>::iterator previous = trajectory_.begin();
+    std::vector<TrajectoryStep>::iterator it = previous;
     it->time_ = 0.0;
     ++it;
     while (it != trajectory_.end())
@@ -378,12 +373,16 @@ bool Trajectory::getNextSwitchingPoint(double path_pos, TrajectoryStep& next_swi
   } while (!acceleration_reached_end &&
            acceleration_switching_point.path_vel_ > getVelocityMaxPathVelocity(acceleration_switching_point.path_pos_));
 
+  // A velocity switching point behind the acceleration switching point is never chosen, so stop searching there
+  const double max_velocity_switching_path_pos =
+      acceleration_reached_end ? path_.getLength() : acceleration_switching_point.path_pos_;
   TrajectoryStep velocity_switching_point(path_pos, 0.0);
   double velocity_before_acceleration, velocity_after_acceleration;
   bool velocity_reached_end;
   do
   {
-    velocity_reached_end = getNextVelocitySwitchingPoint(velocity_switching_point.path_pos_, velocity_switching_point,
+    velocity_reached_end = getNextVelocitySwitchingPoint(velocity_switching_point.path_pos_,
+                                                         max_velocity_switching_path_pos, velocity_switching_point,
                                                          velocity_before_acceleration, velocity_after_acceleration);
   } while (
       !velocity_reached_end && velocity_switching_point.path_pos_ <= acceleration_switching_point.path_pos_ &&
@@ -461,11 +460,15 @@ bool Trajectory::getNextAccelerationSwitchingPoint(double path_pos, TrajectorySt
   return false;
 }
 
-bool Trajectory::getNextVelocitySwitchingPoint(double path_pos, TrajectoryStep& next_switching_point,
-                                               double& before_acceleration, double& after_acceleration)
+// Returns true if there is no switching point up to max_path_pos.
+bool Trajectory::getNextVelocitySwitchingPoint(double path_pos, double max_path_pos,
+                                               TrajectoryStep& next_switching_point, double& before_acceleration,
+                                               double& after_acceleration)
 {
   const double step_size = 0.001;
   const double accuracy = 0.000001;
+  // the bisection below may end up to one step before the last sample
+  const double end_path_pos = std::min(path_.getLength(), max_path_pos + step_size);
 
   bool start = false;
   path_pos -= step_size;
@@ -480,11 +483,11 @@ bool Trajectory::getNextVelocitySwitchingPoint(double path_pos, TrajectoryStep&
     }
   } while ((!start || getMinMaxPhaseSlope(path_pos, getVelocityMaxPathVelocity(path_pos), false) >
                           getVelocityMaxPathVelocityDeriv(path_pos)) &&
-           path_pos < path_.getLength());
+           path_pos < end_path_pos);
 
-  if (path_pos >= path_.getLength())
+  if (path_pos >= end_path_pos)
   {
-    return true;  // end of trajectory reached
+    return true;  // end of trajectory or of the search range reached
   }
 
   double before_path_pos = path_pos - step_size;
@@ -510,13 +513,15 @@ bool Trajectory::getNextVelocitySwitchingPoint(double path_pos, TrajectoryStep&
 }
 
 // Returns true if end of path is reached
-bool Trajectory::integrateForward(std::list<TrajectoryStep>& trajectory, double acceleration)
+bool Trajectory::integrateForward(std::vector<TrajectoryStep>& trajectory, double acceleration)
 {
   double path_pos = trajectory.back().path_pos_;
   double path_vel = trajectory.back().path_vel_;
 
-  std::list<std::pair<double, bool>> switching_points = path_.getSwitchingPoints();
-  std::list<std::pair<double, bool>>::iterator next_discontinuity = switching_points.begin();
+  const std::vector<std::pair<double, bool>>& switching_points = path_.getSwitchingPoints();
+  std::vector<std::pair<double, bool>>::const_iterator next_discontinuity = std::upper_bound(
+      switching_points.begin(), switching_points.end(), path_pos,
+      [](double s, const std::pair<double, bool>& switching_point) { return s < switching_point.first; });
 
   while (true)
   {
@@ -626,14 +631,14 @@ bool Trajectory::integrateForward(std::list<TrajectoryStep>& trajectory, double
   }
 }
 
-void Trajectory::integrateBackward(std::list<TrajectoryStep>& start_trajectory, double path_pos, double path_vel,
+void Trajectory::integrateBackward(std::vector<TrajectoryStep>& start_trajectory, double path_pos, double path_vel,
                                    double acceleration)
 {
-  std::list<TrajectoryStep>::iterator start2 = start_trajectory.end();
+  std::vector<TrajectoryStep>::iterator start2 = start_trajectory.end();
   --start2;
-  std::list<TrajectoryStep>::iterator start1 = start2;
+  std::vector<TrajectoryStep>::iterator start1 = start2;
   --start1;
-  std::list<TrajectoryStep> trajectory;
+  std::vector<TrajectoryStep> trajectory;  // in reverse order, back() is the earliest step
   double slope;
   assert(start1->path_pos_ <= path_pos);
 
@@ -641,17 +646,17 @@ void Trajectory::integrateBackward(std::list<TrajectoryStep>& start_trajectory,
   {
     if (start1->path_pos_ <= path_pos)
     {
-      trajectory.push_front(TrajectoryStep(path_pos, path_vel));
+      trajectory.push_back(TrajectoryStep(path_pos, path_vel));
       path_vel -= time_step_ * acceleration;
-      path_pos -= time_step_ * 0.5 * (path_vel + trajectory.front().path_vel_);
+      path_pos -= time_step_ * 0.5 * (path_vel + trajectory.back().path_vel_);
       acceleration = getMinMaxPathAcceleration(path_pos, path_vel, false);
-      slope = (trajectory.front().path_vel_ - path_vel) / (trajectory.front().path_pos_ - path_pos);
+      slope = (trajectory.back().path_vel_ - path_vel) / (trajectory.back().path_pos_ - path_pos);
 
       if (path_vel < 0.0)
       {
         valid_ = false;
         RCLCPP_ERROR(LOGGER, "Error while integrating backward: Negative path velocity");
-        end_trajectory_ = trajectory;
+        end_trajectory_.assign(trajectory.rbegin(), trajectory.rend());
         return;
       }
     }
@@ -667,20 +672,20 @@ void Trajectory::integrateBackward(std::list<TrajectoryStep>& start_trajectory,
     const double intersection_path_pos =
         (start1->path_vel_ - path_vel + slope * path_pos - start_slope * start1->path_pos_) / (slope - start_slope);
     if (std::max(start1->path_pos_, path_pos) - EPS <= intersection_path_pos &&
-        intersection_path_pos <= EPS + std::min(start2->path_pos_, trajectory.front().path_pos_))
+        intersection_path_pos <= EPS + std::min(start2->path_pos_, trajectory.back().path_pos_))
     {
       const double intersection_path_vel =
           start1->path_vel_ + start_slope * (intersection_path_pos - start1->path_pos_);
       start_trajectory.erase(start2, start_trajectory.end());
       start_trajectory.push_back(TrajectoryStep(intersection_path_pos, intersection_path_vel));
-      start_trajectory.splice(start_trajectory.end(), trajectory);
+      start_trajectory.insert(start_trajectory.end(), trajectory.rbegin(), trajectory.rend());
       return;
     }
   }
 
   valid_ = false;
   RCLCPP_ERROR(LOGGER, "Error while integrating backward: Did not hit start trajectory");
-  end_trajectory_ = trajectory;
+  end_trajectory_.assign(trajectory.rbegin(), trajectory.rend());
 }
 
 double Trajectory::getMinMaxPathAcceleration(double path_pos, double path_vel, bool max)
@@ -782,11 +787,11 @@ double Trajectory::getDuration() const
   return trajectory_.back().time_;
 }
 
-std::list<Trajectory::TrajectoryStep>::const_iterator Trajectory::getTrajectorySegment(double time) const
+std::vector<Trajectory::TrajectoryStep>::const_iterator Trajectory::getTrajectorySegment(double time) const
 {
   if (time >= trajectory_.back().time_)
   {
-    std::list<TrajectoryStep>::const_iterator last = trajectory_.end();
+    std::vector<TrajectoryStep>::const_iterator last = trajectory_.end();
     last--;
     return last;
   }
@@ -807,8 +812,8 @@ std::list<Trajectory::TrajectoryStep>::const_iterator Trajectory::getTrajectoryS
 
 Eigen::VectorXd Trajectory::getPosition(double time) const
 {
-  std::list<TrajectoryStep>::const_iterator it = getTrajectorySegment(time);
-  std::list<TrajectoryStep>::const_iterator previous = it;
+  std::vector<TrajectoryStep>::const_iterator it = getTrajectorySegment(time);
+  std::vector<TrajectoryStep>::const_iterator previous = it;
   previous--;
 
   double time_step = it->time_ - previous->time_;
@@ -824,8 +829,8 @@ Eigen::VectorXd Trajectory::getPosition(double time) const
 
 Eigen::VectorXd Trajectory::getVelocity(double time) const
 {
-  std::list<TrajectoryStep>::const_iterator it = getTrajectorySegment(time);
-  std::list<TrajectoryStep>::const_iterator previous = it;
+  std::vector<TrajectoryStep>::const_iterator it = getTrajectorySegment(time);
+  std::vector<TrajectoryStep>::const_iterator previous = it;
   previous--;
 
   double time_step = it->time_ - previous->time_;
@@ -842,8 +847,8 @@ Eigen::VectorXd Trajectory::getVelocity(double time) const
 
 Eigen::VectorXd Trajectory::getAcceleration(double time) const
 {
-  std::list<TrajectoryStep>::const_iterator it = getTrajectorySegment(time);
-  std::list<TrajectoryStep>::const_iterator previous = it;
+  std::vector<TrajectoryStep>::const_iterator it = getTrajectorySegment(time);
+  std::vector<TrajectoryStep>::const_iterator previous = it;
   previous--;
 
   double time_step = it->time_ - previous->time_;
@@ -0,0 +1,215 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, PickNik LLC
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik LLC nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include <moveit/trajectory_processing/torque_limited_time_parameterization.h>
+#include <moveit/trajectory_processing/time_optimal_trajectory_generation.h>
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace trajectory_processing
+{
+static const rclcpp::Logger LOGGER =
+    rclcpp::get_logger("moveit_trajectory_processing.torque_limited_time_parameterization");
+
+// Segments shorter than this have zero velocity and acceleration
+static const double EPSILON = 1e-9;
+// Extra stretch applied to the factor computed for a waypoint, compensates the finite differences
+static const double FACTOR_MARGIN = 1.02;
+// Largest ratio between the time scaling factors of neighboring waypoints
+static const double MAX_FACTOR_RATIO = 1.1;
+
+namespace
+{
+// Velocities and accelerations by finite differences over non-uniform segments.
+// durations[i] is the duration of the segment ending at waypoint i; the trajectory starts and ends at rest.
+void computeDerivatives(const Eigen::MatrixXd& positions, const std::vector<double>& durations,
+                        Eigen::MatrixXd& velocities, Eigen::MatrixXd& accelerations)
+{
+  const Eigen::Index num_points = positions.cols();
+  velocities.setZero(positions.rows(), num_points);
+  accelerations.setZero(positions.rows(), num_points);
+  if (num_points < 2)
+    return;
+
+  if (durations[1] > EPSILON)
+    accelerations.col(0) = 2.0 * (positions.col(1) - positions.col(0)) / (durations[1] * durations[1]);
+  for (Eigen::Index i = 1; i < num_points - 1; ++i)
+  {
+    const double h0 = durations[i];
+    const double h1 = durations[i + 1];
+    if (h0 <= EPSILON || h1 <= EPSILON)
+      continue;
+    const Eigen::VectorXd v0 = (positions.col(i) - positions.col(i - 1)) / h0;
+    const Eigen::VectorXd v1 = (positions.col(i + 1) - positions.col(i)) / h1;
+    velocities.col(i) = (v0 * h1 + v1 * h0) / (h0 + h1);
+    accelerations.col(i) = 2.0 * (v1 - v0) / (h0 + h1);
+  }
+  const double h = durations[num_points - 1];
+  if (h > EPSILON)
+    accelerations.col(num_points - 1) =
+        2.0 * (positions.col(num_points - 2) - positions.col(num_points - 1)) / (h * h);
+}
+
+void copyPositions(const robot_trajectory::RobotTrajectory& trajectory, const moveit::core::JointModelGroup* group,
+                   Eigen::MatrixXd& positions)
+{
+  positions.resize(group->getVariableCount(), trajectory.getWayPointCount());
+  for (std::size_t i = 0; i < trajectory.getWayPointCount(); ++i)
+    trajectory.getWayPoint(i).copyJointGroupPositions(group, positions.col(i).data());
+}
+}  // namespace
+
+TorqueLimitedTimeParameterization::TorqueLimitedTimeParameterization(
+    const dynamics_solver::DynamicsSolverConstPtr& dynamics_solver, double payload, double path_tolerance,
+    double resample_dt, unsigned int max_iterations)
+  : dynamics_solver_(dynamics_solver)
+  , payload_(payload)
+  , path_tolerance_(path_tolerance)
+  , resample_dt_(resample_dt)
+  , max_iterations_(max_iterations)
+{
+}
+
+bool TorqueLimitedTimeParameterization::computeTimeStamps(robot_trajectory::RobotTrajectory& trajectory,
+                                                          const double max_velocity_scaling_factor,
+                                                          const double max_acceleration_scaling_factor) const
+{
+  if (!dynamics_solver_ || !dynamics_solver_->getGroup())
+  {
+    RCLCPP_ERROR(LOGGER, "A valid dynamics solver is required");
+    return false;
+  }
+  const moveit::core::JointModelGroup* group = trajectory.getGroup();
+  if (!group)
+  {
+    RCLCPP_ERROR(LOGGER, "It looks like the planner did not set the group the plan was computed for");
+    return false;
+  }
+
+  TimeOptimalTrajectoryGeneration totg(path_tolerance_, resample_dt_);
+  if (!totg.computeTimeStamps(trajectory, max_velocity_scaling_factor, max_acceleration_scaling_factor))
+    return false;
+
+  const std::size_t num_points = trajectory.getWayPointCount();
+  if (num_points < 2)
+    return true;
+
+  // the positions do not change with the timing, and neither do the static torques
+  Eigen::MatrixXd positions, velocities, accelerations, torques, static_torques;
+  copyPositions(trajectory, dynamics_solver_->getGroup(), positions);
+  const Eigen::MatrixXd zeros = Eigen::MatrixXd::Zero(positions.rows(), positions.cols());
+  if (!dynamics_solver_->getTorques(positions, zeros, zeros, static_torques, payload_))
+    return false;
+
+  const std::vector<double>& max_torques = dynamics_solver_->getMaxTorques();
+  const Eigen::Index num_joints = std::min<Eigen::Index>(positions.rows(), max_torques.size());
+  for (std::size_t i = 0; i < num_points; ++i)
+  {
+    for (Eigen::Index j = 0; j < num_joints; ++j)
+    {
+      if (max_torques[j] > 0.0 && std::fabs(static_torques(j, i)) >= max_torques[j])
+      {
+        RCLCPP_ERROR(LOGGER, "The static torque %f of joint %ld exceeds its limit %f at waypoint %zu",
+                     static_torques(j, i), static_cast<long>(j), max_torques[j], i);
+        return false;
+      }
+    }
+  }
+
+  std::vector<double> durations(num_points);
+  for (std::size_t i = 0; i < num_points; ++i)
+    durations[i] = trajectory.getWayPointDurationFromPrevious(i);
+
+  std::vector<double> factors(num_points);
+  bool stretched = false;
+  for (unsigned int iteration = 0;; ++iteration)
+  {
+    computeDerivatives(positions, durations, velocities, accelerations);
+    if (!dynamics_solver_->getTorques(positions, velocities, accelerations, torques, payload_))
+      return false;
+
+    // scaling the time by k scales the dynamic torque, torque - static torque, by 1 / k^2
+    bool within_limits = true;
+    for (std::size_t i = 0; i < num_points; ++i)
+    {
+      double scale = 1.0;
+      for (Eigen::Index j = 0; j < num_joints; ++j)
+      {
+        const double limit = max_torques[j];
+        if (limit <= 0.0 || std::fabs(torques(j, i)) <= limit)
+          continue;
+        const double dynamic_torque = torques(j, i) - static_torques(j, i);
+        const double bound = dynamic_torque > 0.0 ? limit - static_torques(j, i) : -limit - static_torques(j, i);
+        scale = std::min(scale, bound / dynamic_torque);
+      }
+      factors[i] = scale < 1.0 ? FACTOR_MARGIN / std::sqrt(scale) : 1.0;
+      if (scale < 1.0)
+        within_limits = false;
+    }
+    if (within_limits)
+      break;
+    if (iteration == max_iterations_)
+    {
+      RCLCPP_ERROR(LOGGER, "Torque limits still exceeded after %u iterations", max_iterations_);
+      return false;
+    }
+
+    // spread the factors so that the timing changes smoothly between waypoints
+    for (std::size_t i = 1; i < num_points; ++i)
+      factors[i] = std::max(factors[i], factors[i - 1] / MAX_FACTOR_RATIO);
+    for (std::size_t i = num_points - 1; i > 0; --i)
+      factors[i - 1] = std::max(factors[i - 1], factors[i] / MAX_FACTOR_RATIO);
+
+    for (std::size_t i = 1; i < num_points; ++i)
+      durations[i] *= std::max(factors[i - 1], factors[i]);
+    stretched = true;
+  }
+
+  // an unchanged timing keeps the velocities and accelerations computed by TimeOptimalTrajectoryGeneration
+  if (!stretched)
+    return true;
+
+  copyPositions(trajectory, group, positions);
+  computeDerivatives(positions, durations, velocities, accelerations);
+  for (std::size_t i = 0; i < num_points; ++i)
+  {
+    moveit::core::RobotStatePtr& waypoint = trajectory.getWayPointPtr(i);
+    waypoint->setJointGroupVelocities(group, velocities.col(i).data());
+    waypoint->setJointGroupAccelerations(group, accelerations.col(i).data());
+    trajectory.setWayPointDurationFromPrevious(i, durations[i]);
+  }
+  return true;
+}
+}  // namespace trajectory_processing
@@ -35,12 +35,17 @@
 /* Author: Ken Anderson */
 
 #include <gtest/gtest.h>
+#include <atomic>
 #include <fstream>
 #include <moveit/robot_state/robot_state.h>
 #include <moveit/robot_model/robot_model.h>
 #include <moveit/robot_trajectory/robot_trajectory.h>
+#include <moveit/trajectory_processing/batch_time_parameterization.h>
 #include <moveit/trajectory_processing/iterative_spline_parameterization.h>
 #include <moveit/trajectory_processing/iterative_time_parameterization.h>
+#include <moveit/trajectory_processing/jerk_limited_time_parameterization.h>
+#include <moveit/trajectory_processing/time_optimal_trajectory_generation.h>
+#include <moveit/trajectory_processing/torque_limited_time_parameterization.h>
 #include <moveit/utils/robot_model_test_utils.h>
 #include "rclcpp/rclcpp.hpp"
 
@@ -111,6 +116,62 @@ int initStraightTrajectory(robot_trajectory::RobotTrajectory& trajectory, double
   return 0;
 }
 
+// Initialize a dense trajectory moving all joints of the group along smooth curves
+int initCurvedTrajectory(robot_trajectory::RobotTrajectory& trajectory, const unsigned num)
+{
+  const moveit::core::JointModelGroup* group = trajectory.getGroup();
+  if (!group)
+  {
+    RCLCPP_ERROR(LOGGER, "Need to set the group");
+    return -1;
+  }
+  const std::vector<int>& idx = group->getVariableIndexList();
+  moveit::core::RobotState state(trajectory.getRobotModel());
+  state.setToDefaultValues();
+
+  trajectory.clear();
+  for (unsigned i = 0; i < num; i++)
+  {
+    const double s = static_cast<double>(i) / (num - 1);
+    for (std::size_t j = 0; j < idx.size(); j++)
+      state.setVariablePosition(idx[j], 0.3 * std::sin((j + 1) * 2.0 * s) + 0.1 * s);
+    trajectory.addSuffixWayPoint(state, 0.0);
+  }
+
+  return 0;
+}
+
+// Check the finite-difference joint velocities, accelerations and jerks against the given limits
+void checkJerkLimited(robot_trajectory::RobotTrajectory& trajectory, const double max_jerk)
+{
+  const moveit::core::JointModelGroup* group = trajectory.getGroup();
+  const std::vector<int>& idx = group->getVariableIndexList();
+  const std::vector<std::string>& vars = group->getVariableNames();
+  const moveit::core::RobotModel& rmodel = group->getParentModel();
+  const std::size_t count = trajectory.getWayPointCount();
+
+  for (std::size_t j = 0; j < idx.size(); j++)
+  {
+    const moveit::core::VariableBounds& bounds = rmodel.getVariableBounds(vars[j]);
+    const double max_velocity = bounds.velocity_bounded_ ? bounds.max_velocity_ : 1.0;
+    const double max_acceleration = bounds.acceleration_bounded_ ? bounds.max_acceleration_ : 1.0;
+    for (std::size_t i = 0; i < count; i++)
+    {
+      const moveit::core::RobotStatePtr& point = trajectory.getWayPointPtr(i);
+      EXPECT_LE(std::abs(point->getVariableVelocity(idx[j])), max_velocity + 1e-6) << "waypoint " << i;
+      EXPECT_LE(std::abs(point->getVariableAcceleration(idx[j])), max_acceleration + 1e-6) << "waypoint " << i;
+      const double dt = trajectory.getWayPointDurationFromPrevious(i);
+      if (i > 0 && dt > 0.0)
+      {
+        const double jerk = (point->getVariableAcceleration(idx[j]) -
+                             trajectory.getWayPointPtr(i - 1)->getVariableAcceleration(idx[j])) /
+                            dt;
+        EXPECT_LE(std::abs(jerk), max_jerk + 1e-6) << "waypoint " << i;
+      }
+    }
+  }
+}
+
 void printTrajectory(robot_trajectory::RobotTrajectory& trajectory)
 {
   const moveit::core::JointModelGroup* group = trajectory.getGroup();
@@ -186,6 +247,114 @@ TEST(TestTimeParameterization, TestRepeatedPoint)
   ASSERT_LT(TRAJECTORY.getWayPointDurationFromStart(TRAJECTORY.getWayPointCount() - 1), 0.001);
 }
 
+TEST(TestTimeParameterization, TestJerkLimited)
+{
+  trajectory_processing::JerkLimitedTimeParameterization time_parameterization(10.0);
+  EXPECT_EQ(initStraightTrajectory(TRAJECTORY), 0);
+
+  auto wt = std::chrono::system_clock::now();
+  EXPECT_TRUE(time_parameterization.computeTimeStamps(TRAJECTORY));
+  std::cout << "JerkLimitedTimeParameterization took " << (std::chrono::system_clock::now() - wt).count() << std::endl;
+  printTrajectory(TRAJECTORY);
+  checkJerkLimited(TRAJECTORY, 10.0);
+  ASSERT_LT(TRAJECTORY.getWayPointDurationFromStart(TRAJECTORY.getWayPointCount() - 1), 5.0);
+}
+
+TEST(TestTimeParameterization, TestJerkLimitedDenseCurvedPath)
+{
+  trajectory_processing::JerkLimitedTimeParameterization time_parameterization(50.0);
+  EXPECT_EQ(initCurvedTrajectory(TRAJECTORY, 1000), 0);
+
+  auto wt = std::chrono::system_clock::now();
+  EXPECT_TRUE(time_parameterization.computeTimeStamps(TRAJECTORY, 0.5, 0.5));
+  std::cout << "JerkLimitedTimeParameterization of 1000 waypoints took "
+            << (std::chrono::system_clock::now() - wt).count() << std::endl;
+  checkJerkLimited(TRAJECTORY, 25.0);
+  ASSERT_GT(TRAJECTORY.getWayPointDurationFromStart(TRAJECTORY.getWayPointCount() - 1), 0.0);
+}
+
+TEST(TestTimeParameterization, TestJerkLimitedRepeatedPoint)
+{
+  trajectory_processing::JerkLimitedTimeParameterization time_parameterization;
+  EXPECT_EQ(initRepeatedPointTrajectory(TRAJECTORY), 0);
+
+  EXPECT_TRUE(time_parameterization.computeTimeStamps(TRAJECTORY));
+  printTrajectory(TRAJECTORY);
+  ASSERT_LT(TRAJECTORY.getWayPointDurationFromStart(TRAJECTORY.getWayPointCount() - 1), 0.001);
+}
+
+TEST(TestTimeParameterization, TestTorqueLimited)
+{
+  // a weak gravity keeps the static torques of the arm well within its limits
+  geometry_msgs::msg::Vector3 gravity;
+  gravity.z = -1.0;
+  auto solver = std::make_shared<const dynamics_solver::DynamicsSolver>(RMODEL, "right_arm", gravity);
+  ASSERT_TRUE(solver->getGroup());
+  Eigen::MatrixXd torques;
+
+  trajectory_processing::TorqueLimitedTimeParameterization light_parameterization(solver, 0.0);
+  EXPECT_EQ(initCurvedTrajectory(TRAJECTORY, 50), 0);
+  EXPECT_TRUE(light_parameterization.computeTimeStamps(TRAJECTORY));
+  ASSERT_TRUE(solver->getTrajectoryTorques(TRAJECTORY, torques, 0.0));
+  EXPECT_TRUE(solver->withinTorqueLimits(torques));
+  const double light_duration = TRAJECTORY.getDuration();
+  EXPECT_GT(light_duration, 0.0);
+
+  trajectory_processing::TorqueLimitedTimeParameterization heavy_parameterization(solver, 5.0);
+  EXPECT_EQ(initCurvedTrajectory(TRAJECTORY, 50), 0);
+  EXPECT_TRUE(heavy_parameterization.computeTimeStamps(TRAJECTORY));
+  ASSERT_TRUE(solver->getTrajectoryTorques(TRAJECTORY, torques, 5.0));
+  EXPECT_TRUE(solver->withinTorqueLimits(torques));
+  EXPECT_GE(TRAJECTORY.getDuration(), light_duration - 1e-6);
+
+  // no timing can hold this payload
+  trajectory_processing::TorqueLimitedTimeParameterization overloaded_parameterization(solver, 1e5);
+  EXPECT_EQ(initCurvedTrajectory(TRAJECTORY, 50), 0);
+  EXPECT_FALSE(overloaded_parameterization.computeTimeStamps(TRAJECTORY));
+}
+
+TEST(TestTimeParameterization, TestBatch)
+{
+  // trajectories of different lengths, parameterized one after the other for reference
+  std::vector<robot_trajectory::RobotTrajectoryPtr> trajectories;
+  std::vector<double> durations;
+  trajectory_processing::TimeOptimalTrajectoryGeneration time_parameterization;
+  for (unsigned num = 10; num < 200; num += 20)
+  {
+    auto trajectory = std::make_shared<robot_trajectory::RobotTrajectory>(RMODEL, "right_arm");
+    EXPECT_EQ(initCurvedTrajectory(*trajectory, num), 0);
+    trajectories.push_back(trajectory);
+    robot_trajectory::RobotTrajectory reference(*trajectory, true);
+    EXPECT_TRUE(time_parameterization.computeTimeStamps(reference, 0.5, 0.5));
+    durations.push_back(reference.getDuration());
+  }
+
+  std::vector<std::size_t> failed_index;
+  EXPECT_TRUE(trajectory_processing::computeTimeStampsBatch(time_parameterization, trajectories, 0.5, 0.5, 4,
+                                                            &failed_index));
+  EXPECT_TRUE(failed_index.empty());
+  for (std::size_t i = 0; i < trajectories.size(); ++i)
+    EXPECT_NEAR(trajectories[i]->getDuration(), durations[i], 1e-9) << "trajectory " << i;
+
+  // each thread gets a parameterization of its own, failures are reported by index
+  std::atomic<unsigned> created(0);
+  trajectories.push_back(nullptr);
+  EXPECT_FALSE(trajectory_processing::computeTimeStampsBatch(
+      trajectories,
+      [&created]() -> trajectory_processing::TimeParameterizationFn {
+        ++created;
+        auto parameterization = std::make_shared<trajectory_processing::IterativeSplineParameterization>(false);
+        return [parameterization](robot_trajectory::RobotTrajectory& trajectory, double max_velocity_scaling,
+                                  double max_acceleration_scaling) {
+          return parameterization->computeTimeStamps(trajectory, max_velocity_scaling, max_acceleration_scaling);
+        };
+      },
+      1.0, 1.0, 3, &failed_index));
+  EXPECT_EQ(created, 3u);
+  ASSERT_EQ(failed_index.size(), 1u);
+  EXPECT_EQ(failed_index[0], trajectories.size() - 1);
+}
+
 int main(int argc, char** argv)
 {
   testing::InitGoogleTest(&argc, argv);
@@ -0,0 +1,87 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, PickNik LLC
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik LLC nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include <gtest/gtest.h>
+#include <moveit/trajectory_processing/time_optimal_trajectory_generation.h>
+#include <chrono>
+#include <iostream>
+#include <random>
+
+using trajectory_processing::Path;
+using trajectory_processing::Trajectory;
+
+// Random walk through the joint space with a smoothly changing direction, similar to a shortcut planner output
+std::list<Eigen::VectorXd> makeWaypoints(std::size_t num_waypoints, std::size_t num_joints)
+{
+  std::mt19937 rng(42);
+  std::uniform_real_distribution<double> step(-0.05, 0.05);
+  std::list<Eigen::VectorXd> waypoints;
+  Eigen::VectorXd waypoint = Eigen::VectorXd::Zero(num_joints);
+  Eigen::VectorXd direction = Eigen::VectorXd::Zero(num_joints);
+  for (std::size_t i = 0; i < num_waypoints; ++i)
+  {
+    for (std::size_t j = 0; j < num_joints; ++j)
+      direction[j] = 0.8 * direction[j] + step(rng);
+    waypoint += direction;
+    waypoints.push_back(waypoint);
+  }
+  return waypoints;
+}
+
+TEST(time_optimal_trajectory_generation, benchmarkPathLength)
+{
+  Eigen::VectorXd max_velocities(7);
+  max_velocities << 2.0, 2.0, 2.2, 2.2, 3.0, 3.0, 3.0;
+  Eigen::VectorXd max_accelerations(7);
+  max_accelerations << 5.0, 5.0, 6.0, 6.0, 8.0, 8.0, 8.0;
+
+  for (std::size_t num_waypoints : { 10, 50, 200, 1000 })
+  {
+    const std::list<Eigen::VectorXd> waypoints = makeWaypoints(num_waypoints, 7);
+
+    const auto start = std::chrono::steady_clock::now();
+    Trajectory trajectory(Path(waypoints, 0.1), max_velocities, max_accelerations, 0.001);
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    std::cerr << num_waypoints << " waypoints: " << elapsed.count() * 1000. << "ms" << std::endl;
+
+    ASSERT_TRUE(trajectory.isValid());
+    EXPECT_TRUE(trajectory.getPosition(trajectory.getDuration()).isApprox(waypoints.back()));
+  }
+}
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -121,6 +121,15 @@ public:
    */
   void setAllTransforms(const FixedTransformsMap& transforms);
 
+  /**
+   * @brief A number that changes whenever transforms are removed. It is unique across all instances, so references
+   * to transforms taken at the same generation are still valid. Setting a transform updates it in place.
+   */
+  std::size_t getGeneration() const
+  {
+    return generation_;
+  }
+
   /**@}*/
 
   /**
@@ -200,6 +209,7 @@ public:
 protected:
   std::string target_frame_;
   FixedTransformsMap transforms_map_;
+  std::size_t generation_;
 };
 }  // namespace core
 }  // namespace moveit
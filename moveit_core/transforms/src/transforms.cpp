@@ -39,6 +39,7 @@
 #include <tf2_eigen/tf2_eigen.h>
 #include <boost/algorithm/string/trim.hpp>
 #include "rclcpp/rclcpp.hpp"
+#include <atomic>
 
 namespace moveit
 {
@@ -47,7 +48,17 @@ namespace core
 // Logger
 static const rclcpp::Logger LOGGER = rclcpp::get_logger("moveit_transforms.transforms");
 
-Transforms::Transforms(const std::string& target_frame) : target_frame_(target_frame)
+namespace
+{
+// generations are unique across all instances, so that a handle cached for one instance never matches another
+std::size_t nextGeneration()
+{
+  static std::atomic<std::size_t> generation(0);
+  return ++generation;
+}
+}  // namespace
+
+Transforms::Transforms(const std::string& target_frame) : target_frame_(target_frame), generation_(nextGeneration())
 {
   boost::trim(target_frame_);
   if (target_frame_.empty())
@@ -86,6 +97,7 @@ void Transforms::setAllTransforms(const FixedTransformsMap& transforms)
     ASSERT_ISOMETRY(t.second)  // unsanitized input, could contain a non-isometry
   }
   transforms_map_ = transforms;
+  generation_ = nextGeneration();
 }
 
 bool Transforms::isFixedFrame(const std::string& frame) const
@@ -0,0 +1,83 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, PickNik LLC
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik LLC nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#pragma once
+
+/** \file halton_sequence.h
+ *  \brief Low-discrepancy points in the unit hypercube
+ *
+ *  The points of a Halton sequence cover the unit hypercube much more evenly than independent uniform samples, so
+ *  roadmaps built from them need fewer samples for the same coverage. A random offset per dimension (Cranley-Patterson
+ *  rotation) keeps the even coverage while letting several samplers produce different sequences.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace moveit
+{
+namespace core
+{
+class HaltonSequence
+{
+public:
+  /** \brief Construct the sequence for \e dimension dimensions, using the first \e dimension primes as bases */
+  explicit HaltonSequence(std::size_t dimension);
+
+  std::size_t getDimension() const
+  {
+    return bases_.size();
+  }
+
+  /** \brief Shift all points by \e offsets (modulo 1), one value in [0, 1) per dimension. An empty vector removes the
+   *  offsets. */
+  void setOffsets(const std::vector<double>& offsets);
+
+  /** \brief Write the next point of the sequence, getDimension() coordinates in [0, 1), to \e point */
+  void next(double* point);
+
+  /** \brief Restart the sequence with the point at \e index (the first point has index 1) */
+  void reset(std::uint64_t index = 1)
+  {
+    index_ = index;
+  }
+
+private:
+  std::vector<unsigned int> bases_;
+  std::vector<double> offsets_;
+  std::uint64_t index_;
+};
+}  // namespace core
+}  // namespace moveit
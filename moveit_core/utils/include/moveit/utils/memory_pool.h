@@ -0,0 +1,67 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, PickNik LLC
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik LLC nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#pragma once
+
+/** \file memory_pool.h
+ *  \brief Thread-local caching of fixed-size memory blocks
+ *
+ *  Planners create and destroy large numbers of equally sized objects (robot states, OMPL state values).
+ *  Blocks released through freeCachedBlock() are kept in a per-thread free list, keyed by their size, and are handed
+ *  out again by allocateCachedBlock() without touching malloc. As every thread owns its cache, no locking is involved.
+ *  Blocks may be released by a different thread than the one that allocated them.
+ *
+ *  Caching is disabled by default (capacity 0), in which case both functions reduce to malloc() / free().
+ */
+
+#include <cstddef>
+
+namespace moveit
+{
+namespace core
+{
+/** \brief Allocate a block of \e bytes, reusing a block previously released on this thread if possible */
+void* allocateCachedBlock(std::size_t bytes);
+
+/** \brief Release a block of \e bytes obtained from allocateCachedBlock(). If the cache of the calling thread is full,
+    the memory is returned to the system. */
+void freeCachedBlock(void* block, std::size_t bytes);
+
+/** \brief Set the maximum number of blocks of each size retained per thread. 0 disables caching. */
+void setBlockCacheCapacity(std::size_t blocks_per_size);
+
+/** \brief Get the maximum number of blocks of each size retained per thread */
+std::size_t getBlockCacheCapacity();
+}  // namespace core
+}  // namespace moveit
@@ -0,0 +1,107 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, PickNik LLC
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik LLC nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include <moveit/utils/halton_sequence.h>
+#include <cmath>
+#include <stdexcept>
+
+namespace moveit
+{
+namespace core
+{
+namespace
+{
+std::vector<unsigned int> firstPrimes(std::size_t count)
+{
+  std::vector<unsigned int> primes;
+  for (unsigned int candidate = 2; primes.size() < count; ++candidate)
+  {
+    bool prime = true;
+    for (unsigned int p : primes)
+    {
+      if (p * p > candidate)
+        break;
+      if (candidate % p == 0)
+      {
+        prime = false;
+        break;
+      }
+    }
+    if (prime)
+      primes.push_back(candidate);
+  }
+  return primes;
+}
+
+double radicalInverse(std::uint64_t index, unsigned int base)
+{
+  const double inv_base = 1.0 / base;
+  double factor = inv_base;
+  double result = 0.0;
+  while (index > 0)
+  {
+    result += factor * (index % base);
+    index /= base;
+    factor *= inv_base;
+  }
+  return result;
+}
+}  // namespace
+
+HaltonSequence::HaltonSequence(std::size_t dimension) : bases_(firstPrimes(dimension)), index_(1)
+{
+}
+
+void HaltonSequence::setOffsets(const std::vector<double>& offsets)
+{
+  if (!offsets.empty() && offsets.size() != bases_.size())
+    throw std::invalid_argument("HaltonSequence: expected one offset per dimension");
+  offsets_ = offsets;
+}
+
+void HaltonSequence::next(double* point)
+{
+  for (std::size_t i = 0; i < bases_.size(); ++i)
+  {
+    point[i] = radicalInverse(index_, bases_[i]);
+    if (!offsets_.empty())
+    {
+      point[i] += offsets_[i];
+      point[i] -= std::floor(point[i]);
+    }
+  }
+  ++index_;
+}
+}  // namespace core
+}  // namespace moveit
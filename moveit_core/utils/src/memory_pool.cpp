@@ -0,0 +1,117 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, PickNik LLC
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik LLC nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include <moveit/utils/memory_pool.h>
+#include <atomic>
+#include <cstdlib>
+#include <unordered_map>
+#include <vector>
+
+namespace moveit
+{
+namespace core
+{
+namespace
+{
+std::atomic<std::size_t> BLOCK_CACHE_CAPACITY(0);
+
+class BlockCache
+{
+public:
+  ~BlockCache()
+  {
+    for (auto& free_list : free_lists_)
+      for (void* block : free_list.second)
+        std::free(block);
+  }
+
+  std::vector<void*>& freeList(std::size_t bytes)
+  {
+    return free_lists_[bytes];
+  }
+
+private:
+  std::unordered_map<std::size_t, std::vector<void*>> free_lists_;
+};
+
+BlockCache& threadBlockCache()
+{
+  static thread_local BlockCache cache;
+  return cache;
+}
+}  // namespace
+
+void* allocateCachedBlock(std::size_t bytes)
+{
+  if (BLOCK_CACHE_CAPACITY.load(std::memory_order_relaxed) > 0)
+  {
+    std::vector<void*>& free_list = threadBlockCache().freeList(bytes);
+    if (!free_list.empty())
+    {
+      void* block = free_list.back();
+      free_list.pop_back();
+      return block;
+    }
+  }
+  return std::malloc(bytes);
+}
+
+void freeCachedBlock(void* block, std::size_t bytes)
+{
+  if (!block)
+    return;
+  const std::size_t capacity = BLOCK_CACHE_CAPACITY.load(std::memory_order_relaxed);
+  if (capacity > 0)
+  {
+    std::vector<void*>& free_list = threadBlockCache().freeList(bytes);
+    if (free_list.size() < capacity)
+    {
+      free_list.push_back(block);
+      return;
+    }
+  }
+  std::free(block);
+}
+
+void setBlockCacheCapacity(std::size_t blocks_per_size)
+{
+  BLOCK_CACHE_CAPACITY.store(blocks_per_size);
+}
+
+std::size_t getBlockCacheCapacity()
+{
+  return BLOCK_CACHE_CAPACITY.load();
+}
+}  // namespace core
+}  // namespace moveit
@@ -0,0 +1,148 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, PickNik LLC
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik LLC nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include <chrono>
+#include <random>
+#include <rclcpp/rclcpp.hpp>
+#include <boost/program_options.hpp>
+#include <moveit/cached_ik_kinematics_plugin/cached_ik_kinematics_plugin.h>
+
+namespace po = boost::program_options;
+using cached_ik_kinematics_plugin::IKCache;
+using IKIndex = cached_ik_kinematics_plugin::NearestNeighborsGNAT<IKCache::IKEntry*>;
+
+static const rclcpp::Logger LOGGER = rclcpp::get_logger("cached_ik.benchmark_ik_cache");
+
+namespace
+{
+IKCache::Pose randomPose(std::mt19937& generator)
+{
+  std::uniform_real_distribution<double> position(-1., 1.);
+  std::normal_distribution<double> orientation;
+  IKCache::Pose pose;
+  pose.position.setValue(position(generator), position(generator), position(generator));
+  pose.orientation.setValue(orientation(generator), orientation(generator), orientation(generator),
+                            orientation(generator));
+  pose.orientation.normalize();
+  return pose;
+}
+
+// return the number of nearest-neighbor queries per second
+double measureQueries(const IKIndex& index, const std::vector<IKCache::IKEntry>& queries,
+                      std::vector<IKCache::IKEntry*>& results)
+{
+  results.resize(queries.size());
+  auto start = std::chrono::steady_clock::now();
+  for (std::size_t i = 0; i < queries.size(); ++i)
+    results[i] = index.nearest(const_cast<IKCache::IKEntry*>(&queries[i]));
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  return queries.size() / elapsed.count();
+}
+}  // namespace
+
+/** Benchmark program comparing nearest-neighbor query throughput of the IK cache index
+    with per-element and with batched (vectorized) distance computation */
+int main(int argc, char* argv[])
+{
+  unsigned int num_entries;
+  unsigned int num_queries;
+  unsigned int num_tips;
+  po::options_description desc("Options");
+  // clang-format off
+  desc.add_options()
+      ("help", "show help message")
+      ("entries", po::value<unsigned int>(&num_entries)->default_value(100000), "number of cache entries")
+      ("queries", po::value<unsigned int>(&num_queries)->default_value(10000), "number of nearest-neighbor queries")
+      ("tips", po::value<unsigned int>(&num_tips)->default_value(1), "number of end effector poses per entry");
+  // clang-format on
+
+  po::variables_map vm;
+  po::store(po::parse_command_line(argc, argv, desc), vm);
+  po::notify(vm);
+
+  if (vm.count("help") != 0u)
+  {
+    std::cout << desc << "\n";
+    return 1;
+  }
+
+  std::mt19937 generator(42);
+  auto random_entry = [&] {
+    IKCache::IKEntry entry;
+    for (unsigned int i = 0; i < num_tips; ++i)
+      entry.first.push_back(randomPose(generator));
+    return entry;
+  };
+  std::vector<IKCache::IKEntry> entries(num_entries), queries(num_queries);
+  std::vector<IKCache::IKEntry*> entry_ptrs(num_entries);
+  for (unsigned int i = 0; i < num_entries; ++i)
+  {
+    entries[i] = random_entry();
+    entry_ptrs[i] = &entries[i];
+  }
+  for (auto& query : queries)
+    query = random_entry();
+
+  IKIndex scalar_index, batch_index;
+  auto distance = [](const IKCache::IKEntry* entry1, const IKCache::IKEntry* entry2) {
+    return IKCache::distance(*entry1, *entry2);
+  };
+  scalar_index.setDistanceFunction(distance);
+  batch_index.setDistanceFunction(distance);
+  batch_index.setBatchDistanceFunction(
+      [](IKCache::IKEntry* const& entry, IKCache::IKEntry* const* entries, std::size_t count, double* distances) {
+        IKCache::distances(*entry, entries, count, distances);
+      });
+  scalar_index.add(entry_ptrs);
+  batch_index.add(entry_ptrs);
+
+  std::vector<IKCache::IKEntry*> scalar_results, batch_results;
+  double scalar_rate = measureQueries(scalar_index, queries, scalar_results);
+  double batch_rate = measureQueries(batch_index, queries, batch_results);
+
+  unsigned int num_mismatches = 0;
+  for (unsigned int i = 0; i < num_queries; ++i)
+    if (std::abs(IKCache::distance(queries[i], *scalar_results[i]) -
+                 IKCache::distance(queries[i], *batch_results[i])) > 1e-9)
+      ++num_mismatches;
+
+  RCLCPP_INFO(LOGGER, "Summary for %u entries with %u tips: %g queries/s per element, %g queries/s batched (%gx)",
+              num_entries, num_tips, scalar_rate, batch_rate, batch_rate / scalar_rate);
+  if (num_mismatches > 0)
+  {
+    RCLCPP_ERROR(LOGGER, "%u of %u batched queries returned a different nearest neighbor", num_mismatches, num_queries);
+    return 1;
+  }
+  return 0;
+}
@@ -70,6 +70,53 @@ void CachedIKKinematicsPlugin<KinematicsPlugin>::initCache(const std::string& ro
   // cache_.verifyCache(fk);
 }
 
+template <class KinematicsPlugin>
+void CachedIKKinematicsPlugin<KinematicsPlugin>::buildCache(unsigned int num_samples, unsigned int thread_count)
+{
+  const moveit::core::RobotModelConstPtr& robot_model = KinematicsPlugin::robot_model_;
+  if (!robot_model)
+  {
+    RCLCPP_ERROR(LOGGER, "Building the IK cache requires a solver initialized with a robot model");
+    return;
+  }
+  const moveit::core::JointModelGroup* jmg = robot_model->getJointModelGroup(KinematicsPlugin::getGroupName());
+  const std::string& base_frame = KinematicsPlugin::getBaseFrame();
+  const std::vector<std::string>& tip_frames = KinematicsPlugin::getTipFrames();
+  const std::vector<std::string>& joint_names = KinematicsPlugin::getJointNames();
+
+  // every thread computes FK on its own RobotState, as the wrapped solver's FK may not be thread-safe
+  cache_.buildCache(
+      [&]() -> IKCache::SampleFn {
+        auto state = std::make_shared<moveit::core::RobotState>(robot_model);
+        state->setToDefaultValues();
+        return [&, state](IKEntry& entry) {
+          state->setToRandomPositions(jmg);
+          state->update();
+          const Eigen::Isometry3d base_inv = state->getFrameTransform(base_frame).inverse();
+          entry.first.resize(tip_frames.size());
+          for (std::size_t i = 0; i < tip_frames.size(); ++i)
+          {
+            const Eigen::Isometry3d tip = base_inv * state->getFrameTransform(tip_frames[i]);
+            const Eigen::Quaterniond q(tip.linear());
+            geometry_msgs::msg::Pose pose;
+            pose.position.x = tip.translation().x();
+            pose.position.y = tip.translation().y();
+            pose.position.z = tip.translation().z();
+            pose.orientation.x = q.x();
+            pose.orientation.y = q.y();
+            pose.orientation.z = q.z();
+            pose.orientation.w = q.w();
+            entry.first[i] = Pose(pose);
+          }
+          entry.second.resize(joint_names.size());
+          for (std::size_t i = 0; i < joint_names.size(); ++i)
+            entry.second[i] = state->getVariablePosition(joint_names[i]);
+          return true;
+        };
+      },
+      num_samples, thread_count);
+}
+
 template <class KinematicsPlugin>
 bool CachedMultiTipIKKinematicsPlugin<KinematicsPlugin>::initialize(
     const rclcpp::Node::SharedPtr& node, const moveit::core::RobotModel& robot_model, const std::string& group_name,
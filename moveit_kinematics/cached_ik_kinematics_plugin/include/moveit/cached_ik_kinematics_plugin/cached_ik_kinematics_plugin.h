@@ -43,7 +43,11 @@
 #include <tf2/LinearMath/Quaternion.h>
 #include <tf2/LinearMath/Vector3.h>
 #include <boost/filesystem.hpp>
+#include <atomic>
+#include <functional>
+#include <memory>
 #include <mutex>
+#include <thread>
 #include <unordered_map>
 #include <utility>
 
@@ -115,11 +119,47 @@ public:
   /** verify with forward kinematics that the cache entries are correct */
   void verifyCache(kdl_kinematics_plugin::KDLKinematicsPlugin& fk) const;
 
+  /** distance between the poses of two cache entries, the metric of the nearest-neighbor index */
+  static double distance(const IKEntry& entry1, const IKEntry& entry2);
+  /**
+    compute distances[i] = distance(entry, *entries[i]) for all i < count;
+    the entries are processed in blocks to use SIMD instructions
+  */
+  static void distances(const IKEntry& entry, const IKEntry* const* entries, std::size_t count, double* distances);
+
+  /**
+    sample a cache entry, i.e., a random configuration and its end
+    effector poses; return false if the sample should be skipped
+  */
+  using SampleFn = std::function<bool(IKEntry& entry)>;
+  /**
+    fill the cache offline with num_samples sampled entries, inserted like
+    updateCache() does, on thread_count threads (0 selects the number of
+    hardware threads); every thread calls make_sampler once to obtain its
+    own sampling function, so make_sampler is called concurrently
+  */
+  void buildCache(const std::function<SampleFn()>& make_sampler, unsigned int num_samples,
+                  unsigned int thread_count = 0);
+
 protected:
+  using IKIndex = NearestNeighborsGNAT<IKEntry*>;
+
   /** compute the distance between two joint configurations */
   double configDistance2(const std::vector<double>& config1, const std::vector<double>& config2) const;
-  /** save current state of cache to disk */
+  /** insert (poses,config) as a new cache entry */
+  void addEntry(const std::vector<Pose>& poses, const std::vector<double>& config) const;
+  /** add the pending entries to the index copy not used by readers and publish it; lock_ must be held */
+  void publishPendingEntries() const;
+  /** save current state of cache to disk; lock_ must be held */
   void saveCache() const;
+  /** read the cache file and index its entries; runs in loader_ */
+  void loadCache();
+  /** parse a mapped cache file in the current format; lock_ must be held */
+  bool readCacheFile(const char* data, std::size_t size);
+  /** parse a cache file written before the versioned format; lock_ must be held */
+  bool readLegacyCacheFile();
+  /** block until a pending background load of the cache file has finished */
+  void waitForLoad();
 
   /** number of joints in the system */
   unsigned int num_joints_;
@@ -140,12 +180,30 @@ protected:
     cache of IK solutions
   */
   mutable std::vector<IKEntry> ik_cache_;
-  /** nearest neighbor data structure over IK cache entries */
-  mutable NearestNeighborsGNAT<IKEntry*> ik_nn_;
+  /**
+    nearest neighbor data structure over IK cache entries, used by
+    readers without locking; only accessed through std::atomic_load/store
+  */
+  mutable std::shared_ptr<IKIndex> ik_nn_;
+  /**
+    second copy of the index, only modified by writers once no reader uses
+    it anymore; it lags behind ik_nn_ by the entries in standby_backlog_
+  */
+  mutable std::shared_ptr<IKIndex> ik_nn_standby_;
+  /** entries in ik_nn_ that still need to be added to ik_nn_standby_ */
+  mutable std::vector<IKEntry*> standby_backlog_;
+  /** entries in ik_cache_ that are not yet in either index */
+  mutable std::vector<IKEntry*> pending_entries_;
   /** size of the cache when it was last saved */
   mutable unsigned int last_saved_cache_size_{ 0 };
-  /** mutex for changing IK cache */
+  /** true once ik_cache_ reached its capacity, such that no more entries can be added */
+  mutable std::atomic<bool> cache_full_{ false };
+  /** mutex for changing IK cache, only taken by writers */
   mutable std::mutex lock_;
+  /** background thread reading the cache file */
+  std::thread loader_;
+  /** true while loader_ is still reading the cache file */
+  std::atomic<bool> loading_{ false };
 };
 
 /** a container of IK caches for cases where there is no fixed base frame */
@@ -255,6 +313,13 @@ public:
                         const IKCallbackFn& solution_callback, moveit_msgs::msg::MoveItErrorCodes& error_code,
                         const KinematicsQueryOptions& options = KinematicsQueryOptions()) const override;
 
+  /**
+    fill the cache offline with the solver's tip poses of num_samples
+    random configurations, computed on thread_count threads (0 selects
+    the number of hardware threads)
+  */
+  void buildCache(unsigned int num_samples, unsigned int thread_count = 0);
+
 private:
   rclcpp::Node::SharedPtr node_;
 
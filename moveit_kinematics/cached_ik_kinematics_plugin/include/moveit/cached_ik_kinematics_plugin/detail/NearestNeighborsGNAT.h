@@ -96,6 +96,10 @@ protected:
   // \endcond
 
 public:
+  /** \brief The definition of a function that computes the distances between one element and an array of
+      elements: batchDistFun(data, elements, count, distances) */
+  typedef std::function<void(const _T&, const _T*, std::size_t, double*)> BatchDistanceFunction;
+
   NearestNeighborsGNAT(unsigned int degree = 8, unsigned int minDegree = 4, unsigned int maxDegree = 12,
                        unsigned int maxNumPtsPerLeaf = 50, unsigned int removedCacheSize = 500,
                        bool rebalancing = false)
@@ -122,6 +126,13 @@ public:
     if (tree_)
       rebuildDataStructure();
   }
+  // \brief Set a function that computes the distances between an element and many elements at once.
+  // If set, it is used instead of the distance function to scan the elements of leaf nodes, which
+  // allows to vectorize the distance computation. It must compute the same distances as the distance function.
+  void setBatchDistanceFunction(const BatchDistanceFunction& batchDistFun)
+  {
+    batchDistFun_ = batchDistFun;
+  }
 
   void clear() override
   {
@@ -366,6 +377,30 @@ protected:
     for (it = nbh.rbegin(); it != nbh.rend(); it++, nbhQueue.pop())
       *it = *nbhQueue.top().first;
   }
+  // \brief Call f(element, distance) for all elements of a leaf that are not marked for removal.
+  // The elements are stored contiguously, so with a batch distance function their distances to
+  // data are computed in blocks of LEAF_BLOCK_SIZE elements without allocating memory.
+  template <typename F>
+  void forEachLeafDistance(const _T& data, const std::vector<_T>& elements, const F& f) const
+  {
+    if (!batchDistFun_)
+    {
+      for (const _T& element : elements)
+        if (!isRemoved(element))
+          f(element, NearestNeighbors<_T>::distFun_(data, element));
+      return;
+    }
+    double dist[LEAF_BLOCK_SIZE];
+    for (std::size_t start = 0; start < elements.size(); start += LEAF_BLOCK_SIZE)
+    {
+      const std::size_t count =
+          elements.size() - start < LEAF_BLOCK_SIZE ? elements.size() - start : LEAF_BLOCK_SIZE;
+      batchDistFun_(data, elements.data() + start, count, dist);
+      for (std::size_t i = 0; i < count; ++i)
+        if (!isRemoved(elements[start + i]))
+          f(elements[start + i], dist[i]);
+    }
+  }
 
   // The class used internally to define the GNAT.
   class Node
@@ -537,12 +572,10 @@ protected:
     void nearestK(const GNAT& gnat, const _T& data, std::size_t k, NearQueue& nbh, NodeQueue& nodeQueue,
                   bool& isPivot) const
     {
-      for (unsigned int i = 0; i < data_.size(); ++i)
-        if (!gnat.isRemoved(data_[i]))
-        {
-          if (insertNeighborK(nbh, k, data_[i], data, gnat.distFun_(data, data_[i])))
-            isPivot = false;
-        }
+      gnat.forEachLeafDistance(data, data_, [&](const _T& element, double dist) {
+        if (insertNeighborK(nbh, k, element, data, dist))
+          isPivot = false;
+      });
       if (!children_.empty())
       {
         double dist;
@@ -595,9 +628,8 @@ protected:
     {
       double dist = r;  // note difference with nearestK
 
-      for (unsigned int i = 0; i < data_.size(); ++i)
-        if (!gnat.isRemoved(data_[i]))
-          insertNeighborR(nbh, r, data_[i], gnat.distFun_(data, data_[i]));
+      gnat.forEachLeafDistance(data, data_,
+                               [&](const _T& element, double dist) { insertNeighborR(nbh, r, element, dist); });
       if (!children_.empty())
       {
         Node* child;
@@ -718,5 +750,9 @@ protected:
   GreedyKCenters<_T> pivotSelector_;
   // \brief Cache of removed elements.
   std::unordered_set<const _T*> removed_;
+  // \brief Optional function to compute distances of leaf elements in batches.
+  BatchDistanceFunction batchDistFun_;
+  // \brief Maximum number of elements passed to batchDistFun_ at once.
+  static constexpr std::size_t LEAF_BLOCK_SIZE = 64;
 };
 }  // namespace cached_ik_kinematics_plugin
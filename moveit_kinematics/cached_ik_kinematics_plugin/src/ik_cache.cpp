@@ -35,25 +35,69 @@
 /* Author: Mark Moll */
 
 #include <boost/filesystem/fstream.hpp>
+#include <boost/iostreams/device/mapped_file.hpp>
+#include <Eigen/Core>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
 #include <numeric>
+#include <thread>
 
 #include <moveit/cached_ik_kinematics_plugin/cached_ik_kinematics_plugin.h>
 
 namespace cached_ik_kinematics_plugin
 {
-IKCache::IKCache()
+namespace
 {
+// number of new cache entries collected before they are added to the nearest-neighbor index
+const std::size_t INSERT_BATCH_SIZE = 16;
+
+// Cache files start with this header, followed by num_entries * num_tips poses (x, y, z, qx, qy, qz, qw)
+// and num_entries configurations of num_dofs joint values, both stored as flat arrays of doubles.
+// Files written before the header was introduced start with the number of entries directly.
+const char CACHE_FILE_MAGIC[8] = { 'I', 'K', 'C', 'A', 'C', 'H', 'E', '\0' };
+const uint32_t CACHE_FILE_VERSION = 2;
+const std::size_t POSE_VALUES = 7;
+
+struct CacheFileHeader
+{
+  char magic[8];
+  uint32_t version;
+  uint32_t num_dofs;
+  uint32_t num_tips;
+  uint32_t reserved;
+  uint64_t num_entries;
+};
+static_assert(sizeof(CacheFileHeader) % sizeof(double) == 0, "cache file arrays need to be aligned");
+
+// number of entries whose distances are computed together in IKCache::distances()
+const int DISTANCE_BLOCK_SIZE = 16;
+
+std::shared_ptr<NearestNeighborsGNAT<IKCache::IKEntry*>> createIndex()
+{
+  auto index = std::make_shared<NearestNeighborsGNAT<IKCache::IKEntry*>>();
   // set distance function for nearest-neighbor queries
-  ik_nn_.setDistanceFunction([](const IKEntry* entry1, const IKEntry* entry2) {
-    double dist = 0.;
-    for (unsigned int i = 0; i < entry1->first.size(); ++i)
-      dist += entry1->first[i].distance(entry2->first[i]);
-    return dist;
+  index->setDistanceFunction([](const IKCache::IKEntry* entry1, const IKCache::IKEntry* entry2) {
+    return IKCache::distance(*entry1, *entry2);
+  });
+  // leaf nodes are scanned with the vectorized kernel
+  index->setBatchDistanceFunction([](IKCache::IKEntry* const& entry, IKCache::IKEntry* const* entries,
+                                     std::size_t count, double* distances) {
+    IKCache::distances(*entry, entries, count, distances);
   });
+  return index;
+}
+}  // namespace
+
+IKCache::IKCache() : ik_nn_(createIndex()), ik_nn_standby_(createIndex())
+{
 }
 
 IKCache::~IKCache()
 {
+  waitForLoad();
+  std::lock_guard<std::mutex> slock(lock_);
   if (!ik_cache_.empty())
     saveCache();
 }
@@ -61,6 +105,8 @@ IKCache::~IKCache()
 void IKCache::initializeCache(const std::string& robot_id, const std::string& group_name, const std::string& cache_name,
                               const unsigned int num_joints, const Options& opts)
 {
+  waitForLoad();
+
   // read ROS parameters
   max_cache_size_ = opts.max_cache_size;
   ik_cache_.reserve(max_cache_size_);
@@ -81,58 +127,147 @@ void IKCache::initializeCache(const std::string& robot_id, const std::string& gr
                                std::to_string(std::sqrt(min_config_distance2_)) + ".ikcache");
 
   ik_cache_.clear();
-  ik_nn_.clear();
+  std::atomic_store(&ik_nn_, createIndex());
+  ik_nn_standby_ = createIndex();
+  standby_backlog_.clear();
+  pending_entries_.clear();
+  cache_full_ = false;
   last_saved_cache_size_ = 0;
+  num_joints_ = num_joints;
   if (boost::filesystem::exists(cache_file_name_))
   {
-    // read cache
-    boost::filesystem::ifstream cache_file(cache_file_name_, std::ios_base::binary | std::ios_base::in);
-    cache_file.read((char*)&last_saved_cache_size_, sizeof(unsigned int));
-    unsigned int num_dofs;
-    cache_file.read((char*)&num_dofs, sizeof(unsigned int));
-    unsigned int num_tips;
-    cache_file.read((char*)&num_tips, sizeof(unsigned int));
-
-    RCLCPP_INFO(LOGGER, "Found %d IK solutions for a %d-dof system with %d end effectors in %s", last_saved_cache_size_,
-                num_dofs, num_tips, cache_file_name_.string().c_str());
-
-    unsigned int position_size = 3 * sizeof(tf2Scalar);
-    unsigned int orientation_size = 4 * sizeof(tf2Scalar);
-    unsigned int pose_size = position_size + orientation_size;
-    unsigned int config_size = num_dofs * sizeof(double);
-    unsigned int offset_conf = pose_size * num_tips;
-    unsigned int bufsize = offset_conf + config_size;
-    char* buffer = new char[bufsize];
-    IKEntry entry;
-    entry.first.resize(num_tips);
-    entry.second.resize(num_dofs);
-    ik_cache_.reserve(last_saved_cache_size_);
+    // reading and indexing a large cache takes a while, so do it in the background:
+    // until the loader is done, lookups find no entries and updates are ignored
+    loading_ = true;
+    loader_ = std::thread([this] { loadCache(); });
+  }
+
+  RCLCPP_INFO(LOGGER, "cache file %s initialized!", cache_file_name_.string().c_str());
+}
+
+void IKCache::waitForLoad()
+{
+  if (loader_.joinable())
+    loader_.join();
+}
+
+void IKCache::loadCache()
+{
+  std::lock_guard<std::mutex> slock(lock_);
+  bool success = false;
+  try
+  {
+    boost::iostreams::mapped_file_source file(cache_file_name_.string());
+    if (file.size() >= sizeof(CacheFileHeader) && memcmp(file.data(), CACHE_FILE_MAGIC, sizeof(CACHE_FILE_MAGIC)) == 0)
+      success = readCacheFile(file.data(), file.size());
+    else
+      success = readLegacyCacheFile();
+  }
+  catch (const std::exception& e)
+  {
+    RCLCPP_ERROR(LOGGER, "Failed to read IK cache file %s: %s", cache_file_name_.string().c_str(), e.what());
+  }
+  if (!success)
+    ik_cache_.clear();
+
+  std::vector<IKEntry*> ik_entry_ptrs(ik_cache_.size());
+  for (std::size_t i = 0; i < ik_cache_.size(); ++i)
+    ik_entry_ptrs[i] = &ik_cache_[i];
+  std::shared_ptr<IKIndex> ik_nn = createIndex();
+  ik_nn->add(ik_entry_ptrs);
+  ik_nn_standby_->add(ik_entry_ptrs);
+  std::atomic_store(&ik_nn_, ik_nn);
+
+  last_saved_cache_size_ = ik_cache_.size();
+  cache_full_ = ik_cache_.size() >= ik_cache_.capacity();
+  loading_ = false;
+  RCLCPP_INFO(LOGGER, "Loaded %zu IK solutions from %s", ik_cache_.size(), cache_file_name_.string().c_str());
+}
 
-    for (unsigned i = 0; i < last_saved_cache_size_; ++i)
+bool IKCache::readCacheFile(const char* data, std::size_t size)
+{
+  CacheFileHeader header;
+  memcpy(&header, data, sizeof(header));
+  if (header.version != CACHE_FILE_VERSION)
+  {
+    RCLCPP_ERROR(LOGGER, "IK cache file %s has unsupported version %u", cache_file_name_.string().c_str(),
+                 header.version);
+    return false;
+  }
+  const std::size_t num_pose_values = header.num_entries * header.num_tips * POSE_VALUES;
+  const std::size_t num_config_values = header.num_entries * header.num_dofs;
+  if (size < sizeof(header) + (num_pose_values + num_config_values) * sizeof(double))
+  {
+    RCLCPP_ERROR(LOGGER, "IK cache file %s is truncated", cache_file_name_.string().c_str());
+    return false;
+  }
+  RCLCPP_INFO(LOGGER, "Found %lu IK solutions for a %u-dof system with %u end effectors in %s",
+              static_cast<unsigned long>(header.num_entries), header.num_dofs, header.num_tips,
+              cache_file_name_.string().c_str());
+
+  // the arrays start at an 8-byte aligned offset of the page-aligned mapping, so they can be accessed in place
+  const double* pose_values = reinterpret_cast<const double*>(data + sizeof(header));
+  const double* config_values = pose_values + num_pose_values;
+  IKEntry entry;
+  entry.first.resize(header.num_tips);
+  ik_cache_.reserve(header.num_entries);
+  for (std::size_t i = 0; i < header.num_entries; ++i)
+  {
+    for (auto& pose : entry.first)
     {
-      unsigned int j = 0;
-      cache_file.read(buffer, bufsize);
-      for (auto& pose : entry.first)
-      {
-        memcpy(&pose.position[0], buffer + j * pose_size, position_size);
-        memcpy(&pose.orientation[0], buffer + j * pose_size + position_size, orientation_size);
-        ++j;
-      }
-      memcpy(&entry.second[0], buffer + offset_conf, config_size);
-      ik_cache_.push_back(entry);
+      pose.position.setValue(pose_values[0], pose_values[1], pose_values[2]);
+      pose.orientation.setValue(pose_values[3], pose_values[4], pose_values[5], pose_values[6]);
+      pose_values += POSE_VALUES;
     }
-    RCLCPP_INFO(LOGGER, "freeing buffer");
-    delete[] buffer;
-    RCLCPP_INFO(LOGGER, "freed buffer");
-    std::vector<IKEntry*> ik_entry_ptrs(last_saved_cache_size_);
-    for (unsigned int i = 0; i < last_saved_cache_size_; ++i)
-      ik_entry_ptrs[i] = &ik_cache_[i];
-    ik_nn_.add(ik_entry_ptrs);
+    entry.second.assign(config_values, config_values + header.num_dofs);
+    config_values += header.num_dofs;
+    ik_cache_.push_back(entry);
   }
+  return true;
+}
 
-  num_joints_ = num_joints;
+bool IKCache::readLegacyCacheFile()
+{
+  boost::filesystem::ifstream cache_file(cache_file_name_, std::ios_base::binary | std::ios_base::in);
+  unsigned int num_entries;
+  cache_file.read((char*)&num_entries, sizeof(unsigned int));
+  unsigned int num_dofs;
+  cache_file.read((char*)&num_dofs, sizeof(unsigned int));
+  unsigned int num_tips;
+  cache_file.read((char*)&num_tips, sizeof(unsigned int));
+  if (!cache_file)
+    return false;
+
+  RCLCPP_INFO(LOGGER, "Found %d IK solutions for a %d-dof system with %d end effectors in %s", num_entries, num_dofs,
+              num_tips, cache_file_name_.string().c_str());
 
-  RCLCPP_INFO(LOGGER, "cache file %s initialized!", cache_file_name_.string().c_str());
+  unsigned int position_size = 3 * sizeof(tf2Scalar);
+  unsigned int orientation_size = 4 * sizeof(tf2Scalar);
+  unsigned int pose_size = position_size + orientation_size;
+  unsigned int config_size = num_dofs * sizeof(double);
+  unsigned int offset_conf = pose_size * num_tips;
+  unsigned int bufsize = offset_conf + config_size;
+  std::vector<char> buffer(bufsize);
+  IKEntry entry;
+  entry.first.resize(num_tips);
+  entry.second.resize(num_dofs);
+  ik_cache_.reserve(num_entries);
+
+  for (unsigned i = 0; i < num_entries; ++i)
+  {
+    unsigned int j = 0;
+    if (!cache_file.read(buffer.data(), bufsize))
+      return false;
+    for (auto& pose : entry.first)
+    {
+      memcpy(&pose.position[0], buffer.data() + j * pose_size, position_size);
+      memcpy(&pose.orientation[0], buffer.data() + j * pose_size + position_size, orientation_size);
+      ++j;
+    }
+    memcpy(&entry.second[0], buffer.data() + offset_conf, config_size);
+    ik_cache_.push_back(entry);
+  }
+  return true;
 }
 
 double IKCache::configDistance2(const std::vector<double>& config1, const std::vector<double>& config2) const
@@ -148,43 +283,40 @@ double IKCache::configDistance2(const std::vector<double>& config1, const std::v
 
 const IKCache::IKEntry& IKCache::getBestApproximateIKSolution(const Pose& pose) const
 {
-  if (ik_cache_.empty())
+  // readers never lock: they use the index that is current when they start
+  std::shared_ptr<IKIndex> ik_nn = std::atomic_load(&ik_nn_);
+  if (ik_nn->size() == 0)
   {
     static IKEntry dummy = std::make_pair(std::vector<Pose>(1, pose), std::vector<double>(num_joints_, 0.));
     return dummy;
   }
   IKEntry query = std::make_pair(std::vector<Pose>(1, pose), std::vector<double>());
-  return *ik_nn_.nearest(&query);
+  return *ik_nn->nearest(&query);
 }
 
 const IKCache::IKEntry& IKCache::getBestApproximateIKSolution(const std::vector<Pose>& poses) const
 {
-  if (ik_cache_.empty())
+  std::shared_ptr<IKIndex> ik_nn = std::atomic_load(&ik_nn_);
+  if (ik_nn->size() == 0)
   {
     static IKEntry dummy = std::make_pair(poses, std::vector<double>(num_joints_, 0.));
     return dummy;
   }
   IKEntry query = std::make_pair(poses, std::vector<double>());
-  return *ik_nn_.nearest(&query);
+  return *ik_nn->nearest(&query);
 }
 
 void IKCache::updateCache(const IKEntry& nearest, const Pose& pose, const std::vector<double>& config) const
 {
-  if (ik_cache_.size() < ik_cache_.capacity() && (nearest.first[0].distance(pose) > min_pose_distance_ ||
-                                                  configDistance2(nearest.second, config) > min_config_distance2_))
-  {
-    std::lock_guard<std::mutex> slock(lock_);
-    ik_cache_.emplace_back(std::vector<Pose>(1u, pose), config);
-    ik_nn_.add(&ik_cache_.back());
-    if (ik_cache_.size() >= last_saved_cache_size_ + 500u || ik_cache_.size() == max_cache_size_)
-      saveCache();
-  }
+  if (!loading_ && !cache_full_ && (nearest.first[0].distance(pose) > min_pose_distance_ ||
+                       configDistance2(nearest.second, config) > min_config_distance2_))
+    addEntry(std::vector<Pose>(1u, pose), config);
 }
 
 void IKCache::updateCache(const IKEntry& nearest, const std::vector<Pose>& poses,
                           const std::vector<double>& config) const
 {
-  if (ik_cache_.size() < ik_cache_.capacity())
+  if (!loading_ && !cache_full_)
   {
     bool add_to_cache = configDistance2(nearest.second, config) > min_config_distance2_;
     if (!add_to_cache)
@@ -201,14 +333,74 @@ void IKCache::updateCache(const IKEntry& nearest, const std::vector<Pose>& poses
       }
     }
     if (add_to_cache)
+      addEntry(poses, config);
+  }
+}
+
+void IKCache::addEntry(const std::vector<Pose>& poses, const std::vector<double>& config) const
+{
+  std::lock_guard<std::mutex> slock(lock_);
+  // the index refers to entries by pointer, so ik_cache_ must never reallocate
+  if (ik_cache_.size() >= ik_cache_.capacity())
+  {
+    cache_full_ = true;
+    return;
+  }
+  ik_cache_.emplace_back(poses, config);
+  pending_entries_.push_back(&ik_cache_.back());
+  if (pending_entries_.size() >= INSERT_BATCH_SIZE || ik_cache_.size() == ik_cache_.capacity())
+    publishPendingEntries();
+  if (ik_cache_.size() >= last_saved_cache_size_ + 500u || ik_cache_.size() == max_cache_size_)
+    saveCache();
+}
+
+void IKCache::publishPendingEntries() const
+{
+  // wait for readers that loaded the standby index before it was last replaced
+  while (ik_nn_standby_.use_count() > 1)
+    std::this_thread::yield();
+  std::atomic_thread_fence(std::memory_order_acquire);
+
+  ik_nn_standby_->add(standby_backlog_);
+  ik_nn_standby_->add(pending_entries_);
+  ik_nn_standby_ = std::atomic_exchange(&ik_nn_, ik_nn_standby_);
+  // the previous index, which is the standby index now, still misses the entries just published
+  standby_backlog_.swap(pending_entries_);
+  pending_entries_.clear();
+}
+
+void IKCache::buildCache(const std::function<SampleFn()>& make_sampler, unsigned int num_samples,
+                         unsigned int thread_count)
+{
+  waitForLoad();
+  if (thread_count == 0)
+    thread_count = std::max(1u, std::thread::hardware_concurrency());
+
+  std::atomic<unsigned int> next_sample(0);
+  auto worker = [&]() {
+    SampleFn sample = make_sampler();
+    IKEntry entry;
+    while (!cache_full_ && next_sample++ < num_samples)
     {
-      std::lock_guard<std::mutex> slock(lock_);
-      ik_cache_.emplace_back(poses, config);
-      ik_nn_.add(&ik_cache_.back());
-      if (ik_cache_.size() >= last_saved_cache_size_ + 500u || ik_cache_.size() == max_cache_size_)
-        saveCache();
+      if (sample(entry))
+        updateCache(getBestApproximateIKSolution(entry.first), entry.first, entry.second);
     }
-  }
+  };
+
+  std::vector<std::thread> threads;
+  threads.reserve(thread_count - 1);
+  for (unsigned int t = 1; t < thread_count; ++t)
+    threads.emplace_back(worker);
+  worker();
+  for (std::thread& thread : threads)
+    thread.join();
+
+  std::lock_guard<std::mutex> slock(lock_);
+  if (!pending_entries_.empty())
+    publishPendingEntries();
+  if (!ik_cache_.empty())
+    saveCache();
+  RCLCPP_INFO(LOGGER, "IK cache contains %zu entries after sampling %u configurations", ik_cache_.size(), num_samples);
 }
 
 void IKCache::saveCache() const
@@ -219,32 +411,34 @@ void IKCache::saveCache() const
   RCLCPP_INFO(LOGGER, "writing %ld IK solutions to %s", ik_cache_.size(), cache_file_name_.string().c_str());
 
   boost::filesystem::ofstream cache_file(cache_file_name_, std::ios_base::binary | std::ios_base::out);
-  unsigned int position_size = 3 * sizeof(tf2Scalar);
-  unsigned int orientation_size = 4 * sizeof(tf2Scalar);
-  unsigned int pose_size = position_size + orientation_size;
-  unsigned int num_tips = ik_cache_[0].first.size();
-  unsigned int config_size = ik_cache_[0].second.size() * sizeof(double);
-  unsigned int offset_conf = num_tips * pose_size;
-  unsigned int bufsize = offset_conf + config_size;
-  char* buffer = new char[bufsize];
-
-  // write number of IK entries and size of each configuration first
-  last_saved_cache_size_ = ik_cache_.size();
-  cache_file.write((char*)&last_saved_cache_size_, sizeof(unsigned int));
-  unsigned int sz = ik_cache_[0].second.size();
-  cache_file.write((char*)&sz, sizeof(unsigned int));
-  cache_file.write((char*)&num_tips, sizeof(unsigned int));
+  CacheFileHeader header;
+  memcpy(header.magic, CACHE_FILE_MAGIC, sizeof(CACHE_FILE_MAGIC));
+  header.version = CACHE_FILE_VERSION;
+  header.num_dofs = ik_cache_[0].second.size();
+  header.num_tips = ik_cache_[0].first.size();
+  header.reserved = 0;
+  header.num_entries = ik_cache_.size();
+  cache_file.write((char*)&header, sizeof(header));
+
+  // first all poses, then all configurations, each as one flat array
+  double pose_values[POSE_VALUES];
   for (const auto& entry : ik_cache_)
   {
-    for (unsigned int i = 0; i < num_tips; ++i)
+    for (const auto& pose : entry.first)
     {
-      memcpy(buffer + i * pose_size, &entry.first[i].position[0], position_size);
-      memcpy(buffer + i * pose_size + position_size, &entry.first[i].orientation[0], orientation_size);
+      pose_values[0] = pose.position.x();
+      pose_values[1] = pose.position.y();
+      pose_values[2] = pose.position.z();
+      pose_values[3] = pose.orientation.x();
+      pose_values[4] = pose.orientation.y();
+      pose_values[5] = pose.orientation.z();
+      pose_values[6] = pose.orientation.w();
+      cache_file.write((char*)pose_values, sizeof(pose_values));
     }
-    memcpy(buffer + offset_conf, &entry.second[0], config_size);
-    cache_file.write(buffer, bufsize);
   }
-  delete[] buffer;
+  for (const auto& entry : ik_cache_)
+    cache_file.write((char*)entry.second.data(), entry.second.size() * sizeof(double));
+  last_saved_cache_size_ = ik_cache_.size();
 }
 
 void IKCache::verifyCache(kdl_kinematics_plugin::KDLKinematicsPlugin& fk) const
@@ -277,6 +471,46 @@ IKCache::Pose::Pose(const geometry_msgs::msg::Pose& pose)
   orientation = tf2::Quaternion(pose.orientation.x, pose.orientation.y, pose.orientation.z, pose.orientation.w);
 }
 
+double IKCache::distance(const IKEntry& entry1, const IKEntry& entry2)
+{
+  double dist = 0.;
+  for (unsigned int i = 0; i < entry1.first.size(); ++i)
+    dist += entry1.first[i].distance(entry2.first[i]);
+  return dist;
+}
+
+void IKCache::distances(const IKEntry& entry, const IKEntry* const* entries, std::size_t count, double* distances)
+{
+  using Block = Eigen::Array<double, DISTANCE_BLOCK_SIZE, 1>;
+  std::fill(distances, distances + count, 0.);
+  for (std::size_t tip = 0; tip < entry.first.size(); ++tip)
+  {
+    const Pose& ref = entry.first[tip];
+    const double ref_length2 = ref.orientation.length2();
+    for (std::size_t start = 0; start < count; start += DISTANCE_BLOCK_SIZE)
+    {
+      const int n = std::min<std::size_t>(DISTANCE_BLOCK_SIZE, count - start);
+      // gather the pose values into a structure of arrays; unused lanes get harmless values
+      Block dx = Block::Zero(), dy = Block::Zero(), dz = Block::Zero(), dot = Block::Zero();
+      Block length2 = Block::Ones();
+      for (int i = 0; i < n; ++i)
+      {
+        const Pose& pose = entries[start + i]->first[tip];
+        dx[i] = pose.position.x() - ref.position.x();
+        dy[i] = pose.position.y() - ref.position.y();
+        dz[i] = pose.position.z() - ref.position.z();
+        dot[i] = pose.orientation.dot(ref.orientation);
+        length2[i] = pose.orientation.length2();
+      }
+      // same as Pose::distance(): position distance plus tf2::Quaternion::angleShortestPath()
+      const Block position_dist = (dx.square() + dy.square() + dz.square()).sqrt();
+      const Block cos_half_angle = (dot.abs() / (length2 * ref_length2).sqrt()).min(1.);
+      for (int i = 0; i < n; ++i)
+        distances[start + i] += position_dist[i] + 2. * std::acos(cos_half_angle[i]);
+    }
+  }
+}
+
 double IKCache::Pose::distance(const Pose& pose) const
 {
   return (position - pose.position).length() + (orientation.angleShortestPath(pose.orientation));
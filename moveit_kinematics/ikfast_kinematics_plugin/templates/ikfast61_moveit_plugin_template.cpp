@@ -47,6 +47,7 @@
 #include <Eigen/Geometry>
 #include <tf2_kdl/tf2_kdl.h>
 #include <tf2_eigen/tf2_eigen.h>
+#include <thread>
 
 // TODO(JafarAbdi): Copied from eigen_conversions/eigen_kdl
 namespace tf
@@ -70,6 +71,8 @@ using namespace moveit::core;
 
 // Need a floating point tolerance when checking joint limits, in case the joint starts at limit
 const double LIMIT_TOLERANCE = .0000001;
+// Minimum number of free joint values solved by each thread, below that starting a thread costs more than it saves
+const std::size_t MIN_FREE_JOINT_SAMPLES_PER_THREAD = 8;
 /// \brief Search modes for searchPositionIK(), see there
 enum SEARCH_MODE
 {
@@ -256,6 +259,23 @@ public:
                      std::vector<std::vector<double>>& solutions, kinematics::KinematicsResult& result,
                      const kinematics::KinematicsQueryOptions& options) const override;
 
+  /**
+   * @brief Computes all IK solutions within the joint limits, sorted by their distance to the seed state.
+   * The redundant joint is sampled as in getPositionIK() for multiple solutions.
+   */
+  bool getAllPositionIK(
+      const geometry_msgs::msg::Pose& ik_pose, const std::vector<double>& ik_seed_state,
+      std::vector<std::vector<double>>& solutions, moveit_msgs::msg::MoveItErrorCodes& error_code,
+      const kinematics::KinematicsQueryOptions& options = kinematics::KinematicsQueryOptions()) const override;
+
+  /**
+   * @brief Without redundant joints, getAllPositionIK() finds every solution that searchPositionIK() could
+   */
+  bool providesAllPositionIK() const override
+  {
+    return free_params_.empty();
+  }
+
   /**
    * @brief Given a desired pose of the end-effector, search for the joint angles required to reach it.
    * This particular method is intended for "searching" for a solutions by stepping through the redundancy
@@ -352,6 +372,15 @@ private:
    */
   size_t solve(KDL::Frame& pose_frame, const std::vector<double>& vfree, IkSolutionList<IkReal>& solutions) const;
 
+  /**
+   * @brief Calls the IK solver from IKFast for the free joint values [begin, end) of \e free_values, in parallel
+   * @param solutions For each of these free joint values, the solutions within the joint limits, rotated to be near
+   * the seed state and stored one after the other. The buffers are reused between calls.
+   */
+  void solveFreeJointSamples(KDL::Frame& pose_frame, const std::vector<double>& free_values, std::size_t begin,
+                             std::size_t end, const std::vector<double>& ik_seed_state,
+                             std::vector<std::vector<double>>& solutions) const;
+
   /**
    * @brief Gets a specific solution from the set
    */
@@ -669,6 +698,62 @@ size_t IKFastKinematicsPlugin::solve(KDL::Frame& pose_frame, const std::vector<d
   }
 }
 
+void IKFastKinematicsPlugin::solveFreeJointSamples(KDL::Frame& pose_frame, const std::vector<double>& free_values,
+                                                   std::size_t begin, std::size_t end,
+                                                   const std::vector<double>& ik_seed_state,
+                                                   std::vector<std::vector<double>>& solutions) const
+{
+  const std::size_t count = end - begin;
+  if (solutions.size() < count)
+    solutions.resize(count);
+
+  // ComputeIk() only uses local state, so disjoint ranges of samples can be solved concurrently
+  auto solve_range = [&](std::size_t first, std::size_t last) {
+    IkSolutionList<IkReal> ik_solutions;
+    std::vector<double> vfree(free_params_.size());
+    std::vector<double> sol;
+    for (std::size_t k = first; k < last; ++k)
+    {
+      std::vector<double>& sample_solutions = solutions[k - begin];
+      sample_solutions.clear();
+      vfree[0] = free_values[k];
+      size_t numsol = solve(pose_frame, vfree, ik_solutions);
+      for (size_t s = 0; s < numsol; ++s)
+      {
+        getSolution(ik_solutions, ik_seed_state, s, sol);
+
+        bool obeys_limits = true;
+        for (size_t i = 0; i < sol.size(); i++)
+        {
+          if (joint_has_limits_vector_[i] && (sol[i] < joint_min_vector_[i] || sol[i] > joint_max_vector_[i]))
+          {
+            obeys_limits = false;
+            break;
+          }
+        }
+        if (obeys_limits)
+          sample_solutions.insert(sample_solutions.end(), sol.begin(), sol.end());
+      }
+    }
+  };
+
+  const std::size_t num_threads = std::min<std::size_t>(std::max(1u, std::thread::hardware_concurrency()),
+                                                        count / MIN_FREE_JOINT_SAMPLES_PER_THREAD);
+  if (num_threads <= 1)
+  {
+    solve_range(begin, end);
+    return;
+  }
+
+  std::vector<std::thread> threads;
+  threads.reserve(num_threads - 1);
+  for (std::size_t t = 1; t < num_threads; ++t)
+    threads.emplace_back(solve_range, begin + count * t / num_threads, begin + count * (t + 1) / num_threads);
+  solve_range(begin, begin + count / num_threads);
+  for (std::thread& thread : threads)
+    thread.join();
+}
+
 void IKFastKinematicsPlugin::getSolution(const IkSolutionList<IkReal>& solutions, int i,
                                          std::vector<double>& solution) const
 {
@@ -885,40 +970,23 @@ bool IKFastKinematicsPlugin::searchPositionIK(const geometry_msgs::msg::Pose& ik
   {
     RCLCPP_DEBUG_STREAM(LOGGER, "No need to search since no free params/redundant joints");
 
-    std::vector<geometry_msgs::msg::Pose> ik_poses(1, ik_pose);
+    // Find all IK solutions within joint limits, sorted by their distance to the seed
     std::vector<std::vector<double>> solutions;
-    kinematics::KinematicsResult kinematic_result;
-    // Find all IK solutions within joint limits
-    if (!getPositionIK(ik_poses, ik_seed_state, solutions, kinematic_result, options))
+    if (!getAllPositionIK(ik_pose, ik_seed_state, solutions, error_code, options))
     {
       RCLCPP_DEBUG(LOGGER, "No solution whatsoever");
-      error_code.val = moveit_msgs::msg::MoveItErrorCodes::NO_IK_SOLUTION;
       return false;
     }
 
-    // sort solutions by their distance to the seed
-    std::vector<LimitObeyingSol> solutions_obey_limits;
-    for (std::size_t i = 0; i < solutions.size(); ++i)
-    {
-      double dist_from_seed = 0.0;
-      for (std::size_t j = 0; j < ik_seed_state.size(); ++j)
-      {
-        dist_from_seed += fabs(ik_seed_state[j] - solutions[i][j]);
-      }
-
-      solutions_obey_limits.push_back({ solutions[i], dist_from_seed });
-    }
-    std::sort(solutions_obey_limits.begin(), solutions_obey_limits.end());
-
     // check for collisions if a callback is provided
     if (!solution_callback.empty())
     {
-      for (std::size_t i = 0; i < solutions_obey_limits.size(); ++i)
+      for (const std::vector<double>& candidate : solutions)
       {
-        solution_callback(ik_pose, solutions_obey_limits[i].value, error_code);
+        solution_callback(ik_pose, candidate, error_code);
         if (error_code.val == moveit_msgs::msg::MoveItErrorCodes::SUCCESS)
         {
-          solution = solutions_obey_limits[i].value;
+          solution = candidate;
           RCLCPP_DEBUG(LOGGER, "Solution passes callback");
           return true;
         }
@@ -929,7 +997,7 @@ bool IKFastKinematicsPlugin::searchPositionIK(const geometry_msgs::msg::Pose& ik
     }
     else
     {
-      solution = solutions_obey_limits[0].value;
+      solution = solutions[0];
       error_code.val = moveit_msgs::msg::MoveItErrorCodes::SUCCESS;
       return true;  // no collision check callback provided
     }
@@ -966,12 +1034,9 @@ bool IKFastKinematicsPlugin::searchPositionIK(const geometry_msgs::msg::Pose& ik
   KDL::Frame frame;
   transformToChainFrame(ik_pose, frame);
 
-  std::vector<double> vfree(free_params_.size());
-
   int counter = 0;
 
   double initial_guess = ik_seed_state[free_params_[0]];
-  vfree[0] = initial_guess;
 
   // -------------------------------------------------------------------------------------------------
   // Handle consitency limits if needed
@@ -1008,82 +1073,71 @@ bool IKFastKinematicsPlugin::searchPositionIK(const geometry_msgs::msg::Pose& ik
   std::vector<double> best_solution;
   int nattempts = 0, nvalid = 0;
 
-  while (true)
+  // the free joint values in the order they are searched, alternating around the initial guess
+  std::vector<double> free_values(1, initial_guess);
+  while (getCount(counter, num_positive_increments, -num_negative_increments))
+    free_values.push_back(initial_guess + search_discretization * counter);
+
+  // The IKFast solutions of a batch of free joint values are computed in parallel, then checked in the search order,
+  // so the callback is never called concurrently. Searching for the first solution stops after the first batch
+  // containing one, searching for the best solution solves the whole sweep at once.
+  const std::size_t batch_size =
+      (search_mode & OPTIMIZE_MAX_JOINT) ?
+          free_values.size() :
+          std::max(1u, std::thread::hardware_concurrency()) * MIN_FREE_JOINT_SAMPLES_PER_THREAD;
+  std::vector<std::vector<double>> batch_solutions;
+
+  for (std::size_t begin = 0; begin < free_values.size(); begin += batch_size)
   {
-    IkSolutionList<IkReal> solutions;
-    size_t numsol = solve(frame, vfree, solutions);
+    const std::size_t end = std::min(begin + batch_size, free_values.size());
+    solveFreeJointSamples(frame, free_values, begin, end, ik_seed_state, batch_solutions);
 
-    RCLCPP_DEBUG_STREAM(LOGGER, "Found " << numsol << " solutions from IKFast");
-
-    if (numsol > 0)
+    for (std::size_t k = 0; k < end - begin; ++k)
     {
-      for (size_t s = 0; s < numsol; ++s)
+      const std::vector<double>& sample_solutions = batch_solutions[k];
+      RCLCPP_DEBUG_STREAM(LOGGER, "Found " << sample_solutions.size() / num_joints_
+                                           << " solutions within limits from IKFast");
+
+      for (std::size_t offset = 0; offset < sample_solutions.size(); offset += num_joints_)
       {
         nattempts++;
-        std::vector<double> sol;
-        getSolution(solutions, ik_seed_state, s, sol);
+        solution.assign(sample_solutions.begin() + offset, sample_solutions.begin() + offset + num_joints_);
 
-        bool obeys_limits = true;
-        for (size_t i = 0; i < sol.size(); i++)
+        // This solution is within joint limits, now check if in collision (if callback provided)
+        if (!solution_callback.empty())
         {
-          if (joint_has_limits_vector_[i] && (sol[i] < joint_min_vector_[i] || sol[i] > joint_max_vector_[i]))
-          {
-            obeys_limits = false;
-            break;
-          }
-          // RCLCPP_INFO_STREAM(LOGGER,"Num " << i << " value " << sol[i] << " has limits " <<
-          // joint_has_limits_vector_[i] << " " << joint_min_vector_[i] << " " << joint_max_vector_[i]);
+          solution_callback(ik_pose, solution, error_code);
         }
-        if (obeys_limits)
+        else
         {
-          getSolution(solutions, ik_seed_state, s, solution);
-
-          // This solution is within joint limits, now check if in collision (if callback provided)
-          if (!solution_callback.empty())
-          {
-            solution_callback(ik_pose, solution, error_code);
-          }
-          else
-          {
-            error_code.val = error_code.SUCCESS;
-          }
+          error_code.val = error_code.SUCCESS;
+        }
 
-          if (error_code.val == error_code.SUCCESS)
+        if (error_code.val == error_code.SUCCESS)
+        {
+          nvalid++;
+          if (search_mode & OPTIMIZE_MAX_JOINT)
           {
-            nvalid++;
-            if (search_mode & OPTIMIZE_MAX_JOINT)
+            // Costs for solution: Largest joint motion
+            double costs = 0.0;
+            for (unsigned int i = 0; i < solution.size(); i++)
             {
-              // Costs for solution: Largest joint motion
-              double costs = 0.0;
-              for (unsigned int i = 0; i < solution.size(); i++)
-              {
-                double d = fabs(ik_seed_state[i] - solution[i]);
-                if (d > costs)
-                  costs = d;
-              }
-              if (costs < best_costs || best_costs == -1.0)
-              {
-                best_costs = costs;
-                best_solution = solution;
-              }
+              double d = fabs(ik_seed_state[i] - solution[i]);
+              if (d > costs)
+                costs = d;
+            }
+            if (costs < best_costs || best_costs == -1.0)
+            {
+              best_costs = costs;
+              best_solution = solution;
             }
-            else
-              // Return first feasible solution
-              return true;
           }
+          else
+            // Return first feasible solution
+            return true;
         }
       }
     }
-
-    if (!getCount(counter, num_positive_increments, -num_negative_increments))
-    {
-      // Everything searched
-      error_code.val = moveit_msgs::msg::MoveItErrorCodes::NO_IK_SOLUTION;
-      break;
-    }
-
-    vfree[0] = initial_guess + search_discretization * counter;
-    // RCLCPP_DEBUG_STREAM(LOGGER,"Attempt " << counter << " with 0th free joint having value " << vfree[0]);
   }
 
   RCLCPP_DEBUG_STREAM(LOGGER, "Valid solutions: " << nvalid << "/" << nattempts);
@@ -1210,6 +1264,45 @@ bool IKFastKinematicsPlugin::getPositionIK(const geometry_msgs::msg::Pose& ik_po
   return false;
 }
 
+bool IKFastKinematicsPlugin::getAllPositionIK(const geometry_msgs::msg::Pose& ik_pose,
+                                              const std::vector<double>& ik_seed_state,
+                                              std::vector<std::vector<double>>& solutions,
+                                              moveit_msgs::msg::MoveItErrorCodes& error_code,
+                                              const kinematics::KinematicsQueryOptions& options) const
+{
+  std::vector<geometry_msgs::msg::Pose> ik_poses(1, ik_pose);
+  std::vector<std::vector<double>> unsorted_solutions;
+  kinematics::KinematicsResult kinematic_result;
+  solutions.clear();
+  // Find all IK solutions within joint limits
+  if (!getPositionIK(ik_poses, ik_seed_state, unsorted_solutions, kinematic_result, options))
+  {
+    error_code.val = moveit_msgs::msg::MoveItErrorCodes::NO_IK_SOLUTION;
+    return false;
+  }
+
+  // sort solutions by their distance to the seed
+  std::vector<LimitObeyingSol> solutions_obey_limits;
+  solutions_obey_limits.reserve(unsorted_solutions.size());
+  for (std::vector<double>& unsorted_solution : unsorted_solutions)
+  {
+    double dist_from_seed = 0.0;
+    for (std::size_t j = 0; j < ik_seed_state.size(); ++j)
+    {
+      dist_from_seed += fabs(ik_seed_state[j] - unsorted_solution[j]);
+    }
+
+    solutions_obey_limits.push_back({ std::move(unsorted_solution), dist_from_seed });
+  }
+  std::sort(solutions_obey_limits.begin(), solutions_obey_limits.end());
+
+  solutions.reserve(solutions_obey_limits.size());
+  for (LimitObeyingSol& solution_obey_limits : solutions_obey_limits)
+    solutions.push_back(std::move(solution_obey_limits.value));
+  error_code.val = moveit_msgs::msg::MoveItErrorCodes::SUCCESS;
+  return true;
+}
+
 bool IKFastKinematicsPlugin::getPositionIK(const std::vector<geometry_msgs::msg::Pose>& ik_poses,
                                            const std::vector<double>& ik_seed_state,
                                            std::vector<std::vector<double>>& solutions,
@@ -95,6 +95,9 @@ public:
 private:
   bool jacToJacReduced(const Jacobian& jac, Jacobian& jac_reduced);
 
+  /// Solve the decomposed system for rhs into the preallocated x, ignoring singular values below the threshold
+  void solveDecomposed(const Eigen::Ref<const Eigen::VectorXd>& rhs, Eigen::VectorXd& x);
+
   // Mimic joint specific
   const std::vector<kdl_kinematics_plugin::JointMimic>& mimic_joints_;
   int num_mimic_joints_;
@@ -105,6 +108,10 @@ private:
   Eigen::JacobiSVD<Eigen::MatrixXd> svd_;
   Eigen::VectorXd qdot_out_reduced_;
 
+  // preallocated buffers, such that CartToJnt() doesn't allocate memory
+  Eigen::MatrixXd jac_weighted_;  // weighted (position-only) Jacobian passed to the SVD
+  Eigen::VectorXd svd_tmp_;       // U^T * v_in, scaled by the inverse singular values
+
   Jacobian jac_;          // full Jacobian
   Jacobian jac_reduced_;  // reduced Jacobian with contributions of mimic joints mapped onto active DoFs
 };
@@ -107,6 +107,17 @@ public:
       const IKCallbackFn& solution_callback, moveit_msgs::msg::MoveItErrorCodes& error_code,
       const kinematics::KinematicsQueryOptions& options = kinematics::KinematicsQueryOptions()) const override;
 
+  /**
+   * @brief Solve a batch of IK queries in parallel. Every worker thread allocates its own IKWorkspace and random
+   * number generator once and reuses them for all the poses it solves.
+   */
+  bool searchPositionIKBatch(
+      const std::vector<geometry_msgs::msg::Pose>& ik_poses, const std::vector<std::vector<double> >& ik_seed_states,
+      double timeout, std::vector<std::vector<double> >& solutions,
+      std::vector<moveit_msgs::msg::MoveItErrorCodes>& error_codes,
+      const kinematics::KinematicsQueryOptions& options = kinematics::KinematicsQueryOptions(),
+      unsigned int thread_count = 0) const override;
+
   bool getPositionFK(const std::vector<std::string>& link_names, const std::vector<double>& joint_angles,
                      std::vector<geometry_msgs::msg::Pose>& poses) const override;
 
@@ -127,16 +138,58 @@ public:
 protected:
   typedef Eigen::Matrix<double, 6, 1> Twist;
 
+  /** @brief Solvers and buffers for one IK query at a time
+   *
+   * All members are sized for the plugin's chain on construction, such that solving on a reused workspace does not
+   * allocate memory. The solvers are only created if \e create_solvers is set. */
+  struct IKWorkspace
+  {
+    explicit IKWorkspace(const KDLKinematicsPlugin& plugin, bool create_solvers = true);
+    ~IKWorkspace();
+
+    std::unique_ptr<KDL::ChainIkSolverVelMimicSVD> ik_solver_vel;
+    std::unique_ptr<KDL::ChainFkSolverPos> fk_solver;
+    KDL::JntArray seed_state, q_in, q_out;  ///< joint values of the attempts in searchPositionIK()
+    KDL::JntArray delta_q, q_backup;        ///< joint values of the iterations in CartToJnt()
+    Eigen::ArrayXd extra_joint_weights;     ///< reduced weights of joints clipped to their limits
+    Eigen::VectorXd step_joint_weights;     ///< joint weights of the current iteration
+  };
+
+  /// Solve position IK given initial joint values (ws.q_in), storing the result in ws.q_out
+  // NOLINTNEXTLINE(readability-identifier-naming)
+  int CartToJnt(IKWorkspace& ws, const KDL::Frame& p_in, const unsigned int max_iter,
+                const Eigen::Ref<const Eigen::VectorXd>& joint_weights, const Twist& cartesian_weights) const;
+
   /// Solve position IK given initial joint values
   // NOLINTNEXTLINE(readability-identifier-naming)
   int CartToJnt(KDL::ChainIkSolverVelMimicSVD& ik_solver, const KDL::JntArray& q_init, const KDL::Frame& p_in,
                 KDL::JntArray& q_out, const unsigned int max_iter, const Eigen::VectorXd& joint_weights,
                 const Twist& cartesian_weights) const;
 
+  /// Solve position IK given initial joint values, using the given FK solver instead of the shared one
+  // NOLINTNEXTLINE(readability-identifier-naming)
+  int CartToJnt(KDL::ChainIkSolverVelMimicSVD& ik_solver, KDL::ChainFkSolverPos& fk_solver, const KDL::JntArray& q_init,
+                const KDL::Frame& p_in, KDL::JntArray& q_out, const unsigned int max_iter,
+                const Eigen::VectorXd& joint_weights, const Twist& cartesian_weights) const;
+
 private:
+  /// Implementation of CartToJnt() on the given solvers, using the buffers of \e ws
+  // NOLINTNEXTLINE(readability-identifier-naming)
+  int CartToJntImpl(KDL::ChainIkSolverVelMimicSVD& ik_solver, KDL::ChainFkSolverPos& fk_solver, IKWorkspace& ws,
+                    const KDL::Frame& p_in, const unsigned int max_iter,
+                    const Eigen::Ref<const Eigen::VectorXd>& joint_weights, const Twist& cartesian_weights) const;
+
   void getJointWeights();
   bool timedOut(const rclcpp::Time& start_time, double duration) const;
 
+  /** @brief Implementation of searchPositionIK() on a caller-provided workspace and random number generator, which
+   *  must not be used by any other thread for the duration of the call */
+  bool searchPositionIKImpl(const geometry_msgs::msg::Pose& ik_pose, const std::vector<double>& ik_seed_state,
+                            double timeout, const std::vector<double>& consistency_limits, std::vector<double>& solution,
+                            const IKCallbackFn& solution_callback, moveit_msgs::msg::MoveItErrorCodes& error_code,
+                            const kinematics::KinematicsQueryOptions& options, IKWorkspace& ws,
+                            random_numbers::RandomNumberGenerator& rng) const;
+
   /** @brief Check whether the solution lies within the consistency limits of the seed state
    *  @param seed_state Seed state
    *  @param consistency_limits
@@ -146,15 +199,16 @@ private:
   bool checkConsistency(const Eigen::VectorXd& seed_state, const std::vector<double>& consistency_limits,
                         const Eigen::VectorXd& solution) const;
 
-  void getRandomConfiguration(Eigen::VectorXd& jnt_array) const;
+  void getRandomConfiguration(random_numbers::RandomNumberGenerator& rng, Eigen::VectorXd& jnt_array) const;
 
   /** @brief Get a random configuration within consistency limits close to the seed state
+   *  @param rng Random number generator to draw from
    *  @param seed_state Seed state
    *  @param consistency_limits
    *  @param jnt_array Returned random configuration
    */
-  void getRandomConfiguration(const Eigen::VectorXd& seed_state, const std::vector<double>& consistency_limits,
-                              Eigen::VectorXd& jnt_array) const;
+  void getRandomConfiguration(random_numbers::RandomNumberGenerator& rng, const Eigen::VectorXd& seed_state,
+                              const std::vector<double>& consistency_limits, Eigen::VectorXd& jnt_array) const;
 
   /// clip q_delta such that joint limits will not be violated
   void clipToJointLimits(const KDL::JntArray& q, KDL::JntArray& q_delta, Eigen::ArrayXd& weighting) const;
@@ -24,6 +24,7 @@
 // Copyright  (C)  2013  Sachin Chitta, Willow Garage
 
 #include <moveit/kdl_kinematics_plugin/chainiksolver_vel_mimic_svd.hpp>
+#include <algorithm>
 
 namespace
 {
@@ -51,8 +52,11 @@ ChainIkSolverVelMimicSVD::ChainIkSolverVelMimicSVD(const Chain& chain,
   // Performing a position-only IK, we just need to consider the first 3 rows of the Jacobian for SVD
   // SVD doesn't consider mimic joints, but only their driving joints
   , svd_(position_ik ? 3 : 6, chain_.getNrOfJoints() - num_mimic_joints_, Eigen::ComputeThinU | Eigen::ComputeThinV)
+  , qdot_out_reduced_(svd_.cols())
   , jac_(chain_.getNrOfJoints())
   , jac_reduced_(svd_.cols())
+  , jac_weighted_(svd_.rows(), svd_.cols())
+  , svd_tmp_(std::min(svd_.rows(), svd_.cols()))
 {
   assert(mimic_joints_.size() == chain.getNrOfJoints());
 #ifndef NDEBUG
@@ -83,6 +87,15 @@ bool ChainIkSolverVelMimicSVD::jacToJacReduced(const Jacobian& jac, Jacobian& ja
   return true;
 }
 
+void ChainIkSolverVelMimicSVD::solveDecomposed(const Eigen::Ref<const Eigen::VectorXd>& rhs, Eigen::VectorXd& x)
+{
+  // same as svd_.solve(rhs), but without the temporaries allocated by Eigen: x = V * S^-1 * U^T * rhs
+  const Eigen::Index rank = svd_.rank();
+  svd_tmp_.head(rank).noalias() = svd_.matrixU().leftCols(rank).adjoint() * rhs;
+  svd_tmp_.head(rank).array() /= svd_.singularValues().head(rank).array();
+  x.noalias() = svd_.matrixV().leftCols(rank) * svd_tmp_.head(rank);
+}
+
 // NOLINTNEXTLINE(readability-identifier-naming)
 int ChainIkSolverVelMimicSVD::CartToJnt(const JntArray& q_in, const Twist& v_in, JntArray& qdot_out,
                                         const Eigen::VectorXd& joint_weights,
@@ -110,18 +123,20 @@ int ChainIkSolverVelMimicSVD::CartToJnt(const JntArray& q_in, const Twist& v_in,
   vin.bottomRows<3>() = Eigen::Map<const Eigen::Array3d>(v_in.rot.data, 3) * cartesian_weights.bottomRows<3>().array();
 
   // Do a singular value decomposition: J = U*S*V^t
-  svd_.compute(jac.topRows(rows));
+  // (copy into a preallocated matrix first: passing the block directly would create a temporary)
+  jac_weighted_ = jac.topRows(rows);
+  svd_.compute(jac_weighted_);
 
   if (num_mimic_joints_ > 0)
   {
-    qdot_out_reduced_.noalias() = svd_.solve(vin.topRows(rows));
+    solveDecomposed(vin.topRows(rows), qdot_out_reduced_);
     qdot_out_reduced_.array() *= joint_weights.array();
     for (unsigned int i = 0; i < chain_.getNrOfJoints(); ++i)
       qdot_out(i) = qdot_out_reduced_[mimic_joints_[i].map_index] * mimic_joints_[i].multiplier;
   }
   else
   {
-    qdot_out.data.noalias() = svd_.solve(vin.topRows(rows));
+    solveDecomposed(vin.topRows(rows), qdot_out.data);
     qdot_out.data.array() *= joint_weights.array();
   }
 
@@ -45,6 +45,8 @@
 #include <kdl/frames_io.hpp>
 #include <kdl/kinfam_io.hpp>
 
+#include <algorithm>
+
 namespace kdl_kinematics_plugin
 {
 static rclcpp::Logger LOGGER = rclcpp::get_logger("moveit_kdl_kinematics_plugin.kdl_kinematics_plugin");
@@ -53,18 +55,18 @@ KDLKinematicsPlugin::KDLKinematicsPlugin() : initialized_(false)
 {
 }
 
-void KDLKinematicsPlugin::getRandomConfiguration(Eigen::VectorXd& jnt_array) const
+void KDLKinematicsPlugin::getRandomConfiguration(random_numbers::RandomNumberGenerator& rng,
+                                                 Eigen::VectorXd& jnt_array) const
 {
-  state_->setToRandomPositions(joint_model_group_);
-  state_->copyJointGroupPositions(joint_model_group_, &jnt_array[0]);
+  joint_model_group_->getVariableRandomPositions(rng, &jnt_array[0]);
 }
 
-void KDLKinematicsPlugin::getRandomConfiguration(const Eigen::VectorXd& seed_state,
+void KDLKinematicsPlugin::getRandomConfiguration(random_numbers::RandomNumberGenerator& rng,
+                                                 const Eigen::VectorXd& seed_state,
                                                  const std::vector<double>& consistency_limits,
                                                  Eigen::VectorXd& jnt_array) const
 {
-  joint_model_group_->getVariableRandomPositionsNearBy(state_->getRandomNumberGenerator(), &jnt_array[0],
-                                                       &seed_state[0], consistency_limits);
+  joint_model_group_->getVariableRandomPositionsNearBy(rng, &jnt_array[0], &seed_state[0], consistency_limits);
 }
 
 bool KDLKinematicsPlugin::checkConsistency(const Eigen::VectorXd& seed_state,
@@ -322,6 +324,46 @@ bool KDLKinematicsPlugin::searchPositionIK(const geometry_msgs::msg::Pose& ik_po
                                            const IKCallbackFn& solution_callback,
                                            moveit_msgs::msg::MoveItErrorCodes& error_code,
                                            const kinematics::KinematicsQueryOptions& options) const
+{
+  IKWorkspace ws(*this);
+  return searchPositionIKImpl(ik_pose, ik_seed_state, timeout, consistency_limits, solution, solution_callback,
+                              error_code, options, ws, state_->getRandomNumberGenerator());
+}
+
+bool KDLKinematicsPlugin::searchPositionIKBatch(const std::vector<geometry_msgs::msg::Pose>& ik_poses,
+                                                const std::vector<std::vector<double> >& ik_seed_states,
+                                                double timeout, std::vector<std::vector<double> >& solutions,
+                                                std::vector<moveit_msgs::msg::MoveItErrorCodes>& error_codes,
+                                                const kinematics::KinematicsQueryOptions& options,
+                                                unsigned int thread_count) const
+{
+  if (!prepareBatchQuery(ik_poses, ik_seed_states, solutions, error_codes))
+    return false;
+
+  const std::vector<double> consistency_limits;
+  forEachBatchQuery(ik_poses.size(), thread_count, [&]() -> BatchQueryFn {
+    // workspaces are allocated once per worker thread and reused for all its queries
+    auto ws = std::make_shared<IKWorkspace>(*this);
+    auto rng = std::make_shared<random_numbers::RandomNumberGenerator>();
+    return [&, ws, rng](std::size_t i) {
+      const std::vector<double>& seed = ik_seed_states.size() == 1 ? ik_seed_states[0] : ik_seed_states[i];
+      searchPositionIKImpl(ik_poses[i], seed, timeout, consistency_limits, solutions[i], IKCallbackFn(),
+                           error_codes[i], options, *ws, *rng);
+    };
+  });
+
+  return std::all_of(error_codes.begin(), error_codes.end(), [](const moveit_msgs::msg::MoveItErrorCodes& error_code) {
+    return error_code.val == moveit_msgs::msg::MoveItErrorCodes::SUCCESS;
+  });
+}
+
+bool KDLKinematicsPlugin::searchPositionIKImpl(const geometry_msgs::msg::Pose& ik_pose,
+                                               const std::vector<double>& ik_seed_state, double timeout,
+                                               const std::vector<double>& consistency_limits,
+                                               std::vector<double>& solution, const IKCallbackFn& solution_callback,
+                                               moveit_msgs::msg::MoveItErrorCodes& error_code,
+                                               const kinematics::KinematicsQueryOptions& options,
+                                               IKWorkspace& ws, random_numbers::RandomNumberGenerator& rng) const
 {
   rclcpp::Time start_time = node_->now();
   if (!initialized_)
@@ -360,13 +402,12 @@ bool KDLKinematicsPlugin::searchPositionIK(const geometry_msgs::msg::Pose& ik_po
   cartesian_weights.topRows<3>().setConstant(1.0);
   cartesian_weights.bottomRows<3>().setConstant(orientation_vs_position_weight_);
 
-  KDL::JntArray jnt_seed_state(dimension_);
-  KDL::JntArray jnt_pos_in(dimension_);
-  KDL::JntArray jnt_pos_out(dimension_);
+  KDL::JntArray& jnt_seed_state = ws.seed_state;
+  KDL::JntArray& jnt_pos_in = ws.q_in;
+  KDL::JntArray& jnt_pos_out = ws.q_out;
   jnt_seed_state.data = Eigen::Map<const Eigen::VectorXd>(ik_seed_state.data(), ik_seed_state.size());
   jnt_pos_in = jnt_seed_state;
 
-  KDL::ChainIkSolverVelMimicSVD ik_solver_vel(kdl_chain_, mimic_joints_, orientation_vs_position_weight_ == 0.0);
   solution.resize(dimension_);
 
   KDL::Frame pose_desired;
@@ -384,14 +425,14 @@ bool KDLKinematicsPlugin::searchPositionIK(const geometry_msgs::msg::Pose& ik_po
     if (attempt > 1)  // randomly re-seed after first attempt
     {
       if (!consistency_limits_mimic.empty())
-        getRandomConfiguration(jnt_seed_state.data, consistency_limits_mimic, jnt_pos_in.data);
+        getRandomConfiguration(rng, jnt_seed_state.data, consistency_limits_mimic, jnt_pos_in.data);
       else
-        getRandomConfiguration(jnt_pos_in.data);
+        getRandomConfiguration(rng, jnt_pos_in.data);
       RCLCPP_DEBUG_STREAM(LOGGER, "New random configuration (" << attempt << "): " << jnt_pos_in);
     }
 
     int ik_valid =
-        CartToJnt(ik_solver_vel, jnt_pos_in, pose_desired, jnt_pos_out, max_solver_iterations_,
+        CartToJnt(ws, pose_desired, max_solver_iterations_,
                   Eigen::Map<const Eigen::VectorXd>(joint_weights_.data(), joint_weights_.size()), cartesian_weights);
     if (ik_valid == 0 || options.return_approximate_solution)  // found acceptable solution
     {
@@ -421,29 +462,85 @@ bool KDLKinematicsPlugin::searchPositionIK(const geometry_msgs::msg::Pose& ik_po
   return false;
 }
 
+KDLKinematicsPlugin::IKWorkspace::IKWorkspace(const KDLKinematicsPlugin& plugin, bool create_solvers)
+  : seed_state(plugin.dimension_)
+  , q_in(plugin.dimension_)
+  , q_out(plugin.dimension_)
+  , delta_q(plugin.dimension_)
+  , q_backup(plugin.dimension_)
+  , extra_joint_weights(plugin.joint_weights_.size())
+  , step_joint_weights(plugin.joint_weights_.size())
+{
+  if (create_solvers)
+  {
+    ik_solver_vel = std::make_unique<KDL::ChainIkSolverVelMimicSVD>(plugin.kdl_chain_, plugin.mimic_joints_,
+                                                                    plugin.orientation_vs_position_weight_ == 0.0);
+    fk_solver = std::make_unique<KDL::ChainFkSolverPos_recursive>(plugin.kdl_chain_);
+  }
+}
+
+KDLKinematicsPlugin::IKWorkspace::~IKWorkspace() = default;
+
+// NOLINTNEXTLINE(readability-identifier-naming)
+int KDLKinematicsPlugin::CartToJnt(IKWorkspace& ws, const KDL::Frame& p_in, const unsigned int max_iter,
+                                   const Eigen::Ref<const Eigen::VectorXd>& joint_weights,
+                                   const Twist& cartesian_weights) const
+{
+  return CartToJntImpl(*ws.ik_solver_vel, *ws.fk_solver, ws, p_in, max_iter, joint_weights, cartesian_weights);
+}
+
 // NOLINTNEXTLINE(readability-identifier-naming)
 int KDLKinematicsPlugin::CartToJnt(KDL::ChainIkSolverVelMimicSVD& ik_solver, const KDL::JntArray& q_init,
                                    const KDL::Frame& p_in, KDL::JntArray& q_out, const unsigned int max_iter,
                                    const Eigen::VectorXd& joint_weights, const Twist& cartesian_weights) const
+{
+  return CartToJnt(ik_solver, *fk_solver_, q_init, p_in, q_out, max_iter, joint_weights, cartesian_weights);
+}
+
+// NOLINTNEXTLINE(readability-identifier-naming)
+int KDLKinematicsPlugin::CartToJnt(KDL::ChainIkSolverVelMimicSVD& ik_solver, KDL::ChainFkSolverPos& fk_solver,
+                                   const KDL::JntArray& q_init, const KDL::Frame& p_in, KDL::JntArray& q_out,
+                                   const unsigned int max_iter, const Eigen::VectorXd& joint_weights,
+                                   const Twist& cartesian_weights) const
+{
+  // the buffers are allocated per call here, reuse an IKWorkspace to avoid that
+  IKWorkspace ws(*this, false);
+  ws.q_in = q_init;
+  const int result = CartToJntImpl(ik_solver, fk_solver, ws, p_in, max_iter, joint_weights, cartesian_weights);
+  q_out = ws.q_out;
+  return result;
+}
+
+// NOLINTNEXTLINE(readability-identifier-naming)
+int KDLKinematicsPlugin::CartToJntImpl(KDL::ChainIkSolverVelMimicSVD& ik_solver, KDL::ChainFkSolverPos& fk_solver,
+                                       IKWorkspace& ws, const KDL::Frame& p_in, const unsigned int max_iter,
+                                       const Eigen::Ref<const Eigen::VectorXd>& joint_weights,
+                                       const Twist& cartesian_weights) const
 {
   double last_delta_twist_norm = DBL_MAX;
   double step_size = 1.0;
   KDL::Frame f;
   KDL::Twist delta_twist;
-  KDL::JntArray delta_q(q_out.rows()), q_backup(q_out.rows());
-  Eigen::ArrayXd extra_joint_weights(joint_weights.rows());
+  const KDL::JntArray& q_init = ws.q_in;
+  KDL::JntArray& q_out = ws.q_out;
+  KDL::JntArray& delta_q = ws.delta_q;
+  KDL::JntArray& q_backup = ws.q_backup;
+  Eigen::ArrayXd& extra_joint_weights = ws.extra_joint_weights;
   extra_joint_weights.setOnes();
 
   q_out = q_init;
   RCLCPP_DEBUG_STREAM(LOGGER, "Input: " << q_init);
+  // stream logging formats its message even if disabled, which would dominate the cost of the iterations below
+  const bool debug = rcutils_logging_logger_is_enabled_for(LOGGER.get_name(), RCUTILS_LOG_SEVERITY_DEBUG);
 
   unsigned int i;
   bool success = false;
   for (i = 0; i < max_iter; ++i)
   {
-    fk_solver_->JntToCart(q_out, f);
+    fk_solver.JntToCart(q_out, f);
     delta_twist = diff(f, p_in);
-    RCLCPP_DEBUG_STREAM(LOGGER, "[" << std::setw(3) << i << "] delta_twist: " << delta_twist);
+    if (debug)
+      RCLCPP_DEBUG_STREAM(LOGGER, "[" << std::setw(3) << i << "] delta_twist: " << delta_twist);
 
     // check norms of position and orientation errors
     const double position_error = delta_twist.vel.Norm();
@@ -471,7 +568,8 @@ int KDLKinematicsPlugin::CartToJnt(KDL::ChainIkSolverVelMimicSVD& ik_solver, con
       step_size = 1.0;   // reset step size
       last_delta_twist_norm = delta_twist_norm;
 
-      ik_solver.CartToJnt(q_out, delta_twist, delta_q, extra_joint_weights * joint_weights.array(), cartesian_weights);
+      ws.step_joint_weights.array() = extra_joint_weights * joint_weights.array();
+      ik_solver.CartToJnt(q_out, delta_twist, delta_q, ws.step_joint_weights, cartesian_weights);
     }
 
     clipToJointLimits(q_out, delta_q, extra_joint_weights);
@@ -493,8 +591,11 @@ int KDLKinematicsPlugin::CartToJnt(KDL::ChainIkSolverVelMimicSVD& ik_solver, con
 
     KDL::Add(q_out, delta_q, q_out);
 
-    RCLCPP_DEBUG_STREAM(LOGGER, "      delta_q: " << delta_q);
-    RCLCPP_DEBUG_STREAM(LOGGER, "      q: " << q_out);
+    if (debug)
+    {
+      RCLCPP_DEBUG_STREAM(LOGGER, "      delta_q: " << delta_q);
+      RCLCPP_DEBUG_STREAM(LOGGER, "      q: " << q_out);
+    }
   }
 
   int result = (i == max_iter) ? -3 : (success ? 0 : -2);
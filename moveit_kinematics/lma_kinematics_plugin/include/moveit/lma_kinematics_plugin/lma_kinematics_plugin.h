@@ -57,6 +57,13 @@
 #include <moveit/robot_model/robot_model.h>
 #include <moveit/robot_state/robot_state.h>
 
+#include <memory>
+
+namespace KDL
+{
+class ChainIkSolverPos_LMA;
+}
+
 namespace lma_kinematics_plugin
 {
 /**
@@ -99,6 +106,17 @@ public:
       const IKCallbackFn& solution_callback, moveit_msgs::msg::MoveItErrorCodes& error_code,
       const kinematics::KinematicsQueryOptions& options = kinematics::KinematicsQueryOptions()) const override;
 
+  /**
+   * @brief Solve a batch of IK queries in parallel. Every worker thread allocates its own LMA solver and random
+   * number generator once and reuses them for all the poses it solves.
+   */
+  bool searchPositionIKBatch(
+      const std::vector<geometry_msgs::msg::Pose>& ik_poses, const std::vector<std::vector<double> >& ik_seed_states,
+      double timeout, std::vector<std::vector<double> >& solutions,
+      std::vector<moveit_msgs::msg::MoveItErrorCodes>& error_codes,
+      const kinematics::KinematicsQueryOptions& options = kinematics::KinematicsQueryOptions(),
+      unsigned int thread_count = 0) const override;
+
   bool getPositionFK(const std::vector<std::string>& link_names, const std::vector<double>& joint_angles,
                      std::vector<geometry_msgs::msg::Pose>& poses) const override;
 
@@ -119,6 +137,17 @@ public:
 private:
   bool timedOut(const rclcpp::Time& start_time, double duration) const;
 
+  /** Allocate an LMA position solver configured with this plugin's weights, tolerance and iteration limit */
+  std::unique_ptr<KDL::ChainIkSolverPos_LMA> createPositionSolver() const;
+
+  /** @brief Implementation of searchPositionIK() on a caller-provided solver and random number generator, which must
+   *  not be used by any other thread for the duration of the call */
+  bool searchPositionIKImpl(const geometry_msgs::msg::Pose& ik_pose, const std::vector<double>& ik_seed_state,
+                            double timeout, const std::vector<double>& consistency_limits, std::vector<double>& solution,
+                            const IKCallbackFn& solution_callback, moveit_msgs::msg::MoveItErrorCodes& error_code,
+                            const kinematics::KinematicsQueryOptions& options, KDL::ChainIkSolverPos_LMA& ik_solver_pos,
+                            random_numbers::RandomNumberGenerator& rng) const;
+
   /** @brief Check whether the solution lies within the consistency limits of the seed state
    *  @param seed_state Seed state
    *  @param consistency_limits
@@ -132,15 +161,16 @@ private:
   /** Harmonize revolute joint values into the range -2 Pi .. 2 Pi */
   void harmonize(Eigen::VectorXd& values) const;
 
-  void getRandomConfiguration(Eigen::VectorXd& jnt_array) const;
+  void getRandomConfiguration(random_numbers::RandomNumberGenerator& rng, Eigen::VectorXd& jnt_array) const;
 
   /** @brief Get a random configuration within consistency limits close to the seed state
+   *  @param rng Random number generator to draw from
    *  @param seed_state Seed state
    *  @param consistency_limits
    *  @param jnt_array Returned random configuration
    */
-  void getRandomConfiguration(const Eigen::VectorXd& seed_state, const std::vector<double>& consistency_limits,
-                              Eigen::VectorXd& jnt_array) const;
+  void getRandomConfiguration(random_numbers::RandomNumberGenerator& rng, const Eigen::VectorXd& seed_state,
+                              const std::vector<double>& consistency_limits, Eigen::VectorXd& jnt_array) const;
 
   bool initialized_;  ///< Internal variable that indicates whether solver is configured and ready
 
@@ -43,6 +43,8 @@
 #include <kdl/frames_io.hpp>
 #include <kdl/kinfam_io.hpp>
 
+#include <algorithm>
+
 // register as a KinematicsBase implementation
 #include <class_loader/class_loader.hpp>
 CLASS_LOADER_REGISTER_CLASS(lma_kinematics_plugin::LMAKinematicsPlugin, kinematics::KinematicsBase)
@@ -55,18 +57,18 @@ LMAKinematicsPlugin::LMAKinematicsPlugin() : initialized_(false)
 {
 }
 
-void LMAKinematicsPlugin::getRandomConfiguration(Eigen::VectorXd& jnt_array) const
+void LMAKinematicsPlugin::getRandomConfiguration(random_numbers::RandomNumberGenerator& rng,
+                                                 Eigen::VectorXd& jnt_array) const
 {
-  state_->setToRandomPositions(joint_model_group_);
-  state_->copyJointGroupPositions(joint_model_group_, &jnt_array[0]);
+  joint_model_group_->getVariableRandomPositions(rng, &jnt_array[0]);
 }
 
-void LMAKinematicsPlugin::getRandomConfiguration(const Eigen::VectorXd& seed_state,
+void LMAKinematicsPlugin::getRandomConfiguration(random_numbers::RandomNumberGenerator& rng,
+                                                 const Eigen::VectorXd& seed_state,
                                                  const std::vector<double>& consistency_limits,
                                                  Eigen::VectorXd& jnt_array) const
 {
-  joint_model_group_->getVariableRandomPositionsNearBy(state_->getRandomNumberGenerator(), &jnt_array[0],
-                                                       &seed_state[0], consistency_limits);
+  joint_model_group_->getVariableRandomPositionsNearBy(rng, &jnt_array[0], &seed_state[0], consistency_limits);
 }
 
 bool LMAKinematicsPlugin::checkConsistency(const Eigen::VectorXd& seed_state,
@@ -218,7 +220,6 @@ bool LMAKinematicsPlugin::searchPositionIK(const geometry_msgs::msg::Pose& ik_po
                                            moveit_msgs::msg::MoveItErrorCodes& error_code,
                                            const kinematics::KinematicsQueryOptions& options) const
 {
-  rclcpp::Time start_time = node_->now();
   if (!initialized_)
   {
     RCLCPP_ERROR(LOGGER, "kinematics solver not initialized");
@@ -226,6 +227,67 @@ bool LMAKinematicsPlugin::searchPositionIK(const geometry_msgs::msg::Pose& ik_po
     return false;
   }
 
+  std::unique_ptr<KDL::ChainIkSolverPos_LMA> ik_solver_pos = createPositionSolver();
+  return searchPositionIKImpl(ik_pose, ik_seed_state, timeout, consistency_limits, solution, solution_callback,
+                              error_code, options, *ik_solver_pos, state_->getRandomNumberGenerator());
+}
+
+bool LMAKinematicsPlugin::searchPositionIKBatch(const std::vector<geometry_msgs::msg::Pose>& ik_poses,
+                                                const std::vector<std::vector<double> >& ik_seed_states,
+                                                double timeout, std::vector<std::vector<double> >& solutions,
+                                                std::vector<moveit_msgs::msg::MoveItErrorCodes>& error_codes,
+                                                const kinematics::KinematicsQueryOptions& options,
+                                                unsigned int thread_count) const
+{
+  if (!prepareBatchQuery(ik_poses, ik_seed_states, solutions, error_codes))
+    return false;
+  if (!initialized_)
+  {
+    RCLCPP_ERROR(LOGGER, "kinematics solver not initialized");
+    for (moveit_msgs::msg::MoveItErrorCodes& error_code : error_codes)
+      error_code.val = error_code.NO_IK_SOLUTION;
+    return false;
+  }
+
+  const std::vector<double> consistency_limits;
+  forEachBatchQuery(ik_poses.size(), thread_count, [&]() -> BatchQueryFn {
+    // the solver and its workspace matrices are allocated once per worker thread and reused for all its queries
+    std::shared_ptr<KDL::ChainIkSolverPos_LMA> ik_solver_pos = createPositionSolver();
+    auto rng = std::make_shared<random_numbers::RandomNumberGenerator>();
+    return [&, ik_solver_pos, rng](std::size_t i) {
+      const std::vector<double>& seed = ik_seed_states.size() == 1 ? ik_seed_states[0] : ik_seed_states[i];
+      searchPositionIKImpl(ik_poses[i], seed, timeout, consistency_limits, solutions[i], IKCallbackFn(),
+                           error_codes[i], options, *ik_solver_pos, *rng);
+    };
+  });
+
+  return std::all_of(error_codes.begin(), error_codes.end(), [](const moveit_msgs::msg::MoveItErrorCodes& error_code) {
+    return error_code.val == moveit_msgs::msg::MoveItErrorCodes::SUCCESS;
+  });
+}
+
+std::unique_ptr<KDL::ChainIkSolverPos_LMA> LMAKinematicsPlugin::createPositionSolver() const
+{
+  Eigen::Matrix<double, 6, 1> cartesian_weights;
+  cartesian_weights(0) = 1;
+  cartesian_weights(1) = 1;
+  cartesian_weights(2) = 1;
+  cartesian_weights(3) = orientation_vs_position_weight_;
+  cartesian_weights(4) = orientation_vs_position_weight_;
+  cartesian_weights(5) = orientation_vs_position_weight_;
+  return std::make_unique<KDL::ChainIkSolverPos_LMA>(kdl_chain_, cartesian_weights, epsilon_, max_solver_iterations_);
+}
+
+bool LMAKinematicsPlugin::searchPositionIKImpl(const geometry_msgs::msg::Pose& ik_pose,
+                                               const std::vector<double>& ik_seed_state, double timeout,
+                                               const std::vector<double>& consistency_limits,
+                                               std::vector<double>& solution, const IKCallbackFn& solution_callback,
+                                               moveit_msgs::msg::MoveItErrorCodes& error_code,
+                                               const kinematics::KinematicsQueryOptions& options,
+                                               KDL::ChainIkSolverPos_LMA& ik_solver_pos,
+                                               random_numbers::RandomNumberGenerator& rng) const
+{
+  rclcpp::Time start_time = node_->now();
   if (ik_seed_state.size() != dimension_)
   {
     RCLCPP_ERROR(LOGGER, "Seed state must have size %d instead of size %d", dimension_, ik_seed_state.size());
@@ -241,21 +303,12 @@ bool LMAKinematicsPlugin::searchPositionIK(const geometry_msgs::msg::Pose& ik_po
     return false;
   }
 
-  Eigen::Matrix<double, 6, 1> cartesian_weights;
-  cartesian_weights(0) = 1;
-  cartesian_weights(1) = 1;
-  cartesian_weights(2) = 1;
-  cartesian_weights(3) = orientation_vs_position_weight_;
-  cartesian_weights(4) = orientation_vs_position_weight_;
-  cartesian_weights(5) = orientation_vs_position_weight_;
-
   KDL::JntArray jnt_seed_state(dimension_);
   KDL::JntArray jnt_pos_in(dimension_);
   KDL::JntArray jnt_pos_out(dimension_);
   jnt_seed_state.data = Eigen::Map<const Eigen::VectorXd>(ik_seed_state.data(), ik_seed_state.size());
   jnt_pos_in = jnt_seed_state;
 
-  KDL::ChainIkSolverPos_LMA ik_solver_pos(kdl_chain_, cartesian_weights, epsilon_, max_solver_iterations_);
   solution.resize(dimension_);
 
   KDL::Frame pose_desired;
@@ -272,9 +325,9 @@ bool LMAKinematicsPlugin::searchPositionIK(const geometry_msgs::msg::Pose& ik_po
     if (attempt > 1)  // randomly re-seed after first attempt
     {
       if (!consistency_limits.empty())
-        getRandomConfiguration(jnt_seed_state.data, consistency_limits, jnt_pos_in.data);
+        getRandomConfiguration(rng, jnt_seed_state.data, consistency_limits, jnt_pos_in.data);
       else
-        getRandomConfiguration(jnt_pos_in.data);
+        getRandomConfiguration(rng, jnt_pos_in.data);
       RCLCPP_DEBUG_STREAM(LOGGER, "New random configuration (" << attempt << "): " << jnt_pos_in);
     }
 
@@ -45,12 +45,15 @@
 #include <rclcpp/rclcpp.hpp>
 
 // System
+#include <list>
+#include <map>
 #include <memory>
 
 // ROS msgs
 #include <geometry_msgs/msg/pose.hpp>
 #include <moveit_msgs/msg/kinematic_solver_info.hpp>
 #include <moveit_msgs/msg/move_it_error_codes.hpp>
+#include <moveit_msgs/srv/get_position_ik.hpp>
 
 // MoveIt
 #include <moveit/kinematics_base/kinematics_base.h>
@@ -104,6 +107,17 @@ public:
                         const kinematics::KinematicsQueryOptions& options = kinematics::KinematicsQueryOptions(),
                         const moveit::core::RobotState* context_state = nullptr) const override;
 
+  /**
+   * @brief Send the requests of all poses before waiting for the first response, so their round trips to the service
+   * overlap. At most kinematics_solver_max_requests_in_flight requests are pending at a time.
+   */
+  bool searchPositionIKBatch(
+      const std::vector<geometry_msgs::msg::Pose>& ik_poses, const std::vector<std::vector<double> >& ik_seed_states,
+      double timeout, std::vector<std::vector<double> >& solutions,
+      std::vector<moveit_msgs::msg::MoveItErrorCodes>& error_codes,
+      const kinematics::KinematicsQueryOptions& options = kinematics::KinematicsQueryOptions(),
+      unsigned int thread_count = 0) const override;
+
   bool getPositionFK(const std::vector<std::string>& link_names, const std::vector<double>& joint_angles,
                      std::vector<geometry_msgs::msg::Pose>& poses) const override;
 
@@ -136,6 +150,23 @@ private:
 
   bool isRedundantJoint(unsigned int index) const;
 
+  /** @brief Create the service request for one pose per tip frame, seeded with ik_seed_state */
+  moveit_msgs::srv::GetPositionIK::Request::SharedPtr
+  createRequest(const std::vector<geometry_msgs::msg::Pose>& ik_poses, const std::vector<double>& ik_seed_state) const;
+
+  /** @brief Wait for the response of a request sent before and extract the group positions of its solution */
+  bool receiveResponse(const rclcpp::Client<moveit_msgs::srv::GetPositionIK>::SharedFuture& future,
+                       std::vector<double>& solution, moveit_msgs::msg::MoveItErrorCodes& error_code) const;
+
+  /** @brief Look up the solution of an earlier query for exactly the same poses and seed */
+  bool lookupCachedSolution(const std::vector<geometry_msgs::msg::Pose>& ik_poses,
+                            const std::vector<double>& ik_seed_state, std::vector<double>& solution) const;
+
+  /** @brief Remember the solution for ik_poses and ik_seed_state, evicting the least recently used entry if the cache
+      is full */
+  void cacheSolution(const std::vector<geometry_msgs::msg::Pose>& ik_poses, const std::vector<double>& ik_seed_state,
+                     const std::vector<double>& solution) const;
+
   bool active_; /** Internal variable that indicates whether solvers are configured and ready */
 
   moveit_msgs::msg::KinematicSolverInfo ik_group_info_; /** Stores information for the inverse kinematics solver */
@@ -150,6 +181,14 @@ private:
 
   rclcpp::Client<moveit_msgs::srv::GetPositionIK>::SharedPtr ik_service_client_;
 
+  std::size_t max_requests_in_flight_; /** Maximal number of pending requests of a batch */
+
+  std::size_t cache_size_; /** Maximal number of cached solutions, 0 disables the cache */
+
+  /** Cached solutions by their poses and seeds, the most recently used first */
+  mutable std::list<std::pair<std::vector<double>, std::vector<double> > > cache_;
+  mutable std::map<std::vector<double>, decltype(cache_)::iterator> cache_index_;
+
   rclcpp::Node::SharedPtr node_;
 };
 }  // namespace srv_kinematics_plugin
@@ -38,6 +38,8 @@
 #include <moveit/srv_kinematics_plugin/srv_kinematics_plugin.h>
 #include <class_loader/class_loader.hpp>
 #include <moveit/robot_state/conversions.h>
+#include <algorithm>
+#include <deque>
 #include <iterator>
 
 // Eigen
@@ -51,7 +53,23 @@ namespace srv_kinematics_plugin
 {
 static const rclcpp::Logger LOGGER = rclcpp::get_logger("moveit_srv_kinematics_plugin.srv_kinematics_plugin");
 
-SrvKinematicsPlugin::SrvKinematicsPlugin() : active_(false)
+namespace
+{
+// exact position and orientation values of all poses followed by the seed, so only repeated queries of the very same
+// poses from the very same seed hit the cache. The service may return a different solution for a different seed.
+std::vector<double> queryKey(const std::vector<geometry_msgs::msg::Pose>& poses, const std::vector<double>& seed)
+{
+  std::vector<double> key;
+  key.reserve(7 * poses.size() + seed.size());
+  for (const geometry_msgs::msg::Pose& pose : poses)
+    key.insert(key.end(), { pose.position.x, pose.position.y, pose.position.z, pose.orientation.x,
+                            pose.orientation.y, pose.orientation.z, pose.orientation.w });
+  key.insert(key.end(), seed.begin(), seed.end());
+  return key;
+}
+}  // namespace
+
+SrvKinematicsPlugin::SrvKinematicsPlugin() : active_(false), max_requests_in_flight_(8), cache_size_(0)
 {
 }
 
@@ -113,6 +131,16 @@ bool SrvKinematicsPlugin::initialize(const rclcpp::Node::SharedPtr& node, const
   std::string ik_service_name;
   lookupParam(node_, "kinematics_solver_service_name", ik_service_name, std::string("solve_ik"));
 
+  // Solutions are cached by their exact target poses and seeds. The cache is disabled by default, as the service
+  // might check collisions against a scene that changes between queries.
+  int max_requests_in_flight, cache_size;
+  lookupParam(node_, "kinematics_solver_max_requests_in_flight", max_requests_in_flight, 8);
+  lookupParam(node_, "kinematics_solver_cache_size", cache_size, 0);
+  max_requests_in_flight_ = std::max(1, max_requests_in_flight);
+  cache_size_ = std::max(0, cache_size);
+  cache_.clear();
+  cache_index_.clear();
+
   // Setup the joint state groups that we need
   robot_state_.reset(new moveit::core::RobotState(robot_model_));
   robot_state_->setToDefaultValues();
@@ -265,6 +293,123 @@ bool SrvKinematicsPlugin::searchPositionIK(const std::vector<geometry_msgs::msg:
     return false;
   }
 
+  const auto call_service = [&] {
+    RCLCPP_DEBUG(LOGGER, "Calling service: %s", ik_service_client_->get_service_name());
+    return receiveResponse(ik_service_client_->async_send_request(createRequest(ik_poses, ik_seed_state)), solution,
+                           error_code);
+  };
+
+  bool cached = lookupCachedSolution(ik_poses, ik_seed_state, solution);
+  if (cached)
+  {
+    RCLCPP_DEBUG(LOGGER, "Reusing cached IK solution");
+    error_code.val = error_code.SUCCESS;
+  }
+  else if (!call_service())
+    return false;
+
+  // Run the solution callback (i.e. collision checker) if available
+  if (!solution_callback.empty())
+  {
+    RCLCPP_DEBUG(LOGGER, "Calling solution callback on IK solution");
+
+    // hack: should use all poses, not just the 0th
+    solution_callback(ik_poses[0], solution, error_code);
+
+    // the cached solution may not suit this callback, e.g. the scene changed since: ask the service instead
+    if (error_code.val != error_code.SUCCESS && cached)
+    {
+      RCLCPP_DEBUG(LOGGER, "Cached IK solution was rejected by the solution callback");
+      cached = false;
+      if (!call_service())
+        return false;
+      solution_callback(ik_poses[0], solution, error_code);
+    }
+
+    if (error_code.val != error_code.SUCCESS)
+    {
+      switch (error_code.val)
+      {
+        case moveit_msgs::msg::MoveItErrorCodes::FAILURE:
+          RCLCPP_ERROR(LOGGER, "IK solution callback failed with with error code: FAILURE");
+          break;
+        case moveit_msgs::msg::MoveItErrorCodes::NO_IK_SOLUTION:
+          RCLCPP_ERROR(LOGGER, "IK solution callback failed with with error code: "
+                               "NO IK SOLUTION");
+          break;
+        default:
+          RCLCPP_ERROR_STREAM(LOGGER, "IK solution callback failed with with error code: " << error_code.val);
+      }
+      return false;
+    }
+  }
+
+  if (!cached)
+    cacheSolution(ik_poses, ik_seed_state, solution);
+  RCLCPP_INFO(LOGGER, "IK Solver Succeeded!");
+  return true;
+}
+
+bool SrvKinematicsPlugin::searchPositionIKBatch(const std::vector<geometry_msgs::msg::Pose>& ik_poses,
+                                                const std::vector<std::vector<double> >& ik_seed_states,
+                                                double timeout, std::vector<std::vector<double> >& solutions,
+                                                std::vector<moveit_msgs::msg::MoveItErrorCodes>& error_codes,
+                                                const kinematics::KinematicsQueryOptions& options,
+                                                unsigned int thread_count) const
+{
+  // groups with several tips need one pose per tip for each query, which a batch does not provide
+  if (!active_ || tip_frames_.size() != 1)
+    return KinematicsBase::searchPositionIKBatch(ik_poses, ik_seed_states, timeout, solutions, error_codes, options,
+                                                 thread_count);
+
+  if (!prepareBatchQuery(ik_poses, ik_seed_states, solutions, error_codes))
+    return false;
+
+  std::vector<std::size_t> pending;
+  for (std::size_t i = 0; i < ik_poses.size(); ++i)
+  {
+    const std::vector<double>& seed = ik_seed_states.size() == 1 ? ik_seed_states[0] : ik_seed_states[i];
+    if (seed.size() != dimension_)
+    {
+      RCLCPP_ERROR_STREAM(LOGGER, "Seed state must have size " << dimension_ << " instead of size " << seed.size());
+      error_codes[i].val = moveit_msgs::msg::MoveItErrorCodes::NO_IK_SOLUTION;
+    }
+    else if (lookupCachedSolution({ ik_poses[i] }, seed, solutions[i]))
+      error_codes[i].val = moveit_msgs::msg::MoveItErrorCodes::SUCCESS;
+    else
+      pending.push_back(i);
+  }
+
+  // Responses are received in the order of the requests. While waiting for the oldest one, the responses of the
+  // requests sent after it arrive as well, so the batch costs about one round trip per max_requests_in_flight_ poses.
+  RCLCPP_DEBUG(LOGGER, "Calling service %s for %zu poses", ik_service_client_->get_service_name(), pending.size());
+  std::deque<std::pair<std::size_t, rclcpp::Client<moveit_msgs::srv::GetPositionIK>::SharedFuture> > in_flight;
+  auto next = pending.begin();
+  while (next != pending.end() || !in_flight.empty())
+  {
+    for (; next != pending.end() && in_flight.size() < max_requests_in_flight_; ++next)
+    {
+      const std::vector<double>& seed = ik_seed_states.size() == 1 ? ik_seed_states[0] : ik_seed_states[*next];
+      in_flight.emplace_back(*next, ik_service_client_->async_send_request(createRequest({ ik_poses[*next] }, seed)));
+    }
+
+    const std::size_t i = in_flight.front().first;
+    const std::vector<double>& seed = ik_seed_states.size() == 1 ? ik_seed_states[0] : ik_seed_states[i];
+    if (receiveResponse(in_flight.front().second, solutions[i], error_codes[i]))
+      cacheSolution({ ik_poses[i] }, seed, solutions[i]);
+    in_flight.pop_front();
+  }
+
+  return std::all_of(error_codes.begin(), error_codes.end(),
+                     [](const moveit_msgs::msg::MoveItErrorCodes& error_code) {
+                       return error_code.val == moveit_msgs::msg::MoveItErrorCodes::SUCCESS;
+                     });
+}
+
+moveit_msgs::srv::GetPositionIK::Request::SharedPtr
+SrvKinematicsPlugin::createRequest(const std::vector<geometry_msgs::msg::Pose>& ik_poses,
+                                   const std::vector<double>& ik_seed_state) const
+{
   // Create the service message
   auto ik_srv = std::make_shared<moveit_msgs::srv::GetPositionIK::Request>();
   ik_srv->ik_request.avoid_collisions = true;
@@ -295,11 +440,15 @@ bool SrvKinematicsPlugin::searchPositionIK(const std::vector<geometry_msgs::msg:
     ik_srv->ik_request.pose_stamped = ik_pose_st;
     ik_srv->ik_request.ik_link_name = getTipFrames()[0];
   }
+  return ik_srv;
+}
 
-  RCLCPP_DEBUG(LOGGER, "Calling service: %s", ik_service_client_->get_service_name());
-  auto result_future = ik_service_client_->async_send_request(ik_srv);
-  const auto& response = result_future.get();
-  if (rclcpp::spin_until_future_complete(node_, result_future) == rclcpp::FutureReturnCode::SUCCESS)
+bool SrvKinematicsPlugin::receiveResponse(const rclcpp::Client<moveit_msgs::srv::GetPositionIK>::SharedFuture& future,
+                                          std::vector<double>& solution,
+                                          moveit_msgs::msg::MoveItErrorCodes& error_code) const
+{
+  const auto& response = future.get();
+  if (rclcpp::spin_until_future_complete(node_, future) == rclcpp::FutureReturnCode::SUCCESS)
   {
     // Check error code
     error_code.val = response->error_code.val;
@@ -340,35 +489,44 @@ bool SrvKinematicsPlugin::searchPositionIK(const std::vector<geometry_msgs::msg:
 
   // Get just the joints we are concerned about in our planning group
   robot_state_->copyJointGroupPositions(joint_model_group_, solution);
+  return true;
+}
 
-  // Run the solution callback (i.e. collision checker) if available
-  if (!solution_callback.empty())
-  {
-    RCLCPP_DEBUG(LOGGER, "Calling solution callback on IK solution");
-
-    // hack: should use all poses, not just the 0th
-    solution_callback(ik_poses[0], solution, error_code);
+bool SrvKinematicsPlugin::lookupCachedSolution(const std::vector<geometry_msgs::msg::Pose>& ik_poses,
+                                               const std::vector<double>& ik_seed_state,
+                                               std::vector<double>& solution) const
+{
+  if (cache_size_ == 0)
+    return false;
+  const auto entry = cache_index_.find(queryKey(ik_poses, ik_seed_state));
+  if (entry == cache_index_.end())
+    return false;
+  cache_.splice(cache_.begin(), cache_, entry->second);
+  solution = entry->second->second;
+  return true;
+}
 
-    if (error_code.val != error_code.SUCCESS)
-    {
-      switch (error_code.val)
-      {
-        case moveit_msgs::msg::MoveItErrorCodes::FAILURE:
-          RCLCPP_ERROR(LOGGER, "IK solution callback failed with with error code: FAILURE");
-          break;
-        case moveit_msgs::msg::MoveItErrorCodes::NO_IK_SOLUTION:
-          RCLCPP_ERROR(LOGGER, "IK solution callback failed with with error code: "
-                               "NO IK SOLUTION");
-          break;
-        default:
-          RCLCPP_ERROR_STREAM(LOGGER, "IK solution callback failed with with error code: " << error_code.val);
-      }
-      return false;
-    }
+void SrvKinematicsPlugin::cacheSolution(const std::vector<geometry_msgs::msg::Pose>& ik_poses,
+                                        const std::vector<double>& ik_seed_state,
+                                        const std::vector<double>& solution) const
+{
+  if (cache_size_ == 0)
+    return;
+  std::vector<double> key = queryKey(ik_poses, ik_seed_state);
+  const auto entry = cache_index_.find(key);
+  if (entry != cache_index_.end())
+  {
+    entry->second->second = solution;
+    cache_.splice(cache_.begin(), cache_, entry->second);
+    return;
   }
-
-  RCLCPP_INFO(LOGGER, "IK Solver Succeeded!");
-  return true;
+  if (cache_.size() >= cache_size_)
+  {
+    cache_index_.erase(cache_.back().first);
+    cache_.pop_back();
+  }
+  cache_.emplace_front(key, solution);
+  cache_index_.emplace(std::move(key), cache_.begin());
 }
 
 bool SrvKinematicsPlugin::getPositionFK(const std::vector<std::string>& link_names,
@@ -425,6 +425,46 @@ TEST_F(KinematicsTest, randomWalkIK)
   // }
 }
 
+// solve IK for a batch of random reachable poses at once
+TEST_F(KinematicsTest, batchIK)
+{
+  const std::vector<std::string>& tip_frames = kinematics_solver_->getTipFrames();
+  moveit::core::RobotState robot_state(robot_model_);
+  robot_state.setToDefaultValues();
+
+  std::vector<double> seed, goal;
+  robot_state.copyJointGroupPositions(jmg_, seed);
+  std::vector<geometry_msgs::msg::Pose> ik_poses;
+  for (unsigned int i = 0; i < num_ik_tests_; ++i)
+  {
+    robot_state.setToRandomPositions(jmg_, this->rng_);
+    robot_state.copyJointGroupPositions(jmg_, goal);
+    std::vector<geometry_msgs::msg::Pose> poses;
+    ASSERT_TRUE(kinematics_solver_->getPositionFK(tip_frames, goal, poses));
+    ik_poses.push_back(poses[0]);
+  }
+
+  std::vector<std::vector<double> > solutions;
+  std::vector<moveit_msgs::msg::MoveItErrorCodes> error_codes;
+  kinematics_solver_->searchPositionIKBatch(ik_poses, { seed }, timeout_, solutions, error_codes);
+  ASSERT_EQ(solutions.size(), ik_poses.size());
+  ASSERT_EQ(error_codes.size(), ik_poses.size());
+
+  unsigned int failures = 0;
+  for (std::size_t i = 0; i < ik_poses.size(); ++i)
+  {
+    if (error_codes[i].val != error_codes[i].SUCCESS)
+    {
+      ++failures;
+      continue;
+    }
+    std::vector<geometry_msgs::msg::Pose> expected_poses = { ik_poses[i] }, reached_poses;
+    kinematics_solver_->getPositionFK(tip_frames, solutions[i], reached_poses);
+    EXPECT_NEAR_POSES(expected_poses, reached_poses, tolerance_);
+  }
+  EXPECT_LE(failures, (1.0 - EXPECTED_SUCCESS_RATE) * num_ik_tests_);
+}
+
 // TODO(JafarAbdi): Enable after porting the launch files and replacing XMLRPC
 // static double parseDouble(XmlRpc::XmlRpcValue& v)
 // {
@@ -58,6 +58,9 @@ public:
 
   void initialize();
 
+  /** \brief Warm-start the planner from, and store its solutions in, the given cache */
+  void setExperienceCache(const chomp::ChompExperienceCachePtr& experience_cache);
+
 private:
   CHOMPInterfacePtr chomp_interface_;
   moveit::core::RobotModelConstPtr robot_model_;
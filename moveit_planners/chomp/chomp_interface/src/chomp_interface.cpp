@@ -73,5 +73,7 @@ void CHOMPInterface::loadParams()
             std::string("quintic-spline"));
   nh_.param("enable_failure_recovery", params_.enable_failure_recovery_, false);
   nh_.param("max_recovery_attempts", params_.max_recovery_attempts_, 5);
+  nh_.param("max_threads", params_.max_threads_, 1);
+  nh_.param("experience_max_distance", params_.experience_max_distance_, 0.5);
 }
 }  // namespace chomp_interface
@@ -68,6 +68,11 @@ bool CHOMPPlanningContext::solve(planning_interface::MotionPlanResponse& res)
   return planning_success;
 }
 
+void CHOMPPlanningContext::setExperienceCache(const chomp::ChompExperienceCachePtr& experience_cache)
+{
+  chomp_interface_->setExperienceCache(experience_cache);
+}
+
 bool CHOMPPlanningContext::terminate()
 {
   // TODO - make interruptible
@@ -39,6 +39,7 @@
 #include <chomp_interface/chomp_planning_context.h>
 
 #include <pluginlib/class_list_macros.hpp>
+#include <fstream>
 
 namespace chomp_interface
 {
@@ -49,12 +50,37 @@ public:
   {
   }
 
+  ~CHOMPPlannerManager() override
+  {
+    if (!experience_cache_ || experience_cache_file_.empty())
+      return;
+    std::ofstream stream(experience_cache_file_.c_str());
+    if (!experience_cache_->writeToStream(stream))
+      ROS_ERROR("Could not write the CHOMP experience cache to %s", experience_cache_file_.c_str());
+  }
+
   bool initialize(const moveit::core::RobotModelConstPtr& model, const std::string& /*ns*/) override
   {
+    // the cache is shared among the groups, as the experiences are keyed by group
+    ros::NodeHandle nh("~");
+    int experience_cache_size;
+    nh.param("experience_cache_size", experience_cache_size, 0);
+    nh.param("experience_cache_file", experience_cache_file_, std::string());
+    if (experience_cache_size > 0)
+    {
+      experience_cache_ = std::make_shared<chomp::ChompExperienceCache>(experience_cache_size);
+      std::ifstream stream(experience_cache_file_.c_str());
+      if (stream.is_open() && !experience_cache_->readFromStream(stream))
+        ROS_ERROR("Could not read the CHOMP experience cache from %s", experience_cache_file_.c_str());
+      else
+        ROS_INFO("CHOMP experience cache holds %zu experiences", experience_cache_->getExperienceCount());
+    }
+
     for (const std::string& group : model->getJointModelGroupNames())
     {
       planning_contexts_[group] =
           CHOMPPlanningContextPtr(new CHOMPPlanningContext("chomp_planning_context", group, model));
+      planning_contexts_[group]->setExperienceCache(experience_cache_);
     }
     return true;
   }
@@ -112,6 +138,8 @@ public:
 
 protected:
   std::map<std::string, CHOMPPlanningContextPtr> planning_contexts_;
+  chomp::ChompExperienceCachePtr experience_cache_;
+  std::string experience_cache_file_;  // experiences are loaded from and saved to this file, if set
 };
 
 }  // namespace chomp_interface
@@ -44,6 +44,10 @@ namespace chomp
 {
 /**
  * \brief Represents the smoothness cost for CHOMP, for a single joint
+ *
+ * The quadratic cost is a sum of squared finite-difference matrices and therefore banded, with a half bandwidth of
+ * DIFF_RULE_LENGTH - 1. Only the lower band of the cost and of its Cholesky factor are stored, so products with the
+ * cost and with its inverse are linear in the number of trajectory points.
  */
 class ChompCost
 {
@@ -55,9 +59,18 @@ public:
   template <typename Derived>
   void getDerivative(const Eigen::MatrixXd::ColXpr& joint_trajectory, Eigen::MatrixBase<Derived>& derivative) const;
 
-  const Eigen::MatrixXd& getQuadraticCostInverse() const;
+  /** \brief Solve quad_cost * x = b for the free variables, i.e. return the product of the inverse cost with b */
+  Eigen::VectorXd solveQuadraticCost(const Eigen::VectorXd& b) const;
+
+  /** \brief Get a single column of the inverse of the quadratic cost of the free variables */
+  Eigen::VectorXd getQuadraticCostInverseColumn(int index) const;
+
+  /** \brief Get the dense inverse of the quadratic cost. This is quadratic in the number of points, prefer
+   * solveQuadraticCost() or getQuadraticCostInverseColumn() */
+  Eigen::MatrixXd getQuadraticCostInverse() const;
 
-  const Eigen::MatrixXd& getQuadraticCost() const;
+  /** \brief Get the dense quadratic cost of the free variables */
+  Eigen::MatrixXd getQuadraticCost() const;
 
   double getCost(const Eigen::MatrixXd::ColXpr& joint_trajectory) const;
 
@@ -66,34 +79,33 @@ public:
   void scale(double scale);
 
 private:
-  Eigen::MatrixXd quad_cost_full_;
-  Eigen::MatrixXd quad_cost_;
-  // Eigen::VectorXd linear_cost_;
-  Eigen::MatrixXd quad_cost_inv_;
-
-  Eigen::MatrixXd getDiffMatrix(int size, const double* diff_rule) const;
+  // lower band of the symmetric quad cost for all variables, quad_cost_full_band_(k, j) is element (j + k, j)
+  Eigen::MatrixXd quad_cost_full_band_;
+  // lower band of the Cholesky factor L of the quad cost for the free variables, stored like quad_cost_full_band_
+  Eigen::MatrixXd quad_cost_chol_band_;
+  // maximum value of the inverse of the quad cost for the free variables
+  double max_quad_cost_inv_value_;
+
+  void addDiffMatrixProduct(const double* diff_rule, double weight);
+  void factorizeQuadraticCost();
+  Eigen::VectorXd multiplyQuadraticCostFull(const Eigen::VectorXd& x) const;
 };
 
 template <typename Derived>
 void ChompCost::getDerivative(const Eigen::MatrixXd::ColXpr& joint_trajectory,
                               Eigen::MatrixBase<Derived>& derivative) const
 {
-  derivative = (quad_cost_full_ * (2.0 * joint_trajectory));
+  derivative = multiplyQuadraticCostFull(2.0 * joint_trajectory);
 }
 
-inline const Eigen::MatrixXd& ChompCost::getQuadraticCostInverse() const
-{
-  return quad_cost_inv_;
-}
-
-inline const Eigen::MatrixXd& ChompCost::getQuadraticCost() const
+inline double ChompCost::getCost(const Eigen::MatrixXd::ColXpr& joint_trajectory) const
 {
-  return quad_cost_;
+  return joint_trajectory.dot(multiplyQuadraticCostFull(joint_trajectory));
 }
 
-inline double ChompCost::getCost(const Eigen::MatrixXd::ColXpr& joint_trajectory) const
+inline double ChompCost::getMaxQuadCostInvValue() const
 {
-  return joint_trajectory.dot(quad_cost_full_ * joint_trajectory);
+  return max_quad_cost_inv_value_;
 }
 
 }  // namespace chomp
@@ -0,0 +1,104 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, PickNik LLC
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik LLC nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#pragma once
+
+#include <moveit/macros/class_forward.h>
+#include <moveit/planning_scene/planning_scene.h>
+#include <eigen3/Eigen/Core>
+#include <iostream>
+#include <list>
+#include <mutex>
+#include <string>
+
+namespace chomp
+{
+MOVEIT_CLASS_FORWARD(ChompExperienceCache)  // Defines ChompExperienceCachePtr, ConstPtr, WeakPtr... etc
+
+/**
+ * \brief Stores previously optimized trajectories, to warm-start CHOMP on similar requests
+ *
+ * Experiences are keyed by planning group, start and goal configuration and a hash of the planning scene. The
+ * cache holds at most a fixed number of experiences and drops the least recently used ones first.
+ */
+class ChompExperienceCache
+{
+public:
+  ChompExperienceCache(std::size_t max_experiences = 100);
+
+  /** \brief Store a successfully optimized trajectory, one row per trajectory point and one column per joint */
+  void addExperience(const std::string& group_name, std::size_t scene_hash, const Eigen::MatrixXd& trajectory);
+
+  /**
+   * \brief Look up the experience of the group, in the same scene and with the same number of points as
+   * trajectory, that has the closest start and goal to the first and last point of trajectory
+   *
+   * If such an experience exists and the summed distance of its start and goal is below max_distance, the points
+   * of trajectory are replaced with the experience, shifted linearly so its end points match the original ones.
+   * @return true if trajectory was filled in from an experience
+   */
+  bool fillInFromExperience(const std::string& group_name, std::size_t scene_hash, double max_distance,
+                            Eigen::MatrixXd& trajectory) const;
+
+  std::size_t getExperienceCount() const;
+
+  void clear();
+
+  /** \brief Write the experiences in a plain text format */
+  bool writeToStream(std::ostream& stream) const;
+
+  /** \brief Replace the experiences with those written by writeToStream() */
+  bool readFromStream(std::istream& stream);
+
+  /**
+   * \brief Compute a hash of the layout of the world and of the attached bodies of a planning scene
+   *
+   * Only the object ids, shape types and poses contribute; the content of octomaps and meshes does not.
+   */
+  static std::size_t computeSceneHash(const planning_scene::PlanningScene& planning_scene);
+
+private:
+  struct Experience
+  {
+    std::string group_name_;
+    std::size_t scene_hash_;
+    Eigen::MatrixXd trajectory_;
+  };
+
+  std::size_t max_experiences_;
+  // most recently used experience first
+  mutable std::list<Experience> experiences_;
+  mutable std::mutex lock_;
+};
+}  // namespace chomp
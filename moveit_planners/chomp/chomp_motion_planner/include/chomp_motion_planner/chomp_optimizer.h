@@ -108,7 +108,7 @@ private:
   //                     const std::string& group_name,
   //                     Eigen::VectorXd& state_vec);
 
-  void setRobotStateFromPoint(ChompTrajectory& group_trajectory, int i);
+  void setRobotStateFromPoint(ChompTrajectory& group_trajectory, int i, moveit::core::RobotState& state) const;
 
   // collision_proximity::CollisionProximitySpace::TrajectorySafety checkCurrentIterValidity();
 
@@ -136,6 +136,10 @@ private:
   collision_detection::GroupStateRepresentationPtr gsr_;
   bool initialized_;
 
+  // copies of state_ and gsr_ for each thread of performForwardKinematics()
+  std::vector<moveit::core::RobotStatePtr> thread_states_;
+  std::vector<collision_detection::GroupStateRepresentationPtr> thread_gsrs_;
+
   std::vector<std::vector<std::string> > collision_point_joint_names_;
   std::vector<EigenSTL::vector_Vector3d> collision_point_pos_eigen_;
   std::vector<EigenSTL::vector_Vector3d> collision_point_vel_eigen_;
@@ -170,9 +174,6 @@ private:
 
   // temporary variables for all functions:
   Eigen::VectorXd smoothness_derivative_;
-  Eigen::MatrixXd jacobian_;
-  Eigen::MatrixXd jacobian_pseudo_inverse_;
-  Eigen::MatrixXd jacobian_jacobian_tranpose_;
   Eigen::VectorXd random_state_;
   Eigen::VectorXd joint_state_velocities_;
 
@@ -212,8 +213,9 @@ private:
   void getRandomMomentum();
   void updateMomentum();
   void updatePositionFromMomentum();
-  void calculatePseudoInverse();
-  void computeJointProperties(int trajectoryPoint);
+  void calculatePseudoInverse(const Eigen::MatrixXd& jacobian, Eigen::MatrixXd& jacobian_pseudo_inverse) const;
+  void computeJointProperties(int trajectoryPoint, const moveit::core::RobotState& state);
+  void createThreadCopies(int num_threads);
   bool isCurrentTrajectoryMeshToMeshCollisionFree() const;
 };
 }  // namespace chomp
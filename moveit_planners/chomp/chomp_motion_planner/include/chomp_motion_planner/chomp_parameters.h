@@ -94,6 +94,9 @@ public:
                                   /// an initial path is not found with the specified chomp parameters
   int max_recovery_attempts_;     /// this the maximum recovery attempts to find a collision free path after an initial
                                   /// failure to find a solution
+  int max_threads_;  /// number of threads used to evaluate the trajectory points, 1 disables the parallelization
+  double experience_max_distance_;  /// maximum summed joint-space distance of the start and goal of a previous
+                                    /// experience in order to warm-start from it
 };
 
 }  // namespace chomp
@@ -36,6 +36,7 @@
 
 #pragma once
 
+#include <chomp_motion_planner/chomp_experience_cache.h>
 #include <chomp_motion_planner/chomp_parameters.h>
 #include <moveit/planning_interface/planning_request.h>
 #include <moveit/planning_interface/planning_response.h>
@@ -52,5 +53,19 @@ public:
   bool solve(const planning_scene::PlanningSceneConstPtr& planning_scene,
              const planning_interface::MotionPlanRequest& req, const ChompParameters& params,
              planning_interface::MotionPlanDetailedResponse& res) const;
+
+  /** \brief Warm-start from, and store successful trajectories in, the given cache. Pass nullptr to disable. */
+  void setExperienceCache(const ChompExperienceCachePtr& experience_cache)
+  {
+    experience_cache_ = experience_cache;
+  }
+
+  const ChompExperienceCachePtr& getExperienceCache() const
+  {
+    return experience_cache_;
+  }
+
+private:
+  ChompExperienceCachePtr experience_cache_;
 };
 }  // namespace chomp
@@ -36,7 +36,9 @@
 
 #include <chomp_motion_planner/chomp_cost.h>
 #include <chomp_motion_planner/chomp_utils.h>
-#include <eigen3/Eigen/LU>
+#include <algorithm>
+#include <cmath>
+#include <limits>
 
 using namespace Eigen;
 using namespace std;
@@ -47,58 +49,155 @@ ChompCost::ChompCost(const ChompTrajectory& trajectory, int /* joint_number */,
                      const std::vector<double>& derivative_costs, double ridge_factor)
 {
   int num_vars_all = trajectory.getNumPoints();
-  int num_vars_free = num_vars_all - 2 * (DIFF_RULE_LENGTH - 1);
-  MatrixXd diff_matrix = MatrixXd::Zero(num_vars_all, num_vars_all);
-  quad_cost_full_ = MatrixXd::Zero(num_vars_all, num_vars_all);
+  quad_cost_full_band_ = MatrixXd::Zero(DIFF_RULE_LENGTH, num_vars_all);
 
   // construct the quad cost for all variables, as a sum of squared differentiation matrices
   double multiplier = 1.0;
   for (unsigned int i = 0; i < derivative_costs.size(); i++)
   {
     multiplier *= trajectory.getDiscretization();
-    diff_matrix = getDiffMatrix(num_vars_all, &DIFF_RULES[i][0]);
-    quad_cost_full_ += (derivative_costs[i] * multiplier) * (diff_matrix.transpose() * diff_matrix);
+    addDiffMatrixProduct(&DIFF_RULES[i][0], derivative_costs[i] * multiplier);
   }
-  quad_cost_full_ += MatrixXd::Identity(num_vars_all, num_vars_all) * ridge_factor;
+  quad_cost_full_band_.row(0).array() += ridge_factor;
 
-  // extract the quad cost just for the free variables:
-  quad_cost_ = quad_cost_full_.block(DIFF_RULE_LENGTH - 1, DIFF_RULE_LENGTH - 1, num_vars_free, num_vars_free);
-
-  // invert the matrix:
-  quad_cost_inv_ = quad_cost_.inverse();
-
-  // cout << quad_cost_inv_ << endl;
+  // factorize the quad cost just for the free variables
+  factorizeQuadraticCost();
 }
 
-Eigen::MatrixXd ChompCost::getDiffMatrix(int size, const double* diff_rule) const
+void ChompCost::addDiffMatrixProduct(const double* diff_rule, double weight)
 {
-  MatrixXd matrix = MatrixXd::Zero(size, size);
+  // row i of the differentiation matrix applies the rule to the variables i - DIFF_RULE_LENGTH / 2 ...
+  // i + DIFF_RULE_LENGTH / 2, so its squared product only has entries within DIFF_RULE_LENGTH - 1 of the diagonal
+  const int size = quad_cost_full_band_.cols();
   for (int i = 0; i < size; i++)
   {
     for (int j = -DIFF_RULE_LENGTH / 2; j <= DIFF_RULE_LENGTH / 2; j++)
     {
       int index = i + j;
-      if (index < 0)
-        continue;
-      if (index >= size)
+      if (index < 0 || index >= size)
         continue;
-      matrix(i, index) = diff_rule[j + DIFF_RULE_LENGTH / 2];
+      for (int k = -DIFF_RULE_LENGTH / 2; k <= j; k++)
+      {
+        int other_index = i + k;
+        if (other_index < 0)
+          continue;
+        quad_cost_full_band_(index - other_index, other_index) +=
+            weight * diff_rule[j + DIFF_RULE_LENGTH / 2] * diff_rule[k + DIFF_RULE_LENGTH / 2];
+      }
     }
   }
-  return matrix;
 }
 
-double ChompCost::getMaxQuadCostInvValue() const
+void ChompCost::factorizeQuadraticCost()
+{
+  const int bandwidth = DIFF_RULE_LENGTH - 1;
+  const int num_vars_free = quad_cost_full_band_.cols() - 2 * bandwidth;
+
+  // banded Cholesky factorization quad_cost = L * L^T, L has the same bandwidth as quad_cost
+  MatrixXd& l = quad_cost_chol_band_;
+  l = quad_cost_full_band_.block(0, bandwidth, DIFF_RULE_LENGTH, num_vars_free);
+  for (int j = 0; j < num_vars_free; j++)
+  {
+    for (int k = std::max(0, j - bandwidth); k < j; k++)
+      l(0, j) -= l(j - k, k) * l(j - k, k);
+    l(0, j) = sqrt(l(0, j));
+    for (int i = j + 1; i <= std::min(j + bandwidth, num_vars_free - 1); i++)
+    {
+      for (int k = std::max(0, i - bandwidth); k < j; k++)
+        l(i - j, j) -= l(i - k, k) * l(j - k, k);
+      l(i - j, j) /= l(0, j);
+    }
+  }
+
+  // the inverse is positive definite, so its maximum value lies on the diagonal. The band of the inverse follows from
+  // the factor from the last column backwards (Takahashi recurrence), without computing the rest of it.
+  MatrixXd inv = MatrixXd::Zero(DIFF_RULE_LENGTH, num_vars_free);
+  auto inv_value = [&inv](int i, int j) { return i >= j ? inv(i - j, j) : inv(j - i, i); };
+  max_quad_cost_inv_value_ = -std::numeric_limits<double>::infinity();
+  for (int j = num_vars_free - 1; j >= 0; j--)
+  {
+    const int last = std::min(j + bandwidth, num_vars_free - 1);
+    for (int i = last; i > j; i--)
+    {
+      double sum = 0.0;
+      for (int k = j + 1; k <= last; k++)
+        sum += l(k - j, j) * inv_value(i, k);
+      inv(i - j, j) = -sum / l(0, j);
+    }
+    double sum = 0.0;
+    for (int k = j + 1; k <= last; k++)
+      sum += l(k - j, j) * inv(k - j, j);
+    inv(0, j) = (1.0 / l(0, j) - sum) / l(0, j);
+    max_quad_cost_inv_value_ = std::max(max_quad_cost_inv_value_, inv(0, j));
+  }
+}
+
+Eigen::VectorXd ChompCost::multiplyQuadraticCostFull(const Eigen::VectorXd& x) const
+{
+  const int size = quad_cost_full_band_.cols();
+  VectorXd result = quad_cost_full_band_.row(0).transpose().cwiseProduct(x);
+  for (int k = 1; k < DIFF_RULE_LENGTH; k++)
+    for (int j = 0; j + k < size; j++)
+    {
+      result(j + k) += quad_cost_full_band_(k, j) * x(j);
+      result(j) += quad_cost_full_band_(k, j) * x(j + k);
+    }
+  return result;
+}
+
+Eigen::VectorXd ChompCost::solveQuadraticCost(const Eigen::VectorXd& b) const
+{
+  const int bandwidth = DIFF_RULE_LENGTH - 1;
+  const MatrixXd& l = quad_cost_chol_band_;
+  const int size = l.cols();
+  VectorXd x = b;
+
+  // forward substitution with L, then backward substitution with L^T
+  for (int i = 0; i < size; i++)
+  {
+    for (int k = std::max(0, i - bandwidth); k < i; k++)
+      x(i) -= l(i - k, k) * x(k);
+    x(i) /= l(0, i);
+  }
+  for (int i = size - 1; i >= 0; i--)
+  {
+    for (int k = i + 1; k <= std::min(i + bandwidth, size - 1); k++)
+      x(i) -= l(k - i, i) * x(k);
+    x(i) /= l(0, i);
+  }
+  return x;
+}
+
+Eigen::VectorXd ChompCost::getQuadraticCostInverseColumn(int index) const
+{
+  return solveQuadraticCost(VectorXd::Unit(quad_cost_chol_band_.cols(), index));
+}
+
+Eigen::MatrixXd ChompCost::getQuadraticCostInverse() const
+{
+  const int size = quad_cost_chol_band_.cols();
+  MatrixXd quad_cost_inv(size, size);
+  for (int i = 0; i < size; i++)
+    quad_cost_inv.col(i) = getQuadraticCostInverseColumn(i);
+  return quad_cost_inv;
+}
+
+Eigen::MatrixXd ChompCost::getQuadraticCost() const
 {
-  return quad_cost_inv_.maxCoeff();
+  const int bandwidth = DIFF_RULE_LENGTH - 1;
+  const int size = quad_cost_chol_band_.cols();
+  MatrixXd quad_cost = MatrixXd::Zero(size, size);
+  for (int j = 0; j < size; j++)
+    for (int k = 0; k < DIFF_RULE_LENGTH && j + k < size; k++)
+      quad_cost(j + k, j) = quad_cost(j, j + k) = quad_cost_full_band_(k, j + bandwidth);
+  return quad_cost;
 }
 
 void ChompCost::scale(double scale)
 {
-  double inv_scale = 1.0 / scale;
-  quad_cost_inv_ *= inv_scale;
-  quad_cost_ *= scale;
-  quad_cost_full_ *= scale;
+  max_quad_cost_inv_value_ /= scale;
+  quad_cost_chol_band_ *= sqrt(scale);
+  quad_cost_full_band_ *= scale;
 }
 
 ChompCost::~ChompCost() = default;
@@ -0,0 +1,191 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, PickNik LLC
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik LLC nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include <chomp_motion_planner/chomp_experience_cache.h>
+#include <boost/functional/hash.hpp>
+#include <cmath>
+#include <iomanip>
+#include <limits>
+
+namespace chomp
+{
+namespace
+{
+// poses are hashed at this resolution, so numerically identical layouts map to the same hash
+const double POSE_HASH_RESOLUTION = 1e-3;
+
+void hashShapes(const std::vector<shapes::ShapeConstPtr>& shapes, const EigenSTL::vector_Isometry3d& poses,
+                std::size_t& seed)
+{
+  for (std::size_t i = 0; i < shapes.size(); ++i)
+  {
+    boost::hash_combine(seed, static_cast<int>(shapes[i]->type));
+    const Eigen::Quaterniond rotation(poses[i].linear());
+    for (double value : { poses[i].translation().x(), poses[i].translation().y(), poses[i].translation().z(),
+                          rotation.x(), rotation.y(), rotation.z(), rotation.w() })
+      boost::hash_combine(seed, std::lround(value / POSE_HASH_RESOLUTION));
+  }
+}
+}  // namespace
+
+ChompExperienceCache::ChompExperienceCache(std::size_t max_experiences) : max_experiences_(max_experiences)
+{
+}
+
+void ChompExperienceCache::addExperience(const std::string& group_name, std::size_t scene_hash,
+                                         const Eigen::MatrixXd& trajectory)
+{
+  std::lock_guard<std::mutex> _(lock_);
+  experiences_.push_front(Experience{ group_name, scene_hash, trajectory });
+  if (experiences_.size() > max_experiences_)
+    experiences_.pop_back();
+}
+
+bool ChompExperienceCache::fillInFromExperience(const std::string& group_name, std::size_t scene_hash,
+                                                double max_distance, Eigen::MatrixXd& trajectory) const
+{
+  const Eigen::Index last = trajectory.rows() - 1;
+  if (last < 1)
+    return false;
+
+  std::lock_guard<std::mutex> _(lock_);
+  auto best = experiences_.end();
+  double best_distance = max_distance;
+  for (auto it = experiences_.begin(); it != experiences_.end(); ++it)
+  {
+    if (it->scene_hash_ != scene_hash || it->group_name_ != group_name || it->trajectory_.rows() != trajectory.rows() ||
+        it->trajectory_.cols() != trajectory.cols())
+      continue;
+    const double distance = (it->trajectory_.row(0) - trajectory.row(0)).norm() +
+                            (it->trajectory_.row(last) - trajectory.row(last)).norm();
+    if (distance < best_distance)
+    {
+      best_distance = distance;
+      best = it;
+    }
+  }
+  if (best == experiences_.end())
+    return false;
+
+  // blend the offsets of the end points over the experience, so the start and goal are kept exactly
+  const Eigen::RowVectorXd start_offset = trajectory.row(0) - best->trajectory_.row(0);
+  const Eigen::RowVectorXd goal_offset = trajectory.row(last) - best->trajectory_.row(last);
+  for (Eigen::Index i = 0; i <= last; ++i)
+  {
+    const double fraction = static_cast<double>(i) / last;
+    trajectory.row(i) = best->trajectory_.row(i) + (1.0 - fraction) * start_offset + fraction * goal_offset;
+  }
+  experiences_.splice(experiences_.begin(), experiences_, best);
+  return true;
+}
+
+std::size_t ChompExperienceCache::getExperienceCount() const
+{
+  std::lock_guard<std::mutex> _(lock_);
+  return experiences_.size();
+}
+
+void ChompExperienceCache::clear()
+{
+  std::lock_guard<std::mutex> _(lock_);
+  experiences_.clear();
+}
+
+bool ChompExperienceCache::writeToStream(std::ostream& stream) const
+{
+  std::lock_guard<std::mutex> _(lock_);
+  stream << "experiences " << experiences_.size() << std::endl;
+  stream << std::setprecision(std::numeric_limits<double>::max_digits10);
+  for (const Experience& experience : experiences_)
+  {
+    stream << experience.group_name_ << " " << experience.scene_hash_ << " " << experience.trajectory_.rows() << " "
+           << experience.trajectory_.cols() << std::endl;
+    for (Eigen::Index i = 0; i < experience.trajectory_.rows(); ++i)
+    {
+      for (Eigen::Index j = 0; j < experience.trajectory_.cols(); ++j)
+        stream << (j == 0 ? "" : " ") << experience.trajectory_(i, j);
+      stream << std::endl;
+    }
+  }
+  return stream.good();
+}
+
+bool ChompExperienceCache::readFromStream(std::istream& stream)
+{
+  std::string header;
+  std::size_t count;
+  if (!(stream >> header >> count) || header != "experiences")
+    return false;
+
+  std::list<Experience> experiences;
+  for (std::size_t k = 0; k < count; ++k)
+  {
+    Experience experience;
+    Eigen::Index rows, cols;
+    if (!(stream >> experience.group_name_ >> experience.scene_hash_ >> rows >> cols) || rows < 0 || cols < 0)
+      return false;
+    experience.trajectory_.resize(rows, cols);
+    for (Eigen::Index i = 0; i < rows; ++i)
+      for (Eigen::Index j = 0; j < cols; ++j)
+        if (!(stream >> experience.trajectory_(i, j)))
+          return false;
+    if (experiences.size() < max_experiences_)
+      experiences.push_back(std::move(experience));
+  }
+
+  std::lock_guard<std::mutex> _(lock_);
+  experiences_.swap(experiences);
+  return true;
+}
+
+std::size_t ChompExperienceCache::computeSceneHash(const planning_scene::PlanningScene& planning_scene)
+{
+  std::size_t seed = 0;
+  for (const auto& object : *planning_scene.getWorld())
+  {
+    boost::hash_combine(seed, object.first);
+    hashShapes(object.second->shapes_, object.second->shape_poses_, seed);
+  }
+
+  std::vector<const moveit::core::AttachedBody*> attached_bodies;
+  planning_scene.getCurrentState().getAttachedBodies(attached_bodies);
+  for (const moveit::core::AttachedBody* attached_body : attached_bodies)
+  {
+    boost::hash_combine(seed, attached_body->getName());
+    boost::hash_combine(seed, attached_body->getAttachedLinkName());
+    hashShapes(attached_body->getShapes(), attached_body->getFixedTransforms(), seed);
+  }
+  return seed;
+}
+}  // namespace chomp
@@ -43,6 +43,7 @@
 #include <moveit/planning_scene/planning_scene.h>
 #include <eigen3/Eigen/LU>
 #include <eigen3/Eigen/Core>
+#include <omp.h>
 #include <random>
 
 namespace chomp
@@ -144,9 +145,6 @@ void ChompOptimizer::initialize()
   collision_increments_ = Eigen::MatrixXd::Zero(num_vars_free_, num_joints_);
   final_increments_ = Eigen::MatrixXd::Zero(num_vars_free_, num_joints_);
   smoothness_derivative_ = Eigen::VectorXd::Zero(num_vars_all_);
-  jacobian_ = Eigen::MatrixXd::Zero(3, num_joints_);
-  jacobian_pseudo_inverse_ = Eigen::MatrixXd::Zero(num_joints_, 3);
-  jacobian_jacobian_tranpose_ = Eigen::MatrixXd::Zero(3, 3);
   random_state_ = Eigen::VectorXd::Zero(num_joints_);
   joint_state_velocities_ = Eigen::VectorXd::Zero(num_joints_);
 
@@ -178,13 +176,14 @@ void ChompOptimizer::initialize()
   // momentum_ = Eigen::MatrixXd::Zero(num_vars_free_, num_joints_);
   // random_momentum_ = Eigen::MatrixXd::Zero(num_vars_free_, num_joints_);
   // random_joint_momentum_ = Eigen::VectorXd::Zero(num_vars_free_);
+  // the samplers need the dense inverse of the quad cost, which is quadratic in the number of points
+  // for (int i = 0; i < num_joints_; i++)
+  // {
+  //   multivariate_gaussian_.push_back(
+  //       MultivariateGaussian(Eigen::VectorXd::Zero(num_vars_free_), joint_costs_[i].getQuadraticCostInverse()));
+  // }
   multivariate_gaussian_.clear();
   stochasticity_factor_ = 1.0;
-  for (int i = 0; i < num_joints_; i++)
-  {
-    multivariate_gaussian_.push_back(
-        MultivariateGaussian(Eigen::VectorXd::Zero(num_vars_free_), joint_costs_[i].getQuadraticCostInverse()));
-  }
 
   std::map<std::string, std::string> fixed_link_resolution_map;
   for (int i = 0; i < num_joints_; i++)
@@ -592,15 +591,6 @@ void ChompOptimizer::calculateSmoothnessIncrements()
 
 void ChompOptimizer::calculateCollisionIncrements()
 {
-  double potential;
-  double vel_mag_sq;
-  double vel_mag;
-  Eigen::Vector3d potential_gradient;
-  Eigen::Vector3d normalized_velocity;
-  Eigen::Matrix3d orthogonal_projector;
-  Eigen::Vector3d curvature_vector;
-  Eigen::Vector3d cartesian_gradient;
-
   collision_increments_.setZero(num_vars_free_, num_joints_);
 
   int start_point = 0;
@@ -622,8 +612,22 @@ void ChompOptimizer::calculateCollisionIncrements()
     start_point = free_vars_start_;
   }
 
+  // each trajectory point only updates its own row of the increments
+  const int num_threads = std::max(parameters_->max_threads_, 1);
+#pragma omp parallel for schedule(dynamic) num_threads(num_threads) if (num_threads > 1 && end_point > start_point)
   for (int i = start_point; i <= end_point; i++)
   {
+    double potential;
+    double vel_mag_sq;
+    double vel_mag;
+    Eigen::Vector3d potential_gradient;
+    Eigen::Vector3d normalized_velocity;
+    Eigen::Matrix3d orthogonal_projector;
+    Eigen::Vector3d curvature_vector;
+    Eigen::Vector3d cartesian_gradient;
+    Eigen::MatrixXd jacobian = Eigen::MatrixXd::Zero(3, num_joints_);
+    Eigen::MatrixXd jacobian_pseudo_inverse;
+
     for (int j = 0; j < num_collision_points_; j++)
     {
       potential = collision_point_potential_[i][j];
@@ -644,16 +648,16 @@ void ChompOptimizer::calculateCollisionIncrements()
       cartesian_gradient = vel_mag * (orthogonal_projector * potential_gradient - potential * curvature_vector);
 
       // pass it through the jacobian transpose to get the increments
-      getJacobian(i, collision_point_pos_eigen_[i][j], collision_point_joint_names_[i][j], jacobian_);
+      getJacobian(i, collision_point_pos_eigen_[i][j], collision_point_joint_names_[i][j], jacobian);
 
       if (parameters_->use_pseudo_inverse_)
       {
-        calculatePseudoInverse();
-        collision_increments_.row(i - free_vars_start_).transpose() -= jacobian_pseudo_inverse_ * cartesian_gradient;
+        calculatePseudoInverse(jacobian, jacobian_pseudo_inverse);
+        collision_increments_.row(i - free_vars_start_).transpose() -= jacobian_pseudo_inverse * cartesian_gradient;
       }
       else
       {
-        collision_increments_.row(i - free_vars_start_).transpose() -= jacobian_.transpose() * cartesian_gradient;
+        collision_increments_.row(i - free_vars_start_).transpose() -= jacobian.transpose() * cartesian_gradient;
       }
 
       /*
@@ -667,21 +671,21 @@ void ChompOptimizer::calculateCollisionIncrements()
   // cout << collision_increments_ << endl;
 }
 
-void ChompOptimizer::calculatePseudoInverse()
+void ChompOptimizer::calculatePseudoInverse(const Eigen::MatrixXd& jacobian,
+                                            Eigen::MatrixXd& jacobian_pseudo_inverse) const
 {
-  jacobian_jacobian_tranpose_ =
-      jacobian_ * jacobian_.transpose() + Eigen::MatrixXd::Identity(3, 3) * parameters_->pseudo_inverse_ridge_factor_;
-  jacobian_pseudo_inverse_ = jacobian_.transpose() * jacobian_jacobian_tranpose_.inverse();
+  const Eigen::MatrixXd jacobian_jacobian_tranpose =
+      jacobian * jacobian.transpose() + Eigen::MatrixXd::Identity(3, 3) * parameters_->pseudo_inverse_ridge_factor_;
+  jacobian_pseudo_inverse = jacobian.transpose() * jacobian_jacobian_tranpose.inverse();
 }
 
 void ChompOptimizer::calculateTotalIncrements()
 {
   for (int i = 0; i < num_joints_; i++)
   {
-    final_increments_.col(i) =
-        parameters_->learning_rate_ * (joint_costs_[i].getQuadraticCostInverse() *
-                                       (parameters_->smoothness_cost_weight_ * smoothness_increments_.col(i) +
-                                        parameters_->obstacle_cost_weight_ * collision_increments_.col(i)));
+    const Eigen::VectorXd increments = parameters_->smoothness_cost_weight_ * smoothness_increments_.col(i) +
+                                       parameters_->obstacle_cost_weight_ * collision_increments_.col(i);
+    final_increments_.col(i) = parameters_->learning_rate_ * joint_costs_[i].solveQuadraticCost(increments);
   }
 }
 
@@ -759,11 +763,11 @@ double ChompOptimizer::getCollisionCost()
   return parameters_->obstacle_cost_weight_ * collision_cost;
 }
 
-void ChompOptimizer::computeJointProperties(int trajectory_point)
+void ChompOptimizer::computeJointProperties(int trajectory_point, const moveit::core::RobotState& state)
 {
   for (int j = 0; j < num_joints_; j++)
   {
-    const moveit::core::JointModel* joint_model = state_.getJointModel(joint_names_[j]);
+    const moveit::core::JointModel* joint_model = state.getJointModel(joint_names_[j]);
     const moveit::core::RevoluteJointModel* revolute_joint =
         dynamic_cast<const moveit::core::RevoluteJointModel*>(joint_model);
     const moveit::core::PrismaticJointModel* prismatic_joint =
@@ -771,9 +775,9 @@ void ChompOptimizer::computeJointProperties(int trajectory_point)
 
     std::string parent_link_name = joint_model->getParentLinkModel()->getName();
     std::string child_link_name = joint_model->getChildLinkModel()->getName();
-    Eigen::Isometry3d joint_transform = state_.getGlobalLinkTransform(parent_link_name) *
+    Eigen::Isometry3d joint_transform = state.getGlobalLinkTransform(parent_link_name) *
                                         (robot_model_->getLinkModel(child_link_name)->getJointOriginTransform() *
-                                         (state_.getJointTransform(joint_model)));
+                                         (state.getJointTransform(joint_model)));
 
     // joint_transform = inverseWorldTransform * jointTransform;
     Eigen::Vector3d axis;
@@ -893,10 +897,9 @@ void ChompOptimizer::handleJointLimits()
       if (violation)
       {
         int free_var_index = max_violation_index - free_vars_start_;
-        double multiplier =
-            max_violation / joint_costs_[joint_i].getQuadraticCostInverse()(free_var_index, free_var_index);
-        group_trajectory_.getFreeJointTrajectoryBlock(joint_i) +=
-            multiplier * joint_costs_[joint_i].getQuadraticCostInverse().col(free_var_index);
+        const Eigen::VectorXd cost_inv_column = joint_costs_[joint_i].getQuadraticCostInverseColumn(free_var_index);
+        double multiplier = max_violation / cost_inv_column(free_var_index);
+        group_trajectory_.getFreeJointTrajectoryBlock(joint_i) += multiplier * cost_inv_column;
       }
       if (++count > 10)
         break;
@@ -918,29 +921,32 @@ void ChompOptimizer::performForwardKinematics()
     end = num_vars_all_ - 1;
   }
 
-  is_collision_free_ = true;
+  const int num_threads = std::max(parameters_->max_threads_, 1);
+  if (thread_states_.size() != static_cast<std::size_t>(num_threads))
+    createThreadCopies(num_threads);
 
-  ros::WallDuration total_dur(0.0);
-
-  // for each point in the trajectory
+  // the points are independent, each thread uses its own state and group state representation
+  bool is_collision_free = true;
+#pragma omp parallel for num_threads(num_threads) if (num_threads > 1) reduction(&& : is_collision_free)
   for (int i = start; i <= end; ++i)
   {
+    moveit::core::RobotState& state = *thread_states_[omp_get_thread_num()];
+    collision_detection::GroupStateRepresentationPtr& gsr = thread_gsrs_[omp_get_thread_num()];
+
     // Set Robot state from trajectory point...
     collision_detection::CollisionRequest req;
     collision_detection::CollisionResult res;
     req.group_name = planning_group_;
-    setRobotStateFromPoint(group_trajectory_, i);
-    ros::WallTime grad = ros::WallTime::now();
+    setRobotStateFromPoint(group_trajectory_, i, state);
 
-    hy_env_->getCollisionGradients(req, res, state_, nullptr, gsr_);
-    total_dur += (ros::WallTime::now() - grad);
-    computeJointProperties(i);
+    hy_env_->getCollisionGradients(req, res, state, nullptr, gsr);
+    computeJointProperties(i, state);
     state_is_in_collision_[i] = false;
 
     // Keep vars in scope
     {
       size_t j = 0;
-      for (const collision_detection::GradientInfo& info : gsr_->gradients_)
+      for (const collision_detection::GradientInfo& info : gsr->gradients_)
       {
         for (size_t k = 0; k < info.sphere_locations.size(); k++)
         {
@@ -969,15 +975,14 @@ void ChompOptimizer::performForwardKinematics()
             //   collision_point_potential_[i][j]);
             // }
 
-            is_collision_free_ = false;
+            is_collision_free = false;
           }
           j++;
         }
       }
     }
   }
-
-  // ROS_INFO_STREAM("Total dur " << total_dur << " total checks " << end-start+1);
+  is_collision_free_ = is_collision_free;
 
   // now, get the vel and acc for each collision point (using finite differencing)
   for (int i = free_vars_start_; i <= free_vars_end_; i++)
@@ -1000,7 +1005,33 @@ void ChompOptimizer::performForwardKinematics()
   }
 }
 
-void ChompOptimizer::setRobotStateFromPoint(ChompTrajectory& group_trajectory, int i)
+void ChompOptimizer::createThreadCopies(int num_threads)
+{
+  thread_states_.clear();
+  thread_gsrs_.clear();
+  for (int i = 0; i < num_threads; ++i)
+  {
+    thread_states_.push_back(std::make_shared<moveit::core::RobotState>(state_));
+    if (i == 0)
+    {
+      thread_gsrs_.push_back(gsr_);
+      continue;
+    }
+
+    // a copy shares the distance field of each link, which stores the pose of the link, with gsr_
+    collision_detection::GroupStateRepresentationPtr gsr(new collision_detection::GroupStateRepresentation(*gsr_));
+    for (collision_detection::PosedDistanceFieldPtr& link_distance_field : gsr->link_distance_fields_)
+    {
+      // the copy still shares the voxels, which are not modified
+      if (link_distance_field)
+        link_distance_field.reset(new collision_detection::PosedDistanceField(*link_distance_field));
+    }
+    thread_gsrs_.push_back(gsr);
+  }
+}
+
+void ChompOptimizer::setRobotStateFromPoint(ChompTrajectory& group_trajectory, int i,
+                                            moveit::core::RobotState& state) const
 {
   const Eigen::MatrixXd::RowXpr& point = group_trajectory.getTrajectoryPoint(i);
 
@@ -1009,8 +1040,8 @@ void ChompOptimizer::setRobotStateFromPoint(ChompTrajectory& group_trajectory, i
   for (size_t j = 0; j < group_trajectory.getNumJoints(); j++)
     joint_states.emplace_back(point(0, j));
 
-  state_.setJointGroupPositions(planning_group_, joint_states);
-  state_.update();
+  state.setJointGroupPositions(planning_group_, joint_states);
+  state.update();
 }
 
 void ChompOptimizer::perturbTrajectory()
@@ -1042,7 +1073,7 @@ void ChompOptimizer::perturbTrajectory()
   for (int i = 0; i < num_joints_; i++)
   {
     group_trajectory_.getFreeJointTrajectoryBlock(i) +=
-        joint_costs_[i].getQuadraticCostInverse().col(mp_free_vars_index) * random_state_(i);
+        joint_costs_[i].getQuadraticCostInverseColumn(mp_free_vars_index) * random_state_(i);
   }
 }
 
@@ -68,6 +68,8 @@ ChompParameters::ChompParameters()
   trajectory_initialization_method_ = std::string("quintic-spline");
   enable_failure_recovery_ = false;
   max_recovery_attempts_ = 5;
+  max_threads_ = 1;
+  experience_max_distance_ = 0.5;
 }
 
 ChompParameters::~ChompParameters() = default;
@@ -116,8 +116,16 @@ bool ChompPlanner::solve(const planning_scene::PlanningSceneConstPtr& planning_s
     }
   }
 
+  // warm-start from the closest previous solution, unless an input trajectory is given explicitly
+  const std::size_t scene_hash = experience_cache_ ? ChompExperienceCache::computeSceneHash(*planning_scene) : 0;
+  const bool from_experience =
+      experience_cache_ && params.trajectory_initialization_method_.compare("fillTrajectory") != 0 &&
+      experience_cache_->fillInFromExperience(req.group_name, scene_hash, params.experience_max_distance_,
+                                              trajectory.getTrajectory());
+  if (from_experience)
+    ROS_INFO_NAMED("chomp_planner", "CHOMP trajectory initialized from a previous experience");
   // fill in an initial trajectory based on user choice from the chomp_config.yaml file
-  if (params.trajectory_initialization_method_.compare("quintic-spline") == 0)
+  else if (params.trajectory_initialization_method_.compare("quintic-spline") == 0)
     trajectory.fillInMinJerk();
   else if (params.trajectory_initialization_method_.compare("linear") == 0)
     trajectory.fillInLinearInterpolation();
@@ -135,8 +143,9 @@ bool ChompPlanner::solve(const planning_scene::PlanningSceneConstPtr& planning_s
   else
     ROS_ERROR_STREAM_NAMED("chomp_planner", "invalid interpolation method specified in the chomp_planner file");
 
-  ROS_INFO_NAMED("chomp_planner", "CHOMP trajectory initialized using method: %s ",
-                 (params.trajectory_initialization_method_).c_str());
+  if (!from_experience)
+    ROS_INFO_NAMED("chomp_planner", "CHOMP trajectory initialized using method: %s ",
+                   (params.trajectory_initialization_method_).c_str());
 
   // optimize!
   ros::WallTime create_time = ros::WallTime::now();
@@ -264,6 +273,9 @@ bool ChompPlanner::solve(const planning_scene::PlanningSceneConstPtr& planning_s
     }
   }
 
+  if (experience_cache_)
+    experience_cache_->addExperience(req.group_name, scene_hash, trajectory.getTrajectory());
+
   return true;
 }
 }  // namespace chomp
@@ -156,6 +156,11 @@ public:
       ROS_INFO_STREAM("Param trajectory_initialization_method was not set. Using New value as: "
                       << params_.trajectory_initialization_method_);
     }
+    if (!nh.getParam("max_threads", params_.max_threads_))
+    {
+      params_.max_threads_ = 1;
+      ROS_INFO_STREAM("Param max_threads was not set. Using default value: " << params_.max_threads_);
+    }
   }
 
   std::string getDescription() const override
@@ -0,0 +1,96 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, PickNik LLC
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik LLC nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#pragma once
+
+#include <moveit/ompl_interface/detail/threadsafe_state_storage.h>
+#include <moveit/collision_detection/collision_common.h>
+#include <ompl/base/DiscreteMotionValidator.h>
+#include <ompl/base/MotionValidator.h>
+#include <utility>
+#include <vector>
+
+namespace ompl_interface
+{
+class ModelBasedPlanningContext;
+
+/** @class ClearanceMotionValidator
+    @brief A motion validator that skips the parts of a motion that the distance of the robot to collision shows
+    to be collision free, instead of checking states at the resolution of the state space everywhere
+
+    Moving a fraction dt along a motion moves no point of the robot geometry further than dt * M, where M is the
+    sum of the joint displacements of the motion weighted by how far each joint can be from the geometry below it.
+    A state at distance d from the world and d_self from self-collision therefore shows the next
+    min(d, d_self / 2) / M of the motion to be collision free, which is skipped. Where this is less than the
+    resolution of the state space, the next state is taken at the resolution, so motions near obstacles are checked
+    at least as densely as by the DiscreteMotionValidator, and all visited states are checked by the state validity
+    checker. The skipped states are not checked for path constraints or feasibility; when there are some, or the
+    geometry cannot be bounded because of planar or floating joints or scaled links, all motions are checked by a
+    DiscreteMotionValidator. */
+class ClearanceMotionValidator : public ompl::base::MotionValidator
+{
+public:
+  ClearanceMotionValidator(const ModelBasedPlanningContext* planning_context);
+
+  bool checkMotion(const ompl::base::State* s1, const ompl::base::State* s2) const override;
+  bool checkMotion(const ompl::base::State* s1, const ompl::base::State* s2,
+                   std::pair<ompl::base::State*, double>& last_valid) const override;
+
+private:
+  /** \brief Check the states of the motion from s1 to s2 in order, s1 is assumed valid; the fraction of the last
+      valid visited state is returned in \e last_valid_fraction */
+  bool checkMotionFrom(const ompl::base::State* s1, const ompl::base::State* s2, double& last_valid_fraction) const;
+
+  /** \brief Bound the distance any point of the robot geometry moves along the motion from s1 to s2 */
+  double computeMotionBound(const ompl::base::State* s1, const ompl::base::State* s2) const;
+
+  /** \brief Bound the distance of the geometry of a link, its attached bodies and all links below it from the
+      origin of the link; return false if it cannot be bounded */
+  bool computeSubtreeRadius(const moveit::core::LinkModel* link, double& radius) const;
+
+  /** \brief The distance a joint moves its child link geometry per unit of joint distance */
+  bool computeJointWeight(const moveit::core::JointModel* joint, double& weight) const;
+
+  const ModelBasedPlanningContext* planning_context_;
+  TSStateStorage tss_;
+  ompl::base::DiscreteMotionValidator discrete_validator_;
+  collision_detection::DistanceRequest distance_request_;
+
+  std::vector<const moveit::core::JointModel*> joints_;  // the active joints of the group
+  std::vector<int> joint_value_indices_;                 // the index of the first value of the joints in the states
+  std::vector<double> joint_weights_;                    // including the joints that mimic them
+
+  bool always_discrete_;  // the skipped states cannot be shown to be valid
+};
+}  // namespace ompl_interface
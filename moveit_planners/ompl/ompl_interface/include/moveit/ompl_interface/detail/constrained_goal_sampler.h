@@ -43,20 +43,53 @@
 #include <moveit/robot_state/robot_state.h>
 #include <moveit/robot_model/joint_model_group.h>
 
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
 namespace ompl_interface
 {
 class ModelBasedPlanningContext;
 
 /** @class ConstrainedGoalSampler
- *  An interface to the OMPL goal lazy sampler*/
+ *  An interface to the OMPL goal lazy sampler. If the planning context asks for more than one goal sampling thread,
+ *  the sampling thread of OMPL starts additional threads, each with its own constraint sampler, that add the goal
+ *  states they find to the same set. */
 class ConstrainedGoalSampler : public ompl::base::GoalLazySamples
 {
 public:
   ConstrainedGoalSampler(const ModelBasedPlanningContext* pc, kinematic_constraints::KinematicConstraintSetPtr ks,
                          constraint_samplers::ConstraintSamplerPtr cs = constraint_samplers::ConstraintSamplerPtr());
 
+  ~ConstrainedGoalSampler() override;
+
+  /** @brief The time the sampling thread of OMPL spent sampling goal states so far, in seconds */
+  double getSamplingTime() const
+  {
+    return sampling_time_ * 1e-9;
+  }
+
 private:
+  /** @brief Sample a goal state and add the time it took to the sampling time */
+  bool sampleAndMeasureTime(const ompl::base::GoalLazySamples* gls, ompl::base::State* new_goal);
   bool sampleUsingConstraintSampler(const ompl::base::GoalLazySamples* gls, ompl::base::State* new_goal);
+
+  /** @brief Make one attempt at sampling a valid goal state with \e sampler, using \e work_state as seed */
+  bool sampleGoal(constraint_samplers::ConstraintSampler& sampler, moveit::core::RobotState& work_state,
+                  ompl::base::State* new_goal, bool verbose);
+
+  /** @brief Whether the attempts, the goal samples or a solution do not yet end the sampling */
+  bool canContinueSampling() const;
+
+  /** @brief Start the additional sampling threads, unless they are still running */
+  void startHelperThreads();
+
+  /** @brief Stop and join the additional sampling threads */
+  void stopHelperThreads();
+
+  /** @brief Loop of an additional sampling thread, which adds the goal states it finds to the set of this goal */
+  void sampleInHelperThread(const constraint_samplers::ConstraintSamplerPtr& sampler);
   bool stateValidityCallback(ompl::base::State* new_goal, moveit::core::RobotState const* state,
                              const moveit::core::JointModelGroup* /*jmg*/, const double* /*jpos*/,
                              bool verbose = false) const;
@@ -68,8 +101,14 @@ private:
   constraint_samplers::ConstraintSamplerPtr constraint_sampler_;
   ompl::base::StateSamplerPtr default_sampler_;
   moveit::core::RobotState work_state_;
-  unsigned int invalid_sampled_constraints_;
-  bool warned_invalid_samples_;
+  std::atomic<unsigned int> invalid_sampled_constraints_;
+  std::atomic<bool> warned_invalid_samples_;
   unsigned int verbose_display_;
+  std::atomic<std::int64_t> sampling_time_;  // nanoseconds
+
+  std::vector<std::thread> helper_threads_;
+  std::atomic<unsigned int> active_helper_threads_;
+  std::atomic<unsigned int> helper_attempts_;  // sampling attempts of the additional threads
+  std::atomic<bool> stop_helper_threads_;
 };
 }  // namespace ompl_interface
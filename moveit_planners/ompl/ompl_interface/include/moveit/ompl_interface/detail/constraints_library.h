@@ -41,6 +41,7 @@
 #include <moveit/kinematic_constraints/kinematic_constraint.h>
 #include <ompl/base/StateStorage.h>
 #include <boost/serialization/map.hpp>
+#include <mutex>
 
 namespace ompl_interface
 {
@@ -57,6 +58,11 @@ public:
                           moveit_msgs::msg::Constraints msg, std::string filename, ompl::base::StateStoragePtr storage,
                           std::size_t milestones = 0);
 
+  /** \brief Construct an approximation whose states are read from the file \e path when they are first needed */
+  ConstraintApproximation(std::string group, std::string state_space_parameterization, bool explicit_motions,
+                          moveit_msgs::msg::Constraints msg, std::string filename,
+                          const ompl::base::StateSpacePtr& space, std::string path, std::size_t milestones);
+
   virtual ~ConstraintApproximation()
   {
   }
@@ -100,10 +106,8 @@ public:
     return constraint_msg_;
   }
 
-  const ompl::base::StateStoragePtr& getStateStorage() const
-  {
-    return state_storage_ptr_;
-  }
+  /** \brief Get the stored states, reading them from disk if they were not loaded yet (nullptr if that fails) */
+  const ompl::base::StateStoragePtr& getStateStorage() const;
 
   const std::string& getFilename() const
   {
@@ -111,6 +115,9 @@ public:
   }
 
 protected:
+  /** \brief Read the states from load_path_ unless this was done already. Returns nullptr if there are no states */
+  ConstraintApproximationStateStorage* loadStateStorage() const;
+
   std::string group_;
   std::string state_space_parameterization_;
   bool explicit_motions_;
@@ -120,9 +127,13 @@ protected:
   std::vector<int> space_signature_;
 
   std::string ompldb_filename_;
-  ompl::base::StateStoragePtr state_storage_ptr_;
-  ConstraintApproximationStateStorage* state_storage_;
-  std::size_t milestones_;
+  mutable ompl::base::StateStoragePtr state_storage_ptr_;
+  mutable ConstraintApproximationStateStorage* state_storage_;
+  mutable std::size_t milestones_;
+
+  // file the states are loaded from on first use; empty if they are in memory already
+  mutable std::string load_path_;
+  mutable std::mutex load_lock_;
 };
 
 struct ConstraintApproximationConstructionOptions
@@ -134,6 +145,7 @@ struct ConstraintApproximationConstructionOptions
     , explicit_motions(false)
     , explicit_points_resolution(0.0)
     , max_explicit_points(0)
+    , threads(0)
   {
   }
 
@@ -144,6 +156,8 @@ struct ConstraintApproximationConstructionOptions
   bool explicit_motions;
   double explicit_points_resolution;
   unsigned int max_explicit_points;
+  // number of threads sampling and connecting states; 0 selects the number of hardware threads
+  unsigned int threads;
 };
 
 struct ConstraintApproximationConstructionResults
@@ -0,0 +1,72 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, PickNik LLC
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik LLC nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#pragma once
+
+#include <moveit/ompl_interface/detail/threadsafe_state_storage.h>
+#include <ompl/base/MotionValidator.h>
+#include <utility>
+
+namespace ompl_interface
+{
+class ModelBasedPlanningContext;
+
+/** @class ContinuousMotionValidator
+    @brief A motion validator that also checks the robot for collisions with the world between the states it visits
+
+    Like the DiscreteMotionValidator, the states of a motion are checked at the resolution of the state space. In
+    addition, the motion between two consecutive states is checked with PlanningScene::isMotionColliding(), which
+    sweeps each link linearly between its two poses. Thin obstacles between two checked states are found this way.
+    This needs a collision detector with continuous collision checking; self collisions are still checked at the
+    visited states only. */
+class ContinuousMotionValidator : public ompl::base::MotionValidator
+{
+public:
+  ContinuousMotionValidator(const ModelBasedPlanningContext* planning_context);
+
+  bool checkMotion(const ompl::base::State* s1, const ompl::base::State* s2) const override;
+  bool checkMotion(const ompl::base::State* s1, const ompl::base::State* s2,
+                   std::pair<ompl::base::State*, double>& last_valid) const override;
+
+private:
+  /** \brief Check the motion from s1 to s2 in order, s1 is assumed valid and s2 is only checked if \e check_end is set;
+      the fraction of the last valid visited state is returned in \e last_valid_fraction */
+  bool checkMotionFrom(const ompl::base::State* s1, const ompl::base::State* s2, bool check_end,
+                       double& last_valid_fraction) const;
+
+  const ModelBasedPlanningContext* planning_context_;
+  TSStateStorage tss_from_;
+  TSStateStorage tss_to_;
+};
+}  // namespace ompl_interface
@@ -0,0 +1,93 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, PickNik LLC
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik LLC nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#pragma once
+
+#include <moveit/macros/class_forward.h>
+#include <moveit/planning_scene/planning_scene.h>
+#include <list>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace ompl_interface
+{
+MOVEIT_CLASS_FORWARD(ExperienceDatabase)  // Defines ExperienceDatabasePtr, ConstPtr, WeakPtr... etc
+
+/** \brief Stores solved paths, so similar queries can be answered by retrieving and repairing a previous path
+ *
+ * Paths are stored as the real values of their states, keyed by planning group and a hash of the planning scene.
+ * The database holds at most a fixed number of paths and drops the least recently used ones first. */
+class ExperienceDatabase
+{
+public:
+  using Waypoints = std::vector<std::vector<double> >;
+
+  struct Experience
+  {
+    std::string group_name_;
+    std::size_t scene_hash_;
+    Waypoints waypoints_;
+  };
+
+  ExperienceDatabase(std::size_t max_experiences = 1000);
+
+  /** \brief Store a path with at least two waypoints. A stored path of the same group and scene with (almost) the
+   * same start and end is replaced. */
+  void addPath(const std::string& group_name, std::size_t scene_hash, const Waypoints& waypoints);
+
+  /** \brief Get copies of the paths stored for a group and scene, most recently used first */
+  std::vector<Experience> getExperiences(const std::string& group_name, std::size_t scene_hash) const;
+
+  std::size_t getExperienceCount() const;
+
+  void clear();
+
+  /** \brief Save the paths in a plain text format. Return false if the file could not be written */
+  bool save(const std::string& filename) const;
+
+  /** \brief Replace the paths with those saved by save(). Return false if the file could not be read */
+  bool load(const std::string& filename);
+
+  /** \brief Compute a hash of the layout of the world and of the attached bodies of a planning scene.
+   * Only the object ids, shape types and poses contribute; the content of octomaps and meshes does not. */
+  static std::size_t computeSceneHash(const planning_scene::PlanningScene& planning_scene);
+
+private:
+  std::size_t max_experiences_;
+  // most recently used experience first
+  std::list<Experience> experiences_;
+  mutable std::mutex lock_;
+};
+}  // namespace ompl_interface
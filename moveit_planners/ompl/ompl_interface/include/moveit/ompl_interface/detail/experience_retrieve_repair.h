@@ -0,0 +1,89 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, PickNik LLC
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik LLC nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#pragma once
+
+#include <moveit/ompl_interface/detail/experience_database.h>
+#include <ompl/base/Planner.h>
+#include <ompl/geometric/PathGeometric.h>
+#include <functional>
+
+namespace ompl_interface
+{
+namespace ob = ompl::base;
+namespace og = ompl::geometric;
+
+/** \brief A planner that looks up stored paths instead of planning from scratch
+ *
+ * The paths of the database are tried in the order of the distance of their first state to the start state; only
+ * paths whose last state satisfies the goal check are considered. A path is prefixed with the start state and
+ * repaired by planning around the segments that became invalid, using a bidirectional RRT. It is meant to run in
+ * parallel with planners that solve the problem from scratch. */
+class ExperienceRetrieveRepair : public ob::Planner
+{
+public:
+  using GoalCheckFn = std::function<bool(const ob::State*)>;
+
+  ExperienceRetrieveRepair(const ob::SpaceInformationPtr& si, ExperienceDatabaseConstPtr experience_database,
+                           std::string group_name, std::size_t scene_hash, GoalCheckFn goal_check);
+
+  ob::PlannerStatus solve(const ob::PlannerTerminationCondition& ptc) override;
+
+  /** \brief Get the number of paths that are tried before giving up */
+  unsigned int getMaximumCandidates() const
+  {
+    return max_candidates_;
+  }
+
+  void setMaximumCandidates(unsigned int max_candidates)
+  {
+    max_candidates_ = max_candidates;
+  }
+
+private:
+  /** \brief Plan from the last state of path to state and append the resulting states to path */
+  bool repairSegment(const ob::State* state, og::PathGeometric& path, const ob::PlannerTerminationCondition& ptc);
+
+  /** \brief Append the states of a stored path to path, planning around invalid segments.
+   * Return false if the path could not be repaired. */
+  bool repairPath(const ExperienceDatabase::Waypoints& waypoints, og::PathGeometric& path,
+                  const ob::PlannerTerminationCondition& ptc);
+
+  ExperienceDatabaseConstPtr experience_database_;
+  std::string group_name_;
+  std::size_t scene_hash_;
+  GoalCheckFn goal_check_;
+  unsigned int max_candidates_;
+};
+}  // namespace ompl_interface
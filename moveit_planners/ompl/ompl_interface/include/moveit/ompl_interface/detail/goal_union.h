@@ -74,6 +74,12 @@ public:
   /** @brief If there are any member lazy samplers, stop them */
   void stopSampling();
 
+  /** @brief Get the input set of goals */
+  const std::vector<ompl::base::GoalPtr>& getGoals() const
+  {
+    return goals_;
+  }
+
   /** @brief Pretty print goal information*/
   void print(std::ostream& out = std::cout) const override;
 
@@ -0,0 +1,94 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, PickNik LLC
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik LLC nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#pragma once
+
+#include <moveit/kinematic_constraints/kinematic_constraint.h>
+#include <moveit/macros/class_forward.h>
+#include <moveit/ompl_interface/detail/threadsafe_state_storage.h>
+#include <moveit_msgs/msg/constraints.hpp>
+#include <ompl/base/Constraint.h>
+#include <memory>
+#include <vector>
+
+namespace ompl_interface
+{
+MOVEIT_CLASS_FORWARD(KinematicConstraintManifold);  // Defines KinematicConstraintManifoldPtr, ConstPtr, WeakPtr... etc
+
+/** @class KinematicConstraintManifold
+    @brief The path constraints of a request as the implicit function of an OMPL constrained state space
+
+    The function maps the positions of the group variables to how far the path constraints are violated, and is zero
+    wherever they are satisfied. Each position constraint contributes three rows, for the offset of its point from its
+    box, sphere or cylinder region in the frame of the region. Each orientation constraint contributes three rows, for
+    the rotation vector from the desired orientation beyond the axis tolerances. Each joint constraint contributes one
+    row, for the distance to its bounds. The regions and tolerances are shrunk by twice the projection tolerance, so
+    that projected states satisfy the constraints. The jacobian is computed from the jacobian of the group, ignoring
+    the motion of mobile reference frames. */
+class KinematicConstraintManifold : public ompl::base::Constraint
+{
+public:
+  /** \brief Construct the function for path constraints like \e constraints, which must be representable */
+  KinematicConstraintManifold(const moveit::core::JointModelGroup* jmg,
+                              const moveit_msgs::msg::Constraints& constraints);
+
+  /** \brief Return the number of rows of the function for \e constraints, or 0 if the group or the constraints are not
+      supported: the group must be a chain of bounded single variable joints, the position constraints must have a
+      single box, sphere or cylinder region, there must be no visibility constraints, and there must be fewer rows than
+      group variables */
+  static unsigned int getRowCount(const moveit::core::JointModelGroup* jmg,
+                                  const moveit_msgs::msg::Constraints& constraints);
+
+  /** \brief Use the configured path constraints \e constraints, which correspond to the message passed to the
+      constructor. The variables that are not in the group are taken from \e state */
+  void setConstraints(const kinematic_constraints::KinematicConstraintSetPtr& constraints,
+                      const moveit::core::RobotState& state);
+
+  void function(const Eigen::Ref<const Eigen::VectorXd>& x, Eigen::Ref<Eigen::VectorXd> out) const override;
+  void jacobian(const Eigen::Ref<const Eigen::VectorXd>& x, Eigen::Ref<Eigen::MatrixXd> out) const override;
+
+private:
+  /** \brief Compute the function and, if \e jacobian is not null, its jacobian */
+  void evaluate(const Eigen::Ref<const Eigen::VectorXd>& x, Eigen::Ref<Eigen::VectorXd> out,
+                Eigen::Ref<Eigen::MatrixXd>* jacobian) const;
+
+  const moveit::core::JointModelGroup* jmg_;
+  kinematic_constraints::KinematicConstraintSetPtr constraints_;
+  std::vector<const kinematic_constraints::JointConstraint*> joint_constraints_;
+  std::vector<int> joint_constraint_indices_;  // the group variable index of each joint constraint, or -1
+  std::vector<const kinematic_constraints::PositionConstraint*> position_constraints_;
+  std::vector<const kinematic_constraints::OrientationConstraint*> orientation_constraints_;
+  std::unique_ptr<TSStateStorage> tss_;
+};
+}  // namespace ompl_interface
@@ -52,7 +52,8 @@ namespace ompl_interface
 class ModelBasedPlanningContext;
 
 /** @class ProjectionEvaluatorLinkPose
-    @brief */
+    @brief Projects states to the position of a link. If the link is the projection link of the planning context, the
+    position stored in the state by the state validity checker is used instead of computing it again. */
 class ProjectionEvaluatorLinkPose : public ompl::base::ProjectionEvaluator
 {
 public:
@@ -62,6 +63,11 @@ public:
   void defaultCellSizes() override;
   void project(const ompl::base::State* state, OMPLProjection projection) const override;
 
+  const moveit::core::LinkModel* getLink() const
+  {
+    return link_;
+  }
+
 private:
   const ModelBasedPlanningContext* planning_context_;
   const moveit::core::LinkModel* link_;
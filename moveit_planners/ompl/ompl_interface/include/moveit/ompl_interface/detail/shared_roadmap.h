@@ -0,0 +1,148 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, PickNik LLC
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik LLC nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#pragma once
+
+#include <moveit/macros/class_forward.h>
+#include <ompl/base/Planner.h>
+#include <ompl/base/StateValidityChecker.h>
+#include <atomic>
+#include <memory>
+#include <mutex>
+
+namespace ompl_interface
+{
+namespace ob = ompl::base;
+
+MOVEIT_CLASS_FORWARD(SharedRoadmap)         // Defines SharedRoadmapPtr, ConstPtr, WeakPtr... etc
+MOVEIT_CLASS_FORWARD(SharedRoadmapPlanner)  // Defines SharedRoadmapPlannerPtr, ConstPtr, WeakPtr... etc
+
+/** \brief A state validity checker that forwards to the checker of the query currently using a shared roadmap.
+ * States are invalid while no checker is set. */
+class DelegatingStateValidityChecker : public ob::StateValidityChecker
+{
+public:
+  DelegatingStateValidityChecker(const ob::SpaceInformationPtr& si);
+
+  bool isValid(const ob::State* state) const override;
+  bool isValid(const ob::State* state, double& dist) const override;
+  double clearance(const ob::State* state) const override;
+
+  void setDelegate(const ob::StateValidityCheckerPtr& delegate)
+  {
+    delegate_ = delegate;
+  }
+
+  const ob::StateValidityCheckerPtr& getDelegate() const
+  {
+    return delegate_;
+  }
+
+private:
+  ob::StateValidityCheckerPtr delegate_;
+};
+
+/** \brief A multi-query planner shared by all planning contexts of a planner configuration
+ *
+ * The planner runs on its own space information, whose state validity checker forwards to the checker of the
+ * context that currently uses the roadmap, so the roadmap grows with the queries of all contexts. Queries are
+ * serialized by a mutex. Between queries, PRM and PRM* roadmaps can be grown using the state validity checker of
+ * the last query, as long as the context of that query keeps it. */
+class SharedRoadmap
+{
+public:
+  /** \brief Create the space information a shared planner is constructed with, for the state space of \e si */
+  static ob::SpaceInformationPtr createSpaceInformation(const ob::SpaceInformationPtr& si);
+
+  /** \brief Share \e planner, which must have been constructed with space information from
+   * createSpaceInformation() */
+  SharedRoadmap(ob::PlannerPtr planner);
+
+  const ob::PlannerPtr& getPlanner() const
+  {
+    return planner_;
+  }
+
+  /** \brief Solve the problem \e pdef of \e user, checking states with \e state_validity_checker */
+  ob::PlannerStatus solve(const ob::PlannerTerminationCondition& ptc, const ob::ProblemDefinitionPtr& pdef,
+                          const ob::StateValidityCheckerPtr& state_validity_checker, const SharedRoadmapPlanner* user);
+
+  /** \brief Stop using the state validity checker of \e user, if it was the last one to solve a query */
+  void releaseStateValidityChecker(const SharedRoadmapPlanner* user);
+
+  /** \brief Grow the roadmap until \e ptc is met or a query is waiting. Return false if the planner does not
+   * support growing its roadmap or no state validity checker is available */
+  bool expand(const ob::PlannerTerminationCondition& ptc);
+
+  /** \brief Mark all vertices and edges of LazyPRM roadmaps as not checked for validity */
+  void clearValidity();
+
+  void getPlannerData(ob::PlannerData& data) const;
+
+private:
+  /** \brief Lock the roadmap for a query, which stops a running expansion */
+  std::unique_lock<std::mutex> lockForQuery() const;
+
+  ob::PlannerPtr planner_;
+  std::shared_ptr<DelegatingStateValidityChecker> state_validity_checker_;
+  const SharedRoadmapPlanner* state_validity_checker_user_;
+
+  mutable std::mutex lock_;
+  mutable std::atomic<unsigned int> waiting_queries_;
+};
+
+/** \brief The planner a planning context uses to solve its queries with a shared roadmap. Clearing it keeps the
+ * roadmap. */
+class SharedRoadmapPlanner : public ob::Planner
+{
+public:
+  SharedRoadmapPlanner(const ob::SpaceInformationPtr& si, SharedRoadmapPtr roadmap);
+  ~SharedRoadmapPlanner() override;
+
+  ob::PlannerStatus solve(const ob::PlannerTerminationCondition& ptc) override;
+
+  void getPlannerData(ob::PlannerData& data) const override;
+
+  const SharedRoadmapPtr& getSharedRoadmap() const
+  {
+    return roadmap_;
+  }
+
+  /** \brief Stop the shared roadmap from using the state validity checker of the last query of this planner */
+  void releaseStateValidityChecker();
+
+private:
+  SharedRoadmapPtr roadmap_;
+};
+}  // namespace ompl_interface
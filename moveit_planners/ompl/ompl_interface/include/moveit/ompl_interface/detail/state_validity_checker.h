@@ -39,6 +39,10 @@
 #include <moveit/ompl_interface/detail/threadsafe_state_storage.h>
 #include <moveit/collision_detection/collision_common.h>
 #include <ompl/base/StateValidityChecker.h>
+#include <Eigen/Geometry>
+#include <atomic>
+#include <cstdint>
+#include <vector>
 
 namespace ompl_interface
 {
@@ -69,7 +73,38 @@ public:
 
   void setVerbose(bool flag);
 
+  /** \brief Check collisions with the collision detector of the planning scene named \e collision_detector_name
+   *  instead of the active one. As its answers can differ from those of the active detector, they are not cached in
+   *  the states. */
+  void setCollisionDetector(const std::string& collision_detector_name);
+
+  /** \brief The number of states checked so far, not counting the states whose validity was cached */
+  unsigned long getCheckCount() const
+  {
+    return check_count_;
+  }
+
+  /** \brief The time spent checking states so far, in seconds */
+  double getCheckTime() const
+  {
+    return check_time_ * 1e-9;
+  }
+
+  /** \brief The part of the check time spent in collision checks, in seconds */
+  double getCollisionCheckTime() const
+  {
+    return collision_check_time_ * 1e-9;
+  }
+
 protected:
+  /** \brief Check a state that satisfies the path constraints for collisions with the world and itself */
+  virtual bool isCollisionFree(moveit::core::RobotState& robot_state, bool verbose) const;
+
+  /** \brief Check \e robot_state for collisions with the world and itself, with the planning scene or the collision
+   *  detector set by setCollisionDetector() */
+  void checkCollision(const collision_detection::CollisionRequest& req, collision_detection::CollisionResult& res,
+                      const moveit::core::RobotState& robot_state) const;
+
   const ModelBasedPlanningContext* planning_context_;
   std::string group_name_;
   TSStateStorage tss_;
@@ -80,5 +115,53 @@ protected:
 
   collision_detection::CollisionRequest collision_request_with_cost_;
   bool verbose_;
+
+private:
+  /** \brief Cache the validity of a state in the state, if the states of the planner support it */
+  void markValid(const ompl::base::State* state) const;
+  void markInvalid(const ompl::base::State* state) const;
+  void markInvalid(const ompl::base::State* state, double dist) const;
+
+  /** \brief Store the position of the projection link of the planning context in a state found valid, computed from
+   *  \e robot_state */
+  void storeProjectionLinkPosition(const ompl::base::State* state, moveit::core::RobotState& robot_state) const;
+
+  bool cache_validity_;  // false for constrained state spaces, which wrap the states and project them in place
+
+  // the collision environments of setCollisionDetector(), null to check with the planning scene
+  collision_detection::CollisionEnvConstPtr collision_env_;
+  collision_detection::CollisionEnvConstPtr collision_env_unpadded_;
+
+  // statistics of the checks, updated by all threads that check states
+  mutable std::atomic<unsigned long> check_count_;
+  mutable std::atomic<std::int64_t> check_time_;            // nanoseconds
+  mutable std::atomic<std::int64_t> collision_check_time_;  // nanoseconds
+};
+
+/** @class TieredStateValidityChecker
+    @brief A state validity checker that skips the exact check against the world when a cheap conservative test
+    shows that no link can touch a world object
+
+    The world objects are bounded by axis-aligned boxes when the checker is constructed, and the links of the
+    group and their attached bodies by spheres, using the padding of the planning scene. States whose spheres
+    overlap a box, which includes all states in collision, are checked exactly. The results are the same as
+    those of the StateValidityChecker; this pays off when many checked states are away from the obstacles, as for
+    lazy planners. */
+class TieredStateValidityChecker : public StateValidityChecker
+{
+public:
+  TieredStateValidityChecker(const ModelBasedPlanningContext* planning_context);
+
+protected:
+  bool isCollisionFree(moveit::core::RobotState& robot_state, bool verbose) const override;
+
+private:
+  /** \brief Return false if no link bounding sphere overlaps a world bounding box */
+  bool mayCollideWithWorld(moveit::core::RobotState& robot_state) const;
+
+  std::vector<Eigen::AlignedBox3d> world_boxes_;
+  std::vector<const moveit::core::LinkModel*> links_;
+  std::vector<double> link_paddings_;
+  bool always_exact_;  // the world or the links cannot be bounded
 };
 }  // namespace ompl_interface
@@ -37,11 +37,17 @@
 #pragma once
 
 #include <moveit/robot_state/robot_state.h>
+#include <cstdint>
 #include <thread>
 #include <mutex>
 
 namespace ompl_interface
 {
+/** \brief Provides each thread with its own copy of a start state.
+
+    Each thread caches the states it obtained from the most recently used storages in thread-local slots, so the
+    common case of getStateStorage() is a short, lock-free scan. Only the first access of a thread (or an access after
+    its slot was evicted) falls back to the mutex-protected map that owns the states. */
 class TSStateStorage
 {
 public:
@@ -52,8 +58,13 @@ public:
   moveit::core::RobotState* getStateStorage() const;
 
 private:
+  moveit::core::RobotState* getStateStorageSlow() const;
+
   moveit::core::RobotState start_state_;
   mutable std::map<std::thread::id, moveit::core::RobotState*> thread_states_;
   mutable std::mutex lock_;
+
+  /// Process-wide unique id of this storage, used to key the thread-local slots. Ids are never reused.
+  const std::uint64_t id_;
 };
 }  // namespace ompl_interface
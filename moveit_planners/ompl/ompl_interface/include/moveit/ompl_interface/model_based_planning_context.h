@@ -42,10 +42,15 @@
 #include <moveit/planning_interface/planning_interface.h>
 
 #include <ompl/geometric/SimpleSetup.h>
+#include <ompl/base/ConstrainedSpaceInformation.h>
+#include <ompl/base/spaces/constraint/ProjectedStateSpace.h>
 #include <ompl/tools/benchmark/Benchmark.h>
 #include <ompl/tools/multiplan/ParallelPlan.h>
 #include <ompl/base/StateStorage.h>
 
+#include <algorithm>
+#include <functional>
+
 namespace ompl_interface
 {
 namespace ob = ompl::base;
@@ -54,6 +59,7 @@ namespace ot = ompl::tools;
 
 MOVEIT_CLASS_FORWARD(ModelBasedPlanningContext)  // Defines ModelBasedPlanningContextPtr, ConstPtr, WeakPtr... etc
 MOVEIT_CLASS_FORWARD(ConstraintsLibrary)         // Defines ConstraintsLibraryPtr, ConstPtr, WeakPtr... etc
+MOVEIT_CLASS_FORWARD(ExperienceDatabase)         // Defines ExperienceDatabasePtr, ConstPtr, WeakPtr... etc
 
 struct ModelBasedPlanningContextSpecification;
 typedef std::function<ob::PlannerPtr(const ompl::base::SpaceInformationPtr& si, const std::string& name,
@@ -69,6 +75,9 @@ struct ModelBasedPlanningContextSpecification
 
   ModelBasedStateSpacePtr state_space_;
   og::SimpleSetupPtr ompl_simple_setup_;  // pass in the correct simple setup type
+
+  // if set, planners work in this space, which wraps state_space_ and projects states onto the path constraints
+  ob::ConstrainedStateSpacePtr constrained_state_space_;
 };
 
 class ModelBasedPlanningContext : public planning_interface::PlanningContext
@@ -76,9 +85,7 @@ class ModelBasedPlanningContext : public planning_interface::PlanningContext
 public:
   ModelBasedPlanningContext(const std::string& name, const ModelBasedPlanningContextSpecification& spec);
 
-  ~ModelBasedPlanningContext() override
-  {
-  }
+  ~ModelBasedPlanningContext() override;
 
   bool solve(planning_interface::MotionPlanResponse& res) override;
   bool solve(planning_interface::MotionPlanDetailedResponse& res) override;
@@ -182,6 +189,18 @@ public:
     max_goal_samples_ = max_goal_samples;
   }
 
+  /* \brief Get the number of threads that sample each goal with a constraint sampler */
+  unsigned int getGoalSamplingThreads() const
+  {
+    return goal_sampling_threads_;
+  }
+
+  /* \brief Set the number of threads that sample each goal with a constraint sampler, at least 1 */
+  void setGoalSamplingThreads(unsigned int goal_sampling_threads)
+  {
+    goal_sampling_threads_ = std::max(goal_sampling_threads, 1u);
+  }
+
   /* \brief Get the maximum number of planning threads allowed */
   unsigned int getMaximumPlanningThreads() const
   {
@@ -217,6 +236,20 @@ public:
     minimum_waypoint_count_ = mwc;
   }
 
+  /* \brief Get the link whose position the default projection of the state space uses, nullptr for other projections.
+   * The state validity checker stores the position of this link in the states it finds valid. */
+  const moveit::core::LinkModel* getProjectionLink() const
+  {
+    return projection_link_;
+  }
+
+  /* \brief Get the padding profile of the collision environment the states are checked with (empty for the link
+   * padding of the planning scene) */
+  const std::string& getPaddingProfile() const
+  {
+    return padding_profile_;
+  }
+
   const constraint_samplers::ConstraintSamplerManagerPtr& getConstraintSamplerManager()
   {
     return spec_.constraint_sampler_manager_;
@@ -266,6 +299,17 @@ public:
     simplify_solutions_ = flag;
   }
 
+  /** \brief Look up previous solutions in, and add new solutions to the given database. Pass nullptr to disable. */
+  void setExperienceDatabase(const ExperienceDatabasePtr& experience_database)
+  {
+    experience_database_ = experience_database;
+  }
+
+  const ExperienceDatabasePtr& getExperienceDatabase() const
+  {
+    return experience_database_;
+  }
+
   void setInterpolation(bool flag)
   {
     interpolate_ = flag;
@@ -302,6 +346,9 @@ public:
     return last_simplify_time_;
   }
 
+  /* @brief Get the amount of time the goal samplers of this context spent sampling goal states so far */
+  double getGoalSamplingTime() const;
+
   /* @brief Apply smoothing and try to simplify the plan
      @param timeout The amount of time allowed to be spent on simplifying the plan*/
   void simplifySolution(double timeout);
@@ -335,6 +382,28 @@ protected:
   void preSolve();
   void postSolve();
 
+  /** \brief Plan with the experience database in parallel with planning from scratch */
+  bool solveWithExperience(double timeout, unsigned int count, const ompl::time::point& start);
+
+  /** \brief Plan against the coarse collision detector first and accept its path if it is valid with the exact
+      collision checks. Otherwise plan again with the exact checks, repairing the coarse path in parallel with
+      planning from scratch. */
+  bool solveCoarseToFine(double timeout, unsigned int count, const ompl::time::point& start);
+
+  /** \brief Get a check whether a state satisfies one of the goal constraints */
+  std::function<bool(const ob::State*)> getGoalCheck() const;
+
+  /** \brief Store the current solution path in the experience database */
+  void addSolutionToExperienceDatabase();
+
+  /** \brief Shortcut the solution path in rounds of one randomized attempt per thread on copies of the path, keeping
+      the best result of each round, until a round brings no improvement or the timeout */
+  void simplifySolutionInParallel(double timeout);
+
+  /** \brief Add the hybridization of the exact solutions in the problem definition as a solution, recording the best
+      solutions first and no more once the time since \e start exceeds \e timeout */
+  void hybridizeSolutions(double timeout, const ompl::time::point& start);
+
   void startSampling();
   void stopSampling();
 
@@ -406,6 +475,9 @@ protected:
   /// possible)
   unsigned int max_goal_samples_;
 
+  /// the number of threads sampling each goal, all but one with their own copy of the constraint sampler
+  unsigned int goal_sampling_threads_;
+
   /// maximum number of attempts to be made at sampling a state when attempting to find valid states that satisfy some
   /// set of constraints
   unsigned int max_state_sampling_attempts_;
@@ -429,6 +501,11 @@ protected:
 
   ConstraintsLibraryPtr constraints_library_;
 
+  ExperienceDatabasePtr experience_database_;
+
+  /// the hash of the planning scene the experiences of the current request are stored under
+  std::size_t experience_scene_hash_;
+
   bool simplify_solutions_;
 
   // if false the final solution is not interpolated
@@ -436,5 +513,33 @@ protected:
 
   // if false parallel plan returns the first solution found
   bool hybridize_;
+
+  // the number of threads the solution is shortcut with in parallel, the OMPL path simplifier is used if less than 2
+  unsigned int simplification_threads_;
+
+  // if true states are checked with a TieredStateValidityChecker
+  bool tiered_state_validity_checking_;
+
+  // if true motions are checked with a ClearanceMotionValidator
+  bool clearance_motion_validation_;
+
+  // if true motions are checked with a ContinuousMotionValidator
+  bool continuous_motion_validation_;
+
+  // the padding profile of the collision environment states are checked with, see CollisionEnv::setPaddingProfile()
+  std::string padding_profile_;
+
+  // the link of the default projection, if it is a link projection
+  const moveit::core::LinkModel* projection_link_;
+
+  // the collision detector of the planning scene the first pass of solveCoarseToFine() checks states with, empty to
+  // plan in a single pass
+  std::string coarse_collision_detector_;
+
+  // the fraction of the planning time the first pass of solveCoarseToFine() may take
+  double coarse_time_fraction_;
+
+  // if true states without path constraints are sampled with ModelBasedStateSpace::allocQuasiRandomStateSampler()
+  bool quasi_random_sampling_;
 };
 }  // namespace ompl_interface
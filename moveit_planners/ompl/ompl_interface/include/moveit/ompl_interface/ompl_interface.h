@@ -125,6 +125,12 @@ public:
     simplify_solutions_ = flag;
   }
 
+  /** @brief Get the database of previous solutions that planning contexts reuse, or nullptr if it is disabled */
+  const ExperienceDatabasePtr& getExperienceDatabase() const
+  {
+    return experience_database_;
+  }
+
   /** @brief Print the status of this node*/
   void printStatus();
 
@@ -140,6 +146,12 @@ protected:
   /** @brief Load the additional plugins for sampling constraints */
   void loadConstraintSamplers();
 
+  /** @brief Read the size limit of the planning context cache and pre-build planning contexts if requested */
+  void loadPlanningContextPoolSettings();
+
+  /** @brief Create the experience database if requested, and load the previous solutions from its file */
+  void loadExperienceDatabaseSettings();
+
   void configureContext(const ModelBasedPlanningContextPtr& context) const;
 
   /** \brief Configure the OMPL planning context for a new planning request */
@@ -160,6 +172,9 @@ protected:
 
   bool use_constraints_approximations_;
 
+  ExperienceDatabasePtr experience_database_;
+  std::string experience_database_path_;  /// if set, the experiences are loaded from and saved to this file
+
   bool simplify_solutions_;
 
 private:
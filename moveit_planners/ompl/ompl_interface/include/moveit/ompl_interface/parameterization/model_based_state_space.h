@@ -41,6 +41,7 @@
 #include <moveit/robot_state/robot_state.h>
 #include <moveit/kinematic_constraints/kinematic_constraint.h>
 #include <moveit/constraint_samplers/constraint_sampler.h>
+#include <Eigen/Core>
 
 namespace ompl_interface
 {
@@ -83,7 +84,8 @@ public:
       GOAL_DISTANCE_KNOWN = 2,
       VALIDITY_TRUE = 4,
       IS_START_STATE = 8,
-      IS_GOAL_STATE = 16
+      IS_GOAL_STATE = 16,
+      LINK_POSITION_KNOWN = 32
     };
 
     StateType() : ompl::base::State(), values(nullptr), tag(-1), flags(0), distance(0.0)
@@ -160,10 +162,25 @@ public:
       flags |= IS_GOAL_STATE;
     }
 
+    /// Remember the position of the projection link of the planning context, computed while checking the state
+    void setLinkPosition(const Eigen::Vector3d& position)
+    {
+      link_position[0] = position.x();
+      link_position[1] = position.y();
+      link_position[2] = position.z();
+      flags |= LINK_POSITION_KNOWN;
+    }
+
+    bool isLinkPositionKnown() const
+    {
+      return flags & LINK_POSITION_KNOWN;
+    }
+
     double* values;
     int tag;
     int flags;
     double distance;
+    double link_position[3];
   };
 
   ModelBasedStateSpace(ModelBasedStateSpaceSpecification spec);
@@ -179,6 +196,16 @@ public:
     distance_function_ = fun;
   }
 
+  /// Set a weight for each active joint of the group, in the order of getJointModelGroup()->getActiveJointModels(),
+  /// by which distance() multiplies the distance of the joint, on top of its distance factor. An empty vector removes
+  /// the weights.
+  void setJointDistanceWeights(const std::vector<double>& weights);
+
+  const std::vector<double>& getJointDistanceWeights() const
+  {
+    return joint_distance_weights_;
+  }
+
   ompl::base::State* allocState() const override;
   void freeState(ompl::base::State* state) const override;
   unsigned int getDimension() const override;
@@ -200,6 +227,11 @@ public:
 
   ompl::base::StateSamplerPtr allocDefaultStateSampler() const override;
 
+  /** \brief Allocate a sampler whose uniform samples of revolute and prismatic joints follow a randomly shifted Halton
+   *  sequence, which covers the joint space more evenly than independent samples. Other joints and the near and
+   *  gaussian samples are drawn as by the default sampler. */
+  ompl::base::StateSamplerPtr allocQuasiRandomStateSampler() const;
+
   virtual const std::string& getParameterizationType() const = 0;
 
   const moveit::core::RobotModelConstPtr& getRobotModel() const
@@ -258,6 +290,9 @@ public:
   void setTagSnapToSegment(double snap);
 
 protected:
+  /// Interpolate the values of a state space with flat values, see flat_values_
+  void interpolateFlatValues(const double* from, const double* to, const double t, double* state) const;
+
   ModelBasedStateSpaceSpecification spec_;
   std::vector<moveit::core::JointModel::Bounds> joint_bounds_storage_;
   std::vector<const moveit::core::JointModel*> joint_model_vector_;
@@ -267,6 +302,13 @@ protected:
   InterpolationFunction interpolation_function_;
   DistanceFunction distance_function_;
 
+  /// When all active joints are single variable revolute or prismatic joints and the group has no mimic joints,
+  /// interpolate() and distance() operate on the values as a whole instead of per joint model
+  bool flat_values_;
+  Eigen::Array<bool, Eigen::Dynamic, 1> continuous_values_;  ///< Which values belong to continuous joints
+  Eigen::ArrayXd value_distance_weights_;                    ///< The distance factor times the weight of each value
+  std::vector<double> joint_distance_weights_;
+
   double tag_snap_to_segment_;
   double tag_snap_to_segment_complement_;
 };
@@ -37,14 +37,18 @@
 #pragma once
 
 #include <moveit/ompl_interface/model_based_planning_context.h>
+#include <moveit/ompl_interface/detail/shared_roadmap.h>
 #include <moveit/ompl_interface/parameterization/model_based_state_space_factory.h>
 #include <moveit/constraint_samplers/constraint_sampler_manager.h>
 #include <moveit/macros/class_forward.h>
 
 #include <ompl/base/PlannerDataStorage.h>
 
+#include <chrono>
+#include <condition_variable>
 #include <string>
 #include <map>
+#include <thread>
 
 namespace ompl_interface
 {
@@ -67,13 +71,39 @@ private:
   template <typename T>
   inline ob::Planner* allocatePersistentPlanner(const ob::PlannerData& data);
 
-  // Storing multi-query planners
-  std::map<std::string, ob::PlannerPtr> planners_;
+  /** \brief Read planner data stored by storePlannerData() from a memory-mapped file */
+  bool loadPlannerData(const std::string& file_path, ob::PlannerData& data);
+
+  /** \brief Store the planner data of a roadmap. The data is written to a temporary file that then replaces
+   * \e file_path, so other processes loading the file never see a partially written roadmap */
+  bool storePlannerData(const SharedRoadmap& roadmap, const std::string& file_path);
+
+  /** \brief Periodically grow the roadmaps that have an expansion period, and store them if requested */
+  void expandRoadmaps();
+
+  struct RoadmapExpansion
+  {
+    std::chrono::duration<double> period_;
+    double duration_;
+    std::chrono::steady_clock::time_point next_;
+  };
+
+  // Storing multi-query planners, shared by all contexts of a planner configuration
+  std::map<std::string, SharedRoadmapPtr> planners_;
 
   std::map<std::string, std::string> planner_data_storage_paths_;
 
+  std::map<std::string, RoadmapExpansion> roadmap_expansions_;
+
   // Store and load planner data
   ob::PlannerDataStorage storage_;
+
+  // Protects the maps above, since planners are allocated by concurrent requests
+  std::mutex lock_;
+
+  std::thread expansion_thread_;
+  std::condition_variable expansion_condition_;
+  std::atomic<bool> stop_expansion_{ false };
 };
 
 class PlanningContextManager
@@ -164,6 +194,37 @@ public:
     minimum_waypoint_count_ = mwc;
   }
 
+  /** \brief Get the maximum number of planning contexts cached per planner configuration and state space (0 means
+   * unlimited) */
+  unsigned int getMaximumCachedContexts() const
+  {
+    return max_cached_contexts_;
+  }
+
+  /** \brief Set the maximum number of planning contexts cached per planner configuration and state space. Contexts
+   * that are created while this many contexts are in use are not retained after the request. 0 means unlimited. */
+  void setMaximumCachedContexts(unsigned int max_cached_contexts)
+  {
+    max_cached_contexts_ = max_cached_contexts;
+  }
+
+  /** \brief How often a request was served by an idle cached planning context (hits) or needed a new one (misses) */
+  struct CachedContextStatistics
+  {
+    std::size_t hits = 0;
+    std::size_t misses = 0;
+  };
+
+  /** \brief Get the hits and misses of the planning context cache so far. Requests planned in a constrained state
+   * space do not use the cache and are not counted. */
+  CachedContextStatistics getCachedContextStatistics() const;
+
+  /** \brief Construct \e contexts_per_config planning contexts (state space and OMPL setup) for each planner
+   * configuration ahead of time, so they do not need to be built while serving the first requests. Contexts are built
+   * for the state space an unconstrained request would be planned in. Must be called after
+   * setPlannerConfigurations(). */
+  void prewarmPlanningContexts(unsigned int contexts_per_config);
+
   const moveit::core::RobotModelConstPtr& getRobotModel() const
   {
     return robot_model_;
@@ -217,6 +278,12 @@ protected:
   template <typename T>
   void registerPlannerAllocatorHelper(const std::string& planner_id);
 
+  /** \brief Construct a new, unconfigured planning context for \e config using the state space of \e factory. For
+      constrained state spaces, the manifold is defined by the path constraints of \e req */
+  ModelBasedPlanningContextPtr createPlanningContext(const planning_interface::PlannerConfigurationSettings& config,
+                                                     const ModelBasedStateSpaceFactoryPtr& factory,
+                                                     const moveit_msgs::msg::MotionPlanRequest& req) const;
+
   /** \brief This is the function that constructs new planning contexts if no previous ones exist that are suitable */
   ModelBasedPlanningContextPtr getPlanningContext(const planning_interface::PlannerConfigurationSettings& config,
                                                   const StateSpaceFactoryTypeSelector& factory_selector,
@@ -263,6 +330,9 @@ protected:
   /// needed)
   unsigned int minimum_waypoint_count_;
 
+  /// maximum number of cached planning contexts per planner configuration and state space (0 means unlimited)
+  unsigned int max_cached_contexts_;
+
   /// Multi-query planner allocator
   MultiQueryPlannerAllocator planner_allocator_;
 
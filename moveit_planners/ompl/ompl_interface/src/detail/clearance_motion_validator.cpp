@@ -0,0 +1,266 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, PickNik LLC
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik LLC nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include <moveit/ompl_interface/detail/clearance_motion_validator.h>
+#include <moveit/ompl_interface/model_based_planning_context.h>
+#include <moveit/ompl_interface/parameterization/joint_space/joint_model_state_space.h>
+#include <geometric_shapes/shape_operations.h>
+#include <rclcpp/rclcpp.hpp>
+#include <algorithm>
+#include <cmath>
+
+namespace ompl_interface
+{
+static const rclcpp::Logger LOGGER = rclcpp::get_logger("moveit.ompl_planning.clearance_motion_validator");
+}  // namespace ompl_interface
+
+ompl_interface::ClearanceMotionValidator::ClearanceMotionValidator(const ModelBasedPlanningContext* pc)
+  : ompl::base::MotionValidator(pc->getOMPLSimpleSetup()->getSpaceInformation())
+  , planning_context_(pc)
+  , tss_(pc->getCompleteInitialRobotState())
+  , discrete_validator_(pc->getOMPLSimpleSetup()->getSpaceInformation())
+  , always_discrete_(false)
+{
+  const planning_scene::PlanningSceneConstPtr& scene = pc->getPlanningScene();
+  distance_request_.group_name = pc->getGroupName();
+  distance_request_.padding_profile = pc->getPaddingProfile();
+  distance_request_.acm = &scene->getAllowedCollisionMatrix();
+  distance_request_.enableGroup(pc->getRobotModel());
+
+  // the skipped states are only shown to be collision free, and the bound assumes joint space interpolation
+  if ((pc->getPathConstraints() && !pc->getPathConstraints()->empty()) || scene->getStateFeasibilityPredicate() ||
+      pc->getOMPLStateSpace()->getParameterizationType() != JointModelStateSpace::PARAMETERIZATION_TYPE)
+  {
+    always_discrete_ = true;
+    return;
+  }
+
+  const moveit::core::JointModelGroup* jmg = pc->getJointModelGroup();
+  bool bounded = true;
+  for (const moveit::core::JointModel* joint : jmg->getActiveJointModels())
+  {
+    double weight = 0.0;
+    bounded = computeJointWeight(joint, weight);
+    for (const moveit::core::JointModel* mimic : joint->getMimicRequests())
+    {
+      double mimic_weight = 0.0;
+      bounded = bounded && computeJointWeight(mimic, mimic_weight);
+      weight += std::fabs(mimic->getMimicFactor()) * mimic_weight;
+    }
+    if (!bounded)
+      break;
+    joints_.push_back(joint);
+    joint_value_indices_.push_back(jmg->getJointVariableGroupIndex(joint));
+    joint_weights_.push_back(weight);
+  }
+  if (!bounded)
+  {
+    RCLCPP_DEBUG(LOGGER, "%s: The motions of the group cannot be bounded, checking them at the state space resolution",
+                 pc->getName().c_str());
+    always_discrete_ = true;
+  }
+}
+
+bool ompl_interface::ClearanceMotionValidator::computeJointWeight(const moveit::core::JointModel* joint,
+                                                                  double& weight) const
+{
+  switch (joint->getType())
+  {
+    case moveit::core::JointModel::REVOLUTE:
+      // points move on circles around the axis through the joint origin, which is the origin of the child link
+      return computeSubtreeRadius(joint->getChildLinkModel(), weight);
+    case moveit::core::JointModel::PRISMATIC:
+      weight = 1.0;
+      return true;
+    default:
+      return false;
+  }
+}
+
+bool ompl_interface::ClearanceMotionValidator::computeSubtreeRadius(const moveit::core::LinkModel* link,
+                                                                    double& radius) const
+{
+  const collision_detection::CollisionEnvConstPtr& env = planning_context_->getPlanningScene()->getCollisionEnv();
+  // scaled shapes grow around their own origin, which is not worth bounding
+  if (env->getLinkScale(link->getName()) != 1.0)
+    return false;
+  const double padding = env->getLinkPadding(link->getName(), planning_context_->getPaddingProfile());
+
+  radius = 0.0;
+  if (!link->getShapes().empty())
+    radius = link->getCenteredBoundingBoxOffset().norm() + 0.5 * link->getShapeExtentsAtOrigin().norm() + padding;
+
+  // the objects attached to the link do not change while planning
+  std::vector<const moveit::core::AttachedBody*> attached_bodies;
+  planning_context_->getCompleteInitialRobotState().getAttachedBodies(attached_bodies, link);
+  for (const moveit::core::AttachedBody* attached_body : attached_bodies)
+    for (std::size_t i = 0; i < attached_body->getShapes().size(); ++i)
+    {
+      Eigen::Vector3d center;
+      double shape_radius;
+      shapes::computeShapeBoundingSphere(attached_body->getShapes()[i].get(), center, shape_radius);
+      radius = std::max(radius, (attached_body->getFixedTransforms()[i] * center).norm() + shape_radius + padding);
+    }
+
+  for (const moveit::core::JointModel* joint : link->getChildJointModels())
+  {
+    // the child link origin is at the joint origin, moved along the axis for prismatic joints
+    double offset = joint->getChildLinkModel()->getJointOriginTransform().translation().norm();
+    if (joint->getType() == moveit::core::JointModel::PRISMATIC)
+    {
+      const moveit::core::VariableBounds& bounds = joint->getVariableBounds()[0];
+      if (!bounds.position_bounded_)
+        return false;
+      offset += std::max(std::fabs(bounds.min_position_), std::fabs(bounds.max_position_));
+    }
+    else if (joint->getType() != moveit::core::JointModel::REVOLUTE &&
+             joint->getType() != moveit::core::JointModel::FIXED)
+      return false;
+
+    double child_radius;
+    if (!computeSubtreeRadius(joint->getChildLinkModel(), child_radius))
+      return false;
+    radius = std::max(radius, offset + child_radius);
+  }
+  return true;
+}
+
+double ompl_interface::ClearanceMotionValidator::computeMotionBound(const ompl::base::State* s1,
+                                                                  const ompl::base::State* s2) const
+{
+  const double* values1 = s1->as<ModelBasedStateSpace::StateType>()->values;
+  const double* values2 = s2->as<ModelBasedStateSpace::StateType>()->values;
+  double bound = 0.0;
+  for (std::size_t i = 0; i < joints_.size(); ++i)
+    bound += joint_weights_[i] *
+             joints_[i]->distance(values1 + joint_value_indices_[i], values2 + joint_value_indices_[i]);
+  return bound;
+}
+
+bool ompl_interface::ClearanceMotionValidator::checkMotion(const ompl::base::State* s1,
+                                                           const ompl::base::State* s2) const
+{
+  if (always_discrete_)
+    return discrete_validator_.checkMotion(s1, s2);
+
+  // assume motion starts in a valid configuration so s1 is valid, and reject early with the end state
+  double last_valid_fraction;
+  const bool result = si_->isValid(s2) && checkMotionFrom(s1, s2, last_valid_fraction);
+  if (result)
+    valid_++;
+  else
+    invalid_++;
+  return result;
+}
+
+bool ompl_interface::ClearanceMotionValidator::checkMotion(const ompl::base::State* s1, const ompl::base::State* s2,
+                                                           std::pair<ompl::base::State*, double>& last_valid) const
+{
+  if (always_discrete_)
+    return discrete_validator_.checkMotion(s1, s2, last_valid);
+
+  double last_valid_fraction;
+  const bool result = checkMotionFrom(s1, s2, last_valid_fraction);
+  if (result)
+    valid_++;
+  else
+  {
+    if (last_valid.first)
+      si_->getStateSpace()->interpolate(s1, s2, last_valid_fraction, last_valid.first);
+    last_valid.second = last_valid_fraction;
+    invalid_++;
+  }
+  return result;
+}
+
+bool ompl_interface::ClearanceMotionValidator::checkMotionFrom(const ompl::base::State* s1,
+                                                               const ompl::base::State* s2,
+                                                               double& last_valid_fraction) const
+{
+  const ompl::base::StateSpacePtr& state_space = si_->getStateSpace();
+  const double resolution_step = 1.0 / std::max(1u, state_space->validSegmentCount(s1, s2));
+  const double bound = computeMotionBound(s1, s2);
+  const planning_scene::PlanningSceneConstPtr& scene = planning_context_->getPlanningScene();
+  moveit::core::RobotState* robot_state = tss_.getStateStorage();
+  collision_detection::DistanceRequest distance_request = distance_request_;
+  collision_detection::DistanceResult world_distance, self_distance;
+
+  ompl::base::State* state = si_->allocState();
+  const ompl::base::State* current = s1;
+  bool result = true;
+  last_valid_fraction = 0.0;
+  while (last_valid_fraction < 1.0)
+  {
+    // points move at most (1 - t) * bound until the end of the motion, larger distances do not need to be computed
+    const double remaining_motion = (1.0 - last_valid_fraction) * bound;
+    double step = 1.0;
+    if (remaining_motion > 0.0)
+    {
+      planning_context_->getOMPLStateSpace()->copyToRobotState(*robot_state, current);
+      robot_state->updateCollisionBodyTransforms();
+
+      world_distance.clear();
+      distance_request.distance_threshold = remaining_motion;
+      scene->getCollisionEnv()->distanceRobot(distance_request, world_distance, *robot_state);
+
+      // both links of a self-collision pair may move towards each other
+      self_distance.clear();
+      distance_request.distance_threshold = 2.0 * remaining_motion;
+      scene->getCollisionEnvUnpadded()->distanceSelf(distance_request, self_distance, *robot_state);
+
+      const double clearance =
+          std::min(world_distance.minimum_distance.distance, 0.5 * self_distance.minimum_distance.distance);
+      step = std::max(resolution_step, clearance / bound);
+    }
+
+    const double t = std::min(1.0, last_valid_fraction + step);
+    if (t < 1.0)
+    {
+      state_space->interpolate(s1, s2, t, state);
+      current = state;
+    }
+    else
+      current = s2;
+
+    // the state where the collision free part of the motion ends may touch an obstacle
+    if (!si_->isValid(current))
+    {
+      result = false;
+      break;
+    }
+    last_valid_fraction = t;
+  }
+  si_->freeState(state);
+  return result;
+}
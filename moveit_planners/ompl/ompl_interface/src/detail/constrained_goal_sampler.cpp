@@ -39,6 +39,7 @@
 #include <moveit/ompl_interface/detail/state_validity_checker.h>
 #include <moveit/profiler/profiler.h>
 
+#include <chrono>
 #include <utility>
 
 namespace ompl_interface
@@ -50,7 +51,7 @@ ompl_interface::ConstrainedGoalSampler::ConstrainedGoalSampler(const ModelBasedP
                                                                kinematic_constraints::KinematicConstraintSetPtr ks,
                                                                constraint_samplers::ConstraintSamplerPtr cs)
   : ob::GoalLazySamples(pc->getOMPLSimpleSetup()->getSpaceInformation(),
-                        std::bind(&ConstrainedGoalSampler::sampleUsingConstraintSampler, this, std::placeholders::_1,
+                        std::bind(&ConstrainedGoalSampler::sampleAndMeasureTime, this, std::placeholders::_1,
                                   std::placeholders::_2),
                         false)
   , planning_context_(pc)
@@ -60,6 +61,10 @@ ompl_interface::ConstrainedGoalSampler::ConstrainedGoalSampler(const ModelBasedP
   , invalid_sampled_constraints_(0)
   , warned_invalid_samples_(false)
   , verbose_display_(0)
+  , sampling_time_(0)
+  , active_helper_threads_(0)
+  , helper_attempts_(0)
+  , stop_helper_threads_(false)
 {
   if (!constraint_sampler_)
     default_sampler_ = si_->allocStateSampler();
@@ -67,6 +72,68 @@ ompl_interface::ConstrainedGoalSampler::ConstrainedGoalSampler(const ModelBasedP
   startSampling();
 }
 
+ompl_interface::ConstrainedGoalSampler::~ConstrainedGoalSampler()
+{
+  // the sampling thread of OMPL starts the helper threads, so it has to be stopped first
+  stopSampling();
+  stopHelperThreads();
+}
+
+void ompl_interface::ConstrainedGoalSampler::startHelperThreads()
+{
+  if (!constraint_sampler_ || active_helper_threads_ > 0 || planning_context_->getGoalSamplingThreads() < 2)
+    return;
+  const constraint_samplers::ConstraintSamplerManagerPtr& manager =
+      planning_context_->getSpecification().constraint_sampler_manager_;
+  if (!manager)
+    return;
+
+  stopHelperThreads();
+  stop_helper_threads_ = false;
+  for (unsigned int i = 1; i < planning_context_->getGoalSamplingThreads(); ++i)
+  {
+    // constraint samplers keep their state (and their IK solver) between samples, so each thread needs its own
+    constraint_samplers::ConstraintSamplerPtr sampler = manager->selectSampler(
+        planning_context_->getPlanningScene(), planning_context_->getGroupName(),
+        kinematic_constraint_set_->getAllConstraints());
+    if (!sampler)
+      break;
+    ++active_helper_threads_;
+    helper_threads_.emplace_back(&ConstrainedGoalSampler::sampleInHelperThread, this, sampler);
+  }
+  RCLCPP_DEBUG(LOGGER, "Started %zu additional goal sampling threads", helper_threads_.size());
+}
+
+void ompl_interface::ConstrainedGoalSampler::stopHelperThreads()
+{
+  stop_helper_threads_ = true;
+  for (std::thread& thread : helper_threads_)
+    thread.join();
+  helper_threads_.clear();
+}
+
+void ompl_interface::ConstrainedGoalSampler::sampleInHelperThread(
+    const constraint_samplers::ConstraintSamplerPtr& sampler)
+{
+  moveit::core::RobotState work_state(planning_context_->getCompleteInitialRobotState());
+  ob::State* new_goal = si_->allocState();
+  while (!stop_helper_threads_ && isSampling() && canContinueSampling())
+  {
+    ++helper_attempts_;
+    if (sampleGoal(*sampler, work_state, new_goal, false))
+      addStateIfDifferent(new_goal, getMinNewSampleDistance());
+  }
+  si_->freeState(new_goal);
+  --active_helper_threads_;
+}
+
+bool ompl_interface::ConstrainedGoalSampler::canContinueSampling() const
+{
+  return samplingAttemptsCount() + helper_attempts_ < planning_context_->getMaximumGoalSamplingAttempts() &&
+         getStateCount() < planning_context_->getMaximumGoalSamples() &&
+         !planning_context_->getOMPLSimpleSetup()->getProblemDefinition()->hasSolution();
+}
+
 bool ompl_interface::ConstrainedGoalSampler::checkStateValidity(ob::State* new_goal,
                                                                 const moveit::core::RobotState& state,
                                                                 bool verbose) const
@@ -87,24 +154,25 @@ bool ompl_interface::ConstrainedGoalSampler::stateValidityCallback(ob::State* ne
   return checkStateValidity(new_goal, solution_state, verbose);
 }
 
+bool ompl_interface::ConstrainedGoalSampler::sampleAndMeasureTime(const ob::GoalLazySamples* gls, ob::State* new_goal)
+{
+  startHelperThreads();
+  const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  const bool sampled = sampleUsingConstraintSampler(gls, new_goal);
+  sampling_time_ +=
+      std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+  return sampled;
+}
+
 bool ompl_interface::ConstrainedGoalSampler::sampleUsingConstraintSampler(const ob::GoalLazySamples* gls,
                                                                           ob::State* new_goal)
 {
   //  moveit::Profiler::ScopedBlock sblock("ConstrainedGoalSampler::sampleUsingConstraintSampler");
 
   unsigned int max_attempts = planning_context_->getMaximumGoalSamplingAttempts();
-  unsigned int attempts_so_far = gls->samplingAttemptsCount();
-
-  // terminate after too many attempts
-  if (attempts_so_far >= max_attempts)
-    return false;
-
-  // terminate after a maximum number of samples
-  if (gls->getStateCount() >= planning_context_->getMaximumGoalSamples())
-    return false;
 
-  // terminate the sampling thread when a solution has been found
-  if (planning_context_->getOMPLSimpleSetup()->getProblemDefinition()->hasSolution())
+  // terminate after too many attempts, after a maximum number of samples or when a solution has been found
+  if (!canContinueSampling())
     return false;
 
   unsigned int max_attempts_div2 = max_attempts / 2;
@@ -120,35 +188,8 @@ bool ompl_interface::ConstrainedGoalSampler::sampleUsingConstraintSampler(const
 
     if (constraint_sampler_)
     {
-      // makes the constraint sampler also perform a validity callback
-      moveit::core::GroupStateValidityCallbackFn gsvcf =
-          std::bind(&ompl_interface::ConstrainedGoalSampler::stateValidityCallback, this, new_goal,
-                    std::placeholders::_1,  // pointer to state
-                    std::placeholders::_2,  // const* joint model group
-                    std::placeholders::_3,  // double* of joint positions
-                    verbose);
-      constraint_sampler_->setGroupStateValidityCallback(gsvcf);
-
-      if (constraint_sampler_->project(work_state_, planning_context_->getMaximumStateSamplingAttempts()))
-      {
-        work_state_.update();
-        if (kinematic_constraint_set_->decide(work_state_, verbose).satisfied)
-        {
-          if (checkStateValidity(new_goal, work_state_, verbose))
-            return true;
-        }
-        else
-        {
-          invalid_sampled_constraints_++;
-          if (!warned_invalid_samples_ && invalid_sampled_constraints_ >= (attempts_so_far * 8) / 10)
-          {
-            warned_invalid_samples_ = true;
-            RCLCPP_WARN(LOGGER, "More than 80%% of the sampled goal states "
-                                "fail to satisfy the constraints imposed on the goal sampler. "
-                                "Is the constrained sampler working correctly?");
-          }
-        }
-      }
+      if (sampleGoal(*constraint_sampler_, work_state_, new_goal, verbose))
+        return true;
     }
     else
     {
@@ -163,3 +204,31 @@ bool ompl_interface::ConstrainedGoalSampler::sampleUsingConstraintSampler(const
   }
   return false;
 }
+
+bool ompl_interface::ConstrainedGoalSampler::sampleGoal(constraint_samplers::ConstraintSampler& sampler,
+                                                        moveit::core::RobotState& work_state, ob::State* new_goal,
+                                                        bool verbose)
+{
+  // makes the constraint sampler also perform a validity callback
+  moveit::core::GroupStateValidityCallbackFn gsvcf =
+      std::bind(&ompl_interface::ConstrainedGoalSampler::stateValidityCallback, this, new_goal,
+                std::placeholders::_1,  // pointer to state
+                std::placeholders::_2,  // const* joint model group
+                std::placeholders::_3,  // double* of joint positions
+                verbose);
+  sampler.setGroupStateValidityCallback(gsvcf);
+
+  if (sampler.project(work_state, planning_context_->getMaximumStateSamplingAttempts()))
+  {
+    work_state.update();
+    if (kinematic_constraint_set_->decide(work_state, verbose).satisfied)
+      return checkStateValidity(new_goal, work_state, verbose);
+
+    const unsigned int attempts_so_far = samplingAttemptsCount() + helper_attempts_;
+    if (++invalid_sampled_constraints_ >= (attempts_so_far * 8) / 10 && !warned_invalid_samples_.exchange(true))
+      RCLCPP_WARN(LOGGER, "More than 80%% of the sampled goal states "
+                          "fail to satisfy the constraints imposed on the goal sampler. "
+                          "Is the constrained sampler working correctly?");
+  }
+  return false;
+}
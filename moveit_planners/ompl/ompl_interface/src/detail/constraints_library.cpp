@@ -36,11 +36,19 @@
 
 #include <boost/date_time/posix_time/posix_time.hpp>
 #include <boost/filesystem.hpp>
+#include <boost/iostreams/device/mapped_file.hpp>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
 #include <fstream>
+#include <functional>
+#include <memory>
+#include <mutex>
 #include <moveit/ompl_interface/detail/constrained_sampler.h>
 #include <moveit/ompl_interface/detail/constraints_library.h>
 #include <moveit/profiler/profiler.h>
 #include <ompl/tools/config/SelfConfig.h>
+#include <thread>
 #include <utility>
 
 namespace ompl_interface
@@ -99,6 +107,150 @@ void hexToMsg(const std::string& hex, T& msg)
     return;
   }
 }
+
+// Binary approximation files start with this header, followed by
+//  - state_count int32 state tags, padded to a multiple of 8 bytes,
+//  - state_count * value_count doubles, the joint values of all states,
+//  - state_count + 1 uint64 offsets into edge_count uint64 indices of connected milestones (CSR layout),
+//  - state_count + 1 uint64 offsets into motion_count uint64 triples (milestone, first state, end state) that
+//    locate the stored states of explicit motions (CSR layout).
+// Files that do not start with APPROXIMATION_FILE_MAGIC are read with ompl::base::StateStorage::load().
+const char APPROXIMATION_FILE_MAGIC[8] = { 'M', 'V', 'T', 'C', 'A', 'P', 'X', '\0' };
+const uint32_t APPROXIMATION_FILE_VERSION = 1;
+
+struct ApproximationFileHeader
+{
+  char magic[8];
+  uint32_t version;
+  uint32_t value_count;
+  uint64_t state_count;
+  uint64_t edge_count;
+  uint64_t motion_count;
+};
+static_assert(sizeof(ApproximationFileHeader) % sizeof(double) == 0, "approximation file arrays need to be aligned");
+
+unsigned int stateValueCount(const ob::StateSpacePtr& space)
+{
+  return space->as<ModelBasedStateSpace>()->getJointModelGroup()->getVariableCount();
+}
+
+bool storeApproximation(const ConstraintApproximationStateStorage& storage, const std::string& filename)
+{
+  const ob::StateSpacePtr& space = storage.getStateSpace();
+  ApproximationFileHeader header;
+  memcpy(header.magic, APPROXIMATION_FILE_MAGIC, sizeof(APPROXIMATION_FILE_MAGIC));
+  header.version = APPROXIMATION_FILE_VERSION;
+  header.value_count = stateValueCount(space);
+  header.state_count = storage.size();
+  header.edge_count = 0;
+  header.motion_count = 0;
+
+  std::vector<int32_t> tags(header.state_count + header.state_count % 2, 0);
+  std::vector<uint64_t> edge_offsets(1, 0), edges, motion_offsets(1, 0), motions;
+  for (std::size_t i = 0; i < storage.size(); ++i)
+  {
+    tags[i] = storage.getState(i)->as<ModelBasedStateSpace::StateType>()->tag;
+    const ConstrainedStateMetadata& md = storage.getMetadata(i);
+    edges.insert(edges.end(), md.first.begin(), md.first.end());
+    edge_offsets.push_back(edges.size());
+    for (const auto& motion : md.second)
+      motions.insert(motions.end(), { motion.first, motion.second.first, motion.second.second });
+    motion_offsets.push_back(motions.size() / 3);
+  }
+  header.edge_count = edges.size();
+  header.motion_count = motions.size() / 3;
+
+  std::ofstream out(filename, std::ios::binary);
+  out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  out.write(reinterpret_cast<const char*>(tags.data()), tags.size() * sizeof(int32_t));
+  for (std::size_t i = 0; i < storage.size(); ++i)
+    out.write(reinterpret_cast<const char*>(storage.getState(i)->as<ModelBasedStateSpace::StateType>()->values),
+              header.value_count * sizeof(double));
+  out.write(reinterpret_cast<const char*>(edge_offsets.data()), edge_offsets.size() * sizeof(uint64_t));
+  out.write(reinterpret_cast<const char*>(edges.data()), edges.size() * sizeof(uint64_t));
+  out.write(reinterpret_cast<const char*>(motion_offsets.data()), motion_offsets.size() * sizeof(uint64_t));
+  out.write(reinterpret_cast<const char*>(motions.data()), motions.size() * sizeof(uint64_t));
+  return out.good();
+}
+
+bool loadApproximation(ConstraintApproximationStateStorage& storage, const std::string& filename)
+{
+  boost::iostreams::mapped_file_source file(filename);
+  ApproximationFileHeader header;
+  if (file.size() < sizeof(header) || memcmp(file.data(), APPROXIMATION_FILE_MAGIC, sizeof(header.magic)) != 0)
+  {
+    file.close();
+    storage.load(filename.c_str());
+    return true;
+  }
+  memcpy(&header, file.data(), sizeof(header));
+  const ob::StateSpacePtr& space = storage.getStateSpace();
+  if (header.version != APPROXIMATION_FILE_VERSION || header.value_count != stateValueCount(space))
+  {
+    RCLCPP_ERROR(LOGGER, "Constraint approximation '%s' has version %u with %u values per state, expected version %u "
+                         "with %u values",
+                 filename.c_str(), header.version, header.value_count, APPROXIMATION_FILE_VERSION,
+                 stateValueCount(space));
+    return false;
+  }
+  const std::size_t tag_bytes = (header.state_count + header.state_count % 2) * sizeof(int32_t);
+  const std::size_t expected_size = sizeof(header) + tag_bytes +
+                                    (header.state_count * header.value_count + 2 * (header.state_count + 1) +
+                                     header.edge_count + 3 * header.motion_count) *
+                                        sizeof(uint64_t);
+  if (file.size() < expected_size)
+  {
+    RCLCPP_ERROR(LOGGER, "Constraint approximation '%s' is truncated", filename.c_str());
+    return false;
+  }
+
+  // all arrays start at 8-byte aligned offsets of the page-aligned mapping
+  const char* data = file.data() + sizeof(header);
+  const int32_t* tags = reinterpret_cast<const int32_t*>(data);
+  const double* values = reinterpret_cast<const double*>(data + tag_bytes);
+  const uint64_t* edge_offsets = reinterpret_cast<const uint64_t*>(values + header.state_count * header.value_count);
+  const uint64_t* edges = edge_offsets + header.state_count + 1;
+  const uint64_t* motion_offsets = edges + header.edge_count;
+  const uint64_t* motions = motion_offsets + header.state_count + 1;
+
+  ob::State* state = space->allocState();
+  for (std::size_t i = 0; i < header.state_count; ++i)
+  {
+    state->as<ModelBasedStateSpace::StateType>()->tag = tags[i];
+    memcpy(state->as<ModelBasedStateSpace::StateType>()->values, values + i * header.value_count,
+           header.value_count * sizeof(double));
+    storage.addState(state);
+  }
+  space->freeState(state);
+
+  for (std::size_t i = 0; i < header.state_count; ++i)
+  {
+    if (edge_offsets[i] > edge_offsets[i + 1] || edge_offsets[i + 1] > header.edge_count ||
+        motion_offsets[i] > motion_offsets[i + 1] || motion_offsets[i + 1] > header.motion_count)
+    {
+      RCLCPP_ERROR(LOGGER, "Constraint approximation '%s' has inconsistent connections", filename.c_str());
+      return false;
+    }
+    ConstrainedStateMetadata& md = storage.getMetadata(i);
+    md.first.assign(edges + edge_offsets[i], edges + edge_offsets[i + 1]);
+    for (const uint64_t* motion = motions + 3 * motion_offsets[i]; motion != motions + 3 * motion_offsets[i + 1];
+         motion += 3)
+      md.second[motion[0]] = std::make_pair(motion[1], motion[2]);
+  }
+  return true;
+}
+
+// run worker(thread_index) on thread_count threads, one of which is the calling thread
+void runParallel(unsigned int thread_count, const std::function<void(unsigned int)>& worker)
+{
+  std::vector<std::thread> threads;
+  threads.reserve(thread_count - 1);
+  for (unsigned int t = 1; t < thread_count; ++t)
+    threads.emplace_back(worker, t);
+  worker(0);
+  for (std::thread& thread : threads)
+    thread.join();
+}
 }  // namespace
 
 class ConstraintApproximationStateSampler : public ob::StateSampler
@@ -203,6 +355,8 @@ bool interpolateUsingStoredStates(const ConstraintApproximationStateStorage* sta
 
 ompl_interface::InterpolationFunction ompl_interface::ConstraintApproximation::getInterpolationFunction() const
 {
+  if (!loadStateStorage())
+    return InterpolationFunction();
   if (explicit_motions_ && milestones_ > 0 && milestones_ < state_storage_->size())
     return std::bind(&interpolateUsingStoredStates, state_storage_, std::placeholders::_1, std::placeholders::_2,
                      std::placeholders::_3, std::placeholders::_4);
@@ -241,10 +395,71 @@ ompl_interface::ConstraintApproximation::ConstraintApproximation(
     milestones_ = state_storage_->size();
 }
 
+ompl_interface::ConstraintApproximation::ConstraintApproximation(
+    std::string group, std::string state_space_parameterization, bool explicit_motions,
+    moveit_msgs::msg::Constraints msg, std::string filename, const ompl::base::StateSpacePtr& space, std::string path,
+    std::size_t milestones)
+  : group_(std::move(group))
+  , state_space_parameterization_(std::move(state_space_parameterization))
+  , explicit_motions_(explicit_motions)
+  , constraint_msg_(std::move(msg))
+  , ompldb_filename_(std::move(filename))
+  , state_storage_ptr_(new ConstraintApproximationStateStorage(space))
+  , milestones_(milestones)
+  , load_path_(std::move(path))
+{
+  state_storage_ = static_cast<ConstraintApproximationStateStorage*>(state_storage_ptr_.get());
+  space->computeSignature(space_signature_);
+}
+
+ompl_interface::ConstraintApproximationStateStorage*
+ompl_interface::ConstraintApproximation::loadStateStorage() const
+{
+  std::lock_guard<std::mutex> slock(load_lock_);
+  if (!load_path_.empty())
+  {
+    bool success = false;
+    try
+    {
+      success = loadApproximation(*state_storage_, load_path_);
+    }
+    catch (const std::exception& e)
+    {
+      RCLCPP_ERROR(LOGGER, "Unable to read constraint approximation from '%s': %s", load_path_.c_str(), e.what());
+    }
+    if (success)
+    {
+      if (milestones_ == 0)
+        milestones_ = state_storage_->size();
+      std::size_t sum = 0;
+      for (std::size_t i = 0; i < state_storage_->size(); ++i)
+        sum += state_storage_->getMetadata(i).first.size();
+      RCLCPP_INFO(LOGGER,
+                  "Loaded %lu states (%lu milestones) and %lu connections (%0.1lf per state) "
+                  "for constraint named '%s'%s",
+                  state_storage_->size(), milestones_, sum, milestones_ > 0 ? (double)sum / (double)milestones_ : 0.0,
+                  constraint_msg_.name.c_str(), explicit_motions_ ? ". Explicit motions included." : "");
+    }
+    else
+    {
+      state_storage_ptr_.reset();
+      state_storage_ = nullptr;
+    }
+    load_path_.clear();
+  }
+  return state_storage_;
+}
+
+const ompl::base::StateStoragePtr& ompl_interface::ConstraintApproximation::getStateStorage() const
+{
+  loadStateStorage();
+  return state_storage_ptr_;
+}
+
 ompl::base::StateSamplerAllocator
 ompl_interface::ConstraintApproximation::getStateSamplerAllocator(const moveit_msgs::msg::Constraints& /*unused*/) const
 {
-  if (state_storage_->size() == 0)
+  if (!loadStateStorage() || state_storage_->size() == 0)
     return ompl::base::StateSamplerAllocator();
   return std::bind(&allocConstraintApproximationStateSampler, std::placeholders::_1, space_signature_, state_storage_,
                    milestones_);
@@ -337,26 +552,25 @@ void ompl_interface::ConstraintsLibrary::loadConstraintApproximations(const std:
       continue;
     }
 
-    RCLCPP_INFO(LOGGER, "Loading constraint approximation of type '%s' for group '%s' from '%s'...",
+    // the states are only read once a planning request uses this approximation, so at least check they are there
+    const std::string states_path = std::string{ path }.append("/").append(filename);
+    if (!boost::filesystem::is_regular_file(states_path))
+    {
+      RCLCPP_ERROR(LOGGER, "Ignoring constraint approximation from '%s', the file is missing", states_path.c_str());
+      continue;
+    }
+
+    RCLCPP_INFO(LOGGER, "Registering constraint approximation of type '%s' for group '%s' from '%s'...",
                 state_space_parameterization.c_str(), group.c_str(), filename.c_str());
     moveit_msgs::msg::Constraints msg;
     hexToMsg(serialization, msg);
-    auto* cass = new ConstraintApproximationStateStorage(context_->getOMPLSimpleSetup()->getStateSpace());
-    cass->load((std::string{ path }.append("/").append(filename)).c_str());
     ConstraintApproximationPtr cap(new ConstraintApproximation(group, state_space_parameterization, explicit_motions,
-                                                               msg, filename, ompl::base::StateStoragePtr(cass),
-                                                               milestones));
+                                                               msg, filename,
+                                                               context_->getOMPLSimpleSetup()->getStateSpace(),
+                                                               states_path, milestones));
     if (constraint_approximations_.find(cap->getName()) != constraint_approximations_.end())
       RCLCPP_WARN(LOGGER, "Overwriting constraint approximation named '%s'", cap->getName().c_str());
     constraint_approximations_[cap->getName()] = cap;
-    std::size_t sum = 0;
-    for (std::size_t i = 0; i < cass->size(); ++i)
-      sum += cass->getMetadata(i).first.size();
-    RCLCPP_INFO(LOGGER,
-                "Loaded %lu states (%lu milestones) and %lu connections (%0.1lf per state) "
-                "for constraint named '%s'%s",
-                cass->size(), cap->getMilestoneCount(), sum, (double)sum / (double)cap->getMilestoneCount(),
-                msg.name.c_str(), explicit_motions ? ". Explicit motions included." : "");
   }
   RCLCPP_INFO(LOGGER, "Done loading constrained space approximations.");
 }
@@ -378,6 +592,15 @@ void ompl_interface::ConstraintsLibrary::saveConstraintApproximations(const std:
     for (std::map<std::string, ConstraintApproximationPtr>::const_iterator it = constraint_approximations_.begin();
          it != constraint_approximations_.end(); ++it)
     {
+      // an approximation whose states could not be read is left out, the manifest must not refer to missing files
+      const ompl::base::StateStoragePtr& storage = it->second->getStateStorage();
+      if (!storage || !storeApproximation(static_cast<const ConstraintApproximationStateStorage&>(*storage),
+                                          path + "/" + it->second->getFilename()))
+      {
+        RCLCPP_ERROR(LOGGER, "Unable to save the states of constraint approximation '%s'",
+                     it->second->getName().c_str());
+        continue;
+      }
       fout << it->second->getGroup() << std::endl;
       fout << it->second->getStateSpaceParameterization() << std::endl;
       fout << it->second->hasExplicitMotions() << std::endl;
@@ -386,8 +609,6 @@ void ompl_interface::ConstraintsLibrary::saveConstraintApproximations(const std:
       msgToHex(it->second->getConstraintsMsg(), serialization);
       fout << serialization << std::endl;
       fout << it->second->getFilename() << std::endl;
-      if (it->second->getStateStorage())
-        it->second->getStateStorage()->store((path + "/" + it->second->getFilename()).c_str());
     }
   else
     RCLCPP_ERROR(LOGGER, "Unable to save constraint approximation to '%s'", path.c_str());
@@ -485,14 +706,18 @@ ompl::base::StateStoragePtr ompl_interface::ConstraintsLibrary::constructConstra
   ConstraintApproximationStateStorage* cass = new ConstraintApproximationStateStorage(pcontext->getOMPLStateSpace());
   ob::StateStoragePtr state_storage(cass);
 
-  // construct a sampler for the sampling constraints
-  kinematic_constraints::KinematicConstraintSet kset(pcontext->getRobotModel());
-  moveit::core::Transforms no_transforms(pcontext->getRobotModel()->getModelFrame());
-  kset.add(constr_hard, no_transforms);
-
-  const moveit::core::RobotState& default_state = pcontext->getCompleteInitialRobotState();
+  const unsigned int thread_count =
+      options.threads > 0 ? options.threads : std::max(1u, std::thread::hardware_concurrency());
 
-  unsigned int attempts = 0;
+  // every thread checks the hard constraints on its own robot state and constraint set
+  moveit::core::Transforms no_transforms(pcontext->getRobotModel()->getModelFrame());
+  std::vector<std::unique_ptr<kinematic_constraints::KinematicConstraintSet> > ksets(thread_count);
+  for (auto& kset : ksets)
+  {
+    kset = std::make_unique<kinematic_constraints::KinematicConstraintSet>(pcontext->getRobotModel());
+    kset->add(constr_hard, no_transforms);
+  }
+  std::vector<moveit::core::RobotState> robot_states(thread_count, pcontext->getCompleteInitialRobotState());
 
   double bounds_val = std::numeric_limits<double>::max() / 2.0 - 1.0;
   pcontext->getOMPLStateSpace()->setPlanningVolume(-bounds_val, bounds_val, -bounds_val, bounds_val, -bounds_val,
@@ -501,148 +726,221 @@ ompl::base::StateStoragePtr ompl_interface::ConstraintsLibrary::constructConstra
 
   // construct the constrained states
 
-  moveit::core::RobotState robot_state(default_state);
+  // constraint samplers may call the IK solver of the group, which is shared by all sampling threads
+  unsigned int sampling_thread_count = thread_count;
   const constraint_samplers::ConstraintSamplerManagerPtr& csmng = pcontext->getConstraintSamplerManager();
-  ConstrainedSampler* constrained_sampler = nullptr;
-  if (csmng)
+  const kinematics::KinematicsBaseConstPtr solver = pcontext->getJointModelGroup()->getSolverInstance();
+  if (csmng && solver && !solver->supportsConcurrentQueries() && sampling_thread_count > 1)
   {
-    constraint_samplers::ConstraintSamplerPtr constraint_sampler =
-        csmng->selectSampler(pcontext->getPlanningScene(), pcontext->getJointModelGroup()->getName(), constr_sampling);
-    if (constraint_sampler)
-      constrained_sampler = new ConstrainedSampler(pcontext, constraint_sampler);
+    RCLCPP_INFO(LOGGER, "The IK solver of group '%s' does not support concurrent queries, sampling states on one thread",
+                pcontext->getJointModelGroup()->getName().c_str());
+    sampling_thread_count = 1;
   }
 
-  ob::StateSamplerPtr ss(constrained_sampler ? ob::StateSamplerPtr(constrained_sampler) :
-                                               pcontext->getOMPLStateSpace()->allocDefaultStateSampler());
-
-  ompl::base::ScopedState<> temp(pcontext->getOMPLStateSpace());
-  int done = -1;
-  bool slow_warn = false;
-  ompl::time::point start = ompl::time::now();
-  while (state_storage->size() < options.samples)
+  std::vector<ob::StateSamplerPtr> samplers(sampling_thread_count);
+  std::vector<ConstrainedSampler*> constrained_samplers(sampling_thread_count, nullptr);
+  for (unsigned int t = 0; t < sampling_thread_count; ++t)
   {
-    ++attempts;
-    int done_now = 100 * state_storage->size() / options.samples;
-    if (done != done_now)
+    if (csmng)
     {
-      done = done_now;
-      RCLCPP_INFO(LOGGER, "%d%% complete (kept %0.1lf%% sampled states)", done,
-                  100.0 * (double)state_storage->size() / (double)attempts);
-    }
-
-    if (!slow_warn && attempts > 10 && attempts > state_storage->size() * 100)
-    {
-      slow_warn = true;
-      RCLCPP_WARN(LOGGER, "Computation of valid state database is very slow...");
+      constraint_samplers::ConstraintSamplerPtr constraint_sampler = csmng->selectSampler(
+          pcontext->getPlanningScene(), pcontext->getJointModelGroup()->getName(), constr_sampling);
+      if (constraint_sampler)
+        constrained_samplers[t] = new ConstrainedSampler(pcontext, constraint_sampler);
     }
+    samplers[t] = constrained_samplers[t] ? ob::StateSamplerPtr(constrained_samplers[t]) :
+                                            pcontext->getOMPLStateSpace()->allocDefaultStateSampler();
+  }
 
-    if (attempts > options.samples && state_storage->size() == 0)
+  // the state storage and the progress counters below are guarded by this mutex
+  std::mutex storage_lock;
+  std::atomic<std::size_t> attempts(0);
+  std::atomic<bool> sampling_failed(false);
+  int done = -1;
+  bool slow_warn = false;
+  ompl::time::point start = ompl::time::now();
+  runParallel(sampling_thread_count, [&](unsigned int t) {
+    ompl::base::ScopedState<> temp(pcontext->getOMPLStateSpace());
+    moveit::core::RobotState& robot_state = robot_states[t];
+    while (!sampling_failed)
     {
-      RCLCPP_ERROR(LOGGER, "Unable to generate any samples");
-      break;
-    }
+      {
+        std::lock_guard<std::mutex> slock(storage_lock);
+        if (state_storage->size() >= options.samples)
+          break;
+      }
+      std::size_t attempt = ++attempts;
+      samplers[t]->sampleUniform(temp.get());
+      pcontext->getOMPLStateSpace()->copyToRobotState(robot_state, temp.get());
+      bool satisfied = ksets[t]->decide(robot_state).satisfied;
 
-    ss->sampleUniform(temp.get());
-    pcontext->getOMPLStateSpace()->copyToRobotState(robot_state, temp.get());
-    if (kset.decide(robot_state).satisfied)
-    {
-      if (state_storage->size() < options.samples)
+      std::lock_guard<std::mutex> slock(storage_lock);
+      if (satisfied && state_storage->size() < options.samples)
       {
         temp->as<ModelBasedStateSpace::StateType>()->tag = state_storage->size();
         state_storage->addState(temp.get());
       }
+
+      int done_now = 100 * state_storage->size() / options.samples;
+      if (done != done_now)
+      {
+        done = done_now;
+        double elapsed = ompl::time::seconds(ompl::time::now() - start);
+        RCLCPP_INFO(LOGGER, "%d%% complete (kept %0.1lf%% sampled states, %0.1lf states/s)", done,
+                    100.0 * (double)state_storage->size() / (double)attempt,
+                    elapsed > 0.0 ? (double)state_storage->size() / elapsed : 0.0);
+      }
+
+      if (!slow_warn && attempt > 10 && attempt > state_storage->size() * 100)
+      {
+        slow_warn = true;
+        RCLCPP_WARN(LOGGER, "Computation of valid state database is very slow...");
+      }
+
+      if (attempt > options.samples && state_storage->size() == 0)
+      {
+        if (!sampling_failed)
+          RCLCPP_ERROR(LOGGER, "Unable to generate any samples");
+        sampling_failed = true;
+      }
     }
-  }
+  });
 
   result.state_sampling_time = ompl::time::seconds(ompl::time::now() - start);
-  RCLCPP_INFO(LOGGER, "Generated %u states in %lf seconds", (unsigned int)state_storage->size(),
-              result.state_sampling_time);
-  if (constrained_sampler)
+  RCLCPP_INFO(LOGGER, "Generated %u states in %lf seconds on %u threads (kept %0.1lf%% of %lu sampled states)",
+              (unsigned int)state_storage->size(), result.state_sampling_time, sampling_thread_count,
+              attempts > 0 ? 100.0 * (double)state_storage->size() / (double)attempts : 0.0,
+              (unsigned long)attempts);
+  if (constrained_samplers[0])
   {
-    result.sampling_success_rate = constrained_sampler->getConstrainedSamplingRate();
+    result.sampling_success_rate = 0.0;
+    for (const ConstrainedSampler* constrained_sampler : constrained_samplers)
+      result.sampling_success_rate += constrained_sampler->getConstrainedSamplingRate();
+    result.sampling_success_rate /= sampling_thread_count;
     RCLCPP_INFO(LOGGER, "Constrained sampling rate: %lf", result.sampling_success_rate);
   }
 
   result.milestones = state_storage->size();
   if (options.edges_per_sample > 0)
   {
-    RCLCPP_INFO(LOGGER, "Computing graph connections (max %u edges per sample) ...", options.edges_per_sample);
+    RCLCPP_INFO(LOGGER, "Computing graph connections (max %u edges per sample) on %u threads ...",
+                options.edges_per_sample, thread_count);
 
     // construct connections
     const ob::StateSpacePtr& space = pcontext->getOMPLSimpleSetup()->getStateSpace();
+    const ob::SpaceInformationPtr& si = pcontext->getOMPLSimpleSetup()->getSpaceInformation();
     unsigned int milestones = state_storage->size();
-    std::vector<ob::State*> int_states(options.max_explicit_points, nullptr);
-    pcontext->getOMPLSimpleSetup()->getSpaceInformation()->allocStates(int_states);
+
+    // the milestones are only read while connecting them; the intermediate states of explicit motions are
+    // collected per edge and appended to the storage once all threads are done
+    struct ExplicitMotion
+    {
+      std::size_t from;
+      std::size_t to;
+      std::vector<ob::State*> states;
+    };
+    std::vector<ExplicitMotion> motions;
 
     ompl::time::point start = ompl::time::now();
+    std::atomic<std::size_t> next_milestone(0);
+    std::atomic<std::size_t> checked_edges(0);
     int good = 0;
     int done = -1;
 
-    for (std::size_t j = 0; j < milestones; ++j)
-    {
-      int done_now = 100 * j / milestones;
-      if (done != done_now)
-      {
-        done = done_now;
-        RCLCPP_INFO(LOGGER, "%d%% complete", done);
-      }
-      if (cass->getMetadata(j).first.size() >= options.edges_per_sample)
-        continue;
-
-      const ob::State* sj = state_storage->getState(j);
+    runParallel(thread_count, [&](unsigned int t) {
+      moveit::core::RobotState& robot_state = robot_states[t];
+      std::vector<ob::State*> int_states(options.max_explicit_points, nullptr);
+      si->allocStates(int_states);
 
-      for (std::size_t i = j + 1; i < milestones; ++i)
+      for (std::size_t j = next_milestone++; j < milestones; j = next_milestone++)
       {
-        if (cass->getMetadata(i).first.size() >= options.edges_per_sample)
-          continue;
-        double d = space->distance(state_storage->getState(i), sj);
-        if (d >= options.max_edge_length)
-          continue;
-        unsigned int isteps =
-            std::min<unsigned int>(options.max_explicit_points, d / options.explicit_points_resolution);
-        double step = 1.0 / (double)isteps;
-        bool ok = true;
-        space->interpolate(state_storage->getState(i), sj, step, int_states[0]);
-        for (unsigned int k = 1; k < isteps; ++k)
         {
-          double this_step = step / (1.0 - (k - 1) * step);
-          space->interpolate(int_states[k - 1], sj, this_step, int_states[k]);
-          pcontext->getOMPLStateSpace()->copyToRobotState(robot_state, int_states[k]);
-          if (!kset.decide(robot_state).satisfied)
+          std::lock_guard<std::mutex> slock(storage_lock);
+          int done_now = 100 * j / milestones;
+          if (done != done_now)
           {
-            ok = false;
-            break;
+            done = done_now;
+            RCLCPP_INFO(LOGGER, "%d%% complete (%d connections, %lu edges checked)", done, good,
+                        (unsigned long)checked_edges);
           }
+          if (cass->getMetadata(j).first.size() >= options.edges_per_sample)
+            continue;
         }
 
-        if (ok)
-        {
-          cass->getMetadata(i).first.push_back(j);
-          cass->getMetadata(j).first.push_back(i);
+        const ob::State* sj = state_storage->getState(j);
 
-          if (options.explicit_motions)
+        for (std::size_t i = j + 1; i < milestones; ++i)
+        {
           {
-            cass->getMetadata(i).second[j].first = state_storage->size();
-            for (unsigned int k = 0; k < isteps; ++k)
+            std::lock_guard<std::mutex> slock(storage_lock);
+            if (cass->getMetadata(i).first.size() >= options.edges_per_sample)
+              continue;
+          }
+          double d = space->distance(state_storage->getState(i), sj);
+          if (d >= options.max_edge_length)
+            continue;
+          ++checked_edges;
+          unsigned int isteps =
+              std::min<unsigned int>(options.max_explicit_points, d / options.explicit_points_resolution);
+          double step = 1.0 / (double)isteps;
+          bool ok = true;
+          space->interpolate(state_storage->getState(i), sj, step, int_states[0]);
+          for (unsigned int k = 1; k < isteps; ++k)
+          {
+            double this_step = step / (1.0 - (k - 1) * step);
+            space->interpolate(int_states[k - 1], sj, this_step, int_states[k]);
+            pcontext->getOMPLStateSpace()->copyToRobotState(robot_state, int_states[k]);
+            if (!ksets[t]->decide(robot_state).satisfied)
             {
-              int_states[k]->as<ModelBasedStateSpace::StateType>()->tag = -1;
-              state_storage->addState(int_states[k]);
+              ok = false;
+              break;
             }
-            cass->getMetadata(i).second[j].second = state_storage->size();
-            cass->getMetadata(j).second[i] = cass->getMetadata(i).second[j];
           }
 
-          good++;
-          if (cass->getMetadata(j).first.size() >= options.edges_per_sample)
-            break;
+          if (ok)
+          {
+            std::lock_guard<std::mutex> slock(storage_lock);
+            // other threads may have connected i or j in the meantime
+            if (cass->getMetadata(j).first.size() >= options.edges_per_sample)
+              break;
+            if (cass->getMetadata(i).first.size() >= options.edges_per_sample)
+              continue;
+            cass->getMetadata(i).first.push_back(j);
+            cass->getMetadata(j).first.push_back(i);
+
+            if (options.explicit_motions)
+            {
+              motions.push_back(ExplicitMotion{ i, j, std::vector<ob::State*>(isteps) });
+              for (unsigned int k = 0; k < isteps; ++k)
+                motions.back().states[k] = space->cloneState(int_states[k]);
+            }
+
+            good++;
+            if (cass->getMetadata(j).first.size() >= options.edges_per_sample)
+              break;
+          }
         }
       }
+      si->freeStates(int_states);
+    });
+
+    for (ExplicitMotion& motion : motions)
+    {
+      std::pair<std::size_t, std::size_t>& istates = cass->getMetadata(motion.from).second[motion.to];
+      istates.first = state_storage->size();
+      for (ob::State* state : motion.states)
+      {
+        state->as<ModelBasedStateSpace::StateType>()->tag = -1;
+        state_storage->addState(state);
+        space->freeState(state);
+      }
+      istates.second = state_storage->size();
+      cass->getMetadata(motion.to).second[motion.from] = istates;
     }
 
     result.state_connection_time = ompl::time::seconds(ompl::time::now() - start);
-    RCLCPP_INFO(LOGGER, "Computed possible connexions in %lf seconds. Added %d connexions",
-                result.state_connection_time, good);
-    pcontext->getOMPLSimpleSetup()->getSpaceInformation()->freeStates(int_states);
+    RCLCPP_INFO(LOGGER, "Computed possible connexions in %lf seconds. Added %d connexions (%lu edges checked)",
+                result.state_connection_time, good, (unsigned long)checked_edges);
 
     return state_storage;
   }
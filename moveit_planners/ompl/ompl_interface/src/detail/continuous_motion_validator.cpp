@@ -0,0 +1,120 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, PickNik LLC
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik LLC nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include <moveit/ompl_interface/detail/continuous_motion_validator.h>
+#include <moveit/ompl_interface/model_based_planning_context.h>
+#include <algorithm>
+
+ompl_interface::ContinuousMotionValidator::ContinuousMotionValidator(const ModelBasedPlanningContext* pc)
+  : ompl::base::MotionValidator(pc->getOMPLSimpleSetup()->getSpaceInformation())
+  , planning_context_(pc)
+  , tss_from_(pc->getCompleteInitialRobotState())
+  , tss_to_(pc->getCompleteInitialRobotState())
+{
+}
+
+bool ompl_interface::ContinuousMotionValidator::checkMotion(const ompl::base::State* s1,
+                                                            const ompl::base::State* s2) const
+{
+  // assume motion starts in a valid configuration so s1 is valid, and reject early with the end state
+  double last_valid_fraction;
+  const bool result = si_->isValid(s2) && checkMotionFrom(s1, s2, false, last_valid_fraction);
+  if (result)
+    valid_++;
+  else
+    invalid_++;
+  return result;
+}
+
+bool ompl_interface::ContinuousMotionValidator::checkMotion(const ompl::base::State* s1, const ompl::base::State* s2,
+                                                            std::pair<ompl::base::State*, double>& last_valid) const
+{
+  double last_valid_fraction;
+  const bool result = checkMotionFrom(s1, s2, true, last_valid_fraction);
+  if (result)
+    valid_++;
+  else
+  {
+    if (last_valid.first)
+      si_->getStateSpace()->interpolate(s1, s2, last_valid_fraction, last_valid.first);
+    last_valid.second = last_valid_fraction;
+    invalid_++;
+  }
+  return result;
+}
+
+bool ompl_interface::ContinuousMotionValidator::checkMotionFrom(const ompl::base::State* s1,
+                                                                const ompl::base::State* s2, bool check_end,
+                                                                double& last_valid_fraction) const
+{
+  const ompl::base::StateSpacePtr& state_space = si_->getStateSpace();
+  const ModelBasedStateSpacePtr& model_state_space = planning_context_->getOMPLStateSpace();
+  const planning_scene::PlanningSceneConstPtr& scene = planning_context_->getPlanningScene();
+  const unsigned int segments = std::max(1u, state_space->validSegmentCount(s1, s2));
+  moveit::core::RobotState* from = tss_from_.getStateStorage();
+  moveit::core::RobotState* to = tss_to_.getStateStorage();
+  model_state_space->copyToRobotState(*from, s1);
+  from->updateCollisionBodyTransforms();
+
+  ompl::base::State* state = si_->allocState();
+  bool result = true;
+  last_valid_fraction = 0.0;
+  for (unsigned int i = 1; i <= segments; ++i)
+  {
+    const double t = static_cast<double>(i) / segments;
+    const ompl::base::State* current = s2;
+    if (i < segments)
+    {
+      state_space->interpolate(s1, s2, t, state);
+      current = state;
+    }
+
+    if ((current != s2 || check_end) && !si_->isValid(current))
+    {
+      result = false;
+      break;
+    }
+    model_state_space->copyToRobotState(*to, current);
+    to->updateCollisionBodyTransforms();
+    if (scene->isMotionColliding(*from, *to, planning_context_->getGroupName()))
+    {
+      result = false;
+      break;
+    }
+    last_valid_fraction = t;
+    std::swap(from, to);
+  }
+  si_->freeState(state);
+  return result;
+}
@@ -0,0 +1,209 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, PickNik LLC
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik LLC nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include <moveit/ompl_interface/detail/experience_database.h>
+#include <boost/functional/hash.hpp>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+
+namespace ompl_interface
+{
+static const rclcpp::Logger LOGGER = rclcpp::get_logger("moveit.ompl_planning.experience_database");
+
+namespace
+{
+// poses are hashed at this resolution, so numerically identical layouts map to the same hash
+const double POSE_HASH_RESOLUTION = 1e-3;
+
+// paths whose end points are closer than this (in the euclidean distance of the state values) are replaced
+const double DUPLICATE_ENDPOINT_DISTANCE = 1e-3;
+
+double distance(const std::vector<double>& a, const std::vector<double>& b)
+{
+  if (a.size() != b.size())
+    return std::numeric_limits<double>::infinity();
+  double d = 0.0;
+  for (std::size_t i = 0; i < a.size(); ++i)
+    d += (a[i] - b[i]) * (a[i] - b[i]);
+  return std::sqrt(d);
+}
+
+void hashShapes(const std::vector<shapes::ShapeConstPtr>& shapes, const EigenSTL::vector_Isometry3d& poses,
+                std::size_t& seed)
+{
+  for (std::size_t i = 0; i < shapes.size(); ++i)
+  {
+    boost::hash_combine(seed, static_cast<int>(shapes[i]->type));
+    const Eigen::Quaterniond rotation(poses[i].linear());
+    for (double value : { poses[i].translation().x(), poses[i].translation().y(), poses[i].translation().z(),
+                          rotation.x(), rotation.y(), rotation.z(), rotation.w() })
+      boost::hash_combine(seed, std::lround(value / POSE_HASH_RESOLUTION));
+  }
+}
+}  // namespace
+
+ExperienceDatabase::ExperienceDatabase(std::size_t max_experiences) : max_experiences_(max_experiences)
+{
+}
+
+void ExperienceDatabase::addPath(const std::string& group_name, std::size_t scene_hash, const Waypoints& waypoints)
+{
+  if (waypoints.size() < 2)
+    return;
+
+  std::unique_lock<std::mutex> slock(lock_);
+  for (auto it = experiences_.begin(); it != experiences_.end(); ++it)
+    if (it->scene_hash_ == scene_hash && it->group_name_ == group_name &&
+        distance(it->waypoints_.front(), waypoints.front()) < DUPLICATE_ENDPOINT_DISTANCE &&
+        distance(it->waypoints_.back(), waypoints.back()) < DUPLICATE_ENDPOINT_DISTANCE)
+    {
+      experiences_.erase(it);
+      break;
+    }
+  experiences_.push_front(Experience{ group_name, scene_hash, waypoints });
+  if (experiences_.size() > max_experiences_)
+    experiences_.pop_back();
+}
+
+std::vector<ExperienceDatabase::Experience> ExperienceDatabase::getExperiences(const std::string& group_name,
+                                                                               std::size_t scene_hash) const
+{
+  std::vector<Experience> result;
+  std::unique_lock<std::mutex> slock(lock_);
+  for (const Experience& experience : experiences_)
+    if (experience.scene_hash_ == scene_hash && experience.group_name_ == group_name)
+      result.push_back(experience);
+  return result;
+}
+
+std::size_t ExperienceDatabase::getExperienceCount() const
+{
+  std::unique_lock<std::mutex> slock(lock_);
+  return experiences_.size();
+}
+
+void ExperienceDatabase::clear()
+{
+  std::unique_lock<std::mutex> slock(lock_);
+  experiences_.clear();
+}
+
+bool ExperienceDatabase::save(const std::string& filename) const
+{
+  std::ofstream out(filename.c_str());
+  if (!out.good())
+  {
+    RCLCPP_ERROR(LOGGER, "Unable to save experiences to '%s'", filename.c_str());
+    return false;
+  }
+
+  std::unique_lock<std::mutex> slock(lock_);
+  out << "experiences " << experiences_.size() << std::endl;
+  out << std::setprecision(std::numeric_limits<double>::max_digits10);
+  for (const Experience& experience : experiences_)
+  {
+    out << experience.group_name_ << " " << experience.scene_hash_ << " " << experience.waypoints_.size() << " "
+        << experience.waypoints_.front().size() << std::endl;
+    for (const std::vector<double>& waypoint : experience.waypoints_)
+    {
+      for (std::size_t i = 0; i < waypoint.size(); ++i)
+        out << (i == 0 ? "" : " ") << waypoint[i];
+      out << std::endl;
+    }
+  }
+  RCLCPP_INFO(LOGGER, "Saved %zu experiences to '%s'", experiences_.size(), filename.c_str());
+  return out.good();
+}
+
+bool ExperienceDatabase::load(const std::string& filename)
+{
+  std::ifstream in(filename.c_str());
+  std::string header;
+  std::size_t count;
+  if (!(in >> header >> count) || header != "experiences")
+  {
+    RCLCPP_WARN(LOGGER, "Unable to load experiences from '%s'", filename.c_str());
+    return false;
+  }
+
+  std::list<Experience> experiences;
+  for (std::size_t k = 0; k < count; ++k)
+  {
+    Experience experience;
+    std::size_t waypoint_count, dimension;
+    if (!(in >> experience.group_name_ >> experience.scene_hash_ >> waypoint_count >> dimension))
+    {
+      RCLCPP_ERROR(LOGGER, "Experience %zu in '%s' is malformed", k, filename.c_str());
+      return false;
+    }
+    experience.waypoints_.resize(waypoint_count, std::vector<double>(dimension));
+    for (std::vector<double>& waypoint : experience.waypoints_)
+      for (double& value : waypoint)
+        if (!(in >> value))
+        {
+          RCLCPP_ERROR(LOGGER, "Experience %zu in '%s' is malformed", k, filename.c_str());
+          return false;
+        }
+    if (experiences.size() < max_experiences_ && waypoint_count >= 2)
+      experiences.push_back(std::move(experience));
+  }
+
+  std::unique_lock<std::mutex> slock(lock_);
+  experiences_.swap(experiences);
+  RCLCPP_INFO(LOGGER, "Loaded %zu experiences from '%s'", experiences_.size(), filename.c_str());
+  return true;
+}
+
+std::size_t ExperienceDatabase::computeSceneHash(const planning_scene::PlanningScene& planning_scene)
+{
+  std::size_t seed = 0;
+  for (const auto& object : *planning_scene.getWorld())
+  {
+    boost::hash_combine(seed, object.first);
+    hashShapes(object.second->shapes_, object.second->shape_poses_, seed);
+  }
+
+  std::vector<const moveit::core::AttachedBody*> attached_bodies;
+  planning_scene.getCurrentState().getAttachedBodies(attached_bodies);
+  for (const moveit::core::AttachedBody* attached_body : attached_bodies)
+  {
+    boost::hash_combine(seed, attached_body->getName());
+    boost::hash_combine(seed, attached_body->getAttachedLinkName());
+    hashShapes(attached_body->getShapes(), attached_body->getFixedTransforms(), seed);
+  }
+  return seed;
+}
+}  // namespace ompl_interface
@@ -0,0 +1,151 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, PickNik LLC
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik LLC nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include <moveit/ompl_interface/detail/experience_retrieve_repair.h>
+#include <ompl/geometric/planners/rrt/RRTConnect.h>
+#include <algorithm>
+#include <utility>
+
+namespace ompl_interface
+{
+static const rclcpp::Logger LOGGER = rclcpp::get_logger("moveit.ompl_planning.experience_retrieve_repair");
+
+ExperienceRetrieveRepair::ExperienceRetrieveRepair(const ob::SpaceInformationPtr& si,
+                                                   ExperienceDatabaseConstPtr experience_database,
+                                                   std::string group_name, std::size_t scene_hash,
+                                                   GoalCheckFn goal_check)
+  : ob::Planner(si, "ExperienceRetrieveRepair")
+  , experience_database_(std::move(experience_database))
+  , group_name_(std::move(group_name))
+  , scene_hash_(scene_hash)
+  , goal_check_(std::move(goal_check))
+  , max_candidates_(5)
+{
+}
+
+ob::PlannerStatus ExperienceRetrieveRepair::solve(const ob::PlannerTerminationCondition& ptc)
+{
+  checkValidity();
+  const ob::State* start = pis_.nextStart();
+  if (!start)
+  {
+    RCLCPP_ERROR(LOGGER, "%s: No valid start state", getName().c_str());
+    return ob::PlannerStatus::INVALID_START;
+  }
+
+  const std::vector<ExperienceDatabase::Experience> experiences =
+      experience_database_->getExperiences(group_name_, scene_hash_);
+  const ob::StateSpacePtr& space = si_->getStateSpace();
+  const std::size_t dimension = space->getValueLocations().size();
+
+  // rank the paths that end in the goal by the distance of their first state to the start
+  std::vector<std::pair<double, std::size_t> > candidates;
+  ob::State* state = si_->allocState();
+  for (std::size_t i = 0; i < experiences.size(); ++i)
+  {
+    const ExperienceDatabase::Waypoints& waypoints = experiences[i].waypoints_;
+    if (waypoints.front().size() != dimension)
+      continue;
+    space->copyFromReals(state, waypoints.back());
+    if (!goal_check_(state))
+      continue;
+    space->copyFromReals(state, waypoints.front());
+    candidates.emplace_back(si_->distance(start, state), i);
+  }
+  si_->freeState(state);
+  std::sort(candidates.begin(), candidates.end());
+  RCLCPP_DEBUG(LOGGER, "%s: %zu of %zu stored paths reach the goal", getName().c_str(), candidates.size(),
+               experiences.size());
+
+  for (std::size_t k = 0; k < candidates.size() && k < max_candidates_ && !ptc; ++k)
+  {
+    auto path = std::make_shared<og::PathGeometric>(si_, start);
+    if (repairPath(experiences[candidates[k].second].waypoints_, *path, ptc))
+    {
+      RCLCPP_DEBUG(LOGGER, "%s: Reusing stored path %zu with %zu states", getName().c_str(), k,
+                   path->getStateCount());
+      pdef_->addSolutionPath(path, false, 0.0, getName());
+      return ob::PlannerStatus::EXACT_SOLUTION;
+    }
+  }
+  return ob::PlannerStatus::TIMEOUT;
+}
+
+bool ExperienceRetrieveRepair::repairPath(const ExperienceDatabase::Waypoints& waypoints, og::PathGeometric& path,
+                                          const ob::PlannerTerminationCondition& ptc)
+{
+  ob::State* state = si_->allocState();
+  bool repaired = true;
+  for (std::size_t i = 0; i < waypoints.size() && repaired; ++i)
+  {
+    if (ptc)
+    {
+      repaired = false;
+      break;
+    }
+    si_->getStateSpace()->copyFromReals(state, waypoints[i]);
+
+    // invalid intermediate states are dropped and the motion around them is planned again; the last state is the
+    // one known to satisfy the goal, so it has to be kept
+    if (!si_->isValid(state))
+    {
+      repaired = i + 1 < waypoints.size();
+      continue;
+    }
+    if (si_->checkMotion(path.getState(path.getStateCount() - 1), state))
+      path.append(state);
+    else
+      repaired = repairSegment(state, path, ptc);
+  }
+  si_->freeState(state);
+  return repaired;
+}
+
+bool ExperienceRetrieveRepair::repairSegment(const ob::State* state, og::PathGeometric& path,
+                                             const ob::PlannerTerminationCondition& ptc)
+{
+  auto pdef = std::make_shared<ob::ProblemDefinition>(si_);
+  pdef->setStartAndGoalStates(path.getState(path.getStateCount() - 1), state);
+  og::RRTConnect planner(si_);
+  planner.setProblemDefinition(pdef);
+  planner.setup();
+  if (planner.solve(ptc) != ob::PlannerStatus::EXACT_SOLUTION)
+    return false;
+
+  const og::PathGeometric& segment = *pdef->getSolutionPath()->as<og::PathGeometric>();
+  for (std::size_t i = 1; i < segment.getStateCount(); ++i)
+    path.append(segment.getState(i));
+  return true;
+}
+}  // namespace ompl_interface
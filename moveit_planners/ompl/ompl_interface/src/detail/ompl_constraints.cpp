@@ -0,0 +1,283 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, PickNik LLC
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik LLC nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include <moveit/ompl_interface/detail/ompl_constraints.h>
+#include <geometric_shapes/bodies.h>
+#include <shape_msgs/msg/solid_primitive.hpp>
+#include <rclcpp/rclcpp.hpp>
+#include <algorithm>
+
+namespace ompl_interface
+{
+static const rclcpp::Logger LOGGER = rclcpp::get_logger("moveit.ompl_planning.ompl_constraints");
+
+namespace
+{
+/** \brief The offset of \e value from the interval [lower, upper], zero inside it */
+double excess(double value, double lower, double upper)
+{
+  return value - std::min(std::max(value, lower), upper);
+}
+
+/** \brief The offset of \e point from a ball of radius \e radius around the origin, zero inside it */
+Eigen::Vector3d excess(const Eigen::Vector3d& point, double radius)
+{
+  const double norm = point.norm();
+  return norm > radius ? Eigen::Vector3d(point * ((norm - radius) / norm)) : Eigen::Vector3d::Zero();
+}
+}  // namespace
+
+KinematicConstraintManifold::KinematicConstraintManifold(const moveit::core::JointModelGroup* jmg,
+                                                         const moveit_msgs::msg::Constraints& constraints)
+  : ompl::base::Constraint(jmg->getVariableCount(), getRowCount(jmg, constraints)), jmg_(jmg)
+{
+}
+
+unsigned int KinematicConstraintManifold::getRowCount(const moveit::core::JointModelGroup* jmg,
+                                                      const moveit_msgs::msg::Constraints& constraints)
+{
+  if (!jmg->isChain() || !constraints.visibility_constraints.empty())
+    return 0;
+
+  // the ambient space is euclidean, with one dimension per variable
+  for (const moveit::core::JointModel* joint_model : jmg->getActiveJointModels())
+  {
+    if (joint_model->getType() == moveit::core::JointModel::PRISMATIC)
+      continue;
+    if (joint_model->getType() != moveit::core::JointModel::REVOLUTE ||
+        static_cast<const moveit::core::RevoluteJointModel*>(joint_model)->isContinuous())
+      return 0;
+  }
+
+  for (const moveit_msgs::msg::PositionConstraint& position_constraint : constraints.position_constraints)
+  {
+    const moveit_msgs::msg::BoundingVolume& region = position_constraint.constraint_region;
+    if (region.primitives.size() != 1 || !region.meshes.empty() ||
+        (region.primitives[0].type != shape_msgs::msg::SolidPrimitive::BOX &&
+         region.primitives[0].type != shape_msgs::msg::SolidPrimitive::SPHERE &&
+         region.primitives[0].type != shape_msgs::msg::SolidPrimitive::CYLINDER))
+      return 0;
+  }
+
+  const std::size_t rows = 3 * constraints.position_constraints.size() +
+                           3 * constraints.orientation_constraints.size() + constraints.joint_constraints.size();
+  return rows < jmg->getVariableCount() ? rows : 0;
+}
+
+void KinematicConstraintManifold::setConstraints(const kinematic_constraints::KinematicConstraintSetPtr& constraints,
+                                                 const moveit::core::RobotState& state)
+{
+  constraints_ = constraints;
+  joint_constraints_.clear();
+  joint_constraint_indices_.clear();
+  position_constraints_.clear();
+  orientation_constraints_.clear();
+  tss_ = std::make_unique<TSStateStorage>(state);
+  if (!constraints_)
+    return;
+
+  // the rows are laid out for the message the function was constructed for
+  unsigned int rows = 0;
+  for (const kinematic_constraints::KinematicConstraintPtr& constraint : constraints_->getKinematicConstraints())
+  {
+    if (constraint->getType() == kinematic_constraints::KinematicConstraint::POSITION_CONSTRAINT)
+    {
+      const auto* position_constraint = static_cast<const kinematic_constraints::PositionConstraint*>(constraint.get());
+      if (position_constraint->getConstraintRegions().size() == 1)
+      {
+        position_constraints_.push_back(position_constraint);
+        rows += 3;
+      }
+    }
+    else if (constraint->getType() == kinematic_constraints::KinematicConstraint::ORIENTATION_CONSTRAINT)
+    {
+      orientation_constraints_.push_back(
+          static_cast<const kinematic_constraints::OrientationConstraint*>(constraint.get()));
+      rows += 3;
+    }
+    else if (constraint->getType() == kinematic_constraints::KinematicConstraint::JOINT_CONSTRAINT)
+    {
+      const auto* joint_constraint = static_cast<const kinematic_constraints::JointConstraint*>(constraint.get());
+      joint_constraints_.push_back(joint_constraint);
+      // constraints on other joints cannot be changed by the projection, they are only checked for validity
+      joint_constraint_indices_.push_back(jmg_->hasJointModel(joint_constraint->getJointModel()->getName()) ?
+                                              jmg_->getVariableGroupIndex(joint_constraint->getJointVariableName()) :
+                                              -1);
+      rows += 1;
+    }
+  }
+
+  if (rows > getCoDimension())
+  {
+    RCLCPP_ERROR(LOGGER, "The path constraints need %u rows, but the constraint function of group '%s' has %u",
+                 rows, jmg_->getName().c_str(), getCoDimension());
+    joint_constraints_.clear();
+    joint_constraint_indices_.clear();
+    position_constraints_.clear();
+    orientation_constraints_.clear();
+  }
+}
+
+void KinematicConstraintManifold::function(const Eigen::Ref<const Eigen::VectorXd>& x,
+                                           Eigen::Ref<Eigen::VectorXd> out) const
+{
+  evaluate(x, out, nullptr);
+}
+
+void KinematicConstraintManifold::jacobian(const Eigen::Ref<const Eigen::VectorXd>& x,
+                                           Eigen::Ref<Eigen::MatrixXd> out) const
+{
+  Eigen::VectorXd values(getCoDimension());
+  evaluate(x, values, &out);
+}
+
+void KinematicConstraintManifold::evaluate(const Eigen::Ref<const Eigen::VectorXd>& x, Eigen::Ref<Eigen::VectorXd> out,
+                                           Eigen::Ref<Eigen::MatrixXd>* jacobian) const
+{
+  out.setZero();
+  if (jacobian)
+    jacobian->setZero();
+  if (!tss_)
+    return;
+
+  // projected states are accepted within the tolerance, so they are projected that far into the constraints
+  const double margin = 2.0 * getTolerance();
+
+  moveit::core::RobotState* state = tss_->getStateStorage();
+  state->setJointGroupPositions(jmg_, x.data());
+  state->updateLinkTransforms();
+
+  // the jacobian of the group is expressed in the frame of the parent link of the chain
+  Eigen::MatrixXd group_jacobian;
+  const moveit::core::LinkModel* root_link = jmg_->getJointModels()[0]->getParentLinkModel();
+  const Eigen::Matrix3d root_rotation =
+      root_link ? state->getGlobalLinkTransform(root_link).linear() : Eigen::Matrix3d::Identity();
+
+  unsigned int row = 0;
+  for (const kinematic_constraints::PositionConstraint* position_constraint : position_constraints_)
+  {
+    const bodies::Body* region = position_constraint->getConstraintRegions()[0].get();
+    const Eigen::Isometry3d region_pose =
+        position_constraint->mobileReferenceFrame() ?
+            state->getFrameTransform(position_constraint->getReferenceFrame()) * region->getPose() :
+            region->getPose();
+    const Eigen::Isometry3d& link_transform = state->getGlobalLinkTransform(position_constraint->getLinkModel());
+    const Eigen::Vector3d local_point = region_pose.inverse() * (link_transform * position_constraint->getLinkOffset());
+
+    const std::vector<double>& dimensions = region->getDimensions();
+    const double scale = region->getScale();
+    const double padding = region->getPadding();
+    Eigen::Vector3d offset;
+    if (region->getType() == shapes::BOX)
+    {
+      for (int i = 0; i < 3; ++i)
+      {
+        const double half_extent = std::max(dimensions[i] * scale / 2.0 + padding - margin, 0.0);
+        offset[i] = excess(local_point[i], -half_extent, half_extent);
+      }
+    }
+    else if (region->getType() == shapes::SPHERE)
+      offset = excess(local_point, std::max(dimensions[0] * scale + padding - margin, 0.0));
+    else
+    {
+      const double half_length = std::max(dimensions[1] * scale / 2.0 + padding - margin, 0.0);
+      offset.head<2>() = excess(Eigen::Vector3d(local_point.x(), local_point.y(), 0.0),
+                                std::max(dimensions[0] * scale + padding - margin, 0.0))
+                             .head<2>();
+      offset.z() = excess(local_point.z(), -half_length, half_length);
+    }
+    out.segment<3>(row) = offset;
+
+    if (jacobian && !offset.isZero())
+    {
+      state->getJacobian(jmg_, position_constraint->getLinkModel(), position_constraint->getLinkOffset(),
+                         group_jacobian);
+      const Eigen::MatrixXd point_jacobian =
+          region_pose.linear().transpose() * root_rotation * group_jacobian.topRows<3>();
+      // rows of box axes within the region do not change to first order
+      for (int i = 0; i < 3; ++i)
+        if (offset[i] != 0.0 || region->getType() != shapes::BOX)
+          jacobian->row(row + i) = point_jacobian.row(i);
+    }
+    row += 3;
+  }
+
+  for (const kinematic_constraints::OrientationConstraint* orientation_constraint : orientation_constraints_)
+  {
+    const Eigen::Matrix3d desired_rotation =
+        orientation_constraint->mobileReferenceFrame() ?
+            Eigen::Matrix3d(state->getFrameTransform(orientation_constraint->getReferenceFrame()).linear() *
+                            orientation_constraint->getDesiredRotationMatrix()) :
+            orientation_constraint->getDesiredRotationMatrix();
+    const Eigen::AngleAxisd error(desired_rotation.transpose() *
+                                  state->getGlobalLinkTransform(orientation_constraint->getLinkModel()).linear());
+    const Eigen::Vector3d rotation = error.angle() * error.axis();
+    const Eigen::Vector3d tolerance(orientation_constraint->getXAxisTolerance(),
+                                    orientation_constraint->getYAxisTolerance(),
+                                    orientation_constraint->getZAxisTolerance());
+    Eigen::Vector3d offset;
+    for (int i = 0; i < 3; ++i)
+    {
+      const double axis_tolerance = std::max(tolerance[i] - margin, 0.0);
+      offset[i] = excess(rotation[i], -axis_tolerance, axis_tolerance);
+    }
+    out.segment<3>(row) = offset;
+
+    if (jacobian && !offset.isZero())
+    {
+      state->getJacobian(jmg_, orientation_constraint->getLinkModel(), Eigen::Vector3d::Zero(), group_jacobian);
+      // the rotation vector changes with the angular velocity, to first order around the desired orientation
+      const Eigen::MatrixXd rotation_jacobian =
+          desired_rotation.transpose() * root_rotation * group_jacobian.bottomRows<3>();
+      for (int i = 0; i < 3; ++i)
+        if (offset[i] != 0.0)
+          jacobian->row(row + i) = rotation_jacobian.row(i);
+    }
+    row += 3;
+  }
+
+  for (std::size_t i = 0; i < joint_constraints_.size(); ++i, ++row)
+  {
+    const kinematic_constraints::JointConstraint* joint_constraint = joint_constraints_[i];
+    const double position = state->getVariablePosition(joint_constraint->getJointVariableName());
+    double lower = joint_constraint->getDesiredJointPosition() - joint_constraint->getJointToleranceBelow() + margin;
+    double upper = joint_constraint->getDesiredJointPosition() + joint_constraint->getJointToleranceAbove() - margin;
+    if (lower > upper)
+      lower = upper = joint_constraint->getDesiredJointPosition();
+    out[row] = joint_constraint_indices_[i] < 0 ? 0.0 : excess(position, lower, upper);
+    if (jacobian && out[row] != 0.0)
+      (*jacobian)(row, joint_constraint_indices_[i]) = 1.0;
+  }
+}
+}  // namespace ompl_interface
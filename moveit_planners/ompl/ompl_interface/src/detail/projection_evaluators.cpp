@@ -65,6 +65,15 @@ void ompl_interface::ProjectionEvaluatorLinkPose::defaultCellSizes()
 void ompl_interface::ProjectionEvaluatorLinkPose::project(const ompl::base::State* state,
                                                           OMPLProjection projection) const
 {
+  const auto* model_state = state->as<ModelBasedStateSpace::StateType>();
+  if (model_state->isLinkPositionKnown() && link_ == planning_context_->getProjectionLink())
+  {
+    projection(0) = model_state->link_position[0];
+    projection(1) = model_state->link_position[1];
+    projection(2) = model_state->link_position[2];
+    return;
+  }
+
   moveit::core::RobotState* s = tss_.getStateStorage();
   planning_context_->getOMPLStateSpace()->copyToRobotState(*s, state);
 
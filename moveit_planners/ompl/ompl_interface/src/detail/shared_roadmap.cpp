@@ -0,0 +1,169 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, PickNik LLC
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik LLC nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include <moveit/ompl_interface/detail/shared_roadmap.h>
+#include <ompl/config.h>
+#include <ompl/geometric/planners/prm/LazyPRM.h>
+#include <ompl/geometric/planners/prm/PRM.h>
+#include <utility>
+
+namespace ompl_interface
+{
+DelegatingStateValidityChecker::DelegatingStateValidityChecker(const ob::SpaceInformationPtr& si)
+  : ob::StateValidityChecker(si)
+{
+}
+
+bool DelegatingStateValidityChecker::isValid(const ob::State* state) const
+{
+  return delegate_ && delegate_->isValid(state);
+}
+
+bool DelegatingStateValidityChecker::isValid(const ob::State* state, double& dist) const
+{
+  if (!delegate_)
+  {
+    dist = 0.0;
+    return false;
+  }
+  return delegate_->isValid(state, dist);
+}
+
+double DelegatingStateValidityChecker::clearance(const ob::State* state) const
+{
+  return delegate_ ? delegate_->clearance(state) : 0.0;
+}
+
+ob::SpaceInformationPtr SharedRoadmap::createSpaceInformation(const ob::SpaceInformationPtr& si)
+{
+  auto shared_si = std::make_shared<ob::SpaceInformation>(si->getStateSpace());
+  shared_si->setStateValidityChecker(std::make_shared<DelegatingStateValidityChecker>(shared_si));
+  shared_si->setStateValidityCheckingResolution(si->getStateValidityCheckingResolution());
+  shared_si->setup();
+  return shared_si;
+}
+
+SharedRoadmap::SharedRoadmap(ob::PlannerPtr planner)
+  : planner_(std::move(planner))
+  , state_validity_checker_(std::dynamic_pointer_cast<DelegatingStateValidityChecker>(
+        planner_->getSpaceInformation()->getStateValidityChecker()))
+  , state_validity_checker_user_(nullptr)
+  , waiting_queries_(0)
+{
+}
+
+std::unique_lock<std::mutex> SharedRoadmap::lockForQuery() const
+{
+  ++waiting_queries_;
+  std::unique_lock<std::mutex> lock(lock_);
+  --waiting_queries_;
+  return lock;
+}
+
+ob::PlannerStatus SharedRoadmap::solve(const ob::PlannerTerminationCondition& ptc,
+                                       const ob::ProblemDefinitionPtr& pdef,
+                                       const ob::StateValidityCheckerPtr& state_validity_checker,
+                                       const SharedRoadmapPlanner* user)
+{
+  std::unique_lock<std::mutex> lock = lockForQuery();
+  state_validity_checker_->setDelegate(state_validity_checker);
+  state_validity_checker_user_ = user;
+  planner_->setProblemDefinition(pdef);
+  return planner_->solve(ptc);
+}
+
+void SharedRoadmap::releaseStateValidityChecker(const SharedRoadmapPlanner* user)
+{
+  std::unique_lock<std::mutex> lock = lockForQuery();
+  if (state_validity_checker_user_ != user)
+    return;
+  state_validity_checker_->setDelegate(ob::StateValidityCheckerPtr());
+  state_validity_checker_user_ = nullptr;
+}
+
+bool SharedRoadmap::expand(const ob::PlannerTerminationCondition& ptc)
+{
+  std::unique_lock<std::mutex> lock(lock_);
+  auto prm = dynamic_cast<ompl::geometric::PRM*>(planner_.get());
+  if (!prm || !state_validity_checker_->getDelegate())
+    return false;
+  prm->growRoadmap(ob::plannerOrTerminationCondition(
+      ptc, ob::PlannerTerminationCondition([this] { return waiting_queries_ > 0; })));
+  return true;
+}
+
+void SharedRoadmap::clearValidity()
+{
+// TODO: remove when ROS Melodic and older are no longer supported
+#if OMPL_VERSION_VALUE >= 1005000
+  std::unique_lock<std::mutex> lock = lockForQuery();
+  auto planner = dynamic_cast<ompl::geometric::LazyPRM*>(planner_.get());
+  if (planner != nullptr)
+    planner->clearValidity();
+#endif
+}
+
+void SharedRoadmap::getPlannerData(ob::PlannerData& data) const
+{
+  std::unique_lock<std::mutex> lock = lockForQuery();
+  planner_->getPlannerData(data);
+}
+
+SharedRoadmapPlanner::SharedRoadmapPlanner(const ob::SpaceInformationPtr& si, SharedRoadmapPtr roadmap)
+  : ob::Planner(si, roadmap->getPlanner()->getName()), roadmap_(std::move(roadmap))
+{
+  specs_ = roadmap_->getPlanner()->getSpecs();
+}
+
+SharedRoadmapPlanner::~SharedRoadmapPlanner()
+{
+  releaseStateValidityChecker();
+}
+
+ob::PlannerStatus SharedRoadmapPlanner::solve(const ob::PlannerTerminationCondition& ptc)
+{
+  checkValidity();
+  return roadmap_->solve(ptc, pdef_, si_->getStateValidityChecker(), this);
+}
+
+void SharedRoadmapPlanner::getPlannerData(ob::PlannerData& data) const
+{
+  roadmap_->getPlannerData(data);
+}
+
+void SharedRoadmapPlanner::releaseStateValidityChecker()
+{
+  roadmap_->releaseStateValidityChecker(this);
+}
+}  // namespace ompl_interface
@@ -36,12 +36,39 @@
 
 #include <moveit/ompl_interface/detail/state_validity_checker.h>
 #include <moveit/ompl_interface/model_based_planning_context.h>
+#include <moveit/collision_detection/collision_culling.h>
 #include <moveit/profiler/profiler.h>
+#include <moveit/profiler/tracing.h>
+#include <geometric_shapes/shape_operations.h>
 #include <rclcpp/rclcpp.hpp>
+#include <chrono>
 
 namespace ompl_interface
 {
 static const rclcpp::Logger LOGGER = rclcpp::get_logger("moveit.ompl_planning.state_validity_checker");
+
+namespace
+{
+// Adds the time from its construction to its destruction to a counter of nanoseconds
+class ScopedTimer
+{
+public:
+  ScopedTimer(std::atomic<std::int64_t>& time) : time_(time), start_(std::chrono::steady_clock::now())
+  {
+  }
+
+  ~ScopedTimer()
+  {
+    time_.fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start_)
+                        .count(),
+                    std::memory_order_relaxed);
+  }
+
+private:
+  std::atomic<std::int64_t>& time_;
+  std::chrono::steady_clock::time_point start_;
+};
+}  // namespace
 }  // namespace ompl_interface
 
 ompl_interface::StateValidityChecker::StateValidityChecker(const ModelBasedPlanningContext* pc)
@@ -50,6 +77,10 @@ ompl_interface::StateValidityChecker::StateValidityChecker(const ModelBasedPlann
   , group_name_(pc->getGroupName())
   , tss_(pc->getCompleteInitialRobotState())
   , verbose_(false)
+  , cache_validity_(!pc->getSpecification().constrained_state_space_)
+  , check_count_(0)
+  , check_time_(0)
+  , collision_check_time_(0)
 {
   specs_.clearanceComputationType = ompl::base::StateValidityCheckerSpecs::APPROXIMATE;
   specs_.hasValidDirectionComputation = false;
@@ -61,6 +92,19 @@ ompl_interface::StateValidityChecker::StateValidityChecker(const ModelBasedPlann
   collision_request_with_distance_.group_name = planning_context_->getGroupName();
   collision_request_with_cost_.group_name = planning_context_->getGroupName();
 
+  collision_request_simple_.padding_profile = planning_context_->getPaddingProfile();
+  collision_request_with_distance_.padding_profile = planning_context_->getPaddingProfile();
+  collision_request_with_cost_.padding_profile = planning_context_->getPaddingProfile();
+
+  // all checked states share the variables outside the group with the initial state, so the link pairs and world
+  // objects that the group cannot bring into contact can be culled once for all checks
+  auto culling = std::make_shared<const collision_detection::GroupCollisionCulling>(
+      *planning_context_->getPlanningScene()->getCollisionEnv(), planning_context_->getCompleteInitialRobotState(),
+      planning_context_->getJointModelGroup(), planning_context_->getPaddingProfile());
+  collision_request_simple_.culling = culling;
+  collision_request_with_distance_.culling = culling;
+  collision_request_with_cost_.culling = culling;
+
   collision_request_simple_verbose_ = collision_request_simple_;
   collision_request_simple_verbose_.verbose = true;
 
@@ -73,17 +117,56 @@ void ompl_interface::StateValidityChecker::setVerbose(bool flag)
   verbose_ = flag;
 }
 
+void ompl_interface::StateValidityChecker::setCollisionDetector(const std::string& collision_detector_name)
+{
+  const planning_scene::PlanningSceneConstPtr& scene = planning_context_->getPlanningScene();
+  collision_env_ = scene->getCollisionEnv(collision_detector_name);
+  collision_env_unpadded_ = scene->getCollisionEnvUnpadded(collision_detector_name);
+  cache_validity_ = false;
+
+  auto culling = std::make_shared<const collision_detection::GroupCollisionCulling>(
+      *collision_env_, planning_context_->getCompleteInitialRobotState(), planning_context_->getJointModelGroup(),
+      planning_context_->getPaddingProfile());
+  collision_request_simple_.culling = culling;
+  collision_request_with_distance_.culling = culling;
+  collision_request_with_cost_.culling = culling;
+  collision_request_simple_verbose_.culling = culling;
+  collision_request_with_distance_verbose_.culling = culling;
+}
+
+void ompl_interface::StateValidityChecker::checkCollision(const collision_detection::CollisionRequest& req,
+                                                          collision_detection::CollisionResult& res,
+                                                          const moveit::core::RobotState& robot_state) const
+{
+  if (!collision_env_)
+  {
+    planning_context_->getPlanningScene()->checkCollision(req, res, robot_state);
+    return;
+  }
+
+  // as in PlanningScene::checkCollision(), the world is checked with the padded and the robot with the unpadded env
+  const collision_detection::AllowedCollisionMatrix& acm =
+      planning_context_->getPlanningScene()->getAllowedCollisionMatrix();
+  collision_env_->checkRobotCollision(req, res, robot_state, acm);
+  if (!res.collision || (req.contacts && res.contacts.size() < req.max_contacts))
+    collision_env_unpadded_->checkSelfCollision(req, res, robot_state, acm);
+}
+
 bool ompl_interface::StateValidityChecker::isValid(const ompl::base::State* state, bool verbose) const
 {
   // Use cached validity if it is available
-  if (state->as<ModelBasedStateSpace::StateType>()->isValidityKnown())
+  if (cache_validity_ && state->as<ModelBasedStateSpace::StateType>()->isValidityKnown())
     return state->as<ModelBasedStateSpace::StateType>()->isMarkedValid();
 
+  MOVEIT_TRACE_SCOPE("StateValidityChecker::isValid");
+  check_count_.fetch_add(1, std::memory_order_relaxed);
+  ScopedTimer timer(check_time_);
+
   if (!si_->satisfiesBounds(state))
   {
     if (verbose)
       RCLCPP_INFO(LOGGER, "State outside bounds");
-    const_cast<ob::State*>(state)->as<ModelBasedStateSpace::StateType>()->markInvalid();
+    markInvalid(state);
     return false;
   }
 
@@ -92,49 +175,63 @@ bool ompl_interface::StateValidityChecker::isValid(const ompl::base::State* stat
 
   // check path constraints
   const kinematic_constraints::KinematicConstraintSetPtr& kset = planning_context_->getPathConstraints();
-  if (kset && !kset->decide(*robot_state, verbose).satisfied)
+  if (kset && !(verbose ? kset->decide(*robot_state, verbose).satisfied : kset->isSatisfied(*robot_state)))
   {
-    const_cast<ob::State*>(state)->as<ModelBasedStateSpace::StateType>()->markInvalid();
+    markInvalid(state);
     return false;
   }
 
   // check feasibility
   if (!planning_context_->getPlanningScene()->isStateFeasible(*robot_state, verbose))
   {
-    const_cast<ob::State*>(state)->as<ModelBasedStateSpace::StateType>()->markInvalid();
+    markInvalid(state);
     return false;
   }
 
   // check collision avoidance
-  collision_detection::CollisionResult res;
-  planning_context_->getPlanningScene()->checkCollision(
-      verbose ? collision_request_simple_verbose_ : collision_request_simple_, res, *robot_state);
-  if (!res.collision)
+  bool collision_free;
   {
-    const_cast<ob::State*>(state)->as<ModelBasedStateSpace::StateType>()->markValid();
+    ScopedTimer collision_timer(collision_check_time_);
+    collision_free = isCollisionFree(*robot_state, verbose);
+  }
+  if (collision_free)
+  {
+    markValid(state);
+    storeProjectionLinkPosition(state, *robot_state);
   }
   else
   {
-    const_cast<ob::State*>(state)->as<ModelBasedStateSpace::StateType>()->markInvalid();
+    markInvalid(state);
   }
+  return collision_free;
+}
+
+bool ompl_interface::StateValidityChecker::isCollisionFree(moveit::core::RobotState& robot_state, bool verbose) const
+{
+  collision_detection::CollisionResult res;
+  checkCollision(verbose ? collision_request_simple_verbose_ : collision_request_simple_, res, robot_state);
   return !res.collision;
 }
 
 bool ompl_interface::StateValidityChecker::isValid(const ompl::base::State* state, double& dist, bool verbose) const
 {
   // Use cached validity and distance if they are available
-  if (state->as<ModelBasedStateSpace::StateType>()->isValidityKnown() &&
+  if (cache_validity_ && state->as<ModelBasedStateSpace::StateType>()->isValidityKnown() &&
       state->as<ModelBasedStateSpace::StateType>()->isGoalDistanceKnown())
   {
     dist = state->as<ModelBasedStateSpace::StateType>()->distance;
     return state->as<ModelBasedStateSpace::StateType>()->isMarkedValid();
   }
 
+  MOVEIT_TRACE_SCOPE("StateValidityChecker::isValid");
+  check_count_.fetch_add(1, std::memory_order_relaxed);
+  ScopedTimer timer(check_time_);
+
   if (!si_->satisfiesBounds(state))
   {
     if (verbose)
       RCLCPP_INFO(LOGGER, "State outside bounds");
-    const_cast<ob::State*>(state)->as<ModelBasedStateSpace::StateType>()->markInvalid(0.0);
+    markInvalid(state, 0.0);
     return false;
   }
 
@@ -149,7 +246,7 @@ bool ompl_interface::StateValidityChecker::isValid(const ompl::base::State* stat
     if (!cer.satisfied)
     {
       dist = cer.distance;
-      const_cast<ob::State*>(state)->as<ModelBasedStateSpace::StateType>()->markInvalid(dist);
+      markInvalid(state, dist);
       return false;
     }
   }
@@ -163,12 +260,45 @@ bool ompl_interface::StateValidityChecker::isValid(const ompl::base::State* stat
 
   // check collision avoidance
   collision_detection::CollisionResult res;
-  planning_context_->getPlanningScene()->checkCollision(
-      verbose ? collision_request_with_distance_verbose_ : collision_request_with_distance_, res, *robot_state);
+  {
+    ScopedTimer collision_timer(collision_check_time_);
+    checkCollision(verbose ? collision_request_with_distance_verbose_ : collision_request_with_distance_, res,
+                   *robot_state);
+  }
   dist = res.distance;
+  if (!res.collision)
+    storeProjectionLinkPosition(state, *robot_state);
   return !res.collision;
 }
 
+void ompl_interface::StateValidityChecker::markValid(const ompl::base::State* state) const
+{
+  if (cache_validity_)
+    const_cast<ob::State*>(state)->as<ModelBasedStateSpace::StateType>()->markValid();
+}
+
+void ompl_interface::StateValidityChecker::storeProjectionLinkPosition(const ompl::base::State* state,
+                                                                       moveit::core::RobotState& robot_state) const
+{
+  // the transforms are up to date after checking the state, so the projection of valid states costs nothing extra
+  const moveit::core::LinkModel* link = planning_context_->getProjectionLink();
+  if (cache_validity_ && link)
+    const_cast<ob::State*>(state)->as<ModelBasedStateSpace::StateType>()->setLinkPosition(
+        robot_state.getGlobalLinkTransform(link).translation());
+}
+
+void ompl_interface::StateValidityChecker::markInvalid(const ompl::base::State* state) const
+{
+  if (cache_validity_)
+    const_cast<ob::State*>(state)->as<ModelBasedStateSpace::StateType>()->markInvalid();
+}
+
+void ompl_interface::StateValidityChecker::markInvalid(const ompl::base::State* state, double dist) const
+{
+  if (cache_validity_)
+    const_cast<ob::State*>(state)->as<ModelBasedStateSpace::StateType>()->markInvalid(dist);
+}
+
 double ompl_interface::StateValidityChecker::cost(const ompl::base::State* state) const
 {
   double cost = 0.0;
@@ -178,7 +308,7 @@ double ompl_interface::StateValidityChecker::cost(const ompl::base::State* state
 
   // Calculates cost from a summation of distance to obstacles times the size of the obstacle
   collision_detection::CollisionResult res;
-  planning_context_->getPlanningScene()->checkCollision(collision_request_with_cost_, res, *robot_state);
+  checkCollision(collision_request_with_cost_, res, *robot_state);
 
   for (const collision_detection::CostSource& cost_source : res.cost_sources)
     cost += cost_source.cost * cost_source.getVolume();
@@ -192,6 +322,98 @@ double ompl_interface::StateValidityChecker::clearance(const ompl::base::State*
   planning_context_->getOMPLStateSpace()->copyToRobotState(*robot_state, state);
 
   collision_detection::CollisionResult res;
-  planning_context_->getPlanningScene()->checkCollision(collision_request_with_distance_, res, *robot_state);
+  checkCollision(collision_request_with_distance_, res, *robot_state);
   return res.collision ? 0.0 : (res.distance < 0.0 ? std::numeric_limits<double>::infinity() : res.distance);
 }
+
+ompl_interface::TieredStateValidityChecker::TieredStateValidityChecker(const ModelBasedPlanningContext* pc)
+  : StateValidityChecker(pc), always_exact_(false)
+{
+  const planning_scene::PlanningSceneConstPtr& scene = pc->getPlanningScene();
+  for (const auto& object : *scene->getWorld())
+    for (std::size_t i = 0; i < object.second->shapes_.size() && !always_exact_; ++i)
+    {
+      const shapes::Shape* shape = object.second->shapes_[i].get();
+      const Eigen::Isometry3d& pose = object.second->shape_poses_[i];
+      if (shape->type == shapes::BOX)
+      {
+        // the axis-aligned extents of the rotated box
+        const Eigen::Vector3d half_size =
+            0.5 * Eigen::Map<const Eigen::Vector3d>(static_cast<const shapes::Box*>(shape)->size);
+        const Eigen::Vector3d half_extents = pose.linear().cwiseAbs() * half_size;
+        world_boxes_.emplace_back(pose.translation() - half_extents, pose.translation() + half_extents);
+      }
+      else if (shape->type == shapes::PLANE || shape->type == shapes::OCTREE)
+        always_exact_ = true;
+      else
+      {
+        Eigen::Vector3d center;
+        double radius;
+        shapes::computeShapeBoundingSphere(shape, center, radius);
+        center = pose * center;
+        world_boxes_.emplace_back(center - Eigen::Vector3d::Constant(radius),
+                                  center + Eigen::Vector3d::Constant(radius));
+      }
+    }
+
+  // the links of the group are checked against the world, with the padding (profile) and scale of the scene
+  const moveit::core::JointModelGroup* jmg = pc->getRobotModel()->getJointModelGroup(group_name_);
+  links_ = jmg->getUpdatedLinkModelsWithGeometry();
+  for (const moveit::core::LinkModel* link : links_)
+  {
+    // scaled shapes grow around their own origin, which is not worth bounding
+    if (scene->getCollisionEnv()->getLinkScale(link->getName()) != 1.0)
+      always_exact_ = true;
+    link_paddings_.push_back(scene->getCollisionEnv()->getLinkPadding(link->getName(), pc->getPaddingProfile()));
+  }
+}
+
+bool ompl_interface::TieredStateValidityChecker::isCollisionFree(moveit::core::RobotState& robot_state,
+                                                                 bool verbose) const
+{
+  if (always_exact_ || mayCollideWithWorld(robot_state))
+    return StateValidityChecker::isCollisionFree(robot_state, verbose);
+
+  // only self collisions are possible
+  collision_detection::CollisionResult res;
+  planning_context_->getPlanningScene()->checkSelfCollision(
+      verbose ? collision_request_simple_verbose_ : collision_request_simple_, res, robot_state);
+  return !res.collision;
+}
+
+bool ompl_interface::TieredStateValidityChecker::mayCollideWithWorld(moveit::core::RobotState& robot_state) const
+{
+  if (world_boxes_.empty())
+    return false;
+
+  robot_state.updateCollisionBodyTransforms();
+  std::vector<const moveit::core::AttachedBody*> attached_bodies;
+  for (std::size_t i = 0; i < links_.size(); ++i)
+  {
+    const Eigen::Isometry3d& link_pose = robot_state.getGlobalLinkTransform(links_[i]);
+    const Eigen::Vector3d center = link_pose * links_[i]->getCenteredBoundingBoxOffset();
+    const double radius = 0.5 * links_[i]->getShapeExtentsAtOrigin().norm() + link_paddings_[i];
+    for (const Eigen::AlignedBox3d& box : world_boxes_)
+      if (box.squaredExteriorDistance(center) <= radius * radius)
+        return true;
+
+    attached_bodies.clear();
+    robot_state.getAttachedBodies(attached_bodies, links_[i]);
+    for (const moveit::core::AttachedBody* attached_body : attached_bodies)
+    {
+      const EigenSTL::vector_Isometry3d& poses = attached_body->getGlobalCollisionBodyTransforms();
+      for (std::size_t j = 0; j < poses.size(); ++j)
+      {
+        Eigen::Vector3d shape_center;
+        double shape_radius;
+        shapes::computeShapeBoundingSphere(attached_body->getShapes()[j].get(), shape_center, shape_radius);
+        shape_center = poses[j] * shape_center;
+        shape_radius += link_paddings_[i];
+        for (const Eigen::AlignedBox3d& box : world_boxes_)
+          if (box.squaredExteriorDistance(shape_center) <= shape_radius * shape_radius)
+            return true;
+      }
+    }
+  }
+  return false;
+}
@@ -35,27 +35,65 @@
 /* Author: Ioan Sucan */
 
 #include <moveit/ompl_interface/detail/threadsafe_state_storage.h>
+#include <array>
+#include <atomic>
+
+namespace
+{
+std::atomic<std::uint64_t> NEXT_STORAGE_ID(1);
+
+// Per-thread cache of (storage id, state) pairs; id 0 marks an empty slot
+struct ThreadStateSlots
+{
+  static constexpr std::size_t SIZE = 8;
+  std::array<std::uint64_t, SIZE> ids{};
+  std::array<moveit::core::RobotState*, SIZE> states{};
+  std::size_t next = 0;
+};
+
+ThreadStateSlots& threadStateSlots()
+{
+  static thread_local ThreadStateSlots slots;
+  return slots;
+}
+}  // namespace
 
 ompl_interface::TSStateStorage::TSStateStorage(const moveit::core::RobotModelPtr& robot_model)
-  : start_state_(robot_model)
+  : start_state_(robot_model), id_(NEXT_STORAGE_ID++)
 {
   start_state_.setToDefaultValues();
 }
 
-ompl_interface::TSStateStorage::TSStateStorage(const moveit::core::RobotState& start_state) : start_state_(start_state)
+ompl_interface::TSStateStorage::TSStateStorage(const moveit::core::RobotState& start_state)
+  : start_state_(start_state), id_(NEXT_STORAGE_ID++)
 {
 }
 
 ompl_interface::TSStateStorage::~TSStateStorage()
 {
+  // thread-local slots referring to this storage become stale, but can never match again as ids are not reused
   for (auto& thread_state : thread_states_)
     delete thread_state.second;
 }
 
 moveit::core::RobotState* ompl_interface::TSStateStorage::getStateStorage() const
+{
+  ThreadStateSlots& slots = threadStateSlots();
+  for (std::size_t i = 0; i < ThreadStateSlots::SIZE; ++i)
+    if (slots.ids[i] == id_)
+      return slots.states[i];
+
+  moveit::core::RobotState* st = getStateStorageSlow();
+  slots.ids[slots.next] = id_;
+  slots.states[slots.next] = st;
+  slots.next = (slots.next + 1) % ThreadStateSlots::SIZE;
+  return st;
+}
+
+moveit::core::RobotState* ompl_interface::TSStateStorage::getStateStorageSlow() const
 {
   moveit::core::RobotState* st = nullptr;
-  std::unique_lock<std::mutex> slock(lock_);  /// \todo use Thread Local Storage?
+  std::unique_lock<std::mutex> slock(lock_);
   std::map<std::thread::id, moveit::core::RobotState*>::const_iterator it =
       thread_states_.find(std::this_thread::get_id());
   if (it == thread_states_.end())
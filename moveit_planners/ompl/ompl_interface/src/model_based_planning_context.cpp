@@ -39,11 +39,17 @@
 
 #include <moveit/ompl_interface/model_based_planning_context.h>
 #include <moveit/ompl_interface/detail/state_validity_checker.h>
+#include <moveit/ompl_interface/detail/clearance_motion_validator.h>
+#include <moveit/ompl_interface/detail/continuous_motion_validator.h>
 #include <moveit/ompl_interface/detail/constrained_sampler.h>
 #include <moveit/ompl_interface/detail/constrained_goal_sampler.h>
 #include <moveit/ompl_interface/detail/goal_union.h>
 #include <moveit/ompl_interface/detail/projection_evaluators.h>
 #include <moveit/ompl_interface/detail/constraints_library.h>
+#include <moveit/ompl_interface/detail/experience_database.h>
+#include <moveit/ompl_interface/detail/experience_retrieve_repair.h>
+#include <moveit/ompl_interface/detail/shared_roadmap.h>
+#include <moveit/ompl_interface/detail/ompl_constraints.h>
 
 #include <moveit/kinematic_constraints/utils.h>
 #include <moveit/profiler/profiler.h>
@@ -55,6 +61,8 @@
 #include <ompl/tools/config/SelfConfig.h>
 #include <ompl/base/spaces/SE3StateSpace.h>
 #include <ompl/datastructures/PDF.h>
+#include <ompl/geometric/PathHybridization.h>
+#include <ompl/geometric/PathSimplifier.h>
 // TODO: remove when ROS Melodic and older are no longer supported
 #if OMPL_VERSION_VALUE < 1005000
 #include <ompl/base/PlannerTerminationCondition.h>
@@ -70,7 +78,7 @@
 #include "ompl/base/objectives/MinimaxObjective.h"
 #include "ompl/base/objectives/StateCostIntegralObjective.h"
 #include "ompl/base/objectives/MaximizeMinClearanceObjective.h"
-#include <ompl/geometric/planners/prm/LazyPRM.h>
+#include <thread>
 
 namespace ompl_interface
 {
@@ -89,21 +97,38 @@ ompl_interface::ModelBasedPlanningContext::ModelBasedPlanningContext(const std::
   , last_plan_time_(0.0)
   , last_simplify_time_(0.0)
   , max_goal_samples_(0)
+  , goal_sampling_threads_(1)
   , max_state_sampling_attempts_(0)
   , max_goal_sampling_attempts_(0)
   , max_planning_threads_(0)
   , max_solution_segment_length_(0.0)
   , minimum_waypoint_count_(0)
   , multi_query_planning_enabled_(false)  // maintain "old" behavior by default
+  , experience_scene_hash_(0)
   , simplify_solutions_(true)
   , interpolate_(true)
   , hybridize_(true)
+  , simplification_threads_(0)
+  , tiered_state_validity_checking_(false)
+  , clearance_motion_validation_(false)
+  , continuous_motion_validation_(false)
+  , projection_link_(nullptr)
+  , coarse_time_fraction_(0.5)
+  , quasi_random_sampling_(false)
 {
   complete_initial_robot_state_.update();
 
   constraints_library_ = std::make_shared<ConstraintsLibrary>(this);
 }
 
+ompl_interface::ModelBasedPlanningContext::~ModelBasedPlanningContext()
+{
+  // a shared roadmap may keep expanding with the state validity checker of this context, which refers to it
+  if (ompl_simple_setup_)
+    if (auto planner = dynamic_cast<SharedRoadmapPlanner*>(ompl_simple_setup_->getPlanner().get()))
+      planner->releaseStateValidityChecker();
+}
+
 void ompl_interface::ModelBasedPlanningContext::configure(const rclcpp::Node::SharedPtr& node,
                                                           bool use_constraints_approximations)
 {
@@ -114,27 +139,42 @@ void ompl_interface::ModelBasedPlanningContext::configure(const rclcpp::Node::Sh
   }
   complete_initial_robot_state_.update();
   ompl_simple_setup_->getStateSpace()->computeSignature(space_signature_);
-  ompl_simple_setup_->getStateSpace()->setStateSamplerAllocator(
-      std::bind(&ModelBasedPlanningContext::allocPathConstrainedSampler, this, std::placeholders::_1));
+  // a constrained state space samples states by projecting them onto the path constraints
+  if (!spec_.constrained_state_space_)
+    ompl_simple_setup_->getStateSpace()->setStateSamplerAllocator(
+        std::bind(&ModelBasedPlanningContext::allocPathConstrainedSampler, this, std::placeholders::_1));
 
-  // convert the input state to the corresponding OMPL state
-  ompl::base::ScopedState<> ompl_start_state(spec_.state_space_);
+  // convert the input state to the corresponding OMPL state, of the constrained state space if there is one
+  ompl::base::ScopedState<> ompl_start_state(ompl_simple_setup_->getStateSpace());
   spec_.state_space_->copyToOMPLState(ompl_start_state.get(), getCompleteInitialRobotState());
   ompl_simple_setup_->setStartState(ompl_start_state);
-  ompl_simple_setup_->setStateValidityChecker(ob::StateValidityCheckerPtr(new StateValidityChecker(this)));
 
-  if (path_constraints_ && constraints_library_)
+  if (path_constraints_ && constraints_library_ && !spec_.constrained_state_space_)
   {
     const ConstraintApproximationPtr& constraint_approx =
         constraints_library_->getConstraintApproximation(path_constraints_msg_);
-    if (constraint_approx)
+    // the interpolation function is empty if the states of the approximation could not be read
+    InterpolationFunction interpolation_function =
+        constraint_approx ? constraint_approx->getInterpolationFunction() : InterpolationFunction();
+    if (interpolation_function)
     {
-      getOMPLStateSpace()->setInterpolationFunction(constraint_approx->getInterpolationFunction());
+      getOMPLStateSpace()->setInterpolationFunction(interpolation_function);
       RCLCPP_INFO(LOGGER, "Using precomputed interpolation states");
     }
   }
 
+  // the validity checker depends on the configuration
   useConfig();
+  if (tiered_state_validity_checking_)
+    ompl_simple_setup_->setStateValidityChecker(std::make_shared<TieredStateValidityChecker>(this));
+  else
+    ompl_simple_setup_->setStateValidityChecker(ob::StateValidityCheckerPtr(new StateValidityChecker(this)));
+  // constrained state spaces come with a motion validator that follows the manifold
+  if (continuous_motion_validation_ && !spec_.constrained_state_space_)
+    ompl_simple_setup_->getSpaceInformation()->setMotionValidator(std::make_shared<ContinuousMotionValidator>(this));
+  else if (clearance_motion_validation_ && !spec_.constrained_state_space_)
+    ompl_simple_setup_->getSpaceInformation()->setMotionValidator(std::make_shared<ClearanceMotionValidator>(this));
+
   if (ompl_simple_setup_->getGoal())
     ompl_simple_setup_->setup();
 }
@@ -146,9 +186,22 @@ void ompl_interface::ModelBasedPlanningContext::setProjectionEvaluator(const std
     RCLCPP_ERROR(LOGGER, "No state space is configured yet");
     return;
   }
+  // the projection is registered with the joint space, whose states the constrained state space passes to it, but
+  // link projections convert states to robot states, which expects the states of the constrained state space
+  if (spec_.constrained_state_space_ && peval.compare(0, 5, "link(") == 0)
+  {
+    RCLCPP_WARN(LOGGER, "%s: Ignoring projection evaluator '%s', only joint projections are supported on the manifold "
+                        "of the path constraints",
+                name_.c_str(), peval.c_str());
+    return;
+  }
   ob::ProjectionEvaluatorPtr projection_eval = getProjectionEvaluator(peval);
   if (projection_eval)
+  {
     spec_.state_space_->registerDefaultProjection(projection_eval);
+    auto link_projection = std::dynamic_pointer_cast<ProjectionEvaluatorLinkPose>(projection_eval);
+    projection_link_ = link_projection ? link_projection->getLink() : nullptr;
+  }
 }
 
 ompl::base::ProjectionEvaluatorPtr
@@ -249,6 +302,11 @@ ompl_interface::ModelBasedPlanningContext::allocPathConstrainedSampler(const omp
       return ob::StateSamplerPtr(new ConstrainedSampler(this, constraint_sampler));
     }
   }
+  if (quasi_random_sampling_)
+  {
+    RCLCPP_DEBUG(LOGGER, "%s: Allocating quasi-random state sampler for state space", name_.c_str());
+    return spec_.state_space_->allocQuasiRandomStateSampler();
+  }
   RCLCPP_DEBUG(LOGGER, "%s: Allocating default state sampler for state space", name_.c_str());
   return state_space->allocDefaultStateSampler();
 }
@@ -353,6 +411,89 @@ void ompl_interface::ModelBasedPlanningContext::useConfig()
     cfg.erase(it);
   }
 
+  // shortcut the solution path with several threads
+  it = cfg.find("simplification_threads");
+  if (it != cfg.end())
+  {
+    simplification_threads_ = boost::lexical_cast<unsigned int>(it->second);
+    cfg.erase(it);
+  }
+
+  // check states with the tiered state validity checker; lazy planners use it by default, since most of the states
+  // they check are not near obstacles
+  it = cfg.find("tiered_state_validity_checking");
+  if (it != cfg.end())
+  {
+    tiered_state_validity_checking_ = boost::lexical_cast<bool>(it->second);
+    cfg.erase(it);
+  }
+  else
+  {
+    static const std::set<std::string> LAZY_PLANNERS = { "geometric::LazyPRM", "geometric::LazyPRMstar",
+                                                         "geometric::LazyRRT", "geometric::LBKPIECE" };
+    it = cfg.find("type");
+    tiered_state_validity_checking_ = it != cfg.end() && LAZY_PLANNERS.count(it->second) > 0;
+  }
+
+  // check motions with the ClearanceMotionValidator
+  it = cfg.find("clearance_motion_validation");
+  if (it != cfg.end())
+  {
+    clearance_motion_validation_ = boost::lexical_cast<bool>(it->second);
+    cfg.erase(it);
+  }
+
+  // also check the motions between the checked states with continuous collision checking, see
+  // ContinuousMotionValidator. This takes precedence over clearance_motion_validation.
+  it = cfg.find("continuous_motion_validation");
+  if (it != cfg.end())
+  {
+    continuous_motion_validation_ = boost::lexical_cast<bool>(it->second);
+    cfg.erase(it);
+  }
+
+  // check states with a padding profile of the collision environment instead of the link padding
+  it = cfg.find("padding_profile");
+  if (it != cfg.end())
+  {
+    padding_profile_ = it->second;
+    cfg.erase(it);
+  }
+  else
+    padding_profile_.clear();
+
+  // plan with a coarse collision model first
+  it = cfg.find("coarse_collision_detector");
+  if (it != cfg.end())
+  {
+    coarse_collision_detector_ = it->second;
+    cfg.erase(it);
+  }
+  else
+    coarse_collision_detector_.clear();
+  it = cfg.find("coarse_time_fraction");
+  if (it != cfg.end())
+  {
+    coarse_time_fraction_ = moveit::core::toDouble(it->second);
+    cfg.erase(it);
+  }
+
+  // sample goals with several threads
+  it = cfg.find("goal_sampling_threads");
+  if (it != cfg.end())
+  {
+    setGoalSamplingThreads(boost::lexical_cast<unsigned int>(it->second));
+    cfg.erase(it);
+  }
+
+  // sample states from a low-discrepancy sequence
+  it = cfg.find("quasi_random_sampling");
+  if (it != cfg.end())
+  {
+    quasi_random_sampling_ = boost::lexical_cast<bool>(it->second);
+    cfg.erase(it);
+  }
+
   // remove the 'type' parameter; the rest are parameters for the planner itself
   it = cfg.find("type");
   if (it == cfg.end())
@@ -399,10 +540,94 @@ void ompl_interface::ModelBasedPlanningContext::setPlanningVolume(const moveit_m
 
 void ompl_interface::ModelBasedPlanningContext::simplifySolution(double timeout)
 {
+  if (simplification_threads_ > 1 && ompl_simple_setup_->haveSolutionPath())
+  {
+    simplifySolutionInParallel(timeout);
+    return;
+  }
   ompl_simple_setup_->simplifySolution(timeout);
   last_simplify_time_ = ompl_simple_setup_->getLastSimplificationTime();
 }
 
+void ompl_interface::ModelBasedPlanningContext::simplifySolutionInParallel(double timeout)
+{
+  ompl::time::point start = ompl::time::now();
+  const ob::SpaceInformationPtr& si = ompl_simple_setup_->getSpaceInformation();
+  const ob::ProblemDefinitionPtr& pdef = ompl_simple_setup_->getProblemDefinition();
+  const ob::OptimizationObjectivePtr& objective = pdef->getOptimizationObjective();
+  auto is_better = [&objective](const og::PathGeometric& a, const og::PathGeometric& b) {
+    return objective ? objective->isCostBetterThan(a.cost(objective), b.cost(objective)) : a.length() < b.length();
+  };
+
+  // each simplifier has its own random number generator, so the attempts of a round differ
+  std::vector<og::PathSimplifierPtr> simplifiers;
+  for (unsigned int t = 0; t < simplification_threads_; ++t)
+#if OMPL_VERSION_VALUE >= 1005000
+    simplifiers.push_back(std::make_shared<og::PathSimplifier>(si, pdef->getGoal(), objective));
+#else
+    simplifiers.push_back(std::make_shared<og::PathSimplifier>(si, pdef->getGoal()));
+#endif
+
+  og::PathGeometric& path = ompl_simple_setup_->getSolutionPath();
+  const std::size_t state_count = path.getStateCount();
+  std::vector<og::PathGeometric> candidates(simplification_threads_, path);
+  unsigned int rounds = 0;
+  while (ompl::time::seconds(ompl::time::now() - start) < timeout)
+  {
+    auto shortcut = [&](unsigned int t) {
+      candidates[t] = path;
+      simplifiers[t]->reduceVertices(candidates[t]);
+      simplifiers[t]->shortcutPath(candidates[t]);
+    };
+    std::vector<std::thread> threads;
+    threads.reserve(simplification_threads_ - 1);
+    for (unsigned int t = 1; t < simplification_threads_; ++t)
+      threads.emplace_back(shortcut, t);
+    shortcut(0);
+    for (std::thread& thread : threads)
+      thread.join();
+    ++rounds;
+
+    std::size_t best = 0;
+    for (std::size_t t = 1; t < candidates.size(); ++t)
+      if (is_better(candidates[t], candidates[best]))
+        best = t;
+    if (!is_better(candidates[best], path))
+      break;
+    path = candidates[best];
+  }
+
+  last_simplify_time_ = ompl::time::seconds(ompl::time::now() - start);
+  RCLCPP_DEBUG(LOGGER, "%s: Simplified the solution from %zu to %zu states in %u rounds of %u threads (%f s)",
+               name_.c_str(), state_count, path.getStateCount(), rounds, simplification_threads_, last_simplify_time_);
+}
+
+void ompl_interface::ModelBasedPlanningContext::hybridizeSolutions(double timeout, const ompl::time::point& start)
+{
+  // the solutions are ordered best first
+  const ob::ProblemDefinitionPtr& pdef = ompl_simple_setup_->getProblemDefinition();
+  og::PathHybridization hybridization(ompl_simple_setup_->getSpaceInformation());
+  for (const ob::PlannerSolution& solution : pdef->getSolutions())
+  {
+    // matching a path against the recorded ones is what takes time
+    if (hybridization.pathCount() > 0 && ompl::time::seconds(ompl::time::now() - start) >= timeout)
+      break;
+    if (!solution.approximate_)
+      hybridization.recordPath(solution.path_, false);
+  }
+  if (hybridization.pathCount() < 2)
+    return;
+
+  hybridization.computeHybridPath();
+  if (const ob::PathPtr& hybrid_path = hybridization.getHybridPath())
+  {
+    double difference = 0.0;
+    const bool approximate = !pdef->getGoal()->isSatisfied(
+        static_cast<const og::PathGeometric&>(*hybrid_path).getStates().back(), &difference);
+    pdef->addSolutionPath(hybrid_path, approximate, difference, hybridization.getName());
+  }
+}
+
 void ompl_interface::ModelBasedPlanningContext::interpolateSolution()
 {
   if (ompl_simple_setup_->haveSolutionPath())
@@ -553,19 +778,16 @@ void ompl_interface::ModelBasedPlanningContext::clear()
 {
   if (!multi_query_planning_enabled_)
     ompl_simple_setup_->clear();
-// TODO: remove when ROS Melodic and older are no longer supported
-#if OMPL_VERSION_VALUE >= 1005000
-  else
+  else if (auto planner = dynamic_cast<SharedRoadmapPlanner*>(ompl_simple_setup_->getPlanner().get()))
   {
+    // The shared roadmap must not check states with this context while it is reconfigured
+    planner->releaseStateValidityChecker();
     // For LazyPRM and LazyPRMstar we assume that the environment *could* have changed
     // This means that we need to reset the validity flags for every node and edge in
     // the roadmap. For PRM and PRMstar we assume that the environment is static. If
     // this is not the case, then multi-query planning should not be enabled.
-    auto planner = dynamic_cast<ompl::geometric::LazyPRM*>(ompl_simple_setup_->getPlanner().get());
-    if (planner != nullptr)
-      planner->clearValidity();
+    planner->getSharedRoadmap()->clearValidity();
   }
-#endif
   ompl_simple_setup_->clearStartStates();
   ompl_simple_setup_->setGoal(ob::GoalPtr());
   ompl_simple_setup_->setStateValidityChecker(ob::StateValidityCheckerPtr());
@@ -582,6 +804,11 @@ bool ompl_interface::ModelBasedPlanningContext::setPathConstraints(const moveit_
   path_constraints_->add(path_constraints, getPlanningScene()->getTransforms());
   path_constraints_msg_ = path_constraints;
 
+  // states are projected onto the configured constraints, the variables of other groups are those of the start state
+  if (spec_.constrained_state_space_)
+    std::static_pointer_cast<KinematicConstraintManifold>(spec_.constrained_state_space_->getConstraint())
+        ->setConstraints(path_constraints_, getCompleteInitialRobotState());
+
   return true;
 }
 
@@ -684,6 +911,7 @@ bool ompl_interface::ModelBasedPlanningContext::solve(planning_interface::Motion
       simplifySolution(request_.allowed_planning_time - ptime);
       ptime += getLastSimplifyTime();
     }
+    addSolutionToExperienceDatabase();
 
     if (interpolate_)
       interpolateSolution();
@@ -705,8 +933,38 @@ bool ompl_interface::ModelBasedPlanningContext::solve(planning_interface::Motion
   }
 }
 
+double ompl_interface::ModelBasedPlanningContext::getGoalSamplingTime() const
+{
+  const ob::GoalPtr& goal = ompl_simple_setup_->getGoal();
+  if (const auto* sampler = dynamic_cast<const ConstrainedGoalSampler*>(goal.get()))
+    return sampler->getSamplingTime();
+
+  double sampling_time = 0.0;
+  if (const auto* goals = dynamic_cast<const GoalSampleableRegionMux*>(goal.get()))
+    for (const ob::GoalPtr& member : goals->getGoals())
+      if (const auto* sampler = dynamic_cast<const ConstrainedGoalSampler*>(member.get()))
+        sampling_time += sampler->getSamplingTime();
+  return sampling_time;
+}
+
 bool ompl_interface::ModelBasedPlanningContext::solve(planning_interface::MotionPlanDetailedResponse& res)
 {
+  // the statistics of the validity checker and the goal samplers add up over all problems solved by this context
+  const auto* checker = dynamic_cast<const StateValidityChecker*>(ompl_simple_setup_->getStateValidityChecker().get());
+  const unsigned long check_count = checker ? checker->getCheckCount() : 0;
+  const double check_time = checker ? checker->getCheckTime() : 0.0;
+  const double collision_check_time = checker ? checker->getCollisionCheckTime() : 0.0;
+  const double goal_sampling_time = getGoalSamplingTime();
+  auto add_statistics = [&] {
+    if (checker)
+    {
+      res.statistics_["validity_check_count"] = checker->getCheckCount() - check_count;
+      res.statistics_["validity_check_time"] = checker->getCheckTime() - check_time;
+      res.statistics_["collision_check_time"] = checker->getCollisionCheckTime() - collision_check_time;
+    }
+    res.statistics_["goal_sampling_time"] = getGoalSamplingTime() - goal_sampling_time;
+  };
+
   if (solve(request_.allowed_planning_time, request_.num_planning_attempts))
   {
     res.trajectory_.reserve(3);
@@ -729,6 +987,7 @@ bool ompl_interface::ModelBasedPlanningContext::solve(planning_interface::Motion
       res.trajectory_.back().reset(new robot_trajectory::RobotTrajectory(getRobotModel(), getGroupName()));
       getSolutionPath(*res.trajectory_.back());
     }
+    addSolutionToExperienceDatabase();
 
     if (interpolate_)
     {
@@ -744,12 +1003,14 @@ bool ompl_interface::ModelBasedPlanningContext::solve(planning_interface::Motion
     // fill the response
     RCLCPP_DEBUG(LOGGER, "%s: Returning successful solution with %lu states", getName().c_str(),
                  getOMPLSimpleSetup()->getSolutionPath().getStateCount());
+    add_statistics();
     return true;
   }
   else
   {
     RCLCPP_INFO(LOGGER, "Unable to solve the planning problem");
     res.error_code_.val = moveit_msgs::msg::MoveItErrorCodes::PLANNING_FAILED;
+    add_statistics();
     return false;
   }
 }
@@ -761,7 +1022,11 @@ bool ompl_interface::ModelBasedPlanningContext::solve(double timeout, unsigned i
   preSolve();
 
   bool result = false;
-  if (count <= 1 || multi_query_planning_enabled_)  // multi-query planners should always run in single instances
+  if (experience_database_ && !multi_query_planning_enabled_)
+    result = solveWithExperience(timeout, count, start);
+  else if (!coarse_collision_detector_.empty() && !multi_query_planning_enabled_)
+    result = solveCoarseToFine(timeout, count, start);
+  else if (count <= 1 || multi_query_planning_enabled_)  // multi-query planners should always run in single instances
   {
     RCLCPP_DEBUG(LOGGER, "%s: Solving the planning problem once...", name_.c_str());
     ob::PlannerTerminationCondition ptc = constructPlannerTerminationCondition(timeout, start);
@@ -786,7 +1051,8 @@ bool ompl_interface::ModelBasedPlanningContext::solve(double timeout, unsigned i
 
       ob::PlannerTerminationCondition ptc = constructPlannerTerminationCondition(timeout, start);
       registerTerminationCondition(ptc);
-      result = ompl_parallel_plan_.solve(ptc, 1, count, hybridize_) == ompl::base::PlannerStatus::EXACT_SOLUTION;
+      result = ompl_parallel_plan_.solve(ptc, hybridize_ ? count : 1, count, false) ==
+               ompl::base::PlannerStatus::EXACT_SOLUTION;
       last_plan_time_ = ompl::time::seconds(ompl::time::now() - start);
       unregisterTerminationCondition();
     }
@@ -805,7 +1071,8 @@ bool ompl_interface::ModelBasedPlanningContext::solve(double timeout, unsigned i
         else
           for (unsigned int i = 0; i < max_planning_threads_; ++i)
             ompl_parallel_plan_.addPlanner(ompl::tools::SelfConfig::getDefaultPlanner(ompl_simple_setup_->getGoal()));
-        bool r = ompl_parallel_plan_.solve(ptc, 1, count, hybridize_) == ompl::base::PlannerStatus::EXACT_SOLUTION;
+        bool r = ompl_parallel_plan_.solve(ptc, hybridize_ ? count : 1, count, false) ==
+                 ompl::base::PlannerStatus::EXACT_SOLUTION;
         result = result && r;
       }
       n = count % max_planning_threads_;
@@ -818,12 +1085,20 @@ bool ompl_interface::ModelBasedPlanningContext::solve(double timeout, unsigned i
         else
           for (int i = 0; i < n; ++i)
             ompl_parallel_plan_.addPlanner(ompl::tools::SelfConfig::getDefaultPlanner(ompl_simple_setup_->getGoal()));
-        bool r = ompl_parallel_plan_.solve(ptc, 1, count, hybridize_) == ompl::base::PlannerStatus::EXACT_SOLUTION;
+        bool r = ompl_parallel_plan_.solve(ptc, hybridize_ ? count : 1, count, false) ==
+                 ompl::base::PlannerStatus::EXACT_SOLUTION;
         result = result && r;
       }
       last_plan_time_ = ompl::time::seconds(ompl::time::now() - start);
       unregisterTerminationCondition();
     }
+
+    // the planners only record their solutions, which are combined in the time left
+    if (hybridize_)
+    {
+      hybridizeSolutions(timeout, start);
+      last_plan_time_ = ompl::time::seconds(ompl::time::now() - start);
+    }
   }
 
   postSolve();
@@ -831,6 +1106,123 @@ bool ompl_interface::ModelBasedPlanningContext::solve(double timeout, unsigned i
   return result;
 }
 
+bool ompl_interface::ModelBasedPlanningContext::solveWithExperience(double timeout, unsigned int count,
+                                                                    const ompl::time::point& start)
+{
+  experience_scene_hash_ = ExperienceDatabase::computeSceneHash(*getPlanningScene());
+
+  // only stored paths that end in a state satisfying one of the goal constraints can be reused
+  const ob::SpaceInformationPtr& si = ompl_simple_setup_->getSpaceInformation();
+  ExperienceRetrieveRepair::GoalCheckFn goal_check = getGoalCheck();
+
+  // the first solution terminates the other planners, which is usually the retrieved path
+  RCLCPP_DEBUG(LOGGER, "%s: Solving the planning problem with experience and %u planners from scratch...",
+               name_.c_str(), count);
+  ompl_parallel_plan_.clearHybridizationPaths();
+  ompl_parallel_plan_.clearPlanners();
+  ompl_parallel_plan_.addPlanner(std::make_shared<ExperienceRetrieveRepair>(si, experience_database_, getGroupName(),
+                                                                            experience_scene_hash_, goal_check));
+  count = std::max(1u, std::min(count, max_planning_threads_ > 1 ? max_planning_threads_ - 1 : 1u));
+  for (unsigned int i = 0; i < count; ++i)
+    if (ompl_simple_setup_->getPlannerAllocator())
+      ompl_parallel_plan_.addPlannerAllocator(ompl_simple_setup_->getPlannerAllocator());
+    else
+      ompl_parallel_plan_.addPlanner(ompl::tools::SelfConfig::getDefaultPlanner(ompl_simple_setup_->getGoal()));
+
+  ob::PlannerTerminationCondition ptc = constructPlannerTerminationCondition(timeout, start);
+  registerTerminationCondition(ptc);
+  bool result = ompl_parallel_plan_.solve(ptc, 1, count + 1, false) == ompl::base::PlannerStatus::EXACT_SOLUTION;
+  last_plan_time_ = ompl::time::seconds(ompl::time::now() - start);
+  unregisterTerminationCondition();
+  return result;
+}
+
+std::function<bool(const ompl::base::State*)> ompl_interface::ModelBasedPlanningContext::getGoalCheck() const
+{
+  moveit::core::RobotState goal_check_state = complete_initial_robot_state_;
+  return [this, goal_check_state](const ob::State* state) mutable {
+    spec_.state_space_->copyToRobotState(goal_check_state, state);
+    for (const kinematic_constraints::KinematicConstraintSetPtr& goal_constraint : goal_constraints_)
+      if (goal_constraint->decide(goal_check_state).satisfied)
+        return true;
+    return false;
+  };
+}
+
+bool ompl_interface::ModelBasedPlanningContext::solveCoarseToFine(double timeout, unsigned int count,
+                                                                  const ompl::time::point& start)
+{
+  const ob::SpaceInformationPtr& si = ompl_simple_setup_->getSpaceInformation();
+  const ob::StateValidityCheckerPtr exact_checker = si->getStateValidityChecker();
+
+  // first pass: the coarse model is cheap to check and usually encloses the exact geometry
+  RCLCPP_DEBUG(LOGGER, "%s: Solving the planning problem with collision detector '%s'...", name_.c_str(),
+               coarse_collision_detector_.c_str());
+  auto coarse_checker = std::make_shared<StateValidityChecker>(this);
+  coarse_checker->setCollisionDetector(coarse_collision_detector_);
+  ompl_simple_setup_->setStateValidityChecker(coarse_checker);
+  bool coarse_result;
+  {
+    ob::PlannerTerminationCondition ptc = constructPlannerTerminationCondition(timeout * coarse_time_fraction_, start);
+    registerTerminationCondition(ptc);
+    coarse_result = ompl_simple_setup_->solve(ptc) == ompl::base::PlannerStatus::EXACT_SOLUTION;
+    unregisterTerminationCondition();
+  }
+  ompl_simple_setup_->setStateValidityChecker(exact_checker);
+
+  ExperienceDatabasePtr coarse_paths;
+  if (coarse_result)
+  {
+    const og::PathGeometric& path = ompl_simple_setup_->getSolutionPath();
+    if (path.check())
+    {
+      last_plan_time_ = ompl::time::seconds(ompl::time::now() - start);
+      return true;
+    }
+    coarse_paths = std::make_shared<ExperienceDatabase>(1);
+    ExperienceDatabase::Waypoints waypoints(path.getStateCount());
+    for (std::size_t i = 0; i < path.getStateCount(); ++i)
+      spec_.state_space_->copyToReals(waypoints[i], path.getState(i));
+    coarse_paths->addPath(getGroupName(), 0, waypoints);
+  }
+
+  // second pass: the planner data and the solution were found with the coarse checks
+  RCLCPP_DEBUG(LOGGER, "%s: The coarse path is %s, solving with exact collision checks...", name_.c_str(),
+               coarse_result ? "invalid" : "missing");
+  ompl_simple_setup_->clear();
+  ompl_parallel_plan_.clearHybridizationPaths();
+  ompl_parallel_plan_.clearPlanners();
+  if (coarse_paths)
+    ompl_parallel_plan_.addPlanner(
+        std::make_shared<ExperienceRetrieveRepair>(si, coarse_paths, getGroupName(), 0, getGoalCheck()));
+  count = std::max(1u, std::min(count, max_planning_threads_ > 1 ? max_planning_threads_ - 1 : 1u));
+  for (unsigned int i = 0; i < count; ++i)
+    if (ompl_simple_setup_->getPlannerAllocator())
+      ompl_parallel_plan_.addPlannerAllocator(ompl_simple_setup_->getPlannerAllocator());
+    else
+      ompl_parallel_plan_.addPlanner(ompl::tools::SelfConfig::getDefaultPlanner(ompl_simple_setup_->getGoal()));
+
+  ob::PlannerTerminationCondition ptc = constructPlannerTerminationCondition(timeout, start);
+  registerTerminationCondition(ptc);
+  const unsigned int planner_count = count + (coarse_paths ? 1 : 0);
+  bool result = ompl_parallel_plan_.solve(ptc, 1, planner_count, false) == ompl::base::PlannerStatus::EXACT_SOLUTION;
+  last_plan_time_ = ompl::time::seconds(ompl::time::now() - start);
+  unregisterTerminationCondition();
+  return result;
+}
+
+void ompl_interface::ModelBasedPlanningContext::addSolutionToExperienceDatabase()
+{
+  if (!experience_database_ || multi_query_planning_enabled_ || !ompl_simple_setup_->haveExactSolutionPath())
+    return;
+
+  const og::PathGeometric& path = ompl_simple_setup_->getSolutionPath();
+  ExperienceDatabase::Waypoints waypoints(path.getStateCount());
+  for (std::size_t i = 0; i < path.getStateCount(); ++i)
+    spec_.state_space_->copyToReals(waypoints[i], path.getState(i));
+  experience_database_->addPath(getGroupName(), experience_scene_hash_, waypoints);
+}
+
 void ompl_interface::ModelBasedPlanningContext::registerTerminationCondition(const ob::PlannerTerminationCondition& ptc)
 {
   std::unique_lock<std::mutex> slock(ptc_lock_);
@@ -38,6 +38,7 @@
 #include <moveit/robot_state/conversions.h>
 #include <moveit/kinematic_constraints/utils.h>
 #include <moveit/ompl_interface/detail/constrained_valid_state_sampler.h>
+#include <moveit/ompl_interface/detail/experience_database.h>
 #include <moveit/profiler/profiler.h>
 #include <moveit/utils/lexical_casts.h>
 #include <fstream>
@@ -61,6 +62,8 @@ ompl_interface::OMPLInterface::OMPLInterface(const moveit::core::RobotModelConst
   RCLCPP_DEBUG(LOGGER, "Initializing OMPL interface using ROS parameters");
   loadPlannerConfigurations();
   loadConstraintSamplers();
+  loadPlanningContextPoolSettings();
+  loadExperienceDatabaseSettings();
 }
 
 ompl_interface::OMPLInterface::OMPLInterface(const moveit::core::RobotModelConstPtr& robot_model,
@@ -80,7 +83,11 @@ ompl_interface::OMPLInterface::OMPLInterface(const moveit::core::RobotModelConst
   loadConstraintSamplers();
 }
 
-ompl_interface::OMPLInterface::~OMPLInterface() = default;
+ompl_interface::OMPLInterface::~OMPLInterface()
+{
+  if (experience_database_ && !experience_database_path_.empty())
+    experience_database_->save(experience_database_path_);
+}
 
 void ompl_interface::OMPLInterface::setPlannerConfigurations(const planning_interface::PlannerConfigurationMap& pconfig)
 {
@@ -123,6 +130,7 @@ ompl_interface::OMPLInterface::getPlanningContext(const planning_scene::Planning
 void ompl_interface::OMPLInterface::configureContext(const ModelBasedPlanningContextPtr& context) const
 {
   context->simplifySolutions(simplify_solutions_);
+  context->setExperienceDatabase(experience_database_);
 }
 
 void ompl_interface::OMPLInterface::loadConstraintSamplers()
@@ -259,6 +267,34 @@ void ompl_interface::OMPLInterface::loadPlannerConfigurations()
   setPlannerConfigurations(pconfig);
 }
 
+void ompl_interface::OMPLInterface::loadPlanningContextPoolSettings()
+{
+  int max_cached_contexts = 0;
+  if (node_->get_parameter(parameter_namespace_ + ".max_cached_planning_contexts", max_cached_contexts) &&
+      max_cached_contexts > 0)
+    context_manager_.setMaximumCachedContexts(max_cached_contexts);
+
+  int prewarm_contexts = 0;
+  if (node_->get_parameter(parameter_namespace_ + ".prewarm_planning_contexts", prewarm_contexts) &&
+      prewarm_contexts > 0)
+    context_manager_.prewarmPlanningContexts(prewarm_contexts);
+}
+
+void ompl_interface::OMPLInterface::loadExperienceDatabaseSettings()
+{
+  bool use_experience_database = false;
+  if (!node_->get_parameter(parameter_namespace_ + ".use_experience_database", use_experience_database) ||
+      !use_experience_database)
+    return;
+
+  int max_experiences = 1000;
+  node_->get_parameter(parameter_namespace_ + ".max_experiences", max_experiences);
+  experience_database_ = std::make_shared<ExperienceDatabase>(std::max(max_experiences, 1));
+  if (node_->get_parameter(parameter_namespace_ + ".experience_database_path", experience_database_path_) &&
+      !experience_database_path_.empty() && std::ifstream(experience_database_path_.c_str()).good())
+    experience_database_->load(experience_database_path_);
+}
+
 void ompl_interface::OMPLInterface::printStatus()
 {
   RCLCPP_INFO(LOGGER, "OMPL ROS interface is running.");
@@ -35,6 +35,9 @@
 /* Author: Ioan Sucan */
 
 #include <moveit/ompl_interface/parameterization/model_based_state_space.h>
+#include <moveit/utils/halton_sequence.h>
+#include <moveit/utils/memory_pool.h>
+#include <cmath>
 #include <utility>
 
 namespace ompl_interface
@@ -71,6 +74,21 @@ ompl_interface::ModelBasedStateSpace::ModelBasedStateSpace(ModelBasedStateSpaceS
     spec_.joint_bounds_[i] = &joint_bounds_storage_[i];
   }
 
+  // groups of revolute and prismatic joints have one value per active joint, in their order
+  flat_values_ = variable_count_ == joint_model_vector_.size();
+  continuous_values_.setConstant(variable_count_, false);
+  for (std::size_t i = 0; flat_values_ && i < joint_model_vector_.size(); ++i)
+  {
+    const moveit::core::JointModel* joint_model = joint_model_vector_[i];
+    if (joint_model->getType() == moveit::core::JointModel::REVOLUTE)
+      continuous_values_[i] = static_cast<const moveit::core::RevoluteJointModel*>(joint_model)->isContinuous();
+    else if (joint_model->getType() != moveit::core::JointModel::PRISMATIC)
+      flat_values_ = false;
+    if (spec_.joint_model_group_->getJointVariableGroupIndex(joint_model) != static_cast<int>(i))
+      flat_values_ = false;
+  }
+  setJointDistanceWeights(std::vector<double>());
+
   // default settings
   setTagSnapToSegment(0.95);
 
@@ -104,13 +122,13 @@ void ompl_interface::ModelBasedStateSpace::setTagSnapToSegment(double snap)
 ompl::base::State* ompl_interface::ModelBasedStateSpace::allocState() const
 {
   auto* state = new StateType();
-  state->values = new double[variable_count_];
+  state->values = static_cast<double*>(moveit::core::allocateCachedBlock(state_values_size_));
   return state;
 }
 
 void ompl_interface::ModelBasedStateSpace::freeState(ompl::base::State* state) const
 {
-  delete[] state->as<StateType>()->values;
+  moveit::core::freeCachedBlock(state->as<StateType>()->values, state_values_size_);
   delete state->as<StateType>();
 }
 
@@ -121,6 +139,8 @@ void ompl_interface::ModelBasedStateSpace::copyState(ompl::base::State* destinat
   destination->as<StateType>()->tag = source->as<StateType>()->tag;
   destination->as<StateType>()->flags = source->as<StateType>()->flags;
   destination->as<StateType>()->distance = source->as<StateType>()->distance;
+  memcpy(destination->as<StateType>()->link_position, source->as<StateType>()->link_position,
+         sizeof(StateType::link_position));
 }
 
 unsigned int ompl_interface::ModelBasedStateSpace::getSerializationLength() const
@@ -166,13 +186,53 @@ double ompl_interface::ModelBasedStateSpace::getMeasure() const
   return m;
 }
 
+void ompl_interface::ModelBasedStateSpace::setJointDistanceWeights(const std::vector<double>& weights)
+{
+  if (!weights.empty() && weights.size() != joint_model_vector_.size())
+  {
+    RCLCPP_ERROR(LOGGER, "Expected %zu joint distance weights for group '%s' but got %zu. Weights are ignored.",
+                 joint_model_vector_.size(), spec_.joint_model_group_->getName().c_str(), weights.size());
+    return;
+  }
+  joint_distance_weights_ = weights;
+  if (flat_values_)
+  {
+    value_distance_weights_.resize(variable_count_);
+    for (std::size_t i = 0; i < joint_model_vector_.size(); ++i)
+      value_distance_weights_[i] =
+          joint_model_vector_[i]->getDistanceFactor() * (weights.empty() ? 1.0 : joint_distance_weights_[i]);
+  }
+}
+
 double ompl_interface::ModelBasedStateSpace::distance(const ompl::base::State* state1,
                                                       const ompl::base::State* state2) const
 {
   if (distance_function_)
     return distance_function_(state1, state2);
-  else
-    return spec_.joint_model_group_->distance(state1->as<StateType>()->values, state2->as<StateType>()->values);
+
+  const double* values1 = state1->as<StateType>()->values;
+  const double* values2 = state2->as<StateType>()->values;
+  if (flat_values_)
+  {
+    // same as RevoluteJointModel::distance() and PrismaticJointModel::distance() for all values at once
+    const double two_pi = 2.0 * M_PI;
+    const Eigen::Map<const Eigen::ArrayXd> a(values1, variable_count_);
+    const Eigen::Map<const Eigen::ArrayXd> b(values2, variable_count_);
+    const auto d = (a - b).abs();
+    const auto wrapped = d - two_pi * (d / two_pi).floor();
+    return (value_distance_weights_ * continuous_values_.select(wrapped.min(two_pi - wrapped), d)).sum();
+  }
+  if (joint_distance_weights_.empty())
+    return spec_.joint_model_group_->distance(values1, values2);
+
+  double d = 0.0;
+  for (std::size_t i = 0; i < joint_model_vector_.size(); ++i)
+  {
+    const int index = spec_.joint_model_group_->getJointVariableGroupIndex(joint_model_vector_[i]);
+    d += joint_distance_weights_[i] * joint_model_vector_[i]->getDistanceFactor() *
+         joint_model_vector_[i]->distance(values1 + index, values2 + index);
+  }
+  return d;
 }
 
 bool ompl_interface::ModelBasedStateSpace::equalStates(const ompl::base::State* state1,
@@ -196,6 +256,23 @@ bool ompl_interface::ModelBasedStateSpace::satisfiesBounds(const ompl::base::Sta
                                                            std::numeric_limits<double>::epsilon());
 }
 
+void ompl_interface::ModelBasedStateSpace::interpolateFlatValues(const double* from, const double* to, const double t,
+                                                                 double* state) const
+{
+  // same as RevoluteJointModel::interpolate() and PrismaticJointModel::interpolate() for all values at once
+  const double two_pi = 2.0 * M_PI;
+  const Eigen::Map<const Eigen::ArrayXd> a(from, variable_count_);
+  const Eigen::Map<const Eigen::ArrayXd> b(to, variable_count_);
+  Eigen::Map<Eigen::ArrayXd> result(state, variable_count_);
+
+  // continuous joints move the shorter way around the circle and are wrapped back into [-pi, pi]
+  const auto diff = b - a;
+  const auto wrap = (diff > M_PI).cast<double>() - (diff < -M_PI).cast<double>();
+  result = a + t * continuous_values_.select(diff - two_pi * wrap, diff);
+  const auto overflow = (result > M_PI).cast<double>() - (result < -M_PI).cast<double>();
+  result -= continuous_values_.select(two_pi * overflow, 0.0);
+}
+
 void ompl_interface::ModelBasedStateSpace::interpolate(const ompl::base::State* from, const ompl::base::State* to,
                                                        const double t, ompl::base::State* state) const
 {
@@ -205,8 +282,12 @@ void ompl_interface::ModelBasedStateSpace::interpolate(const ompl::base::State*
   if (!interpolation_function_ || !interpolation_function_(from, to, t, state))
   {
     // perform the actual interpolation
-    spec_.joint_model_group_->interpolate(from->as<StateType>()->values, to->as<StateType>()->values, t,
-                                          state->as<StateType>()->values);
+    if (flat_values_)
+      interpolateFlatValues(from->as<StateType>()->values, to->as<StateType>()->values, t,
+                            state->as<StateType>()->values);
+    else
+      spec_.joint_model_group_->interpolate(from->as<StateType>()->values, to->as<StateType>()->values, t,
+                                            state->as<StateType>()->values);
 
     // compute tag
     if (from->as<StateType>()->tag >= 0 && t < 1.0 - tag_snap_to_segment_)
@@ -287,6 +368,79 @@ ompl::base::StateSamplerPtr ompl_interface::ModelBasedStateSpace::allocDefaultSt
       new DefaultStateSampler(this, spec_.joint_model_group_, &spec_.joint_bounds_)));
 }
 
+ompl::base::StateSamplerPtr ompl_interface::ModelBasedStateSpace::allocQuasiRandomStateSampler() const
+{
+  class QuasiRandomStateSampler : public ompl::base::StateSampler
+  {
+  public:
+    QuasiRandomStateSampler(const ompl::base::StateSpace* space, const moveit::core::JointModelGroup* group,
+                            const moveit::core::JointBoundsVector* joint_bounds)
+      : ompl::base::StateSampler(space), joint_model_group_(group), joint_bounds_(joint_bounds), halton_(0)
+    {
+      const std::vector<const moveit::core::JointModel*>& joints = group->getActiveJointModels();
+      for (std::size_t i = 0; i < joints.size(); ++i)
+      {
+        variable_indices_.push_back(group->getVariableGroupIndex(joints[i]->getVariableNames()[0]));
+        // continuous revolute joints have the bounds [-pi, pi]
+        const moveit::core::VariableBounds& b = (*joint_bounds)[i]->front();
+        const bool single_variable = joints[i]->getType() == moveit::core::JointModel::REVOLUTE ||
+                                     joints[i]->getType() == moveit::core::JointModel::PRISMATIC;
+        if (single_variable && std::isfinite(b.min_position_) && std::isfinite(b.max_position_))
+          quasi_joints_.push_back(i);
+        else
+          random_joints_.push_back(i);
+      }
+      halton_ = moveit::core::HaltonSequence(quasi_joints_.size());
+      std::vector<double> offsets(quasi_joints_.size());
+      for (double& offset : offsets)
+        offset = moveit_rng_.uniform01();
+      halton_.setOffsets(offsets);
+      point_.resize(quasi_joints_.size());
+    }
+
+    void sampleUniform(ompl::base::State* state) override
+    {
+      const std::vector<const moveit::core::JointModel*>& joints = joint_model_group_->getActiveJointModels();
+      double* values = state->as<StateType>()->values;
+      halton_.next(point_.data());
+      for (std::size_t i = 0; i < quasi_joints_.size(); ++i)
+      {
+        const std::size_t j = quasi_joints_[i];
+        const moveit::core::VariableBounds& b = (*joint_bounds_)[j]->front();
+        values[variable_indices_[j]] = b.min_position_ + point_[i] * (b.max_position_ - b.min_position_);
+      }
+      for (std::size_t j : random_joints_)
+        joints[j]->getVariableRandomPositions(moveit_rng_, values + variable_indices_[j], *(*joint_bounds_)[j]);
+      state->as<StateType>()->clearKnownInformation();
+    }
+
+    void sampleUniformNear(ompl::base::State* state, const ompl::base::State* near, const double distance) override
+    {
+      joint_model_group_->getVariableRandomPositionsNearBy(moveit_rng_, state->as<StateType>()->values, *joint_bounds_,
+                                                           near->as<StateType>()->values, distance);
+      state->as<StateType>()->clearKnownInformation();
+    }
+
+    void sampleGaussian(ompl::base::State* state, const ompl::base::State* mean, const double stdDev) override
+    {
+      sampleUniformNear(state, mean, rng_.gaussian(0.0, stdDev));
+    }
+
+  protected:
+    random_numbers::RandomNumberGenerator moveit_rng_;
+    const moveit::core::JointModelGroup* joint_model_group_;
+    const moveit::core::JointBoundsVector* joint_bounds_;
+    std::vector<int> variable_indices_;       // index of the first variable of each active joint in the group
+    std::vector<std::size_t> quasi_joints_;   // active joints sampled from the Halton sequence
+    std::vector<std::size_t> random_joints_;  // active joints sampled with moveit_rng_
+    moveit::core::HaltonSequence halton_;
+    std::vector<double> point_;
+  };
+
+  return ompl::base::StateSamplerPtr(static_cast<ompl::base::StateSampler*>(
+      new QuasiRandomStateSampler(this, spec_.joint_model_group_, &spec_.joint_bounds_)));
+}
+
 void ompl_interface::ModelBasedStateSpace::printSettings(std::ostream& out) const
 {
   out << "ModelBasedStateSpace '" << getName() << "' at " << this << std::endl;
@@ -321,7 +475,9 @@ void ompl_interface::ModelBasedStateSpace::printState(const ompl::base::State* s
 void ompl_interface::ModelBasedStateSpace::copyToRobotState(moveit::core::RobotState& rstate,
                                                             const ompl::base::State* state) const
 {
-  rstate.setJointGroupPositions(spec_.joint_model_group_, state->as<StateType>()->values);
+  // consecutive states often share joint values, e.g. the links before the first moving joint of an interpolated
+  // motion, so only the transforms below the changed joints are updated
+  rstate.setJointGroupPositionsIfChanged(spec_.joint_model_group_, state->as<StateType>()->values);
   rstate.update();
 }
 
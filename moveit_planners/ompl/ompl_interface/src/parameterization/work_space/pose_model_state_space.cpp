@@ -37,6 +37,7 @@
 #include <moveit/ompl_interface/parameterization/work_space/pose_model_state_space.h>
 #include <ompl/base/spaces/SE3StateSpace.h>
 #include <moveit/profiler/profiler.h>
+#include <moveit/utils/memory_pool.h>
 
 #include <utility>
 
@@ -90,8 +91,8 @@ double ompl_interface::PoseModelStateSpace::getMaximumExtent() const
 ompl::base::State* ompl_interface::PoseModelStateSpace::allocState() const
 {
   auto* state = new StateType();
-  state->values =
-      new double[variable_count_];  // need to allocate this here since ModelBasedStateSpace::allocState() is not called
+  // need to allocate this here since ModelBasedStateSpace::allocState() is not called
+  state->values = static_cast<double*>(moveit::core::allocateCachedBlock(state_values_size_));
   state->poses = new ompl::base::SE3StateSpace::StateType*[poses_.size()];
   for (std::size_t i = 0; i < poses_.size(); ++i)
     state->poses[i] = poses_[i].state_space_->allocState()->as<ompl::base::SE3StateSpace::StateType>();
@@ -37,6 +37,12 @@
 #include <moveit/ompl_interface/planning_context_manager.h>
 #include <moveit/robot_state/conversions.h>
 #include <moveit/profiler/profiler.h>
+#include <boost/filesystem.hpp>
+#include <boost/iostreams/device/array.hpp>
+#include <boost/iostreams/device/mapped_file.hpp>
+#include <boost/iostreams/stream.hpp>
+#include <algorithm>
+#include <fstream>
 #include <utility>
 
 #include <ompl/geometric/planners/AnytimePathShortening.h>
@@ -67,8 +73,11 @@
 #include <ompl/geometric/planners/prm/SPARS.h>
 #include <ompl/geometric/planners/prm/SPARStwo.h>
 
+#include <moveit/ompl_interface/parameterization/joint_space/constrained_planning_state_space_factory.h>
+#include <moveit/ompl_interface/parameterization/joint_space/constrained_planning_state_space.h>
 #include <moveit/ompl_interface/parameterization/joint_space/joint_model_state_space_factory.h>
 #include <moveit/ompl_interface/parameterization/joint_space/joint_model_state_space.h>
+#include <moveit/ompl_interface/detail/ompl_constraints.h>
 #include <moveit/ompl_interface/parameterization/work_space/pose_model_state_space_factory.h>
 
 using namespace std::placeholders;
@@ -81,19 +90,29 @@ struct PlanningContextManager::CachedContexts
 {
   std::map<std::pair<std::string, std::string>, std::vector<ModelBasedPlanningContextPtr> > contexts_;
   std::mutex lock_;
+  PlanningContextManager::CachedContextStatistics statistics_;
 };
 
 }  // namespace ompl_interface
 
 ompl_interface::MultiQueryPlannerAllocator::~MultiQueryPlannerAllocator()
 {
+  if (expansion_thread_.joinable())
+  {
+    {
+      std::unique_lock<std::mutex> lock(lock_);
+      stop_expansion_ = true;
+    }
+    expansion_condition_.notify_all();
+    expansion_thread_.join();
+  }
+
   // Store all planner data
+  std::unique_lock<std::mutex> lock(lock_);
   for (const auto& entry : planner_data_storage_paths_)
   {
     RCLCPP_INFO(LOGGER, "Storing planner data");
-    ob::PlannerData data(planners_[entry.first]->getSpaceInformation());
-    planners_[entry.first]->getPlannerData(data);
-    storage_.store(data, entry.second.c_str());
+    storePlannerData(*planners_[entry.first], entry.second);
   }
 }
 
@@ -112,10 +131,11 @@ ompl::base::PlannerPtr ompl_interface::MultiQueryPlannerAllocator::allocatePlann
   }
   if (multi_query_planning_enabled)
   {
-    // If we already have an instance, use that one
+    std::unique_lock<std::mutex> lock(lock_);
+    // If we already have an instance, share its roadmap
     auto planner_map_it = planners_.find(new_name);
     if (planner_map_it != planners_.end())
-      return planner_map_it->second;
+      return std::make_shared<SharedRoadmapPlanner>(si, planner_map_it->second);
 
     // Certain multi-query planners allow loading and storing the generated planner data. This feature can be
     // selectively enabled for loading and storing using the bool parameters 'load_planner_data' and
@@ -143,10 +163,40 @@ ompl::base::PlannerPtr ompl_interface::MultiQueryPlannerAllocator::allocatePlann
       planner_data_path = it->second;
       cfg.erase(it);
     }
-    // Store planner instance for multi-query use
-    planners_[new_name] =
-        allocatePlannerImpl<T>(si, new_name, spec, load_planner_data, store_planner_data, planner_data_path);
-    return planners_[new_name];
+    // PRM and PRM* roadmaps can be grown in the background every 'roadmap_expansion_period' seconds, for
+    // 'roadmap_expansion_time' seconds. Stored roadmaps are then also written after each expansion.
+    it = cfg.find("roadmap_expansion_period");
+    double roadmap_expansion_period = 0.0;
+    if (it != cfg.end())
+    {
+      roadmap_expansion_period = boost::lexical_cast<double>(it->second);
+      cfg.erase(it);
+    }
+    it = cfg.find("roadmap_expansion_time");
+    double roadmap_expansion_time = 1.0;
+    if (it != cfg.end())
+    {
+      roadmap_expansion_time = boost::lexical_cast<double>(it->second);
+      cfg.erase(it);
+    }
+    // Store planner instance for multi-query use. The planner runs on its own space information, so that all
+    // contexts of this configuration can use it with their own state validity checker.
+    auto roadmap = std::make_shared<SharedRoadmap>(allocatePlannerImpl<T>(
+        SharedRoadmap::createSpaceInformation(si), new_name, spec, load_planner_data, store_planner_data,
+        planner_data_path));
+    planners_[new_name] = roadmap;
+    if (roadmap_expansion_period > 0.0)
+    {
+      const std::chrono::duration<double> period(roadmap_expansion_period);
+      roadmap_expansions_[new_name] = RoadmapExpansion{
+        period, roadmap_expansion_time,
+        std::chrono::steady_clock::now() + std::chrono::duration_cast<std::chrono::steady_clock::duration>(period)
+      };
+      if (!expansion_thread_.joinable())
+        expansion_thread_ = std::thread(&MultiQueryPlannerAllocator::expandRoadmaps, this);
+      expansion_condition_.notify_all();
+    }
+    return std::make_shared<SharedRoadmapPlanner>(si, roadmap);
   }
   else
   {
@@ -166,12 +216,14 @@ ompl::base::PlannerPtr ompl_interface::MultiQueryPlannerAllocator::allocatePlann
   {
     RCLCPP_INFO(LOGGER, "Loading planner data");
     ob::PlannerData data(si);
-    storage_.load(file_path.c_str(), data);
-    planner.reset(allocatePersistentPlanner<T>(data));
-    if (!planner)
-      RCLCPP_ERROR(LOGGER,
-                   "Creating a '%s' planner from persistent data is not supported. Going to create a new instance.",
-                   new_name.c_str());
+    if (loadPlannerData(file_path, data))
+    {
+      planner.reset(allocatePersistentPlanner<T>(data));
+      if (!planner)
+        RCLCPP_ERROR(LOGGER,
+                     "Creating a '%s' planner from persistent data is not supported. Going to create a new instance.",
+                     new_name.c_str());
+    }
   }
   if (!planner)
     planner.reset(new T(si));
@@ -184,6 +236,81 @@ ompl::base::PlannerPtr ompl_interface::MultiQueryPlannerAllocator::allocatePlann
   return planner;
 }
 
+bool ompl_interface::MultiQueryPlannerAllocator::loadPlannerData(const std::string& file_path, ob::PlannerData& data)
+{
+  try
+  {
+    // several processes can map the same file, the pages are shared between them
+    boost::iostreams::mapped_file_source file(file_path);
+    boost::iostreams::stream<boost::iostreams::array_source> in(file.data(), file.size());
+    storage_.load(in, data);
+  }
+  catch (std::exception& e)
+  {
+    RCLCPP_ERROR(LOGGER, "Unable to load planner data from '%s': %s", file_path.c_str(), e.what());
+    return false;
+  }
+  return true;
+}
+
+bool ompl_interface::MultiQueryPlannerAllocator::storePlannerData(const SharedRoadmap& roadmap,
+                                                                   const std::string& file_path)
+{
+  ob::PlannerData data(roadmap.getPlanner()->getSpaceInformation());
+  roadmap.getPlannerData(data);
+  try
+  {
+    const boost::filesystem::path temp_path = boost::filesystem::unique_path(file_path + ".%%%%-%%%%");
+    {
+      std::ofstream out(temp_path.string(), std::ios::binary);
+      storage_.store(data, out);
+      if (!out)
+      {
+        RCLCPP_ERROR(LOGGER, "Unable to write planner data to '%s'", temp_path.string().c_str());
+        boost::filesystem::remove(temp_path);
+        return false;
+      }
+    }
+    boost::filesystem::rename(temp_path, file_path);
+  }
+  catch (boost::filesystem::filesystem_error& e)
+  {
+    RCLCPP_ERROR(LOGGER, "Unable to store planner data to '%s': %s", file_path.c_str(), e.what());
+    return false;
+  }
+  return true;
+}
+
+void ompl_interface::MultiQueryPlannerAllocator::expandRoadmaps()
+{
+  const ob::PlannerTerminationCondition stop_ptc([this] { return stop_expansion_.load(); });
+  std::unique_lock<std::mutex> lock(lock_);
+  while (!stop_expansion_)
+  {
+    auto wake_up = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+    // entries are never removed, so the iterators stay valid while the lock is released
+    for (auto& entry : roadmap_expansions_)
+    {
+      RoadmapExpansion& expansion = entry.second;
+      if (expansion.next_ <= std::chrono::steady_clock::now() && !stop_expansion_)
+      {
+        const SharedRoadmapPtr roadmap = planners_[entry.first];
+        lock.unlock();
+        const bool expanded = roadmap->expand(
+            ob::plannerOrTerminationCondition(stop_ptc, ob::timedPlannerTerminationCondition(expansion.duration_)));
+        lock.lock();
+        auto path_it = planner_data_storage_paths_.find(entry.first);
+        if (expanded && path_it != planner_data_storage_paths_.end() && !stop_expansion_)
+          storePlannerData(*roadmap, path_it->second);
+        expansion.next_ = std::chrono::steady_clock::now() +
+                          std::chrono::duration_cast<std::chrono::steady_clock::duration>(expansion.period_);
+      }
+      wake_up = std::min(wake_up, expansion.next_);
+    }
+    expansion_condition_.wait_until(lock, wake_up, [this] { return stop_expansion_.load(); });
+  }
+}
+
 // default implementation
 template <typename T>
 inline ompl::base::Planner*
@@ -233,6 +360,7 @@ ompl_interface::PlanningContextManager::PlanningContextManager(moveit::core::Rob
   , max_planning_threads_(4)
   , max_solution_segment_length_(0.0)
   , minimum_waypoint_count_(2)
+  , max_cached_contexts_(0)
 {
   cached_contexts_.reset(new CachedContexts());
   registerDefaultPlanners();
@@ -296,6 +424,7 @@ void ompl_interface::PlanningContextManager::registerDefaultStateSpaces()
 {
   registerStateSpaceFactory(ModelBasedStateSpaceFactoryPtr(new JointModelStateSpaceFactory()));
   registerStateSpaceFactory(ModelBasedStateSpaceFactoryPtr(new PoseModelStateSpaceFactory()));
+  registerStateSpaceFactory(ModelBasedStateSpaceFactoryPtr(new ConstrainedPlanningStateSpaceFactory()));
 }
 
 ompl_interface::ConfiguredPlannerSelector ompl_interface::PlanningContextManager::getPlannerSelector() const
@@ -311,13 +440,16 @@ void ompl_interface::PlanningContextManager::setPlannerConfigurations(
 
 ompl_interface::ModelBasedPlanningContextPtr ompl_interface::PlanningContextManager::getPlanningContext(
     const planning_interface::PlannerConfigurationSettings& config,
-    const StateSpaceFactoryTypeSelector& factory_selector, const moveit_msgs::msg::MotionPlanRequest& /*req*/) const
+    const StateSpaceFactoryTypeSelector& factory_selector, const moveit_msgs::msg::MotionPlanRequest& req) const
 {
   const ompl_interface::ModelBasedStateSpaceFactoryPtr& factory = factory_selector(config.group);
 
   // Check for a cached planning context
   ModelBasedPlanningContextPtr context;
 
+  // the constrained state space depends on the path constraints of the request, so it is not reused
+  const bool cacheable = factory->getType() != ConstrainedPlanningStateSpace::PARAMETERIZATION_TYPE;
+  if (cacheable)
   {
     std::unique_lock<std::mutex> slock(cached_contexts_->lock_);
     auto cached_contexts = cached_contexts_->contexts_.find(std::make_pair(config.name, factory->getType()));
@@ -326,31 +458,28 @@ ompl_interface::ModelBasedPlanningContextPtr ompl_interface::PlanningContextMana
       for (const ModelBasedPlanningContextPtr& cached_context : cached_contexts->second)
         if (cached_context.unique())
         {
-          RCLCPP_DEBUG(LOGGER, "Reusing cached planning context");
           context = cached_context;
           break;
         }
     }
+    CachedContextStatistics& statistics = cached_contexts_->statistics_;
+    ++(context ? statistics.hits : statistics.misses);
+    RCLCPP_DEBUG(LOGGER, "%s planning context (cache hits: %zu, misses: %zu)", context ? "Reusing cached" : "No idle",
+                 statistics.hits, statistics.misses);
   }
 
   // Create a new planning context
   if (!context)
   {
-    ModelBasedStateSpaceSpecification space_spec(robot_model_, config.group);
-    ModelBasedPlanningContextSpecification context_spec;
-    context_spec.config_ = config.config;
-    context_spec.planner_selector_ = getPlannerSelector();
-    context_spec.constraint_sampler_manager_ = constraint_sampler_manager_;
-    context_spec.state_space_ = factory->getNewStateSpace(space_spec);
-
-    // Choose the correct simple setup type to load
-    context_spec.ompl_simple_setup_.reset(new ompl::geometric::SimpleSetup(context_spec.state_space_));
-
     RCLCPP_DEBUG(LOGGER, "Creating new planning context");
-    context.reset(new ModelBasedPlanningContext(config.name, context_spec));
+    context = createPlanningContext(config, factory, req);
+    if (cacheable)
     {
       std::unique_lock<std::mutex> slock(cached_contexts_->lock_);
-      cached_contexts_->contexts_[std::make_pair(config.name, factory->getType())].push_back(context);
+      std::vector<ModelBasedPlanningContextPtr>& cached =
+          cached_contexts_->contexts_[std::make_pair(config.name, factory->getType())];
+      if (max_cached_contexts_ == 0 || cached.size() < max_cached_contexts_)
+        cached.push_back(context);
     }
   }
 
@@ -367,6 +496,78 @@ ompl_interface::ModelBasedPlanningContextPtr ompl_interface::PlanningContextMana
   return context;
 }
 
+ompl_interface::PlanningContextManager::CachedContextStatistics
+ompl_interface::PlanningContextManager::getCachedContextStatistics() const
+{
+  std::unique_lock<std::mutex> slock(cached_contexts_->lock_);
+  return cached_contexts_->statistics_;
+}
+
+ompl_interface::ModelBasedPlanningContextPtr ompl_interface::PlanningContextManager::createPlanningContext(
+    const planning_interface::PlannerConfigurationSettings& config, const ModelBasedStateSpaceFactoryPtr& factory,
+    const moveit_msgs::msg::MotionPlanRequest& req) const
+{
+  ModelBasedStateSpaceSpecification space_spec(robot_model_, config.group);
+  ModelBasedPlanningContextSpecification context_spec;
+  context_spec.config_ = config.config;
+  context_spec.planner_selector_ = getPlannerSelector();
+  context_spec.constraint_sampler_manager_ = constraint_sampler_manager_;
+  context_spec.state_space_ = factory->getNewStateSpace(space_spec);
+
+  // Choose the correct simple setup type to load
+  if (factory->getType() == ConstrainedPlanningStateSpace::PARAMETERIZATION_TYPE)
+  {
+    // planners work in a projected state space that wraps the joint space; the constraint function is given the
+    // configured path constraints when the context is set up for the request
+    RCLCPP_DEBUG(LOGGER, "Planning on the manifold of the path constraints");
+    context_spec.constrained_state_space_ = std::make_shared<ompl::base::ProjectedStateSpace>(
+        context_spec.state_space_,
+        std::make_shared<KinematicConstraintManifold>(space_spec.joint_model_group_, req.path_constraints));
+    context_spec.ompl_simple_setup_ = std::make_shared<ompl::geometric::SimpleSetup>(
+        std::make_shared<ompl::base::ConstrainedSpaceInformation>(context_spec.constrained_state_space_));
+  }
+  else
+    context_spec.ompl_simple_setup_.reset(new ompl::geometric::SimpleSetup(context_spec.state_space_));
+
+  return ModelBasedPlanningContextPtr(new ModelBasedPlanningContext(config.name, context_spec));
+}
+
+void ompl_interface::PlanningContextManager::prewarmPlanningContexts(unsigned int contexts_per_config)
+{
+  const moveit_msgs::msg::MotionPlanRequest req;  // the state space an unconstrained request is planned in
+  std::size_t created = 0;
+  for (const std::pair<const std::string, planning_interface::PlannerConfigurationSettings>& config : planner_configs_)
+  {
+    auto it = config.second.config.find("enforce_joint_model_state_space");
+    const ModelBasedStateSpaceFactoryPtr& factory =
+        it != config.second.config.end() && boost::lexical_cast<bool>(it->second) ?
+            getStateSpaceFactory1(config.second.group, JointModelStateSpace::PARAMETERIZATION_TYPE) :
+            getStateSpaceFactory2(config.second.group, req);
+    if (!factory)
+      continue;
+
+    const auto key = std::make_pair(config.second.name, factory->getType());
+    std::size_t missing;
+    {
+      std::unique_lock<std::mutex> slock(cached_contexts_->lock_);
+      const std::size_t cached = cached_contexts_->contexts_[key].size();
+      missing = cached < contexts_per_config ? contexts_per_config - cached : 0;
+    }
+
+    // construct outside of the lock, this is the expensive part
+    std::vector<ModelBasedPlanningContextPtr> contexts;
+    for (std::size_t i = 0; i < missing; ++i)
+      contexts.push_back(createPlanningContext(config.second, factory, req));
+
+    std::unique_lock<std::mutex> slock(cached_contexts_->lock_);
+    std::vector<ModelBasedPlanningContextPtr>& cached = cached_contexts_->contexts_[key];
+    cached.insert(cached.end(), contexts.begin(), contexts.end());
+    created += contexts.size();
+  }
+  RCLCPP_INFO(LOGGER, "Pre-built %zu planning contexts for %zu planner configurations", created,
+              planner_configs_.size());
+}
+
 const ompl_interface::ModelBasedStateSpaceFactoryPtr&
 ompl_interface::PlanningContextManager::getStateSpaceFactory1(const std::string& /* dummy */,
                                                               const std::string& factory_type) const
@@ -463,10 +664,19 @@ ompl_interface::ModelBasedPlanningContextPtr ompl_interface::PlanningContextMana
   // However consecutive IK solutions are not checked for proximity at the moment and sometimes happen to be flipped,
   // leading to invalid trajectories. This workaround lets the user prevent this problem by forcing rejection sampling
   // in JointModelStateSpace.
+  //
+  // Setting 'enforce_constrained_state_space' instead plans on the manifold of the path constraints, projecting
+  // states onto it, if the group and the path constraints can be represented that way.
   StateSpaceFactoryTypeSelector factory_selector;
   auto it = pc->second.config.find("enforce_joint_model_state_space");
+  auto constrained_it = pc->second.config.find("enforce_constrained_state_space");
 
-  if (it != pc->second.config.end() && boost::lexical_cast<bool>(it->second))
+  if (constrained_it != pc->second.config.end() && boost::lexical_cast<bool>(constrained_it->second) &&
+      state_space_factories_.at(ConstrainedPlanningStateSpace::PARAMETERIZATION_TYPE)
+              ->canRepresentProblem(req.group_name, req, robot_model_) > 0)
+    factory_selector = std::bind(&PlanningContextManager::getStateSpaceFactory1, this, std::placeholders::_1,
+                                 ConstrainedPlanningStateSpace::PARAMETERIZATION_TYPE);
+  else if (it != pc->second.config.end() && boost::lexical_cast<bool>(it->second))
     factory_selector = std::bind(&PlanningContextManager::getStateSpaceFactory1, this, std::placeholders::_1,
                                  JointModelStateSpace::PARAMETERIZATION_TYPE);
   else
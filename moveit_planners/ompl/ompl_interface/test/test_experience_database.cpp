@@ -0,0 +1,129 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, PickNik LLC
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik LLC nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include <moveit/ompl_interface/detail/experience_database.h>
+#include <moveit/utils/robot_model_test_utils.h>
+#include <geometric_shapes/shapes.h>
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <string>
+
+using ompl_interface::ExperienceDatabase;
+
+namespace
+{
+ExperienceDatabase::Waypoints makePath(double start, double goal)
+{
+  return ExperienceDatabase::Waypoints{ { start, 0.0 }, { 0.5 * (start + goal), 1.0 }, { goal, 0.0 } };
+}
+}  // namespace
+
+TEST(ExperienceDatabase, KeysByGroupAndScene)
+{
+  ExperienceDatabase database;
+  database.addPath("arm", 1, makePath(0.0, 1.0));
+  database.addPath("arm", 2, makePath(0.0, 2.0));
+  database.addPath("hand", 1, makePath(0.0, 3.0));
+
+  std::vector<ExperienceDatabase::Experience> experiences = database.getExperiences("arm", 1);
+  ASSERT_EQ(experiences.size(), 1u);
+  EXPECT_EQ(experiences[0].waypoints_, makePath(0.0, 1.0));
+  EXPECT_TRUE(database.getExperiences("arm", 3).empty());
+  EXPECT_EQ(database.getExperienceCount(), 3u);
+}
+
+TEST(ExperienceDatabase, ReplacesDuplicatesAndDropsOldest)
+{
+  ExperienceDatabase database(2);
+  database.addPath("arm", 1, makePath(0.0, 1.0));
+  ExperienceDatabase::Waypoints detour = makePath(0.0, 1.0);
+  detour[1][1] = 2.0;
+  database.addPath("arm", 1, detour);
+  std::vector<ExperienceDatabase::Experience> experiences = database.getExperiences("arm", 1);
+  ASSERT_EQ(experiences.size(), 1u);
+  EXPECT_EQ(experiences[0].waypoints_, detour);
+
+  // paths with a single state are ignored
+  database.addPath("arm", 1, ExperienceDatabase::Waypoints{ { 0.0, 0.0 } });
+  EXPECT_EQ(database.getExperienceCount(), 1u);
+
+  database.addPath("arm", 1, makePath(1.0, 2.0));
+  database.addPath("arm", 1, makePath(2.0, 3.0));
+  experiences = database.getExperiences("arm", 1);
+  ASSERT_EQ(experiences.size(), 2u);
+  EXPECT_EQ(experiences[0].waypoints_, makePath(2.0, 3.0));
+  EXPECT_EQ(experiences[1].waypoints_, makePath(1.0, 2.0));
+}
+
+TEST(ExperienceDatabase, SaveAndLoad)
+{
+  ExperienceDatabase database;
+  database.addPath("arm", 7, makePath(0.1, 1.0 / 3.0));
+  database.addPath("hand", 8, makePath(0.2, 2.0));
+
+  const std::string filename = ::testing::TempDir() + "experiences.txt";
+  ASSERT_TRUE(database.save(filename));
+  ExperienceDatabase loaded;
+  ASSERT_TRUE(loaded.load(filename));
+  std::remove(filename.c_str());
+
+  EXPECT_EQ(loaded.getExperienceCount(), 2u);
+  ASSERT_EQ(loaded.getExperiences("arm", 7).size(), 1u);
+  EXPECT_EQ(loaded.getExperiences("arm", 7)[0].waypoints_, makePath(0.1, 1.0 / 3.0));
+  EXPECT_FALSE(loaded.load(filename));
+}
+
+TEST(ExperienceDatabase, SceneHash)
+{
+  planning_scene::PlanningScene scene(moveit::core::loadTestingRobotModel("panda"));
+  const std::size_t empty_hash = ExperienceDatabase::computeSceneHash(scene);
+
+  Eigen::Isometry3d pose = Eigen::Isometry3d::Identity();
+  pose.translation().x() = 0.5;
+  scene.getWorldNonConst()->addToObject("box", std::make_shared<const shapes::Box>(0.1, 0.1, 0.1), pose);
+  const std::size_t box_hash = ExperienceDatabase::computeSceneHash(scene);
+  EXPECT_NE(box_hash, empty_hash);
+
+  // the same layout gives the same hash, a moved object a different one
+  EXPECT_EQ(ExperienceDatabase::computeSceneHash(*scene.diff()), box_hash);
+  pose.translation().x() = 0.6;
+  scene.getWorldNonConst()->moveShapeInObject("box", scene.getWorld()->getObject("box")->shapes_[0], pose);
+  EXPECT_NE(ExperienceDatabase::computeSceneHash(scene), box_hash);
+}
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
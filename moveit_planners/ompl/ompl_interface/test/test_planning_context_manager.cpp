@@ -96,6 +96,15 @@ public:
 
     // see if it returns the expected planning context
     auto pc = pcm.getPlanningContext(planning_scene_, request, error_code, node_handle_, false);
+    EXPECT_EQ(pcm.getCachedContextStatistics().hits, 0u);
+    EXPECT_EQ(pcm.getCachedContextStatistics().misses, 1u);
+
+    // a context that is still in use is not handed out again, an idle one is
+    EXPECT_NE(pcm.getPlanningContext(planning_scene_, request, error_code, node_handle_, false), pc);
+    EXPECT_EQ(pcm.getCachedContextStatistics().misses, 2u);
+    pc.reset();
+    pc = pcm.getPlanningContext(planning_scene_, request, error_code, node_handle_, false);
+    EXPECT_EQ(pcm.getCachedContextStatistics().hits, 1u);
 
     // the planning context should have a simple setup created
     EXPECT_NE(pc->getOMPLSimpleSetup(), nullptr);
@@ -111,6 +120,27 @@ public:
     ASSERT_TRUE(pc->solve(res));
   }
 
+  void testCoarseToFine(const std::vector<double>& start, const std::vector<double>& goal)
+  {
+    // the active detector stands in for a coarse one, so the first pass solves the problem
+    planning_interface::PlannerConfigurationSettings pconfig_settings;
+    pconfig_settings.group = group_name_;
+    pconfig_settings.name = group_name_;
+    pconfig_settings.config = { { "enforce_joint_model_state_space", "0" },
+                                { "coarse_collision_detector", planning_scene_->getActiveCollisionDetectorName() } };
+
+    planning_interface::PlannerConfigurationMap pconfig_map{ { pconfig_settings.name, pconfig_settings } };
+    moveit_msgs::MoveItErrorCodes error_code;
+    planning_interface::MotionPlanRequest request = createRequest(start, goal);
+
+    ompl_interface::PlanningContextManager pcm(robot_model_, constraint_sampler_manager_);
+    pcm.setPlannerConfigurations(pconfig_map);
+    auto pc = pcm.getPlanningContext(planning_scene_, request, error_code, node_handle_, false);
+
+    planning_interface::MotionPlanDetailedResponse res;
+    ASSERT_TRUE(pc->solve(res));
+  }
+
   void testPathConstraints(const std::vector<double>& start, const std::vector<double>& goal)
   {
     // create all the test specific input necessary to make the getPlanningContext call possible
@@ -325,6 +355,11 @@ TEST_F(PandaTestPlanningContext, testPathConstraints)
   testPathConstraints({ 0, -0.785, 0, -2.356, 0, 1.571, 0.785 }, { 0, -0.785, 0, -2.356, 0, 1.571, 0.685 });
 }
 
+TEST_F(PandaTestPlanningContext, testCoarseToFine)
+{
+  testCoarseToFine({ 0, -0.785, 0, -2.356, 0, 1.571, 0.785 }, { 0, -0.785, 0, -2.356, 0, 1.571, 0.685 });
+}
+
 /***************************************************************************
  * Run all tests on the Fanuc robot
  * ************************************************************************/
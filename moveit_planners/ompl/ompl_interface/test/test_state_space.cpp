@@ -185,6 +185,75 @@ TEST_F(LoadPlanningModelsPr2, StateSpaceCopy)
   joint_model_state_space.freeState(state);
 }
 
+TEST_F(LoadPlanningModelsPr2, StateSpaceDistanceAndInterpolation)
+{
+  // the right arm has continuous joints, which use the flat values implementation
+  ompl_interface::ModelBasedStateSpaceSpecification spec(robot_model_, "right_arm");
+  ompl_interface::JointModelStateSpace joint_model_state_space(spec);
+  joint_model_state_space.setup();
+  const moveit::core::JointModelGroup* joint_model_group = joint_model_state_space.getJointModelGroup();
+
+  ompl::base::State* state1 = joint_model_state_space.allocState();
+  ompl::base::State* state2 = joint_model_state_space.allocState();
+  ompl::base::State* state = joint_model_state_space.allocState();
+  std::vector<double> expected(joint_model_group->getVariableCount());
+  ompl::base::StateSamplerPtr sampler = joint_model_state_space.allocDefaultStateSampler();
+  for (int i = 0; i < 100; ++i)
+  {
+    sampler->sampleUniform(state1);
+    sampler->sampleUniform(state2);
+    const double* values1 = state1->as<ompl_interface::ModelBasedStateSpace::StateType>()->values;
+    const double* values2 = state2->as<ompl_interface::ModelBasedStateSpace::StateType>()->values;
+    EXPECT_NEAR(joint_model_state_space.distance(state1, state2), joint_model_group->distance(values1, values2),
+                1e-12);
+
+    const double t = i / 99.0;
+    joint_model_state_space.interpolate(state1, state2, t, state);
+    joint_model_group->interpolate(values1, values2, t, expected.data());
+    for (std::size_t j = 0; j < expected.size(); ++j)
+      EXPECT_NEAR(state->as<ompl_interface::ModelBasedStateSpace::StateType>()->values[j], expected[j], 1e-12);
+  }
+
+  // weights multiply the distance of each joint
+  joint_model_state_space.setJointDistanceWeights(
+      std::vector<double>(joint_model_group->getActiveJointModels().size(), 2.0));
+  const double* values1 = state1->as<ompl_interface::ModelBasedStateSpace::StateType>()->values;
+  const double* values2 = state2->as<ompl_interface::ModelBasedStateSpace::StateType>()->values;
+  EXPECT_NEAR(joint_model_state_space.distance(state1, state2), 2.0 * joint_model_group->distance(values1, values2),
+              1e-12);
+
+  joint_model_state_space.freeState(state1);
+  joint_model_state_space.freeState(state2);
+  joint_model_state_space.freeState(state);
+}
+
+TEST_F(LoadPlanningModelsPr2, QuasiRandomStateSampler)
+{
+  ompl_interface::ModelBasedStateSpaceSpecification spec(robot_model_, "right_arm");
+  ompl_interface::JointModelStateSpace joint_model_state_space(spec);
+  joint_model_state_space.setup();
+  const moveit::core::VariableBounds& bounds = joint_model_state_space.getJointsBounds()[0]->front();
+
+  // the first joint is sampled in base 2, so 256 samples fill 16 equal bins almost exactly
+  ompl::base::State* state = joint_model_state_space.allocState();
+  ompl::base::StateSamplerPtr sampler = joint_model_state_space.allocQuasiRandomStateSampler();
+  std::vector<int> bins(16, 0);
+  for (int i = 0; i < 256; ++i)
+  {
+    sampler->sampleUniform(state);
+    EXPECT_TRUE(joint_model_state_space.satisfiesBounds(state));
+    const double value = state->as<ompl_interface::ModelBasedStateSpace::StateType>()->values[0];
+    const double fraction = (value - bounds.min_position_) / (bounds.max_position_ - bounds.min_position_);
+    ++bins[std::min(static_cast<int>(16 * fraction), 15)];
+  }
+  for (int count : bins)
+  {
+    EXPECT_GE(count, 15);
+    EXPECT_LE(count, 17);
+  }
+  joint_model_state_space.freeState(state);
+}
+
 int main(int argc, char** argv)
 {
   testing::InitGoogleTest(&argc, argv);
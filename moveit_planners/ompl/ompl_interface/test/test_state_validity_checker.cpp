@@ -39,9 +39,10 @@
  *        - States inside and outside joint limits.
  *        - States that are in self-collision.
  *        - Position constraints on the robot's end-effector link.
+ *        - The TieredStateValidityChecker against the exact checker, with an object in the environment.
  *
  *    It does not yet test:
- *        - Collision with objects in the environment.
+ *        - Collision with objects in the environment for the exact checker alone.
  *        - Orientation constraints, visibility constraints, ...
  *        - A user-specified feasibility function in the planning scene.
  *
@@ -60,6 +61,7 @@
 #include <moveit/ompl_interface/parameterization/joint_space/joint_model_state_space.h>
 #include <moveit/planning_scene/planning_scene.h>
 
+#include <geometric_shapes/shapes.h>
 #include <ompl/geometric/SimpleSetup.h>
 
 /** \brief This flag sets the verbosity level for the state validity checker. **/
@@ -190,6 +192,62 @@ public:
     EXPECT_FALSE(checker->isValid(ompl_state.get()));
   }
 
+  /** This test compares the tiered checker to the exact one, with a box around the end-effector of the given state **/
+  void testTieredStateValidityChecker(const std::vector<double>& position_in_joint_limits)
+  {
+    robot_state_->setJointGroupPositions(joint_model_group_, position_in_joint_limits);
+    planning_scene_->getWorldNonConst()->addToObject("box", std::make_shared<shapes::Box>(0.2, 0.2, 0.2),
+                                                     robot_state_->getGlobalLinkTransform(ee_link_name_));
+
+    auto checker = std::make_shared<ompl_interface::StateValidityChecker>(planning_context_.get());
+    auto tiered_checker = std::make_shared<ompl_interface::TieredStateValidityChecker>(planning_context_.get());
+    checker->setVerbose(VERBOSE);
+    tiered_checker->setVerbose(VERBOSE);
+
+    ompl::base::ScopedState<> ompl_state(state_space_);
+    state_space_->copyToOMPLState(ompl_state.get(), *robot_state_);
+
+    // the end-effector is inside the box
+    EXPECT_FALSE(tiered_checker->isValid(ompl_state.get()));
+
+    ompl::base::StateSamplerPtr sampler = state_space_->allocDefaultStateSampler();
+    for (int i = 0; i < 100; ++i)
+    {
+      sampler->sampleUniform(ompl_state.get());
+      ompl_state->as<ompl_interface::JointModelStateSpace::StateType>()->clearKnownInformation();
+      const bool valid = checker->isValid(ompl_state.get());
+      ompl_state->as<ompl_interface::JointModelStateSpace::StateType>()->clearKnownInformation();
+
+      ROS_DEBUG_STREAM_NAMED(LOGNAME, ompl_state.reals());
+
+      EXPECT_EQ(tiered_checker->isValid(ompl_state.get()), valid);
+    }
+  }
+
+  /** This test checks that the validity checker stores the position of the projection link in valid states **/
+  void testProjectionLinkCache(const std::vector<double>& position_in_limits)
+  {
+    planning_context_->setProjectionEvaluator("link(" + ee_link_name_ + ")");
+    ASSERT_NE(planning_context_->getProjectionLink(), nullptr);
+    auto checker = std::make_shared<ompl_interface::StateValidityChecker>(planning_context_.get());
+
+    robot_state_->setJointGroupPositions(joint_model_group_, position_in_limits);
+    robot_state_->update();
+    ompl::base::ScopedState<> ompl_state(state_space_);
+    state_space_->copyToOMPLState(ompl_state.get(), *robot_state_);
+    EXPECT_FALSE(ompl_state->as<ompl_interface::ModelBasedStateSpace::StateType>()->isLinkPositionKnown());
+
+    EXPECT_TRUE(checker->isValid(ompl_state.get()));
+    EXPECT_TRUE(ompl_state->as<ompl_interface::ModelBasedStateSpace::StateType>()->isLinkPositionKnown());
+
+    // the projection of the stored position matches the forward kinematics
+    Eigen::VectorXd projection(3);
+    state_space_->getDefaultProjection()->project(ompl_state.get(), projection);
+    const Eigen::Vector3d& expected = robot_state_->getGlobalLinkTransform(ee_link_name_).translation();
+    for (int i = 0; i < 3; ++i)
+      EXPECT_NEAR(projection[i], expected[i], 1e-9);
+  }
+
   /***************************************************************************
    * END Test implementation
    * ************************************************************************/
@@ -297,6 +355,16 @@ TEST_F(PandaValidity, testPathConstraints)
   testPathConstraints({ 0, -0.785, 0, -2.356, 0, 1.571, 0.785 });
 }
 
+TEST_F(PandaValidity, testTieredStateValidityChecker)
+{
+  testTieredStateValidityChecker({ 0, -0.785, 0, -2.356, 0, 1.571, 0.785 });
+}
+
+TEST_F(PandaValidity, testProjectionLinkCache)
+{
+  testProjectionLinkCache({ 0, -0.785, 0, -2.356, 0, 1.571, 0.785 });
+}
+
 /***************************************************************************
  * Run all tests on the Fanuc robot
  * ************************************************************************/
@@ -332,6 +400,16 @@ TEST_F(FanucTest, testPathConstraints)
   testPathConstraints({ 0.0, 0.0, 0.0, 0.0, 0.0, 0.0 });
 }
 
+TEST_F(FanucTest, testTieredStateValidityChecker)
+{
+  testTieredStateValidityChecker({ 0.0, 0.0, 0.0, 0.0, 0.0, 0.0 });
+}
+
+TEST_F(FanucTest, testProjectionLinkCache)
+{
+  testProjectionLinkCache({ 0.0, 0.0, 0.0, 0.0, 0.0, 0.0 });
+}
+
 /***************************************************************************
  * MAIN
  * ************************************************************************/
@@ -0,0 +1,127 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, PickNik LLC
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik LLC nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include <moveit/ompl_interface/detail/threadsafe_state_storage.h>
+#include <moveit/utils/robot_model_test_utils.h>
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <set>
+#include <thread>
+#include <vector>
+
+class TSStateStorageTest : public testing::Test
+{
+protected:
+  void SetUp() override
+  {
+    robot_model_ = moveit::core::loadTestingRobotModel("pr2");
+  }
+
+  moveit::core::RobotModelPtr robot_model_;
+};
+
+TEST_F(TSStateStorageTest, OneStatePerThread)
+{
+  ompl_interface::TSStateStorage storage(robot_model_);
+  moveit::core::RobotState* main_state = storage.getStateStorage();
+  EXPECT_EQ(main_state, storage.getStateStorage());
+
+  const std::size_t thread_count = 8;
+  std::vector<moveit::core::RobotState*> states(thread_count);
+  std::vector<std::thread> threads;
+  for (std::size_t i = 0; i < thread_count; ++i)
+    threads.emplace_back([&storage, &states, i] {
+      states[i] = storage.getStateStorage();
+      EXPECT_EQ(states[i], storage.getStateStorage());
+    });
+  for (std::thread& thread : threads)
+    thread.join();
+
+  std::set<moveit::core::RobotState*> unique_states(states.begin(), states.end());
+  unique_states.insert(main_state);
+  EXPECT_EQ(unique_states.size(), thread_count + 1);
+}
+
+TEST_F(TSStateStorageTest, ManyStorages)
+{
+  // exceed the number of thread-local slots, so slot eviction is exercised
+  std::vector<std::unique_ptr<ompl_interface::TSStateStorage>> storages;
+  std::vector<moveit::core::RobotState*> states;
+  for (std::size_t i = 0; i < 20; ++i)
+  {
+    storages.emplace_back(new ompl_interface::TSStateStorage(robot_model_));
+    states.push_back(storages.back()->getStateStorage());
+  }
+  for (std::size_t i = 0; i < storages.size(); ++i)
+    EXPECT_EQ(states[i], storages[i]->getStateStorage());
+
+  // a storage allocated after another one was destroyed must not see the destroyed storage's state
+  storages.front().reset(new ompl_interface::TSStateStorage(robot_model_));
+  EXPECT_NE(storages.front()->getStateStorage(), nullptr);
+  EXPECT_EQ(storages.front()->getStateStorage(), storages.front()->getStateStorage());
+}
+
+// Microbenchmark: throughput of getStateStorage() when called concurrently from 1 to 32 threads
+TEST_F(TSStateStorageTest, Scaling)
+{
+  ompl_interface::TSStateStorage storage(robot_model_);
+  const std::size_t calls_per_thread = 1e6;
+  for (std::size_t thread_count = 1; thread_count <= 32; thread_count *= 2)
+  {
+    std::atomic<std::size_t> checksum(0);
+    const auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (std::size_t i = 0; i < thread_count; ++i)
+      threads.emplace_back([&storage, &checksum, calls_per_thread] {
+        std::size_t local = 0;
+        for (std::size_t j = 0; j < calls_per_thread; ++j)
+          local += reinterpret_cast<std::uintptr_t>(storage.getStateStorage()) & 1;
+        checksum += local;
+      });
+    for (std::thread& thread : threads)
+      thread.join();
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    std::cerr << thread_count << " threads: " << elapsed.count() * 1e9 / calls_per_thread << "ns per call and thread"
+              << std::endl;
+    EXPECT_EQ(checksum.load(), 0u);
+  }
+}
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -121,6 +121,11 @@ private:
   /**
    * @brief Solve each sequence item individually.
    *
+   * The start state of an item only depends on the previous items of the
+   * same group, therefore the items of different groups are solved
+   * concurrently, one thread per group. The result is the same as when
+   * solving the items one after another.
+   *
    * @param planning_scene The planning_scene to be used for trajectory
    * generation.
    * @param req_list Container of requests for calculation/generation.
@@ -131,6 +136,18 @@ private:
                                         const planning_pipeline::PlanningPipelinePtr& planning_pipeline,
                                         const moveit_msgs::MotionSequenceRequest& req_list) const;
 
+  /**
+   * @brief Solve the sequence items of the specified group in order,
+   * each one starting at the end state of the previous one.
+   *
+   * @param motion_plan_responses Container of the size of the request
+   * list, the responses are stored at the indices of their requests.
+   */
+  void solveGroupSequenceItems(const planning_scene::PlanningSceneConstPtr& planning_scene,
+                               const planning_pipeline::PlanningPipelinePtr& planning_pipeline,
+                               const moveit_msgs::MotionSequenceRequest& req_list, const std::string& group_name,
+                               MotionResponseCont& motion_plan_responses) const;
+
   /**
    * @return TRUE if the blending radii of specified trajectories overlap,
    * otherwise FALSE. The functions returns FALSE if both trajectories are from
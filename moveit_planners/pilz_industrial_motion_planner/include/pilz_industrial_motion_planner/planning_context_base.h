@@ -103,6 +103,15 @@ public:
    */
   void clear() override;
 
+  /**
+   * @brief Sets how generated trajectories are checked for collisions with the
+   * planning scene, see isTrajectoryCollisionFree()
+   */
+  void setCollisionCheck(const TrajectoryCollisionCheck& collision_check)
+  {
+    collision_check_ = collision_check;
+  }
+
   /// Flag if terminated
   std::atomic_bool terminated_;
 
@@ -114,6 +123,9 @@ public:
 
 protected:
   GeneratorT generator_;
+
+  /// Collision checks of the generated trajectories
+  TrajectoryCollisionCheck collision_check_;
 };
 
 template <typename GeneratorT>
@@ -129,6 +141,16 @@ bool pilz_industrial_motion_planner::PlanningContextBase<GeneratorT>::solve(plan
       request_.start_state = current_state;
     }
     bool result = generator_.generate(request_, res);
+    std::size_t colliding_index;
+    if (result && collision_check_.enabled &&
+        !isTrajectoryCollisionFree(getPlanningScene(), *res.trajectory_, collision_check_.continuous,
+                                   collision_check_.thread_count, &colliding_index))
+    {
+      ROS_ERROR_STREAM("Generated trajectory is in collision at sample " << colliding_index);
+      res.trajectory_->clear();
+      res.error_code_.val = moveit_msgs::MoveItErrorCodes::INVALID_MOTION_PLAN;
+      return false;
+    }
     return result;
     // res.error_code_.val = moveit_msgs::MoveItErrorCodes::INVALID_MOTION_PLAN;
     // return false; // TODO
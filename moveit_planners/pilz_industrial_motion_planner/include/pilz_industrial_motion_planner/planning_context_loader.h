@@ -42,6 +42,7 @@
 #include <moveit/planning_interface/planning_interface.h>
 
 #include "pilz_industrial_motion_planner/limits_container.h"
+#include "pilz_industrial_motion_planner/trajectory_functions.h"
 
 namespace pilz_industrial_motion_planner
 {
@@ -75,6 +76,13 @@ public:
    */
   virtual bool setLimits(const pilz_industrial_motion_planner::LimitsContainer& limits);
 
+  /**
+   * @brief Sets how the planning contexts check their trajectories for
+   * collisions
+   * @param collision_check collision check options, disabled by default
+   */
+  void setCollisionCheck(const TrajectoryCollisionCheck& collision_check);
+
   /**
    * @brief Return the planning context
    * @param planning_context
@@ -112,6 +120,9 @@ protected:
 
   /// The robot model
   moveit::core::RobotModelConstPtr model_;
+
+  /// Collision checks passed to the planning contexts
+  TrajectoryCollisionCheck collision_check_;
 };
 
 typedef boost::shared_ptr<PlanningContextLoader> PlanningContextLoaderPtr;
@@ -123,7 +134,9 @@ bool PlanningContextLoader::loadContext(planning_interface::PlanningContextPtr&
 {
   if (limits_set_ && model_set_)
   {
-    planning_context.reset(new T(name, group, model_, limits_));
+    T* context = new T(name, group, model_, limits_);
+    context->setCollisionCheck(collision_check_);
+    planning_context.reset(context);
     return true;
   }
   else
@@ -38,6 +38,7 @@
 #include <eigen_conversions/eigen_kdl.h>
 #include <eigen_conversions/eigen_msg.h>
 #include <kdl/trajectory.hpp>
+#include <moveit/planning_scene/planning_scene.h>
 #include <moveit/robot_model/robot_model.h>
 #include <moveit/robot_state/robot_state.h>
 #include <moveit/robot_trajectory/robot_trajectory.h>
@@ -107,6 +108,14 @@ bool verifySampleJointLimits(const std::map<std::string, double>& position_last,
                              const std::map<std::string, double>& position_current, double duration_last,
                              double duration_current, const JointLimitsContainer& joint_limits);
 
+/**
+ * @brief Same as above with the positions and velocities of the specified
+ * joints stored in vectors, which avoids building maps for every sample.
+ */
+bool verifySampleJointLimits(const std::vector<std::string>& joint_names, const std::vector<double>& position_last,
+                             const std::vector<double>& velocity_last, const std::vector<double>& position_current,
+                             double duration_last, double duration_current, const JointLimitsContainer& joint_limits);
+
 /**
  * @brief Generate joint trajectory from a KDL Cartesian trajectory
  * @param robot_model: robot kinematics model
@@ -199,6 +208,19 @@ bool linearSearchIntersectionPoint(const std::string& link_name, const Eigen::Ve
                                    const double& r, const robot_trajectory::RobotTrajectoryPtr& traj, bool inverseOrder,
                                    std::size_t& index);
 
+/**
+ * @brief Performs a binary search for the intersection point of the
+ * trajectory with the blending radius, with the same parameters and result as
+ * linearSearchIntersectionPoint().
+ *
+ * The distance of the waypoints to the center must be monotonic, as for the
+ * straight and circular segments of LIN and CIRC commands. Otherwise the
+ * search may fail, or find another intersection than the linear search.
+ */
+bool binarySearchIntersectionPoint(const std::string& link_name, const Eigen::Vector3d& center_position,
+                                   const double& r, const robot_trajectory::RobotTrajectoryPtr& traj, bool inverseOrder,
+                                   std::size_t& index);
+
 bool intersectionFound(const Eigen::Vector3d& p_center, const Eigen::Vector3d& p_current, const Eigen::Vector3d& p_next,
                        const double& r);
 
@@ -214,6 +236,42 @@ bool intersectionFound(const Eigen::Vector3d& p_center, const Eigen::Vector3d& p
 bool isStateColliding(const bool test_for_self_collision, const moveit::core::RobotModelConstPtr& robot_model,
                       robot_state::RobotState* state, const robot_state::JointModelGroup* const group,
                       const double* const ik_solution);
+
+/**
+ * @brief How generated trajectories are checked for collisions with the
+ * planning scene before they are returned.
+ */
+struct TrajectoryCollisionCheck
+{
+  /// Check every sample of the trajectory
+  bool enabled{ false };
+  /// Also check the motion between consecutive samples against the world,
+  /// so that coarse sampling does not step over obstacles
+  bool continuous{ false };
+  /// Number of threads the samples are distributed over, 0 for the number of
+  /// hardware threads
+  unsigned int thread_count{ 0 };
+};
+
+/**
+ * @brief Checks a trajectory for collisions with the planning scene,
+ * distributing its samples over several threads.
+ *
+ * Every sample is checked for self collisions and collisions with the world.
+ * With \e continuous checks, the motion from each sample to the next one is
+ * checked against the world with continuous collision detection, where the
+ * collision detector supports it.
+ * @param scene The planning scene to check against.
+ * @param trajectory The trajectory, its group selects the links checked.
+ * @param continuous Whether to check the motion between samples.
+ * @param thread_count Number of threads, 0 for the number of hardware threads.
+ * @param colliding_index Set to the first colliding sample (the end of the
+ * first colliding motion) if given.
+ * @return True if the trajectory is collision free, otherwise false.
+ */
+bool isTrajectoryCollisionFree(const planning_scene::PlanningSceneConstPtr& scene,
+                               const robot_trajectory::RobotTrajectory& trajectory, bool continuous,
+                               unsigned int thread_count = 0, std::size_t* colliding_index = nullptr);
 }  // namespace pilz_industrial_motion_planner
 
 void normalizeQuaternion(geometry_msgs::Quaternion& quat);
@@ -35,7 +35,9 @@
 #include "pilz_industrial_motion_planner/command_list_manager.h"
 
 #include <cassert>
+#include <exception>
 #include <functional>
+#include <future>
 #include <sstream>
 
 #include <moveit/planning_pipeline/planning_pipeline.h>
@@ -226,13 +228,81 @@ CommandListManager::solveSequenceItems(const planning_scene::PlanningSceneConstP
                                        const planning_pipeline::PlanningPipelinePtr& planning_pipeline,
                                        const moveit_msgs::MotionSequenceRequest& req_list) const
 {
-  MotionResponseCont motion_plan_responses;
-  size_t curr_req_index{ 0 };
+  MotionResponseCont motion_plan_responses(req_list.items.size());
+  GroupNamesCont group_names{ getGroupNames(req_list) };
+
+  // The groups are independent of each other, the first group is solved in
+  // the calling thread.
+  std::vector<std::future<void>> group_solutions;
+  for (GroupNamesCont::size_type i = 1; i < group_names.size(); ++i)
+  {
+    group_solutions.emplace_back(std::async(std::launch::async, &CommandListManager::solveGroupSequenceItems, this,
+                                            std::cref(planning_scene), std::cref(planning_pipeline),
+                                            std::cref(req_list), std::cref(group_names.at(i)),
+                                            std::ref(motion_plan_responses)));
+  }
+
+  // Rethrow the error of the first failed item, which is the error the
+  // items would have caused if solved one after another.
+  std::exception_ptr error;
+  size_t error_index{ req_list.items.size() };
+  auto record_error = [&](const std::string& group_name) {
+    for (size_t i = 0; i < error_index; ++i)
+    {
+      if (req_list.items.at(i).req.group_name == group_name && !motion_plan_responses.at(i).trajectory_)
+      {
+        error = std::current_exception();
+        error_index = i;
+        return;
+      }
+    }
+  };
+
+  try
+  {
+    solveGroupSequenceItems(planning_scene, planning_pipeline, req_list, group_names.front(), motion_plan_responses);
+  }
+  catch (...)
+  {
+    record_error(group_names.front());
+  }
+  for (GroupNamesCont::size_type i = 0; i < group_solutions.size(); ++i)
+  {
+    try
+    {
+      group_solutions.at(i).get();
+    }
+    catch (...)
+    {
+      record_error(group_names.at(i + 1));
+    }
+  }
+
+  if (error)
+  {
+    std::rethrow_exception(error);
+  }
+  return motion_plan_responses;
+}
+
+void CommandListManager::solveGroupSequenceItems(const planning_scene::PlanningSceneConstPtr& planning_scene,
+                                                 const planning_pipeline::PlanningPipelinePtr& planning_pipeline,
+                                                 const moveit_msgs::MotionSequenceRequest& req_list,
+                                                 const std::string& group_name,
+                                                 MotionResponseCont& motion_plan_responses) const
+{
+  MotionResponseCont group_responses;
   const size_t num_req{ req_list.items.size() };
-  for (const auto& seq_item : req_list.items)
+  for (size_t curr_req_index = 0; curr_req_index < num_req; ++curr_req_index)
   {
+    const moveit_msgs::MotionSequenceItem& seq_item{ req_list.items.at(curr_req_index) };
+    if (seq_item.req.group_name != group_name)
+    {
+      continue;
+    }
+
     planning_interface::MotionPlanRequest req{ seq_item.req };
-    setStartState(motion_plan_responses, req.group_name, req.start_state);
+    setStartState(group_responses, req.group_name, req.start_state);
 
     planning_interface::MotionPlanResponse res;
     planning_pipeline->generatePlan(planning_scene, req, res);
@@ -242,10 +312,10 @@ CommandListManager::solveSequenceItems(const planning_scene::PlanningSceneConstP
       os << "Could not solve request\n---\n" << req << "\n---\n";
       throw PlanningPipelineException(os.str(), res.error_code_.val);
     }
-    motion_plan_responses.emplace_back(res);
-    ROS_DEBUG_STREAM("Solved [" << ++curr_req_index << "/" << num_req << "]");
+    group_responses.emplace_back(res);
+    motion_plan_responses.at(curr_req_index) = res;
+    ROS_DEBUG_STREAM("Solved [" << curr_req_index + 1 << "/" << num_req << "]");
   }
-  return motion_plan_responses;
 }
 
 void CommandListManager::checkForNegativeRadii(const moveit_msgs::MotionSequenceRequest& req_list)
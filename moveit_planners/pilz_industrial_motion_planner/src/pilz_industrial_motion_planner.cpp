@@ -51,6 +51,9 @@
 namespace pilz_industrial_motion_planner
 {
 static const std::string PARAM_NAMESPACE_LIMTS = "robot_description_planning";
+static const std::string PARAM_COLLISION_CHECK = "collision_check_trajectory";
+static const std::string PARAM_CONTINUOUS_COLLISION_CHECK = "continuous_collision_check";
+static const std::string PARAM_COLLISION_CHECK_THREADS = "collision_check_threads";
 
 bool CommandPlanner::initialize(const moveit::core::RobotModelConstPtr& model, const std::string& ns)
 {
@@ -69,6 +72,15 @@ bool CommandPlanner::initialize(const moveit::core::RobotModelConstPtr& model, c
   cartesian_limit_ = pilz_industrial_motion_planner::CartesianLimitsAggregator::getAggregatedLimits(
       ros::NodeHandle(PARAM_NAMESPACE_LIMTS));
 
+  // Obtain the collision checks of the generated trajectories
+  ros::NodeHandle nh(ns);
+  TrajectoryCollisionCheck collision_check;
+  nh.param(PARAM_COLLISION_CHECK, collision_check.enabled, false);
+  nh.param(PARAM_CONTINUOUS_COLLISION_CHECK, collision_check.continuous, false);
+  int collision_check_threads;
+  nh.param(PARAM_COLLISION_CHECK_THREADS, collision_check_threads, 0);
+  collision_check.thread_count = std::max(0, collision_check_threads);
+
   // Load the planning context loader
   planner_context_loader.reset(new pluginlib::ClassLoader<PlanningContextLoader>(
       "pilz_industrial_motion_planner", "pilz_industrial_motion_planner::PlanningContextLoader"));
@@ -95,6 +107,7 @@ bool CommandPlanner::initialize(const moveit::core::RobotModelConstPtr& model, c
 
     loader_pointer->setLimits(limits);
     loader_pointer->setModel(model_);
+    loader_pointer->setCollisionCheck(collision_check);
 
     registerContextLoader(loader_pointer);
   }
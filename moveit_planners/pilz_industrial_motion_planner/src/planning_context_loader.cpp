@@ -58,6 +58,12 @@ bool pilz_industrial_motion_planner::PlanningContextLoader::setLimits(
   return true;
 }
 
+void pilz_industrial_motion_planner::PlanningContextLoader::setCollisionCheck(
+    const TrajectoryCollisionCheck& collision_check)
+{
+  collision_check_ = collision_check;
+}
+
 std::string pilz_industrial_motion_planner::PlanningContextLoader::getAlgorithm() const
 {
   return alg_;
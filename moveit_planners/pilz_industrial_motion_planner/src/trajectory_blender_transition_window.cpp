@@ -264,7 +264,11 @@ bool pilz_industrial_motion_planner::TrajectoryBlenderTransitionWindow::searchIn
   Eigen::Isometry3d circ_pose = req.first_trajectory->getLastWayPoint().getFrameTransform(req.link_name);
 
   // Searh for intersection points according to distance
-  if (!linearSearchIntersectionPoint(req.link_name, circ_pose.translation(), req.blend_radius, req.first_trajectory,
+  // The binary search applies to the monotonic distance profiles of LIN and
+  // CIRC segments, the linear search is the fallback for other segments.
+  if (!binarySearchIntersectionPoint(req.link_name, circ_pose.translation(), req.blend_radius, req.first_trajectory,
+                                     true, first_interse_index) &&
+      !linearSearchIntersectionPoint(req.link_name, circ_pose.translation(), req.blend_radius, req.first_trajectory,
                                      true, first_interse_index))
   {
     ROS_ERROR_STREAM("Intersection point of first trajectory not found.");
@@ -272,7 +276,9 @@ bool pilz_industrial_motion_planner::TrajectoryBlenderTransitionWindow::searchIn
   }
   ROS_INFO_STREAM("Intersection point of first trajectory found, index: " << first_interse_index);
 
-  if (!linearSearchIntersectionPoint(req.link_name, circ_pose.translation(), req.blend_radius, req.second_trajectory,
+  if (!binarySearchIntersectionPoint(req.link_name, circ_pose.translation(), req.blend_radius, req.second_trajectory,
+                                     false, second_interse_index) &&
+      !linearSearchIntersectionPoint(req.link_name, circ_pose.translation(), req.blend_radius, req.second_trajectory,
                                      false, second_interse_index))
   {
     ROS_ERROR_STREAM("Intersection point of second trajectory not found.");
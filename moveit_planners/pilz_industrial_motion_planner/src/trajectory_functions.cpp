@@ -40,6 +40,208 @@
 #include <tf2_eigen/tf2_eigen.h>
 #include <tf2_geometry_msgs/tf2_geometry_msgs.h>
 
+#include <atomic>
+#include <thread>
+
+namespace
+{
+/**
+ * @brief Looks up the position of a frame in many waypoints of a trajectory,
+ * resolving the frame by name only once. Link frames and frames of attached
+ * bodies are a fixed offset from a link, which is looked up by pointer.
+ */
+class WaypointFramePosition
+{
+public:
+  WaypointFramePosition(const std::string& frame, const robot_trajectory::RobotTrajectoryPtr& traj) : frame_(frame)
+  {
+    if (traj->empty())
+    {
+      return;
+    }
+    robot_state::RobotState& state = *traj->getWayPointPtr(0);
+    state.updateLinkTransforms();
+    const std::string& model_frame = state.getRobotModel()->getModelFrame();
+    if (frame == model_frame || frame == "/" + model_frame)
+    {
+      return;
+    }
+    bool found;
+    const Eigen::Isometry3d& frame_pose = state.getFrameInfo(frame, link_, found);
+    if (!found || !link_)
+    {
+      link_ = nullptr;
+      return;
+    }
+    offset_ = state.getGlobalLinkTransform(link_).inverse() * frame_pose.translation();
+  }
+
+  Eigen::Vector3d operator()(robot_state::RobotState& state) const
+  {
+    if (!link_)
+    {
+      return state.getFrameTransform(frame_).translation();
+    }
+    return state.getGlobalLinkTransform(link_) * offset_;
+  }
+
+private:
+  const std::string& frame_;
+  const robot_state::LinkModel* link_ = nullptr;
+  Eigen::Vector3d offset_;
+};
+
+/**
+ * @brief Moves the link of the group to a pose close to its current pose by
+ * damped least squares iterations on the Jacobian, starting from the
+ * current positions of the state.
+ * @return True if the pose is reached within the joint bounds, otherwise
+ * the state is left at the last iteration.
+ */
+bool computeIncrementalPoseIK(robot_state::RobotState& rstate, const robot_state::JointModelGroup* group,
+                              const robot_state::LinkModel* link, const Eigen::Isometry3d& pose)
+{
+  const int max_iterations = 10;
+  const double tolerance = 1e-9;  // squared norm of the pose error
+  const double damping = 1e-8;
+
+  // the Jacobian is expressed in the frame of the parent link of the group
+  const robot_state::LinkModel* root_link = group->getJointModels().front()->getParentLinkModel();
+
+  Eigen::MatrixXd jacobian;
+  Eigen::VectorXd positions;
+  Eigen::Matrix<double, 6, 1> pose_error;
+  rstate.copyJointGroupPositions(group, positions);
+  for (int i = 0; i <= max_iterations; ++i)
+  {
+    const Eigen::Isometry3d& link_pose = rstate.getGlobalLinkTransform(link);
+    Eigen::AngleAxisd rotation_error(pose.linear() * link_pose.linear().transpose());
+    pose_error.head<3>() = pose.translation() - link_pose.translation();
+    pose_error.tail<3>() = rotation_error.angle() * rotation_error.axis();
+    if (root_link)
+    {
+      const Eigen::Matrix3d root_rotation_inverse = rstate.getGlobalLinkTransform(root_link).linear().transpose();
+      pose_error.head<3>() = root_rotation_inverse * pose_error.head<3>();
+      pose_error.tail<3>() = root_rotation_inverse * pose_error.tail<3>();
+    }
+    if (pose_error.squaredNorm() < tolerance)
+    {
+      return rstate.satisfiesBounds(group);
+    }
+    if (i == max_iterations || !rstate.getJacobian(group, link, Eigen::Vector3d::Zero(), jacobian) ||
+        jacobian.cols() != positions.size())
+    {
+      return false;
+    }
+    Eigen::Matrix<double, 6, 6> jjt = jacobian * jacobian.transpose();
+    jjt.diagonal().array() += damping;
+    positions += jacobian.transpose() * jjt.ldlt().solve(pose_error);
+    rstate.setJointGroupPositions(group, positions);
+  }
+  return false;
+}
+
+/**
+ * @brief Solves the inverse kinematics of consecutive Cartesian samples.
+ *
+ * One robot state is reused for all samples and always holds the last
+ * solution. As consecutive samples are close to each other, a sample is
+ * usually solved by a few Jacobian iterations from the last solution,
+ * computePoseIK() is only called if they fail.
+ */
+class SampleIKSolver
+{
+public:
+  SampleIKSolver(const moveit::core::RobotModelConstPtr& robot_model, const std::string& group_name,
+                 const std::string& link_name, const std::map<std::string, double>& initial_joint_position,
+                 bool check_self_collision)
+    : robot_model_(robot_model)
+    , group_name_(group_name)
+    , link_name_(link_name)
+    , check_self_collision_(check_self_collision)
+    , rstate_(robot_model)
+    , group_(robot_model->hasJointModelGroup(group_name) ? robot_model->getJointModelGroup(group_name) : nullptr)
+    , link_(robot_model->hasLinkModel(link_name) ? robot_model->getLinkModel(link_name) : nullptr)
+  {
+    for (const auto& item : initial_joint_position)
+    {
+      joint_names_.push_back(item.first);
+      variable_indices_.push_back(robot_model->getVariableIndex(item.first));
+      last_solution_.push_back(item.second);
+    }
+    rstate_.setToDefaultValues();
+    rstate_.setVariablePositions(initial_joint_position);
+  }
+
+  /** @brief The names of the joints, in the order of the initial joint positions */
+  const std::vector<std::string>& getJointNames() const
+  {
+    return joint_names_;
+  }
+
+  /** @brief Solves the IK of the pose, the solution is ordered like the joint names */
+  bool solve(const Eigen::Isometry3d& pose, std::vector<double>& solution)
+  {
+    if (!(group_ && link_ && computeIncrementalPoseIK(rstate_, group_, link_, pose) && isCollisionFree()))
+    {
+      for (std::size_t i = 0; i < joint_names_.size(); ++i)
+      {
+        seed_[joint_names_[i]] = last_solution_[i];
+      }
+      if (!pilz_industrial_motion_planner::computePoseIK(robot_model_, group_name_, link_name_, pose,
+                                                         robot_model_->getModelFrame(), seed_, ik_solution_,
+                                                         check_self_collision_))
+      {
+        return false;
+      }
+      rstate_.setVariablePositions(ik_solution_);
+    }
+
+    solution.resize(joint_names_.size());
+    for (std::size_t i = 0; i < joint_names_.size(); ++i)
+    {
+      solution[i] = rstate_.getVariablePosition(variable_indices_[i]);
+    }
+    last_solution_ = solution;
+    return true;
+  }
+
+private:
+  /** @brief Checks the current state like isStateColliding(), with one planning scene for all samples */
+  bool isCollisionFree()
+  {
+    if (!check_self_collision_)
+    {
+      return true;
+    }
+    if (!planning_scene_)
+    {
+      planning_scene_ = std::make_shared<planning_scene::PlanningScene>(robot_model_);
+    }
+    rstate_.update();
+    collision_detection::CollisionRequest collision_req;
+    collision_req.group_name = group_->getName();
+    collision_detection::CollisionResult collision_res;
+    planning_scene_->checkSelfCollision(collision_req, collision_res, rstate_);
+    return !collision_res.collision;
+  }
+
+  const moveit::core::RobotModelConstPtr robot_model_;
+  const std::string group_name_;
+  const std::string link_name_;
+  const bool check_self_collision_;
+  robot_state::RobotState rstate_;
+  const robot_state::JointModelGroup* group_;
+  const robot_state::LinkModel* link_;
+  planning_scene::PlanningScenePtr planning_scene_;
+
+  std::vector<std::string> joint_names_;
+  std::vector<int> variable_indices_;
+  std::vector<double> last_solution_;
+  std::map<std::string, double> seed_, ik_solution_;
+};
+}  // namespace
+
 bool pilz_industrial_motion_planner::computePoseIK(const moveit::core::RobotModelConstPtr& robot_model,
                                                    const std::string& group_name, const std::string& link_name,
                                                    const Eigen::Isometry3d& pose, const std::string& frame_id,
@@ -135,6 +337,26 @@ bool pilz_industrial_motion_planner::verifySampleJointLimits(
     const std::map<std::string, double>& position_last, const std::map<std::string, double>& velocity_last,
     const std::map<std::string, double>& position_current, double duration_last, double duration_current,
     const pilz_industrial_motion_planner::JointLimitsContainer& joint_limits)
+{
+  std::vector<std::string> joint_names;
+  std::vector<double> positions_last, velocities_last, positions_current;
+  for (const auto& pos : position_current)
+  {
+    joint_names.push_back(pos.first);
+    positions_last.push_back(position_last.at(pos.first));
+    // a missing last velocity is treated as standstill
+    const auto velocity = velocity_last.find(pos.first);
+    velocities_last.push_back(velocity != velocity_last.end() ? velocity->second : 0.0);
+    positions_current.push_back(pos.second);
+  }
+  return verifySampleJointLimits(joint_names, positions_last, velocities_last, positions_current, duration_last,
+                                 duration_current, joint_limits);
+}
+
+bool pilz_industrial_motion_planner::verifySampleJointLimits(
+    const std::vector<std::string>& joint_names, const std::vector<double>& position_last,
+    const std::vector<double>& velocity_last, const std::vector<double>& position_current, double duration_last,
+    double duration_current, const pilz_industrial_motion_planner::JointLimitsContainer& joint_limits)
 {
   const double epsilon = 10e-6;
   if (duration_current <= epsilon)
@@ -145,43 +367,44 @@ bool pilz_industrial_motion_planner::verifySampleJointLimits(
 
   double velocity_current, acceleration_current;
 
-  for (const auto& pos : position_current)
+  for (std::size_t i = 0; i < joint_names.size(); ++i)
   {
-    velocity_current = (pos.second - position_last.at(pos.first)) / duration_current;
+    const std::string& joint_name = joint_names[i];
+    velocity_current = (position_current[i] - position_last[i]) / duration_current;
 
-    if (!joint_limits.verifyVelocityLimit(pos.first, velocity_current))
+    if (!joint_limits.verifyVelocityLimit(joint_name, velocity_current))
     {
-      ROS_ERROR_STREAM("Joint velocity limit of " << pos.first << " violated. Set the velocity scaling factor lower!"
+      ROS_ERROR_STREAM("Joint velocity limit of " << joint_name << " violated. Set the velocity scaling factor lower!"
                                                   << " Actual joint velocity is " << velocity_current
                                                   << ", while the limit is "
-                                                  << joint_limits.getLimit(pos.first).max_velocity << ". ");
+                                                  << joint_limits.getLimit(joint_name).max_velocity << ". ");
       return false;
     }
 
-    acceleration_current = (velocity_current - velocity_last.at(pos.first)) / (duration_last + duration_current) * 2;
+    acceleration_current = (velocity_current - velocity_last[i]) / (duration_last + duration_current) * 2;
     // acceleration case
-    if (fabs(velocity_last.at(pos.first)) <= fabs(velocity_current))
+    if (fabs(velocity_last[i]) <= fabs(velocity_current))
     {
-      if (joint_limits.getLimit(pos.first).has_acceleration_limits &&
-          fabs(acceleration_current) > fabs(joint_limits.getLimit(pos.first).max_acceleration))
+      if (joint_limits.getLimit(joint_name).has_acceleration_limits &&
+          fabs(acceleration_current) > fabs(joint_limits.getLimit(joint_name).max_acceleration))
       {
         ROS_ERROR_STREAM("Joint acceleration limit of "
-                         << pos.first << " violated. Set the acceleration scaling factor lower!"
+                         << joint_name << " violated. Set the acceleration scaling factor lower!"
                          << " Actual joint acceleration is " << acceleration_current << ", while the limit is "
-                         << joint_limits.getLimit(pos.first).max_acceleration << ". ");
+                         << joint_limits.getLimit(joint_name).max_acceleration << ". ");
         return false;
       }
     }
     // deceleration case
     else
     {
-      if (joint_limits.getLimit(pos.first).has_deceleration_limits &&
-          fabs(acceleration_current) > fabs(joint_limits.getLimit(pos.first).max_deceleration))
+      if (joint_limits.getLimit(joint_name).has_deceleration_limits &&
+          fabs(acceleration_current) > fabs(joint_limits.getLimit(joint_name).max_deceleration))
       {
         ROS_ERROR_STREAM("Joint deceleration limit of "
-                         << pos.first << " violated. Set the acceleration scaling factor lower!"
+                         << joint_name << " violated. Set the acceleration scaling factor lower!"
                          << " Actual joint deceleration is " << acceleration_current << ", while the limit is "
-                         << joint_limits.getLimit(pos.first).max_deceleration << ". ");
+                         << joint_limits.getLimit(joint_name).max_deceleration << ". ");
         return false;
       }
     }
@@ -211,22 +434,25 @@ bool pilz_industrial_motion_planner::generateJointTrajectory(
   }
   time_samples.push_back(trajectory.Duration());
 
-  // sample the trajectory and solve the inverse kinematics
-  Eigen::Isometry3d pose_sample;
-  std::map<std::string, double> ik_solution_last, ik_solution, joint_velocity_last;
-  ik_solution_last = initial_joint_position;
-  for (const auto& item : ik_solution_last)
+  // The joints are stored in vectors in the order of the initial joint
+  // positions, which is also the order of the joint names of the trajectory.
+  SampleIKSolver ik_solver(robot_model, group_name, link_name, initial_joint_position, check_self_collision);
+  const std::vector<std::string>& joint_names = ik_solver.getJointNames();
+  std::vector<double> ik_solution_last, ik_solution, joint_velocity_last(joint_names.size(), 0.0);
+  for (const auto& item : initial_joint_position)
   {
-    joint_velocity_last[item.first] = 0.0;
+    ik_solution_last.push_back(item.second);
   }
+  joint_trajectory.joint_names = joint_names;
 
+  // sample the trajectory and solve the inverse kinematics
+  Eigen::Isometry3d pose_sample;
   for (std::vector<double>::const_iterator time_iter = time_samples.begin(); time_iter != time_samples.end();
        ++time_iter)
   {
     tf::transformKDLToEigen(trajectory.Pos(*time_iter), pose_sample);
 
-    if (!computePoseIK(robot_model, group_name, link_name, pose_sample, robot_model->getModelFrame(), ik_solution_last,
-                       ik_solution, check_self_collision))
+    if (!ik_solver.solve(pose_sample, ik_solution))
     {
       ROS_ERROR("Failed to compute inverse kinematics solution for sampled "
                 "Cartesian pose.");
@@ -249,7 +475,7 @@ bool pilz_industrial_motion_planner::generateJointTrajectory(
 
     // skip the first sample with zero time from start for limits checking
     if (time_iter != time_samples.begin() &&
-        !verifySampleJointLimits(ik_solution_last, joint_velocity_last, ik_solution, sampling_time,
+        !verifySampleJointLimits(joint_names, ik_solution_last, joint_velocity_last, ik_solution, sampling_time,
                                  duration_current_sample, joint_limits))
     {
       ROS_ERROR_STREAM("Inverse kinematics solution at "
@@ -261,33 +487,23 @@ bool pilz_industrial_motion_planner::generateJointTrajectory(
 
     // fill the point with joint values
     trajectory_msgs::JointTrajectoryPoint point;
-
-    // set joint names
-    joint_trajectory.joint_names.clear();
-    for (const auto& start_joint : initial_joint_position)
-    {
-      joint_trajectory.joint_names.push_back(start_joint.first);
-    }
-
     point.time_from_start = ros::Duration(*time_iter);
-    for (const auto& joint_name : joint_trajectory.joint_names)
+    point.positions = ik_solution;
+    for (std::size_t i = 0; i < joint_names.size(); ++i)
     {
-      point.positions.push_back(ik_solution.at(joint_name));
-
       if (time_iter != time_samples.begin() && time_iter != time_samples.end() - 1)
       {
-        double joint_velocity =
-            (ik_solution.at(joint_name) - ik_solution_last.at(joint_name)) / duration_current_sample;
+        double joint_velocity = (ik_solution[i] - ik_solution_last[i]) / duration_current_sample;
         point.velocities.push_back(joint_velocity);
-        point.accelerations.push_back((joint_velocity - joint_velocity_last.at(joint_name)) /
+        point.accelerations.push_back((joint_velocity - joint_velocity_last[i]) /
                                       (duration_current_sample + sampling_time) * 2);
-        joint_velocity_last[joint_name] = joint_velocity;
+        joint_velocity_last[i] = joint_velocity;
       }
       else
       {
         point.velocities.push_back(0.);
         point.accelerations.push_back(0.);
-        joint_velocity_last[joint_name] = 0.;
+        joint_velocity_last[i] = 0.;
       }
     }
 
@@ -317,21 +533,23 @@ bool pilz_industrial_motion_planner::generateJointTrajectory(
 
   ros::Time generation_begin = ros::Time::now();
 
-  std::map<std::string, double> ik_solution_last = initial_joint_position;
-  std::map<std::string, double> joint_velocity_last = initial_joint_velocity;
-  double duration_last = 0;
-  double duration_current = 0;
-  joint_trajectory.joint_names.clear();
-  for (const auto& joint_position : ik_solution_last)
+  SampleIKSolver ik_solver(robot_model, group_name, link_name, initial_joint_position, check_self_collision);
+  const std::vector<std::string>& joint_names = ik_solver.getJointNames();
+  std::vector<double> ik_solution_last, ik_solution, joint_velocity_last;
+  for (const auto& joint_name : joint_names)
   {
-    joint_trajectory.joint_names.push_back(joint_position.first);
+    ik_solution_last.push_back(initial_joint_position.at(joint_name));
+    joint_velocity_last.push_back(initial_joint_velocity.at(joint_name));
   }
-  std::map<std::string, double> ik_solution;
+  double duration_last = 0;
+  double duration_current = 0;
+  joint_trajectory.joint_names = joint_names;
+  Eigen::Isometry3d pose_sample;
   for (size_t i = 0; i < trajectory.points.size(); ++i)
   {
     // compute inverse kinematics
-    if (!computePoseIK(robot_model, group_name, link_name, trajectory.points.at(i).pose, robot_model->getModelFrame(),
-                       ik_solution_last, ik_solution, check_self_collision))
+    tf2::convert<geometry_msgs::Pose, Eigen::Isometry3d>(trajectory.points.at(i).pose, pose_sample);
+    if (!ik_solver.solve(pose_sample, ik_solution))
     {
       ROS_ERROR("Failed to compute inverse kinematics solution for sampled "
                 "Cartesian pose.");
@@ -352,8 +570,8 @@ bool pilz_industrial_motion_planner::generateJointTrajectory(
           trajectory.points.at(i).time_from_start.toSec() - trajectory.points.at(i - 1).time_from_start.toSec();
     }
 
-    if (!verifySampleJointLimits(ik_solution_last, joint_velocity_last, ik_solution, duration_last, duration_current,
-                                 joint_limits))
+    if (!verifySampleJointLimits(joint_names, ik_solution_last, joint_velocity_last, ik_solution, duration_last,
+                                 duration_current, joint_limits))
     {
       // LCOV_EXCL_START since the same code was captured in a test in the other
       // overload generateJointTrajectory(...,
@@ -371,15 +589,15 @@ bool pilz_industrial_motion_planner::generateJointTrajectory(
     // compute the waypoint
     trajectory_msgs::JointTrajectoryPoint waypoint_joint;
     waypoint_joint.time_from_start = ros::Duration(trajectory.points.at(i).time_from_start);
-    for (const auto& joint_name : joint_trajectory.joint_names)
+    waypoint_joint.positions = ik_solution;
+    for (size_t j = 0; j < joint_names.size(); ++j)
     {
-      waypoint_joint.positions.push_back(ik_solution.at(joint_name));
-      double joint_velocity = (ik_solution.at(joint_name) - ik_solution_last.at(joint_name)) / duration_current;
+      double joint_velocity = (ik_solution[j] - ik_solution_last[j]) / duration_current;
       waypoint_joint.velocities.push_back(joint_velocity);
-      waypoint_joint.accelerations.push_back((joint_velocity - joint_velocity_last.at(joint_name)) /
+      waypoint_joint.accelerations.push_back((joint_velocity - joint_velocity_last[j]) /
                                              (duration_current + duration_last) * 2);
       // update the joint velocity
-      joint_velocity_last[joint_name] = joint_velocity;
+      joint_velocity_last[j] = joint_velocity;
     }
 
     // update joint trajectory
@@ -519,13 +737,14 @@ bool pilz_industrial_motion_planner::linearSearchIntersectionPoint(const std::st
   ROS_DEBUG("Start linear search for intersection point.");
 
   const size_t waypoint_num = traj->getWayPointCount();
+  const WaypointFramePosition position(link_name, traj);
 
   if (inverseOrder)
   {
     for (size_t i = waypoint_num - 1; i > 0; --i)
     {
-      if (intersectionFound(center_position, traj->getWayPointPtr(i)->getFrameTransform(link_name).translation(),
-                            traj->getWayPointPtr(i - 1)->getFrameTransform(link_name).translation(), r))
+      if (intersectionFound(center_position, position(*traj->getWayPointPtr(i)),
+                            position(*traj->getWayPointPtr(i - 1)), r))
       {
         index = i;
         return true;
@@ -536,8 +755,8 @@ bool pilz_industrial_motion_planner::linearSearchIntersectionPoint(const std::st
   {
     for (size_t i = 0; i < waypoint_num - 1; ++i)
     {
-      if (intersectionFound(center_position, traj->getWayPointPtr(i)->getFrameTransform(link_name).translation(),
-                            traj->getWayPointPtr(i + 1)->getFrameTransform(link_name).translation(), r))
+      if (intersectionFound(center_position, position(*traj->getWayPointPtr(i)),
+                            position(*traj->getWayPointPtr(i + 1)), r))
       {
         index = i;
         return true;
@@ -548,6 +767,53 @@ bool pilz_industrial_motion_planner::linearSearchIntersectionPoint(const std::st
   return false;
 }
 
+bool pilz_industrial_motion_planner::binarySearchIntersectionPoint(const std::string& link_name,
+                                                                   const Eigen::Vector3d& center_position,
+                                                                   const double& r,
+                                                                   const robot_trajectory::RobotTrajectoryPtr& traj,
+                                                                   bool inverseOrder, std::size_t& index)
+{
+  ROS_DEBUG("Start binary search for intersection point.");
+
+  const size_t waypoint_num = traj->getWayPointCount();
+  if (waypoint_num < 2)
+  {
+    return false;
+  }
+
+  // Steps count the waypoints starting at the center, their distance to the
+  // center increases, so the last step inside the sphere is searched.
+  const WaypointFramePosition position(link_name, traj);
+  auto inside = [&](size_t step) {
+    const size_t i = inverseOrder ? waypoint_num - 1 - step : step;
+    return (position(*traj->getWayPointPtr(i)) - center_position).norm() < r;
+  };
+  // invariant: the waypoint at step low is inside the sphere, the one at step high is not
+  size_t low = 0;
+  size_t high = waypoint_num - 1;
+  if (!inside(low) || inside(high))
+  {
+    return false;
+  }
+  while (high - low > 1)
+  {
+    const size_t middle = low + (high - low) / 2;
+    if (inside(middle))
+    {
+      low = middle;
+    }
+    else
+    {
+      high = middle;
+    }
+  }
+
+  index = inverseOrder ? waypoint_num - 1 - low : low;
+  const size_t next = inverseOrder ? index - 1 : index + 1;
+  return intersectionFound(center_position, position(*traj->getWayPointPtr(index)),
+                           position(*traj->getWayPointPtr(next)), r);
+}
+
 bool pilz_industrial_motion_planner::intersectionFound(const Eigen::Vector3d& p_center,
                                                        const Eigen::Vector3d& p_current, const Eigen::Vector3d& p_next,
                                                        const double& r)
@@ -576,6 +842,79 @@ bool pilz_industrial_motion_planner::isStateColliding(const bool test_for_self_c
   return !collision_res.collision;
 }
 
+bool pilz_industrial_motion_planner::isTrajectoryCollisionFree(const planning_scene::PlanningSceneConstPtr& scene,
+                                                               const robot_trajectory::RobotTrajectory& trajectory,
+                                                               bool continuous, unsigned int thread_count,
+                                                               std::size_t* colliding_index)
+{
+  // number of samples claimed by a thread at a time
+  static const std::size_t CHUNK_SIZE = 16;
+
+  const std::size_t sample_count = trajectory.getWayPointCount();
+  const std::string group_name = trajectory.getGroup() ? trajectory.getGroup()->getName() : std::string();
+  const std::size_t chunk_count = (sample_count + CHUNK_SIZE - 1) / CHUNK_SIZE;
+  if (thread_count == 0)
+  {
+    thread_count = std::max(1u, std::thread::hardware_concurrency());
+  }
+  thread_count = std::max<std::size_t>(1, std::min<std::size_t>(thread_count, chunk_count));
+
+  // sample i is checked together with the motion from sample i - 1 to it; threads skip the samples after the first
+  // collision found so far, so the reported sample is the first colliding one
+  std::atomic<std::size_t> next_chunk(0);
+  std::atomic<std::size_t> first_collision(sample_count);
+  auto check_samples = [&]() {
+    collision_detection::CollisionRequest collision_req;
+    collision_req.group_name = group_name;
+    for (std::size_t chunk = next_chunk++; chunk < chunk_count; chunk = next_chunk++)
+    {
+      const std::size_t end = std::min(sample_count, (chunk + 1) * CHUNK_SIZE);
+      for (std::size_t i = chunk * CHUNK_SIZE; i < end && i < first_collision; ++i)
+      {
+        const robot_state::RobotState& state = trajectory.getWayPoint(i);
+        bool collision = scene->isStateColliding(state, group_name);
+        if (!collision && continuous && i > 0)
+        {
+          collision_detection::CollisionResult collision_res;
+          scene->getCollisionEnv()->checkRobotCollision(collision_req, collision_res, trajectory.getWayPoint(i - 1),
+                                                        state, scene->getAllowedCollisionMatrix());
+          collision = collision_res.collision;
+        }
+        if (collision)
+        {
+          std::size_t first = first_collision;
+          while (i < first && !first_collision.compare_exchange_weak(first, i))
+          {
+          }
+          break;
+        }
+      }
+    }
+  };
+
+  std::vector<std::thread> threads;
+  threads.reserve(thread_count - 1);
+  for (std::size_t t = 1; t < thread_count; ++t)
+  {
+    threads.emplace_back(check_samples);
+  }
+  check_samples();
+  for (std::thread& thread : threads)
+  {
+    thread.join();
+  }
+
+  if (first_collision == sample_count)
+  {
+    return true;
+  }
+  if (colliding_index)
+  {
+    *colliding_index = first_collision;
+  }
+  return false;
+}
+
 void normalizeQuaternion(geometry_msgs::Quaternion& quat)
 {
   tf2::Quaternion q;
@@ -41,6 +41,7 @@
 
 #include <Eigen/Geometry>
 #include <eigen_conversions/eigen_msg.h>
+#include <geometric_shapes/shapes.h>
 #include <kdl/frames.hpp>
 #include <kdl/path_roundedcomposite.hpp>
 #include <kdl/rotational_interpolation_sa.hpp>
@@ -580,6 +581,53 @@ TEST_P(TrajectoryFunctionsTestFlangeAndGripper, testVerifySampleJointLimitsVeloc
                                                                        duration_last, duration_current, joint_limits));
 }
 
+/**
+ * @brief Check that the vector overload of VerifySampleJointLimits() gives
+ * the same results as the map version.
+ *
+ * Test Sequence:
+ *    1. Call both versions with and without a velocity violation.
+ *
+ * Expected Results:
+ *    1. Both versions return 'false' for the violation and 'true' otherwise.
+ */
+TEST_P(TrajectoryFunctionsTestFlangeAndGripper, testVerifySampleJointLimitsVectorOverload)
+{
+  const std::vector<std::string> joint_names{ "joint_a", "joint_b" };
+  const std::vector<double> position_last{ 1.0, 2.0 };
+  const std::vector<double> velocity_last{ 0.0, 0.0 };
+  const std::vector<double> position_current{ 1.5, 2.5 };
+  double duration_current{ 1.0 };
+  double duration_last{ 1.0 };
+
+  pilz_industrial_motion_planner::JointLimitsContainer joint_limits;
+  JointLimit test_joint_limits;
+  test_joint_limits.max_velocity = 1.0;
+  test_joint_limits.has_velocity_limits = true;
+
+  std::map<std::string, double> position_last_map, velocity_last_map, position_current_map;
+  for (size_t i = 0; i < joint_names.size(); ++i)
+  {
+    joint_limits.addLimit(joint_names.at(i), test_joint_limits);
+    position_last_map[joint_names.at(i)] = position_last.at(i);
+    velocity_last_map[joint_names.at(i)] = velocity_last.at(i);
+    position_current_map[joint_names.at(i)] = position_current.at(i);
+  }
+  EXPECT_TRUE(pilz_industrial_motion_planner::verifySampleJointLimits(
+      joint_names, position_last, velocity_last, position_current, duration_last, duration_current, joint_limits));
+  EXPECT_TRUE(pilz_industrial_motion_planner::verifySampleJointLimits(position_last_map, velocity_last_map,
+                                                                      position_current_map, duration_last,
+                                                                      duration_current, joint_limits));
+
+  // the joints are too fast
+  duration_current = 0.25;
+  EXPECT_FALSE(pilz_industrial_motion_planner::verifySampleJointLimits(
+      joint_names, position_last, velocity_last, position_current, duration_last, duration_current, joint_limits));
+  EXPECT_FALSE(pilz_industrial_motion_planner::verifySampleJointLimits(position_last_map, velocity_last_map,
+                                                                       position_current_map, duration_last,
+                                                                       duration_current, joint_limits));
+}
+
 /**
  * @brief Check that function VerifySampleJointLimits() returns 'false' in case
  * of a acceleration violation.
@@ -962,6 +1010,62 @@ TEST_P(TrajectoryFunctionsTestFlangeAndGripper, testIsRobotStateStationaryAccele
   EXPECT_FALSE(pilz_industrial_motion_planner::isRobotStateStationary(rstate_1, planning_group_, epsilon));
 }
 
+/**
+ * @brief Check that isTrajectoryCollisionFree() finds the first colliding
+ * sample on several threads, and collisions between samples with continuous
+ * checks.
+ *
+ * Test Sequence:
+ *    1. Check a trajectory in an empty scene.
+ *    2. Add a box at the tcp of a sample in the middle and check again.
+ *    3. Check only the first and last samples, with and without continuous
+ *       checks.
+ *
+ * Expected Results:
+ *    1. The trajectory is collision free.
+ *    2. The first colliding sample is the first one found by checking the
+ *       samples in order.
+ *    3. The samples are collision free, the motion between them is not.
+ */
+TEST_P(TrajectoryFunctionsTestFlangeAndGripper, testIsTrajectoryCollisionFree)
+{
+  auto scene = std::make_shared<planning_scene::PlanningScene>(robot_model_);
+  robot_trajectory::RobotTrajectory trajectory(robot_model_, planning_group_);
+  robot_state::RobotState rstate(robot_model_);
+  rstate.setToDefaultValues();
+  const std::size_t sample_count = 40;
+  for (std::size_t i = 0; i < sample_count; ++i)
+  {
+    rstate.setVariablePosition(joint_names_.front(), static_cast<double>(i) / (sample_count - 1));
+    trajectory.addSuffixWayPoint(rstate, 0.1);
+  }
+  EXPECT_TRUE(pilz_industrial_motion_planner::isTrajectoryCollisionFree(scene, trajectory, true, 4));
+
+  const Eigen::Isometry3d box_pose = trajectory.getWayPoint(sample_count / 2).getFrameTransform(tcp_link_);
+  scene->getWorldNonConst()->addToObject("box", std::make_shared<shapes::Box>(0.2, 0.2, 0.2), box_pose);
+  std::size_t expected_index = sample_count;
+  for (std::size_t i = 0; i < sample_count && expected_index == sample_count; ++i)
+  {
+    if (scene->isStateColliding(trajectory.getWayPoint(i), planning_group_))
+    {
+      expected_index = i;
+    }
+  }
+  ASSERT_LE(expected_index, sample_count / 2);
+  std::size_t colliding_index;
+  EXPECT_FALSE(
+      pilz_industrial_motion_planner::isTrajectoryCollisionFree(scene, trajectory, false, 4, &colliding_index));
+  EXPECT_EQ(expected_index, colliding_index);
+
+  robot_trajectory::RobotTrajectory sparse_trajectory(robot_model_, planning_group_);
+  sparse_trajectory.addSuffixWayPoint(trajectory.getWayPoint(0), 0.0);
+  sparse_trajectory.addSuffixWayPoint(trajectory.getLastWayPoint(), 3.9);
+  EXPECT_TRUE(pilz_industrial_motion_planner::isTrajectoryCollisionFree(scene, sparse_trajectory, false));
+  EXPECT_FALSE(
+      pilz_industrial_motion_planner::isTrajectoryCollisionFree(scene, sparse_trajectory, true, 0, &colliding_index));
+  EXPECT_EQ(1u, colliding_index);
+}
+
 int main(int argc, char** argv)
 {
   ros::init(argc, argv, "unittest_trajectory_functions");
@@ -37,12 +37,24 @@
 #pragma once
 
 #include <boost/thread.hpp>
+#include <atomic>
+#include <utility>
+#include <vector>
 
 namespace sbpl_interface
 {
 #define WALL 0x7FFFFFFF
 #define UNDISCOVERED 0xFFFFFFFF
 
+/**
+ * \brief Breadth-first distances in a 26-connected 3D grid from an origin cell, computed in a background thread.
+ *
+ * The search expands one distance level at a time, splitting large levels across threads, so every cell is written
+ * once with its final distance and getDistance() can be called while the search is running.
+ *
+ * If the origin of run() is the same as for the previous search, only the distances that can be affected by the
+ * walls set or cleared since then are recomputed.
+ */
 class BFS_3D
 {
 private:
@@ -50,16 +62,26 @@ private:
   int dim_xy, dim_xyz;
 
   int origin;
-  int volatile* distance_grid;
+  std::atomic<int>* distance_grid;
 
   int* queue;
   int queue_head, queue_tail;
 
+  int neighbor_offsets[26];
+
+  /** \brief The cells whose wall state changed since the last search and their distance before the change */
+  std::vector<std::pair<int, int> > changed_cells;
+
+  /** \brief Whether distance_grid holds the distances of a completed search from origin */
+  bool search_complete;
+
   boost::shared_ptr<boost::thread> search_thread_;
 
-  volatile bool running;
+  std::atomic<bool> running;
 
-  void search(int, int, int volatile*, int*, int&, int&);
+  void search();
+  void expand(int begin, int end, int cost, std::vector<int>& discovered);
+  bool prepareIncrementalSearch();
   inline int getNode(int, int, int);
 
 public:
@@ -69,6 +91,7 @@ public:
   void getDimensions(int*, int*, int*);
 
   void setWall(int, int, int);
+  void clearWall(int, int, int);
   bool isWall(int, int, int);
 
   void run(int, int, int);
@@ -63,7 +63,7 @@ namespace sbpl_interface
 {
 struct PlanningStatistics
 {
-  PlanningStatistics() : total_expansions_(0), coll_checks_(0)
+  PlanningStatistics() : total_expansions_(0), coll_checks_(0), cached_successors_(0), swept_tip_rejections_(0)
   {
   }
 
@@ -71,6 +71,8 @@ struct PlanningStatistics
   ros::WallDuration total_expansion_time_;
   ros::WallDuration total_coll_check_time_;
   unsigned int coll_checks_;
+  unsigned int cached_successors_;     // successors answered from the hash without FK or collision checks
+  unsigned int swept_tip_rejections_;  // successors rejected by the swept tip pre-check
   ros::WallDuration total_planning_time_;
 };
 
@@ -237,6 +239,12 @@ public:
 protected:
   bool getGridXYZInt(const Eigen::Isometry3d& pose, int (&xyz)[3]) const;
 
+  /**
+   * @brief Cheap pre-check before the full collision check: returns true if the line of grid cells
+   * swept by the tip link origin between two cells crosses a BFS wall, i.e. an obstacle cell
+   */
+  bool isTipPathBlocked(const int (&from_xyz)[3], const int (&to_xyz)[3]);
+
   void getMotionPrimitives(const std::string& group);
 
   planning_scene::PlanningSceneConstPtr planning_scene_;
@@ -36,6 +36,7 @@
 
 #pragma once
 
+#include <deque>
 #include <vector>
 #include <planning_models/robot_model.h>
 #include <planning_models/angle_utils.h>
@@ -93,14 +94,7 @@ struct EnvChain3DPlanningData
     , hash_table_size_(HASH_TABLE_SIZE)
   {
     coord_to_state_ID_table_.resize(hash_table_size_);
-  }
-
-  ~EnvChain3DPlanningData()
-  {
-    for (unsigned int i = 0; i < state_ID_to_coord_table_.size(); i++)
-    {
-      delete state_ID_to_coord_table_[i];
-    }
+    colliding_coord_table_.resize(hash_table_size_);
   }
 
   unsigned int getHashBin(const std::vector<int>& coord)
@@ -116,7 +110,9 @@ struct EnvChain3DPlanningData
   EnvChain3DHashEntry* addHashEntry(const std::vector<int>& coord, const std::vector<double>& angles,
                                     const int (&xyz)[3], int action)
   {
-    EnvChain3DHashEntry* new_hash_entry = new EnvChain3DHashEntry();
+    // entries are allocated in chunks by the pool, which keeps their addresses stable
+    hash_entry_pool_.emplace_back();
+    EnvChain3DHashEntry* new_hash_entry = &hash_entry_pool_.back();
     new_hash_entry->stateID = state_ID_to_coord_table_.size();
     new_hash_entry->coord = coord;
     new_hash_entry->angles = angles;
@@ -152,6 +148,25 @@ struct EnvChain3DPlanningData
     return NULL;
   }
 
+  /** @brief records a coord whose state was found in collision, so that it is not checked again */
+  void addCollidingCoord(const std::vector<int>& coord)
+  {
+    colliding_coord_table_[getHashBin(coord)].push_back(coord);
+  }
+
+  bool isCollidingCoord(const std::vector<int>& coord)
+  {
+    const std::vector<std::vector<int> >& bin = colliding_coord_table_[getHashBin(coord)];
+    for (unsigned int i = 0; i < bin.size(); i++)
+    {
+      if (bin[i] == coord)
+      {
+        return true;
+      }
+    }
+    return false;
+  }
+
   bool convertFromStateIDsToAngles(const std::vector<int>& state_ids,
                                    std::vector<std::vector<double> >& angle_vector) const
   {
@@ -179,6 +194,12 @@ struct EnvChain3DPlanningData
 
   // vector that maps from stateID to coords
   std::vector<EnvChain3DHashEntry*> state_ID_to_coord_table_;
+
+  // coords of successors found in collision
+  std::vector<std::vector<std::vector<int> > > colliding_coord_table_;
+
+  // storage of all hash entries
+  std::deque<EnvChain3DHashEntry> hash_entry_pool_;
 };
 
 class JointMotionWrapper
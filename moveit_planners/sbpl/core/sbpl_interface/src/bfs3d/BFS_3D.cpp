@@ -33,6 +33,7 @@
  *********************************************************************/
 
 #include <sbpl_interface/bfs3d/BFS_3D.h>
+#include <algorithm>
 
 namespace sbpl_interface
 {
@@ -61,9 +62,16 @@ BFS_3D::BFS_3D(int width, int height, int length)
   dim_xy = dim_x * dim_y;
   dim_xyz = dim_xy * dim_z;
 
-  distance_grid = new int[dim_xyz];
+  distance_grid = new std::atomic<int>[dim_xyz];
   queue = new int[width * height * length];
 
+  int i = 0;
+  for (int dz = -1; dz <= 1; dz++)
+    for (int dy = -1; dy <= 1; dy++)
+      for (int dx = -1; dx <= 1; dx++)
+        if (dx != 0 || dy != 0 || dz != 0)
+          neighbor_offsets[i++] = dz * dim_xy + dy * dim_x + dx;
+
   for (int node = 0; node < dim_xyz; node++)
   {
     int x = node % dim_x, y = node / dim_x % dim_y, z = node / dim_xy;
@@ -73,6 +81,8 @@ BFS_3D::BFS_3D(int width, int height, int length)
       distance_grid[node] = UNDISCOVERED;
   }
 
+  origin = -1;
+  search_complete = false;
   running = false;
 }
 
@@ -104,7 +114,27 @@ void BFS_3D::setWall(int x, int y, int z)
   }
 
   int node = getNode(x, y, z);
-  distance_grid[node] = WALL;
+  if (distance_grid[node] != WALL)
+  {
+    changed_cells.push_back(std::make_pair(node, distance_grid[node].load()));
+    distance_grid[node] = WALL;
+  }
+}
+
+void BFS_3D::clearWall(int x, int y, int z)
+{
+  if (running)
+  {
+    // error "Cannot modify grid while search is running"
+    return;
+  }
+
+  int node = getNode(x, y, z);
+  if (distance_grid[node] == WALL)
+  {
+    changed_cells.push_back(std::make_pair(node, distance_grid[node].load()));
+    distance_grid[node] = UNDISCOVERED;
+  }
 }
 
 bool BFS_3D::isWall(int x, int y, int z)
@@ -121,21 +151,77 @@ void BFS_3D::run(int x, int y, int z)
     return;
   }
 
-  for (int i = 0; i < dim_xyz; i++)
-    if (distance_grid[i] != WALL)
-      distance_grid[i] = UNDISCOVERED;
+  if (search_thread_)
+    search_thread_->join();
 
-  origin = getNode(x, y, z);
+  int node = getNode(x, y, z);
+  if (!search_complete || node != origin || !prepareIncrementalSearch())
+  {
+    for (int i = 0; i < dim_xyz; i++)
+      if (distance_grid[i] != WALL)
+        distance_grid[i] = UNDISCOVERED;
 
-  queue_head = 0;
-  queue_tail = 1;
-  queue[0] = origin;
+    origin = node;
+
+    queue_head = 0;
+    queue_tail = 1;
+    queue[0] = origin;
 
-  distance_grid[origin] = 0;
+    distance_grid[origin] = 0;
+  }
+  changed_cells.clear();
+
+  if (queue_head == queue_tail)
+  {
+    // the changes cannot affect any distance
+    search_complete = true;
+    return;
+  }
 
-  search_thread_.reset(
-      new boost::thread(&BFS_3D::search, this, dim_x, dim_xy, distance_grid, queue, queue_head, queue_tail));
+  search_complete = false;
   running = true;
+  search_thread_.reset(new boost::thread(&BFS_3D::search, this));
+}
+
+bool BFS_3D::prepareIncrementalSearch()
+{
+  // A new wall only changes distances not smaller than its previous distance, a cleared wall only distances larger
+  // than those of its neighbors. All cells closer than the smallest such distance keep their distances.
+  int threshold = WALL;
+  for (const std::pair<int, int>& changed_cell : changed_cells)
+  {
+    if (changed_cell.second >= 0 && changed_cell.second != WALL)
+      threshold = std::min(threshold, changed_cell.second);
+    if (distance_grid[changed_cell.first] != WALL)
+      for (int offset : neighbor_offsets)
+      {
+        int distance = distance_grid[changed_cell.first + offset];
+        if (distance >= 0 && distance != WALL)
+          threshold = std::min(threshold, distance + 1);
+      }
+  }
+
+  // the origin itself became a wall
+  if (threshold == 0)
+    return false;
+
+  queue_head = 0;
+  queue_tail = 0;
+  if (threshold == WALL)
+    return true;
+
+  // restart the search from all cells just below the threshold, every shortest path beyond passes through them
+  for (int i = 0; i < dim_xyz; i++)
+  {
+    int distance = distance_grid[i];
+    if (distance == WALL || distance < 0)
+      continue;
+    if (distance >= threshold)
+      distance_grid[i] = UNDISCOVERED;
+    else if (distance == threshold - 1)
+      queue[queue_tail++] = i;
+  }
+  return true;
 }
 
 int BFS_3D::getDistance(int x, int y, int z)
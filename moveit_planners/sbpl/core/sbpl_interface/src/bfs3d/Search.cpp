@@ -33,54 +33,69 @@
  *********************************************************************/
 
 #include <sbpl_interface/bfs3d/BFS_3D.h>
+#include <algorithm>
 #include <iostream>
 #include <boost/thread.hpp>
 
 namespace sbpl_interface
 {
-#define EXPAND_NEIGHBOR(offset)                                                                                        \
-  if (distance_grid[currentNode + offset] < 0)                                                                         \
-  {                                                                                                                    \
-    queue[queue_tail++] = currentNode + offset;                                                                        \
-    distance_grid[currentNode + offset] = currentCost;                                                                 \
-    boost::this_thread::interruption_point();                                                                          \
+// Levels with fewer cells per thread are expanded by the search thread alone
+static const int MIN_CELLS_PER_THREAD = 4096;
+
+void BFS_3D::expand(int begin, int end, int cost, std::vector<int>& discovered)
+{
+  for (int i = begin; i < end; i++)
+  {
+    int currentNode = queue[i];
+    for (int offset : neighbor_offsets)
+    {
+      // claim the cell, so it is written only once even if several threads reach it
+      int expected = static_cast<int>(UNDISCOVERED);
+      if (distance_grid[currentNode + offset].load(std::memory_order_relaxed) < 0 &&
+          distance_grid[currentNode + offset].compare_exchange_strong(expected, cost, std::memory_order_relaxed))
+        discovered.push_back(currentNode + offset);
+    }
   }
+}
 
-void BFS_3D::search(int width, int planeSize, int volatile* distance_grid, int* queue, int& queue_head, int& queue_tail)
+void BFS_3D::search()
 {
+  const int num_threads = std::max(1u, boost::thread::hardware_concurrency());
+  std::vector<std::vector<int> > discovered(num_threads);
+
+  // expand one distance level at a time, so all cells get their final distance when first written
   while (queue_head < queue_tail)
   {
-    int currentNode = queue[queue_head++];
-    int currentCost = distance_grid[currentNode] + 1;
+    boost::this_thread::interruption_point();
+
+    int levelBegin = queue_head, levelEnd = queue_tail;
+    int currentCost = distance_grid[queue[levelBegin]] + 1;
+    int levelThreads = std::max(1, std::min(num_threads, (levelEnd - levelBegin) / MIN_CELLS_PER_THREAD));
+
+    if (levelThreads == 1)
+      expand(levelBegin, levelEnd, currentCost, discovered[0]);
+    else
+    {
+      boost::thread_group workers;
+      for (int t = 1; t < levelThreads; t++)
+        workers.create_thread([this, &discovered, levelBegin, levelEnd, levelThreads, currentCost, t] {
+          expand(levelBegin + (levelEnd - levelBegin) * t / levelThreads,
+                 levelBegin + (levelEnd - levelBegin) * (t + 1) / levelThreads, currentCost, discovered[t]);
+        });
+      expand(levelBegin, levelBegin + (levelEnd - levelBegin) / levelThreads, currentCost, discovered[0]);
+      workers.join_all();
+    }
 
-    EXPAND_NEIGHBOR(-width);
-    EXPAND_NEIGHBOR(1);
-    EXPAND_NEIGHBOR(width);
-    EXPAND_NEIGHBOR(-1);
-    EXPAND_NEIGHBOR(-width - 1);
-    EXPAND_NEIGHBOR(-width + 1);
-    EXPAND_NEIGHBOR(width + 1);
-    EXPAND_NEIGHBOR(width - 1);
-    EXPAND_NEIGHBOR(planeSize);
-    EXPAND_NEIGHBOR(-width + planeSize);
-    EXPAND_NEIGHBOR(1 + planeSize);
-    EXPAND_NEIGHBOR(width + planeSize);
-    EXPAND_NEIGHBOR(-1 + planeSize);
-    EXPAND_NEIGHBOR(-width - 1 + planeSize);
-    EXPAND_NEIGHBOR(-width + 1 + planeSize);
-    EXPAND_NEIGHBOR(width + 1 + planeSize);
-    EXPAND_NEIGHBOR(width - 1 + planeSize);
-    EXPAND_NEIGHBOR(-planeSize);
-    EXPAND_NEIGHBOR(-width - planeSize);
-    EXPAND_NEIGHBOR(1 - planeSize);
-    EXPAND_NEIGHBOR(width - planeSize);
-    EXPAND_NEIGHBOR(-1 - planeSize);
-    EXPAND_NEIGHBOR(-width - 1 - planeSize);
-    EXPAND_NEIGHBOR(-width + 1 - planeSize);
-    EXPAND_NEIGHBOR(width + 1 - planeSize);
-    EXPAND_NEIGHBOR(width - 1 - planeSize);
+    queue_head = levelEnd;
+    for (int t = 0; t < levelThreads; t++)
+    {
+      std::copy(discovered[t].begin(), discovered[t].end(), queue + queue_tail);
+      queue_tail += discovered[t].size();
+      discovered[t].clear();
+    }
   }
   // std::cerr << "Search thread done" << std::endl;
+  search_complete = true;
   running = false;
 }
 }  // namespace sbpl_interface
@@ -35,6 +35,7 @@
 /* Author: Benjamin Cohen, E. Gil Jones */
 
 #include <sbpl_interface/environment_chain3d.h>
+#include <sbpl_interface/bresenham.h>
 #include <collision_detection/collision_common.h>
 #include <planning_models/conversions.h>
 #include <boost/timer.hpp>
@@ -228,54 +229,68 @@ void EnvironmentChain3D::GetSuccs(int source_state_ID, std::vector<int>* succ_id
     // }
     convertJointAnglesToCoord(succ_joint_angles, succ_coord);
 
-    joint_state_group_->setStateValues(succ_joint_angles);
-
-    kinematic_constraints::ConstraintEvaluationResult con_res = path_constraint_set_.decide(state_);
-    if (!con_res.satisfied)
+    // states are only hashed after passing the collision check, so for a known coord the cached
+    // tip cell is used and forward kinematics and the state collision check are skipped
+    if (planning_data_.isCollidingCoord(succ_coord))
     {
-      ROS_INFO_STREAM("State violates path constraints");
+      planning_statistics_.cached_successors_++;
+      continue;
     }
+    EnvChain3DHashEntry* known_hash_entry = planning_data_.getHashEntry(succ_coord, i);
 
-    // if(!joint_state_group_->satisfiesBounds()) {
-    //   std::cerr << "ERROR - successor doesn't satisfy bounds" << std::endl;
-    //   //std::cerr << "Successor doesn't satisfy bounds" << std::endl;
-    //   continue;
-    // }
-    ros::WallTime before_coll = ros::WallTime::now();
-    collision_detection::CollisionRequest req;
-    collision_detection::CollisionResult res;
-    req.group_name = planning_group_;
-    if (!planning_parameters_.use_standard_collision_checking_)
+    int xyz[3] = { 0, 0, 0 };
+    if (known_hash_entry)
     {
-      hy_env_->checkCollisionDistanceField(req, res, *hy_env_->getCollisionRobotDistanceField().get(), state_, gsr_);
+      planning_statistics_.cached_successors_++;
+      memcpy(xyz, known_hash_entry->xyz, sizeof(int) * 3);
     }
     else
     {
-      planning_scene_->checkCollision(req, res, state_);
-    }
-    planning_statistics_.coll_checks_++;
-    // std::cerr << "Elapsed " << t.elapsed() << std::endl;
-    ros::WallDuration dur(ros::WallTime::now() - before_coll);
-    // std::cerr << dur.toSec() << std::endl;
-    // ROS_DEBUG_STREAM("Time " << ros::WallTime::now()-before_coll);
-    planning_statistics_.total_coll_check_time_ += dur;
-    if (res.collision)
-    {
-      // std::cerr << "Successor in collision" << std::endl;
-      continue;
-    }
+      joint_state_group_->setStateValues(succ_joint_angles);
 
-    Eigen::Isometry3d pose = tip_link_state_->getGlobalLinkTransform();
+      kinematic_constraints::ConstraintEvaluationResult con_res = path_constraint_set_.decide(state_);
+      if (!con_res.satisfied)
+      {
+        ROS_INFO_STREAM("State violates path constraints");
+      }
 
-    int xyz[3];
-    if (!planning_parameters_.use_standard_collision_checking_)
-    {
-      if (!getGridXYZInt(pose, xyz))
+      if (!planning_parameters_.use_standard_collision_checking_)
+      {
+        Eigen::Isometry3d pose = tip_link_state_->getGlobalLinkTransform();
+        if (!getGridXYZInt(pose, xyz))
+        {
+          std::cerr << "Can't get successor x y z" << std::endl;
+          continue;
+        }
+        if (planning_parameters_.use_bfs_ && isTipPathBlocked(hash_entry->xyz, xyz))
+        {
+          // only this motion is rejected, the state may still be reachable from other sources
+          planning_statistics_.swept_tip_rejections_++;
+          continue;
+        }
+      }
+
+      ros::WallTime before_coll = ros::WallTime::now();
+      collision_detection::CollisionRequest req;
+      collision_detection::CollisionResult res;
+      req.group_name = planning_group_;
+      if (!planning_parameters_.use_standard_collision_checking_)
+      {
+        hy_env_->checkCollisionDistanceField(req, res, *hy_env_->getCollisionRobotDistanceField().get(), state_, gsr_);
+      }
+      else
       {
-        std::cerr << "Can't get successor x y z" << std::endl;
+        planning_scene_->checkCollision(req, res, state_);
+      }
+      planning_statistics_.coll_checks_++;
+      planning_statistics_.total_coll_check_time_ += ros::WallTime::now() - before_coll;
+      if (res.collision)
+      {
+        planning_data_.addCollidingCoord(succ_coord);
         continue;
       }
     }
+
     int dist;
     if (planning_parameters_.use_bfs_)
     {
@@ -331,7 +346,7 @@ void EnvironmentChain3D::GetSuccs(int source_state_ID, std::vector<int>* succ_id
           continue;
         }
       }
-      succ_hash_entry = planning_data_.getHashEntry(succ_coord, i);
+      succ_hash_entry = known_hash_entry;
     }
     // double max_dist = getJointDistanceMax(planning_data_.goal_hash_entry_->angles, succ_joint_angles);
     // if(max_dist < closest_to_goal_) {
@@ -899,6 +914,22 @@ bool EnvironmentChain3D::getGridXYZInt(const Eigen::Isometry3d& pose, int (&xyz)
   return true;
 }
 
+bool EnvironmentChain3D::isTipPathBlocked(const int (&from_xyz)[3], const int (&to_xyz)[3])
+{
+  bresenham3d_param_t params;
+  get_bresenham3d_parameters(from_xyz[0], from_xyz[1], from_xyz[2], to_xyz[0], to_xyz[1], to_xyz[2], &params);
+  do
+  {
+    int x, y, z;
+    get_current_point3d(&params, &x, &y, &z);
+    if (bfs_->isWall(x, y, z))
+    {
+      return true;
+    }
+  } while (get_next_point3d(&params));
+  return false;
+}
+
 bool EnvironmentChain3D::populateTrajectoryFromStateIDSequence(const std::vector<int>& state_ids,
                                                                trajectory_msgs::JointTrajectory& traj) const
 {
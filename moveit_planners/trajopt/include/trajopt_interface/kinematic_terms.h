@@ -4,6 +4,11 @@
 
 #include <Eigen/Geometry>
 
+#include <trajopt_sco/modeling.hpp>
+
+#include <string>
+#include <vector>
+
 namespace trajopt_interface
 {
 /**
@@ -90,4 +95,39 @@ struct JointVelJacobianCalculator : sco::MatrixOfVector
   Eigen::MatrixXd operator()(const Eigen::VectorXd& var_vals) const;
 };
 
+/**
+ * @brief Penalizes every timestep by coeff * max(0, safety_margin - d), where d is the distance of the robot to the
+ * world.
+ *
+ * The distances of all timesteps, and their numerical gradients for the linearization, are computed on up to
+ * thread_count threads (0 selects the number of hardware threads). Each thread uses its own clone of the planning
+ * scene, so no collision environment is shared between threads. The cost of each timestep is computed independently
+ * and summed in timestep order, so the result does not depend on the number of threads.
+ */
+class CollisionCost : public sco::Cost
+{
+public:
+  CollisionCost(const planning_scene::PlanningSceneConstPtr& planning_scene, const std::string& group_name,
+                const std::vector<sco::VarVector>& timestep_vars, double safety_margin, double coeff,
+                unsigned int thread_count = 0);
+
+  double value(const sco::DblVec& x) override;
+  sco::ConvexObjectivePtr convex(const sco::DblVec& x, sco::Model* model) override;
+  sco::VarVector getVars() override;
+
+private:
+  /** @brief Compute the distance of every timestep, and its gradient if it is within twice the safety margin */
+  void computeDistances(const sco::DblVec& x, bool with_gradients);
+
+  std::string group_name_;
+  std::vector<sco::VarVector> timestep_vars_;
+  double safety_margin_;
+  double coeff_;
+  /** @brief One clone of the planning scene per thread */
+  std::vector<planning_scene::PlanningScenePtr> scenes_;
+  std::vector<double> distances_;
+  /** @brief Gradients of the distances, empty for timesteps far from collision */
+  std::vector<Eigen::VectorXd> gradients_;
+};
+
 }  // namespace trajopt_interface
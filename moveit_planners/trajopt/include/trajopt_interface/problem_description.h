@@ -52,6 +52,9 @@ MOVEIT_CLASS_FORWARD(CartPoseTermInfo);  // Defines CartPoseTermInfoPtr, ConstPt
 struct JointVelTermInfo;
 MOVEIT_CLASS_FORWARD(JointVelTermInfo);  // Defines JointVelTermInfoPtr, ConstPtr, WeakPtr... etc
 
+struct CollisionTermInfo;
+MOVEIT_CLASS_FORWARD(CollisionTermInfo);  // Defines CollisionTermInfoPtr, ConstPtr, WeakPtr... etc
+
 struct ProblemInfo;
 TrajOptProblemPtr ConstructProblem(const ProblemInfo&);
 
@@ -224,6 +227,10 @@ public:
   {
     return planning_scene_;
   }
+  const std::string& GetPlanningGroup()
+  {
+    return planning_group_;
+  }
   void SetInitTraj(const trajopt::TrajArray& x)
   {
     matrix_init_traj = x;
@@ -361,6 +368,43 @@ struct JointVelTermInfo : public TermInfo
   }
 };
 
+/**
+  \brief Collision cost
+    Penalizes the timesteps that are closer to the world than the safety margin, see CollisionCost
+
+  \f{align*}{
+  \sum_t c \max(0, d_{safe} - d_t)
+  \f}
+  where \f$t\f$ indexes over the timesteps and \f$d_t\f$ is the distance of the robot to the world at timestep t
+ */
+struct CollisionTermInfo : public TermInfo
+{
+  /** @brief Coefficient that scales the cost. Default: 20 */
+  double coeff = 20.0;
+  /** @brief Distance to the world below which timesteps are penalized. Default: 0.025 */
+  double safety_margin = 0.025;
+  /** @brief First time step to which the term is applied. Default: 0 */
+  int first_step = 0;
+  /** @brief Last time step to which the term is applied. Default: prob.GetNumSteps() - 1*/
+  int last_step = -1;
+  /** @brief Number of threads evaluating the timesteps. Default: 0, the number of hardware threads */
+  unsigned int thread_count = 0;
+
+  /** @brief Initialize term with it's supported types */
+  CollisionTermInfo() : TermInfo(TT_COST)
+  {
+  }
+
+  /** @brief Converts term info into cost and adds it to trajopt problem */
+  void addObjectiveTerms(TrajOptProblem& prob) override;
+
+  static TermInfoPtr create()
+  {
+    TermInfoPtr out(new CollisionTermInfo());
+    return out;
+  }
+};
+
 void generateInitialTrajectory(const ProblemInfo& pci, const std::vector<double>& current_joint_values,
                                trajopt::TrajArray& init_traj);
 
@@ -1,6 +1,10 @@
 #include <Eigen/Geometry>
 #include <boost/format.hpp>
 
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
 #include <trajopt_sco/expr_ops.hpp>
 #include <trajopt_sco/modeling_utils.hpp>
 
@@ -12,6 +16,12 @@ using namespace Eigen;
 
 namespace trajopt_interface
 {
+namespace
+{
+/** @brief Step of the joint positions for the numerical gradients of the distances */
+constexpr double DISTANCE_GRADIENT_STEP = 1e-4;
+}  // namespace
+
 VectorXd CartPoseErrCalculator::operator()(const VectorXd& dof_vals) const
 {
   // TODO: create the actual error function from information in planning scene
@@ -61,4 +71,101 @@ MatrixXd JointVelJacobianCalculator::operator()(const VectorXd& var_vals) const
   return jac;
 }
 
+CollisionCost::CollisionCost(const planning_scene::PlanningSceneConstPtr& planning_scene,
+                             const std::string& group_name, const std::vector<VarVector>& timestep_vars,
+                             double safety_margin, double coeff, unsigned int thread_count)
+  : group_name_(group_name), timestep_vars_(timestep_vars), safety_margin_(safety_margin), coeff_(coeff)
+{
+  if (thread_count == 0)
+    thread_count = std::max(1u, std::thread::hardware_concurrency());
+  thread_count = std::max<std::size_t>(1, std::min<std::size_t>(thread_count, timestep_vars_.size()));
+  for (unsigned int t = 0; t < thread_count; ++t)
+    scenes_.push_back(planning_scene::PlanningScene::clone(planning_scene));
+}
+
+double CollisionCost::value(const DblVec& x)
+{
+  computeDistances(x, false);
+  double cost = 0.0;
+  for (double distance : distances_)
+    cost += coeff_ * std::max(0.0, safety_margin_ - distance);
+  return cost;
+}
+
+ConvexObjectivePtr CollisionCost::convex(const DblVec& x, Model* model)
+{
+  computeDistances(x, true);
+  ConvexObjectivePtr out(new ConvexObjective(model));
+  for (std::size_t i = 0; i < timestep_vars_.size(); ++i)
+  {
+    if (gradients_[i].size() == 0)
+      continue;
+
+    // safety_margin - (d + g * (q - q_x)), hinged at zero
+    AffExpr penetration(safety_margin_ - distances_[i]);
+    for (std::size_t j = 0; j < timestep_vars_[i].size(); ++j)
+    {
+      penetration.constant += gradients_[i](j) * timestep_vars_[i][j].value(x);
+      penetration.coeffs.push_back(-gradients_[i](j));
+      penetration.vars.push_back(timestep_vars_[i][j]);
+    }
+    out->addHinge(penetration, coeff_);
+  }
+  return out;
+}
+
+VarVector CollisionCost::getVars()
+{
+  VarVector vars;
+  for (const VarVector& timestep_vars : timestep_vars_)
+    vars.insert(vars.end(), timestep_vars.begin(), timestep_vars.end());
+  return vars;
+}
+
+void CollisionCost::computeDistances(const DblVec& x, bool with_gradients)
+{
+  const std::size_t count = timestep_vars_.size();
+  distances_.assign(count, 0.0);
+  gradients_.assign(count, VectorXd());
+
+  // timesteps are claimed one at a time, as the distance queries are much cheaper far from obstacles
+  std::atomic<std::size_t> next_index(0);
+  auto worker = [&](const planning_scene::PlanningScenePtr& scene) {
+    moveit::core::RobotState state = scene->getCurrentState();
+    const moveit::core::JointModelGroup* group = state.getJointModelGroup(group_name_);
+    std::vector<double> positions;
+    auto distance = [&]() {
+      state.setJointGroupPositions(group, positions);
+      state.update();
+      return scene->distanceToCollision(state);
+    };
+
+    for (std::size_t i = next_index++; i < count; i = next_index++)
+    {
+      positions.clear();
+      for (const Var& var : timestep_vars_[i])
+        positions.push_back(var.value(x));
+      distances_[i] = distance();
+      if (!with_gradients || distances_[i] >= 2.0 * safety_margin_)
+        continue;
+
+      gradients_[i].resize(positions.size());
+      for (std::size_t j = 0; j < positions.size(); ++j)
+      {
+        positions[j] += DISTANCE_GRADIENT_STEP;
+        gradients_[i](j) = (distance() - distances_[i]) / DISTANCE_GRADIENT_STEP;
+        positions[j] -= DISTANCE_GRADIENT_STEP;
+      }
+    }
+  };
+
+  std::vector<std::thread> threads;
+  threads.reserve(scenes_.size() - 1);
+  for (std::size_t t = 1; t < scenes_.size(); ++t)
+    threads.emplace_back(worker, scenes_[t]);
+  worker(scenes_[0]);
+  for (std::thread& thread : threads)
+    thread.join();
+}
+
 }  // namespace trajopt_interface
@@ -35,6 +35,10 @@
 
 #include <ros/ros.h>
 
+#include <map>
+#include <mutex>
+#include <tuple>
+
 #include <moveit/planning_interface/planning_interface.h>
 #include <moveit/planning_scene/planning_scene.h>
 #include <moveit_msgs/MotionPlanRequest.h>
@@ -77,22 +81,46 @@ TrajOptProblem::TrajOptProblem()
 {
 }
 
-TrajOptProblem::TrajOptProblem(const ProblemInfo& problem_info)
-  : OptProb(problem_info.basic_info.convex_solver)
-  , planning_scene_(problem_info.planning_scene)
-  , planning_group_(problem_info.planning_group_name)
+namespace
+{
+/** @brief Names and bounds of the optimization variables, which only depend on the group and the step layout */
+struct VariableLayout
 {
-  moveit::core::RobotModelConstPtr robot_model = planning_scene_->getRobotModel();
-  moveit::core::RobotState current_state = planning_scene_->getCurrentState();
-  const moveit::core::JointModelGroup* joint_model_group = current_state.getJointModelGroup(planning_group_);
+  int dof;
+  trajopt::DblVec lower;
+  trajopt::DblVec upper;
+  std::vector<std::string> names;
+};
+
+using VariableLayoutKey = std::tuple<std::string, std::string, int, bool, double, double>;
+
+const VariableLayout& getVariableLayout(const ProblemInfo& problem_info)
+{
+  // layouts are kept for the life time of the process, as there are only few combinations of groups and step counts
+  static std::map<VariableLayoutKey, VariableLayout> layouts;
+  static std::mutex layouts_lock;
+
+  const BasicInfo& bi = problem_info.basic_info;
+  const moveit::core::RobotModelConstPtr& robot_model = problem_info.planning_scene->getRobotModel();
+  const VariableLayoutKey key(robot_model->getName(), problem_info.planning_group_name, bi.n_steps, bi.use_time,
+                              bi.dt_lower_lim, bi.dt_upper_lim);
+
+  std::lock_guard<std::mutex> _(layouts_lock);
+  std::map<VariableLayoutKey, VariableLayout>::const_iterator it = layouts.find(key);
+  if (it != layouts.end())
+    return it->second;
+
+  const moveit::core::JointModelGroup* joint_model_group =
+      robot_model->getJointModelGroup(problem_info.planning_group_name);
 
   moveit::core::JointBoundsVector bounds = joint_model_group->getActiveJointModelsBounds();
-  dof_ = joint_model_group->getActiveJointModelNames().size();  // or bounds.size();
+  VariableLayout& layout = layouts[key];
+  layout.dof = joint_model_group->getActiveJointModelNames().size();  // or bounds.size();
 
-  int n_steps = problem_info.basic_info.n_steps;
+  int n_steps = bi.n_steps;
 
   ROS_INFO(" ======================================= problem_description: limits");
-  Eigen::MatrixX2d limits(dof_, 2);
+  Eigen::MatrixX2d limits(layout.dof, 2);
   for (int k = 0; k < limits.size() / 2; ++k)
   {
     moveit::core::JointModel::Bounds bound = *bounds[k];
@@ -109,26 +137,38 @@ TrajOptProblem::TrajOptProblem(const ProblemInfo& problem_info)
   lower = limits.col(0);
   upper = limits.col(1);
 
-  trajopt::DblVec vlower, vupper;
-  std::vector<std::string> names;
   for (int i = 0; i < n_steps; ++i)
   {
-    for (int j = 0; j < dof_; ++j)
+    for (int j = 0; j < layout.dof; ++j)
     {
-      names.push_back((boost::format("j_%i_%i") % i % j).str());
+      layout.names.push_back((boost::format("j_%i_%i") % i % j).str());
     }
-    vlower.insert(vlower.end(), lower.data(), lower.data() + lower.size());
-    vupper.insert(vupper.end(), upper.data(), upper.data() + upper.size());
+    layout.lower.insert(layout.lower.end(), lower.data(), lower.data() + lower.size());
+    layout.upper.insert(layout.upper.end(), upper.data(), upper.data() + upper.size());
 
-    if (problem_info.basic_info.use_time == true)
+    if (bi.use_time == true)
     {
-      vlower.insert(vlower.end(), problem_info.basic_info.dt_lower_lim);
-      vupper.insert(vupper.end(), problem_info.basic_info.dt_upper_lim);
-      names.push_back((boost::format("dt_%i") % i).str());
+      layout.lower.insert(layout.lower.end(), bi.dt_lower_lim);
+      layout.upper.insert(layout.upper.end(), bi.dt_upper_lim);
+      layout.names.push_back((boost::format("dt_%i") % i).str());
     }
   }
+  return layout;
+}
+}  // namespace
+
+TrajOptProblem::TrajOptProblem(const ProblemInfo& problem_info)
+  : OptProb(problem_info.basic_info.convex_solver)
+  , planning_scene_(problem_info.planning_scene)
+  , planning_group_(problem_info.planning_group_name)
+{
+  // the variables belong to the model of this problem and are created every time, but their names and bounds are
+  // reused between requests for the same group
+  const VariableLayout& layout = getVariableLayout(problem_info);
+  dof_ = layout.dof;
 
-  sco::VarVector trajvarvec = createVariables(names, vlower, vupper);
+  int n_steps = problem_info.basic_info.n_steps;
+  sco::VarVector trajvarvec = createVariables(layout.names, layout.lower, layout.upper);
   matrix_traj_vars = trajopt::VarArray(n_steps, dof_ + (problem_info.basic_info.use_time ? 1 : 0), trajvarvec.data());
   // matrix_traj_vars is essentialy a matrix of elements like:
   // j_0_0, j_0_1 ...
@@ -546,6 +586,40 @@ void JointVelTermInfo::addObjectiveTerms(TrajOptProblem& prob)
   }
 }
 
+void CollisionTermInfo::addObjectiveTerms(TrajOptProblem& prob)
+{
+  if (last_step <= -1)
+    last_step = prob.GetNumSteps() - 1;
+
+  // Check time step is valid
+  if ((prob.GetNumSteps() - 1) <= first_step)
+    first_step = prob.GetNumSteps() - 1;
+  if ((prob.GetNumSteps() - 1) <= last_step)
+    last_step = prob.GetNumSteps() - 1;
+  if (last_step < first_step)
+  {
+    int tmp = first_step;
+    first_step = last_step;
+    last_step = tmp;
+    ROS_WARN("Last time step for CollisionTerm comes before first step. Reversing them.");
+  }
+
+  if (term_type & TT_COST)
+  {
+    std::vector<sco::VarVector> timestep_vars;
+    for (int i = first_step; i <= last_step; ++i)
+      timestep_vars.push_back(prob.GetVarRow(i, 0, prob.GetActiveGroupNumDOF()));
+
+    prob.addCost(sco::CostPtr(new CollisionCost(prob.GetPlanningScene(), prob.GetPlanningGroup(), timestep_vars,
+                                                safety_margin, coeff, thread_count)));
+    prob.getCosts().back()->setName(name);
+  }
+  else
+  {
+    ROS_WARN("CollisionTermInfo does not have a valid term_type defined. No cost applied");
+  }
+}
+
 void generateInitialTrajectory(const ProblemInfo& pci, const std::vector<double>& current_joint_values,
                                trajopt::TrajArray& init_traj)
 {
@@ -48,6 +48,7 @@
 #include <ros/ros.h>
 #include <rosparam_shortcuts/rosparam_shortcuts.h>
 
+#include <algorithm>
 #include <limits>
 #include <vector>
 #include <Eigen/Geometry>
@@ -210,6 +211,23 @@ bool TrajOptInterface::solve(const planning_scene::PlanningSceneConstPtr& planni
   joint_vel->term_type = trajopt_interface::TT_COST;
   problem_info.cost_infos.push_back(joint_vel);
 
+  bool collision_cost;
+  nh_.param("collision_cost_info/enabled", collision_cost, false);
+  if (collision_cost)
+  {
+    ROS_INFO(" ======================================= Collision Cost");
+    CollisionTermInfoPtr collision(new CollisionTermInfo);
+
+    nh_.param("collision_cost_info/coeff", collision->coeff, 20.0);
+    nh_.param("collision_cost_info/safety_margin", collision->safety_margin, 0.025);
+    int thread_count;
+    nh_.param("collision_cost_info/thread_count", thread_count, 0);
+    collision->thread_count = std::max(0, thread_count);
+    collision->name = "collision";
+    collision->term_type = trajopt_interface::TT_COST;
+    problem_info.cost_infos.push_back(collision);
+  }
+
   ROS_INFO(" ======================================= Visibility Constraints");
   if (!req.goal_constraints[0].visibility_constraints.empty())
   {
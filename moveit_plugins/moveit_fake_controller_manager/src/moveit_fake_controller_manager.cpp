@@ -75,6 +75,19 @@ public:
     /* by setting latch to true we preserve the initial joint state while other nodes launch */
     pub_ = node_->create_publisher<sensor_msgs::msg::JointState>("fake_controller_joint_states", 100);
 
+    /* trajectories are executed time_scaling times faster than real time */
+    if (node_->has_parameter(param_base_name + ".time_scaling"))
+      node_->get_parameter(param_base_name + ".time_scaling", time_scaling_);
+    if (time_scaling_ <= 0.0)
+    {
+      RCLCPP_WARN(LOGGER, "Parameter time_scaling should be positive, using 1.0");
+      time_scaling_ = 1.0;
+    }
+
+    /* pass the joint states to the current state monitor instead of over the topic */
+    if (node_->has_parameter(param_base_name + ".in_process"))
+      node_->get_parameter(param_base_name + ".in_process", in_process_);
+
     /* publish initial pose */
     rcl_interfaces::msg::ListParametersResult params_result = node->list_parameters(
         { param_base_name + ".initial" }, rcl_interfaces::srv::ListParameters::Request::DEPTH_RECURSIVE);
@@ -83,6 +96,7 @@ public:
       sensor_msgs::msg::JointState js = loadInitialJointValues(params_result.names);
       js.header.stamp = rclcpp::Clock(RCL_ROS_TIME).now();
       pub_->publish(js);
+      initial_joint_state_ = std::make_shared<const sensor_msgs::msg::JointState>(js);
     }
 
     std::vector<std::string> controller_names = controller_names_param.as_string_array();
@@ -105,7 +119,8 @@ public:
         if (type == "last point")
           controllers_[controller_name].reset(new LastPointController(controller_name, controller_joints, pub_));
         else if (type == "via points")
-          controllers_[controller_name].reset(new ViaPointController(controller_name, controller_joints, pub_));
+          controllers_[controller_name].reset(
+              new ViaPointController(controller_name, controller_joints, pub_, time_scaling_));
         else if (type == "interpolate")
         {
           double rate = 10.0;
@@ -114,7 +129,7 @@ public:
           if (node_->has_parameter(fake_interp_rate_param))
             node_->get_parameter(fake_interp_rate_param, rate);
           controllers_[controller_name].reset(
-              new InterpolatingController(controller_name, controller_joints, pub_, rate));
+              new InterpolatingController(controller_name, controller_joints, pub_, rate, time_scaling_));
         }
         else
           RCLCPP_ERROR_STREAM(LOGGER, "Unknown fake controller type: " << type);
@@ -274,6 +289,19 @@ public:
     return controller_states_[name];
   }
 
+  /*
+   * With the in_process parameter, the controllers pass the joint states to the callback directly
+   */
+  void setJointStateCallback(const JointStateCallback& callback) override
+  {
+    if (!in_process_)
+      return;
+    for (const std::pair<const std::string, BaseFakeControllerPtr>& controller : controllers_)
+      controller.second->setJointStateCallback(callback);
+    if (callback && initial_joint_state_)
+      callback(initial_joint_state_);
+  }
+
   /* Cannot switch our controllers */
   bool switchControllers(const std::vector<std::string>& /*activate*/,
                          const std::vector<std::string>& /*deactivate*/) override
@@ -286,6 +314,9 @@ protected:
   rclcpp::Publisher<sensor_msgs::msg::JointState>::SharedPtr pub_;
   std::map<std::string, BaseFakeControllerPtr> controllers_;
   std::map<std::string, moveit_controller_manager::MoveItControllerManager::ControllerState> controller_states_;
+  sensor_msgs::msg::JointState::ConstSharedPtr initial_joint_state_;
+  double time_scaling_ = 1.0;
+  bool in_process_ = false;
 };
 
 }  // end namespace moveit_fake_controller_manager
@@ -64,6 +64,24 @@ moveit_controller_manager::ExecutionStatus BaseFakeController::getLastExecutionS
   return moveit_controller_manager::ExecutionStatus::SUCCEEDED;
 }
 
+void BaseFakeController::setJointStateCallback(
+    const moveit_controller_manager::MoveItControllerManager::JointStateCallback& callback)
+{
+  joint_state_callback_ = callback;
+}
+
+void BaseFakeController::publish(const sensor_msgs::msg::JointState& js) const
+{
+  if (joint_state_callback_)
+  {
+    joint_state_callback_(std::make_shared<const sensor_msgs::msg::JointState>(js));
+    // still feed visualization and other observers of the topic
+    if (pub_->get_subscription_count() == 0)
+      return;
+  }
+  pub_->publish(js);
+}
+
 LastPointController::LastPointController(const std::string& name, const std::vector<std::string>& joints,
                                          const rclcpp::Publisher<sensor_msgs::msg::JointState>::SharedPtr& pub)
   : BaseFakeController(name, joints, pub)
@@ -86,7 +104,7 @@ bool LastPointController::sendTrajectory(const moveit_msgs::msg::RobotTrajectory
   js.position = last.positions;
   js.velocity = last.velocities;
   js.effort = last.effort;
-  pub_->publish(js);
+  publish(js);
 
   return true;
 }
@@ -98,14 +116,18 @@ bool LastPointController::cancelExecution()
 
 bool LastPointController::waitForExecution(const rclcpp::Duration& /*timeout*/)
 {
+  // a joint state passed to the callback is already applied
+  if (joint_state_callback_)
+    return true;
   rclcpp::Duration dur = rclcpp::Duration::from_seconds(0.5);  // give some time to receive the published JointState
   rclcpp::sleep_for(std::chrono::nanoseconds(dur.nanoseconds()));
   return true;
 }
 
 ThreadedController::ThreadedController(const std::string& name, const std::vector<std::string>& joints,
-                                       const rclcpp::Publisher<sensor_msgs::msg::JointState>::SharedPtr& pub)
-  : BaseFakeController(name, joints, pub)
+                                       const rclcpp::Publisher<sensor_msgs::msg::JointState>::SharedPtr& pub,
+                                       double time_scaling)
+  : BaseFakeController(name, joints, pub), time_scaling_(time_scaling)
 {
 }
 
@@ -149,9 +171,15 @@ moveit_controller_manager::ExecutionStatus ThreadedController::getLastExecutionS
   return status_;
 }
 
+rclcpp::Duration ThreadedController::getElapsedTime(const rclcpp::Time& start_time) const
+{
+  return rclcpp::Duration::from_seconds((rclcpp::Clock(RCL_ROS_TIME).now() - start_time).seconds() * time_scaling_);
+}
+
 ViaPointController::ViaPointController(const std::string& name, const std::vector<std::string>& joints,
-                                       const rclcpp::Publisher<sensor_msgs::msg::JointState>::SharedPtr& pub)
-  : ThreadedController(name, joints, pub)
+                                       const rclcpp::Publisher<sensor_msgs::msg::JointState>::SharedPtr& pub,
+                                       double time_scaling)
+  : ThreadedController(name, joints, pub, time_scaling)
 {
 }
 
@@ -175,24 +203,25 @@ void ViaPointController::execTrajectory(const moveit_msgs::msg::RobotTrajectory&
     js.velocity = via->velocities;
     js.effort = via->effort;
 
-    rclcpp::Duration wait_time =
-        rclcpp::Duration(via->time_from_start) - (rclcpp::Clock(RCL_ROS_TIME).now() - start_time);
+    // the wait is in real time, the trajectory times are scaled
+    rclcpp::Duration wait_time = rclcpp::Duration::from_seconds(
+        (rclcpp::Duration(via->time_from_start) - getElapsedTime(start_time)).seconds() / time_scaling_);
     if (wait_time.seconds() > std::numeric_limits<float>::epsilon())
     {
-      RCLCPP_DEBUG(LOGGER, "Fake execution: waiting %0.1fs for next via point, %ld remaining", wait_time.seconds(),
+      RCLCPP_DEBUG(LOGGER, "Fake execution: waiting %0.3fs for next via point, %ld remaining", wait_time.seconds(),
                    end - via);
       rclcpp::sleep_for(std::chrono::nanoseconds(wait_time.nanoseconds()));
     }
     js.header.stamp = rclcpp::Clock(RCL_ROS_TIME).now();
-    pub_->publish(js);
+    publish(js);
   }
   RCLCPP_DEBUG(LOGGER, "Fake execution of trajectory: done");
 }
 
 InterpolatingController::InterpolatingController(const std::string& name, const std::vector<std::string>& joints,
                                                  const rclcpp::Publisher<sensor_msgs::msg::JointState>::SharedPtr& pub,
-                                                 double rate)
-  : ThreadedController(name, joints, pub), rate_(rate)
+                                                 double rate, double time_scaling)
+  : ThreadedController(name, joints, pub, time_scaling), rate_(rate * time_scaling)
 {
 }
 
@@ -237,7 +266,7 @@ void InterpolatingController::execTrajectory(const moveit_msgs::msg::RobotTrajec
   rclcpp::Time start_time = rclcpp::Clock(RCL_ROS_TIME).now();
   while (!cancelled())
   {
-    rclcpp::Duration elapsed = rclcpp::Clock(RCL_ROS_TIME).now() - start_time;
+    rclcpp::Duration elapsed = getElapsedTime(start_time);
     // hop to next targetted via point
     while (next != end && elapsed > next->time_from_start)
     {
@@ -258,21 +287,21 @@ void InterpolatingController::execTrajectory(const moveit_msgs::msg::RobotTrajec
                      1.0);
     interpolate(js, *prev, *next, elapsed);
     js.header.stamp = rclcpp::Clock(RCL_ROS_TIME).now();
-    pub_->publish(js);
+    publish(js);
 
     rate_.sleep();
   }
   if (cancelled())
     return;
 
-  rclcpp::Duration elapsed = rclcpp::Clock(RCL_ROS_TIME).now() - start_time;
+  rclcpp::Duration elapsed = getElapsedTime(start_time);
   RCLCPP_DEBUG(LOGGER, "elapsed: %.3f via points %td,%td / %td  alpha: 1.0", elapsed.seconds(), prev - points.begin(),
                next - points.begin(), end - points.begin());
 
   // publish last point
   interpolate(js, *prev, *prev, prev->time_from_start);
   js.header.stamp = rclcpp::Clock(RCL_ROS_TIME).now();
-  pub_->publish(js);
+  publish(js);
 
   RCLCPP_DEBUG(LOGGER, "Fake execution of trajectory: done");
 }
@@ -56,9 +56,16 @@ public:
   moveit_controller_manager::ExecutionStatus getLastExecutionStatus() override;
   void getJoints(std::vector<std::string>& joints) const;
 
+  /// Pass joint states to \e callback directly, and publish them only if the topic has subscribers
+  void setJointStateCallback(const moveit_controller_manager::MoveItControllerManager::JointStateCallback& callback);
+
 protected:
+  /// Send a joint state to the joint state callback and/or the publisher
+  void publish(const sensor_msgs::msg::JointState& js) const;
+
   std::vector<std::string> joints_;
   rclcpp::Publisher<sensor_msgs::msg::JointState>::SharedPtr pub_;
+  moveit_controller_manager::MoveItControllerManager::JointStateCallback joint_state_callback_;
 };
 
 class LastPointController : public BaseFakeController
@@ -76,8 +83,9 @@ public:
 class ThreadedController : public BaseFakeController
 {
 public:
+  /// The trajectories are executed \e time_scaling times faster than real time
   ThreadedController(const std::string& name, const std::vector<std::string>& joints,
-                     const rclcpp::Publisher<sensor_msgs::msg::JointState>::SharedPtr& pub);
+                     const rclcpp::Publisher<sensor_msgs::msg::JointState>::SharedPtr& pub, double time_scaling = 1.0);
   ~ThreadedController() override;
 
   bool sendTrajectory(const moveit_msgs::msg::RobotTrajectory& t) override;
@@ -91,6 +99,11 @@ protected:
     return cancel_;
   }
 
+  /// The time elapsed in the trajectory since \e start_time, accounting for the time scaling
+  rclcpp::Duration getElapsedTime(const rclcpp::Time& start_time) const;
+
+  double time_scaling_;
+
 private:
   virtual void execTrajectory(const moveit_msgs::msg::RobotTrajectory& t) = 0;
   virtual void cancelTrajectory();
@@ -105,7 +118,7 @@ class ViaPointController : public ThreadedController
 {
 public:
   ViaPointController(const std::string& name, const std::vector<std::string>& joints,
-                     const rclcpp::Publisher<sensor_msgs::msg::JointState>::SharedPtr& pub);
+                     const rclcpp::Publisher<sensor_msgs::msg::JointState>::SharedPtr& pub, double time_scaling = 1.0);
   ~ViaPointController() override;
 
 protected:
@@ -115,8 +128,10 @@ protected:
 class InterpolatingController : public ThreadedController
 {
 public:
+  /// The joint states are published at \e rate in trajectory time, i.e. \e rate * \e time_scaling in real time
   InterpolatingController(const std::string& name, const std::vector<std::string>& joints,
-                          const rclcpp::Publisher<sensor_msgs::msg::JointState>::SharedPtr& pub, double rate = 10.0);
+                          const rclcpp::Publisher<sensor_msgs::msg::JointState>::SharedPtr& pub, double rate = 10.0,
+                          double time_scaling = 1.0);
   ~InterpolatingController() override;
 
 protected:
@@ -0,0 +1,159 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, PickNik LLC
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik LLC nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#pragma once
+
+#include <ros/ros.h>
+#include <moveit/controller_manager/controller_manager.h>
+#include <moveit/macros/class_forward.h>
+#include <std_msgs/Float64MultiArray.h>
+
+#include <boost/thread.hpp>
+
+#include <string>
+#include <vector>
+
+namespace moveit_ros_control_interface
+{
+MOVEIT_CLASS_FORWARD(JointGroupCommandControllerHandle)  // Defines JointGroupCommandControllerHandlePtr, ConstPtr...
+
+/**
+ * \brief MoveItControllerHandle for controllers that take a stream of setpoints on their command topic,
+ * like position_controllers/JointGroupPositionController or velocity_controllers/JointGroupVelocityController.
+ *
+ * Trajectories are interpolated and streamed from a thread at a fixed rate. Alternatively, single setpoints can be
+ * sent with sendCommand(), e.g. by servoing or reactive re-planning, with no goal handshake in between.
+ * The command message is allocated once, so streaming does not allocate per cycle on our side.
+ */
+class JointGroupCommandControllerHandle : public moveit_controller_manager::MoveItControllerHandle
+{
+public:
+  enum CommandType
+  {
+    POSITION,
+    VELOCITY
+  };
+
+  /**
+   * \brief Create a handle publishing on \e name /command
+   * @param name fully qualified name of the controller
+   * @param joints the joints of the controller, in the order of the command array
+   * @param type whether positions or velocities are commanded
+   * @param rate rate in Hz at which trajectories are streamed
+   */
+  JointGroupCommandControllerHandle(const std::string& name, const std::vector<std::string>& joints, CommandType type,
+                                    double rate);
+  ~JointGroupCommandControllerHandle() override;
+
+  bool sendTrajectory(const moveit_msgs::RobotTrajectory& trajectory) override;
+  bool cancelExecution() override;
+  bool waitForExecution(const ros::Duration& timeout = ros::Duration(0)) override;
+  moveit_controller_manager::ExecutionStatus getLastExecutionStatus() override;
+
+  /** \brief The joints of the controller, in the order of the command array */
+  const std::vector<std::string>& getJoints() const
+  {
+    return joints_;
+  }
+
+  CommandType getCommandType() const
+  {
+    return type_;
+  }
+
+  /**
+   * \brief Publish a single setpoint, ordered like getJoints(), immediately. A streamed trajectory is preempted.
+   * @return false if the number of values does not match the number of joints
+   */
+  bool sendCommand(const std::vector<double>& values);
+
+  /** \brief Like sendCommand(const std::vector<double>&), for getJoints().size() values */
+  void sendCommand(const double* values);
+
+private:
+  /** \brief Stop the streaming thread, setting the status if a trajectory was running */
+  void stopStreaming(moveit_controller_manager::ExecutionStatus status);
+
+  /** \brief Body of the streaming thread */
+  void stream();
+
+  /** \brief Fill command_ with the trajectory interpolated at \e time, return false past its end */
+  bool interpolate(double time);
+
+  const std::vector<std::string> joints_;
+  const CommandType type_;
+  const double rate_;
+  ros::Publisher pub_;
+
+  boost::mutex mutex_;
+  boost::condition_variable done_condition_;
+  boost::thread thread_;
+  bool cancel_;
+  bool done_;
+  moveit_controller_manager::ExecutionStatus last_exec_;
+
+  /* the streamed trajectory, ordered like joints_ */
+  ros::Time start_time_;
+  std::vector<double> times_;
+  std::vector<std::vector<double>> values_;
+  std::size_t segment_;
+
+  std_msgs::Float64MultiArray command_;
+};
+
+/**
+ * \brief Send one setpoint to several JointGroupCommandControllerHandle instances at once, e.g. the controllers of
+ * all joints of a group. The joint names are resolved to command array indices once in the constructor.
+ */
+class JointGroupCommandStreamer
+{
+public:
+  /**
+   * @param handles the controllers to command
+   * @param joints the joint order of the setpoints passed to send()
+   * @throw std::runtime_error if a joint of a controller is not in \e joints. Extra joints are ignored.
+   */
+  JointGroupCommandStreamer(const std::vector<JointGroupCommandControllerHandlePtr>& handles,
+                            const std::vector<std::string>& joints);
+
+  /** \brief Publish the setpoint \e values, ordered like the joints passed to the constructor, to all controllers */
+  void send(const std::vector<double>& values);
+
+private:
+  std::vector<JointGroupCommandControllerHandlePtr> handles_;
+  std::vector<std::vector<std::size_t>> indices_;  // for each handle, the index of each of its joints in values
+  std::vector<double> buffer_;
+};
+
+}  // namespace moveit_ros_control_interface
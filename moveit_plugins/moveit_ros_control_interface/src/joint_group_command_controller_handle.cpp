@@ -0,0 +1,278 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, PickNik LLC
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik LLC nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include <moveit_ros_control_interface/JointGroupCommandControllerHandle.h>
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace moveit_ros_control_interface
+{
+JointGroupCommandControllerHandle::JointGroupCommandControllerHandle(const std::string& name,
+                                                                     const std::vector<std::string>& joints,
+                                                                     CommandType type, double rate)
+  : moveit_controller_manager::MoveItControllerHandle(name)
+  , joints_(joints)
+  , type_(type)
+  , rate_(rate)
+  , cancel_(false)
+  , done_(true)
+  , last_exec_(moveit_controller_manager::ExecutionStatus::SUCCEEDED)
+  , segment_(0)
+{
+  pub_ = ros::NodeHandle().advertise<std_msgs::Float64MultiArray>(ros::names::append(name, "command"), 1);
+  command_.data.resize(joints_.size(), 0.0);
+}
+
+JointGroupCommandControllerHandle::~JointGroupCommandControllerHandle()
+{
+  stopStreaming(moveit_controller_manager::ExecutionStatus::PREEMPTED);
+}
+
+bool JointGroupCommandControllerHandle::sendTrajectory(const moveit_msgs::RobotTrajectory& trajectory)
+{
+  const trajectory_msgs::JointTrajectory& jt = trajectory.joint_trajectory;
+  if (!trajectory.multi_dof_joint_trajectory.points.empty())
+  {
+    ROS_ERROR_STREAM("Controller " << name_ << " cannot execute multi-dof trajectories");
+    return false;
+  }
+
+  // map the trajectory joints to the command array
+  std::vector<std::size_t> indices(joints_.size());
+  for (std::size_t i = 0; i < joints_.size(); ++i)
+  {
+    std::vector<std::string>::const_iterator it = std::find(jt.joint_names.begin(), jt.joint_names.end(), joints_[i]);
+    if (it == jt.joint_names.end())
+    {
+      ROS_ERROR_STREAM("Trajectory for controller " << name_ << " is missing joint " << joints_[i]);
+      return false;
+    }
+    indices[i] = it - jt.joint_names.begin();
+  }
+
+  stopStreaming(moveit_controller_manager::ExecutionStatus::PREEMPTED);
+
+  times_.clear();
+  values_.clear();
+  times_.reserve(jt.points.size());
+  values_.reserve(jt.points.size());
+  for (const trajectory_msgs::JointTrajectoryPoint& point : jt.points)
+  {
+    const std::vector<double>& source = type_ == POSITION ? point.positions : point.velocities;
+    if (source.size() != jt.joint_names.size())
+    {
+      ROS_ERROR_STREAM("Trajectory for controller " << name_ << " has a point without "
+                                                    << (type_ == POSITION ? "positions" : "velocities"));
+      return false;
+    }
+    times_.push_back(point.time_from_start.toSec());
+    values_.emplace_back(joints_.size());
+    for (std::size_t i = 0; i < joints_.size(); ++i)
+      values_.back()[i] = source[indices[i]];
+  }
+  if (times_.empty())
+    return true;
+
+  // the trajectory starts at its stamp, or now if it is unset
+  start_time_ = jt.header.stamp.isZero() ? ros::Time::now() : jt.header.stamp;
+  segment_ = 0;
+
+  boost::mutex::scoped_lock lock(mutex_);
+  cancel_ = false;
+  done_ = false;
+  last_exec_ = moveit_controller_manager::ExecutionStatus::RUNNING;
+  thread_ = boost::thread(&JointGroupCommandControllerHandle::stream, this);
+  return true;
+}
+
+bool JointGroupCommandControllerHandle::cancelExecution()
+{
+  stopStreaming(moveit_controller_manager::ExecutionStatus::PREEMPTED);
+  return true;
+}
+
+bool JointGroupCommandControllerHandle::waitForExecution(const ros::Duration& timeout)
+{
+  boost::mutex::scoped_lock lock(mutex_);
+  if (timeout.isZero())
+  {
+    while (!done_)
+      done_condition_.wait(lock);
+    return true;
+  }
+  boost::system_time deadline = boost::get_system_time() + boost::posix_time::microseconds(timeout.toNSec() / 1000);
+  while (!done_)
+  {
+    if (!done_condition_.timed_wait(lock, deadline))
+      return done_;
+  }
+  return true;
+}
+
+moveit_controller_manager::ExecutionStatus JointGroupCommandControllerHandle::getLastExecutionStatus()
+{
+  boost::mutex::scoped_lock lock(mutex_);
+  return last_exec_;
+}
+
+bool JointGroupCommandControllerHandle::sendCommand(const std::vector<double>& values)
+{
+  if (values.size() != joints_.size())
+  {
+    ROS_ERROR_STREAM("Controller " << name_ << " expects " << joints_.size() << " command values, got "
+                                   << values.size());
+    return false;
+  }
+  sendCommand(values.data());
+  return true;
+}
+
+void JointGroupCommandControllerHandle::sendCommand(const double* values)
+{
+  if (thread_.joinable())
+    stopStreaming(moveit_controller_manager::ExecutionStatus::PREEMPTED);
+  std::copy(values, values + joints_.size(), command_.data.begin());
+  pub_.publish(command_);
+}
+
+void JointGroupCommandControllerHandle::stopStreaming(moveit_controller_manager::ExecutionStatus status)
+{
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+    cancel_ = true;
+  }
+  if (thread_.joinable())
+    thread_.join();
+
+  boost::mutex::scoped_lock lock(mutex_);
+  if (!done_)
+  {
+    if (type_ == VELOCITY)
+    {  // do not leave the joints moving
+      std::fill(command_.data.begin(), command_.data.end(), 0.0);
+      pub_.publish(command_);
+    }
+    last_exec_ = status;
+    done_ = true;
+    done_condition_.notify_all();
+  }
+}
+
+void JointGroupCommandControllerHandle::stream()
+{
+  ros::Rate rate(rate_);
+  bool running = true;
+  while (running)
+  {
+    {
+      boost::mutex::scoped_lock lock(mutex_);
+      if (cancel_ || !ros::ok())
+        return;
+    }
+
+    double time = (ros::Time::now() - start_time_).toSec();
+    if (time >= 0.0)
+    {
+      running = interpolate(time);
+      pub_.publish(command_);
+    }
+    if (running)
+      rate.sleep();
+  }
+
+  if (type_ == VELOCITY)
+  {  // come to a stop at the end of the trajectory
+    std::fill(command_.data.begin(), command_.data.end(), 0.0);
+    pub_.publish(command_);
+  }
+
+  boost::mutex::scoped_lock lock(mutex_);
+  last_exec_ = moveit_controller_manager::ExecutionStatus::SUCCEEDED;
+  done_ = true;
+  done_condition_.notify_all();
+}
+
+bool JointGroupCommandControllerHandle::interpolate(double time)
+{
+  // time only moves forward, so the segment is searched from the last one
+  while (segment_ + 1 < times_.size() && times_[segment_ + 1] <= time)
+    ++segment_;
+
+  const std::vector<double>& prev = values_[segment_];
+  if (segment_ + 1 == times_.size() || time <= times_[segment_])
+  {
+    std::copy(prev.begin(), prev.end(), command_.data.begin());
+    return segment_ + 1 < times_.size();
+  }
+
+  const std::vector<double>& next = values_[segment_ + 1];
+  double alpha = (time - times_[segment_]) / (times_[segment_ + 1] - times_[segment_]);
+  for (std::size_t i = 0; i < prev.size(); ++i)
+    command_.data[i] = prev[i] + alpha * (next[i] - prev[i]);
+  return true;
+}
+
+JointGroupCommandStreamer::JointGroupCommandStreamer(const std::vector<JointGroupCommandControllerHandlePtr>& handles,
+                                                     const std::vector<std::string>& joints)
+  : handles_(handles), indices_(handles.size())
+{
+  std::size_t max_size = 0;
+  for (std::size_t h = 0; h < handles_.size(); ++h)
+  {
+    const std::vector<std::string>& handle_joints = handles_[h]->getJoints();
+    for (const std::string& joint : handle_joints)
+    {
+      std::vector<std::string>::const_iterator it = std::find(joints.begin(), joints.end(), joint);
+      if (it == joints.end())
+        throw std::runtime_error("Joint " + joint + " of controller " + handles_[h]->getName() + " is not streamed");
+      indices_[h].push_back(it - joints.begin());
+    }
+    max_size = std::max(max_size, handle_joints.size());
+  }
+  buffer_.resize(max_size);
+}
+
+void JointGroupCommandStreamer::send(const std::vector<double>& values)
+{
+  for (std::size_t h = 0; h < handles_.size(); ++h)
+  {
+    const std::vector<std::size_t>& indices = indices_[h];
+    for (std::size_t i = 0; i < indices.size(); ++i)
+      buffer_[i] = values[indices[i]];
+    handles_[h]->sendCommand(buffer_.data());
+  }
+}
+
+}  // namespace moveit_ros_control_interface
@@ -0,0 +1,76 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, PickNik LLC
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik LLC nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include <ros/ros.h>
+#include <moveit_ros_control_interface/ControllerHandle.h>
+#include <moveit_ros_control_interface/JointGroupCommandControllerHandle.h>
+#include <pluginlib/class_list_macros.hpp>
+#include <memory>
+
+namespace moveit_ros_control_interface
+{
+/**
+ * \brief Allocator for JointGroupCommandControllerHandle instances.
+ * The streaming rate is read from the ~command_stream_rate parameter (in Hz, default 100).
+ */
+template <JointGroupCommandControllerHandle::CommandType TYPE>
+class JointGroupCommandControllerAllocator : public ControllerHandleAllocator
+{
+public:
+  moveit_controller_manager::MoveItControllerHandlePtr alloc(const std::string& name,
+                                                             const std::vector<std::string>& resources) override
+  {
+    // the claimed resources are sorted, the command array follows the joints parameter of the controller
+    std::vector<std::string> joints;
+    if (!ros::NodeHandle(name).getParam("joints", joints))
+    {
+      ROS_WARN_STREAM("Could not read the joints of controller " << name << ", assuming the order of its resources");
+      joints = resources;
+    }
+    double rate = ros::NodeHandle("~").param("command_stream_rate", 100.0);
+    return std::make_shared<JointGroupCommandControllerHandle>(name, joints, TYPE, rate);
+  }
+};
+
+using JointGroupPositionControllerAllocator =
+    JointGroupCommandControllerAllocator<JointGroupCommandControllerHandle::POSITION>;
+using JointGroupVelocityControllerAllocator =
+    JointGroupCommandControllerAllocator<JointGroupCommandControllerHandle::VELOCITY>;
+
+}  // namespace moveit_ros_control_interface
+
+PLUGINLIB_EXPORT_CLASS(moveit_ros_control_interface::JointGroupPositionControllerAllocator,
+                       moveit_ros_control_interface::ControllerHandleAllocator);
+PLUGINLIB_EXPORT_CLASS(moveit_ros_control_interface::JointGroupVelocityControllerAllocator,
+                       moveit_ros_control_interface::ControllerHandleAllocator);
@@ -141,6 +141,8 @@ public:
 
   bool waitForExecution(const rclcpp::Duration& timeout = rclcpp::Duration(0)) override
   {
+    if (!controller_action_client_ || !current_goal_)
+      return true;
     auto result_future = controller_action_client_->async_get_result(current_goal_);
     if (timeout.seconds() == 0.0)
     {
@@ -148,7 +150,8 @@ public:
     }
     else
     {
-      std::future_status status = result_future.wait_for(timeout.to_chrono<std::chrono::seconds>());
+      // nanoseconds, sub-second timeouts would be truncated to zero in seconds
+      std::future_status status = result_future.wait_for(timeout.to_chrono<std::chrono::nanoseconds>());
       if (status == std::future_status::timeout)
         RCLCPP_WARN(LOGGER, "waitForExecution timed out");
     }
@@ -57,9 +57,11 @@ public:
     : ActionBasedControllerHandle<control_msgs::action::FollowJointTrajectory>(
           node, name, action_ns, "moveit.simple_controller_manager.follow_joint_trajectory_controller_handle")
   {
+    initializeGoalOptions();
   }
 
   bool sendTrajectory(const moveit_msgs::msg::RobotTrajectory& trajectory) override;
+  bool appendTrajectory(const moveit_msgs::msg::RobotTrajectory& trajectory) override;
 
   // TODO(JafarAbdi): Revise parameter lookup
   // void configure(XmlRpc::XmlRpcValue& config) override;
@@ -71,7 +73,18 @@ protected:
   void controllerDoneCallback(
       const rclcpp_action::ClientGoalHandle<control_msgs::action::FollowJointTrajectory>::WrappedResult& wrapped_result);
 
+  /* set up the goal callbacks once, instead of for every goal */
+  void initializeGoalOptions();
+
+  bool sendGoal(const control_msgs::action::FollowJointTrajectory::Goal& goal);
+
   control_msgs::action::FollowJointTrajectory::Goal goal_template_;
+  rclcpp_action::Client<control_msgs::action::FollowJointTrajectory>::SendGoalOptions send_goal_options_;
+
+  /* the goal last sent by sendTrajectory(), extended by appendTrajectory() */
+  control_msgs::action::FollowJointTrajectory::Goal streamed_goal_;
+  /* the time the streamed goal started executing, used to stamp its continuations */
+  rclcpp::Time stream_start_;
 };
 
 }  // end namespace moveit_simple_controller_manager
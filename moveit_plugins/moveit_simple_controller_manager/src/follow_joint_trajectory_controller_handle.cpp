@@ -58,12 +58,50 @@ bool FollowJointTrajectoryControllerHandle::sendTrajectory(const moveit_msgs::ms
   else
     RCLCPP_INFO_STREAM(LOGGER, "sending continuation for the currently executed trajectory to " << name_);
 
-  control_msgs::action::FollowJointTrajectory::Goal goal = goal_template_;
-  goal.trajectory = trajectory.joint_trajectory;
+  // Build the goal in place, so the trajectory is copied once. A running goal is not cancelled: the controller
+  // replaces it when accepting the new one, which saves a round trip for reactive re-planning.
+  streamed_goal_ = goal_template_;  // the template has no trajectory, this only copies the tolerances
+  streamed_goal_.trajectory = trajectory.joint_trajectory;
+  stream_start_ = streamed_goal_.trajectory.header.stamp;
+  if (stream_start_.nanoseconds() == 0)
+    stream_start_ = node_->now();
 
-  rclcpp_action::Client<control_msgs::action::FollowJointTrajectory>::SendGoalOptions send_goal_options;
+  return sendGoal(streamed_goal_);
+}
+
+bool FollowJointTrajectoryControllerHandle::appendTrajectory(const moveit_msgs::msg::RobotTrajectory& trajectory)
+{
+  if (!controller_action_client_)
+    return false;
+
+  if (done_)
+  {
+    RCLCPP_ERROR_STREAM(LOGGER, name_ << " is not executing a trajectory that could be extended");
+    return false;
+  }
+
+  if (trajectory.joint_trajectory.joint_names != streamed_goal_.trajectory.joint_names)
+  {
+    RCLCPP_ERROR_STREAM(LOGGER, "Cannot append a trajectory with different joints to the one executed by " << name_);
+    return false;
+  }
+
+  RCLCPP_DEBUG_STREAM(LOGGER, "appending " << trajectory.joint_trajectory.points.size() << " points to " << name_);
+
+  // The controller replaces its active goal with the new one and starts sampling it at the current time. Stamping the
+  // whole buffered trajectory with its original start time therefore skips the already executed prefix, so the motion
+  // continues seamlessly into the appended points.
+  streamed_goal_.trajectory.points.insert(streamed_goal_.trajectory.points.end(),
+                                          trajectory.joint_trajectory.points.begin(),
+                                          trajectory.joint_trajectory.points.end());
+  streamed_goal_.trajectory.header.stamp = stream_start_;
+  return sendGoal(streamed_goal_);
+}
+
+void FollowJointTrajectoryControllerHandle::initializeGoalOptions()
+{
   // Active callback
-  send_goal_options.goal_response_callback = [this](const auto& future) {
+  send_goal_options_.goal_response_callback = [this](const auto& future) {
     RCLCPP_INFO_STREAM(LOGGER, name_ << " started execution");
     const auto& goal_handle = future.get();
     if (!goal_handle)
@@ -72,14 +110,17 @@ bool FollowJointTrajectoryControllerHandle::sendTrajectory(const moveit_msgs::ms
       RCLCPP_INFO(LOGGER, "Goal request accepted!");
   };
   // Result callback
-  send_goal_options.result_callback =
+  send_goal_options_.result_callback =
       std::bind(&FollowJointTrajectoryControllerHandle::controllerDoneCallback, this, _1);
+}
 
+bool FollowJointTrajectoryControllerHandle::sendGoal(const control_msgs::action::FollowJointTrajectory::Goal& goal)
+{
   done_ = false;
   last_exec_ = moveit_controller_manager::ExecutionStatus::RUNNING;
 
   // Send goal
-  auto current_goal_future = controller_action_client_->async_send_goal(goal, send_goal_options);
+  auto current_goal_future = controller_action_client_->async_send_goal(goal, send_goal_options_);
   current_goal_ = current_goal_future.get();
   if (!current_goal_)
   {
@@ -218,6 +259,10 @@ FollowJointTrajectoryControllerHandle::getTolerance(std::vector<control_msgs::ms
 void FollowJointTrajectoryControllerHandle::controllerDoneCallback(
     const rclcpp_action::ClientGoalHandle<control_msgs::action::FollowJointTrajectory>::WrappedResult& wrapped_result)
 {
+  // A goal that was replaced by a continuation reports as preempted; this does not end the current execution
+  if (current_goal_ && wrapped_result.goal_id != current_goal_->get_goal_id())
+    return;
+
   // Output custom error message for FollowJointTrajectoryResult if necessary
   if (!wrapped_result.result)
     RCLCPP_WARN_STREAM(LOGGER, "Controller " << name_ << " done, no result returned");
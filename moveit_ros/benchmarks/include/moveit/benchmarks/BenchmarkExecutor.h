@@ -147,6 +147,8 @@ protected:
                                       std::vector<TrajectoryConstraints>& traj_constraints,
                                       std::vector<BenchmarkRequest>& queries);
 
+  /// Collect the metrics of a run. This is called concurrently for the runs of a query if the benchmark uses several
+  /// threads.
   virtual void collectMetrics(PlannerRunData& metrics, const planning_interface::MotionPlanDetailedResponse& mp_res,
                               bool solved, double total_time);
 
@@ -199,6 +201,17 @@ protected:
   void runBenchmark(moveit_msgs::msg::MotionPlanRequest request,
                     const std::map<std::string, std::vector<std::string>>& planners, int runs);
 
+  /// Execute the runs of the given motion plan request on the set of planners on the configured number of threads.
+  /// Each thread plans in its own diff of the planning scene, and the event functions are called one at a time.
+  void runBenchmarkInParallel(const moveit_msgs::msg::MotionPlanRequest& request,
+                              const std::map<std::string, std::vector<std::string>>& planners, int runs);
+
+  /// Solve the request once, with the planning context if given or with the planning pipeline otherwise
+  bool solve(const planning_pipeline::PlanningPipelinePtr& planning_pipeline,
+             const planning_interface::PlanningContextPtr& planning_context,
+             const planning_scene::PlanningSceneConstPtr& scene, const moveit_msgs::msg::MotionPlanRequest& request,
+             planning_interface::MotionPlanDetailedResponse& response);
+
   planning_scene_monitor::PlanningSceneMonitor* psm_;
   moveit_warehouse::PlanningSceneStorage* pss_;
   moveit_warehouse::PlanningSceneWorldStorage* psws_;
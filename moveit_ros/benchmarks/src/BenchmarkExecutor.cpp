@@ -55,6 +55,10 @@
 #include <winsock2.h>
 #endif
 
+#include <atomic>
+#include <mutex>
+#include <thread>
+
 using namespace moveit_ros_benchmarks;
 
 static const rclcpp::Logger LOGGER = rclcpp::get_logger("moveit.ros.benchmarks.BenchmarkExecutor");
@@ -775,6 +779,12 @@ bool BenchmarkExecutor::loadTrajectoryConstraints(const std::string& regex,
 void BenchmarkExecutor::runBenchmark(moveit_msgs::msg::MotionPlanRequest request,
                                      const std::map<std::string, std::vector<std::string>>& pipeline_map, int runs)
 {
+  if (options_.getNumThreads() > 1)
+  {
+    runBenchmarkInParallel(request, pipeline_map, runs);
+    return;
+  }
+
   benchmark_data_.clear();
 
   unsigned int num_planners = 0;
@@ -805,8 +815,13 @@ void BenchmarkExecutor::runBenchmark(moveit_msgs::msg::MotionPlanRequest request
         planner_start_fn(request, planner_data);
 
       planning_interface::PlanningContextPtr planning_context;
+      double context_setup_time = 0.0;
       if (use_planning_context)
+      {
+        std::chrono::system_clock::time_point start = std::chrono::system_clock::now();
         planning_context = planning_pipeline->getPlannerManager()->getPlanningContext(planning_scene_, request);
+        context_setup_time = std::chrono::duration<double>(std::chrono::system_clock::now() - start).count();
+      }
 
       // Iterate runs
       for (int j = 0; j < runs; ++j)
@@ -817,23 +832,7 @@ void BenchmarkExecutor::runBenchmark(moveit_msgs::msg::MotionPlanRequest request
 
         // Solve problem
         std::chrono::system_clock::time_point start = std::chrono::system_clock::now();
-        if (use_planning_context)
-        {
-          solved[j] = planning_context->solve(responses[j]);
-        }
-        else
-        {
-          // The planning pipeline does not support MotionPlanDetailedResponse
-          planning_interface::MotionPlanResponse response;
-          solved[j] = planning_pipeline->generatePlan(planning_scene_, request, response);
-          responses[j].error_code_ = response.error_code_;
-          if (response.trajectory_)
-          {
-            responses[j].description_.push_back("plan");
-            responses[j].trajectory_.push_back(response.trajectory_);
-            responses[j].processing_time_.push_back(response.planning_time_);
-          }
-        }
+        solved[j] = solve(planning_pipeline, planning_context, planning_scene_, request, responses[j]);
         std::chrono::duration<double> dt = std::chrono::system_clock::now() - start;
         double total_time = dt.count();
 
@@ -844,6 +843,8 @@ void BenchmarkExecutor::runBenchmark(moveit_msgs::msg::MotionPlanRequest request
         for (PostRunEventFunction& post_event_fn : post_event_fns_)
           post_event_fn(request, responses[j], planner_data[j]);
         collectMetrics(planner_data[j], responses[j], solved[j], total_time);
+        if (use_planning_context)  // all runs share the context
+          planner_data[j]["context_setup_time REAL"] = moveit::core::toString(context_setup_time);
         dt = std::chrono::system_clock::now() - start;
         double metrics_time = dt.count();
         RCLCPP_DEBUG(LOGGER, "Spent %lf seconds collecting metrics", metrics_time);
@@ -862,6 +863,131 @@ void BenchmarkExecutor::runBenchmark(moveit_msgs::msg::MotionPlanRequest request
   }
 }
 
+void BenchmarkExecutor::runBenchmarkInParallel(const moveit_msgs::msg::MotionPlanRequest& request,
+                                               const std::map<std::string, std::vector<std::string>>& pipeline_map,
+                                               int runs)
+{
+  benchmark_data_.clear();
+
+  // The runs of all planners, which are benchmarked in the same order as in runBenchmark()
+  struct PlannerRuns
+  {
+    planning_pipeline::PlanningPipelinePtr planning_pipeline;
+    moveit_msgs::msg::MotionPlanRequest request;
+    PlannerBenchmarkData planner_data;
+    std::vector<planning_interface::MotionPlanDetailedResponse> responses;
+    std::vector<char> solved;  // not std::vector<bool>, whose elements cannot be written concurrently
+  };
+  std::vector<PlannerRuns> planners;
+  for (const std::pair<const std::string, std::vector<std::string>>& pipeline_entry : pipeline_map)
+  {
+    for (const std::string& planner_id : pipeline_entry.second)
+    {
+      PlannerRuns& planner = planners.emplace_back();
+      planner.planning_pipeline = planning_pipelines_[pipeline_entry.first];
+      planner.request = request;
+      planner.request.planner_id = planner_id;
+      planner.planner_data.resize(runs);
+      planner.responses.resize(runs);
+      planner.solved.resize(runs);
+
+      // Planner start events
+      for (PlannerStartEventFunction& planner_start_fn : planner_start_fns_)
+        planner_start_fn(planner.request, planner.planner_data);
+    }
+  }
+
+  const std::size_t run_count = planners.size() * runs;
+  boost::progress_display progress(run_count, std::cout);
+  std::atomic<std::size_t> next_run(0);
+  std::mutex events_mutex;  // the event functions and the progress display are not thread-safe
+
+  auto benchmark_runs = [&]() {
+    // Plan in a diff of the benchmark scene, so that planners don't share scene data between threads
+    planning_scene::PlanningScenePtr scene = planning_scene_->diff();
+    for (std::size_t i = next_run++; i < run_count; i = next_run++)
+    {
+      PlannerRuns& planner = planners[i / runs];
+      const std::size_t j = i % runs;
+      moveit_msgs::msg::MotionPlanRequest run_request = planner.request;
+
+      // Pre-run events
+      {
+        std::scoped_lock lock(events_mutex);
+        for (PreRunEventFunction& pre_event_fn : pre_event_fns_)
+          pre_event_fn(run_request);
+      }
+
+      // Use the planning context if the pipeline only contains the planner plugin
+      planning_interface::PlanningContextPtr planning_context;
+      std::chrono::system_clock::time_point start = std::chrono::system_clock::now();
+      if (planner.planning_pipeline->getAdapterPluginNames().empty())
+        planning_context = planner.planning_pipeline->getPlannerManager()->getPlanningContext(scene, run_request);
+      double context_setup_time = std::chrono::duration<double>(std::chrono::system_clock::now() - start).count();
+
+      // Solve problem
+      start = std::chrono::system_clock::now();
+      planner.solved[j] = solve(planner.planning_pipeline, planning_context, scene, run_request, planner.responses[j]);
+      std::chrono::duration<double> dt = std::chrono::system_clock::now() - start;
+      double total_time = dt.count();
+
+      // Post-run events
+      {
+        std::scoped_lock lock(events_mutex);
+        for (PostRunEventFunction& post_event_fn : post_event_fns_)
+          post_event_fn(run_request, planner.responses[j], planner.planner_data[j]);
+      }
+      collectMetrics(planner.planner_data[j], planner.responses[j], planner.solved[j], total_time);
+      if (planning_context)
+        planner.planner_data[j]["context_setup_time REAL"] = moveit::core::toString(context_setup_time);
+
+      std::scoped_lock lock(events_mutex);
+      ++progress;
+    }
+  };
+
+  std::vector<std::thread> threads;
+  for (std::size_t i = 1; i < std::min<std::size_t>(options_.getNumThreads(), run_count); ++i)
+    threads.emplace_back(benchmark_runs);
+  benchmark_runs();
+  for (std::thread& thread : threads)
+    thread.join();
+
+  for (PlannerRuns& planner : planners)
+  {
+    computeAveragePathSimilarities(planner.planner_data, planner.responses,
+                                   std::vector<bool>(planner.solved.begin(), planner.solved.end()));
+
+    // Planner completion events
+    for (PlannerCompletionEventFunction& planner_completion_fn : planner_completion_fns_)
+      planner_completion_fn(planner.request, planner.planner_data);
+
+    benchmark_data_.push_back(planner.planner_data);
+  }
+}
+
+bool BenchmarkExecutor::solve(const planning_pipeline::PlanningPipelinePtr& planning_pipeline,
+                              const planning_interface::PlanningContextPtr& planning_context,
+                              const planning_scene::PlanningSceneConstPtr& scene,
+                              const moveit_msgs::msg::MotionPlanRequest& request,
+                              planning_interface::MotionPlanDetailedResponse& response)
+{
+  if (planning_context)
+    return planning_context->solve(response);
+
+  // The planning pipeline does not support MotionPlanDetailedResponse
+  planning_interface::MotionPlanResponse plan_response;
+  bool solved = planning_pipeline->generatePlan(scene, request, plan_response);
+  response.error_code_ = plan_response.error_code_;
+  if (plan_response.trajectory_)
+  {
+    response.description_.push_back("plan");
+    response.trajectory_.push_back(plan_response.trajectory_);
+    response.processing_time_.push_back(plan_response.planning_time_);
+  }
+  return solved;
+}
+
 void BenchmarkExecutor::collectMetrics(PlannerRunData& metrics,
                                        const planning_interface::MotionPlanDetailedResponse& mp_res, bool solved,
                                        double total_time)
@@ -869,6 +995,10 @@ void BenchmarkExecutor::collectMetrics(PlannerRunData& metrics,
   metrics["time REAL"] = moveit::core::toString(total_time);
   metrics["solved BOOLEAN"] = boost::lexical_cast<std::string>(solved);
 
+  // Where the planner spent its time, if it reports it
+  for (const std::pair<const std::string, double>& statistic : mp_res.statistics_)
+    metrics[statistic.first + " REAL"] = moveit::core::toString(statistic.second);
+
   if (solved)
   {
     // Analyzing the trajectory(ies) geometrically
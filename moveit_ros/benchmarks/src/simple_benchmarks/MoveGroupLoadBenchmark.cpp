@@ -0,0 +1,370 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, PickNik LLC
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik LLC nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Description: A load test that drives a running move_group with concurrent plan, Cartesian path, IK and state
+   validity requests while publishing planning scene updates, and reports throughput and latency percentiles */
+
+// MoveIt
+#include <moveit/kinematic_constraints/utils.h>
+#include <moveit/robot_model_loader/robot_model_loader.h>
+#include <moveit/robot_state/conversions.h>
+#include <moveit_msgs/msg/planning_scene.hpp>
+#include <moveit_msgs/srv/get_cartesian_path.hpp>
+#include <moveit_msgs/srv/get_motion_plan.hpp>
+#include <moveit_msgs/srv/get_position_ik.hpp>
+#include <moveit_msgs/srv/get_state_validity.hpp>
+#include <random_numbers/random_numbers.h>
+#include <rclcpp/rclcpp.hpp>
+#include <tf2_eigen/tf2_eigen.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <thread>
+#include <vector>
+
+static const rclcpp::Logger LOGGER = rclcpp::get_logger("moveit.ros.benchmarks.move_group_load_benchmark");
+
+namespace moveit_ros_benchmarks
+{
+namespace
+{
+enum Capability
+{
+  PLAN,
+  CARTESIAN_PATH,
+  IK,
+  STATE_VALIDITY,
+  CAPABILITY_COUNT
+};
+const std::array<std::string, CAPABILITY_COUNT> CAPABILITY_NAMES = { "plan", "cartesian_path", "ik",
+                                                                      "state_validity" };
+
+struct Sample
+{
+  double latency;  // seconds from sending the request to receiving the response
+  bool success;
+};
+
+using Samples = std::array<std::vector<Sample>, CAPABILITY_COUNT>;
+
+// nearest-rank percentile of sorted latencies
+double percentile(const std::vector<double>& sorted, double fraction)
+{
+  if (sorted.empty())
+    return 0.0;
+  const std::size_t rank = static_cast<std::size_t>(std::ceil(fraction * sorted.size()));
+  return sorted[std::max<std::size_t>(rank, 1) - 1];
+}
+}  // namespace
+
+class MoveGroupLoadBenchmark
+{
+public:
+  MoveGroupLoadBenchmark(const rclcpp::Node::SharedPtr& node) : node_(node)
+  {
+    node_->get_parameter_or("clients", clients_, 4);
+    node_->get_parameter_or("duration", duration_, 30.0);
+    node_->get_parameter_or("group", group_name_, std::string("panda_arm"));
+    node_->get_parameter_or("tip_link", tip_link_, std::string(""));
+    node_->get_parameter_or("planning_time", planning_time_, 1.0);
+    node_->get_parameter_or("scene_update_rate", scene_update_rate_, 10.0);
+    node_->get_parameter_or("output_file", output_file_, std::string(""));
+    std::vector<std::string> capabilities;
+    node_->get_parameter_or("capabilities", capabilities,
+                            std::vector<std::string>(CAPABILITY_NAMES.begin(), CAPABILITY_NAMES.end()));
+    for (std::size_t i = 0; i < CAPABILITY_COUNT; ++i)
+      enabled_[i] = std::find(capabilities.begin(), capabilities.end(), CAPABILITY_NAMES[i]) != capabilities.end();
+  }
+
+  bool initialize()
+  {
+    robot_model_loader::RobotModelLoader loader(node_, "robot_description");
+    robot_model_ = loader.getModel();
+    if (!robot_model_)
+    {
+      RCLCPP_ERROR(LOGGER, "Failed to load robot model");
+      return false;
+    }
+    group_ = robot_model_->getJointModelGroup(group_name_);
+    if (!group_)
+    {
+      RCLCPP_ERROR_STREAM(LOGGER, "Robot model has no joint model group named '" << group_name_ << "'");
+      return false;
+    }
+    if (tip_link_.empty())
+      tip_link_ = group_->getLinkModelNames().back();
+    if (clients_ < 1 || std::none_of(enabled_.begin(), enabled_.end(), [](bool enabled) { return enabled; }))
+    {
+      RCLCPP_ERROR(LOGGER, "At least one client and one of the capabilities plan, cartesian_path, ik and "
+                           "state_validity are needed");
+      return false;
+    }
+    return true;
+  }
+
+  void run()
+  {
+    std::atomic<bool> stop(false);
+    std::vector<Samples> client_samples(clients_);
+    std::vector<std::thread> threads;
+    for (int i = 0; i < clients_; ++i)
+      threads.emplace_back([this, i, &stop, &client_samples] { runClient(i, stop, client_samples[i]); });
+    std::size_t scene_updates = 0;
+    if (scene_update_rate_ > 0.0)
+      threads.emplace_back([this, &stop, &scene_updates] { scene_updates = runSceneUpdates(stop); });
+
+    RCLCPP_INFO(LOGGER, "Loading move_group with %d clients for %.1fs", clients_, duration_);
+    std::this_thread::sleep_for(std::chrono::duration<double>(duration_));
+    stop = true;
+    for (std::thread& thread : threads)
+      thread.join();
+
+    // the clients query move_group until the end of the duration, so their samples cover the same time span
+    Samples samples;
+    for (const Samples& client : client_samples)
+      for (std::size_t c = 0; c < CAPABILITY_COUNT; ++c)
+        samples[c].insert(samples[c].end(), client[c].begin(), client[c].end());
+    report(samples, scene_updates);
+  }
+
+private:
+  template <typename ServiceT>
+  bool call(const rclcpp::Node::SharedPtr& node, const typename rclcpp::Client<ServiceT>::SharedPtr& client,
+            const typename ServiceT::Request::SharedPtr& request, typename ServiceT::Response::SharedPtr& response,
+            std::vector<Sample>& samples) const
+  {
+    const auto start = std::chrono::steady_clock::now();
+    auto future = client->async_send_request(request);
+    if (rclcpp::spin_until_future_complete(node, future) != rclcpp::FutureReturnCode::SUCCESS)
+    {
+      samples.push_back({ std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count(), false });
+      return false;
+    }
+    response = future.get();
+    samples.push_back({ std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count(), true });
+    return true;
+  }
+
+  // Every client has its own node and executor, so the requests only contend inside move_group
+  void runClient(int index, const std::atomic<bool>& stop, Samples& samples) const
+  {
+    auto node = rclcpp::Node::make_shared("move_group_load_client_" + std::to_string(index));
+    auto plan_client = node->create_client<moveit_msgs::srv::GetMotionPlan>("plan_kinematic_path");
+    auto cartesian_client = node->create_client<moveit_msgs::srv::GetCartesianPath>("compute_cartesian_path");
+    auto ik_client = node->create_client<moveit_msgs::srv::GetPositionIK>("compute_ik");
+    auto validity_client = node->create_client<moveit_msgs::srv::GetStateValidity>("check_state_validity");
+    const std::vector<rclcpp::ClientBase*> clients = { plan_client.get(), cartesian_client.get(), ik_client.get(),
+                                                       validity_client.get() };
+    for (rclcpp::ClientBase* client : clients)
+      if (!client->wait_for_service(std::chrono::seconds(10)))
+        RCLCPP_WARN(LOGGER, "Service %s is not available", client->get_service_name());
+
+    random_numbers::RandomNumberGenerator rng(index);
+    moveit::core::RobotState state(robot_model_);
+    state.setToDefaultValues();
+    moveit::core::RobotState goal(state);
+
+    // cycle through the enabled capabilities, so all of them are under load at the same time
+    for (std::size_t c = index % CAPABILITY_COUNT; !stop; c = (c + 1) % CAPABILITY_COUNT)
+    {
+      if (!enabled_[c])
+        continue;
+      state.setToRandomPositions(group_, rng);
+      state.update();
+      switch (c)
+      {
+        case PLAN:
+        {
+          auto request = std::make_shared<moveit_msgs::srv::GetMotionPlan::Request>();
+          moveit_msgs::msg::MotionPlanRequest& plan_request = request->motion_plan_request;
+          plan_request.group_name = group_name_;
+          plan_request.num_planning_attempts = 1;
+          plan_request.allowed_planning_time = planning_time_;
+          plan_request.max_velocity_scaling_factor = 1.0;
+          plan_request.max_acceleration_scaling_factor = 1.0;
+          moveit::core::robotStateToRobotStateMsg(state, plan_request.start_state);
+          goal.setToRandomPositions(group_, rng);
+          plan_request.goal_constraints.push_back(kinematic_constraints::constructGoalConstraints(goal, group_));
+          moveit_msgs::srv::GetMotionPlan::Response::SharedPtr response;
+          if (call<moveit_msgs::srv::GetMotionPlan>(node, plan_client, request, response, samples[c]))
+            samples[c].back().success =
+                response->motion_plan_response.error_code.val == moveit_msgs::msg::MoveItErrorCodes::SUCCESS;
+          break;
+        }
+        case CARTESIAN_PATH:
+        {
+          auto request = std::make_shared<moveit_msgs::srv::GetCartesianPath::Request>();
+          request->header.frame_id = robot_model_->getModelFrame();
+          request->group_name = group_name_;
+          request->link_name = tip_link_;
+          request->max_step = 0.01;
+          request->avoid_collisions = true;
+          moveit::core::robotStateToRobotStateMsg(state, request->start_state);
+          Eigen::Isometry3d target = state.getGlobalLinkTransform(tip_link_);
+          target.translation().z() -= 0.05;
+          request->waypoints.push_back(tf2::toMsg(target));
+          moveit_msgs::srv::GetCartesianPath::Response::SharedPtr response;
+          if (call<moveit_msgs::srv::GetCartesianPath>(node, cartesian_client, request, response, samples[c]))
+            samples[c].back().success = response->error_code.val == moveit_msgs::msg::MoveItErrorCodes::SUCCESS;
+          break;
+        }
+        case IK:
+        {
+          auto request = std::make_shared<moveit_msgs::srv::GetPositionIK::Request>();
+          request->ik_request.group_name = group_name_;
+          request->ik_request.ik_link_name = tip_link_;
+          request->ik_request.avoid_collisions = true;
+          request->ik_request.timeout.nanosec = 100000000;
+          request->ik_request.pose_stamped.header.frame_id = robot_model_->getModelFrame();
+          request->ik_request.pose_stamped.pose = tf2::toMsg(state.getGlobalLinkTransform(tip_link_));
+          moveit_msgs::srv::GetPositionIK::Response::SharedPtr response;
+          if (call<moveit_msgs::srv::GetPositionIK>(node, ik_client, request, response, samples[c]))
+            samples[c].back().success = response->error_code.val == moveit_msgs::msg::MoveItErrorCodes::SUCCESS;
+          break;
+        }
+        case STATE_VALIDITY:
+        {
+          auto request = std::make_shared<moveit_msgs::srv::GetStateValidity::Request>();
+          request->group_name = group_name_;
+          moveit::core::robotStateToRobotStateMsg(state, request->robot_state);
+          moveit_msgs::srv::GetStateValidity::Response::SharedPtr response;
+          call<moveit_msgs::srv::GetStateValidity>(node, validity_client, request, response, samples[c]);
+          break;
+        }
+      }
+    }
+  }
+
+  // Move a box around the robot, so every update changes the world geometry that the requests are checked against
+  std::size_t runSceneUpdates(const std::atomic<bool>& stop) const
+  {
+    auto node = rclcpp::Node::make_shared("move_group_load_scene_updates");
+    auto publisher = node->create_publisher<moveit_msgs::msg::PlanningScene>("planning_scene", 10);
+    moveit_msgs::msg::PlanningScene scene;
+    scene.is_diff = true;
+    scene.world.collision_objects.resize(1);
+    moveit_msgs::msg::CollisionObject& box = scene.world.collision_objects[0];
+    box.id = "move_group_load_box";
+    box.header.frame_id = robot_model_->getModelFrame();
+    box.operation = moveit_msgs::msg::CollisionObject::ADD;
+    box.primitives.resize(1);
+    box.primitives[0].type = shape_msgs::msg::SolidPrimitive::BOX;
+    box.primitives[0].dimensions = { 0.1, 0.1, 0.1 };
+    box.primitive_poses.resize(1);
+    box.primitive_poses[0].orientation.w = 1.0;
+    box.primitive_poses[0].position.z = 0.5;
+
+    rclcpp::WallRate rate(scene_update_rate_);
+    std::size_t updates = 0;
+    for (; !stop; ++updates)
+    {
+      const double angle = 0.1 * updates;
+      box.primitive_poses[0].position.x = 0.6 * std::cos(angle);
+      box.primitive_poses[0].position.y = 0.6 * std::sin(angle);
+      publisher->publish(scene);
+      rate.sleep();
+    }
+    return updates;
+  }
+
+  void report(const Samples& samples, std::size_t scene_updates) const
+  {
+    std::ofstream out;
+    if (!output_file_.empty())
+    {
+      out.open(output_file_);
+      out << "capability,requests,failures,throughput,p50,p99,p999,max\n";
+    }
+
+    for (std::size_t c = 0; c < CAPABILITY_COUNT; ++c)
+    {
+      if (!enabled_[c])
+        continue;
+      std::vector<double> latencies;
+      std::size_t failures = 0;
+      for (const Sample& sample : samples[c])
+      {
+        latencies.push_back(sample.latency);
+        failures += sample.success ? 0 : 1;
+      }
+      std::sort(latencies.begin(), latencies.end());
+      const double throughput = latencies.size() / duration_;
+      const double p50 = percentile(latencies, 0.5), p99 = percentile(latencies, 0.99),
+                   p999 = percentile(latencies, 0.999), max = latencies.empty() ? 0.0 : latencies.back();
+
+      RCLCPP_INFO(LOGGER, "%-15s %7zu requests %6zu failed %8.2f req/s   p50 %8.2fms  p99 %8.2fms  p999 %8.2fms",
+                  CAPABILITY_NAMES[c].c_str(), latencies.size(), failures, throughput, 1e3 * p50, 1e3 * p99,
+                  1e3 * p999);
+      if (out.is_open())
+        out << CAPABILITY_NAMES[c] << ',' << latencies.size() << ',' << failures << ',' << throughput << ',' << p50
+            << ',' << p99 << ',' << p999 << ',' << max << '\n';
+    }
+    if (scene_update_rate_ > 0.0)
+      RCLCPP_INFO(LOGGER, "Published %zu scene updates (%.1f/s)", scene_updates, scene_updates / duration_);
+  }
+
+  rclcpp::Node::SharedPtr node_;
+  moveit::core::RobotModelConstPtr robot_model_;
+  const moveit::core::JointModelGroup* group_ = nullptr;
+  int clients_;
+  double duration_;
+  std::string group_name_;
+  std::string tip_link_;
+  double planning_time_;
+  double scene_update_rate_;
+  std::string output_file_;
+  std::array<bool, CAPABILITY_COUNT> enabled_;
+};
+}  // namespace moveit_ros_benchmarks
+
+int main(int argc, char** argv)
+{
+  rclcpp::init(argc, argv);
+  rclcpp::NodeOptions node_options;
+  node_options.allow_undeclared_parameters(true);
+  node_options.automatically_declare_parameters_from_overrides(true);
+  rclcpp::Node::SharedPtr node = rclcpp::Node::make_shared("move_group_load_benchmark", node_options);
+
+  moveit_ros_benchmarks::MoveGroupLoadBenchmark benchmark(node);
+  if (!benchmark.initialize())
+    return 1;
+  benchmark.run();
+
+  rclcpp::shutdown();
+  return 0;
+}
@@ -0,0 +1,76 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, PickNik LLC
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik LLC nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#pragma once
+
+#include <moveit/pick_place/manipulation_plan.h>
+#include <moveit/planning_scene/planning_scene.h>
+#include <vector>
+
+namespace pick_place
+{
+/** \brief Cheap checks of the goal poses of manipulation plans, used to order the plans before they are pushed to the
+    ManipulationPipeline so that its expensive stages see the most promising plans first.
+
+    A goal pose is promising if it is within the reach of the kinematic chain of the planning group and if the end
+    effector does not collide at it. Plans failing these checks are not dropped, but evaluated last. */
+class GoalPosePreFilter
+{
+public:
+  GoalPosePreFilter(const planning_scene::PlanningSceneConstPtr& scene,
+                    const collision_detection::AllowedCollisionMatrixConstPtr& collision_matrix,
+                    const ManipulationPlanSharedDataConstPtr& shared_data);
+
+  /** \brief Check whether the goal pose of \e plan is within reach and leaves the end effector collision free */
+  bool isPromising(const ManipulationPlan& plan) const;
+
+  /** \brief Move the promising plans to the front of \e plans, keeping the order among promising and among other
+      plans */
+  void sort(std::vector<ManipulationPlanPtr>& plans) const;
+
+private:
+  /** \brief Compute the link at the base of the chain to the IK link and the length of the chain */
+  void computeReach();
+
+  planning_scene::PlanningSceneConstPtr planning_scene_;
+  collision_detection::AllowedCollisionMatrixConstPtr collision_matrix_;
+  ManipulationPlanSharedDataConstPtr shared_data_;
+
+  /** \brief The link the goal poses are reached from, null for the model frame */
+  const moveit::core::LinkModel* base_link_;
+
+  /** \brief Upper bound of the distance of the IK link from the base link, infinite if not bounded */
+  double reach_;
+};
+}  // namespace pick_place
@@ -44,7 +44,11 @@
 
 namespace pick_place
 {
-/** \brief Represent the sequence of steps that are executed for a manipulation plan */
+/** \brief Represent the sequence of steps that are executed for a manipulation plan
+
+    Each stage has its own queue of plans waiting to be evaluated by it, and the processing threads evaluate any
+    plan at any stage. Plans that are further along the pipeline are taken first, so that the threads spread over
+    the stages and the first solution is found early, instead of each thread running all stages for one plan. */
 class ManipulationPipeline
 {
 public:
@@ -100,7 +104,8 @@ protected:
   bool verbose_;
   std::vector<ManipulationStagePtr> stages_;
 
-  std::deque<ManipulationPlanPtr> queue_;
+  /** \brief For each stage, the plans waiting to be evaluated by it */
+  std::vector<std::deque<ManipulationPlanPtr> > queues_;
   std::vector<ManipulationPlanPtr> success_;
   std::vector<ManipulationPlanPtr> failed_;
 
@@ -0,0 +1,121 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, PickNik LLC
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik LLC nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include <moveit/pick_place/goal_pose_pre_filter.h>
+#include <tf2_eigen/tf2_eigen.h>
+#include <ros/console.h>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace pick_place
+{
+GoalPosePreFilter::GoalPosePreFilter(const planning_scene::PlanningSceneConstPtr& scene,
+                                     const collision_detection::AllowedCollisionMatrixConstPtr& collision_matrix,
+                                     const ManipulationPlanSharedDataConstPtr& shared_data)
+  : planning_scene_(scene)
+  , collision_matrix_(collision_matrix)
+  , shared_data_(shared_data)
+  , base_link_(nullptr)
+  , reach_(std::numeric_limits<double>::infinity())
+{
+  computeReach();
+}
+
+void GoalPosePreFilter::computeReach()
+{
+  const moveit::core::JointModel* root = shared_data_->planning_group_->getCommonRoot();
+  double reach = 0.0;
+  for (const moveit::core::LinkModel* link = shared_data_->ik_link_; link; link = link->getParentLinkModel())
+  {
+    const moveit::core::JointModel* joint = link->getParentJointModel();
+    // mobile bases do not bound the reach
+    if (joint->getType() == moveit::core::JointModel::PLANAR || joint->getType() == moveit::core::JointModel::FLOATING)
+      return;
+
+    reach += link->getJointOriginTransform().translation().norm();
+    if (joint->getType() == moveit::core::JointModel::PRISMATIC)
+    {
+      const moveit::core::VariableBounds& bounds = joint->getVariableBounds()[0];
+      if (!bounds.position_bounded_)
+        return;
+      reach += std::max(std::abs(bounds.min_position_), std::abs(bounds.max_position_));
+    }
+
+    if (joint == root)
+    {
+      base_link_ = link->getParentLinkModel();
+      reach_ = reach;
+      ROS_DEBUG_NAMED("manipulation", "Goal poses of group '%s' are within %lf m of link '%s'",
+                      shared_data_->planning_group_->getName().c_str(), reach_,
+                      base_link_ ? base_link_->getName().c_str() : "<model frame>");
+      return;
+    }
+  }
+  // the IK link is not below the root of the group, so the reach remains unbounded
+}
+
+bool GoalPosePreFilter::isPromising(const ManipulationPlan& plan) const
+{
+  moveit::core::RobotState state(planning_scene_->getCurrentState());
+  Eigen::Isometry3d goal_pose;
+  tf2::fromMsg(plan.goal_pose_.pose, goal_pose);
+  goal_pose = planning_scene_->getFrameTransform(state, plan.goal_pose_.header.frame_id) * goal_pose;
+
+  if (std::isfinite(reach_))
+  {
+    const Eigen::Vector3d base =
+        base_link_ ? state.getGlobalLinkTransform(base_link_).translation() : Eigen::Vector3d::Zero();
+    if ((goal_pose.translation() - base).norm() > reach_)
+      return false;
+  }
+
+  // the same check as the first stage of the pipeline, without sampling any IK solution
+  state.updateStateWithLinkAt(plan.shared_data_->ik_link_, goal_pose);
+  collision_detection::CollisionRequest req;
+  collision_detection::CollisionResult res;
+  req.group_name = plan.shared_data_->end_effector_group_->getName();
+  planning_scene_->checkCollision(req, res, state, *collision_matrix_);
+  return !res.collision;
+}
+
+void GoalPosePreFilter::sort(std::vector<ManipulationPlanPtr>& plans) const
+{
+  std::vector<ManipulationPlanPtr>::iterator end =
+      std::stable_partition(plans.begin(), plans.end(), [this](const ManipulationPlanPtr& plan) {
+        return isPromising(*plan);
+      });
+  ROS_DEBUG_NAMED("manipulation", "%d of %d goal poses are promising", (int)(end - plans.begin()), (int)plans.size());
+}
+}  // namespace pick_place
@@ -54,6 +54,8 @@ ManipulationPipeline& ManipulationPipeline::addStage(const ManipulationStagePtr&
 {
   next->setVerbose(verbose_);
   stages_.push_back(next);
+  boost::mutex::scoped_lock slock(queue_access_lock_);
+  queues_.resize(stages_.size());
   return *this;
 }
 
@@ -83,6 +85,7 @@ void ManipulationPipeline::reset()
 {
   clear();
   stages_.clear();
+  queues_.clear();
 }
 
 void ManipulationPipeline::setVerbose(bool flag)
@@ -97,7 +100,8 @@ void ManipulationPipeline::clear()
   stop();
   {
     boost::mutex::scoped_lock slock(queue_access_lock_);
-    queue_.clear();
+    for (std::deque<ManipulationPlanPtr>& queue : queues_)
+      queue.clear();
   }
   {
     boost::mutex::scoped_lock slock(result_lock_);
@@ -121,6 +125,8 @@ void ManipulationPipeline::signalStop()
 {
   for (pick_place::ManipulationStagePtr& stage : stages_)
     stage->signalStop();
+  // set the flag under the lock, so that no thread misses the notification between checking it and waiting
+  boost::mutex::scoped_lock slock(queue_access_lock_);
   stop_processing_ = true;
   queue_access_cond_.notify_all();
 }
@@ -141,66 +147,81 @@ void ManipulationPipeline::processingThread(unsigned int index)
 {
   ROS_DEBUG_STREAM_NAMED("manipulation", "Start thread " << index << " for '" << name_ << "'");
 
+  bool empty_queue = false;  // whether this thread is counted in empty_queue_threads_
+  boost::unique_lock<boost::mutex> ulock(queue_access_lock_);
   while (!stop_processing_)
   {
-    bool inc_queue = false;
-    boost::unique_lock<boost::mutex> ulock(queue_access_lock_);
-    // if the queue is empty, we trigger the corresponding event
-    if (queue_.empty() && !stop_processing_ && empty_queue_callback_)
+    // take the plan that is furthest along the pipeline
+    ManipulationPlanPtr g;
+    std::size_t stage = queues_.size();
+    while (stage > 0 && !g)
+      if (!queues_[--stage].empty())
+      {
+        g = queues_[stage].front();
+        queues_[stage].pop_front();
+      }
+
+    // if all queues are empty, we trigger the corresponding event
+    if (!g)
     {
-      empty_queue_threads_++;
-      inc_queue = true;
-      if (empty_queue_threads_ == processing_threads_.size())
-        empty_queue_callback_();
-    }
-    while (queue_.empty() && !stop_processing_)
+      if (!empty_queue && empty_queue_callback_)
+      {
+        empty_queue_threads_++;
+        empty_queue = true;
+        if (empty_queue_threads_ == processing_threads_.size())
+          empty_queue_callback_();
+      }
       queue_access_cond_.wait(ulock);
-    while (!stop_processing_ && !queue_.empty())
+      continue;
+    }
+    if (empty_queue)
     {
-      ManipulationPlanPtr g = queue_.front();
-      queue_.pop_front();
-      if (inc_queue)
+      empty_queue_threads_--;
+      empty_queue = false;
+    }
+
+    ulock.unlock();
+    bool next_stage = false;
+    try
+    {
+      if (stage == 0)
+        g->error_code_.val = moveit_msgs::msg::MoveItErrorCodes::FAILURE;
+      bool res = stages_[stage]->evaluate(g);
+      g->processing_stage_ = stage + 1;
+      if (!res)
       {
-        empty_queue_threads_--;
-        inc_queue = false;
+        boost::mutex::scoped_lock slock(result_lock_);
+        failed_.push_back(g);
+        ROS_INFO_STREAM_NAMED("manipulation", "Manipulation plan " << g->id_ << " failed at stage '"
+                                                                   << stages_[stage]->getName() << "' on thread "
+                                                                   << index);
       }
-
-      queue_access_lock_.unlock();
-      try
+      else if (stage + 1 < stages_.size())
+        next_stage = true;
+      else if (g->error_code_.val == moveit_msgs::msg::MoveItErrorCodes::SUCCESS)
       {
-        g->error_code_.val = moveit_msgs::msg::MoveItErrorCodes::FAILURE;
-        for (std::size_t i = 0; !stop_processing_ && i < stages_.size(); ++i)
-        {
-          bool res = stages_[i]->evaluate(g);
-          g->processing_stage_ = i + 1;
-          if (!res)
-          {
-            boost::mutex::scoped_lock slock(result_lock_);
-            failed_.push_back(g);
-            ROS_INFO_STREAM_NAMED("manipulation", "Manipulation plan " << g->id_ << " failed at stage '"
-                                                                       << stages_[i]->getName() << "' on thread "
-                                                                       << index);
-            break;
-          }
-        }
-        if (g->error_code_.val == moveit_msgs::msg::MoveItErrorCodes::SUCCESS)
+        g->processing_stage_++;
         {
-          g->processing_stage_++;
-          {
-            boost::mutex::scoped_lock slock(result_lock_);
-            success_.push_back(g);
-          }
-          signalStop();
-          ROS_INFO_STREAM_NAMED("manipulation", "Found successful manipulation plan!");
-          if (solution_callback_)
-            solution_callback_();
+          boost::mutex::scoped_lock slock(result_lock_);
+          success_.push_back(g);
         }
+        signalStop();
+        ROS_INFO_STREAM_NAMED("manipulation", "Found successful manipulation plan!");
+        if (solution_callback_)
+          solution_callback_();
       }
-      catch (std::exception& ex)
-      {
-        ROS_ERROR_NAMED("manipulation", "[%s:%u] %s", name_.c_str(), index, ex.what());
-      }
-      queue_access_lock_.lock();
+    }
+    catch (std::exception& ex)
+    {
+      ROS_ERROR_NAMED("manipulation", "[%s:%u] %s", name_.c_str(), index, ex.what());
+    }
+    ulock.lock();
+
+    // pass the plan on to the next stage, for any thread to continue
+    if (next_stage)
+    {
+      queues_[stage + 1].push_back(g);
+      queue_access_cond_.notify_one();
     }
   }
 }
@@ -208,23 +229,28 @@ void ManipulationPipeline::processingThread(unsigned int index)
 void ManipulationPipeline::push(const ManipulationPlanPtr& plan)
 {
   boost::mutex::scoped_lock slock(queue_access_lock_);
-  queue_.push_back(plan);
+  if (queues_.empty())
+  {
+    ROS_ERROR_STREAM_NAMED("manipulation", "Cannot add plan to pipeline '" << name_ << "' without stages");
+    return;
+  }
+  queues_.front().push_back(plan);
   ROS_INFO_STREAM_NAMED("manipulation",
-                        "Added plan for pipeline '" << name_ << "'. Queue is now of size " << queue_.size());
+                        "Added plan for pipeline '" << name_ << "'. Queue is now of size " << queues_.front().size());
   queue_access_cond_.notify_all();
 }
 
 void ManipulationPipeline::reprocessLastFailure()
 {
   boost::mutex::scoped_lock slock(queue_access_lock_);
-  if (failed_.empty())
+  if (failed_.empty() || queues_.empty())
     return;
   ManipulationPlanPtr plan = failed_.back();
   failed_.pop_back();
   plan->clear();
-  queue_.push_back(plan);
+  queues_.front().push_back(plan);
   ROS_INFO_STREAM_NAMED("manipulation", "Re-added last failed plan for pipeline '"
-                                            << name_ << "'. Queue is now of size " << queue_.size());
+                                            << name_ << "'. Queue is now of size " << queues_.front().size());
   queue_access_cond_.notify_all();
 }
 }  // namespace pick_place
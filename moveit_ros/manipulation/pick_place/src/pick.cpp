@@ -36,6 +36,7 @@
 
 #include <moveit/pick_place/pick_place.h>
 #include <moveit/pick_place/reachable_valid_pose_filter.h>
+#include <moveit/pick_place/goal_pose_pre_filter.h>
 #include <moveit/pick_place/approach_and_translate_stage.h>
 #include <moveit/pick_place/plan_stage.h>
 #include <moveit/utils/message_checks.h>
@@ -177,6 +178,7 @@ bool PickPlan::plan(const planning_scene::PlanningSceneConstPtr& planning_scene,
   std::sort(grasp_order.begin(), grasp_order.end(), oq);
 
   // feed the available grasps to the stages we set up
+  std::vector<ManipulationPlanPtr> plans;
   for (std::size_t i = 0; i < goal.possible_grasps.size(); ++i)
   {
     ManipulationPlanPtr p(new ManipulationPlan(const_plan_data));
@@ -190,9 +192,14 @@ bool PickPlan::plan(const planning_scene::PlanningSceneConstPtr& planning_scene,
       p->goal_pose_.header.frame_id = goal.target_name;
     p->approach_posture_ = g.pre_grasp_posture;
     p->retreat_posture_ = g.grasp_posture;
-    pipeline_.push(p);
+    plans.push_back(p);
   }
 
+  // evaluate the grasps that pass the cheap checks first
+  GoalPosePreFilter(planning_scene, approach_grasp_acm, const_plan_data).sort(plans);
+  for (const ManipulationPlanPtr& p : plans)
+    pipeline_.push(p);
+
   // wait till we're done
   waitForPipeline(endtime);
   pipeline_.stop();
@@ -36,6 +36,7 @@
 
 #include <moveit/pick_place/pick_place.h>
 #include <moveit/pick_place/reachable_valid_pose_filter.h>
+#include <moveit/pick_place/goal_pose_pre_filter.h>
 #include <moveit/pick_place/approach_and_translate_stage.h>
 #include <moveit/pick_place/plan_stage.h>
 #include <moveit/robot_state/conversions.h>
@@ -306,6 +307,7 @@ bool PlacePlan::plan(const planning_scene::PlanningSceneConstPtr& planning_scene
   pipeline_.start();
 
   // add possible place locations
+  std::vector<ManipulationPlanPtr> plans;
   for (std::size_t i = 0; i < goal.place_locations.size(); ++i)
   {
     ManipulationPlanPtr p(new ManipulationPlan(const_plan_data));
@@ -329,8 +331,13 @@ bool PlacePlan::plan(const planning_scene::PlanningSceneConstPtr& planning_scene
     p->id_ = i;
     if (p->retreat_posture_.joint_names.empty())
       p->retreat_posture_ = attached_body->getDetachPosture();
-    pipeline_.push(p);
+    plans.push_back(p);
   }
+
+  // evaluate the place locations that pass the cheap checks first
+  GoalPosePreFilter(planning_scene, approach_place_acm, const_plan_data).sort(plans);
+  for (const ManipulationPlanPtr& p : plans)
+    pipeline_.push(p);
   ROS_INFO_NAMED("manipulation", "Added %d place locations", (int)goal.place_locations.size());
 
   // wait till we're done
@@ -62,4 +62,8 @@ static const std::string APPLY_PLANNING_SCENE_SERVICE_NAME =
     "apply_planning_scene";  // name of the service that applies a given planning scene
 static const std::string CLEAR_OCTOMAP_SERVICE_NAME =
     "clear_octomap";  // name of the service that can be used to clear the octomap
+static const std::string DISPATCH_PLANNER_SERVICE_NAME =
+    "dispatch_kinematic_path";  // name of the service that passes planning requests on to worker move_groups
+static const std::string SCENE_VERSION_TOPIC =
+    "scene_version";  // name of the topic the version of the planning scene of a move_group is published on
 }  // namespace move_group
@@ -67,6 +67,13 @@ public:
 
   void setContext(const MoveGroupContextPtr& context);
 
+  /** \brief Set the callback group to serve the services and actions of this capability in.
+   *
+   * move_group gives each capability a group of its own, so a long request of one capability does not delay the
+   * requests of the others. Capabilities that need a particular concurrency, like the reentrant state validation
+   * service, may create groups of their own instead. Must be called before initialize(). */
+  void setCallbackGroup(const rclcpp::CallbackGroup::SharedPtr& callback_group);
+
   virtual void initialize() = 0;
 
   const std::string& getName() const
@@ -94,7 +101,15 @@ protected:
   moveit_msgs::msg::PlanningScene clearSceneRobotState(const moveit_msgs::msg::PlanningScene& scene) const;
   bool performTransform(geometry_msgs::msg::PoseStamped& pose_msg, const std::string& target_frame) const;
 
+  /** \brief Compute a version of the collision objects and attached bodies of \e scene.
+   *
+   * Scenes that applied the same updates have the same version, also in different processes, so move_group instances
+   * can tell whether they plan in the same scene. The octomap is not covered. */
+  std::uint64_t computeSceneVersion(const planning_scene::PlanningScene& scene) const;
+
   std::string capability_name_;
   MoveGroupContextPtr context_;
+  // The callback group to serve requests in. If null, the default callback group of the node is used
+  rclcpp::CallbackGroup::SharedPtr callback_group_;
 };
 }  // namespace move_group
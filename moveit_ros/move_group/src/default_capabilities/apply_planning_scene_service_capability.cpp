@@ -53,7 +53,8 @@ void ApplyPlanningSceneService::initialize()
   using std::placeholders::_3;
 
   service_ = context_->node_->create_service<moveit_msgs::srv::ApplyPlanningScene>(
-      APPLY_PLANNING_SCENE_SERVICE_NAME, std::bind(&ApplyPlanningSceneService::applyScene, this, _1, _2, _3));
+      APPLY_PLANNING_SCENE_SERVICE_NAME, std::bind(&ApplyPlanningSceneService::applyScene, this, _1, _2, _3),
+      rmw_qos_profile_services_default, callback_group_);
 }
 
 bool ApplyPlanningSceneService::applyScene(const std::shared_ptr<rmw_request_id_t> request_header,
@@ -45,6 +45,7 @@
 #include <moveit/robot_state/cartesian_interpolator.h>
 #include <moveit_msgs/msg/display_trajectory.hpp>
 #include <moveit/trajectory_processing/iterative_time_parameterization.h>
+#include <algorithm>
 
 namespace
 {
@@ -75,11 +76,19 @@ void MoveGroupCartesianPathService::initialize()
   using std::placeholders::_2;
   using std::placeholders::_3;
 
+  context_->node_->get_parameter_or("cartesian_path_precision.translational", precision_.translational, 0.0);
+  context_->node_->get_parameter_or("cartesian_path_precision.rotational", precision_.rotational, 0.0);
+  context_->node_->get_parameter_or("cartesian_path_precision.max_resolution", precision_.max_resolution, 1e-4);
+  if (precision_.translational > 0.0 || precision_.rotational > 0.0)
+    RCLCPP_INFO(LOGGER, "Cartesian paths are refined to a precision of %g m and %g rad", precision_.translational,
+                precision_.rotational);
+
   display_path_ = context_->node_->create_publisher<moveit_msgs::msg::DisplayTrajectory>(
       planning_pipeline::PlanningPipeline::DISPLAY_PATH_TOPIC, 10);
 
   cartesian_path_service_ = context_->node_->create_service<moveit_msgs::srv::GetCartesianPath>(
-      CARTESIAN_PATH_SERVICE_NAME, std::bind(&MoveGroupCartesianPathService::computeService, this, _1, _2, _3));
+      CARTESIAN_PATH_SERVICE_NAME, std::bind(&MoveGroupCartesianPathService::computeService, this, _1, _2, _3),
+      rmw_qos_profile_services_default, callback_group_);
 }
 
 bool MoveGroupCartesianPathService::computeService(const std::shared_ptr<rmw_request_id_t> request_header,
@@ -137,19 +146,16 @@ bool MoveGroupCartesianPathService::computeService(const std::shared_ptr<rmw_req
       {
         if (!waypoints.empty())
         {
+          // path constraints are checked while computing the path, collisions afterwards, in parallel
           moveit::core::GroupStateValidityCallbackFn constraint_fn;
-          std::unique_ptr<planning_scene_monitor::LockedPlanningSceneRO> ls;
           std::unique_ptr<kinematic_constraints::KinematicConstraintSet> kset;
-          if (req->avoid_collisions || !moveit::core::isEmpty(req->path_constraints))
+          if (!moveit::core::isEmpty(req->path_constraints))
           {
-            ls.reset(new planning_scene_monitor::LockedPlanningSceneRO(context_->planning_scene_monitor_));
-            kset.reset(new kinematic_constraints::KinematicConstraintSet((*ls)->getRobotModel()));
-            kset->add(req->path_constraints, (*ls)->getTransforms());
-            constraint_fn = boost::bind(
-                &isStateValid,
-                req->avoid_collisions ? static_cast<const planning_scene::PlanningSceneConstPtr&>(*ls).get() : nullptr,
-                kset->empty() ? nullptr : kset.get(), boost::placeholders::_1, boost::placeholders::_2,
-                boost::placeholders::_3);
+            planning_scene_monitor::LockedPlanningSceneRO ls(context_->planning_scene_monitor_);
+            kset.reset(new kinematic_constraints::KinematicConstraintSet(ls->getRobotModel()));
+            kset->add(req->path_constraints, ls->getTransforms());
+            constraint_fn = boost::bind(&isStateValid, nullptr, kset->empty() ? nullptr : kset.get(),
+                                        boost::placeholders::_1, boost::placeholders::_2, boost::placeholders::_3);
           }
           bool global_frame = !moveit::core::Transforms::sameFrame(link_name, req->header.frame_id);
           RCLCPP_INFO(LOGGER,
@@ -160,13 +166,33 @@ bool MoveGroupCartesianPathService::computeService(const std::shared_ptr<rmw_req
           std::vector<moveit::core::RobotStatePtr> traj;
           res->fraction = moveit::core::CartesianInterpolator::computeCartesianPath(
               &start_state, jmg, traj, start_state.getLinkModel(link_name), waypoints, global_frame,
-              moveit::core::MaxEEFStep(req->max_step), moveit::core::JumpThreshold(req->jump_threshold), constraint_fn);
+              moveit::core::MaxEEFStep(req->max_step), moveit::core::JumpThreshold(req->jump_threshold), precision_,
+              constraint_fn);
           moveit::core::robotStateToRobotStateMsg(start_state, res->start_state);
 
           robot_trajectory::RobotTrajectory rt(context_->planning_scene_monitor_->getRobotModel(), req->group_name);
           for (const moveit::core::RobotStatePtr& traj_state : traj)
             rt.addSuffixWayPoint(traj_state, 0.0);
 
+          if (req->avoid_collisions && traj.size() > 1)
+          {
+            // truncate the path before the first colliding state, the start state is not checked
+            std::vector<std::size_t> invalid_index;
+            planning_scene_monitor::LockedPlanningSceneRO(context_->planning_scene_monitor_)
+                ->isPathValidParallel(rt, moveit_msgs::msg::Constraints(), std::vector<moveit_msgs::msg::Constraints>(),
+                                      0, req->group_name, false, &invalid_index);
+            auto first_invalid = std::upper_bound(invalid_index.begin(), invalid_index.end(), std::size_t(0));
+            if (first_invalid != invalid_index.end())
+            {
+              RCLCPP_DEBUG(LOGGER, "Truncating Cartesian path before colliding waypoint %zu", *first_invalid);
+              res->fraction *= (double)*first_invalid / (double)traj.size();
+              traj.resize(*first_invalid);
+              rt.clear();
+              for (const moveit::core::RobotStatePtr& traj_state : traj)
+                rt.addSuffixWayPoint(traj_state, 0.0);
+            }
+          }
+
           // time trajectory
           // \todo optionally compute timing to move the eef with constant speed
           trajectory_processing::IterativeParabolicTimeParameterization time_param;
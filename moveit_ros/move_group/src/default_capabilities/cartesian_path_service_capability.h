@@ -39,6 +39,7 @@
 #include <moveit/move_group/move_group_capability.h>
 #include <moveit_msgs/srv/get_cartesian_path.hpp>
 #include <moveit_msgs/msg/display_trajectory.hpp>
+#include <moveit/robot_state/cartesian_interpolator.h>
 
 namespace move_group
 {
@@ -58,5 +59,8 @@ private:
   rclcpp::Publisher<moveit_msgs::msg::DisplayTrajectory>::SharedPtr display_path_;
 
   bool display_computed_paths_;
+
+  // the precision of adaptive steps, disabled unless set by parameters
+  moveit::core::CartesianPrecision precision_;
 };
 }  // namespace move_group
@@ -51,7 +51,8 @@ void move_group::ClearOctomapService::initialize()
   using std::placeholders::_3;
 
   service_ = context_->node_->create_service<std_srvs::srv::Empty>(
-      CLEAR_OCTOMAP_SERVICE_NAME, std::bind(&ClearOctomapService::clearOctomap, this, _1, _2));
+      CLEAR_OCTOMAP_SERVICE_NAME, std::bind(&ClearOctomapService::clearOctomap, this, _1, _2),
+      rmw_qos_profile_services_default, callback_group_);
 }
 
 void move_group::ClearOctomapService::clearOctomap(const std::shared_ptr<std_srvs::srv::Empty::Request> /*req*/,
@@ -68,7 +68,8 @@ void MoveGroupExecuteTrajectoryAction::initialize()
         RCLCPP_INFO(LOGGER, "Received request to cancel goal");
         return rclcpp_action::CancelResponse::ACCEPT;
       },
-      std::bind(&MoveGroupExecuteTrajectoryAction::executePathCallback, this, _1));
+      std::bind(&MoveGroupExecuteTrajectoryAction::executePathCallback, this, _1),
+      rcl_action_server_get_default_options(), callback_group_);
 }
 
 void MoveGroupExecuteTrajectoryAction::executePathCallback(std::shared_ptr<ExecTrajectoryGoal> goal)
@@ -45,7 +45,10 @@ MoveGroupGetPlanningSceneService::MoveGroupGetPlanningSceneService() : MoveGroup
 
 void MoveGroupGetPlanningSceneService::initialize()
 {
-  context_->planning_scene_monitor_->providePlanningSceneService(GET_PLANNING_SCENE_SERVICE_NAME);
+  // the binary format is much smaller, but does not keep the occupancy probabilities of the octomap
+  bool binary_octomap;
+  context_->node_->get_parameter_or("get_planning_scene_binary_octomap", binary_octomap, false);
+  context_->planning_scene_monitor_->providePlanningSceneService(GET_PLANNING_SCENE_SERVICE_NAME, binary_octomap);
 }
 
 }  // namespace move_group
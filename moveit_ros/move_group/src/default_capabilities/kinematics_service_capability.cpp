@@ -55,10 +55,17 @@ void MoveGroupKinematicsService::initialize()
   using std::placeholders::_2;
   using std::placeholders::_3;
 
+  // FK requests only read the scene and are served concurrently, so that clients can keep many requests in flight.
+  // IK requests are served one at a time, as kinematics solvers are not required to be thread-safe, but in their
+  // own callback group so that a queue of them does not hold up the other callbacks of the node.
+  fk_callback_group_ = context_->node_->create_callback_group(rclcpp::CallbackGroupType::Reentrant);
+  ik_callback_group_ = context_->node_->create_callback_group(rclcpp::CallbackGroupType::MutuallyExclusive);
   fk_service_ = context_->node_->create_service<moveit_msgs::srv::GetPositionFK>(
-      FK_SERVICE_NAME, std::bind(&MoveGroupKinematicsService::computeFKService, this, _1, _2, _3));
+      FK_SERVICE_NAME, std::bind(&MoveGroupKinematicsService::computeFKService, this, _1, _2, _3),
+      rmw_qos_profile_services_default, fk_callback_group_);
   ik_service_ = context_->node_->create_service<moveit_msgs::srv::GetPositionIK>(
-      IK_SERVICE_NAME, std::bind(&MoveGroupKinematicsService::computeIKService, this, _1, _2, _3));
+      IK_SERVICE_NAME, std::bind(&MoveGroupKinematicsService::computeIKService, this, _1, _2, _3),
+      rmw_qos_profile_services_default, ik_callback_group_);
 }
 
 namespace
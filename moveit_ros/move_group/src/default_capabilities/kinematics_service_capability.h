@@ -64,5 +64,7 @@ private:
 
   rclcpp::Service<moveit_msgs::srv::GetPositionFK>::SharedPtr fk_service_;
   rclcpp::Service<moveit_msgs::srv::GetPositionIK>::SharedPtr ik_service_;
+  rclcpp::CallbackGroup::SharedPtr fk_callback_group_;
+  rclcpp::CallbackGroup::SharedPtr ik_callback_group_;
 };
 }  // namespace move_group
@@ -41,6 +41,7 @@
 #include <moveit/plan_execution/plan_with_sensing.h>
 #include <moveit/trajectory_processing/trajectory_tools.h>
 #include <moveit/kinematic_constraints/utils.h>
+#include <moveit/robot_state/conversions.h>
 #include <moveit/utils/message_checks.h>
 #include <moveit/move_group/capability_names.h>
 
@@ -49,18 +50,52 @@ namespace move_group
 static const rclcpp::Logger LOGGER =
     rclcpp::get_logger("moveit_move_group_default_capabilities.move_action_capability");
 
+// the largest distance between the robot state and the start of a trajectory planned ahead for it to be used
+static const double LOOKAHEAD_START_TOLERANCE = 0.01;
+
 MoveGroupMoveAction::MoveGroupMoveAction()
-  : MoveGroupCapability("MoveAction"), move_state_(IDLE), preempt_requested_{ false }
+  : MoveGroupCapability("MoveAction")
+  , move_state_(IDLE)
+  , preempt_requested_{ false }
+  , lookahead_enabled_{ false }
+  , local_repair_lookahead_{ 0.0 }
+  , shutdown_requested_{ false }
+  , lookahead_scene_changed_{ false }
 {
 }
 
-void MoveGroupMoveAction::initialize()
+MoveGroupMoveAction::~MoveGroupMoveAction()
 {
-  // start the move action server
-  using std::placeholders::_1;
-  using std::placeholders::_2;
+  {
+    std::lock_guard<std::mutex> lock(move_goals_mutex_);
+    shutdown_requested_ = true;
+  }
+  move_goals_condition_.notify_all();
+  if (move_goals_thread_.joinable())
+    move_goals_thread_.join();
+  if (lookahead_thread_.joinable())
+    lookahead_thread_.join();
+}
 
+void MoveGroupMoveAction::initialize()
+{
   auto node = context_->node_;
+  node->get_parameter_or("enable_lookahead_planning", lookahead_enabled_, false);
+  node->get_parameter_or("local_trajectory_repair_lookahead", local_repair_lookahead_, 0.0);
+  if (lookahead_enabled_)
+  {
+    if (context_->allow_trajectory_execution_)
+    {
+      RCLCPP_INFO(LOGGER, "Queued move goals are planned while the previous goal executes");
+      context_->planning_scene_monitor_->addUpdateCallback(
+          boost::bind(&MoveGroupMoveAction::sceneUpdateCallback, this, boost::placeholders::_1));
+      move_goals_thread_ = std::thread(&MoveGroupMoveAction::processMoveGoals, this);
+    }
+    else
+      lookahead_enabled_ = false;
+  }
+
+  // start the move action server
   execute_action_server_ = rclcpp_action::create_server<MGAction>(
       node, MOVE_ACTION,
       [](const rclcpp_action::GoalUUID& /*unused*/, std::shared_ptr<const MGAction::Goal> /*unused*/) {
@@ -71,7 +106,54 @@ void MoveGroupMoveAction::initialize()
         RCLCPP_INFO(LOGGER, "Received request to cancel goal");
         return rclcpp_action::CancelResponse::ACCEPT;
       },
-      std::bind(&MoveGroupMoveAction::executeMoveCallback, this, _1));
+      [this](const std::shared_ptr<MGActionGoal>& goal) {
+        if (!lookahead_enabled_)
+        {
+          executeMoveCallback(goal);
+          return;
+        }
+        {
+          std::lock_guard<std::mutex> lock(move_goals_mutex_);
+          move_goals_.push_back(goal);
+        }
+        move_goals_condition_.notify_all();
+      },
+      rcl_action_server_get_default_options(), callback_group_);
+}
+
+void MoveGroupMoveAction::processMoveGoals()
+{
+  while (true)
+  {
+    std::shared_ptr<MGActionGoal> goal;
+    {
+      std::unique_lock<std::mutex> lock(move_goals_mutex_);
+      move_goals_condition_.wait(lock, [this] { return shutdown_requested_ || !move_goals_.empty(); });
+      if (shutdown_requested_)
+        break;
+      goal = move_goals_.front();
+      move_goals_.pop_front();
+    }
+
+    if (goal->is_canceling())
+    {
+      auto action_res = std::make_shared<MGAction::Result>();
+      action_res->error_code.val = moveit_msgs::msg::MoveItErrorCodes::PREEMPTED;
+      goal->canceled(action_res);
+      continue;
+    }
+    executeMoveCallback(goal);
+  }
+
+  // abort the goals that were not processed
+  std::lock_guard<std::mutex> lock(move_goals_mutex_);
+  for (const std::shared_ptr<MGActionGoal>& goal : move_goals_)
+  {
+    auto action_res = std::make_shared<MGAction::Result>();
+    action_res->error_code.val = moveit_msgs::msg::MoveItErrorCodes::FAILURE;
+    goal->abort(action_res);
+  }
+  move_goals_.clear();
 }
 
 void MoveGroupMoveAction::executeMoveCallback(std::shared_ptr<MGActionGoal> goal)
@@ -147,8 +229,19 @@ void MoveGroupMoveAction::executeMoveCallbackPlanAndExecute(const std::shared_pt
   opt.replan_delay_ = goal->get_goal()->planning_options.replan_delay;
   opt.before_execution_callback_ = boost::bind(&MoveGroupMoveAction::startMoveExecutionCallback, this);
 
-  opt.plan_callback_ = boost::bind(&MoveGroupMoveAction::planUsingPlanningPipeline, this,
-                                   boost::cref(motion_plan_request), boost::placeholders::_1);
+  if (lookahead_enabled_)
+    opt.plan_callback_ = boost::bind(&MoveGroupMoveAction::planUsingLookahead, this, goal,
+                                     boost::cref(motion_plan_request), boost::placeholders::_1);
+  else
+    opt.plan_callback_ = boost::bind(&MoveGroupMoveAction::planUsingPlanningPipeline, this,
+                                     boost::cref(motion_plan_request), boost::placeholders::_1);
+  if (local_repair_lookahead_ > 0.0)
+  {
+    opt.local_repair_callback_ = boost::bind(&MoveGroupMoveAction::planLocalRepair, this,
+                                             boost::cref(motion_plan_request), boost::placeholders::_1,
+                                             boost::placeholders::_2, boost::placeholders::_3, boost::placeholders::_4);
+    opt.local_repair_lookahead_ = local_repair_lookahead_;
+  }
   if (goal->get_goal()->planning_options.look_around && context_->plan_with_sensing_)
   {
     opt.plan_callback_ = boost::bind(&plan_execution::PlanWithSensing::computePlan, context_->plan_with_sensing_.get(),
@@ -233,13 +326,156 @@ bool MoveGroupMoveAction::planUsingPlanningPipeline(const planning_interface::Mo
     plan.plan_components_[0].description_ = "plan";
   }
   plan.error_code_ = res.error_code_;
+  planned_trajectory_ = res.trajectory_;
 
   return solved;
 }
 
+bool MoveGroupMoveAction::planLocalRepair(const planning_interface::MotionPlanRequest& req,
+                                          plan_execution::ExecutableMotionPlan& plan,
+                                          const moveit::core::RobotState& start, const moveit::core::RobotState& goal,
+                                          robot_trajectory::RobotTrajectoryPtr& segment)
+{
+  // plan between the two waypoints with the settings of the original request, keeping its path constraints
+  planning_interface::MotionPlanRequest segment_req = req;
+  moveit::core::robotStateToRobotStateMsg(start, segment_req.start_state, false);
+  segment_req.goal_constraints.assign(
+      1, kinematic_constraints::constructGoalConstraints(goal, goal.getJointModelGroup(req.group_name)));
+  segment_req.trajectory_constraints.constraints.clear();
+  segment_req.allowed_planning_time = std::min(segment_req.allowed_planning_time, local_repair_lookahead_);
+
+  planning_scene_monitor::LockedPlanningSceneRO lscene(plan.planning_scene_monitor_);
+  planning_interface::MotionPlanResponse res;
+  try
+  {
+    if (!context_->planning_pipeline_->generatePlan(plan.planning_scene_, segment_req, res))
+      return false;
+  }
+  catch (std::exception& ex)
+  {
+    RCLCPP_ERROR(LOGGER, "Planning pipeline threw an exception: %s", ex.what());
+    return false;
+  }
+  segment = res.trajectory_;
+  return segment != nullptr;
+}
+
+bool MoveGroupMoveAction::canPlanAhead(const MGAction::Goal& goal) const
+{
+  // goals that start from a given state, change the scene or need sensing are planned when they are processed
+  return !goal.planning_options.plan_only && !goal.planning_options.look_around &&
+         moveit::core::isEmpty(goal.request.start_state) &&
+         moveit::core::isEmpty(goal.planning_options.planning_scene_diff);
+}
+
+void MoveGroupMoveAction::startLookahead()
+{
+  if (!planned_trajectory_ || planned_trajectory_->empty())
+    return;
+
+  std::shared_ptr<MGActionGoal> goal;
+  {
+    std::lock_guard<std::mutex> lock(move_goals_mutex_);
+    if (move_goals_.empty())
+      return;
+    goal = move_goals_.front();
+  }
+  if (!canPlanAhead(*goal->get_goal()))
+    return;
+
+  if (lookahead_thread_.joinable())
+    lookahead_thread_.join();
+  lookahead_goal_ = goal;
+  lookahead_trajectory_.reset();
+  lookahead_scene_changed_ = false;
+
+  // plan in a copy of the scene, so that the scene is not locked while the current goal executes
+  planning_scene::PlanningScenePtr scene;
+  {
+    planning_scene_monitor::LockedPlanningSceneRO lscene(context_->planning_scene_monitor_,
+                                                         "MoveGroupMoveAction::startLookahead");
+    scene = planning_scene::PlanningScene::clone(lscene);
+  }
+  scene->setCurrentState(planned_trajectory_->getLastWayPoint());
+
+  RCLCPP_INFO(LOGGER, "Planning the next goal from the end of the executing trajectory");
+  lookahead_thread_ = std::thread([this, goal, scene] {
+    planning_interface::MotionPlanResponse res;
+    try
+    {
+      context_->planning_pipeline_->generatePlan(scene, goal->get_goal()->request, res);
+    }
+    catch (std::exception& ex)
+    {
+      RCLCPP_ERROR(LOGGER, "Planning pipeline threw an exception: %s", ex.what());
+      res.error_code_.val = moveit_msgs::msg::MoveItErrorCodes::FAILURE;
+    }
+    if (res.error_code_.val == moveit_msgs::msg::MoveItErrorCodes::SUCCESS && res.trajectory_ &&
+        !res.trajectory_->empty())
+      lookahead_trajectory_ = res.trajectory_;
+  });
+}
+
+robot_trajectory::RobotTrajectoryPtr MoveGroupMoveAction::takeLookaheadPlan(const std::shared_ptr<MGActionGoal>& goal)
+{
+  if (lookahead_goal_ != goal)
+    return robot_trajectory::RobotTrajectoryPtr();
+  if (lookahead_thread_.joinable())
+    lookahead_thread_.join();
+  lookahead_goal_.reset();
+  robot_trajectory::RobotTrajectoryPtr trajectory;
+  trajectory.swap(lookahead_trajectory_);
+  if (trajectory && lookahead_scene_changed_)
+  {
+    RCLCPP_INFO(LOGGER, "The scene changed while the goal was planned ahead, planning it again");
+    trajectory.reset();
+  }
+  return trajectory;
+}
+
+bool MoveGroupMoveAction::planUsingLookahead(const std::shared_ptr<MGActionGoal>& goal,
+                                             const planning_interface::MotionPlanRequest& req,
+                                             plan_execution::ExecutableMotionPlan& plan)
+{
+  robot_trajectory::RobotTrajectoryPtr trajectory = takeLookaheadPlan(goal);
+  if (trajectory)
+  {
+    planning_scene_monitor::LockedPlanningSceneRO lscene(plan.planning_scene_monitor_,
+                                                         "MoveGroupMoveAction::planUsingLookahead");
+    // the previous trajectory may not have ended where it was planned to, or the scene may have changed in a way
+    // that is not signalled as a geometry update
+    const moveit::core::RobotState& current_state = plan.planning_scene_->getCurrentState();
+    const double start_distance = trajectory->getGroup() ?
+                                      trajectory->getFirstWayPoint().distance(current_state, trajectory->getGroup()) :
+                                      trajectory->getFirstWayPoint().distance(current_state);
+    if (start_distance <= LOOKAHEAD_START_TOLERANCE &&
+        plan.planning_scene_->isPathValid(*trajectory, req.path_constraints, req.goal_constraints, req.group_name))
+    {
+      RCLCPP_INFO(LOGGER, "Using the plan computed while the previous goal executed");
+      plan.plan_components_.resize(1);
+      plan.plan_components_[0].trajectory_ = trajectory;
+      plan.plan_components_[0].description_ = "plan";
+      plan.error_code_.val = moveit_msgs::msg::MoveItErrorCodes::SUCCESS;
+      planned_trajectory_ = trajectory;
+      return true;
+    }
+    RCLCPP_INFO(LOGGER, "The plan computed while the previous goal executed is no longer valid, planning it again");
+  }
+  return planUsingPlanningPipeline(req, plan);
+}
+
+void MoveGroupMoveAction::sceneUpdateCallback(
+    planning_scene_monitor::PlanningSceneMonitor::SceneUpdateType update_type)
+{
+  if (update_type & planning_scene_monitor::PlanningSceneMonitor::UPDATE_GEOMETRY)
+    lookahead_scene_changed_ = true;
+}
+
 void MoveGroupMoveAction::startMoveExecutionCallback()
 {
   setMoveState(MONITOR, nullptr);
+  if (lookahead_enabled_)
+    startLookahead();
 }
 
 void MoveGroupMoveAction::startMoveLookCallback()
@@ -39,7 +39,12 @@
 #include <moveit/move_group/move_group_capability.h>
 #include <rclcpp_action/rclcpp_action.hpp>
 #include <moveit_msgs/action/move_group.hpp>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
 #include <memory>
+#include <mutex>
+#include <thread>
 
 namespace move_group
 {
@@ -50,11 +55,22 @@ class MoveGroupMoveAction : public MoveGroupCapability
 {
 public:
   MoveGroupMoveAction();
+  ~MoveGroupMoveAction() override;
 
   void initialize() override;
 
 private:
   void executeMoveCallback(std::shared_ptr<MGActionGoal> goal);
+
+  // lookahead mode: goals are queued and the next goal is planned from the end of the executing trajectory
+  void processMoveGoals();
+  bool canPlanAhead(const MGAction::Goal& goal) const;
+  void startLookahead();
+  robot_trajectory::RobotTrajectoryPtr takeLookaheadPlan(const std::shared_ptr<MGActionGoal>& goal);
+  bool planUsingLookahead(const std::shared_ptr<MGActionGoal>& goal, const planning_interface::MotionPlanRequest& req,
+                          plan_execution::ExecutableMotionPlan& plan);
+  void sceneUpdateCallback(planning_scene_monitor::PlanningSceneMonitor::SceneUpdateType update_type);
+
   void executeMoveCallbackPlanAndExecute(const std::shared_ptr<MGActionGoal>& goal,
                                          std::shared_ptr<MGAction::Result>& action_res);
   void executeMoveCallbackPlanOnly(const std::shared_ptr<MGActionGoal>& goal,
@@ -67,10 +83,36 @@ private:
 
   bool planUsingPlanningPipeline(const planning_interface::MotionPlanRequest& req,
                                  plan_execution::ExecutableMotionPlan& plan);
+  bool planLocalRepair(const planning_interface::MotionPlanRequest& req, plan_execution::ExecutableMotionPlan& plan,
+                       const moveit::core::RobotState& start, const moveit::core::RobotState& goal,
+                       robot_trajectory::RobotTrajectoryPtr& segment);
 
   std::shared_ptr<rclcpp_action::Server<MGAction>> execute_action_server_;
 
   MoveGroupState move_state_;
   bool preempt_requested_;
+
+  bool lookahead_enabled_;
+
+  // how far ahead of the robot an invalidated trajectory is repaired locally (in seconds), 0 to always replan
+  double local_repair_lookahead_;
+
+  // goals waiting for the goal being processed, protected by move_goals_mutex_
+  std::deque<std::shared_ptr<MGActionGoal>> move_goals_;
+  bool shutdown_requested_;
+  std::mutex move_goals_mutex_;
+  std::condition_variable move_goals_condition_;
+  std::thread move_goals_thread_;
+
+  // the last trajectory planned for the goal being processed
+  robot_trajectory::RobotTrajectoryPtr planned_trajectory_;
+
+  // the goal planned ahead and its trajectory (null if planning failed), which is only set once
+  // lookahead_thread_ has been joined
+  std::shared_ptr<MGActionGoal> lookahead_goal_;
+  robot_trajectory::RobotTrajectoryPtr lookahead_trajectory_;
+  std::thread lookahead_thread_;
+  // set when the geometry of the scene changes after the lookahead started
+  std::atomic<bool> lookahead_scene_changed_;
 };
 }  // namespace move_group
@@ -0,0 +1,211 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, PickNik LLC
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik LLC nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include "plan_dispatcher_capability.h"
+#include <moveit/move_group/capability_names.h>
+#include <algorithm>
+#include <chrono>
+#include <future>
+
+namespace move_group
+{
+static const rclcpp::Logger LOGGER =
+    rclcpp::get_logger("moveit_move_group_default_capabilities.plan_dispatcher_capability");
+
+MoveGroupPlanDispatcher::MoveGroupPlanDispatcher()
+  : MoveGroupCapability("PlanDispatcher")
+  , scene_version_(0)
+  , next_worker_(0)
+  , scene_wait_time_(1.0)
+  , response_timeout_(5.0)
+  , allow_outdated_workers_(false)
+{
+}
+
+void MoveGroupPlanDispatcher::initialize()
+{
+  using std::placeholders::_1;
+  using std::placeholders::_2;
+  using std::placeholders::_3;
+
+  const rclcpp::Node::SharedPtr& node = context_->node_;
+  std::vector<std::string> worker_names;
+  node->get_parameter("plan_dispatcher.workers", worker_names);
+  node->get_parameter_or("plan_dispatcher.scene_wait_time", scene_wait_time_, 1.0);
+  node->get_parameter_or("plan_dispatcher.response_timeout", response_timeout_, 5.0);
+  node->get_parameter_or("plan_dispatcher.allow_outdated_workers", allow_outdated_workers_, false);
+  if (worker_names.empty())
+    RCLCPP_WARN(LOGGER, "No workers listed in parameter 'plan_dispatcher.workers'. Planning requests will fail.");
+
+  worker_callback_group_ = node->create_callback_group(rclcpp::CallbackGroupType::MutuallyExclusive);
+  rclcpp::SubscriptionOptions options;
+  options.callback_group = worker_callback_group_;
+  for (const std::string& worker_name : worker_names)
+  {
+    auto worker = std::make_unique<Worker>();
+    worker->name = worker_name;
+    const std::string prefix = worker_name.empty() || worker_name.back() == '/' ? worker_name : worker_name + "/";
+    worker->client = node->create_client<moveit_msgs::srv::GetMotionPlan>(
+        prefix + PLANNER_SERVICE_NAME, rmw_qos_profile_services_default, worker_callback_group_);
+
+    Worker* w = worker.get();
+    worker->version_subscriber = node->create_subscription<std_msgs::msg::UInt64>(
+        prefix + SCENE_VERSION_TOPIC, rclcpp::QoS(1).transient_local(),
+        [this, w](const std_msgs::msg::UInt64::ConstSharedPtr& msg) {
+          {
+            std::lock_guard<std::mutex> lock(workers_mutex_);
+            w->has_scene_version = true;
+            w->scene_version = msg->data;
+          }
+          workers_condition_.notify_all();
+        },
+        options);
+    workers_.push_back(std::move(worker));
+  }
+
+  updateSceneVersion();
+  context_->planning_scene_monitor_->addUpdateCallback(
+      boost::bind(&MoveGroupPlanDispatcher::sceneUpdateCallback, this, boost::placeholders::_1));
+
+  dispatch_service_ = node->create_service<moveit_msgs::srv::GetMotionPlan>(
+      DISPATCH_PLANNER_SERVICE_NAME, std::bind(&MoveGroupPlanDispatcher::computePlanService, this, _1, _2, _3),
+      rmw_qos_profile_services_default, callback_group_);
+}
+
+void MoveGroupPlanDispatcher::sceneUpdateCallback(
+    planning_scene_monitor::PlanningSceneMonitor::SceneUpdateType update_type)
+{
+  if (update_type & (planning_scene_monitor::PlanningSceneMonitor::UPDATE_GEOMETRY |
+                     planning_scene_monitor::PlanningSceneMonitor::UPDATE_SCENE))
+    updateSceneVersion();
+}
+
+void MoveGroupPlanDispatcher::updateSceneVersion()
+{
+  std::uint64_t version;
+  {
+    planning_scene_monitor::LockedPlanningSceneRO ps(context_->planning_scene_monitor_);
+    version = computeSceneVersion(*ps);
+  }
+  {
+    std::lock_guard<std::mutex> lock(workers_mutex_);
+    scene_version_ = version;
+  }
+  workers_condition_.notify_all();
+}
+
+MoveGroupPlanDispatcher::Worker* MoveGroupPlanDispatcher::acquireWorker()
+{
+  const auto select = [this](bool current_scene_only) -> Worker* {
+    // the least busy worker, starting the search at the worker after the one chosen last
+    Worker* best = nullptr;
+    for (std::size_t i = 0; i < workers_.size(); ++i)
+    {
+      Worker* worker = workers_[(next_worker_ + i) % workers_.size()].get();
+      if (!worker->client->service_is_ready())
+        continue;
+      if (current_scene_only && (!worker->has_scene_version || worker->scene_version != scene_version_))
+        continue;
+      if (!best || worker->active_requests < best->active_requests)
+        best = worker;
+    }
+    return best;
+  };
+
+  std::unique_lock<std::mutex> lock(workers_mutex_);
+  Worker* worker = nullptr;
+  // the readiness of services is not signaled, so look again periodically
+  const std::chrono::steady_clock::time_point deadline =
+      std::chrono::steady_clock::now() +
+      std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(scene_wait_time_));
+  while (!(worker = select(true)) && rclcpp::ok() && std::chrono::steady_clock::now() < deadline)
+    workers_condition_.wait_until(lock,
+                                  std::min(deadline, std::chrono::steady_clock::now() + std::chrono::milliseconds(50)));
+
+  if (!worker && allow_outdated_workers_)
+  {
+    worker = select(false);
+    if (worker)
+      RCLCPP_WARN_STREAM(LOGGER, "No worker has the current planning scene. Planning with '" << worker->name << "'");
+  }
+  if (!worker)
+    return nullptr;
+
+  ++worker->active_requests;
+  for (std::size_t i = 0; i < workers_.size(); ++i)
+    if (workers_[i].get() == worker)
+      next_worker_ = i + 1;
+  return worker;
+}
+
+void MoveGroupPlanDispatcher::releaseWorker(Worker& worker)
+{
+  {
+    std::lock_guard<std::mutex> lock(workers_mutex_);
+    --worker.active_requests;
+  }
+  workers_condition_.notify_all();
+}
+
+bool MoveGroupPlanDispatcher::computePlanService(const std::shared_ptr<rmw_request_id_t> /*request_header*/,
+                                                 const std::shared_ptr<moveit_msgs::srv::GetMotionPlan::Request> req,
+                                                 std::shared_ptr<moveit_msgs::srv::GetMotionPlan::Response> res)
+{
+  RCLCPP_INFO(LOGGER, "Received new planning service request to dispatch...");
+  Worker* worker = acquireWorker();
+  if (!worker)
+  {
+    RCLCPP_ERROR(LOGGER, "No worker with the current planning scene is available");
+    res->motion_plan_response.error_code.val = moveit_msgs::msg::MoveItErrorCodes::FAILURE;
+    return true;
+  }
+
+  RCLCPP_DEBUG_STREAM(LOGGER, "Dispatching planning request to '" << worker->name << "'");
+  auto response = worker->client->async_send_request(req);
+  const double timeout = std::max(req->motion_plan_request.allowed_planning_time, 0.0) + response_timeout_;
+  if (response.wait_for(std::chrono::duration<double>(timeout)) == std::future_status::ready)
+    *res = *response.get();
+  else
+  {
+    RCLCPP_ERROR_STREAM(LOGGER, "Worker '" << worker->name << "' did not respond to the planning request in time");
+    res->motion_plan_response.error_code.val = moveit_msgs::msg::MoveItErrorCodes::TIMED_OUT;
+  }
+  releaseWorker(*worker);
+  return true;
+}
+}  // namespace move_group
+
+#include <pluginlib/class_list_macros.hpp>
+
+PLUGINLIB_EXPORT_CLASS(move_group::MoveGroupPlanDispatcher, move_group::MoveGroupCapability)
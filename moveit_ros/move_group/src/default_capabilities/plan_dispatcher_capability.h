@@ -0,0 +1,98 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, PickNik LLC
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik LLC nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#pragma once
+
+#include <moveit/move_group/move_group_capability.h>
+#include <moveit_msgs/srv/get_motion_plan.hpp>
+#include <std_msgs/msg/u_int64.hpp>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace move_group
+{
+/** \brief Pass planning requests on to worker move_group instances, to plan several requests at the same time.
+ *
+ * The workers are move_group instances in the namespaces listed in the plan_dispatcher.workers parameter. They serve
+ * the MoveGroupPlanService and load the SceneVersionPublisher capability. A request is only passed to a worker whose
+ * scene has the same version as the scene of this move_group, and of those to the one with the fewest requests in
+ * progress. If no worker is up to date within plan_dispatcher.scene_wait_time seconds, the request fails, unless
+ * plan_dispatcher.allow_outdated_workers is set. List this capability in reentrant_capabilities to dispatch requests
+ * concurrently. */
+class MoveGroupPlanDispatcher : public MoveGroupCapability
+{
+public:
+  MoveGroupPlanDispatcher();
+
+  void initialize() override;
+
+private:
+  struct Worker
+  {
+    std::string name;
+    rclcpp::Client<moveit_msgs::srv::GetMotionPlan>::SharedPtr client;
+    rclcpp::Subscription<std_msgs::msg::UInt64>::SharedPtr version_subscriber;
+    bool has_scene_version = false;
+    std::uint64_t scene_version = 0;
+    unsigned int active_requests = 0;
+  };
+
+  bool computePlanService(const std::shared_ptr<rmw_request_id_t> request_header,
+                          const std::shared_ptr<moveit_msgs::srv::GetMotionPlan::Request> req,
+                          std::shared_ptr<moveit_msgs::srv::GetMotionPlan::Response> res);
+  void sceneUpdateCallback(planning_scene_monitor::PlanningSceneMonitor::SceneUpdateType update_type);
+  void updateSceneVersion();
+
+  /** \brief Wait for a worker that has the current scene and count a request in progress for it, nullptr on timeout */
+  Worker* acquireWorker();
+  void releaseWorker(Worker& worker);
+
+  rclcpp::Service<moveit_msgs::srv::GetMotionPlan>::SharedPtr dispatch_service_;
+  // Clients and version subscriptions have a group of their own, so responses arrive while requests wait for them
+  rclcpp::CallbackGroup::SharedPtr worker_callback_group_;
+  std::vector<std::unique_ptr<Worker>> workers_;
+
+  std::mutex workers_mutex_;
+  std::condition_variable workers_condition_;
+  std::uint64_t scene_version_;
+  std::size_t next_worker_;
+
+  double scene_wait_time_;
+  double response_timeout_;
+  bool allow_outdated_workers_;
+};
+}  // namespace move_group
@@ -54,7 +54,8 @@ void MoveGroupPlanService::initialize()
   using std::placeholders::_3;
 
   plan_service_ = context_->node_->create_service<moveit_msgs::srv::GetMotionPlan>(
-      PLANNER_SERVICE_NAME, std::bind(&MoveGroupPlanService::computePlanService, this, _1, _2, _3));
+      PLANNER_SERVICE_NAME, std::bind(&MoveGroupPlanService::computePlanService, this, _1, _2, _3),
+      rmw_qos_profile_services_default, callback_group_);
 }
 
 bool MoveGroupPlanService::computePlanService(const std::shared_ptr<rmw_request_id_t> request_header,
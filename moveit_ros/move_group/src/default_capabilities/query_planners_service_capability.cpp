@@ -50,13 +50,16 @@ void MoveGroupQueryPlannersService::initialize()
   using std::placeholders::_2;
   using std::placeholders::_3;
   query_service_ = context_->node_->create_service<moveit_msgs::srv::QueryPlannerInterfaces>(
-      QUERY_PLANNERS_SERVICE_NAME, std::bind(&MoveGroupQueryPlannersService::queryInterface, this, _1, _2, _3));
+      QUERY_PLANNERS_SERVICE_NAME, std::bind(&MoveGroupQueryPlannersService::queryInterface, this, _1, _2, _3),
+      rmw_qos_profile_services_default, callback_group_);
 
   get_service_ = context_->node_->create_service<moveit_msgs::srv::GetPlannerParams>(
-      GET_PLANNER_PARAMS_SERVICE_NAME, std::bind(&MoveGroupQueryPlannersService::getParams, this, _1, _2, _3));
+      GET_PLANNER_PARAMS_SERVICE_NAME, std::bind(&MoveGroupQueryPlannersService::getParams, this, _1, _2, _3),
+      rmw_qos_profile_services_default, callback_group_);
 
   set_service_ = context_->node_->create_service<moveit_msgs::srv::SetPlannerParams>(
-      SET_PLANNER_PARAMS_SERVICE_NAME, std::bind(&MoveGroupQueryPlannersService::setParams, this, _1, _2, _3));
+      SET_PLANNER_PARAMS_SERVICE_NAME, std::bind(&MoveGroupQueryPlannersService::setParams, this, _1, _2, _3),
+      rmw_qos_profile_services_default, callback_group_);
 }
 
 bool MoveGroupQueryPlannersService::queryInterface(
@@ -0,0 +1,85 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, PickNik LLC
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik LLC nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include "scene_version_publisher_capability.h"
+#include <moveit/move_group/capability_names.h>
+
+namespace move_group
+{
+SceneVersionPublisher::SceneVersionPublisher()
+  : MoveGroupCapability("SceneVersionPublisher"), version_(0), version_published_(false)
+{
+}
+
+void SceneVersionPublisher::initialize()
+{
+  // latched, so that dispatchers started later receive the current version
+  version_publisher_ =
+      context_->node_->create_publisher<std_msgs::msg::UInt64>(SCENE_VERSION_TOPIC, rclcpp::QoS(1).transient_local());
+  context_->planning_scene_monitor_->addUpdateCallback(
+      boost::bind(&SceneVersionPublisher::sceneUpdateCallback, this, boost::placeholders::_1));
+  publishSceneVersion();
+}
+
+void SceneVersionPublisher::sceneUpdateCallback(
+    planning_scene_monitor::PlanningSceneMonitor::SceneUpdateType update_type)
+{
+  if (update_type & (planning_scene_monitor::PlanningSceneMonitor::UPDATE_GEOMETRY |
+                     planning_scene_monitor::PlanningSceneMonitor::UPDATE_SCENE))
+    publishSceneVersion();
+}
+
+void SceneVersionPublisher::publishSceneVersion()
+{
+  std::uint64_t version;
+  {
+    planning_scene_monitor::LockedPlanningSceneRO ps(context_->planning_scene_monitor_);
+    version = computeSceneVersion(*ps);
+  }
+
+  std::lock_guard<std::mutex> lock(version_mutex_);
+  if (version_published_ && version == version_)
+    return;
+  version_ = version;
+  version_published_ = true;
+
+  std_msgs::msg::UInt64 msg;
+  msg.data = version;
+  version_publisher_->publish(msg);
+}
+}  // namespace move_group
+
+#include <pluginlib/class_list_macros.hpp>
+
+PLUGINLIB_EXPORT_CLASS(move_group::SceneVersionPublisher, move_group::MoveGroupCapability)
@@ -52,8 +52,11 @@ void MoveGroupStateValidationService::initialize()
   using std::placeholders::_2;
   using std::placeholders::_3;
 
+  // requests only read the scene and are served concurrently, so that clients can keep many requests in flight
+  validity_callback_group_ = context_->node_->create_callback_group(rclcpp::CallbackGroupType::Reentrant);
   validity_service_ = context_->node_->create_service<moveit_msgs::srv::GetStateValidity>(
-      STATE_VALIDITY_SERVICE_NAME, std::bind(&MoveGroupStateValidationService::computeService, this, _1, _2, _3));
+      STATE_VALIDITY_SERVICE_NAME, std::bind(&MoveGroupStateValidationService::computeService, this, _1, _2, _3),
+      rmw_qos_profile_services_default, validity_callback_group_);
 }
 
 bool MoveGroupStateValidationService::computeService(
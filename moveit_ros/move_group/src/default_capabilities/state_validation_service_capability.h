@@ -54,5 +54,6 @@ private:
                       std::shared_ptr<moveit_msgs::srv::GetStateValidity::Response> res);
 
   rclcpp::Service<moveit_msgs::srv::GetStateValidity>::SharedPtr validity_service_;
+  rclcpp::CallbackGroup::SharedPtr validity_callback_group_;
 };
 }  // namespace move_group
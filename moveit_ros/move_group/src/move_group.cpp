@@ -154,6 +154,15 @@ private:
         capabilities.erase(*cap_name);
     }
 
+    // capabilities that serve their requests concurrently; the others serve one request at a time
+    std::set<std::string> reentrant_capabilities;
+    if (node_->get_parameter("reentrant_capabilities", capability_plugins))
+    {
+      boost::char_separator<char> sep(" ");
+      boost::tokenizer<boost::char_separator<char> > tok(capability_plugins, sep);
+      reentrant_capabilities.insert(tok.begin(), tok.end());
+    }
+
     for (const std::string& capability : capabilities)
     {
       try
@@ -161,6 +170,10 @@ private:
         printf(MOVEIT_CONSOLE_COLOR_CYAN "Loading '%s'...\n" MOVEIT_CONSOLE_COLOR_RESET, capability.c_str());
         MoveGroupCapabilityPtr cap = capability_plugin_loader_->createUniqueInstance(capability);
         cap->setContext(context_);
+        // each capability is served in its own callback group, so its requests do not wait for the other capabilities
+        cap->setCallbackGroup(node_->create_callback_group(reentrant_capabilities.count(capability) ?
+                                                               rclcpp::CallbackGroupType::Reentrant :
+                                                               rclcpp::CallbackGroupType::MutuallyExclusive));
         cap->initialize();
         capabilities_.push_back(cap);
       }
@@ -227,6 +240,8 @@ int main(int argc, char** argv)
     planning_scene_monitor->startWorldGeometryMonitor();
     planning_scene_monitor->startStateMonitor();
     planning_scene_monitor->setPlanningScenePublishingFrequency(100);
+    // let in-process components (e.g. MoveItCpp in capabilities) use this monitor
+    planning_scene_monitor::PlanningSceneMonitor::shareMonitor(planning_scene_monitor);
     printf(MOVEIT_CONSOLE_COLOR_CYAN "Planning scene monitors started.\n" MOVEIT_CONSOLE_COLOR_RESET);
 
     move_group::MoveGroupExe mge(nh, planning_scene_monitor, debug);
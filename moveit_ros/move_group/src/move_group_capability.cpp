@@ -36,6 +36,7 @@
 
 #include <moveit/move_group/move_group_capability.h>
 #include <moveit/robot_state/conversions.h>
+#include <moveit/planning_scene/planning_scene.h>
 #include <tf2_geometry_msgs/tf2_geometry_msgs.h>
 
 static const rclcpp::Logger LOGGER = rclcpp::get_logger("moveit_move_group_capabilities_base.move_group_capability");
@@ -45,6 +46,11 @@ void move_group::MoveGroupCapability::setContext(const MoveGroupContextPtr& cont
   context_ = context;
 }
 
+void move_group::MoveGroupCapability::setCallbackGroup(const rclcpp::CallbackGroup::SharedPtr& callback_group)
+{
+  callback_group_ = callback_group;
+}
+
 void move_group::MoveGroupCapability::convertToMsg(const std::vector<plan_execution::ExecutableTrajectory>& trajectory,
                                                    moveit_msgs::msg::RobotState& first_state_msg,
                                                    std::vector<moveit_msgs::msg::RobotTrajectory>& trajectory_msg) const
@@ -202,3 +208,35 @@ bool move_group::MoveGroupCapability::performTransform(geometry_msgs::msg::PoseS
   }
   return true;
 }
+
+std::uint64_t move_group::MoveGroupCapability::computeSceneVersion(const planning_scene::PlanningScene& scene) const
+{
+  // FNV-1a hash of the object ids and poses, which are computed from the update messages identically everywhere
+  std::uint64_t version = 14695981039346656037ULL;
+  const auto add = [&version](const void* data, std::size_t size) {
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    for (std::size_t i = 0; i < size; ++i)
+    {
+      version ^= bytes[i];
+      version *= 1099511628211ULL;
+    }
+  };
+
+  for (const auto& object : *scene.getWorld())
+  {
+    if (object.first == planning_scene::PlanningScene::OCTOMAP_NS)
+      continue;
+    add(object.first.data(), object.first.size());
+    for (const Eigen::Isometry3d& pose : object.second->shape_poses_)
+      add(pose.matrix().data(), sizeof(double) * pose.matrix().size());
+  }
+
+  std::vector<const moveit::core::AttachedBody*> attached_bodies;
+  scene.getCurrentState().getAttachedBodies(attached_bodies);  // sorted by name
+  for (const moveit::core::AttachedBody* attached_body : attached_bodies)
+  {
+    add(attached_body->getName().data(), attached_body->getName().size());
+    add(attached_body->getAttachedLinkName().data(), attached_body->getAttachedLinkName().size());
+  }
+  return version;
+}
@@ -55,7 +55,8 @@ namespace moveit_servo
 enum CollisionCheckType
 {
   K_THRESHOLD_DISTANCE = 1,
-  K_STOP_DISTANCE = 2
+  K_STOP_DISTANCE = 2,
+  K_PREDICTIVE = 3
 };
 
 class CollisionCheck
@@ -71,22 +72,48 @@ public:
 
   ~CollisionCheck()
   {
-    timer_->cancel();
+    if (timer_)
+      timer_->cancel();
   }
 
   /** \brief start the Timer that regulates collision check rate */
   void start();
 
+  /** \brief Run one iteration of collision checking for \e state in \e scene, instead of the timer.
+   * Used to check collisions inside the servo loop, so the velocity scale belongs to the state the servo step is
+   * computed from. The scale is published as usual, too.
+   * @return the collision velocity scale
+   */
+  double checkState(const moveit::core::RobotStatePtr& state, const planning_scene::PlanningScene& scene);
+
   /** \brief Pause or unpause processing servo commands while keeping the timers alive */
   void setPaused(bool paused);
 
+  /** \brief Set the worst-case stop time directly, for callers that compute it for several ServoCalcs at once */
+  void setWorstCaseStopTime(double worst_case_stop_time);
+
 private:
   /** \brief Run one iteration of collision checking */
   void run();
 
+  /** \brief Check current_state_ in \e scene and update velocity_scale_ */
+  void checkCollisions(const planning_scene::PlanningScene& scene);
+
+  /** \brief Publish velocity_scale_ for ServoCalcs */
+  void publishVelocityScale();
+
   /** \brief Get a read-only copy of the planning scene */
   planning_scene_monitor::LockedPlanningSceneRO getLockedPlanningSceneRO() const;
 
+  /** \brief Velocity scale of the "predictive" collision check type. Checks states predicted from the current joint
+   * velocities up to the worst-case stopping time, and returns the scale that lets the robot stop before the first
+   * predicted violation of min_allowable_collision_distance.
+   */
+  double predictiveVelocityScale(const planning_scene::PlanningScene& scene);
+
+  /** \brief Upper bound on how far any point of the group's links moves between current_state_ and \e state */
+  double maxLinkDisplacement(const moveit::core::RobotState& state) const;
+
   /** \brief Callback for collision stopping time, from the thread that is aware of velocity and acceleration */
   void worstCaseStopTimeCB(const std_msgs::msg::Float64::SharedPtr msg);
 
@@ -121,6 +148,20 @@ private:
   double safety_factor_ = 1000;
   double worst_case_stop_time_ = std::numeric_limits<double>::max();
 
+  // Variables for predictive collision checking, allocated once in the constructor
+  const moveit::core::JointModelGroup* joint_model_group_;
+  std::vector<moveit::core::RobotState> predicted_states_;
+  std::vector<const moveit::core::RobotState*> predicted_state_ptrs_;
+  // The links whose displacement bounds the change of collision distances, with the radius of a sphere around the
+  // link origin that contains the (padded) link geometry
+  std::vector<std::pair<const moveit::core::LinkModel*, double>> predicted_links_;
+  collision_detection::DistanceRequest distance_request_;
+  std::vector<collision_detection::DistanceResult> scene_distance_results_;
+  std::vector<collision_detection::DistanceResult> self_distance_results_;
+  std::vector<double> joint_positions_;
+  std::vector<double> joint_velocities_;
+  std::vector<double> predicted_positions_;
+
   const double self_velocity_scale_coefficient_;
   const double scene_velocity_scale_coefficient_;
 
@@ -40,6 +40,8 @@
 
 #include <cstddef>
 
+#include <Eigen/Core>
+
 namespace moveit_servo
 {
 /**
@@ -66,4 +68,51 @@ private:
   const double scale_term_;
   const double feedback_term_;
 };
+
+/**
+ * Class JointSmoothingFilter - Smooth the commanded positions of all joints of the group at once.
+ * The filter state is allocated in initialize(), so reset() and filter() do not allocate in the servo loop.
+ */
+class JointSmoothingFilter
+{
+public:
+  virtual ~JointSmoothingFilter() = default;
+  // Allocate the filter state for num_joints joints
+  virtual void initialize(std::size_t num_joints) = 0;
+  // The number of joints the filter state was allocated for
+  virtual std::size_t size() const = 0;
+  // Set the filter state to rest at the given positions
+  virtual void reset(const Eigen::Ref<const Eigen::VectorXd>& positions) = 0;
+  // Replace the new commanded positions with their filtered values
+  virtual void filter(Eigen::Ref<Eigen::VectorXd> positions) = 0;
+};
+
+/**
+ * Class ButterworthJointFilter - Butterworth low-pass filter of first or second order, vectorized over the joints.
+ * The first-order filter produces exactly the output of one LowPassFilter per joint. The second-order filter has the
+ * same cutoff frequency and attenuates jerks more strongly, for a little more lag.
+ */
+class ButterworthJointFilter : public JointSmoothingFilter
+{
+public:
+  // See LowPassFilter for the meaning of low_pass_filter_coeff
+  ButterworthJointFilter(double low_pass_filter_coeff, int order = 1);
+
+  void initialize(std::size_t num_joints) override;
+  std::size_t size() const override;
+  void reset(const Eigen::Ref<const Eigen::VectorXd>& positions) override;
+  void filter(Eigen::Ref<Eigen::VectorXd> positions) override;
+
+private:
+  const int order_;
+  // First order terms, same as in LowPassFilter
+  double scale_term_;
+  double feedback_term_;
+  // Second order terms of y[k] = b0 x[k] + b1 x[k-1] + b2 x[k-2] - a1 y[k-1] - a2 y[k-2]
+  double b0_, b1_, b2_, a1_, a2_;
+  // Previous measurements and filtered measurements of all joints, newest first
+  Eigen::ArrayXd x1_, x2_, y1_, y2_;
+  // Filtered measurement of the current step
+  Eigen::ArrayXd y_;
+};
 }  // namespace moveit_servo
@@ -0,0 +1,142 @@
+/*******************************************************************************
+ *      Title     : multi_servo.h
+ *      Project   : moveit_servo
+ *      Created   : 10/14/2026
+ *
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2019, Los Alamos National Security, LLC
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *******************************************************************************/
+
+
+#pragma once
+
+#include <limits>
+#include <memory>
+#include <vector>
+
+#include <moveit_servo/collision_check.h>
+#include <moveit_servo/servo_parameters.h>
+#include <moveit_servo/servo_calcs.h>
+
+namespace moveit_servo
+{
+/**
+ * Class MultiServo - Servo several arms of one robot in a single loop.
+ *
+ * Each arm is servoed by its own ServoCalcs, with its own command topics, frames and limits. Every cycle reads one
+ * robot state for all arms, checks collisions once for a group containing all of them (which includes collisions
+ * between the arms) against one planning scene snapshot, and publishes a single command for all of their joints.
+ */
+class MultiServo
+{
+public:
+  /** \brief Constructor
+   *  \param parameters: settings of the combined loop. Its move_group_name is a group containing all arms, which is
+   *                     checked for collisions. Its publish period, outgoing command and collision checking settings
+   *                     apply to all arms.
+   *  \param arm_parameters: settings of each arm. The settings taken from \e parameters are overwritten.
+   *  \param planning_scene_monitor: shared by all arms
+   */
+  MultiServo(const rclcpp::Node::SharedPtr& node, const ServoParametersPtr& parameters,
+             const std::vector<ServoParametersPtr>& arm_parameters,
+             const planning_scene_monitor::PlanningSceneMonitorPtr& planning_scene_monitor);
+
+  ~MultiServo();
+
+  /** \brief Start the timer of the combined loop. The real-time loop settings are not supported. */
+  void start();
+
+  /** \brief Pause or unpause processing servo commands of all arms while keeping the timer alive */
+  void setPaused(bool paused);
+
+  /** \brief Get the number of arms */
+  std::size_t getArmCount() const
+  {
+    return arms_.size();
+  }
+
+  /** \brief Get the ServoCalcs of an arm, e.g. for its frame transforms. The index is the one of \e arm_parameters */
+  ServoCalcs& getArm(std::size_t arm)
+  {
+    return *arms_.at(arm);
+  }
+
+  /** \brief Get the parameters of the combined loop */
+  const ServoParametersPtr& getParameters() const
+  {
+    return parameters_;
+  }
+
+private:
+  /** \brief Timer method: one cycle of all arms */
+  void run();
+
+  /** \brief Concatenate the arm commands into combined_command_ */
+  void composeCombinedCommand();
+
+  // Pointer to the ROS node
+  rclcpp::Node::SharedPtr node_;
+
+  // Pointer to the collision environment
+  planning_scene_monitor::PlanningSceneMonitorPtr planning_scene_monitor_;
+
+  // The stored servo parameters
+  ServoParametersPtr parameters_;
+
+  std::vector<std::unique_ptr<ServoCalcs>> arms_;
+  std::unique_ptr<CollisionCheck> collision_checker_;
+
+  // Per-arm copies of the state of the cycle and the arm commands, reused every cycle
+  std::vector<moveit::core::RobotStatePtr> arm_states_;
+  std::vector<trajectory_msgs::msg::JointTrajectory> arm_commands_;
+
+  // Outgoing messages
+  trajectory_msgs::msg::JointTrajectory combined_command_;
+  std_msgs::msg::Float64MultiArray multiarray_msg_;
+
+  // Collision checking every collision_check_cycle_divider_-th cycle
+  std::size_t collision_check_cycle_divider_ = 1;
+  std::size_t collision_check_cycle_ = 0;
+  double collision_velocity_scale_ = 1.0;
+  double worst_case_stop_time_ = std::numeric_limits<double>::max();
+
+  bool paused_ = false;
+
+  // ROS
+  rclcpp::TimerBase::SharedPtr timer_;
+  rclcpp::Publisher<trajectory_msgs::msg::JointTrajectory>::SharedPtr trajectory_outgoing_cmd_pub_;
+  rclcpp::Publisher<std_msgs::msg::Float64MultiArray>::SharedPtr multiarray_outgoing_cmd_pub_;
+};
+
+// MultiServoPtr using alias
+using MultiServoPtr = std::shared_ptr<MultiServo>;
+
+}  // namespace moveit_servo
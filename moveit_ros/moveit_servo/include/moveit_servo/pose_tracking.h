@@ -39,8 +39,11 @@
 #pragma once
 
 #include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
 #include <control_toolbox/pid.h>
-#include <moveit_servo/make_shared_from_pool.h>
 #include <moveit_servo/servo.h>
 #include <rosparam_shortcuts/rosparam_shortcuts.h>
 #include <tf2_geometry_msgs/tf2_geometry_msgs.h>
@@ -79,7 +82,8 @@ const std::unordered_map<PoseTrackingStatusCode, std::string> POSE_TRACKING_STAT
 
 /**
  * Class PoseTracking - subscribe to a target pose.
- * Servo toward the target pose.
+ * Servo toward the target pose. The PID controllers run in the servo loop, once per servo cycle with the state of that
+ * cycle, and their command is executed in the same cycle.
  */
 class PoseTracking
 {
@@ -87,6 +91,9 @@ public:
   /** \brief Constructor. Loads ROS parameters under the given namespace. */
   PoseTracking(const ros::NodeHandle& nh, const planning_scene_monitor::PlanningSceneMonitorPtr& planning_scene_monitor);
 
+  /** \brief Servo toward the target pose until the tolerances are satisfied. Blocks until the motion ended; the target
+   * pose may get updated by new messages as the robot moves.
+   */
   PoseTrackingStatusCode moveToPose(const Eigen::Vector3d& positional_tolerance, const double angular_tolerance,
                                     const double target_pose_timeout);
 
@@ -94,8 +101,21 @@ public:
   void stopMotion()
   {
     stop_requested_ = true;
+    motion_cv_.notify_all();
   }
 
+  /** \brief Latency from the arrival of a target pose to the servo cycle commanding toward it, in seconds */
+  struct TargetLatencyStatistics
+  {
+    std::uint64_t targets = 0;
+    double last_latency = 0;
+    double mean_latency = 0;
+    double max_latency = 0;
+  };
+
+  /** \brief Get the latency statistics of the target poses servoed toward so far */
+  TargetLatencyStatistics getTargetLatencyStatistics() const;
+
   /** \brief Change PID parameters. Motion is stopped before the udpate */
   void updatePIDConfig(const double x_proportional_gain, const double x_integral_gain, const double x_derivative_gain,
                        const double y_proportional_gain, const double y_integral_gain, const double y_derivative_gain,
@@ -145,8 +165,14 @@ private:
   /** \brief Update PID controller states (positions & orientations) */
   void updateControllerStateMeasurements();
 
+  /** \brief Called by Servo in every cycle: update the end effector pose and, during a motion, compute the command */
+  bool servoCycleCallback(const Eigen::Isometry3d& command_frame_transform, geometry_msgs::msg::TwistStamped& command);
+
+  /** \brief End the active motion with \e result and wake up moveToPose(). motion_mtx_ must be held. */
+  void finishMotion(PoseTrackingStatusCode result);
+
   /** \brief Use PID controllers to calculate a full spatial velocity toward a pose */
-  geometry_msgs::TwistStampedConstPtr calculateTwistCommand();
+  void calculateTwistCommand(geometry_msgs::msg::TwistStamped& msg);
 
   /** \brief Reset flags and PID controllers after a motion completes */
   void doPostMotionReset();
@@ -159,22 +185,33 @@ private:
   // Joint group used for controlling the motions
   std::string move_group_name_;
 
-  ros::Rate loop_rate_;
-
-  // ROS interface to Servo
-  ros::Publisher twist_stamped_pub_;
+  // The servo cycle period, which is the time step of the PID controllers
+  double publish_period_;
 
   std::vector<control_toolbox::Pid> cartesian_position_pids_;
   std::vector<control_toolbox::Pid> cartesian_orientation_pids_;
   // Cartesian PID configs
   PIDConfig x_pid_config_, y_pid_config_, z_pid_config_, angular_pid_config_;
 
+  // The motion run by the servo cycles, and the command frame transform updated by them (protected by motion_mtx_)
+  std::mutex motion_mtx_;
+  std::condition_variable motion_cv_;
+  bool motion_active_;
+  PoseTrackingStatusCode motion_result_;
+  Eigen::Vector3d positional_tolerance_;
+  double angular_tolerance_;
+
   // Transforms w.r.t. planning_frame_
   Eigen::Isometry3d command_frame_transform_;
   ros::Time command_frame_transform_stamp_;
   geometry_msgs::PoseStamped target_pose_;
   mutable std::mutex target_pose_mtx_;
 
+  // Arrival of the latest target pose, until a servo cycle commanded toward it (protected by target_pose_mtx_)
+  std::chrono::steady_clock::time_point target_pose_arrival_;
+  bool target_pose_commanded_;
+  TargetLatencyStatistics target_latency_;
+
   // Subscribe to target pose
   ros::Subscriber target_pose_sub_;
 
@@ -94,6 +94,22 @@ public:
     servo_calcs_->changeRobotLinkCommandFrame(new_command_frame);
   }
 
+  /** \brief Compute the Cartesian command of every servo cycle with \e callback, see ServoCalcs::setCycleCallback().
+   * Must be called before start().
+   */
+  void setCycleCallback(const ServoCalcs::CycleCallback& callback)
+  {
+    servo_calcs_->setCycleCallback(callback);
+  }
+
+  /** \brief Smooth the commanded joint positions with \e filter, see ServoCalcs::setSmoothingFilter().
+   * Must be called before start().
+   */
+  void setSmoothingFilter(std::unique_ptr<JointSmoothingFilter> filter)
+  {
+    servo_calcs_->setSmoothingFilter(std::move(filter));
+  }
+
 private:
   // Pointer to the collision environment
   planning_scene_monitor::PlanningSceneMonitorPtr planning_scene_monitor_;
@@ -39,7 +39,12 @@
 #pragma once
 
 // C++
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
 #include <mutex>
+#include <thread>
 
 // ROS
 #include <rclcpp/rclcpp.hpp>
@@ -58,25 +63,69 @@
 #include <trajectory_msgs/msg/joint_trajectory.hpp>
 
 // moveit_servo
+#include <moveit_servo/collision_check.h>
 #include <moveit_servo/servo_parameters.h>
 #include <moveit_servo/status_codes.h>
 #include <moveit_servo/low_pass_filter.h>
+#include <moveit_servo/triple_buffer.h>
 
 namespace moveit_servo
 {
 class ServoCalcs
 {
 public:
+  /** \brief Constructor
+   *  \param topic_prefix: prefix of the services and the collision checker topics of this instance. Instances sharing
+   *                       a node, like the arms of a MultiServo, need distinct prefixes.
+   */
   ServoCalcs(rclcpp::Node::SharedPtr node, const ServoParametersPtr& parameters,
-             const planning_scene_monitor::PlanningSceneMonitorPtr& planning_scene_monitor);
+             const planning_scene_monitor::PlanningSceneMonitorPtr& planning_scene_monitor,
+             const std::string& topic_prefix = "~/");
+
+  ~ServoCalcs();
 
-  ~ServoCalcs()
+  /** \brief Start the timer (or the real-time loop thread) where we do work and publish outputs.
+   * With \e start_loop false, only prepare the outgoing messages, for cycles driven with runCycle().
+   */
+  void start(bool start_loop = true);
+
+  /** \brief Run one servo cycle from \e state, for driving several instances from one loop instead of their own.
+   * \e state must be a copy owned by this instance, as the singularity look-ahead modifies it. The collision velocity
+   * scale is \e collision_velocity_scale instead of the one from the collision checker. Instead of publishing it, the
+   * command is written to \e command. If no command was produced in this cycle, \e command holds the last positions
+   * with zero velocities.
+   * @return true if a command was produced that should be sent
+   */
+  bool runCycle(const moveit::core::RobotStatePtr& state, double collision_velocity_scale,
+                trajectory_msgs::msg::JointTrajectory& command);
+
+  /** \brief The worst-case stop time computed in the latest cycle, in seconds */
+  double getWorstCaseStopTime() const
   {
-    timer_->cancel();
+    return worst_case_stop_time_msg_.data;
   }
 
-  /** \brief Start the timer where we do work and publish outputs */
-  void start();
+  /** \brief Timing statistics of the real-time loop, all durations in seconds */
+  struct LoopStatistics
+  {
+    std::uint64_t cycles = 0;
+    // Cycles whose calculations did not finish before the next deadline
+    std::uint64_t overruns = 0;
+    // How late the loop woke up with respect to its deadline
+    double mean_wakeup_latency = 0;
+    double max_wakeup_latency = 0;
+    // How long the calculations of one cycle took
+    double mean_cycle_time = 0;
+    double max_cycle_time = 0;
+  };
+
+  /** \brief Get the timing statistics of the real-time loop. All zeros if the loop runs on a ROS timer */
+  LoopStatistics getLoopStatistics() const;
+
+  /** \brief Get the condition number of the Jacobian from the latest Cartesian servo cycle, 0 before the first one.
+   * This is the metric the singularity thresholds are compared against.
+   */
+  double getJacobianConditionNumber() const;
 
   /**
    * Get the MoveIt planning link transform.
@@ -101,6 +150,30 @@ public:
   /** \brief Pause or unpause processing servo commands while keeping the timers alive */
   void setPaused(bool paused);
 
+  /** \brief Check collisions inside the servo loop with \e collision_checker instead of receiving the velocity scale
+   * from its timer. Every cycle at collision_check_rate checks the very state the servo step is computed from, against
+   * the latest planning scene snapshot. Must be called before start(); the checker must outlive this object.
+   */
+  void setCollisionChecker(CollisionCheck* collision_checker);
+
+  /** \brief Computes a Cartesian command for the current cycle from the command frame transform of this cycle.
+   * Return true to servo with \e command in this cycle, instead of the latest command received on the topic. The
+   * command needs a non-zero stamp, like commands received on the topic.
+   */
+  using CycleCallback =
+      std::function<bool(const Eigen::Isometry3d& command_frame_transform, geometry_msgs::msg::TwistStamped& command)>;
+
+  /** \brief Call \e callback once in every servo cycle, after the robot state was updated and before the servo step is
+   * computed. A controller running in it, e.g. PoseTracking, sees every new state exactly once and its command is
+   * executed in the same cycle. The callback runs in the servo loop and must not block. Must be called before start().
+   */
+  void setCycleCallback(const CycleCallback& callback);
+
+  /** \brief Smooth the commanded joint positions with \e filter, instead of the ButterworthJointFilter configured by
+   * the low_pass_filter_coeff and low_pass_filter_order parameters. Must be called before start().
+   */
+  void setSmoothingFilter(std::unique_ptr<JointSmoothingFilter> filter);
+
   /** \brief Change the controlled link. Often, this is the end effector
    * This must be a link on the robot since MoveIt tracks the transform (not tf)
    */
@@ -110,6 +183,9 @@ protected:
   /** \brief Timer method */
   void run();
 
+  /** \brief Body of the real-time loop thread: calls run() at absolute deadlines until stopped */
+  void realtimeLoop();
+
   /** \brief Do servoing calculations for Cartesian twist commands. */
   bool cartesianServoCalcs(geometry_msgs::msg::TwistStamped& cmd,
                            trajectory_msgs::msg::JointTrajectory& joint_trajectory);
@@ -165,6 +241,17 @@ protected:
                                              const Eigen::JacobiSVD<Eigen::MatrixXd>& svd,
                                              const Eigen::MatrixXd& pseudo_inverse);
 
+  /** \brief Velocity scaling for a Jacobian of condition number \e condition, given the dot product of the command
+   * with the direction toward the singularity
+   */
+  double velocityScalingFactorForCondition(double condition, double dot);
+
+  /** \brief Calculate delta_theta_ for the Cartesian step delta_x with damped least squares.
+   * Solves (J J^T + damping^2 I) y = delta_x on the rows that may not drift and sets delta_theta_ = J^T y,
+   * including the singularity velocity scaling. Uses jacobian_, which must be up to date.
+   */
+  void dampedLeastSquaresCalcs(const Eigen::VectorXd& delta_x);
+
   /** \brief Compose the outgoing JointTrajectory message */
   void composeJointTrajMessage(const sensor_msgs::msg::JointState& joint_state,
                                trajectory_msgs::msg::JointTrajectory& joint_trajectory);
@@ -275,6 +362,29 @@ protected:
   geometry_msgs::msg::TwistStamped twist_stamped_cmd_;
   control_msgs::msg::JointJog joint_servo_cmd_;
 
+  // Outgoing messages, reused every cycle so the loop does not allocate once their sizes have settled
+  std_msgs::msg::Int8 status_msg_;
+  std_msgs::msg::Float64 worst_case_stop_time_msg_;
+  trajectory_msgs::msg::JointTrajectory joint_trajectory_;
+  std_msgs::msg::Float64MultiArray multiarray_msg_;
+
+  // Workspace of the Cartesian calculations, sized on the first cycle and reused afterwards
+  Eigen::MatrixXd jacobian_;
+  Eigen::JacobiSVD<Eigen::MatrixXd> svd_;
+  Eigen::MatrixXd pseudo_inverse_;
+  Eigen::VectorXd new_theta_;
+  Eigen::VectorXd joint_step_;
+  Eigen::MatrixXd new_jacobian_;
+  Eigen::JacobiSVD<Eigen::MatrixXd> new_svd_;
+
+  // Cartesian quantities of at most 6 rows for the damped least-squares solver. The fixed maximum size keeps them off
+  // the heap.
+  using CartesianMatrix = Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, 0, 6, 6>;
+  using CartesianVector = Eigen::Matrix<double, Eigen::Dynamic, 1, 0, 6, 1>;
+
+  // Condition number of the Jacobian in the latest Cartesian cycle, read by getJacobianConditionNumber()
+  std::atomic<double> jacobian_condition_number_{ 0 };
+
   const moveit::core::JointModelGroup* joint_model_group_;
 
   moveit::core::RobotStatePtr current_state_;
@@ -286,13 +396,24 @@ protected:
   sensor_msgs::msg::JointState internal_joint_state_, original_joint_state_;
   std::map<std::string, std::size_t> joint_state_name_map_;
 
-  std::vector<LowPassFilter> position_filters_;
+  // Smooths the commanded positions of all joints at once
+  std::unique_ptr<JointSmoothingFilter> position_filter_;
 
   trajectory_msgs::msg::JointTrajectory::SharedPtr last_sent_command_;
 
   // ROS
   rclcpp::TimerBase::SharedPtr timer_;
   double period_;  // The loop period, in seconds
+
+  // Real-time loop, used instead of timer_ if use_realtime_loop is set
+  std::thread loop_thread_;
+  std::atomic<bool> stop_loop_{ false };
+  std::atomic<std::uint64_t> loop_cycles_{ 0 };
+  std::atomic<std::uint64_t> loop_overruns_{ 0 };
+  std::atomic<double> loop_wakeup_latency_sum_{ 0 };
+  std::atomic<double> loop_wakeup_latency_max_{ 0 };
+  std::atomic<double> loop_cycle_time_sum_{ 0 };
+  std::atomic<double> loop_cycle_time_max_{ 0 };
   rclcpp::Subscription<sensor_msgs::msg::JointState>::SharedPtr joint_state_sub_;
   rclcpp::Subscription<geometry_msgs::msg::TwistStamped>::SharedPtr twist_stamped_sub_;
   rclcpp::Subscription<control_msgs::msg::JointJog>::SharedPtr joint_cmd_sub_;
@@ -305,13 +426,27 @@ protected:
   rclcpp::Service<moveit_msgs::srv::ChangeDriftDimensions>::SharedPtr drift_dimensions_server_;
   rclcpp::Service<std_srvs::srv::Empty>::SharedPtr reset_servo_status_;
 
-  // Status
-  StatusCode status_ = StatusCode::NO_WARNING;
-  bool paused_ = false;
+  // Status. status_, paused_ and collision_velocity_scale_ are also set by callbacks while the loop thread runs
+  std::atomic<StatusCode> status_{ StatusCode::NO_WARNING };
+  std::atomic<bool> paused_{ false };
   bool twist_command_is_stale_ = false;
   bool joint_command_is_stale_ = false;
   bool ok_to_publish_ = false;
-  double collision_velocity_scale_ = 1.0;
+  std::atomic<double> collision_velocity_scale_{ 1.0 };
+
+  // Computes the Cartesian command of each cycle, if set
+  CycleCallback cycle_callback_;
+  geometry_msgs::msg::TwistStamped cycle_callback_command_;
+
+  // State and command output of the cycle run by runCycle(), if any
+  moveit::core::RobotStatePtr cycle_state_;
+  trajectory_msgs::msg::JointTrajectory* cycle_command_ = nullptr;
+  bool cycle_command_produced_ = false;
+
+  // Collision checking inside the loop, every collision_check_cycle_divider_-th cycle, if set
+  CollisionCheck* collision_checker_ = nullptr;
+  std::size_t collision_check_cycle_divider_ = 1;
+  std::size_t collision_check_cycle_ = 0;
 
   // Use ArrayXd type to enable more coefficient-wise operations
   Eigen::ArrayXd delta_theta_;
@@ -327,15 +462,30 @@ protected:
   // The dimesions to control. In the command frame. [x, y, z, roll, pitch, yaw]
   std::array<bool, 6> control_dimensions_ = { { true, true, true, true, true, true } };
 
+  // Written by the dimension services and copied into the two arrays above at the start of each cycle
+  TripleBuffer<std::array<bool, 6>> requested_drift_dimensions_{ drift_dimensions_ };
+  TripleBuffer<std::array<bool, 6>> requested_control_dimensions_{ control_dimensions_ };
+
   // latest_state_mutex_ is used to protect the state below it
   mutable std::mutex latest_state_mutex_;
   Eigen::Isometry3d tf_moveit_to_robot_cmd_frame_;
   Eigen::Isometry3d tf_moveit_to_ee_frame_;
-  geometry_msgs::msg::TwistStamped::ConstSharedPtr latest_twist_stamped_;
-  control_msgs::msg::JointJog::ConstSharedPtr latest_joint_cmd_;
+
+  /** \brief The latest incoming command of one type, with the stamp of the latest command that carried one */
+  template <typename MessageT>
+  struct LatestCommand
+  {
+    MessageT msg;
+    bool has_msg = false;
+    rclcpp::Time stamp = rclcpp::Time(0., RCL_ROS_TIME);
+    bool nonzero = false;
+  };
+
+  // Written by the command callbacks and read by the loop, so a callback never blocks the loop and the loop never
+  // frees a message. The callbacks keep the stamps of their latest commands themselves.
+  TripleBuffer<LatestCommand<geometry_msgs::msg::TwistStamped>> latest_twist_command_;
+  TripleBuffer<LatestCommand<control_msgs::msg::JointJog>> latest_joint_command_;
   rclcpp::Time latest_twist_command_stamp_ = rclcpp::Time(0., RCL_ROS_TIME);
   rclcpp::Time latest_joint_command_stamp_ = rclcpp::Time(0., RCL_ROS_TIME);
-  bool latest_nonzero_twist_stamped_ = false;
-  bool latest_nonzero_joint_cmd_ = false;
 };
 }  // namespace moveit_servo
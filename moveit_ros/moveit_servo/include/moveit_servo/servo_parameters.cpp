@@ -111,9 +111,14 @@ bool readParameters(ServoParametersPtr& parameters, const rclcpp::Node::SharedPt
   declareOrGetParam<bool>(parameters->publish_joint_velocities, ns + ".publish_joint_velocities", node, logger);
   declareOrGetParam<bool>(parameters->publish_joint_accelerations, ns + ".publish_joint_accelerations", node, logger);
 
+  // Real-time control loop
+  declareOrGetParam<bool>(parameters->use_realtime_loop, ns + ".use_realtime_loop", node, logger);
+  declareOrGetParam<int>(parameters->realtime_priority, ns + ".realtime_priority", node, logger);
+
   // Incoming Joint State properties
   declareOrGetParam<std::string>(parameters->joint_topic, ns + ".joint_topic", node, logger);
   declareOrGetParam<double>(parameters->low_pass_filter_coeff, ns + ".low_pass_filter_coeff", node, logger);
+  declareOrGetParam<int>(parameters->low_pass_filter_order, ns + ".low_pass_filter_order", node, logger);
 
   // MoveIt properties
   declareOrGetParam<std::string>(parameters->move_group_name, ns + ".move_group_name", node, logger);
@@ -130,10 +135,14 @@ bool readParameters(ServoParametersPtr& parameters, const rclcpp::Node::SharedPt
   declareOrGetParam<double>(parameters->hard_stop_singularity_threshold, ns + ".hard_stop_singularity_threshold", node,
                             logger);
   declareOrGetParam<double>(parameters->joint_limit_margin, ns + ".joint_limit_margin", node, logger);
+  declareOrGetParam<bool>(parameters->use_damped_least_squares, ns + ".use_damped_least_squares", node, logger);
+  declareOrGetParam<double>(parameters->damping_factor, ns + ".damping_factor", node, logger);
 
   // Collision checking
   declareOrGetParam<bool>(parameters->check_collisions, ns + ".check_collisions", node, logger);
   declareOrGetParam<double>(parameters->collision_check_rate, ns + ".collision_check_rate", node, logger);
+  declareOrGetParam<bool>(parameters->collision_check_in_servo_loop, ns + ".collision_check_in_servo_loop", node,
+                          logger);
   declareOrGetParam<std::string>(parameters->collision_check_type, ns + ".collision_check_type", node, logger);
   declareOrGetParam<double>(parameters->self_collision_proximity_threshold, ns + ".self_collision_proximity_threshold",
                             node, logger);
@@ -143,6 +152,7 @@ bool readParameters(ServoParametersPtr& parameters, const rclcpp::Node::SharedPt
                             node, logger);
   declareOrGetParam<double>(parameters->min_allowable_collision_distance, ns + ".min_allowable_collision_distance",
                             node, logger);
+  declareOrGetParam<int>(parameters->predictive_collision_samples, ns + ".predictive_collision_samples", node, logger);
 
   // Begin input checking
   if (parameters->publish_period <= 0.)
@@ -151,6 +161,11 @@ bool readParameters(ServoParametersPtr& parameters, const rclcpp::Node::SharedPt
                         "greater than zero. Check yaml file.");
     return false;
   }
+  if (parameters->realtime_priority < 0 || parameters->realtime_priority > 99)
+  {
+    RCLCPP_WARN(logger, "Parameter 'realtime_priority' should be between 0 and 99. Check yaml file.");
+    return false;
+  }
   if (parameters->num_outgoing_halt_msgs_to_publish < 0)
   {
     RCLCPP_WARN(logger, "Parameter 'num_outgoing_halt_msgs_to_publish' should be greater than zero. Check yaml file.");
@@ -176,12 +191,24 @@ bool readParameters(ServoParametersPtr& parameters, const rclcpp::Node::SharedPt
                         "greater than zero. Check yaml file.");
     return false;
   }
+  if (parameters->low_pass_filter_order != 1 && parameters->low_pass_filter_order != 2)
+  {
+    RCLCPP_WARN(logger, "Parameter 'low_pass_filter_order' should be "
+                        "1 or 2. Check yaml file.");
+    return false;
+  }
   if (parameters->joint_limit_margin < 0.)
   {
     RCLCPP_WARN(logger, "Parameter 'joint_limit_margin' should be "
                         "greater than or equal to zero. Check yaml file.");
     return false;
   }
+  if (parameters->use_damped_least_squares && parameters->damping_factor <= 0.)
+  {
+    RCLCPP_WARN(logger, "Parameter 'damping_factor' should be "
+                        "greater than zero when 'use_damped_least_squares' is set. Check yaml file.");
+    return false;
+  }
   if (parameters->command_in_type != "unitless" && parameters->command_in_type != "speed_units")
   {
     RCLCPP_WARN(logger, "command_in_type should be 'unitless' or "
@@ -213,9 +240,16 @@ bool readParameters(ServoParametersPtr& parameters, const rclcpp::Node::SharedPt
     return false;
   }
   // Collision checking
-  if (parameters->collision_check_type != "threshold_distance" && parameters->collision_check_type != "stop_distance")
+  if (parameters->collision_check_type != "threshold_distance" && parameters->collision_check_type != "stop_distance" &&
+      parameters->collision_check_type != "predictive")
   {
-    RCLCPP_WARN(logger, "collision_check_type must be 'threshold_distance' or 'stop_distance'");
+    RCLCPP_WARN(logger, "collision_check_type must be 'threshold_distance', 'stop_distance' or 'predictive'");
+    return false;
+  }
+  if (parameters->collision_check_type == "predictive" && parameters->predictive_collision_samples < 1)
+  {
+    RCLCPP_WARN(logger, "Parameter 'predictive_collision_samples' should be "
+                        "greater than zero. Check yaml file.");
     return false;
   }
   if (parameters->self_collision_proximity_threshold <= 0.)
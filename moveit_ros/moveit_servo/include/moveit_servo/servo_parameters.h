@@ -63,9 +63,13 @@ struct ServoParameters
   bool publish_joint_positions;
   bool publish_joint_velocities;
   bool publish_joint_accelerations;
+  // Real-time control loop
+  bool use_realtime_loop;
+  int realtime_priority;
   // Incoming Joint State properties
   std::string joint_topic;
   double low_pass_filter_coeff;
+  int low_pass_filter_order;
   // MoveIt properties
   std::string move_group_name;
   std::string planning_frame;
@@ -77,14 +81,18 @@ struct ServoParameters
   double lower_singularity_threshold;
   double hard_stop_singularity_threshold;
   double joint_limit_margin;
+  bool use_damped_least_squares;
+  double damping_factor;
   // Collision checking
   bool check_collisions;
   double collision_check_rate;
+  bool collision_check_in_servo_loop;
   std::string collision_check_type;
   double self_collision_proximity_threshold;
   double scene_collision_proximity_threshold;
   double collision_distance_safety_factor;
   double min_allowable_collision_distance;
+  int predictive_collision_samples;
 };
 
 using ServoParametersPtr = std::shared_ptr<ServoParameters>;
@@ -0,0 +1,92 @@
+/*******************************************************************************
+ *      Title     : triple_buffer.h
+ *      Project   : moveit_servo
+ *      Created   : 10/14/2026
+ *
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2020, PickNik LLC
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *******************************************************************************/
+
+#pragma once
+
+#include <array>
+#include <atomic>
+
+namespace moveit_servo
+{
+/** \brief Hands the latest value from one producer thread to one consumer thread without locking or allocating.
+ *
+ * Each side owns one of three buffers, the third one holds the latest published value. The producer fills its buffer
+ * and swaps it with the published one, the consumer swaps its buffer with the published one if that is newer. No side
+ * ever waits for the other, and values the consumer did not pick up in time are overwritten. */
+template <typename T>
+class TripleBuffer
+{
+public:
+  TripleBuffer() = default;
+
+  explicit TripleBuffer(const T& value)
+  {
+    buffers_.fill(value);
+  }
+
+  /** \brief The buffer the producer fills before calling publish(). It holds an older value, not the last published
+      one, so it needs to be overwritten completely. */
+  T& writeBuffer()
+  {
+    return buffers_[back_];
+  }
+
+  /** \brief Make the content of writeBuffer() the latest value. Producer side only. */
+  void publish()
+  {
+    back_ = middle_.exchange(back_ | NEW_VALUE, std::memory_order_acq_rel) & INDEX;
+  }
+
+  /** \brief Get the latest published value. Consumer side only; the reference stays valid until the next call. */
+  const T& read()
+  {
+    if (middle_.load(std::memory_order_relaxed) & NEW_VALUE)
+      front_ = middle_.exchange(front_, std::memory_order_acq_rel) & INDEX;
+    return buffers_[front_];
+  }
+
+private:
+  static constexpr unsigned INDEX = 3;
+  static constexpr unsigned NEW_VALUE = 4;
+
+  std::array<T, 3> buffers_;
+  unsigned back_ = 0;   // owned by the producer
+  unsigned front_ = 1;  // owned by the consumer
+  std::atomic<unsigned> middle_{ 2 };
+  static_assert(std::atomic<unsigned>::is_always_lock_free, "TripleBuffer needs a lock-free index");
+};
+}  // namespace moveit_servo
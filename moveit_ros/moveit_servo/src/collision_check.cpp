@@ -37,6 +37,8 @@
  *      Author    : Brian O'Neil, Andy Zelenak, Blake Anderson
  */
 
+#include <cmath>
+
 #include <std_msgs/msg/float64.hpp>
 
 #include <moveit_servo/collision_check.h>
@@ -46,6 +48,7 @@ static const rclcpp::Logger LOGGER = rclcpp::get_logger("moveit_servo.collision_
 static const double MIN_RECOMMENDED_COLLISION_RATE = 10;
 constexpr double EPSILON = 1e-6;                       // For very small numeric comparisons
 constexpr size_t ROS_LOG_THROTTLE_PERIOD = 30 * 1000;  // Milliseconds to throttle logs inside loops
+constexpr double MAX_PREDICTION_HORIZON = 1.0;         // Seconds, until a worst-case stop time has been received
 
 namespace moveit_servo
 {
@@ -71,8 +74,12 @@ CollisionCheck::CollisionCheck(rclcpp::Node::SharedPtr node, const ServoParamete
                                 "Collision check rate is low, increase it in yaml file if CPU allows");
   }
 
-  collision_check_type_ =
-      (parameters_->collision_check_type == "threshold_distance" ? K_THRESHOLD_DISTANCE : K_STOP_DISTANCE);
+  if (parameters_->collision_check_type == "threshold_distance")
+    collision_check_type_ = K_THRESHOLD_DISTANCE;
+  else if (parameters_->collision_check_type == "stop_distance")
+    collision_check_type_ = K_STOP_DISTANCE;
+  else
+    collision_check_type_ = K_PREDICTIVE;
   safety_factor_ = parameters_->collision_distance_safety_factor;
 
   // ROS pubs/subs
@@ -85,6 +92,27 @@ CollisionCheck::CollisionCheck(rclcpp::Node::SharedPtr node, const ServoParamete
 
   current_state_ = planning_scene_monitor_->getStateMonitor()->getCurrentState();
   acm_ = getLockedPlanningSceneRO()->getAllowedCollisionMatrix();
+
+  // Set up the predicted states and the batched distance query once, so run() only overwrites them
+  joint_model_group_ = current_state_->getJointModelGroup(parameters_->move_group_name);
+  if (collision_check_type_ == K_PREDICTIVE)
+  {
+    predicted_states_.assign(parameters_->predictive_collision_samples, *current_state_);
+    for (const moveit::core::RobotState& state : predicted_states_)
+      predicted_state_ptrs_.push_back(&state);
+
+    const collision_detection::CollisionEnvConstPtr collision_env = getLockedPlanningSceneRO()->getCollisionEnv();
+    for (const moveit::core::LinkModel* link : joint_model_group_->getUpdatedLinkModelsWithGeometry())
+    {
+      const double radius = 0.5 * link->getShapeExtentsAtOrigin().norm() + link->getCenteredBoundingBoxOffset().norm() +
+                            collision_env->getLinkPadding(link->getName());
+      predicted_links_.emplace_back(link, radius);
+    }
+
+    distance_request_.group_name = parameters_->move_group_name;
+    distance_request_.enableGroup(current_state_->getRobotModel());
+    distance_request_.acm = &acm_;
+  }
 }
 
 planning_scene_monitor::LockedPlanningSceneRO CollisionCheck::getLockedPlanningSceneRO() const
@@ -106,21 +134,41 @@ void CollisionCheck::run()
 
   // Update to the latest current state
   current_state_ = planning_scene_monitor_->getStateMonitor()->getCurrentState();
+
+  // Hold a single read lock for all queries of this iteration
+  const planning_scene_monitor::LockedPlanningSceneRO locked_scene = getLockedPlanningSceneRO();
+  checkCollisions(*static_cast<const planning_scene::PlanningSceneConstPtr&>(locked_scene));
+  publishVelocityScale();
+}
+
+double CollisionCheck::checkState(const moveit::core::RobotStatePtr& state, const planning_scene::PlanningScene& scene)
+{
+  if (paused_)
+  {
+    return velocity_scale_;
+  }
+
+  current_state_ = state;
+  checkCollisions(scene);
+  publishVelocityScale();
+  return velocity_scale_;
+}
+
+void CollisionCheck::checkCollisions(const planning_scene::PlanningScene& scene)
+{
   current_state_->updateCollisionBodyTransforms();
   collision_detected_ = false;
 
   // Do a timer-safe distance-based collision detection
   collision_result_.clear();
-  getLockedPlanningSceneRO()->getCollisionEnv()->checkRobotCollision(collision_request_, collision_result_,
-                                                                     *current_state_);
+  scene.getCollisionEnv()->checkRobotCollision(collision_request_, collision_result_, *current_state_);
   scene_collision_distance_ = collision_result_.distance;
   collision_detected_ |= collision_result_.collision;
   collision_result_.print();
 
   collision_result_.clear();
   // Self-collisions and scene collisions are checked separately so different thresholds can be used
-  getLockedPlanningSceneRO()->getCollisionEnvUnpadded()->checkSelfCollision(collision_request_, collision_result_,
-                                                                            *current_state_, acm_);
+  scene.getCollisionEnvUnpadded()->checkSelfCollision(collision_request_, collision_result_, *current_state_, acm_);
   self_collision_distance_ = collision_result_.distance;
   collision_detected_ |= collision_result_.collision;
   collision_result_.print();
@@ -131,6 +179,10 @@ void CollisionCheck::run()
   {
     velocity_scale_ = 0;
   }
+  else if (collision_check_type_ == K_PREDICTIVE)
+  {
+    velocity_scale_ = predictiveVelocityScale(scene);
+  }
   // If threshold distances were specified
   else if (collision_check_type_ == K_THRESHOLD_DISTANCE)
   {
@@ -185,7 +237,10 @@ void CollisionCheck::run()
     // Update for the next iteration
     prev_collision_distance_ = current_collision_distance_;
   }
+}
 
+void CollisionCheck::publishVelocityScale()
+{
   // publish message
   {
     auto msg = std::make_unique<std_msgs::msg::Float64>();
@@ -194,11 +249,97 @@ void CollisionCheck::run()
   }
 }
 
+double CollisionCheck::predictiveVelocityScale(const planning_scene::PlanningScene& scene)
+{
+  current_state_->copyJointGroupPositions(joint_model_group_, joint_positions_);
+  current_state_->copyJointGroupVelocities(joint_model_group_, joint_velocities_);
+  predicted_positions_.resize(joint_positions_.size());
+
+  // Predict until the robot could have stopped, plus the time until the next check picks up a change
+  const double horizon = std::min(worst_case_stop_time_, MAX_PREDICTION_HORIZON) + period_;
+  const std::size_t samples = predicted_states_.size();
+
+  // Each predicted state continues the current joint velocities for a fraction of the horizon
+  double max_displacement = 0;
+  std::vector<const moveit::core::AttachedBody*> attached_bodies;
+  current_state_->getAttachedBodies(attached_bodies);
+  for (std::size_t sample = 0; sample < samples; ++sample)
+  {
+    const double time = horizon * (sample + 1) / samples;
+    for (std::size_t i = 0; i < joint_positions_.size(); ++i)
+      predicted_positions_[i] = joint_positions_[i] + joint_velocities_[i] * time;
+
+    moveit::core::RobotState& state = predicted_states_[sample];
+    state = *current_state_;
+    state.setJointGroupPositions(joint_model_group_, predicted_positions_);
+    state.enforceBounds(joint_model_group_);
+    state.updateCollisionBodyTransforms();
+    if (attached_bodies.empty())
+      max_displacement = std::max(max_displacement, maxLinkDisplacement(state));
+  }
+
+  // Cheap pre-filter: the distance to the world shrinks at most by how far any point of the robot moves, the distance
+  // between two links at most by twice that. If even the worst case stays clear, skip the distance queries.
+  // Attached bodies are not covered by the link bounds, so they always get the full check.
+  const double current_distance = std::min(scene_collision_distance_, self_collision_distance_);
+  if (attached_bodies.empty() &&
+      scene_collision_distance_ - max_displacement >= parameters_->min_allowable_collision_distance &&
+      self_collision_distance_ - 2 * max_displacement >= parameters_->min_allowable_collision_distance)
+  {
+    return 1;
+  }
+
+  // One batched query per collision environment for all predicted states
+  scene.getCollisionEnv()->distanceRobotBatch(distance_request_, scene_distance_results_, predicted_state_ptrs_);
+  scene.getCollisionEnvUnpadded()->distanceSelfBatch(distance_request_, self_distance_results_, predicted_state_ptrs_);
+
+  for (std::size_t sample = 0; sample < samples; ++sample)
+  {
+    const double distance = std::min(scene_distance_results_[sample].minimum_distance.distance,
+                                     self_distance_results_[sample].minimum_distance.distance);
+
+    // Moving away from a close obstacle is fine, only approaching it below the allowed distance is not
+    if (distance < parameters_->min_allowable_collision_distance && distance < current_distance)
+    {
+      // A predicted violation at time t leaves t at full speed. Stopping from a speed scaled by s takes s times the
+      // worst-case stop time and covers s^2 times the stopping distance, so the largest speed that still stops in
+      // time is s = sqrt(2 t / stop_time).
+      const double time = horizon * (sample + 1) / samples;
+      if (worst_case_stop_time_ <= EPSILON)
+        return 1;
+      return std::min(1.0, std::sqrt(2 * time / worst_case_stop_time_));
+    }
+  }
+  return 1;
+}
+
+double CollisionCheck::maxLinkDisplacement(const moveit::core::RobotState& state) const
+{
+  double max_displacement = 0;
+  for (const auto& link : predicted_links_)
+  {
+    const Eigen::Isometry3d& current = current_state_->getGlobalLinkTransform(link.first);
+    const Eigen::Isometry3d& predicted = state.getGlobalLinkTransform(link.first);
+
+    // A point within link.second of the origin moves at most the origin's displacement plus the radius times the
+    // rotation angle
+    const double angle = Eigen::AngleAxisd(current.linear().transpose() * predicted.linear()).angle();
+    max_displacement = std::max(max_displacement,
+                                (predicted.translation() - current.translation()).norm() + link.second * angle);
+  }
+  return max_displacement;
+}
+
 void CollisionCheck::worstCaseStopTimeCB(const std_msgs::msg::Float64::SharedPtr msg)
 {
   worst_case_stop_time_ = msg.get()->data;
 }
 
+void CollisionCheck::setWorstCaseStopTime(double worst_case_stop_time)
+{
+  worst_case_stop_time_ = worst_case_stop_time;
+}
+
 void CollisionCheck::setPaused(bool paused)
 {
   paused_ = paused;
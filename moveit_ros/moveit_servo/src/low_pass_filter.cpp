@@ -94,4 +94,77 @@ double LowPassFilter::filter(double new_measurement)
 
   return new_filtered_measurement;
 }
+
+ButterworthJointFilter::ButterworthJointFilter(double low_pass_filter_coeff, int order)
+  : order_(order)
+  , scale_term_(1. / (1. + low_pass_filter_coeff))
+  , feedback_term_(1. - low_pass_filter_coeff)
+  , b0_(0.)
+  , b1_(0.)
+  , b2_(0.)
+  , a1_(0.)
+  , a2_(0.)
+{
+  // Make sure input values are ok
+  if (std::isinf(feedback_term_))
+    throw std::length_error("moveit_servo::ButterworthJointFilter: infinite feedback_term_");
+
+  if (low_pass_filter_coeff < 1)
+    throw std::length_error("moveit_servo::ButterworthJointFilter: Filter coefficient < 1. makes the filter unstable");
+
+  if (std::abs(feedback_term_) < EPSILON)
+    throw std::length_error("moveit_servo::ButterworthJointFilter: Filter coefficient value resulted in feedback term "
+                            "of 0");
+
+  if (order_ != 1 && order_ != 2)
+    throw std::length_error("moveit_servo::ButterworthJointFilter: Only filters of order 1 and 2 are supported");
+
+  // The bilinear transform of the first-order filter pre-warps the cutoff frequency to tan(wc T / 2) = 1 / coeff.
+  // Use the same cutoff frequency for the second-order filter.
+  const double k = 1. / low_pass_filter_coeff;
+  const double norm = 1. / (1. + M_SQRT2 * k + k * k);
+  b0_ = k * k * norm;
+  b1_ = 2. * b0_;
+  b2_ = b0_;
+  a1_ = 2. * (k * k - 1.) * norm;
+  a2_ = (1. - M_SQRT2 * k + k * k) * norm;
+}
+
+void ButterworthJointFilter::initialize(std::size_t num_joints)
+{
+  x1_.setZero(num_joints);
+  x2_.setZero(num_joints);
+  y1_.setZero(num_joints);
+  y2_.setZero(num_joints);
+  y_.setZero(num_joints);
+}
+
+std::size_t ButterworthJointFilter::size() const
+{
+  return static_cast<std::size_t>(y_.size());
+}
+
+void ButterworthJointFilter::reset(const Eigen::Ref<const Eigen::VectorXd>& positions)
+{
+  x1_ = positions.array();
+  x2_ = positions.array();
+  y1_ = positions.array();
+  y2_ = positions.array();
+}
+
+void ButterworthJointFilter::filter(Eigen::Ref<Eigen::VectorXd> positions)
+{
+  if (order_ == 1)
+    y_ = scale_term_ * (x1_ + positions.array() - feedback_term_ * y1_);
+  else
+    y_ = b0_ * positions.array() + b1_ * x1_ + b2_ * x2_ - a1_ * y1_ - a2_ * y2_;
+
+  // Push in the new measurement and filtered measurement. Swapping exchanges the buffers without allocating.
+  x2_.swap(x1_);
+  x1_ = positions.array();
+  y2_.swap(y1_);
+  y1_.swap(y_);
+
+  positions = y1_.matrix();
+}
 }  // namespace moveit_servo
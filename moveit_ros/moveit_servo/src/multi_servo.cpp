@@ -0,0 +1,220 @@
+/*******************************************************************************
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2019, Los Alamos National Security, LLC
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *******************************************************************************/
+
+/*      Title     : multi_servo.cpp
+ *      Project   : moveit_servo
+ *      Created   : 10/14/2026
+ */
+
+#include <algorithm>
+#include <cmath>
+
+#include <moveit_servo/multi_servo.h>
+
+namespace moveit_servo
+{
+static const rclcpp::Logger LOGGER = rclcpp::get_logger("moveit_servo.multi_servo");
+namespace
+{
+constexpr double ROBOT_STATE_WAIT_TIME = 10.0;  // seconds
+}  // namespace
+
+MultiServo::MultiServo(const rclcpp::Node::SharedPtr& node, const ServoParametersPtr& parameters,
+                       const std::vector<ServoParametersPtr>& arm_parameters,
+                       const planning_scene_monitor::PlanningSceneMonitorPtr& planning_scene_monitor)
+  : node_(node), planning_scene_monitor_(planning_scene_monitor), parameters_(parameters)
+{
+  // Confirm the planning scene monitor is ready to be used
+  if (!planning_scene_monitor_->getStateMonitor())
+  {
+    planning_scene_monitor_->startStateMonitor(parameters_->joint_topic);
+  }
+  planning_scene_monitor_->getStateMonitor()->enableCopyDynamics(true);
+
+  if (!planning_scene_monitor_->getStateMonitor()->waitForCompleteState(parameters_->move_group_name,
+                                                                        ROBOT_STATE_WAIT_TIME))
+  {
+    RCLCPP_FATAL(LOGGER, "Timeout waiting for current state");
+    exit(EXIT_FAILURE);
+  }
+
+  const moveit::core::RobotStatePtr state = planning_scene_monitor_->getStateMonitor()->getCurrentState();
+  for (const ServoParametersPtr& arm : arm_parameters)
+  {
+    // All arms step with the combined loop and produce the parts of its command
+    arm->publish_period = parameters_->publish_period;
+    arm->publish_joint_positions = parameters_->publish_joint_positions;
+    arm->publish_joint_velocities = parameters_->publish_joint_velocities;
+    arm->publish_joint_accelerations = parameters_->publish_joint_accelerations;
+    arm->use_realtime_loop = false;
+    // Each arm computes its worst-case stop time, the collision checker of the combined group uses the largest one
+    arm->check_collisions = parameters_->check_collisions;
+    arm->collision_check_type = parameters_->collision_check_type;
+
+    // The arms share the node, so their services need distinct names
+    arms_.push_back(
+        std::make_unique<ServoCalcs>(node_, arm, planning_scene_monitor_, "~/" + arm->move_group_name + "/"));
+    arm_states_.push_back(std::make_shared<moveit::core::RobotState>(*state));
+  }
+  arm_commands_.resize(arms_.size());
+
+  if (parameters_->check_collisions)
+  {
+    collision_checker_ = std::make_unique<CollisionCheck>(node_, parameters_, planning_scene_monitor_);
+    collision_check_cycle_divider_ = std::max<std::size_t>(
+        1, std::lround(1. / (parameters_->collision_check_rate * parameters_->publish_period)));
+  }
+
+  if (parameters_->command_out_type == "trajectory_msgs/JointTrajectory")
+  {
+    trajectory_outgoing_cmd_pub_ =
+        node_->create_publisher<trajectory_msgs::msg::JointTrajectory>(parameters_->command_out_topic, ROS_QUEUE_SIZE);
+  }
+  else if (parameters_->command_out_type == "std_msgs/Float64MultiArray")
+  {
+    multiarray_outgoing_cmd_pub_ =
+        node_->create_publisher<std_msgs::msg::Float64MultiArray>(parameters_->command_out_topic, ROS_QUEUE_SIZE);
+  }
+}
+
+MultiServo::~MultiServo()
+{
+  if (timer_)
+    timer_->cancel();
+  setPaused(true);
+}
+
+void MultiServo::start()
+{
+  setPaused(false);
+
+  // The collision checks run in the loop, against immutable scene snapshots so the loop never waits for scene updates
+  if (collision_checker_)
+    planning_scene_monitor_->setSceneSnapshotsEnabled(true);
+
+  for (const std::unique_ptr<ServoCalcs>& arm : arms_)
+    arm->start(false);
+
+  timer_ = node_->create_wall_timer(std::chrono::duration<double>(parameters_->publish_period),
+                                    std::bind(&MultiServo::run, this));
+}
+
+void MultiServo::setPaused(bool paused)
+{
+  paused_ = paused;
+  for (const std::unique_ptr<ServoCalcs>& arm : arms_)
+    arm->setPaused(paused);
+  if (collision_checker_)
+    collision_checker_->setPaused(paused);
+}
+
+void MultiServo::run()
+{
+  // A single state for all arms, so their commands are computed for the same instant
+  const moveit::core::RobotStatePtr state = planning_scene_monitor_->getStateMonitor()->getCurrentState();
+
+  // One check of the combined group covers the scene, each arm and the arms against each other
+  if (collision_checker_ && (collision_check_cycle_++ % collision_check_cycle_divider_ == 0))
+  {
+    collision_checker_->setWorstCaseStopTime(worst_case_stop_time_);
+    const planning_scene::PlanningSceneConstPtr scene = planning_scene_monitor_->getPlanningSceneSnapshot();
+    if (scene)
+      collision_velocity_scale_ = collision_checker_->checkState(state, *scene);
+  }
+
+  bool send_command = false;
+  worst_case_stop_time_ = 0;
+  for (std::size_t i = 0; i < arms_.size(); ++i)
+  {
+    // The singularity look-ahead of an arm modifies its state, so each arm gets its own copy
+    *arm_states_[i] = *state;
+    send_command |= arms_[i]->runCycle(arm_states_[i], collision_velocity_scale_, arm_commands_[i]);
+    worst_case_stop_time_ = std::max(worst_case_stop_time_, arms_[i]->getWorstCaseStopTime());
+  }
+
+  // Arms without a command of their own in this cycle hold their positions in the combined command
+  if (!send_command || paused_ || arms_.empty())
+    return;
+
+  composeCombinedCommand();
+  if (trajectory_outgoing_cmd_pub_)
+  {
+    trajectory_outgoing_cmd_pub_->publish(combined_command_);
+  }
+  else if (multiarray_outgoing_cmd_pub_)
+  {
+    multiarray_msg_.data.clear();
+    if (parameters_->publish_joint_positions && !combined_command_.points.empty())
+      multiarray_msg_.data = combined_command_.points[0].positions;
+    else if (parameters_->publish_joint_velocities && !combined_command_.points.empty())
+      multiarray_msg_.data = combined_command_.points[0].velocities;
+    multiarray_outgoing_cmd_pub_->publish(multiarray_msg_);
+  }
+}
+
+void MultiServo::composeCombinedCommand()
+{
+  std::size_t point_count = arm_commands_.front().points.size();
+  for (const trajectory_msgs::msg::JointTrajectory& command : arm_commands_)
+    point_count = std::min(point_count, command.points.size());
+
+  // When a joint_trajectory_controller receives a new command, a stamp of 0 indicates "begin immediately"
+  combined_command_.header.stamp = rclcpp::Time(0);
+  combined_command_.header.frame_id = parameters_->planning_frame;
+  combined_command_.joint_names.clear();
+  combined_command_.points.resize(point_count);
+  for (trajectory_msgs::msg::JointTrajectoryPoint& point : combined_command_.points)
+  {
+    point.positions.clear();
+    point.velocities.clear();
+    point.accelerations.clear();
+  }
+
+  for (const trajectory_msgs::msg::JointTrajectory& command : arm_commands_)
+  {
+    combined_command_.joint_names.insert(combined_command_.joint_names.end(), command.joint_names.begin(),
+                                         command.joint_names.end());
+    for (std::size_t i = 0; i < point_count; ++i)
+    {
+      const trajectory_msgs::msg::JointTrajectoryPoint& arm_point = command.points[i];
+      trajectory_msgs::msg::JointTrajectoryPoint& point = combined_command_.points[i];
+      point.positions.insert(point.positions.end(), arm_point.positions.begin(), arm_point.positions.end());
+      point.velocities.insert(point.velocities.end(), arm_point.velocities.begin(), arm_point.velocities.end());
+      point.accelerations.insert(point.accelerations.end(), arm_point.accelerations.begin(),
+                                 arm_point.accelerations.end());
+      point.time_from_start = arm_point.time_from_start;
+    }
+  }
+}
+
+}  // namespace moveit_servo
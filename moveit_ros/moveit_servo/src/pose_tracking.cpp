@@ -34,11 +34,13 @@
 
 #include "moveit_servo/pose_tracking.h"
 
+#include <algorithm>
+#include <functional>
+
 namespace
 {
 constexpr char LOGNAME[] = "pose_tracking";
-constexpr double DEFAULT_LOOP_RATE = 100;  // Hz
-constexpr double ROS_STARTUP_WAIT = 10;    // sec
+constexpr double ROS_STARTUP_WAIT = 10;  // sec
 }  // namespace
 
 namespace moveit_servo
@@ -47,7 +49,12 @@ PoseTracking::PoseTracking(const ros::NodeHandle& nh,
                            const planning_scene_monitor::PlanningSceneMonitorPtr& planning_scene_monitor)
   : nh_(nh)
   , planning_scene_monitor_(planning_scene_monitor)
-  , loop_rate_(DEFAULT_LOOP_RATE)
+  , publish_period_(0)
+  , motion_active_(false)
+  , motion_result_(PoseTrackingStatusCode::INVALID)
+  , positional_tolerance_(Eigen::Vector3d::Zero())
+  , angular_tolerance_(0)
+  , target_pose_commanded_(true)
   , transform_listener_(transform_buffer_)
   , stop_requested_(false)
   , angular_error_(0)
@@ -63,34 +70,30 @@ PoseTracking::PoseTracking(const ros::NodeHandle& nh,
   initializePID(z_pid_config_, cartesian_position_pids_);
   initializePID(angular_pid_config_, cartesian_orientation_pids_);
 
-  // Use the C++ interface that Servo provides
+  // Use the C++ interface that Servo provides. The PID controllers run in its cycles, so their commands skip the
+  // command topic and are computed from the state of the cycle that executes them.
   servo_ = std::make_unique<moveit_servo::Servo>(nh_, planning_scene_monitor_);
+  servo_->setCycleCallback(
+      std::bind(&PoseTracking::servoCycleCallback, this, std::placeholders::_1, std::placeholders::_2));
   servo_->start();
 
   // Connect to Servo ROS interfaces
   target_pose_sub_ =
       nh_.subscribe<geometry_msgs::PoseStamped>("target_pose", 1, &PoseTracking::targetPoseCallback, this);
-
-  // Publish outgoing twist commands to the Servo object
-  twist_stamped_pub_ =
-      nh_.advertise<geometry_msgs::TwistStamped>(servo_->getParameters().cartesian_command_in_topic, 1);
 }
 
 PoseTrackingStatusCode PoseTracking::moveToPose(const Eigen::Vector3d& positional_tolerance,
                                                 const double angular_tolerance, const double target_pose_timeout)
 {
-  // Wait a bit for a target pose message to arrive.
-  // The target pose may get updated by new messages as the robot moves (in a callback function).
-  const ros::Time start_time = ros::Time::now();
-  while ((!haveRecentTargetPose(target_pose_timeout) || !haveRecentEndEffectorPose(target_pose_timeout)) &&
-         ((ros::Time::now() - start_time).toSec() < target_pose_timeout))
-  {
-    if (servo_->getCommandFrameTransform(command_frame_transform_))
-    {
-      command_frame_transform_stamp_ = ros::Time::now();
-    }
-    ros::Duration(0.001).sleep();
-  }
+  std::unique_lock<std::mutex> lock(motion_mtx_);
+  const std::chrono::duration<double> timeout(target_pose_timeout);
+
+  // Wait a bit for a target pose message to arrive, and for a servo cycle to report the end effector pose.
+  // Both callbacks wake this thread up.
+  motion_cv_.wait_for(lock, timeout, [this, target_pose_timeout] {
+    return stop_requested_ ||
+           (haveRecentTargetPose(target_pose_timeout) && haveRecentEndEffectorPose(target_pose_timeout));
+  });
 
   if (!haveRecentTargetPose(target_pose_timeout))
   {
@@ -98,40 +101,72 @@ PoseTrackingStatusCode PoseTracking::moveToPose(const Eigen::Vector3d& positiona
     return PoseTrackingStatusCode::NO_RECENT_TARGET_POSE;
   }
 
-  // Continue sending PID controller output to Servo until one of the following conditions is met:
+  // The servo cycles send PID controller output to Servo until one of the following conditions is met:
   // - Goal tolerance is satisfied
-  // - Target pose becomes outdated
-  // - Command frame transform becomes outdated
+  // - Command frame transform becomes outdated, i.e. the servo cycles stopped
   // - Another thread requested a stop
-  while (ros::ok() && !satisfiesPoseTolerance(positional_tolerance, angular_tolerance))
+  positional_tolerance_ = positional_tolerance;
+  angular_tolerance_ = angular_tolerance;
+  motion_result_ = PoseTrackingStatusCode::INVALID;
+  motion_active_ = true;
+  while (motion_active_)
   {
-    // Attempt to update robot pose
-    if (servo_->getCommandFrameTransform(command_frame_transform_))
+    if (!ros::ok())
     {
-      command_frame_transform_stamp_ = ros::Time::now();
+      finishMotion(PoseTrackingStatusCode::STOP_REQUESTED);
+      break;
     }
-
-    // Check that end-effector pose (command frame transform) is recent enough.
     if (!haveRecentEndEffectorPose(target_pose_timeout))
     {
       ROS_ERROR_STREAM_NAMED(LOGNAME, "The end effector pose was not updated in time. Aborting.");
-      doPostMotionReset();
-      return PoseTrackingStatusCode::NO_RECENT_END_EFFECTOR_POSE;
+      finishMotion(PoseTrackingStatusCode::NO_RECENT_END_EFFECTOR_POSE);
+      break;
     }
+    motion_cv_.wait_for(lock, timeout);
+  }
+
+  const PoseTrackingStatusCode result = motion_result_;
+  doPostMotionReset();
+  return result;
+}
 
+bool PoseTracking::servoCycleCallback(const Eigen::Isometry3d& command_frame_transform,
+                                      geometry_msgs::msg::TwistStamped& command)
+{
+  const std::lock_guard<std::mutex> lock(motion_mtx_);
+  command_frame_transform_ = command_frame_transform;
+  command_frame_transform_stamp_ = ros::Time::now();
+
+  bool send_command = false;
+  if (motion_active_)
+  {
     if (stop_requested_)
     {
       ROS_INFO_STREAM_NAMED(LOGNAME, "Halting servo motion, a stop was requested.");
-      doPostMotionReset();
-      return PoseTrackingStatusCode::STOP_REQUESTED;
+      finishMotion(PoseTrackingStatusCode::STOP_REQUESTED);
+    }
+    else if (satisfiesPoseTolerance(positional_tolerance_, angular_tolerance_))
+    {
+      finishMotion(PoseTrackingStatusCode::SUCCESS);
+    }
+    else
+    {
+      // Compute servo command from PID controller output, Servo executes it in this cycle
+      calculateTwistCommand(command);
+      send_command = true;
     }
-
-    // Compute servo command from PID controller output and send it to the Servo object, for execution
-    twist_stamped_pub_.publish(calculateTwistCommand());
   }
 
-  doPostMotionReset();
-  return PoseTrackingStatusCode::SUCCESS;
+  // moveToPose() waits for a fresh end effector pose, too
+  motion_cv_.notify_all();
+  return send_command;
+}
+
+void PoseTracking::finishMotion(PoseTrackingStatusCode result)
+{
+  motion_result_ = result;
+  motion_active_ = false;
+  motion_cv_.notify_all();
 }
 
 void PoseTracking::readROSParams()
@@ -165,7 +200,7 @@ void PoseTracking::readROSParams()
 
   double publish_period;
   error += !rosparam_shortcuts::get(LOGNAME, nh, "publish_period", publish_period);
-  loop_rate_ = ros::Rate(1 / publish_period);
+  publish_period_ = publish_period;
 
   x_pid_config_.dt = publish_period;
   y_pid_config_.dt = publish_period;
@@ -227,47 +262,54 @@ bool PoseTracking::satisfiesPoseTolerance(const Eigen::Vector3d& positional_tole
 
 void PoseTracking::targetPoseCallback(const geometry_msgs::PoseStampedConstPtr& msg)
 {
-  std::lock_guard<std::mutex> lock(target_pose_mtx_);
-  target_pose_ = *msg;
-
-  // If the target pose is not defined in planning frame, transform the target pose.
-  if (target_pose_.header.frame_id != planning_frame_)
   {
-    try
-    {
-      geometry_msgs::TransformStamped target_to_planning_frame = transform_buffer_.lookupTransform(
-          planning_frame_, target_pose_.header.frame_id, ros::Time(0), ros::Duration(0.1));
-      tf2::doTransform(target_pose_, target_pose_, target_to_planning_frame);
-    }
-    catch (const tf2::TransformException& ex)
+    std::lock_guard<std::mutex> lock(target_pose_mtx_);
+    target_pose_ = *msg;
+    target_pose_arrival_ = std::chrono::steady_clock::now();
+    target_pose_commanded_ = false;
+
+    // If the target pose is not defined in planning frame, transform the target pose.
+    if (target_pose_.header.frame_id != planning_frame_)
     {
-      ROS_WARN_STREAM_NAMED(LOGNAME, ex.what());
-      return;
+      try
+      {
+        geometry_msgs::TransformStamped target_to_planning_frame = transform_buffer_.lookupTransform(
+            planning_frame_, target_pose_.header.frame_id, ros::Time(0), ros::Duration(0.1));
+        tf2::doTransform(target_pose_, target_pose_, target_to_planning_frame);
+      }
+      catch (const tf2::TransformException& ex)
+      {
+        ROS_WARN_STREAM_NAMED(LOGNAME, ex.what());
+        return;
+      }
     }
   }
+
+  // Wake up moveToPose() if it waits for a target. Taking the lock orders this after its check of the target pose.
+  {
+    std::lock_guard<std::mutex> lock(motion_mtx_);
+  }
+  motion_cv_.notify_all();
 }
 
-geometry_msgs::TwistStampedConstPtr PoseTracking::calculateTwistCommand()
+void PoseTracking::calculateTwistCommand(geometry_msgs::msg::TwistStamped& msg)
 {
-  // use the shared pool to create a message more efficiently
-  auto msg = moveit::util::make_shared_from_pool<geometry_msgs::TwistStamped>();
-
   // Get twist components from PID controllers
-  geometry_msgs::Twist& twist = msg->twist;
+  geometry_msgs::msg::Twist& twist = msg.twist;
   Eigen::Quaterniond q_desired;
 
   // Scope mutex locking only to operations which require access to target pose.
   {
     std::lock_guard<std::mutex> lock(target_pose_mtx_);
-    msg->header.frame_id = target_pose_.header.frame_id;
+    msg.header.frame_id = target_pose_.header.frame_id;
 
-    // Position
+    // Position. The controllers are updated exactly once per servo cycle, so the time step is the servo period.
     twist.linear.x = cartesian_position_pids_[0].computeCommand(
-        target_pose_.pose.position.x - command_frame_transform_.translation()(0), loop_rate_.expectedCycleTime());
+        target_pose_.pose.position.x - command_frame_transform_.translation()(0), publish_period_);
     twist.linear.y = cartesian_position_pids_[1].computeCommand(
-        target_pose_.pose.position.y - command_frame_transform_.translation()(1), loop_rate_.expectedCycleTime());
+        target_pose_.pose.position.y - command_frame_transform_.translation()(1), publish_period_);
     twist.linear.z = cartesian_position_pids_[2].computeCommand(
-        target_pose_.pose.position.z - command_frame_transform_.translation()(2), loop_rate_.expectedCycleTime());
+        target_pose_.pose.position.z - command_frame_transform_.translation()(2), publish_period_);
 
     // Orientation algorithm:
     // - Find the orientation error as a quaternion: q_error = q_desired * q_current ^ -1
@@ -275,6 +317,18 @@ geometry_msgs::TwistStampedConstPtr PoseTracking::calculateTwistCommand()
     // - Convert to angular velocity for the TwistStamped message
     q_desired = Eigen::Quaterniond(target_pose_.pose.orientation.w, target_pose_.pose.orientation.x,
                                    target_pose_.pose.orientation.y, target_pose_.pose.orientation.z);
+
+    // The first command toward a new target pose ends its latency
+    if (!target_pose_commanded_)
+    {
+      target_pose_commanded_ = true;
+      const double latency =
+          std::chrono::duration<double>(std::chrono::steady_clock::now() - target_pose_arrival_).count();
+      ++target_latency_.targets;
+      target_latency_.last_latency = latency;
+      target_latency_.mean_latency += (latency - target_latency_.mean_latency) / target_latency_.targets;
+      target_latency_.max_latency = std::max(target_latency_.max_latency, latency);
+    }
   }
 
   Eigen::Quaterniond q_current(command_frame_transform_.rotation());
@@ -284,15 +338,18 @@ geometry_msgs::TwistStampedConstPtr PoseTracking::calculateTwistCommand()
   Eigen::AngleAxisd axis_angle(q_error);
   // Cache the angular error, for rotation tolerance checking
   angular_error_ = axis_angle.angle();
-  double ang_vel_magnitude =
-      cartesian_orientation_pids_[0].computeCommand(angular_error_, loop_rate_.expectedCycleTime());
+  double ang_vel_magnitude = cartesian_orientation_pids_[0].computeCommand(angular_error_, publish_period_);
   twist.angular.x = ang_vel_magnitude * axis_angle.axis()[0];
   twist.angular.y = ang_vel_magnitude * axis_angle.axis()[1];
   twist.angular.z = ang_vel_magnitude * axis_angle.axis()[2];
 
-  msg->header.stamp = ros::Time::now();
+  msg.header.stamp = rclcpp::Clock().now();
+}
 
-  return msg;
+PoseTracking::TargetLatencyStatistics PoseTracking::getTargetLatencyStatistics() const
+{
+  std::lock_guard<std::mutex> lock(target_pose_mtx_);
+  return target_latency_;
 }
 
 void PoseTracking::doPostMotionReset()
@@ -314,7 +371,10 @@ void PoseTracking::updatePIDConfig(const double x_proportional_gain, const doubl
                                    const double z_derivative_gain, const double angular_proportional_gain,
                                    const double angular_integral_gain, const double angular_derivative_gain)
 {
-  stopMotion();
+  // Stop the motion and keep the servo cycles away from the controllers while they are replaced
+  std::lock_guard<std::mutex> lock(motion_mtx_);
+  if (motion_active_)
+    finishMotion(PoseTrackingStatusCode::STOP_REQUESTED);
 
   x_pid_config_.k_p = x_proportional_gain;
   x_pid_config_.k_i = x_integral_gain;
@@ -342,6 +402,7 @@ void PoseTracking::updatePIDConfig(const double x_proportional_gain, const doubl
 
 void PoseTracking::getPIDErrors(double& x_error, double& y_error, double& z_error, double& orientation_error)
 {
+  std::lock_guard<std::mutex> lock(motion_mtx_);
   double dummy1, dummy2;
   cartesian_position_pids_.at(0).getCurrentPIDErrors(&x_error, &dummy1, &dummy2);
   cartesian_position_pids_.at(1).getCurrentPIDErrors(&y_error, &dummy1, &dummy2);
@@ -74,11 +74,18 @@ void Servo::start()
 {
   setPaused(false);
 
+  // Check collisions in the servo loop, against immutable scene snapshots so the loop never waits for scene updates
+  if (parameters_->check_collisions && parameters_->collision_check_in_servo_loop)
+  {
+    planning_scene_monitor_->setSceneSnapshotsEnabled(true);
+    servo_calcs_->setCollisionChecker(collision_checker_.get());
+  }
+
   // Crunch the numbers in this timer
   servo_calcs_->start();
 
   // Check collisions in this timer
-  if (parameters_->check_collisions)
+  if (parameters_->check_collisions && !parameters_->collision_check_in_servo_loop)
     collision_checker_->start();
 }
 
@@ -37,8 +37,20 @@
  *      Author    : Brian O'Neil, Andy Zelenak, Blake Anderson
  */
 
+#include <algorithm>
+#include <array>
 #include <cassert>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <limits>
 
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+
+#include <Eigen/Cholesky>
+#include <Eigen/Eigenvalues>
 #include <std_msgs/msg/bool.h>
 
 // #include <moveit_servo/make_shared_from_pool.h> // TODO(adamp): create an issue about this
@@ -69,6 +81,28 @@ bool isNonZero(const control_msgs::msg::JointJog& msg)
   return !all_zeros;
 }
 
+// Helper function for the real-time loop: nanoseconds between two points of CLOCK_MONOTONIC
+int64_t monotonicDifference(const timespec& later, const timespec& earlier)
+{
+  return static_cast<int64_t>(later.tv_sec - earlier.tv_sec) * 1000000000 + (later.tv_nsec - earlier.tv_nsec);
+}
+
+// Helper function for the real-time loop: advance an absolute deadline by a period
+void addNanoseconds(timespec& time, int64_t nanoseconds)
+{
+  nanoseconds += time.tv_nsec;
+  time.tv_sec += nanoseconds / 1000000000;
+  time.tv_nsec = nanoseconds % 1000000000;
+}
+
+// Helper function for the real-time loop statistics, there is no atomic fetch_max for doubles
+void updateMaximum(std::atomic<double>& maximum, double value)
+{
+  double previous = maximum.load(std::memory_order_relaxed);
+  while (previous < value && !maximum.compare_exchange_weak(previous, value, std::memory_order_relaxed))
+    ;
+}
+
 // Helper function for converting Eigen::Isometry3d to geometry_msgs/TransformStamped
 geometry_msgs::msg::TransformStamped convertIsometryToTransform(const Eigen::Isometry3d& eigen_tf,
                                                                 const std::string& parent_frame,
@@ -84,7 +118,8 @@ geometry_msgs::msg::TransformStamped convertIsometryToTransform(const Eigen::Iso
 
 // Constructor for the class that handles servoing calculations
 ServoCalcs::ServoCalcs(rclcpp::Node::SharedPtr node, const ServoParametersPtr& parameters,
-                       const planning_scene_monitor::PlanningSceneMonitorPtr& planning_scene_monitor)
+                       const planning_scene_monitor::PlanningSceneMonitorPtr& planning_scene_monitor,
+                       const std::string& topic_prefix)
   : node_(node)
   , parameters_(parameters)
   , planning_scene_monitor_(planning_scene_monitor)
@@ -106,22 +141,24 @@ ServoCalcs::ServoCalcs(rclcpp::Node::SharedPtr node, const ServoParametersPtr& p
 
   // ROS Server for allowing drift in some dimensions
   drift_dimensions_server_ = node_->create_service<moveit_msgs::srv::ChangeDriftDimensions>(
-      "~/change_drift_dimensions", std::bind(&ServoCalcs::changeDriftDimensions, this, _1, _2));
+      topic_prefix + "change_drift_dimensions", std::bind(&ServoCalcs::changeDriftDimensions, this, _1, _2));
 
   // ROS Server for changing the control dimensions
   control_dimensions_server_ = node_->create_service<moveit_msgs::srv::ChangeControlDimensions>(
-      "~/change_control_dimensions", std::bind(&ServoCalcs::changeControlDimensions, this, _1, _2));
+      topic_prefix + "change_control_dimensions", std::bind(&ServoCalcs::changeControlDimensions, this, _1, _2));
 
   // ROS Server to reset the status, e.g. so the arm can move again after a collision
   reset_servo_status_ = node_->create_service<std_srvs::srv::Empty>(
-      "~/reset_servo_status", std::bind(&ServoCalcs::resetServoStatus, this, _1, _2));
+      topic_prefix + "reset_servo_status", std::bind(&ServoCalcs::resetServoStatus, this, _1, _2));
 
   // Subscribe to the collision_check topic
   collision_velocity_scale_sub_ = node_->create_subscription<std_msgs::msg::Float64>(
-      "~/collision_velocity_scale", ROS_QUEUE_SIZE, std::bind(&ServoCalcs::collisionVelocityScaleCB, this, _1));
+      topic_prefix + "collision_velocity_scale", ROS_QUEUE_SIZE,
+      std::bind(&ServoCalcs::collisionVelocityScaleCB, this, _1));
 
   // Publish to collision_check for worst stop time
-  worst_case_stop_time_pub_ = node_->create_publisher<std_msgs::msg::Float64>("~/worst_case_stop_time", ROS_QUEUE_SIZE);
+  worst_case_stop_time_pub_ =
+      node_->create_publisher<std_msgs::msg::Float64>(topic_prefix + "worst_case_stop_time", ROS_QUEUE_SIZE);
 
   // Publish freshly-calculated joints to the robot.
   // Put the outgoing msg in the right format (trajectory_msgs/JointTrajectory or std_msgs/Float64MultiArray).
@@ -148,11 +185,12 @@ ServoCalcs::ServoCalcs(rclcpp::Node::SharedPtr node, const ServoParametersPtr& p
   {
     // A map for the indices of incoming joint commands
     joint_state_name_map_[internal_joint_state_.name[i]] = i;
-
-    // Low-pass filters for the joint positions
-    position_filters_.emplace_back(parameters_->low_pass_filter_coeff);
   }
 
+  // Low-pass filter for the joint positions
+  setSmoothingFilter(std::make_unique<ButterworthJointFilter>(parameters_->low_pass_filter_coeff,
+                                                              parameters_->low_pass_filter_order));
+
   // A matrix of all zeros is used to check whether matrices have been initialized
   Eigen::Matrix3d empty_matrix;
   empty_matrix.setZero();
@@ -160,7 +198,28 @@ ServoCalcs::ServoCalcs(rclcpp::Node::SharedPtr node, const ServoParametersPtr& p
   tf_moveit_to_robot_cmd_frame_ = empty_matrix;
 }
 
-void ServoCalcs::start()
+ServoCalcs::~ServoCalcs()
+{
+  if (timer_)
+    timer_->cancel();
+
+  if (loop_thread_.joinable())
+  {
+    stop_loop_ = true;
+    loop_thread_.join();
+
+    const LoopStatistics statistics = getLoopStatistics();
+    RCLCPP_INFO_STREAM(LOGGER, "Real-time loop ran " << statistics.cycles << " cycles with " << statistics.overruns
+                                                     << " overruns. Wake-up latency mean/max: "
+                                                     << statistics.mean_wakeup_latency * 1e6 << "/"
+                                                     << statistics.max_wakeup_latency * 1e6
+                                                     << " us, cycle time mean/max: "
+                                                     << statistics.mean_cycle_time * 1e6 << "/"
+                                                     << statistics.max_cycle_time * 1e6 << " us");
+  }
+}
+
+void ServoCalcs::start(bool start_loop)
 {
   // Set up the "last" published message, in case we need to send it first
   auto initial_joint_trajectory = std::make_unique<trajectory_msgs::msg::JointTrajectory>();
@@ -188,22 +247,128 @@ void ServoCalcs::start()
   initial_joint_trajectory->points.push_back(point);
   last_sent_command_ = std::move(initial_joint_trajectory);
 
-  // Set up timer for calculation callback
-  timer_ = node_->create_wall_timer(std::chrono::duration<double>(period_), std::bind(&ServoCalcs::run, this));
+  // Size the outgoing messages up front, so the first cycles do not allocate either
+  joint_trajectory_ = *last_sent_command_;
+  multiarray_msg_.data.reserve(num_joints_);
 
   current_state_ = planning_scene_monitor_->getStateMonitor()->getCurrentState();
   tf_moveit_to_ee_frame_ = current_state_->getGlobalLinkTransform(parameters_->planning_frame).inverse() *
                            current_state_->getGlobalLinkTransform(parameters_->ee_frame_name);
   tf_moveit_to_robot_cmd_frame_ = current_state_->getGlobalLinkTransform(parameters_->planning_frame).inverse() *
                                   current_state_->getGlobalLinkTransform(parameters_->robot_link_command_frame);
+
+  // Set up timer (or thread) for calculation callback
+  if (!start_loop)
+    return;
+  if (parameters_->use_realtime_loop)
+  {
+    stop_loop_ = false;
+    loop_thread_ = std::thread(&ServoCalcs::realtimeLoop, this);
+  }
+  else
+    timer_ = node_->create_wall_timer(std::chrono::duration<double>(period_), std::bind(&ServoCalcs::run, this));
+}
+
+void ServoCalcs::realtimeLoop()
+{
+  if (parameters_->realtime_priority > 0)
+  {
+    sched_param param;
+    param.sched_priority = parameters_->realtime_priority;
+    const int result = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+    if (result != 0)
+      RCLCPP_WARN_STREAM(LOGGER, "Could not switch the servo loop to SCHED_FIFO priority "
+                                     << parameters_->realtime_priority << ": " << std::strerror(result)
+                                     << ". Running with the default scheduler. Is the rtprio limit raised?");
+  }
+
+  const int64_t period = static_cast<int64_t>(period_ * 1e9);
+  timespec deadline;
+  clock_gettime(CLOCK_MONOTONIC, &deadline);
+  addNanoseconds(deadline, period);
+
+  while (!stop_loop_ && rclcpp::ok())
+  {
+    // Sleep until an absolute deadline, so the time spent in run() does not accumulate into drift
+    int result;
+    do
+      result = clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, nullptr);
+    while (result == EINTR);
+
+    timespec wakeup;
+    clock_gettime(CLOCK_MONOTONIC, &wakeup);
+
+    run();
+
+    timespec done;
+    clock_gettime(CLOCK_MONOTONIC, &done);
+
+    const double wakeup_latency = monotonicDifference(wakeup, deadline) * 1e-9;
+    const double cycle_time = monotonicDifference(done, wakeup) * 1e-9;
+    loop_cycles_.fetch_add(1, std::memory_order_relaxed);
+    loop_wakeup_latency_sum_.store(loop_wakeup_latency_sum_.load(std::memory_order_relaxed) + wakeup_latency,
+                                   std::memory_order_relaxed);
+    loop_cycle_time_sum_.store(loop_cycle_time_sum_.load(std::memory_order_relaxed) + cycle_time,
+                               std::memory_order_relaxed);
+    updateMaximum(loop_wakeup_latency_max_, wakeup_latency);
+    updateMaximum(loop_cycle_time_max_, cycle_time);
+
+    addNanoseconds(deadline, period);
+
+    // If this cycle ran past the next deadline, skip the missed cycles instead of running them back to back
+    if (monotonicDifference(done, deadline) > 0)
+    {
+      loop_overruns_.fetch_add(1, std::memory_order_relaxed);
+      const int64_t missed = monotonicDifference(done, deadline) / period + 1;
+      addNanoseconds(deadline, missed * period);
+      rclcpp::Clock& clock = *node_->get_clock();
+      RCLCPP_WARN_STREAM_THROTTLE(LOGGER, clock, ROS_LOG_THROTTLE_PERIOD,
+                                  "Servo loop overran its period of " << period_ << " s, took " << cycle_time << " s");
+    }
+  }
+}
+
+ServoCalcs::LoopStatistics ServoCalcs::getLoopStatistics() const
+{
+  LoopStatistics statistics;
+  statistics.cycles = loop_cycles_.load(std::memory_order_relaxed);
+  statistics.overruns = loop_overruns_.load(std::memory_order_relaxed);
+  statistics.max_wakeup_latency = loop_wakeup_latency_max_.load(std::memory_order_relaxed);
+  statistics.max_cycle_time = loop_cycle_time_max_.load(std::memory_order_relaxed);
+  if (statistics.cycles > 0)
+  {
+    statistics.mean_wakeup_latency = loop_wakeup_latency_sum_.load(std::memory_order_relaxed) / statistics.cycles;
+    statistics.mean_cycle_time = loop_cycle_time_sum_.load(std::memory_order_relaxed) / statistics.cycles;
+  }
+  return statistics;
+}
+
+bool ServoCalcs::runCycle(const moveit::core::RobotStatePtr& state, double collision_velocity_scale,
+                          trajectory_msgs::msg::JointTrajectory& command)
+{
+  cycle_state_ = state;
+  cycle_command_ = &command;
+  cycle_command_produced_ = false;
+  collision_velocity_scale_ = collision_velocity_scale;
+
+  run();
+
+  if (!cycle_command_produced_)
+  {
+    command = *last_sent_command_;
+    for (auto& point : command.points)
+      point.velocities.assign(point.velocities.size(), 0);
+  }
+  cycle_state_.reset();
+  cycle_command_ = nullptr;
+  return cycle_command_produced_;
 }
 
 void ServoCalcs::run()
 {
   // Publish status each loop iteration
-  auto status_msg = std::make_unique<std_msgs::msg::Int8>();
-  status_msg->data = static_cast<int8_t>(status_);
-  status_pub_->publish(std::move(status_msg));
+  status_msg_.data = static_cast<int8_t>(status_.load());
+  status_pub_->publish(status_msg_);
 
   // After we publish, status, reset it back to no warnings
   status_ = StatusCode::NO_WARNING;
@@ -214,27 +379,12 @@ void ServoCalcs::run()
   updateJoints();
 
   // Calculate and publish worst stop time for collision checker
-  if (parameters_->check_collisions && parameters_->collision_check_type == "stop_distance")
+  if (parameters_->check_collisions &&
+      (parameters_->collision_check_type == "stop_distance" || parameters_->collision_check_type == "predictive"))
     calculateWorstCaseStopTime();
 
   // Update from latest state
-  current_state_ = planning_scene_monitor_->getStateMonitor()->getCurrentState();
-  {
-    const std::lock_guard<std::mutex> lock(latest_state_mutex_);
-    if (latest_twist_stamped_)
-      twist_stamped_cmd_ = *latest_twist_stamped_;
-    if (latest_joint_cmd_)
-      joint_servo_cmd_ = *latest_joint_cmd_;
-
-    // Check for stale cmds
-    twist_command_is_stale_ = ((node_->now() - latest_twist_command_stamp_) >=
-                               rclcpp::Duration::from_seconds(parameters_->incoming_command_timeout));
-    joint_command_is_stale_ = ((node_->now() - latest_joint_command_stamp_) >=
-                               rclcpp::Duration::from_seconds(parameters_->incoming_command_timeout));
-
-    have_nonzero_twist_stamped_ = latest_nonzero_twist_stamped_;
-    have_nonzero_joint_command_ = latest_nonzero_joint_cmd_;
-  }
+  current_state_ = cycle_state_ ? cycle_state_ : planning_scene_monitor_->getStateMonitor()->getCurrentState();
 
   // Get the transform from MoveIt planning frame to servoing command frame
   // Calculate this transform to ensure it is available via C++ API
@@ -248,6 +398,37 @@ void ServoCalcs::run()
   tf_moveit_to_ee_frame_ = current_state_->getGlobalLinkTransform(parameters_->planning_frame).inverse() *
                            current_state_->getGlobalLinkTransform(parameters_->ee_frame_name);
 
+  {
+    const auto& latest_twist_command = latest_twist_command_.read();
+    const auto& latest_joint_command = latest_joint_command_.read();
+    if (latest_twist_command.has_msg)
+      twist_stamped_cmd_ = latest_twist_command.msg;
+    if (latest_joint_command.has_msg)
+      joint_servo_cmd_ = latest_joint_command.msg;
+
+    // Check for stale cmds
+    const rclcpp::Time now = node_->now();
+    twist_command_is_stale_ = ((now - latest_twist_command.stamp) >=
+                               rclcpp::Duration::from_seconds(parameters_->incoming_command_timeout));
+    joint_command_is_stale_ = ((now - latest_joint_command.stamp) >=
+                               rclcpp::Duration::from_seconds(parameters_->incoming_command_timeout));
+
+    have_nonzero_twist_stamped_ = latest_twist_command.nonzero;
+    have_nonzero_joint_command_ = latest_joint_command.nonzero;
+  }
+
+  // Apply dimension changes requested through the services
+  drift_dimensions_ = requested_drift_dimensions_.read();
+  control_dimensions_ = requested_control_dimensions_.read();
+
+  // A command computed for exactly this cycle takes the place of the latest one from the topic
+  if (cycle_callback_ && cycle_callback_(tf_moveit_to_robot_cmd_frame_, cycle_callback_command_))
+  {
+    twist_stamped_cmd_ = cycle_callback_command_;
+    twist_command_is_stale_ = false;
+    have_nonzero_twist_stamped_ = isNonZero(cycle_callback_command_);
+  }
+
   have_nonzero_command_ = have_nonzero_twist_stamped_ || have_nonzero_joint_command_;
 
   // Don't end this function without updating the filters
@@ -267,16 +448,25 @@ void ServoCalcs::run()
     return;
   }
 
+  // Check collisions of exactly the state the servo step below starts from, before the singularity look-ahead
+  // modifies current_state_
+  if (collision_checker_ && (collision_check_cycle_++ % collision_check_cycle_divider_ == 0))
+  {
+    const planning_scene::PlanningSceneConstPtr scene = planning_scene_monitor_->getPlanningSceneSnapshot();
+    if (scene)
+      collision_velocity_scale_ = collision_checker_->checkState(current_state_, *scene);
+  }
+
   // If not waiting for initial command, and not paused.
   // Do servoing calculations only if the robot should move, for efficiency
-  // Create new outgoing joint trajectory command message
-  auto joint_trajectory = std::make_unique<trajectory_msgs::msg::JointTrajectory>();
+  // Fill the outgoing joint trajectory command message in place
+  trajectory_msgs::msg::JointTrajectory& joint_trajectory = joint_trajectory_;
 
   // Prioritize cartesian servoing above joint servoing
   // Only run commands if not stale and nonzero
   if (have_nonzero_twist_stamped_ && !twist_command_is_stale_)
   {
-    if (!cartesianServoCalcs(twist_stamped_cmd_, *joint_trajectory))
+    if (!cartesianServoCalcs(twist_stamped_cmd_, joint_trajectory))
     {
       resetLowPassFilters(original_joint_state_);
       return;
@@ -284,7 +474,7 @@ void ServoCalcs::run()
   }
   else if (have_nonzero_joint_command_ && !joint_command_is_stale_)
   {
-    if (!jointServoCalcs(joint_servo_cmd_, *joint_trajectory))
+    if (!jointServoCalcs(joint_servo_cmd_, joint_trajectory))
     {
       resetLowPassFilters(original_joint_state_);
       return;
@@ -293,8 +483,8 @@ void ServoCalcs::run()
   else
   {
     // Joint trajectory is not populated with anything, so set it to the last positions and 0 velocity
-    *joint_trajectory = *last_sent_command_;
-    for (auto& point : joint_trajectory->points)
+    joint_trajectory = *last_sent_command_;
+    for (auto& point : joint_trajectory.points)
     {
       point.velocities.assign(point.velocities.size(), 0);
     }
@@ -311,7 +501,7 @@ void ServoCalcs::run()
   // If we should halt
   if (!have_nonzero_command_)
   {
-    suddenHalt(*joint_trajectory);
+    suddenHalt(joint_trajectory);
     have_nonzero_twist_stamped_ = false;
     have_nonzero_joint_command_ = false;
   }
@@ -343,7 +533,15 @@ void ServoCalcs::run()
     zero_velocity_count_ = 0;
   }
 
-  if (ok_to_publish_ && !paused_)
+  if (ok_to_publish_ && !paused_ && cycle_command_)
+  {
+    // The caller of runCycle() sends the command
+    joint_trajectory.header.stamp = rclcpp::Time(0);
+    *last_sent_command_ = joint_trajectory;
+    *cycle_command_ = joint_trajectory;
+    cycle_command_produced_ = true;
+  }
+  else if (ok_to_publish_ && !paused_)
   {
     // Put the outgoing msg in the right format
     // (trajectory_msgs/JointTrajectory or std_msgs/Float64MultiArray).
@@ -351,19 +549,19 @@ void ServoCalcs::run()
     {
       // When a joint_trajectory_controller receives a new command, a stamp of 0 indicates "begin immediately"
       // See http://wiki.ros.org/joint_trajectory_controller#Trajectory_replacement
-      joint_trajectory->header.stamp = rclcpp::Time(0);
-      *last_sent_command_ = *joint_trajectory;
-      trajectory_outgoing_cmd_pub_->publish(std::move(joint_trajectory));
+      joint_trajectory.header.stamp = rclcpp::Time(0);
+      *last_sent_command_ = joint_trajectory;
+      trajectory_outgoing_cmd_pub_->publish(joint_trajectory);
     }
     else if (parameters_->command_out_type == "std_msgs/Float64MultiArray")
     {
-      auto joints = std::make_unique<std_msgs::msg::Float64MultiArray>();
-      if (parameters_->publish_joint_positions && !joint_trajectory->points.empty())
-        joints->data = joint_trajectory->points[0].positions;
-      else if (parameters_->publish_joint_velocities && !joint_trajectory->points.empty())
-        joints->data = joint_trajectory->points[0].velocities;
-      *last_sent_command_ = *joint_trajectory;
-      multiarray_outgoing_cmd_pub_->publish(std::move(joints));
+      multiarray_msg_.data.clear();
+      if (parameters_->publish_joint_positions && !joint_trajectory.points.empty())
+        multiarray_msg_.data = joint_trajectory.points[0].positions;
+      else if (parameters_->publish_joint_velocities && !joint_trajectory.points.empty())
+        multiarray_msg_.data = joint_trajectory.points[0].velocities;
+      *last_sent_command_ = joint_trajectory;
+      multiarray_outgoing_cmd_pub_->publish(multiarray_msg_);
     }
   }
 
@@ -425,18 +623,27 @@ bool ServoCalcs::cartesianServoCalcs(geometry_msgs::msg::TwistStamped& cmd,
 
   Eigen::VectorXd delta_x = scaleCartesianCommand(cmd);
 
-  // Convert from cartesian commands to joint commands
-  Eigen::MatrixXd jacobian = current_state_->getJacobian(joint_model_group_);
+  // Convert from cartesian commands to joint commands.
+  // The Jacobian, SVD and pseudo-inverse reuse their storage from the previous cycle.
+  current_state_->updateLinkTransforms();
+  if (!current_state_->getJacobian(joint_model_group_, joint_model_group_->getLinkModels().back(),
+                                   Eigen::Vector3d::Zero(), jacobian_))
+    return false;
 
-  removeDriftDimensions(jacobian, delta_x);
+  if (parameters_->use_damped_least_squares)
+  {
+    dampedLeastSquaresCalcs(delta_x);
+    return internalServoUpdate(delta_theta_, joint_trajectory);
+  }
 
-  Eigen::JacobiSVD<Eigen::MatrixXd> svd =
-      Eigen::JacobiSVD<Eigen::MatrixXd>(jacobian, Eigen::ComputeThinU | Eigen::ComputeThinV);
-  Eigen::MatrixXd matrix_s = svd.singularValues().asDiagonal();
-  Eigen::MatrixXd pseudo_inverse = svd.matrixV() * matrix_s.inverse() * svd.matrixU().transpose();
+  removeDriftDimensions(jacobian_, delta_x);
 
-  delta_theta_ = pseudo_inverse * delta_x;
-  delta_theta_ *= velocityScalingFactorForSingularity(delta_x, svd, pseudo_inverse);
+  svd_.compute(jacobian_, Eigen::ComputeThinU | Eigen::ComputeThinV);
+  pseudo_inverse_.noalias() =
+      svd_.matrixV() * svd_.singularValues().cwiseInverse().asDiagonal() * svd_.matrixU().transpose();
+
+  delta_theta_ = pseudo_inverse_ * delta_x;
+  delta_theta_ *= velocityScalingFactorForSingularity(delta_x, svd_, pseudo_inverse_);
 
   return internalServoUpdate(delta_theta_, joint_trajectory);
 }
@@ -470,7 +677,7 @@ bool ServoCalcs::internalServoUpdate(Eigen::ArrayXd& delta_theta,
   {
     status_ = StatusCode::DECELERATE_FOR_COLLISION;
     rclcpp::Clock& clock = *node_->get_clock();
-    RCLCPP_WARN_STREAM_THROTTLE(LOGGER, clock, ROS_LOG_THROTTLE_PERIOD, SERVO_STATUS_CODE_MAP.at(status_));
+    RCLCPP_WARN_STREAM_THROTTLE(LOGGER, clock, ROS_LOG_THROTTLE_PERIOD, SERVO_STATUS_CODE_MAP.at(status_.load()));
   }
   else if (collision_scale == 0)
   {
@@ -521,14 +728,20 @@ bool ServoCalcs::applyJointUpdate(const Eigen::ArrayXd& delta_theta, sensor_msgs
     return false;
   }
 
-  for (std::size_t i = 0; i < joint_state.position.size(); ++i)
+  Eigen::Map<Eigen::VectorXd> positions(joint_state.position.data(), joint_state.position.size());
+  if (position_filter_->size() != joint_state.position.size())
   {
-    // Increment joint
-    joint_state.position[i] += delta_theta[i];
+    // Only reallocates if the joints differ from the ones the filter was set up for
+    position_filter_->initialize(joint_state.position.size());
+    position_filter_->reset(positions);
+  }
 
-    // Lowpass filter position
-    joint_state.position[i] = position_filters_[i].filter(joint_state.position[i]);
+  // Increment joints and lowpass filter the positions of all joints at once
+  positions += delta_theta.matrix();
+  position_filter_->filter(positions);
 
+  for (std::size_t i = 0; i < joint_state.position.size(); ++i)
+  {
     // Calculate joint velocity
     joint_state.velocity[i] = delta_theta[i] / parameters_->publish_period;
 
@@ -547,21 +760,18 @@ void ServoCalcs::insertRedundantPointsIntoTrajectory(trajectory_msgs::msg::Joint
   if (count < 2)
     return;
   joint_trajectory.points.resize(count);
-  auto point = joint_trajectory.points[0];
   // Start from 2 because we already have the first point. End at count+1 so (total #) == count
   for (int i = 2; i < count; ++i)
   {
-    point.time_from_start = rclcpp::Duration(i * parameters_->publish_period);
-    joint_trajectory.points[i] = point;
+    joint_trajectory.points[i] = joint_trajectory.points[0];
+    joint_trajectory.points[i].time_from_start = rclcpp::Duration(i * parameters_->publish_period);
   }
 }
 
 void ServoCalcs::resetLowPassFilters(const sensor_msgs::msg::JointState& joint_state)
 {
-  for (std::size_t i = 0; i < position_filters_.size(); ++i)
-  {
-    position_filters_[i].reset(joint_state.position[i]);
-  }
+  position_filter_->reset(
+      Eigen::Map<const Eigen::VectorXd>(joint_state.position.data(), joint_state.position.size()));
 
   updated_filters_ = true;
 }
@@ -575,21 +785,28 @@ void ServoCalcs::composeJointTrajMessage(const sensor_msgs::msg::JointState& joi
   joint_trajectory.header.frame_id = parameters_->planning_frame;
   joint_trajectory.joint_names = joint_state.name;
 
-  trajectory_msgs::msg::JointTrajectoryPoint point;
+  // Overwrite the single point in place, keeping the storage of the previous cycle
+  joint_trajectory.points.resize(1);
+  trajectory_msgs::msg::JointTrajectoryPoint& point = joint_trajectory.points.front();
   point.time_from_start = rclcpp::Duration(parameters_->publish_period);
   if (parameters_->publish_joint_positions)
     point.positions = joint_state.position;
+  else
+    point.positions.clear();
   if (parameters_->publish_joint_velocities)
     point.velocities = joint_state.velocity;
+  else
+    point.velocities.clear();
   if (parameters_->publish_joint_accelerations)
   {
     // I do not know of a robot that takes acceleration commands.
     // However, some controllers check that this data is non-empty.
     // Send all zeros, for now.
-    std::vector<double> acceleration(num_joints_);
-    point.accelerations = acceleration;
+    point.accelerations.assign(num_joints_, 0.0);
   }
-  joint_trajectory.points.push_back(point);
+  else
+    point.accelerations.clear();
+  point.effort.clear();
 }
 
 // Possibly calculate a velocity scaling factor, due to proximity of singularity and direction of motion
@@ -597,7 +814,6 @@ double ServoCalcs::velocityScalingFactorForSingularity(const Eigen::VectorXd& co
                                                        const Eigen::JacobiSVD<Eigen::MatrixXd>& svd,
                                                        const Eigen::MatrixXd& pseudo_inverse)
 {
-  double velocity_scale = 1;
   std::size_t num_dimensions = commanded_velocity.size();
 
   // Find the direction away from nearest singularity.
@@ -617,14 +833,16 @@ double ServoCalcs::velocityScalingFactorForSingularity(const Eigen::VectorXd& co
   delta_x = vector_toward_singularity / scale;
 
   // Calculate a small change in joints
-  Eigen::VectorXd new_theta;
-  current_state_->copyJointGroupPositions(joint_model_group_, new_theta);
-  new_theta += pseudo_inverse * delta_x;
-  current_state_->setJointGroupPositions(joint_model_group_, new_theta);
-  Eigen::MatrixXd new_jacobian = current_state_->getJacobian(joint_model_group_);
-
-  Eigen::JacobiSVD<Eigen::MatrixXd> new_svd(new_jacobian);
-  double new_condition = new_svd.singularValues()(0) / new_svd.singularValues()(new_svd.singularValues().size() - 1);
+  current_state_->copyJointGroupPositions(joint_model_group_, new_theta_);
+  new_theta_ += pseudo_inverse * delta_x;
+  current_state_->setJointGroupPositions(joint_model_group_, new_theta_);
+  current_state_->updateLinkTransforms();
+  current_state_->getJacobian(joint_model_group_, joint_model_group_->getLinkModels().back(), Eigen::Vector3d::Zero(),
+                              new_jacobian_);
+
+  new_svd_.compute(new_jacobian_);
+  double new_condition =
+      new_svd_.singularValues()(0) / new_svd_.singularValues()(new_svd_.singularValues().size() - 1);
   // If new_condition < ini_condition, the singular vector does point towards a
   // singularity. Otherwise, flip its direction.
   if (ini_condition >= new_condition)
@@ -634,6 +852,14 @@ double ServoCalcs::velocityScalingFactorForSingularity(const Eigen::VectorXd& co
 
   // If this dot product is positive, we're moving toward singularity ==> decelerate
   double dot = vector_toward_singularity.dot(commanded_velocity);
+  return velocityScalingFactorForCondition(ini_condition, dot);
+}
+
+double ServoCalcs::velocityScalingFactorForCondition(double ini_condition, double dot)
+{
+  jacobian_condition_number_.store(ini_condition, std::memory_order_relaxed);
+
+  double velocity_scale = 1;
   if (dot > 0)
   {
     // Ramp velocity down linearly when the Jacobian condition is between lower_singularity_threshold and
@@ -646,7 +872,7 @@ double ServoCalcs::velocityScalingFactorForSingularity(const Eigen::VectorXd& co
                    (parameters_->hard_stop_singularity_threshold - parameters_->lower_singularity_threshold);
       status_ = StatusCode::DECELERATE_FOR_SINGULARITY;
       rclcpp::Clock& clock = *node_->get_clock();
-      RCLCPP_WARN_STREAM_THROTTLE(LOGGER, clock, ROS_LOG_THROTTLE_PERIOD, SERVO_STATUS_CODE_MAP.at(status_));
+      RCLCPP_WARN_STREAM_THROTTLE(LOGGER, clock, ROS_LOG_THROTTLE_PERIOD, SERVO_STATUS_CODE_MAP.at(status_.load()));
     }
 
     // Very close to singularity, so halt.
@@ -655,13 +881,94 @@ double ServoCalcs::velocityScalingFactorForSingularity(const Eigen::VectorXd& co
       velocity_scale = 0;
       status_ = StatusCode::HALT_FOR_SINGULARITY;
       rclcpp::Clock& clock = *node_->get_clock();
-      RCLCPP_WARN_STREAM_THROTTLE(LOGGER, clock, ROS_LOG_THROTTLE_PERIOD, SERVO_STATUS_CODE_MAP.at(status_));
+      RCLCPP_WARN_STREAM_THROTTLE(LOGGER, clock, ROS_LOG_THROTTLE_PERIOD, SERVO_STATUS_CODE_MAP.at(status_.load()));
     }
   }
 
   return velocity_scale;
 }
 
+void ServoCalcs::dampedLeastSquaresCalcs(const Eigen::VectorXd& delta_x)
+{
+  // The rows of the dimensions that may not drift. Like removeDriftDimensions(), always keep at least one.
+  std::array<Eigen::Index, 6> rows;
+  Eigen::Index num_rows = 0;
+  for (Eigen::Index dimension = 0; dimension < 6; ++dimension)
+  {
+    if (!drift_dimensions_[dimension])
+      rows[num_rows++] = dimension;
+  }
+  if (num_rows == 0)
+    rows[num_rows++] = 0;
+
+  // Everything below works on J * J^T, which has at most 6x6 entries no matter how many joints the group has
+  Eigen::Matrix<double, 6, 6> full_jjt;
+  full_jjt.noalias() = jacobian_ * jacobian_.transpose();
+
+  CartesianMatrix jjt(num_rows, num_rows);
+  CartesianVector reduced_delta_x(num_rows);
+  for (Eigen::Index i = 0; i < num_rows; ++i)
+  {
+    reduced_delta_x(i) = delta_x(rows[i]);
+    for (Eigen::Index j = 0; j < num_rows; ++j)
+      jjt(i, j) = full_jjt(rows[i], rows[j]);
+  }
+
+  CartesianMatrix damped_jjt = jjt;
+  damped_jjt.diagonal().array() += parameters_->damping_factor * parameters_->damping_factor;
+  const Eigen::LLT<CartesianMatrix> llt(damped_jjt);
+
+  // Map a Cartesian step on the kept rows to joints: delta_theta = J^T (J J^T + damping^2 I)^-1 delta_x
+  Eigen::Matrix<double, 6, 1> cartesian_step;
+  const auto solve = [&](const CartesianVector& reduced_step, Eigen::VectorXd& joint_step) {
+    const CartesianVector y = llt.solve(reduced_step);
+    cartesian_step.setZero();
+    for (Eigen::Index i = 0; i < num_rows; ++i)
+      cartesian_step(rows[i]) = y(i);
+    joint_step.resize(jacobian_.cols());
+    joint_step.noalias() = jacobian_.transpose() * cartesian_step;
+  };
+  solve(reduced_delta_x, joint_step_);
+  delta_theta_ = joint_step_.array();
+
+  // The eigenvectors of J * J^T are the left singular vectors of J and its eigenvalues the squared singular values,
+  // so the singularity metric comes out of the same small matrix. Eigenvalues are sorted in increasing order.
+  const Eigen::SelfAdjointEigenSolver<CartesianMatrix> eigen_solver(jjt);
+  const auto condition = [num_rows](const CartesianVector& eigenvalues) {
+    return eigenvalues(0) > 0 ? std::sqrt(eigenvalues(num_rows - 1) / eigenvalues(0)) :
+                                std::numeric_limits<double>::infinity();
+  };
+  const double ini_condition = condition(eigen_solver.eigenvalues());
+  CartesianVector vector_toward_singularity = eigen_solver.eigenvectors().col(0);
+
+  // The direction of the singular vector is ambiguous, see velocityScalingFactorForSingularity().
+  // Look ahead with a small step along it and flip it if the condition does not increase.
+  solve(vector_toward_singularity / 100, joint_step_);
+  current_state_->copyJointGroupPositions(joint_model_group_, new_theta_);
+  new_theta_ += joint_step_;
+  current_state_->setJointGroupPositions(joint_model_group_, new_theta_);
+  current_state_->updateLinkTransforms();
+  current_state_->getJacobian(joint_model_group_, joint_model_group_->getLinkModels().back(), Eigen::Vector3d::Zero(),
+                              new_jacobian_);
+
+  full_jjt.noalias() = new_jacobian_ * new_jacobian_.transpose();
+  for (Eigen::Index i = 0; i < num_rows; ++i)
+  {
+    for (Eigen::Index j = 0; j < num_rows; ++j)
+      jjt(i, j) = full_jjt(rows[i], rows[j]);
+  }
+  const Eigen::SelfAdjointEigenSolver<CartesianMatrix> new_eigen_solver(jjt, Eigen::EigenvaluesOnly);
+  if (ini_condition >= condition(new_eigen_solver.eigenvalues()))
+    vector_toward_singularity *= -1;
+
+  delta_theta_ *= velocityScalingFactorForCondition(ini_condition, vector_toward_singularity.dot(reduced_delta_x));
+}
+
+double ServoCalcs::getJacobianConditionNumber() const
+{
+  return jacobian_condition_number_.load(std::memory_order_relaxed);
+}
+
 void ServoCalcs::enforceVelLimits(Eigen::ArrayXd& delta_theta)
 {
   Eigen::ArrayXd velocity = delta_theta / parameters_->publish_period;
@@ -762,10 +1069,11 @@ bool ServoCalcs::enforcePositionLimits()
 // Is handled differently for position vs. velocity control.
 void ServoCalcs::suddenHalt(trajectory_msgs::msg::JointTrajectory& joint_trajectory) const
 {
-  // Prepare the joint trajectory message to stop the robot
-  joint_trajectory.points.clear();
-  joint_trajectory.points.emplace_back();
+  // Prepare the joint trajectory message to stop the robot, reusing the storage of the first point
+  joint_trajectory.points.resize(1);
   trajectory_msgs::msg::JointTrajectoryPoint& point = joint_trajectory.points.front();
+  point.accelerations.clear();
+  point.effort.clear();
 
   // When sending out trajectory_msgs/JointTrajectory type messages, the "trajectory" is just a single point.
   // That point cannot have the same timestamp as the start of trajectory execution since that would mean the
@@ -783,12 +1091,10 @@ void ServoCalcs::suddenHalt(trajectory_msgs::msg::JointTrajectory& joint_traject
   for (std::size_t i = 0; i < num_joints_; ++i)
   {
     // For position-controlled robots, can reset the joints to a known, good state
-    if (parameters_->publish_joint_positions)
-      point.positions[i] = original_joint_state_.position[i];
+    point.positions[i] = parameters_->publish_joint_positions ? original_joint_state_.position[i] : 0.0;
 
     // For velocity-controlled robots, stop
-    if (parameters_->publish_joint_velocities)
-      point.velocities[i] = 0;
+    point.velocities[i] = 0;
   }
 }
 
@@ -796,7 +1102,7 @@ void ServoCalcs::suddenHalt(trajectory_msgs::msg::JointTrajectory& joint_traject
 void ServoCalcs::updateJoints()
 {
   // Get the latest joint group positions
-  current_state_ = planning_scene_monitor_->getStateMonitor()->getCurrentState();
+  current_state_ = cycle_state_ ? cycle_state_ : planning_scene_monitor_->getStateMonitor()->getCurrentState();
   current_state_->copyJointGroupPositions(joint_model_group_, internal_joint_state_.position);
   current_state_->copyJointGroupVelocities(joint_model_group_, internal_joint_state_.velocity);
 
@@ -852,9 +1158,8 @@ void ServoCalcs::calculateWorstCaseStopTime()
 
   // publish message
   {
-    auto msg = std::make_unique<std_msgs::msg::Float64>();
-    msg->data = worst_case_stop_time;
-    worst_case_stop_time_pub_->publish(std::move(msg));
+    worst_case_stop_time_msg_.data = worst_case_stop_time;
+    worst_case_stop_time_pub_->publish(worst_case_stop_time_msg_);
   }
 }
 
@@ -1066,38 +1371,52 @@ bool ServoCalcs::getEEFrameTransform(geometry_msgs::msg::TransformStamped& trans
 
 void ServoCalcs::twistStampedCB(const geometry_msgs::msg::TwistStamped::SharedPtr msg)
 {
-  const std::lock_guard<std::mutex> lock(latest_state_mutex_);
-  latest_twist_stamped_ = msg;
-  latest_nonzero_twist_stamped_ = isNonZero(*latest_twist_stamped_.get());
-
-  if (msg.get()->header.stamp != rclcpp::Time(0.))
-    latest_twist_command_stamp_ = msg.get()->header.stamp;
+  // Callbacks of one subscription do not overlap, so this is the only producer of latest_twist_command_
+  if (msg->header.stamp != rclcpp::Time(0.))
+    latest_twist_command_stamp_ = msg->header.stamp;
+
+  auto& command = latest_twist_command_.writeBuffer();
+  command.msg = *msg;
+  command.has_msg = true;
+  command.stamp = latest_twist_command_stamp_;
+  command.nonzero = isNonZero(*msg);
+  latest_twist_command_.publish();
 }
 
 void ServoCalcs::jointCmdCB(const control_msgs::msg::JointJog::SharedPtr msg)
 {
-  const std::lock_guard<std::mutex> lock(latest_state_mutex_);
-  latest_joint_cmd_ = msg;
-  latest_nonzero_joint_cmd_ = isNonZero(*latest_joint_cmd_.get());
-
-  if (msg.get()->header.stamp != rclcpp::Time(0.))
-    latest_joint_command_stamp_ = msg.get()->header.stamp;
+  // Callbacks of one subscription do not overlap, so this is the only producer of latest_joint_command_
+  if (msg->header.stamp != rclcpp::Time(0.))
+    latest_joint_command_stamp_ = msg->header.stamp;
+
+  auto& command = latest_joint_command_.writeBuffer();
+  command.msg = *msg;
+  command.has_msg = true;
+  command.stamp = latest_joint_command_stamp_;
+  command.nonzero = isNonZero(*msg);
+  latest_joint_command_.publish();
 }
 
 void ServoCalcs::collisionVelocityScaleCB(const std_msgs::msg::Float64::SharedPtr msg)
 {
+  // The loop sets the scale itself when it checks collisions, this would only deliver older values
+  if (collision_checker_)
+    return;
+
   collision_velocity_scale_ = msg.get()->data;
 }
 
 void ServoCalcs::changeDriftDimensions(const std::shared_ptr<moveit_msgs::srv::ChangeDriftDimensions::Request> req,
                                        std::shared_ptr<moveit_msgs::srv::ChangeDriftDimensions::Response> res)
 {
-  drift_dimensions_[0] = req->drift_x_translation;
-  drift_dimensions_[1] = req->drift_y_translation;
-  drift_dimensions_[2] = req->drift_z_translation;
-  drift_dimensions_[3] = req->drift_x_rotation;
-  drift_dimensions_[4] = req->drift_y_rotation;
-  drift_dimensions_[5] = req->drift_z_rotation;
+  auto& dimensions = requested_drift_dimensions_.writeBuffer();
+  dimensions[0] = req->drift_x_translation;
+  dimensions[1] = req->drift_y_translation;
+  dimensions[2] = req->drift_z_translation;
+  dimensions[3] = req->drift_x_rotation;
+  dimensions[4] = req->drift_y_rotation;
+  dimensions[5] = req->drift_z_rotation;
+  requested_drift_dimensions_.publish();
 
   res->success = true;
 }
@@ -1105,12 +1424,14 @@ void ServoCalcs::changeDriftDimensions(const std::shared_ptr<moveit_msgs::srv::C
 void ServoCalcs::changeControlDimensions(const std::shared_ptr<moveit_msgs::srv::ChangeControlDimensions::Request> req,
                                          std::shared_ptr<moveit_msgs::srv::ChangeControlDimensions::Response> res)
 {
-  control_dimensions_[0] = req->control_x_translation;
-  control_dimensions_[1] = req->control_y_translation;
-  control_dimensions_[2] = req->control_z_translation;
-  control_dimensions_[3] = req->control_x_rotation;
-  control_dimensions_[4] = req->control_y_rotation;
-  control_dimensions_[5] = req->control_z_rotation;
+  auto& dimensions = requested_control_dimensions_.writeBuffer();
+  dimensions[0] = req->control_x_translation;
+  dimensions[1] = req->control_y_translation;
+  dimensions[2] = req->control_z_translation;
+  dimensions[3] = req->control_x_rotation;
+  dimensions[4] = req->control_y_rotation;
+  dimensions[5] = req->control_z_rotation;
+  requested_control_dimensions_.publish();
 
   res->success = true;
 }
@@ -1127,6 +1448,25 @@ void ServoCalcs::setPaused(bool paused)
   paused_ = paused;
 }
 
+void ServoCalcs::setCollisionChecker(CollisionCheck* collision_checker)
+{
+  collision_checker_ = collision_checker;
+  collision_check_cycle_divider_ = std::max<std::size_t>(
+      1, std::lround(1. / (parameters_->collision_check_rate * parameters_->publish_period)));
+  collision_check_cycle_ = 0;
+}
+
+void ServoCalcs::setCycleCallback(const CycleCallback& callback)
+{
+  cycle_callback_ = callback;
+}
+
+void ServoCalcs::setSmoothingFilter(std::unique_ptr<JointSmoothingFilter> filter)
+{
+  position_filter_ = std::move(filter);
+  position_filter_->initialize(num_joints_);
+}
+
 void ServoCalcs::changeRobotLinkCommandFrame(const std::string& new_command_frame)
 {
   parameters_->robot_link_command_frame = new_command_frame;
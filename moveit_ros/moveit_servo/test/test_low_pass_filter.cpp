@@ -39,6 +39,10 @@
  *      Desc      : Unit test for moveit_servo::LowPassFilter
  */
 
+#include <cmath>
+#include <stdexcept>
+#include <vector>
+
 #include <gtest/gtest.h>
 #include <moveit_servo/low_pass_filter.h>
 
@@ -70,4 +74,57 @@ TEST(MOVEIT_SERVO, FilterReset)
 
   // Then check that a different measurement changes the value
   EXPECT_NE(5.0, lpf.filter(100.0));
-}
\ No newline at end of file
+}
+TEST(MOVEIT_SERVO, JointFilterMatchesScalarFilter)
+{
+  moveit_servo::ButterworthJointFilter joint_filter(2.0);
+  std::vector<moveit_servo::LowPassFilter> scalar_filters(3, moveit_servo::LowPassFilter(2.0));
+  joint_filter.initialize(3);
+
+  Eigen::VectorXd positions(3);
+  positions << 1.0, -2.0, 3.0;
+  joint_filter.reset(positions);
+  for (std::size_t j = 0; j < 3; ++j)
+    scalar_filters[j].reset(positions[j]);
+
+  // Check that all joints are filtered exactly like with one scalar filter per joint
+  for (size_t i = 0; i < 20; ++i)
+  {
+    positions << 1.0 + 0.1 * i, -2.0 - 0.2 * i, 3.0 * std::sin(0.3 * i);
+    Eigen::VectorXd expected(3);
+    for (std::size_t j = 0; j < 3; ++j)
+      expected[j] = scalar_filters[j].filter(positions[j]);
+    joint_filter.filter(positions);
+    for (std::size_t j = 0; j < 3; ++j)
+      EXPECT_DOUBLE_EQ(expected[j], positions[j]);
+  }
+}
+
+TEST(MOVEIT_SERVO, SecondOrderJointFilterConverge)
+{
+  moveit_servo::ButterworthJointFilter joint_filter(2.0, 2);
+  joint_filter.initialize(2);
+  joint_filter.reset(Eigen::VectorXd::Zero(2));
+
+  // Check that a step is smoothed more than by the first-order filter
+  moveit_servo::LowPassFilter lpf(2.0);
+  Eigen::VectorXd positions = Eigen::VectorXd::Constant(2, 5.0);
+  joint_filter.filter(positions);
+  EXPECT_LT(positions[0], lpf.filter(5.0));
+  EXPECT_DOUBLE_EQ(positions[0], positions[1]);
+
+  // Check that the filter converges to expected value after many identical messages
+  for (size_t i = 0; i < 100; ++i)
+  {
+    positions.setConstant(5.0);
+    joint_filter.filter(positions);
+  }
+  EXPECT_NEAR(5.0, positions[0], 1e-9);
+  EXPECT_NEAR(5.0, positions[1], 1e-9);
+}
+
+TEST(MOVEIT_SERVO, JointFilterInvalidOrder)
+{
+  EXPECT_THROW(moveit_servo::ButterworthJointFilter(2.0, 3), std::length_error);
+  EXPECT_THROW(moveit_servo::ButterworthJointFilter(0.5), std::length_error);
+}
@@ -66,8 +66,11 @@ moveit_servo::ServoParametersPtr getTestParameters()
   output->publish_joint_positions = true;
   output->publish_joint_velocities = false;
   output->publish_joint_accelerations = false;
+  output->use_realtime_loop = false;
+  output->realtime_priority = 0;
   output->joint_topic = "/joint_states";
   output->low_pass_filter_coeff = 2;
+  output->low_pass_filter_order = 1;
   output->move_group_name = "panda_arm";
   output->ee_frame_name = "panda_link8";
   output->planning_frame = "panda_link0";
@@ -76,13 +79,17 @@ moveit_servo::ServoParametersPtr getTestParameters()
   output->lower_singularity_threshold = 17;
   output->hard_stop_singularity_threshold = 30;
   output->joint_limit_margin = 0.1;
+  output->use_damped_least_squares = false;
+  output->damping_factor = 0.05;
   output->check_collisions = true;
   output->collision_check_rate = 10;
+  output->collision_check_in_servo_loop = false;
   output->collision_check_type = "threshold_distance";
   output->self_collision_proximity_threshold = 0.01;
   output->scene_collision_proximity_threshold = 0.02;
   output->collision_distance_safety_factor = 1000;
   output->min_allowable_collision_distance = 0.01;
+  output->predictive_collision_samples = 5;
 
   return output;
 }
@@ -100,20 +107,27 @@ bool operator==(moveit_servo::ServoParameters& lhs, moveit_servo::ServoParameter
           lhs.publish_period == rhs.publish_period && lhs.command_out_type == rhs.command_out_type &&
           lhs.publish_joint_positions == rhs.publish_joint_positions &&
           lhs.publish_joint_velocities == rhs.publish_joint_velocities &&
-          lhs.publish_joint_accelerations == rhs.publish_joint_accelerations && lhs.joint_topic == rhs.joint_topic &&
-          lhs.low_pass_filter_coeff == rhs.low_pass_filter_coeff && lhs.move_group_name == rhs.move_group_name &&
+          lhs.publish_joint_accelerations == rhs.publish_joint_accelerations &&
+          lhs.use_realtime_loop == rhs.use_realtime_loop && lhs.realtime_priority == rhs.realtime_priority &&
+          lhs.joint_topic == rhs.joint_topic &&
+          lhs.low_pass_filter_coeff == rhs.low_pass_filter_coeff &&
+          lhs.low_pass_filter_order == rhs.low_pass_filter_order && lhs.move_group_name == rhs.move_group_name &&
           lhs.ee_frame_name == rhs.ee_frame_name && lhs.planning_frame == rhs.planning_frame &&
           lhs.incoming_command_timeout == rhs.incoming_command_timeout &&
           lhs.num_outgoing_halt_msgs_to_publish == rhs.num_outgoing_halt_msgs_to_publish &&
           lhs.lower_singularity_threshold == rhs.lower_singularity_threshold &&
           lhs.hard_stop_singularity_threshold == rhs.hard_stop_singularity_threshold &&
-          lhs.joint_limit_margin == rhs.joint_limit_margin && lhs.check_collisions == rhs.check_collisions &&
+          lhs.joint_limit_margin == rhs.joint_limit_margin &&
+          lhs.use_damped_least_squares == rhs.use_damped_least_squares &&
+          lhs.damping_factor == rhs.damping_factor && lhs.check_collisions == rhs.check_collisions &&
           lhs.collision_check_rate == rhs.collision_check_rate &&
+          lhs.collision_check_in_servo_loop == rhs.collision_check_in_servo_loop &&
           lhs.collision_check_type == rhs.collision_check_type &&
           lhs.self_collision_proximity_threshold == rhs.self_collision_proximity_threshold &&
           lhs.scene_collision_proximity_threshold == rhs.scene_collision_proximity_threshold &&
           lhs.collision_distance_safety_factor == rhs.collision_distance_safety_factor &&
-          lhs.min_allowable_collision_distance == rhs.min_allowable_collision_distance);
+          lhs.min_allowable_collision_distance == rhs.min_allowable_collision_distance &&
+          lhs.predictive_collision_samples == rhs.predictive_collision_samples);
 }
 
 bool operator!=(moveit_servo::ServoParameters& lhs, moveit_servo::ServoParameters& rhs)
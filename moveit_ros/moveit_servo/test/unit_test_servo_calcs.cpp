@@ -504,6 +504,100 @@ TEST_F(ServoCalcsTestFixture, TestComposeOutputMsg)
   EXPECT_EQ(traj.points[0].accelerations[0], 0.0);
 }
 
+TEST_F(ServoCalcsTestFixture, TestComposeOutputMsgInPlace)
+{
+  // Start from the message of an earlier cycle with several points and all fields filled
+  trajectory_msgs::msg::JointTrajectory traj;
+  trajectory_msgs::msg::JointTrajectoryPoint point;
+  point.positions.assign(3, 5.0);
+  point.velocities.assign(3, 6.0);
+  point.accelerations.assign(3, 7.0);
+  traj.points.assign(4, point);
+
+  sensor_msgs::msg::JointState joint_state;
+  joint_state.name.push_back("some_joint");
+  joint_state.position.push_back(1.0);
+  joint_state.velocity.push_back(2.0);
+
+  // Only publish positions this time
+  servo_calcs_->parameters_->publish_joint_positions = true;
+  servo_calcs_->parameters_->publish_joint_velocities = false;
+  servo_calcs_->parameters_->publish_joint_accelerations = false;
+  servo_calcs_->composeJointTrajMessage(joint_state, traj);
+
+  // The old points and fields must not leak into the new message
+  EXPECT_EQ(traj.points.size(), 1UL);
+  EXPECT_EQ(traj.points[0].positions.size(), 1UL);
+  EXPECT_EQ(traj.points[0].positions[0], 1.0);
+  EXPECT_TRUE(traj.points[0].velocities.empty());
+  EXPECT_TRUE(traj.points[0].accelerations.empty());
+}
+
+TEST_F(ServoCalcsTestFixture, TestRunCycleWithoutCommand)
+{
+  // Before any servo command arrived, a cycle produces nothing to send and the command holds the current positions
+  auto state = std::make_shared<moveit::core::RobotState>(*servo_calcs_->current_state_);
+  trajectory_msgs::msg::JointTrajectory command;
+  EXPECT_FALSE(servo_calcs_->runCycle(state, 1.0, command));
+
+  ASSERT_EQ(command.points.size(), 1UL);
+  EXPECT_EQ(command.joint_names, servo_calcs_->joint_model_group_->getActiveJointModelNames());
+  for (double velocity : command.points[0].velocities)
+    EXPECT_EQ(velocity, 0.0);
+}
+
+TEST_F(ServoCalcsTestFixture, TestDampedLeastSquares)
+{
+  // A configuration away from singularities, with thresholds high enough that no velocity scaling applies
+  const std::vector<double> ready_pose{ 0, -0.785, 0, -2.356, 0, 1.571, 0.785 };
+  servo_calcs_->current_state_->setJointGroupPositions(servo_calcs_->joint_model_group_, ready_pose);
+  servo_calcs_->parameters_->lower_singularity_threshold = 1e6;
+  servo_calcs_->parameters_->hard_stop_singularity_threshold = 1e7;
+  servo_calcs_->parameters_->damping_factor = 1e-6;
+
+  servo_calcs_->jacobian_ = servo_calcs_->current_state_->getJacobian(servo_calcs_->joint_model_group_);
+  const Eigen::MatrixXd jacobian = servo_calcs_->jacobian_;
+  Eigen::VectorXd delta_x(6);
+  delta_x << 0.001, -0.002, 0.0005, 0.001, 0, -0.001;
+  servo_calcs_->dampedLeastSquaresCalcs(delta_x);
+
+  // With negligible damping the joint step reproduces the commanded Cartesian step
+  Eigen::VectorXd cartesian_step = jacobian * servo_calcs_->delta_theta_.matrix();
+  EXPECT_TRUE(cartesian_step.isApprox(delta_x, 1e-4));
+
+  // The exposed singularity metric is the condition number of the Jacobian
+  Eigen::JacobiSVD<Eigen::MatrixXd> svd(jacobian);
+  double condition = svd.singularValues()(0) / svd.singularValues()(5);
+  EXPECT_NEAR(servo_calcs_->getJacobianConditionNumber(), condition, 1e-6 * condition);
+}
+
+TEST(TripleBufferTest, ReadsLatestPublishedValue)
+{
+  moveit_servo::TripleBuffer<int> buffer(1);
+  EXPECT_EQ(buffer.read(), 1);
+
+  // Unpublished values are not visible
+  buffer.writeBuffer() = 2;
+  EXPECT_EQ(buffer.read(), 1);
+
+  // Of several values published between two reads, only the latest one is seen
+  buffer.publish();
+  buffer.writeBuffer() = 3;
+  buffer.publish();
+  EXPECT_EQ(buffer.read(), 3);
+  EXPECT_EQ(buffer.read(), 3);
+
+  // The producer never gets the buffer the consumer reads from
+  const int& value = buffer.read();
+  for (int i = 4; i < 10; ++i)
+  {
+    buffer.writeBuffer() = i;
+    buffer.publish();
+    EXPECT_EQ(value, 3);
+  }
+  EXPECT_EQ(buffer.read(), 9);
+}
+
 int main(int argc, char** argv)
 {
   ::testing::InitGoogleTest(&argc, argv);
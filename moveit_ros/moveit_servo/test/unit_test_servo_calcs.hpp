@@ -64,6 +64,8 @@ class FriendServoCalcs : public moveit_servo::ServoCalcs
   FRIEND_TEST(ServoCalcsTestFixture, TestScaleCartesianCommand);
   FRIEND_TEST(ServoCalcsTestFixture, TestScaleJointCommand);
   FRIEND_TEST(ServoCalcsTestFixture, TestComposeOutputMsg);
+  FRIEND_TEST(ServoCalcsTestFixture, TestComposeOutputMsgInPlace);
+  FRIEND_TEST(ServoCalcsTestFixture, TestDampedLeastSquares);
 
 public:
   FriendServoCalcs(const rclcpp::Node::SharedPtr& node, const moveit_servo::ServoParametersPtr& parameters,
@@ -41,11 +41,20 @@
 #include <boost/thread/shared_mutex.hpp>
 #include <boost/function.hpp>
 #include <memory>
+#include <vector>
 
 namespace occupancy_map_monitor
 {
 typedef octomap::OcTreeNode OccMapNode;
 
+/** @brief The cells observed in one sensor message */
+struct OccMapUpdate
+{
+  octomap::KeySet free_cells;
+  octomap::KeySet occupied_cells;
+  octomap::KeySet model_cells;  // cells of the robot, set to the minimum occupancy
+};
+
 class OccMapTree : public octomap::OcTree
 {
 public:
@@ -108,6 +117,21 @@ public:
     update_callback_ = update_callback;
   }
 
+  /** @brief Move the log-odds of all leaves towards zero (unknown) by \e log_odds_delta. Leaves that reach zero are
+   *  deleted and the tree is pruned. The tree needs to be locked for writing. With change detection enabled, deleted
+   *  leaves and leaves that are no longer occupied (free) are reported as changed.
+   *  @return the number of deleted leaves */
+  std::size_t decay(float log_odds_delta);
+
+  /** @brief Delete all leaves that do not intersect the axis-aligned box from \e min to \e max.
+   *  The tree needs to be locked for writing. With change detection enabled, deleted leaves are reported as changed.
+   *  @return the number of deleted leaves */
+  std::size_t deleteOutside(const octomap::point3d& min, const octomap::point3d& max);
+
+  /** @brief Integrate the cells of \e update: mark the free cells, then the occupied cells, then set the model cells
+   *  to the minimum occupancy. The tree needs to be locked for writing. */
+  void integrateUpdate(const OccMapUpdate& update);
+
 private:
   boost::shared_mutex tree_mutex_;
   boost::function<void()> update_callback_;
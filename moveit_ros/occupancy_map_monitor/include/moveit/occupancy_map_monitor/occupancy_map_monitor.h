@@ -49,7 +49,11 @@
 
 #include <boost/thread/mutex.hpp>
 
+#include <chrono>
+#include <condition_variable>
 #include <memory>
+#include <mutex>
+#include <thread>
 
 namespace occupancy_map_monitor
 {
@@ -100,6 +104,14 @@ public:
 
   void addUpdater(const OccupancyMapUpdaterPtr& updater);
 
+  /** @brief Integrate the cells observed in a sensor message into the octree.
+   *
+   *  With a positive octomap_merge_rate, the update is queued and the calling updater does not wait for the tree:
+   *  a single merge thread integrates all queued updates in order, locking the tree for writing once per period.
+   *  Otherwise the update is integrated right away. The update callback is triggered after integration.
+   *  Queued cells are moved out of \e update, so callers can reuse it for the next message either way. */
+  void queueUpdate(OccMapUpdate& update);
+
   /** \brief Add this shape to the set of shapes to be filtered out from the octomap */
   ShapeHandle excludeShape(const shapes::ShapeConstPtr& shape);
 
@@ -124,6 +136,13 @@ public:
 private:
   void initialize();
 
+  /** @brief Bound the size of the octree: decay all voxels towards unknown and delete the voxels outside of the
+   *  window around the robot, if configured. Runs periodically. */
+  void maintainMap();
+
+  /** @brief Integrate the queued updates at the configured rate, until the monitor is destroyed */
+  void mergeUpdates();
+
   /** @brief Save the current octree to a binary file */
   bool saveMapCallback(const std::shared_ptr<rmw_request_id_t> request_header,
                        const std::shared_ptr<moveit_msgs::srv::SaveMap::Request> request,
@@ -158,5 +177,20 @@ private:
   rclcpp::Service<moveit_msgs::srv::LoadMap>::SharedPtr load_map_srv_;
 
   bool active_;
+
+  /* bounded-memory mode, disabled for zero values */
+  double decay_time_;   // seconds for a voxel at the clamping threshold to decay to unknown
+  double window_size_;  // edge length of the cube around window_frame_ outside of which voxels are deleted
+  std::string window_frame_;
+  rclcpp::TimerBase::SharedPtr maintenance_timer_;
+  std::chrono::steady_clock::time_point last_maintenance_time_;
+
+  /* staged updates, disabled for a zero merge rate */
+  double merge_rate_;
+  std::vector<OccMapUpdate> queued_updates_;
+  std::mutex queued_updates_mutex_;
+  std::condition_variable merge_condition_;
+  bool stop_merging_;
+  std::thread merge_thread_;
 };
 }  // namespace occupancy_map_monitor
@@ -0,0 +1,109 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, PickNik LLC
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik LLC nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include <moveit/occupancy_map_monitor/occupancy_map.h>
+#include <cmath>
+
+namespace occupancy_map_monitor
+{
+std::size_t OccMapTree::decay(float log_odds_delta)
+{
+  std::vector<std::pair<octomap::OcTreeKey, unsigned int> > expired;
+  for (leaf_iterator it = begin_leafs(), end = end_leafs(); it != end; ++it)
+  {
+    const float log_odds = it->getLogOdds();
+    if (std::fabs(log_odds) <= log_odds_delta)
+      expired.emplace_back(it.getKey(), it.getDepth());
+    else
+    {
+      const bool occupied = isNodeOccupied(*it);
+      it->setLogOdds(log_odds > 0.0f ? log_odds - log_odds_delta : log_odds + log_odds_delta);
+      if (use_change_detection && occupied != isNodeOccupied(*it))
+        changed_keys[it.getKey()] = false;
+    }
+  }
+
+  for (const std::pair<octomap::OcTreeKey, unsigned int>& leaf : expired)
+  {
+    deleteNode(leaf.first, leaf.second);
+    if (use_change_detection)
+      changed_keys[leaf.first] = false;
+  }
+
+  // the inner nodes hold the maximum of their children
+  updateInnerOccupancy();
+  prune();
+  return expired.size();
+}
+
+std::size_t OccMapTree::deleteOutside(const octomap::point3d& min, const octomap::point3d& max)
+{
+  std::vector<std::pair<octomap::OcTreeKey, unsigned int> > outside;
+  for (leaf_iterator it = begin_leafs(), end = end_leafs(); it != end; ++it)
+  {
+    const octomap::point3d center = it.getCoordinate();
+    const double half_size = 0.5 * it.getSize();
+    for (unsigned int i = 0; i < 3; ++i)
+      if (center(i) + half_size < min(i) || center(i) - half_size > max(i))
+      {
+        outside.emplace_back(it.getKey(), it.getDepth());
+        break;
+      }
+  }
+
+  for (const std::pair<octomap::OcTreeKey, unsigned int>& leaf : outside)
+  {
+    deleteNode(leaf.first, leaf.second);
+    if (use_change_detection)
+      changed_keys[leaf.first] = false;
+  }
+  if (!outside.empty())
+    updateInnerOccupancy();
+  return outside.size();
+}
+
+void OccMapTree::integrateUpdate(const OccMapUpdate& update)
+{
+  for (const octomap::OcTreeKey& free_cell : update.free_cells)
+    updateNode(free_cell, false);
+  for (const octomap::OcTreeKey& occupied_cell : update.occupied_cells)
+    updateNode(occupied_cell, true);
+  if (!update.model_cells.empty())
+  {
+    const float lg = getClampingThresMinLog() - getClampingThresMaxLog();
+    for (const octomap::OcTreeKey& model_cell : update.model_cells)
+      updateNode(model_cell, lg);
+  }
+}
+}  // namespace occupancy_map_monitor
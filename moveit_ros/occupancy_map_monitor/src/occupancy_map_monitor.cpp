@@ -47,7 +47,15 @@ namespace occupancy_map_monitor
 static const rclcpp::Logger LOGGER = rclcpp::get_logger("moveit.ros.occupancy_map_monitor");
 
 OccupancyMapMonitor::OccupancyMapMonitor(const rclcpp::Node::SharedPtr& node, double map_resolution)
-  : map_resolution_(map_resolution), debug_info_(false), mesh_handle_count_(0), node_(node), active_(false)
+  : map_resolution_(map_resolution)
+  , debug_info_(false)
+  , mesh_handle_count_(0)
+  , node_(node)
+  , active_(false)
+  , decay_time_(0.0)
+  , window_size_(0.0)
+  , merge_rate_(0.0)
+  , stop_merging_(false)
 {
   initialize();
 }
@@ -61,6 +69,11 @@ OccupancyMapMonitor::OccupancyMapMonitor(const rclcpp::Node::SharedPtr& node,
   , debug_info_(false)
   , mesh_handle_count_(0)
   , node_(node)
+  , active_(false)
+  , decay_time_(0.0)
+  , window_size_(0.0)
+  , merge_rate_(0.0)
+  , stop_merging_(false)
 {
   initialize();
 }
@@ -88,6 +101,35 @@ void OccupancyMapMonitor::initialize()
   tree_.reset(new OccMapTree(map_resolution_));
   tree_const_ = tree_;
 
+  /* optionally bound the memory used by the octree for long running applications */
+  node_->get_parameter("octomap_decay_time", decay_time_);
+  node_->get_parameter("octomap_window_size", window_size_);
+  node_->get_parameter("octomap_window_frame", window_frame_);
+  if (window_size_ > 0.0 && (!tf_buffer_ || window_frame_.empty()))
+  {
+    RCLCPP_WARN(LOGGER, "Octomap window requires a TF buffer and octomap_window_frame. "
+                        "Not limiting the octomap extent.");
+    window_size_ = 0.0;
+  }
+  if (decay_time_ > 0.0 || window_size_ > 0.0)
+  {
+    double maintenance_period = 1.0;
+    node_->get_parameter("octomap_maintenance_period", maintenance_period);
+    RCLCPP_INFO(LOGGER, "Bounding octomap size: decay time %gs, window size %gm around '%s', every %gs", decay_time_,
+                window_size_, window_frame_.c_str(), maintenance_period);
+    last_maintenance_time_ = std::chrono::steady_clock::now();
+    maintenance_timer_ = node_->create_wall_timer(std::chrono::duration<double>(maintenance_period),
+                                                  [this]() { maintainMap(); });
+  }
+
+  /* optionally let updaters compute their cells concurrently, and integrate them from a single thread */
+  node_->get_parameter("octomap_merge_rate", merge_rate_);
+  if (merge_rate_ > 0.0)
+  {
+    RCLCPP_INFO(LOGGER, "Integrating octomap updates at %g Hz", merge_rate_);
+    merge_thread_ = std::thread([this]() { mergeUpdates(); });
+  }
+
   // TODO(henningkayser): rework this in ROS2
   //   XmlRpc::XmlRpcValue sensor_list;
   //   if (nh_.getParam("sensors", sensor_list))
@@ -217,6 +259,65 @@ void OccupancyMapMonitor::addUpdater(const OccupancyMapUpdaterPtr& updater)
     RCLCPP_ERROR(LOGGER, "NULL updater was specified");
 }
 
+void OccupancyMapMonitor::queueUpdate(OccMapUpdate& update)
+{
+  if (merge_rate_ > 0.0)
+  {
+    {
+      std::lock_guard<std::mutex> lock(queued_updates_mutex_);
+      queued_updates_.push_back(std::move(update));
+    }
+    update.free_cells.clear();
+    update.occupied_cells.clear();
+    update.model_cells.clear();
+    return;
+  }
+
+  tree_->lockWrite();
+  try
+  {
+    tree_->integrateUpdate(update);
+  }
+  catch (...)
+  {
+    RCLCPP_ERROR(LOGGER, "Internal error while updating octree");
+  }
+  tree_->unlockWrite();
+  tree_->triggerUpdateCallback();
+}
+
+void OccupancyMapMonitor::mergeUpdates()
+{
+  const std::chrono::duration<double> period(1.0 / merge_rate_);
+  std::vector<OccMapUpdate> updates;
+  std::unique_lock<std::mutex> lock(queued_updates_mutex_);
+  while (!stop_merging_)
+  {
+    merge_condition_.wait_for(lock, period, [this]() { return stop_merging_; });
+    if (queued_updates_.empty())
+      continue;
+    updates.swap(queued_updates_);
+    lock.unlock();
+
+    tree_->lockWrite();
+    try
+    {
+      for (const OccMapUpdate& update : updates)
+        tree_->integrateUpdate(update);
+    }
+    catch (...)
+    {
+      RCLCPP_ERROR(LOGGER, "Internal error while updating octree");
+    }
+    tree_->unlockWrite();
+    RCLCPP_DEBUG(LOGGER, "Integrated %zu octomap updates", updates.size());
+    updates.clear();
+    tree_->triggerUpdateCallback();
+
+    lock.lock();
+  }
+}
+
 void OccupancyMapMonitor::publishDebugInformation(bool flag)
 {
   debug_info_ = flag;
@@ -349,6 +450,62 @@ bool OccupancyMapMonitor::loadMapCallback(const std::shared_ptr<rmw_request_id_t
   return true;
 }
 
+void OccupancyMapMonitor::maintainMap()
+{
+  const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+  const double elapsed = std::chrono::duration<double>(now - last_maintenance_time_).count();
+  last_maintenance_time_ = now;
+  if (!active_)
+    return;
+
+  bool crop = window_size_ > 0.0;
+  octomap::point3d window_center;
+  if (crop)
+  {
+    std::string map_frame;
+    {
+      boost::mutex::scoped_lock _(parameters_lock_);
+      map_frame = map_frame_;
+    }
+    try
+    {
+      const geometry_msgs::msg::Vector3& translation =
+          tf_buffer_->lookupTransform(map_frame, window_frame_, tf2::TimePointZero).transform.translation;
+      window_center = octomap::point3d(translation.x, translation.y, translation.z);
+    }
+    catch (tf2::TransformException& ex)
+    {
+      rclcpp::Clock steady_clock(RCL_STEADY_TIME);
+      RCLCPP_WARN_THROTTLE(LOGGER, steady_clock, 10000, "Not limiting the octomap extent: %s", ex.what());
+      crop = false;
+    }
+  }
+
+  std::size_t deleted = 0;
+  tree_->lockWrite();
+  try
+  {
+    if (decay_time_ > 0.0)
+      deleted += tree_->decay(tree_->getClampingThresMaxLog() * elapsed / decay_time_);
+    if (crop)
+    {
+      const float half_size = 0.5 * window_size_;
+      const octomap::point3d half_extent(half_size, half_size, half_size);
+      deleted += tree_->deleteOutside(window_center - half_extent, window_center + half_extent);
+    }
+  }
+  catch (...)
+  {
+    RCLCPP_ERROR(LOGGER, "Internal error while bounding the octree");
+  }
+  tree_->unlockWrite();
+
+  RCLCPP_DEBUG(LOGGER, "Deleted %zu octomap leaves", deleted);
+  // decaying changes the occupancy even if no leaf is deleted
+  if (deleted > 0 || decay_time_ > 0.0)
+    tree_->triggerUpdateCallback();
+}
+
 void OccupancyMapMonitor::startMonitor()
 {
   active_ = true;
@@ -367,5 +524,14 @@ void OccupancyMapMonitor::stopMonitor()
 OccupancyMapMonitor::~OccupancyMapMonitor()
 {
   stopMonitor();
+  if (merge_thread_.joinable())
+  {
+    {
+      std::lock_guard<std::mutex> lock(queued_updates_mutex_);
+      stop_merging_ = true;
+    }
+    merge_condition_.notify_all();
+    merge_thread_.join();
+  }
 }
 }  // namespace occupancy_map_monitor
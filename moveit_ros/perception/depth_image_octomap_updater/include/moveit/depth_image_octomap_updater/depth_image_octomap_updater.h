@@ -91,6 +91,7 @@ private:
   double max_update_rate_;
   unsigned int skip_vertical_pixels_;
   unsigned int skip_horizontal_pixels_;
+  bool gpu_projection_;
 
   unsigned int image_callback_count_;
   double average_callback_dt_;
@@ -103,6 +104,7 @@ private:
   std::vector<float> x_cache_, y_cache_;
   double inv_fx_, inv_fy_, K0_, K2_, K4_, K5_;
   std::vector<unsigned int> filtered_labels_;
+  std::vector<float> projected_keys_;
   ros::WallTime last_depth_callback_start_;
 };
 }  // namespace occupancy_map_monitor
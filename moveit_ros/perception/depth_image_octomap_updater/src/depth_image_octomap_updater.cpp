@@ -67,6 +67,7 @@ DepthImageOctomapUpdater::DepthImageOctomapUpdater()
   , max_update_rate_(0)
   , skip_vertical_pixels_(4)
   , skip_horizontal_pixels_(6)
+  , gpu_projection_(false)
   , image_callback_count_(0)
   , average_callback_dt_(0.0)
   , good_tf_(5)
@@ -103,6 +104,8 @@ bool DepthImageOctomapUpdater::setParams(XmlRpc::XmlRpcValue& params)
       readXmlParam(params, "max_update_rate", &max_update_rate_);
     readXmlParam(params, "skip_vertical_pixels", &skip_vertical_pixels_);
     readXmlParam(params, "skip_horizontal_pixels", &skip_horizontal_pixels_);
+    if (params.hasMember("gpu_projection"))
+      gpu_projection_ = static_cast<bool>(params["gpu_projection"]);
     if (params.hasMember("filtered_cloud_topic"))
       filtered_cloud_topic_ = static_cast<const std::string&>(params["filtered_cloud_topic"]);
   }
@@ -389,9 +392,10 @@ void DepthImageOctomapUpdater::depthImageCallback(const sensor_msgs::ImageConstP
   if (filtered_labels_.size() < img_size)
     filtered_labels_.resize(img_size);
 
-  // get the labels of the filtered data
+  // get the labels of the filtered data, the GPU projection uses them in place
   const unsigned int* labels_row = &filtered_labels_[0];
-  mesh_filter_->getFilteredLabels(&filtered_labels_[0]);
+  if (!gpu_projection_)
+    mesh_filter_->getFilteredLabels(&filtered_labels_[0]);
 
   // publish debug information if needed
   if (debug_info_)
@@ -458,79 +462,121 @@ void DepthImageOctomapUpdater::depthImageCallback(const sensor_msgs::ImageConstP
   }
 
   // figure out occupied cells and model cells
-  tree_->lockRead();
+  const int h_bound = h - skip_vertical_pixels_;
+  const int w_bound = w - skip_horizontal_pixels_;
+  if (gpu_projection_)
+  {
+    // the keys of all pixels are computed by the mesh filter, in its GL context
+    if (projected_keys_.size() < 4 * img_size)
+      projected_keys_.resize(4 * img_size);
+    Eigen::Isometry3d map_h_sensor_eigen;
+    for (int i = 0; i < 3; ++i)
+    {
+      for (int j = 0; j < 3; ++j)
+        map_h_sensor_eigen.linear()(i, j) = map_h_sensor.getBasis()[i][j];
+      map_h_sensor_eigen.translation()[i] = map_h_sensor.getOrigin()[i];
+    }
+    mesh_filter_->getProjectedKeys(&projected_keys_[0], map_h_sensor_eigen, tree_->getResolution(), K0_, K4_, K2_,
+                                   K5_);
 
-  try
+    // neighboring pixels mostly fall into the same cell, skip those before hashing
+    octomap::OcTreeKey key, last_key;
+    int last_category = mesh_filter::MeshFilterBase::KEY_NONE;
+    for (int y = skip_vertical_pixels_; y < h_bound; ++y)
+    {
+      const float* keys_row = &projected_keys_[4 * y * w];
+      for (int x = skip_horizontal_pixels_; x < w_bound; ++x)
+      {
+        const float* pixel = keys_row + 4 * x;
+        const int category = static_cast<int>(pixel[3]);
+        if (category == mesh_filter::MeshFilterBase::KEY_NONE)
+          continue;
+        key = octomap::OcTreeKey(static_cast<octomap::key_type>(pixel[0]), static_cast<octomap::key_type>(pixel[1]),
+                                 static_cast<octomap::key_type>(pixel[2]));
+        if (category == last_category && key == last_key)
+          continue;
+        if (category == mesh_filter::MeshFilterBase::KEY_OCCUPIED)
+          occupied_cells.insert(key);
+        else
+          model_cells.insert(key);
+        last_key = key;
+        last_category = category;
+      }
+    }
+  }
+  else
   {
-    const int h_bound = h - skip_vertical_pixels_;
-    const int w_bound = w - skip_horizontal_pixels_;
+    tree_->lockRead();
 
-    if (is_u_short)
+    try
     {
-      const uint16_t* input_row = reinterpret_cast<const uint16_t*>(&depth_msg->data[0]);
+      if (is_u_short)
+      {
+        const uint16_t* input_row = reinterpret_cast<const uint16_t*>(&depth_msg->data[0]);
 
-      for (int y = skip_vertical_pixels_; y < h_bound; ++y, labels_row += w, input_row += w)
-        for (int x = skip_horizontal_pixels_; x < w_bound; ++x)
-        {
-          // not filtered
-          if (labels_row[x] == mesh_filter::MeshFilterBase::BACKGROUND)
+        for (int y = skip_vertical_pixels_; y < h_bound; ++y, labels_row += w, input_row += w)
+          for (int x = skip_horizontal_pixels_; x < w_bound; ++x)
           {
-            float zz = (float)input_row[x] * 1e-3;  // scale from mm to m
-            float yy = y_cache_[y] * zz;
-            float xx = x_cache_[x] * zz;
-            /* transform to map frame */
-            tf2::Vector3 point_tf = map_h_sensor * tf2::Vector3(xx, yy, zz);
-            occupied_cells.insert(tree_->coordToKey(point_tf.getX(), point_tf.getY(), point_tf.getZ()));
+            // not filtered
+            if (labels_row[x] == mesh_filter::MeshFilterBase::BACKGROUND)
+            {
+              float zz = (float)input_row[x] * 1e-3;  // scale from mm to m
+              float yy = y_cache_[y] * zz;
+              float xx = x_cache_[x] * zz;
+              /* transform to map frame */
+              tf2::Vector3 point_tf = map_h_sensor * tf2::Vector3(xx, yy, zz);
+              occupied_cells.insert(tree_->coordToKey(point_tf.getX(), point_tf.getY(), point_tf.getZ()));
+            }
+            // on far plane or a model point -> remove
+            else if (labels_row[x] >= mesh_filter::MeshFilterBase::FAR_CLIP)
+            {
+              float zz = input_row[x] * 1e-3;
+              float yy = y_cache_[y] * zz;
+              float xx = x_cache_[x] * zz;
+              /* transform to map frame */
+              tf2::Vector3 point_tf = map_h_sensor * tf2::Vector3(xx, yy, zz);
+              // add to the list of model cells
+              model_cells.insert(tree_->coordToKey(point_tf.getX(), point_tf.getY(), point_tf.getZ()));
+            }
           }
-          // on far plane or a model point -> remove
-          else if (labels_row[x] >= mesh_filter::MeshFilterBase::FAR_CLIP)
+      }
+      else
+      {
+        const float* input_row = reinterpret_cast<const float*>(&depth_msg->data[0]);
+
+        for (int y = skip_vertical_pixels_; y < h_bound; ++y, labels_row += w, input_row += w)
+          for (int x = skip_horizontal_pixels_; x < w_bound; ++x)
           {
-            float zz = input_row[x] * 1e-3;
-            float yy = y_cache_[y] * zz;
-            float xx = x_cache_[x] * zz;
-            /* transform to map frame */
-            tf2::Vector3 point_tf = map_h_sensor * tf2::Vector3(xx, yy, zz);
-            // add to the list of model cells
-            model_cells.insert(tree_->coordToKey(point_tf.getX(), point_tf.getY(), point_tf.getZ()));
+            if (labels_row[x] == mesh_filter::MeshFilterBase::BACKGROUND)
+            {
+              float zz = input_row[x];
+              float yy = y_cache_[y] * zz;
+              float xx = x_cache_[x] * zz;
+              /* transform to map frame */
+              tf2::Vector3 point_tf = map_h_sensor * tf2::Vector3(xx, yy, zz);
+              occupied_cells.insert(tree_->coordToKey(point_tf.getX(), point_tf.getY(), point_tf.getZ()));
+            }
+            else if (labels_row[x] >= mesh_filter::MeshFilterBase::FAR_CLIP)
+            {
+              float zz = input_row[x];
+              float yy = y_cache_[y] * zz;
+              float xx = x_cache_[x] * zz;
+              /* transform to map frame */
+              tf2::Vector3 point_tf = map_h_sensor * tf2::Vector3(xx, yy, zz);
+              // add to the list of model cells
+              model_cells.insert(tree_->coordToKey(point_tf.getX(), point_tf.getY(), point_tf.getZ()));
+            }
           }
-        }
+      }
     }
-    else
+    catch (...)
     {
-      const float* input_row = reinterpret_cast<const float*>(&depth_msg->data[0]);
-
-      for (int y = skip_vertical_pixels_; y < h_bound; ++y, labels_row += w, input_row += w)
-        for (int x = skip_horizontal_pixels_; x < w_bound; ++x)
-        {
-          if (labels_row[x] == mesh_filter::MeshFilterBase::BACKGROUND)
-          {
-            float zz = input_row[x];
-            float yy = y_cache_[y] * zz;
-            float xx = x_cache_[x] * zz;
-            /* transform to map frame */
-            tf2::Vector3 point_tf = map_h_sensor * tf2::Vector3(xx, yy, zz);
-            occupied_cells.insert(tree_->coordToKey(point_tf.getX(), point_tf.getY(), point_tf.getZ()));
-          }
-          else if (labels_row[x] >= mesh_filter::MeshFilterBase::FAR_CLIP)
-          {
-            float zz = input_row[x];
-            float yy = y_cache_[y] * zz;
-            float xx = x_cache_[x] * zz;
-            /* transform to map frame */
-            tf2::Vector3 point_tf = map_h_sensor * tf2::Vector3(xx, yy, zz);
-            // add to the list of model cells
-            model_cells.insert(tree_->coordToKey(point_tf.getX(), point_tf.getY(), point_tf.getZ()));
-          }
-        }
+      tree_->unlockRead();
+      ROS_ERROR_NAMED(LOGNAME, "Internal error while parsing depth data");
+      return;
     }
-  }
-  catch (...)
-  {
     tree_->unlockRead();
-    ROS_ERROR_NAMED(LOGNAME, "Internal error while parsing depth data");
-    return;
   }
-  tree_->unlockRead();
 
   /* cells that overlap with the model are not occupied */
   for (const octomap::OcTreeKey& model_cell : model_cells)
@@ -38,20 +38,39 @@
 
 #include <moveit/occupancy_map_monitor/occupancy_map.h>
 #include <boost/thread.hpp>
+#include <atomic>
 #include <deque>
 #include <unordered_map>
 
 namespace occupancy_map_monitor
 {
+/** \brief Clears the free space along the rays to occupied and model cells in a background thread.
+    Updates from the same sensor origin are accumulated into batches of up to \e max_batch_size updates and the rays
+    of a batch are cast in parallel. At most \e max_queue_size updates wait to be batched; if updates are pushed faster
+    than they can be processed, the oldest ones are dropped, as are batches arriving while the previous one is being
+    processed. getStatistics() tells how much is dropped. */
 class LazyFreeSpaceUpdater
 {
 public:
-  LazyFreeSpaceUpdater(const OccMapTreePtr& tree, unsigned int max_batch_size = 10);
+  /** \brief Counters since construction, to monitor if the updater keeps up with the sensors */
+  struct Statistics
+  {
+    std::size_t pushed_updates;
+    std::size_t dropped_updates;
+    std::size_t processed_batches;
+    std::size_t dropped_batches;
+    std::size_t queued_updates;
+  };
+
+  LazyFreeSpaceUpdater(const OccMapTreePtr& tree, unsigned int max_batch_size = 10, unsigned int max_queue_size = 100);
   ~LazyFreeSpaceUpdater();
 
+  /** \brief Queue the cells seen from \e sensor_origin. Takes ownership of \e occupied_cells and \e model_cells. */
   void pushLazyUpdate(octomap::KeySet* occupied_cells, octomap::KeySet* model_cells,
                       const octomap::point3d& sensor_origin);
 
+  Statistics getStatistics() const;
+
 private:
 #ifdef __APPLE__
   typedef std::unordered_map<octomap::OcTreeKey, unsigned int, octomap::OcTreeKey::KeyHash> OcTreeKeyCountMap;
@@ -70,13 +89,19 @@ private:
   OccMapTreePtr tree_;
   bool running_;
   std::size_t max_batch_size_;
+  std::size_t max_queue_size_;
   double max_sensor_delta_;
 
+  std::atomic<std::size_t> pushed_updates_;
+  std::atomic<std::size_t> dropped_updates_;
+  std::atomic<std::size_t> processed_batches_;
+  std::atomic<std::size_t> dropped_batches_;
+
   std::deque<octomap::KeySet*> occupied_cells_sets_;
   std::deque<octomap::KeySet*> model_cells_sets_;
   std::deque<octomap::point3d> sensor_origins_;
   boost::condition_variable update_condition_;
-  boost::mutex update_cell_sets_lock_;
+  mutable boost::mutex update_cell_sets_lock_;
 
   OcTreeKeyCountMap* process_occupied_cells_set_;
   octomap::KeySet* process_model_cells_set_;
@@ -36,16 +36,25 @@
 
 #include <moveit/lazy_free_space_updater/lazy_free_space_updater.h>
 #include <ros/console.h>
+#include <omp.h>
+#include <algorithm>
+#include <vector>
 
 namespace occupancy_map_monitor
 {
 static const std::string LOGNAME = "lazy_free_space_updater";
 
-LazyFreeSpaceUpdater::LazyFreeSpaceUpdater(const OccMapTreePtr& tree, unsigned int max_batch_size)
+LazyFreeSpaceUpdater::LazyFreeSpaceUpdater(const OccMapTreePtr& tree, unsigned int max_batch_size,
+                                           unsigned int max_queue_size)
   : tree_(tree)
   , running_(true)
   , max_batch_size_(max_batch_size)
+  , max_queue_size_(std::max(max_queue_size, 1u))
   , max_sensor_delta_(1e-3)  // 1mm
+  , pushed_updates_(0)
+  , dropped_updates_(0)
+  , processed_batches_(0)
+  , dropped_batches_(0)
   , process_occupied_cells_set_(nullptr)
   , process_model_cells_set_(nullptr)
   , update_thread_(boost::bind(&LazyFreeSpaceUpdater::lazyUpdateThread, this))
@@ -74,6 +83,20 @@ void LazyFreeSpaceUpdater::pushLazyUpdate(octomap::KeySet* occupied_cells, octom
   ROS_DEBUG_NAMED(LOGNAME, "Pushing %lu occupied cells and %lu model cells for lazy updating...",
                   (long unsigned int)occupied_cells->size(), (long unsigned int)model_cells->size());
   boost::mutex::scoped_lock _(update_cell_sets_lock_);
+  ++pushed_updates_;
+
+  // bound the queue: if the updates arrive faster than they are batched, the oldest ones are dropped
+  if (occupied_cells_sets_.size() >= max_queue_size_)
+  {
+    ROS_WARN_THROTTLE_NAMED(1, LOGNAME, "Lazy update queue is full. Dropping the oldest set of cells.");
+    delete occupied_cells_sets_.front();
+    occupied_cells_sets_.pop_front();
+    delete model_cells_sets_.front();
+    model_cells_sets_.pop_front();
+    sensor_origins_.pop_front();
+    ++dropped_updates_;
+  }
+
   occupied_cells_sets_.push_back(occupied_cells);
   model_cells_sets_.push_back(model_cells);
   sensor_origins_.push_back(sensor_origin);
@@ -97,24 +120,36 @@ void LazyFreeSpaceUpdater::pushBatchToProcess(OcTreeKeyCountMap* occupied_cells,
   else
   {
     ROS_WARN_NAMED(LOGNAME, "Previous batch update did not complete. Ignoring set of cells to be freed.");
+    ++dropped_batches_;
     delete occupied_cells;
     delete model_cells;
   }
 }
 
+LazyFreeSpaceUpdater::Statistics LazyFreeSpaceUpdater::getStatistics() const
+{
+  Statistics statistics;
+  statistics.pushed_updates = pushed_updates_;
+  statistics.dropped_updates = dropped_updates_;
+  statistics.processed_batches = processed_batches_;
+  statistics.dropped_batches = dropped_batches_;
+  boost::mutex::scoped_lock _(update_cell_sets_lock_);
+  statistics.queued_updates = occupied_cells_sets_.size();
+  return statistics;
+}
+
 void LazyFreeSpaceUpdater::processThread()
 {
   const float lg_0 = tree_->getClampingThresMinLog() - tree_->getClampingThresMaxLog();
   const float lg_miss = tree_->getProbMissLog();
 
-  octomap::KeyRay key_ray1, key_ray2;
-  OcTreeKeyCountMap free_cells1, free_cells2;
+  // ray endpoints and the number of rays ending there, and one key ray and free cell map per thread
+  std::vector<std::pair<octomap::OcTreeKey, unsigned int> > endpoints;
+  std::vector<octomap::KeyRay> key_rays;
+  std::vector<OcTreeKeyCountMap> thread_free_cells;
 
   while (running_)
   {
-    free_cells1.clear();
-    free_cells2.clear();
-
     boost::unique_lock<boost::mutex> ulock(cell_process_lock_);
     while (!process_occupied_cells_set_ && running_)
       process_condition_.wait(ulock);
@@ -128,44 +163,43 @@ void LazyFreeSpaceUpdater::processThread()
                     (long unsigned int)process_model_cells_set_->size());
 
     ros::WallTime start = ros::WallTime::now();
+
+    endpoints.assign(process_occupied_cells_set_->begin(), process_occupied_cells_set_->end());
+    for (const octomap::OcTreeKey& it : *process_model_cells_set_)
+      endpoints.emplace_back(it, 1);
+
+    const int num_threads = std::max(omp_get_max_threads(), 1);
+    key_rays.resize(num_threads);
+    thread_free_cells.resize(num_threads);
+    for (OcTreeKeyCountMap& free_cells : thread_free_cells)
+      free_cells.clear();
+
     tree_->lockRead();
 
-#pragma omp sections
+    /* compute the free cells along each ray that ends at an occupied or a model cell */
+    const int num_endpoints = endpoints.size();
+#pragma omp parallel for schedule(dynamic, 64) num_threads(num_threads)
+    for (int i = 0; i < num_endpoints; ++i)
     {
-#pragma omp section
-      {
-        /* compute the free cells along each ray that ends at an occupied cell */
-        for (std::pair<const octomap::OcTreeKey, unsigned int>& it : *process_occupied_cells_set_)
-          if (tree_->computeRayKeys(process_sensor_origin_, tree_->keyToCoord(it.first), key_ray1))
-            for (octomap::OcTreeKey& jt : key_ray1)
-              free_cells1[jt] += it.second;
-      }
-
-#pragma omp section
-      {
-        /* compute the free cells along each ray that ends at a model cell */
-        for (const octomap::OcTreeKey& it : *process_model_cells_set_)
-          if (tree_->computeRayKeys(process_sensor_origin_, tree_->keyToCoord(it), key_ray2))
-            for (octomap::OcTreeKey& jt : key_ray2)
-              free_cells2[jt]++;
-      }
+      const int thread = omp_get_thread_num();
+      if (tree_->computeRayKeys(process_sensor_origin_, tree_->keyToCoord(endpoints[i].first), key_rays[thread]))
+        for (const octomap::OcTreeKey& jt : key_rays[thread])
+          thread_free_cells[thread][jt] += endpoints[i].second;
     }
 
     tree_->unlockRead();
 
+    OcTreeKeyCountMap& free_cells = thread_free_cells[0];
+    for (int thread = 1; thread < num_threads; ++thread)
+      for (const std::pair<const octomap::OcTreeKey, unsigned int>& it : thread_free_cells[thread])
+        free_cells[it.first] += it.second;
+
     for (std::pair<const octomap::OcTreeKey, unsigned int>& it : *process_occupied_cells_set_)
-    {
-      free_cells1.erase(it.first);
-      free_cells2.erase(it.first);
-    }
+      free_cells.erase(it.first);
 
     for (const octomap::OcTreeKey& it : *process_model_cells_set_)
-    {
-      free_cells1.erase(it);
-      free_cells2.erase(it);
-    }
-    ROS_DEBUG_NAMED(LOGNAME, "Marking %lu cells as free...",
-                    (long unsigned int)(free_cells1.size() + free_cells2.size()));
+      free_cells.erase(it);
+    ROS_DEBUG_NAMED(LOGNAME, "Marking %lu cells as free...", (long unsigned int)free_cells.size());
 
     tree_->lockWrite();
 
@@ -176,9 +210,7 @@ void LazyFreeSpaceUpdater::processThread()
         tree_->updateNode(it, lg_0);
 
       /* mark free cells only if not seen occupied in this cloud */
-      for (std::pair<const octomap::OcTreeKey, unsigned int>& it : free_cells1)
-        tree_->updateNode(it.first, it.second * lg_miss);
-      for (std::pair<const octomap::OcTreeKey, unsigned int>& it : free_cells2)
+      for (std::pair<const octomap::OcTreeKey, unsigned int>& it : free_cells)
         tree_->updateNode(it.first, it.second * lg_miss);
     }
     catch (...)
@@ -187,6 +219,7 @@ void LazyFreeSpaceUpdater::processThread()
     }
     tree_->unlockWrite();
     tree_->triggerUpdateCallback();
+    ++processed_batches_;
 
     ROS_DEBUG_NAMED(LOGNAME, "Marked free cells in %lf ms", (ros::WallTime::now() - start).toSec() * 1000.0);
 
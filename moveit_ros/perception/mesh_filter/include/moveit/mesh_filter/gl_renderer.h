@@ -96,6 +96,12 @@ public:
    */
   void getColorBuffer(unsigned char* buffer) const;
 
+  /**
+   * \brief retrieves the color buffer as four floats per pixel, for renderers with a floating point color format
+   * \param[out] buffer pointer to memory where the color values need to be stored
+   */
+  void getFloatColorBuffer(float* buffer) const;
+
   /**
    * \brief retrieves the depth buffer from OpenGL
    * \author Suat Gedikli (gedikli@willowgarage.com)
@@ -176,6 +182,12 @@ public:
    */
   void setBufferSize(unsigned width, unsigned height);
 
+  /**
+   * \brief set the internal format of the color buffer, e.g. GL_RGBA32F to render unclamped floats
+   * \param[in] format the internal format, GL_RGBA by default
+   */
+  void setColorFormat(GLint format);
+
   /**
    * \returns the current programID
    * \author Suat Gedikli (gedikli@willowgarage.com)
@@ -272,6 +284,9 @@ private:
   /** \brief handle to depth buffer*/
   GLuint depth_id_;
 
+  /** \brief internal format of the color buffer*/
+  GLint color_format_;
+
   /** \brief handle to program that is currently used*/
   GLuint program_;
 
@@ -293,8 +308,22 @@ private:
   /** \brief y-coordinate of principal point of camera in pixels*/
   float cy_;
 
+  /** \brief OpenGL context of a thread, either a hidden GLUT window or a headless EGL context */
+  struct ContextHandle
+  {
+    /** \brief number of renderers using this context */
+    unsigned ref_count = 1;
+
+    /** \brief GLUT window, 0 for EGL contexts */
+    GLuint window_id = 0;
+
+    /** \brief EGLContext and EGLSurface, nullptr for GLUT contexts */
+    void* egl_context = nullptr;
+    void* egl_surface = nullptr;
+  };
+
   /** \brief map from thread id to OpenGL context */
-  static std::map<boost::thread::id, std::pair<unsigned, GLuint> > context_;
+  static std::map<boost::thread::id, ContextHandle> context_;
 
   /* \brief lock for context map */
   static boost::mutex context_lock_;
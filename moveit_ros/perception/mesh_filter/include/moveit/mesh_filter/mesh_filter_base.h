@@ -76,6 +76,14 @@ public:
     FIRST_LABEL = 16
   };
 
+  /** \brief categories of the keys computed by getProjectedKeys */
+  enum
+  {
+    KEY_NONE = 0,      // shadow or invalid depth reading
+    KEY_OCCUPIED = 1,  // background, an obstacle
+    KEY_MODEL = 2      // on the far plane or on a mesh, only used to clear free space
+  };
+
 public:
   /**
    * \brief Constructor
@@ -150,6 +158,18 @@ public:
    */
   void getModelDepth(float* depth) const;
 
+  /**
+   * \brief back-projects the pixels of the last filtered depth image and computes their octree keys on the GPU
+   * \param[out] keys pointer to a buffer of four floats per pixel, filled with the three key coordinates of the point
+   *                  and its category (KEY_NONE, KEY_OCCUPIED or KEY_MODEL). The key coordinates are exact integers.
+   * \param[in] map_h_sensor the pose of the sensor in the frame of the octree
+   * \param[in] resolution the resolution of the octree, assumed to have the default depth of 16
+   * \param[in] fx, fy, cx, cy the pinhole parameters of the depth camera
+   * \note depth readings are clamped to the clipping range, unlike in the filtered depth
+   */
+  void getProjectedKeys(float* keys, const Eigen::Isometry3d& map_h_sensor, double resolution, float fx, float fy,
+                        float cx, float cy) const;
+
   /**
    * \brief set the shadow threshold. points that are further away than the rendered model are filtered out.
    *        Except they are further away than this threshold. Then these points are kept, but its label is set to
@@ -204,6 +224,12 @@ protected:
    */
   void doFilter(const void* sensor_data, const int encoding) const;
 
+  /**
+   * \brief the key projection pass run in the filtering thread, see getProjectedKeys
+   */
+  void projectKeys(float* keys, const Eigen::Matrix4f& map_h_sensor, float inverse_resolution,
+                   const Eigen::Vector4f& intrinsics) const;
+
   /**
    * \brief used within a Job to allow the main thread adding meshes
    * \param[in] handle the handle of the mesh that is predetermined and passed
@@ -271,6 +297,9 @@ protected:
   /** \brief second pass renderer for filtering the results of first pass*/
   GLRendererPtr depth_filter_;
 
+  /** \brief optional third pass computing the octree keys of the filtered depth image*/
+  GLRendererPtr key_projector_;
+
   /** \brief canvas element (screen-filling quad) for second pass*/
   GLuint canvas_;
 
@@ -42,6 +42,9 @@
 #endif
 #include <GL/glut.h>
 #include <GL/freeglut.h>
+#ifdef MOVEIT_MESH_FILTER_EGL
+#include <EGL/egl.h>
+#endif
 #include <moveit/mesh_filter/gl_renderer.h>
 #include <sstream>
 #include <fstream>
@@ -59,6 +62,7 @@ mesh_filter::GLRenderer::GLRenderer(unsigned width, unsigned height, float near,
   , rbo_id_(0)
   , rgb_id_(0)
   , depth_id_(0)
+  , color_format_(GL_RGBA)
   , program_(0)
   , near_(near)
   , far_(far)
@@ -89,6 +93,16 @@ void mesh_filter::GLRenderer::setBufferSize(unsigned width, unsigned height)
   }
 }
 
+void mesh_filter::GLRenderer::setColorFormat(GLint format)
+{
+  if (color_format_ != format)
+  {
+    color_format_ = format;
+    deleteFrameBuffers();
+    initFrameBuffers();
+  }
+}
+
 void mesh_filter::GLRenderer::setClippingRange(float near, float far)
 {
   if (near_ <= 0)
@@ -127,7 +141,7 @@ void mesh_filter::GLRenderer::initFrameBuffers()
 {
   glGenTextures(1, &rgb_id_);
   glBindTexture(GL_TEXTURE_2D, rgb_id_);
-  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width_, height_, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+  glTexImage2D(GL_TEXTURE_2D, 0, color_format_, width_, height_, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
   glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
   glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
@@ -211,6 +225,14 @@ void mesh_filter::GLRenderer::getColorBuffer(unsigned char* buffer) const
   glBindFramebuffer(GL_FRAMEBUFFER, 0);
 }
 
+void mesh_filter::GLRenderer::getFloatColorBuffer(float* buffer) const
+{
+  glBindFramebuffer(GL_FRAMEBUFFER, fbo_id_);
+  glBindTexture(GL_TEXTURE_2D, rgb_id_);
+  glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_FLOAT, buffer);
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
 void mesh_filter::GLRenderer::getDepthBuffer(float* buffer) const
 {
   glBindFramebuffer(GL_FRAMEBUFFER, fbo_id_);
@@ -352,67 +374,130 @@ GLuint mesh_filter::GLRenderer::loadShaders(const string& vertex_source, const s
   return program_id;
 }
 
-map<boost::thread::id, pair<unsigned, GLuint> > mesh_filter::GLRenderer::context_;
+map<boost::thread::id, mesh_filter::GLRenderer::ContextHandle> mesh_filter::GLRenderer::context_;
 boost::mutex mesh_filter::GLRenderer::context_lock_;
 bool mesh_filter::GLRenderer::glutInitialized_ = false;
 
 namespace
 {
 void nullDisplayFunction(){};
+
+#ifdef MOVEIT_MESH_FILTER_EGL
+/** \brief Create and activate an EGL context without a window. Rendering happens into frame buffer objects anyway,
+    so a 1x1 pbuffer surface suffices. This works on machines without a display, where glutInit() would exit. */
+bool createEGLContext(void*& egl_context, void*& egl_surface)
+{
+  EGLDisplay display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+  EGLint major, minor;
+  if (display == EGL_NO_DISPLAY || !eglInitialize(display, &major, &minor))
+    return false;
+
+  static const EGLint CONFIG_ATTRIBS[] = { EGL_SURFACE_TYPE, EGL_PBUFFER_BIT, EGL_RED_SIZE,        8,
+                                           EGL_GREEN_SIZE,   8,               EGL_BLUE_SIZE,       8,
+                                           EGL_DEPTH_SIZE,   24,              EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+                                           EGL_NONE };
+  static const EGLint PBUFFER_ATTRIBS[] = { EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE };
+
+  EGLConfig config;
+  EGLint num_configs;
+  if (!eglChooseConfig(display, CONFIG_ATTRIBS, &config, 1, &num_configs) || num_configs < 1 ||
+      !eglBindAPI(EGL_OPENGL_API))
+    return false;
+
+  EGLSurface surface = eglCreatePbufferSurface(display, config, PBUFFER_ATTRIBS);
+  if (surface == EGL_NO_SURFACE)
+    return false;
+
+  // no attributes: a compatibility profile context, the renderer uses the fixed function matrix stack
+  EGLContext context = eglCreateContext(display, config, EGL_NO_CONTEXT, nullptr);
+  if (context == EGL_NO_CONTEXT || !eglMakeCurrent(display, surface, surface, context))
+  {
+    if (context != EGL_NO_CONTEXT)
+      eglDestroyContext(display, context);
+    eglDestroySurface(display, surface);
+    return false;
+  }
+
+  egl_context = context;
+  egl_surface = surface;
+  return true;
+}
+
+void destroyEGLContext(void* egl_context, void* egl_surface)
+{
+  EGLDisplay display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+  eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+  eglDestroyContext(display, egl_context);
+  eglDestroySurface(display, egl_surface);
 }
+#endif
+}  // namespace
 
 void mesh_filter::GLRenderer::createGLContext()
 {
   boost::mutex::scoped_lock _(context_lock_);
-  if (!glutInitialized_)
-  {
-    char buffer[1];
-    char* args = buffer;
-    int n = 1;
-
-    glutInit(&n, &args);
-    glutInitDisplayMode(GLUT_SINGLE | GLUT_RGB | GLUT_DEPTH);
-    glutInitialized_ = true;
-  }
 
   // check if our thread is initialized
   boost::thread::id thread_id = boost::this_thread::get_id();
-  map<boost::thread::id, pair<unsigned, GLuint> >::iterator context_it = context_.find(thread_id);
+  map<boost::thread::id, ContextHandle>::iterator context_it = context_.find(thread_id);
 
-  if (context_it == context_.end())
+  if (context_it != context_.end())
+  {
+    ++(context_it->second.ref_count);
+    return;
+  }
+
+  ContextHandle handle;
+#ifdef MOVEIT_MESH_FILTER_EGL
+  if (!createEGLContext(handle.egl_context, handle.egl_surface))
+    ROS_WARN("Unable to create a headless EGL context, falling back to GLUT");
+#endif
+
+  if (!handle.egl_context)
   {
-    context_[thread_id] = std::pair<unsigned, GLuint>(1, 0);
+    if (!glutInitialized_)
+    {
+      char buffer[1];
+      char* args = buffer;
+      int n = 1;
+
+      glutInit(&n, &args);
+      glutInitDisplayMode(GLUT_SINGLE | GLUT_RGB | GLUT_DEPTH);
+      glutInitialized_ = true;
+    }
 
     glutInitWindowPosition(glutGet(GLUT_SCREEN_WIDTH) + 30000, 0);
     glutInitWindowSize(1, 1);
-    GLuint window_id = glutCreateWindow("mesh_filter");
+    handle.window_id = glutCreateWindow("mesh_filter");
     glutDisplayFunc(nullDisplayFunction);
+  }
 
-    GLenum err = glewInit();
-    if (GLEW_OK != err)
-    {
-      stringstream error_stream;
-      error_stream << "Unable to initialize GLEW: " << glewGetErrorString(err);
+  GLenum err = glewInit();
+  if (GLEW_OK != err)
+  {
+    stringstream error_stream;
+    error_stream << "Unable to initialize GLEW: " << glewGetErrorString(err);
 
-      throw(runtime_error(error_stream.str()));
-    }
+    throw(runtime_error(error_stream.str()));
+  }
+
+  if (handle.window_id)
+  {
     glutIconifyWindow();
     glutHideWindow();
 
     for (int i = 0; i < 10; ++i)
       glutMainLoopEvent();
-
-    context_[thread_id] = std::pair<unsigned, GLuint>(1, window_id);
   }
-  else
-    ++(context_it->second.first);
+
+  context_[thread_id] = handle;
 }
 
 void mesh_filter::GLRenderer::deleteGLContext()
 {
   boost::mutex::scoped_lock _(context_lock_);
   boost::thread::id thread_id = boost::this_thread::get_id();
-  map<boost::thread::id, pair<unsigned, GLuint> >::iterator context_it = context_.find(thread_id);
+  map<boost::thread::id, ContextHandle>::iterator context_it = context_.find(thread_id);
   if (context_it == context_.end())
   {
     stringstream error_msg;
@@ -420,9 +505,14 @@ void mesh_filter::GLRenderer::deleteGLContext()
     throw runtime_error(error_msg.str());
   }
 
-  if (--(context_it->second.first) == 0)
+  if (--(context_it->second.ref_count) == 0)
   {
-    glutDestroyWindow(context_it->second.second);
+#ifdef MOVEIT_MESH_FILTER_EGL
+    if (context_it->second.egl_context)
+      destroyEGLContext(context_it->second.egl_context, context_it->second.egl_surface);
+#endif
+    if (context_it->second.window_id)
+      glutDestroyWindow(context_it->second.window_id);
     context_.erase(context_it);
   }
 }
@@ -51,6 +51,43 @@
 #include <xmmintrin.h>
 #endif
 
+namespace
+{
+const std::string KEY_VERTEX_SHADER_SOURCE = "#version 120\n"
+                                             "void main()"
+                                             "{"
+                                             "  gl_TexCoord[0] = gl_MultiTexCoord0;"
+                                             "  gl_Position = gl_Vertex;"
+                                             "  gl_Position.w = 1.0;"
+                                             "}";
+
+// The labels are decoded like the RGBA bytes read back by getFilteredLabels. The sensor depth is mapped linearly
+// to the clipping range, as uploaded in doFilter. Keys are computed like octomap's coordToKey for 16 levels.
+const std::string KEY_FRAGMENT_SHADER_SOURCE =
+    "#version 120\n"
+    "uniform sampler2D sensor;"
+    "uniform sampler2D label;"
+    "uniform float near;"
+    "uniform float far;"
+    "uniform vec2 size;"
+    "uniform vec4 intrinsics;"
+    "uniform mat4 map_h_sensor;"
+    "uniform float inverse_resolution;"
+    "void main()"
+    "{"
+    "  vec4 l = floor(texture2D(label, gl_TexCoord[0].st) * 255.0 + 0.5);"
+    "  float category = 0.0;"
+    "  if (l.r + l.g + l.b + l.a == 0.0)"
+    "    category = 1.0;"
+    "  else if (l.r >= 3.0 || l.g + l.b + l.a > 0.0)"
+    "    category = 2.0;"
+    "  float z = near + float(texture2D(sensor, gl_TexCoord[0].st)) * (far - near);"
+    "  vec2 pixel = gl_TexCoord[0].st * size - 0.5;"
+    "  vec4 point = map_h_sensor * vec4((pixel - intrinsics.zw) / intrinsics.xy * z, z, 1.0);"
+    "  gl_FragColor = vec4(clamp(floor(point.xyz * inverse_resolution) + 32768.0, 0.0, 65535.0), category);"
+    "}";
+}  // namespace
+
 mesh_filter::MeshFilterBase::MeshFilterBase(const TransformCallback& transform_callback,
                                             const SensorModel::Parameters& sensor_parameters,
                                             const std::string& render_vertex_shader,
@@ -97,6 +134,16 @@ void mesh_filter::MeshFilterBase::initialize(const std::string& render_vertex_sh
 
   depth_filter_->end();
 
+  key_projector_.reset(new GLRenderer(sensor_parameters_->getWidth(), sensor_parameters_->getHeight(),
+                                      sensor_parameters_->getNearClippingPlaneDistance(),
+                                      sensor_parameters_->getFarClippingPlaneDistance()));
+  key_projector_->setColorFormat(GL_RGBA32F);
+  key_projector_->setShadersFromString(KEY_VERTEX_SHADER_SOURCE, KEY_FRAGMENT_SHADER_SOURCE);
+  key_projector_->begin();
+  glUniform1i(glGetUniformLocation(key_projector_->getProgramID(), "sensor"), 0);
+  glUniform1i(glGetUniformLocation(key_projector_->getProgramID(), "label"), 4);
+  key_projector_->end();
+
   canvas_ = glGenLists(1);
   glNewList(canvas_, GL_COMPILE);
   glBegin(GL_QUADS);
@@ -150,6 +197,7 @@ void mesh_filter::MeshFilterBase::deInitialize()
   meshes_.clear();
   mesh_renderer_.reset();
   depth_filter_.reset();
+  key_projector_.reset();
 }
 
 void mesh_filter::MeshFilterBase::setSize(unsigned int width, unsigned int height)
@@ -260,6 +308,53 @@ void mesh_filter::MeshFilterBase::getFilteredLabels(LabelType* labels) const
   job->wait();
 }
 
+void mesh_filter::MeshFilterBase::getProjectedKeys(float* keys, const Eigen::Isometry3d& map_h_sensor,
+                                                   double resolution, float fx, float fy, float cx, float cy) const
+{
+  // queued after the filter job of the last image, like the other getters. The job is waited for, so it can refer
+  // to the local variables
+  const Eigen::Matrix4f transform = map_h_sensor.matrix().cast<float>();
+  const Eigen::Vector4f intrinsics(fx, fy, cx, cy);
+  JobPtr job(new FilterJob<void>(boost::bind(&MeshFilterBase::projectKeys, this, keys, boost::cref(transform),
+                                             float(1.0 / resolution), boost::cref(intrinsics))));
+  addJob(job);
+  job->wait();
+}
+
+void mesh_filter::MeshFilterBase::projectKeys(float* keys, const Eigen::Matrix4f& map_h_sensor,
+                                              float inverse_resolution, const Eigen::Vector4f& intrinsics) const
+{
+  const unsigned width = sensor_parameters_->getWidth();
+  const unsigned height = sensor_parameters_->getHeight();
+  key_projector_->setBufferSize(width, height);
+  key_projector_->begin();
+  glDisable(GL_DEPTH_TEST);
+  glDisable(GL_CULL_FACE);
+  glDisable(GL_ALPHA_TEST);
+  glDisable(GL_BLEND);
+
+  const GLuint program = key_projector_->getProgramID();
+  glUniform1f(glGetUniformLocation(program, "near"), sensor_parameters_->getNearClippingPlaneDistance());
+  glUniform1f(glGetUniformLocation(program, "far"), sensor_parameters_->getFarClippingPlaneDistance());
+  glUniform2f(glGetUniformLocation(program, "size"), width, height);
+  glUniform4f(glGetUniformLocation(program, "intrinsics"), intrinsics[0], intrinsics[1], intrinsics[2],
+              intrinsics[3]);
+  glUniformMatrix4fv(glGetUniformLocation(program, "map_h_sensor"), 1, GL_FALSE, map_h_sensor.data());
+  glUniform1f(glGetUniformLocation(program, "inverse_resolution"), inverse_resolution);
+
+  // bind sensor depth, as uploaded by doFilter
+  glActiveTexture(GL_TEXTURE0);
+  glBindTexture(GL_TEXTURE_2D, sensor_depth_texture_);
+
+  // bind filtered labels
+  glActiveTexture(GL_TEXTURE4);
+  glBindTexture(GL_TEXTURE_2D, depth_filter_->getColorTexture());
+  glCallList(canvas_);
+  key_projector_->end();
+
+  key_projector_->getFloatColorBuffer(keys);
+}
+
 void mesh_filter::MeshFilterBase::run(const std::string& render_vertex_shader,
                                       const std::string& render_fragment_shader,
                                       const std::string& filter_vertex_shader,
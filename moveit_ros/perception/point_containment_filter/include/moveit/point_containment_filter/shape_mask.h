@@ -74,6 +74,10 @@ public:
 
   void setTransformCallback(const TransformCallback& transform_callback);
 
+  /** \brief Set the number of threads maskContainment() may use. Defaults to 1, as running in parallel
+      with the other perception threads can result in very high CPU consumption. */
+  void setMaxThreads(unsigned int max_threads);
+
   /** \brief Compute the containment mask (INSIDE or OUTSIDE) for a given pointcloud. If a mask element is INSIDE, the
      point
       is inside the robot. The point is outside if the mask element is OUTSIDE.
@@ -121,6 +125,13 @@ protected:
   std::set<SeeShape, SortBodies> bodies_;
   std::vector<bodies::BoundingSphere> bspheres_;
 
+  /** \brief The bodies with a known pose, in the order of bodies_, and their bounding spheres as columns
+      holding center and squared radius. Updated by maskContainment(). */
+  std::vector<const bodies::Body*> posed_bodies_;
+  Eigen::Matrix<double, 4, Eigen::Dynamic> body_spheres_;
+
+  unsigned int max_threads_;
+
 private:
   /** \brief Free memory. */
   void freeMemory();
@@ -38,11 +38,12 @@
 #include <geometric_shapes/body_operations.h>
 #include <ros/console.h>
 #include <sensor_msgs/point_cloud2_iterator.h>
+#include <algorithm>
 
 static const std::string LOGNAME = "shape_mask";
 
 point_containment_filter::ShapeMask::ShapeMask(const TransformCallback& transform_callback)
-  : transform_callback_(transform_callback), next_handle_(1), min_handle_(1)
+  : transform_callback_(transform_callback), max_threads_(1), next_handle_(1), min_handle_(1)
 {
 }
 
@@ -64,6 +65,12 @@ void point_containment_filter::ShapeMask::setTransformCallback(const TransformCa
   transform_callback_ = transform_callback;
 }
 
+void point_containment_filter::ShapeMask::setMaxThreads(unsigned int max_threads)
+{
+  boost::mutex::scoped_lock _(shapes_lock_);
+  max_threads_ = std::max(max_threads, 1u);
+}
+
 point_containment_filter::ShapeHandle point_containment_filter::ShapeMask::addShape(const shapes::ShapeConstPtr& shape,
                                                                                     double scale, double padding)
 {
@@ -129,6 +136,7 @@ void point_containment_filter::ShapeMask::maskContainment(const sensor_msgs::Poi
   {
     Eigen::Isometry3d tmp;
     bspheres_.resize(bodies_.size());
+    posed_bodies_.resize(bodies_.size());
     std::size_t j = 0;
     for (std::set<SeeShape>::const_iterator it = bodies_.begin(); it != bodies_.end(); ++it)
     {
@@ -143,9 +151,17 @@ void point_containment_filter::ShapeMask::maskContainment(const sensor_msgs::Poi
       else
       {
         it->body->setPose(tmp);
-        it->body->computeBoundingSphere(bspheres_[j++]);
+        it->body->computeBoundingSphere(bspheres_[j]);
+        posed_bodies_[j++] = it->body;
       }
     }
+    bspheres_.resize(j);
+    posed_bodies_.resize(j);
+
+    // the bounding spheres of the bodies as columns (center, squared radius), for a cheap test before containsPoint()
+    body_spheres_.resize(4, j);
+    for (std::size_t k = 0; k < j; ++k)
+      body_spheres_.col(k) << bspheres_[k].center, bspheres_[k].radius * bspheres_[k].radius;
 
     // compute a sphere that bounds the entire robot
     bodies::BoundingSphere bound;
@@ -158,8 +174,8 @@ void point_containment_filter::ShapeMask::maskContainment(const sensor_msgs::Poi
     sensor_msgs::PointCloud2ConstIterator<float> iter_z(data_in, "z");
 
     // Cloud iterators are not incremented in the for loop, because of the pragma
-    // Comment out below parallelization as it can result in very high CPU consumption
-    //#pragma omp parallel for schedule(dynamic)
+    // Parallelization is opt-in (setMaxThreads()) as it can result in very high CPU consumption
+#pragma omp parallel for schedule(dynamic, 1024) num_threads(max_threads_) if (max_threads_ > 1)
     for (int i = 0; i < (int)np; ++i)
     {
       Eigen::Vector3d pt = Eigen::Vector3d(*(iter_x + i), *(iter_y + i), *(iter_z + i));
@@ -168,9 +184,12 @@ void point_containment_filter::ShapeMask::maskContainment(const sensor_msgs::Poi
       if (d < min_sensor_dist || d > max_sensor_dist)
         out = CLIP;
       else if ((bound.center - pt).squaredNorm() < radius_squared)
-        for (std::set<SeeShape>::const_iterator it = bodies_.begin(); it != bodies_.end() && out == OUTSIDE; ++it)
-          if (it->body->containsPoint(pt))
+      {
+        for (std::size_t k = 0; k < posed_bodies_.size() && out == OUTSIDE; ++k)
+          if ((body_spheres_.col(k).head<3>() - pt).squaredNorm() <= body_spheres_(3, k) &&
+              posed_bodies_[k]->containsPoint(pt))
             out = INSIDE;
+      }
       mask[i] = out;
     }
   }
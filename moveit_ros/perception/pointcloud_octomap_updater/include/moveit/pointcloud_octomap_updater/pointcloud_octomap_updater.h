@@ -43,8 +43,10 @@
 #include <sensor_msgs/PointCloud2.h>
 #include <moveit/occupancy_map_monitor/occupancy_map_updater.h>
 #include <moveit/point_containment_filter/shape_mask.h>
+#include <moveit/lazy_free_space_updater/lazy_free_space_updater.h>
 
 #include <memory>
+#include <vector>
 
 namespace occupancy_map_monitor
 {
@@ -85,6 +87,8 @@ private:
   double padding_;
   double max_range_;
   unsigned int point_subsample_;
+  unsigned int self_filter_threads_;
+  bool lazy_free_space_update_;
   double max_update_rate_;
   std::string filtered_cloud_topic_;
   ros::Publisher filtered_cloud_publisher_;
@@ -92,11 +96,27 @@ private:
   message_filters::Subscriber<sensor_msgs::PointCloud2>* point_cloud_subscriber_;
   tf2_ros::MessageFilter<sensor_msgs::PointCloud2>* point_cloud_filter_;
 
-  /* used to store all cells in the map which a given ray passes through during raycasting.
-     we cache this here because it dynamically pre-allocates a lot of memory in its contsructor */
-  octomap::KeyRay key_ray_;
+  /* cells found by one thread of cloudMsgCallback() */
+  struct ThreadCells
+  {
+    octomap::KeySet occupied;
+    octomap::KeySet model;
+    octomap::KeySet clip;
+    octomap::KeySet free;
+    /* used to store all cells in the map which a given ray passes through during raycasting.
+       we cache this here because it dynamically pre-allocates a lot of memory in its contsructor */
+    octomap::KeyRay key_ray;
+  };
+  std::vector<ThreadCells> thread_cells_;
+
+  /* per cloud buffers, kept to avoid reallocating them for every cloud */
+  OccMapUpdate cells_;
+  std::vector<octomap::OcTreeKey> ray_endpoints_;
 
   std::unique_ptr<point_containment_filter::ShapeMask> shape_mask_;
+
+  /* clears the free space in a background thread if lazy_free_space_update is set */
+  std::unique_ptr<LazyFreeSpaceUpdater> lazy_free_space_updater_;
   std::vector<int> mask_;
 };
 }  // namespace occupancy_map_monitor
@@ -42,7 +42,10 @@
 #include <tf2/LinearMath/Transform.h>
 #include <sensor_msgs/point_cloud2_iterator.h>
 #include <XmlRpcException.h>
+#include <omp.h>
 
+#include <algorithm>
+#include <atomic>
 #include <memory>
 
 namespace occupancy_map_monitor
@@ -55,6 +58,8 @@ PointCloudOctomapUpdater::PointCloudOctomapUpdater()
   , padding_(0.0)
   , max_range_(std::numeric_limits<double>::infinity())
   , point_subsample_(1)
+  , self_filter_threads_(1)
+  , lazy_free_space_update_(false)
   , max_update_rate_(0)
   , point_cloud_subscriber_(nullptr)
   , point_cloud_filter_(nullptr)
@@ -78,6 +83,9 @@ bool PointCloudOctomapUpdater::setParams(XmlRpc::XmlRpcValue& params)
     readXmlParam(params, "padding_offset", &padding_);
     readXmlParam(params, "padding_scale", &scale_);
     readXmlParam(params, "point_subsample", &point_subsample_);
+    readXmlParam(params, "self_filter_threads", &self_filter_threads_);
+    if (params.hasMember("lazy_free_space_update"))
+      lazy_free_space_update_ = static_cast<bool>(params["lazy_free_space_update"]);
     if (params.hasMember("max_update_rate"))
       readXmlParam(params, "max_update_rate", &max_update_rate_);
     if (params.hasMember("filtered_cloud_topic"))
@@ -98,6 +106,9 @@ bool PointCloudOctomapUpdater::initialize()
   tf_listener_.reset(new tf2_ros::TransformListener(*tf_buffer_, root_nh_));
   shape_mask_.reset(new point_containment_filter::ShapeMask());
   shape_mask_->setTransformCallback(boost::bind(&PointCloudOctomapUpdater::getShapeTransform, this, _1, _2));
+  shape_mask_->setMaxThreads(self_filter_threads_);
+  if (lazy_free_space_update_)
+    lazy_free_space_updater_.reset(new LazyFreeSpaceUpdater(tree_));
   if (!filtered_cloud_topic_.empty())
     filtered_cloud_publisher_ = private_nh_.advertise<sensor_msgs::PointCloud2>(filtered_cloud_topic_, 10, false);
   return true;
@@ -223,7 +234,14 @@ void PointCloudOctomapUpdater::cloudMsgCallback(const sensor_msgs::PointCloud2::
   shape_mask_->maskContainment(*cloud_msg, sensor_origin_eigen, 0.0, max_range_, mask_);
   updateMask(*cloud_msg, sensor_origin_eigen, mask_);
 
-  octomap::KeySet free_cells, occupied_cells, model_cells, clip_cells;
+  /* the cell sets are members so that their buckets are reused from one cloud to the next, unless the monitor
+     queues them */
+  octomap::KeySet& free_cells = cells_.free_cells;
+  octomap::KeySet& occupied_cells = cells_.occupied_cells;
+  octomap::KeySet& model_cells = cells_.model_cells;
+  free_cells.clear();
+  occupied_cells.clear();
+  model_cells.clear();
   std::unique_ptr<sensor_msgs::PointCloud2> filtered_cloud;
 
   // We only use these iterators if we are creating a filtered_cloud for
@@ -248,78 +266,166 @@ void PointCloudOctomapUpdater::cloudMsgCallback(const sensor_msgs::PointCloud2::
   }
   size_t filtered_cloud_size = 0;
 
+  /* transform into the map frame with Eigen, which vectorizes the fixed size products */
+  const tf2::Matrix3x3& basis = map_h_sensor.getBasis();
+  Eigen::Matrix3d map_r_sensor;
+  map_r_sensor << basis[0][0], basis[0][1], basis[0][2], basis[1][0], basis[1][1], basis[1][2], basis[2][0],
+      basis[2][1], basis[2][2];
+
+  const int num_threads = std::max(omp_get_max_threads(), 1);
+  if (thread_cells_.size() < static_cast<std::size_t>(num_threads))
+    thread_cells_.resize(num_threads);
+  for (ThreadCells& cells : thread_cells_)
+  {
+    cells.occupied.clear();
+    cells.model.clear();
+    cells.clip.clear();
+    cells.free.clear();
+  }
+  std::atomic<bool> failed(false);
+
   tree_->lockRead();
 
-  try
+  /* find the cells this point cloud indicates should be occupied, each thread handling a share of the rows */
+  const int num_rows = (cloud_msg->height + point_subsample_ - 1) / point_subsample_;
+#pragma omp parallel for schedule(static) num_threads(num_threads)
+  for (int row_index = 0; row_index < num_rows; ++row_index)
   {
-    /* do ray tracing to find which cells this point cloud indicates should be free, and which it indicates
-     * should be occupied */
-    for (unsigned int row = 0; row < cloud_msg->height; row += point_subsample_)
+    if (failed)
+      continue;
+    ThreadCells& cells = thread_cells_[omp_get_thread_num()];
+    try
     {
-      unsigned int row_c = row * cloud_msg->width;
+      const unsigned int row_c = row_index * point_subsample_ * cloud_msg->width;
       sensor_msgs::PointCloud2ConstIterator<float> pt_iter(*cloud_msg, "x");
       // set iterator to point at start of the current row
       pt_iter += row_c;
 
+      /* neighboring points mostly fall into the same voxel, skip the hash lookup for those */
+      octomap::OcTreeKey last_key;
+      int last_mask = -1;
+
       for (unsigned int col = 0; col < cloud_msg->width; col += point_subsample_, pt_iter += point_subsample_)
       {
-        // if (mask_[row_c + col] == point_containment_filter::ShapeMask::CLIP)
-        //  continue;
-
         /* check for NaN */
-        if (!std::isnan(pt_iter[0]) && !std::isnan(pt_iter[1]) && !std::isnan(pt_iter[2]))
-        {
-          /* transform to map frame */
-          tf2::Vector3 point_tf = map_h_sensor * tf2::Vector3(pt_iter[0], pt_iter[1], pt_iter[2]);
-
-          /* occupied cell at ray endpoint if ray is shorter than max range and this point
-             isn't on a part of the robot*/
-          if (mask_[row_c + col] == point_containment_filter::ShapeMask::INSIDE)
-            model_cells.insert(tree_->coordToKey(point_tf.getX(), point_tf.getY(), point_tf.getZ()));
-          else if (mask_[row_c + col] == point_containment_filter::ShapeMask::CLIP)
-            clip_cells.insert(tree_->coordToKey(point_tf.getX(), point_tf.getY(), point_tf.getZ()));
-          else
-          {
-            occupied_cells.insert(tree_->coordToKey(point_tf.getX(), point_tf.getY(), point_tf.getZ()));
-            // build list of valid points if we want to publish them
-            if (filtered_cloud)
-            {
-              **iter_filtered_x = pt_iter[0];
-              **iter_filtered_y = pt_iter[1];
-              **iter_filtered_z = pt_iter[2];
-              ++filtered_cloud_size;
-              ++*iter_filtered_x;
-              ++*iter_filtered_y;
-              ++*iter_filtered_z;
-            }
-          }
-        }
+        if (std::isnan(pt_iter[0]) || std::isnan(pt_iter[1]) || std::isnan(pt_iter[2]))
+          continue;
+
+        /* occupied cell at ray endpoint if ray is shorter than max range and this point
+           isn't on a part of the robot*/
+        const Eigen::Vector3d point = map_r_sensor * Eigen::Vector3d(pt_iter[0], pt_iter[1], pt_iter[2]) +
+                                      sensor_origin_eigen;
+        const octomap::OcTreeKey key = tree_->coordToKey(point.x(), point.y(), point.z());
+        const int mask = mask_[row_c + col];
+        if (mask == last_mask && key == last_key)
+          continue;
+        last_key = key;
+        last_mask = mask;
+
+        if (mask == point_containment_filter::ShapeMask::INSIDE)
+          cells.model.insert(key);
+        else if (mask == point_containment_filter::ShapeMask::CLIP)
+          cells.clip.insert(key);
+        else
+          cells.occupied.insert(key);
       }
     }
+    catch (...)
+    {
+      failed = true;
+    }
+  }
 
-    /* compute the free cells along each ray that ends at an occupied cell */
-    for (const octomap::OcTreeKey& occupied_cell : occupied_cells)
-      if (tree_->computeRayKeys(sensor_origin, tree_->keyToCoord(occupied_cell), key_ray_))
-        free_cells.insert(key_ray_.begin(), key_ray_.end());
+  /* clipped cells are only needed as ray endpoints, reuse the first thread's set to merge them */
+  octomap::KeySet& clip_cells = thread_cells_[0].clip;
+  if (!failed)
+  {
+    for (int thread = 0; thread < num_threads; ++thread)
+    {
+      occupied_cells.insert(thread_cells_[thread].occupied.begin(), thread_cells_[thread].occupied.end());
+      model_cells.insert(thread_cells_[thread].model.begin(), thread_cells_[thread].model.end());
+    }
+    for (int thread = 1; thread < num_threads; ++thread)
+      clip_cells.insert(thread_cells_[thread].clip.begin(), thread_cells_[thread].clip.end());
+  }
 
-    /* compute the free cells along each ray that ends at a model cell */
+  /* rays end at occupied, model and clipped cells alike; cast a single ray per voxel.
+     With lazy updates, the rays are cast later by the lazy free space updater instead */
+  std::vector<octomap::OcTreeKey>& endpoints = ray_endpoints_;
+  endpoints.clear();
+  if (!failed && !lazy_free_space_updater_)
+  {
+    endpoints.insert(endpoints.end(), occupied_cells.begin(), occupied_cells.end());
     for (const octomap::OcTreeKey& model_cell : model_cells)
-      if (tree_->computeRayKeys(sensor_origin, tree_->keyToCoord(model_cell), key_ray_))
-        free_cells.insert(key_ray_.begin(), key_ray_.end());
-
-    /* compute the free cells along each ray that ends at a clipped cell */
+      if (occupied_cells.find(model_cell) == occupied_cells.end())
+        endpoints.push_back(model_cell);
     for (const octomap::OcTreeKey& clip_cell : clip_cells)
-      if (tree_->computeRayKeys(sensor_origin, tree_->keyToCoord(clip_cell), key_ray_))
-        free_cells.insert(key_ray_.begin(), key_ray_.end());
+      if (occupied_cells.find(clip_cell) == occupied_cells.end() && model_cells.find(clip_cell) == model_cells.end())
+        endpoints.push_back(clip_cell);
   }
-  catch (...)
+
+  /* do ray tracing to find which cells this point cloud indicates should be free */
+  const int num_endpoints = endpoints.size();
+#pragma omp parallel for schedule(dynamic, 64) num_threads(num_threads)
+  for (int i = 0; i < num_endpoints; ++i)
   {
-    tree_->unlockRead();
-    return;
+    if (failed)
+      continue;
+    ThreadCells& cells = thread_cells_[omp_get_thread_num()];
+    try
+    {
+      if (tree_->computeRayKeys(sensor_origin, tree_->keyToCoord(endpoints[i]), cells.key_ray))
+        cells.free.insert(cells.key_ray.begin(), cells.key_ray.end());
+    }
+    catch (...)
+    {
+      failed = true;
+    }
   }
 
   tree_->unlockRead();
 
+  if (failed)
+    return;
+
+  if (lazy_free_space_updater_)
+  {
+    /* the lazy updater does not distinguish clipped cells, their rays clear the free space like those to occupied
+       cells; it takes ownership of the sets */
+    octomap::KeySet* lazy_occupied_cells = new octomap::KeySet(occupied_cells);
+    lazy_occupied_cells->insert(clip_cells.begin(), clip_cells.end());
+    lazy_free_space_updater_->pushLazyUpdate(lazy_occupied_cells, new octomap::KeySet(model_cells), sensor_origin);
+  }
+
+  for (int thread = 0; thread < num_threads; ++thread)
+    free_cells.insert(thread_cells_[thread].free.begin(), thread_cells_[thread].free.end());
+
+  /* build list of valid points if we want to publish them */
+  if (filtered_cloud)
+  {
+    for (unsigned int row = 0; row < cloud_msg->height; row += point_subsample_)
+    {
+      unsigned int row_c = row * cloud_msg->width;
+      sensor_msgs::PointCloud2ConstIterator<float> pt_iter(*cloud_msg, "x");
+      pt_iter += row_c;
+
+      for (unsigned int col = 0; col < cloud_msg->width; col += point_subsample_, pt_iter += point_subsample_)
+      {
+        if (std::isnan(pt_iter[0]) || std::isnan(pt_iter[1]) || std::isnan(pt_iter[2]) ||
+            mask_[row_c + col] == point_containment_filter::ShapeMask::INSIDE ||
+            mask_[row_c + col] == point_containment_filter::ShapeMask::CLIP)
+          continue;
+        **iter_filtered_x = pt_iter[0];
+        **iter_filtered_y = pt_iter[1];
+        **iter_filtered_z = pt_iter[2];
+        ++filtered_cloud_size;
+        ++*iter_filtered_x;
+        ++*iter_filtered_y;
+        ++*iter_filtered_z;
+      }
+    }
+  }
+
   /* cells that overlap with the model are not occupied */
   for (const octomap::OcTreeKey& model_cell : model_cells)
     occupied_cells.erase(model_cell);
@@ -328,30 +434,9 @@ void PointCloudOctomapUpdater::cloudMsgCallback(const sensor_msgs::PointCloud2::
   for (const octomap::OcTreeKey& occupied_cell : occupied_cells)
     free_cells.erase(occupied_cell);
 
-  tree_->lockWrite();
-
-  try
-  {
-    /* mark free cells only if not seen occupied in this cloud */
-    for (const octomap::OcTreeKey& free_cell : free_cells)
-      tree_->updateNode(free_cell, false);
-
-    /* now mark all occupied cells */
-    for (const octomap::OcTreeKey& occupied_cell : occupied_cells)
-      tree_->updateNode(occupied_cell, true);
-
-    // set the logodds to the minimum for the cells that are part of the model
-    const float lg = tree_->getClampingThresMinLog() - tree_->getClampingThresMaxLog();
-    for (const octomap::OcTreeKey& model_cell : model_cells)
-      tree_->updateNode(model_cell, lg);
-  }
-  catch (...)
-  {
-    ROS_ERROR_NAMED(LOGNAME, "Internal error while updating octree");
-  }
-  tree_->unlockWrite();
+  /* mark free cells, occupied cells and the cells of the model, possibly batched with other sensors */
+  monitor_->queueUpdate(cells_);
   ROS_DEBUG_NAMED(LOGNAME, "Processed point cloud in %lf ms", (ros::WallTime::now() - start).toSec() * 1000.0);
-  tree_->triggerUpdateCallback();
 
   if (filtered_cloud)
   {
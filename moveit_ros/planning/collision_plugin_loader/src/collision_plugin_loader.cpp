@@ -70,23 +70,15 @@ public:
     return plugin;
   }
 
-  bool activate(const std::string& name, const planning_scene::PlanningScenePtr& scene, bool exclusive)
+  bool activate(const std::string& name, const planning_scene::PlanningScenePtr& scene, bool exclusive,
+                const rclcpp::Node::SharedPtr& node = nullptr)
   {
     std::map<std::string, CollisionPluginPtr>::iterator it = plugins_.find(name);
-    if (it == plugins_.end())
-    {
-      CollisionPluginPtr plugin = load(name);
-      if (plugin)
-      {
-        return plugin->initialize(scene, exclusive);
-      }
+    CollisionPluginPtr plugin = it == plugins_.end() ? load(name) : it->second;
+    if (!plugin)
       return false;
-    }
-    if (it->second)
-    {
-      return it->second->initialize(scene, exclusive);
-    }
-    return false;
+    // plugins read their parameters from the node, if there is one
+    return node ? plugin->initialize(node, scene, exclusive) : plugin->initialize(scene, exclusive);
   }
 
 private:
@@ -137,7 +129,7 @@ void CollisionPluginLoader::setupScene(const rclcpp::Node::SharedPtr& node,
     return;
   }
 
-  activate(collision_detector_name, scene, true);
+  loader_->activate(collision_detector_name, scene, true, node);
   RCLCPP_INFO(LOGGER, "Using collision detector: %s", scene->getActiveCollisionDetectorName().c_str());
 }
 
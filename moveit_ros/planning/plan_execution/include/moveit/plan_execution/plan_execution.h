@@ -42,6 +42,8 @@
 #include <moveit/planning_scene_monitor/planning_scene_monitor.h>
 #include <moveit/planning_scene_monitor/trajectory_monitor.h>
 #include <moveit/sensor_manager/sensor_manager.h>
+#include <moveit/collision_detection/world_diff.h>
+#include <moveit/robot_model/aabb.h>
 #include <pluginlib/class_loader.hpp>
 
 /** \brief This namespace includes functionality specific to the execution and monitoring of motion plans */
@@ -54,7 +56,7 @@ class PlanExecution
 public:
   struct Options
   {
-    Options() : replan_(false), replan_attempts_(0), replan_delay_(0.0)
+    Options() : replan_(false), replan_attempts_(0), replan_delay_(0.0), local_repair_lookahead_(0.5)
     {
     }
 
@@ -83,6 +85,19 @@ public:
     boost::function<bool(ExecutableMotionPlan& plan_to_update, const std::pair<int, int>& trajectory_index)>
         repair_plan_callback_;
 
+    /// Callback for planning a motion that replaces part of a trajectory. This is optional. If specified, a remaining
+    /// path that becomes invalid during execution is first repaired locally, without stopping for a full replan: a
+    /// segment is planned from the waypoint local_repair_lookahead_ seconds ahead of the expected robot state to the
+    /// first valid waypoint after the invalid part, and spliced into the trajectory, which is retimed from the start
+    /// of the segment. If the repair fails, execution stops and the plan is recomputed as usual.
+    boost::function<bool(ExecutableMotionPlan& plan, const moveit::core::RobotState& start,
+                         const moveit::core::RobotState& goal, robot_trajectory::RobotTrajectoryPtr& segment)>
+        local_repair_callback_;
+
+    /// How far ahead of the expected robot state (in seconds) a local repair starts. The repair has to be planned in
+    /// less time than this.
+    double local_repair_lookahead_;
+
     boost::function<void()> before_plan_callback_;
     boost::function<void()> before_execution_callback_;
     boost::function<void()> done_callback_;
@@ -136,6 +151,10 @@ public:
       start of the method. They are then used to monitor the execution. */
   moveit_msgs::msg::MoveItErrorCodes executeAndMonitor(ExecutableMotionPlan& plan);
 
+  /** \brief Execute and monitor a previously created \e plan, repairing the remaining path locally with
+      \e opt.local_repair_callback_ if it becomes invalid during execution. */
+  moveit_msgs::msg::MoveItErrorCodes executeAndMonitor(ExecutableMotionPlan& plan, const Options& opt);
+
   void stop();
 
   std::string getErrorCodeString(const moveit_msgs::msg::MoveItErrorCodes& error_code);
@@ -143,6 +162,27 @@ public:
 private:
   void planAndExecuteHelper(ExecutableMotionPlan& plan, const Options& opt);
   bool isRemainingPathValid(const ExecutableMotionPlan& plan, const std::pair<int, int>& path_segment);
+  bool isWayPointValid(const ExecutableMotionPlan& plan, std::size_t component, std::size_t index, bool verbose) const;
+
+  /** \brief Push the trajectories of the plan components, starting with \e first_component, to the trajectory
+      execution manager */
+  bool pushTrajectories(ExecutableMotionPlan& plan, std::size_t first_component);
+
+  /** \brief Replace the invalid part of the trajectory component being executed with a segment planned by
+      \e opt.local_repair_callback_. \e first_component is the plan component the trajectory execution manager
+      started with. On success, the component holds the repaired remaining motion, starting at the state the robot
+      is expected to be in. */
+  bool repairRemainingPath(ExecutableMotionPlan& plan, const Options& opt, const std::pair<int, int>& path_segment,
+                           std::size_t first_component);
+
+  /** \brief Mark the waypoints of the plan component being executed whose validity may have changed with the
+      scene updates received since the last call. Only waypoints for which the box swept by the robot overlaps a
+      changed world object are marked, unless the update can affect any waypoint (e.g., transforms changed). */
+  void markChangedWayPoints(const ExecutableMotionPlan& plan, const std::pair<int, int>& path_segment);
+
+  /** \brief Check the marked waypoints of the remaining path, closest to the robot first, at most
+      MAX_WAYPOINT_CHECKS_PER_CYCLE of them per call. Return false if one of them is invalid. */
+  bool areChangedWayPointsValid(const ExecutableMotionPlan& plan, const std::pair<int, int>& path_segment);
 
   void planningSceneUpdatedCallback(const planning_scene_monitor::PlanningSceneMonitor::SceneUpdateType update_type);
   void doneWithTrajectoryExecution(const moveit_controller_manager::ExecutionStatus& status);
@@ -161,6 +201,16 @@ private:
   bool execution_complete_;
   bool path_became_invalid_;
 
+  // changes to the world of the scene the executing plan is checked against, if it is the monitored scene
+  collision_detection::WorldDiffPtr world_diff_;
+  // set by scene updates that may change the validity of any waypoint
+  bool full_path_check_;
+  // the plan component the waypoint boxes are computed for, -1 if none
+  int checked_component_;
+  // the box swept by the robot around each waypoint of the checked component, and whether it needs to be checked
+  std::vector<moveit::core::AABB> waypoint_boxes_;
+  std::vector<bool> waypoints_to_check_;
+
   // class DynamicReconfigureImpl;
   // DynamicReconfigureImpl* reconfigure_impl_;
 };
@@ -42,6 +42,7 @@
 
 #include <moveit/planning_scene_monitor/trajectory_monitor.h>
 #include <moveit/sensor_manager/sensor_manager.h>
+#include <moveit/collision_detection/world_diff.h>
 #include <pluginlib/class_loader.hpp>
 
 #include <memory>
@@ -105,6 +106,31 @@ public:
     discard_overlapping_cost_sources_ = value;
   }
 
+  /** \brief Whether to start planning again as soon as the sensor starts moving, on the scene information available
+      so far. The new plan is evaluated once the look motion is done and new sensor data has arrived, and computed
+      again if planning failed. By default, planning waits for the sensor to reach its target. */
+  void setPlanWhileLooking(bool flag)
+  {
+    plan_while_looking_ = flag;
+  }
+
+  bool getPlanWhileLooking() const
+  {
+    return plan_while_looking_;
+  }
+
+  /** \brief When planning while looking, how long to wait for new sensor data after the sensor reached its target
+      (seconds) */
+  void setSensorUpdateTimeout(double timeout)
+  {
+    sensor_update_timeout_ = timeout;
+  }
+
+  double getSensorUpdateTimeout() const
+  {
+    return sensor_update_timeout_;
+  }
+
   void setBeforeLookCallback(const boost::function<void()>& callback)
   {
     before_look_callback_ = callback;
@@ -113,7 +139,13 @@ public:
   void displayCostSources(bool flag);
 
 private:
-  bool lookAt(const std::set<collision_detection::CostSource>& cost_sources, const std::string& frame_id);
+  /** \brief Point a sensor at the cost sources. If \e wait is false and the look motion does not move any of the
+      \e planned_joints, the motion is only started and waitForLook() needs to be called. */
+  bool lookAt(const std::set<collision_detection::CostSource>& cost_sources, const std::string& frame_id, bool wait,
+              const std::set<std::string>& planned_joints = std::set<std::string>());
+
+  /** \brief Wait for the look motion started by lookAt() and for the world of the monitored scene to change */
+  bool waitForLook(const ExecutableMotionPlan& plan);
 
   std::shared_ptr<rclcpp::Node> node_;
   trajectory_execution_manager::TrajectoryExecutionManagerPtr trajectory_execution_manager_;
@@ -127,6 +159,9 @@ private:
   unsigned int max_cost_sources_;
 
   bool display_cost_sources_;
+  bool plan_while_looking_;
+  double sensor_update_timeout_;
+  bool look_motion_started_;
   rclcpp::Publisher<visualization_msgs::msg::MarkerArray>::SharedPtr cost_sources_publisher_;
 
   boost::function<void()> before_look_callback_;
@@ -38,8 +38,10 @@
 #include <moveit/plan_execution/plan_execution.h>
 #include <moveit/robot_state/conversions.h>
 #include <moveit/trajectory_processing/trajectory_tools.h>
+#include <moveit/trajectory_processing/iterative_spline_parameterization.h>
 #include <moveit/collision_detection/collision_tools.h>
 #include <moveit/utils/message_checks.h>
+#include <geometric_shapes/shape_operations.h>
 #include <boost/algorithm/string/join.hpp>
 
 // #include <dynamic_reconfigure/server.h>
@@ -49,6 +51,11 @@ namespace plan_execution
 {
 static const rclcpp::Logger LOGGER = rclcpp::get_logger("moveit_ros.plan_execution");
 
+// the most waypoints of the remaining path checked per monitoring cycle (100 Hz), closest to the robot first, so that
+// frequent scene updates (e.g., octomaps) do not use up a core; waypoints that remain marked are checked in the
+// following cycles
+static const std::size_t MAX_WAYPOINT_CHECKS_PER_CYCLE = 20;
+
 // class PlanExecution::DynamicReconfigureImpl
 // {
 // public:
@@ -84,6 +91,8 @@ plan_execution::PlanExecution::PlanExecution(
 
   preempt_requested_ = false;
   new_scene_update_ = false;
+  full_path_check_ = false;
+  checked_component_ = -1;
 
   // we want to be notified when new information is available
   planning_scene_monitor_->addUpdateCallback(
@@ -223,7 +232,7 @@ void plan_execution::PlanExecution::planAndExecuteHelper(ExecutableMotionPlan& p
         break;
 
       // execute the trajectory, and monitor its executionm
-      plan.error_code_ = executeAndMonitor(plan);
+      plan.error_code_ = executeAndMonitor(plan, opt);
     }
 
     // if we are done, then we exit the loop
@@ -277,42 +286,259 @@ bool plan_execution::PlanExecution::isRemainingPathValid(const ExecutableMotionP
                                                                                          // does not modify the world
                                                                                          // representation while
                                                                                          // isStateValid() is called
-    const robot_trajectory::RobotTrajectory& t = *plan.plan_components_[path_segment.first].trajectory_;
-    const collision_detection::AllowedCollisionMatrix* acm =
-        plan.plan_components_[path_segment.first].allowed_collision_matrix_.get();
-    std::size_t wpc = t.getWayPointCount();
-    collision_detection::CollisionRequest req;
-    req.group_name = t.getGroupName();
+    std::size_t wpc = plan.plan_components_[path_segment.first].trajectory_->getWayPointCount();
     for (std::size_t i = std::max(path_segment.second - 1, 0); i < wpc; ++i)
-    {
-      collision_detection::CollisionResult res;
-      if (acm)
-        plan.planning_scene_->checkCollisionUnpadded(req, res, t.getWayPoint(i), *acm);
-      else
-        plan.planning_scene_->checkCollisionUnpadded(req, res, t.getWayPoint(i));
-
-      if (res.collision || !plan.planning_scene_->isStateFeasible(t.getWayPoint(i), false))
+      if (!isWayPointValid(plan, path_segment.first, i, false))
       {
         // Dave's debacle
         RCLCPP_INFO(LOGGER, "Trajectory component '%s' is invalid",
                     plan.plan_components_[path_segment.first].description_.c_str());
 
         // call the same functions again, in verbose mode, to show what issues have been detected
-        plan.planning_scene_->isStateFeasible(t.getWayPoint(i), true);
-        req.verbose = true;
-        res.clear();
-        if (acm)
-          plan.planning_scene_->checkCollisionUnpadded(req, res, t.getWayPoint(i), *acm);
-        else
-          plan.planning_scene_->checkCollisionUnpadded(req, res, t.getWayPoint(i));
+        isWayPointValid(plan, path_segment.first, i, true);
         return false;
       }
+  }
+  return true;
+}
+
+bool plan_execution::PlanExecution::isWayPointValid(const ExecutableMotionPlan& plan, std::size_t component,
+                                                    std::size_t index, bool verbose) const
+{
+  const robot_trajectory::RobotTrajectory& t = *plan.plan_components_[component].trajectory_;
+  const collision_detection::AllowedCollisionMatrix* acm =
+      plan.plan_components_[component].allowed_collision_matrix_.get();
+  collision_detection::CollisionRequest req;
+  req.group_name = t.getGroupName();
+  req.verbose = verbose;
+  collision_detection::CollisionResult res;
+  if (acm)
+    plan.planning_scene_->checkCollisionUnpadded(req, res, t.getWayPoint(index), *acm);
+  else
+    plan.planning_scene_->checkCollisionUnpadded(req, res, t.getWayPoint(index));
+  if (verbose)
+    // report both kinds of issues
+    return plan.planning_scene_->isStateFeasible(t.getWayPoint(index), true) && !res.collision;
+  return !res.collision && plan.planning_scene_->isStateFeasible(t.getWayPoint(index), false);
+}
+
+bool plan_execution::PlanExecution::repairRemainingPath(ExecutableMotionPlan& plan, const Options& opt,
+                                                        const std::pair<int, int>& path_segment,
+                                                        std::size_t first_component)
+{
+  if (path_segment.first < 0 || !plan.plan_components_[path_segment.first].trajectory_monitoring_)
+    return false;
+  ExecutableTrajectory& component = plan.plan_components_[path_segment.first];
+  const robot_trajectory::RobotTrajectory& t = *component.trajectory_;
+  const std::size_t wpc = t.getWayPointCount();
+  const std::size_t current = std::max(path_segment.second, 0);
+  if (current >= wpc)
+    return false;
+
+  // the segment starts at the first waypoint the robot is expected to reach after the lookahead time
+  const double start_time = t.getWayPointDurationFromStart(current) + opt.local_repair_lookahead_;
+  std::size_t start = current;
+  while (start + 1 < wpc && t.getWayPointDurationFromStart(start) < start_time)
+    ++start;
+
+  // the segment ends at the first valid waypoint after the invalid part
+  std::size_t first_invalid = wpc;
+  std::size_t goal = wpc;
+  {
+    planning_scene_monitor::LockedPlanningSceneRO lscene(plan.planning_scene_monitor_);
+    for (std::size_t i = current; i < wpc; ++i)
+      if (!isWayPointValid(plan, path_segment.first, i, false))
+      {
+        first_invalid = i;
+        break;
+      }
+    if (first_invalid <= start)
+    {
+      RCLCPP_INFO(LOGGER, "Trajectory component '%s' becomes invalid too soon to be repaired locally",
+                  component.description_.c_str());
+      return false;
+    }
+    for (std::size_t i = first_invalid + 1; i < wpc; ++i)
+      if (isWayPointValid(plan, path_segment.first, i, false))
+      {
+        goal = i;
+        break;
+      }
+  }
+  if (goal >= wpc)
+  {
+    RCLCPP_INFO(LOGGER, "The end of trajectory component '%s' is invalid, it cannot be repaired locally",
+                component.description_.c_str());
+    return false;
+  }
+
+  RCLCPP_INFO(LOGGER, "Repairing waypoints %zu to %zu of trajectory component '%s'", start, goal,
+              component.description_.c_str());
+  robot_trajectory::RobotTrajectoryPtr segment;
+  if (!opt.local_repair_callback_(plan, t.getWayPoint(start), t.getWayPoint(goal), segment) || !segment ||
+      segment->empty())
+  {
+    RCLCPP_INFO(LOGGER, "Unable to plan a local repair of trajectory component '%s'", component.description_.c_str());
+    return false;
+  }
+
+  // retime the motion from the start of the segment on, keeping the velocity and acceleration the robot is expected
+  // to have at its start
+  robot_trajectory::RobotTrajectory tail(t.getRobotModel(), t.getGroup());
+  tail.addSuffixWayPoint(t.getWayPoint(start), 0.0);
+  for (std::size_t i = 1; i + 1 < segment->getWayPointCount(); ++i)
+    tail.addSuffixWayPoint(segment->getWayPoint(i), 0.0);
+  for (std::size_t i = goal; i < wpc; ++i)
+    tail.addSuffixWayPoint(t.getWayPoint(i), 0.0);
+  trajectory_processing::IterativeSplineParameterization time_parameterization;
+  if (!time_parameterization.computeTimeStamps(tail))
+  {
+    RCLCPP_INFO(LOGGER, "Unable to retime the local repair of trajectory component '%s'",
+                component.description_.c_str());
+    return false;
+  }
+
+  // the robot kept moving while the segment was planned; it must not have reached the start of the segment yet
+  std::pair<int, int> now = trajectory_execution_manager_->getCurrentExpectedTrajectoryIndex();
+  if (now.first < 0 || now.first + first_component != static_cast<std::size_t>(path_segment.first) ||
+      now.second < 0 || static_cast<std::size_t>(now.second) >= start)
+  {
+    RCLCPP_INFO(LOGGER, "Planning the local repair of trajectory component '%s' took too long",
+                component.description_.c_str());
+    return false;
+  }
+
+  auto repaired = std::make_shared<robot_trajectory::RobotTrajectory>(t.getRobotModel(), t.getGroup());
+  for (std::size_t i = now.second; i <= start; ++i)
+    repaired->addSuffixWayPoint(t.getWayPoint(i),
+                                i == static_cast<std::size_t>(now.second) ? 0.0 : t.getWayPointDurationFromPrevious(i));
+  repaired->append(tail, 0.0, 1);
+  component.trajectory_ = repaired;
+  return true;
+}
+
+void plan_execution::PlanExecution::markChangedWayPoints(const ExecutableMotionPlan& plan,
+                                                        const std::pair<int, int>& path_segment)
+{
+  // without a world diff, or with changes that may affect any waypoint, the whole remaining path is checked again
+  bool full_check = full_path_check_ || !world_diff_;
+  full_path_check_ = false;
+
+  std::vector<moveit::core::AABB> changed_boxes;
+  if (world_diff_)
+  {
+    planning_scene_monitor::LockedPlanningSceneRO lscene(plan.planning_scene_monitor_);
+    for (const std::pair<const std::string, collision_detection::World::Action>& change : *world_diff_)
+    {
+      // removed objects cannot make a waypoint invalid
+      collision_detection::World::ObjectConstPtr object = lscene->getWorld()->getObject(change.first);
+      if (full_check || !object)
+        continue;
+      moveit::core::AABB box;
+      for (std::size_t i = 0; i < object->shapes_.size(); ++i)
+      {
+        // octomaps and planes have no useful bounding box
+        if (object->shapes_[i]->type == shapes::OCTREE || object->shapes_[i]->type == shapes::PLANE)
+        {
+          full_check = true;
+          break;
+        }
+        Eigen::Vector3d center;
+        double radius;
+        shapes::computeShapeBoundingSphere(object->shapes_[i].get(), center, radius);
+        center = object->shape_poses_[i] * center;
+        box.extend(center - Eigen::Vector3d::Constant(radius));
+        box.extend(center + Eigen::Vector3d::Constant(radius));
+      }
+      changed_boxes.push_back(box);
     }
+    world_diff_->clearChanges();
   }
+
+  if (path_segment.first < 0 || !plan.plan_components_[path_segment.first].trajectory_monitoring_)
+  {
+    // nothing to check for this component
+    checked_component_ = path_segment.first;
+    waypoint_boxes_.clear();
+    waypoints_to_check_.clear();
+    return;
+  }
+
+  const robot_trajectory::RobotTrajectory& t = *plan.plan_components_[path_segment.first].trajectory_;
+  if (checked_component_ != path_segment.first)
+  {
+    // a component is checked entirely before its execution starts, so only later changes need to be checked
+    checked_component_ = path_segment.first;
+    std::vector<moveit::core::AABB> boxes(t.getWayPointCount());
+    std::vector<double> aabb;
+    for (std::size_t i = 0; i < boxes.size(); ++i)
+    {
+      moveit::core::RobotState state(t.getWayPoint(i));
+      state.updateLinkTransforms();
+      state.computeAABB(aabb);
+      boxes[i].extend(Eigen::Vector3d(aabb[0], aabb[2], aabb[4]));
+      boxes[i].extend(Eigen::Vector3d(aabb[1], aabb[3], aabb[5]));
+    }
+    // the box swept by the robot from the previous to the next waypoint
+    waypoint_boxes_ = boxes;
+    for (std::size_t i = 0; i < boxes.size(); ++i)
+    {
+      if (i > 0)
+        waypoint_boxes_[i].extend(boxes[i - 1]);
+      if (i + 1 < boxes.size())
+        waypoint_boxes_[i].extend(boxes[i + 1]);
+    }
+    waypoints_to_check_.assign(boxes.size(), false);
+  }
+
+  for (std::size_t i = std::max(path_segment.second - 1, 0); i < waypoints_to_check_.size(); ++i)
+  {
+    if (full_check)
+      waypoints_to_check_[i] = true;
+    else
+      for (const moveit::core::AABB& box : changed_boxes)
+        if (waypoint_boxes_[i].intersects(box))
+        {
+          waypoints_to_check_[i] = true;
+          break;
+        }
+  }
+}
+
+bool plan_execution::PlanExecution::areChangedWayPointsValid(const ExecutableMotionPlan& plan,
+                                                            const std::pair<int, int>& path_segment)
+{
+  if (path_segment.first < 0 || path_segment.first != checked_component_)
+    return true;
+
+  std::size_t checks = 0;
+  planning_scene_monitor::LockedPlanningSceneRO lscene(plan.planning_scene_monitor_);
+  for (std::size_t i = std::max(path_segment.second - 1, 0);
+       i < waypoints_to_check_.size() && checks < MAX_WAYPOINT_CHECKS_PER_CYCLE; ++i)
+    if (waypoints_to_check_[i])
+    {
+      waypoints_to_check_[i] = false;
+      ++checks;
+      if (!isWayPointValid(plan, path_segment.first, i, false))
+      {
+        RCLCPP_INFO(LOGGER, "Trajectory component '%s' is invalid",
+                    plan.plan_components_[path_segment.first].description_.c_str());
+
+        // call the same functions again, in verbose mode, to show what issues have been detected
+        isWayPointValid(plan, path_segment.first, i, true);
+        return false;
+      }
+    }
   return true;
 }
 
 moveit_msgs::msg::MoveItErrorCodes plan_execution::PlanExecution::executeAndMonitor(ExecutableMotionPlan& plan)
+{
+  return executeAndMonitor(plan, Options());
+}
+
+moveit_msgs::msg::MoveItErrorCodes plan_execution::PlanExecution::executeAndMonitor(ExecutableMotionPlan& plan,
+                                                                                   const Options& opt)
 {
   if (!plan.planning_scene_monitor_)
     plan.planning_scene_monitor_ = planning_scene_monitor_;
@@ -340,52 +566,11 @@ moveit_msgs::msg::MoveItErrorCodes plan_execution::PlanExecution::executeAndMoni
   execution_complete_ = false;
 
   // push the trajectories we have slated for execution to the trajectory execution manager
-  int prev = -1;
-  for (std::size_t i = 0; i < plan.plan_components_.size(); ++i)
+  if (!pushTrajectories(plan, 0))
   {
-    // \todo should this be in trajectory_execution ? Maybe. Then that will have to use kinematic_trajectory too;
-    // spliting trajectories for controllers becomes interesting: tied to groups instead of joints. this could cause
-    // some problems
-    // in the meantime we do a hack:
-
-    bool unwound = false;
-    for (std::size_t j = 0; j < i; ++j)
-      // if we ran unwind on a path for the same group
-      if (plan.plan_components_[j].trajectory_ &&
-          plan.plan_components_[j].trajectory_->getGroup() == plan.plan_components_[i].trajectory_->getGroup() &&
-          !plan.plan_components_[j].trajectory_->empty())
-      {
-        plan.plan_components_[i].trajectory_->unwind(plan.plan_components_[j].trajectory_->getLastWayPoint());
-        unwound = true;
-        break;
-      }
-
-    if (!unwound)
-    {
-      // unwind the path to execute based on the current state of the system
-      if (prev < 0)
-        plan.plan_components_[i].trajectory_->unwind(
-            plan.planning_scene_monitor_ && plan.planning_scene_monitor_->getStateMonitor() ?
-                *plan.planning_scene_monitor_->getStateMonitor()->getCurrentState() :
-                plan.planning_scene_->getCurrentState());
-      else
-        plan.plan_components_[i].trajectory_->unwind(plan.plan_components_[prev].trajectory_->getLastWayPoint());
-    }
-
-    if (plan.plan_components_[i].trajectory_ && !plan.plan_components_[i].trajectory_->empty())
-      prev = i;
-
-    // convert to message, pass along
-    moveit_msgs::msg::RobotTrajectory msg;
-    plan.plan_components_[i].trajectory_->getRobotTrajectoryMsg(msg);
-    if (!trajectory_execution_manager_->push(msg, plan.plan_components_[i].controller_names_))
-    {
-      trajectory_execution_manager_->clear();
-      RCLCPP_ERROR(LOGGER, "Apparently trajectory initialization failed");
-      execution_complete_ = true;
-      result.val = moveit_msgs::msg::MoveItErrorCodes::CONTROL_FAILED;
-      return result;
-    }
+    execution_complete_ = true;
+    result.val = moveit_msgs::msg::MoveItErrorCodes::CONTROL_FAILED;
+    return result;
   }
 
   if (!trajectory_monitor_ && planning_scene_monitor_->getStateMonitor())
@@ -401,28 +586,69 @@ moveit_msgs::msg::MoveItErrorCodes plan_execution::PlanExecution::executeAndMoni
   if (trajectory_monitor_)
     trajectory_monitor_->startTrajectoryMonitor();
 
+  // record the changes of the world, to only check the waypoints they affect
+  checked_component_ = -1;
+  full_path_check_ = false;
+  if (plan.planning_scene_monitor_)
+  {
+    planning_scene_monitor::LockedPlanningSceneRW lscene(plan.planning_scene_monitor_);
+    const planning_scene::PlanningScenePtr& monitored_scene = lscene;
+    if (plan.planning_scene_ == monitored_scene)
+      world_diff_ = std::make_shared<collision_detection::WorldDiff>(monitored_scene->getWorldNonConst());
+  }
+
+  // index of the plan component executed first by the trajectory execution manager, which changes when the remaining
+  // path is repaired locally
+  std::size_t first_component = 0;
+  auto execute = [this, &plan, &first_component]() {
+    trajectory_execution_manager_->execute(
+        boost::bind(&PlanExecution::doneWithTrajectoryExecution, this, boost::placeholders::_1),
+        [this, &plan, first = first_component](std::size_t index) {
+          successfulTrajectorySegmentExecution(&plan, first + index);
+        });
+  };
+
   // start a trajectory execution thread
-  trajectory_execution_manager_->execute(
-      boost::bind(&PlanExecution::doneWithTrajectoryExecution, this, boost::placeholders::_1),
-      boost::bind(&PlanExecution::successfulTrajectorySegmentExecution, this, &plan, boost::placeholders::_1));
+  execute();
   // wait for path to be done, while checking that the path does not become invalid
   rclcpp::WallRate r(100);
   path_became_invalid_ = false;
   while (rclcpp::ok() && !execution_complete_ && !preempt_requested_ && !path_became_invalid_)
   {
     r.sleep();
-    // check the path if there was an environment update in the meantime
-    if (new_scene_update_)
+    std::pair<int, int> current_index = trajectory_execution_manager_->getCurrentExpectedTrajectoryIndex();
+    if (current_index.first >= 0)
+      current_index.first += first_component;
+    // mark the waypoints that are affected by environment updates in the meantime
+    if (new_scene_update_ || current_index.first != checked_component_)
     {
       new_scene_update_ = false;
-      std::pair<int, int> current_index = trajectory_execution_manager_->getCurrentExpectedTrajectoryIndex();
-      if (!isRemainingPathValid(plan, current_index))
+      markChangedWayPoints(plan, current_index);
+    }
+    // and check some of them
+    if (!areChangedWayPointsValid(plan, current_index))
+    {
+      RCLCPP_INFO(LOGGER, "Trajectory component '%s' is invalid after scene update",
+                  plan.plan_components_[current_index.first].description_.c_str());
+      if (opt.local_repair_callback_ && repairRemainingPath(plan, opt, current_index, first_component))
       {
-        RCLCPP_INFO(LOGGER, "Trajectory component '%s' is invalid after scene update",
-                    plan.plan_components_[current_index.first].description_.c_str());
-        path_became_invalid_ = true;
-        break;
+        // continue with the repaired remaining motion, which starts where the robot is expected to be now
+        trajectory_execution_manager_->stopExecution(true);
+        first_component = current_index.first;
+        // the repaired component is checked again from scratch
+        checked_component_ = -1;
+        full_path_check_ = true;
+        if (pushTrajectories(plan, first_component))
+        {
+          execution_complete_ = false;
+          execute();
+          RCLCPP_INFO(LOGGER, "Continuing with the locally repaired trajectory component '%s'",
+                      plan.plan_components_[first_component].description_.c_str());
+          continue;
+        }
       }
+      path_became_invalid_ = true;
+      break;
     }
   }
 
@@ -445,6 +671,12 @@ moveit_msgs::msg::MoveItErrorCodes plan_execution::PlanExecution::executeAndMoni
     trajectory_execution_manager_->stopExecution();
   }
 
+  if (world_diff_)
+  {
+    planning_scene_monitor::LockedPlanningSceneRW lscene(plan.planning_scene_monitor_);
+    world_diff_.reset();
+  }
+
   // stop recording trajectory states
   if (trajectory_monitor_)
   {
@@ -478,12 +710,67 @@ moveit_msgs::msg::MoveItErrorCodes plan_execution::PlanExecution::executeAndMoni
   return result;
 }
 
+bool plan_execution::PlanExecution::pushTrajectories(ExecutableMotionPlan& plan, std::size_t first_component)
+{
+  int prev = -1;
+  for (std::size_t i = first_component; i < plan.plan_components_.size(); ++i)
+  {
+    // \todo should this be in trajectory_execution ? Maybe. Then that will have to use kinematic_trajectory too;
+    // spliting trajectories for controllers becomes interesting: tied to groups instead of joints. this could cause
+    // some problems
+    // in the meantime we do a hack:
+
+    bool unwound = false;
+    for (std::size_t j = first_component; j < i; ++j)
+      // if we ran unwind on a path for the same group
+      if (plan.plan_components_[j].trajectory_ &&
+          plan.plan_components_[j].trajectory_->getGroup() == plan.plan_components_[i].trajectory_->getGroup() &&
+          !plan.plan_components_[j].trajectory_->empty())
+      {
+        plan.plan_components_[i].trajectory_->unwind(plan.plan_components_[j].trajectory_->getLastWayPoint());
+        unwound = true;
+        break;
+      }
+
+    if (!unwound)
+    {
+      // unwind the path to execute based on the current state of the system
+      if (prev < 0)
+        plan.plan_components_[i].trajectory_->unwind(
+            plan.planning_scene_monitor_ && plan.planning_scene_monitor_->getStateMonitor() ?
+                *plan.planning_scene_monitor_->getStateMonitor()->getCurrentState() :
+                plan.planning_scene_->getCurrentState());
+      else
+        plan.plan_components_[i].trajectory_->unwind(plan.plan_components_[prev].trajectory_->getLastWayPoint());
+    }
+
+    if (plan.plan_components_[i].trajectory_ && !plan.plan_components_[i].trajectory_->empty())
+      prev = i;
+
+    // convert to message, pass along
+    moveit_msgs::msg::RobotTrajectory msg;
+    plan.plan_components_[i].trajectory_->getRobotTrajectoryMsg(msg);
+    if (!trajectory_execution_manager_->push(msg, plan.plan_components_[i].controller_names_))
+    {
+      trajectory_execution_manager_->clear();
+      RCLCPP_ERROR(LOGGER, "Apparently trajectory initialization failed");
+      return false;
+    }
+  }
+  return true;
+}
+
 void plan_execution::PlanExecution::planningSceneUpdatedCallback(
     const planning_scene_monitor::PlanningSceneMonitor::SceneUpdateType update_type)
 {
   if (update_type & (planning_scene_monitor::PlanningSceneMonitor::UPDATE_GEOMETRY |
                      planning_scene_monitor::PlanningSceneMonitor::UPDATE_TRANSFORMS))
+  {
+    // geometry updates are tracked by the world diff, changed transforms may move any object
+    if (update_type & planning_scene_monitor::PlanningSceneMonitor::UPDATE_TRANSFORMS)
+      full_path_check_ = true;
     new_scene_update_ = true;
+  }
 }
 
 void plan_execution::PlanExecution::doneWithTrajectoryExecution(
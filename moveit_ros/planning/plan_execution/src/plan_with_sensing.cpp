@@ -39,6 +39,7 @@
 #include <moveit/trajectory_processing/trajectory_tools.h>
 #include <moveit/collision_detection/collision_tools.h>
 #include <boost/algorithm/string/join.hpp>
+#include <set>
 
 // #include <dynamic_reconfigure/server.h>
 // #include <moveit_ros_planning/SenseForPlanDynamicReconfigureConfig.h>
@@ -88,6 +89,11 @@ plan_execution::PlanWithSensing::PlanWithSensing(
   // by default we do not display path cost sources
   display_cost_sources_ = false;
 
+  // by default the sensor is pointed before planning again
+  plan_while_looking_ = false;
+  sensor_update_timeout_ = 1.0;
+  look_motion_started_ = false;
+
   // load the sensor manager plugin, if needed
   auto sensor_manager_params = std::make_shared<rclcpp::SyncParametersClient>(node_);
   if (sensor_manager_params && sensor_manager_params->has_parameter("moveit_sensor_manager"))
@@ -168,11 +174,55 @@ bool plan_execution::PlanWithSensing::computePlan(ExecutableMotionPlan& plan,
   // If we have two sensor pointing failures in a row, we fail
   bool look_around_failed = false;
 
+  // this flag is set when the sensor is being pointed while the next plan is computed
+  bool look_in_progress = false;
+
+  // report the result of pointing the sensor, and decide whether to plan again
+  auto after_look = [&](bool looked_at_result, double cost) {
+    if (looked_at_result)
+    {
+      RCLCPP_INFO(LOGGER, "Sensor was succesfully actuated. Attempting to recompute a motion plan.");
+    }
+    else
+    {
+      if (look_around_failed)
+      {
+        RCLCPP_WARN(LOGGER, "Looking around seems to keep failing. Giving up.");
+      }
+      else
+      {
+        RCLCPP_WARN(LOGGER, "Looking around seems to have failed. Attempting to recompute a motion plan anyway.");
+      }
+    }
+    if (looked_at_result || !look_around_failed)
+    {
+      previous_cost = cost;
+      just_looked_around = true;
+    }
+    look_around_failed = !looked_at_result;
+    return just_looked_around;
+  };
+  double look_cost = 0.0;
+
   // there can be a maximum number of looking attempts as well that lead to replanning, if the cost
   // of the path is above a maximum threshold.
   do
   {
     bool solved = motion_planner(plan);
+
+    if (look_in_progress)
+    {
+      // the plan was computed on the information available while the sensor moved; it is only evaluated once the
+      // look motion is done and new sensor data has arrived
+      look_in_progress = false;
+      bool plan_again = after_look(waitForLook(plan), look_cost);
+      if (plan_again && (!solved || plan.error_code_.val != moveit_msgs::msg::MoveItErrorCodes::SUCCESS))
+      {
+        RCLCPP_INFO(LOGGER, "Planning while looking around failed. Planning again with the new sensor data.");
+        continue;
+      }
+    }
+
     if (!solved || plan.error_code_.val != moveit_msgs::msg::MoveItErrorCodes::SUCCESS)
       return solved;
 
@@ -222,30 +272,27 @@ bool plan_execution::PlanWithSensing::computePlan(ExecutableMotionPlan& plan,
           "%u) at looking around.",
           cost, max_safe_path_cost, look_attempts, max_look_attempts);
 
-      bool looked_at_result = lookAt(cost_sources, plan.planning_scene_->getPlanningFrame());
-      if (looked_at_result)
+      if (plan_while_looking_)
       {
-        RCLCPP_INFO(LOGGER, "Sensor was succesfully actuated. Attempting to recompute a motion plan.");
-      }
-      else
-      {
-        if (look_around_failed)
-        {
-          RCLCPP_WARN(LOGGER, "Looking around seems to keep failing. Giving up.");
-        }
-        else
+        // start pointing the sensor and plan again right away, unless the sensor is moved by the joints to plan for
+        std::set<std::string> planned_joints;
+        for (const ExecutableTrajectory& component : plan.plan_components_)
+          if (component.trajectory_ && component.trajectory_->getGroup())
+          {
+            const std::vector<std::string>& names = component.trajectory_->getGroup()->getVariableNames();
+            planned_joints.insert(names.begin(), names.end());
+          }
+        if (lookAt(cost_sources, plan.planning_scene_->getPlanningFrame(), false, planned_joints))
         {
-          RCLCPP_WARN(LOGGER, "Looking around seems to have failed. Attempting to recompute a motion plan anyway.");
+          look_in_progress = true;
+          look_cost = cost;
+          continue;
         }
+        if (after_look(false, cost))
+          continue;
       }
-      if (looked_at_result || !look_around_failed)
-      {
-        previous_cost = cost;
-        just_looked_around = true;
-      }
-      look_around_failed = !looked_at_result;
       // if we are unable to look, let this loop continue into the next if statement
-      if (just_looked_around)
+      else if (after_look(lookAt(cost_sources, plan.planning_scene_->getPlanningFrame(), true), cost))
         continue;
     }
 
@@ -262,7 +309,8 @@ bool plan_execution::PlanWithSensing::computePlan(ExecutableMotionPlan& plan,
 }
 
 bool plan_execution::PlanWithSensing::lookAt(const std::set<collision_detection::CostSource>& cost_sources,
-                                             const std::string& frame_id)
+                                             const std::string& frame_id, bool wait,
+                                             const std::set<std::string>& planned_joints)
 {
   if (!sensor_manager_)
   {
@@ -286,12 +334,61 @@ bool plan_execution::PlanWithSensing::lookAt(const std::set<collision_detection:
       moveit_msgs::msg::RobotTrajectory sensor_trajectory;
       if (sensor_manager_->pointSensorTo(name, point, sensor_trajectory))
       {
-        if (!trajectory_processing::isTrajectoryEmpty(sensor_trajectory))
-          return trajectory_execution_manager_->push(sensor_trajectory) &&
-                 trajectory_execution_manager_->executeAndWait();
-        else
+        if (trajectory_processing::isTrajectoryEmpty(sensor_trajectory))
           return true;
+        if (!trajectory_execution_manager_->push(sensor_trajectory))
+          return false;
+        // planning from a state the sensor motion changes would give a plan that does not start at the robot state
+        for (const std::string& name : sensor_trajectory.joint_trajectory.joint_names)
+          wait = wait || planned_joints.count(name) > 0;
+        for (const std::string& name : sensor_trajectory.multi_dof_joint_trajectory.joint_names)
+          wait = wait || planned_joints.count(name) > 0;
+        if (wait)
+          return bool(trajectory_execution_manager_->executeAndWait());
+        trajectory_execution_manager_->execute();
+        look_motion_started_ = true;
+        return true;
       }
     }
   return false;
 }
+
+bool plan_execution::PlanWithSensing::waitForLook(const ExecutableMotionPlan& plan)
+{
+  // the sensor may not have needed to move
+  bool looked_at_result = true;
+  if (look_motion_started_)
+  {
+    look_motion_started_ = false;
+    looked_at_result = bool(trajectory_execution_manager_->waitForExecution());
+  }
+
+  // new sensor data only shows up in the monitored scene
+  if (!looked_at_result || !plan.planning_scene_monitor_ || sensor_update_timeout_ <= 0.0)
+    return looked_at_result;
+  collision_detection::WorldDiffPtr world_diff;
+  {
+    planning_scene_monitor::LockedPlanningSceneRW lscene(plan.planning_scene_monitor_);
+    const planning_scene::PlanningScenePtr& monitored_scene = lscene;
+    if (plan.planning_scene_ != monitored_scene)
+      return looked_at_result;
+    world_diff = std::make_shared<collision_detection::WorldDiff>(monitored_scene->getWorldNonConst());
+  }
+
+  // wait for the world to change after the sensor reached its target
+  rclcpp::WallRate rate(100);
+  const rclcpp::Time end = rclcpp::Clock().now() + rclcpp::Duration::from_seconds(sensor_update_timeout_);
+  bool updated = false;
+  while (rclcpp::ok() && !updated && rclcpp::Clock().now() < end)
+  {
+    rate.sleep();
+    planning_scene_monitor::LockedPlanningSceneRO lscene(plan.planning_scene_monitor_);
+    updated = world_diff->size() > 0;
+  }
+  if (!updated)
+    RCLCPP_WARN(LOGGER, "No new sensor data arrived within %lf seconds after looking around", sensor_update_timeout_);
+
+  planning_scene_monitor::LockedPlanningSceneRW lscene(plan.planning_scene_monitor_);
+  world_diff.reset();
+  return looked_at_result;
+}
@@ -106,6 +106,14 @@ public:
    * This is true by default.  */
   void checkSolutionPaths(bool flag);
 
+  /** \brief Pass a flag telling the pipeline whether to bound all of generatePlan() by the allowed planning time of the
+      request, instead of only the calls of the planner. Every planner call of the planning request adapters is then
+      given the time left until the deadline, minus \e post_processing_reserve (a fraction of the allowed planning time
+      kept for the adapters and checks after planning), and is terminated when that time is up, so the best solution
+      found until then is used. Default is false, which can be changed by the parameter enforce_planning_deadline
+      (and planning_deadline_reserve) in the parameter namespace of the pipeline. */
+  void enforcePlanningDeadline(bool flag, double post_processing_reserve = 0.1);
+
   /** \brief Get the flag set by displayComputedMotionPlans() */
   bool getDisplayComputedMotionPlans() const
   {
@@ -124,6 +132,12 @@ public:
     return check_solution_paths_;
   }
 
+  /** \brief Get the flag set by enforcePlanningDeadline() */
+  bool getEnforcePlanningDeadline() const
+  {
+    return enforce_planning_deadline_;
+  }
+
   /** \brief Call the motion planner plugin and the sequence of planning request adapters (if any).
       \param planning_scene The planning scene where motion planning is to be done
       \param req The request for motion planning
@@ -144,6 +158,30 @@ public:
                     const planning_interface::MotionPlanRequest& req, planning_interface::MotionPlanResponse& res,
                     std::vector<std::size_t>& adapter_added_state_index) const;
 
+  /** \brief Selects how generatePlanPortfolio() picks the result among the concurrently running planners */
+  enum class PortfolioMode
+  {
+    /// Return the first valid solution and terminate all other planners
+    FIRST_SOLUTION,
+    /// Wait for all planners (bounded by the allowed planning time) and return the shortest solution path
+    BEST_WITHIN_DEADLINE
+  };
+
+  /** \brief Race the same motion plan request on several planners of the loaded planning plugin concurrently.
+      Each planner runs on its own thread with \e req.planner_id replaced by one of \e planner_ids, passing through the
+      planning request adapters as in generatePlan(). Planners that are no longer needed are stopped via
+      planning_interface::PlanningContext::terminate(). The selected solution is checked and displayed like the result
+      of generatePlan(). The entries of \e planner_ids must be distinct, as contexts may be shared per planner.
+      \param planning_scene The planning scene where motion planning is to be done
+      \param req The request for motion planning
+      \param planner_ids The planner configurations to race; if empty, this is equivalent to generatePlan()
+      \param res The motion planning response of the selected planner
+      \param mode How to select the response among the planners */
+  bool generatePlanPortfolio(const planning_scene::PlanningSceneConstPtr& planning_scene,
+                             const planning_interface::MotionPlanRequest& req,
+                             const std::vector<std::string>& planner_ids, planning_interface::MotionPlanResponse& res,
+                             PortfolioMode mode = PortfolioMode::FIRST_SOLUTION) const;
+
   /** \brief Request termination, if a generatePlan() function is currently computing plans */
   void terminate() const;
 
@@ -174,6 +212,21 @@ public:
 private:
   void configure();
 
+  /** \brief Compute a plan with \e planner, passing through the planning request adapters. May throw. */
+  bool plan(const planning_interface::PlannerManagerPtr& planner,
+            const planning_scene::PlanningSceneConstPtr& planning_scene,
+            const planning_interface::MotionPlanRequest& req, planning_interface::MotionPlanResponse& res,
+            std::vector<std::size_t>& adapter_added_state_index) const;
+
+  struct SpeculativePathCheck;
+
+  /** \brief Re-check and display a (possibly) solved plan. Returns whether the solution is valid. The states of the
+      plan that are those of the solution checked by \e path_check, if given, are not checked again. */
+  bool postProcessPlan(const planning_scene::PlanningSceneConstPtr& planning_scene,
+                       const planning_interface::MotionPlanRequest& req, planning_interface::MotionPlanResponse& res,
+                       const std::vector<std::size_t>& adapter_added_state_index, bool solved,
+                       SpeculativePathCheck* path_check = nullptr) const;
+
   std::shared_ptr<rclcpp::Node> node_;
   std::string parameter_namespace_;
   /// Flag indicating whether motion plans should be published as a moveit_msgs::msg::DisplayTrajectory
@@ -198,6 +251,11 @@ private:
   /// Flag indicating whether the reported plans should be checked once again, by the planning pipeline itself
   bool check_solution_paths_;
   rclcpp::Publisher<visualization_msgs::msg::MarkerArray>::SharedPtr contacts_publisher_;
+
+  /// Flag indicating whether the allowed planning time bounds the whole pipeline, see enforcePlanningDeadline()
+  bool enforce_planning_deadline_;
+  /// Fraction of the allowed planning time kept for the stages after the last planner call
+  double planning_deadline_reserve_;
 };
 
 MOVEIT_CLASS_FORWARD(PlanningPipeline)  // Defines PlanningPipelinePtr, ConstPtr, WeakPtr... etc
@@ -38,12 +38,287 @@
 #include <moveit/robot_state/conversions.h>
 #include <moveit/collision_detection/collision_tools.h>
 #include <moveit/trajectory_processing/trajectory_tools.h>
+#include <moveit/profiler/tracing.h>
 #include <boost/tokenizer.hpp>
 #include <boost/algorithm/string/join.hpp>
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <limits>
+#include <mutex>
 #include <sstream>
+#include <thread>
 
 static const rclcpp::Logger LOGGER = rclcpp::get_logger("moveit.ros_planning.planning_pipeline");
 
+/** \brief The check of the solution path of the planner, which runs while the planning request adapters process it */
+struct planning_pipeline::PlanningPipeline::SpeculativePathCheck
+{
+  robot_trajectory::RobotTrajectoryPtr solution;
+  std::future<std::vector<std::size_t>> invalid_index;
+};
+
+namespace
+{
+/** \brief PlannerManager decorator that remembers the planning contexts it hands out, so that a single planner of a
+    portfolio can be terminated without affecting the other (concurrently running) ones. */
+class TerminablePlannerManager : public planning_interface::PlannerManager
+{
+public:
+  TerminablePlannerManager(const planning_interface::PlannerManagerPtr& planner) : planner_(planner)
+  {
+  }
+
+  using planning_interface::PlannerManager::getPlanningContext;
+
+  std::string getDescription() const override
+  {
+    return planner_->getDescription();
+  }
+
+  void getPlanningAlgorithms(std::vector<std::string>& algs) const override
+  {
+    planner_->getPlanningAlgorithms(algs);
+  }
+
+  planning_interface::PlanningContextPtr getPlanningContext(const planning_scene::PlanningSceneConstPtr& planning_scene,
+                                                            const planning_interface::MotionPlanRequest& req,
+                                                            moveit_msgs::msg::MoveItErrorCodes& error_code) const override
+  {
+    planning_interface::PlanningContextPtr context = planner_->getPlanningContext(planning_scene, req, error_code);
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (context)
+    {
+      contexts_.push_back(context);
+      if (terminated_)
+        context->terminate();
+    }
+    return context;
+  }
+
+  bool canServiceRequest(const planning_interface::MotionPlanRequest& req) const override
+  {
+    return planner_->canServiceRequest(req);
+  }
+
+  void terminateContexts()
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    terminated_ = true;
+    for (const planning_interface::PlanningContextPtr& context : contexts_)
+      context->terminate();
+  }
+
+private:
+  planning_interface::PlannerManagerPtr planner_;
+  mutable std::mutex mutex_;
+  mutable std::vector<planning_interface::PlanningContextPtr> contexts_;
+  bool terminated_ = false;
+};
+
+/** \brief TerminablePlannerManager that gives each planning context at most the time left until a deadline */
+class DeadlinePlannerManager : public TerminablePlannerManager
+{
+public:
+  DeadlinePlannerManager(const planning_interface::PlannerManagerPtr& planner,
+                         const std::chrono::steady_clock::time_point& deadline)
+    : TerminablePlannerManager(planner), deadline_(deadline)
+  {
+  }
+
+  using TerminablePlannerManager::getPlanningContext;
+
+  planning_interface::PlanningContextPtr getPlanningContext(const planning_scene::PlanningSceneConstPtr& planning_scene,
+                                                            const planning_interface::MotionPlanRequest& req,
+                                                            moveit_msgs::msg::MoveItErrorCodes& error_code) const override
+  {
+    // planners fall back to a default time if the allowed planning time is 0, so fail if no time is left
+    const double remaining = std::chrono::duration<double>(deadline_ - std::chrono::steady_clock::now()).count();
+    if (remaining <= 0.0)
+    {
+      RCLCPP_WARN(LOGGER, "Planning deadline passed before the planner was called");
+      error_code.val = moveit_msgs::msg::MoveItErrorCodes::TIMED_OUT;
+      return planning_interface::PlanningContextPtr();
+    }
+    planning_interface::MotionPlanRequest bounded_req = req;
+    bounded_req.allowed_planning_time = std::min(req.allowed_planning_time, remaining);
+    return TerminablePlannerManager::getPlanningContext(planning_scene, bounded_req, error_code);
+  }
+
+private:
+  std::chrono::steady_clock::time_point deadline_;
+};
+
+/** \brief Terminates the planning contexts of a TerminablePlannerManager from the time a deadline passed until it is
+    destroyed */
+class DeadlineWatchdog
+{
+public:
+  DeadlineWatchdog(const std::shared_ptr<TerminablePlannerManager>& planner,
+                   const std::chrono::steady_clock::time_point& deadline)
+    : thread_([this, planner, deadline] {
+      std::unique_lock<std::mutex> lock(mutex_);
+      if (condition_.wait_until(lock, deadline, [this] { return done_; }))
+        return;
+      // Contexts may still be created or may not have started solving yet, in which case terminate() is a no-op.
+      // Keep terminating until planning is done.
+      while (!done_)
+      {
+        planner->terminateContexts();
+        condition_.wait_for(lock, std::chrono::milliseconds(10));
+      }
+    })
+  {
+  }
+
+  ~DeadlineWatchdog()
+  {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      done_ = true;
+    }
+    condition_.notify_all();
+    thread_.join();
+  }
+
+private:
+  std::mutex mutex_;
+  std::condition_variable condition_;
+  bool done_ = false;
+  std::thread thread_;  // last, so it starts after the other members are initialized
+};
+
+/** \brief PlanningContext decorator that passes each solution of the planner to a function, before the planning
+    request adapters process it */
+class SolutionObservingPlanningContext : public planning_interface::PlanningContext
+{
+public:
+  using SolutionFn = std::function<void(const robot_trajectory::RobotTrajectory&)>;
+
+  SolutionObservingPlanningContext(const planning_interface::PlanningContextPtr& context, const SolutionFn& on_solution)
+    : planning_interface::PlanningContext(context->getName(), context->getGroupName())
+    , context_(context)
+    , on_solution_(on_solution)
+  {
+    setPlanningScene(context->getPlanningScene());
+    setMotionPlanRequest(context->getMotionPlanRequest());
+  }
+
+  bool solve(planning_interface::MotionPlanResponse& res) override
+  {
+    const bool solved = context_->solve(res);
+    if (solved && res.trajectory_)
+      on_solution_(*res.trajectory_);
+    return solved;
+  }
+
+  bool solve(planning_interface::MotionPlanDetailedResponse& res) override
+  {
+    return context_->solve(res);
+  }
+
+  bool terminate() override
+  {
+    return context_->terminate();
+  }
+
+  void clear() override
+  {
+    context_->clear();
+  }
+
+private:
+  planning_interface::PlanningContextPtr context_;
+  SolutionFn on_solution_;
+};
+
+/** \brief PlannerManager decorator that hands out SolutionObservingPlanningContexts */
+class SolutionObservingPlannerManager : public planning_interface::PlannerManager
+{
+public:
+  SolutionObservingPlannerManager(const planning_interface::PlannerManagerPtr& planner,
+                                  const SolutionObservingPlanningContext::SolutionFn& on_solution)
+    : planner_(planner), on_solution_(on_solution)
+  {
+  }
+
+  using planning_interface::PlannerManager::getPlanningContext;
+
+  std::string getDescription() const override
+  {
+    return planner_->getDescription();
+  }
+
+  void getPlanningAlgorithms(std::vector<std::string>& algs) const override
+  {
+    planner_->getPlanningAlgorithms(algs);
+  }
+
+  planning_interface::PlanningContextPtr getPlanningContext(const planning_scene::PlanningSceneConstPtr& planning_scene,
+                                                            const planning_interface::MotionPlanRequest& req,
+                                                            moveit_msgs::msg::MoveItErrorCodes& error_code) const override
+  {
+    planning_interface::PlanningContextPtr context = planner_->getPlanningContext(planning_scene, req, error_code);
+    if (!context)
+      return context;
+    return std::make_shared<SolutionObservingPlanningContext>(context, on_solution_);
+  }
+
+  bool canServiceRequest(const planning_interface::MotionPlanRequest& req) const override
+  {
+    return planner_->canServiceRequest(req);
+  }
+
+private:
+  planning_interface::PlannerManagerPtr planner_;
+  SolutionObservingPlanningContext::SolutionFn on_solution_;
+};
+
+/** \brief Map the invalid states of the solution of the planner to the states of the trajectory the planning request
+    adapters made of it. Return false if the adapters changed more than the timing and the added states. */
+bool mapInvalidStates(const robot_trajectory::RobotTrajectory& solution,
+                      const std::vector<std::size_t>& solution_invalid_index,
+                      const robot_trajectory::RobotTrajectory& trajectory,
+                      const std::vector<std::size_t>& adapter_added_state_index,
+                      std::vector<std::size_t>& invalid_index)
+{
+  if (trajectory.getWayPointCount() != solution.getWayPointCount() + adapter_added_state_index.size())
+    return false;
+
+  const std::size_t variable_count = trajectory.getRobotModel()->getVariableCount();
+  std::vector<std::size_t> solution_to_trajectory;
+  solution_to_trajectory.reserve(solution.getWayPointCount());
+  for (std::size_t i = 0; i < trajectory.getWayPointCount(); ++i)
+  {
+    // the added indices are sorted
+    if (std::binary_search(adapter_added_state_index.begin(), adapter_added_state_index.end(), i))
+      continue;
+    const double* positions = trajectory.getWayPoint(i).getVariablePositions();
+    const double* solution_positions = solution.getWayPoint(solution_to_trajectory.size()).getVariablePositions();
+    if (!std::equal(positions, positions + variable_count, solution_positions))
+      return false;
+    solution_to_trajectory.push_back(i);
+  }
+
+  invalid_index.clear();
+  for (std::size_t solution_index : solution_invalid_index)
+    invalid_index.push_back(solution_to_trajectory[solution_index]);
+  return true;
+}
+
+double getPathLength(const robot_trajectory::RobotTrajectory& trajectory)
+{
+  double length = 0.0;
+  for (std::size_t i = 1; i < trajectory.getWayPointCount(); ++i)
+    length += trajectory.getGroup() ?
+                  trajectory.getWayPoint(i - 1).distance(trajectory.getWayPoint(i), trajectory.getGroup()) :
+                  trajectory.getWayPoint(i - 1).distance(trajectory.getWayPoint(i));
+  return length;
+}
+}  // namespace
+
 const std::string planning_pipeline::PlanningPipeline::DISPLAY_PATH_TOPIC = "display_planned_path";
 const std::string planning_pipeline::PlanningPipeline::MOTION_PLAN_REQUEST_TOPIC = "motion_plan_request";
 const std::string planning_pipeline::PlanningPipeline::MOTION_CONTACTS_TOPIC = "display_contacts";
@@ -100,6 +375,15 @@ void planning_pipeline::PlanningPipeline::configure()
   publish_received_requests_ = false;
   display_computed_motion_plans_ = false;  // this is set to true below
 
+  bool enforce_planning_deadline = false;
+  double planning_deadline_reserve = 0.1;
+  const std::string prefix = parameter_namespace_.empty() ? "" : parameter_namespace_ + ".";
+  if (node_->has_parameter(prefix + "enforce_planning_deadline"))
+    node_->get_parameter(prefix + "enforce_planning_deadline", enforce_planning_deadline);
+  if (node_->has_parameter(prefix + "planning_deadline_reserve"))
+    node_->get_parameter(prefix + "planning_deadline_reserve", planning_deadline_reserve);
+  enforcePlanningDeadline(enforce_planning_deadline, planning_deadline_reserve);
+
   // load the planning plugin
   try
   {
@@ -217,6 +501,12 @@ void planning_pipeline::PlanningPipeline::publishReceivedRequests(bool flag)
   publish_received_requests_ = flag;
 }
 
+void planning_pipeline::PlanningPipeline::enforcePlanningDeadline(bool flag, double post_processing_reserve)
+{
+  enforce_planning_deadline_ = flag;
+  planning_deadline_reserve_ = std::min(std::max(post_processing_reserve, 0.0), 1.0);
+}
+
 void planning_pipeline::PlanningPipeline::checkSolutionPaths(bool flag)
 {
   if (check_solution_paths_ && !flag)
@@ -241,6 +531,9 @@ bool planning_pipeline::PlanningPipeline::generatePlan(const planning_scene::Pla
                                                        planning_interface::MotionPlanResponse& res,
                                                        std::vector<std::size_t>& adapter_added_state_index) const
 {
+  MOVEIT_TRACE_SCOPE("PlanningPipeline::generatePlan");
+  const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
   // broadcast the request we are about to work on, if needed
   if (publish_received_requests_)
     received_request_publisher_->publish(req);
@@ -252,32 +545,87 @@ bool planning_pipeline::PlanningPipeline::generatePlan(const planning_scene::Pla
     return false;
   }
 
+  // the solution of the planner is checked while the planning request adapters process it, which is only used if
+  // they do not change its states
+  planning_interface::PlannerManagerPtr planner = planner_instance_;
+  std::unique_ptr<DeadlineWatchdog> deadline_watchdog;
+  if (enforce_planning_deadline_ && req.allowed_planning_time > 0.0)
+  {
+    const std::chrono::steady_clock::time_point planning_deadline =
+        start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(
+                    (1.0 - planning_deadline_reserve_) * req.allowed_planning_time));
+    auto deadline_planner = std::make_shared<DeadlinePlannerManager>(planner_instance_, planning_deadline);
+    deadline_watchdog = std::make_unique<DeadlineWatchdog>(deadline_planner, planning_deadline);
+    planner = deadline_planner;
+  }
+
+  std::shared_ptr<SpeculativePathCheck> path_check;
+  if (check_solution_paths_ && adapter_chain_)
+  {
+    path_check = std::make_shared<SpeculativePathCheck>();
+    auto check_solution = [path_check, planning_scene, &req](const robot_trajectory::RobotTrajectory& solution) {
+      // keep the last solution if the adapters plan several times
+      if (path_check->invalid_index.valid())
+        path_check->invalid_index.wait();
+      path_check->solution = std::make_shared<robot_trajectory::RobotTrajectory>(solution, true);
+      path_check->invalid_index =
+          std::async(std::launch::async, [planning_scene, solution = path_check->solution,
+                                          path_constraints = req.path_constraints, group_name = req.group_name] {
+            std::vector<std::size_t> index;
+            planning_scene->isPathValid(*solution, path_constraints, group_name, false, &index);
+            return index;
+          });
+    };
+    planner = std::make_shared<SolutionObservingPlannerManager>(planner, check_solution);
+  }
+
   bool solved = false;
   try
   {
-    if (adapter_chain_)
-    {
-      solved = adapter_chain_->adaptAndPlan(planner_instance_, planning_scene, req, res, adapter_added_state_index);
-      if (!adapter_added_state_index.empty())
-      {
-        std::stringstream ss;
-        for (std::size_t added_index : adapter_added_state_index)
-          ss << added_index << " ";
-        RCLCPP_INFO(LOGGER, "Planning adapters have added states at index positions: [ %s]", ss.str().c_str());
-      }
-    }
-    else
-    {
-      planning_interface::PlanningContextPtr context =
-          planner_instance_->getPlanningContext(planning_scene, req, res.error_code_);
-      solved = context ? context->solve(res) : false;
-    }
+    solved = plan(planner, planning_scene, req, res, adapter_added_state_index);
   }
   catch (std::exception& ex)
   {
     RCLCPP_ERROR(LOGGER, "Exception caught: '%s'", ex.what());
     return false;
   }
+  deadline_watchdog.reset();
+
+  return postProcessPlan(planning_scene, req, res, adapter_added_state_index, solved, path_check.get());
+}
+
+bool planning_pipeline::PlanningPipeline::plan(const planning_interface::PlannerManagerPtr& planner,
+                                               const planning_scene::PlanningSceneConstPtr& planning_scene,
+                                               const planning_interface::MotionPlanRequest& req,
+                                               planning_interface::MotionPlanResponse& res,
+                                               std::vector<std::size_t>& adapter_added_state_index) const
+{
+  bool solved = false;
+  if (adapter_chain_)
+  {
+    solved = adapter_chain_->adaptAndPlan(planner, planning_scene, req, res, adapter_added_state_index);
+    if (!adapter_added_state_index.empty())
+    {
+      std::stringstream ss;
+      for (std::size_t added_index : adapter_added_state_index)
+        ss << added_index << " ";
+      RCLCPP_INFO(LOGGER, "Planning adapters have added states at index positions: [ %s]", ss.str().c_str());
+    }
+  }
+  else
+  {
+    planning_interface::PlanningContextPtr context = planner->getPlanningContext(planning_scene, req, res.error_code_);
+    solved = context ? context->solve(res) : false;
+  }
+  return solved;
+}
+
+bool planning_pipeline::PlanningPipeline::postProcessPlan(const planning_scene::PlanningSceneConstPtr& planning_scene,
+                                                          const planning_interface::MotionPlanRequest& req,
+                                                          planning_interface::MotionPlanResponse& res,
+                                                          const std::vector<std::size_t>& adapter_added_state_index,
+                                                          bool solved, SpeculativePathCheck* path_check) const
+{
   bool valid = true;
 
   if (solved && res.trajectory_)
@@ -287,7 +635,18 @@ bool planning_pipeline::PlanningPipeline::generatePlan(const planning_scene::Pla
     if (check_solution_paths_)
     {
       std::vector<std::size_t> index;
-      if (!planning_scene->isPathValid(*res.trajectory_, req.path_constraints, req.group_name, false, &index))
+      bool path_valid;
+      if (path_check && path_check->invalid_index.valid() &&
+          mapInvalidStates(*path_check->solution, path_check->invalid_index.get(), *res.trajectory_,
+                           adapter_added_state_index, index))
+      {
+        RCLCPP_DEBUG(LOGGER, "Using the check of the solution path that ran while the planning request adapters "
+                             "processed it");
+        path_valid = index.empty();
+      }
+      else
+        path_valid = planning_scene->isPathValid(*res.trajectory_, req.path_constraints, req.group_name, false, &index);
+      if (!path_valid)
       {
         // check to see if there is any problem with the states that are found to be invalid
         // they are considered ok if they were added by a planning request adapter
@@ -400,6 +759,114 @@ bool planning_pipeline::PlanningPipeline::generatePlan(const planning_scene::Pla
   return solved && valid;
 }
 
+bool planning_pipeline::PlanningPipeline::generatePlanPortfolio(
+    const planning_scene::PlanningSceneConstPtr& planning_scene, const planning_interface::MotionPlanRequest& req,
+    const std::vector<std::string>& planner_ids, planning_interface::MotionPlanResponse& res, PortfolioMode mode) const
+{
+  if (planner_ids.empty())
+    return generatePlan(planning_scene, req, res);
+
+  // broadcast the request we are about to work on, if needed
+  if (publish_received_requests_)
+    received_request_publisher_->publish(req);
+
+  if (!planner_instance_)
+  {
+    RCLCPP_ERROR(LOGGER, "No planning plugin loaded. Cannot plan.");
+    return false;
+  }
+
+  struct Racer
+  {
+    planning_interface::MotionPlanRequest req;
+    planning_interface::MotionPlanResponse res;
+    std::vector<std::size_t> adapter_added_state_index;
+    std::shared_ptr<TerminablePlannerManager> planner;
+    bool solved = false;
+  };
+  std::vector<Racer> racers(planner_ids.size());
+
+  std::mutex mutex;
+  std::condition_variable finished_condition;
+  std::size_t finished_count = 0;
+  std::size_t first_solution = racers.size();
+
+  std::vector<std::thread> threads;
+  for (std::size_t i = 0; i < racers.size(); ++i)
+  {
+    racers[i].req = req;
+    racers[i].req.planner_id = planner_ids[i];
+    racers[i].planner = std::make_shared<TerminablePlannerManager>(planner_instance_);
+    threads.emplace_back([&, i] {
+      Racer& racer = racers[i];
+      try
+      {
+        racer.solved = plan(racer.planner, planning_scene, racer.req, racer.res, racer.adapter_added_state_index);
+      }
+      catch (std::exception& ex)
+      {
+        RCLCPP_ERROR(LOGGER, "Exception caught while planning with '%s': '%s'", racer.req.planner_id.c_str(),
+                     ex.what());
+        racer.solved = false;
+      }
+      std::lock_guard<std::mutex> lock(mutex);
+      ++finished_count;
+      if (racer.solved && racer.res.trajectory_ && first_solution == racers.size())
+        first_solution = i;
+      finished_condition.notify_all();
+    });
+  }
+
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    if (mode == PortfolioMode::FIRST_SOLUTION)
+    {
+      finished_condition.wait(lock, [&] { return first_solution < racers.size() || finished_count == racers.size(); });
+      // Contexts may still be created or may not have started solving yet, in which case terminate() is a no-op.
+      // Keep terminating until all planners returned.
+      while (finished_count < racers.size())
+      {
+        for (Racer& racer : racers)
+          racer.planner->terminateContexts();
+        finished_condition.wait_for(lock, std::chrono::milliseconds(10));
+      }
+    }
+    else
+      finished_condition.wait(lock, [&] { return finished_count == racers.size(); });
+  }
+  for (std::thread& thread : threads)
+    thread.join();
+
+  std::size_t selected = first_solution;
+  if (mode == PortfolioMode::BEST_WITHIN_DEADLINE)
+  {
+    double best_length = std::numeric_limits<double>::infinity();
+    for (std::size_t i = 0; i < racers.size(); ++i)
+      if (racers[i].solved && racers[i].res.trajectory_)
+      {
+        double length = getPathLength(*racers[i].res.trajectory_);
+        if (length < best_length)
+        {
+          best_length = length;
+          selected = i;
+        }
+      }
+  }
+
+  if (selected == racers.size())
+  {
+    RCLCPP_INFO(LOGGER, "None of the %zu planners of the portfolio found a solution", racers.size());
+    selected = 0;
+  }
+  else
+    RCLCPP_INFO(LOGGER, "Using the solution of planner '%s' from a portfolio of %zu planners",
+                racers[selected].req.planner_id.c_str(), racers.size());
+
+  res = racers[selected].res;
+  return postProcessPlan(planning_scene, racers[selected].req, res, racers[selected].adapter_added_state_index,
+                         racers[selected].solved);
+}
+
 void planning_pipeline::PlanningPipeline::terminate() const
 {
   if (planner_instance_)
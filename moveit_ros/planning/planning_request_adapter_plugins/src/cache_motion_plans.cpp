@@ -0,0 +1,210 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, PickNik LLC
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik LLC nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include <moveit/planning_request_adapter/planning_request_adapter.h>
+#include <moveit/robot_state/conversions.h>
+#include <class_loader/class_loader.hpp>
+#include <rclcpp/rclcpp.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <list>
+#include <mutex>
+
+namespace default_planner_request_adapters
+{
+static const rclcpp::Logger LOGGER = rclcpp::get_logger("moveit_ros.cache_motion_plans");
+
+/** @brief Reuse the solution of an earlier request that only differs in the start state by a small tolerance, if the
+    solution is still valid in the current planning scene
+
+    This adapter should come first, so that the cached solutions are the results of all other adapters. */
+class CacheMotionPlans : public planning_request_adapter::PlanningRequestAdapter
+{
+public:
+  static const std::string MAX_ENTRIES_PARAM_NAME;
+  static const std::string TOLERANCE_PARAM_NAME;
+
+  void initialize(const rclcpp::Node::SharedPtr& node, const std::string& parameter_namespace) override
+  {
+    node_ = node;
+    std::string max_entries_param =
+        parameter_namespace.empty() ? MAX_ENTRIES_PARAM_NAME : parameter_namespace + "." + MAX_ENTRIES_PARAM_NAME;
+    if (!node_->get_parameter(max_entries_param, max_entries_))
+    {
+      max_entries_ = 100;
+      RCLCPP_INFO(LOGGER, "Param '%s' was not set. Using default value: %d", max_entries_param.c_str(), max_entries_);
+    }
+    else
+    {
+      RCLCPP_INFO(LOGGER, "Param '%s' was set to %d", max_entries_param.c_str(), max_entries_);
+    }
+
+    std::string tolerance_param =
+        parameter_namespace.empty() ? TOLERANCE_PARAM_NAME : parameter_namespace + "." + TOLERANCE_PARAM_NAME;
+    if (!node_->get_parameter(tolerance_param, start_state_tolerance_))
+    {
+      start_state_tolerance_ = 1e-3;
+      RCLCPP_INFO(LOGGER, "Param '%s' was not set. Using default value: %f", tolerance_param.c_str(),
+                  start_state_tolerance_);
+    }
+    else
+    {
+      RCLCPP_INFO(LOGGER, "Param '%s' was set to %f", tolerance_param.c_str(), start_state_tolerance_);
+    }
+  }
+
+  std::string getDescription() const override
+  {
+    return "Cache Motion Plans";
+  }
+
+  bool adaptAndPlan(const PlannerFn& planner, const planning_scene::PlanningSceneConstPtr& planning_scene,
+                    const planning_interface::MotionPlanRequest& req, planning_interface::MotionPlanResponse& res,
+                    std::vector<std::size_t>& added_path_index) const override
+  {
+    RCLCPP_DEBUG(LOGGER, "Running '%s'", getDescription().c_str());
+    const moveit::core::RobotModelConstPtr& robot_model = planning_scene->getRobotModel();
+    if (max_entries_ <= 0 || !robot_model->hasJointModelGroup(req.group_name))
+      return planner(planning_scene, req, res);
+    auto start_time = std::chrono::steady_clock::now();
+
+    // the start state is compared with a tolerance, everything else that affects the solution must be the same
+    planning_interface::MotionPlanRequest key = req;
+    key.start_state = moveit_msgs::msg::RobotState();
+    key.allowed_planning_time = 0.0;
+    key.num_planning_attempts = 0;
+
+    moveit::core::RobotState start_state = planning_scene->getCurrentState();
+    moveit::core::robotStateMsgToRobotState(planning_scene->getTransforms(), req.start_state, start_state);
+    std::vector<double> start_positions;
+    start_state.copyJointGroupPositions(req.group_name, start_positions);
+
+    // the waypoints of the cached solutions carry the attached bodies of their start state
+    std::vector<const moveit::core::AttachedBody*> attached_bodies;
+    start_state.getAttachedBodies(attached_bodies);
+    std::vector<std::pair<std::string, std::string>> attached_body_links;
+    for (const moveit::core::AttachedBody* attached_body : attached_bodies)
+      attached_body_links.emplace_back(attached_body->getName(), attached_body->getAttachedLinkName());
+    std::sort(attached_body_links.begin(), attached_body_links.end());
+
+    robot_trajectory::RobotTrajectoryConstPtr cached_trajectory;
+    std::vector<std::size_t> cached_added_path_index;
+    {
+      std::unique_lock<std::mutex> lock(cache_lock_);
+      for (auto it = cache_.begin(); it != cache_.end(); ++it)
+        if (isSameStart(it->start_positions, start_positions) && it->attached_body_links == attached_body_links &&
+            it->key == key)
+        {
+          // the most recently used solutions are kept longest
+          cache_.splice(cache_.begin(), cache_, it);
+          cached_trajectory = it->trajectory;
+          cached_added_path_index = it->added_path_index;
+          break;
+        }
+    }
+
+    if (cached_trajectory)
+    {
+      // the scene may have changed since the solution was stored
+      std::vector<std::size_t> invalid_index;
+      if (planning_scene->isPathValid(*cached_trajectory, req.path_constraints, req.goal_constraints, req.group_name,
+                                      false, &invalid_index))
+      {
+        res.trajectory_ = std::make_shared<robot_trajectory::RobotTrajectory>(*cached_trajectory, true);
+        res.error_code_.val = moveit_msgs::msg::MoveItErrorCodes::SUCCESS;
+        res.planning_time_ = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+        added_path_index = cached_added_path_index;
+        RCLCPP_DEBUG(LOGGER, "Reusing a cached solution for group '%s'", req.group_name.c_str());
+        return true;
+      }
+
+      RCLCPP_DEBUG(LOGGER, "Discarding the cached solution, which is invalid at %zu states in the current scene",
+                   invalid_index.size());
+      std::unique_lock<std::mutex> lock(cache_lock_);
+      cache_.remove_if([&cached_trajectory](const Entry& entry) { return entry.trajectory == cached_trajectory; });
+    }
+
+    if (!planner(planning_scene, req, res) || !res.trajectory_ || res.trajectory_->empty())
+      return false;
+
+    Entry entry;
+    entry.key = std::move(key);
+    entry.start_positions = std::move(start_positions);
+    entry.attached_body_links = std::move(attached_body_links);
+    entry.trajectory = std::make_shared<robot_trajectory::RobotTrajectory>(*res.trajectory_, true);
+    entry.added_path_index = added_path_index;
+
+    std::unique_lock<std::mutex> lock(cache_lock_);
+    cache_.push_front(std::move(entry));
+    if (cache_.size() > static_cast<std::size_t>(max_entries_))
+      cache_.pop_back();
+    return true;
+  }
+
+private:
+  struct Entry
+  {
+    planning_interface::MotionPlanRequest key;
+    std::vector<double> start_positions;
+    std::vector<std::pair<std::string, std::string>> attached_body_links;  // sorted pairs of body and link names
+    robot_trajectory::RobotTrajectoryConstPtr trajectory;
+    std::vector<std::size_t> added_path_index;
+  };
+
+  bool isSameStart(const std::vector<double>& a, const std::vector<double>& b) const
+  {
+    if (a.size() != b.size())
+      return false;
+    for (std::size_t i = 0; i < a.size(); ++i)
+      if (std::fabs(a[i] - b[i]) > start_state_tolerance_)
+        return false;
+    return true;
+  }
+
+  rclcpp::Node::SharedPtr node_;
+  int max_entries_;
+  double start_state_tolerance_;
+
+  // the most recently used solution first
+  mutable std::list<Entry> cache_;
+  mutable std::mutex cache_lock_;
+};
+
+const std::string CacheMotionPlans::MAX_ENTRIES_PARAM_NAME = "cache_max_entries";
+const std::string CacheMotionPlans::TOLERANCE_PARAM_NAME = "cache_start_state_tolerance";
+}  // namespace default_planner_request_adapters
+
+CLASS_LOADER_REGISTER_CLASS(default_planner_request_adapters::CacheMotionPlans,
+                            planning_request_adapter::PlanningRequestAdapter)
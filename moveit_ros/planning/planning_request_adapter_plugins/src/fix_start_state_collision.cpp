@@ -39,6 +39,10 @@
 #include <moveit/trajectory_processing/trajectory_tools.h>
 #include <class_loader/class_loader.hpp>
 #include <rclcpp/rclcpp.hpp>
+#include <algorithm>
+#include <limits>
+#include <mutex>
+#include <thread>
 
 namespace default_planner_request_adapters
 {
@@ -50,6 +54,7 @@ public:
   static const std::string DT_PARAM_NAME;
   static const std::string JIGGLE_PARAM_NAME;
   static const std::string ATTEMPTS_PARAM_NAME;
+  static const std::string THREADS_PARAM_NAME;
 
   void initialize(const rclcpp::Node::SharedPtr& node, const std::string& parameter_namespace) override
   {
@@ -90,6 +95,17 @@ public:
       }
       RCLCPP_INFO(LOGGER, "Param '%s' was set to %f", ATTEMPTS_PARAM_NAME.c_str(), sampling_attempts_);
     }
+
+    if (!node_->get_parameter(parameter_namespace + "." + THREADS_PARAM_NAME, sampling_threads_))
+    {
+      sampling_threads_ = std::max(1, std::min(4, static_cast<int>(std::thread::hardware_concurrency())));
+      RCLCPP_INFO(LOGGER, "Param '%s' was not set. Using default value: %d", THREADS_PARAM_NAME.c_str(),
+                  sampling_threads_);
+    }
+    else
+    {
+      RCLCPP_INFO(LOGGER, "Param '%s' was set to %d", THREADS_PARAM_NAME.c_str(), sampling_threads_);
+    }
   }
 
   std::string getDescription() const override
@@ -132,29 +148,59 @@ public:
               planning_scene->getRobotModel()->getJointModelGroup(req.group_name)->getJointModels() :
               planning_scene->getRobotModel()->getJointModels();
 
-      bool found = false;
-      for (int c = 0; !found && c < sampling_attempts_; ++c)
-      {
-        for (std::size_t i = 0; !found && i < jmodels.size(); ++i)
+      // the attempts are distributed over the threads, the valid state of the first successful attempt is used
+      const int thread_count = std::max(1, std::min(sampling_threads_, sampling_attempts_));
+      int found_attempt = sampling_attempts_;
+      std::mutex found_lock;
+      auto sample = [&](int thread_index, boost::uint32_t seed) {
+        random_numbers::RandomNumberGenerator thread_rng(seed);
+        moveit::core::RobotState sample_state(*prefix_state);
+        std::vector<double> sampled_variable_values;
+        for (int c = thread_index; c < sampling_attempts_; c += thread_count)
         {
-          std::vector<double> sampled_variable_values(jmodels[i]->getVariableCount());
-          const double* original_values = prefix_state->getJointPositions(jmodels[i]);
-          jmodels[i]->getVariableRandomPositionsNearBy(rng, &sampled_variable_values[0], original_values,
-                                                       jmodels[i]->getMaximumExtent() * jiggle_fraction_);
-          start_state.setJointPositions(jmodels[i], sampled_variable_values);
-          collision_detection::CollisionResult cres;
-          planning_scene->checkCollision(creq, cres, start_state);
-          if (!cres.collision)
           {
-            found = true;
-            RCLCPP_INFO(LOGGER, "Found a valid state near the start state at distance %lf after %d attempts",
-                        prefix_state->distance(start_state), c);
+            std::unique_lock<std::mutex> lock(found_lock);
+            if (c > found_attempt)
+              return;
+          }
+          for (const moveit::core::JointModel* jmodel : jmodels)
+          {
+            sampled_variable_values.resize(jmodel->getVariableCount());
+            const double* original_values = prefix_state->getJointPositions(jmodel);
+            jmodel->getVariableRandomPositionsNearBy(thread_rng, &sampled_variable_values[0], original_values,
+                                                     jmodel->getMaximumExtent() * jiggle_fraction_);
+            sample_state.setJointPositions(jmodel, sampled_variable_values);
+            collision_detection::CollisionResult cres;
+            planning_scene->checkCollision(creq, cres, sample_state);
+            if (!cres.collision)
+            {
+              std::unique_lock<std::mutex> lock(found_lock);
+              if (c < found_attempt)
+              {
+                found_attempt = c;
+                start_state = sample_state;
+              }
+              return;
+            }
           }
         }
-      }
-
-      if (found)
+      };
+
+      std::vector<boost::uint32_t> seeds(thread_count);
+      for (boost::uint32_t& seed : seeds)
+        seed = rng.uniformInteger(0, std::numeric_limits<int>::max());
+      std::vector<std::thread> threads;
+      threads.reserve(thread_count - 1);
+      for (int t = 1; t < thread_count; ++t)
+        threads.emplace_back(sample, t, seeds[t]);
+      sample(0, seeds[0]);
+      for (std::thread& thread : threads)
+        thread.join();
+
+      if (found_attempt < sampling_attempts_)
       {
+        RCLCPP_INFO(LOGGER, "Found a valid state near the start state at distance %lf after %d attempts",
+                    prefix_state->distance(start_state), found_attempt);
         planning_interface::MotionPlanRequest req2 = req;
         moveit::core::robotStateToRobotStateMsg(start_state, req2.start_state);
         bool solved = planner(planning_scene, req2, res);
@@ -196,11 +242,13 @@ private:
   double max_dt_offset_;
   double jiggle_fraction_;
   int sampling_attempts_;
+  int sampling_threads_;
 };
 
 const std::string FixStartStateCollision::DT_PARAM_NAME = "start_state_max_dt";
 const std::string FixStartStateCollision::JIGGLE_PARAM_NAME = "jiggle_fraction";
 const std::string FixStartStateCollision::ATTEMPTS_PARAM_NAME = "max_sampling_attempts";
+const std::string FixStartStateCollision::THREADS_PARAM_NAME = "sampling_threads";
 }  // namespace default_planner_request_adapters
 
 CLASS_LOADER_REGISTER_CLASS(default_planner_request_adapters::FixStartStateCollision,
@@ -45,6 +45,10 @@
 #include <boost/signals2.hpp>
 #include <rclcpp/rclcpp.hpp>
 
+#include <atomic>
+#include <cstdint>
+#include <limits>
+
 namespace planning_scene_monitor
 {
 using JointStateUpdateCallback = boost::function<void(const sensor_msgs::msg::JointState::ConstSharedPtr&)>;
@@ -78,6 +82,11 @@ public:
   /** @brief Check if the state monitor is started */
   bool isActive() const;
 
+  /** @brief Update the monitored state from a joint state, as if it was received on the joint states
+   *  topic. Used to feed states from a simulation in the same process without a topic round trip.
+   */
+  void updateJointState(const sensor_msgs::msg::JointState::ConstSharedPtr& joint_state);
+
   /** @brief Get the RobotModel for which we are monitoring state */
   const moveit::core::RobotModelConstPtr& getRobotModel() const
   {
@@ -129,6 +138,22 @@ public:
    *  @return Returns the map from joint names to joint state values*/
   std::map<std::string, double> getCurrentStateValues() const;
 
+  /** @brief Keep the last \e length received joint states, to look up past states with getStateAtTime().
+   *  The history is disabled by default (length 0). It must not be resized while getStateAtTime() is called.
+   *  @param length The number of joint state messages to keep, e.g. one second worth of messages */
+  void setStateHistoryLength(std::size_t length);
+
+  /** @brief Get the number of joint states kept to look up past states */
+  std::size_t getStateHistoryLength() const
+  {
+    return history_.size();
+  }
+
+  /** @brief Set the joint positions of \e state to those of the robot at time \e t, interpolated between the two
+   *  joint states received around \e t. This does not block the joint state callback.
+   *  @return false if \e t is older than the history or newer than the last received joint state */
+  bool getStateAtTime(const rclcpp::Time& t, moveit::core::RobotState& state) const;
+
   /** @brief Wait for at most \e wait_time seconds (default 1s) for a robot state more recent than t
    *  @return true on success, false if up-to-date robot state wasn't received within \e wait_time
    */
@@ -184,15 +209,49 @@ private:
   void jointStateCallback(const sensor_msgs::msg::JointState::ConstSharedPtr joint_state);
   void tfCallback();
 
+  /** @brief The joint values and time stamp of a copy of the current state */
+  struct StateSnapshot
+  {
+    std::vector<double> values;  // positions, velocities and efforts, each indexed by variable index
+    bool has_velocities;
+    bool has_effort;
+    rclcpp::Time stamp;
+  };
+
+  /** @brief Publish robot_state_ and current_state_time_ to the readers. Must be called with state_update_lock_ held */
+  void writeSnapshot();
+
+  /** @brief Copy the last published state, without locking state_update_lock_ */
+  void readSnapshot(StateSnapshot& snapshot) const;
+
+  /** @brief A received state in the history, written with its own sequence lock like the current state */
+  struct StateHistoryEntry
+  {
+    std::atomic<std::uint64_t> sequence{ 0 };
+    std::atomic<std::uint64_t> index{ std::numeric_limits<std::uint64_t>::max() };  // number of the recorded state
+    std::atomic<std::int64_t> stamp{ 0 };                                             // nanoseconds
+    std::vector<std::atomic<double>> positions;
+  };
+
+  /** @brief Record robot_state_ at current_state_time_ in the history. Must be called with state_update_lock_ held */
+  void recordStateHistory();
+
+  /** @brief Copy the positions and time stamp of the recorded state number \e index
+   *  @return false if the history does not contain this state (anymore) */
+  bool readStateHistory(std::uint64_t index, std::vector<double>* positions, std::int64_t& stamp) const;
+
   std::shared_ptr<rclcpp::Node> node_;
   std::shared_ptr<tf2_ros::Buffer> tf_buffer_;
   moveit::core::RobotModelConstPtr robot_model_;
   moveit::core::RobotState robot_state_;
+  moveit::core::VariableIndexMapping joint_state_mapping_;  // variable indices of the received joint state names
   std::map<const moveit::core::JointModel*, rclcpp::Time> joint_time_;
   bool state_monitor_started_;
   bool copy_dynamics_;  // Copy velocity and effort from joint_state
   rclcpp::Time monitor_start_time_ = rclcpp::Time(0, 0, RCL_ROS_TIME);
   double error_;
+  // Joint states are received in their own callback group, so that other callbacks of the node do not delay them
+  rclcpp::CallbackGroup::SharedPtr callback_group_;
   rclcpp::Subscription<sensor_msgs::msg::JointState>::SharedPtr joint_state_subscriber_;
   rclcpp::Time current_state_time_ = rclcpp::Time(0, 0, RCL_ROS_TIME);
 
@@ -200,6 +259,20 @@ private:
   mutable std::condition_variable state_update_condition_;
   std::vector<JointStateUpdateCallback> update_callbacks_;
 
+  // The current state is published in a sequence lock, so that getting the state never waits for the joint state
+  // callback and vice versa: the sequence number is odd while the writer updates the values, and readers retry
+  // their copy if it changed meanwhile.
+  std::atomic<std::uint64_t> snapshot_sequence_;
+  std::vector<std::atomic<double>> snapshot_values_;
+  std::atomic<bool> snapshot_has_velocities_;
+  std::atomic<bool> snapshot_has_effort_;
+  std::atomic<std::int64_t> snapshot_stamp_;  // nanoseconds of current_state_time_
+
+  // ring buffer of the last received states, with increasing time stamps. The state number i is stored in entry
+  // i % history_.size(), and history_count_ is the number of states recorded so far
+  std::vector<StateHistoryEntry> history_;
+  std::atomic<std::uint64_t> history_count_;
+
   std::shared_ptr<TFConnection> tf_connection_;
 };
 
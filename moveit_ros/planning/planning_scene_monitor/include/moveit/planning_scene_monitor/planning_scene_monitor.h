@@ -44,12 +44,20 @@
 #include <moveit/robot_model_loader/robot_model_loader.h>
 #include <moveit/occupancy_map_monitor/occupancy_map_monitor.h>
 #include <moveit/planning_scene_monitor/current_state_monitor.h>
+#include <moveit/planning_scene_monitor/shared_planning_scene.h>
 #include <moveit/collision_plugin_loader/collision_plugin_loader.h>
 #include <moveit_msgs/srv/get_planning_scene.hpp>
+#include <diagnostic_msgs/msg/diagnostic_array.hpp>
 #include <boost/noncopyable.hpp>
 #include <boost/thread/shared_mutex.hpp>
 #include <boost/thread/recursive_mutex.hpp>
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <map>
 #include <memory>
+#include <mutex>
 #include <thread>
 
 namespace planning_scene_monitor
@@ -104,6 +112,13 @@ public:
   /// name, so the topic is prefixed by the node name)
   static const std::string MONITORED_PLANNING_SCENE_TOPIC;  // "monitored_planning_scene"
 
+  /// The name of the shared memory segment used by default for sharing the monitored planning scene with other
+  /// processes on the same host
+  static const std::string DEFAULT_SHARED_PLANNING_SCENE;  // "moveit_shared_planning_scene"
+
+  /// The name of the topic used by default for publishing the memory usage of the monitored planning scene
+  static const std::string DEFAULT_MEMORY_USAGE_TOPIC;  // "/diagnostics"
+
   /** @brief Constructor
    *  @param robot_description The name of the ROS parameter that contains the URDF (in string format)
    *  @param tf_buffer A pointer to a tf2_ros::Buffer
@@ -146,6 +161,16 @@ public:
 
   ~PlanningSceneMonitor();
 
+  /** \brief Make \e monitor available to other components of this process through getSharedMonitor().
+   *
+   * Components running in the same process can then use a single monitored scene instead of each one subscribing to
+   * and deserializing the same scene updates. The monitor is registered for its robot description, replacing any
+   * monitor shared before. Only a weak reference is kept, so sharing does not extend the lifetime of the monitor. */
+  static void shareMonitor(const PlanningSceneMonitorPtr& monitor);
+
+  /** \brief Get the monitor shared for \e robot_description in this process, or nullptr if there is none */
+  static PlanningSceneMonitorPtr getSharedMonitor(const std::string& robot_description);
+
   /** \brief Get the name of this monitor */
   const std::string& getName() const
   {
@@ -246,6 +271,26 @@ public:
       publishing planning scenes. */
   void monitorDiffs(bool flag);
 
+  /** \brief Enable or disable immutable snapshots of the maintained planning scene.
+   *
+   * While enabled, every update announced by triggerSceneUpdateEvent() publishes a new snapshot, a standalone copy of
+   * the scene with its own copy of the octree. getPlanningSceneSnapshot() then returns the latest snapshot without
+   * waiting for updates that are in progress. */
+  void setSceneSnapshotsEnabled(bool flag);
+
+  /** \brief Check whether immutable scene snapshots are maintained */
+  bool getSceneSnapshotsEnabled() const
+  {
+    return scene_snapshots_enabled_;
+  }
+
+  /** \brief Get an immutable copy of the maintained planning scene.
+   *
+   * With snapshots enabled, this returns the most recently published snapshot in constant time and never blocks on
+   * scene writers. Otherwise, a new copy is created while holding the scene's read lock. The snapshot does not change
+   * when the monitored scene is updated; call this function again to get the new version. */
+  planning_scene::PlanningSceneConstPtr getPlanningSceneSnapshot();
+
   /** \brief Start publishing the maintained planning scene. The first message set out is a complete planning scene.
       Diffs are sent afterwards on updates specified by the \e event bitmask. For UPDATE_SCENE, the full scene is always
      sent. */
@@ -255,6 +300,34 @@ public:
   /** \brief Stop publishing the maintained planning scene. */
   void stopPublishingPlanningScene();
 
+  /** \brief Start sharing the maintained planning scene in the shared memory segment \e name, which
+      SharedPlanningSceneReader instances in other processes on the same host map read-only. The robot state is
+      rewritten on every state update; the world objects and the octomap are each serialized once they changed. */
+  void startSharingPlanningScene(const std::string& name = DEFAULT_SHARED_PLANNING_SCENE);
+
+  /** \brief Stop sharing the maintained planning scene and remove its shared memory segment. */
+  void stopSharingPlanningScene();
+
+  /** \brief Start publishing the estimated memory usage of the maintained planning scene (world shapes, collision
+      environments, the FCL mesh cache and the cached service messages) every \e period seconds, as a diagnostic
+      status on \e topic. */
+  void startPublishingMemoryUsage(double period = 1.0, const std::string& topic = DEFAULT_MEMORY_USAGE_TOPIC);
+
+  /** \brief Stop publishing the memory usage of the maintained planning scene. */
+  void stopPublishingMemoryUsage();
+
+  /** \brief Set the memory budget of the maintained planning scene (in bytes). If the published memory usage exceeds
+      it, the status is a warning and the cached service messages are dropped. Zero disables the budget (default). */
+  void setMemoryBudget(std::size_t max_bytes)
+  {
+    memory_budget_ = max_bytes;
+  }
+
+  std::size_t getMemoryBudget() const
+  {
+    return memory_budget_;
+  }
+
   /** \brief Set the maximum frequency at which planning scenes are being published */
   void setPlanningScenePublishingFrequency(double hz);
 
@@ -332,9 +405,12 @@ public:
    *         without having to use a move_group node.
    *         Be careful not to use this in conjunction with requestPlanningSceneState(),
    *         as it will create a pointless feedback loop.
+   *         The world geometry and the octomap are serialized once after they changed and served from a cache.
    *  @param service_name The topic to provide the service
+   *  @param binary_octomap Send the octomap in the compact binary format, see PlanningScene::getOctomapMsg()
    */
-  void providePlanningSceneService(const std::string& service_name = DEFAULT_PLANNING_SCENE_SERVICE);
+  void providePlanningSceneService(const std::string& service_name = DEFAULT_PLANNING_SCENE_SERVICE,
+                                   bool binary_octomap = false);
 
   /** @brief Stop the scene monitor*/
   void stopSceneMonitor();
@@ -381,20 +457,52 @@ public:
    */
   bool waitForCurrentRobotState(const rclcpp::Time& t, double wait_time = 1.);
 
-  /** \brief Lock the scene for reading (multiple threads can lock for reading at the same time) */
-  void lockSceneRead();
+  /** \brief Lock the scene for reading (multiple threads can lock for reading at the same time)
+   *  @param holder The name of the lock holder in the lock statistics, which must be a string literal */
+  void lockSceneRead(const char* holder = "lockSceneRead");
 
   /** \brief Unlock the scene from reading (multiple threads can lock for reading at the same time) */
   void unlockSceneRead();
 
   /** \brief Lock the scene for writing (only one thread can lock for writing and no other thread can lock for reading)
-   */
-  void lockSceneWrite();
+   *  @param holder The name of the lock holder in the lock statistics, which must be a string literal */
+  void lockSceneWrite(const char* holder = "lockSceneWrite");
 
   /** \brief Lock the scene from writing (only one thread can lock for writing and no other thread can lock for reading)
    */
   void unlockSceneWrite();
 
+  /** \brief The number of times a holder locked the scene, and how long it waited for the lock and held it */
+  struct SceneLockStatistics
+  {
+    static const std::size_t HISTOGRAM_SIZE = 24;
+
+    std::size_t count = 0;
+    double total_wait_time = 0.0;  // seconds
+    double max_wait_time = 0.0;
+    double total_hold_time = 0.0;
+    double max_hold_time = 0.0;
+    // bucket i counts the times in [2^i, 2^(i+1)) microseconds, the last bucket also all longer times
+    std::array<std::size_t, HISTOGRAM_SIZE> wait_time_histogram{};
+    std::array<std::size_t, HISTOGRAM_SIZE> hold_time_histogram{};
+  };
+
+  /** \brief Get the statistics of the scene lock by holder and lock type, e.g. "octomapUpdateCallback (write)" */
+  std::map<std::string, SceneLockStatistics> getSceneLockStatistics() const;
+
+  /** \brief Warn when a holder keeps the scene locked for writing for longer than \e threshold seconds (0.5 s by
+   *  default) */
+  void setSceneWriteLockWarningThreshold(double threshold)
+  {
+    scene_write_lock_warning_threshold_ = threshold;
+  }
+
+  /** \brief Create a standalone copy of the maintained scene that no longer shares the octree with the monitor */
+  planning_scene::PlanningScenePtr copyPlanningScene();
+
+  /** \brief Publish a new snapshot for getPlanningSceneSnapshot() */
+  void updateSceneSnapshot();
+
   void clearOctomap();
 
   // Called to update the planning scene with a new message.
@@ -421,6 +529,22 @@ protected:
   /** @brief Callback for octomap updates */
   void octomapUpdateCallback();
 
+  /** @brief Announce a scene update, see triggerSceneUpdateEvent(). Unless \e world_objects_changed, only the octomap
+   *  of the world geometry changed */
+  void triggerSceneUpdateEvent(SceneUpdateType update_type, bool world_objects_changed);
+
+  /** @brief Write the scene to the shared memory segment whenever an update is announced */
+  void sharedSceneThread();
+
+  /** @brief Publish the memory usage of the scene, called by memory_usage_timer_ */
+  void memoryUsageTimerCallback();
+
+  /** @brief The collision objects of the scene as served by the planning scene service, the scene must be locked */
+  std::shared_ptr<const std::vector<moveit_msgs::msg::CollisionObject>> getCachedCollisionObjectMsgs();
+
+  /** @brief The octomap of the scene as served by the planning scene service, the scene must be locked */
+  std::shared_ptr<const octomap_msgs::msg::OctomapWithPose> getCachedOctomapMsg();
+
   /** @brief Callback for a new attached object msg*/
   void attachObjectCallback(moveit_msgs::msg::AttachedCollisionObject::SharedPtr obj);
 
@@ -457,13 +581,20 @@ protected:
   rclcpp::Time last_update_time_;                  /// Last time the state was updated
   rclcpp::Time last_robot_motion_time_;            /// Last time the robot has moved
 
+  /// latest immutable copy of the scene, if snapshots are enabled
+  planning_scene::PlanningSceneConstPtr scene_snapshot_;
+  std::mutex scene_snapshot_lock_;
+  std::atomic<bool> scene_snapshots_enabled_;
+
   std::shared_ptr<rclcpp::Node> node_;
 
   // TODO: (anasarrak) callbacks on ROS2?
   // https://answers.ros.org/question/300874/how-do-you-use-callbackgroups-as-a-replacement-for-callbackqueues-in-ros2/
   // ros::CallbackQueue queue_;
   std::shared_ptr<rclcpp::Node> pnode_;
-  std::shared_ptr<rclcpp::executors::SingleThreadedExecutor> private_executor_;
+  // Spins pnode_. Joint state updates are in their own callback group and get a thread of their own, so that
+  // processing planning scene updates does not delay them.
+  std::shared_ptr<rclcpp::executors::MultiThreadedExecutor> private_executor_;
   std::thread private_executor_thread_;
 
   std::shared_ptr<tf2_ros::Buffer> tf_buffer_;
@@ -489,8 +620,23 @@ protected:
   double publish_planning_scene_frequency_;
   SceneUpdateType publish_update_types_;
   std::atomic<SceneUpdateType> new_scene_update_;
+  std::atomic<bool> attached_bodies_changed_;  /// attached bodies changed since the last published diff
   boost::condition_variable_any new_scene_update_condition_;
 
+  // variables for sharing the planning scene in shared memory
+  SharedPlanningSceneWriterPtr shared_scene_writer_;
+  std::thread shared_scene_thread_;
+  std::mutex shared_scene_mutex_;
+  std::condition_variable shared_scene_condition_;
+  bool shared_scene_running_;
+  bool shared_geometry_pending_;  /// the geometry changed since it was last written, under shared_scene_mutex_
+  bool shared_state_pending_;     /// the robot state changed since it was last written, under shared_scene_mutex_
+
+  // variables for publishing the memory usage
+  rclcpp::Publisher<diagnostic_msgs::msg::DiagnosticArray>::SharedPtr memory_usage_publisher_;
+  rclcpp::TimerBase::SharedPtr memory_usage_timer_;
+  std::atomic<std::size_t> memory_budget_;
+
   // subscribe to various sources of data
   rclcpp::Subscription<moveit_msgs::msg::PlanningScene>::SharedPtr planning_scene_subscriber_;
   rclcpp::Subscription<moveit_msgs::msg::PlanningSceneWorld>::SharedPtr planning_scene_world_subscriber_;
@@ -501,9 +647,22 @@ protected:
   // provide an optional service to get the full planning scene state
   // this is used by MoveGroup and related application nodes
   rclcpp::Service<moveit_msgs::srv::GetPlanningScene>::SharedPtr get_scene_service_;
+  bool binary_octomap_service_;
+
+  // The service serializes the world geometry and the octomap only after their version changed. The versions are
+  // incremented with every announced geometry update.
+  std::atomic<std::uint64_t> world_objects_version_;
+  std::atomic<std::uint64_t> octomap_version_;
+  std::mutex scene_msg_cache_mutex_;
+  std::shared_ptr<const std::vector<moveit_msgs::msg::CollisionObject>> cached_collision_objects_;
+  std::uint64_t cached_collision_objects_version_;
+  std::shared_ptr<const octomap_msgs::msg::OctomapWithPose> cached_octomap_;
+  std::uint64_t cached_octomap_version_;
 
   // include a octomap monitor
   std::unique_ptr<occupancy_map_monitor::OccupancyMapMonitor> octomap_monitor_;
+  std::atomic<bool> octomap_world_outdated_;  /// the scene's octomap may not refer to the monitored octree
+  std::size_t last_octree_size_;             /// number of octree nodes at the last octomap update, under tree lock
 
   // include a current state monitor
   CurrentStateMonitorPtr current_state_monitor_;
@@ -527,6 +686,15 @@ protected:
                                                                            /// are received
 
 private:
+  /** \brief Exclusive lock of scene_update_mutex_ (without the octree) that adds its wait and hold times to the
+      scene lock statistics */
+  class SceneUpdateLock;
+
+  /** \brief Add a lock of the scene, from the trace clock times it was requested, acquired and released, to the
+      scene lock statistics */
+  void recordSceneLock(const char* holder, bool write, std::int64_t request_time, std::int64_t acquire_time,
+                       std::int64_t release_time);
+
   void getUpdatedFrameTransforms(std::vector<geometry_msgs::msg::TransformStamped>& transforms);
 
   // publish planning scene update diffs (runs in its own thread)
@@ -559,6 +727,16 @@ private:
   // This field is protected by state_pending_mutex_
   std::chrono::duration<double> dt_state_update_;  // 1hz
 
+  /// statistics of the scene lock by holder and lock type
+  mutable std::mutex scene_lock_statistics_mutex_;
+  std::map<std::string, SceneLockStatistics> scene_lock_statistics_;
+  std::atomic<double> scene_write_lock_warning_threshold_{ 0.5 };
+
+  /// the holder of the write lock and when it requested and acquired it, protected by scene_update_mutex_
+  const char* scene_write_lock_holder_ = nullptr;
+  std::int64_t scene_write_lock_request_time_ = 0;
+  std::int64_t scene_write_lock_acquire_time_ = 0;
+
   /// the amount of time to wait when looking up transforms
   // Setting this to a non-zero value resolves issues when the sensor data is
   // arriving so fast that it is preceding the transform state.
@@ -606,10 +784,11 @@ private:
 class LockedPlanningSceneRO
 {
 public:
-  LockedPlanningSceneRO(const PlanningSceneMonitorPtr& planning_scene_monitor)
+  LockedPlanningSceneRO(const PlanningSceneMonitorPtr& planning_scene_monitor,
+                        const char* holder = "LockedPlanningSceneRO")
     : planning_scene_monitor_(planning_scene_monitor)
   {
-    initialize(true);
+    initialize(true, holder);
   }
 
   const PlanningSceneMonitorPtr& getPlanningSceneMonitor()
@@ -633,16 +812,16 @@ public:
   }
 
 protected:
-  LockedPlanningSceneRO(const PlanningSceneMonitorPtr& planning_scene_monitor, bool read_only)
+  LockedPlanningSceneRO(const PlanningSceneMonitorPtr& planning_scene_monitor, bool read_only, const char* holder)
     : planning_scene_monitor_(planning_scene_monitor)
   {
-    initialize(read_only);
+    initialize(read_only, holder);
   }
 
-  void initialize(bool read_only)
+  void initialize(bool read_only, const char* holder)
   {
     if (planning_scene_monitor_)
-      lock_.reset(new SingleUnlock(planning_scene_monitor_.get(), read_only));
+      lock_.reset(new SingleUnlock(planning_scene_monitor_.get(), read_only, holder));
   }
 
   MOVEIT_STRUCT_FORWARD(SingleUnlock)
@@ -651,13 +830,13 @@ protected:
   // even if the LockedPlanningScene instance is copied around
   struct SingleUnlock
   {
-    SingleUnlock(PlanningSceneMonitor* planning_scene_monitor, bool read_only)
+    SingleUnlock(PlanningSceneMonitor* planning_scene_monitor, bool read_only, const char* holder)
       : planning_scene_monitor_(planning_scene_monitor), read_only_(read_only)
     {
       if (read_only)
-        planning_scene_monitor_->lockSceneRead();
+        planning_scene_monitor_->lockSceneRead(holder);
       else
-        planning_scene_monitor_->lockSceneWrite();
+        planning_scene_monitor_->lockSceneWrite(holder);
     }
     ~SingleUnlock()
     {
@@ -698,8 +877,9 @@ protected:
 class LockedPlanningSceneRW : public LockedPlanningSceneRO
 {
 public:
-  LockedPlanningSceneRW(const PlanningSceneMonitorPtr& planning_scene_monitor)
-    : LockedPlanningSceneRO(planning_scene_monitor, false)
+  LockedPlanningSceneRW(const PlanningSceneMonitorPtr& planning_scene_monitor,
+                        const char* holder = "LockedPlanningSceneRW")
+    : LockedPlanningSceneRO(planning_scene_monitor, false, holder)
   {
   }
 
@@ -0,0 +1,156 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, PickNik LLC
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik LLC nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#pragma once
+
+#include <moveit/macros/class_forward.h>
+#include <moveit/planning_scene/planning_scene.h>
+#include <moveit_msgs/msg/planning_scene.hpp>
+#include <octomap_msgs/msg/octomap_with_pose.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <boost/interprocess/shared_memory_object.hpp>
+#include <rclcpp/rclcpp.hpp>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace planning_scene_monitor
+{
+MOVEIT_CLASS_FORWARD(SharedPlanningSceneWriter)  // Defines SharedPlanningSceneWriterPtr, ConstPtr, WeakPtr... etc
+MOVEIT_CLASS_FORWARD(SharedPlanningSceneReader)  // Defines SharedPlanningSceneReaderPtr, ConstPtr, WeakPtr... etc
+
+/** @brief Publishes a planning scene in a shared memory segment, which other processes on the same host map read-only.
+ *
+ *  The segment holds the positions of the robot state, which readers access without any deserialization, the
+ *  serialized rest of the scene apart from the octomap (world objects, attached objects, allowed collisions...) and
+ *  the serialized octomap. The scene and the octomap have their own versions, readers only deserialize what changed,
+ *  so a new octomap does not make them rebuild the world objects. The state and the serialized parts are written
+ *  under their own sequence locks, so the writer never waits for readers. If the serialized parts outgrow the segment,
+ *  a larger segment of the same name replaces it and readers map it again.
+ *
+ *  The constructor and the write functions throw boost::interprocess::interprocess_exception if the segment cannot
+ *  be created. */
+class SharedPlanningSceneWriter
+{
+public:
+  /** @brief Create the segment \e name (a name without slashes) for scenes of \e robot_model */
+  SharedPlanningSceneWriter(const std::string& name, const moveit::core::RobotModelConstPtr& robot_model);
+
+  /** @brief Remove the segment. Readers that mapped it keep the last published scene */
+  ~SharedPlanningSceneWriter();
+
+  SharedPlanningSceneWriter(const SharedPlanningSceneWriter&) = delete;
+  SharedPlanningSceneWriter& operator=(const SharedPlanningSceneWriter&) = delete;
+
+  const std::string& getName() const
+  {
+    return name_;
+  }
+
+  /** @brief Publish \e scene, apart from the robot state positions and the octomap, and increment the geometry
+   *  version. Readers replace the octomap of \e scene by the one published with writeOctomap(), so \e scene should
+   *  come without it. */
+  void writeGeometry(const moveit_msgs::msg::PlanningScene& scene);
+
+  /** @brief Publish the octomap of the scene and increment the octomap version */
+  void writeOctomap(const octomap_msgs::msg::OctomapWithPose& octomap);
+
+  /** @brief Publish the positions of \e state, which was current at \e stamp */
+  void writeState(const moveit::core::RobotState& state, const rclcpp::Time& stamp);
+
+private:
+  /** @brief Replace the segment by one with room for \e geometry_capacity serialized bytes, and copy the last
+   *  published state and serialized parts into it */
+  void createSegment(std::size_t geometry_capacity);
+
+  /** @brief Copy the serialized scene and octomap into the segment under the geometry sequence lock, growing the
+   *  segment if needed */
+  void writeSerialized();
+
+  std::string name_;
+  moveit::core::RobotModelConstPtr robot_model_;
+  std::unique_ptr<boost::interprocess::shared_memory_object> segment_;
+  std::unique_ptr<boost::interprocess::mapped_region> region_;
+  std::size_t geometry_capacity_;
+  std::uint64_t geometry_version_;
+  std::uint64_t octomap_version_;
+  std::vector<std::uint8_t> scene_bytes_;    // the last published serialized scene
+  std::vector<std::uint8_t> octomap_bytes_;  // the last published serialized octomap
+  rclcpp::Serialization<moveit_msgs::msg::PlanningScene> serializer_;
+  rclcpp::Serialization<octomap_msgs::msg::OctomapWithPose> octomap_serializer_;
+};
+
+/** @brief Maps a planning scene published by a SharedPlanningSceneWriter read-only.
+ *
+ *  The reader connects lazily, so it can be created before the writer. Not thread safe. */
+class SharedPlanningSceneReader
+{
+public:
+  SharedPlanningSceneReader(const std::string& name, const moveit::core::RobotModelConstPtr& robot_model);
+
+  /** @brief Check whether the segment is mapped and matches the robot model, mapping it if necessary */
+  bool connect();
+
+  /** @brief The version of the published geometry apart from the octomap, 0 if none is available */
+  std::uint64_t getGeometryVersion();
+
+  /** @brief The version of the published octomap, 0 if none is available */
+  std::uint64_t getOctomapVersion();
+
+  /** @brief Read the published robot state positions straight from shared memory into \e state.
+   *  Returns false if no state was published yet. */
+  bool readRobotState(moveit::core::RobotState& state, rclcpp::Time* stamp = nullptr);
+
+  /** @brief Update \e scene to the published scene. The geometry is only deserialized and set if its version changed
+   *  since the last call. If only the octomap changed, only the octomap is deserialized and replaced. The robot state
+   *  positions are always copied. Returns false if no scene was published yet. \e scene must stay the same object
+   *  between calls. */
+  bool updatePlanningScene(planning_scene::PlanningScene& scene);
+
+private:
+  std::string name_;
+  moveit::core::RobotModelConstPtr robot_model_;
+  std::unique_ptr<boost::interprocess::shared_memory_object> segment_;
+  std::unique_ptr<boost::interprocess::mapped_region> region_;
+  std::vector<double> positions_;
+  std::vector<std::uint8_t> scene_bytes_;
+  std::vector<std::uint8_t> octomap_bytes_;
+  bool has_applied_geometry_;
+  std::uint64_t applied_geometry_version_;
+  std::uint64_t applied_octomap_version_;
+  rclcpp::Serialization<moveit_msgs::msg::PlanningScene> serializer_;
+  rclcpp::Serialization<octomap_msgs::msg::OctomapWithPose> octomap_serializer_;
+};
+}  // namespace planning_scene_monitor
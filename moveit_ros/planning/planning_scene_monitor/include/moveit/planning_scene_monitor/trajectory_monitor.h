@@ -39,8 +39,11 @@
 #include <moveit/macros/class_forward.h>
 #include <moveit/planning_scene_monitor/current_state_monitor.h>
 #include <moveit/robot_trajectory/robot_trajectory.h>
+#include <moveit/robot_trajectory/compact_robot_trajectory.h>
 #include <boost/thread.hpp>
+#include <atomic>
 #include <memory>
+#include <mutex>
 
 namespace planning_scene_monitor
 {
@@ -50,14 +53,29 @@ using TrajectoryStateAddedCallback =
 MOVEIT_CLASS_FORWARD(TrajectoryMonitor)  // Defines TrajectoryMonitorPtr, ConstPtr, WeakPtr... etc
 
 /** @class TrajectoryMonitor
-    @brief Monitors the joint_states topic and tf to record the trajectory of the robot. */
+    @brief Monitors the joint_states topic and tf to record the trajectory of the robot.
+
+    By default, the current state is sampled at a fixed frequency on a separate thread and stored as a full RobotState
+    per waypoint. Alternatively, states are recorded from the joint state updates of the state monitor, storing only
+    the variable positions. In both modes, states that differ too little from the last recorded one can be skipped. */
 class TrajectoryMonitor
 {
 public:
-  /** @brief Constructor.
+  /** @brief Constructor for sampling the state of \e state_monitor at \e sampling_frequency on a separate thread.
+   *  No states are recorded if the frequency is not positive.
    */
   TrajectoryMonitor(const CurrentStateMonitorConstPtr& state_monitor, double sampling_frequency = 0.0);
 
+  /** @brief Constructor for recording the state of \e state_monitor whenever it receives a joint state update,
+   *  without a thread polling it. Only the variable positions are stored.
+   *
+   *  The update callback is registered with \e state_monitor here, so like all update callbacks the monitor should
+   *  be constructed before joint states are received.
+   *  @param max_frequency The maximal frequency of the recorded states; updates following the last recorded one
+   *  more closely are skipped. Every update is recorded if not positive.
+   */
+  TrajectoryMonitor(const CurrentStateMonitorPtr& state_monitor, double max_frequency, bool record_on_update);
+
   ~TrajectoryMonitor();
 
   void startTrajectoryMonitor();
@@ -75,34 +93,78 @@ public:
 
   void setSamplingFrequency(double sampling_frequency);
 
-  /// Return the current maintained trajectory. This function is not thread safe (hence NOT const), because the
-  /// trajectory could be modified.
-  const robot_trajectory::RobotTrajectory& getTrajectory()
+  /** @brief Whether states are recorded from the joint state updates instead of being sampled */
+  bool isRecordingOnUpdate() const
   {
-    return trajectory_;
+    return record_on_update_;
   }
 
-  void swapTrajectory(robot_trajectory::RobotTrajectory& other)
+  /** @brief Skip states in which no variable moved by more than \e min_position_change since the last recorded
+   *  state (0 by default, recording all states). The last skipped state is still recorded when the monitor stops,
+   *  so that the trajectory ends in the final state. */
+  void setMinimumPositionChange(double min_position_change)
   {
-    trajectory_.swap(other);
+    min_position_change_ = min_position_change;
   }
 
+  double getMinimumPositionChange() const
+  {
+    return min_position_change_;
+  }
+
+  /// Return the current maintained trajectory. This function is not thread safe (hence NOT const), because the
+  /// trajectory could be modified. When recording on updates, the waypoints are materialized by this call.
+  const robot_trajectory::RobotTrajectory& getTrajectory();
+
+  /// Exchange the maintained trajectory with \e other. When recording on updates, \e other receives the
+  /// materialized waypoints and the recorded positions are cleared.
+  void swapTrajectory(robot_trajectory::RobotTrajectory& other);
+
+  /// Return a copy of the positions recorded on updates, without materializing them. Thread safe.
+  robot_trajectory::CompactRobotTrajectory getCompactTrajectory() const;
+
   void setOnStateAddCallback(const TrajectoryStateAddedCallback& callback)
   {
     state_add_callback_ = callback;
   }
 
 private:
+  /** @brief Calls recordUpdate() for as long as the monitor exists, as the update callbacks of the state monitor
+   *  can not be removed */
+  struct UpdateTarget
+  {
+    std::mutex lock;
+    TrajectoryMonitor* monitor;
+  };
+
   void recordStates();
 
+  /** @brief Record the current state after a joint state update */
+  void recordUpdate();
+
+  /** @brief Whether a state with \e positions differs enough from one with \e last_positions to be recorded */
+  bool hasMoved(const double* last_positions, const double* positions) const;
+
   CurrentStateMonitorConstPtr current_state_monitor_;
   double sampling_frequency_;
+  bool record_on_update_;
+  double min_position_change_;
 
   robot_trajectory::RobotTrajectory trajectory_;
   rclcpp::Time trajectory_start_time_;
   rclcpp::Time last_recorded_state_time_;
+  std::pair<moveit::core::RobotStatePtr, rclcpp::Time> skipped_state_;  // last state skipped by the sampling thread
 
   std::unique_ptr<boost::thread> record_states_thread_;
   TrajectoryStateAddedCallback state_add_callback_;
+
+  // recording on updates
+  std::atomic<bool> recording_;
+  mutable std::mutex compact_trajectory_lock_;
+  robot_trajectory::CompactRobotTrajectory compact_trajectory_;
+  moveit::core::RobotState update_state_;  // the current state, only accessed from the update callback
+  std::vector<double> skipped_positions_;    // positions of the last skipped update, empty if there is none
+  rclcpp::Time skipped_time_;
+  std::shared_ptr<UpdateTarget> update_target_;
 };
 }  // namespace planning_scene_monitor
@@ -40,6 +40,7 @@
 #include <tf2_geometry_msgs/tf2_geometry_msgs.h>
 
 #include <limits>
+#include <thread>
 
 static const rclcpp::Logger LOGGER = rclcpp::get_logger("moveit_ros.current_state_monitor");
 
@@ -50,11 +51,19 @@ planning_scene_monitor::CurrentStateMonitor::CurrentStateMonitor(const rclcpp::N
   , tf_buffer_(tf_buffer)
   , robot_model_(robot_model)
   , robot_state_(robot_model)
+  , joint_state_mapping_(*robot_model)
   , state_monitor_started_(false)
   , copy_dynamics_(false)
   , error_(std::numeric_limits<double>::epsilon())
+  , snapshot_sequence_(0)
+  , snapshot_values_(3 * robot_model->getVariableCount())
+  , snapshot_has_velocities_(false)
+  , snapshot_has_effort_(false)
+  , snapshot_stamp_(0)
+  , history_count_(0)
 {
   robot_state_.setToDefaultValues();
+  writeSnapshot();
 }
 
 planning_scene_monitor::CurrentStateMonitor::~CurrentStateMonitor()
@@ -62,61 +71,218 @@ planning_scene_monitor::CurrentStateMonitor::~CurrentStateMonitor()
   stopStateMonitor();
 }
 
+void planning_scene_monitor::CurrentStateMonitor::writeSnapshot()
+{
+  const std::size_t n = robot_model_->getVariableCount();
+  const std::uint64_t sequence = snapshot_sequence_.load(std::memory_order_relaxed);
+  snapshot_sequence_.store(sequence + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  const double* pos = robot_state_.getVariablePositions();
+  for (std::size_t i = 0; i < n; ++i)
+    snapshot_values_[i].store(pos[i], std::memory_order_relaxed);
+  if (robot_state_.hasVelocities())
+  {
+    const double* vel = robot_state_.getVariableVelocities();
+    for (std::size_t i = 0; i < n; ++i)
+      snapshot_values_[n + i].store(vel[i], std::memory_order_relaxed);
+  }
+  if (robot_state_.hasEffort())
+  {
+    const double* eff = robot_state_.getVariableEffort();
+    for (std::size_t i = 0; i < n; ++i)
+      snapshot_values_[2 * n + i].store(eff[i], std::memory_order_relaxed);
+  }
+  snapshot_has_velocities_.store(robot_state_.hasVelocities(), std::memory_order_relaxed);
+  snapshot_has_effort_.store(robot_state_.hasEffort(), std::memory_order_relaxed);
+  snapshot_stamp_.store(current_state_time_.nanoseconds(), std::memory_order_relaxed);
+
+  snapshot_sequence_.store(sequence + 2, std::memory_order_release);
+}
+
+void planning_scene_monitor::CurrentStateMonitor::readSnapshot(StateSnapshot& snapshot) const
+{
+  snapshot.values.resize(snapshot_values_.size());
+  std::uint64_t sequence;
+  std::int64_t stamp;
+  do
+  {
+    // wait for the writer to finish an update in progress, which is a short copy
+    while ((sequence = snapshot_sequence_.load(std::memory_order_acquire)) & 1)
+      std::this_thread::yield();
+    for (std::size_t i = 0; i < snapshot.values.size(); ++i)
+      snapshot.values[i] = snapshot_values_[i].load(std::memory_order_relaxed);
+    snapshot.has_velocities = snapshot_has_velocities_.load(std::memory_order_relaxed);
+    snapshot.has_effort = snapshot_has_effort_.load(std::memory_order_relaxed);
+    stamp = snapshot_stamp_.load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+  } while (snapshot_sequence_.load(std::memory_order_relaxed) != sequence);
+  snapshot.stamp = rclcpp::Time(stamp, RCL_ROS_TIME);
+}
+
 moveit::core::RobotStatePtr planning_scene_monitor::CurrentStateMonitor::getCurrentState() const
 {
-  std::unique_lock<std::mutex> slock(state_update_lock_);
-  moveit::core::RobotState* result = new moveit::core::RobotState(robot_state_);
-  return moveit::core::RobotStatePtr(result);
+  return getCurrentStateAndTime().first;
 }
 
 rclcpp::Time planning_scene_monitor::CurrentStateMonitor::getCurrentStateTime() const
 {
-  std::unique_lock<std::mutex> slock(state_update_lock_);
-  return current_state_time_;
+  // a single value, no need to copy a consistent snapshot
+  return rclcpp::Time(snapshot_stamp_.load(std::memory_order_acquire), RCL_ROS_TIME);
 }
 
 std::pair<moveit::core::RobotStatePtr, rclcpp::Time>
 planning_scene_monitor::CurrentStateMonitor::getCurrentStateAndTime() const
 {
-  std::unique_lock<std::mutex> slock(state_update_lock_);
-  moveit::core::RobotState* result = new moveit::core::RobotState(robot_state_);
-  return std::make_pair(moveit::core::RobotStatePtr(result), current_state_time_);
+  StateSnapshot snapshot;
+  readSnapshot(snapshot);
+  const std::size_t n = robot_model_->getVariableCount();
+  moveit::core::RobotStatePtr result(new moveit::core::RobotState(robot_model_));
+  result->setVariablePositions(snapshot.values.data());
+  if (snapshot.has_velocities)
+    result->setVariableVelocities(snapshot.values.data() + n);
+  if (snapshot.has_effort)
+    result->setVariableEffort(snapshot.values.data() + 2 * n);
+  return std::make_pair(result, snapshot.stamp);
 }
 
 std::map<std::string, double> planning_scene_monitor::CurrentStateMonitor::getCurrentStateValues() const
 {
   std::map<std::string, double> m;
-  std::unique_lock<std::mutex> slock(state_update_lock_);
-  const double* pos = robot_state_.getVariablePositions();
-  const std::vector<std::string>& names = robot_state_.getVariableNames();
+  StateSnapshot snapshot;
+  readSnapshot(snapshot);
+  const std::vector<std::string>& names = robot_model_->getVariableNames();
   for (std::size_t i = 0; i < names.size(); ++i)
-    m[names[i]] = pos[i];
+    m[names[i]] = snapshot.values[i];
   return m;
 }
 
 void planning_scene_monitor::CurrentStateMonitor::setToCurrentState(moveit::core::RobotState& upd) const
+{
+  StateSnapshot snapshot;
+  readSnapshot(snapshot);
+  const std::size_t n = robot_model_->getVariableCount();
+  upd.setVariablePositions(snapshot.values.data());
+  if (copy_dynamics_)
+  {
+    if (snapshot.has_velocities)
+      upd.setVariableVelocities(snapshot.values.data() + n);
+    if (snapshot.has_effort)
+      upd.setVariableEffort(snapshot.values.data() + 2 * n);
+  }
+}
+
+void planning_scene_monitor::CurrentStateMonitor::setStateHistoryLength(std::size_t length)
 {
   std::unique_lock<std::mutex> slock(state_update_lock_);
+  std::vector<StateHistoryEntry> history(length);
+  for (StateHistoryEntry& entry : history)
+    entry.positions = std::vector<std::atomic<double>>(robot_model_->getVariableCount());
+  history_.swap(history);
+  history_count_ = 0;
+}
+
+void planning_scene_monitor::CurrentStateMonitor::recordStateHistory()
+{
+  if (history_.empty())
+    return;
+  const std::int64_t stamp = current_state_time_.nanoseconds();
+  std::uint64_t index = history_count_.load(std::memory_order_relaxed);
+
+  // keep the time stamps increasing: a state with the time stamp of the last one (e.g. from another joint state
+  // publisher) replaces it, and older states are not recorded
+  if (index > 0)
+  {
+    const std::int64_t last_stamp = history_[(index - 1) % history_.size()].stamp.load(std::memory_order_relaxed);
+    if (stamp < last_stamp)
+      return;
+    if (stamp == last_stamp)
+      --index;
+  }
+
+  StateHistoryEntry& entry = history_[index % history_.size()];
+  const std::uint64_t sequence = entry.sequence.load(std::memory_order_relaxed);
+  entry.sequence.store(sequence + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  entry.index.store(index, std::memory_order_relaxed);
+  entry.stamp.store(stamp, std::memory_order_relaxed);
   const double* pos = robot_state_.getVariablePositions();
-  upd.setVariablePositions(pos);
-  if (copy_dynamics_)
+  for (std::size_t i = 0; i < entry.positions.size(); ++i)
+    entry.positions[i].store(pos[i], std::memory_order_relaxed);
+  entry.sequence.store(sequence + 2, std::memory_order_release);
+
+  history_count_.store(index + 1, std::memory_order_release);
+}
+
+bool planning_scene_monitor::CurrentStateMonitor::readStateHistory(std::uint64_t index, std::vector<double>* positions,
+                                                                   std::int64_t& stamp) const
+{
+  const StateHistoryEntry& entry = history_[index % history_.size()];
+  std::uint64_t sequence;
+  std::uint64_t entry_index;
+  do
   {
-    if (robot_state_.hasVelocities())
-    {
-      const double* vel = robot_state_.getVariableVelocities();
-      upd.setVariableVelocities(vel);
-    }
-    if (robot_state_.hasAccelerations())
+    while ((sequence = entry.sequence.load(std::memory_order_acquire)) & 1)
+      std::this_thread::yield();
+    entry_index = entry.index.load(std::memory_order_relaxed);
+    stamp = entry.stamp.load(std::memory_order_relaxed);
+    if (positions)
     {
-      const double* acc = robot_state_.getVariableAccelerations();
-      upd.setVariableAccelerations(acc);
-    }
-    if (robot_state_.hasEffort())
-    {
-      const double* eff = robot_state_.getVariableEffort();
-      upd.setVariableEffort(eff);
+      positions->resize(entry.positions.size());
+      for (std::size_t i = 0; i < entry.positions.size(); ++i)
+        (*positions)[i] = entry.positions[i].load(std::memory_order_relaxed);
     }
+    std::atomic_thread_fence(std::memory_order_acquire);
+  } while (entry.sequence.load(std::memory_order_relaxed) != sequence);
+  return entry_index == index;
+}
+
+bool planning_scene_monitor::CurrentStateMonitor::getStateAtTime(const rclcpp::Time& t,
+                                                                 moveit::core::RobotState& state) const
+{
+  if (history_.empty())
+    return false;
+  const std::int64_t time = t.nanoseconds();
+
+  // binary search of the first recorded state that is not older than t. A state that gets overwritten meanwhile
+  // counts as older than all others, which keeps the search valid.
+  const std::uint64_t count = history_count_.load(std::memory_order_acquire);
+  std::uint64_t first = count > history_.size() ? count - history_.size() : 0;
+  std::uint64_t last = count;
+  std::int64_t stamp;
+  while (first < last)
+  {
+    const std::uint64_t middle = first + (last - first) / 2;
+    if (!readStateHistory(middle, nullptr, stamp) || stamp < time)
+      first = middle + 1;
+    else
+      last = middle;
+  }
+  if (first == count)
+    return false;
+
+  std::vector<double> after;
+  if (!readStateHistory(first, &after, stamp))
+    return false;
+  if (stamp == time)
+  {
+    state.setVariablePositions(after);
+    return true;
   }
+
+  std::vector<double> before;
+  std::int64_t before_stamp;
+  if (first == 0 || !readStateHistory(first - 1, &before, before_stamp))
+    return false;
+
+  // the model interpolates the active joints, mimic joints follow from interpolating all variables linearly
+  const double fraction = static_cast<double>(time - before_stamp) / static_cast<double>(stamp - before_stamp);
+  std::vector<double> positions(before.size());
+  for (std::size_t i = 0; i < positions.size(); ++i)
+    positions[i] = before[i] + (after[i] - before[i]) * fraction;
+  robot_model_->interpolate(before.data(), after.data(), fraction, positions.data());
+  state.setVariablePositions(positions);
+  return true;
 }
 
 void planning_scene_monitor::CurrentStateMonitor::addUpdateCallback(const JointStateUpdateCallback& fn)
@@ -138,8 +304,15 @@ void planning_scene_monitor::CurrentStateMonitor::startStateMonitor(const std::s
     if (joint_states_topic.empty())
       RCLCPP_ERROR(LOGGER, "The joint states topic cannot be an empty string");
     else
+    {
+      if (!callback_group_)
+        callback_group_ = node_->create_callback_group(rclcpp::CallbackGroupType::MutuallyExclusive);
+      rclcpp::SubscriptionOptions options;
+      options.callback_group = callback_group_;
       joint_state_subscriber_ = node_->create_subscription<sensor_msgs::msg::JointState>(
-          joint_states_topic, 25, std::bind(&CurrentStateMonitor::jointStateCallback, this, std::placeholders::_1));
+          joint_states_topic, 25, std::bind(&CurrentStateMonitor::jointStateCallback, this, std::placeholders::_1),
+          options);
+    }
     if (tf_buffer_ && !robot_model_->getMultiDOFJointModels().empty())
     {
       // TODO (anasarrak): replace this for the appropiate function, there is no similar
@@ -158,6 +331,12 @@ bool planning_scene_monitor::CurrentStateMonitor::isActive() const
   return state_monitor_started_;
 }
 
+void planning_scene_monitor::CurrentStateMonitor::updateJointState(
+    const sensor_msgs::msg::JointState::ConstSharedPtr& joint_state)
+{
+  jointStateCallback(joint_state);
+}
+
 void planning_scene_monitor::CurrentStateMonitor::stopStateMonitor()
 {
   if (state_monitor_started_)
@@ -276,12 +455,12 @@ bool planning_scene_monitor::CurrentStateMonitor::waitForCurrentState(const rclc
 {
   rclcpp::Time start = node_->now();
   rclcpp::Duration elapsed(0, 0);
-  rclcpp::Duration timeout(wait_time, 0);
+  rclcpp::Duration timeout(wait_time);
 
   std::unique_lock<std::mutex> lock(state_update_lock_);
   while (current_state_time_ < t)
   {
-    state_update_condition_.wait_for(lock, (timeout - elapsed).to_chrono<std::chrono::seconds>());
+    state_update_condition_.wait_for(lock, (timeout - elapsed).to_chrono<std::chrono::nanoseconds>());
     elapsed = node_->now() - start;
     if (elapsed > timeout)
     {
@@ -354,11 +533,13 @@ void planning_scene_monitor::CurrentStateMonitor::jointStateCallback(
     // read the received values, and update their time stamps
     std::size_t n = joint_state->name.size();
     current_state_time_ = joint_state->header.stamp;
+    // the names are only looked up when the layout of the messages changes
+    const std::vector<int>& variable_indices = joint_state_mapping_.getVariableIndices(joint_state->name);
     for (std::size_t i = 0; i < n; ++i)
     {
-      const moveit::core::JointModel* jm = robot_model_->getJointModel(joint_state->name[i]);
-      if (!jm)
+      if (variable_indices[i] < 0)
         continue;
+      const moveit::core::JointModel* jm = robot_model_->getJointOfVariable(variable_indices[i]);
       // ignore fixed joints, multi-dof joints (they should not even be in the message)
       if (jm->getVariableCount() != 1)
         continue;
@@ -406,6 +587,8 @@ void planning_scene_monitor::CurrentStateMonitor::jointStateCallback(
         }
       }
     }
+    writeSnapshot();
+    recordStateHistory();
   }
 
   // callbacks, if needed
@@ -470,6 +653,8 @@ void planning_scene_monitor::CurrentStateMonitor::tfCallback()
       robot_state_.setJointPositions(joint, new_values.data());
       update = true;
     }
+    if (update)
+      writeSnapshot();
   }
 
   // callbacks, if needed
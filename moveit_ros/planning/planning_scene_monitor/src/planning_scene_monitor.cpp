@@ -38,6 +38,7 @@
 #include <moveit/robot_model_loader/robot_model_loader.h>
 #include <moveit/utils/message_checks.h>
 #include <moveit/exceptions/exceptions.h>
+#include <moveit/collision_detection_fcl/collision_common.h>
 #include <moveit_msgs/srv/get_planning_scene.hpp>
 
 #include <tf2/exceptions.h>
@@ -45,6 +46,9 @@
 #include <tf2_eigen/tf2_eigen.h>
 #include <tf2_geometry_msgs/tf2_geometry_msgs.h>
 #include <moveit/profiler/profiler.h>
+#include <moveit/profiler/tracing.h>
+#include <geometric_shapes/shapes.h>
+#include <octomap/octomap.h>
 
 #include <boost/algorithm/string/join.hpp>
 #include <memory>
@@ -58,6 +62,67 @@ static const rclcpp::Logger LOGGER = rclcpp::get_logger("moveit_ros.planning_sce
 
 namespace planning_scene_monitor
 {
+namespace
+{
+// monitors shared within this process, by robot description
+std::mutex& sharedMonitorsLock()
+{
+  static std::mutex lock;
+  return lock;
+}
+
+std::map<std::string, std::weak_ptr<PlanningSceneMonitor>>& sharedMonitors()
+{
+  static std::map<std::string, std::weak_ptr<PlanningSceneMonitor>> monitors;
+  return monitors;
+}
+
+// read locks of the scene held by this thread, to time them when they are released
+struct SceneReadLock
+{
+  const PlanningSceneMonitor* monitor;
+  const char* holder;
+  std::int64_t request_time;
+  std::int64_t acquire_time;
+};
+thread_local std::vector<SceneReadLock> scene_read_locks;
+
+std::size_t getHistogramBucket(std::int64_t duration)
+{
+  const std::size_t last_bucket = PlanningSceneMonitor::SceneLockStatistics::HISTOGRAM_SIZE - 1;
+  std::size_t bucket = 0;
+  for (std::int64_t us = duration / 1000; us > 1 && bucket < last_bucket; us >>= 1)
+    ++bucket;
+  return bucket;
+}
+}  // namespace
+
+class PlanningSceneMonitor::SceneUpdateLock
+{
+public:
+  SceneUpdateLock(PlanningSceneMonitor& monitor, const char* holder) : monitor_(monitor), holder_(holder)
+  {
+    request_time_ = moveit::tools::tracing::now();
+    monitor_.scene_update_mutex_.lock();
+    acquire_time_ = moveit::tools::tracing::now();
+  }
+
+  ~SceneUpdateLock()
+  {
+    monitor_.recordSceneLock(holder_, true, request_time_, acquire_time_, moveit::tools::tracing::now());
+    monitor_.scene_update_mutex_.unlock();
+  }
+
+  SceneUpdateLock(const SceneUpdateLock&) = delete;
+  SceneUpdateLock& operator=(const SceneUpdateLock&) = delete;
+
+private:
+  PlanningSceneMonitor& monitor_;
+  const char* holder_;
+  std::int64_t request_time_;
+  std::int64_t acquire_time_;
+};
+
 const std::string PlanningSceneMonitor::DEFAULT_JOINT_STATES_TOPIC = "joint_states";
 const std::string PlanningSceneMonitor::DEFAULT_ATTACHED_COLLISION_OBJECT_TOPIC = "attached_collision_object";
 const std::string PlanningSceneMonitor::DEFAULT_COLLISION_OBJECT_TOPIC = "collision_object";
@@ -65,6 +130,8 @@ const std::string PlanningSceneMonitor::DEFAULT_PLANNING_SCENE_WORLD_TOPIC = "pl
 const std::string PlanningSceneMonitor::DEFAULT_PLANNING_SCENE_TOPIC = "planning_scene";
 const std::string PlanningSceneMonitor::DEFAULT_PLANNING_SCENE_SERVICE = "get_planning_scene";
 const std::string PlanningSceneMonitor::MONITORED_PLANNING_SCENE_TOPIC = "monitored_planning_scene";
+const std::string PlanningSceneMonitor::DEFAULT_SHARED_PLANNING_SCENE = "moveit_shared_planning_scene";
+const std::string PlanningSceneMonitor::DEFAULT_MEMORY_USAGE_TOPIC = "/diagnostics";
 
 PlanningSceneMonitor::PlanningSceneMonitor(const rclcpp::Node::SharedPtr& node, const std::string& robot_description,
                                            const std::shared_ptr<tf2_ros::Buffer>& tf_buffer, const std::string& name)
@@ -94,7 +161,7 @@ PlanningSceneMonitor::PlanningSceneMonitor(const rclcpp::Node::SharedPtr& node,
                                            const std::shared_ptr<tf2_ros::Buffer>& tf_buffer, const std::string& name)
   : monitor_name_(name)
   , node_(node)
-  , private_executor_(std::make_shared<rclcpp::executors::SingleThreadedExecutor>())
+  , private_executor_(std::make_shared<rclcpp::executors::MultiThreadedExecutor>(rclcpp::ExecutorOptions(), 2))
   , tf_buffer_(tf_buffer)
   , dt_state_update_(0.0)
   , shape_transform_cache_lookup_wait_time_(0, 0)
@@ -122,6 +189,8 @@ PlanningSceneMonitor::~PlanningSceneMonitor()
     scene_->setAttachedBodyUpdateCallback(moveit::core::AttachedBodyCallback());
   }
   stopPublishingPlanningScene();
+  stopSharingPlanningScene();
+  stopPublishingMemoryUsage();
   stopStateMonitor();
   stopWorldGeometryMonitor();
   stopSceneMonitor();
@@ -139,6 +208,25 @@ PlanningSceneMonitor::~PlanningSceneMonitor()
   rm_loader_.reset();
 }
 
+void PlanningSceneMonitor::shareMonitor(const PlanningSceneMonitorPtr& monitor)
+{
+  std::lock_guard<std::mutex> slock(sharedMonitorsLock());
+  sharedMonitors()[monitor->getRobotDescription()] = monitor;
+}
+
+PlanningSceneMonitorPtr PlanningSceneMonitor::getSharedMonitor(const std::string& robot_description)
+{
+  std::lock_guard<std::mutex> slock(sharedMonitorsLock());
+  auto it = sharedMonitors().find(robot_description);
+  if (it == sharedMonitors().end())
+    return PlanningSceneMonitorPtr();
+
+  PlanningSceneMonitorPtr monitor = it->second.lock();
+  if (!monitor)
+    sharedMonitors().erase(it);
+  return monitor;
+}
+
 void PlanningSceneMonitor::initialize(const planning_scene::PlanningScenePtr& scene)
 {
   moveit::tools::Profiler::ScopedStart prof_start;
@@ -196,6 +284,19 @@ void PlanningSceneMonitor::initialize(const planning_scene::PlanningScenePtr& sc
 
   publish_planning_scene_frequency_ = 2.0;
   new_scene_update_ = UPDATE_NONE;
+  scene_snapshots_enabled_ = false;
+  binary_octomap_service_ = false;
+  shared_scene_running_ = false;
+  shared_geometry_pending_ = false;
+  shared_state_pending_ = false;
+  memory_budget_ = 0;
+  world_objects_version_ = 0;
+  octomap_version_ = 0;
+  cached_collision_objects_version_ = 0;
+  cached_octomap_version_ = 0;
+  attached_bodies_changed_ = true;
+  octomap_world_outdated_ = true;
+  last_octree_size_ = 0;
 
   last_update_time_ = last_robot_motion_time_ = rclcpp::Clock().now();
   last_robot_state_update_wall_time_ = std::chrono::system_clock::now();
@@ -242,6 +343,17 @@ void PlanningSceneMonitor::initialize(const planning_scene::PlanningScenePtr& sc
         "publish_planning_scene_hz", 4.0, "Set the maximum frequency at which planning scene updates are published");
     updatePublishSettings(publish_geometry_updates, publish_state_updates, publish_transform_updates,
                           publish_planning_scene, publish_planning_scene_hz);
+
+    // Set up memory usage parameters
+    bool publish_memory_usage = declare_parameter(
+        "publish_memory_usage", false, "Set to True to publish the memory usage of the planning scene as diagnostics");
+    double memory_usage_period = declare_parameter("memory_usage_period", 1.0,
+                                                   "Set the period at which the memory usage is published (seconds)");
+    int64_t memory_budget = declare_parameter(
+        "memory_budget", int64_t(0), "Set the memory budget of the planning scene in bytes, 0 to disable it");
+    setMemoryBudget(std::max<int64_t>(memory_budget, 0));
+    if (publish_memory_usage)
+      startPublishingMemoryUsage(memory_usage_period);
   }
   catch (const rclcpp::exceptions::InvalidParameterTypeException& e)
   {
@@ -312,7 +424,7 @@ void PlanningSceneMonitor::monitorDiffs(bool flag)
   {
     if (flag)
     {
-      boost::unique_lock<boost::shared_mutex> ulock(scene_update_mutex_);
+      SceneUpdateLock ulock(*this, "monitorDiffs");
       if (scene_)
       {
         scene_->setAttachedBodyUpdateCallback(moveit::core::AttachedBodyCallback());
@@ -336,7 +448,7 @@ void PlanningSceneMonitor::monitorDiffs(bool flag)
         stopPublishingPlanningScene();
       }
       {
-        boost::unique_lock<boost::shared_mutex> ulock(scene_update_mutex_);
+        SceneUpdateLock ulock(*this, "monitorDiffs");
         if (scene_)
         {
           scene_->decoupleParent();
@@ -411,15 +523,23 @@ void PlanningSceneMonitor::scenePublishingThread()
       {
         if ((publish_update_types_ & new_scene_update_) || new_scene_update_ == UPDATE_SCENE)
         {
+          // the flag is cleared before the message is built, so a change made meanwhile is sent with the next diff
           if (new_scene_update_ == UPDATE_SCENE)
+          {
             is_full = true;
+            attached_bodies_changed_ = false;
+          }
           else
           {
+            // attached bodies are only sent if they changed since the last publication, otherwise their
+            // meshes would be re-sent with every state update
+            const bool send_attached_bodies =
+                new_scene_update_ != UPDATE_STATE && attached_bodies_changed_.exchange(false);
             occupancy_map_monitor::OccMapTree::ReadLock lock;
             if (octomap_monitor_)
               lock = octomap_monitor_->getOcTreePtr()->reading();
             scene_->getPlanningSceneDiffMsg(msg);
-            if (new_scene_update_ == UPDATE_STATE)
+            if (!send_attached_bodies)
             {
               msg.robot_state.attached_collision_objects.clear();
               msg.robot_state.is_diff = true;
@@ -468,6 +588,235 @@ void PlanningSceneMonitor::scenePublishingThread()
   } while (publish_planning_scene_);
 }
 
+void PlanningSceneMonitor::startSharingPlanningScene(const std::string& name)
+{
+  if (shared_scene_thread_.joinable() || !scene_)
+    return;
+  try
+  {
+    shared_scene_writer_ = std::make_shared<SharedPlanningSceneWriter>(name, getRobotModel());
+  }
+  catch (const boost::interprocess::interprocess_exception& e)
+  {
+    RCLCPP_ERROR(LOGGER, "Failed to create the shared memory segment '%s': %s", name.c_str(), e.what());
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> slock(shared_scene_mutex_);
+    shared_scene_running_ = true;
+    shared_geometry_pending_ = true;
+    shared_state_pending_ = true;
+  }
+  shared_scene_thread_ = std::thread(&PlanningSceneMonitor::sharedSceneThread, this);
+  RCLCPP_INFO(LOGGER, "Sharing maintained planning scene in shared memory segment '%s'", name.c_str());
+}
+
+void PlanningSceneMonitor::stopSharingPlanningScene()
+{
+  if (!shared_scene_thread_.joinable())
+    return;
+  {
+    std::lock_guard<std::mutex> slock(shared_scene_mutex_);
+    shared_scene_running_ = false;
+  }
+  shared_scene_condition_.notify_all();
+  shared_scene_thread_.join();
+  shared_scene_writer_.reset();
+  RCLCPP_INFO(LOGGER, "Stopped sharing maintained planning scene.");
+}
+
+void PlanningSceneMonitor::startPublishingMemoryUsage(double period, const std::string& topic)
+{
+  if (memory_usage_timer_ || !scene_)
+    return;
+  memory_usage_publisher_ = pnode_->create_publisher<diagnostic_msgs::msg::DiagnosticArray>(topic, 1);
+  memory_usage_timer_ = pnode_->create_wall_timer(std::chrono::duration<double>(std::max(period, 0.01)),
+                                                  std::bind(&PlanningSceneMonitor::memoryUsageTimerCallback, this));
+  RCLCPP_INFO(LOGGER, "Publishing memory usage of the maintained planning scene on '%s'", topic.c_str());
+}
+
+void PlanningSceneMonitor::stopPublishingMemoryUsage()
+{
+  if (!memory_usage_timer_)
+    return;
+  memory_usage_timer_->cancel();
+  memory_usage_timer_.reset();
+  memory_usage_publisher_.reset();
+  RCLCPP_INFO(LOGGER, "Stopped publishing memory usage of the maintained planning scene.");
+}
+
+void PlanningSceneMonitor::memoryUsageTimerCallback()
+{
+  planning_scene::PlanningScene::MemoryUsage usage;
+  lockSceneRead("memoryUsageTimerCallback");
+  try
+  {
+    usage = scene_->getMemoryUsage();
+    // while monitoring diffs, the world of the scene shares its shapes with the parent, but not the environments
+    if (parent_scene_)
+      for (const std::pair<const std::string, std::size_t>& env :
+           parent_scene_->getMemoryUsage().collision_environments)
+        usage.collision_environments[env.first] += env.second;
+  }
+  catch (...)
+  {
+    unlockSceneRead();  // unlock and rethrow
+    throw;
+  }
+  unlockSceneRead();
+
+  std::size_t message_cache_bytes = 0;
+  {
+    std::lock_guard<std::mutex> lock(scene_msg_cache_mutex_);
+    if (cached_collision_objects_)
+      for (const moveit_msgs::msg::CollisionObject& object : *cached_collision_objects_)
+      {
+        message_cache_bytes += sizeof(object) + object.primitives.size() * sizeof(shape_msgs::msg::SolidPrimitive) +
+                               object.planes.size() * sizeof(shape_msgs::msg::Plane);
+        for (const shape_msgs::msg::Mesh& mesh : object.meshes)
+          message_cache_bytes += sizeof(mesh) + mesh.vertices.size() * sizeof(geometry_msgs::msg::Point) +
+                                 mesh.triangles.size() * sizeof(shape_msgs::msg::MeshTriangle);
+      }
+    if (cached_octomap_)
+      message_cache_bytes += sizeof(*cached_octomap_) + cached_octomap_->octomap.data.size();
+  }
+  const std::size_t mesh_cache_bytes = collision_detection::getCollisionGeometryMeshCacheMemoryUsage();
+  const std::size_t total = usage.total() + mesh_cache_bytes + message_cache_bytes;
+
+  diagnostic_msgs::msg::DiagnosticStatus status;
+  status.name = pnode_->get_name() + std::string(": planning scene memory");
+  status.hardware_id = getName();
+  auto add_value = [&status](const std::string& key, std::size_t bytes) {
+    diagnostic_msgs::msg::KeyValue value;
+    value.key = key;
+    value.value = std::to_string(bytes);
+    status.values.push_back(value);
+  };
+  add_value("total", total);
+  add_value("world.meshes", usage.world.meshes);
+  add_value("world.octrees", usage.world.octrees);
+  add_value("world.other", usage.world.other);
+  for (const std::pair<const std::string, std::size_t>& env : usage.collision_environments)
+    add_value("collision_env." + env.first, env.second);
+  add_value("fcl_mesh_cache", mesh_cache_bytes);
+  add_value("scene_message_cache", message_cache_bytes);
+
+  const std::size_t budget = memory_budget_;
+  if (budget && total > budget)
+  {
+    // the cached service messages are the only part of the scene that can be rebuilt on demand
+    {
+      std::lock_guard<std::mutex> lock(scene_msg_cache_mutex_);
+      cached_collision_objects_.reset();
+      cached_octomap_.reset();
+    }
+    status.level = diagnostic_msgs::msg::DiagnosticStatus::WARN;
+    status.message = "Memory usage exceeds the budget of " + std::to_string(budget) + " bytes";
+    RCLCPP_WARN_THROTTLE(LOGGER, *pnode_->get_clock(), 10000, "Planning scene uses %zu bytes, the budget is %zu bytes",
+                         total, budget);
+  }
+  else
+  {
+    status.level = diagnostic_msgs::msg::DiagnosticStatus::OK;
+    status.message = "OK";
+  }
+
+  diagnostic_msgs::msg::DiagnosticArray msg;
+  msg.header.stamp = pnode_->now();
+  msg.status.push_back(status);
+  memory_usage_publisher_->publish(msg);
+}
+
+void PlanningSceneMonitor::sharedSceneThread()
+{
+  // the octomap is shared apart from the rest of the scene, which is only serialized again if the world objects changed
+  moveit_msgs::msg::PlanningSceneComponents components;
+  components.components = UINT_MAX & ~moveit_msgs::msg::PlanningSceneComponents::OCTOMAP;
+  bool scene_written = false;
+  std::uint64_t written_world_objects_version = 0;
+  std::shared_ptr<const octomap_msgs::msg::OctomapWithPose> written_octomap;
+
+  while (true)
+  {
+    bool write_geometry;
+    bool write_state;
+    {
+      std::unique_lock<std::mutex> ulock(shared_scene_mutex_);
+      shared_scene_condition_.wait(
+          ulock, [this] { return !shared_scene_running_ || shared_geometry_pending_ || shared_state_pending_; });
+      if (!shared_scene_running_)
+        break;
+      write_geometry = shared_geometry_pending_;
+      write_state = shared_state_pending_;
+      shared_geometry_pending_ = shared_state_pending_ = false;
+    }
+
+    // updates announced while writing are collected and written in the next iteration
+    moveit_msgs::msg::PlanningScene msg;
+    bool write_scene = false;
+    std::uint64_t world_objects_version = 0;
+    std::shared_ptr<const octomap_msgs::msg::OctomapWithPose> octomap;
+    std::unique_ptr<moveit::core::RobotState> state;
+    rclcpp::Time stamp;
+    lockSceneRead("sharedSceneThread");
+    try
+    {
+      if (write_geometry)
+      {
+        world_objects_version = world_objects_version_;
+        write_scene = !scene_written || world_objects_version != written_world_objects_version;
+        if (write_scene)
+          scene_->getPlanningSceneMsg(msg, components);
+        octomap = getCachedOctomapMsg();
+      }
+      if (write_state)
+      {
+        state = std::make_unique<moveit::core::RobotState>(scene_->getCurrentState());
+        stamp = last_robot_motion_time_;
+      }
+    }
+    catch (const std::exception& e)
+    {
+      // an exception escaping this thread would terminate the process
+      unlockSceneRead();
+      RCLCPP_ERROR(LOGGER, "Failed to get the planning scene to share: %s", e.what());
+      continue;
+    }
+    catch (...)
+    {
+      unlockSceneRead();
+      RCLCPP_ERROR(LOGGER, "Failed to get the planning scene to share");
+      continue;
+    }
+    unlockSceneRead();
+
+    try
+    {
+      if (write_scene)
+      {
+        shared_scene_writer_->writeGeometry(msg);
+        scene_written = true;
+        written_world_objects_version = world_objects_version;
+      }
+      // the cached octomap message is only replaced when the octomap changed
+      if (octomap && octomap != written_octomap)
+      {
+        shared_scene_writer_->writeOctomap(*octomap);
+        written_octomap = octomap;
+      }
+      if (state)
+        shared_scene_writer_->writeState(*state, stamp);
+    }
+    catch (const std::exception& e)
+    {
+      // interprocess_exception if the segment could not be replaced, the parts not written are written again with the
+      // next update
+      RCLCPP_ERROR(LOGGER, "Failed to write the shared memory segment '%s': %s",
+                   shared_scene_writer_->getName().c_str(), e.what());
+    }
+  }
+}
+
 void PlanningSceneMonitor::getMonitoredTopics(std::vector<std::string>& topics) const
 {
   // TODO(anasarrak): Do we need this for ROS2?
@@ -513,6 +862,18 @@ bool PlanningSceneMonitor::updatesScene(const planning_scene::PlanningSceneConst
 
 void PlanningSceneMonitor::triggerSceneUpdateEvent(SceneUpdateType update_type)
 {
+  triggerSceneUpdateEvent(update_type, true);
+}
+
+void PlanningSceneMonitor::triggerSceneUpdateEvent(SceneUpdateType update_type, bool world_objects_changed)
+{
+  if (update_type & (UPDATE_GEOMETRY | UPDATE_SCENE))
+  {
+    ++octomap_version_;
+    if (world_objects_changed)
+      ++world_objects_version_;
+  }
+
   // do not modify update functions while we are calling them
   boost::recursive_mutex::scoped_lock lock(update_lock_);
 
@@ -520,6 +881,84 @@ void PlanningSceneMonitor::triggerSceneUpdateEvent(SceneUpdateType update_type)
     update_callback(update_type);
   new_scene_update_ = (SceneUpdateType)((int)new_scene_update_ | (int)update_type);
   new_scene_update_condition_.notify_all();
+
+  {
+    std::lock_guard<std::mutex> slock(shared_scene_mutex_);
+    if (shared_scene_running_)
+    {
+      shared_geometry_pending_ = shared_geometry_pending_ || (update_type & (UPDATE_GEOMETRY | UPDATE_SCENE));
+      shared_state_pending_ = shared_state_pending_ || (update_type & UPDATE_STATE);
+    }
+  }
+  shared_scene_condition_.notify_one();
+
+  if (scene_snapshots_enabled_)
+    updateSceneSnapshot();
+}
+
+void PlanningSceneMonitor::setSceneSnapshotsEnabled(bool flag)
+{
+  scene_snapshots_enabled_ = flag;
+  if (flag)
+  {
+    updateSceneSnapshot();
+  }
+  else
+  {
+    std::lock_guard<std::mutex> slock(scene_snapshot_lock_);
+    scene_snapshot_.reset();
+  }
+}
+
+planning_scene::PlanningSceneConstPtr PlanningSceneMonitor::getPlanningSceneSnapshot()
+{
+  if (scene_snapshots_enabled_)
+  {
+    std::lock_guard<std::mutex> slock(scene_snapshot_lock_);
+    if (scene_snapshot_)
+      return scene_snapshot_;
+  }
+  return copyPlanningScene();
+}
+
+planning_scene::PlanningScenePtr PlanningSceneMonitor::copyPlanningScene()
+{
+  if (!scene_)
+    return planning_scene::PlanningScenePtr();
+
+  planning_scene::PlanningScenePtr copy;
+  lockSceneRead();
+  try
+  {
+    copy = planning_scene::PlanningScene::clone(scene_);
+
+    // the octree is updated in place by the octomap monitor, so the copy needs its own
+    collision_detection::World::ObjectConstPtr map =
+        copy->getWorld()->getObject(planning_scene::PlanningScene::OCTOMAP_NS);
+    if (map && map->shapes_.size() == 1 && map->shapes_[0]->type == shapes::OCTREE)
+    {
+      const shapes::OcTree* o = static_cast<const shapes::OcTree*>(map->shapes_[0].get());
+      const Eigen::Isometry3d pose = map->shape_poses_[0];
+      std::shared_ptr<const octomap::OcTree> octree = std::make_shared<const octomap::OcTree>(*o->octree);
+      map.reset();
+      copy->processOctomapPtr(octree, pose);
+    }
+  }
+  catch (...)
+  {
+    unlockSceneRead();  // unlock and rethrow
+    throw;
+  }
+  unlockSceneRead();
+  return copy;
+}
+
+void PlanningSceneMonitor::updateSceneSnapshot()
+{
+  // the copy is created outside of the snapshot lock, so readers keep getting the previous snapshot meanwhile
+  planning_scene::PlanningSceneConstPtr snapshot = copyPlanningScene();
+  std::lock_guard<std::mutex> slock(scene_snapshot_lock_);
+  scene_snapshot_ = snapshot;
 }
 
 bool PlanningSceneMonitor::requestPlanningSceneState(const std::string& service_name)
@@ -567,8 +1006,14 @@ bool PlanningSceneMonitor::requestPlanningSceneState(const std::string& service_
   return false;
 }
 
-void PlanningSceneMonitor::providePlanningSceneService(const std::string& service_name)
+void PlanningSceneMonitor::providePlanningSceneService(const std::string& service_name, bool binary_octomap)
 {
+  binary_octomap_service_ = binary_octomap;
+  {
+    std::lock_guard<std::mutex> lock(scene_msg_cache_mutex_);
+    cached_octomap_.reset();
+  }
+
   // Load the service
   get_scene_service_ = pnode_->create_service<moveit_msgs::srv::GetPlanningScene>(
       service_name, std::bind(&PlanningSceneMonitor::getPlanningSceneServiceCallback, this, std::placeholders::_1,
@@ -581,11 +1026,70 @@ void PlanningSceneMonitor::getPlanningSceneServiceCallback(moveit_msgs::srv::Get
   if (req->components.components & moveit_msgs::msg::PlanningSceneComponents::TRANSFORMS)
     updateFrameTransforms();
 
-  moveit_msgs::msg::PlanningSceneComponents all_components;
-  all_components.components = UINT_MAX;  // Return all scene components if nothing is specified.
+  // Return all scene components if nothing is specified.
+  const std::uint32_t components = req->components.components ? req->components.components : UINT_MAX;
+  const bool world_geometry = components & moveit_msgs::msg::PlanningSceneComponents::WORLD_OBJECT_GEOMETRY;
+  const bool octomap = components & moveit_msgs::msg::PlanningSceneComponents::OCTOMAP;
+
+  // The world geometry and the octomap come from caches, the other components are cheap to serialize
+  moveit_msgs::msg::PlanningSceneComponents uncached_components;
+  uncached_components.components = components & ~moveit_msgs::msg::PlanningSceneComponents::OCTOMAP;
+  if (world_geometry)
+    uncached_components.components &= ~(moveit_msgs::msg::PlanningSceneComponents::WORLD_OBJECT_GEOMETRY |
+                                        moveit_msgs::msg::PlanningSceneComponents::WORLD_OBJECT_NAMES);
+
+  std::shared_ptr<const std::vector<moveit_msgs::msg::CollisionObject>> collision_objects;
+  std::shared_ptr<const octomap_msgs::msg::OctomapWithPose> octomap_msg;
+  lockSceneRead("getPlanningSceneServiceCallback");
+  try
+  {
+    scene_->getPlanningSceneMsg(res->scene, uncached_components);
+    if (world_geometry)
+      collision_objects = getCachedCollisionObjectMsgs();
+    if (octomap)
+      octomap_msg = getCachedOctomapMsg();
+  }
+  catch (...)
+  {
+    unlockSceneRead();  // unlock and rethrow
+    throw;
+  }
+  unlockSceneRead();
 
-  boost::unique_lock<boost::shared_mutex> ulock(scene_update_mutex_);
-  scene_->getPlanningSceneMsg(res->scene, req->components.components ? req->components : all_components);
+  // the cached messages are not changed anymore, so they are copied without holding the scene lock
+  if (collision_objects)
+    res->scene.world.collision_objects = *collision_objects;
+  if (octomap_msg)
+    res->scene.world.octomap = *octomap_msg;
+}
+
+std::shared_ptr<const std::vector<moveit_msgs::msg::CollisionObject>>
+PlanningSceneMonitor::getCachedCollisionObjectMsgs()
+{
+  std::lock_guard<std::mutex> lock(scene_msg_cache_mutex_);
+  const std::uint64_t version = world_objects_version_;
+  if (!cached_collision_objects_ || cached_collision_objects_version_ != version)
+  {
+    auto collision_objects = std::make_shared<std::vector<moveit_msgs::msg::CollisionObject>>();
+    scene_->getCollisionObjectMsgs(*collision_objects);
+    cached_collision_objects_ = collision_objects;
+    cached_collision_objects_version_ = version;
+  }
+  return cached_collision_objects_;
+}
+
+std::shared_ptr<const octomap_msgs::msg::OctomapWithPose> PlanningSceneMonitor::getCachedOctomapMsg()
+{
+  std::lock_guard<std::mutex> lock(scene_msg_cache_mutex_);
+  const std::uint64_t version = octomap_version_;
+  if (!cached_octomap_ || cached_octomap_version_ != version)
+  {
+    auto octomap = std::make_shared<octomap_msgs::msg::OctomapWithPose>();
+    scene_->getOctomapMsg(*octomap, binary_octomap_service_);
+    cached_octomap_ = octomap;
+    cached_octomap_version_ = version;
+  }
+  return cached_octomap_;
 }
 
 void PlanningSceneMonitor::updatePublishSettings(bool publish_geom_updates, bool publish_state_updates,
@@ -639,7 +1143,7 @@ bool PlanningSceneMonitor::newPlanningSceneMessage(const moveit_msgs::msg::Plann
   SceneUpdateType upd = UPDATE_SCENE;
   std::string old_scene_name;
   {
-    boost::unique_lock<boost::shared_mutex> ulock(scene_update_mutex_);
+    SceneUpdateLock ulock(*this, "newPlanningSceneMessage");
     // we don't want the transform cache to update while we are potentially changing attached bodies
     boost::recursive_mutex::scoped_lock prevent_shape_cache_updates(shape_handles_lock_);
 
@@ -651,6 +1155,7 @@ bool PlanningSceneMonitor::newPlanningSceneMessage(const moveit_msgs::msg::Plann
     result = scene_->usePlanningSceneMsg(scene);
     if (octomap_monitor_)
     {
+      octomap_world_outdated_ = true;
       if (!scene.is_diff && scene.world.octomap.octomap.data.empty())
       {
         octomap_monitor_->getOcTreePtr()->lockWrite();
@@ -714,12 +1219,13 @@ void PlanningSceneMonitor::newPlanningSceneWorldCallback(moveit_msgs::msg::Plann
   {
     updateFrameTransforms();
     {
-      boost::unique_lock<boost::shared_mutex> ulock(scene_update_mutex_);
+      SceneUpdateLock ulock(*this, "newPlanningSceneWorldCallback");
       last_update_time_ = rclcpp::Clock().now();
       scene_->getWorldNonConst()->clearObjects();
       scene_->processPlanningSceneWorldMsg(*world);
       if (octomap_monitor_)
       {
+        octomap_world_outdated_ = true;
         if (world->octomap.octomap.data.empty())
         {
           octomap_monitor_->getOcTreePtr()->lockWrite();
@@ -739,7 +1245,7 @@ void PlanningSceneMonitor::collisionObjectCallback(moveit_msgs::msg::CollisionOb
 
   updateFrameTransforms();
   {
-    boost::unique_lock<boost::shared_mutex> ulock(scene_update_mutex_);
+    SceneUpdateLock ulock(*this, "collisionObjectCallback");
     last_update_time_ = rclcpp::Clock().now();
     if (!scene_->processCollisionObjectMsg(*obj))
       return;
@@ -753,7 +1259,7 @@ void PlanningSceneMonitor::attachObjectCallback(moveit_msgs::msg::AttachedCollis
   {
     updateFrameTransforms();
     {
-      boost::unique_lock<boost::shared_mutex> ulock(scene_update_mutex_);
+      SceneUpdateLock ulock(*this, "attachObjectCallback");
       last_update_time_ = rclcpp::Clock().now();
       scene_->processAttachedCollisionObjectMsg(*obj);
     }
@@ -948,6 +1454,7 @@ void PlanningSceneMonitor::includeWorldObjectInOctree(const collision_detection:
 void PlanningSceneMonitor::currentStateAttachedBodyUpdateCallback(moveit::core::AttachedBody* attached_body,
                                                                   bool just_attached)
 {
+  attached_bodies_changed_ = true;
   if (!octomap_monitor_)
     return;
 
@@ -1031,34 +1538,79 @@ bool PlanningSceneMonitor::waitForCurrentRobotState(const rclcpp::Time& t, doubl
   return success;
 }
 
-void PlanningSceneMonitor::lockSceneRead()
+void PlanningSceneMonitor::lockSceneRead(const char* holder)
 {
+  MOVEIT_TRACE_SCOPE("PlanningSceneMonitor::lockSceneRead");
+  std::int64_t request_time = moveit::tools::tracing::now();
   scene_update_mutex_.lock_shared();
   if (octomap_monitor_)
     octomap_monitor_->getOcTreePtr()->lockRead();
+  scene_read_locks.push_back({ this, holder, request_time, moveit::tools::tracing::now() });
 }
 
 void PlanningSceneMonitor::unlockSceneRead()
 {
+  // read locks released by another thread than the one that acquired them are not recorded
+  for (auto it = scene_read_locks.rbegin(); it != scene_read_locks.rend(); ++it)
+    if (it->monitor == this)
+    {
+      recordSceneLock(it->holder, false, it->request_time, it->acquire_time, moveit::tools::tracing::now());
+      scene_read_locks.erase(std::next(it).base());
+      break;
+    }
   if (octomap_monitor_)
     octomap_monitor_->getOcTreePtr()->unlockRead();
   scene_update_mutex_.unlock_shared();
 }
 
-void PlanningSceneMonitor::lockSceneWrite()
+void PlanningSceneMonitor::lockSceneWrite(const char* holder)
 {
+  MOVEIT_TRACE_SCOPE("PlanningSceneMonitor::lockSceneWrite");
+  std::int64_t request_time = moveit::tools::tracing::now();
   scene_update_mutex_.lock();
   if (octomap_monitor_)
     octomap_monitor_->getOcTreePtr()->lockWrite();
+  scene_write_lock_holder_ = holder;
+  scene_write_lock_request_time_ = request_time;
+  scene_write_lock_acquire_time_ = moveit::tools::tracing::now();
 }
 
 void PlanningSceneMonitor::unlockSceneWrite()
 {
+  recordSceneLock(scene_write_lock_holder_, true, scene_write_lock_request_time_, scene_write_lock_acquire_time_,
+                  moveit::tools::tracing::now());
   if (octomap_monitor_)
     octomap_monitor_->getOcTreePtr()->unlockWrite();
   scene_update_mutex_.unlock();
 }
 
+void PlanningSceneMonitor::recordSceneLock(const char* holder, bool write, std::int64_t request_time,
+                                           std::int64_t acquire_time, std::int64_t release_time)
+{
+  const std::int64_t wait = acquire_time - request_time;
+  const std::int64_t hold = release_time - acquire_time;
+  const double wait_time = 1e-9 * wait;
+  const double hold_time = 1e-9 * hold;
+  if (write && hold_time > scene_write_lock_warning_threshold_)
+    RCLCPP_WARN(LOGGER, "'%s' held the planning scene locked for writing for %.3f seconds", holder, hold_time);
+
+  std::lock_guard<std::mutex> lock(scene_lock_statistics_mutex_);
+  SceneLockStatistics& statistics = scene_lock_statistics_[std::string(holder) + (write ? " (write)" : " (read)")];
+  ++statistics.count;
+  statistics.total_wait_time += wait_time;
+  statistics.max_wait_time = std::max(statistics.max_wait_time, wait_time);
+  statistics.total_hold_time += hold_time;
+  statistics.max_hold_time = std::max(statistics.max_hold_time, hold_time);
+  ++statistics.wait_time_histogram[getHistogramBucket(wait)];
+  ++statistics.hold_time_histogram[getHistogramBucket(hold)];
+}
+
+std::map<std::string, PlanningSceneMonitor::SceneLockStatistics> PlanningSceneMonitor::getSceneLockStatistics() const
+{
+  std::lock_guard<std::mutex> lock(scene_lock_statistics_mutex_);
+  return scene_lock_statistics_;
+}
+
 void PlanningSceneMonitor::startSceneMonitor(const std::string& scene_topic)
 {
   stopSceneMonitor();
@@ -1178,6 +1730,7 @@ void PlanningSceneMonitor::startWorldGeometryMonitor(const std::string& collisio
                                                               boost::placeholders::_1, boost::placeholders::_2,
                                                               boost::placeholders::_3));
       octomap_monitor_->setUpdateCallback(boost::bind(&PlanningSceneMonitor::octomapUpdateCallback, this));
+      octomap_monitor_->getOcTreePtr()->enableChangeDetection(true);
     }
     octomap_monitor_->startMonitor();
   }
@@ -1313,9 +1866,22 @@ void PlanningSceneMonitor::octomapUpdateCallback()
   if (!octomap_monitor_)
     return;
 
+  {
+    // The collision environments query the octree in place, so the scene only needs to be updated (and published)
+    // if voxels were added, deleted or changed between occupied and free, or if the scene lost track of the octree
+    const occupancy_map_monitor::OccMapTreePtr& tree = octomap_monitor_->getOcTreePtr();
+    occupancy_map_monitor::OccMapTree::WriteLock lock = tree->writing();
+    const bool outdated = octomap_world_outdated_.exchange(false);
+    const bool changed = tree->numChangesDetected() > 0 || tree->size() != last_octree_size_;
+    tree->resetChangeDetection();
+    last_octree_size_ = tree->size();
+    if (!outdated && !changed)
+      return;
+  }
+
   updateFrameTransforms();
   {
-    boost::unique_lock<boost::shared_mutex> ulock(scene_update_mutex_);
+    SceneUpdateLock ulock(*this, "octomapUpdateCallback");
     last_update_time_ = rclcpp::Clock().now();
     octomap_monitor_->getOcTreePtr()->lockRead();
     try
@@ -1329,7 +1895,7 @@ void PlanningSceneMonitor::octomapUpdateCallback()
       throw;
     }
   }
-  triggerSceneUpdateEvent(UPDATE_GEOMETRY);
+  triggerSceneUpdateEvent(UPDATE_GEOMETRY, false);
 }
 
 void PlanningSceneMonitor::setStateUpdateFrequency(double hz)
@@ -1378,7 +1944,7 @@ void PlanningSceneMonitor::updateSceneWithCurrentState()
     }
 
     {
-      boost::unique_lock<boost::shared_mutex> ulock(scene_update_mutex_);
+      SceneUpdateLock ulock(*this, "updateSceneWithCurrentState");
       last_update_time_ = last_robot_motion_time_ = current_state_monitor_->getCurrentStateTime();
       RCLCPP_DEBUG(LOGGER, "robot state update %f", fmod(last_robot_motion_time_.seconds(), 10.));
       current_state_monitor_->setToCurrentState(scene_->getCurrentStateNonConst());
@@ -1449,7 +2015,7 @@ void PlanningSceneMonitor::updateFrameTransforms()
     std::vector<geometry_msgs::msg::TransformStamped> transforms;
     getUpdatedFrameTransforms(transforms);
     {
-      boost::unique_lock<boost::shared_mutex> ulock(scene_update_mutex_);
+      SceneUpdateLock ulock(*this, "updateFrameTransforms");
       scene_->getTransformsNonConst().setTransforms(transforms);
       last_update_time_ = rclcpp::Clock().now();
     }
@@ -0,0 +1,414 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, PickNik LLC
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik LLC nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include <moveit/planning_scene_monitor/shared_planning_scene.h>
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <thread>
+
+namespace planning_scene_monitor
+{
+namespace bip = boost::interprocess;
+
+static const rclcpp::Logger LOGGER = rclcpp::get_logger("moveit_ros.shared_planning_scene");
+
+namespace
+{
+constexpr std::uint32_t SEGMENT_MAGIC = 0x4d505353;  // "MPSS"
+constexpr std::uint32_t SEGMENT_LAYOUT = 2;
+constexpr std::size_t MODEL_NAME_LENGTH = 64;
+constexpr std::size_t INITIAL_GEOMETRY_CAPACITY = 1 << 20;
+
+// The layout of the segment. Only fixed size types are used, so that all processes agree on it, and only lock-free
+// atomics, which work across processes.
+struct SegmentHeader
+{
+  std::atomic<std::uint32_t> magic;  // set last, once the header is initialized
+  std::uint32_t layout;
+  std::atomic<std::uint32_t> stale;  // set when the writer replaced the segment by a larger one
+  std::uint32_t variable_count;
+  char robot_model_name[MODEL_NAME_LENGTH];
+  std::uint64_t geometry_capacity;
+
+  // robot state positions, written under their own sequence lock
+  std::atomic<std::uint64_t> state_sequence;
+  std::atomic<std::int64_t> state_stamp;  // 0 until a state is published
+
+  // serialized scene without the octomap, followed by the serialized octomap, written under their own sequence lock
+  std::atomic<std::uint64_t> geometry_sequence;
+  std::atomic<std::uint64_t> geometry_version;  // 0 until a scene is published
+  std::atomic<std::uint64_t> geometry_size;
+  std::atomic<std::uint64_t> octomap_version;  // 0 until an octomap is published
+  std::atomic<std::uint64_t> octomap_size;
+  // followed by variable_count positions and geometry_capacity bytes of the serialized scene and octomap
+};
+
+static_assert(std::atomic<std::uint64_t>::is_always_lock_free && std::atomic<double>::is_always_lock_free,
+              "Sharing the planning scene requires lock-free 64 bit atomics");
+
+std::size_t positionsOffset()
+{
+  return (sizeof(SegmentHeader) + alignof(std::atomic<double>) - 1) / alignof(std::atomic<double>) *
+         alignof(std::atomic<double>);
+}
+
+std::atomic<double>* positions(void* base)
+{
+  return reinterpret_cast<std::atomic<double>*>(static_cast<char*>(base) + positionsOffset());
+}
+
+std::uint8_t* geometry(void* base, std::size_t variable_count)
+{
+  return reinterpret_cast<std::uint8_t*>(positions(base) + variable_count);
+}
+
+template <typename MessageT>
+void serialize(const rclcpp::Serialization<MessageT>& serializer, const MessageT& msg, std::vector<std::uint8_t>& bytes)
+{
+  rclcpp::SerializedMessage serialized;
+  serializer.serialize_message(&msg, &serialized);
+  const rcl_serialized_message_t& raw = serialized.get_rcl_serialized_message();
+  bytes.assign(raw.buffer, raw.buffer + raw.buffer_length);
+}
+
+// throws if the bytes are not a valid message
+template <typename MessageT>
+void deserialize(const rclcpp::Serialization<MessageT>& serializer, const std::vector<std::uint8_t>& bytes,
+                 MessageT& msg)
+{
+  rclcpp::SerializedMessage serialized(bytes.size());
+  rcl_serialized_message_t& raw = serialized.get_rcl_serialized_message();
+  std::memcpy(raw.buffer, bytes.data(), bytes.size());
+  raw.buffer_length = bytes.size();
+  serializer.deserialize_message(&serialized, &msg);
+}
+}  // namespace
+
+SharedPlanningSceneWriter::SharedPlanningSceneWriter(const std::string& name,
+                                                     const moveit::core::RobotModelConstPtr& robot_model)
+  : name_(name), robot_model_(robot_model), geometry_capacity_(0), geometry_version_(0), octomap_version_(0)
+{
+  createSegment(INITIAL_GEOMETRY_CAPACITY);
+}
+
+SharedPlanningSceneWriter::~SharedPlanningSceneWriter()
+{
+  region_.reset();
+  segment_.reset();
+  bip::shared_memory_object::remove(name_.c_str());
+}
+
+void SharedPlanningSceneWriter::createSegment(std::size_t geometry_capacity)
+{
+  const std::size_t variable_count = robot_model_->getVariableCount();
+  std::vector<double> state(variable_count, 0.0);
+  std::int64_t state_stamp = 0;
+  if (region_)
+  {
+    SegmentHeader* old_header = static_cast<SegmentHeader*>(region_->get_address());
+    const std::atomic<double>* old_values = positions(region_->get_address());
+    for (std::size_t i = 0; i < variable_count; ++i)
+      state[i] = old_values[i].load(std::memory_order_relaxed);
+    state_stamp = old_header->state_stamp.load(std::memory_order_relaxed);
+
+    // readers that mapped the old segment keep it until they map the new one
+    old_header->stale.store(1, std::memory_order_release);
+    region_.reset();
+    segment_.reset();
+  }
+  bip::shared_memory_object::remove(name_.c_str());
+
+  segment_ = std::make_unique<bip::shared_memory_object>(bip::create_only, name_.c_str(), bip::read_write);
+  segment_->truncate(positionsOffset() + variable_count * sizeof(double) + geometry_capacity);
+  region_ = std::make_unique<bip::mapped_region>(*segment_, bip::read_write);
+  geometry_capacity_ = geometry_capacity;
+
+  SegmentHeader* header = new (region_->get_address()) SegmentHeader();
+  header->layout = SEGMENT_LAYOUT;
+  header->stale.store(0, std::memory_order_relaxed);
+  header->variable_count = variable_count;
+  std::strncpy(header->robot_model_name, robot_model_->getName().c_str(), MODEL_NAME_LENGTH - 1);
+  header->robot_model_name[MODEL_NAME_LENGTH - 1] = '\0';
+  header->geometry_capacity = geometry_capacity;
+  header->state_sequence.store(0, std::memory_order_relaxed);
+  header->state_stamp.store(state_stamp, std::memory_order_relaxed);
+  header->geometry_sequence.store(0, std::memory_order_relaxed);
+  std::atomic<double>* values = positions(region_->get_address());
+  for (std::size_t i = 0; i < variable_count; ++i)
+    new (values + i) std::atomic<double>(state[i]);
+
+  // the new segment starts out with the scene published last
+  std::uint8_t* bytes = geometry(region_->get_address(), variable_count);
+  std::copy(scene_bytes_.begin(), scene_bytes_.end(), bytes);
+  std::copy(octomap_bytes_.begin(), octomap_bytes_.end(), bytes + scene_bytes_.size());
+  header->geometry_size.store(scene_bytes_.size(), std::memory_order_relaxed);
+  header->geometry_version.store(geometry_version_, std::memory_order_relaxed);
+  header->octomap_size.store(octomap_bytes_.size(), std::memory_order_relaxed);
+  header->octomap_version.store(octomap_version_, std::memory_order_relaxed);
+  header->magic.store(SEGMENT_MAGIC, std::memory_order_release);
+}
+
+void SharedPlanningSceneWriter::writeGeometry(const moveit_msgs::msg::PlanningScene& scene)
+{
+  serialize(serializer_, scene, scene_bytes_);
+  ++geometry_version_;
+  writeSerialized();
+}
+
+void SharedPlanningSceneWriter::writeOctomap(const octomap_msgs::msg::OctomapWithPose& octomap)
+{
+  serialize(octomap_serializer_, octomap, octomap_bytes_);
+  ++octomap_version_;
+  writeSerialized();
+}
+
+void SharedPlanningSceneWriter::writeSerialized()
+{
+  const std::size_t size = scene_bytes_.size() + octomap_bytes_.size();
+  if (!region_ || size > geometry_capacity_)
+  {
+    if (region_)
+      RCLCPP_INFO(LOGGER, "Planning scene of %zu bytes outgrew the shared memory segment '%s', replacing it", size,
+                  name_.c_str());
+    createSegment(std::max(INITIAL_GEOMETRY_CAPACITY, 2 * size));
+    return;
+  }
+
+  SegmentHeader* header = static_cast<SegmentHeader*>(region_->get_address());
+  const std::uint64_t sequence = header->geometry_sequence.load(std::memory_order_relaxed);
+  header->geometry_sequence.store(sequence + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  // the scene bytes are rewritten even if only the octomap changed, as a copy is cheap compared to deserializing
+  std::uint8_t* bytes = geometry(region_->get_address(), header->variable_count);
+  std::memcpy(bytes, scene_bytes_.data(), scene_bytes_.size());
+  std::memcpy(bytes + scene_bytes_.size(), octomap_bytes_.data(), octomap_bytes_.size());
+  header->geometry_size.store(scene_bytes_.size(), std::memory_order_relaxed);
+  header->geometry_version.store(geometry_version_, std::memory_order_relaxed);
+  header->octomap_size.store(octomap_bytes_.size(), std::memory_order_relaxed);
+  header->octomap_version.store(octomap_version_, std::memory_order_relaxed);
+
+  header->geometry_sequence.store(sequence + 2, std::memory_order_release);
+}
+
+void SharedPlanningSceneWriter::writeState(const moveit::core::RobotState& state, const rclcpp::Time& stamp)
+{
+  // a previous attempt to replace the segment failed
+  if (!region_)
+    createSegment(std::max(INITIAL_GEOMETRY_CAPACITY, 2 * (scene_bytes_.size() + octomap_bytes_.size())));
+
+  SegmentHeader* header = static_cast<SegmentHeader*>(region_->get_address());
+  const std::uint64_t sequence = header->state_sequence.load(std::memory_order_relaxed);
+  header->state_sequence.store(sequence + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  const double* pos = state.getVariablePositions();
+  std::atomic<double>* values = positions(region_->get_address());
+  for (std::size_t i = 0; i < header->variable_count; ++i)
+    values[i].store(pos[i], std::memory_order_relaxed);
+  // a stamp of 0 means there is no state yet
+  header->state_stamp.store(std::max<std::int64_t>(stamp.nanoseconds(), 1), std::memory_order_relaxed);
+
+  header->state_sequence.store(sequence + 2, std::memory_order_release);
+}
+
+SharedPlanningSceneReader::SharedPlanningSceneReader(const std::string& name,
+                                                     const moveit::core::RobotModelConstPtr& robot_model)
+  : name_(name)
+  , robot_model_(robot_model)
+  , positions_(robot_model->getVariableCount())
+  , has_applied_geometry_(false)
+  , applied_geometry_version_(0)
+  , applied_octomap_version_(0)
+{
+}
+
+bool SharedPlanningSceneReader::connect()
+{
+  if (region_ && !static_cast<SegmentHeader*>(region_->get_address())->stale.load(std::memory_order_acquire))
+    return true;
+
+  region_.reset();
+  segment_.reset();
+  has_applied_geometry_ = false;
+  try
+  {
+    segment_ = std::make_unique<bip::shared_memory_object>(bip::open_only, name_.c_str(), bip::read_only);
+    region_ = std::make_unique<bip::mapped_region>(*segment_, bip::read_only);
+  }
+  catch (const bip::interprocess_exception&)
+  {
+    // the writer did not create the segment yet
+    region_.reset();
+    segment_.reset();
+    return false;
+  }
+
+  const SegmentHeader* header = static_cast<const SegmentHeader*>(region_->get_address());
+  bool valid = region_->get_size() >= positionsOffset() &&
+               header->magic.load(std::memory_order_acquire) == SEGMENT_MAGIC && header->layout == SEGMENT_LAYOUT;
+  if (valid && (header->variable_count != robot_model_->getVariableCount() ||
+                robot_model_->getName().compare(0, MODEL_NAME_LENGTH - 1, header->robot_model_name) != 0))
+  {
+    RCLCPP_ERROR(LOGGER, "Shared planning scene '%s' is for robot model '%s', not '%s'", name_.c_str(),
+                 header->robot_model_name, robot_model_->getName().c_str());
+    valid = false;
+  }
+  if (!valid)
+  {
+    region_.reset();
+    segment_.reset();
+  }
+  return valid;
+}
+
+std::uint64_t SharedPlanningSceneReader::getGeometryVersion()
+{
+  if (!connect())
+    return 0;
+  return static_cast<const SegmentHeader*>(region_->get_address())->geometry_version.load(std::memory_order_acquire);
+}
+
+std::uint64_t SharedPlanningSceneReader::getOctomapVersion()
+{
+  if (!connect())
+    return 0;
+  return static_cast<const SegmentHeader*>(region_->get_address())->octomap_version.load(std::memory_order_acquire);
+}
+
+bool SharedPlanningSceneReader::readRobotState(moveit::core::RobotState& state, rclcpp::Time* stamp)
+{
+  if (!connect())
+    return false;
+
+  SegmentHeader* header = static_cast<SegmentHeader*>(region_->get_address());
+  const std::atomic<double>* values = positions(region_->get_address());
+  std::uint64_t sequence;
+  std::int64_t state_stamp;
+  do
+  {
+    // wait for the writer to finish an update in progress, which is a short copy
+    while ((sequence = header->state_sequence.load(std::memory_order_acquire)) & 1)
+      std::this_thread::yield();
+    for (std::size_t i = 0; i < positions_.size(); ++i)
+      positions_[i] = values[i].load(std::memory_order_relaxed);
+    state_stamp = header->state_stamp.load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+  } while (header->state_sequence.load(std::memory_order_relaxed) != sequence);
+
+  if (state_stamp == 0)
+    return false;
+  state.setVariablePositions(positions_);
+  if (stamp)
+    *stamp = rclcpp::Time(state_stamp, RCL_ROS_TIME);
+  return true;
+}
+
+bool SharedPlanningSceneReader::updatePlanningScene(planning_scene::PlanningScene& scene)
+{
+  if (!connect())
+    return false;
+
+  SegmentHeader* header = static_cast<SegmentHeader*>(region_->get_address());
+  const std::uint8_t* bytes = geometry(region_->get_address(), header->variable_count);
+  std::uint64_t sequence;
+  std::uint64_t version;
+  std::uint64_t octomap_version;
+  bool read_scene;
+  bool read_octomap;
+  do
+  {
+    // the geometry only changes with the world, so waiting for the writer here is rare
+    while ((sequence = header->geometry_sequence.load(std::memory_order_acquire)) & 1)
+      std::this_thread::yield();
+    version = header->geometry_version.load(std::memory_order_relaxed);
+    octomap_version = header->octomap_version.load(std::memory_order_relaxed);
+    read_scene = version != 0 && (!has_applied_geometry_ || version != applied_geometry_version_);
+    // a scene message replaces the whole world, so a new scene is always applied together with the octomap
+    read_octomap = read_scene || (has_applied_geometry_ && octomap_version != applied_octomap_version_);
+    if (!read_octomap)
+      break;
+    const std::uint64_t scene_size =
+        std::min<std::uint64_t>(header->geometry_size.load(std::memory_order_relaxed), header->geometry_capacity);
+    const std::uint64_t octomap_size = std::min<std::uint64_t>(header->octomap_size.load(std::memory_order_relaxed),
+                                                               header->geometry_capacity - scene_size);
+    if (read_scene)
+    {
+      scene_bytes_.resize(scene_size);
+      std::memcpy(scene_bytes_.data(), bytes, scene_size);
+    }
+    octomap_bytes_.resize(octomap_size);
+    std::memcpy(octomap_bytes_.data(), bytes + scene_size, octomap_size);
+    std::atomic_thread_fence(std::memory_order_acquire);
+  } while (header->geometry_sequence.load(std::memory_order_relaxed) != sequence);
+
+  if (version == 0)
+    return false;
+  if (read_octomap)
+  {
+    try
+    {
+      // an empty octomap part means no octomap was published, which clears the octomap of the scene
+      octomap_msgs::msg::OctomapWithPose octomap_msg;
+      if (!octomap_bytes_.empty())
+        deserialize(octomap_serializer_, octomap_bytes_, octomap_msg);
+      if (read_scene)
+      {
+        moveit_msgs::msg::PlanningScene scene_msg;
+        deserialize(serializer_, scene_bytes_, scene_msg);
+        scene_msg.world.octomap = std::move(octomap_msg);
+        if (!scene.setPlanningSceneMsg(scene_msg))
+          return false;
+      }
+      else
+      {
+        // only the octomap changed, the world objects are left alone
+        scene.processOctomapMsg(octomap_msg);
+      }
+    }
+    catch (const std::exception& e)
+    {
+      RCLCPP_ERROR(LOGGER, "Failed to deserialize shared planning scene '%s': %s", name_.c_str(), e.what());
+      return false;
+    }
+    has_applied_geometry_ = true;
+    applied_geometry_version_ = version;
+    applied_octomap_version_ = octomap_version;
+  }
+
+  readRobotState(scene.getCurrentStateNonConst());
+  return true;
+}
+}  // namespace planning_scene_monitor
@@ -37,28 +37,64 @@
 #include <moveit/planning_scene_monitor/trajectory_monitor.h>
 #include <moveit/trajectory_processing/trajectory_tools.h>
 #include <rclcpp/rate.hpp>
+#include <cmath>
 #include <limits>
 #include <memory>
 
 static const rclcpp::Logger LOGGER = rclcpp::get_logger("moveit_ros.planning_scene_monitor.trajectory_monitor");
 
+static moveit::core::RobotState getDefaultState(const moveit::core::RobotModelConstPtr& robot_model)
+{
+  moveit::core::RobotState state(robot_model);
+  state.setToDefaultValues();
+  return state;
+}
+
 planning_scene_monitor::TrajectoryMonitor::TrajectoryMonitor(const CurrentStateMonitorConstPtr& state_monitor,
                                                              double sampling_frequency)
   : current_state_monitor_(state_monitor)
   , sampling_frequency_(sampling_frequency)
+  , record_on_update_(false)
+  , min_position_change_(0.0)
   , trajectory_(current_state_monitor_->getRobotModel(), "")
+  , recording_(false)
+  , compact_trajectory_(getDefaultState(current_state_monitor_->getRobotModel()), nullptr)
+  , update_state_(getDefaultState(current_state_monitor_->getRobotModel()))
 {
   setSamplingFrequency(sampling_frequency);
 }
 
+planning_scene_monitor::TrajectoryMonitor::TrajectoryMonitor(const CurrentStateMonitorPtr& state_monitor,
+                                                             double max_frequency, bool record_on_update)
+  : TrajectoryMonitor(CurrentStateMonitorConstPtr(state_monitor), max_frequency)
+{
+  record_on_update_ = record_on_update;
+  if (!record_on_update_)
+    return;
+
+  update_target_ = std::make_shared<UpdateTarget>();
+  update_target_->monitor = this;
+  std::shared_ptr<UpdateTarget> target = update_target_;
+  state_monitor->addUpdateCallback([target](const sensor_msgs::msg::JointState::ConstSharedPtr& /*joint_state*/) {
+    std::lock_guard<std::mutex> _(target->lock);
+    if (target->monitor)
+      target->monitor->recordUpdate();
+  });
+}
+
 planning_scene_monitor::TrajectoryMonitor::~TrajectoryMonitor()
 {
   stopTrajectoryMonitor();
+  if (update_target_)
+  {
+    std::lock_guard<std::mutex> _(update_target_->lock);
+    update_target_->monitor = nullptr;
+  }
 }
 
 void planning_scene_monitor::TrajectoryMonitor::setSamplingFrequency(double sampling_frequency)
 {
-  if (sampling_frequency != sampling_frequency_)
+  if (sampling_frequency == sampling_frequency_)
     return;  // silently return if nothing changes
 
   if (sampling_frequency <= std::numeric_limits<double>::epsilon())
@@ -70,12 +106,20 @@ void planning_scene_monitor::TrajectoryMonitor::setSamplingFrequency(double samp
 
 bool planning_scene_monitor::TrajectoryMonitor::isActive() const
 {
-  return static_cast<bool>(record_states_thread_);
+  return record_on_update_ ? recording_.load() : static_cast<bool>(record_states_thread_);
 }
 
 void planning_scene_monitor::TrajectoryMonitor::startTrajectoryMonitor()
 {
-  if (sampling_frequency_ > std::numeric_limits<double>::epsilon() && !record_states_thread_)
+  if (record_on_update_)
+  {
+    if (!recording_)
+    {
+      recording_ = true;
+      RCLCPP_DEBUG(LOGGER, "Started trajectory monitor");
+    }
+  }
+  else if (sampling_frequency_ > std::numeric_limits<double>::epsilon() && !record_states_thread_)
   {
     record_states_thread_.reset(new boost::thread(boost::bind(&TrajectoryMonitor::recordStates, this)));
     RCLCPP_DEBUG(LOGGER, "Started trajectory monitor");
@@ -84,25 +128,98 @@ void planning_scene_monitor::TrajectoryMonitor::startTrajectoryMonitor()
 
 void planning_scene_monitor::TrajectoryMonitor::stopTrajectoryMonitor()
 {
-  if (record_states_thread_)
+  if (record_on_update_)
+  {
+    if (recording_)
+    {
+      std::lock_guard<std::mutex> _(compact_trajectory_lock_);
+      recording_ = false;
+      // end in the final state, even if it moved too little to be recorded
+      if (!skipped_positions_.empty())
+      {
+        compact_trajectory_.addSuffixWayPoint(skipped_positions_.data(), nullptr, nullptr,
+                                              (skipped_time_ - last_recorded_state_time_).seconds());
+        last_recorded_state_time_ = skipped_time_;
+        skipped_positions_.clear();
+      }
+      RCLCPP_DEBUG(LOGGER, "Stopped trajectory monitor");
+    }
+  }
+  else if (record_states_thread_)
   {
     std::unique_ptr<boost::thread> copy;
     copy.swap(record_states_thread_);
     copy->join();
+    if (skipped_state_.first)
+    {
+      trajectory_.addSuffixWayPoint(skipped_state_.first,
+                                    (skipped_state_.second - last_recorded_state_time_).seconds());
+      last_recorded_state_time_ = skipped_state_.second;
+      skipped_state_.first.reset();
+    }
     RCLCPP_DEBUG(LOGGER, "Stopped trajectory monitor");
   }
 }
 
 void planning_scene_monitor::TrajectoryMonitor::clearTrajectory()
 {
+  if (record_on_update_)
+  {
+    std::lock_guard<std::mutex> _(compact_trajectory_lock_);
+    compact_trajectory_.clear();
+    skipped_positions_.clear();
+    return;
+  }
+
   bool restart = isActive();
   if (restart)
     stopTrajectoryMonitor();
   trajectory_.clear();
+  skipped_state_.first.reset();
   if (restart)
     startTrajectoryMonitor();
 }
 
+const robot_trajectory::RobotTrajectory& planning_scene_monitor::TrajectoryMonitor::getTrajectory()
+{
+  if (record_on_update_)
+  {
+    std::lock_guard<std::mutex> _(compact_trajectory_lock_);
+    compact_trajectory_.getRobotTrajectory(trajectory_);
+  }
+  return trajectory_;
+}
+
+void planning_scene_monitor::TrajectoryMonitor::swapTrajectory(robot_trajectory::RobotTrajectory& other)
+{
+  if (record_on_update_)
+  {
+    std::lock_guard<std::mutex> _(compact_trajectory_lock_);
+    compact_trajectory_.getRobotTrajectory(other);
+    compact_trajectory_.clear();
+    skipped_positions_.clear();
+  }
+  else
+    trajectory_.swap(other);
+}
+
+robot_trajectory::CompactRobotTrajectory planning_scene_monitor::TrajectoryMonitor::getCompactTrajectory() const
+{
+  std::lock_guard<std::mutex> _(compact_trajectory_lock_);
+  return compact_trajectory_;
+}
+
+bool planning_scene_monitor::TrajectoryMonitor::hasMoved(const double* last_positions, const double* positions) const
+{
+  if (min_position_change_ <= 0.0)
+    return true;
+  const std::size_t count = current_state_monitor_->getRobotModel()->getVariableCount();
+  for (std::size_t i = 0; i < count; ++i)
+    if (std::fabs(positions[i] - last_positions[i]) > min_position_change_)
+      return true;
+  return false;
+}
+
 void planning_scene_monitor::TrajectoryMonitor::recordStates()
 {
   if (!current_state_monitor_)
@@ -120,12 +237,56 @@ void planning_scene_monitor::TrajectoryMonitor::recordStates()
       trajectory_start_time_ = state.second;
       last_recorded_state_time_ = state.second;
     }
+    else if (!hasMoved(trajectory_.getLastWayPoint().getVariablePositions(), state.first->getVariablePositions()))
+    {
+      skipped_state_ = state;
+      continue;
+    }
     else
     {
       trajectory_.addSuffixWayPoint(state.first, (state.second - last_recorded_state_time_).seconds());
       last_recorded_state_time_ = state.second;
     }
+    skipped_state_.first.reset();
     if (state_add_callback_)
       state_add_callback_(state.first, state.second);
   }
 }
+
+void planning_scene_monitor::TrajectoryMonitor::recordUpdate()
+{
+  if (!recording_)
+    return;
+
+  const rclcpp::Time stamp = current_state_monitor_->getCurrentStateTime();
+  current_state_monitor_->setToCurrentState(update_state_);
+  const double* positions = update_state_.getVariablePositions();
+  {
+    std::lock_guard<std::mutex> _(compact_trajectory_lock_);
+    if (!recording_)
+      return;
+    if (compact_trajectory_.empty())
+    {
+      compact_trajectory_.addSuffixWayPoint(positions, nullptr, nullptr, 0.0);
+      trajectory_start_time_ = stamp;
+    }
+    else
+    {
+      const bool too_soon =
+          sampling_frequency_ > 0.0 && (stamp - last_recorded_state_time_).seconds() < 1.0 / sampling_frequency_;
+      if (too_soon ||
+          !hasMoved(compact_trajectory_.getWayPointPositions(compact_trajectory_.getWayPointCount() - 1), positions))
+      {
+        skipped_positions_.assign(positions, positions + compact_trajectory_.getVariableCount());
+        skipped_time_ = stamp;
+        return;
+      }
+      compact_trajectory_.addSuffixWayPoint(positions, nullptr, nullptr, (stamp - last_recorded_state_time_).seconds());
+    }
+    last_recorded_state_time_ = stamp;
+    skipped_positions_.clear();
+  }
+
+  if (state_add_callback_)
+    state_add_callback_(std::make_shared<moveit::core::RobotState>(update_state_), stamp);
+}
@@ -129,6 +129,12 @@ public:
 private:
   void configure(const Options& opt);
 
+  /** \brief Read the collision proxies of the link meshes from the parameters. Returns null if none are configured. */
+  moveit::core::CollisionProxyGeneratorConstPtr loadCollisionProxies() const;
+
+  /** \brief Read the directory of the cache of parsed link meshes from the parameters. Returns null if not set. */
+  moveit::core::MeshCacheConstPtr loadMeshCache() const;
+
   moveit::core::RobotModelPtr model_;
   rdf_loader::RDFLoaderPtr rdf_loader_;
   kinematics_plugin_loader::KinematicsPluginLoaderPtr kinematics_loader_;
@@ -37,6 +37,8 @@
 #include <moveit/robot_model_loader/robot_model_loader.h>
 #include <moveit/profiler/profiler.h>
 #include "rclcpp/rclcpp.hpp"
+#include <algorithm>
+#include <future>
 #include <typeinfo>
 
 namespace robot_model_loader
@@ -95,6 +97,46 @@ bool canSpecifyPosition(const moveit::core::JointModel* jmodel, const unsigned i
   }
   return ok;
 }
+
+/// Read the collision proxy options under \e prefix. Returns false if none of them is set.
+bool loadCollisionProxyOptions(const rclcpp::Node::SharedPtr& node, const std::string& prefix,
+                               moveit::core::CollisionProxyOptions& options)
+{
+  bool found = false;
+  std::string param_name;
+  try
+  {
+    param_name = prefix + "type";
+    std::string type;
+    if (node->get_parameter(param_name, type))
+    {
+      found = true;
+      if (!moveit::core::collisionProxyTypeFromString(type, options.type))
+        RCLCPP_ERROR(LOGGER, "Unknown collision proxy type '%s' for parameter %s", type.c_str(), param_name.c_str());
+    }
+
+    param_name = prefix + "resolution";
+    if (node->get_parameter(param_name, options.resolution))
+      found = true;
+
+    param_name = prefix + "max_convex_hulls";
+    int max_convex_hulls;
+    if (node->get_parameter(param_name, max_convex_hulls))
+    {
+      found = true;
+      options.max_convex_hulls = std::max(max_convex_hulls, 1);
+    }
+
+    param_name = prefix + "concavity";
+    if (node->get_parameter(param_name, options.concavity))
+      found = true;
+  }
+  catch (const rclcpp::ParameterTypeException& e)
+  {
+    RCLCPP_ERROR(LOGGER, "When getting the parameter %s: %s", param_name.c_str(), e.what());
+  }
+  return found;
+}
 }  // namespace
 
 void RobotModelLoader::configure(const Options& opt)
@@ -112,7 +154,8 @@ void RobotModelLoader::configure(const Options& opt)
   {
     const srdf::ModelSharedPtr& srdf =
         rdf_loader_->getSRDF() ? rdf_loader_->getSRDF() : srdf::ModelSharedPtr(new srdf::Model());
-    model_.reset(new moveit::core::RobotModel(rdf_loader_->getURDF(), srdf));
+    model_.reset(
+        new moveit::core::RobotModel(rdf_loader_->getURDF(), srdf, loadCollisionProxies(), loadMeshCache()));
   }
 
   if (model_ && !rdf_loader_->getRobotDescription().empty())
@@ -196,6 +239,53 @@ void RobotModelLoader::configure(const Options& opt)
   RCLCPP_DEBUG(node_->get_logger(), "Loaded kinematic model in %d seconds", (clock.now() - start).seconds());
 }
 
+moveit::core::CollisionProxyGeneratorConstPtr RobotModelLoader::loadCollisionProxies() const
+{
+  if (rdf_loader_->getRobotDescription().empty())
+    return moveit::core::CollisionProxyGeneratorConstPtr();
+
+  // simplified collision geometry for the link meshes, e.g. robot_description_planning.collision_proxies.<link>.type
+  const std::string prefix = rdf_loader_->getRobotDescription() + "_planning.collision_proxies.";
+  auto proxies = std::make_shared<moveit::core::CollisionProxyGenerator>();
+  bool found = false;
+
+  moveit::core::CollisionProxyOptions options;
+  if (loadCollisionProxyOptions(node_, prefix + "default.", options))
+  {
+    proxies->setDefaultOptions(options);
+    found = true;
+  }
+  for (const std::pair<const std::string, urdf::LinkSharedPtr>& link : rdf_loader_->getURDF()->links_)
+  {
+    options = proxies->getDefaultOptions();
+    if (loadCollisionProxyOptions(node_, prefix + link.first + ".", options))
+    {
+      proxies->setLinkOptions(link.first, options);
+      found = true;
+    }
+  }
+  if (!found)
+    return moveit::core::CollisionProxyGeneratorConstPtr();
+
+  std::string cache_directory;
+  if (node_->get_parameter(prefix + "cache_directory", cache_directory))
+    proxies->setCacheDirectory(cache_directory);
+  return proxies;
+}
+
+moveit::core::MeshCacheConstPtr RobotModelLoader::loadMeshCache() const
+{
+  if (rdf_loader_->getRobotDescription().empty())
+    return moveit::core::MeshCacheConstPtr();
+
+  // e.g. robot_description_planning.mesh_cache_directory
+  std::string directory;
+  if (!node_->get_parameter(rdf_loader_->getRobotDescription() + "_planning.mesh_cache_directory", directory) ||
+      directory.empty())
+    return moveit::core::MeshCacheConstPtr();
+  return std::make_shared<moveit::core::MeshCache>(directory);
+}
+
 void RobotModelLoader::loadKinematicsSolvers(const kinematics_plugin_loader::KinematicsPluginLoaderPtr& kloader)
 {
   moveit::tools::Profiler::ScopedStart prof_start;
@@ -218,7 +308,9 @@ void RobotModelLoader::loadKinematicsSolvers(const kinematics_plugin_loader::Kin
     if (groups.empty() && !model_->getJointModelGroups().empty())
       RCLCPP_WARN(LOGGER, "No kinematics plugins defined. Fill and load kinematics.yaml!");
 
-    std::map<std::string, moveit::core::SolverAllocatorFn> imap;
+    // initialize the solvers of all groups concurrently, since the groups are independent and initializing a solver
+    // can take long (e.g. loading a robot model into the solver)
+    std::vector<std::pair<const moveit::core::JointModelGroup*, std::future<kinematics::KinematicsBasePtr>>> solvers;
     for (const std::string& group : groups)
     {
       // Check if a group in kinematics.yaml exists in the srdf
@@ -226,8 +318,16 @@ void RobotModelLoader::loadKinematicsSolvers(const kinematics_plugin_loader::Kin
         continue;
 
       const moveit::core::JointModelGroup* jmg = model_->getJointModelGroup(group);
+      solvers.emplace_back(jmg, std::async(std::launch::async, kinematics_allocator, jmg));
+    }
+
+    std::map<std::string, moveit::core::SolverAllocatorFn> imap;
+    for (auto& group_solver : solvers)
+    {
+      const moveit::core::JointModelGroup* jmg = group_solver.first;
+      const std::string& group = jmg->getName();
 
-      kinematics::KinematicsBasePtr solver = kinematics_allocator(jmg);
+      kinematics::KinematicsBasePtr solver = group_solver.second.get();
       if (solver)
       {
         std::string error_msg;
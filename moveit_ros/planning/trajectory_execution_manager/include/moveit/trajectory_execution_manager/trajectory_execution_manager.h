@@ -191,6 +191,8 @@ public:
   /// to execute the different parts of the trajectory. If multiple controllers can be used, preference is given to the
   /// already loaded ones.
   /// If no controller is specified, a default is used. This call is non-blocking.
+  /// If the trajectory starts within the allowed blend tolerance of the end of the trajectory still executing on the
+  /// same controller, the two are blended, see setAllowedBlendTolerance().
   bool pushAndExecute(const moveit_msgs::msg::RobotTrajectory& trajectory, const std::vector<std::string>& controllers);
 
   /// Add a trajectory that consists of a single state for immediate execution. Optionally specify a set of controllers
@@ -200,6 +202,22 @@ public:
   /// is given to the already loaded ones. If no controller is specified, a default is used. This call is non-blocking.
   bool pushAndExecute(const sensor_msgs::msg::JointState& state, const std::vector<std::string>& controllers);
 
+  /// Start executing a trajectory whose remainder is still being computed. Further chunks are added with
+  /// appendToStreamingExecution() and the stream is closed with finishStreamingExecution(). Controllers are selected as
+  /// for push(); all of them need to support appending to an executing trajectory. This call is non-blocking.
+  bool startStreamingExecution(const moveit_msgs::msg::RobotTrajectory& trajectory,
+                               const std::vector<std::string>& controllers = std::vector<std::string>());
+
+  /// Append a chunk to the trajectory started with startStreamingExecution(). The chunk needs to actuate the same
+  /// joints, with time_from_start measured from the start of the stream. Its first point either repeats the last
+  /// streamed point (within the allowed start tolerance) or follows it in time without exceeding joint velocity limits.
+  /// Chunks need to arrive before the controllers reach the end of the points already streamed. This call is
+  /// non-blocking.
+  bool appendToStreamingExecution(const moveit_msgs::msg::RobotTrajectory& trajectory);
+
+  /// Declare that no more chunks follow and wait until the streamed trajectory has been executed
+  moveit_controller_manager::ExecutionStatus finishStreamingExecution();
+
   /// Wait until the execution is complete. This only works for executions started by execute().  If you call this after
   /// pushAndExecute(), it will immediately stop execution.
   moveit_controller_manager::ExecutionStatus waitForExecution();
@@ -240,6 +258,17 @@ public:
   /// Set joint-value tolerance for validating trajectory's start point against current robot state
   void setAllowedStartTolerance(double tolerance);
 
+  /// Set the maximum age (seconds) of the latest robot state for validating a trajectory's start point against it
+  /// right away, extrapolated with the joint velocities. Older states make validation wait for a fresh one; 0 (the
+  /// default) always waits.
+  void setStartStateMaxAge(double age);
+
+  /// Set the joint-value tolerance within which a trajectory passed to pushAndExecute() may start away from the end of
+  /// the trajectory still executing on the same controller, for the two to be blended: the motion is retimed through
+  /// the junction, so that the robot does not stop in between. Blending needs a single controller per trajectory and a
+  /// joint model group of exactly the trajectory's joints. 0 (the default) disables blending.
+  void setAllowedBlendTolerance(double tolerance);
+
   /// Enable or disable waiting for trajectory completion
   void setWaitForTrajectoryCompletion(bool flag);
 
@@ -298,8 +327,18 @@ private:
                          const std::vector<std::string>& available_controllers,
                          std::vector<std::string>& selected_controllers);
 
+  /// Check that \e chunk continues \e previous, which holds the last streamed point; drop a repeated first point
+  bool checkStreamingContinuity(const trajectory_msgs::msg::JointTrajectory& previous,
+                                trajectory_msgs::msg::JointTrajectory& chunk) const;
+
   void executeThread(const ExecutionCompleteCallback& callback, const PathSegmentCompleteCallback& part_callback,
                      bool auto_clear);
+
+  /// Send each trajectory part to the corresponding controller, to all controllers concurrently. If any of them fails,
+  /// the parts that were sent successfully are canceled again.
+  bool sendTrajectoryParts(const std::vector<moveit_controller_manager::MoveItControllerHandlePtr>& handles,
+                           const std::vector<moveit_msgs::msg::RobotTrajectory>& parts);
+
   bool executePart(std::size_t part_index);
   bool waitForRobotToStop(const TrajectoryExecutionContext& context, double wait_time = 1.0);
   void continuousExecutionThread();
@@ -350,6 +389,9 @@ private:
   std::vector<TrajectoryExecutionContext*> trajectories_;
   std::deque<TrajectoryExecutionContext*> continuous_execution_queue_;
 
+  // controllers and last streamed points of the execution started by startStreamingExecution(), if any
+  std::unique_ptr<TrajectoryExecutionContext> streaming_context_;
+
   std::unique_ptr<pluginlib::ClassLoader<moveit_controller_manager::MoveItControllerManager> > controller_manager_loader_;
   moveit_controller_manager::MoveItControllerManagerPtr controller_manager_;
 
@@ -365,6 +407,8 @@ private:
   std::map<std::string, double> controller_allowed_goal_duration_margin_;
 
   double allowed_start_tolerance_;  // joint tolerance for validate(): radians for revolute joints
+  double start_state_max_age_;      // max age (s) of a robot state used by validate() without waiting for a new one
+  double allowed_blend_tolerance_;  // joint tolerance for blending trajectories passed to pushAndExecute(), 0 disables
   double execution_velocity_scaling_;
   bool wait_for_trajectory_completion_;
 
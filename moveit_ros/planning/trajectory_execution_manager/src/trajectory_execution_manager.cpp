@@ -36,9 +36,14 @@
 
 #include <moveit/trajectory_execution_manager/trajectory_execution_manager.h>
 #include <moveit/robot_state/robot_state.h>
+#include <moveit/robot_trajectory/robot_trajectory.h>
+#include <moveit/trajectory_processing/iterative_spline_parameterization.h>
+#include <moveit/profiler/tracing.h>
 #include <geometric_shapes/check_isometry.h>
 #include <tf2_eigen/tf2_eigen.h>
 
+#include <future>
+
 namespace trajectory_execution_manager
 {
 static const rclcpp::Logger LOGGER = rclcpp::get_logger("moveit_ros.trajectory_execution_manager");
@@ -52,6 +57,113 @@ static const double DEFAULT_CONTROLLER_GOAL_DURATION_MARGIN = 0.5;  // allow 0.5
 static const double DEFAULT_CONTROLLER_GOAL_DURATION_SCALING =
     1.1;  // allow the execution of a trajectory to take more time than expected (scaled by a value > 1)
 
+// time difference (s) below which the first point of a streamed chunk is treated as a repeat of the last streamed point
+static const double STREAMING_CONTINUITY_TIME_TOLERANCE = 1e-6;
+
+// time (s) ahead of the robot's expected position after which a blended trajectory is retimed; the points before are
+// kept as they are, since the controller is already moving towards them
+static const double BLEND_LOOKAHEAD = 0.1;
+
+namespace
+{
+// Evaluate function(i) for all i in [0, count), concurrently if there is more than one item. The calling thread
+// evaluates the first item itself. Used to talk to several controllers at once, so that a slow round trip to one of
+// them does not delay the others.
+template <typename Function>
+std::vector<bool> forEachConcurrently(std::size_t count, const Function& function)
+{
+  std::vector<std::future<bool> > futures;
+  for (std::size_t i = 1; i < count; ++i)
+    futures.push_back(std::async(std::launch::async, function, i));
+
+  std::vector<bool> results(count, false);
+  if (count > 0)
+    results[0] = function(0);
+  for (std::size_t i = 1; i < count; ++i)
+    results[i] = futures[i - 1].get();
+  return results;
+}
+
+// Rewrite \e next, which starts within \e tolerance of the end of \e previous, to continue \e previous without
+// stopping at their junction. The robot has been executing \e previous for \e elapsed seconds. The result starts
+// with the points of \e previous the robot has not reached yet; the motion from BLEND_LOOKAHEAD seconds ahead on,
+// up to the end of \e next, is retimed as a whole. Returns false if the trajectories cannot be blended.
+bool blendTrajectories(const moveit::core::RobotModelConstPtr& robot_model,
+                       const moveit_msgs::msg::RobotTrajectory& previous, double elapsed, double tolerance,
+                       moveit_msgs::msg::RobotTrajectory& next)
+{
+  const trajectory_msgs::msg::JointTrajectory& executing = previous.joint_trajectory;
+  const trajectory_msgs::msg::JointTrajectory& continuation = next.joint_trajectory;
+  if (!previous.multi_dof_joint_trajectory.points.empty() || !next.multi_dof_joint_trajectory.points.empty() ||
+      executing.points.empty() || continuation.points.empty() || executing.joint_names != continuation.joint_names ||
+      executing.points.back().positions.size() != executing.joint_names.size() ||
+      continuation.points.front().positions.size() != continuation.joint_names.size())
+    return false;
+
+  // retiming needs a group of exactly the trajectory's joints
+  const std::set<std::string> joints(executing.joint_names.begin(), executing.joint_names.end());
+  const moveit::core::JointModelGroup* group = nullptr;
+  for (const moveit::core::JointModelGroup* candidate : robot_model->getJointModelGroups())
+  {
+    const std::vector<std::string>& names = candidate->getActiveJointModelNames();
+    if (candidate->getVariableCount() == joints.size() && std::set<std::string>(names.begin(), names.end()) == joints)
+    {
+      group = candidate;
+      break;
+    }
+  }
+  if (!group)
+    return false;
+
+  for (std::size_t i = 0; i < executing.joint_names.size(); ++i)
+  {
+    const moveit::core::JointModel* jm = robot_model->getJointModel(executing.joint_names[i]);
+    if (!jm ||
+        jm->distance(&executing.points.back().positions[i], &continuation.points.front().positions[i]) > tolerance)
+      return false;
+  }
+
+  // the robot is on its way to point 'current'; the points up to 'splice' keep their timing
+  std::size_t current = 0;
+  while (current < executing.points.size() &&
+         rclcpp::Duration(executing.points[current].time_from_start).seconds() <= elapsed)
+    ++current;
+  if (current == executing.points.size())
+    return false;  // previous is complete, there is nothing to blend with
+  std::size_t splice = current;
+  while (splice + 1 < executing.points.size() &&
+         rclcpp::Duration(executing.points[splice].time_from_start).seconds() < elapsed + BLEND_LOOKAHEAD)
+    ++splice;
+
+  moveit::core::RobotState reference_state(robot_model);
+  reference_state.setToDefaultValues();
+  robot_trajectory::RobotTrajectory executing_trajectory(robot_model, group);
+  executing_trajectory.setRobotTrajectoryMsg(reference_state, previous);
+  robot_trajectory::RobotTrajectory continuation_trajectory(robot_model, group);
+  continuation_trajectory.setRobotTrajectoryMsg(reference_state, next);
+
+  // retime from the splice point on, keeping the velocity and acceleration the robot is expected to have there
+  robot_trajectory::RobotTrajectory tail(robot_model, group);
+  for (std::size_t i = splice; i < executing_trajectory.getWayPointCount(); ++i)
+    tail.addSuffixWayPoint(executing_trajectory.getWayPoint(i), 0.0);
+  for (std::size_t i = 1; i < continuation_trajectory.getWayPointCount(); ++i)
+    tail.addSuffixWayPoint(continuation_trajectory.getWayPoint(i), 0.0);
+  trajectory_processing::IterativeSplineParameterization time_parameterization;
+  if (!time_parameterization.computeTimeStamps(tail))
+    return false;
+
+  robot_trajectory::RobotTrajectory blended(robot_model, group);
+  for (std::size_t i = current; i <= splice; ++i)
+    blended.addSuffixWayPoint(executing_trajectory.getWayPoint(i),
+                              i == current ?
+                                  rclcpp::Duration(executing.points[current].time_from_start).seconds() - elapsed :
+                                  executing_trajectory.getWayPointDurationFromPrevious(i));
+  blended.append(tail, 0.0, 1);
+  blended.getRobotTrajectoryMsg(next);
+  return true;
+}
+}  // namespace
+
 TrajectoryExecutionManager::TrajectoryExecutionManager(const rclcpp::Node::SharedPtr& node,
                                                        const moveit::core::RobotModelConstPtr& robot_model,
                                                        const planning_scene_monitor::CurrentStateMonitorPtr& csm)
@@ -92,6 +204,8 @@ void TrajectoryExecutionManager::initialize()
   execution_duration_monitoring_ = true;
   execution_velocity_scaling_ = 1.0;
   allowed_start_tolerance_ = 0.01;
+  start_state_max_age_ = 0.0;
+  allowed_blend_tolerance_ = 0.0;
   wait_for_trajectory_completion_ = true;
 
   allowed_execution_duration_scaling_ = DEFAULT_CONTROLLER_GOAL_DURATION_SCALING;
@@ -152,6 +266,15 @@ void TrajectoryExecutionManager::initialize()
 
         controller_manager_ = controller_manager_loader_->createUniqueInstance(controller);
         controller_manager_->initialize(controller_mgr_node_);
+        if (csm_)
+        {
+          // simulated controllers may update the state monitor directly
+          planning_scene_monitor::CurrentStateMonitorPtr csm = csm_;
+          controller_manager_->setJointStateCallback(
+              [csm](const sensor_msgs::msg::JointState::ConstSharedPtr& joint_state) {
+                csm->updateJointState(joint_state);
+              });
+        }
         private_executor_ = std::make_shared<rclcpp::executors::SingleThreadedExecutor>();
         private_executor_->add_node(controller_mgr_node_);
 
@@ -174,6 +297,8 @@ void TrajectoryExecutionManager::initialize()
   controller_mgr_node_->get_parameter("trajectory_execution.allowed_goal_duration_margin",
                                       allowed_goal_duration_margin_);
   controller_mgr_node_->get_parameter("trajectory_execution.allowed_start_tolerance", allowed_start_tolerance_);
+  controller_mgr_node_->get_parameter("trajectory_execution.start_state_max_age", start_state_max_age_);
+  controller_mgr_node_->get_parameter("trajectory_execution.allowed_blend_tolerance", allowed_blend_tolerance_);
 
   if (manage_controllers_)
     RCLCPP_INFO(LOGGER, "Trajectory execution is managing controllers");
@@ -196,6 +321,10 @@ void TrajectoryExecutionManager::initialize()
         setExecutionVelocityScaling(parameter.as_double());
       else if (name == "trajectory_execution.allowed_start_tolerance")
         setAllowedStartTolerance(parameter.as_double());
+      else if (name == "trajectory_execution.start_state_max_age")
+        setStartStateMaxAge(parameter.as_double());
+      else if (name == "trajectory_execution.allowed_blend_tolerance")
+        setAllowedBlendTolerance(parameter.as_double());
       else if (name == "trajectory_execution.wait_for_trajectory_completion")
         setWaitForTrajectoryCompletion(parameter.as_bool());
       else
@@ -231,6 +360,16 @@ void TrajectoryExecutionManager::setAllowedStartTolerance(double tolerance)
   allowed_start_tolerance_ = tolerance;
 }
 
+void TrajectoryExecutionManager::setStartStateMaxAge(double age)
+{
+  start_state_max_age_ = age;
+}
+
+void TrajectoryExecutionManager::setAllowedBlendTolerance(double tolerance)
+{
+  allowed_blend_tolerance_ = tolerance;
+}
+
 void TrajectoryExecutionManager::setWaitForTrajectoryCompletion(bool flag)
 {
   wait_for_trajectory_completion_ = flag;
@@ -400,9 +539,255 @@ bool TrajectoryExecutionManager::pushAndExecute(const moveit_msgs::msg::RobotTra
   }
 }
 
+bool TrajectoryExecutionManager::startStreamingExecution(const moveit_msgs::msg::RobotTrajectory& trajectory,
+                                                         const std::vector<std::string>& controllers)
+{
+  if (!execution_complete_)
+  {
+    RCLCPP_ERROR(LOGGER, "Cannot start a streaming execution while another trajectory is being executed");
+    return false;
+  }
+  if (trajectory.joint_trajectory.points.empty() && trajectory.multi_dof_joint_trajectory.points.empty())
+  {
+    RCLCPP_ERROR(LOGGER, "Cannot start a streaming execution with an empty trajectory");
+    return false;
+  }
+
+  auto context = std::make_unique<TrajectoryExecutionContext>();
+  if (!configure(*context, trajectory, controllers) || !validate(*context))
+  {
+    last_execution_status_ = moveit_controller_manager::ExecutionStatus::ABORTED;
+    return false;
+  }
+  if (!areControllersActive(context->controllers_))
+  {
+    RCLCPP_ERROR(LOGGER, "Not all needed controllers are active. Cannot start streaming execution. You can try "
+                         "calling ensureActiveControllers() before startStreamingExecution()");
+    last_execution_status_ = moveit_controller_manager::ExecutionStatus::ABORTED;
+    return false;
+  }
+
+  std::vector<moveit_controller_manager::MoveItControllerHandlePtr> handles(context->controllers_.size());
+  for (std::size_t i = 0; i < context->controllers_.size(); ++i)
+  {
+    try
+    {
+      handles[i] = controller_manager_->getControllerHandle(context->controllers_[i]);
+    }
+    catch (std::exception& ex)
+    {
+      RCLCPP_ERROR(LOGGER, "%s caught when retrieving controller handle", ex.what());
+    }
+    if (!handles[i])
+    {
+      RCLCPP_ERROR(LOGGER, "No controller handle for controller '%s'. Aborting.", context->controllers_[i].c_str());
+      last_execution_status_ = moveit_controller_manager::ExecutionStatus::ABORTED;
+      return false;
+    }
+  }
+
+  boost::mutex::scoped_lock slock(execution_state_mutex_);
+  if (!execution_complete_)
+  {
+    RCLCPP_ERROR(LOGGER, "Cannot start a streaming execution while another trajectory is being executed");
+    return false;
+  }
+
+  if (!sendTrajectoryParts(handles, context->trajectory_parts_))
+  {
+    last_execution_status_ = moveit_controller_manager::ExecutionStatus::ABORTED;
+    return false;
+  }
+
+  // only the last point of each part is needed to check the continuity of the following chunks
+  for (moveit_msgs::msg::RobotTrajectory& part : context->trajectory_parts_)
+  {
+    if (!part.joint_trajectory.points.empty())
+      part.joint_trajectory.points.erase(part.joint_trajectory.points.begin(), part.joint_trajectory.points.end() - 1);
+    if (!part.multi_dof_joint_trajectory.points.empty())
+      part.multi_dof_joint_trajectory.points.erase(part.multi_dof_joint_trajectory.points.begin(),
+                                                   part.multi_dof_joint_trajectory.points.end() - 1);
+  }
+
+  streaming_context_ = std::move(context);
+  active_handles_ = handles;
+  execution_complete_ = false;
+  last_execution_status_ = moveit_controller_manager::ExecutionStatus::RUNNING;
+  return true;
+}
+
+bool TrajectoryExecutionManager::appendToStreamingExecution(const moveit_msgs::msg::RobotTrajectory& trajectory)
+{
+  boost::mutex::scoped_lock slock(execution_state_mutex_);
+  if (!streaming_context_)
+  {
+    RCLCPP_ERROR(LOGGER, "Cannot append to a streaming execution that was not started or has already ended");
+    return false;
+  }
+
+  std::vector<moveit_msgs::msg::RobotTrajectory> parts;
+  if (!distributeTrajectory(trajectory, streaming_context_->controllers_, parts))
+    return false;
+
+  for (std::size_t i = 0; i < parts.size(); ++i)
+  {
+    const moveit_msgs::msg::RobotTrajectory& previous = streaming_context_->trajectory_parts_[i];
+    if (!checkStreamingContinuity(previous.joint_trajectory, parts[i].joint_trajectory))
+      return false;
+    if (!parts[i].multi_dof_joint_trajectory.points.empty() &&
+        (parts[i].multi_dof_joint_trajectory.joint_names != previous.multi_dof_joint_trajectory.joint_names ||
+         previous.multi_dof_joint_trajectory.points.empty() ||
+         rclcpp::Duration(parts[i].multi_dof_joint_trajectory.points.front().time_from_start) <
+             rclcpp::Duration(previous.multi_dof_joint_trajectory.points.back().time_from_start)))
+    {
+      RCLCPP_ERROR(LOGGER, "Streamed multi-dof trajectory chunk does not continue the trajectory being executed");
+      return false;
+    }
+  }
+
+  for (std::size_t i = 0; i < parts.size(); ++i)
+  {
+    if (parts[i].joint_trajectory.points.empty() && parts[i].multi_dof_joint_trajectory.points.empty())
+      continue;
+
+    bool ok = false;
+    try
+    {
+      ok = active_handles_[i]->appendTrajectory(parts[i]);
+    }
+    catch (std::exception& ex)
+    {
+      RCLCPP_ERROR(LOGGER, "Caught %s when appending trajectory to controller", ex.what());
+    }
+    if (!ok)
+    {
+      RCLCPP_ERROR(LOGGER, "Controller %s could not continue the streamed trajectory. Stopping execution.",
+                   active_handles_[i]->getName().c_str());
+      stopExecutionInternal();
+      active_handles_.clear();
+      streaming_context_.reset();
+      last_execution_status_ = moveit_controller_manager::ExecutionStatus::ABORTED;
+      execution_complete_ = true;
+      execution_complete_condition_.notify_all();
+      return false;
+    }
+
+    moveit_msgs::msg::RobotTrajectory& previous = streaming_context_->trajectory_parts_[i];
+    if (!parts[i].joint_trajectory.points.empty())
+      previous.joint_trajectory.points.assign(1, parts[i].joint_trajectory.points.back());
+    if (!parts[i].multi_dof_joint_trajectory.points.empty())
+      previous.multi_dof_joint_trajectory.points.assign(1, parts[i].multi_dof_joint_trajectory.points.back());
+  }
+  return true;
+}
+
+moveit_controller_manager::ExecutionStatus TrajectoryExecutionManager::finishStreamingExecution()
+{
+  std::vector<moveit_controller_manager::MoveItControllerHandlePtr> handles;
+  {
+    boost::mutex::scoped_lock slock(execution_state_mutex_);
+    if (!streaming_context_)
+      return last_execution_status_;
+    handles = active_handles_;  // keep a copy, stopExecution() may clear them while we wait
+  }
+
+  moveit_controller_manager::ExecutionStatus status = moveit_controller_manager::ExecutionStatus::SUCCEEDED;
+  for (const moveit_controller_manager::MoveItControllerHandlePtr& handle : handles)
+  {
+    handle->waitForExecution();
+    moveit_controller_manager::ExecutionStatus handle_status = handle->getLastExecutionStatus();
+    if (handle_status != moveit_controller_manager::ExecutionStatus::SUCCEEDED)
+    {
+      RCLCPP_WARN_STREAM(LOGGER, "Controller handle " << handle->getName() << " reports status "
+                                                      << handle_status.asString());
+      status = handle_status;
+    }
+  }
+
+  boost::mutex::scoped_lock slock(execution_state_mutex_);
+  // a concurrent stopExecution() already ended the stream and set the status
+  if (!streaming_context_)
+    return last_execution_status_;
+  streaming_context_.reset();
+  active_handles_.clear();
+  last_execution_status_ = status;
+  execution_complete_ = true;
+  execution_complete_condition_.notify_all();
+  return last_execution_status_;
+}
+
+bool TrajectoryExecutionManager::checkStreamingContinuity(const trajectory_msgs::msg::JointTrajectory& previous,
+                                                          trajectory_msgs::msg::JointTrajectory& chunk) const
+{
+  if (chunk.points.empty())
+    return true;
+  if (previous.points.empty() || chunk.joint_names != previous.joint_names)
+  {
+    RCLCPP_ERROR(LOGGER, "Streamed trajectory chunk does not actuate the same joints as the trajectory being executed");
+    return false;
+  }
+
+  const trajectory_msgs::msg::JointTrajectoryPoint& last = previous.points.back();
+  const trajectory_msgs::msg::JointTrajectoryPoint& first = chunk.points.front();
+  if (first.positions.size() != chunk.joint_names.size() || last.positions.size() != chunk.joint_names.size())
+  {
+    RCLCPP_ERROR(LOGGER, "Wrong trajectory chunk: #joints: %zu != #positions: %zu", chunk.joint_names.size(),
+                 first.positions.size());
+    return false;
+  }
+
+  const double dt =
+      rclcpp::Duration(first.time_from_start).seconds() - rclcpp::Duration(last.time_from_start).seconds();
+  const bool repeats_last_point = std::fabs(dt) <= STREAMING_CONTINUITY_TIME_TOLERANCE;
+  if (dt < 0.0 && !repeats_last_point)
+  {
+    RCLCPP_ERROR(LOGGER, "Streamed trajectory chunk starts %g s before the end of the trajectory being executed", -dt);
+    return false;
+  }
+
+  for (std::size_t i = 0; i < chunk.joint_names.size(); ++i)
+  {
+    const moveit::core::JointModel* jm = robot_model_->getJointModel(chunk.joint_names[i]);
+    const double distance = jm->distance(&last.positions[i], &first.positions[i]);
+    if (repeats_last_point)
+    {
+      // a tolerance of 0 disables the check, as in validate()
+      if (allowed_start_tolerance_ > 0 && distance > allowed_start_tolerance_)
+      {
+        RCLCPP_ERROR(LOGGER,
+                     "\nInvalid trajectory chunk: start point deviates from the last streamed point more than %g"
+                     "\njoint '%s': expected: %g, chunk: %g",
+                     allowed_start_tolerance_, chunk.joint_names[i].c_str(), last.positions[i], first.positions[i]);
+        return false;
+      }
+    }
+    else
+    {
+      const moveit::core::VariableBounds& bounds = jm->getVariableBounds()[0];
+      const double max_velocity = std::max(std::fabs(bounds.min_velocity_), std::fabs(bounds.max_velocity_));
+      if (bounds.velocity_bounded_ && distance > max_velocity * dt)
+      {
+        RCLCPP_ERROR(LOGGER,
+                     "\nInvalid trajectory chunk: joint '%s' would need to move %g in %g s to reach its start point, "
+                     "exceeding its velocity limit %g",
+                     chunk.joint_names[i].c_str(), distance, dt, max_velocity);
+        return false;
+      }
+    }
+  }
+
+  if (repeats_last_point)
+    chunk.points.erase(chunk.points.begin());
+  return true;
+}
+
 void TrajectoryExecutionManager::continuousExecutionThread()
 {
   std::set<moveit_controller_manager::MoveItControllerHandlePtr> used_handles;
+  // the trajectory sent last to a single controller, and when, for blending the next one into it
+  moveit_controller_manager::MoveItControllerHandlePtr blend_handle;
+  moveit_msgs::msg::RobotTrajectory blend_trajectory;
+  rclcpp::Time blend_start_time;
   while (run_continuous_execution_thread_)
   {
     if (!stop_continuous_execution_)
@@ -418,6 +803,7 @@ void TrajectoryExecutionManager::continuousExecutionThread()
         if (used_handle->getLastExecutionStatus() == moveit_controller_manager::ExecutionStatus::RUNNING)
           used_handle->cancelExecution();
       used_handles.clear();
+      blend_handle.reset();
       while (!continuous_execution_queue_.empty())
       {
         TrajectoryExecutionContext* context = continuous_execution_queue_.front();
@@ -488,39 +874,29 @@ void TrajectoryExecutionManager::continuousExecutionThread()
           break;
         }
 
+        // continue the trajectory still executing on the same controller without stopping in between
+        const rclcpp::Time now = node_->now();
+        if (allowed_blend_tolerance_ > 0.0 && handles.size() == 1 && handles[0] == blend_handle &&
+            blend_handle->getLastExecutionStatus() == moveit_controller_manager::ExecutionStatus::RUNNING &&
+            blendTrajectories(robot_model_, blend_trajectory, (now - blend_start_time).seconds(),
+                              allowed_blend_tolerance_, context->trajectory_parts_[0]))
+          RCLCPP_DEBUG(LOGGER, "Blended trajectory into the one executing on controller '%s'",
+                       blend_handle->getName().c_str());
+
         // push all trajectories to all controllers simultaneously
-        if (!handles.empty())
-          for (std::size_t i = 0; i < context->trajectory_parts_.size(); ++i)
-          {
-            bool ok = false;
-            try
-            {
-              ok = handles[i]->sendTrajectory(context->trajectory_parts_[i]);
-            }
-            catch (std::exception& ex)
-            {
-              RCLCPP_ERROR(LOGGER, "Caught %s when sending trajectory to controller", ex.what());
-            }
-            if (!ok)
-            {
-              for (std::size_t j = 0; j < i; ++j)
-                try
-                {
-                  handles[j]->cancelExecution();
-                }
-                catch (std::exception& ex)
-                {
-                  RCLCPP_ERROR(LOGGER, "Caught %s when canceling execution", ex.what());
-                }
-              RCLCPP_ERROR(LOGGER, "Failed to send trajectory part %zu of %zu to controller %s", i + 1,
-                           context->trajectory_parts_.size(), handles[i]->getName().c_str());
-              if (i > 0)
-                RCLCPP_ERROR(LOGGER, "Cancelling previously sent trajectory parts");
-              last_execution_status_ = moveit_controller_manager::ExecutionStatus::ABORTED;
-              handles.clear();
-              break;
-            }
-          }
+        if (!handles.empty() && !sendTrajectoryParts(handles, context->trajectory_parts_))
+        {
+          last_execution_status_ = moveit_controller_manager::ExecutionStatus::ABORTED;
+          handles.clear();
+        }
+        if (handles.size() == 1)
+        {
+          blend_handle = handles[0];
+          blend_trajectory = context->trajectory_parts_[0];
+          blend_start_time = now;
+        }
+        else
+          blend_handle.reset();
         delete context;
 
         // remember which handles we used
@@ -966,7 +1342,29 @@ bool TrajectoryExecutionManager::validate(const TrajectoryExecutionContext& cont
   RCLCPP_INFO(LOGGER, "Validating trajectory with allowed_start_tolerance %g", allowed_start_tolerance_);
 
   moveit::core::RobotStatePtr current_state;
-  if (!csm_->waitForCurrentState(node_->now()) || !(current_state = csm_->getCurrentState()))
+  const rclcpp::Time now = node_->now();
+  if (start_state_max_age_ > 0.0)
+  {
+    // avoid waiting for the next joint state update if the latest one is recent enough;
+    // extrapolate it to the current time with the reported joint velocities instead
+    std::pair<moveit::core::RobotStatePtr, rclcpp::Time> state_and_time = csm_->getCurrentStateAndTime();
+    const double age = (now - state_and_time.second).seconds();
+    if (state_and_time.first && age >= 0.0 && age <= start_state_max_age_ && csm_->haveCompleteState())
+    {
+      current_state = state_and_time.first;
+      if (current_state->hasVelocities() && age > 0.0)
+        for (const moveit::core::JointModel* jm : robot_model_->getActiveJointModels())
+          if (jm->getVariableCount() == 1)
+          {
+            const int index = jm->getFirstVariableIndex();
+            current_state->setVariablePosition(index, current_state->getVariablePosition(index) +
+                                                          current_state->getVariableVelocity(index) * age);
+          }
+      RCLCPP_DEBUG(LOGGER, "Validating against the latest robot state, received %g s ago", age);
+    }
+  }
+
+  if (!current_state && (!csm_->waitForCurrentState(now) || !(current_state = csm_->getCurrentState())))
   {
     RCLCPP_WARN(LOGGER, "Failed to validate trajectory: couldn't receive full current joint state within 1s");
     return false;
@@ -1194,6 +1592,7 @@ void TrajectoryExecutionManager::stopExecution(bool auto_clear)
       // trigger to stop has been received
       execution_complete_ = true;
       stopExecutionInternal();
+      streaming_context_.reset();
 
       // we set the status here; executePart() will not set status when execution_complete_ is true ahead of time
       last_execution_status_ = moveit_controller_manager::ExecutionStatus::PREEMPTED;
@@ -1292,6 +1691,48 @@ void TrajectoryExecutionManager::clear()
     RCLCPP_ERROR(LOGGER, "Cannot push a new trajectory while another is being executed");
 }
 
+bool TrajectoryExecutionManager::sendTrajectoryParts(
+    const std::vector<moveit_controller_manager::MoveItControllerHandlePtr>& handles,
+    const std::vector<moveit_msgs::msg::RobotTrajectory>& parts)
+{
+  const std::vector<bool> sent = forEachConcurrently(parts.size(), [&handles, &parts](std::size_t i) {
+    try
+    {
+      return handles[i]->sendTrajectory(parts[i]);
+    }
+    catch (std::exception& ex)
+    {
+      RCLCPP_ERROR(LOGGER, "Caught %s when sending trajectory to controller", ex.what());
+    }
+    return false;
+  });
+
+  bool cancel = false;
+  for (std::size_t i = 0; i < sent.size(); ++i)
+    if (!sent[i])
+    {
+      RCLCPP_ERROR(LOGGER, "Failed to send trajectory part %zu of %zu to controller %s", i + 1, parts.size(),
+                   handles[i]->getName().c_str());
+      cancel = true;
+    }
+  if (!cancel)
+    return true;
+
+  if (parts.size() > 1)
+    RCLCPP_ERROR(LOGGER, "Cancelling the trajectory parts sent to other controllers");
+  for (std::size_t i = 0; i < sent.size(); ++i)
+    if (sent[i])
+      try
+      {
+        handles[i]->cancelExecution();
+      }
+      catch (std::exception& ex)
+      {
+        RCLCPP_ERROR(LOGGER, "Caught %s when canceling execution", ex.what());
+      }
+  return false;
+}
+
 void TrajectoryExecutionManager::executeThread(const ExecutionCompleteCallback& callback,
                                                const PathSegmentCompleteCallback& part_callback, bool auto_clear)
 {
@@ -1346,6 +1787,8 @@ void TrajectoryExecutionManager::executeThread(const ExecutionCompleteCallback&
 
 bool TrajectoryExecutionManager::executePart(std::size_t part_index)
 {
+  MOVEIT_TRACE_SCOPE("TrajectoryExecutionManager::executePart");
+
   TrajectoryExecutionContext& context = *trajectories_[part_index];
 
   // first make sure desired controllers are active
@@ -1387,37 +1830,12 @@ bool TrajectoryExecutionManager::executePart(std::size_t part_index)
           active_handles_[i] = h;
         }
         handles = active_handles_;  // keep a copy for later, to avoid thread safety issues
-        for (std::size_t i = 0; i < context.trajectory_parts_.size(); ++i)
+        if (!sendTrajectoryParts(handles, context.trajectory_parts_))
         {
-          bool ok = false;
-          try
-          {
-            ok = active_handles_[i]->sendTrajectory(context.trajectory_parts_[i]);
-          }
-          catch (std::exception& ex)
-          {
-            RCLCPP_ERROR(LOGGER, "Caught %s when sending trajectory to controller", ex.what());
-          }
-          if (!ok)
-          {
-            for (std::size_t j = 0; j < i; ++j)
-              try
-              {
-                active_handles_[j]->cancelExecution();
-              }
-              catch (std::exception& ex)
-              {
-                RCLCPP_ERROR(LOGGER, "Caught %s when canceling execution", ex.what());
-              }
-            RCLCPP_ERROR(LOGGER, "Failed to send trajectory part %zu of %zu to controller %s", i + 1,
-                         context.trajectory_parts_.size(), active_handles_[i]->getName().c_str());
-            if (i > 0)
-              RCLCPP_ERROR(LOGGER, "Cancelling previously sent trajectory parts");
-            active_handles_.clear();
-            current_context_ = -1;
-            last_execution_status_ = moveit_controller_manager::ExecutionStatus::ABORTED;
-            return false;
-          }
+          active_handles_.clear();
+          current_context_ = -1;
+          last_execution_status_ = moveit_controller_manager::ExecutionStatus::ABORTED;
+          return false;
         }
       }
     }
@@ -1501,12 +1919,19 @@ bool TrajectoryExecutionManager::executePart(std::size_t part_index)
       }
     }
 
+    // wait for all controllers at once, so each of them is held to the same deadline and no waiting is serialized
+    const rclcpp::Duration timeout =
+        execution_duration_monitoring_ ? expected_trajectory_duration : rclcpp::Duration(0.0);
+    const std::vector<bool> completed = forEachConcurrently(
+        handles.size(), [&handles, &timeout](std::size_t i) { return handles[i]->waitForExecution(timeout); });
+
     bool result = true;
-    for (moveit_controller_manager::MoveItControllerHandlePtr& handle : handles)
+    for (std::size_t i = 0; i < handles.size(); ++i)
     {
+      const moveit_controller_manager::MoveItControllerHandlePtr& handle = handles[i];
       if (execution_duration_monitoring_)
       {
-        if (!handle->waitForExecution(expected_trajectory_duration))
+        if (!completed[i])
           if (!execution_complete_ && node_->now() - current_time > expected_trajectory_duration)
           {
             RCLCPP_ERROR(LOGGER,
@@ -1523,8 +1948,6 @@ bool TrajectoryExecutionManager::executePart(std::size_t part_index)
             break;
           }
       }
-      else
-        handle->waitForExecution();
 
       // if something made the trajectory stop, we stop this thread too
       if (execution_complete_)
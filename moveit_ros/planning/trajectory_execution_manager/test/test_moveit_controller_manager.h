@@ -55,6 +55,11 @@ public:
     return true;
   }
 
+  bool appendTrajectory(const moveit_msgs::msg::RobotTrajectory& /*trajectory*/) override
+  {
+    return true;
+  }
+
   bool cancelExecution() override
   {
     return true;
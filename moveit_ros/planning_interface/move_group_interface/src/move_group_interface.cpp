@@ -39,6 +39,8 @@
 #include <stdexcept>
 #include <sstream>
 #include <memory>
+#include <chrono>
+#include <future>
 // TODO(JafarAbdi): Enable once moveit_ros_warehouse is ported
 // #include <moveit/warehouse/constraints_storage.h>
 #include <moveit/kinematic_constraints/utils.h>
@@ -686,6 +688,7 @@ public:
       return MoveItErrorCode(moveit_msgs::msg::MoveItErrorCodes::FAILURE);
     }
 
+    const auto start_time = std::chrono::steady_clock::now();
     moveit_msgs::action::MoveGroup::Goal goal;
     constructGoal(goal);
     goal.planning_options.plan_only = true;
@@ -694,7 +697,9 @@ public:
     goal.planning_options.planning_scene_diff.is_diff = true;
     goal.planning_options.planning_scene_diff.robot_state.is_diff = true;
 
-    bool done = false;
+    // fulfilled by the action client callbacks, so the wait below ends as soon as the result arrives
+    std::promise<void> done;
+    std::shared_future<void> done_future = done.get_future().share();
     rclcpp_action::ResultCode code = rclcpp_action::ResultCode::UNKNOWN;
     std::shared_ptr<moveit_msgs::action::MoveGroup::Result> res;
     auto send_goal_opts = rclcpp_action::Client<moveit_msgs::action::MoveGroup>::SendGoalOptions();
@@ -704,7 +709,7 @@ public:
           const auto& goal_handle = future.get();
           if (!goal_handle)
           {
-            done = true;
+            done.set_value();
             RCLCPP_INFO(LOGGER, "Planning request rejected");
           }
           else
@@ -714,7 +719,7 @@ public:
         [&](const rclcpp_action::ClientGoalHandle<moveit_msgs::action::MoveGroup>::WrappedResult& result) {
           res = result.result;
           code = result.code;
-          done = true;
+          done.set_value();
 
           switch (result.code)
           {
@@ -735,12 +740,8 @@ public:
 
     auto goal_handle_future = move_action_client_->async_send_goal(goal, send_goal_opts);
 
-    // wait until send_goal_opts.result_callback is called
-    while (!done)
-    {
-      rclcpp::spin_some(pnode_);
-      std::this_thread::sleep_for(std::chrono::milliseconds(100));
-    }
+    // spin until send_goal_opts.result_callback is called
+    rclcpp::spin_until_future_complete(pnode_, done_future);
 
     if (code != rclcpp_action::ResultCode::SUCCEEDED)
     {
@@ -752,6 +753,9 @@ public:
     plan.start_state_ = res->trajectory_start;
     plan.planning_time_ = res->planning_time;
     RCLCPP_INFO(LOGGER, "time taken to generate plan: %g seconds", plan.planning_time_);
+    // the difference to the planning time is the overhead of the request and the action round trip
+    RCLCPP_DEBUG(LOGGER, "time taken to receive the plan: %g seconds",
+                 std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count());
 
     return res->error_code;
   }
@@ -773,7 +777,9 @@ public:
     goal.planning_options.planning_scene_diff.is_diff = true;
     goal.planning_options.planning_scene_diff.robot_state.is_diff = true;
 
-    bool done = false;
+    // fulfilled by the action client callbacks, so the wait below ends as soon as the result arrives
+    std::promise<void> done;
+    std::shared_future<void> done_future = done.get_future().share();
     rclcpp_action::ResultCode code = rclcpp_action::ResultCode::UNKNOWN;
     std::shared_ptr<moveit_msgs::action::MoveGroup_Result> res;
     auto send_goal_opts = rclcpp_action::Client<moveit_msgs::action::MoveGroup>::SendGoalOptions();
@@ -783,7 +789,7 @@ public:
           const auto& goal_handle = future.get();
           if (!goal_handle)
           {
-            done = true;
+            done.set_value();
             RCLCPP_INFO(LOGGER, "Plan and Execute request rejected");
           }
           else
@@ -793,7 +799,7 @@ public:
         [&](const rclcpp_action::ClientGoalHandle<moveit_msgs::action::MoveGroup>::WrappedResult& result) {
           res = result.result;
           code = result.code;
-          done = true;
+          done.set_value();
 
           switch (result.code)
           {
@@ -815,12 +821,8 @@ public:
     if (!wait)
       return MoveItErrorCode::SUCCESS;
 
-    // wait until send_goal_opts.result_callback is called
-    while (!done)
-    {
-      rclcpp::spin_some(pnode_);
-      std::this_thread::sleep_for(std::chrono::milliseconds(100));
-    }
+    // spin until send_goal_opts.result_callback is called
+    rclcpp::spin_until_future_complete(pnode_, done_future);
 
     if (code != rclcpp_action::ResultCode::SUCCEEDED)
     {
@@ -838,7 +840,9 @@ public:
       return MoveItErrorCode(moveit_msgs::msg::MoveItErrorCodes::FAILURE);
     }
 
-    bool done = false;
+    // fulfilled by the action client callbacks, so the wait below ends as soon as the result arrives
+    std::promise<void> done;
+    std::shared_future<void> done_future = done.get_future().share();
     rclcpp_action::ResultCode code = rclcpp_action::ResultCode::UNKNOWN;
     std::shared_ptr<moveit_msgs::action::ExecuteTrajectory_Result> res;
     auto send_goal_opts = rclcpp_action::Client<moveit_msgs::action::ExecuteTrajectory>::SendGoalOptions();
@@ -849,7 +853,7 @@ public:
           const auto& goal_handle = future.get();
           if (!goal_handle)
           {
-            done = true;
+            done.set_value();
             RCLCPP_INFO(LOGGER, "Execute request rejected");
           }
           else
@@ -859,7 +863,7 @@ public:
         [&](const rclcpp_action::ClientGoalHandle<moveit_msgs::action::ExecuteTrajectory>::WrappedResult& result) {
           res = result.result;
           code = result.code;
-          done = true;
+          done.set_value();
 
           switch (result.code)
           {
@@ -885,12 +889,8 @@ public:
     if (!wait)
       return MoveItErrorCode::SUCCESS;
 
-    // wait until send_goal_opts.result_callback is called
-    while (!done)
-    {
-      rclcpp::spin_some(pnode_);
-      std::this_thread::sleep_for(std::chrono::milliseconds(100));
-    }
+    // spin until send_goal_opts.result_callback is called
+    rclcpp::spin_until_future_complete(pnode_, done_future);
 
     if (code != rclcpp_action::ResultCode::SUCCEEDED)
     {
@@ -45,6 +45,7 @@
 #include <moveit/robot_state/robot_state.h>
 #include <tf2_ros/buffer.h>
 #include <tf2_ros/transform_listener.h>
+#include <future>
 
 namespace moveit
 {
@@ -72,6 +73,7 @@ public:
       node->get_parameter_or(ns + ".publish_planning_scene_topic", publish_planning_scene_topic,
                              planning_scene_monitor::PlanningSceneMonitor::DEFAULT_PLANNING_SCENE_TOPIC);
       node->get_parameter_or(ns + ".wait_for_initial_state_timeout", wait_for_initial_state_timeout, 0.0);
+      node->get_parameter_or(ns + ".share_in_process", share_in_process, false);
     }
     std::string name;
     std::string robot_description;
@@ -80,6 +82,8 @@ public:
     std::string monitored_planning_scene_topic;
     std::string publish_planning_scene_topic;
     double wait_for_initial_state_timeout;
+    /// use the monitor shared for the robot description in this process, or share the created one
+    bool share_in_process = false;
   };
 
   /// struct contains the the variables used for loading the planning pipeline
@@ -163,6 +167,17 @@ public:
   bool execute(const std::string& group_name, const robot_trajectory::RobotTrajectoryPtr& robot_trajectory,
                bool blocking = true);
 
+  /** \brief Start the execution of a trajectory on the planning group specified by group_name and return immediately.
+   * The returned future is ready, and the optional callback is called, with the status of the execution when it
+   * completes. Starting another execution preempts this one. */
+  std::shared_future<moveit_controller_manager::ExecutionStatus>
+  executeAsync(const std::string& group_name, const robot_trajectory::RobotTrajectoryPtr& robot_trajectory,
+               const trajectory_execution_manager::TrajectoryExecutionManager::ExecutionCompleteCallback& callback =
+                   trajectory_execution_manager::TrajectoryExecutionManager::ExecutionCompleteCallback());
+
+  /** \brief Stop the active execution, if any */
+  void stopExecution();
+
 private:
   //  Core properties and instances
   rclcpp::Node::SharedPtr node_;
@@ -42,6 +42,10 @@
 #include <geometry_msgs/msg/pose_stamped.h>
 #include <moveit/robot_state/conversions.h>
 #include <moveit_msgs/msg/move_it_error_codes.h>
+#include <atomic>
+#include <functional>
+#include <future>
+#include <mutex>
 
 namespace moveit
 {
@@ -123,6 +127,9 @@ public:
     }
   };
 
+  /// The function called with the solution of planAsync(), from the planning thread or right away for invalid requests
+  using PlanSolutionCallback = std::function<void(const PlanSolution&)>;
+
   /** \brief Constructor */
   PlanningComponent(const std::string& group_name, const rclcpp::Node::SharedPtr& node);
   PlanningComponent(const std::string& group_name, const MoveItCppPtr& moveit_cpp);
@@ -186,14 +193,60 @@ public:
    * provided PlanRequestParameters. */
   PlanSolution plan(const PlanRequestParameters& parameters);
 
+  /** \brief Start planning from start or current state to fulfill the last goal constraints provided by setGoal() in
+   * the background and return immediately. The request is built from the start state, goal constraints and planning
+   * scene at the time of the call, so the component can be reconfigured for the next request right away and several
+   * requests can be in flight at the same time. The returned future is ready, and the optional callback is called,
+   * with the solution when planning finishes. Unlike plan(), this does not change the last plan solution. */
+  std::shared_future<PlanSolution> planAsync(const PlanSolutionCallback& callback = PlanSolutionCallback());
+  /** \brief Start planning in the background like planAsync() using the provided PlanRequestParameters. */
+  std::shared_future<PlanSolution> planAsync(const PlanRequestParameters& parameters,
+                                             const PlanSolutionCallback& callback = PlanSolutionCallback());
+
+  /** \brief Cancel all requests of planAsync() that are still being planned. Requests that did not start yet fail
+   * with PREEMPTED, running ones are stopped by terminating their planning pipeline, which also stops other requests
+   * that are planned with the same pipeline at the time. */
+  void cancelAsyncPlans();
+
   /** \brief Execute the latest computed solution trajectory computed by plan(). By default this function terminates
    * after the execution is complete. The execution can be run in background by setting blocking to false. */
   bool execute(bool blocking = true);
 
+  /** \brief Start the execution of a plan solution, e.g. one computed by planAsync(), and return immediately. The
+   * returned future is ready, and the optional callback is called, with the status of the execution when it
+   * completes. Starting another execution preempts this one. */
+  std::shared_future<moveit_controller_manager::ExecutionStatus>
+  executeAsync(const PlanSolution& solution,
+               const trajectory_execution_manager::TrajectoryExecutionManager::ExecutionCompleteCallback& callback =
+                   trajectory_execution_manager::TrajectoryExecutionManager::ExecutionCompleteCallback());
+
   /** \brief Return the last plan solution*/
   const PlanSolutionPtr getLastPlanSolution();
 
 private:
+  /// A motion plan request together with the planning scene and the pipeline it is planned with
+  struct PlanRequest
+  {
+    planning_scene::PlanningScenePtr planning_scene;
+    planning_pipeline::PlanningPipelinePtr pipeline;
+    ::planning_interface::MotionPlanRequest req;
+  };
+
+  /// A request of planAsync() that is planned in the background
+  struct AsyncPlan
+  {
+    planning_pipeline::PlanningPipelinePtr pipeline;
+    std::atomic<bool> cancelled{ false };
+    std::future<void> thread;
+  };
+
+  /// The requests of planAsync(), kept separately so that the component can be moved
+  struct AsyncPlans
+  {
+    std::mutex mutex;
+    std::vector<std::shared_ptr<AsyncPlan>> plans;
+  };
+
   // Core properties and instances
   rclcpp::Node::SharedPtr node_;
   MoveItCppPtr moveit_cpp_;
@@ -210,6 +263,7 @@ private:
   moveit_msgs::msg::WorkspaceParameters workspace_parameters_;
   bool workspace_parameters_set_ = false;
   PlanSolutionPtr last_plan_solution_;
+  std::unique_ptr<AsyncPlans> async_plans_ = std::make_unique<AsyncPlans>();
 
   // common properties for goals
   // TODO(henningkayser): support goal tolerances
@@ -220,6 +274,12 @@ private:
   // std::unique_ptr<moveit_msgs::msg::Constraints> path_constraints_;
   // std::unique_ptr<moveit_msgs::msg::TrajectoryConstraints> trajectory_constraints_;
 
+  /** \brief Build the request for the current start state, goal constraints and planning scene */
+  MoveItErrorCode createPlanRequest(const PlanRequestParameters& parameters, PlanRequest& request);
+
+  /** \brief Plan a request created by createPlanRequest() */
+  static PlanSolution solvePlanRequest(const PlanRequest& request);
+
   /** \brief Reset all member variables */
   void clearContents();
 };
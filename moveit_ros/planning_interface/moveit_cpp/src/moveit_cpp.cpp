@@ -102,6 +102,17 @@ MoveItCpp::~MoveItCpp()
 
 bool MoveItCpp::loadPlanningSceneMonitor(const PlanningSceneMonitorOptions& options)
 {
+  if (options.share_in_process)
+  {
+    planning_scene_monitor_ = planning_scene_monitor::PlanningSceneMonitor::getSharedMonitor(options.robot_description);
+    if (planning_scene_monitor_)
+    {
+      RCLCPP_INFO(LOGGER, "Using the planning scene monitor '%s' shared in this process",
+                  planning_scene_monitor_->getName().c_str());
+      return true;
+    }
+  }
+
   planning_scene_monitor_.reset(
       new planning_scene_monitor::PlanningSceneMonitor(node_, options.robot_description, tf_buffer_, options.name));
   // Allows us to sycronize to Rviz and also publish collision objects to ourselves
@@ -114,6 +125,8 @@ bool MoveItCpp::loadPlanningSceneMonitor(const PlanningSceneMonitorOptions& opti
     planning_scene_monitor_->startPublishingPlanningScene(planning_scene_monitor::PlanningSceneMonitor::UPDATE_SCENE,
                                                           options.publish_planning_scene_topic);
     planning_scene_monitor_->startSceneMonitor(options.monitored_planning_scene_topic);
+    if (options.share_in_process)
+      planning_scene_monitor::PlanningSceneMonitor::shareMonitor(planning_scene_monitor_);
   }
   else
   {
@@ -296,6 +309,52 @@ bool MoveItCpp::execute(const std::string& group_name, const robot_trajectory::R
   return true;
 }
 
+std::shared_future<moveit_controller_manager::ExecutionStatus> MoveItCpp::executeAsync(
+    const std::string& group_name, const robot_trajectory::RobotTrajectoryPtr& robot_trajectory,
+    const trajectory_execution_manager::TrajectoryExecutionManager::ExecutionCompleteCallback& callback)
+{
+  auto status = std::make_shared<std::promise<moveit_controller_manager::ExecutionStatus>>();
+  std::shared_future<moveit_controller_manager::ExecutionStatus> future = status->get_future().share();
+  auto complete = [status, callback](const moveit_controller_manager::ExecutionStatus& execution_status) {
+    if (callback)
+      callback(execution_status);
+    status->set_value(execution_status);
+  };
+
+  if (!robot_trajectory)
+  {
+    RCLCPP_ERROR(LOGGER, "Robot trajectory is undefined");
+    complete(moveit_controller_manager::ExecutionStatus::FAILED);
+    return future;
+  }
+
+  // Check if there are controllers that can handle the execution
+  if (!trajectory_execution_manager_->ensureActiveControllersForGroup(group_name))
+  {
+    RCLCPP_ERROR(LOGGER, "Execution failed! No active controllers configured for group '%s'", group_name.c_str());
+    complete(moveit_controller_manager::ExecutionStatus::FAILED);
+    return future;
+  }
+
+  // Execute trajectory, trajectories can only be pushed while no other execution is active
+  moveit_msgs::msg::RobotTrajectory robot_trajectory_msg;
+  robot_trajectory->getRobotTrajectoryMsg(robot_trajectory_msg);
+  trajectory_execution_manager_->stopExecution(true);
+  if (!trajectory_execution_manager_->push(robot_trajectory_msg))
+  {
+    RCLCPP_ERROR(LOGGER, "Execution failed! The trajectory could not be assigned to controllers");
+    complete(moveit_controller_manager::ExecutionStatus::FAILED);
+    return future;
+  }
+  trajectory_execution_manager_->execute(complete);
+  return future;
+}
+
+void MoveItCpp::stopExecution()
+{
+  trajectory_execution_manager_->stopExecution(true);
+}
+
 const std::shared_ptr<tf2_ros::Buffer>& MoveItCpp::getTFBuffer() const
 {
   return tf_buffer_;
@@ -34,6 +34,7 @@
 
 /* Author: Henning Kayser */
 
+#include <algorithm>
 #include <stdexcept>
 #include <sstream>
 #include <memory>
@@ -89,6 +90,12 @@ PlanningComponent::PlanningComponent(const std::string& group_name, const rclcpp
 PlanningComponent::~PlanningComponent()
 {
   RCLCPP_INFO(LOGGER, "Deleting PlanningComponent '%s'", group_name_.c_str());
+  if (async_plans_)
+  {
+    cancelAsyncPlans();
+    for (const std::shared_ptr<AsyncPlan>& plan : async_plans_->plans)
+      plan->thread.wait();
+  }
   clearContents();
 }
 
@@ -112,28 +119,26 @@ const std::string& PlanningComponent::getPlanningGroupName() const
   return group_name_;
 }
 
-PlanningComponent::PlanSolution PlanningComponent::plan(const PlanRequestParameters& parameters)
+PlanningComponent::MoveItErrorCode PlanningComponent::createPlanRequest(const PlanRequestParameters& parameters,
+                                                                        PlanRequest& request)
 {
-  last_plan_solution_.reset(new PlanSolution());
   if (!joint_model_group_)
   {
     RCLCPP_ERROR(LOGGER, "Failed to retrieve joint model group for name '%s'.", group_name_.c_str());
-    last_plan_solution_->error_code = MoveItErrorCode(moveit_msgs::msg::MoveItErrorCodes::INVALID_GROUP_NAME);
-    return *last_plan_solution_;
+    return MoveItErrorCode(moveit_msgs::msg::MoveItErrorCodes::INVALID_GROUP_NAME);
   }
 
   // Clone current planning scene
   planning_scene_monitor::PlanningSceneMonitorPtr planning_scene_monitor =
       moveit_cpp_->getPlanningSceneMonitorNonConst();
   planning_scene_monitor->updateFrameTransforms();
-  planning_scene_monitor->lockSceneRead();  // LOCK planning scene
-  planning_scene::PlanningScenePtr planning_scene =
-      planning_scene::PlanningScene::clone(planning_scene_monitor->getPlanningScene());
+  planning_scene_monitor->lockSceneRead("PlanningComponent::plan");  // LOCK planning scene
+  request.planning_scene = planning_scene::PlanningScene::clone(planning_scene_monitor->getPlanningScene());
   planning_scene_monitor->unlockSceneRead();  // UNLOCK planning scene
   planning_scene_monitor.reset();             // release this pointer
 
   // Init MotionPlanRequest
-  ::planning_interface::MotionPlanRequest req;
+  ::planning_interface::MotionPlanRequest& req = request.req;
   req.group_name = group_name_;
   req.planner_id = parameters.planner_id;
   req.num_planning_attempts = std::max(1, parameters.planning_attempts);
@@ -149,36 +154,40 @@ PlanningComponent::PlanSolution PlanningComponent::plan(const PlanRequestParamet
     start_state = moveit_cpp_->getCurrentState();
   start_state->update();
   moveit::core::robotStateToRobotStateMsg(*start_state, req.start_state);
-  planning_scene->setCurrentState(*start_state);
+  request.planning_scene->setCurrentState(*start_state);
 
   // Set goal constraints
   if (current_goal_constraints_.empty())
   {
     RCLCPP_ERROR(LOGGER, "No goal constraints set for planning request");
-    last_plan_solution_->error_code = MoveItErrorCode(moveit_msgs::msg::MoveItErrorCodes::INVALID_GOAL_CONSTRAINTS);
-    return *last_plan_solution_;
+    return MoveItErrorCode(moveit_msgs::msg::MoveItErrorCodes::INVALID_GOAL_CONSTRAINTS);
   }
   req.goal_constraints = current_goal_constraints_;
 
-  // Run planning attempt
-  ::planning_interface::MotionPlanResponse res;
+  // Select planning pipeline
   if (planning_pipeline_names_.find(parameters.planning_pipeline) == planning_pipeline_names_.end())
   {
     RCLCPP_ERROR(LOGGER, "No planning pipeline available for name '%s'", parameters.planning_pipeline.c_str());
-    last_plan_solution_->error_code = MoveItErrorCode(moveit_msgs::msg::MoveItErrorCodes::FAILURE);
-    return *last_plan_solution_;
+    return MoveItErrorCode(moveit_msgs::msg::MoveItErrorCodes::FAILURE);
   }
-  const planning_pipeline::PlanningPipelinePtr pipeline =
-      moveit_cpp_->getPlanningPipelines().at(parameters.planning_pipeline);
-  pipeline->generatePlan(planning_scene, req, res);
-  last_plan_solution_->error_code = res.error_code_.val;
+  request.pipeline = moveit_cpp_->getPlanningPipelines().at(parameters.planning_pipeline);
+  return MoveItErrorCode(moveit_msgs::msg::MoveItErrorCodes::SUCCESS);
+}
+
+PlanningComponent::PlanSolution PlanningComponent::solvePlanRequest(const PlanRequest& request)
+{
+  // Run planning attempt
+  PlanSolution solution;
+  ::planning_interface::MotionPlanResponse res;
+  request.pipeline->generatePlan(request.planning_scene, request.req, res);
+  solution.error_code = res.error_code_.val;
   if (res.error_code_.val != res.error_code_.SUCCESS)
   {
     RCLCPP_ERROR(LOGGER, "Could not compute plan successfully");
-    return *last_plan_solution_;
+    return solution;
   }
-  last_plan_solution_->start_state = req.start_state;
-  last_plan_solution_->trajectory = res.trajectory_;
+  solution.start_state = request.req.start_state;
+  solution.trajectory = res.trajectory_;
   // TODO(henningkayser): Visualize trajectory
   // std::vector<const moveit::core::LinkModel*> eef_links;
   // if (joint_model_group->getEndEffectorTips(eef_links))
@@ -191,6 +200,16 @@ PlanningComponent::PlanSolution PlanningComponent::plan(const PlanRequestParamet
   //    visual_tools_->publishRobotState(last_solution_trajectory_->getLastWayPoint(), rviz_visual_tools::TRANSLUCENT);
   //  }
   //}
+  return solution;
+}
+
+PlanningComponent::PlanSolution PlanningComponent::plan(const PlanRequestParameters& parameters)
+{
+  last_plan_solution_.reset(new PlanSolution());
+  PlanRequest request;
+  last_plan_solution_->error_code = createPlanRequest(parameters, request);
+  if (last_plan_solution_->error_code)
+    *last_plan_solution_ = solvePlanRequest(request);
   return *last_plan_solution_;
 }
 
@@ -199,6 +218,83 @@ PlanningComponent::PlanSolution PlanningComponent::plan()
   return plan(plan_request_parameters_);
 }
 
+std::shared_future<PlanningComponent::PlanSolution>
+PlanningComponent::planAsync(const PlanRequestParameters& parameters, const PlanSolutionCallback& callback)
+{
+  auto solution = std::make_shared<std::promise<PlanSolution>>();
+  std::shared_future<PlanSolution> future = solution->get_future().share();
+  auto finish = [solution, callback](const PlanSolution& result) {
+    if (callback)
+      callback(result);
+    solution->set_value(result);
+  };
+
+  auto request = std::make_shared<PlanRequest>();
+  MoveItErrorCode error_code = createPlanRequest(parameters, *request);
+  if (!error_code)
+  {
+    PlanSolution result;
+    result.error_code = error_code;
+    finish(result);
+    return future;
+  }
+
+  std::lock_guard<std::mutex> lock(async_plans_->mutex);
+  // forget the requests that finished planning
+  std::vector<std::shared_ptr<AsyncPlan>>& plans = async_plans_->plans;
+  plans.erase(std::remove_if(plans.begin(), plans.end(),
+                             [](const std::shared_ptr<AsyncPlan>& plan) {
+                               return plan->thread.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+                             }),
+              plans.end());
+
+  auto async_plan = std::make_shared<AsyncPlan>();
+  async_plan->pipeline = request->pipeline;
+  async_plan->thread = std::async(std::launch::async, [async_plan, request, finish] {
+    PlanSolution result;
+    if (async_plan->cancelled)
+      result.error_code = MoveItErrorCode(moveit_msgs::msg::MoveItErrorCodes::PREEMPTED);
+    else
+    {
+      try
+      {
+        result = solvePlanRequest(*request);
+      }
+      catch (std::exception& ex)
+      {
+        RCLCPP_ERROR(LOGGER, "Exception caught while planning: '%s'", ex.what());
+        result.error_code = MoveItErrorCode(moveit_msgs::msg::MoveItErrorCodes::FAILURE);
+      }
+      if (!result && async_plan->cancelled)
+        result.error_code = MoveItErrorCode(moveit_msgs::msg::MoveItErrorCodes::PREEMPTED);
+    }
+    finish(result);
+  });
+  plans.push_back(async_plan);
+  return future;
+}
+
+std::shared_future<PlanningComponent::PlanSolution> PlanningComponent::planAsync(const PlanSolutionCallback& callback)
+{
+  return planAsync(plan_request_parameters_, callback);
+}
+
+void PlanningComponent::cancelAsyncPlans()
+{
+  std::set<planning_pipeline::PlanningPipelinePtr> running_pipelines;
+  {
+    std::lock_guard<std::mutex> lock(async_plans_->mutex);
+    for (const std::shared_ptr<AsyncPlan>& plan : async_plans_->plans)
+      if (plan->thread.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+      {
+        plan->cancelled = true;
+        running_pipelines.insert(plan->pipeline);
+      }
+  }
+  for (const planning_pipeline::PlanningPipelinePtr& pipeline : running_pipelines)
+    pipeline->terminate();
+}
+
 bool PlanningComponent::setStartState(const moveit::core::RobotState& start_state)
 {
   considered_start_state_.reset(new moveit::core::RobotState(start_state));
@@ -311,6 +407,13 @@ bool PlanningComponent::execute(bool blocking)
   return moveit_cpp_->execute(group_name_, last_plan_solution_->trajectory, blocking);
 }
 
+std::shared_future<moveit_controller_manager::ExecutionStatus> PlanningComponent::executeAsync(
+    const PlanSolution& solution,
+    const trajectory_execution_manager::TrajectoryExecutionManager::ExecutionCompleteCallback& callback)
+{
+  return moveit_cpp_->executeAsync(group_name_, solution.trajectory, callback);
+}
+
 const PlanningComponent::PlanSolutionPtr PlanningComponent::getLastPlanSolution()
 {
   return last_plan_solution_;
@@ -52,6 +52,60 @@ MOVEIT_CLASS_FORWARD(PlanningSceneInterface)  // Defines PlanningSceneInterfaceP
 class PlanningSceneInterface
 {
 public:
+  /** \brief Fields of the collision objects returned by getObjects(). The id is always filled in. */
+  enum ObjectFields : uint8_t
+  {
+    OBJECT_TYPE = 1,         /**< \brief The object type */
+    OBJECT_POSES = 2,        /**< \brief The header and poses of the object and of its shapes */
+    OBJECT_GEOMETRY = 4,     /**< \brief The primitives, meshes, planes and subframes */
+    OBJECT_ALL_FIELDS = 0xFF /**< \brief All fields */
+  };
+
+  /** \brief A batch of changes to the world and the attached objects, sent to the planning scene as a single diff.
+
+      Successive pose updates of the same object are merged, so only the latest poses are sent. Like in any planning
+      scene diff, the attached objects are processed before the world objects. */
+  class Transaction
+  {
+  public:
+    Transaction();
+
+    /** \brief Add, append or remove a collision object, or move it if its operation is MOVE */
+    void applyCollisionObject(const moveit_msgs::msg::CollisionObject& collision_object);
+
+    /** \brief Same as applyCollisionObject(), also setting the color of the object */
+    void applyCollisionObject(const moveit_msgs::msg::CollisionObject& collision_object,
+                              const std_msgs::msg::ColorRGBA& object_color);
+
+    /** \brief Move an existing collision object. Only the header, id and poses of \e collision_object are used,
+        the geometry is not sent. */
+    void moveCollisionObject(const moveit_msgs::msg::CollisionObject& collision_object);
+
+    /** \brief Remove the collision object with the given id */
+    void removeCollisionObject(const std::string& object_id);
+
+    /** \brief Attach or detach an object */
+    void applyAttachedCollisionObject(const moveit_msgs::msg::AttachedCollisionObject& attached_collision_object);
+
+    /** \brief Whether the transaction contains no changes */
+    bool empty() const;
+
+    /** \brief Discard all changes */
+    void clear();
+
+    /** \brief The planning scene diff applying all changes in order */
+    const moveit_msgs::msg::PlanningScene& getPlanningSceneDiff() const
+    {
+      return diff_;
+    }
+
+  private:
+    moveit_msgs::msg::PlanningScene diff_;
+
+    /** \brief The index in diff_.world.collision_objects of the trailing MOVE of each object, for merging updates */
+    std::map<std::string, std::size_t> last_move_;
+  };
+
   /**
     \param ns. Namespace in which all MoveIt related topics and services are discovered
     \param wait. Wait for services if they are not announced in ROS.
@@ -93,6 +147,13 @@ public:
   std::map<std::string, moveit_msgs::msg::CollisionObject>
   getObjects(const std::vector<std::string>& object_ids = std::vector<std::string>());
 
+  /** \brief Get the objects identified by the given object ids list, filling in only the requested \e fields
+      (a combination of ObjectFields). If no ids are provided, return all the known objects.
+
+      If only the type is requested, the geometry of the objects is not transferred. */
+  std::map<std::string, moveit_msgs::msg::CollisionObject> getObjects(const std::vector<std::string>& object_ids,
+                                                                      uint8_t fields);
+
   /** \brief Get the attached objects identified by the given object ids list. If no ids are provided, return all the
    * attached objects. */
   std::map<std::string, moveit_msgs::msg::AttachedCollisionObject>
@@ -123,6 +184,14 @@ public:
   bool applyAttachedCollisionObjects(
       const std::vector<moveit_msgs::msg::AttachedCollisionObject>& attached_collision_objects);
 
+  /** \brief Move existing collision objects in the planning scene of the move_group node synchronously.
+      Only the header, id and poses of the objects are sent, the geometry is ignored. */
+  bool applyCollisionObjectPoses(const std::vector<moveit_msgs::msg::CollisionObject>& collision_objects);
+
+  /** \brief Apply all changes of \e transaction to the planning scene of the move_group node synchronously,
+      in a single service call. */
+  bool applyTransaction(const Transaction& transaction);
+
   /** \brief Update the planning_scene of the move_group node with the given ps synchronously.
       Other PlanningSceneMonitors will NOT receive the update unless they subscribe to move_group's monitored scene */
   bool applyPlanningScene(const moveit_msgs::msg::PlanningScene& ps);
@@ -142,6 +211,18 @@ public:
       consider using `applyCollisionObjects` instead. */
   void removeCollisionObjects(const std::vector<std::string>& object_ids) const;
 
+  /** \brief Move existing collision objects in the world via /planning_scene.
+      Only the header, id and poses of the objects are sent, the geometry is ignored.
+
+      The update runs asynchronously. This is the cheapest way to update the poses of many objects at a high rate. */
+  void moveCollisionObjects(const std::vector<moveit_msgs::msg::CollisionObject>& collision_objects) const;
+
+  /** \brief Apply all changes of \e transaction via /planning_scene in a single message.
+
+      The update runs asynchronously. If you need the changes to be available *directly* after you called this
+      function, consider using `applyTransaction` instead. */
+  void publishTransaction(const Transaction& transaction) const;
+
   /**@}*/
 
 private:
@@ -39,6 +39,7 @@
 #include <moveit_msgs/srv/get_planning_scene.hpp>
 #include <moveit_msgs/srv/apply_planning_scene.hpp>
 #include <algorithm>
+#include <set>
 
 namespace moveit
 {
@@ -46,6 +47,22 @@ namespace planning_interface
 {
 static const rclcpp::Logger LOGGER = rclcpp::get_logger("moveit_ros.planning_scene_interface.planning_scene_interface");
 
+namespace
+{
+// Keep only what a MOVE operation uses, so no geometry is sent
+moveit_msgs::msg::CollisionObject makeMoveOperation(const moveit_msgs::msg::CollisionObject& collision_object)
+{
+  moveit_msgs::msg::CollisionObject move;
+  move.header = collision_object.header;
+  move.id = collision_object.id;
+  move.primitive_poses = collision_object.primitive_poses;
+  move.mesh_poses = collision_object.mesh_poses;
+  move.plane_poses = collision_object.plane_poses;
+  move.operation = moveit_msgs::msg::CollisionObject::MOVE;
+  return move;
+}
+}  // namespace
+
 class PlanningSceneInterface::PlanningSceneInterfaceImpl
 {
 public:
@@ -170,12 +187,17 @@ public:
     return result;
   }
 
-  std::map<std::string, moveit_msgs::msg::CollisionObject> getObjects(const std::vector<std::string>& object_ids)
+  std::map<std::string, moveit_msgs::msg::CollisionObject> getObjects(const std::vector<std::string>& object_ids,
+                                                                      uint8_t fields)
   {
     auto request = std::make_shared<moveit_msgs::srv::GetPlanningScene::Request>();
     moveit_msgs::srv::GetPlanningScene::Response::SharedPtr response;
     std::map<std::string, moveit_msgs::msg::CollisionObject> result;
-    request->components.components = request->components.WORLD_OBJECT_GEOMETRY;
+    // the names come with the types, but the poses are only sent along with the geometry
+    if (fields & (OBJECT_POSES | OBJECT_GEOMETRY))
+      request->components.components = request->components.WORLD_OBJECT_GEOMETRY;
+    else
+      request->components.components = request->components.WORLD_OBJECT_NAMES;
 
     auto res = planning_scene_service_->async_send_request(request);
     if (rclcpp::spin_until_future_complete(node_, res) != rclcpp::FutureReturnCode::SUCCESS)
@@ -185,12 +207,30 @@ public:
     }
     response = res.get();
 
-    for (const moveit_msgs::msg::CollisionObject& collision_object : response->scene.world.collision_objects)
+    const std::set<std::string> ids(object_ids.begin(), object_ids.end());
+    for (moveit_msgs::msg::CollisionObject& collision_object : response->scene.world.collision_objects)
     {
-      if (object_ids.empty() || std::find(object_ids.begin(), object_ids.end(), collision_object.id) != object_ids.end())
+      if (!ids.empty() && ids.find(collision_object.id) == ids.end())
+        continue;
+      if (!(fields & OBJECT_TYPE))
+        collision_object.type = decltype(collision_object.type)();
+      if (!(fields & OBJECT_POSES))
       {
-        result[collision_object.id] = collision_object;
+        collision_object.header = std_msgs::msg::Header();
+        collision_object.primitive_poses.clear();
+        collision_object.mesh_poses.clear();
+        collision_object.plane_poses.clear();
       }
+      if (!(fields & OBJECT_GEOMETRY))
+      {
+        collision_object.primitives.clear();
+        collision_object.meshes.clear();
+        collision_object.planes.clear();
+        collision_object.subframe_names.clear();
+        collision_object.subframe_poses.clear();
+      }
+      std::string id = collision_object.id;
+      result[id] = std::move(collision_object);
     }
     return result;
   }
@@ -271,6 +311,11 @@ public:
     planning_scene_diff_publisher_->publish(planning_scene);
   }
 
+  void publishPlanningSceneDiff(const moveit_msgs::msg::PlanningScene& planning_scene) const
+  {
+    planning_scene_diff_publisher_->publish(planning_scene);
+  }
+
 private:
   void waitForService(std::shared_ptr<rclcpp::ClientBase> srv)
   {
@@ -324,7 +369,13 @@ PlanningSceneInterface::getObjectPoses(const std::vector<std::string>& object_id
 std::map<std::string, moveit_msgs::msg::CollisionObject>
 PlanningSceneInterface::getObjects(const std::vector<std::string>& object_ids)
 {
-  return impl_->getObjects(object_ids);
+  return impl_->getObjects(object_ids, OBJECT_ALL_FIELDS);
+}
+
+std::map<std::string, moveit_msgs::msg::CollisionObject>
+PlanningSceneInterface::getObjects(const std::vector<std::string>& object_ids, uint8_t fields)
+{
+  return impl_->getObjects(object_ids, fields);
 }
 
 std::map<std::string, moveit_msgs::msg::AttachedCollisionObject>
@@ -400,6 +451,23 @@ bool PlanningSceneInterface::applyAttachedCollisionObjects(
   return applyPlanningScene(ps);
 }
 
+bool PlanningSceneInterface::applyCollisionObjectPoses(
+    const std::vector<moveit_msgs::msg::CollisionObject>& collision_objects)
+{
+  moveit_msgs::msg::PlanningScene ps;
+  ps.robot_state.is_diff = true;
+  ps.is_diff = true;
+  ps.world.collision_objects.reserve(collision_objects.size());
+  for (const moveit_msgs::msg::CollisionObject& collision_object : collision_objects)
+    ps.world.collision_objects.push_back(makeMoveOperation(collision_object));
+  return applyPlanningScene(ps);
+}
+
+bool PlanningSceneInterface::applyTransaction(const Transaction& transaction)
+{
+  return applyPlanningScene(transaction.getPlanningSceneDiff());
+}
+
 bool PlanningSceneInterface::applyPlanningScene(const moveit_msgs::msg::PlanningScene& ps)
 {
   return impl_->applyPlanningScene(ps);
@@ -415,5 +483,92 @@ void PlanningSceneInterface::removeCollisionObjects(const std::vector<std::strin
 {
   impl_->removeCollisionObjects(object_ids);
 }
+
+void PlanningSceneInterface::moveCollisionObjects(
+    const std::vector<moveit_msgs::msg::CollisionObject>& collision_objects) const
+{
+  moveit_msgs::msg::PlanningScene ps;
+  ps.robot_state.is_diff = true;
+  ps.is_diff = true;
+  ps.world.collision_objects.reserve(collision_objects.size());
+  for (const moveit_msgs::msg::CollisionObject& collision_object : collision_objects)
+    ps.world.collision_objects.push_back(makeMoveOperation(collision_object));
+  impl_->publishPlanningSceneDiff(ps);
+}
+
+void PlanningSceneInterface::publishTransaction(const Transaction& transaction) const
+{
+  impl_->publishPlanningSceneDiff(transaction.getPlanningSceneDiff());
+}
+
+PlanningSceneInterface::Transaction::Transaction()
+{
+  diff_.is_diff = true;
+  diff_.robot_state.is_diff = true;
+}
+
+void PlanningSceneInterface::Transaction::applyCollisionObject(
+    const moveit_msgs::msg::CollisionObject& collision_object)
+{
+  if (collision_object.operation == moveit_msgs::msg::CollisionObject::MOVE)
+  {
+    moveCollisionObject(collision_object);
+    return;
+  }
+  // a later move must not be merged into a move that precedes this operation
+  last_move_.erase(collision_object.id);
+  diff_.world.collision_objects.push_back(collision_object);
+}
+
+void PlanningSceneInterface::Transaction::applyCollisionObject(
+    const moveit_msgs::msg::CollisionObject& collision_object, const std_msgs::msg::ColorRGBA& object_color)
+{
+  applyCollisionObject(collision_object);
+  moveit_msgs::msg::ObjectColor oc;
+  oc.id = collision_object.id;
+  oc.color = object_color;
+  diff_.object_colors.push_back(oc);
+}
+
+void PlanningSceneInterface::Transaction::moveCollisionObject(
+    const moveit_msgs::msg::CollisionObject& collision_object)
+{
+  std::map<std::string, std::size_t>::const_iterator it = last_move_.find(collision_object.id);
+  if (it != last_move_.end())
+  {
+    diff_.world.collision_objects[it->second] = makeMoveOperation(collision_object);
+    return;
+  }
+  last_move_[collision_object.id] = diff_.world.collision_objects.size();
+  diff_.world.collision_objects.push_back(makeMoveOperation(collision_object));
+}
+
+void PlanningSceneInterface::Transaction::removeCollisionObject(const std::string& object_id)
+{
+  moveit_msgs::msg::CollisionObject object;
+  object.id = object_id;
+  object.operation = object.REMOVE;
+  applyCollisionObject(object);
+}
+
+void PlanningSceneInterface::Transaction::applyAttachedCollisionObject(
+    const moveit_msgs::msg::AttachedCollisionObject& attached_collision_object)
+{
+  diff_.robot_state.attached_collision_objects.push_back(attached_collision_object);
+}
+
+bool PlanningSceneInterface::Transaction::empty() const
+{
+  return diff_.world.collision_objects.empty() && diff_.robot_state.attached_collision_objects.empty() &&
+         diff_.object_colors.empty();
+}
+
+void PlanningSceneInterface::Transaction::clear()
+{
+  diff_.world.collision_objects.clear();
+  diff_.robot_state.attached_collision_objects.clear();
+  diff_.object_colors.clear();
+  last_move_.clear();
+}
 }  // namespace planning_interface
 }  // namespace moveit
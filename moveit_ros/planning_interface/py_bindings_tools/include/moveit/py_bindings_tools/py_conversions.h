@@ -38,6 +38,8 @@
 
 #include <boost/python.hpp>
 #include <boost/python/stl_iterator.hpp>
+#include <Python.h>
+#include <cstring>
 #include <string>
 #include <vector>
 #include <map>
@@ -73,8 +75,55 @@ boost::python::dict dictFromType(const std::map<std::string, T>& v)
   return d;
 }
 
+/** \brief Copy the contents of an object exposing a C-contiguous buffer of doubles (e.g. a float64 numpy array,
+    an array.array('d') or a memoryview) into \e v with a single memcpy, instead of converting element by element.
+    If \e columns is non-zero, the buffer must hold rows of that many values (a 2D array of that width, or a flat
+    one of a multiple of that length). Return false if \e values does not expose such a buffer. */
+inline bool doubleFromBuffer(const boost::python::object& values, std::vector<double>& v, std::size_t columns = 0)
+{
+  if (!PyObject_CheckBuffer(values.ptr()))
+    return false;
+  Py_buffer view;
+  if (PyObject_GetBuffer(values.ptr(), &view, PyBUF_C_CONTIGUOUS | PyBUF_FORMAT) != 0)
+  {
+    PyErr_Clear();
+    return false;
+  }
+  const char* format = view.format ? view.format : "B";
+  if (*format == '@' || *format == '=' || (*format == '<' && PY_LITTLE_ENDIAN) || (*format == '>' && PY_BIG_ENDIAN))
+    ++format;
+  std::size_t count = view.itemsize > 0 ? view.len / view.itemsize : 0;
+  bool ok = std::strcmp(format, "d") == 0 && view.itemsize == sizeof(double) && view.ndim <= 2;
+  if (ok && columns > 0)
+    ok = view.ndim == 2 ? static_cast<std::size_t>(view.shape[1]) == columns : count % columns == 0;
+  if (ok)
+  {
+    v.resize(count);
+    if (count > 0)
+      std::memcpy(v.data(), view.buf, count * sizeof(double));
+  }
+  PyBuffer_Release(&view);
+  return ok;
+}
+
+/** \brief Copy \e v into a Python memoryview of doubles, shaped as rows of \e columns values if \e columns is
+    non-zero. numpy.asarray() wraps the result without copying it again, and no Python float is created per value. */
+inline boost::python::object arrayFromDouble(const std::vector<double>& v, std::size_t columns = 0)
+{
+  boost::python::object bytes(boost::python::handle<>(
+      PyByteArray_FromStringAndSize(reinterpret_cast<const char*>(v.data()), v.size() * sizeof(double))));
+  boost::python::object view(boost::python::handle<>(PyMemoryView_FromObject(bytes.ptr())));
+  // memoryview cannot be shaped with a zero extent
+  if (columns == 0 || v.empty())
+    return view.attr("cast")("d");
+  return view.attr("cast")("d", boost::python::make_tuple(v.size() / columns, columns));
+}
+
 std::vector<double> doubleFromList(const boost::python::object& values)
 {
+  std::vector<double> v;
+  if (doubleFromBuffer(values, v))
+    return v;
   return typeFromList<double>(values);
 }
 
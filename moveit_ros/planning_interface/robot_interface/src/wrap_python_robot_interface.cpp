@@ -151,21 +151,47 @@ public:
     if (lm)
     {
       // getGlobalLinkTransform() returns a valid isometry by contract
-      const Eigen::Isometry3d& t = state->getGlobalLinkTransform(lm);
       std::vector<double> v(7);
-      v[0] = t.translation().x();
-      v[1] = t.translation().y();
-      v[2] = t.translation().z();
-      Eigen::Quaterniond q(t.linear());
-      v[3] = q.x();
-      v[4] = q.y();
-      v[5] = q.z();
-      v[6] = q.w();
+      poseToValues(state->getGlobalLinkTransform(lm), &v[0]);
       l = py_bindings_tools::listFromDouble(v);
     }
     return l;
   }
 
+  /** Compute the pose of link \e name for each row of group variable values in \e values (an N x V array, e.g.
+      float64 numpy) and return them as an N x 7 array of (x, y, z, qx, qy, qz, qw). Variables outside the group are
+      taken from the current state. This evaluates all states in a single call, without per-state messages. */
+  bp::object getLinkPoses(const std::string& name, const std::string& group, const bp::object& values)
+  {
+    const moveit::core::JointModelGroup* jmg = robot_model_->getJointModelGroup(group);
+    const moveit::core::LinkModel* lm = robot_model_->getLinkModel(name);
+    if (!jmg || !lm)
+      return py_bindings_tools::arrayFromDouble(std::vector<double>(), 7);
+    const std::size_t variable_count = jmg->getVariableCount();
+    std::vector<double> group_values;
+    if (!py_bindings_tools::doubleFromBuffer(values, group_values, variable_count))
+      group_values = py_bindings_tools::doubleFromList(values);
+    if (variable_count == 0 || group_values.size() % variable_count != 0)
+      throw std::invalid_argument("RobotInterfacePython: expected rows of " + std::to_string(variable_count) +
+                                  " values for group '" + group + "'");
+
+    moveit::core::RobotState state(robot_model_);
+    if (ensureCurrentState())
+      state = *current_state_monitor_->getCurrentState();
+    const std::size_t count = group_values.size() / variable_count;
+    std::vector<double> poses(count * 7);
+    {
+      GILReleaser gr;
+      for (std::size_t i = 0; i < count; ++i)
+      {
+        state.setJointGroupPositions(jmg, &group_values[i * variable_count]);
+        state.updateLinkTransforms();
+        poseToValues(state.getGlobalLinkTransform(lm), &poses[i * 7]);
+      }
+    }
+    return py_bindings_tools::arrayFromDouble(poses, 7);
+  }
+
   bp::list getDefaultStateNames(const std::string& group)
   {
     bp::list l;
@@ -367,6 +393,18 @@ public:
   }
 
 private:
+  static void poseToValues(const Eigen::Isometry3d& t, double* v)
+  {
+    v[0] = t.translation().x();
+    v[1] = t.translation().y();
+    v[2] = t.translation().z();
+    Eigen::Quaterniond q(t.linear());
+    v[3] = q.x();
+    v[4] = q.y();
+    v[5] = q.z();
+    v[6] = q.w();
+  }
+
   moveit::core::RobotModelConstPtr robot_model_;
   planning_scene_monitor::CurrentStateMonitorPtr current_state_monitor_;
   ros::NodeHandle nh_;
@@ -388,6 +426,7 @@ static void wrap_robot_interface()
   robot_class.def("get_group_link_names", &RobotInterfacePython::getGroupLinkNames);
   robot_class.def("get_joint_limits", &RobotInterfacePython::getJointLimits);
   robot_class.def("get_link_pose", &RobotInterfacePython::getLinkPose);
+  robot_class.def("get_link_poses", &RobotInterfacePython::getLinkPoses);
   robot_class.def("get_planning_frame", &RobotInterfacePython::getPlanningFrame);
   robot_class.def("get_current_state", &RobotInterfacePython::getCurrentState);
   robot_class.def("get_current_variable_values", &RobotInterfacePython::getCurrentVariableValues);
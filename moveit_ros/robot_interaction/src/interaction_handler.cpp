@@ -301,6 +301,7 @@ void InteractionHandler::updateStateEndEffector(moveit::core::RobotState* state,
   // access kinematic_options_map_.
   KinematicOptions kinematic_options = kinematic_options_map_->getOptions(eef->parent_group);
 
+  // the state is modified in place, so IK is seeded with the solution found for the previous feedback
   bool ok = kinematic_options.setStateFromIK(*state, eef->parent_group, eef->parent_link, *pose);
   bool error_state_changed = setErrorState(eef->parent_group, !ok);
   if (update_callback_)
@@ -730,10 +730,17 @@ void RobotInteraction::processingThread()
     while (feedback_map_.empty() && run_processing_thread_ && rclcpp::ok())
       new_feedback_condition_.wait(ulock);
 
-    while (!feedback_map_.empty() && rclcpp::ok())
+    // take all pending feedback at once, so a marker that keeps being dragged cannot starve the others
+    std::map<std::string, visualization_msgs::msg::InteractiveMarkerFeedback::ConstSharedPtr> pending_feedback;
+    pending_feedback.swap(feedback_map_);
+    for (const auto& pending : pending_feedback)
     {
-      auto feedback = feedback_map_.begin()->second;
-      feedback_map_.erase(feedback_map_.begin());
+      if (!rclcpp::ok())
+        break;
+      // newer feedback for this marker arrived while the previous markers were handled; only the latest is processed
+      if (feedback_map_.find(pending.first) != feedback_map_.end())
+        continue;
+      const auto& feedback = pending.second;
       RCLCPP_DEBUG(LOGGER, "Processing feedback from map for marker [%s]", feedback->marker_name.c_str());
 
       std::map<std::string, std::size_t>::const_iterator it = shown_markers_.find(feedback->marker_name);
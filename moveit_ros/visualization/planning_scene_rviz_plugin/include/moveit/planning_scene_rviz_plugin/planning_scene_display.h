@@ -45,6 +45,7 @@
 #include <moveit/planning_scene_monitor/planning_scene_monitor.h>
 #include <moveit/background_processing/background_processing.h>
 #include <rclcpp/rclcpp.hpp>
+#include <atomic>
 #endif
 
 namespace Ogre
@@ -62,6 +63,7 @@ class FloatProperty;
 class RosTopicProperty;
 class ColorProperty;
 class EnumProperty;
+class IntProperty;
 }  // namespace rviz
 
 namespace moveit_rviz_plugin
@@ -196,9 +198,13 @@ protected:
 
   // full update required
   bool planning_scene_needs_render_;
+  // full update required by the scene monitor, coalesced to at most one per scene display time
+  std::atomic<bool> scene_geometry_needs_render_;
   // or only the robot position (excluding attached object changes)
-  bool robot_state_needs_render_;
+  std::atomic<bool> robot_state_needs_render_;
   float current_scene_time_;
+  // the attached bodies of the last state received from the scene monitor, to detect their changes
+  std::vector<const moveit::core::AttachedBody*> attached_bodies_;
 
   rviz_common::properties::Property* scene_category_;
   rviz_common::properties::Property* robot_category_;
@@ -217,6 +223,7 @@ protected:
   rviz_common::properties::FloatProperty* scene_display_time_property_;
   rviz_common::properties::EnumProperty* octree_render_property_;
   rviz_common::properties::EnumProperty* octree_coloring_property_;
+  rviz_common::properties::IntProperty* octree_depth_property_;
 
   // rclcpp node
   rclcpp::Node::SharedPtr node_;
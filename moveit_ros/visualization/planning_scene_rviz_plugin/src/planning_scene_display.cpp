@@ -49,6 +49,7 @@
 #include <rviz_common/properties/float_property.hpp>
 #include <rviz_common/properties/color_property.hpp>
 #include <rviz_common/properties/enum_property.hpp>
+#include <rviz_common/properties/int_property.hpp>
 #include <rviz_common/display_context.hpp>
 #include <tf2_ros/buffer.h>
 
@@ -64,7 +65,12 @@ static const rclcpp::Logger LOGGER = rclcpp::get_logger("moveit_ros_visualizatio
 // Base class contructor
 // ******************************************************************************************
 PlanningSceneDisplay::PlanningSceneDisplay(bool listen_to_planning_scene, bool show_scene_robot)
-  : Display(), model_is_loading_(false), planning_scene_needs_render_(true), current_scene_time_(0.0f)
+  : Display()
+  , model_is_loading_(false)
+  , planning_scene_needs_render_(true)
+  , scene_geometry_needs_render_(false)
+  , robot_state_needs_render_(false)
+  , current_scene_time_(0.0f)
 {
   move_group_ns_property_ = new rviz_common::properties::StringProperty("Move Group Namespace", "",
                                                                         "The name of the ROS namespace in "
@@ -119,6 +125,13 @@ PlanningSceneDisplay::PlanningSceneDisplay(bool listen_to_planning_scene, bool s
   octree_coloring_property_->addOption("Z-Axis", OCTOMAP_Z_AXIS_COLOR);
   octree_coloring_property_->addOption("Cell Probability", OCTOMAP_PROBABLILTY_COLOR);
 
+  octree_depth_property_ = new rviz_common::properties::IntProperty(
+      "Voxel Rendering Depth", 0,
+      "The maximum depth of the octree to render; deeper voxels are aggregated into their parents. "
+      "0 renders the full depth",
+      scene_category_, SLOT(changedOctreeRenderMode()), this);
+  octree_depth_property_->setMin(0);
+
   scene_display_time_property_ =
       new rviz_common::properties::FloatProperty("Scene Display Time", 0.01f,
                                                  "The amount of wall-time to wait in between rendering "
@@ -359,7 +372,7 @@ void PlanningSceneDisplay::renderPlanningScene()
       planning_scene_render_->renderPlanningScene(
           ps, env_color, attached_color, static_cast<OctreeVoxelRenderMode>(octree_render_property_->getOptionInt()),
           static_cast<OctreeVoxelColorMode>(octree_coloring_property_->getOptionInt()),
-          scene_alpha_property_->getFloat());
+          scene_alpha_property_->getFloat(), octree_depth_property_->getInt());
     }
     else
     {
@@ -411,10 +424,12 @@ void PlanningSceneDisplay::changedSceneDisplayTime()
 
 void PlanningSceneDisplay::changedOctreeRenderMode()
 {
+  queueRenderSceneGeometry();
 }
 
 void PlanningSceneDisplay::changedOctreeColorMode()
 {
+  queueRenderSceneGeometry();
 }
 
 void PlanningSceneDisplay::changedSceneRobotVisualEnabled()
@@ -592,12 +607,30 @@ void PlanningSceneDisplay::sceneMonitorReceivedUpdate(
 }
 
 void PlanningSceneDisplay::onSceneMonitorReceivedUpdate(
-    planning_scene_monitor::PlanningSceneMonitor::SceneUpdateType /*update_type*/)
+    planning_scene_monitor::PlanningSceneMonitor::SceneUpdateType update_type)
 {
-  getPlanningSceneRW()->getCurrentStateNonConst().update();
+  // compute the transforms here, on the thread of the scene monitor, instead of on the main thread when rendering
+  bool attached_bodies_changed;
+  {
+    planning_scene_monitor::LockedPlanningSceneRW ps = getPlanningSceneRW();
+    moveit::core::RobotState& state = ps->getCurrentStateNonConst();
+    state.update();
+    std::vector<const moveit::core::AttachedBody*> attached_bodies;
+    state.getAttachedBodies(attached_bodies);
+    attached_bodies_changed = attached_bodies != attached_bodies_;
+    attached_bodies_.swap(attached_bodies);
+  }
+
+  // state updates arrive at high rates and only need the robot to be moved, unless its attached bodies changed.
+  // updateInternal() coalesces all updates received within the scene display time into one render.
+  if (update_type == planning_scene_monitor::PlanningSceneMonitor::UPDATE_STATE && !attached_bodies_changed)
+  {
+    robot_state_needs_render_ = true;
+    return;
+  }
   QMetaObject::invokeMethod(this, "setSceneName", Qt::QueuedConnection,
                             Q_ARG(QString, QString::fromStdString(getPlanningSceneRO()->getName())));
-  planning_scene_needs_render_ = true;
+  scene_geometry_needs_render_ = true;
 }
 
 void PlanningSceneDisplay::setSceneName(const QString& name)
@@ -659,13 +692,15 @@ void PlanningSceneDisplay::updateInternal(float wall_dt, float /*ros_dt*/)
 {
   current_scene_time_ += wall_dt;
   if ((current_scene_time_ > scene_display_time_property_->getFloat() && planning_scene_render_ &&
-       robot_state_needs_render_) ||
+       (robot_state_needs_render_ || scene_geometry_needs_render_)) ||
       planning_scene_needs_render_)
   {
+    if (scene_geometry_needs_render_.exchange(false))
+      planning_scene_needs_render_ = true;
+    robot_state_needs_render_ = false;
     renderPlanningScene();
     calculateOffsetPosition();
     current_scene_time_ = 0.0f;
-    robot_state_needs_render_ = false;
     planning_scene_needs_render_ = false;
   }
 }
@@ -41,6 +41,7 @@
 #include <moveit/rviz_plugin_render_tools/render_shapes.h>
 #include <rviz_common/properties/color_property.hpp>
 #include <OgreMaterial.h>
+#include <map>
 
 namespace moveit_rviz_plugin
 {
@@ -67,16 +68,35 @@ public:
 
   void updateRobotPosition(const planning_scene::PlanningSceneConstPtr& scene);
 
+  /** \brief Render the robot and the world objects of \e scene. Only world objects that changed since the last call
+   *  are rendered again. Octrees are rendered up to \e octree_max_depth, 0 for their full depth. */
   void renderPlanningScene(const planning_scene::PlanningSceneConstPtr& scene,
                            const Ogre::ColourValue& default_scene_color,
                            const Ogre::ColourValue& default_attached_color, OctreeVoxelRenderMode voxel_render_mode,
-                           OctreeVoxelColorMode voxel_color_mode, float default_scene_alpha);
+                           OctreeVoxelColorMode voxel_color_mode, float default_scene_alpha,
+                           std::size_t octree_max_depth = 0);
   void clear();
 
 private:
+  /** \brief The shapes rendered for a world object and what they were rendered from */
+  struct RenderedObject
+  {
+    // world objects are copied on modification while referenced, so an unchanged pointer means unchanged content
+    collision_detection::World::ObjectConstPtr object_;
+    Ogre::ColourValue color_;
+    float alpha_;
+    RenderShapesPtr shapes_;
+  };
+
   Ogre::SceneNode* planning_scene_geometry_node_;
   rviz_common::DisplayContext* context_;
-  RenderShapesPtr render_shapes_;
   RobotStateVisualizationPtr scene_robot_;
+
+  std::map<std::string, RenderedObject> rendered_objects_;
+
+  // the octree settings rendered_objects_ were rendered with
+  OctreeVoxelRenderMode voxel_render_mode_;
+  OctreeVoxelColorMode voxel_color_mode_;
+  std::size_t octree_max_depth_;
 };
 }  // namespace moveit_rviz_plugin
@@ -57,9 +57,11 @@ public:
   RenderShapes(rviz_common::DisplayContext* context);
   ~RenderShapes();
 
+  /** \brief Render shape \e s at pose \e p. Octrees are rendered up to \e octree_max_depth, 0 for their full depth,
+   *  aggregating the voxels below it. */
   void renderShape(Ogre::SceneNode* node, const shapes::Shape* s, const Eigen::Isometry3d& p,
                    OctreeVoxelRenderMode octree_voxel_rendering, OctreeVoxelColorMode octree_color_mode,
-                   const Ogre::ColourValue& color, float alpha);
+                   const Ogre::ColourValue& color, float alpha, std::size_t octree_max_depth = 0);
   void updateShapeColors(float r, float g, float b, float a);
   void clear();
 
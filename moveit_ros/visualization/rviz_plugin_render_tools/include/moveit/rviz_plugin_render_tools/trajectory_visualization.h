@@ -139,6 +139,7 @@ protected:
   robot_trajectory::RobotTrajectoryPtr displaying_trajectory_message_;
   robot_trajectory::RobotTrajectoryPtr trajectory_message_to_display_;
   std::vector<RobotStateVisualizationUniquePtr> trajectory_trail_;
+  std::size_t trail_step_size_;  // the step size used for trajectory_trail_, after decimation
   rclcpp::Subscription<moveit_msgs::msg::DisplayTrajectory>::SharedPtr trajectory_topic_sub_;
   bool animating_path_;
   bool drop_displaying_trajectory_;
@@ -170,6 +171,7 @@ protected:
   rviz_common::properties::ColorProperty* robot_color_property_;
   rviz_common::properties::BoolProperty* enable_robot_color_property_;
   rviz_common::properties::IntProperty* trail_step_size_property_;
+  rviz_common::properties::IntProperty* trail_max_size_property_;
 };
 
 }  // namespace moveit_rviz_plugin
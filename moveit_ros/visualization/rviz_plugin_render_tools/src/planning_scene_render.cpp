@@ -46,13 +46,18 @@ namespace moveit_rviz_plugin
 {
 PlanningSceneRender::PlanningSceneRender(Ogre::SceneNode* node, rviz_common::DisplayContext* context,
                                          const RobotStateVisualizationPtr& robot)
-  : planning_scene_geometry_node_(node->createChildSceneNode()), context_(context), scene_robot_(robot)
+  : planning_scene_geometry_node_(node->createChildSceneNode())
+  , context_(context)
+  , scene_robot_(robot)
+  , voxel_render_mode_(OCTOMAP_OCCUPIED_VOXELS)
+  , voxel_color_mode_(OCTOMAP_Z_AXIS_COLOR)
+  , octree_max_depth_(0)
 {
-  render_shapes_.reset(new RenderShapes(context));
 }
 
 PlanningSceneRender::~PlanningSceneRender()
 {
+  clear();
   context_->getSceneManager()->destroySceneNode(planning_scene_geometry_node_);
 }
 
@@ -68,19 +73,27 @@ void PlanningSceneRender::updateRobotPosition(const planning_scene::PlanningScen
 
 void PlanningSceneRender::clear()
 {
-  render_shapes_->clear();
+  rendered_objects_.clear();
 }
 
 void PlanningSceneRender::renderPlanningScene(const planning_scene::PlanningSceneConstPtr& scene,
                                               const Ogre::ColourValue& default_env_color,
                                               const Ogre::ColourValue& default_attached_color,
                                               OctreeVoxelRenderMode octree_voxel_rendering,
-                                              OctreeVoxelColorMode octree_color_mode, float default_scene_alpha)
+                                              OctreeVoxelColorMode octree_color_mode, float default_scene_alpha,
+                                              std::size_t octree_max_depth)
 {
   if (!scene)
     return;
 
-  clear();
+  if (octree_voxel_rendering != voxel_render_mode_ || octree_color_mode != voxel_color_mode_ ||
+      octree_max_depth != octree_max_depth_)
+  {
+    clear();
+    voxel_render_mode_ = octree_voxel_rendering;
+    voxel_color_mode_ = octree_color_mode;
+    octree_max_depth_ = octree_max_depth;
+  }
 
   if (scene_robot_)
   {
@@ -97,10 +110,18 @@ void PlanningSceneRender::renderPlanningScene(const planning_scene::PlanningScen
     scene_robot_->update(moveit::core::RobotStateConstPtr(rs), color, color_map);
   }
 
-  const std::vector<std::string>& ids = scene->getWorld()->getObjectIds();
+  // remove the objects that are no longer in the scene
+  const collision_detection::WorldConstPtr& world = scene->getWorld();
+  for (std::map<std::string, RenderedObject>::iterator it = rendered_objects_.begin(); it != rendered_objects_.end();)
+    if (world->hasObject(it->first))
+      ++it;
+    else
+      it = rendered_objects_.erase(it);
+
+  const std::vector<std::string>& ids = world->getObjectIds();
   for (const std::string& id : ids)
   {
-    collision_detection::CollisionEnv::ObjectConstPtr object = scene->getWorld()->getObject(id);
+    collision_detection::CollisionEnv::ObjectConstPtr object = world->getObject(id);
     Ogre::ColourValue color = default_env_color;
     float alpha = default_scene_alpha;
     if (scene->hasObjectColor(id))
@@ -111,9 +132,21 @@ void PlanningSceneRender::renderPlanningScene(const planning_scene::PlanningScen
       color.b = c.b;
       alpha = c.a;
     }
+
+    RenderedObject& rendered = rendered_objects_[id];
+    if (rendered.shapes_ && rendered.object_ == object && rendered.color_ == color && rendered.alpha_ == alpha)
+      continue;  // unchanged
+
+    rendered.object_ = object;
+    rendered.color_ = color;
+    rendered.alpha_ = alpha;
+    if (rendered.shapes_)
+      rendered.shapes_->clear();
+    else
+      rendered.shapes_.reset(new RenderShapes(context_));
     for (std::size_t j = 0; j < object->shapes_.size(); ++j)
-      render_shapes_->renderShape(planning_scene_geometry_node_, object->shapes_[j].get(), object->shape_poses_[j],
-                                  octree_voxel_rendering, octree_color_mode, color, alpha);
+      rendered.shapes_->renderShape(planning_scene_geometry_node_, object->shapes_[j].get(), object->shape_poses_[j],
+                                    octree_voxel_rendering, octree_color_mode, color, alpha, octree_max_depth);
   }
 }
 }  // namespace moveit_rviz_plugin
@@ -72,7 +72,7 @@ void RenderShapes::clear()
 
 void RenderShapes::renderShape(Ogre::SceneNode* node, const shapes::Shape* s, const Eigen::Isometry3d& p,
                                OctreeVoxelRenderMode octree_voxel_rendering, OctreeVoxelColorMode octree_color_mode,
-                               const Ogre::ColourValue& color, float alpha)
+                               const Ogre::ColourValue& color, float alpha, std::size_t octree_max_depth)
 {
   rviz_rendering::Shape* ogre_shape = nullptr;
   Eigen::Vector3d translation = p.translation();
@@ -86,7 +86,7 @@ void RenderShapes::renderShape(Ogre::SceneNode* node, const shapes::Shape* s, co
   {
     std::unique_ptr<shapes::Mesh> m(shapes::createMeshFromShape(static_cast<const shapes::Cone&>(*s)));
     if (m)
-      renderShape(node, m.get(), p, octree_voxel_rendering, octree_color_mode, color, alpha);
+      renderShape(node, m.get(), p, octree_voxel_rendering, octree_color_mode, color, alpha, octree_max_depth);
     return;
   }
 
@@ -157,7 +157,7 @@ void RenderShapes::renderShape(Ogre::SceneNode* node, const shapes::Shape* s, co
     case shapes::OCTREE:
     {
       OcTreeRenderPtr octree(new OcTreeRender(static_cast<const shapes::OcTree*>(s)->octree, octree_voxel_rendering,
-                                              octree_color_mode, 0u, node));
+                                              octree_color_mode, octree_max_depth, node));
       octree->setPosition(position);
       octree->setOrientation(orientation);
       octree_voxel_grids_.push_back(octree);
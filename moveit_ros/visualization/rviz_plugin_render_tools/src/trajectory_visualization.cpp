@@ -65,7 +65,8 @@ static const rclcpp::Logger LOGGER = rclcpp::get_logger("moveit_rviz_plugin_rend
 
 TrajectoryVisualization::TrajectoryVisualization(rviz_common::properties::Property* widget,
                                                  rviz_common::Display* display)
-  : animating_path_(false)
+  : trail_step_size_(1)
+  , animating_path_(false)
   , drop_displaying_trajectory_(false)
   , current_state_(-1)
   , display_(display)
@@ -120,6 +121,13 @@ TrajectoryVisualization::TrajectoryVisualization(rviz_common::properties::Proper
                                                                        widget, SLOT(changedTrailStepSize()), this);
   trail_step_size_property_->setMin(1);
 
+  trail_max_size_property_ = new rviz_common::properties::IntProperty(
+      "Trail Max Size", 100,
+      "The maximum number of robots shown in the trajectory trail. The step size is increased for longer "
+      "trajectories. 0 shows all samples selected by the step size.",
+      widget, SLOT(changedTrailStepSize()), this);
+  trail_max_size_property_->setMin(0);
+
   interrupt_display_property_ = new rviz_common::properties::BoolProperty(
       "Interrupt Display", false,
       "Immediately show newly planned trajectory, interrupting the currently displayed one.", widget);
@@ -237,33 +245,55 @@ void TrajectoryVisualization::changedLoopDisplay()
 
 void TrajectoryVisualization::changedShowTrail()
 {
-  clearTrajectoryTrail();
-
   if (!trail_display_property_->getBool())
+  {
+    clearTrajectoryTrail();
     return;
+  }
   robot_trajectory::RobotTrajectoryPtr t = trajectory_message_to_display_;
   if (!t)
     t = displaying_trajectory_message_;
   if (!t)
+  {
+    clearTrajectoryTrail();
     return;
+  }
 
-  int stepsize = trail_step_size_property_->getInt();
   // always include last trajectory point
-  trajectory_trail_.resize((int)std::ceil((t->getWayPointCount() + stepsize - 1) / (float)stepsize));
+  const std::size_t waypoint_count = t->getWayPointCount();
+  auto trail_size = [waypoint_count](std::size_t stepsize) {
+    return (waypoint_count + stepsize - 1) / stepsize + ((waypoint_count - 1) % stepsize ? 1 : 0);
+  };
+
+  // decimate dense trajectories, so that the trail does not grow with the number of waypoints
+  std::size_t stepsize = trail_step_size_property_->getInt();
+  const std::size_t max_size = std::max(2, trail_max_size_property_->getInt());
+  if (trail_max_size_property_->getInt() > 0)
+    while (trail_size(stepsize) > max_size && stepsize < waypoint_count)
+      ++stepsize;
+  trail_step_size_ = stepsize;
+
+  // robots are kept from the previous trajectory, since loading their meshes is by far the most expensive part
+  trajectory_trail_.resize(trail_size(stepsize));
   for (std::size_t i = 0; i < trajectory_trail_.size(); i++)
   {
-    int waypoint_i = std::min(i * stepsize, t->getWayPointCount() - 1);  // limit to last trajectory point
-    auto r = std::make_unique<RobotStateVisualization>(scene_node_, context_,
-                                                       "Trail Robot " + boost::lexical_cast<std::string>(i), nullptr);
-    r->load(*robot_model_->getURDF());
+    std::size_t waypoint_i = std::min(i * stepsize, waypoint_count - 1);  // limit to last trajectory point
+    RobotStateVisualizationUniquePtr& r = trajectory_trail_[i];
+    if (!r)
+    {
+      r = std::make_unique<RobotStateVisualization>(scene_node_, context_,
+                                                    "Trail Robot " + boost::lexical_cast<std::string>(i), nullptr);
+      r->load(*robot_model_->getURDF());
+    }
     r->setVisualVisible(display_path_visual_enabled_property_->getBool());
     r->setCollisionVisible(display_path_collision_enabled_property_->getBool());
     r->setAlpha(robot_path_alpha_property_->getFloat());
     r->update(t->getWayPointPtr(waypoint_i), default_attached_object_color_);
     if (enable_robot_color_property_->getBool())
       setRobotColor(&(r->getRobot()), robot_color_property_->getColor());
-    r->setVisible(display_->isEnabled() && (!animating_path_ || waypoint_i <= current_state_));
-    trajectory_trail_[i] = std::move(r);
+    else
+      unsetRobotColor(&(r->getRobot()));
+    r->setVisible(display_->isEnabled() && (!animating_path_ || static_cast<int>(waypoint_i) <= current_state_));
   }
 }
 
@@ -472,7 +502,7 @@ void TrajectoryVisualization::update(float wall_dt, float /*ros_dt*/)
       display_path_robot_->update(displaying_trajectory_message_->getWayPointPtr(current_state_));
       for (std::size_t i = 0; i < trajectory_trail_.size(); ++i)
         trajectory_trail_[i]->setVisible(
-            std::min(waypoint_count - 1, static_cast<int>(i) * trail_step_size_property_->getInt()) <= current_state_);
+            std::min(waypoint_count - 1, static_cast<int>(i * trail_step_size_)) <= current_state_);
     }
     else
     {
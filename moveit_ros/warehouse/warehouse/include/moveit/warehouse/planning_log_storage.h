@@ -0,0 +1,158 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, PickNik LLC
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik LLC nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#pragma once
+
+#include <moveit/macros/class_forward.h>
+#include <moveit_msgs/msg/planning_scene.hpp>
+#include <moveit_msgs/msg/motion_plan_request.hpp>
+#include <moveit_msgs/msg/robot_trajectory.hpp>
+#include <rclcpp/time.hpp>
+#include <cstdint>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace moveit_warehouse
+{
+MOVEIT_CLASS_FORWARD(PlanningLogStorage)  // Defines PlanningLogStoragePtr, ConstPtr, WeakPtr... etc
+
+/** \brief Append-only storage of planning scenes, queries and results, meant for logging every planning request.
+ *
+ * PlanningSceneStorage keeps full messages in a warehouse_ros database and finds them by scanning metadata, which
+ * gets slow as the database grows. This storage writes each entry to a single data file as a compressed serialized
+ * message. Meshes of collision objects are stored once per content hash, so logging the same scene repeatedly only
+ * costs its other fields. An index of all entries is kept next to the data and loaded into memory on construction,
+ * providing lookups by scene name, by scene and query name, and by time stamp without reading the data file.
+ *
+ * Entries are never modified or removed. Adding a scene with a known name adds a newer version of it, and lookups by
+ * name return the latest version. Concurrent use of one directory from several processes is not supported.
+ */
+class PlanningLogStorage
+{
+public:
+  enum EntryType : std::uint8_t
+  {
+    PLANNING_SCENE = 0,
+    PLANNING_QUERY = 1,
+    PLANNING_RESULT = 2
+  };
+
+  /** \brief The index entry of a stored message */
+  struct Entry
+  {
+    EntryType type;
+    std::string scene_name;
+    std::string query_name;  // empty for planning scenes
+    std::int64_t stamp;      // in nanoseconds
+    std::uint64_t offset;    // of the compressed message in the data file
+    std::uint64_t size;      // of the compressed message
+  };
+
+  /** \brief Open the log in \e directory, creating it if needed. Throws std::runtime_error on failure. */
+  PlanningLogStorage(const std::string& directory);
+
+  void addPlanningScene(const moveit_msgs::msg::PlanningScene& scene, const rclcpp::Time& stamp);
+  void addPlanningQuery(const moveit_msgs::msg::MotionPlanRequest& planning_query, const std::string& scene_name,
+                        const std::string& query_name, const rclcpp::Time& stamp);
+  void addPlanningResult(const moveit_msgs::msg::RobotTrajectory& result, const std::string& scene_name,
+                         const std::string& query_name, const rclcpp::Time& stamp);
+
+  bool hasPlanningScene(const std::string& name) const;
+  void getPlanningSceneNames(std::vector<std::string>& names) const;
+  void getPlanningSceneNames(const std::string& regex, std::vector<std::string>& names) const;
+
+  /** \brief Get the latest planning scene named \e scene_name */
+  bool getPlanningScene(moveit_msgs::msg::PlanningScene& scene, const std::string& scene_name) const;
+
+  void getPlanningQueriesNames(std::vector<std::string>& query_names, const std::string& scene_name) const;
+
+  /** \brief Get the latest planning query named \e query_name for \e scene_name */
+  bool getPlanningQuery(moveit_msgs::msg::MotionPlanRequest& planning_query, const std::string& scene_name,
+                        const std::string& query_name) const;
+
+  /** \brief Get all results of the query \e query_name for \e scene_name, oldest first */
+  void getPlanningResults(std::vector<moveit_msgs::msg::RobotTrajectory>& planning_results,
+                          const std::string& scene_name, const std::string& query_name) const;
+
+  /** \brief Get the entries stamped in [\e from, \e to], in time order */
+  void getEntries(std::vector<Entry>& entries, const rclcpp::Time& from, const rclcpp::Time& to) const;
+
+  /** \brief Read the message of an entry of type PLANNING_SCENE */
+  bool readEntry(const Entry& entry, moveit_msgs::msg::PlanningScene& scene) const;
+  /** \brief Read the message of an entry of type PLANNING_QUERY */
+  bool readEntry(const Entry& entry, moveit_msgs::msg::MotionPlanRequest& planning_query) const;
+  /** \brief Read the message of an entry of type PLANNING_RESULT */
+  bool readEntry(const Entry& entry, moveit_msgs::msg::RobotTrajectory& result) const;
+
+  std::size_t getEntryCount() const;
+  std::size_t getMeshCount() const;
+
+private:
+  using Hash = std::string;  // hexadecimal SHA-256 digest
+
+  void loadIndex();
+  void addEntry(EntryType type, const std::string& scene_name, const std::string& query_name,
+                const rclcpp::Time& stamp, const std::vector<Hash>& meshes, const std::string& serialized);
+  void indexEntry(std::size_t index);
+
+  /** \brief Read the mesh hashes and the serialized message of an entry, return false on failure */
+  bool readData(const Entry& entry, std::vector<Hash>& meshes, std::string& serialized) const;
+
+  /** \brief Store a serialized mesh, unless one with the same content is stored already */
+  Hash storeMesh(const std::string& serialized_mesh);
+  bool loadMesh(const Hash& hash, std::string& serialized_mesh) const;
+  std::string getMeshPath(const Hash& hash) const;
+
+  /** \brief The latest entry of \e type in \e indices, or nullptr */
+  const Entry* findLatest(const std::vector<std::size_t>& indices, EntryType type) const;
+
+  std::string directory_;
+  std::ofstream data_out_;
+  std::ofstream index_out_;
+  std::uint64_t data_size_;
+
+  std::vector<Entry> entries_;
+  /* the secondary indexes, referring to entries_ */
+  std::map<std::string, std::vector<std::size_t>> scene_index_;  // the scenes of each name
+  std::map<std::pair<std::string, std::string>, std::vector<std::size_t>> query_index_;  // queries and results
+  std::multimap<std::int64_t, std::size_t> time_index_;
+  std::set<Hash> meshes_;
+
+  mutable std::mutex mutex_;
+};
+}  // namespace moveit_warehouse
@@ -0,0 +1,118 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, PickNik LLC
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik LLC nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#pragma once
+
+#include <moveit/warehouse/planning_scene_storage.h>
+#include <moveit/macros/class_forward.h>
+#include <moveit_msgs/msg/robot_trajectory.hpp>
+#include <limits>
+
+namespace planning_scene
+{
+MOVEIT_CLASS_FORWARD(PlanningScene)  // Defines PlanningScenePtr, ConstPtr, WeakPtr... etc
+}
+
+namespace moveit_warehouse
+{
+MOVEIT_CLASS_FORWARD(TrajectoryCacheStorage)  // Defines TrajectoryCacheStoragePtr, ConstPtr, WeakPtr... etc
+
+/** \brief A stored trajectory that may solve a new planning problem */
+struct TrajectoryCacheCandidate
+{
+  RobotTrajectoryWithMetadata trajectory;
+  /** \brief The distance of the start and goal of the trajectory to the requested ones, see getCandidates() */
+  double distance;
+};
+
+/** \brief Storage of planned trajectories, looked up by the scene they were planned in and their start and goal.
+ *
+ * Trajectories are stored together with a hash of the scene geometry near the robot. Robots sharing a database can
+ * then reuse the trajectories planned by other robots in an identical environment: the stored trajectories of the
+ * same scene hash and group are ranked by the joint space distance of their first and last waypoints to the requested
+ * start and goal. Candidates are not checked against the current scene, they must be revalidated (and their ends
+ * connected to the requested start and goal) before execution. Invalid entries can be removed by their id.
+ */
+class TrajectoryCacheStorage : public MoveItMessageStorage
+{
+public:
+  static const std::string DATABASE_NAME;
+
+  static const std::string ENTRY_ID_NAME;
+  static const std::string SCENE_HASH_NAME;
+  static const std::string GROUP_NAME;
+  static const std::string JOINT_NAMES_NAME;
+  static const std::string START_NAME;
+  static const std::string GOAL_NAME;
+
+  TrajectoryCacheStorage(warehouse_ros::DatabaseConnection::Ptr conn);
+
+  /** \brief Compute a hash of the geometry of \e scene near its robot
+   *
+   * The hash covers the robot model name, the attached bodies of the current state and the shapes of the world
+   * objects whose bounding sphere is within \e radius of the robot root link. Object poses are rounded to \e
+   * resolution meters (and their orientations to 1e-3), so that scenes rebuilt from the same data hash equally.
+   * Octrees are ignored, as sensor data differs between every update. */
+  static std::string computeSceneHash(const planning_scene::PlanningScene& scene, double radius = 2.0,
+                                      double resolution = 1e-3);
+
+  /** \brief Add a trajectory of \e group planned in a scene of hash \e scene_hash. Its first and last waypoints are
+   * used as start and goal. Return the id of the new entry, or an empty string if the trajectory has no waypoint. */
+  std::string addTrajectory(const moveit_msgs::msg::RobotTrajectory& trajectory, const std::string& scene_hash,
+                            const std::string& group);
+
+  /** \brief Get the stored trajectories of \e group for \e scene_hash with the same \e joint_names, closest first
+   *
+   * The distance of a trajectory is the sum of the euclidean joint space distances of its first waypoint to \e
+   * start and of its last waypoint to \e goal. At most \e max_candidates trajectories within \e max_distance are
+   * returned. */
+  void getCandidates(std::vector<TrajectoryCacheCandidate>& candidates, const std::string& scene_hash,
+                     const std::string& group, const std::vector<std::string>& joint_names,
+                     const std::vector<double>& start, const std::vector<double>& goal, std::size_t max_candidates = 1,
+                     double max_distance = std::numeric_limits<double>::infinity()) const;
+
+  /** \brief Get the number of trajectories stored for \e scene_hash, or in total if \e scene_hash is empty */
+  std::size_t getTrajectoryCount(const std::string& scene_hash = "") const;
+
+  void removeTrajectory(const std::string& entry_id);
+  void removeTrajectories(const std::string& scene_hash);
+
+  void reset();
+
+private:
+  void createCollections();
+
+  RobotTrajectoryCollection trajectory_collection_;
+};
+}  // namespace moveit_warehouse
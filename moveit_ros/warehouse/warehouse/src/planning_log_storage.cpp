@@ -0,0 +1,554 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, PickNik LLC
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik LLC nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include <moveit/warehouse/planning_log_storage.h>
+#include <rclcpp/logging.hpp>
+#include <rclcpp/serialization.hpp>
+#include <shape_msgs/msg/mesh.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/regex.hpp>
+#include <openssl/sha.h>
+#include <zlib.h>
+#include <cstring>
+#include <iterator>
+#include <stdexcept>
+
+namespace moveit_warehouse
+{
+static const rclcpp::Logger LOGGER = rclcpp::get_logger("moveit.ros.warehouse.planning_log_storage");
+
+namespace
+{
+const char* const DATA_FILE = "data";
+const char* const INDEX_FILE = "index";
+const char* const MESH_DIRECTORY = "meshes";
+const std::size_t HASH_LENGTH = 2 * SHA256_DIGEST_LENGTH;
+
+template <typename T>
+void appendValue(std::string& buffer, T value)
+{
+  buffer.append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+void appendString(std::string& buffer, const std::string& value)
+{
+  appendValue<std::uint32_t>(buffer, value.size());
+  buffer.append(value);
+}
+
+/** Read a value at \e pos in \e buffer and advance \e pos, return false past the end */
+template <typename T>
+bool readValue(const std::string& buffer, std::size_t& pos, T& value)
+{
+  if (buffer.size() - pos < sizeof(T))
+    return false;
+  std::memcpy(&value, buffer.data() + pos, sizeof(T));
+  pos += sizeof(T);
+  return true;
+}
+
+bool readString(const std::string& buffer, std::size_t& pos, std::string& value)
+{
+  std::uint32_t size;
+  if (!readValue(buffer, pos, size) || buffer.size() - pos < size)
+    return false;
+  value.assign(buffer, pos, size);
+  pos += size;
+  return true;
+}
+
+bool readFile(const std::string& path, std::string& content)
+{
+  std::ifstream in(path, std::ios::binary);
+  if (!in)
+    return false;
+  content.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+  return !in.bad();
+}
+
+/** Compress \e in, prefixed by its size */
+std::string compress(const std::string& in)
+{
+  std::string out;
+  appendValue<std::uint64_t>(out, in.size());
+  uLongf size = compressBound(in.size());
+  out.resize(sizeof(std::uint64_t) + size);
+  // the fastest level: logging must keep up with planning, and meshes are deduplicated already
+  if (compress2(reinterpret_cast<Bytef*>(&out[sizeof(std::uint64_t)]), &size,
+                reinterpret_cast<const Bytef*>(in.data()), in.size(), Z_BEST_SPEED) != Z_OK)
+    throw std::runtime_error("Compression of planning log entry failed");
+  out.resize(sizeof(std::uint64_t) + size);
+  return out;
+}
+
+bool decompress(const std::string& in, std::string& out)
+{
+  std::size_t pos = 0;
+  std::uint64_t size;
+  if (!readValue(in, pos, size))
+    return false;
+  out.resize(size);
+  uLongf out_size = size;
+  return uncompress(reinterpret_cast<Bytef*>(&out[0]), &out_size, reinterpret_cast<const Bytef*>(in.data() + pos),
+                    in.size() - pos) == Z_OK &&
+         out_size == size;
+}
+
+template <typename T>
+void serialize(const T& msg, std::string& bytes)
+{
+  rclcpp::Serialization<T> serializer;
+  rclcpp::SerializedMessage serialized;
+  serializer.serialize_message(&msg, &serialized);
+  const rcl_serialized_message_t& raw = serialized.get_rcl_serialized_message();
+  bytes.assign(reinterpret_cast<const char*>(raw.buffer), raw.buffer_length);
+}
+
+template <typename T>
+bool deserialize(const std::string& bytes, T& msg)
+{
+  rclcpp::SerializedMessage serialized(bytes.size());
+  rcl_serialized_message_t& raw = serialized.get_rcl_serialized_message();
+  std::memcpy(raw.buffer, bytes.data(), bytes.size());
+  raw.buffer_length = bytes.size();
+  try
+  {
+    rclcpp::Serialization<T>().deserialize_message(&serialized, &msg);
+  }
+  catch (const std::exception& e)
+  {
+    RCLCPP_ERROR(LOGGER, "Failed to deserialize planning log entry: %s", e.what());
+    return false;
+  }
+  return true;
+}
+
+/** Call \e f for each mesh of the collision objects of \e scene, in a fixed order */
+template <typename F>
+void forEachMesh(moveit_msgs::msg::PlanningScene& scene, const F& f)
+{
+  for (moveit_msgs::msg::CollisionObject& object : scene.world.collision_objects)
+    for (shape_msgs::msg::Mesh& mesh : object.meshes)
+      f(mesh);
+  for (moveit_msgs::msg::AttachedCollisionObject& attached : scene.robot_state.attached_collision_objects)
+    for (shape_msgs::msg::Mesh& mesh : attached.object.meshes)
+      f(mesh);
+}
+
+std::string hashOf(const std::string& bytes)
+{
+  unsigned char digest[SHA256_DIGEST_LENGTH];
+  SHA256(reinterpret_cast<const unsigned char*>(bytes.data()), bytes.size(), digest);
+  static const char* const HEX = "0123456789abcdef";
+  std::string hash(HASH_LENGTH, '0');
+  for (std::size_t i = 0; i < SHA256_DIGEST_LENGTH; ++i)
+  {
+    hash[2 * i] = HEX[digest[i] >> 4];
+    hash[2 * i + 1] = HEX[digest[i] & 0xf];
+  }
+  return hash;
+}
+}  // namespace
+
+PlanningLogStorage::PlanningLogStorage(const std::string& directory) : directory_(directory), data_size_(0)
+{
+  boost::filesystem::create_directories(boost::filesystem::path(directory_) / MESH_DIRECTORY);
+  for (const boost::filesystem::directory_entry& file :
+       boost::filesystem::directory_iterator(boost::filesystem::path(directory_) / MESH_DIRECTORY))
+  {
+    std::string name = file.path().filename().string();
+    if (name.size() == HASH_LENGTH)
+      meshes_.insert(name);
+  }
+
+  loadIndex();
+
+  data_out_.open((boost::filesystem::path(directory_) / DATA_FILE).string(), std::ios::binary | std::ios::app);
+  index_out_.open((boost::filesystem::path(directory_) / INDEX_FILE).string(), std::ios::binary | std::ios::app);
+  if (!data_out_ || !index_out_)
+    throw std::runtime_error("Cannot open planning log in " + directory_);
+  RCLCPP_DEBUG(LOGGER, "Opened planning log '%s' with %zu entries and %zu meshes", directory_.c_str(),
+               entries_.size(), meshes_.size());
+}
+
+void PlanningLogStorage::loadIndex()
+{
+  const boost::filesystem::path data_path = boost::filesystem::path(directory_) / DATA_FILE;
+  const boost::filesystem::path index_path = boost::filesystem::path(directory_) / INDEX_FILE;
+  data_size_ = boost::filesystem::exists(data_path) ? boost::filesystem::file_size(data_path) : 0;
+
+  std::string index;
+  if (!readFile(index_path.string(), index))
+    return;
+  std::size_t pos = 0;
+  std::size_t valid = 0;
+  while (pos < index.size())
+  {
+    Entry entry;
+    std::uint8_t type;
+    if (!readValue(index, pos, type) || !readValue(index, pos, entry.stamp) || !readValue(index, pos, entry.offset) ||
+        !readValue(index, pos, entry.size) || !readString(index, pos, entry.scene_name) ||
+        !readString(index, pos, entry.query_name) || type > PLANNING_RESULT || entry.offset + entry.size > data_size_)
+      break;
+    entry.type = static_cast<EntryType>(type);
+    entries_.push_back(std::move(entry));
+    indexEntry(entries_.size() - 1);
+    valid = pos;
+  }
+
+  // drop an entry that was written partially, so that entries added later can be read again
+  if (valid < index.size())
+  {
+    RCLCPP_WARN(LOGGER, "Truncating incomplete entry at the end of planning log '%s'", directory_.c_str());
+    boost::filesystem::resize_file(index_path, valid);
+  }
+}
+
+void PlanningLogStorage::indexEntry(std::size_t index)
+{
+  const Entry& entry = entries_[index];
+  if (entry.type == PLANNING_SCENE)
+    scene_index_[entry.scene_name].push_back(index);
+  else
+    query_index_[std::make_pair(entry.scene_name, entry.query_name)].push_back(index);
+  time_index_.emplace(entry.stamp, index);
+}
+
+void PlanningLogStorage::addPlanningScene(const moveit_msgs::msg::PlanningScene& scene, const rclcpp::Time& stamp)
+{
+  // the meshes are stored separately, the logged scene only keeps their hashes
+  moveit_msgs::msg::PlanningScene stripped = scene;
+  std::vector<Hash> meshes;
+  std::string bytes;
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  forEachMesh(stripped, [&](shape_msgs::msg::Mesh& mesh) {
+    serialize(mesh, bytes);
+    meshes.push_back(storeMesh(bytes));
+    mesh = shape_msgs::msg::Mesh();
+  });
+  serialize(stripped, bytes);
+  addEntry(PLANNING_SCENE, scene.name, "", stamp, meshes, bytes);
+}
+
+void PlanningLogStorage::addPlanningQuery(const moveit_msgs::msg::MotionPlanRequest& planning_query,
+                                          const std::string& scene_name, const std::string& query_name,
+                                          const rclcpp::Time& stamp)
+{
+  std::string bytes;
+  serialize(planning_query, bytes);
+  std::lock_guard<std::mutex> lock(mutex_);
+  addEntry(PLANNING_QUERY, scene_name, query_name, stamp, std::vector<Hash>(), bytes);
+}
+
+void PlanningLogStorage::addPlanningResult(const moveit_msgs::msg::RobotTrajectory& result,
+                                           const std::string& scene_name, const std::string& query_name,
+                                           const rclcpp::Time& stamp)
+{
+  std::string bytes;
+  serialize(result, bytes);
+  std::lock_guard<std::mutex> lock(mutex_);
+  addEntry(PLANNING_RESULT, scene_name, query_name, stamp, std::vector<Hash>(), bytes);
+}
+
+void PlanningLogStorage::addEntry(EntryType type, const std::string& scene_name, const std::string& query_name,
+                                  const rclcpp::Time& stamp, const std::vector<Hash>& meshes,
+                                  const std::string& serialized)
+{
+  std::string payload;
+  payload.reserve(sizeof(std::uint32_t) + meshes.size() * HASH_LENGTH + serialized.size());
+  appendValue<std::uint32_t>(payload, meshes.size());
+  for (const Hash& hash : meshes)
+    payload.append(hash);
+  payload.append(serialized);
+  const std::string data = compress(payload);
+
+  Entry entry;
+  entry.type = type;
+  entry.scene_name = scene_name;
+  entry.query_name = query_name;
+  entry.stamp = stamp.nanoseconds();
+  entry.offset = data_size_;
+  entry.size = data.size();
+
+  // the data is flushed before the index, so the index never refers to missing data
+  data_out_.write(data.data(), data.size());
+  data_out_.flush();
+  if (!data_out_)
+    throw std::runtime_error("Failed to write to planning log in " + directory_);
+  data_size_ += data.size();
+
+  std::string record;
+  appendValue<std::uint8_t>(record, type);
+  appendValue(record, entry.stamp);
+  appendValue(record, entry.offset);
+  appendValue(record, entry.size);
+  appendString(record, scene_name);
+  appendString(record, query_name);
+  index_out_.write(record.data(), record.size());
+  index_out_.flush();
+  if (!index_out_)
+    throw std::runtime_error("Failed to write to planning log index in " + directory_);
+
+  entries_.push_back(std::move(entry));
+  indexEntry(entries_.size() - 1);
+}
+
+std::string PlanningLogStorage::getMeshPath(const Hash& hash) const
+{
+  return (boost::filesystem::path(directory_) / MESH_DIRECTORY / hash).string();
+}
+
+PlanningLogStorage::Hash PlanningLogStorage::storeMesh(const std::string& serialized_mesh)
+{
+  Hash hash = hashOf(serialized_mesh);
+  if (meshes_.count(hash))
+    return hash;
+
+  // write to a temporary file first, so that a mesh file is always complete
+  const std::string path = getMeshPath(hash);
+  const std::string data = compress(serialized_mesh);
+  {
+    std::ofstream out(path + ".tmp", std::ios::binary | std::ios::trunc);
+    out.write(data.data(), data.size());
+    if (!out)
+      throw std::runtime_error("Failed to write mesh " + path);
+  }
+  boost::filesystem::rename(path + ".tmp", path);
+  meshes_.insert(hash);
+  return hash;
+}
+
+bool PlanningLogStorage::loadMesh(const Hash& hash, std::string& serialized_mesh) const
+{
+  std::string data;
+  if (!readFile(getMeshPath(hash), data) || !decompress(data, serialized_mesh))
+  {
+    RCLCPP_ERROR(LOGGER, "Failed to read mesh %s from planning log '%s'", hash.c_str(), directory_.c_str());
+    return false;
+  }
+  return true;
+}
+
+bool PlanningLogStorage::readData(const Entry& entry, std::vector<Hash>& meshes, std::string& serialized) const
+{
+  std::ifstream in((boost::filesystem::path(directory_) / DATA_FILE).string(), std::ios::binary);
+  std::string data(entry.size, '\0');
+  in.seekg(entry.offset);
+  in.read(&data[0], data.size());
+  std::string payload;
+  if (!in || !decompress(data, payload))
+  {
+    RCLCPP_ERROR(LOGGER, "Failed to read entry at %lu from planning log '%s'", static_cast<unsigned long>(entry.offset),
+                 directory_.c_str());
+    return false;
+  }
+
+  std::size_t pos = 0;
+  std::uint32_t mesh_count;
+  if (!readValue(payload, pos, mesh_count) || (payload.size() - pos) / HASH_LENGTH < mesh_count)
+    return false;
+  meshes.resize(mesh_count);
+  for (Hash& hash : meshes)
+  {
+    hash.assign(payload, pos, HASH_LENGTH);
+    pos += HASH_LENGTH;
+  }
+  serialized.assign(payload, pos, std::string::npos);
+  return true;
+}
+
+bool PlanningLogStorage::readEntry(const Entry& entry, moveit_msgs::msg::PlanningScene& scene) const
+{
+  std::vector<Hash> meshes;
+  std::string bytes;
+  if (entry.type != PLANNING_SCENE || !readData(entry, meshes, bytes) || !deserialize(bytes, scene))
+    return false;
+
+  std::size_t count = 0;
+  bool ok = true;
+  forEachMesh(scene, [&](shape_msgs::msg::Mesh& mesh) {
+    if (!ok || count >= meshes.size())
+    {
+      ok = false;
+      return;
+    }
+    ok = loadMesh(meshes[count++], bytes) && deserialize(bytes, mesh);
+  });
+  return ok && count == meshes.size();
+}
+
+bool PlanningLogStorage::readEntry(const Entry& entry, moveit_msgs::msg::MotionPlanRequest& planning_query) const
+{
+  std::vector<Hash> meshes;
+  std::string bytes;
+  return entry.type == PLANNING_QUERY && readData(entry, meshes, bytes) && deserialize(bytes, planning_query);
+}
+
+bool PlanningLogStorage::readEntry(const Entry& entry, moveit_msgs::msg::RobotTrajectory& result) const
+{
+  std::vector<Hash> meshes;
+  std::string bytes;
+  return entry.type == PLANNING_RESULT && readData(entry, meshes, bytes) && deserialize(bytes, result);
+}
+
+const PlanningLogStorage::Entry* PlanningLogStorage::findLatest(const std::vector<std::size_t>& indices,
+                                                                EntryType type) const
+{
+  for (std::vector<std::size_t>::const_reverse_iterator it = indices.rbegin(); it != indices.rend(); ++it)
+    if (entries_[*it].type == type)
+      return &entries_[*it];
+  return nullptr;
+}
+
+bool PlanningLogStorage::hasPlanningScene(const std::string& name) const
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  return scene_index_.find(name) != scene_index_.end();
+}
+
+void PlanningLogStorage::getPlanningSceneNames(std::vector<std::string>& names) const
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  names.clear();
+  names.reserve(scene_index_.size());
+  for (const std::pair<const std::string, std::vector<std::size_t>>& scene : scene_index_)
+    names.push_back(scene.first);
+}
+
+void PlanningLogStorage::getPlanningSceneNames(const std::string& regex, std::vector<std::string>& names) const
+{
+  getPlanningSceneNames(names);
+  if (regex.empty())
+    return;
+  boost::regex r(regex);
+  std::vector<std::string> filtered;
+  for (std::string& name : names)
+    if (boost::regex_match(name, r))
+      filtered.push_back(std::move(name));
+  names.swap(filtered);
+}
+
+bool PlanningLogStorage::getPlanningScene(moveit_msgs::msg::PlanningScene& scene, const std::string& scene_name) const
+{
+  Entry entry;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::map<std::string, std::vector<std::size_t>>::const_iterator it = scene_index_.find(scene_name);
+    if (it == scene_index_.end())
+    {
+      RCLCPP_WARN(LOGGER, "Planning scene '%s' was not found in the planning log", scene_name.c_str());
+      return false;
+    }
+    entry = entries_[it->second.back()];
+  }
+  return readEntry(entry, scene);
+}
+
+void PlanningLogStorage::getPlanningQueriesNames(std::vector<std::string>& query_names,
+                                                 const std::string& scene_name) const
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  query_names.clear();
+  for (std::map<std::pair<std::string, std::string>, std::vector<std::size_t>>::const_iterator it =
+           query_index_.lower_bound(std::make_pair(scene_name, std::string()));
+       it != query_index_.end() && it->first.first == scene_name; ++it)
+    if (findLatest(it->second, PLANNING_QUERY))
+      query_names.push_back(it->first.second);
+}
+
+bool PlanningLogStorage::getPlanningQuery(moveit_msgs::msg::MotionPlanRequest& planning_query,
+                                          const std::string& scene_name, const std::string& query_name) const
+{
+  Entry entry;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::map<std::pair<std::string, std::string>, std::vector<std::size_t>>::const_iterator it =
+        query_index_.find(std::make_pair(scene_name, query_name));
+    const Entry* latest = it == query_index_.end() ? nullptr : findLatest(it->second, PLANNING_QUERY);
+    if (!latest)
+    {
+      RCLCPP_ERROR(LOGGER, "Planning query '%s' not found for scene '%s'", query_name.c_str(), scene_name.c_str());
+      return false;
+    }
+    entry = *latest;
+  }
+  return readEntry(entry, planning_query);
+}
+
+void PlanningLogStorage::getPlanningResults(std::vector<moveit_msgs::msg::RobotTrajectory>& planning_results,
+                                            const std::string& scene_name, const std::string& query_name) const
+{
+  std::vector<Entry> entries;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::map<std::pair<std::string, std::string>, std::vector<std::size_t>>::const_iterator it =
+        query_index_.find(std::make_pair(scene_name, query_name));
+    if (it != query_index_.end())
+      for (std::size_t index : it->second)
+        if (entries_[index].type == PLANNING_RESULT)
+          entries.push_back(entries_[index]);
+  }
+  planning_results.clear();
+  planning_results.reserve(entries.size());
+  for (const Entry& entry : entries)
+  {
+    planning_results.emplace_back();
+    if (!readEntry(entry, planning_results.back()))
+      planning_results.pop_back();
+  }
+}
+
+void PlanningLogStorage::getEntries(std::vector<Entry>& entries, const rclcpp::Time& from,
+                                    const rclcpp::Time& to) const
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  entries.clear();
+  for (std::multimap<std::int64_t, std::size_t>::const_iterator it = time_index_.lower_bound(from.nanoseconds());
+       it != time_index_.end() && it->first <= to.nanoseconds(); ++it)
+    entries.push_back(entries_[it->second]);
+}
+
+std::size_t PlanningLogStorage::getEntryCount() const
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  return entries_.size();
+}
+
+std::size_t PlanningLogStorage::getMeshCount() const
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  return meshes_.size();
+}
+}  // namespace moveit_warehouse
@@ -0,0 +1,337 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, PickNik LLC
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik LLC nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include <moveit/warehouse/trajectory_cache_storage.h>
+#include <moveit/planning_scene/planning_scene.h>
+#include <geometric_shapes/shape_operations.h>
+#include <rclcpp/serialization.hpp>
+#include <boost/uuid/uuid_generators.hpp>
+#include <boost/uuid/uuid_io.hpp>
+#include <openssl/sha.h>
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+#include <utility>
+
+const std::string moveit_warehouse::TrajectoryCacheStorage::DATABASE_NAME = "moveit_trajectory_cache";
+
+const std::string moveit_warehouse::TrajectoryCacheStorage::ENTRY_ID_NAME = "cache_entry_id";
+const std::string moveit_warehouse::TrajectoryCacheStorage::SCENE_HASH_NAME = "scene_hash";
+const std::string moveit_warehouse::TrajectoryCacheStorage::GROUP_NAME = "group_id";
+const std::string moveit_warehouse::TrajectoryCacheStorage::JOINT_NAMES_NAME = "joint_names";
+const std::string moveit_warehouse::TrajectoryCacheStorage::START_NAME = "start_positions";
+const std::string moveit_warehouse::TrajectoryCacheStorage::GOAL_NAME = "goal_positions";
+
+static const rclcpp::Logger LOGGER = rclcpp::get_logger("moveit.ros.warehouse.trajectory_cache_storage");
+
+using warehouse_ros::Metadata;
+using warehouse_ros::Query;
+
+namespace
+{
+const double ORIENTATION_RESOLUTION = 1e-3;
+
+/** \brief Appends the canonical byte representation of scene geometry to a buffer */
+class SceneHashInput
+{
+public:
+  SceneHashInput(double resolution) : resolution_(resolution)
+  {
+  }
+
+  void add(const std::string& value)
+  {
+    add<std::uint64_t>(value.size());
+    data_.append(value);
+  }
+
+  template <typename T>
+  void add(T value)
+  {
+    data_.append(reinterpret_cast<const char*>(&value), sizeof(T));
+  }
+
+  void add(const Eigen::Isometry3d& pose)
+  {
+    // a quaternion and its negation are the same orientation
+    Eigen::Quaterniond q(pose.linear());
+    if (q.w() < 0.0)
+      q.coeffs() = -q.coeffs();
+    for (int i = 0; i < 3; ++i)
+      add(std::llround(pose.translation()[i] / resolution_));
+    for (int i = 0; i < 4; ++i)
+      add(std::llround(q.coeffs()[i] / ORIENTATION_RESOLUTION));
+  }
+
+  void add(const shapes::ShapeMsg& shape)
+  {
+    boost::apply_visitor(ShapeVisitor(*this), shape);
+  }
+
+  std::string getHash() const
+  {
+    unsigned char digest[SHA256_DIGEST_LENGTH];
+    SHA256(reinterpret_cast<const unsigned char*>(data_.data()), data_.size(), digest);
+    std::ostringstream hash;
+    hash << std::hex;
+    for (unsigned char byte : digest)
+      hash << (byte >> 4) << (byte & 0xf);
+    return hash.str();
+  }
+
+private:
+  /** \brief Adds the serialized message of a shape, which is exact since it does not depend on any pose */
+  class ShapeVisitor : public boost::static_visitor<void>
+  {
+  public:
+    ShapeVisitor(SceneHashInput& input) : input_(input)
+    {
+    }
+
+    template <typename T>
+    void operator()(const T& msg) const
+    {
+      rclcpp::Serialization<T> serializer;
+      rclcpp::SerializedMessage serialized;
+      serializer.serialize_message(&msg, &serialized);
+      const rcl_serialized_message_t& raw = serialized.get_rcl_serialized_message();
+      input_.add(std::string(reinterpret_cast<const char*>(raw.buffer), raw.buffer_length));
+    }
+
+  private:
+    SceneHashInput& input_;
+  };
+
+  double resolution_;
+  std::string data_;
+};
+
+std::string encodePositions(const std::vector<double>& positions)
+{
+  std::ostringstream out;
+  out.precision(17);
+  for (std::size_t i = 0; i < positions.size(); ++i)
+    out << (i ? " " : "") << positions[i];
+  return out.str();
+}
+
+std::vector<double> decodePositions(const std::string& encoded)
+{
+  std::istringstream in(encoded);
+  std::vector<double> positions;
+  double value;
+  while (in >> value)
+    positions.push_back(value);
+  return positions;
+}
+
+std::string encodeNames(const std::vector<std::string>& names)
+{
+  std::string encoded;
+  for (const std::string& name : names)
+    encoded += (encoded.empty() ? "" : " ") + name;
+  return encoded;
+}
+
+double getDistance(const std::vector<double>& a, const std::vector<double>& b)
+{
+  double distance_sq = 0.0;
+  for (std::size_t i = 0; i < a.size(); ++i)
+    distance_sq += (a[i] - b[i]) * (a[i] - b[i]);
+  return std::sqrt(distance_sq);
+}
+}  // namespace
+
+moveit_warehouse::TrajectoryCacheStorage::TrajectoryCacheStorage(warehouse_ros::DatabaseConnection::Ptr conn)
+  : MoveItMessageStorage(std::move(conn))
+{
+  createCollections();
+}
+
+void moveit_warehouse::TrajectoryCacheStorage::createCollections()
+{
+  trajectory_collection_ =
+      conn_->openCollectionPtr<moveit_msgs::msg::RobotTrajectory>(DATABASE_NAME, "robot_trajectory");
+}
+
+void moveit_warehouse::TrajectoryCacheStorage::reset()
+{
+  trajectory_collection_.reset();
+  conn_->dropDatabase(DATABASE_NAME);
+  createCollections();
+}
+
+std::string moveit_warehouse::TrajectoryCacheStorage::computeSceneHash(const planning_scene::PlanningScene& scene,
+                                                                       double radius, double resolution)
+{
+  SceneHashInput input(resolution);
+  input.add(scene.getRobotModel()->getName());
+
+  const moveit::core::RobotState& state = scene.getCurrentState();
+  std::vector<const moveit::core::AttachedBody*> attached_bodies;
+  state.getAttachedBodies(attached_bodies);
+  std::sort(attached_bodies.begin(), attached_bodies.end(),
+            [](const moveit::core::AttachedBody* a, const moveit::core::AttachedBody* b) {
+              return a->getName() < b->getName();
+            });
+  for (const moveit::core::AttachedBody* attached_body : attached_bodies)
+  {
+    input.add(attached_body->getName());
+    input.add(attached_body->getAttachedLinkName());
+    for (std::size_t i = 0; i < attached_body->getShapes().size(); ++i)
+    {
+      shapes::ShapeMsg shape_msg;
+      if (!shapes::constructMsgFromShape(attached_body->getShapes()[i].get(), shape_msg))
+        continue;
+      input.add(shape_msg);
+      input.add(attached_body->getFixedTransforms()[i]);
+    }
+  }
+
+  // world objects are sorted by id
+  const Eigen::Vector3d root = state.getGlobalLinkTransform(scene.getRobotModel()->getRootLink()).translation();
+  for (const std::pair<const std::string, collision_detection::World::ObjectPtr>& object : *scene.getWorld())
+  {
+    bool added = false;
+    for (std::size_t i = 0; i < object.second->shapes_.size(); ++i)
+    {
+      const shapes::Shape* shape = object.second->shapes_[i].get();
+      const Eigen::Isometry3d& pose = object.second->shape_poses_[i];
+      Eigen::Vector3d center;
+      double shape_radius;
+      shapes::computeShapeBoundingSphere(shape, center, shape_radius);
+      shapes::ShapeMsg shape_msg;
+      if ((pose * center - root).norm() - shape_radius > radius || !shapes::constructMsgFromShape(shape, shape_msg))
+        continue;
+      if (!added)
+        input.add(object.first);
+      added = true;
+      input.add(shape_msg);
+      input.add(pose);
+    }
+  }
+  return input.getHash();
+}
+
+std::string moveit_warehouse::TrajectoryCacheStorage::addTrajectory(const moveit_msgs::msg::RobotTrajectory& trajectory,
+                                                                    const std::string& scene_hash,
+                                                                    const std::string& group)
+{
+  const trajectory_msgs::msg::JointTrajectory& joint_trajectory = trajectory.joint_trajectory;
+  if (joint_trajectory.points.empty())
+  {
+    RCLCPP_ERROR(LOGGER, "Cannot cache a trajectory without waypoints");
+    return "";
+  }
+
+  const std::string id = boost::uuids::to_string(boost::uuids::random_generator()());
+  Metadata::Ptr metadata = trajectory_collection_->createMetadata();
+  metadata->append(ENTRY_ID_NAME, id);
+  metadata->append(SCENE_HASH_NAME, scene_hash);
+  metadata->append(GROUP_NAME, group);
+  metadata->append(JOINT_NAMES_NAME, encodeNames(joint_trajectory.joint_names));
+  metadata->append(START_NAME, encodePositions(joint_trajectory.points.front().positions));
+  metadata->append(GOAL_NAME, encodePositions(joint_trajectory.points.back().positions));
+  trajectory_collection_->insert(trajectory, metadata);
+  RCLCPP_DEBUG(LOGGER, "Cached trajectory '%s' of group '%s' for scene %s", id.c_str(), group.c_str(),
+               scene_hash.c_str());
+  return id;
+}
+
+void moveit_warehouse::TrajectoryCacheStorage::getCandidates(std::vector<TrajectoryCacheCandidate>& candidates,
+                                                             const std::string& scene_hash, const std::string& group,
+                                                             const std::vector<std::string>& joint_names,
+                                                             const std::vector<double>& start,
+                                                             const std::vector<double>& goal,
+                                                             std::size_t max_candidates, double max_distance) const
+{
+  candidates.clear();
+  if (start.size() != joint_names.size() || goal.size() != joint_names.size())
+  {
+    RCLCPP_ERROR(LOGGER, "Start and goal must have one position for each of the %zu joints", joint_names.size());
+    return;
+  }
+
+  // rank the entries by their metadata, only the selected trajectories are loaded
+  Query::Ptr q = trajectory_collection_->createQuery();
+  q->append(SCENE_HASH_NAME, scene_hash);
+  q->append(GROUP_NAME, group);
+  q->append(JOINT_NAMES_NAME, encodeNames(joint_names));
+  std::vector<std::pair<double, std::string>> ranked;
+  for (const RobotTrajectoryWithMetadata& entry : trajectory_collection_->queryList(q, true))
+  {
+    const std::vector<double> entry_start = decodePositions(entry->lookupString(START_NAME));
+    const std::vector<double> entry_goal = decodePositions(entry->lookupString(GOAL_NAME));
+    if (entry_start.size() != start.size() || entry_goal.size() != goal.size())
+      continue;
+    const double distance = getDistance(start, entry_start) + getDistance(goal, entry_goal);
+    if (distance <= max_distance)
+      ranked.emplace_back(distance, entry->lookupString(ENTRY_ID_NAME));
+  }
+  const std::size_t count = std::min(max_candidates, ranked.size());
+  std::partial_sort(ranked.begin(), ranked.begin() + count, ranked.end());
+
+  for (std::size_t i = 0; i < count; ++i)
+  {
+    Query::Ptr id_query = trajectory_collection_->createQuery();
+    id_query->append(ENTRY_ID_NAME, ranked[i].second);
+    std::vector<RobotTrajectoryWithMetadata> trajectories = trajectory_collection_->queryList(id_query, false);
+    if (!trajectories.empty())
+      candidates.push_back(TrajectoryCacheCandidate{ trajectories.front(), ranked[i].first });
+  }
+}
+
+std::size_t moveit_warehouse::TrajectoryCacheStorage::getTrajectoryCount(const std::string& scene_hash) const
+{
+  Query::Ptr q = trajectory_collection_->createQuery();
+  if (!scene_hash.empty())
+    q->append(SCENE_HASH_NAME, scene_hash);
+  return trajectory_collection_->queryList(q, true).size();
+}
+
+void moveit_warehouse::TrajectoryCacheStorage::removeTrajectory(const std::string& entry_id)
+{
+  Query::Ptr q = trajectory_collection_->createQuery();
+  q->append(ENTRY_ID_NAME, entry_id);
+  unsigned int rem = trajectory_collection_->removeMessages(q);
+  RCLCPP_DEBUG(LOGGER, "Removed %u cached trajectories (id '%s')", rem, entry_id.c_str());
+}
+
+void moveit_warehouse::TrajectoryCacheStorage::removeTrajectories(const std::string& scene_hash)
+{
+  Query::Ptr q = trajectory_collection_->createQuery();
+  q->append(SCENE_HASH_NAME, scene_hash);
+  unsigned int rem = trajectory_collection_->removeMessages(q);
+  RCLCPP_DEBUG(LOGGER, "Removed %u cached trajectories for scene %s", rem, scene_hash.c_str());
+}
@@ -79,7 +79,8 @@ typedef std::map<std::pair<std::string, std::string>, LinkPairData> LinkPairMap;
  * \brief Generate an adjacency list of links that are always and never in collision, to speed up collision detection
  * \param parent_scene A reference to the robot in the planning scene
  * \param include_never_colliding Flag to disable the check for links that are never in collision
- * \param trials Set the number random collision checks that are made. Increase the probability of correctness
+ * \param trials Set the maximum number of random collision checks that are made. Increase the probability of
+ * correctness. The checks stop early once no new pair of links was seen colliding for a quarter of the trials
  * \param min_collision_fraction If collisions are found between a pair of links >= this fraction, the are assumed
  * "always" in collision
  * \return Adj List of unique set of pairs of links in string-based form
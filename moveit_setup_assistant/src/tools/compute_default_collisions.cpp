@@ -40,6 +40,7 @@
 #include <boost/thread.hpp>
 #include <boost/unordered_map.hpp>
 #include <boost/assign.hpp>
+#include <algorithm>
 #include <ros/console.h>
 
 namespace moveit_setup_assistant
@@ -59,27 +60,33 @@ const boost::unordered_map<std::string, DisabledReason> REASONS_FROM_STRING =
 // Unique set of pairs of links in string-based form
 typedef std::set<std::pair<std::string, std::string> > StringPairSet;
 
+// Results of the "never in collision" trials shared between the threads
+struct NeverInCollisionSearch
+{
+  NeverInCollisionSearch(unsigned int num_trials) : num_trials_(num_trials)
+  {
+  }
+  const unsigned int num_trials_;
+  boost::mutex lock_;
+  std::vector<std::pair<std::string, std::string> > discovered_;  // link pairs seen colliding, in discovery order
+  unsigned int trials_claimed_ = 0;
+  unsigned int trials_done_ = 0;
+  unsigned int last_discovery_ = 0;  // trials done when the last new pair was discovered
+  bool stopped_ = false;
+};
+
 // Struct for passing parameters to threads, for cleaner code
 struct ThreadComputation
 {
-  ThreadComputation(planning_scene::PlanningScene& scene, const collision_detection::CollisionRequest& req,
-                    int thread_id, int num_trials, StringPairSet* links_seen_colliding, boost::mutex* lock,
-                    unsigned int* progress)
-    : scene_(scene)
-    , req_(req)
-    , thread_id_(thread_id)
-    , num_trials_(num_trials)
-    , links_seen_colliding_(links_seen_colliding)
-    , lock_(lock)
-    , progress_(progress)
+  ThreadComputation(const planning_scene::PlanningScenePtr& scene, const collision_detection::CollisionRequest& req,
+                    int thread_id, NeverInCollisionSearch* search, unsigned int* progress)
+    : scene_(scene), req_(req), thread_id_(thread_id), search_(search), progress_(progress)
   {
   }
-  planning_scene::PlanningScene& scene_;
+  planning_scene::PlanningScenePtr scene_;  // own scene of the thread, its ACM disables the pairs seen colliding
   const collision_detection::CollisionRequest& req_;
   int thread_id_;
-  unsigned int num_trials_;
-  StringPairSet* links_seen_colliding_;
-  boost::mutex* lock_;
+  NeverInCollisionSearch* search_;
   unsigned int* progress_;  // only to be updated by thread 0
 };
 
@@ -151,6 +158,7 @@ static unsigned int disableAlwaysInCollision(planning_scene::PlanningScene& scen
 
 /**
  * \brief Get the pairs of links that are never in collision
+ * \param num_trials The maximum number of random states to check
  * \param scene A reference to the robot in the planning scene
  * \param link_pairs List of all unique link pairs and each pair's properties
  * \param req A reference to a collision request that is already initialized
@@ -555,7 +563,7 @@ unsigned int disableNeverInCollision(const unsigned int num_trials, planning_sce
   unsigned int num_disabled = 0;
 
   boost::thread_group bgroup;  // create a group of threads
-  boost::mutex lock;           // used for sharing the same data structures
+  NeverInCollisionSearch search(num_trials);
 
   int num_threads = boost::thread::hardware_concurrency();  // how many cores does this computer have?
   // ROS_INFO_STREAM("Performing " << num_trials << " trials for 'always in collision' checking on " <<
@@ -563,7 +571,12 @@ unsigned int disableNeverInCollision(const unsigned int num_trials, planning_sce
 
   for (int i = 0; i < num_threads; ++i)
   {
-    ThreadComputation tc(scene, req, i, num_trials / num_threads, &links_seen_colliding, &lock, progress);
+    // each thread prunes the pairs it knows to collide from its own copy of the allowed collision matrix, so that
+    // only the undecided pairs are checked and no lock is needed during collision checking
+    planning_scene::PlanningScenePtr thread_scene = scene.diff();
+    for (const std::pair<std::string, std::string>& link_pair : links_seen_colliding)
+      thread_scene->getAllowedCollisionMatrixNonConst().setEntry(link_pair.first, link_pair.second, true);
+    ThreadComputation tc(thread_scene, req, i, &search, progress);
     bgroup.create_thread(boost::bind(&disableNeverInCollisionThread, tc));
   }
 
@@ -578,6 +591,9 @@ unsigned int disableNeverInCollision(const unsigned int num_trials, planning_sce
     bgroup.join_all();  // wait for all threads to interrupt
     throw;
   }
+  links_seen_colliding.insert(search.discovered_.begin(), search.discovered_.end());
+  ROS_DEBUG("Found %u link pairs in collision in %u trials", (unsigned int)search.discovered_.size(),
+            search.trials_done_);
 
   // Loop through every possible link pair and check if it has ever been seen in collision
   for (std::pair<const std::pair<std::string, std::string>, LinkPairData>& link_pair : link_pairs)
@@ -607,45 +623,84 @@ unsigned int disableNeverInCollision(const unsigned int num_trials, planning_sce
 // ******************************************************************************************
 void disableNeverInCollisionThread(ThreadComputation tc)
 {
-  // ROS_INFO_STREAM("Thread " << tc.thread_id_ << " running " << tc.num_trials_ << " trials");
+  // Trials are claimed in batches, after which the results are exchanged with the other threads
+  static const unsigned int BATCH_SIZE = 100;
+
+  // Stop early once no new pair was seen colliding for this fraction of the trials. By the rule of three, a pair
+  // that is still not seen colliding then collides in less than 12 / num_trials of the states, with 95% confidence.
+  static const double STOP_FRACTION = 0.25;
 
-  // User feedback vars
-  const unsigned int progress_interval = tc.num_trials_ / 20;  // show progress update every 5%
+  NeverInCollisionSearch& search = *tc.search_;
+  const unsigned int stop_window = std::max(BATCH_SIZE, (unsigned int)(search.num_trials_ * STOP_FRACTION));
+  collision_detection::AllowedCollisionMatrix& acm = tc.scene_->getAllowedCollisionMatrixNonConst();
 
   // Create a new kinematic state for this thread to work on
-  moveit::core::RobotState robot_state(tc.scene_.getRobotModel());
+  moveit::core::RobotState robot_state(tc.scene_->getRobotModel());
 
-  // Do a large number of tests
-  for (unsigned int i = 0; i < tc.num_trials_; ++i)
+  StringPairSet seen;  // link pairs seen colliding by this thread, or taken from the other threads
+  std::vector<std::pair<std::string, std::string> > new_pairs;
+  std::size_t discovered_taken = 0;  // number of entries of search.discovered_ taken into seen
+  while (true)
   {
-    boost::this_thread::interruption_point();
-
-    // Status update at intervals and only for 0 thread
-    if (i % progress_interval == 0 && tc.thread_id_ == 0)
+    unsigned int batch_trials;
     {
-      (*tc.progress_) = i * 92 / tc.num_trials_ + 8;  // 8 is the amount of progress already completed in prev steps
+      boost::mutex::scoped_lock slock(search.lock_);
+      if (search.stopped_ || search.trials_claimed_ >= search.num_trials_)
+        break;
+      batch_trials = std::min(BATCH_SIZE, search.num_trials_ - search.trials_claimed_);
+      search.trials_claimed_ += batch_trials;
     }
 
-    collision_detection::CollisionResult res;
-    robot_state.setToRandomPositions();
-    tc.scene_.checkSelfCollision(tc.req_, res, robot_state);
-
-    // Check all contacts
-    for (collision_detection::CollisionResult::ContactMap::const_iterator it = res.contacts.begin();
-         it != res.contacts.end(); ++it)
+    // Do a batch of tests
+    for (unsigned int i = 0; i < batch_trials; ++i)
     {
-      // Check if this collision pair is unique before doing a thread lock
-      if (tc.links_seen_colliding_->find(it->first) == tc.links_seen_colliding_->end())
-      {
-        // Collision Matrix and links_seen_colliding is modified only if needed, based on above if statement
+      boost::this_thread::interruption_point();
 
-        boost::mutex::scoped_lock slock(*tc.lock_);
-        tc.links_seen_colliding_->insert(it->first);
+      collision_detection::CollisionResult res;
+      robot_state.setToRandomPositions();
+      tc.scene_->checkSelfCollision(tc.req_, res, robot_state);
 
-        tc.scene_.getAllowedCollisionMatrixNonConst().setEntry(it->first.first, it->first.second,
-                                                               true);  // disable link checking in the collision matrix
+      // Check all contacts
+      for (collision_detection::CollisionResult::ContactMap::const_iterator it = res.contacts.begin();
+           it != res.contacts.end(); ++it)
+      {
+        if (seen.insert(it->first).second)
+        {
+          new_pairs.push_back(it->first);
+          acm.setEntry(it->first.first, it->first.second, true);  // disable link checking in the collision matrix
+        }
+      }
+    }
+
+    // Merge the results of this batch and take the pairs found by the other threads
+    boost::mutex::scoped_lock slock(search.lock_);
+    search.trials_done_ += batch_trials;
+    for (const std::pair<std::string, std::string>& link_pair : new_pairs)
+    {
+      // another thread may have found the same pair in the meantime
+      if (std::find(search.discovered_.begin() + discovered_taken, search.discovered_.end(), link_pair) ==
+          search.discovered_.end())
+      {
+        search.discovered_.push_back(link_pair);
+        search.last_discovery_ = search.trials_done_;
       }
     }
+    new_pairs.clear();
+    for (; discovered_taken < search.discovered_.size(); ++discovered_taken)
+    {
+      const std::pair<std::string, std::string>& link_pair = search.discovered_[discovered_taken];
+      if (seen.insert(link_pair).second)
+        acm.setEntry(link_pair.first, link_pair.second, true);
+    }
+    if (search.trials_done_ - search.last_discovery_ >= stop_window)
+      search.stopped_ = true;
+
+    // Status update only for 0 thread
+    if (tc.thread_id_ == 0)
+    {
+      // 8 is the amount of progress already completed in prev steps
+      (*tc.progress_) = (unsigned long long)search.trials_done_ * 92 / std::max(1u, search.num_trials_) + 8;
+    }
   }
 }
 